@@ -55,6 +55,7 @@ COMPRESSION_NONE = CompressionType_NONE
 COMPRESSION_SNAPPY = CompressionType_SNAPPY
 COMPRESSION_LZ4 = CompressionType_LZ4
 COMPRESSION_ZLIB = CompressionType_ZLIB
+COMPRESSION_ZSTD = CompressionType_ZSTD
 
 cdef dict _compression_types = {
     'default': COMPRESSION_DEFAULT,
@@ -62,6 +63,7 @@ cdef dict _compression_types = {
     'snappy': COMPRESSION_SNAPPY,
     'lz4': COMPRESSION_LZ4,
     'zlib': COMPRESSION_ZLIB,
+    'zstd': COMPRESSION_ZSTD,
 }
 
 cdef dict _compression_type_to_name = _reverse_dict(_compression_types)
@@ -74,6 +76,7 @@ ENCODING_PREFIX = EncodingType_PREFIX
 ENCODING_BIT_SHUFFLE = EncodingType_BIT_SHUFFLE
 ENCODING_RLE = EncodingType_RLE
 ENCODING_DICT = EncodingType_DICT
+ENCODING_DELTA = EncodingType_DELTA
 
 cdef dict _encoding_types = {
     'auto': ENCODING_AUTO,
@@ -82,6 +85,7 @@ cdef dict _encoding_types = {
     'bitshuffle': ENCODING_BIT_SHUFFLE,
     'rle': ENCODING_RLE,
     'dict': ENCODING_DICT,
+    'delta': ENCODING_DELTA,
 }
 
 cdef dict _encoding_type_to_name = _reverse_dict(_encoding_types)
@@ -243,7 +247,7 @@ cdef class ColumnSpec:
         Parameters
         ----------
         compression : string or int
-          One of {'default', 'none', 'snappy', 'lz4', 'zlib'}
+          One of {'default', 'none', 'snappy', 'lz4', 'zlib', 'zstd'}
           Or see kudu.COMPRESSION_* constants
 
         Returns
@@ -400,7 +404,7 @@ cdef class SchemaBuilder:
           New columns are nullable by default. Set boolean value for explicit
           nullable / not-nullable
         compression : string or int
-          One of {'default', 'none', 'snappy', 'lz4', 'zlib'}
+          One of {'default', 'none', 'snappy', 'lz4', 'zlib', 'zstd'}
           Or see kudu.COMPRESSION_* constants
         encoding : string or int
           One of {'auto', 'plain', 'prefix', 'bitshuffle', 'rle', 'dict'}
@@ -0,0 +1,455 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Micro benchmark for the CFile block encodings. For every supported
+// encoding of each type in --encoding_types, and for every cardinality and
+// sort order of synthetic values, it measures:
+//  - the throughput of building the data blocks,
+//  - the encoded size, compared to the size of the values,
+//  - the throughput of decoding the blocks with CopyNextValues(), and with
+//    CopyNextSelectedValues() and a selection vector,
+//  - the latency of seeking to a random position in a block and copying the
+//    value there.
+//
+// Instead of synthetic values, --encoding_input_file may be given a dump of a
+// column of type --encoding_input_type, with one value per line.
+//
+// The results are written to stdout as JSON, one object per line, so that
+// the results of different builds can be compared.
+//
+// Dictionary encoding is skipped: its blocks can't be decoded without the
+// dictionary stored in the CFile.
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <gflags/gflags.h>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/type_encodings.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/random.h"
+#include "kudu/util/stopwatch.h"
+
+DEFINE_string(encoding_types, "BOOL,INT8,INT16,INT32,INT64,FLOAT,DOUBLE,BINARY",
+              "Comma-separated list of the types to benchmark the encodings of");
+DEFINE_int32(encoding_num_values, 1000000,
+             "Number of synthetic values to encode for each benchmark");
+DEFINE_string(encoding_cardinalities, "16,4096,1000000",
+              "Comma-separated list of the numbers of distinct synthetic values");
+DEFINE_string(encoding_sort_orders, "random,sorted",
+              "Comma-separated list of the orders of the synthetic values: 'random' "
+              "and/or 'sorted'");
+DEFINE_string(encoding_input_file, "",
+              "If set, benchmark the values read from this file, one per line, "
+              "instead of synthetic values");
+DEFINE_string(encoding_input_type, "BINARY",
+              "Type of the values in --encoding_input_file");
+DEFINE_int32(encoding_iterations, 3,
+             "Number of times each measurement is repeated. The best one is reported");
+DEFINE_int32(encoding_batch_size, 1024,
+             "Number of values decoded per call, i.e. the analogue of a scan batch");
+DEFINE_double(encoding_selectivity, 0.1,
+              "Fraction of the rows selected when decoding with a selection vector");
+DEFINE_int32(encoding_num_seeks, 100000,
+             "Number of random seeks to measure the seek latency with");
+
+namespace kudu {
+namespace cfile {
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace {
+
+// The values of a column, in their in-memory cell format.
+struct Column {
+  explicit Column(const TypeInfo* type) : type(type), arena(1024, 64 * 1024 * 1024) {}
+
+  // Appends a cell, which for BINARY points to a copy of 'str'.
+  void AppendInt(int64_t v);
+  void AppendDouble(double v);
+  void AppendString(const Slice& str);
+
+  size_t num_values() const { return cells.size() / type->size(); }
+
+  const TypeInfo* type;
+  faststring cells;
+  // The size of the values, counting the data of BINARY values.
+  size_t raw_bytes = 0;
+  Arena arena;
+};
+
+void Column::AppendInt(int64_t v) {
+  switch (type->physical_type()) {
+    case BOOL: {
+      bool b = v % 2;
+      cells.append(&b, sizeof(b));
+      break;
+    }
+    case INT8: case UINT8: {
+      int8_t i = v;
+      cells.append(&i, sizeof(i));
+      break;
+    }
+    case INT16: case UINT16: {
+      int16_t i = v;
+      cells.append(&i, sizeof(i));
+      break;
+    }
+    case INT32: case UINT32: {
+      int32_t i = v;
+      cells.append(&i, sizeof(i));
+      break;
+    }
+    case INT64: case UINT64: {
+      cells.append(&v, sizeof(v));
+      break;
+    }
+    case FLOAT: case DOUBLE:
+      AppendDouble(v * 0.25);
+      return;
+    case BINARY:
+      AppendString(StringPrintf("value-%012" PRId64, v));
+      return;
+    default:
+      LOG(FATAL) << "unsupported type " << type->name();
+  }
+  raw_bytes += type->size();
+}
+
+void Column::AppendDouble(double v) {
+  if (type->physical_type() == FLOAT) {
+    float f = v;
+    cells.append(&f, sizeof(f));
+  } else {
+    CHECK_EQ(DOUBLE, type->physical_type());
+    cells.append(&v, sizeof(v));
+  }
+  raw_bytes += type->size();
+}
+
+void Column::AppendString(const Slice& str) {
+  CHECK_EQ(BINARY, type->physical_type());
+  Slice copy;
+  CHECK(arena.RelocateSlice(str, &copy));
+  cells.append(&copy, sizeof(copy));
+  raw_bytes += str.size();
+}
+
+// Fills 'col' with 'n' synthetic values, taking 'cardinality' distinct values
+// in the given order.
+void GenerateColumn(int n, int64_t cardinality, const string& order, Column* col) {
+  Random rand(0);
+  for (int i = 0; i < n; i++) {
+    int64_t v;
+    if (order == "sorted") {
+      v = static_cast<int64_t>(i) * cardinality / n;
+    } else {
+      CHECK_EQ("random", order);
+      v = rand.Uniform64(cardinality);
+    }
+    col->AppendInt(v);
+  }
+}
+
+Status ReadColumn(const string& path, Column* col) {
+  faststring data;
+  RETURN_NOT_OK(ReadFileToString(Env::Default(), path, &data));
+  vector<string> lines = strings::Split(data.ToString(), "\n", strings::SkipEmpty());
+  for (const string& line : lines) {
+    switch (col->type->physical_type()) {
+      case BINARY:
+        col->AppendString(line);
+        break;
+      case FLOAT: case DOUBLE: {
+        double d;
+        if (!safe_strtod(line, &d)) {
+          return Status::Corruption("invalid floating point value", line);
+        }
+        col->AppendDouble(d);
+        break;
+      }
+      case BOOL:
+        col->AppendInt(line == "true" || line == "1");
+        break;
+      default: {
+        int64_t i;
+        if (!safe_strto64(line, &i)) {
+          return Status::Corruption("invalid integer value", line);
+        }
+        col->AppendInt(i);
+        break;
+      }
+    }
+  }
+  return Status::OK();
+}
+
+struct EncodedBlock {
+  string data;
+  size_t num_values;
+};
+
+// Encodes all the values of 'col' into 'blocks'. Returns the elapsed time.
+double BuildBlocks(const TypeEncodingInfo* info, const Column& col,
+                   vector<EncodedBlock>* blocks) {
+  WriterOptions opts;
+  BlockBuilder* bb_ptr;
+  CHECK_OK(info->CreateBlockBuilder(&bb_ptr, &opts));
+  unique_ptr<BlockBuilder> bb(bb_ptr);
+
+  blocks->clear();
+  const size_t size = col.type->size();
+  const size_t n = col.num_values();
+  Stopwatch sw;
+  sw.start();
+  rowid_t ordinal = 0;
+  size_t i = 0;
+  while (i < n) {
+    int added = bb->Add(col.cells.data() + i * size, n - i);
+    CHECK(added > 0 || bb->IsBlockFull());
+    i += added;
+    if (bb->IsBlockFull() || i == n) {
+      Slice s = bb->Finish(ordinal);
+      blocks->push_back({ s.ToString(), bb->Count() });
+      ordinal += bb->Count();
+      bb->Reset();
+    }
+  }
+  sw.stop();
+  return sw.elapsed().wall_seconds();
+}
+
+unique_ptr<BlockDecoder> NewDecoder(const TypeEncodingInfo* info, const EncodedBlock& block) {
+  BlockDecoder* bd;
+  CHECK_OK(info->CreateBlockDecoder(&bd, block.data, nullptr));
+  unique_ptr<BlockDecoder> decoder(bd);
+  CHECK_OK(decoder->ParseHeader());
+  return decoder;
+}
+
+// Decodes all the blocks, with a selection vector if 'sel' isn't null.
+// Returns the elapsed time.
+double DecodeBlocks(const TypeEncodingInfo* info, const TypeInfo* type,
+                    const vector<EncodedBlock>& blocks, SelectionVector* sel) {
+  const size_t batch_size = FLAGS_encoding_batch_size;
+  faststring cells;
+  cells.resize(batch_size * type->size());
+  Arena arena(32 * 1024, 64 * 1024 * 1024);
+  ColumnBlock cb(type, nullptr, cells.data(), batch_size, &arena);
+
+  Stopwatch sw;
+  sw.start();
+  for (const EncodedBlock& block : blocks) {
+    unique_ptr<BlockDecoder> decoder = NewDecoder(info, block);
+    size_t remaining = block.num_values;
+    while (remaining > 0) {
+      size_t n = std::min(remaining, batch_size);
+      ColumnDataView dst(&cb);
+      if (sel) {
+        SelectionVectorView sel_view(sel);
+        CHECK_OK(decoder->CopyNextSelectedValues(&n, sel_view, &dst));
+      } else {
+        CHECK_OK(decoder->CopyNextValues(&n, &dst));
+      }
+      CHECK_GT(n, 0);
+      remaining -= n;
+    }
+    arena.Reset();
+  }
+  sw.stop();
+  return sw.elapsed().wall_seconds();
+}
+
+// Seeks to random positions in the blocks and copies the value there.
+// Returns the elapsed time.
+double SeekBlocks(const TypeEncodingInfo* info, const TypeInfo* type,
+                  const vector<EncodedBlock>& blocks) {
+  vector<unique_ptr<BlockDecoder>> decoders;
+  for (const EncodedBlock& block : blocks) {
+    decoders.emplace_back(NewDecoder(info, block));
+  }
+  faststring cell;
+  cell.resize(type->size());
+  Arena arena(1024, 1024 * 1024);
+  ColumnBlock cb(type, nullptr, cell.data(), 1, &arena);
+
+  Random rand(0);
+  Stopwatch sw;
+  sw.start();
+  for (int i = 0; i < FLAGS_encoding_num_seeks; i++) {
+    int b = rand.Uniform(blocks.size());
+    decoders[b]->SeekToPositionInBlock(rand.Uniform(blocks[b].num_values));
+    ColumnDataView dst(&cb);
+    size_t n = 1;
+    CHECK_OK(decoders[b]->CopyNextValues(&n, &dst));
+    if (i % 1024 == 0) {
+      arena.Reset();
+    }
+  }
+  sw.stop();
+  return sw.elapsed().wall_seconds();
+}
+
+void BenchmarkEncoding(const TypeEncodingInfo* info, const Column& col,
+                       const string& dataset) {
+  const int iterations = std::max(1, FLAGS_encoding_iterations);
+  const size_t n = col.num_values();
+  vector<EncodedBlock> blocks;
+  double build_secs = 0;
+  for (int i = 0; i < iterations; i++) {
+    double secs = BuildBlocks(info, col, &blocks);
+    build_secs = i == 0 ? secs : std::min(build_secs, secs);
+  }
+  size_t encoded_bytes = 0;
+  for (const EncodedBlock& block : blocks) {
+    encoded_bytes += block.data.size();
+  }
+
+  SelectionVector sel(FLAGS_encoding_batch_size);
+  sel.SetAllFalse();
+  Random rand(0);
+  for (int i = 0; i < FLAGS_encoding_batch_size; i++) {
+    if (rand.NextDoubleFraction() < FLAGS_encoding_selectivity) {
+      BitmapSet(sel.mutable_bitmap(), i);
+    }
+  }
+
+  double decode_secs = 0;
+  double decode_selected_secs = 0;
+  double seek_secs = 0;
+  for (int i = 0; i < iterations; i++) {
+    double secs = DecodeBlocks(info, col.type, blocks, nullptr);
+    decode_secs = i == 0 ? secs : std::min(decode_secs, secs);
+    secs = DecodeBlocks(info, col.type, blocks, &sel);
+    decode_selected_secs = i == 0 ? secs : std::min(decode_selected_secs, secs);
+    secs = SeekBlocks(info, col.type, blocks);
+    seek_secs = i == 0 ? secs : std::min(seek_secs, secs);
+  }
+
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::COMPACT);
+  jw.StartObject();
+  jw.String("type");
+  jw.String(col.type->name());
+  jw.String("encoding");
+  jw.String(EncodingType_Name(info->encoding_type()));
+  jw.String("dataset");
+  jw.String(dataset);
+  jw.String("num_values");
+  jw.Uint64(n);
+  jw.String("num_blocks");
+  jw.Uint64(blocks.size());
+  jw.String("raw_bytes");
+  jw.Uint64(col.raw_bytes);
+  jw.String("encoded_bytes");
+  jw.Uint64(encoded_bytes);
+  jw.String("compression_ratio");
+  jw.Double(static_cast<double>(col.raw_bytes) / encoded_bytes);
+  jw.String("build_mvals_per_sec");
+  jw.Double(n / build_secs / 1e6);
+  jw.String("decode_mvals_per_sec");
+  jw.Double(n / decode_secs / 1e6);
+  jw.String("decode_selected_mvals_per_sec");
+  jw.Double(n / decode_selected_secs / 1e6);
+  jw.String("seek_ns");
+  jw.Double(seek_secs * 1e9 / FLAGS_encoding_num_seeks);
+  jw.EndObject();
+  std::cout << out.str() << std::endl;
+}
+
+void BenchmarkColumn(const Column& col, const string& dataset) {
+  for (EncodingType encoding : TypeEncodingInfo::GetSupportedEncodings(col.type)) {
+    if (encoding == DICT_ENCODING) {
+      continue;
+    }
+    const TypeEncodingInfo* info;
+    CHECK_OK(TypeEncodingInfo::Get(col.type, encoding, &info));
+    LOG_TIMING(INFO, StringPrintf("benchmarking %s %s on %s", col.type->name().c_str(),
+                                  EncodingType_Name(encoding).c_str(), dataset.c_str())) {
+      BenchmarkEncoding(info, col, dataset);
+    }
+  }
+}
+
+const TypeInfo* ParseType(const string& name) {
+  DataType type;
+  CHECK(DataType_Parse(name, &type)) << "unknown type " << name;
+  return GetTypeInfo(type);
+}
+
+} // anonymous namespace
+
+void RunEncodingBenchmarks() {
+  if (!FLAGS_encoding_input_file.empty()) {
+    Column col(ParseType(FLAGS_encoding_input_type));
+    CHECK_OK(ReadColumn(FLAGS_encoding_input_file, &col));
+    CHECK_GT(col.num_values(), 0) << "no values in " << FLAGS_encoding_input_file;
+    BenchmarkColumn(col, FLAGS_encoding_input_file);
+    return;
+  }
+
+  vector<string> types = strings::Split(FLAGS_encoding_types, ",", strings::SkipEmpty());
+  vector<string> cardinalities = strings::Split(FLAGS_encoding_cardinalities, ",",
+                                                strings::SkipEmpty());
+  vector<string> orders = strings::Split(FLAGS_encoding_sort_orders, ",", strings::SkipEmpty());
+  for (const string& type_name : types) {
+    const TypeInfo* type = ParseType(type_name);
+    for (const string& card_str : cardinalities) {
+      int64_t cardinality;
+      CHECK(safe_strto64(card_str, &cardinality) && cardinality > 0)
+          << "invalid cardinality " << card_str;
+      for (const string& order : orders) {
+        Column col(type);
+        GenerateColumn(FLAGS_encoding_num_values, cardinality, order, &col);
+        BenchmarkColumn(col, StringPrintf("%s-%" PRId64, order.c_str(), cardinality));
+      }
+    }
+  }
+}
+
+} // namespace cfile
+} // namespace kudu
+
+int main(int argc, char **argv) {
+  FLAGS_logtostderr = 1;
+  google::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::cfile::RunEncodingBenchmarks();
+  return 0;
+}
@@ -16,23 +16,35 @@
 // under the License.
 //
 // Micro benchmark for writing/reading bit streams and Kudu specific
-// run-length encoding (RLE) APIs. Currently only covers booleans and
-// the most performance sensitive APIs. NB: Impala contains a RLE
-// micro benchmark (rle-benchmark.cc).
+// run-length encoding (RLE) APIs. Covers booleans, the most performance
+// sensitive APIs, and decode throughput of bit-packed literal runs for
+// every bit width. NB: Impala contains a RLE micro benchmark
+// (rle-benchmark.cc).
 //
 
+#include <vector>
+
 #include <glog/logging.h>
 #include <gflags/gflags.h>
 
 #include "kudu/gutil/basictypes.h"
 #include "kudu/gutil/mathlimits.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/util/bit-packing.h"
 #include "kudu/util/bit-stream-utils.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/random.h"
 #include "kudu/util/rle-encoding.h"
 #include "kudu/util/stopwatch.h"
 
 DEFINE_int32(bitstream_num_bytes, 1 * 1024 * 1024,
              "Number of bytes worth of bits to write and read from the bitstream");
+DEFINE_int32(rle_decode_num_values, 4 * 1024 * 1024,
+             "Number of values to encode and decode for each bit width in the "
+             "per-width RLE decode benchmark");
+DEFINE_int32(rle_decode_batch_size, 1024,
+             "Number of values decoded per RleDecoder::GetValues() call, i.e. "
+             "the analogue of a scan batch");
 
 namespace kudu {
 
@@ -96,6 +108,58 @@ void BooleanRLE() {
   }
 }
 
+// Measure decoding of random (hence mostly bit-packed literal) RLE data for
+// every bit width, both a value at a time and in scan-sized batches.
+void DecodeThroughputByBitWidth() {
+  const int num_values = FLAGS_rle_decode_num_values;
+  std::vector<uint32_t> decoded(FLAGS_rle_decode_batch_size);
+  Random rng(0);
+
+  LOG(INFO) << "Bit-packing kernels: " << bitpacking::SelectedKernelName();
+  for (int width = 1; width <= 32; width++) {
+    const uint32_t mask = width == 32 ? MathLimits<uint32_t>::kMax : (1U << width) - 1;
+    // Pre-size the buffer: BitWriter grows it only 8 bytes at a time.
+    faststring buffer(num_values * sizeof(uint32_t) + 1024);
+    RleEncoder<uint32_t> encoder(&buffer, width);
+    for (int i = 0; i < num_values; i++) {
+      encoder.Put(rng.Next32() & mask);
+    }
+    encoder.Flush();
+
+    uint64_t checksum_single = 0;
+    Stopwatch single;
+    single.start();
+    RleDecoder<uint32_t> single_decoder(buffer.data(), encoder.len(), width);
+    for (int i = 0; i < num_values; i++) {
+      uint32_t val;
+      CHECK(single_decoder.Get(&val));
+      checksum_single += val;
+    }
+    single.stop();
+
+    uint64_t checksum_batch = 0;
+    Stopwatch batch;
+    batch.start();
+    RleDecoder<uint32_t> batch_decoder(buffer.data(), encoder.len(), width);
+    for (int remaining = num_values; remaining > 0;) {
+      size_t n = std::min(remaining, FLAGS_rle_decode_batch_size);
+      CHECK_EQ(n, batch_decoder.GetValues(decoded.data(), n));
+      for (size_t i = 0; i < n; i++) {
+        checksum_batch += decoded[i];
+      }
+      remaining -= n;
+    }
+    batch.stop();
+    CHECK_EQ(checksum_single, checksum_batch);
+
+    double single_mvals = num_values / single.elapsed().wall_seconds() / 1e6;
+    double batch_mvals = num_values / batch.elapsed().wall_seconds() / 1e6;
+    LOG(INFO) << StringPrintf("bit width %2d: Get() %8.1f Mvals/s, GetValues() %8.1f Mvals/s "
+                              "(%.2fx)", width, single_mvals, batch_mvals,
+                              batch_mvals / single_mvals);
+  }
+}
+
 } // namespace kudu
 
 int main(int argc, char **argv) {
@@ -111,5 +175,9 @@ int main(int argc, char **argv) {
     kudu::BooleanRLE();
   }
 
+  LOG_TIMING(INFO, "DecodeThroughputByBitWidth") {
+    kudu::DecodeThroughputByBitWidth();
+  }
+
   return 0;
 }
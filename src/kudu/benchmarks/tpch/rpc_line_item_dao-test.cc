@@ -94,6 +94,25 @@ class RpcLineItemDAOTest : public KuduTest {
     CHECK_OK(row->SetInt32(tpch::kQuantityColIdx, quantity));
   }
 
+  static void UpdateTestRowShipping(int key, int line_number, const char* ship_date,
+                                    double discount, int quantity, KuduPartialRow* row) {
+    CHECK_OK(row->SetInt64(tpch::kOrderKeyColIdx, key));
+    CHECK_OK(row->SetInt32(tpch::kLineNumberColIdx, line_number));
+    CHECK_OK(row->SetStringCopy(tpch::kShipDateColIdx, Slice(ship_date)));
+    CHECK_OK(row->SetDouble(tpch::kDiscountColIdx, discount));
+    CHECK_OK(row->SetInt32(tpch::kQuantityColIdx, quantity));
+  }
+
+  static int CountScannerRows(RpcLineItemDAO::Scanner* scanner) {
+    vector<KuduRowResult> rows;
+    int count = 0;
+    while (scanner->HasMore()) {
+      scanner->GetNext(&rows);
+      count += rows.size();
+    }
+    return count;
+  }
+
   int CountRows() {
     gscoped_ptr<RpcLineItemDAO::Scanner> scanner;
     dao_->OpenScanner(vector<string>(), &scanner);
@@ -162,4 +181,35 @@ TEST_F(RpcLineItemDAOTest, TestUpdate) {
   }
 }
 
+TEST_F(RpcLineItemDAOTest, TestQueryScanners) {
+  for (int i = 1; i < 5; i++) {
+    for (int y = 0; y < 3; y++) {
+      dao_->WriteLine(boost::bind(BuildTestRow, i, y, _1));
+    }
+  }
+  dao_->FinishWriting();
+
+  // None of the test rows match tpch6 or tpch14.
+  gscoped_ptr<RpcLineItemDAO::Scanner> scanner;
+  dao_->OpenTpch6Scanner(&scanner);
+  ASSERT_EQ(0, CountScannerRows(scanner.get()));
+  dao_->OpenTpch14Scanner(&scanner);
+  ASSERT_EQ(0, CountScannerRows(scanner.get()));
+
+  // Make one row match each of them, and one almost match tpch6.
+  dao_->MutateLine(boost::bind(UpdateTestRowShipping, 2, 1, "1994-06-01", 0.06, 10, _1));
+  dao_->MutateLine(boost::bind(UpdateTestRowShipping, 3, 1, "1995-09-15", 0.1, 30, _1));
+  dao_->MutateLine(boost::bind(UpdateTestRowShipping, 4, 1, "1994-06-01", 0.06, 24, _1));
+  dao_->FinishWriting();
+  dao_->OpenTpch6Scanner(&scanner);
+  ASSERT_EQ(1, CountScannerRows(scanner.get()));
+  dao_->OpenTpch14Scanner(&scanner);
+  ASSERT_EQ(1, CountScannerRows(scanner.get()));
+
+  dao_->OpenOrderScanner(3, { tpch::kLineNumberColName }, &scanner);
+  ASSERT_EQ(3, CountScannerRows(scanner.get()));
+  dao_->OpenOrderScanner(5, { tpch::kLineNumberColName }, &scanner);
+  ASSERT_EQ(0, CountScannerRows(scanner.get()));
+}
+
 } // namespace kudu
@@ -97,6 +97,10 @@ class FlushCallback : public KuduStatusCallback {
 } // anonymous namespace
 
 const Slice RpcLineItemDAO::kScanUpperBound = Slice("1998-09-02");
+const Slice RpcLineItemDAO::kTpch6ShipDateLowerBound = Slice("1994-01-01");
+const Slice RpcLineItemDAO::kTpch6ShipDateUpperBound = Slice("1995-01-01");
+const Slice RpcLineItemDAO::kTpch14ShipDateLowerBound = Slice("1995-09-01");
+const Slice RpcLineItemDAO::kTpch14ShipDateUpperBound = Slice("1995-10-01");
 
 RpcLineItemDAO::~RpcLineItemDAO() {
   FinishWriting();
@@ -193,6 +197,46 @@ void RpcLineItemDAO::OpenTpch1ScannerForOrderKeyRange(int64_t min_key, int64_t m
   OpenScannerImpl(tpch::GetTpchQ1QueryColumns(), preds, out_scanner);
 }
 
+void RpcLineItemDAO::OpenTpch6Scanner(gscoped_ptr<Scanner>* out_scanner) {
+  vector<KuduPredicate*> preds;
+  preds.push_back(client_table_->NewComparisonPredicate(
+                      tpch::kShipDateColName, KuduPredicate::GREATER_EQUAL,
+                      KuduValue::CopyString(kTpch6ShipDateLowerBound)));
+  preds.push_back(client_table_->NewComparisonPredicate(
+                      tpch::kShipDateColName, KuduPredicate::LESS,
+                      KuduValue::CopyString(kTpch6ShipDateUpperBound)));
+  preds.push_back(client_table_->NewComparisonPredicate(
+                      tpch::kDiscountColName, KuduPredicate::GREATER_EQUAL,
+                      KuduValue::FromDouble(0.05)));
+  preds.push_back(client_table_->NewComparisonPredicate(
+                      tpch::kDiscountColName, KuduPredicate::LESS_EQUAL,
+                      KuduValue::FromDouble(0.07)));
+  preds.push_back(client_table_->NewComparisonPredicate(
+                      tpch::kQuantityColName, KuduPredicate::LESS,
+                      KuduValue::FromInt(24)));
+  OpenScannerImpl(tpch::GetTpchQ6QueryColumns(), preds, out_scanner);
+}
+
+void RpcLineItemDAO::OpenTpch14Scanner(gscoped_ptr<Scanner>* out_scanner) {
+  vector<KuduPredicate*> preds;
+  preds.push_back(client_table_->NewComparisonPredicate(
+                      tpch::kShipDateColName, KuduPredicate::GREATER_EQUAL,
+                      KuduValue::CopyString(kTpch14ShipDateLowerBound)));
+  preds.push_back(client_table_->NewComparisonPredicate(
+                      tpch::kShipDateColName, KuduPredicate::LESS,
+                      KuduValue::CopyString(kTpch14ShipDateUpperBound)));
+  OpenScannerImpl(tpch::GetTpchQ14QueryColumns(), preds, out_scanner);
+}
+
+void RpcLineItemDAO::OpenOrderScanner(int64_t orderkey, const vector<string>& columns,
+                                      gscoped_ptr<Scanner>* out_scanner) {
+  vector<KuduPredicate*> preds;
+  preds.push_back(client_table_->NewComparisonPredicate(
+                      tpch::kOrderKeyColName, KuduPredicate::EQUAL,
+                      KuduValue::FromInt(orderkey)));
+  OpenScannerImpl(columns, preds, out_scanner);
+}
+
 bool RpcLineItemDAO::IsTableEmpty() {
   KuduScanner scanner(client_table_.get());
   CHECK_OK(scanner.Open());
@@ -58,6 +58,19 @@ class RpcLineItemDAO {
   // select rows in the given order key range.
   void OpenTpch1ScannerForOrderKeyRange(int64_t min_orderkey, int64_t max_orderkey,
                                         gscoped_ptr<Scanner>* scanner);
+
+  // Calls OpenScanner with the tpch6 query parameters.
+  void OpenTpch6Scanner(gscoped_ptr<Scanner>* scanner);
+
+  // Calls OpenScanner with the parameters of the lineitem side of the tpch14
+  // query.
+  void OpenTpch14Scanner(gscoped_ptr<Scanner>* scanner);
+
+  // Opens a scanner for the line items of the order with the given key.
+  // Projects only those column names listed in 'columns'.
+  void OpenOrderScanner(int64_t orderkey, const std::vector<std::string>& columns,
+                        gscoped_ptr<Scanner>* scanner);
+
   bool IsTableEmpty();
 
   // TODO: this wrapper class is of limited utility now that we only have a single
@@ -81,6 +94,10 @@ class RpcLineItemDAO {
 
  private:
   static const Slice kScanUpperBound;
+  static const Slice kTpch6ShipDateLowerBound;
+  static const Slice kTpch6ShipDateUpperBound;
+  static const Slice kTpch14ShipDateLowerBound;
+  static const Slice kTpch14ShipDateUpperBound;
 
   void OpenScannerImpl(const std::vector<std::string>& columns,
                        const std::vector<client::KuduPredicate*>& preds,
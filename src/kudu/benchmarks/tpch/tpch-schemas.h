@@ -114,6 +114,17 @@ inline std::vector<std::string> GetTpchQ1QueryColumns() {
            kTaxColName };
 }
 
+inline std::vector<std::string> GetTpchQ6QueryColumns() {
+  return { kExtendedPriceColName,
+           kDiscountColName };
+}
+
+inline std::vector<std::string> GetTpchQ14QueryColumns() {
+  return { kPartKeyColName,
+           kExtendedPriceColName,
+           kDiscountColName };
+}
+
 } // namespace tpch
 } // namespace kudu
 #endif
@@ -16,8 +16,17 @@
 // under the License.
 //
 // This utility will first try to load the data from the given path if the
-// tablet doesn't already exist at the given location. It will then run
-// the tpch1 query, as described below, up to tpch_num_query_iterations times.
+// tablet doesn't already exist at the given location, timing the load. It will
+// then run the queries listed in tpch_queries, up to tpch_num_query_iterations
+// times:
+//  - "1": the tpch1 query, as described below.
+//  - "6": the tpch6 query, as described below.
+//  - "14": the lineitem side of the tpch14 query, as described below.
+//  - "lookups": tpch_num_lookups lookups of the line items of random orders.
+//
+// Several comma-separated paths may be given, e.g. the data generated at
+// several scale factors, in which case each is loaded into its own table and
+// queried in turn.
 //
 // The input data must be in the tpch format, separated by "|".
 //
@@ -56,8 +65,33 @@
 // 'N','O',74476040,111701729697.74,106118230307.6,110367043872.5,25.5,38249.1,0,2920374
 // 'R','F',37719753,56568041380.90,53741292684.6,55889619119.8,25.5,38250.9,0.1,1478870
 // ====
+// ---- QUERY : TPCH-Q6
+// # Q6 - Forecasting Revenue Change Query
+// select
+//   sum(l_extendedprice * l_discount) as revenue
+// from
+//   lineitem
+// where
+//   l_shipdate >= '1994-01-01'
+//   and l_shipdate < '1995-01-01'
+//   and l_discount between 0.05 and 0.07
+//   and l_quantity < 24
+// ====
+// ---- QUERY : TPCH-Q14
+// # Q14 - Promotion Effect
+// # Modifications: only the lineitem table is loaded, so the join with the
+// # part table and the promotion revenue are left out.
+// select
+//   sum(l_extendedprice * (1 - l_discount)) as revenue
+// from
+//   lineitem
+// where
+//   l_shipdate >= '1995-09-01'
+//   and l_shipdate < '1995-10-01'
+// ====
 #include <boost/bind.hpp>
 #include <unordered_map>
+#include <unordered_set>
 #include <stdlib.h>
 
 #include <glog/logging.h>
@@ -69,19 +103,33 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/integration-tests/mini_cluster.h"
 #include "kudu/master/mini_master.h"
 #include "kudu/util/env.h"
 #include "kudu/util/flags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/stopwatch.h"
 
 DEFINE_string(tpch_path_to_data, "/tmp/lineitem.tbl",
-              "The full path to the '|' separated file containing the lineitem table.");
-DEFINE_int32(tpch_num_query_iterations, 1, "Number of times the query will be run.");
-DEFINE_int32(tpch_expected_matching_rows, 5916591, "Number of rows that should match the query.");
-DEFINE_bool(tpch_check_matching_rows, true, "Whether to check the number of matching rows.");
+              "The full path to the '|' separated file containing the lineitem table. "
+              "Several comma-separated paths load each file into its own table.");
+DEFINE_string(tpch_queries, "1,6,14,lookups",
+              "Comma-separated list of the queries to run: any of 1, 6, 14 and lookups.");
+DEFINE_int32(tpch_num_query_iterations, 1, "Number of times the queries will be run.");
+DEFINE_int32(tpch_expected_matching_rows, 5916591,
+             "Number of rows that should match the tpch1 query.");
+DEFINE_bool(tpch_check_matching_rows, true,
+            "Whether to check the number of rows matching the tpch1 query. Only "
+            "checked if a single data file is loaded.");
+DEFINE_int32(tpch_num_lookups, 1000, "Number of orders looked up by the lookups query.");
+DEFINE_int64(tpch_max_lookup_orderkey, 6000000,
+             "The orders looked up by the lookups query are picked uniformly at random "
+             "between 1 and this key. The default is the largest key at scale factor 1.");
 DEFINE_bool(use_mini_cluster, true,
             "Create a mini cluster for the work to be performed against.");
 DEFINE_string(mini_cluster_base_dir, "/tmp/tpch",
@@ -93,7 +141,8 @@ DEFINE_int32(tpch_max_batch_size, 1000,
              "to delegate the batching control to the logic of the "
              "KuduSession running in AUTO_BACKGROUND_MODE flush mode.");
 DEFINE_string(table_name, "lineitem",
-              "The table name to write/read");
+              "The table name to write/read. If several data files are loaded, the "
+              "table name of the nth file is suffixed with _n.");
 
 namespace kudu {
 
@@ -102,6 +151,7 @@ using client::KuduRowResult;
 using client::KuduSchema;
 
 using std::unordered_map;
+using std::unordered_set;
 
 struct Result {
   int32_t l_quantity;
@@ -136,14 +186,17 @@ struct hash {
   }
 };
 
-void LoadLineItems(const string &path, RpcLineItemDAO *dao) {
+int64_t LoadLineItems(const string &path, RpcLineItemDAO *dao) {
   LineItemTsvImporter importer(path);
 
+  int64_t num_rows = 0;
   while (importer.HasNextLine()) {
     dao->WriteLine(boost::bind(&LineItemTsvImporter::GetNextLine,
                                &importer, _1));
+    num_rows++;
   }
   dao->FinishWriting();
+  return num_rows;
 }
 
 void WarmupScanCache(RpcLineItemDAO* dao) {
@@ -153,7 +206,7 @@ void WarmupScanCache(RpcLineItemDAO* dao) {
   codegen::CompilationManager::GetSingleton()->Wait();
 }
 
-void Tpch1(RpcLineItemDAO *dao) {
+void Tpch1(RpcLineItemDAO *dao, bool check_matching_rows) {
   typedef unordered_map<SliceMapKey, Result*, hash> slice_map;
   typedef unordered_map<SliceMapKey, slice_map*, hash> slice_map_map;
 
@@ -234,11 +287,82 @@ void Tpch1(RpcLineItemDAO *dao) {
     delete maps;
     delete returnflag.slice.data();
   }
-  if (FLAGS_tpch_check_matching_rows) {
+  if (check_matching_rows) {
     CHECK_EQ(matching_rows, FLAGS_tpch_expected_matching_rows) << "Wrong number of rows returned";
   }
 }
 
+void Tpch6(RpcLineItemDAO *dao) {
+  gscoped_ptr<RpcLineItemDAO::Scanner> scanner;
+  dao->OpenTpch6Scanner(&scanner);
+
+  int matching_rows = 0;
+  double revenue = 0;
+  vector<KuduRowResult> rows;
+  while (scanner->HasMore()) {
+    scanner->GetNext(&rows);
+    for (const KuduRowResult& row : rows) {
+      matching_rows++;
+      double l_extendedprice;
+      CHECK_OK(row.GetDouble(0, &l_extendedprice));
+      double l_discount;
+      CHECK_OK(row.GetDouble(1, &l_discount));
+      revenue += l_extendedprice * l_discount;
+    }
+  }
+  LOG(INFO) << "Result: " << StringPrintf("%.2f", revenue)
+            << " (" << matching_rows << " matching rows)";
+}
+
+void Tpch14(RpcLineItemDAO *dao) {
+  gscoped_ptr<RpcLineItemDAO::Scanner> scanner;
+  dao->OpenTpch14Scanner(&scanner);
+
+  int matching_rows = 0;
+  double revenue = 0;
+  unordered_set<int32_t> parts;
+  vector<KuduRowResult> rows;
+  while (scanner->HasMore()) {
+    scanner->GetNext(&rows);
+    for (const KuduRowResult& row : rows) {
+      matching_rows++;
+      int32_t l_partkey;
+      CHECK_OK(row.GetInt32(0, &l_partkey));
+      double l_extendedprice;
+      CHECK_OK(row.GetDouble(1, &l_extendedprice));
+      double l_discount;
+      CHECK_OK(row.GetDouble(2, &l_discount));
+      parts.insert(l_partkey);
+      revenue += l_extendedprice * (1 - l_discount);
+    }
+  }
+  LOG(INFO) << "Result: " << StringPrintf("%.2f", revenue) << " over " << parts.size()
+            << " parts (" << matching_rows << " matching rows)";
+}
+
+void OrderLookups(RpcLineItemDAO *dao) {
+  Random rand(GetRandomSeed32());
+  int found_orders = 0;
+  int matching_rows = 0;
+  vector<KuduRowResult> rows;
+  for (int i = 0; i < FLAGS_tpch_num_lookups; i++) {
+    int64_t orderkey = 1 + rand.Uniform64(FLAGS_tpch_max_lookup_orderkey);
+    gscoped_ptr<RpcLineItemDAO::Scanner> scanner;
+    dao->OpenOrderScanner(orderkey, tpch::GetTpchQ1QueryColumns(), &scanner);
+    int order_rows = 0;
+    while (scanner->HasMore()) {
+      scanner->GetNext(&rows);
+      order_rows += rows.size();
+    }
+    if (order_rows > 0) {
+      found_orders++;
+      matching_rows += order_rows;
+    }
+  }
+  LOG(INFO) << "Result: found " << found_orders << " of " << FLAGS_tpch_num_lookups
+            << " orders (" << matching_rows << " matching rows)";
+}
+
 } // namespace kudu
 
 int main(int argc, char **argv) {
@@ -261,23 +385,47 @@ int main(int argc, char **argv) {
     master_address = FLAGS_master_address;
   }
 
-  gscoped_ptr<kudu::RpcLineItemDAO> dao(new kudu::RpcLineItemDAO(master_address, FLAGS_table_name,
-                                                                 FLAGS_tpch_max_batch_size));
-  dao->Init();
+  vector<string> paths = strings::Split(FLAGS_tpch_path_to_data, ",", strings::SkipEmpty());
+  vector<string> queries = strings::Split(FLAGS_tpch_queries, ",", strings::SkipEmpty());
+  for (const string& query : queries) {
+    CHECK(query == "1" || query == "6" || query == "14" || query == "lookups")
+        << "Unknown query: " << query;
+  }
+
+  for (size_t p = 0; p < paths.size(); p++) {
+    string table_name = paths.size() == 1
+        ? FLAGS_table_name : strings::Substitute("$0_$1", FLAGS_table_name, p);
+    gscoped_ptr<kudu::RpcLineItemDAO> dao(new kudu::RpcLineItemDAO(master_address, table_name,
+                                                                   FLAGS_tpch_max_batch_size));
+    dao->Init();
 
-  kudu::WarmupScanCache(dao.get());
+    kudu::WarmupScanCache(dao.get());
 
-  bool needs_loading = dao->IsTableEmpty();
-  if (needs_loading) {
-    LOG_TIMING(INFO, "loading") {
-      kudu::LoadLineItems(FLAGS_tpch_path_to_data, dao.get());
+    bool needs_loading = dao->IsTableEmpty();
+    if (needs_loading) {
+      int64_t num_rows = 0;
+      LOG_TIMING(INFO, strings::Substitute("loading $0 into $1", paths[p], table_name)) {
+        num_rows = kudu::LoadLineItems(paths[p], dao.get());
+      }
+      LOG(INFO) << "Loaded " << num_rows << " rows into " << table_name;
+    } else {
+      LOG(INFO) << "Data already in place in " << table_name;
     }
-  } else {
-    LOG(INFO) << "Data already in place";
-  }
-  for (int i = 0; i < FLAGS_tpch_num_query_iterations; i++) {
-    LOG_TIMING(INFO, StringPrintf("querying for iteration # %d", i)) {
-      kudu::Tpch1(dao.get());
+    for (int i = 0; i < FLAGS_tpch_num_query_iterations; i++) {
+      for (const string& query : queries) {
+        LOG_TIMING(INFO, strings::Substitute("querying $0 on $1 for iteration # $2",
+                                          query, table_name, i)) {
+          if (query == "1") {
+            kudu::Tpch1(dao.get(), FLAGS_tpch_check_matching_rows && paths.size() == 1);
+          } else if (query == "6") {
+            kudu::Tpch6(dao.get());
+          } else if (query == "14") {
+            kudu::Tpch14(dao.get());
+          } else {
+            kudu::OrderLookups(dao.get());
+          }
+        }
+      }
     }
   }
 
@@ -0,0 +1,358 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Benchmarking tool to qualify a device for use as a WAL disk.
+//
+// Unlike wal_hiccup, which measures the fsync latency of a single writer,
+// this tool runs the real Log of 'wal_bench_num_tablets' tablets on the
+// device, each one appending replicate batches from its own thread, so that
+// the measured latencies include group commit, segment preallocation and
+// segment roll, as on a tablet server.
+//
+// Each tablet appends 'wal_bench_batches_per_sec' batches per second, or as
+// fast as it can if 0, with up to 'wal_bench_max_outstanding_batches' of them
+// waiting to be durable. A batch holds 'wal_bench_entries_per_batch' entries
+// of 'wal_bench_entry_size_bytes' bytes each. The segments are regularly
+// garbage collected so that the benchmark can run for a long time.
+//
+// The segment size, preallocation and group commit are configured by the
+// usual Log flags, e.g. --log_segment_size_mb, --log_preallocate_segments,
+// --log_async_preallocate_segments, --log_group_commit_across_tablets and
+// --log_group_commit_max_delay_us.
+//
+// At the end, a JSON object is written to stdout with the append throughput,
+// the append latency percentiles (from submitting a batch to it being
+// durable), and the Log's own histograms of the sync latency, the number of
+// batches and bytes per sync, and the segment roll latency.
+//
+// The benchmark writes to a new 'kudu-wal-bench' directory under
+// 'wal_bench_dir', which is deleted at the end.
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/common/schema.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/log.h"
+#include "kudu/consensus/log_util.h"
+#include "kudu/consensus/ref_counted_replicate.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/histogram.pb.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/semaphore.h"
+#include "kudu/util/thread.h"
+
+DEFINE_string(wal_bench_dir, ".",
+              "Directory on the device to qualify, where the WALs are written");
+DEFINE_int32(wal_bench_num_tablets, 8, "Number of tablets appending to their WAL");
+DEFINE_int32(wal_bench_batches_per_sec, 0,
+             "Number of batches each tablet appends per second. 0 appends as fast as "
+             "possible");
+DEFINE_int32(wal_bench_max_outstanding_batches, 16,
+             "Maximum number of batches of each tablet waiting to be durable");
+DEFINE_int32(wal_bench_entries_per_batch, 1, "Number of entries in each batch");
+DEFINE_int32(wal_bench_entry_size_bytes, 1024, "Size of the payload of each entry");
+DEFINE_int32(wal_bench_runtime_sec, 60, "How long to run the benchmark for");
+DEFINE_bool(wal_bench_fsync, true,
+            "Whether the Log fsyncs every group commit, as with --log_force_fsync_all");
+
+METRIC_DECLARE_entity(tablet);
+METRIC_DECLARE_histogram(log_sync_latency);
+METRIC_DECLARE_histogram(log_group_commit_latency);
+METRIC_DECLARE_histogram(log_roll_latency);
+METRIC_DECLARE_histogram(log_entry_batches_per_group);
+METRIC_DECLARE_histogram(log_bytes_per_sync);
+
+namespace kudu {
+namespace log {
+
+using consensus::NO_OP;
+using consensus::ReplicateMsg;
+using consensus::ReplicateRefPtr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+// The largest append latency tracked, in microseconds.
+static const uint64_t kMaxLatencyMicros = 60LL * 1000 * 1000;
+
+class WalBenchmarker {
+ public:
+  WalBenchmarker()
+      : append_latency_micros_(kMaxLatencyMicros, 3),
+        num_batches_(0),
+        num_errors_(0),
+        stop_threads_(false) {
+  }
+
+  Status Init();
+
+  Status Run();
+
+ private:
+  struct Tablet {
+    explicit Tablet(string id)
+        : id(std::move(id)),
+          next_index(1),
+          outstanding(FLAGS_wal_bench_max_outstanding_batches) {
+    }
+
+    const string id;
+    scoped_refptr<Log> log;
+    int64_t next_index;
+    // Permits for the batches which may be waiting to be durable.
+    Semaphore outstanding;
+  };
+
+  void AppendThread(Tablet* tablet);
+
+  void AppendDone(Tablet* tablet, MicrosecondsInt64 start_micros, const Status& s);
+
+  void WriteResults(const MonoDelta& elapsed);
+
+  string root_;
+  gscoped_ptr<FsManager> fs_manager_;
+  MetricRegistry metric_registry_;
+  scoped_refptr<MetricEntity> metric_entity_;
+  vector<unique_ptr<Tablet>> tablets_;
+  string payload_;
+
+  HdrHistogram append_latency_micros_;
+  AtomicInt<int64_t> num_batches_;
+  AtomicInt<int64_t> num_errors_;
+  AtomicBool stop_threads_;
+};
+
+Status WalBenchmarker::Init() {
+  if (FLAGS_wal_bench_num_tablets <= 0 || FLAGS_wal_bench_max_outstanding_batches <= 0 ||
+      FLAGS_wal_bench_entries_per_batch <= 0) {
+    return Status::InvalidArgument("the numbers of tablets, outstanding batches and entries "
+                                   "per batch must be positive");
+  }
+
+  Env* env = Env::Default();
+  root_ = JoinPathSegments(FLAGS_wal_bench_dir, "kudu-wal-bench");
+  if (env->FileExists(root_)) {
+    return Status::AlreadyPresent("please remove the directory of a previous run", root_);
+  }
+  fs_manager_.reset(new FsManager(env, root_));
+  RETURN_NOT_OK(fs_manager_->CreateInitialFileSystemLayout());
+  RETURN_NOT_OK(fs_manager_->Open());
+  metric_entity_ = METRIC_ENTITY_tablet.Instantiate(&metric_registry_, "wal-bench");
+  payload_.assign(FLAGS_wal_bench_entry_size_bytes, 'x');
+
+  LogOptions options;
+  options.force_fsync_all = FLAGS_wal_bench_fsync;
+  Schema schema = SchemaBuilder(Schema({ ColumnSchema("key", INT32) }, 1)).Build();
+  for (int i = 0; i < FLAGS_wal_bench_num_tablets; i++) {
+    unique_ptr<Tablet> tablet(new Tablet(Substitute("wal-bench-tablet-$0", i)));
+    // All the logs share the metrics of the entity, which thus aggregate them.
+    RETURN_NOT_OK(Log::Open(options, fs_manager_.get(), tablet->id, schema, 0,
+                            metric_entity_, &tablet->log));
+    tablets_.emplace_back(std::move(tablet));
+  }
+  return Status::OK();
+}
+
+void WalBenchmarker::AppendDone(Tablet* tablet, MicrosecondsInt64 start_micros,
+                                const Status& s) {
+  if (PREDICT_FALSE(!s.ok())) {
+    num_errors_.Increment();
+    KLOG_EVERY_N_SECS(WARNING, 1) << "Failed to append to the log of " << tablet->id
+                                  << ": " << s.ToString();
+  } else {
+    int64_t micros = GetMonoTimeMicros() - start_micros;
+    micros = std::min<int64_t>(micros, kMaxLatencyMicros);
+    if (FLAGS_wal_bench_batches_per_sec > 0) {
+      // Account for the batches which couldn't be sent on time.
+      append_latency_micros_.IncrementWithExpectedInterval(
+          micros, 1000000 / FLAGS_wal_bench_batches_per_sec);
+    } else {
+      append_latency_micros_.Increment(micros);
+    }
+    num_batches_.Increment();
+  }
+  tablet->outstanding.Release();
+}
+
+void WalBenchmarker::AppendThread(Tablet* tablet) {
+  MonoDelta interval = FLAGS_wal_bench_batches_per_sec > 0
+      ? MonoDelta::FromNanoseconds(1000000000LL / FLAGS_wal_bench_batches_per_sec)
+      : MonoDelta::FromNanoseconds(0);
+  MonoTime next_append = MonoTime::Now();
+  MonoTime next_gc = MonoTime::Now() + MonoDelta::FromSeconds(1);
+  while (!stop_threads_.Load()) {
+    if (FLAGS_wal_bench_batches_per_sec > 0) {
+      MonoTime now = MonoTime::Now();
+      if (next_append > now) {
+        SleepFor(next_append - now);
+      }
+      next_append += interval;
+    }
+    tablet->outstanding.Acquire();
+
+    vector<ReplicateRefPtr> replicates;
+    for (int i = 0; i < FLAGS_wal_bench_entries_per_batch; i++) {
+      ReplicateRefPtr replicate = consensus::make_scoped_refptr_replicate(new ReplicateMsg());
+      ReplicateMsg* msg = replicate->get();
+      msg->mutable_id()->set_term(1);
+      msg->mutable_id()->set_index(tablet->next_index++);
+      msg->set_timestamp(0);
+      msg->set_op_type(NO_OP);
+      msg->mutable_noop_request()->set_payload_for_tests(payload_);
+      replicates.push_back(replicate);
+    }
+    Status s = tablet->log->AsyncAppendReplicates(
+        replicates, Bind(&WalBenchmarker::AppendDone, Unretained(this), tablet,
+                         GetMonoTimeMicros()));
+    if (!s.ok()) {
+      LOG(WARNING) << "Failed to append to the log of " << tablet->id << ": " << s.ToString();
+      num_errors_.Increment();
+      tablet->outstanding.Release();
+      break;
+    }
+
+    // Garbage collect the segments of the entries appended so far, as the
+    // tablet would once they're flushed.
+    if (MonoTime::Now() > next_gc) {
+      int num_gced;
+      RetentionIndexes retention(tablet->next_index - 1, tablet->next_index - 1);
+      WARN_NOT_OK(tablet->log->GC(retention, &num_gced), "Failed to GC the log");
+      next_gc = MonoTime::Now() + MonoDelta::FromSeconds(1);
+    }
+  }
+
+  // Wait for the outstanding batches to be durable.
+  for (int i = 0; i < FLAGS_wal_bench_max_outstanding_batches; i++) {
+    tablet->outstanding.Acquire();
+  }
+}
+
+Status WalBenchmarker::Run() {
+  LOG(INFO) << "Running with " << tablets_.size() << " tablets for "
+            << FLAGS_wal_bench_runtime_sec << " seconds";
+  MonoTime start = MonoTime::Now();
+  vector<scoped_refptr<Thread>> threads;
+  for (const auto& tablet : tablets_) {
+    scoped_refptr<Thread> thr;
+    RETURN_NOT_OK(Thread::Create("wal-bench", tablet->id, &WalBenchmarker::AppendThread,
+                                 this, tablet.get(), &thr));
+    threads.push_back(thr);
+  }
+  SleepFor(MonoDelta::FromSeconds(FLAGS_wal_bench_runtime_sec));
+  stop_threads_.Store(true);
+  for (const auto& thr : threads) {
+    RETURN_NOT_OK(ThreadJoiner(thr.get()).Join());
+  }
+  MonoDelta elapsed = MonoTime::Now() - start;
+
+  for (const auto& tablet : tablets_) {
+    RETURN_NOT_OK(tablet->log->Close());
+  }
+  WriteResults(elapsed);
+  return Env::Default()->DeleteRecursively(root_);
+}
+
+void WalBenchmarker::WriteResults(const MonoDelta& elapsed) {
+  int64_t num_batches = num_batches_.Load();
+  double mb = static_cast<double>(num_batches) * FLAGS_wal_bench_entries_per_batch *
+      FLAGS_wal_bench_entry_size_bytes / (1024 * 1024);
+
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::COMPACT);
+  jw.StartObject();
+  jw.String("num_tablets");
+  jw.Int(FLAGS_wal_bench_num_tablets);
+  jw.String("elapsed_sec");
+  jw.Double(elapsed.ToSeconds());
+  jw.String("batches");
+  jw.Int64(num_batches);
+  jw.String("errors");
+  jw.Int64(num_errors_.Load());
+  jw.String("batches_per_sec");
+  jw.Double(num_batches / elapsed.ToSeconds());
+  jw.String("payload_mb_per_sec");
+  jw.Double(mb / elapsed.ToSeconds());
+
+  const HdrHistogram& h = append_latency_micros_;
+  jw.String("append_latency_us");
+  jw.StartObject();
+  jw.String("mean");
+  jw.Double(h.MeanValue());
+  for (double percentile : { 50.0, 95.0, 99.0, 99.9, 99.99 }) {
+    jw.String(Substitute("p$0", percentile));
+    jw.Uint64(h.ValueAtPercentile(percentile));
+  }
+  jw.String("max");
+  jw.Uint64(h.MaxValue());
+  jw.EndObject();
+
+  // The Log's histograms, aggregated over all the tablets.
+  for (HistogramPrototype* proto : { &METRIC_log_sync_latency,
+                                           &METRIC_log_group_commit_latency,
+                                           &METRIC_log_entry_batches_per_group,
+                                           &METRIC_log_bytes_per_sync,
+                                           &METRIC_log_roll_latency }) {
+    HistogramSnapshotPB snapshot;
+    CHECK_OK(proto->Instantiate(metric_entity_)->GetHistogramSnapshotPB(
+        &snapshot, MetricJsonOptions()));
+    jw.String(proto->name());
+    jw.Protobuf(snapshot);
+  }
+  jw.EndObject();
+  std::cout << out.str() << std::endl;
+}
+
+} // namespace log
+} // namespace kudu
+
+int main(int argc, char* argv[]) {
+  kudu::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::log::WalBenchmarker benchmarker;
+  kudu::Status s = benchmarker.Init();
+  if (!s.ok()) {
+    std::cerr << "Couldn't initialize the benchmarking tool, reason: " << s.ToString() << std::endl;
+    return 1;
+  }
+  s = benchmarker.Run();
+  if (!s.ok()) {
+    std::cerr << "Couldn't run the benchmarking tool, reason: " << s.ToString() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,835 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Benchmarking tool that runs the YCSB core workloads against a cluster.
+//
+// By default it starts its own external cluster, loads 'ycsb_record_count'
+// records into the YCSB table and then runs the workload selected by
+// 'ycsb_workload':
+//  - A: 50% reads, 50% updates, zipfian keys.
+//  - B: 95% reads, 5% updates, zipfian keys.
+//  - C: 100% reads, zipfian keys.
+//  - D: 95% reads, 5% inserts, reads favor the latest inserted keys.
+//  - E: 95% short scans, 5% inserts, zipfian keys.
+//  - F: 50% reads, 50% read-modify-writes, zipfian keys.
+// The operation mix and the key distribution can be overridden by flags.
+//
+// Operations are issued by 'ycsb_threads_per_client' threads for each of the
+// 'ycsb_num_clients' clients, each thread with its own session, and each
+// operation waits for its response, as YCSB does.
+//
+// The results are written to stdout as JSON, one object per line:
+//  - Every 'ycsb_report_interval_sec', the number of operations of each type
+//    completed during the interval and the overall throughput.
+//  - At the end of each phase, for each type of operation, the number of
+//    operations and errors, the throughput, and HDR histogram latency
+//    percentiles in microseconds.
+//
+// Like YCSB, record keys are "user" followed by a hash of the record number,
+// so that inserts are spread over the key space. The hash is zero-padded so
+// that the table can be range partitioned evenly, and scans return records in
+// key order.
+
+#include <math.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <glog/logging.h>
+
+#include "kudu/benchmarks/ycsb-schema.h"
+#include "kudu/client/client.h"
+#include "kudu/common/partial_row.h"
+#include "kudu/gutil/integral_types.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/integration-tests/external_mini_cluster.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flags.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/jsonwriter.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/thread.h"
+
+DEFINE_bool(ycsb_use_mini_cluster, true,
+            "Create a mini cluster for the workload to run against");
+DEFINE_string(ycsb_master_addresses, "localhost",
+              "Comma-separated addresses of the masters of the cluster to run against "
+              "if not using a mini cluster");
+DEFINE_string(ycsb_mini_cluster_base_dir, "/tmp/ycsb",
+              "If using a mini cluster, directory for master/ts data");
+DEFINE_int32(ycsb_num_tablet_servers, 1,
+             "If using a mini cluster, the number of tablet servers to start");
+DEFINE_string(ycsb_table_name, "usertable",
+              "Table name to use during the benchmark");
+DEFINE_int32(ycsb_num_tablets, 8,
+             "Number of tablets of the table, if the benchmark creates it");
+DEFINE_int32(ycsb_num_replicas, 1,
+             "Number of replicas of each tablet, if the benchmark creates the table");
+DEFINE_bool(ycsb_load, true,
+            "Create the table and load 'ycsb_record_count' records before running the "
+            "workload. If false, the table must already exist and hold these records");
+
+DEFINE_string(ycsb_workload, "A",
+              "YCSB core workload to run: one of A, B, C, D, E or F");
+DEFINE_int64(ycsb_record_count, 1000000,
+             "Number of records in the table before the workload runs");
+DEFINE_int64(ycsb_operation_count, 1000000,
+             "Number of operations to run. 0 means no limit, in which case "
+             "'ycsb_runtime_sec' must be set");
+DEFINE_int32(ycsb_runtime_sec, 0,
+             "Maximum time to run the workload for, in seconds. 0 means no limit");
+DEFINE_double(ycsb_read_proportion, -1,
+              "Proportion of reads. A negative value uses the workload's proportion");
+DEFINE_double(ycsb_update_proportion, -1,
+              "Proportion of updates. A negative value uses the workload's proportion");
+DEFINE_double(ycsb_scan_proportion, -1,
+              "Proportion of scans. A negative value uses the workload's proportion");
+DEFINE_double(ycsb_insert_proportion, -1,
+              "Proportion of inserts. A negative value uses the workload's proportion");
+DEFINE_double(ycsb_read_modify_write_proportion, -1,
+              "Proportion of read-modify-writes. A negative value uses the "
+              "workload's proportion");
+DEFINE_string(ycsb_request_distribution, "",
+              "Distribution of the keys of reads, updates and scans: one of 'zipfian', "
+              "'latest' or 'uniform'. Empty uses the workload's distribution");
+DEFINE_double(ycsb_zipfian_constant, 0.99,
+              "Skew of the zipfian and latest distributions");
+DEFINE_int32(ycsb_max_scan_length, 100,
+             "Maximum number of records read by a scan. Scan lengths are uniformly "
+             "distributed between 1 and this value");
+DEFINE_int32(ycsb_field_length, 100,
+             "Length of each of the fields of a record, in bytes");
+
+DEFINE_int32(ycsb_num_clients, 1,
+             "Number of clients issuing operations");
+DEFINE_int32(ycsb_threads_per_client, 16,
+             "Number of threads issuing operations for each client. Each thread "
+             "has its own session");
+DEFINE_int32(ycsb_timeout_msec, 10000,
+             "Timeout that will be used for all operations and RPCs");
+DEFINE_int32(ycsb_report_interval_sec, 10,
+             "Interval at which the throughput is reported, in seconds");
+
+namespace kudu {
+
+using client::KuduClient;
+using client::KuduClientBuilder;
+using client::KuduInsert;
+using client::KuduPredicate;
+using client::KuduScanBatch;
+using client::KuduScanner;
+using client::KuduSchema;
+using client::KuduSession;
+using client::KuduTable;
+using client::KuduTableCreator;
+using client::KuduUpdate;
+using client::KuduValue;
+using client::sp::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace {
+
+const int kNumFields = 10;
+
+// The largest latency tracked by the histograms, in microseconds.
+const uint64_t kMaxLatencyMicros = 60LL * 1000 * 1000;
+
+enum OpType {
+  READ,
+  UPDATE,
+  SCAN,
+  INSERT,
+  READ_MODIFY_WRITE,
+  NUM_OP_TYPES
+};
+
+const char* OpTypeToString(OpType type) {
+  switch (type) {
+    case READ: return "READ";
+    case UPDATE: return "UPDATE";
+    case SCAN: return "SCAN";
+    case INSERT: return "INSERT";
+    case READ_MODIFY_WRITE: return "READ-MODIFY-WRITE";
+    default: LOG(FATAL) << "unknown operation type " << type;
+  }
+  return "";
+}
+
+enum KeyDistribution {
+  UNIFORM,
+  ZIPFIAN,
+  LATEST
+};
+
+struct Workload {
+  double proportions[NUM_OP_TYPES];
+  KeyDistribution distribution;
+};
+
+Status GetWorkload(const string& name, Workload* workload) {
+  //                   read   update scan  insert rmw
+  static const Workload kA = {{0.5,  0.5,   0,    0,     0},   ZIPFIAN};
+  static const Workload kB = {{0.95, 0.05,  0,    0,     0},   ZIPFIAN};
+  static const Workload kC = {{1,    0,     0,    0,     0},   ZIPFIAN};
+  static const Workload kD = {{0.95, 0,     0,    0.05,  0},   LATEST};
+  static const Workload kE = {{0,    0,     0.95, 0.05,  0},   ZIPFIAN};
+  static const Workload kF = {{0.5,  0,     0,    0,     0.5}, ZIPFIAN};
+  if (name == "A" || name == "a") {
+    *workload = kA;
+  } else if (name == "B" || name == "b") {
+    *workload = kB;
+  } else if (name == "C" || name == "c") {
+    *workload = kC;
+  } else if (name == "D" || name == "d") {
+    *workload = kD;
+  } else if (name == "E" || name == "e") {
+    *workload = kE;
+  } else if (name == "F" || name == "f") {
+    *workload = kF;
+  } else {
+    return Status::InvalidArgument("unknown YCSB workload", name);
+  }
+
+  const double overrides[NUM_OP_TYPES] = {
+    FLAGS_ycsb_read_proportion,
+    FLAGS_ycsb_update_proportion,
+    FLAGS_ycsb_scan_proportion,
+    FLAGS_ycsb_insert_proportion,
+    FLAGS_ycsb_read_modify_write_proportion
+  };
+  double total = 0;
+  for (int i = 0; i < NUM_OP_TYPES; i++) {
+    if (overrides[i] >= 0) {
+      workload->proportions[i] = overrides[i];
+    }
+    total += workload->proportions[i];
+  }
+  if (total <= 0) {
+    return Status::InvalidArgument("the operation proportions must not all be 0");
+  }
+  for (double& p : workload->proportions) {
+    p /= total;
+  }
+
+  const string& dist = FLAGS_ycsb_request_distribution;
+  if (dist == "uniform") {
+    workload->distribution = UNIFORM;
+  } else if (dist == "zipfian") {
+    workload->distribution = ZIPFIAN;
+  } else if (dist == "latest") {
+    workload->distribution = LATEST;
+  } else if (!dist.empty()) {
+    return Status::InvalidArgument("unknown request distribution", dist);
+  }
+  return Status::OK();
+}
+
+// Generates integers in [0, num_items) following a zipfian distribution,
+// with the smallest integers being the most popular.
+//
+// This is the algorithm from "Quickly Generating Billion-Record Synthetic
+// Databases" by Gray et al., which YCSB uses as well. The constructor takes
+// time linear in 'num_items'; generating an item takes constant time.
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(int64_t num_items, double theta)
+      : num_items_(num_items),
+        theta_(theta),
+        alpha_(1.0 / (1.0 - theta)),
+        zetan_(Zeta(num_items, theta)),
+        eta_((1 - pow(2.0 / num_items, 1 - theta)) / (1 - Zeta(2, theta) / zetan_)) {
+    CHECK_GT(num_items, 0);
+  }
+
+  int64_t Next(Random* rand) const {
+    double u = rand->NextDoubleFraction();
+    double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < 1.0 + pow(0.5, theta_)) {
+      return std::min<int64_t>(1, num_items_ - 1);
+    }
+    int64_t item = static_cast<int64_t>(num_items_ * pow(eta_ * u - eta_ + 1, alpha_));
+    return std::min(item, num_items_ - 1);
+  }
+
+ private:
+  static double Zeta(int64_t n, double theta) {
+    double sum = 0;
+    for (int64_t i = 1; i <= n; i++) {
+      sum += 1 / pow(i, theta);
+    }
+    return sum;
+  }
+
+  const int64_t num_items_;
+  const double theta_;
+  const double alpha_;
+  const double zetan_;
+  const double eta_;
+};
+
+// The FNV-1a hash of 'val', which YCSB uses to spread record numbers over the
+// key space.
+uint64_t FnvHash64(uint64_t val) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (int i = 0; i < 8; i++) {
+    hash ^= val & 0xff;
+    hash *= 1099511628211ULL;
+    val >>= 8;
+  }
+  return hash;
+}
+
+string KeyForHash(uint64_t hash) {
+  return StringPrintf("user%020llu", static_cast<unsigned long long>(hash));
+}
+
+string KeyForRecord(int64_t record) {
+  return KeyForHash(FnvHash64(record));
+}
+
+// The latencies and counts of one type of operation. Thread-safe.
+struct OpStats {
+  OpStats()
+      : latency_micros(kMaxLatencyMicros, 3),
+        num_ops(0),
+        num_errors(0) {
+  }
+
+  HdrHistogram latency_micros;
+  AtomicInt<int64_t> num_ops;
+  AtomicInt<int64_t> num_errors;
+};
+
+// A thread-safe source of data for one phase of the benchmark.
+class Phase {
+ public:
+  explicit Phase(string name) : name_(std::move(name)) {}
+
+  const string& name() const { return name_; }
+
+  OpStats* stats(OpType type) { return &stats_[type]; }
+  const OpStats* stats(OpType type) const { return &stats_[type]; }
+
+  void Record(OpType type, const MonoTime& start, const Status& s) {
+    OpStats* stats = &stats_[type];
+    if (PREDICT_FALSE(!s.ok())) {
+      stats->num_errors.Increment();
+      KLOG_EVERY_N_SECS(WARNING, 1) << OpTypeToString(type) << " failed: " << s.ToString();
+      return;
+    }
+    int64_t micros = (MonoTime::Now() - start).ToMicroseconds();
+    stats->latency_micros.Increment(std::min<int64_t>(micros, kMaxLatencyMicros));
+    stats->num_ops.Increment();
+  }
+
+ private:
+  const string name_;
+  OpStats stats_[NUM_OP_TYPES];
+};
+
+void WriteLine(const std::ostringstream& out) {
+  // Lines may be written by the reporting thread and the main thread.
+  static simple_spinlock lock;
+  std::lock_guard<simple_spinlock> l(lock);
+  std::cout << out.str() << std::endl;
+}
+
+} // anonymous namespace
+
+class YcsbBenchmark {
+ public:
+  YcsbBenchmark()
+      : next_op_(0),
+        next_insert_(FLAGS_ycsb_record_count),
+        num_inserted_(FLAGS_ycsb_record_count),
+        stop_threads_(false),
+        phase_(nullptr) {
+  }
+
+  Status Init();
+
+  Status Run();
+
+ private:
+  Status CreateTable();
+
+  // Runs 'phase' with 'ycsb_num_clients' * 'ycsb_threads_per_client'
+  // threads running 'thread_func', reporting its throughput until all of
+  // them are done or, if 'runtime_sec' is positive, 'runtime_sec' expire.
+  Status RunPhase(Phase* phase, int runtime_sec,
+                  const boost::function<void(int)>& thread_func);
+
+  void LoadThread(int thread_idx);
+
+  void WorkloadThread(int thread_idx);
+
+  void ReportThread(CountDownLatch* done);
+
+  // Picks the record targeted by a read, update or scan.
+  int64_t NextRecord(Random* rand) const;
+
+  // Sets the fields of 'row' to random values: all of them if 'all_fields'
+  // is true, or a single random one otherwise.
+  void SetRandomFields(Random* rand, bool all_fields, KuduPartialRow* row) const;
+
+  Status Insert(KuduSession* session, KuduTable* table, Random* rand, int64_t record) const;
+  Status Read(KuduTable* table, const string& key) const;
+  Status Update(KuduSession* session, KuduTable* table, Random* rand, const string& key) const;
+  Status Scan(KuduTable* table, const string& start_key, int length) const;
+
+  // Writes the overall results of 'phase', which ran for 'elapsed'.
+  void ReportPhase(const Phase& phase, const MonoDelta& elapsed);
+
+  KuduSchema schema_;
+  Workload workload_;
+  gscoped_ptr<ZipfianGenerator> zipfian_;
+
+  gscoped_ptr<ExternalMiniCluster> cluster_;
+  vector<shared_ptr<KuduClient>> clients_;
+
+  // The number of operations started by the workload.
+  AtomicInt<int64_t> next_op_;
+  // The number of the next record to insert.
+  AtomicInt<int64_t> next_insert_;
+  // A lower bound on the number of records that were inserted, used by the
+  // 'latest' distribution.
+  AtomicInt<int64_t> num_inserted_;
+  AtomicBool stop_threads_;
+  // The phase being run.
+  Phase* phase_;
+};
+
+Status YcsbBenchmark::Init() {
+  if (FLAGS_ycsb_record_count <= 0) {
+    return Status::InvalidArgument("ycsb_record_count must be positive");
+  }
+  if (FLAGS_ycsb_operation_count <= 0 && FLAGS_ycsb_runtime_sec <= 0) {
+    return Status::InvalidArgument(
+        "one of ycsb_operation_count or ycsb_runtime_sec must be set");
+  }
+  if (FLAGS_ycsb_num_clients <= 0 || FLAGS_ycsb_threads_per_client <= 0) {
+    return Status::InvalidArgument(
+        "ycsb_num_clients and ycsb_threads_per_client must be positive");
+  }
+  if (FLAGS_ycsb_max_scan_length <= 0) {
+    return Status::InvalidArgument("ycsb_max_scan_length must be positive");
+  }
+  RETURN_NOT_OK(GetWorkload(FLAGS_ycsb_workload, &workload_));
+  schema_ = CreateYCSBSchema();
+  zipfian_.reset(new ZipfianGenerator(FLAGS_ycsb_record_count, FLAGS_ycsb_zipfian_constant));
+
+  string master_addresses;
+  if (FLAGS_ycsb_use_mini_cluster) {
+    Env* env = Env::Default();
+    if (env->FileExists(FLAGS_ycsb_mini_cluster_base_dir)) {
+      RETURN_NOT_OK(env->DeleteRecursively(FLAGS_ycsb_mini_cluster_base_dir));
+    }
+    RETURN_NOT_OK(env->CreateDir(FLAGS_ycsb_mini_cluster_base_dir));
+
+    ExternalMiniClusterOptions opts;
+    opts.num_tablet_servers = FLAGS_ycsb_num_tablet_servers;
+    opts.data_root = FLAGS_ycsb_mini_cluster_base_dir;
+    cluster_.reset(new ExternalMiniCluster(opts));
+    RETURN_NOT_OK(cluster_->Start());
+    master_addresses = cluster_->leader_master()->bound_rpc_hostport().ToString();
+  } else {
+    master_addresses = FLAGS_ycsb_master_addresses;
+  }
+
+  MonoDelta timeout = MonoDelta::FromMilliseconds(FLAGS_ycsb_timeout_msec);
+  for (int i = 0; i < FLAGS_ycsb_num_clients; i++) {
+    shared_ptr<KuduClient> client;
+    RETURN_NOT_OK(KuduClientBuilder()
+                  .master_server_addrs(strings::Split(master_addresses, ",",
+                                                      strings::SkipEmpty()))
+                  .default_admin_operation_timeout(timeout)
+                  .default_rpc_timeout(timeout)
+                  .Build(&client));
+    clients_.push_back(client);
+  }
+
+  if (FLAGS_ycsb_load) {
+    RETURN_NOT_OK(CreateTable());
+  }
+  return Status::OK();
+}
+
+Status YcsbBenchmark::CreateTable() {
+  bool exists;
+  RETURN_NOT_OK(clients_[0]->TableExists(FLAGS_ycsb_table_name, &exists));
+  if (exists) {
+    LOG(INFO) << "Deleting existing table " << FLAGS_ycsb_table_name;
+    RETURN_NOT_OK(clients_[0]->DeleteTable(FLAGS_ycsb_table_name));
+  }
+
+  // The hashed keys are uniformly distributed, so split the key space evenly.
+  unique_ptr<KuduTableCreator> creator(clients_[0]->NewTableCreator());
+  creator->table_name(FLAGS_ycsb_table_name)
+      .schema(&schema_)
+      .set_range_partition_columns({ "key" })
+      .num_replicas(FLAGS_ycsb_num_replicas);
+  uint64_t increment = kuint64max / FLAGS_ycsb_num_tablets;
+  for (int i = 1; i < FLAGS_ycsb_num_tablets; i++) {
+    KuduPartialRow* split = schema_.NewRow();
+    RETURN_NOT_OK(split->SetStringCopy("key", KeyForHash(i * increment)));
+    creator->add_range_partition_split(split);
+  }
+  return creator->Create();
+}
+
+int64_t YcsbBenchmark::NextRecord(Random* rand) const {
+  switch (workload_.distribution) {
+    case UNIFORM:
+      return rand->Uniform64(num_inserted_.Load());
+    case ZIPFIAN:
+      // Scramble the popular records over the key space, as YCSB does.
+      return FnvHash64(zipfian_->Next(rand)) % num_inserted_.Load();
+    case LATEST: {
+      int64_t num_inserted = num_inserted_.Load();
+      return std::max<int64_t>(0, num_inserted - 1 - zipfian_->Next(rand));
+    }
+  }
+  LOG(FATAL) << "unknown key distribution";
+  return 0;
+}
+
+void YcsbBenchmark::SetRandomFields(Random* rand, bool all_fields, KuduPartialRow* row) const {
+  string value(FLAGS_ycsb_field_length, ' ');
+  int first = all_fields ? 0 : rand->Uniform(kNumFields);
+  int last = all_fields ? kNumFields - 1 : first;
+  for (int i = first; i <= last; i++) {
+    for (char& c : value) {
+      c = ' ' + rand->Uniform(95);
+    }
+    CHECK_OK(row->SetStringCopy(Substitute("field$0", i), value));
+  }
+}
+
+Status YcsbBenchmark::Insert(KuduSession* session, KuduTable* table, Random* rand,
+                             int64_t record) const {
+  unique_ptr<KuduInsert> insert(table->NewInsert());
+  RETURN_NOT_OK(insert->mutable_row()->SetStringCopy("key", KeyForRecord(record)));
+  SetRandomFields(rand, true, insert->mutable_row());
+  return session->Apply(insert.release());
+}
+
+Status YcsbBenchmark::Read(KuduTable* table, const string& key) const {
+  KuduScanner scanner(table);
+  RETURN_NOT_OK(scanner.SetTimeoutMillis(FLAGS_ycsb_timeout_msec));
+  RETURN_NOT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+      "key", KuduPredicate::EQUAL, KuduValue::CopyString(key))));
+  RETURN_NOT_OK(scanner.Open());
+  int num_rows = 0;
+  KuduScanBatch batch;
+  while (scanner.HasMoreRows()) {
+    RETURN_NOT_OK(scanner.NextBatch(&batch));
+    num_rows += batch.NumRows();
+  }
+  if (num_rows != 1) {
+    return Status::NotFound("record not found", key);
+  }
+  return Status::OK();
+}
+
+Status YcsbBenchmark::Update(KuduSession* session, KuduTable* table, Random* rand,
+                             const string& key) const {
+  unique_ptr<KuduUpdate> update(table->NewUpdate());
+  RETURN_NOT_OK(update->mutable_row()->SetStringCopy("key", key));
+  SetRandomFields(rand, false, update->mutable_row());
+  return session->Apply(update.release());
+}
+
+Status YcsbBenchmark::Scan(KuduTable* table, const string& start_key, int length) const {
+  KuduScanner scanner(table);
+  RETURN_NOT_OK(scanner.SetTimeoutMillis(FLAGS_ycsb_timeout_msec));
+  gscoped_ptr<KuduPartialRow> lower_bound(schema_.NewRow());
+  RETURN_NOT_OK(lower_bound->SetStringCopy("key", start_key));
+  RETURN_NOT_OK(scanner.AddLowerBound(*lower_bound));
+  // Avoid fetching much more than 'length' rows in the first batch.
+  RETURN_NOT_OK(scanner.SetBatchSizeBytes(
+      length * (kNumFields * FLAGS_ycsb_field_length + start_key.size())));
+  RETURN_NOT_OK(scanner.Open());
+  int num_rows = 0;
+  KuduScanBatch batch;
+  while (num_rows < length && scanner.HasMoreRows()) {
+    RETURN_NOT_OK(scanner.NextBatch(&batch));
+    num_rows += batch.NumRows();
+  }
+  scanner.Close();
+  return Status::OK();
+}
+
+void YcsbBenchmark::LoadThread(int thread_idx) {
+  shared_ptr<KuduClient> client = clients_[thread_idx % clients_.size()];
+  shared_ptr<KuduTable> table;
+  CHECK_OK(client->OpenTable(FLAGS_ycsb_table_name, &table));
+  shared_ptr<KuduSession> session = client->NewSession();
+  session->SetTimeoutMillis(FLAGS_ycsb_timeout_msec);
+  CHECK_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  Random rand(GetRandomSeed32());
+
+  // Each thread loads an equal share of the records.
+  int num_threads = FLAGS_ycsb_num_clients * FLAGS_ycsb_threads_per_client;
+  int64_t begin = FLAGS_ycsb_record_count * thread_idx / num_threads;
+  int64_t end = FLAGS_ycsb_record_count * (thread_idx + 1) / num_threads;
+  for (int64_t record = begin; record < end && !stop_threads_.Load(); record++) {
+    MonoTime start = MonoTime::Now();
+    phase_->Record(INSERT, start, Insert(session.get(), table.get(), &rand, record));
+  }
+  Status s = session->Flush();
+  if (!s.ok()) {
+    vector<client::KuduError*> errors;
+    ElementDeleter d(&errors);
+    session->GetPendingErrors(&errors, nullptr);
+    for (const client::KuduError* error : errors) {
+      phase_->stats(INSERT)->num_errors.Increment();
+      KLOG_EVERY_N_SECS(WARNING, 1) << "INSERT failed: " << error->status().ToString();
+    }
+  }
+}
+
+void YcsbBenchmark::WorkloadThread(int thread_idx) {
+  shared_ptr<KuduClient> client = clients_[thread_idx % clients_.size()];
+  shared_ptr<KuduTable> table;
+  CHECK_OK(client->OpenTable(FLAGS_ycsb_table_name, &table));
+  shared_ptr<KuduSession> session = client->NewSession();
+  session->SetTimeoutMillis(FLAGS_ycsb_timeout_msec);
+  CHECK_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_SYNC));
+  Random rand(GetRandomSeed32());
+
+  while (!stop_threads_.Load()) {
+    if (FLAGS_ycsb_operation_count > 0 &&
+        next_op_.Increment() > FLAGS_ycsb_operation_count) {
+      break;
+    }
+
+    double choice = rand.NextDoubleFraction();
+    int type = 0;
+    while (type < NUM_OP_TYPES - 1 && choice >= workload_.proportions[type]) {
+      choice -= workload_.proportions[type];
+      type++;
+    }
+
+    MonoTime start = MonoTime::Now();
+    Status s;
+    switch (type) {
+      case READ:
+        s = Read(table.get(), KeyForRecord(NextRecord(&rand)));
+        break;
+      case UPDATE:
+        s = Update(session.get(), table.get(), &rand, KeyForRecord(NextRecord(&rand)));
+        break;
+      case SCAN:
+        s = Scan(table.get(), KeyForRecord(NextRecord(&rand)),
+                 1 + rand.Uniform(FLAGS_ycsb_max_scan_length));
+        break;
+      case INSERT: {
+        int64_t record = next_insert_.Increment() - 1;
+        s = Insert(session.get(), table.get(), &rand, record);
+        if (s.ok()) {
+          num_inserted_.StoreMax(record + 1);
+        }
+        break;
+      }
+      case READ_MODIFY_WRITE: {
+        string key = KeyForRecord(NextRecord(&rand));
+        s = Read(table.get(), key);
+        if (s.ok()) {
+          s = Update(session.get(), table.get(), &rand, key);
+        }
+        break;
+      }
+    }
+    phase_->Record(static_cast<OpType>(type), start, s);
+  }
+}
+
+void YcsbBenchmark::ReportThread(CountDownLatch* done) {
+  MonoTime start = MonoTime::Now();
+  int64_t prev_ops[NUM_OP_TYPES] = { 0 };
+  MonoDelta interval = MonoDelta::FromSeconds(FLAGS_ycsb_report_interval_sec);
+  while (!done->WaitFor(interval)) {
+    std::ostringstream out;
+    JsonWriter jw(&out, JsonWriter::COMPACT);
+    jw.StartObject();
+    jw.String("phase");
+    jw.String(phase_->name());
+    jw.String("elapsed_sec");
+    jw.Double((MonoTime::Now() - start).ToSeconds());
+    int64_t total = 0;
+    jw.String("ops");
+    jw.StartObject();
+    for (int i = 0; i < NUM_OP_TYPES; i++) {
+      int64_t ops = phase_->stats(static_cast<OpType>(i))->num_ops.Load();
+      if (ops > 0) {
+        jw.String(OpTypeToString(static_cast<OpType>(i)));
+        jw.Int64(ops - prev_ops[i]);
+      }
+      total += ops - prev_ops[i];
+      prev_ops[i] = ops;
+    }
+    jw.EndObject();
+    jw.String("ops_per_sec");
+    jw.Double(total / interval.ToSeconds());
+    jw.EndObject();
+    WriteLine(out);
+  }
+}
+
+Status YcsbBenchmark::RunPhase(Phase* phase, int runtime_sec,
+                              const boost::function<void(int)>& thread_func) {
+  phase_ = phase;
+  stop_threads_.Store(false);
+  int num_threads = FLAGS_ycsb_num_clients * FLAGS_ycsb_threads_per_client;
+  CountDownLatch done(num_threads);
+  CountDownLatch report_done(1);
+  scoped_refptr<Thread> report_thread;
+  RETURN_NOT_OK(Thread::Create("ycsb", "report", &YcsbBenchmark::ReportThread, this,
+                               &report_done, &report_thread));
+
+  LOG(INFO) << "Running the " << phase->name() << " phase with " << num_threads << " threads";
+  MonoTime start = MonoTime::Now();
+  vector<scoped_refptr<Thread>> threads;
+  for (int i = 0; i < num_threads; i++) {
+    scoped_refptr<Thread> thr;
+    RETURN_NOT_OK(Thread::Create("ycsb", Substitute("$0-$1", phase->name(), i),
+                                 [&thread_func, &done, i]() {
+                                   thread_func(i);
+                                   done.CountDown();
+                                 },
+                                 &thr));
+    threads.push_back(thr);
+  }
+  if (runtime_sec > 0) {
+    if (!done.WaitFor(MonoDelta::FromSeconds(runtime_sec))) {
+      LOG(INFO) << runtime_sec << " seconds expired, stopping the "
+                << phase->name() << " phase";
+    }
+  }
+  stop_threads_.Store(true);
+  for (const auto& thr : threads) {
+    RETURN_NOT_OK(ThreadJoiner(thr.get()).Join());
+  }
+  MonoDelta elapsed = MonoTime::Now() - start;
+  report_done.CountDown();
+  RETURN_NOT_OK(ThreadJoiner(report_thread.get()).Join());
+
+  ReportPhase(*phase, elapsed);
+  return Status::OK();
+}
+
+void YcsbBenchmark::ReportPhase(const Phase& phase, const MonoDelta& elapsed) {
+  std::ostringstream out;
+  JsonWriter jw(&out, JsonWriter::COMPACT);
+  jw.StartObject();
+  jw.String("phase");
+  jw.String(phase.name());
+  jw.String("elapsed_sec");
+  jw.Double(elapsed.ToSeconds());
+  jw.String("results");
+  jw.StartObject();
+  for (int i = 0; i < NUM_OP_TYPES; i++) {
+    const OpStats* stats = phase.stats(static_cast<OpType>(i));
+    int64_t ops = stats->num_ops.Load();
+    int64_t errors = stats->num_errors.Load();
+    if (ops == 0 && errors == 0) {
+      continue;
+    }
+    const HdrHistogram& h = stats->latency_micros;
+    jw.String(OpTypeToString(static_cast<OpType>(i)));
+    jw.StartObject();
+    jw.String("ops");
+    jw.Int64(ops);
+    jw.String("errors");
+    jw.Int64(errors);
+    jw.String("ops_per_sec");
+    jw.Double(ops / elapsed.ToSeconds());
+    jw.String("latency_us");
+    jw.StartObject();
+    jw.String("min");
+    jw.Uint64(ops > 0 ? h.MinValue() : 0);
+    jw.String("mean");
+    jw.Double(ops > 0 ? h.MeanValue() : 0);
+    for (double percentile : { 50.0, 75.0, 95.0, 99.0, 99.9, 99.99 }) {
+      jw.String(Substitute("p$0", percentile));
+      jw.Uint64(h.ValueAtPercentile(percentile));
+    }
+    jw.String("max");
+    jw.Uint64(h.MaxValue());
+    jw.EndObject();
+    jw.EndObject();
+  }
+  jw.EndObject();
+  jw.EndObject();
+  WriteLine(out);
+}
+
+Status YcsbBenchmark::Run() {
+  if (FLAGS_ycsb_load) {
+    Phase load("load");
+    RETURN_NOT_OK(RunPhase(&load, 0, boost::bind(&YcsbBenchmark::LoadThread, this, _1)));
+    if (load.stats(INSERT)->num_errors.Load() > 0) {
+      return Status::RuntimeError("failed to load all the records");
+    }
+  }
+  Phase run(Substitute("workload-$0", FLAGS_ycsb_workload));
+  return RunPhase(&run, FLAGS_ycsb_runtime_sec,
+                  boost::bind(&YcsbBenchmark::WorkloadThread, this, _1));
+}
+
+} // namespace kudu
+
+int main(int argc, char* argv[]) {
+  kudu::ParseCommandLineFlags(&argc, &argv, true);
+  kudu::InitGoogleLoggingSafe(argv[0]);
+
+  kudu::YcsbBenchmark benchmark;
+  kudu::Status s = benchmark.Init();
+  if (!s.ok()) {
+    std::cerr << "Couldn't initialize the benchmarking tool, reason: " << s.ToString() << std::endl;
+    return 1;
+  }
+  s = benchmark.Run();
+  if (!s.ok()) {
+    std::cerr << "Couldn't run the benchmarking tool, reason: " << s.ToString() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -274,25 +274,26 @@ Status BinaryDictBlockDecoder::CopyNextAndEval(size_t* n,
     return Status::OK();
   }
 
-  // IsNotNull predicates should return all data.
-  if (ctx->pred()->predicate_type() == PredicateType::IsNotNull) {
-    return CopyNextDecodeStrings(n, dst);
-  }
+  // IsNotNull predicates, and predicates satisfied by every word in the
+  // dictionary, match every row: there is no need to test the codewords.
+  bool all_match = ctx->pred()->predicate_type() == PredicateType::IsNotNull ||
+      parent_cfile_iter_->AllCodeWordsMatchPredicate();
 
   // Load the rows' codeword values into a buffer for scanning.
   BShufBlockDecoder<UINT32>* d_bptr = down_cast<BShufBlockDecoder<UINT32>*>(data_decoder_.get());
   codeword_buf_.resize(*n * sizeof(uint32_t));
-  d_bptr->CopyNextValuesToArray(n, codeword_buf_.data());
+  RETURN_NOT_OK(d_bptr->CopyNextValuesToArray(n, codeword_buf_.data()));
+  const uint32_t* codewords = reinterpret_cast<const uint32_t*>(codeword_buf_.data());
   Slice* out = reinterpret_cast<Slice*>(dst->data());
   Arena* out_arena = dst->arena();
   for (size_t i = 0; i < *n; i++, out++) {
     // Check with the SelectionVectorView to see whether the data has already
-    // been cleared, in which case we can skip evaluation.
+    // been cleared, in which case we can skip evaluation and the copy.
     if (!sel->TestBit(i)) {
       continue;
     }
-    uint32_t codeword = *reinterpret_cast<uint32_t*>(&codeword_buf_[i*sizeof(uint32_t)]);
-    if (BitmapTest(codewords_matching_pred->bitmap(), codeword)) {
+    uint32_t codeword = codewords[i];
+    if (all_match || BitmapTest(codewords_matching_pred->bitmap(), codeword)) {
       // Row is included in predicate, copy data to block.
       CHECK(out_arena->RelocateSlice(dict_decoder_->string_at_index(codeword), out));
     } else {
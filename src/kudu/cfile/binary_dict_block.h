@@ -74,6 +74,10 @@ class BinaryDictBlockBuilder final : public BlockBuilder {
   // accordingly.
   Status AppendExtraInfo(CFileWriter* c_writer, CFileFooterPB* footer) OVERRIDE;
 
+  size_t EstimateExtraInfoSize() const OVERRIDE {
+    return dict_block_.EstimateEncodedSize();
+  }
+
   int Add(const uint8_t* vals, size_t count) OVERRIDE;
 
   Slice Finish(rowid_t ordinal_pos) OVERRIDE;
@@ -131,6 +135,12 @@ class BinaryDictBlockDecoder final : public BlockDecoder {
                          ColumnMaterializationContext* ctx,
                          SelectionVectorView* sel,
                          ColumnDataView* dst) override;
+  // Skipping unselected rows saves copying their strings.
+  Status CopyNextSelectedValues(size_t* n,
+                                const SelectionVectorView& sel,
+                                ColumnDataView* dst) override {
+    return CopyNextSelectedValuesBySeeking(n, sel, dst);
+  }
 
   virtual bool HasNext() const OVERRIDE {
     return data_decoder_->HasNext();
@@ -58,6 +58,11 @@ class BinaryPlainBlockBuilder final : public BlockBuilder {
 
   size_t Count() const OVERRIDE;
 
+  // Return an estimate of the size of the block if it were finished now.
+  size_t EstimateEncodedSize() const {
+    return size_estimate_;
+  }
+
   // Return the key at index idx.
   // key should be a Slice*
   Status GetKeyAtIdx(void* key_void, int idx) const;
@@ -101,6 +106,12 @@ class BinaryPlainBlockDecoder final : public BlockDecoder {
                          ColumnMaterializationContext* ctx,
                          SelectionVectorView* sel,
                          ColumnDataView* dst) override;
+  // Skipping unselected rows saves copying their strings.
+  Status CopyNextSelectedValues(size_t* n,
+                                const SelectionVectorView& sel,
+                                ColumnDataView* dst) override {
+    return CopyNextSelectedValuesBySeeking(n, sel, dst);
+  }
 
   virtual bool HasNext() const OVERRIDE {
     DCHECK(parsed_);
@@ -15,12 +15,20 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
 #include "kudu/cfile/block_cache.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/slice.h"
 
+DECLARE_bool(cache_force_single_shard);
+DECLARE_double(block_cache_high_priority_ratio);
+DECLARE_int64(block_cache_compressed_capacity_mb);
+
+METRIC_DECLARE_entity(tablet);
+
 namespace kudu {
 namespace cfile {
 
@@ -60,6 +68,146 @@ TEST(TestBlockCache, TestBasics) {
   ASSERT_FALSE(cache.Lookup(key1, Cache::EXPECT_IN_CACHE, &retrieved_handle));
 }
 
+static void InsertBlock(BlockCache* cache, const BlockCache::CacheKey& key,
+                        size_t size, BlockCache::Priority priority,
+                        BlockCacheAttribution* attribution = nullptr,
+                        bool cold = false) {
+  BlockCache::PendingEntry data = cache->Allocate(key, size, priority);
+  ASSERT_TRUE(data.valid());
+  memset(data.val_ptr(), 0, size);
+  BlockCacheHandle handle;
+  cache->Insert(&data, &handle, attribution, cold);
+}
+
+TEST(TestBlockCache, TestCompressedBlocks) {
+  google::FlagSaver saver;
+  size_t data_size = strlen(DATA_TO_CACHE) + 1;
+  {
+    BlockCache cache(512 * 1024 * 1024);
+    ASSERT_FALSE(cache.has_compressed_cache());
+  }
+  FLAGS_block_cache_compressed_capacity_mb = 1;
+  BlockCache cache(512 * 1024 * 1024);
+  ASSERT_TRUE(cache.has_compressed_cache());
+  BlockCache::FileId id(1234);
+  BlockCache::CacheKey key(id, 1);
+
+  BlockCache::PendingEntry data = cache.AllocateCompressed(key, data_size);
+  ASSERT_TRUE(data.valid());
+  memcpy(data.val_ptr(), DATA_TO_CACHE, data_size);
+  BlockCacheHandle inserted_handle;
+  cache.InsertCompressed(&data, &inserted_handle);
+  ASSERT_FALSE(data.valid());
+  ASSERT_TRUE(inserted_handle.valid());
+
+  BlockCacheHandle handle;
+  ASSERT_TRUE(cache.LookupCompressed(key, Cache::EXPECT_IN_CACHE, &handle));
+  ASSERT_EQ(0, memcmp(handle.data().data(), DATA_TO_CACHE, data_size));
+
+  // The compressed and decompressed blocks are cached separately.
+  BlockCacheHandle decompressed_handle;
+  ASSERT_FALSE(cache.Lookup(key, Cache::EXPECT_IN_CACHE, &decompressed_handle));
+}
+
+// Data blocks should not be able to evict high priority blocks from the
+// share of the capacity that is reserved for them.
+TEST(TestBlockCache, TestHighPriorityReserved) {
+  google::FlagSaver saver;
+  FLAGS_cache_force_single_shard = true;
+  FLAGS_block_cache_high_priority_ratio = 0.25;
+  const size_t kCapacity = 1024 * 1024;
+  const size_t kBlockSize = 1024;
+  BlockCache cache(kCapacity);
+  BlockCache::FileId id(1234);
+
+  BlockCache::CacheKey index_key(id, 1);
+  ASSERT_NO_FATAL_FAILURE(InsertBlock(&cache, index_key, kBlockSize,
+                                      BlockCache::HIGH_PRIORITY));
+
+  // Insert enough data blocks to fill the whole cache several times over.
+  for (size_t i = 0; i < 4 * kCapacity / kBlockSize; i++) {
+    BlockCache::CacheKey key(id, 100 + i);
+    ASSERT_NO_FATAL_FAILURE(InsertBlock(&cache, key, kBlockSize,
+                                        BlockCache::NORMAL_PRIORITY));
+  }
+
+  BlockCacheHandle handle;
+  ASSERT_TRUE(cache.Lookup(index_key, Cache::EXPECT_IN_CACHE, &handle,
+                           BlockCache::HIGH_PRIORITY));
+  // The first data blocks were evicted.
+  BlockCache::CacheKey first_data_key(id, 100);
+  ASSERT_FALSE(cache.Lookup(first_data_key, Cache::EXPECT_IN_CACHE, &handle));
+}
+
+// Blocks inserted cold only evict each other once the cache is full.
+TEST(TestBlockCache, TestColdInsertions) {
+  google::FlagSaver saver;
+  FLAGS_cache_force_single_shard = true;
+  const size_t kCapacity = 1024 * 1024;
+  const size_t kBlockSize = 1024;
+  const size_t kNumBlocks = kCapacity / kBlockSize;
+  BlockCache cache(kCapacity);
+  BlockCache::FileId id(1234);
+
+  for (size_t i = 0; i < kNumBlocks; i++) {
+    BlockCache::CacheKey key(id, 100 + i);
+    ASSERT_NO_FATAL_FAILURE(InsertBlock(&cache, key, kBlockSize,
+                                        BlockCache::NORMAL_PRIORITY));
+  }
+  for (size_t i = 0; i < 4 * kNumBlocks; i++) {
+    BlockCache::CacheKey key(id, 100 + kNumBlocks + i);
+    ASSERT_NO_FATAL_FAILURE(InsertBlock(&cache, key, kBlockSize,
+                                        BlockCache::NORMAL_PRIORITY, nullptr, true));
+  }
+
+  // Only the oldest of the blocks inserted normally made room for the cold ones.
+  BlockCacheHandle handle;
+  ASSERT_FALSE(cache.Lookup(BlockCache::CacheKey(id, 100), Cache::EXPECT_IN_CACHE, &handle));
+  for (size_t i = 1; i < kNumBlocks; i++) {
+    ASSERT_TRUE(cache.Lookup(BlockCache::CacheKey(id, 100 + i), Cache::EXPECT_IN_CACHE,
+                             &handle));
+  }
+  BlockCache::CacheKey last_key(id, 100 + 5 * kNumBlocks - 1);
+  ASSERT_TRUE(cache.Lookup(last_key, Cache::EXPECT_IN_CACHE, &handle));
+}
+
+
+TEST(TestBlockCache, TestAttribution) {
+  google::FlagSaver saver;
+  FLAGS_cache_force_single_shard = true;
+  const size_t kCapacity = 1024 * 1024;
+  const size_t kBlockSize = 1024;
+  BlockCache cache(kCapacity);
+  BlockCache::FileId id(1234);
+
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity = METRIC_ENTITY_tablet.Instantiate(&registry, "tablet");
+  scoped_refptr<BlockCacheAttribution> attribution(new BlockCacheAttribution(entity));
+  for (int i = 0; i < 10; i++) {
+    BlockCache::CacheKey key(id, 1 + i);
+    ASSERT_NO_FATAL_FAILURE(InsertBlock(&cache, key, kBlockSize, BlockCache::NORMAL_PRIORITY,
+                                        attribution.get()));
+  }
+  ASSERT_EQ(10 * kBlockSize, attribution->inserted_bytes());
+  ASSERT_EQ(10 * kBlockSize, attribution->resident_bytes());
+
+  attribution->RecordLookup(true);
+  attribution->RecordLookup(false);
+  ASSERT_EQ(1, attribution->hits());
+  ASSERT_EQ(1, attribution->misses());
+
+  // Each cached block holds a reference to the attribution.
+  ASSERT_FALSE(attribution->HasOneRef());
+
+  // Push the attributed blocks out of the cache with unattributed ones.
+  for (size_t i = 0; i < 2 * kCapacity / kBlockSize; i++) {
+    BlockCache::CacheKey key(id, 100 + i);
+    ASSERT_NO_FATAL_FAILURE(InsertBlock(&cache, key, kBlockSize, BlockCache::NORMAL_PRIORITY));
+  }
+  ASSERT_EQ(10 * kBlockSize, attribution->inserted_bytes());
+  ASSERT_EQ(0, attribution->resident_bytes());
+  ASSERT_TRUE(attribution->HasOneRef());
+}
 
 } // namespace cfile
 } // namespace kudu
@@ -15,6 +15,11 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <string.h>
+
+#include <string>
+#include <vector>
+
 #include <gflags/gflags.h>
 
 #include "kudu/cfile/block_cache.h"
@@ -25,36 +30,212 @@
 #include "kudu/util/slice.h"
 #include "kudu/util/string_case.h"
 
+#if !defined(__APPLE__)
+#include "kudu/util/tiered_cache.h"
+#endif
+
 DEFINE_int64(block_cache_capacity_mb, 512, "block cache capacity in MB");
 TAG_FLAG(block_cache_capacity_mb, stable);
 
 DEFINE_string(block_cache_type, "DRAM",
               "Which type of block cache to use for caching data. "
-              "Valid choices are 'DRAM' or 'NVM'. DRAM, the default, "
+              "Valid choices are 'DRAM', 'NVM' or 'TIERED'. DRAM, the default, "
               "caches data in regular memory. 'NVM' caches data "
-              "in a memory-mapped file using the NVML library.");
+              "in a memory-mapped file using the NVML library. 'TIERED' "
+              "caches data in regular memory, and moves blocks evicted from "
+              "it to an NVM cache of --block_cache_nvm_tier_capacity_mb.");
 TAG_FLAG(block_cache_type, experimental);
 
+DEFINE_int64(block_cache_nvm_tier_capacity_mb, 0,
+             "Capacity in MB of the NVM tier of the block cache, when "
+             "--block_cache_type is 'TIERED'. --block_cache_capacity_mb is then "
+             "the capacity of its DRAM tier.");
+TAG_FLAG(block_cache_nvm_tier_capacity_mb, experimental);
+
+DEFINE_string(block_cache_eviction_policy, "LRU",
+              "Which eviction policy the block cache uses. Valid choices are "
+              "'LRU' or 'SLRU'. 'SLRU' (segmented LRU) protects blocks which have "
+              "been read more than once from being evicted by large scans "
+              "which read many blocks only once. 'SLRU' requires the 'DRAM' "
+              "block cache type.");
+TAG_FLAG(block_cache_eviction_policy, experimental);
+
+DEFINE_double(block_cache_high_priority_ratio, 0,
+              "Fraction of the block cache capacity reserved for high priority "
+              "blocks, i.e. CFile index and bloom filter blocks. Data blocks "
+              "cannot evict blocks from the reserved share. If 0, all blocks "
+              "share the whole capacity.");
+TAG_FLAG(block_cache_high_priority_ratio, experimental);
+
+DEFINE_int64(block_cache_compressed_capacity_mb, 0,
+             "Capacity in MB of a separate cache of compressed CFile blocks, "
+             "kept in regular memory in addition to the block cache of "
+             "decompressed blocks. A hit avoids reading the block from disk "
+             "but still requires decompressing it. If 0, compressed blocks "
+             "are not cached.");
+TAG_FLAG(block_cache_compressed_capacity_mb, experimental);
+
+static bool ValidateHighPriorityRatio(const char* flagname, double value) {
+  if (value >= 0 && value < 1) {
+    return true;
+  }
+  LOG(ERROR) << flagname << " must be at least 0 and less than 1, value "
+             << value << " is invalid";
+  return false;
+}
+static bool dummy = google::RegisterFlagValidator(
+    &FLAGS_block_cache_high_priority_ratio, &ValidateHighPriorityRatio);
+
+METRIC_DEFINE_counter(tablet, tablet_block_cache_hits,
+                      "Tablet Block Cache Hits", kudu::MetricUnit::kBlocks,
+                      "Number of block cache lookups of this tablet's blocks "
+                      "that found the block");
+METRIC_DEFINE_counter(tablet, tablet_block_cache_misses,
+                      "Tablet Block Cache Misses", kudu::MetricUnit::kBlocks,
+                      "Number of block cache lookups of this tablet's blocks "
+                      "that didn't find the block");
+METRIC_DEFINE_counter(tablet, tablet_block_cache_inserted_bytes,
+                      "Tablet Block Cache Inserted Bytes", kudu::MetricUnit::kBytes,
+                      "Number of bytes of this tablet's blocks inserted in the "
+                      "block cache");
+METRIC_DEFINE_gauge_uint64(tablet, tablet_block_cache_resident_bytes,
+                           "Tablet Block Cache Resident Bytes", kudu::MetricUnit::kBytes,
+                           "Number of bytes of this tablet's blocks currently held "
+                           "in the block cache");
+
+METRIC_DEFINE_counter(server, block_cache_high_priority_hits,
+                      "Block Cache High Priority Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of high priority (index and bloom filter) "
+                      "blocks that found the block");
+METRIC_DEFINE_counter(server, block_cache_high_priority_misses,
+                      "Block Cache High Priority Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of high priority (index and bloom filter) "
+                      "blocks that didn't find the block");
+METRIC_DEFINE_counter(server, block_cache_high_priority_inserts,
+                      "Block Cache High Priority Inserts", kudu::MetricUnit::kBlocks,
+                      "Number of high priority (index and bloom filter) blocks "
+                      "inserted in the cache");
+METRIC_DEFINE_counter(server, block_cache_normal_priority_hits,
+                      "Block Cache Normal Priority Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of normal priority (data) blocks that "
+                      "found the block");
+METRIC_DEFINE_counter(server, block_cache_normal_priority_misses,
+                      "Block Cache Normal Priority Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups of normal priority (data) blocks that "
+                      "didn't find the block");
+METRIC_DEFINE_counter(server, block_cache_normal_priority_inserts,
+                      "Block Cache Normal Priority Inserts", kudu::MetricUnit::kBlocks,
+                      "Number of normal priority (data) blocks inserted in the cache");
+METRIC_DEFINE_counter(server, block_cache_compressed_hits,
+                      "Compressed Block Cache Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the cache of compressed blocks that "
+                      "found the block");
+METRIC_DEFINE_counter(server, block_cache_compressed_misses,
+                      "Compressed Block Cache Misses", kudu::MetricUnit::kBlocks,
+                      "Number of lookups in the cache of compressed blocks that "
+                      "didn't find the block");
+METRIC_DEFINE_counter(server, block_cache_compressed_inserts,
+                      "Compressed Block Cache Inserts", kudu::MetricUnit::kBlocks,
+                      "Number of blocks inserted in the cache of compressed blocks");
+
 namespace kudu {
 
 class MetricEntity;
 
 namespace cfile {
 
+BlockCacheAttribution::BlockCacheAttribution(const scoped_refptr<MetricEntity>& metric_entity)
+    : hits_(METRIC_tablet_block_cache_hits.Instantiate(metric_entity)),
+      misses_(METRIC_tablet_block_cache_misses.Instantiate(metric_entity)),
+      inserted_bytes_(METRIC_tablet_block_cache_inserted_bytes.Instantiate(metric_entity)),
+      resident_bytes_(METRIC_tablet_block_cache_resident_bytes.Instantiate(metric_entity, 0)) {
+}
+
+BlockCacheAttribution::~BlockCacheAttribution() {
+}
+
+void BlockCacheAttribution::RecordLookup(bool hit) {
+  if (hit) {
+    hits_->Increment();
+  } else {
+    misses_->Increment();
+  }
+}
+
+int64_t BlockCacheAttribution::hits() const {
+  return hits_->value();
+}
+
+int64_t BlockCacheAttribution::misses() const {
+  return misses_->value();
+}
+
+int64_t BlockCacheAttribution::inserted_bytes() const {
+  return inserted_bytes_->value();
+}
+
+uint64_t BlockCacheAttribution::resident_bytes() const {
+  return resident_bytes_->value();
+}
+
+void BlockCacheAttribution::RecordInsert(size_t size) {
+  // Released by EvictedEntry().
+  AddRef();
+  inserted_bytes_->IncrementBy(size);
+  resident_bytes_->IncrementBy(size);
+}
+
+void BlockCacheAttribution::EvictedEntry(Slice key, Slice value) {
+  resident_bytes_->DecrementBy(value.size());
+  // May delete 'this'.
+  Release();
+}
+
 namespace {
 
-Cache* CreateCache(int64_t capacity) {
+// 'nvm_tier_capacity' is only used by the 'TIERED' block cache type.
+Cache* CreateCache(int64_t capacity, int64_t nvm_tier_capacity, const std::string& id) {
   CacheType t;
+  bool tiered = false;
   ToUpperCase(FLAGS_block_cache_type, &FLAGS_block_cache_type);
   if (FLAGS_block_cache_type == "NVM") {
     t = NVM_CACHE;
   } else if (FLAGS_block_cache_type == "DRAM") {
     t = DRAM_CACHE;
+  } else if (FLAGS_block_cache_type == "TIERED") {
+    // The eviction policy applies to the DRAM tier.
+    t = DRAM_CACHE;
+    tiered = true;
   } else {
     LOG(FATAL) << "Unknown block cache type: '" << FLAGS_block_cache_type
-               << "' (expected 'DRAM' or 'NVM')";
+               << "' (expected 'DRAM', 'NVM' or 'TIERED')";
+  }
+  CacheEvictionPolicy policy;
+  ToUpperCase(FLAGS_block_cache_eviction_policy, &FLAGS_block_cache_eviction_policy);
+  if (FLAGS_block_cache_eviction_policy == "LRU") {
+    policy = CacheEvictionPolicy::LRU;
+  } else if (FLAGS_block_cache_eviction_policy == "SLRU") {
+    if (t != DRAM_CACHE) {
+      LOG(FATAL) << "The 'SLRU' block cache eviction policy requires the 'DRAM' "
+                 << "block cache type";
+    }
+    policy = CacheEvictionPolicy::SLRU;
+  } else {
+    LOG(FATAL) << "Unknown block cache eviction policy: '"
+               << FLAGS_block_cache_eviction_policy << "' (expected 'LRU' or 'SLRU')";
   }
-  return NewLRUCache(t, capacity, "block_cache");
+  if (tiered) {
+#if defined(__APPLE__)
+    LOG(FATAL) << "The 'TIERED' block cache type is not supported on this platform";
+#else
+    if (nvm_tier_capacity <= 0) {
+      LOG(FATAL) << "The 'TIERED' block cache type requires a positive "
+                 << "--block_cache_nvm_tier_capacity_mb";
+    }
+    return NewTieredCache(policy, capacity, nvm_tier_capacity, id);
+#endif
+  }
+  return NewCache(t, policy, capacity, id);
 }
 
 } // anonymous namespace
@@ -63,34 +244,153 @@ BlockCache::BlockCache()
   : BlockCache(FLAGS_block_cache_capacity_mb * 1024 * 1024) {
 }
 
-BlockCache::BlockCache(size_t capacity)
-  : cache_(CreateCache(capacity)) {
+BlockCache::BlockCache(size_t capacity) {
+  size_t high_priority_capacity = capacity * FLAGS_block_cache_high_priority_ratio;
+  // The high priority share of a tiered cache includes both tiers.
+  int64_t nvm_tier_capacity = FLAGS_block_cache_nvm_tier_capacity_mb * 1024 * 1024;
+  int64_t high_priority_nvm_tier_capacity = high_priority_capacity > 0 ?
+      nvm_tier_capacity * FLAGS_block_cache_high_priority_ratio : 0;
+  if (high_priority_capacity > 0) {
+    high_priority_cache_.reset(CreateCache(high_priority_capacity,
+                                           high_priority_nvm_tier_capacity,
+                                           "block_cache_high_priority"));
+  }
+  cache_.reset(CreateCache(capacity - high_priority_capacity,
+                           nvm_tier_capacity - high_priority_nvm_tier_capacity,
+                           "block_cache"));
+  if (FLAGS_block_cache_compressed_capacity_mb > 0) {
+    compressed_cache_.reset(NewLRUCache(DRAM_CACHE,
+                                        FLAGS_block_cache_compressed_capacity_mb * 1024 * 1024,
+                                        "block_cache_compressed"));
+  }
 }
 
-BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t val_size) {
+BlockCache::~BlockCache() {
+}
+
+BlockCache::PendingEntry BlockCache::Allocate(const CacheKey& key, size_t val_size,
+                                              Priority priority) {
   Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
   int charge = val_size;
-  return PendingEntry(cache_.get(), cache_->Allocate(key_slice, val_size, charge));
+  Cache* cache = cache_for(priority);
+  return PendingEntry(cache, cache->Allocate(key_slice, val_size, charge), priority);
 }
 
 bool BlockCache::Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-                        BlockCacheHandle *handle) {
-  Cache::Handle *h = cache_->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key),
-                                          sizeof(key)), behavior);
+                        BlockCacheHandle *handle, Priority priority) {
+  Cache* cache = cache_for(priority);
+  Cache::Handle *h = cache->Lookup(Slice(reinterpret_cast<const uint8_t*>(&key),
+                                         sizeof(key)), behavior);
+  if (h != nullptr) {
+    handle->SetHandle(cache, h);
+  }
+  const TierMetrics& metrics = tier_metrics_[priority];
+  if (metrics.hits) {
+    if (h != nullptr) {
+      metrics.hits->Increment();
+    } else {
+      metrics.misses->Increment();
+    }
+  }
+  return h != nullptr;
+}
+
+void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted,
+                        BlockCacheAttribution* attribution, bool cold) {
+  // The entry was allocated from the cache for its priority.
+  Cache* cache = entry->cache_;
+  Cache::Handle *h = cold ? cache->InsertCold(entry->handle_, attribution) :
+                            cache->Insert(entry->handle_, attribution);
+  entry->handle_ = nullptr;
+  if (attribution) {
+    // 'h' keeps the entry from being freed, and so the eviction callback from
+    // being called, until after this.
+    attribution->RecordInsert(cache->Value(h).size());
+  }
+  inserted->SetHandle(cache, h);
+  if (tier_metrics_[entry->priority_].inserts) {
+    tier_metrics_[entry->priority_].inserts->Increment();
+  }
+}
+
+void BlockCache::GetHotBlocks(size_t max_blocks, std::vector<HotBlock>* blocks) const {
+  const size_t limit = blocks->size() + max_blocks;
+  std::vector<std::string> keys;
+  for (Priority priority : { HIGH_PRIORITY, NORMAL_PRIORITY }) {
+    // Without a reserve, high priority blocks share the normal cache.
+    if (priority == HIGH_PRIORITY && !high_priority_cache_) {
+      continue;
+    }
+    keys.clear();
+    cache_for(priority)->GetHotKeys(limit - blocks->size(), &keys);
+    for (const std::string& k : keys) {
+      DCHECK_EQ(sizeof(CacheKey), k.size());
+      CacheKey key(BlockId(0), 0);
+      memcpy(&key, k.data(), sizeof(key));
+      blocks->push_back({ key, priority });
+    }
+  }
+}
+
+bool BlockCache::LookupCompressed(const CacheKey& key, Cache::CacheBehavior behavior,
+                                  BlockCacheHandle* handle) {
+  DCHECK(compressed_cache_);
+  Cache::Handle* h = compressed_cache_->Lookup(
+      Slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key)), behavior);
   if (h != nullptr) {
-    handle->SetHandle(cache_.get(), h);
+    handle->SetHandle(compressed_cache_.get(), h);
+  }
+  if (compressed_metrics_.hits) {
+    if (h != nullptr) {
+      compressed_metrics_.hits->Increment();
+    } else {
+      compressed_metrics_.misses->Increment();
+    }
   }
   return h != nullptr;
 }
 
-void BlockCache::Insert(BlockCache::PendingEntry* entry, BlockCacheHandle* inserted) {
-  Cache::Handle *h = cache_->Insert(entry->handle_, /* eviction_callback= */ nullptr);
+BlockCache::PendingEntry BlockCache::AllocateCompressed(const CacheKey& key,
+                                                        size_t block_size) {
+  DCHECK(compressed_cache_);
+  Slice key_slice(reinterpret_cast<const uint8_t*>(&key), sizeof(key));
+  int charge = block_size;
+  return PendingEntry(compressed_cache_.get(),
+                      compressed_cache_->Allocate(key_slice, block_size, charge));
+}
+
+void BlockCache::InsertCompressed(PendingEntry* entry, BlockCacheHandle* inserted) {
+  DCHECK_EQ(compressed_cache_.get(), entry->cache_);
+  Cache::Handle* h = compressed_cache_->Insert(entry->handle_, nullptr);
   entry->handle_ = nullptr;
-  inserted->SetHandle(cache_.get(), h);
+  inserted->SetHandle(compressed_cache_.get(), h);
+  if (compressed_metrics_.inserts) {
+    compressed_metrics_.inserts->Increment();
+  }
 }
 
 void BlockCache::StartInstrumentation(const scoped_refptr<MetricEntity>& metric_entity) {
+  // Both caches instantiate the same block_cache_* metrics, which therefore
+  // cover the whole block cache.
   cache_->SetMetrics(metric_entity);
+  if (high_priority_cache_) {
+    high_priority_cache_->SetMetrics(metric_entity);
+  }
+  TierMetrics* high = &tier_metrics_[HIGH_PRIORITY];
+  high->hits = METRIC_block_cache_high_priority_hits.Instantiate(metric_entity);
+  high->misses = METRIC_block_cache_high_priority_misses.Instantiate(metric_entity);
+  high->inserts = METRIC_block_cache_high_priority_inserts.Instantiate(metric_entity);
+  TierMetrics* normal = &tier_metrics_[NORMAL_PRIORITY];
+  normal->hits = METRIC_block_cache_normal_priority_hits.Instantiate(metric_entity);
+  normal->misses = METRIC_block_cache_normal_priority_misses.Instantiate(metric_entity);
+  normal->inserts = METRIC_block_cache_normal_priority_inserts.Instantiate(metric_entity);
+  // The cache of compressed blocks keeps metrics of its own, so that the
+  // block_cache_* metrics keep describing the cache of decompressed blocks.
+  if (compressed_cache_) {
+    compressed_metrics_.hits = METRIC_block_cache_compressed_hits.Instantiate(metric_entity);
+    compressed_metrics_.misses = METRIC_block_cache_compressed_misses.Instantiate(metric_entity);
+    compressed_metrics_.inserts = METRIC_block_cache_compressed_inserts.Instantiate(metric_entity);
+  }
 }
 
 } // namespace cfile
@@ -19,10 +19,12 @@
 
 #include <algorithm>
 #include <glog/logging.h>
+#include <vector>
 
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/singleton.h"
 #include "kudu/util/cache.h"
 
@@ -30,12 +32,54 @@ DECLARE_string(block_cache_type);
 
 namespace kudu {
 
+template<class T>
+class AtomicGauge;
+class Counter;
+class MetricEntity;
 class MetricRegistry;
 
 namespace cfile {
 
 class BlockCacheHandle;
 
+// Block cache statistics for a subset of the cached blocks, typically those
+// of one tablet. They are exposed as metrics of the given entity.
+//
+// Blocks inserted with an attribution hold a reference to it until they are
+// evicted, so that their resident bytes can be accounted for after the
+// tablet is gone.
+class BlockCacheAttribution : public RefCountedThreadSafe<BlockCacheAttribution>,
+                              public Cache::EvictionCallback {
+ public:
+  explicit BlockCacheAttribution(const scoped_refptr<MetricEntity>& metric_entity);
+
+  // Record a lookup of one of the blocks.
+  void RecordLookup(bool hit);
+
+  int64_t hits() const;
+  int64_t misses() const;
+  int64_t inserted_bytes() const;
+  uint64_t resident_bytes() const;
+
+ private:
+  friend class BlockCache;
+  friend class RefCountedThreadSafe<BlockCacheAttribution>;
+  ~BlockCacheAttribution();
+
+  // Called by BlockCache when a block of 'size' bytes is inserted with this
+  // attribution.
+  void RecordInsert(size_t size);
+
+  virtual void EvictedEntry(Slice key, Slice value) OVERRIDE;
+
+  scoped_refptr<Counter> hits_;
+  scoped_refptr<Counter> misses_;
+  scoped_refptr<Counter> inserted_bytes_;
+  scoped_refptr<AtomicGauge<uint64_t>> resident_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockCacheAttribution);
+};
+
 // Wrapper around kudu::Cache specifically for caching blocks of CFiles.
 // Provides a singleton and LRU cache for CFile blocks.
 class BlockCache {
@@ -45,6 +89,15 @@ class BlockCache {
   // which is just a portion of a CFile.
   typedef BlockId FileId;
 
+  // Blocks which are needed by many lookups, such as index and bloom filter
+  // blocks, are cached with high priority. If --block_cache_high_priority_ratio
+  // is non-zero, that share of the capacity is reserved for them, so that they
+  // cannot be evicted by data blocks.
+  enum Priority {
+    NORMAL_PRIORITY,
+    HIGH_PRIORITY
+  };
+
   // The unique key identifying entries in the block cache.
   // Each cached block corresponds to a specific offset within
   // a file (called a "block" in other parts of Kudu).
@@ -69,9 +122,10 @@ class BlockCache {
   // cache insertion path.
   class PendingEntry {
    public:
-    PendingEntry() : cache_(nullptr), handle_(nullptr) {}
-    PendingEntry(Cache* cache, Cache::PendingHandle* handle)
-        : cache_(cache), handle_(handle) {
+    PendingEntry() : cache_(nullptr), handle_(nullptr), priority_(NORMAL_PRIORITY) {}
+    PendingEntry(Cache* cache, Cache::PendingHandle* handle,
+                 Priority priority = NORMAL_PRIORITY)
+        : cache_(cache), handle_(handle), priority_(priority) {
     }
     PendingEntry(PendingEntry&& other) : PendingEntry() {
       *this = std::move(other);
@@ -103,6 +157,7 @@ class BlockCache {
 
     Cache* cache_;
     Cache::PendingHandle* handle_;
+    Priority priority_;
   };
 
   static BlockCache *GetSingleton() {
@@ -110,6 +165,7 @@ class BlockCache {
   }
 
   explicit BlockCache(size_t capacity);
+  ~BlockCache();
 
   // Lookup the given block in the cache.
   //
@@ -118,8 +174,10 @@ class BlockCache {
   // Alternatively,  handle->Release() may be used to explicitly release it.
   //
   // Returns true to indicate that the entry was found, false otherwise.
+  //
+  // 'priority' must match the priority the block was inserted with.
   bool Lookup(const CacheKey& key, Cache::CacheBehavior behavior,
-              BlockCacheHandle* handle);
+              BlockCacheHandle* handle, Priority priority = NORMAL_PRIORITY);
 
   // Pass a metric entity to the cache to start recording metrics.
   // This should be called before the block cache starts serving blocks.
@@ -145,20 +203,91 @@ class BlockCache {
   //   BlockCacheHandle bch;
   //   cache->Insert(&entry, &bch);
 
-  // Allocate a new entry to be inserted into the cache.
-  PendingEntry Allocate(const CacheKey& key, size_t block_size);
+  // Allocate a new entry to be inserted into the cache with the given priority.
+  PendingEntry Allocate(const CacheKey& key, size_t block_size,
+                        Priority priority = NORMAL_PRIORITY);
 
   // Insert the given block into the cache. 'inserted' is set to refer to the
   // entry in the cache.
-  void Insert(PendingEntry* entry, BlockCacheHandle* inserted);
+  //
+  // If 'attribution' is not null, the block is accounted for in it.
+  //
+  // If 'cold' is true, the block is inserted as the next one to evict, for
+  // blocks which are unlikely to be read again, such as the data blocks of a
+  // large scan. It's only kept if it is read again before being evicted.
+  void Insert(PendingEntry* entry, BlockCacheHandle* inserted,
+              BlockCacheAttribution* attribution = nullptr, bool cold = false);
+
+  // A recently used block, as returned by GetHotBlocks().
+  struct HotBlock {
+    CacheKey key;
+    Priority priority;
+  };
+
+  // Append up to 'max_blocks' of the most recently used blocks to 'blocks',
+  // high priority blocks first. This is a best-effort snapshot: blocks of
+  // caches which can't enumerate their entries (e.g. NVM) are not included.
+  void GetHotBlocks(size_t max_blocks, std::vector<HotBlock>* blocks) const;
+
+  // Compressed blocks
+  // --------------------
+  // If --block_cache_compressed_capacity_mb is positive, a separate cache
+  // holds blocks of compressed CFiles as they are stored on disk. Compressed
+  // blocks take several times less space than decompressed ones, so this
+  // cache covers more data per byte; a hit saves the disk read but not the
+  // decompression. It is sized separately from the cache of decompressed
+  // blocks, and is used in the same way.
+
+  // Return true if there is a cache of compressed blocks.
+  bool has_compressed_cache() const {
+    return compressed_cache_ != nullptr;
+  }
+
+  // Like Lookup(), but for the cache of compressed blocks.
+  bool LookupCompressed(const CacheKey& key, Cache::CacheBehavior behavior,
+                        BlockCacheHandle* handle);
+
+  // Like Allocate(), but for the cache of compressed blocks.
+  // Requires has_compressed_cache().
+  PendingEntry AllocateCompressed(const CacheKey& key, size_t block_size);
+
+  // Like Insert(), for an entry returned by AllocateCompressed().
+  void InsertCompressed(PendingEntry* entry, BlockCacheHandle* inserted);
 
  private:
   friend class Singleton<BlockCache>;
   BlockCache();
 
+  // Metrics kept separately for each priority, on top of the metrics of the
+  // underlying caches.
+  struct TierMetrics {
+    scoped_refptr<Counter> hits;
+    scoped_refptr<Counter> misses;
+    scoped_refptr<Counter> inserts;
+  };
+
+  Cache* cache_for(Priority priority) const {
+    return priority == HIGH_PRIORITY && high_priority_cache_ ?
+        high_priority_cache_.get() : cache_.get();
+  }
+
   DISALLOW_COPY_AND_ASSIGN(BlockCache);
 
   gscoped_ptr<Cache> cache_;
+
+  // Holds the high priority blocks if part of the capacity is reserved for
+  // them, otherwise null.
+  gscoped_ptr<Cache> high_priority_cache_;
+
+  // Indexed by Priority. Unset until StartInstrumentation() is called.
+  TierMetrics tier_metrics_[2];
+
+  // Holds compressed blocks if --block_cache_compressed_capacity_mb is
+  // positive, otherwise null.
+  gscoped_ptr<Cache> compressed_cache_;
+
+  // Unset until StartInstrumentation() is called.
+  TierMetrics compressed_metrics_;
 };
 
 // Scoped reference to a block from the block cache.
@@ -220,6 +349,7 @@ inline BlockCache::PendingEntry& BlockCache::PendingEntry::operator=(
   reset();
   cache_ = other.cache_;
   handle_ = other.handle_;
+  priority_ = other.priority_;
   other.cache_ = nullptr;
   other.handle_ = nullptr;
   return *this;
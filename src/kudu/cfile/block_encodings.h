@@ -47,6 +47,12 @@ class BlockBuilder {
     return Status::OK();
   }
 
+  // Return an estimate of the number of bytes AppendExtraInfo() would append
+  // given the values added so far.
+  virtual size_t EstimateExtraInfoSize() const {
+    return 0;
+  }
+
   // Used by the cfile writer to determine whether the current block is full.
   // A block is full if it its estimated size is larger than the configured
   // WriterOptions' cfile_block_size.
@@ -171,6 +177,33 @@ class BlockDecoder {
     return Status::OK();
   }
 
+  // Like CopyNextValues(), but the values of the rows which are unselected in
+  // 'sel' need not be copied, leaving their cells in 'dst' unspecified. 'sel'
+  // must be positioned at the same row as 'dst'.
+  //
+  // Decoders which can't seek within the block cheaply copy every value.
+  virtual Status CopyNextSelectedValues(size_t* n,
+                                        const SelectionVectorView& sel,
+                                        ColumnDataView* dst) {
+    return CopyNextValues(n, dst);
+  }
+
+  // Whether ReferenceNextValues() is supported, i.e. whether the values are
+  // stored in the block exactly as CopyNextValues() would copy them out.
+  virtual bool SupportsReferenceNextValues() const {
+    return false;
+  }
+
+  // Like CopyNextValues(), but instead of copying them, sets '*data' to point
+  // at the next values within the block's own memory. The pointer is valid
+  // for as long as the block's data is.
+  //
+  // Modifies *n to contain the number of values fetched. Only supported if
+  // SupportsReferenceNextValues() returns true.
+  virtual Status ReferenceNextValues(size_t* n, const uint8_t** data) {
+    return Status::NotSupported("decoder does not support referencing values");
+  }
+
   // Return true if there are more values remaining to be iterated.
   // (i.e that the next call to CopyNextValues will return at least 1
   // element)
@@ -190,6 +223,51 @@ class BlockDecoder {
   virtual rowid_t GetFirstRowId() const = 0;
 
   virtual ~BlockDecoder() {}
+
+ protected:
+  // Shorter runs of unselected rows are copied along with their neighbors,
+  // since seeking past them costs more than it saves.
+  static const size_t kMinSkippedRun = 16;
+
+  // Implements CopyNextSelectedValues() by seeking past the long runs of
+  // unselected rows. For decoders where SeekToPositionInBlock() is cheap.
+  Status CopyNextSelectedValuesBySeeking(size_t* n,
+                                         const SelectionVectorView& sel,
+                                         ColumnDataView* dst) {
+    size_t requested = std::min(*n, Count() - GetCurrentIndex());
+    ColumnDataView remaining_dst(*dst);
+    size_t done = 0;
+    while (done < requested) {
+      // Find the next run of unselected rows worth skipping, copying the
+      // values up to it.
+      size_t copy_end = done;
+      size_t skip = 0;
+      while (copy_end < requested) {
+        bool selected;
+        size_t run = sel.GetRun(copy_end, requested - copy_end, &selected);
+        if (!selected && run >= kMinSkippedRun) {
+          skip = run;
+          break;
+        }
+        copy_end += run;
+      }
+      if (copy_end > done) {
+        size_t this_batch = copy_end - done;
+        RETURN_NOT_OK(CopyNextValues(&this_batch, &remaining_dst));
+        DCHECK_EQ(copy_end - done, this_batch);
+        remaining_dst.Advance(this_batch);
+        done = copy_end;
+      }
+      if (skip > 0) {
+        SeekToPositionInBlock(GetCurrentIndex() + skip);
+        remaining_dst.Advance(skip);
+        done += skip;
+      }
+    }
+    *n = done;
+    return Status::OK();
+  }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(BlockDecoder);
 };
@@ -27,11 +27,16 @@ namespace cfile {
 // When blocks are read, they are sometimes resident in the block cache, and sometimes skip the
 // block cache. In the case that they came from the cache, we just need to dereference them when
 // they stop being used. In the case that they didn't come from cache, we need to actually free
-// the underlying data.
+// the underlying data, unless it is owned by someone else (e.g. a memory mapped block).
 class BlockHandle {
  public:
   static BlockHandle WithOwnedData(const Slice& data) {
-    return BlockHandle(data);
+    return BlockHandle(data, true);
+  }
+
+  // 'data' must outlive the handle.
+  static BlockHandle WithUnownedData(const Slice& data) {
+    return BlockHandle(data, false);
   }
 
   static BlockHandle WithDataFromCache(BlockCacheHandle *handle) {
@@ -56,10 +61,10 @@ class BlockHandle {
   }
 
   Slice data() const {
-    if (is_data_owner_) {
-      return data_;
-    } else {
+    if (dblk_data_.valid()) {
       return dblk_data_.data();
+    } else {
+      return data_;
     }
   }
 
@@ -68,9 +73,9 @@ class BlockHandle {
   Slice data_;
   bool is_data_owner_;
 
-  explicit BlockHandle(Slice data)
+  BlockHandle(Slice data, bool is_data_owner)
       : data_(std::move(data)),
-        is_data_owner_(true) {
+        is_data_owner_(is_data_owner) {
   }
 
   explicit BlockHandle(BlockCacheHandle *dblk_data)
@@ -82,12 +87,10 @@ class BlockHandle {
     Reset();
 
     is_data_owner_ = other->is_data_owner_;
-    if (is_data_owner_) {
-      data_ = other->data_;
-      other->is_data_owner_ = false;
-    } else {
-      dblk_data_.swap(&other->dblk_data_);
-    }
+    data_ = other->data_;
+    other->is_data_owner_ = false;
+    other->data_ = "";
+    dblk_data_.swap(&other->dblk_data_);
   }
 
   void Reset() {
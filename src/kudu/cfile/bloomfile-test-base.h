@@ -36,6 +36,7 @@ DEFINE_double(fp_rate, 0.01f, "False positive rate to aim for");
 
 DEFINE_int64(benchmark_queries, 1000000, "Number of probes to benchmark");
 DEFINE_bool(benchmark_should_hit, false, "Set to true for the benchmark to query rows which match");
+DEFINE_bool(blocked_bloom, false, "Whether to write the bloom filters with the blocked layout");
 
 namespace kudu {
 namespace cfile {
@@ -69,14 +70,19 @@ class BloomFileTestBase : public KuduTest {
     }
   }
 
+  BloomFilterSizing TestSizing() const {
+    return BloomFilterSizing::BySizeAndFPRate(FLAGS_bloom_size_bytes, FLAGS_fp_rate)
+        .WithLayout(FLAGS_blocked_bloom ? BloomFilterLayout::kBlocked
+                                        : BloomFilterLayout::kSpread);
+  }
+
   void WriteTestBloomFile() {
     gscoped_ptr<WritableBlock> sink;
     ASSERT_OK(fs_manager_->CreateNewBlock(&sink));
     block_id_ = sink->id();
 
     // Set sizing based on flags
-    BloomFilterSizing sizing = BloomFilterSizing::BySizeAndFPRate(
-      FLAGS_bloom_size_bytes, FLAGS_fp_rate);
+    BloomFilterSizing sizing = TestSizing();
     ASSERT_NEAR(sizing.n_bytes(), FLAGS_bloom_size_bytes, FLAGS_bloom_size_bytes * 0.05);
     ASSERT_GT(FLAGS_n_keys, sizing.expected_count())
       << "Invalid parameters: --n_keys isn't set large enough to fill even "
@@ -15,10 +15,15 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
+#include <vector>
+
 #include "kudu/cfile/bloomfile-test-base.h"
 #include "kudu/fs/fs-test-util.h"
+#include "kudu/util/scoped_cleanup.h"
 
 using std::shared_ptr;
+using std::vector;
 
 namespace kudu {
 namespace cfile {
@@ -53,8 +58,9 @@ class BloomFileTest : public BloomFileTestBase {
     }
 
     double fp_rate = static_cast<double>(positive_count) / FLAGS_n_keys;
+    double expected_fp_rate = BloomFilterBuilder(TestSizing()).false_positive_rate();
     LOG(INFO) << "fp_rate: " << fp_rate << "(" << positive_count << "/" << FLAGS_n_keys << ")";
-    ASSERT_LT(fp_rate, FLAGS_fp_rate + FLAGS_fp_rate * 0.20f)
+    ASSERT_LT(fp_rate, expected_fp_rate + expected_fp_rate * 0.20f)
       << "Should be no more than 1.2x the expected FP rate";
   }
 };
@@ -66,6 +72,43 @@ TEST_F(BloomFileTest, TestWriteAndRead) {
   VerifyBloomFile();
 }
 
+TEST_F(BloomFileTest, TestWriteAndReadBlocked) {
+  FLAGS_blocked_bloom = true;
+  auto reset_layout = MakeScopedCleanup([]() { FLAGS_blocked_bloom = false; });
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+  ASSERT_NO_FATAL_FAILURE(VerifyBloomFile());
+}
+
+// Probing a sorted batch of keys should give the same answers as probing
+// them one at a time.
+TEST_F(BloomFileTest, TestCheckKeysPresent) {
+  ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
+  ASSERT_OK(OpenBloomFile());
+
+  // Every other key was inserted, and the last ones come past the end.
+  const int kNumProbes = std::min<int>(FLAGS_n_keys * 2 + 10, 100000);
+  vector<uint64_t> keys(kNumProbes);
+  vector<BloomKeyProbe> probes(kNumProbes);
+  vector<const BloomKeyProbe*> probe_ptrs(kNumProbes);
+  for (int i = 0; i < kNumProbes; i++) {
+    keys[i] = BigEndian::FromHost64(static_cast<uint64_t>(i) << (kKeyShift - 1));
+    probes[i] = BloomKeyProbe(Slice(reinterpret_cast<const uint8_t*>(&keys[i]),
+                                    sizeof(keys[i])));
+    probe_ptrs[i] = &probes[i];
+  }
+  gscoped_array<bool> present(new bool[kNumProbes]);
+  ASSERT_OK(bfr_->CheckKeysPresent(probe_ptrs.data(), kNumProbes, present.get()));
+  for (int i = 0; i < kNumProbes; i++) {
+    bool expected;
+    ASSERT_OK(bfr_->CheckKeyPresent(probes[i], &expected));
+    ASSERT_EQ(expected, present[i]) << i;
+    if (i % 2 == 0 && i / 2 < FLAGS_n_keys) {
+      ASSERT_TRUE(present[i]) << i;
+    }
+  }
+}
+
 #ifdef NDEBUG
 TEST_F(BloomFileTest, Benchmark) {
   ASSERT_NO_FATAL_FAILURE(WriteTestBloomFile());
@@ -81,7 +124,8 @@ TEST_F(BloomFileTest, Benchmark) {
   if (FLAGS_benchmark_should_hit) {
     ASSERT_EQ(count_present, FLAGS_benchmark_queries);
   } else {
-    ASSERT_LT(hit_rate, FLAGS_fp_rate + FLAGS_fp_rate * 0.20f)
+    double expected_fp_rate = BloomFilterBuilder(TestSizing()).false_positive_rate();
+    ASSERT_LT(hit_rate, expected_fp_rate + expected_fp_rate * 0.20f)
       << "Should be no more than 1.2x the expected FP rate";
   }
 }
@@ -43,15 +43,22 @@ using fs::WritableBlock;
 ////////////////////////////////////////////////////////////
 
 BloomFileWriter::BloomFileWriter(gscoped_ptr<WritableBlock> block,
-                                 const BloomFilterSizing &sizing)
+                                 const BloomFilterSizing &sizing,
+                                 bool cache_written_blocks,
+                                 scoped_refptr<BlockCacheAttribution> block_cache_attribution)
   : bloom_builder_(sizing) {
   cfile::WriterOptions opts;
+  opts.cache_written_blocks = cache_written_blocks;
+  opts.block_cache_attribution = std::move(block_cache_attribution);
   opts.write_posidx = false;
   opts.write_validx = true;
   // Never use compression, regardless of the default settings, since
   // bloom filters are high-entropy data structures by their nature.
   opts.storage_attributes.encoding  = PLAIN_ENCODING;
   opts.storage_attributes.compression = NO_COMPRESSION;
+  if (sizing.layout() == BloomFilterLayout::kBlocked) {
+    opts.incompatible_features = CFileFooterPB::BLOCKED_BLOOM_FILTERS;
+  }
   writer_.reset(new cfile::CFileWriter(opts, GetTypeInfo(BINARY), false, std::move(block)));
 }
 
@@ -112,6 +119,9 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
   // Encode the header.
   BloomBlockHeaderPB hdr;
   hdr.set_num_hash_functions(bloom_builder_.n_hashes());
+  if (bloom_builder_.layout() == BloomFilterLayout::kBlocked) {
+    hdr.set_layout(BloomBlockHeaderPB::BLOCKED);
+  }
   faststring hdr_str;
   PutFixed32(&hdr_str, hdr.ByteSize());
   pb_util::AppendToString(hdr, &hdr_str);
@@ -124,7 +134,8 @@ Status BloomFileWriter::FinishCurrentBloomBlock() {
   // Append to the file.
   Slice start_key(first_key_);
   Slice last_key(last_key_);
-  RETURN_NOT_OK(writer_->AppendRawBlock(slices, 0, &start_key, last_key, "bloom block"));
+  RETURN_NOT_OK(writer_->AppendRawBlock(slices, 0, &start_key, last_key, "bloom block",
+                                        BlockCache::HIGH_PRIORITY));
 
   bloom_builder_.Clear();
 
@@ -236,33 +247,53 @@ Status BloomFileReader::ParseBlockHeader(const Slice &block,
   }
 
   data.remove_prefix(header_len);
+  if (hdr->layout() == BloomBlockHeaderPB::BLOCKED &&
+      (data.empty() || data.size() % BloomFilter::kBucketBytes != 0)) {
+    return Status::Corruption(
+        StringPrintf("Blocked bloom filter of %ld bytes is not made of %ld-byte buckets",
+                     data.size(), BloomFilter::kBucketBytes));
+  }
   *bloom_data = data;
   return Status::OK();
 }
 
-Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
-                                        bool *maybe_present) {
-  DCHECK(init_once_.initted());
+BloomFilterLayout BloomFileReader::LayoutFromPB(BloomBlockHeaderPB::Layout layout) {
+  switch (layout) {
+    case BloomBlockHeaderPB::BLOCKED:
+      return BloomFilterLayout::kBlocked;
+    case BloomBlockHeaderPB::SPREAD:
+      return BloomFilterLayout::kSpread;
+  }
+  LOG(FATAL) << "unknown bloom filter layout: " << layout;
+  return BloomFilterLayout::kSpread;
+}
 
+cfile::IndexTreeIterator* BloomFileReader::LockIndexIterator(
+    std::unique_lock<simple_spinlock>* lock) {
 #if defined(__linux__)
   int cpu = sched_getcpu();
 #else
   // Use just one lock if on OS X.
   int cpu = 0;
 #endif
+  while (true) {
+    std::unique_lock<simple_spinlock> l(iter_locks_[cpu], std::try_to_lock);
+    if (l.owns_lock()) {
+      lock->swap(l);
+      return index_iters_[cpu].get();
+    }
+    cpu = (cpu + 1) % index_iters_.size();
+  }
+}
+
+Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
+                                        bool *maybe_present) {
+  DCHECK(init_once_.initted());
+
   BlockPointer bblk_ptr;
   {
     std::unique_lock<simple_spinlock> lock;
-    while (true) {
-      std::unique_lock<simple_spinlock> l(iter_locks_[cpu], std::try_to_lock);
-      if (l.owns_lock()) {
-        lock.swap(l);
-        break;
-      }
-      cpu = (cpu + 1) % index_iters_.size();
-    }
-
-    cfile::IndexTreeIterator *index_iter = index_iters_[cpu].get();
+    cfile::IndexTreeIterator *index_iter = LockIndexIterator(&lock);
 
     Status s = index_iter->SeekAtOrBefore(probe.key());
     if (PREDICT_FALSE(s.IsNotFound())) {
@@ -277,7 +308,8 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
   }
 
   BlockHandle dblk_data;
-  RETURN_NOT_OK(reader_->ReadBlock(bblk_ptr, CFileReader::CACHE_BLOCK, &dblk_data));
+  RETURN_NOT_OK(reader_->ReadBlock(bblk_ptr, CFileReader::CACHE_BLOCK, &dblk_data,
+                                   BlockCache::HIGH_PRIORITY));
 
   // Parse the header in the block.
   BloomBlockHeaderPB hdr;
@@ -285,11 +317,65 @@ Status BloomFileReader::CheckKeyPresent(const BloomKeyProbe &probe,
   RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
 
   // Actually check the bloom filter.
-  BloomFilter bf(bloom_data, hdr.num_hash_functions());
+  BloomFilter bf(bloom_data, hdr.num_hash_functions(), LayoutFromPB(hdr.layout()));
   *maybe_present = bf.MayContainKey(probe);
   return Status::OK();
 }
 
+Status BloomFileReader::CheckKeysPresent(const BloomKeyProbe* const* probes, int num_probes,
+                                         bool* maybe_present) {
+  DCHECK(init_once_.initted());
+
+  // Find the bloom block of each key. A key which sorts before the first
+  // entry of the file is definitely not present, and is marked with an
+  // invalid (zero) offset.
+  std::vector<BlockPointer> bblk_ptrs(num_probes);
+  {
+    std::unique_lock<simple_spinlock> lock;
+    cfile::IndexTreeIterator *index_iter = LockIndexIterator(&lock);
+    for (int i = 0; i < num_probes; i++) {
+      DCHECK(i == 0 || probes[i - 1]->key().compare(probes[i]->key()) <= 0);
+      Status s = index_iter->SeekAtOrBefore(probes[i]->key());
+      if (PREDICT_FALSE(s.IsNotFound())) {
+        bblk_ptrs[i] = BlockPointer(0, 0);
+        continue;
+      }
+      RETURN_NOT_OK(s);
+      bblk_ptrs[i] = index_iter->GetCurrentBlockPointer();
+    }
+  }
+
+  // Keys are sorted, so those sharing a bloom block are consecutive.
+  int i = 0;
+  while (i < num_probes) {
+    if (bblk_ptrs[i].offset() == 0) {
+      maybe_present[i++] = false;
+      continue;
+    }
+    int run_end = i + 1;
+    while (run_end < num_probes && bblk_ptrs[run_end].offset() == bblk_ptrs[i].offset()) {
+      run_end++;
+    }
+
+    BlockHandle dblk_data;
+    RETURN_NOT_OK(reader_->ReadBlock(bblk_ptrs[i], CFileReader::CACHE_BLOCK, &dblk_data,
+                                     BlockCache::HIGH_PRIORITY));
+    BloomBlockHeaderPB hdr;
+    Slice bloom_data;
+    RETURN_NOT_OK(ParseBlockHeader(dblk_data.data(), &hdr, &bloom_data));
+    BloomFilter bf(bloom_data, hdr.num_hash_functions(), LayoutFromPB(hdr.layout()));
+
+    bf.Prefetch(*probes[i]);
+    for (; i < run_end; i++) {
+      if (i + 1 < run_end) {
+        bf.Prefetch(*probes[i + 1]);
+      }
+      maybe_present[i] = bf.MayContainKey(*probes[i]);
+    }
+  }
+  return Status::OK();
+}
+
 size_t BloomFileReader::memory_footprint_excluding_reader() const {
   size_t size = kudu_malloc_usable_size(this);
 
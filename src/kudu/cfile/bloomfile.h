@@ -18,6 +18,7 @@
 #define KUDU_CFILE_BLOOMFILE_H
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,7 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/once.h"
 #include "kudu/util/status.h"
@@ -35,8 +37,17 @@ namespace cfile {
 
 class BloomFileWriter {
  public:
+  // The filters are written with the layout of 'sizing'. Files with
+  // BloomFilterLayout::kBlocked filters can't be read by versions which
+  // don't know about that layout.
+  //
+  // If 'cache_written_blocks' is true, the blocks are inserted into the block
+  // cache as they are written, accounted for in 'block_cache_attribution' if
+  // it is not null. See WriterOptions::cache_written_blocks.
   BloomFileWriter(gscoped_ptr<fs::WritableBlock> block,
-                  const BloomFilterSizing &sizing);
+                  const BloomFilterSizing &sizing,
+                  bool cache_written_blocks = false,
+                  scoped_refptr<BlockCacheAttribution> block_cache_attribution = nullptr);
 
   Status Start();
   Status AppendKeys(const Slice *keys, size_t n_keys);
@@ -103,6 +114,15 @@ class BloomFileReader {
   Status CheckKeyPresent(const BloomKeyProbe &probe,
                          bool *maybe_present);
 
+  // Like CheckKeyPresent(), for each of the 'num_probes' keys in 'probes',
+  // which must be in ascending order, setting maybe_present[i] for probes[i].
+  //
+  // The bloom blocks are located with a single index iterator. Each block is
+  // then read and parsed once for the run of keys it covers, and the bitmap
+  // reads for the next key are prefetched while the current one is tested.
+  Status CheckKeysPresent(const BloomKeyProbe* const* probes, int num_probes,
+                          bool* maybe_present);
+
  private:
   DISALLOW_COPY_AND_ASSIGN(BloomFileReader);
 
@@ -117,6 +137,12 @@ class BloomFileReader {
                           BloomBlockHeaderPB *hdr,
                           Slice *bloom_data) const;
 
+  static BloomFilterLayout LayoutFromPB(BloomBlockHeaderPB::Layout layout);
+
+  // Lock one of the index iterators, preferably the current CPU's, into
+  // 'lock' and return it.
+  cfile::IndexTreeIterator* LockIndexIterator(std::unique_lock<simple_spinlock>* lock);
+
   // Callback used in 'init_once_' to initialize this bloom file.
   Status InitOnce();
 
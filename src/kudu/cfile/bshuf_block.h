@@ -17,7 +17,7 @@
 //
 // Make use of bitshuffle and lz4 to encode the fixed size
 // type blocks, such as UINT8, INT8, UINT16, INT16,
-//                      UINT32, INT32, FLOAT, DOUBLE.
+//                      UINT32, INT32, FLOAT, DOUBLE, INT128.
 // Reference:
 // https://github.com/kiyo-masui/bitshuffle.git
 #ifndef KUDU_CFILE_BSHUF_BLOCK_H
@@ -252,6 +252,7 @@ class BShufBlockDecoder final : public BlockDecoder {
       case 2:
       case 4:
       case 8:
+      case 16:
         break;
       default:
         return Status::Corruption(strings::Substitute("invalid size_of_elem: $0", size_of_elem_));
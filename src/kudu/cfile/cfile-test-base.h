@@ -338,7 +338,12 @@ class CFileTestBase : public KuduTest {
   enum Flags {
     NO_FLAGS = 0,
     WRITE_VALIDX = 1,
-    SMALL_BLOCKSIZE = 1 << 1
+    SMALL_BLOCKSIZE = 1 << 1,
+    WRITE_BLOCK_STATS = 1 << 2,
+    WRITE_VALUE_BLOOM = 1 << 3,
+    CACHE_WRITTEN_BLOCKS = 1 << 4,
+    WRITE_SECONDARY_INDEX = 1 << 5,
+    WRITE_COLUMN_STATS = 1 << 6
   };
 
   template<class DataGeneratorType>
@@ -361,6 +366,21 @@ class CFileTestBase : public KuduTest {
       // Use a smaller block size to exercise multi-level indexing.
       opts.storage_attributes.cfile_block_size = 1024;
     }
+    if (flags & WRITE_BLOCK_STATS) {
+      opts.write_block_stats = true;
+    }
+    if (flags & WRITE_VALUE_BLOOM) {
+      opts.write_value_bloom = true;
+    }
+    if (flags & CACHE_WRITTEN_BLOCKS) {
+      opts.cache_written_blocks = true;
+    }
+    if (flags & WRITE_SECONDARY_INDEX) {
+      opts.write_secondary_index = true;
+    }
+    if (flags & WRITE_COLUMN_STATS) {
+      opts.write_column_stats = true;
+    }
 
     opts.storage_attributes.encoding = encoding;
     opts.storage_attributes.compression = compression;
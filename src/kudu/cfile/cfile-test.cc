@@ -26,16 +26,29 @@
 #include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/index_block.h"
 #include "kudu/cfile/index_btree.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/column_statistics.h"
 #include "kudu/common/columnblock.h"
 #include "kudu/fs/fs-test-util.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/env.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/stopwatch.h"
 
+DECLARE_int64(block_cache_capacity_mb);
+DECLARE_int64(block_cache_compressed_capacity_mb);
 DECLARE_string(block_cache_type);
 DECLARE_string(cfile_do_on_finish);
+DECLARE_bool(cfile_zstd_train_dictionary);
+DECLARE_int32(cfile_zstd_dictionary_training_blocks);
+DECLARE_bool(cfile_adaptive_encoding);
+DECLARE_int32(cfile_adaptive_encoding_sample_cells);
+DECLARE_bool(cfile_write_checksums);
+DECLARE_int32(cfile_parallel_checksum_min_bytes);
+DECLARE_bool(block_manager_mmap_reads);
 
 #if defined(__linux__)
 DECLARE_string(nvm_cache_path);
@@ -43,10 +56,12 @@ DECLARE_bool(nvm_cache_simulate_allocation_failure);
 #endif
 
 METRIC_DECLARE_counter(block_cache_hits_caching);
+METRIC_DECLARE_counter(block_cache_compressed_hits);
 
 METRIC_DECLARE_entity(server);
 
 using std::shared_ptr;
+using strings::Substitute;
 
 namespace kudu {
 namespace cfile {
@@ -290,6 +305,99 @@ class TestCFile : public CFileTestBase {
   }
 #endif
 
+  // Scan a string file with only some rows selected, letting the iterator
+  // skip the others, and check the values of the selected rows.
+  template<bool HAS_NULLS>
+  void TestScanSkippingUnselected(EncodingType encoding) {
+    const int kNumRows = 10000;
+    StringDataGenerator<HAS_NULLS> generator("hello %zu");
+    BlockId block_id;
+    ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, encoding, NO_COMPRESSION, kNumRows,
+                                          SMALL_BLOCKSIZE, &block_id));
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+    ASSERT_OK(iter->SeekToOrdinal(0));
+
+    ScopedColumnBlock<STRING> cb(1000);
+    SelectionVector sel(cb.nrows());
+    const Slice kUntouched("untouched");
+    size_t row = 0;
+    while (iter->HasNext()) {
+      cb.arena()->Reset();
+      size_t n = cb.nrows();
+      ASSERT_OK(iter->PrepareBatch(&n));
+      // Select a dense range and some scattered rows.
+      sel.SetAllFalse();
+      for (size_t i = 0; i < n; i++) {
+        cb[i] = kUntouched;
+        if ((i >= 100 && i < 130) || i % 97 == 0) {
+          sel.SetRowSelected(i);
+        }
+      }
+      ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&cb, &sel);
+      ctx.set_skip_deselected_allowed(true);
+      ASSERT_OK(iter->Scan(&ctx));
+      ASSERT_OK(iter->FinishBatch());
+
+      for (size_t i = 0; i < n; i++) {
+        if (!sel.IsRowSelected(i)) {
+          continue;
+        }
+        size_t idx = row + i;
+        if (generator.TestValueShouldBeNull(idx)) {
+          ASSERT_TRUE(cb.is_null(i)) << idx;
+        } else {
+          ASSERT_FALSE(cb.is_null(i)) << idx;
+          ASSERT_EQ(StringPrintf("hello %zu", idx), cb[i].ToString());
+        }
+      }
+      // A long run of unselected non-null rows is skipped.
+      if (!HAS_NULLS && n > 500) {
+        ASSERT_EQ(kUntouched, cb[500]);
+      }
+      row += n;
+    }
+    ASSERT_EQ(kNumRows, row);
+  }
+
+  // Write a file using AUTO_ENCODING with the adaptive encoding selection
+  // enabled, and check that the encoding with the smallest sample won.
+  template<class DataGeneratorType>
+  void TestAdaptiveEncoding(DataGeneratorType* generator, int num_entries) {
+    FLAGS_cfile_adaptive_encoding = true;
+    FLAGS_cfile_adaptive_encoding_sample_cells = 1000;
+
+    BlockId block_id;
+    WriteTestFile(generator, AUTO_ENCODING, NO_COMPRESSION, num_entries, NO_FLAGS, &block_id);
+
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    const CFileFooterPB& footer = reader->footer();
+    ASSERT_TRUE(footer.has_encoding_selection());
+    const EncodingSelectionPB& selection = footer.encoding_selection();
+    ASSERT_EQ(std::min(num_entries, 1000), selection.num_sampled_cells());
+    ASSERT_EQ(TypeEncodingInfo::GetSupportedEncodings(
+        GetTypeInfo(DataGeneratorType::kDataType)).size(), selection.candidates_size());
+    int64_t min_size = selection.candidates(0).encoded_size();
+    int64_t selected_size = -1;
+    for (const auto& candidate : selection.candidates()) {
+      min_size = std::min(min_size, candidate.encoded_size());
+      if (candidate.encoding() == footer.encoding()) {
+        selected_size = candidate.encoded_size();
+      }
+    }
+    ASSERT_EQ(min_size, selected_size);
+
+    size_t count;
+    TimeReadFile(fs_manager_.get(), block_id, &count);
+    ASSERT_EQ(num_entries, count);
+  }
 };
 
 // Subclass of TestCFile which is parameterized on the block cache type.
@@ -743,11 +851,420 @@ TEST_P(TestCFileBothCacheTypes, TestDefaultColumnIter) {
   }
 }
 
+// Test that the per-block min/max statistics allow skipping exactly the rows
+// whose blocks cannot match a predicate.
+TEST_P(TestCFileBothCacheTypes, TestBlockStats) {
+  const int kNumRows = 10000;
+  UInt32DataGenerator<false> generator;
+  BlockId block_id;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                        SMALL_BLOCKSIZE | WRITE_BLOCK_STATS, &block_id));
+
+  gscoped_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  gscoped_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_TRUE(reader->has_block_stats());
+  gscoped_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+
+  // Row 'i' holds the value i * 10.
+  ColumnSchema col("c", UINT32);
+  uint32_t val = 50000;
+  ColumnPredicate eq = ColumnPredicate::Equality(col, &val);
+  bool can_skip;
+  ASSERT_OK(iter->CanSkipRows(eq, 0, 100, &can_skip));
+  ASSERT_TRUE(can_skip);
+  ASSERT_OK(iter->CanSkipRows(eq, 4990, 20, &can_skip));
+  ASSERT_FALSE(can_skip);
+  ASSERT_OK(iter->CanSkipRows(eq, 0, kNumRows, &can_skip));
+  ASSERT_FALSE(can_skip);
+
+  uint32_t beyond_max = kNumRows * 10;
+  ColumnPredicate range = ColumnPredicate::Range(col, &beyond_max, nullptr);
+  ASSERT_OK(iter->CanSkipRows(range, 0, kNumRows, &can_skip));
+  ASSERT_TRUE(can_skip);
+
+  ASSERT_OK(iter->CanSkipRows(ColumnPredicate::IsNotNull(col), 0, kNumRows, &can_skip));
+  ASSERT_FALSE(can_skip);
+
+  // Files written without statistics never skip.
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                        SMALL_BLOCKSIZE, &block_id));
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_FALSE(reader->has_block_stats());
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+  ASSERT_OK(iter->CanSkipRows(range, 0, kNumRows, &can_skip));
+  ASSERT_FALSE(can_skip);
+}
+
+// Test block statistics on a nullable column, where some blocks hold only nulls.
+TEST_P(TestCFileBothCacheTypes, TestBlockStatsWithNulls) {
+  const int kNumRows = 10000;
+  UInt32DataGenerator<true> generator;
+  BlockId block_id;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                        SMALL_BLOCKSIZE | WRITE_BLOCK_STATS, &block_id));
+
+  gscoped_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  gscoped_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  gscoped_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+
+  // Row 5060 is not null.
+  ColumnSchema col("c", UINT32, true);
+  uint32_t val = 50600;
+  bool can_skip;
+  ASSERT_OK(iter->CanSkipRows(ColumnPredicate::Equality(col, &val), 0, 100, &can_skip));
+  ASSERT_TRUE(can_skip);
+  ASSERT_OK(iter->CanSkipRows(ColumnPredicate::Equality(col, &val), 5050, 20, &can_skip));
+  ASSERT_FALSE(can_skip);
+
+  // Null values are not reflected by the statistics, so IS NULL never skips.
+  ASSERT_OK(iter->CanSkipRows(ColumnPredicate::IsNull(col), 0, kNumRows, &can_skip));
+  ASSERT_FALSE(can_skip);
+}
+
+// Test that the value bloom filters contain every written value and rule out
+// most others.
+TEST_P(TestCFileBothCacheTypes, TestValueBloom) {
+  const int kNumRows = 10000;
+  BlockId block_id;
+  gscoped_ptr<ReadableBlock> block;
+  gscoped_ptr<CFileReader> reader;
+  {
+    // Row 'i' holds the value i * 10.
+    UInt32DataGenerator<false> generator;
+    ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                          WRITE_VALUE_BLOOM, &block_id));
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    ASSERT_TRUE(reader->has_value_bloom());
+
+    int false_positives = 0;
+    for (uint32_t i = 0; i < kNumRows; i++) {
+      bool present;
+      uint32_t val = i * 10;
+      ASSERT_OK(reader->CheckValueMayBePresent(&val, &present));
+      ASSERT_TRUE(present) << val;
+      val = i * 10 + 5;
+      ASSERT_OK(reader->CheckValueMayBePresent(&val, &present));
+      false_positives += present;
+    }
+    ASSERT_LT(false_positives, kNumRows / 10);
+  }
+
+  {
+    StringDataGenerator<true> generator("hello %04d");
+    ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PREFIX_ENCODING, NO_COMPRESSION, kNumRows,
+                                          WRITE_VALUE_BLOOM, &block_id));
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    ASSERT_TRUE(reader->has_value_bloom());
+
+    bool present;
+    // Row 70 is not null.
+    Slice val("hello 0070");
+    ASSERT_OK(reader->CheckValueMayBePresent(&val, &present));
+    ASSERT_TRUE(present);
+    val = "goodbye";
+    ASSERT_OK(reader->CheckValueMayBePresent(&val, &present));
+    ASSERT_FALSE(present);
+  }
+
+  // Files written without bloom filters don't have them.
+  UInt32DataGenerator<false> generator;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                        NO_FLAGS, &block_id));
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_FALSE(reader->has_value_bloom());
+}
+
+// Test that lookups in the secondary index return the ordinals of exactly the
+// rows matching the predicate.
+TEST_P(TestCFileBothCacheTypes, TestSecondaryIndex) {
+  const int kNumRows = 10000;
+  BlockId block_id;
+  gscoped_ptr<ReadableBlock> block;
+  gscoped_ptr<CFileReader> reader;
+  vector<rowid_t> rowids;
+  bool exceeded;
+  {
+    // Row 'i' holds the value i * 10. The index spans several blocks.
+    UInt32DataGenerator<false> generator;
+    ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                          WRITE_SECONDARY_INDEX, &block_id));
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    ASSERT_TRUE(reader->has_secondary_index());
+
+    ColumnSchema col("c", UINT32);
+    uint32_t val = 50000;
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Equality(col, &val), kNumRows,
+                                           &rowids, &exceeded));
+    ASSERT_FALSE(exceeded);
+    ASSERT_EQ(vector<rowid_t>({ 5000 }), rowids);
+
+    val = 5;
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Equality(col, &val), kNumRows,
+                                           &rowids, &exceeded));
+    ASSERT_TRUE(rowids.empty());
+
+    uint32_t lower = 1000;
+    uint32_t upper = 1035;
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Range(col, &lower, &upper),
+                                           kNumRows, &rowids, &exceeded));
+    ASSERT_EQ(vector<rowid_t>({ 100, 101, 102, 103 }), rowids);
+
+    lower = 99980;
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Range(col, &lower, nullptr),
+                                           kNumRows, &rowids, &exceeded));
+    ASSERT_EQ(vector<rowid_t>({ 9998, 9999 }), rowids);
+
+    upper = 30;
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Range(col, nullptr, &upper),
+                                           kNumRows, &rowids, &exceeded));
+    ASSERT_EQ(vector<rowid_t>({ 0, 1, 2 }), rowids);
+
+    uint32_t values[] = { 99990, 10, 55 };
+    vector<const void*> value_ptrs = { &values[0], &values[1], &values[2] };
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::InList(col, &value_ptrs),
+                                           kNumRows, &rowids, &exceeded));
+    ASSERT_EQ(vector<rowid_t>({ 1, 9999 }), rowids);
+
+    // The lookup gives up once too many rows match.
+    lower = 0;
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Range(col, &lower, nullptr),
+                                           100, &rowids, &exceeded));
+    ASSERT_TRUE(exceeded);
+  }
+
+  {
+    StringDataGenerator<true> generator("hello %04d");
+    ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PREFIX_ENCODING, NO_COMPRESSION, kNumRows,
+                                          WRITE_SECONDARY_INDEX, &block_id));
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    ASSERT_TRUE(reader->has_secondary_index());
+
+    ColumnSchema col("c", STRING, true);
+    // Row 70 is not null, row 71 is.
+    Slice val("hello 0070");
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Equality(col, &val), kNumRows,
+                                           &rowids, &exceeded));
+    ASSERT_EQ(vector<rowid_t>({ 70 }), rowids);
+    val = "hello 0071";
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Equality(col, &val), kNumRows,
+                                           &rowids, &exceeded));
+    ASSERT_TRUE(rowids.empty());
+
+    Slice lower("hello 0128");
+    Slice upper("hello 0131");
+    ASSERT_OK(reader->SearchSecondaryIndex(ColumnPredicate::Range(col, &lower, &upper),
+                                           kNumRows, &rowids, &exceeded));
+    ASSERT_EQ(vector<rowid_t>({ 128, 129, 130 }), rowids);
+  }
+
+  // Files written without a secondary index don't have one.
+  UInt32DataGenerator<false> generator;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                        NO_FLAGS, &block_id));
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_FALSE(reader->has_secondary_index());
+}
+
+TEST_P(TestCFileBothCacheTypes, TestColumnStats) {
+  const int kNumRows = 10000;
+  BlockId block_id;
+  gscoped_ptr<ReadableBlock> block;
+  gscoped_ptr<CFileReader> reader;
+  {
+    // Row 'i' holds the value i * 10.
+    UInt32DataGenerator<false> generator;
+    ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                          WRITE_COLUMN_STATS, &block_id));
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    ASSERT_TRUE(reader->has_column_stats());
+
+    ColumnStatistics stats(GetTypeInfo(UINT32));
+    ASSERT_OK(reader->ReadColumnStats(&stats));
+    ASSERT_EQ(0, stats.null_count());
+    ASSERT_EQ(kNumRows, stats.non_null_count());
+    ASSERT_EQ(0U, UNALIGNED_LOAD32(stats.min_value().data()));
+    ASSERT_EQ(99990U, UNALIGNED_LOAD32(stats.max_value().data()));
+    ASSERT_NEAR(kNumRows, stats.EstimateDistinctCount(), kNumRows * 0.05);
+  }
+
+  {
+    StringDataGenerator<true> generator("hello %04d");
+    ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PREFIX_ENCODING, NO_COMPRESSION, kNumRows,
+                                          WRITE_COLUMN_STATS, &block_id));
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    ASSERT_TRUE(reader->has_column_stats());
+
+    ColumnStatistics stats(GetTypeInfo(STRING));
+    ASSERT_OK(reader->ReadColumnStats(&stats));
+    ASSERT_GT(stats.null_count(), 0);
+    ASSERT_GT(stats.non_null_count(), 0);
+    ASSERT_EQ(kNumRows, stats.null_count() + stats.non_null_count());
+    // The first and last 64 rows are null.
+    ASSERT_GE(stats.min_value().ToString(), "hello 0064");
+    ASSERT_LT(stats.min_value().ToString(), "hello 0128");
+    ASSERT_GE(stats.max_value().ToString(), "hello 9900");
+    ASSERT_LT(stats.max_value().ToString(), "hello 9984");
+    ASSERT_NEAR(stats.non_null_count(), stats.EstimateDistinctCount(),
+                stats.non_null_count() * 0.05);
+  }
+
+  // Files written without statistics don't have them.
+  UInt32DataGenerator<false> generator;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                        NO_FLAGS, &block_id));
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_FALSE(reader->has_column_stats());
+}
+
 TEST_P(TestCFileBothCacheTypes, TestAppendRaw) {
   TestReadWriteRawBlocks(NO_COMPRESSION, 1000);
   TestReadWriteRawBlocks(SNAPPY, 1000);
   TestReadWriteRawBlocks(LZ4, 1000);
   TestReadWriteRawBlocks(ZLIB, 1000);
+  TestReadWriteRawBlocks(ZSTD, 1000);
+}
+
+TEST_P(TestCFileBothCacheTypes, TestScanSkippingUnselected) {
+  for (EncodingType encoding : { PLAIN_ENCODING, DICT_ENCODING }) {
+    SCOPED_TRACE(EncodingType_Name(encoding));
+    TestScanSkippingUnselected<false>(encoding);
+    TestScanSkippingUnselected<true>(encoding);
+  }
+}
+
+TEST_P(TestCFileBothCacheTypes, TestAdaptiveEncoding) {
+  {
+    SCOPED_TRACE("ints");
+    UInt32DataGenerator<false> generator;
+    TestAdaptiveEncoding(&generator, 10000);
+  }
+  {
+    SCOPED_TRACE("nullable ints");
+    UInt32DataGenerator<true> generator;
+    TestAdaptiveEncoding(&generator, 10000);
+  }
+  {
+    SCOPED_TRACE("duplicate strings");
+    DuplicateStringDataGenerator<false> generator("hello %d", 4);
+    TestAdaptiveEncoding(&generator, 10000);
+  }
+  {
+    SCOPED_TRACE("short file");
+    StringDataGenerator<true> generator("hello %zu");
+    TestAdaptiveEncoding(&generator, 100);
+  }
+
+  // An explicitly configured encoding is used as is.
+  BlockId block_id;
+  UInt32DataGenerator<false> generator;
+  WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 10000, NO_FLAGS, &block_id);
+  gscoped_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  gscoped_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  ASSERT_EQ(PLAIN_ENCODING, reader->footer().encoding());
+  ASSERT_FALSE(reader->footer().has_encoding_selection());
+}
+
+// Write ZSTD files with a trained dictionary and make sure they read back.
+TEST_P(TestCFileBothCacheTypes, TestZstdDictionary) {
+  FLAGS_cfile_zstd_train_dictionary = true;
+  FLAGS_cfile_zstd_dictionary_training_blocks = 4;
+
+  for (int num_rows : { 10000, 1 }) {
+    SCOPED_TRACE(num_rows);
+    StringDataGenerator<false> generator([](size_t idx) {
+        return StringPrintf("{\"id\": %zu, \"name\": \"user_%zu\", \"active\": %s}",
+                            idx, idx % 101, (idx % 2) ? "true" : "false");
+      });
+    BlockId block_id;
+    WriteTestFile(&generator, PLAIN_ENCODING, ZSTD, num_rows, SMALL_BLOCKSIZE, &block_id);
+
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    // A single row isn't enough to train a dictionary; the file is then
+    // written without one.
+    bool has_dictionary = num_rows > 1;
+    ASSERT_EQ(has_dictionary, reader->footer().has_compression_dictionary_ptr());
+    ASSERT_EQ(has_dictionary, (reader->footer().incompatible_features() &
+                               CFileFooterPB::COMPRESSION_DICTIONARY) != 0);
+
+    size_t count;
+    TimeReadFile(fs_manager_.get(), block_id, &count);
+    ASSERT_EQ(num_rows, count);
+  }
+}
+
+TEST_P(TestCFileBothCacheTypes, TestChecksums) {
+  FLAGS_cfile_write_checksums = true;
+  const int kNumRows = 10000;
+  for (CompressionType compression : { NO_COMPRESSION, LZ4 }) {
+    // Compressed blocks are also verified in the background.
+    for (int parallel_min_bytes : { 512 * 1024, 0 }) {
+      SCOPED_TRACE(Substitute("$0 $1", CompressionType_Name(compression), parallel_min_bytes));
+      FLAGS_cfile_parallel_checksum_min_bytes = parallel_min_bytes;
+      Int32DataGenerator<false> generator;
+      BlockId block_id;
+      ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, compression, kNumRows,
+                                            SMALL_BLOCKSIZE, &block_id));
+      gscoped_ptr<ReadableBlock> block;
+      ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+      uint64_t size;
+      ASSERT_OK(block->Size(&size));
+      faststring contents;
+      contents.resize(size);
+      Slice slice;
+      ASSERT_OK(block->Read(0, size, &slice, contents.data()));
+      slice.relocate(contents.data());
+      gscoped_ptr<CFileReader> reader;
+      ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+      ASSERT_TRUE(reader->has_checksums());
+      size_t count;
+      TimeReadFile(fs_manager_.get(), block_id, &count);
+      ASSERT_EQ(kNumRows, count);
+
+      // Flip a bit of the first data block and copy the file.
+      gscoped_ptr<IndexTreeIterator> iter(
+          IndexTreeIterator::Create(reader.get(), reader->posidx_root()));
+      ASSERT_OK(iter->SeekToFirst());
+      BlockPointer ptr = iter->GetCurrentBlockPointer();
+      contents[ptr.offset() + ptr.size() / 2] ^= 1;
+      gscoped_ptr<WritableBlock> sink;
+      ASSERT_OK(fs_manager_->CreateNewBlock(&sink));
+      BlockId corrupt_id = sink->id();
+      ASSERT_OK(sink->Append(Slice(contents)));
+      ASSERT_OK(sink->Close());
+
+      // The corruption is detected whether or not the block is cached.
+      ASSERT_OK(fs_manager_->OpenBlock(corrupt_id, &block));
+      gscoped_ptr<CFileReader> corrupt_reader;
+      ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &corrupt_reader));
+      for (auto cache_control : { CFileReader::DONT_CACHE_BLOCK, CFileReader::CACHE_BLOCK }) {
+        BlockHandle handle;
+        Status s = corrupt_reader->ReadBlock(ptr, cache_control, &handle);
+        ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+        ASSERT_STR_CONTAINS(s.ToString(), "Checksum mismatch");
+      }
+    }
+  }
 }
 
 TEST_P(TestCFileBothCacheTypes, TestNullInts) {
@@ -898,6 +1415,301 @@ TEST_P(TestCFileBothCacheTypes, TestCacheKeysAreStable) {
   }
 }
 
+// Tests that the blocks inserted into the block cache by the writer are found
+// by readers, and hold what the readers would have read.
+TEST_F(TestCFile, TestCacheWrittenBlocks) {
+  Singleton<BlockCache>::UnsafeReset();
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache::GetSingleton()->StartInstrumentation(entity);
+
+  BlockId block_id;
+  {
+    const int nrows = 1000;
+    StringDataGenerator<false> generator("hello %04d");
+    WriteTestFile(&generator, PREFIX_ENCODING, LZ4, nrows,
+                  SMALL_BLOCKSIZE | WRITE_VALIDX | CACHE_WRITTEN_BLOCKS, &block_id);
+  }
+
+  // The first read already hits in the seek and in the ReadBlock(). After the
+  // cache is reset, the second read misses and reads the same data.
+  string first_read;
+  for (int i = 0; i < 2; i++) {
+    gscoped_ptr<ReadableBlock> source;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+
+    gscoped_ptr<IndexTreeIterator> iter;
+    iter.reset(IndexTreeIterator::Create(reader.get(), reader->posidx_root()));
+    ASSERT_OK(iter->SeekToFirst());
+
+    BlockHandle bh;
+    ASSERT_OK(reader->ReadBlock(iter->GetCurrentBlockPointer(),
+                                CFileReader::CACHE_BLOCK,
+                                &bh));
+    if (i == 0) {
+      ASSERT_EQ(2, down_cast<Counter*>(
+          entity->FindOrNull(METRIC_block_cache_hits_caching).get())->value());
+      first_read = bh.data().ToString();
+      bh = BlockHandle();
+      iter.reset();
+      reader.reset();
+      Singleton<BlockCache>::UnsafeReset();
+      entity = METRIC_ENTITY_server.Instantiate(&registry, "test_entity2");
+      BlockCache::GetSingleton()->StartInstrumentation(entity);
+    } else {
+      ASSERT_EQ(0, down_cast<Counter*>(
+          entity->FindOrNull(METRIC_block_cache_hits_caching).get())->value());
+      ASSERT_EQ(first_read, bh.data().ToString());
+    }
+  }
+  Singleton<BlockCache>::UnsafeReset();
+}
+
+// Tests that blocks of compressed CFiles which don't fit in the block cache are
+// served from the cache of compressed blocks.
+TEST_F(TestCFile, TestCompressedBlockCache) {
+  // Leave no room for decompressed blocks, so that every read misses them.
+  FLAGS_block_cache_capacity_mb = 0;
+  FLAGS_block_cache_compressed_capacity_mb = 16;
+  Singleton<BlockCache>::UnsafeReset();
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache* cache = BlockCache::GetSingleton();
+  ASSERT_TRUE(cache->has_compressed_cache());
+  cache->StartInstrumentation(entity);
+
+  BlockId block_id;
+  {
+    const int nrows = 1000;
+    StringDataGenerator<false> generator("hello %04d");
+    WriteTestFile(&generator, PREFIX_ENCODING, LZ4, nrows, SMALL_BLOCKSIZE, &block_id);
+  }
+
+  string first_read;
+  for (int i = 0; i < 2; i++) {
+    gscoped_ptr<ReadableBlock> source;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &source));
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(source), ReaderOptions(), &reader));
+
+    gscoped_ptr<IndexTreeIterator> iter;
+    iter.reset(IndexTreeIterator::Create(reader.get(), reader->posidx_root()));
+    ASSERT_OK(iter->SeekToFirst());
+
+    BlockHandle bh;
+    ASSERT_OK(reader->ReadBlock(iter->GetCurrentBlockPointer(),
+                                CFileReader::CACHE_BLOCK,
+                                &bh));
+    if (i == 0) {
+      first_read = bh.data().ToString();
+    } else {
+      ASSERT_EQ(first_read, bh.data().ToString());
+    }
+
+    // The second time through, the seek and the ReadBlock() both find their
+    // compressed blocks in the cache.
+    ASSERT_EQ(i * 2, down_cast<Counter*>(
+        entity->FindOrNull(METRIC_block_cache_compressed_hits).get())->value());
+  }
+  Singleton<BlockCache>::UnsafeReset();
+}
+
+// Tests that a sequential scan reads the following data blocks into the block
+// cache ahead of the iterator.
+TEST_P(TestCFileBothCacheTypes, TestReadAhead) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity(METRIC_ENTITY_server.Instantiate(&registry, "test_entity"));
+  BlockCache* cache = BlockCache::GetSingleton();
+  cache->StartInstrumentation(entity);
+
+  const int kNumRows = 10000;
+  UInt32DataGenerator<false> generator;
+  BlockId block_id;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                        SMALL_BLOCKSIZE, &block_id));
+
+  gscoped_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  gscoped_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+  const int kDepth = 4;
+  int64_t blocks_read;
+  int64_t blocks_read_ahead;
+  {
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+    iter->set_readahead_depth(kDepth);
+    ASSERT_OK(iter->SeekToFirst());
+
+    // Read the first 1000 rows, which span several blocks.
+    ScopedColumnBlock<UINT32> cb(100);
+    SelectionVector sel(cb.nrows());
+    for (int i = 0; i < 10; i++) {
+      size_t n = cb.nrows();
+      ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&cb, &sel);
+      ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+      ASSERT_EQ(cb.nrows(), n);
+      ASSERT_EQ(i * 1000, cb[0]);
+    }
+    blocks_read = iter->io_statistics().data_blocks_read_from_disk;
+    blocks_read_ahead = iter->readahead_blocks_issued();
+
+    // Destroying the iterator waits for the outstanding read-ahead.
+  }
+
+  // Read-ahead starts once the iterator has moved on from the first block
+  // twice, and then keeps kDepth blocks ahead of it.
+  ASSERT_GE(blocks_read, 3);
+  ASSERT_EQ(kDepth + blocks_read - 3, blocks_read_ahead);
+
+  // All the blocks read by the iterator or ahead of it are now cached.
+  vector<BlockPointer> ptrs;
+  gscoped_ptr<IndexTreeIterator> idx_iter(
+      IndexTreeIterator::Create(reader.get(), reader->posidx_root()));
+  ASSERT_OK(idx_iter->SeekToFirst());
+  while (ptrs.size() < blocks_read + blocks_read_ahead) {
+    ptrs.push_back(idx_iter->GetCurrentBlockPointer());
+    ASSERT_OK(idx_iter->Next());
+  }
+  Counter* hits = down_cast<Counter*>(
+      entity->FindOrNull(METRIC_block_cache_hits_caching).get());
+  int64_t hits_before = hits->value();
+  for (const BlockPointer& ptr : ptrs) {
+    BlockHandle bh;
+    ASSERT_OK(reader->ReadBlock(ptr, CFileReader::CACHE_BLOCK, &bh));
+  }
+  ASSERT_EQ(hits_before + ptrs.size(), hits->value());
+
+  // Iterators which don't cache blocks never read ahead.
+  gscoped_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::DONT_CACHE_BLOCK));
+  iter->set_readahead_depth(kDepth);
+  ASSERT_OK(iter->SeekToFirst());
+  ScopedColumnBlock<UINT32> cb(1000);
+  SelectionVector sel(cb.nrows());
+  size_t n = cb.nrows();
+  ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&cb, &sel);
+  ASSERT_OK(iter->CopyNextValues(&n, &ctx));
+  ASSERT_EQ(0, iter->readahead_blocks_issued());
+}
+
+TEST_P(TestCFileBothCacheTypes, TestMmapReads) {
+  FLAGS_block_manager_mmap_reads = true;
+  const int kNumRows = 10000;
+  for (CompressionType compression : { NO_COMPRESSION, LZ4 }) {
+    SCOPED_TRACE(CompressionType_Name(compression));
+    UInt32DataGenerator<false> generator;
+    BlockId block_id;
+    ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, compression, kNumRows,
+                                          SMALL_BLOCKSIZE, &block_id));
+    size_t count;
+    TimeReadFile(fs_manager_.get(), block_id, &count);
+    ASSERT_EQ(kNumRows, count);
+
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    const MemoryMappedRegion* region = block->mapped_region();
+    ASSERT_TRUE(region != nullptr);
+    uint64_t size;
+    ASSERT_OK(block->Size(&size));
+    ASSERT_EQ(size, region->data().size());
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+    // Uncompressed blocks are served straight from the mapping, and so are
+    // never cached; compressed ones are read and cached as usual.
+    gscoped_ptr<IndexTreeIterator> iter(
+        IndexTreeIterator::Create(reader.get(), reader->posidx_root()));
+    ASSERT_OK(iter->SeekToFirst());
+    BlockPointer ptr = iter->GetCurrentBlockPointer();
+    BlockHandle handle;
+    ASSERT_OK(reader->ReadBlock(ptr, CFileReader::CACHE_BLOCK, &handle));
+    bool in_mapping = handle.data().data() == region->data().data() + ptr.offset();
+    ASSERT_EQ(compression == NO_COMPRESSION, in_mapping);
+    BlockCacheHandle cache_handle;
+    ASSERT_EQ(compression != NO_COMPRESSION, BlockCache::GetSingleton()->Lookup(
+        BlockCache::CacheKey(reader->block_id(), ptr.offset()),
+        Cache::EXPECT_IN_CACHE, &cache_handle));
+  }
+}
+
+TEST_P(TestCFileBothCacheTypes, TestScanByReference) {
+  const int kNumRows = 10000;
+  UInt32DataGenerator<false> generator;
+  BlockId block_id;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, kNumRows,
+                                        NO_FLAGS, &block_id));
+  gscoped_ptr<ReadableBlock> block;
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  gscoped_ptr<CFileReader> reader;
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+  ScopedColumnBlock<UINT32> cb(1000);
+  SelectionVector sel(cb.nrows());
+  std::shared_ptr<const void> pin;
+  const uint32_t* values;
+  {
+    gscoped_ptr<CFileIterator> iter;
+    ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+    ASSERT_OK(iter->SeekToOrdinal(500));
+
+    // Unless allowed, the values are copied.
+    size_t n = cb.nrows();
+    ASSERT_OK(iter->PrepareBatch(&n));
+    ColumnMaterializationContext copy_ctx = CreateNonDecoderEvalContext(&cb, &sel);
+    ASSERT_OK(iter->Scan(&copy_ctx));
+    ASSERT_TRUE(copy_ctx.external_data() == nullptr);
+    ASSERT_EQ(500, cb[0]);
+
+    // Scanning the same batch again, by reference this time, points at the
+    // values within the block.
+    ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&cb, &sel);
+    ctx.set_zero_copy_allowed(true);
+    ASSERT_OK(iter->Scan(&ctx));
+    ASSERT_TRUE(ctx.external_data() != nullptr);
+    ASSERT_TRUE(ctx.external_data_pin() != nullptr);
+    ASSERT_OK(iter->FinishBatch());
+    values = reinterpret_cast<const uint32_t*>(ctx.external_data());
+    pin = ctx.external_data_pin();
+
+    // The next batch carries on where the referenced one ended.
+    n = cb.nrows();
+    ASSERT_OK(iter->PrepareBatch(&n));
+    ColumnMaterializationContext next_ctx = CreateNonDecoderEvalContext(&cb, &sel);
+    ASSERT_OK(iter->Scan(&next_ctx));
+    ASSERT_OK(iter->FinishBatch());
+    ASSERT_EQ(1500, cb[0]);
+  }
+
+  // The pin keeps the values alive after the iterator is gone.
+  for (int i = 0; i < cb.nrows(); i++) {
+    ASSERT_EQ(500 + i, static_cast<int>(values[i]));
+  }
+  pin.reset();
+
+  // Nullable files leave the null cells out of the data blocks, so they are
+  // always copied.
+  UInt32DataGenerator<true> nullable_generator;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&nullable_generator, PLAIN_ENCODING, NO_COMPRESSION,
+                                        kNumRows, NO_FLAGS, &block_id));
+  ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+  ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+  gscoped_ptr<CFileIterator> iter;
+  ASSERT_OK(reader->NewIterator(&iter, CFileReader::CACHE_BLOCK));
+  ASSERT_OK(iter->SeekToFirst());
+  ScopedColumnBlock<UINT32> nullable_cb(1000);
+  size_t n = nullable_cb.nrows();
+  ASSERT_OK(iter->PrepareBatch(&n));
+  ColumnMaterializationContext ctx = CreateNonDecoderEvalContext(&nullable_cb, &sel);
+  ctx.set_zero_copy_allowed(true);
+  ASSERT_OK(iter->Scan(&ctx));
+  ASSERT_OK(iter->FinishBatch());
+  ASSERT_TRUE(ctx.external_data() == nullptr);
+}
+
 #if defined(__linux__)
 // Inject failures in nvm allocation and ensure that we can still read a file.
 TEST_P(TestCFileBothCacheTypes, TestNvmAllocationFailure) {
@@ -912,7 +1724,7 @@ class TestCFileDifferentCodecs : public TestCFile,
 };
 
 INSTANTIATE_TEST_CASE_P(Codecs, TestCFileDifferentCodecs,
-                        ::testing::Values(NO_COMPRESSION, SNAPPY, LZ4, ZLIB));
+                        ::testing::Values(NO_COMPRESSION, SNAPPY, LZ4, ZLIB, ZSTD));
 
 // Read/write a file with uncompressible data (random int32s)
 TEST_P(TestCFileDifferentCodecs, TestUncompressible) {
@@ -19,6 +19,8 @@
 
 #include <glog/logging.h>
 
+#include <string.h>
+
 #include <algorithm>
 
 #include "kudu/cfile/binary_plain_block.h"
@@ -29,26 +31,57 @@
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/cfile/index_block.h"
 #include "kudu/cfile/index_btree.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/column_statistics.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/mathlimits.h"
+#include "kudu/gutil/singleton.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/memory/overwrite.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/rle-encoding.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_bool(cfile_lazy_open, true,
             "Allow lazily opening of cfiles");
 TAG_FLAG(cfile_lazy_open, hidden);
 
+DEFINE_int32(cfile_readahead_blocks, 0,
+             "Number of data blocks to asynchronously read into the block cache "
+             "ahead of a sequential CFile scan. Individual scans may override "
+             "this. 0 disables read-ahead.");
+TAG_FLAG(cfile_readahead_blocks, experimental);
+
+DEFINE_bool(cfile_verify_checksums, true,
+            "Whether to verify the checksums of the blocks read from cfiles "
+            "written with them (see --cfile_write_checksums).");
+TAG_FLAG(cfile_verify_checksums, advanced);
+TAG_FLAG(cfile_verify_checksums, runtime);
+
+DEFINE_int32(cfile_parallel_checksum_min_bytes, 512 * 1024,
+             "Size of the compressed blocks from which checksums are verified "
+             "on another core while the block is being decompressed, rather "
+             "than right after the block is read. Smaller blocks are still in "
+             "the CPU cache from being read when they are verified.");
+TAG_FLAG(cfile_parallel_checksum_min_bytes, experimental);
+TAG_FLAG(cfile_parallel_checksum_min_bytes, runtime);
+
 using kudu::fs::ReadableBlock;
 using strings::Substitute;
 
@@ -62,6 +95,36 @@ const char* CFILE_CACHE_HIT_BYTES_METRIC_NAME = "cfile_cache_hit_bytes";
 static const size_t kMagicAndLengthSize = 12;
 static const size_t kMaxHeaderFooterPBSize = 64*1024;
 
+// Number of times an iterator must move on to the next data block without
+// seeking before it starts reading ahead.
+static const int kSequentialBlocksBeforeReadAhead = 2;
+
+// Blocks passed to ReadBlocksAsync() are read with a single I/O if they are
+// separated on disk by at most this many bytes (e.g. of index blocks), as
+// long as the I/O stays within kMaxAsyncReadBytes.
+static const uint64_t kMaxAsyncReadGapBytes = 64 * 1024;
+static const uint64_t kMaxAsyncReadBytes = 4 * 1024 * 1024;
+
+// Process-wide pool of threads which verify the checksums of large
+// compressed blocks while they're being decompressed.
+class ChecksumPool {
+ public:
+  static ThreadPool* Get() {
+    return Singleton<ChecksumPool>::get()->pool_.get();
+  }
+
+ private:
+  friend class Singleton<ChecksumPool>;
+
+  ChecksumPool() {
+    CHECK_OK(ThreadPoolBuilder("cfile-checksum")
+             .set_max_threads(base::NumCPUs())
+             .Build(&pool_));
+  }
+
+  gscoped_ptr<ThreadPool> pool_;
+};
+
 static Status ParseMagicAndLength(const Slice &data,
                                   uint8_t* cfile_version,
                                   uint32_t *parsed_len) {
@@ -95,6 +158,7 @@ CFileReader::CFileReader(ReaderOptions options,
   block_(std::move(block)),
   file_size_(file_size),
   codec_(nullptr),
+  block_cache_attribution_(std::move(options.block_cache_attribution)),
   mem_consumption_(std::move(options.parent_mem_tracker),
                    memory_footprint()) {
 }
@@ -147,8 +211,9 @@ Status CFileReader::InitOnce() {
 
   RETURN_NOT_OK(ReadAndParseFooter());
 
-  if (PREDICT_FALSE(footer_->incompatible_features() != 0)) {
-    // Currently we do not support any incompatible features.
+  const uint32_t kSupportedIncompatibleFeatures = CFileFooterPB::COMPRESSION_DICTIONARY |
+                                                  CFileFooterPB::BLOCKED_BLOOM_FILTERS;
+  if (PREDICT_FALSE((footer_->incompatible_features() & ~kSupportedIncompatibleFeatures) != 0)) {
     return Status::NotSupported(Substitute(
         "cfile uses features from an incompatible version: $0",
         footer_->incompatible_features()));
@@ -231,6 +296,19 @@ Status CFileReader::ReadAndParseFooter() {
     RETURN_NOT_OK(GetCompressionCodec(footer_->compression(), &codec_));
   }
 
+  // Every block is compressed with the dictionary, if there is one, so it
+  // must be loaded before anything else is read.
+  if (footer_->has_compression_dictionary_ptr()) {
+    BlockPointer ptr(footer_->compression_dictionary_ptr());
+    gscoped_array<uint8_t> dictionary_space(new uint8_t[ptr.size()]);
+    Slice dictionary;
+    RETURN_NOT_OK(block_->Read(ptr.offset(), ptr.size(), &dictionary, dictionary_space.get()));
+    RETURN_NOT_OK_PREPEND(NewCompressionCodecWithDictionary(footer_->compression(), dictionary,
+                                                            &dictionary_codec_),
+                          "Invalid compression dictionary");
+    codec_ = dictionary_codec_.get();
+  }
+
   VLOG(2) << "Read footer: " << SecureDebugString(*footer_);
 
   return Status::OK();
@@ -265,9 +343,10 @@ class ScratchMemory {
   // no capacity and cannot evict to make room, this will fall back
   // to allocating from the heap. In that case, IsFromCache() will
   // return false.
-  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size) {
+  void TryAllocateFromCache(BlockCache* cache, const BlockCache::CacheKey& key, int size,
+                            BlockCache::Priority priority) {
     DCHECK(!ptr_);
-    from_cache_ = cache->Allocate(key, size);
+    from_cache_ = cache->Allocate(key, size, priority);
     if (!from_cache_.valid()) {
       AllocateFromHeap(size);
       return;
@@ -323,19 +402,48 @@ class ScratchMemory {
 };
 } // anonymous namespace
 
+const Slice* CFileReader::mapped_data() const {
+  const MemoryMappedRegion* region = block_->mapped_region();
+  if (region == nullptr || codec_ != nullptr ||
+      (has_checksums() && FLAGS_cfile_verify_checksums)) {
+    return nullptr;
+  }
+  return &region->data();
+}
+
 Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_control,
-                              BlockHandle *ret) const {
+                              BlockHandle *ret, BlockCache::Priority priority) const {
   DCHECK(init_once_.initted());
   CHECK(ptr.offset() > 0 &&
         ptr.offset() + ptr.size() < file_size_) <<
     "bad offset " << ptr.ToString() << " in file of size "
                   << file_size_;
+  // Beyond the insertion position, low priority caching is like CACHE_BLOCK.
+  bool insert_cold = false;
+  if (cache_control == CACHE_BLOCK_LOW_PRIORITY) {
+    insert_cold = priority == BlockCache::NORMAL_PRIORITY;
+    cache_control = CACHE_BLOCK;
+  }
+
+  // Uncompressed blocks of memory mapped files are used in place, bypassing
+  // the block cache, unless their checksums must be verified on every read.
+  const Slice* mapped = mapped_data();
+  if (mapped != nullptr) {
+    TRACE_COUNTER_INCREMENT("cfile_mmap_reads", 1);
+    *ret = BlockHandle::WithUnownedData(Slice(mapped->data() + ptr.offset(), ptr.size()));
+    return Status::OK();
+  }
+
   BlockCacheHandle bc_handle;
   Cache::CacheBehavior cache_behavior = cache_control == CACHE_BLOCK ?
       Cache::EXPECT_IN_CACHE : Cache::NO_EXPECT_IN_CACHE;
   BlockCache* cache = BlockCache::GetSingleton();
   BlockCache::CacheKey key(block_->id(), ptr.offset());
-  if (cache->Lookup(key, cache_behavior, &bc_handle)) {
+  bool hit = cache->Lookup(key, cache_behavior, &bc_handle, priority);
+  if (block_cache_attribution_) {
+    block_cache_attribution_->RecordLookup(hit);
+  }
+  if (hit) {
     TRACE_COUNTER_INCREMENT("cfile_cache_hit", 1);
     TRACE_COUNTER_INCREMENT(CFILE_CACHE_HIT_BYTES_METRIC_NAME, ptr.size());
     *ret = BlockHandle::WithDataFromCache(&bc_handle);
@@ -352,29 +460,84 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
   TRACE_COUNTER_INCREMENT("cfile_cache_miss", 1);
   TRACE_COUNTER_INCREMENT(CFILE_CACHE_MISS_BYTES_METRIC_NAME, ptr.size());
 
-  ScratchMemory scratch;
-  // If we are reading uncompressed data and plan to cache the result,
-  // then we should allocate our scratch memory directly from the cache.
-  // This avoids an extra memory copy in the case of an NVM cache.
-  if (codec_ == nullptr && cache_control == CACHE_BLOCK) {
-    scratch.TryAllocateFromCache(cache, key, ptr.size());
-  } else {
-    scratch.AllocateFromHeap(ptr.size());
+  // Blocks of compressed CFiles may still be found, compressed, in the
+  // compressed block cache, which saves the read but not the decompression.
+  bool use_compressed_cache = codec_ != nullptr && cache->has_compressed_cache();
+  BlockCacheHandle compressed_handle;
+  bool compressed_hit = use_compressed_cache &&
+      cache->LookupCompressed(key, cache_behavior, &compressed_handle);
+  if (compressed_hit) {
+    TRACE_COUNTER_INCREMENT("cfile_compressed_cache_hit", 1);
   }
-  uint8_t* buf = scratch.get();
 
+  // The checksum which follows the block is read along with it, unless the
+  // block comes from the compressed cache, whose blocks were verified when
+  // they were read.
+  bool verify_checksum = has_checksums() && FLAGS_cfile_verify_checksums && !compressed_hit;
+  size_t read_size = ptr.size() + (verify_checksum ? kBlockChecksumSize : 0);
+
+  ScratchMemory scratch;
   Slice block;
-  RETURN_NOT_OK(block_->Read(ptr.offset(), ptr.size(), &block, buf));
-  if (block.size() != ptr.size()) {
-    return Status::IOError("Could not read full block length");
+  if (compressed_hit) {
+    block = compressed_handle.data();
+  } else {
+    // If we are reading uncompressed data and plan to cache the result,
+    // then we should allocate our scratch memory directly from the cache.
+    // This avoids an extra memory copy in the case of an NVM cache. Blocks
+    // with checksums are instead verified as they're copied into the cache.
+    if (codec_ == nullptr && cache_control == CACHE_BLOCK && !verify_checksum) {
+      scratch.TryAllocateFromCache(cache, key, ptr.size(), priority);
+    } else {
+      scratch.AllocateFromHeap(read_size);
+    }
+    RETURN_NOT_OK(block_->Read(ptr.offset(), read_size, &block, scratch.get()));
+    if (block.size() != read_size) {
+      return Status::IOError("Could not read full block length");
+    }
+  }
+  uint32_t expected_checksum = 0;
+  if (verify_checksum) {
+    expected_checksum = DecodeFixed32(block.data() + ptr.size());
+    block.truncate(ptr.size());
   }
 
   // Decompress the block
   if (codec_ != nullptr) {
+    // Small blocks are verified while they're still in the CPU cache from
+    // being read. Large ones are verified on another core while they're
+    // being decompressed, rather than in a second pass over memory.
+    bool background_checksum = verify_checksum &&
+        block.size() >= FLAGS_cfile_parallel_checksum_min_bytes;
+    uint32_t actual_checksum = 0;
+    CountDownLatch checksum_latch(background_checksum ? 1 : 0);
+    auto wait_for_checksum = MakeScopedCleanup([&]() { checksum_latch.Wait(); });
+    if (background_checksum) {
+      Status s = ChecksumPool::Get()->SubmitFunc([&]() {
+          actual_checksum = crc::Crc32c(block.data(), block.size());
+          checksum_latch.CountDown();
+        });
+      if (PREDICT_FALSE(!s.ok())) {
+        actual_checksum = crc::Crc32c(block.data(), block.size());
+        checksum_latch.CountDown();
+      }
+    } else if (verify_checksum) {
+      RETURN_NOT_OK(VerifyChecksum(ptr, expected_checksum,
+                                   crc::Crc32c(block.data(), block.size())));
+    }
+    // A corrupt block is reported as such rather than as undecodable.
+    auto background_checksum_status = [&]() -> Status {
+      if (!background_checksum) {
+        return Status::OK();
+      }
+      checksum_latch.Wait();
+      return VerifyChecksum(ptr, expected_checksum, actual_checksum);
+    };
+
     // Init the decompressor and get the size required for the uncompressed buffer.
     CompressedBlockDecoder uncompressor(codec_, cfile_version_, block);
     Status s = uncompressor.Init();
     if (!s.ok()) {
+      RETURN_NOT_OK(background_checksum_status());
       LOG(WARNING) << "Unable to validate compressed block at "
                    << ptr.offset() << " of size " << ptr.size() << ": "
                    << s.ToString();
@@ -386,16 +549,28 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     // decompress directly into the cache's memory (to avoid a memcpy for NVM).
     ScratchMemory decompressed_scratch;
     if (cache_control == CACHE_BLOCK) {
-      decompressed_scratch.TryAllocateFromCache(cache, key, uncompressed_size);
+      decompressed_scratch.TryAllocateFromCache(cache, key, uncompressed_size, priority);
     } else {
       decompressed_scratch.AllocateFromHeap(uncompressed_size);
     }
     s = uncompressor.UncompressIntoBuffer(decompressed_scratch.get());
     if (!s.ok()) {
+      RETURN_NOT_OK(background_checksum_status());
       LOG(WARNING) << "Unable to uncompress block at " << ptr.offset()
                    << " of size " << ptr.size() << ": " << s.ToString();
       return s;
     }
+    RETURN_NOT_OK(background_checksum_status());
+
+    // Keep the validated compressed block around for later reads which miss
+    // the cache of uncompressed blocks.
+    if (use_compressed_cache && !compressed_hit && cache_control == CACHE_BLOCK) {
+      BlockCache::PendingEntry compressed_entry = cache->AllocateCompressed(key, block.size());
+      if (compressed_entry.valid()) {
+        memcpy(compressed_entry.val_ptr(), block.data(), block.size());
+        cache->InsertCompressed(&compressed_entry, &compressed_handle);
+      }
+    }
 
     // Now that we've decompressed, we don't need to keep holding onto the original
     // scratch buffer. Instead, we have to start holding onto our decompression
@@ -403,7 +578,25 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
     scratch.Swap(&decompressed_scratch);
 
     // Set the result block to our decompressed data.
-    block = Slice(buf, uncompressed_size);
+    block = Slice(scratch.get(), uncompressed_size);
+  } else if (verify_checksum) {
+    // The block is verified as it's copied into the cache, if it's to be
+    // cached, or in place otherwise.
+    ScratchMemory cached;
+    if (cache_control == CACHE_BLOCK) {
+      cached.TryAllocateFromCache(cache, key, ptr.size(), priority);
+    }
+    if (cached.IsFromCache()) {
+      RETURN_NOT_OK(VerifyChecksum(ptr, expected_checksum,
+                                   crc::Crc32cAndCopy(block.data(), cached.get(),
+                                                      block.size())));
+      scratch.Swap(&cached);
+      block = Slice(scratch.get(), ptr.size());
+    } else {
+      RETURN_NOT_OK(VerifyChecksum(ptr, expected_checksum,
+                                   crc::Crc32c(block.data(), block.size())));
+      block.relocate(scratch.get());
+    }
   } else {
     // Some of the File implementations from LevelDB attempt to be tricky
     // and just return a Slice into an mmapped region (or in-memory region).
@@ -417,16 +610,17 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
   // of what the user requested. The scratch memory includes both the
   // generated key and the data read from disk.
   if (cache_control == CACHE_BLOCK && scratch.IsFromCache()) {
-    cache->Insert(scratch.mutable_pending_entry(), &bc_handle);
+    cache->Insert(scratch.mutable_pending_entry(), &bc_handle,
+                  block_cache_attribution_.get(), insert_cold);
     *ret = BlockHandle::WithDataFromCache(&bc_handle);
   } else {
     // We get here by either not intending to cache the block or
     // if the entry could not be allocated from the block cache.
     // Since we allocate memory to include the key for the cache entry
     // we must reset the block.
-    DCHECK_EQ(block.data(), buf);
+    DCHECK_EQ(block.data(), scratch.get());
     DCHECK(!scratch.IsFromCache());
-    *ret = BlockHandle::WithOwnedData(scratch.as_slice());
+    *ret = BlockHandle::WithOwnedData(Slice(scratch.get(), block.size()));
   }
 
   // The cache or the BlockHandle now has ownership over the memory, so release
@@ -436,6 +630,345 @@ Status CFileReader::ReadBlock(const BlockPointer &ptr, CacheControl cache_contro
   return Status::OK();
 }
 
+namespace {
+
+// A single I/O issued by CFileReader::ReadBlocksAsync(), covering one or
+// more blocks.
+struct AsyncBlockRead {
+  uint64_t offset;
+  uint64_t length;
+  std::vector<BlockPointer> ptrs;
+  std::unique_ptr<uint8_t[]> scratch;
+  Slice result;
+};
+
+// The I/Os of a single ReadBlocksAsync() call.
+struct AsyncBlockReadBatch {
+  std::vector<AsyncBlockRead> reads;
+  std::function<void(const Status&)> callback;
+
+  Mutex lock;
+  int pending;  // protected by 'lock'
+  Status status;  // protected by 'lock'
+};
+
+} // anonymous namespace
+
+void CFileReader::ReadBlocksAsync(const std::vector<BlockPointer>& ptrs,
+                                  std::function<void(const Status&)> callback) const {
+  DCHECK(init_once_.initted());
+  BlockCache* cache = BlockCache::GetSingleton();
+  auto batch = std::make_shared<AsyncBlockReadBatch>();
+  batch->callback = std::move(callback);
+  // Memory mapped blocks are read ahead by the OS instead.
+  const MemoryMappedRegion* region = mapped_data() ? block_->mapped_region() : nullptr;
+  if (region != nullptr) {
+    for (const BlockPointer& ptr : ptrs) {
+      region->Advise(ptr.offset(), ptr.size(), MemoryMappedRegion::WILLNEED);
+    }
+    batch->callback(Status::OK());
+    return;
+  }
+  bool verify_checksums = has_checksums() && FLAGS_cfile_verify_checksums;
+  uint64_t checksum_size = verify_checksums ? kBlockChecksumSize : 0;
+  for (const BlockPointer& ptr : ptrs) {
+    BlockCacheHandle handle;
+    if (cache->Lookup(BlockCache::CacheKey(block_->id(), ptr.offset()),
+                      Cache::NO_EXPECT_IN_CACHE, &handle)) {
+      continue;
+    }
+    if (!batch->reads.empty()) {
+      AsyncBlockRead* last = &batch->reads.back();
+      uint64_t end = last->offset + last->length;
+      DCHECK_GE(ptr.offset(), end);
+      uint64_t ptr_end = ptr.offset() + ptr.size() + checksum_size;
+      if (ptr.offset() - end <= kMaxAsyncReadGapBytes &&
+          ptr_end - last->offset <= kMaxAsyncReadBytes) {
+        last->length = ptr_end - last->offset;
+        last->ptrs.push_back(ptr);
+        continue;
+      }
+    }
+    batch->reads.emplace_back();
+    AsyncBlockRead* read = &batch->reads.back();
+    read->offset = ptr.offset();
+    read->length = ptr.size() + checksum_size;
+    read->ptrs.push_back(ptr);
+  }
+  if (batch->reads.empty()) {
+    batch->callback(Status::OK());
+    return;
+  }
+
+  TRACE_COUNTER_INCREMENT("cfile_async_reads", batch->reads.size());
+  batch->pending = batch->reads.size();
+  for (AsyncBlockRead& read : batch->reads) {
+    read.scratch.reset(new uint8_t[read.length]);
+    AsyncBlockRead* r = &read;
+    block_->ReadAsync(read.offset, read.length, &read.result, read.scratch.get(),
+                      [this, batch, r, verify_checksums](const Status& read_status) {
+        Status s = read_status;
+        if (s.ok() && r->result.size() != r->length) {
+          s = Status::IOError("Could not read full block length");
+        }
+        for (const BlockPointer& ptr : r->ptrs) {
+          if (!s.ok()) {
+            break;
+          }
+          size_t size = ptr.size() + (verify_checksums ? kBlockChecksumSize : 0);
+          s = InsertBlockIntoCache(
+              ptr, Slice(r->result.data() + (ptr.offset() - r->offset), size),
+              verify_checksums);
+        }
+        r->scratch.reset();
+
+        bool done;
+        {
+          MutexLock l(batch->lock);
+          if (batch->status.ok()) {
+            batch->status = s;
+          }
+          done = --batch->pending == 0;
+        }
+        if (done) {
+          batch->callback(batch->status);
+        }
+      });
+  }
+}
+
+Status CFileReader::InsertBlockIntoCache(const BlockPointer& ptr, Slice data,
+                                         bool verify_checksum) const {
+  BlockCache* cache = BlockCache::GetSingleton();
+  BlockCache::CacheKey key(block_->id(), ptr.offset());
+  uint32_t expected_checksum = 0;
+  if (verify_checksum) {
+    expected_checksum = DecodeFixed32(data.data() + ptr.size());
+    data.truncate(ptr.size());
+  }
+  ScratchMemory scratch;
+  if (codec_ != nullptr) {
+    if (verify_checksum) {
+      RETURN_NOT_OK(VerifyChecksum(ptr, expected_checksum,
+                                   crc::Crc32c(data.data(), data.size())));
+    }
+    CompressedBlockDecoder uncompressor(codec_, cfile_version_, data);
+    RETURN_NOT_OK_PREPEND(uncompressor.Init(),
+                          Substitute("Unable to validate compressed block at $0",
+                                     ptr.ToString()));
+    scratch.TryAllocateFromCache(cache, key, uncompressor.uncompressed_size(),
+                                 BlockCache::NORMAL_PRIORITY);
+    if (!scratch.IsFromCache()) {
+      return Status::OK();
+    }
+    RETURN_NOT_OK_PREPEND(uncompressor.UncompressIntoBuffer(scratch.get()),
+                          Substitute("Unable to uncompress block at $0",
+                                     ptr.ToString()));
+  } else {
+    scratch.TryAllocateFromCache(cache, key, data.size(), BlockCache::NORMAL_PRIORITY);
+    if (!scratch.IsFromCache()) {
+      return Status::OK();
+    }
+    if (verify_checksum) {
+      RETURN_NOT_OK(VerifyChecksum(ptr, expected_checksum,
+                                   crc::Crc32cAndCopy(data.data(), scratch.get(), data.size())));
+    } else {
+      memcpy(scratch.get(), data.data(), data.size());
+    }
+  }
+  BlockCacheHandle handle;
+  cache->Insert(scratch.mutable_pending_entry(), &handle,
+                block_cache_attribution_.get(), false);
+  ignore_result(scratch.release());
+  return Status::OK();
+}
+
+Status CFileReader::VerifyChecksum(const BlockPointer& ptr, uint32_t expected,
+                                   uint32_t actual) const {
+  if (PREDICT_FALSE(expected != actual)) {
+    return Status::Corruption(Substitute("Checksum mismatch for block $0 of $1: "
+                                         "expected $2, computed $3",
+                                         ptr.ToString(), ToString(), expected, actual));
+  }
+  return Status::OK();
+}
+
+Status CFileReader::CheckValueMayBePresent(const void* cell, bool* maybe_present) {
+  DCHECK(has_value_bloom());
+  RETURN_NOT_OK(value_bloom_once_.Init(&CFileReader::ReadValueBloomOnce, this));
+
+  BloomKeyProbe probe(CellValueBytes(type_info_, cell));
+  for (const BloomFilter& filter : value_bloom_filters_) {
+    if (filter.MayContainKey(probe)) {
+      *maybe_present = true;
+      return Status::OK();
+    }
+  }
+  *maybe_present = false;
+  return Status::OK();
+}
+
+Status CFileReader::ReadValueBloomOnce() {
+  BlockHandle handle;
+  BlockPointer bp(footer().value_bloom_ptr());
+  RETURN_NOT_OK_PREPEND(ReadBlock(bp, CACHE_BLOCK, &handle, BlockCache::HIGH_PRIORITY),
+                        "Couldn't read value bloom filters");
+
+  gscoped_ptr<ValueBloomFilterPB> pb(new ValueBloomFilterPB());
+  if (!pb->ParseFromArray(handle.data().data(), handle.data().size()) ||
+      pb->num_hash_functions() <= 0) {
+    return Status::Corruption("Invalid value bloom filters", ToString());
+  }
+  vector<BloomFilter> filters;
+  filters.reserve(pb->filters_size());
+  for (const string& data : pb->filters()) {
+    if (data.empty()) {
+      return Status::Corruption("Empty value bloom filter", ToString());
+    }
+    filters.emplace_back(Slice(data), pb->num_hash_functions());
+  }
+
+  value_bloom_pb_.swap(pb);
+  value_bloom_filters_.swap(filters);
+  mem_consumption_.Reset(memory_footprint());
+  return Status::OK();
+}
+
+Status CFileReader::SearchSecondaryIndex(const ColumnPredicate& pred, size_t max_rows,
+                                         vector<rowid_t>* rowids, bool* exceeded) {
+  DCHECK(has_secondary_index());
+  RETURN_NOT_OK(secondary_index_once_.Init(&CFileReader::ReadSecondaryIndexOnce, this));
+
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(type_info_);
+  faststring lower;
+  faststring upper;
+  rowids->clear();
+  *exceeded = false;
+  switch (pred.predicate_type()) {
+    case PredicateType::Equality: {
+      encoder.Encode(pred.raw_lower(), &lower);
+      Slice value(lower);
+      RETURN_NOT_OK(SearchSecondaryIndexRange(value, &value, true, max_rows,
+                                              rowids, exceeded));
+      break;
+    }
+    case PredicateType::Range: {
+      if (pred.raw_lower() != nullptr) {
+        encoder.Encode(pred.raw_lower(), &lower);
+      }
+      Slice upper_slice;
+      if (pred.raw_upper() != nullptr) {
+        encoder.Encode(pred.raw_upper(), &upper);
+        upper_slice = Slice(upper);
+      }
+      RETURN_NOT_OK(SearchSecondaryIndexRange(
+          Slice(lower), pred.raw_upper() != nullptr ? &upper_slice : nullptr, false,
+          max_rows, rowids, exceeded));
+      break;
+    }
+    case PredicateType::InList:
+      for (const void* value : pred.raw_values()) {
+        encoder.ResetAndEncode(value, &lower);
+        Slice value_slice(lower);
+        RETURN_NOT_OK(SearchSecondaryIndexRange(value_slice, &value_slice, true, max_rows,
+                                                rowids, exceeded));
+        if (*exceeded) {
+          break;
+        }
+      }
+      break;
+    default:
+      return Status::InvalidArgument("Predicate can't be looked up in a secondary index",
+                                     pred.ToString());
+  }
+  std::sort(rowids->begin(), rowids->end());
+  return Status::OK();
+}
+
+Status CFileReader::SearchSecondaryIndexRange(const Slice& lower, const Slice* upper,
+                                              bool upper_inclusive, size_t max_rows,
+                                              vector<rowid_t>* rowids, bool* exceeded) {
+  const auto& blocks = secondary_index_pb_->blocks();
+  // The values below 'lower' may only end the block before the first one
+  // starting at or above it.
+  auto it = std::lower_bound(blocks.begin(), blocks.end(), lower,
+                             [](const SecondaryIndexPB::BlockPB& b, const Slice& v) {
+                               return Slice(b.first_value()).compare(v) < 0;
+                             });
+  if (it != blocks.begin()) {
+    --it;
+  }
+  for (; it != blocks.end(); ++it) {
+    if (upper != nullptr) {
+      int c = Slice(it->first_value()).compare(*upper);
+      if (c > 0 || (c == 0 && !upper_inclusive)) {
+        break;
+      }
+    }
+    BlockHandle handle;
+    RETURN_NOT_OK_PREPEND(ReadBlock(BlockPointer(it->ptr()), CACHE_BLOCK, &handle),
+                          "Couldn't read secondary index block");
+    Slice data = handle.data();
+    while (!data.empty()) {
+      uint32_t size;
+      uint32_t ordinal;
+      if (!GetVarint32(&data, &size) || data.size() < size) {
+        return Status::Corruption("Invalid secondary index entry", ToString());
+      }
+      Slice value(data.data(), size);
+      data.remove_prefix(size);
+      if (!GetVarint32(&data, &ordinal)) {
+        return Status::Corruption("Invalid secondary index entry", ToString());
+      }
+      if (value.compare(lower) < 0) {
+        continue;
+      }
+      if (upper != nullptr) {
+        int c = value.compare(*upper);
+        if (c > 0 || (c == 0 && !upper_inclusive)) {
+          return Status::OK();
+        }
+      }
+      rowids->push_back(ordinal);
+      if (rowids->size() > max_rows) {
+        *exceeded = true;
+        return Status::OK();
+      }
+    }
+  }
+  return Status::OK();
+}
+
+Status CFileReader::ReadColumnStats(ColumnStatistics* stats) const {
+  DCHECK(has_column_stats());
+  BlockHandle handle;
+  BlockPointer bp(footer().column_stats_ptr());
+  RETURN_NOT_OK_PREPEND(ReadBlock(bp, CACHE_BLOCK, &handle),
+                        "Couldn't read column statistics");
+  ColumnStatisticsPB pb;
+  if (!pb.ParseFromArray(handle.data().data(), handle.data().size())) {
+    return Status::Corruption("Invalid column statistics", ToString());
+  }
+  RETURN_NOT_OK_PREPEND(stats->FromPB(pb),
+                        Substitute("Invalid column statistics in $0", ToString()));
+  return Status::OK();
+}
+
+Status CFileReader::ReadSecondaryIndexOnce() {
+  BlockHandle handle;
+  BlockPointer bp(footer().secondary_index_ptr());
+  RETURN_NOT_OK_PREPEND(ReadBlock(bp, CACHE_BLOCK, &handle, BlockCache::HIGH_PRIORITY),
+                        "Couldn't read secondary index directory");
+
+  gscoped_ptr<SecondaryIndexPB> pb(new SecondaryIndexPB());
+  if (!pb->ParseFromArray(handle.data().data(), handle.data().size())) {
+    return Status::Corruption("Invalid secondary index directory", ToString());
+  }
+  secondary_index_pb_.swap(pb);
+  mem_consumption_.Reset(memory_footprint());
+  return Status::OK();
+}
+
 Status CFileReader::CountRows(rowid_t *count) const {
   *count = footer().num_values();
   return Status::OK();
@@ -475,6 +1008,17 @@ size_t CFileReader::memory_footprint() const {
   }
   if (footer_) {
     size += footer_->SpaceUsed();
+    // Roughly the copy of the dictionary held by the codec.
+    if (footer_->has_compression_dictionary_ptr()) {
+      size += footer_->compression_dictionary_ptr().size();
+    }
+  }
+  if (value_bloom_pb_) {
+    size += value_bloom_pb_->SpaceUsed();
+    size += value_bloom_filters_.capacity() * sizeof(BloomFilter);
+  }
+  if (secondary_index_pb_) {
+    size += secondary_index_pb_->SpaceUsed();
   }
   return size;
 }
@@ -526,17 +1070,60 @@ Status DefaultColumnValueIterator::FinishBatch() {
 ////////////////////////////////////////////////////////////
 // Iterator
 ////////////////////////////////////////////////////////////
+// Counts the read-ahead requests of a CFileIterator which are still in
+// flight.
+class CFileIterator::ReadAheadTracker {
+ public:
+  ReadAheadTracker() : cond_(&lock_), pending_(0) {}
+
+  void RequestStarted() {
+    MutexLock l(lock_);
+    pending_++;
+  }
+
+  void RequestFinished() {
+    MutexLock l(lock_);
+    DCHECK_GT(pending_, 0);
+    if (--pending_ == 0) {
+      cond_.Broadcast();
+    }
+  }
+
+  // Block until all started requests have finished.
+  void WaitForPendingRequests() {
+    MutexLock l(lock_);
+    while (pending_ > 0) {
+      cond_.Wait();
+    }
+  }
+
+ private:
+  Mutex lock_;
+  ConditionVariable cond_;
+  int pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReadAheadTracker);
+};
+
 CFileIterator::CFileIterator(CFileReader* reader,
                              CFileReader::CacheControl cache_control)
   : reader_(reader),
+    all_codewords_match_pred_(false),
     seeked_(nullptr),
     prepared_(false),
     cache_control_(cache_control),
     last_prepare_idx_(-1),
-    last_prepare_count_(-1) {
+    last_prepare_count_(-1),
+    readahead_depth_(FLAGS_cfile_readahead_blocks),
+    sequential_blocks_read_(0),
+    readahead_blocks_ahead_(0),
+    readahead_blocks_issued_(0) {
 }
 
 CFileIterator::~CFileIterator() {
+  if (readahead_tracker_) {
+    readahead_tracker_->WaitForPendingRequests();
+  }
 }
 
 Status CFileIterator::SeekToOrdinal(rowid_t ord_idx) {
@@ -729,6 +1316,10 @@ Status CFileIterator::PrepareForNewSeek() {
   }
   prepared_blocks_.clear();
 
+  sequential_blocks_read_ = 0;
+  readahead_iter_.reset();
+  readahead_blocks_ahead_ = 0;
+
   return Status::OK();
 }
 
@@ -763,10 +1354,12 @@ Status DecodeNullInfo(Slice *data_block, uint32_t *num_rows_in_block, Slice *nul
 Status CFileIterator::ReadCurrentDataBlock(const IndexTreeIterator &idx_iter,
                                            PreparedBlock *prep_block) {
   prep_block->dblk_ptr_ = idx_iter.GetCurrentBlockPointer();
-  RETURN_NOT_OK(reader_->ReadBlock(prep_block->dblk_ptr_, cache_control_, &prep_block->dblk_data_));
+  BlockHandle dblk_data;
+  RETURN_NOT_OK(reader_->ReadBlock(prep_block->dblk_ptr_, cache_control_, &dblk_data));
+  prep_block->dblk_data_ = std::make_shared<BlockHandle>(std::move(dblk_data));
 
   uint32_t num_rows_in_block = 0;
-  Slice data_block = prep_block->dblk_data_.data();
+  Slice data_block = prep_block->dblk_data_->data();
   if (reader_->is_nullable()) {
     RETURN_NOT_OK(DecodeNullInfo(&data_block, &num_rows_in_block, &(prep_block->rle_bitmap)));
     prep_block->rle_decoder_ = RleDecoder<bool>(prep_block->rle_bitmap.data(),
@@ -806,6 +1399,132 @@ Status CFileIterator::QueueCurrentDataBlock(const IndexTreeIterator &idx_iter) {
   return Status::OK();
 }
 
+void CFileIterator::MaybeReadAhead() {
+  if (readahead_depth_ <= 0 || cache_control_ != CFileReader::CACHE_BLOCK) {
+    return;
+  }
+  if (++sequential_blocks_read_ < kSequentialBlocksBeforeReadAhead) {
+    return;
+  }
+
+  if (!readahead_iter_) {
+    // Start reading ahead from the block the iterator is positioned at.
+    BlockPointer root = seeked_ == posidx_iter_.get() ? reader_->posidx_root() :
+                                                        reader_->validx_root();
+    gscoped_ptr<IndexTreeIterator> iter(IndexTreeIterator::Create(reader_, root));
+    Status s = iter->SeekAtOrBefore(seeked_->GetCurrentKey());
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << "Unable to start read-ahead for " << reader_->ToString()
+                   << ": " << s.ToString();
+      return;
+    }
+    readahead_iter_.swap(iter);
+    readahead_blocks_ahead_ = 0;
+    if (!readahead_tracker_) {
+      readahead_tracker_ = std::make_shared<ReadAheadTracker>();
+    }
+  } else if (readahead_blocks_ahead_ > 0) {
+    // The iterator moved on to a block which was already read ahead.
+    readahead_blocks_ahead_--;
+  }
+
+  std::vector<BlockPointer> ptrs;
+  while (readahead_blocks_ahead_ < readahead_depth_ && readahead_iter_->HasNext()) {
+    Status s = readahead_iter_->Next();
+    if (PREDICT_FALSE(!s.ok())) {
+      // The error, if persistent, is reported once the iterator itself
+      // reaches the block.
+      VLOG(1) << "Stopping read-ahead for " << reader_->ToString()
+              << ": " << s.ToString();
+      readahead_iter_.reset();
+      break;
+    }
+    ptrs.push_back(readahead_iter_->GetCurrentBlockPointer());
+    readahead_blocks_ahead_++;
+    readahead_blocks_issued_++;
+  }
+  if (ptrs.empty()) {
+    return;
+  }
+
+  // The blocks are only read to warm the block cache, all of them with a
+  // single call so that their reads are in flight at once.
+  std::shared_ptr<ReadAheadTracker> tracker = readahead_tracker_;
+  tracker->RequestStarted();
+  reader_->ReadBlocksAsync(ptrs, [tracker](const Status& s) {
+      WARN_NOT_OK(s, "Unable to read ahead blocks");
+      tracker->RequestFinished();
+    });
+}
+
+Status CFileIterator::ReadBlockStats() {
+  BlockHandle handle;
+  BlockPointer bp(reader_->footer().block_stats_ptr());
+  RETURN_NOT_OK_PREPEND(reader_->ReadBlock(bp, cache_control_, &handle,
+                                           BlockCache::HIGH_PRIORITY),
+                        "Couldn't read block statistics");
+
+  std::unique_ptr<BlockStatsPB> stats(new BlockStatsPB());
+  if (!stats->ParseFromArray(handle.data().data(), handle.data().size())) {
+    return Status::Corruption("Invalid block statistics", reader_->ToString());
+  }
+  const TypeInfo* type_info = reader_->type_info();
+  for (const auto& entry : stats->entries()) {
+    if (entry.has_min_value() != entry.has_max_value() ||
+        (type_info->physical_type() != BINARY && entry.has_min_value() &&
+         (entry.min_value().size() != type_info->size() ||
+          entry.max_value().size() != type_info->size()))) {
+      return Status::Corruption("Invalid block statistics entry", entry.ShortDebugString());
+    }
+  }
+  block_stats_ = std::move(stats);
+  return Status::OK();
+}
+
+Status CFileIterator::CanSkipRows(const ColumnPredicate& pred, rowid_t ord_idx, size_t n,
+                                  bool* can_skip) {
+  *can_skip = false;
+  // An IS NULL predicate can match any block which may contain nulls.
+  if (!reader_->has_block_stats() || pred.predicate_type() == PredicateType::IsNull) {
+    return Status::OK();
+  }
+  if (!block_stats_) {
+    RETURN_NOT_OK(ReadBlockStats());
+  }
+
+  // Find the block containing 'ord_idx', then check every block overlapping
+  // the requested rows.
+  const auto& entries = block_stats_->entries();
+  auto it = std::upper_bound(entries.begin(), entries.end(), ord_idx,
+                             [](rowid_t ord, const BlockStatsPB::EntryPB& entry) {
+                               return ord < entry.first_ordinal();
+                             });
+  if (it == entries.begin()) {
+    return Status::OK();
+  }
+  --it;
+
+  const TypeInfo* type_info = reader_->type_info();
+  Slice min_slice;
+  Slice max_slice;
+  int64_t num_blocks = 0;
+  for (; it != entries.end() && it->first_ordinal() < ord_idx + n; ++it) {
+    num_blocks++;
+    // A block of nulls only matches IS NULL, handled above.
+    if (!it->has_min_value()) {
+      continue;
+    }
+    const void* min = DecodeBlockStatsValue(type_info, it->min_value(), &min_slice);
+    const void* max = DecodeBlockStatsValue(type_info, it->max_value(), &max_slice);
+    if (pred.MayMatchRange(min, max)) {
+      return Status::OK();
+    }
+  }
+  *can_skip = true;
+  io_stats_.data_blocks_skipped += num_blocks;
+  return Status::OK();
+}
+
 bool CFileIterator::HasNext() const {
   CHECK(seeked_) << "not seeked";
   CHECK(!prepared_) << "Cannot call HasNext() mid-batch";
@@ -833,6 +1552,7 @@ Status CFileIterator::PrepareBatch(size_t *n) {
       return s;
     }
     RETURN_NOT_OK(QueueCurrentDataBlock(*seeked_));
+    MaybeReadAhead();
   }
 
   // Seek the first block in the queue such that the first value to be read
@@ -906,9 +1626,52 @@ Status CFileIterator::FinishBatch() {
   return Status::OK();
 }
 
+Status CFileIterator::ScanByReference(ColumnMaterializationContext* ctx, bool* done) {
+  *done = false;
+  // Nullable data blocks don't store the null cells, so their values can't
+  // be laid out row by row in place.
+  if (!ctx->zero_copy_allowed() || reader_->is_nullable() ||
+      prepared_blocks_.size() != 1) {
+    return Status::OK();
+  }
+  PreparedBlock* pb = prepared_blocks_[0];
+  if (!pb->dblk_->SupportsReferenceNextValues()) {
+    return Status::OK();
+  }
+  if (pb->needs_rewind_) {
+    SeekToPositionInBlock(pb, pb->rewind_idx_);
+  }
+
+  size_t n = last_prepare_count_;
+  const uint8_t* data;
+  RETURN_NOT_OK(pb->dblk_->ReferenceNextValues(&n, &data));
+  // A single prepared block always holds the whole batch.
+  DCHECK_EQ(last_prepare_count_, n);
+  pb->needs_rewind_ = true;
+  pb->idx_in_block_ += n;
+
+  if (ctx->block()->is_nullable()) {
+    ColumnDataView(ctx->block()).SetNullBits(n, true);
+  }
+  // Decoders which support referencing values don't evaluate predicates, so
+  // leave that to the caller as CopyNextAndEval() would have.
+  if (ctx->DecoderEvalNotDisabled()) {
+    ctx->SetDecoderEvalNotSupported();
+  }
+  ctx->SetExternalData(data, pb->dblk_data_);
+  *done = true;
+  return Status::OK();
+}
+
 Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
   CHECK(seeked_) << "not seeked";
 
+  bool done;
+  RETURN_NOT_OK(ScanByReference(ctx, &done));
+  if (done) {
+    return Status::OK();
+  }
+
   // Use views to advance the block and selection vector as we read into them.
   ColumnDataView remaining_dst(ctx->block());
   SelectionVectorView remaining_sel(ctx->sel());
@@ -928,6 +1691,7 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
           BitmapSet(codewords_matching_pred_->mutable_bitmap(), i);
         }
       }
+      all_codewords_match_pred_ = codewords_matching_pred_->CountSelected() == nwords;
     }
   }
   for (PreparedBlock *pb : prepared_blocks_) {
@@ -960,6 +1724,10 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
                                                      ctx,
                                                      &remaining_sel,
                                                      &remaining_dst));
+          } else if (ctx->skip_deselected_allowed()) {
+            RETURN_NOT_OK(pb->dblk_->CopyNextSelectedValues(&this_batch,
+                                                            remaining_sel,
+                                                            &remaining_dst));
           } else {
             RETURN_NOT_OK(pb->dblk_->CopyNextValues(&this_batch, &remaining_dst));
           }
@@ -991,6 +1759,9 @@ Status CFileIterator::Scan(ColumnMaterializationContext* ctx) {
 
       if (ctx->DecoderEvalNotDisabled()) {
         RETURN_NOT_OK(pb->dblk_->CopyNextAndEval(&this_batch, ctx, &remaining_sel, &remaining_dst));
+      } else if (ctx->skip_deselected_allowed()) {
+        RETURN_NOT_OK(pb->dblk_->CopyNextSelectedValues(&this_batch, remaining_sel,
+                                                        &remaining_dst));
       } else {
         RETURN_NOT_OK(pb->dblk_->CopyNextValues(&this_batch, &remaining_dst));
       }
@@ -18,6 +18,8 @@
 #ifndef KUDU_CFILE_CFILE_READER_H
 #define KUDU_CFILE_CFILE_READER_H
 
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -35,6 +37,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/object_pool.h"
 #include "kudu/util/once.h"
@@ -44,6 +47,10 @@
 #include "kudu/common/key_encoder.h"
 
 namespace kudu {
+
+class ColumnPredicate;
+class ColumnStatistics;
+
 namespace cfile {
 
 class BlockCache;
@@ -79,9 +86,13 @@ class CFileReader {
   // May be called multiple times; subsequent calls will no-op.
   Status Init();
 
+  // With CACHE_BLOCK_LOW_PRIORITY, data blocks are inserted into the block
+  // cache as the next ones to evict, so that they don't displace blocks which
+  // are in use unless they're read again. Other blocks are cached normally.
   enum CacheControl {
     CACHE_BLOCK,
-    DONT_CACHE_BLOCK
+    DONT_CACHE_BLOCK,
+    CACHE_BLOCK_LOW_PRIORITY
   };
 
   // Can be called before Init().
@@ -96,8 +107,23 @@ class CFileReader {
 
   // TODO: make this private? should only be used
   // by the iterator and index tree readers, I think.
+  //
+  // Index and bloom filter blocks should be read with HIGH_PRIORITY, so that
+  // they are cached with that priority.
   Status ReadBlock(const BlockPointer &ptr, CacheControl cache_control,
-                   BlockHandle *ret) const;
+                   BlockHandle *ret,
+                   BlockCache::Priority priority = BlockCache::NORMAL_PRIORITY) const;
+
+  // Reads the blocks of 'ptrs', which must be in increasing order of offset,
+  // into the block cache without waiting for the reads. Blocks already in the
+  // cache are skipped, and runs of blocks close together on disk are read
+  // with a single ReadableBlock::ReadAsync() each, so that the reads are all
+  // in flight at once. 'callback' is invoked, possibly from another thread,
+  // once all of them have completed, with the first error encountered.
+  //
+  // The reader must remain alive until 'callback' has been invoked.
+  void ReadBlocksAsync(const std::vector<BlockPointer>& ptrs,
+                       std::function<void(const Status&)> callback) const;
 
   // Return the number of rows in this cfile.
   // This is assumed to be reasonably fast (i.e does not scan
@@ -149,6 +175,11 @@ class CFileReader {
     return footer().compression() != NO_COMPRESSION;
   }
 
+  // Return true if each block of the file is followed by a checksum.
+  bool has_checksums() const {
+    return footer().compatible_features() & CFileFooterPB::BLOCK_CHECKSUMS;
+  }
+
   // Advanced access to the cfile. This is used by the
   // delta reader code. TODO: think about reorganizing this:
   // delta files can probably be done more cleanly.
@@ -167,6 +198,41 @@ class CFileReader {
     return BlockPointer(footer().validx_info().root_block());
   }
 
+  // Return true if the file stores min/max statistics for its data blocks.
+  bool has_block_stats() const { return footer().has_block_stats_ptr(); }
+
+  // Return true if the file stores bloom filters over its values.
+  bool has_value_bloom() const { return footer().has_value_bloom_ptr(); }
+
+  // Sets *maybe_present to false if the value bloom filters of the file show
+  // that no row holds the value of 'cell', and to true otherwise.
+  //
+  // The filters are read on first use and then kept in memory for the
+  // lifetime of the reader. Requires has_value_bloom().
+  Status CheckValueMayBePresent(const void* cell, bool* maybe_present);
+
+  // Return true if the file stores a secondary index from its values to the
+  // ordinals of the rows holding them.
+  bool has_secondary_index() const { return footer().has_secondary_index_ptr(); }
+
+  // Looks up the ordinals of the rows whose value matches 'pred', which must
+  // be an Equality, Range or InList predicate, in the secondary index. The
+  // ordinals are returned sorted in 'rowids'. If more than 'max_rows' rows
+  // match, stops early and sets *exceeded to true, in which case 'rowids' is
+  // incomplete.
+  //
+  // The directory of the index blocks is read on first use and then kept in
+  // memory for the lifetime of the reader. Requires has_secondary_index().
+  Status SearchSecondaryIndex(const ColumnPredicate& pred, size_t max_rows,
+                              std::vector<rowid_t>* rowids, bool* exceeded);
+
+  // Return true if the file stores statistics over its values.
+  bool has_column_stats() const { return footer().has_column_stats_ptr(); }
+
+  // Reads the statistics over the values of the file into 'stats'. They are
+  // read anew on each call. Requires has_column_stats().
+  Status ReadColumnStats(ColumnStatistics* stats) const;
+
   // Can be called before Init().
   std::string ToString() const { return block_->id().ToString(); }
 
@@ -180,10 +246,42 @@ class CFileReader {
   // Callback used in 'init_once_' to initialize this cfile.
   Status InitOnce();
 
+  // Callback used in 'value_bloom_once_' to read the value bloom filters.
+  Status ReadValueBloomOnce();
+
+  // Callback used in 'secondary_index_once_' to read the directory of the
+  // secondary index blocks.
+  Status ReadSecondaryIndexOnce();
+
+  // Appends to 'rowids' the ordinals of the rows whose key-encoded value is
+  // at least 'lower' and below 'upper', or at most 'upper' if
+  // 'upper_inclusive' is true. A null 'upper' doesn't bound the values.
+  // Stops and sets *exceeded to true once 'rowids' holds more than
+  // 'max_rows' ordinals.
+  Status SearchSecondaryIndexRange(const Slice& lower, const Slice* upper,
+                                   bool upper_inclusive, size_t max_rows,
+                                   std::vector<rowid_t>* rowids, bool* exceeded);
+
   Status ReadMagicAndLength(uint64_t offset, uint32_t *len);
   Status ReadAndParseHeader();
   Status ReadAndParseFooter();
 
+  // Inserts the block at 'ptr', whose on-disk contents are 'data', into the
+  // block cache. Does nothing if the cache has no room for it. If
+  // 'verify_checksum' is true, 'data' is followed by the checksum of the
+  // block, which is verified.
+  Status InsertBlockIntoCache(const BlockPointer& ptr, Slice data, bool verify_checksum) const;
+
+  // Returns Status::Corruption if 'actual' isn't the checksum 'expected'
+  // stored after the block at 'ptr'.
+  Status VerifyChecksum(const BlockPointer& ptr, uint32_t expected, uint32_t actual) const;
+
+  // Returns the memory mapped contents of the file if its blocks may be used
+  // in place, i.e. if the file is memory mapped (see
+  // --block_manager_mmap_reads), uncompressed, and its checksums needn't be
+  // verified. Returns null otherwise.
+  const Slice* mapped_data() const;
+
   // Returns the memory usage of the object including the object itself.
   size_t memory_footprint() const;
 
@@ -198,11 +296,24 @@ class CFileReader {
   gscoped_ptr<CFileHeaderPB> header_;
   gscoped_ptr<CFileFooterPB> footer_;
   const CompressionCodec* codec_;
+  // Owns codec_ if the file was compressed with a dictionary.
+  std::unique_ptr<CompressionCodec> dictionary_codec_;
   const TypeInfo *type_info_;
   const TypeEncodingInfo *type_encoding_info_;
 
+  // May be null.
+  const scoped_refptr<BlockCacheAttribution> block_cache_attribution_;
+
   KuduOnceDynamic init_once_;
 
+  // The value bloom filters, which refer to the data of value_bloom_pb_.
+  gscoped_ptr<ValueBloomFilterPB> value_bloom_pb_;
+  std::vector<BloomFilter> value_bloom_filters_;
+  KuduOnceDynamic value_bloom_once_;
+
+  gscoped_ptr<SecondaryIndexPB> secondary_index_pb_;
+  KuduOnceDynamic secondary_index_once_;
+
   ScopedTrackedConsumption mem_consumption_;
 };
 
@@ -259,6 +370,17 @@ class ColumnIterator {
   // batch left off.
   virtual Status FinishBatch() = 0;
 
+  // Sets *can_skip to true if it can be determined, without reading the data,
+  // that none of the 'n' rows starting at ordinal 'ord_idx' satisfy 'pred'.
+  // This does not change the position of the iterator.
+  //
+  // The default implementation never skips.
+  virtual Status CanSkipRows(const ColumnPredicate& pred, rowid_t ord_idx, size_t n,
+                             bool* can_skip) {
+    *can_skip = false;
+    return Status::OK();
+  }
+
   virtual const IteratorStats& io_statistics() const = 0;
 };
 
@@ -362,6 +484,11 @@ class CFileIterator : public ColumnIterator {
   // batch left off.
   Status FinishBatch() OVERRIDE;
 
+  // Uses the block statistics of the file, if present, to determine whether
+  // the given rows can be skipped. See ColumnIterator::CanSkipRows().
+  Status CanSkipRows(const ColumnPredicate& pred, rowid_t ord_idx, size_t n,
+                     bool* can_skip) override;
+
   // Return true if the next call to PrepareBatch will return at least one row.
   bool HasNext() const;
 
@@ -384,12 +511,33 @@ class CFileIterator : public ColumnIterator {
   // single set of predicate-satisfying codewords.
   SelectionVector* GetCodeWordsMatchingPredicate() { return codewords_matching_pred_.get(); }
 
+  // Returns true if every word in the dictionary satisfies the predicate, in
+  // which case decoders need not test each row's codeword against
+  // GetCodeWordsMatchingPredicate(). Only valid once the latter is non-null.
+  bool AllCodeWordsMatchPredicate() const { return all_codewords_match_pred_; }
+
+  // Set the number of data blocks which are read asynchronously into the
+  // block cache ahead of the current position once the iterator detects
+  // that it is reading the file sequentially. 0 disables read-ahead.
+  //
+  // Defaults to --cfile_readahead_blocks. Read-ahead is never done by
+  // iterators which do not cache the blocks they read.
+  void set_readahead_depth(int depth) { readahead_depth_ = depth; }
+
+  // Return the number of data blocks for which read-ahead has been issued
+  // since the iterator was created. Exposed for tests.
+  int64_t readahead_blocks_issued() const { return readahead_blocks_issued_; }
+
  private:
   DISALLOW_COPY_AND_ASSIGN(CFileIterator);
 
+  class ReadAheadTracker;
+
   struct PreparedBlock {
     BlockPointer dblk_ptr_;
-    BlockHandle dblk_data_;
+    // Shared so that batches materialized by reference (see
+    // ScanByReference()) can keep the block's data alive.
+    std::shared_ptr<BlockHandle> dblk_data_;
     gscoped_ptr<BlockDecoder> dblk_;
 
     // The rowid of the first row in this block.
@@ -430,6 +578,12 @@ class CFileIterator : public ColumnIterator {
   // Seek the given PreparedBlock to the given index within it.
   void SeekToPositionInBlock(PreparedBlock *pb, uint32_t idx_in_block);
 
+  // If the whole prepared batch lies within a single block whose decoder
+  // supports it, and 'ctx' allows it, point 'ctx' at the values in place
+  // rather than copying them out of the block. Sets '*done' to whether the
+  // batch was materialized this way; if not, nothing was consumed.
+  Status ScanByReference(ColumnMaterializationContext* ctx, bool* done);
+
   // Read the data block currently pointed to by idx_iter_
   // into the given PreparedBlock structure.
   //
@@ -445,6 +599,15 @@ class CFileIterator : public ColumnIterator {
   // seek-related state.
   Status PrepareForNewSeek();
 
+  // Read and validate the block statistics of the file into block_stats_.
+  Status ReadBlockStats();
+
+  // Called each time the iterator moves on to the next data block without
+  // seeking. Once enough blocks have been read sequentially, issues
+  // asynchronous reads so that the next readahead_depth_ data blocks are in
+  // the block cache before they are needed.
+  void MaybeReadAhead();
+
   CFileReader* reader_;
 
   gscoped_ptr<IndexTreeIterator> posidx_iter_;
@@ -457,6 +620,13 @@ class CFileIterator : public ColumnIterator {
   // Set containing the codewords that match the predicate in a dictionary.
   std::unique_ptr<SelectionVector> codewords_matching_pred_;
 
+  // Whether every codeword is set in codewords_matching_pred_.
+  bool all_codewords_match_pred_;
+
+  // Min/max statistics of the data blocks, loaded on first use by
+  // CanSkipRows().
+  std::unique_ptr<BlockStatsPB> block_stats_;
+
   // The currently in-use index iterator. This is equal to either
   // posidx_iter_.get(), validx_iter_.get(), or NULL if not seeked.
   IndexTreeIterator *seeked_;
@@ -485,6 +655,28 @@ class CFileIterator : public ColumnIterator {
 
   IteratorStats io_stats_;
 
+  // Number of data blocks to read ahead of the current position.
+  int readahead_depth_;
+
+  // Number of times the iterator moved on to the next data block since the
+  // last seek.
+  int sequential_blocks_read_;
+
+  // Index iterator positioned at the last data block for which read-ahead
+  // was issued, or NULL if read-ahead has not started since the last seek.
+  gscoped_ptr<IndexTreeIterator> readahead_iter_;
+
+  // Number of data blocks for which read-ahead has been issued beyond the
+  // block the iterator is currently positioned at.
+  int readahead_blocks_ahead_;
+
+  int64_t readahead_blocks_issued_;
+
+  // Read-ahead requests which have not completed yet. Shared with the
+  // requests themselves; the destructor waits for them to finish, since they
+  // reference reader_.
+  std::shared_ptr<ReadAheadTracker> readahead_tracker_;
+
   // a temporary buffer for encoding
   faststring tmp_buf_;
 };
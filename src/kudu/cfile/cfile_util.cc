@@ -130,5 +130,26 @@ void GetSeparatingKey(const Slice& left, Slice* right) {
   right->truncate(cpl == right->size() ? cpl : cpl + 1);
 }
 
+Slice CellValueBytes(const TypeInfo* type, const void* cell) {
+  if (type->physical_type() == BINARY) {
+    return *reinterpret_cast<const Slice*>(cell);
+  }
+  return Slice(reinterpret_cast<const uint8_t*>(cell), type->size());
+}
+
+void EncodeBlockStatsValue(const TypeInfo* type, const void* cell, string* dst) {
+  Slice value = CellValueBytes(type, cell);
+  dst->assign(reinterpret_cast<const char*>(value.data()), value.size());
+}
+
+const void* DecodeBlockStatsValue(const TypeInfo* type, const Slice& value, Slice* slice_cell) {
+  if (type->physical_type() == BINARY) {
+    *slice_cell = value;
+    return slice_cell;
+  }
+  DCHECK_EQ(value.size(), type->size());
+  return value.data();
+}
+
 } // namespace cfile
 } // namespace kudu
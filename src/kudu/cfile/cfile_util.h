@@ -19,7 +19,9 @@
 
 #include <algorithm>
 #include <iostream>
+#include <string>
 
+#include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/cfile.pb.h"
 
 #include "kudu/common/schema.h"
@@ -60,6 +62,60 @@ struct WriterOptions {
   // instead of entire keys.
   bool optimize_index_keys;
 
+  // Whether to store the minimum and maximum value of each data block, which
+  // allows scans to skip blocks that cannot match their predicates.
+  //
+  // Default: false.
+  bool write_block_stats;
+
+  // Whether to store bloom filters over the values of the file, which allow
+  // equality lookups to skip files which don't contain the value. Not
+  // supported for floating point types, for which it is ignored.
+  //
+  // Default: false.
+  bool write_value_bloom;
+
+  // Whether to store a secondary index from the values of the file to the
+  // ordinals of the rows holding them, which allows lookups by value to read
+  // only the matching rows. Only supported for the types which may be part
+  // of a key, and ignored for the others.
+  //
+  // Default: false.
+  bool write_secondary_index;
+
+  // Whether to store statistics over the values of the file: the number of
+  // nulls, the minimum and maximum values and a sketch of the number of
+  // distinct values.
+  //
+  // Default: false.
+  bool write_column_stats;
+
+  // Bits of CFileFooterPB::IncompatibleFeatures to set in the footer in
+  // addition to those implied by the other options, for files whose raw
+  // blocks older readers would misinterpret.
+  //
+  // Default: 0.
+  uint32_t incompatible_features;
+
+  // Whether to follow each block with a checksum, verified as the block is
+  // read (see --cfile_verify_checksums).
+  //
+  // Default: --cfile_write_checksums.
+  bool write_checksums;
+
+  // Whether to insert the blocks into the block cache as they are written, so
+  // that the first reads of the file don't miss the cache. Blocks are cached
+  // uncompressed and with the priority they are read with.
+  //
+  // Default: false.
+  bool cache_written_blocks;
+
+  // Where the blocks cached because of 'cache_written_blocks' are accounted
+  // for, if anywhere.
+  //
+  // Default: null.
+  scoped_refptr<BlockCacheAttribution> block_cache_attribution;
+
   // Column storage attributes.
   //
   // Default: all default values as specified in the constructor in
@@ -76,6 +132,12 @@ struct ReaderOptions {
   //
   // Default: the root tracker.
   std::shared_ptr<MemTracker> parent_mem_tracker;
+
+  // Where the block cache lookups and inserts of this reader are accounted
+  // for, if anywhere.
+  //
+  // Default: null.
+  scoped_refptr<BlockCacheAttribution> block_cache_attribution;
 };
 
 // Dumps the contents of a cfile to 'out'; 'reader' and 'iterator'
@@ -92,6 +154,21 @@ size_t CommonPrefixLength(const Slice& a, const Slice& b);
 // Truncate right to give a shortest key satisfying left <= key <= right.
 void GetSeparatingKey(const Slice& left, Slice* right);
 
+// Returns the bytes holding the value of 'cell', of type 'type': the cell
+// itself for fixed size types, or the referenced bytes for binary types.
+// These are the keys of the value bloom filters of a cfile.
+Slice CellValueBytes(const TypeInfo* type, const void* cell);
+
+// Stores the value of 'cell', of type 'type', into 'dst' in the format of the
+// BlockStatsPB min/max values: the cell itself for fixed size types, or the
+// referenced bytes for binary types.
+void EncodeBlockStatsValue(const TypeInfo* type, const void* cell, std::string* dst);
+
+// The inverse of EncodeBlockStatsValue(): returns a pointer to a cell holding
+// 'value'. For binary types, the cell is stored in 'slice_cell' and refers to
+// the data of 'value'. The size of 'value' must be valid for 'type'.
+const void* DecodeBlockStatsValue(const TypeInfo* type, const Slice& value, Slice* slice_cell);
+
 }  // namespace cfile
 }  // namespace kudu
 
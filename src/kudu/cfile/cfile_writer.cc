@@ -18,28 +18,36 @@
 #include "kudu/cfile/cfile_writer.h"
 
 #include <glog/logging.h>
+#include <algorithm>
+#include <memory>
 #include <string>
 #include <utility>
 
+#include "kudu/cfile/block_cache.h"
 #include "kudu/cfile/block_pointer.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/index_block.h"
 #include "kudu/cfile/index_btree.h"
 #include "kudu/cfile/type_encodings.h"
+#include "kudu/common/column_statistics.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/gutil/endian.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/pb_util.h"
 
 using google::protobuf::RepeatedPtrField;
 using kudu::fs::ScopedWritableBlockCloser;
 using kudu::fs::WritableBlock;
 using std::string;
+using std::unique_ptr;
 
 DEFINE_int32(cfile_default_block_size, 256*1024, "The default block size to use in cfiles");
 TAG_FLAG(cfile_default_block_size, advanced);
@@ -66,9 +74,60 @@ DEFINE_string(cfile_do_on_finish, "flush",
               "Possible values are 'close', 'flush', or 'nothing'.");
 TAG_FLAG(cfile_do_on_finish, experimental);
 
+DEFINE_int32(cfile_value_bloom_block_size, 4096,
+             "Size in bytes of each of the bloom filters over the values of cfile "
+             "columns which have bloom filters enabled.");
+TAG_FLAG(cfile_value_bloom_block_size, advanced);
+
+DEFINE_double(cfile_value_bloom_target_fp_rate, 0.01,
+              "Target false-positive rate (between 0 and 1) of the bloom filters over "
+              "the values of cfile columns which have bloom filters enabled.");
+TAG_FLAG(cfile_value_bloom_target_fp_rate, advanced);
+
+DEFINE_bool(cfile_zstd_train_dictionary, false,
+            "Whether to compress ZSTD-compressed cfiles with a dictionary trained "
+            "on the first data blocks of each file. This helps blocks of small, "
+            "similar values compress nearly as well as the whole file would.");
+TAG_FLAG(cfile_zstd_train_dictionary, experimental);
+
+DEFINE_int32(cfile_zstd_dictionary_training_blocks, 8,
+             "Number of data blocks at the start of a cfile to train its ZSTD "
+             "dictionary on. These blocks are held in memory until the dictionary "
+             "has been trained.");
+TAG_FLAG(cfile_zstd_dictionary_training_blocks, experimental);
+
+DEFINE_int32(cfile_zstd_dictionary_size, 64 * 1024,
+             "Maximum size in bytes of the ZSTD dictionary trained for a cfile.");
+TAG_FLAG(cfile_zstd_dictionary_size, experimental);
+
+DEFINE_bool(cfile_adaptive_encoding, false,
+            "Whether to choose the encoding of columns using AUTO_ENCODING by "
+            "encoding a sample of the values of each cfile with every encoding "
+            "supported for the column's type, and using the one with the smallest "
+            "output. Otherwise, such columns use the default encoding of their type.");
+TAG_FLAG(cfile_adaptive_encoding, experimental);
+
+DEFINE_int32(cfile_adaptive_encoding_sample_cells, 4096,
+             "Number of cells sampled from the start of each cfile when choosing "
+             "its encoding. See --cfile_adaptive_encoding.");
+TAG_FLAG(cfile_adaptive_encoding_sample_cells, experimental);
+
+DEFINE_bool(cfile_write_checksums, false,
+            "Whether to follow each block of the cfiles written with a CRC32C "
+            "checksum of its data, verified when the block is read.");
+TAG_FLAG(cfile_write_checksums, experimental);
+
 namespace kudu {
 namespace cfile {
 
+// The training samples for a compression dictionary are cut out of the data
+// blocks in pieces of this size, since the trainer needs many samples.
+static const size_t kDictionarySampleSize = 4096;
+
+// Sampling for the encoding selection stops early once the sampled binary
+// values take up this much memory.
+static const size_t kMaxEncodingSampleBytes = 1024 * 1024;
+
 const char kMagicStringV1[] = "kuducfil";
 const char kMagicStringV2[] = "kuducfl2";
 const int kMagicLength = 8;
@@ -87,7 +146,14 @@ WriterOptions::WriterOptions()
     block_restart_interval(16),
     write_posidx(false),
     write_validx(false),
-    optimize_index_keys(true) {
+    optimize_index_keys(true),
+    write_block_stats(false),
+    write_value_bloom(false),
+    write_secondary_index(false),
+    write_column_stats(false),
+    incompatible_features(0),
+    write_checksums(FLAGS_cfile_write_checksums),
+    cache_written_blocks(false) {
 }
 
 
@@ -107,6 +173,12 @@ CFileWriter::CFileWriter(const WriterOptions &options,
     is_nullable_(is_nullable),
     typeinfo_(typeinfo),
     key_encoder_(nullptr),
+    cur_block_has_values_(false),
+    dictionary_training_pending_(false),
+    pending_data_bytes_(0),
+    encoding_selection_pending_(false),
+    num_sample_cells_(0),
+    sample_bytes_(0),
     state_(kWriterInitialized) {
   EncodingType encoding = options_.storage_attributes.encoding;
   Status s = TypeEncodingInfo::Get(typeinfo_, encoding, &type_encoding_info_);
@@ -143,6 +215,36 @@ CFileWriter::CFileWriter(const WriterOptions &options,
     key_encoder_ = &GetKeyEncoder<faststring>(typeinfo_);
     validx_builder_.reset(new IndexTreeBuilder(&options_, this));
   }
+
+  if (options_.write_value_bloom) {
+    // The filters hash the bytes of the values, which doesn't match the
+    // equality of floating point values (e.g. 0.0 == -0.0).
+    if (typeinfo_->physical_type() == FLOAT || typeinfo_->physical_type() == DOUBLE) {
+      LOG(WARNING) << "Bloom filters are not supported for type " << typeinfo_->name()
+                   << ": not writing them";
+      options_.write_value_bloom = false;
+    } else {
+      value_bloom_builder_.reset(new BloomFilterBuilder(
+          BloomFilterSizing::BySizeAndFPRate(FLAGS_cfile_value_bloom_block_size,
+                                             FLAGS_cfile_value_bloom_target_fp_rate)));
+    }
+  }
+
+  if (options_.write_secondary_index) {
+    // The index is sorted by the key encoding of the values, which only
+    // exists for the types allowed in keys.
+    if (!IsTypeAllowableInKey(typeinfo_)) {
+      LOG(WARNING) << "Secondary indexes are not supported for type " << typeinfo_->name()
+                   << ": not writing one";
+      options_.write_secondary_index = false;
+    } else {
+      key_encoder_ = &GetKeyEncoder<faststring>(typeinfo_);
+    }
+  }
+
+  if (options_.write_column_stats) {
+    column_stats_.reset(new ColumnStatistics(typeinfo_));
+  }
 }
 
 CFileWriter::~CFileWriter() {
@@ -157,6 +259,9 @@ Status CFileWriter::Start() {
     const CompressionCodec* codec;
     RETURN_NOT_OK(GetCompressionCodec(compression_, &codec));
     block_compressor_ .reset(new CompressedBlockBuilder(codec));
+    // The data blocks are held back until there are enough of them to train
+    // the dictionary on; see HoldBackDataBlock().
+    dictionary_training_pending_ = compression_ == ZSTD && FLAGS_cfile_zstd_train_dictionary;
   }
 
   CFileHeaderPB header;
@@ -177,6 +282,13 @@ Status CFileWriter::Start() {
   RETURN_NOT_OK(type_encoding_info_->CreateBlockBuilder(&bb, &options_));
   data_block_.reset(bb);
 
+  // The values are held back until the encoding is chosen; see SampleEntries().
+  if (FLAGS_cfile_adaptive_encoding &&
+      options_.storage_attributes.encoding == AUTO_ENCODING) {
+    encoding_selection_pending_ = true;
+    sample_arena_.reset(new Arena(16 * 1024, 64 * 1024 * 1024));
+  }
+
   if (is_nullable_) {
     size_t nrows = ((options_.storage_attributes.cfile_block_size + typeinfo_->size() - 1) /
                     typeinfo_->size());
@@ -201,7 +313,13 @@ Status CFileWriter::FinishAndReleaseBlock(ScopedWritableBlockCloser* closer) {
     "Bad state for Finish(): " << state_;
 
   // Write out any pending values as the last data block.
+  if (encoding_selection_pending_) {
+    RETURN_NOT_OK(SelectEncodingAndAppendSample());
+  }
   RETURN_NOT_OK(FinishCurDataBlock());
+  if (dictionary_training_pending_) {
+    RETURN_NOT_OK(TrainDictionaryAndFlushDataBlocks());
+  }
 
   state_ = kWriterFinished;
 
@@ -210,8 +328,22 @@ Status CFileWriter::FinishAndReleaseBlock(ScopedWritableBlockCloser* closer) {
   footer.set_data_type(typeinfo_->type());
   footer.set_is_type_nullable(is_nullable_);
   footer.set_encoding(type_encoding_info_->encoding_type());
+  if (encoding_selection_.candidates_size() > 0) {
+    footer.mutable_encoding_selection()->CopyFrom(encoding_selection_);
+  }
   footer.set_num_values(value_count_);
   footer.set_compression(compression_);
+  if (options_.incompatible_features != 0) {
+    footer.set_incompatible_features(options_.incompatible_features);
+  }
+  if (options_.write_checksums) {
+    footer.set_compatible_features(CFileFooterPB::BLOCK_CHECKSUMS);
+  }
+  if (compression_dictionary_codec_) {
+    compression_dictionary_ptr_.CopyToPB(footer.mutable_compression_dictionary_ptr());
+    footer.set_incompatible_features(footer.incompatible_features() |
+                                     CFileFooterPB::COMPRESSION_DICTIONARY);
+  }
 
   // Write out any pending positional index blocks.
   if (options_.write_posidx) {
@@ -227,6 +359,22 @@ Status CFileWriter::FinishAndReleaseBlock(ScopedWritableBlockCloser* closer) {
     footer.mutable_validx_info()->CopyFrom(validx_info);
   }
 
+  if (options_.write_block_stats) {
+    RETURN_NOT_OK_PREPEND(WriteBlockStats(&footer), "Couldn't write block statistics");
+  }
+
+  if (options_.write_value_bloom) {
+    RETURN_NOT_OK_PREPEND(WriteValueBloom(&footer), "Couldn't write value bloom filters");
+  }
+
+  if (options_.write_secondary_index) {
+    RETURN_NOT_OK_PREPEND(WriteSecondaryIndex(&footer), "Couldn't write secondary index");
+  }
+
+  if (options_.write_column_stats) {
+    RETURN_NOT_OK_PREPEND(WriteColumnStats(&footer), "Couldn't write column statistics");
+  }
+
   // Optionally append extra information to the end of cfile.
   // Example: dictionary block for dictionary encoding
   RETURN_NOT_OK(data_block_->AppendExtraInfo(this, &footer));
@@ -285,6 +433,9 @@ void CFileWriter::FlushMetadataToPB(RepeatedPtrField<FileMetadataPairPB> *field)
 
 Status CFileWriter::AppendEntries(const void *entries, size_t count) {
   DCHECK(!is_nullable_);
+  if (encoding_selection_pending_) {
+    return SampleEntries(nullptr, entries, count);
+  }
 
   int rem = count;
 
@@ -294,6 +445,12 @@ Status CFileWriter::AppendEntries(const void *entries, size_t count) {
     int n = data_block_->Add(ptr, rem);
     DCHECK_GE(n, 0);
 
+    UpdateBlockStats(ptr, n);
+    AddToValueBloom(ptr, n);
+    AddToSecondaryIndex(ptr, n, value_count_);
+    if (column_stats_) {
+      column_stats_->AddValues(ptr, n);
+    }
     ptr += typeinfo_->size() * n;
     rem -= n;
     value_count_ += n;
@@ -311,6 +468,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
                                           const void *entries,
                                           size_t count) {
   DCHECK(is_nullable_ && bitmap != nullptr);
+  if (encoding_selection_pending_) {
+    return SampleEntries(bitmap, entries, count);
+  }
 
   const uint8_t *ptr = reinterpret_cast<const uint8_t *>(entries);
 
@@ -324,6 +484,12 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
         int n = data_block_->Add(ptr, rem);
         DCHECK_GE(n, 0);
 
+        UpdateBlockStats(ptr, n);
+        AddToValueBloom(ptr, n);
+        AddToSecondaryIndex(ptr, n, value_count_);
+        if (column_stats_) {
+          column_stats_->AddValues(ptr, n);
+        }
         null_bitmap_builder_->AddRun(true, n);
         ptr += n * typeinfo_->size();
         value_count_ += n;
@@ -336,6 +502,9 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
       } while (rem > 0);
     } else {
       null_bitmap_builder_->AddRun(false, nblock);
+      if (column_stats_) {
+        column_stats_->AddNulls(nblock);
+      }
       ptr += nblock * typeinfo_->size();
       value_count_ += nblock;
     }
@@ -344,6 +513,142 @@ Status CFileWriter::AppendNullableEntries(const uint8_t *bitmap,
   return Status::OK();
 }
 
+Status CFileWriter::SampleEntries(const uint8_t* bitmap, const void* entries, size_t count) {
+  const size_t cell_size = typeinfo_->size();
+  size_t offset = sample_cells_.size();
+  sample_cells_.resize(offset + count * cell_size);
+  memcpy(&sample_cells_[offset], entries, count * cell_size);
+  if (bitmap != nullptr) {
+    sample_null_bitmap_.resize(BitmapSize(num_sample_cells_ + count));
+    for (size_t i = 0; i < count; i++) {
+      BitmapChange(sample_null_bitmap_.data(), num_sample_cells_ + i, BitmapTest(bitmap, i));
+    }
+  }
+
+  // The cells of binary types point to data owned by the caller, which must be
+  // copied as well.
+  if (typeinfo_->physical_type() == BINARY) {
+    Slice* slices = reinterpret_cast<Slice*>(&sample_cells_[offset]);
+    for (size_t i = 0; i < count; i++) {
+      if (bitmap != nullptr && !BitmapTest(bitmap, i)) {
+        slices[i] = Slice();
+        continue;
+      }
+      if (PREDICT_FALSE(!sample_arena_->RelocateSlice(slices[i], &slices[i]))) {
+        return Status::RuntimeError("unable to allocate memory for the encoding sample");
+      }
+      sample_bytes_ += slices[i].size();
+    }
+  }
+  num_sample_cells_ += count;
+
+  if (num_sample_cells_ >= FLAGS_cfile_adaptive_encoding_sample_cells ||
+      sample_bytes_ >= kMaxEncodingSampleBytes) {
+    return SelectEncodingAndAppendSample();
+  }
+  return Status::OK();
+}
+
+Status CFileWriter::SelectEncodingAndAppendSample() {
+  DCHECK(encoding_selection_pending_);
+  encoding_selection_pending_ = false;
+
+  // The block builders are only given the non-null cells.
+  const size_t cell_size = typeinfo_->size();
+  faststring non_null_cells;
+  size_t num_non_null = num_sample_cells_;
+  const uint8_t* cells = sample_cells_.data();
+  if (is_nullable_) {
+    num_non_null = 0;
+    for (size_t i = 0; i < num_sample_cells_; i++) {
+      if (BitmapTest(sample_null_bitmap_.data(), i)) {
+        non_null_cells.append(&sample_cells_[i * cell_size], cell_size);
+        num_non_null++;
+      }
+    }
+    cells = non_null_cells.data();
+  }
+
+  if (num_non_null > 0) {
+    encoding_selection_.set_num_sampled_cells(num_sample_cells_);
+    const TypeEncodingInfo* best = nullptr;
+    int64_t best_size = 0;
+    // The default encoding comes first, so it wins ties.
+    for (EncodingType encoding : TypeEncodingInfo::GetSupportedEncodings(typeinfo_)) {
+      const TypeEncodingInfo* candidate;
+      RETURN_NOT_OK(TypeEncodingInfo::Get(typeinfo_, encoding, &candidate));
+      int64_t size;
+      RETURN_NOT_OK(EstimateEncodedSize(candidate, cells, num_non_null, &size));
+      EncodingSelectionPB::CandidatePB* candidate_pb = encoding_selection_.add_candidates();
+      candidate_pb->set_encoding(encoding);
+      candidate_pb->set_encoded_size(size);
+      if (best == nullptr || size < best_size) {
+        best = candidate;
+        best_size = size;
+      }
+    }
+    VLOG(2) << "Selected encoding " << EncodingType_Name(best->encoding_type())
+            << " for cfile " << ToString() << " of type " << typeinfo_->name()
+            << ": " << encoding_selection_.ShortDebugString();
+    if (best != type_encoding_info_) {
+      type_encoding_info_ = best;
+      BlockBuilder* bb;
+      RETURN_NOT_OK(type_encoding_info_->CreateBlockBuilder(&bb, &options_));
+      data_block_.reset(bb);
+    }
+  }
+
+  // Now append the sampled cells for real. The block builders copy the
+  // values, so the sample can be discarded afterwards.
+  if (num_sample_cells_ > 0) {
+    if (is_nullable_) {
+      RETURN_NOT_OK(AppendNullableEntries(sample_null_bitmap_.data(), sample_cells_.data(),
+                                          num_sample_cells_));
+    } else {
+      RETURN_NOT_OK(AppendEntries(sample_cells_.data(), num_sample_cells_));
+    }
+  }
+  delete[] sample_cells_.release();
+  delete[] sample_null_bitmap_.release();
+  sample_arena_.reset();
+  num_sample_cells_ = 0;
+  sample_bytes_ = 0;
+  return Status::OK();
+}
+
+Status CFileWriter::EstimateEncodedSize(const TypeEncodingInfo* encoding_info,
+                                        const uint8_t* cells,
+                                        size_t count,
+                                        int64_t* size) {
+  BlockBuilder* bb;
+  RETURN_NOT_OK(encoding_info->CreateBlockBuilder(&bb, &options_));
+  gscoped_ptr<BlockBuilder> builder(bb);
+
+  int64_t total = 0;
+  while (count > 0) {
+    int n = builder->Add(cells, count);
+    DCHECK_GT(n, 0);
+    cells += n * typeinfo_->size();
+    count -= n;
+    if (builder->IsBlockFull() || count == 0) {
+      vector<Slice> block = { builder->Finish(0) };
+      // Compressing hides some of the differences between the encodings, so
+      // compare the sizes which would actually be written.
+      if (block_compressor_) {
+        vector<Slice> compressed;
+        RETURN_NOT_OK(block_compressor_->Compress(block, &compressed));
+        block.swap(compressed);
+      }
+      for (const Slice& s : block) {
+        total += s.size();
+      }
+      builder->Reset();
+    }
+  }
+  *size = total + builder->EstimateExtraInfoSize();
+  return Status::OK();
+}
+
 Status CFileWriter::FinishCurDataBlock() {
   uint32_t num_elems_in_block = data_block_->Count();
   if (is_nullable_) {
@@ -363,6 +668,16 @@ Status CFileWriter::FinishCurDataBlock() {
   Slice data = data_block_->Finish(first_elem_ord);
   VLOG(2) << " actual size=" << data.size();
 
+  if (options_.write_block_stats) {
+    BlockStatsPB::EntryPB* entry = block_stats_.add_entries();
+    entry->set_first_ordinal(first_elem_ord);
+    if (cur_block_has_values_) {
+      entry->set_min_value(cur_block_min_);
+      entry->set_max_value(cur_block_max_);
+    }
+    cur_block_has_values_ = false;
+  }
+
   uint8_t key_tmp_space[typeinfo_->size()];
   if (validx_builder_ != nullptr) {
     // If we're building an index, we need to copy the first
@@ -382,10 +697,15 @@ Status CFileWriter::FinishCurDataBlock() {
     v.push_back(null_bitmap);
   }
   v.push_back(data);
-  Status s = AppendRawBlock(v, first_elem_ord,
-                            reinterpret_cast<const void *>(key_tmp_space),
-                            Slice(last_key_),
-                            "data block");
+  Status s;
+  if (dictionary_training_pending_) {
+    s = HoldBackDataBlock(v, first_elem_ord, reinterpret_cast<const void *>(key_tmp_space));
+  } else {
+    s = AppendRawBlock(v, first_elem_ord,
+                       reinterpret_cast<const void *>(key_tmp_space),
+                       Slice(last_key_),
+                       "data block");
+  }
 
   if (is_nullable_) {
     null_bitmap_builder_->Reset();
@@ -400,15 +720,270 @@ Status CFileWriter::FinishCurDataBlock() {
   return s;
 }
 
+void CFileWriter::UpdateBlockStats(const uint8_t* cells, size_t count) {
+  if (!options_.write_block_stats || count == 0) {
+    return;
+  }
+  const size_t cell_size = typeinfo_->size();
+  if (!cur_block_has_values_) {
+    EncodeBlockStatsValue(typeinfo_, cells, &cur_block_min_);
+    EncodeBlockStatsValue(typeinfo_, cells, &cur_block_max_);
+    cur_block_has_values_ = true;
+  }
+
+  Slice min_slice;
+  Slice max_slice;
+  const void* min = DecodeBlockStatsValue(typeinfo_, cur_block_min_, &min_slice);
+  const void* max = DecodeBlockStatsValue(typeinfo_, cur_block_max_, &max_slice);
+  const uint8_t* min_cell = nullptr;
+  const uint8_t* max_cell = nullptr;
+  for (const uint8_t* cell = cells; cell < cells + count * cell_size; cell += cell_size) {
+    if (typeinfo_->Compare(cell, min) < 0) {
+      min = min_cell = cell;
+    } else if (typeinfo_->Compare(cell, max) > 0) {
+      max = max_cell = cell;
+    }
+  }
+  // Only copy out the new extremes once, since 'cells' stays valid until we return.
+  if (min_cell != nullptr) {
+    EncodeBlockStatsValue(typeinfo_, min_cell, &cur_block_min_);
+  }
+  if (max_cell != nullptr) {
+    EncodeBlockStatsValue(typeinfo_, max_cell, &cur_block_max_);
+  }
+}
+
+Status CFileWriter::WriteBlockStats(CFileFooterPB* footer) {
+  faststring buf;
+  pb_util::SerializeToString(block_stats_, &buf);
+  vector<Slice> v;
+  v.push_back(Slice(buf));
+  BlockPointer ptr;
+  RETURN_NOT_OK(AddBlock(v, &ptr, "block stats", BlockCache::HIGH_PRIORITY));
+  ptr.CopyToPB(footer->mutable_block_stats_ptr());
+  return Status::OK();
+}
+
+void CFileWriter::AddToValueBloom(const uint8_t* cells, size_t count) {
+  if (!options_.write_value_bloom) {
+    return;
+  }
+  const size_t cell_size = typeinfo_->size();
+  for (const uint8_t* cell = cells; cell < cells + count * cell_size; cell += cell_size) {
+    Slice value = CellValueBytes(typeinfo_, cell);
+    // Runs of a repeated value only need to be added once.
+    if (value_bloom_builder_->count() > 0 && value == Slice(last_bloom_value_)) {
+      continue;
+    }
+    value_bloom_builder_->AddKey(BloomKeyProbe(value));
+    last_bloom_value_.assign_copy(value.data(), value.size());
+
+    if (value_bloom_builder_->count() >= value_bloom_builder_->expected_count()) {
+      FinishValueBloomFilter();
+    }
+  }
+}
+
+void CFileWriter::FinishValueBloomFilter() {
+  Slice filter = value_bloom_builder_->slice();
+  value_bloom_.add_filters(filter.data(), filter.size());
+  value_bloom_builder_->Clear();
+}
+
+Status CFileWriter::WriteValueBloom(CFileFooterPB* footer) {
+  if (value_bloom_builder_->count() > 0) {
+    FinishValueBloomFilter();
+  }
+  value_bloom_.set_num_hash_functions(value_bloom_builder_->n_hashes());
+
+  faststring buf;
+  pb_util::SerializeToString(value_bloom_, &buf);
+  vector<Slice> v;
+  v.push_back(Slice(buf));
+  BlockPointer ptr;
+  RETURN_NOT_OK(AddBlock(v, &ptr, "value bloom", BlockCache::HIGH_PRIORITY));
+  ptr.CopyToPB(footer->mutable_value_bloom_ptr());
+  return Status::OK();
+}
+
+void CFileWriter::AddToSecondaryIndex(const uint8_t* cells, size_t count,
+                                      rowid_t first_ordinal) {
+  if (!options_.write_secondary_index) {
+    return;
+  }
+  const size_t cell_size = typeinfo_->size();
+  for (size_t i = 0; i < count; i++) {
+    size_t offset = secondary_index_values_.size();
+    key_encoder_->Encode(cells + i * cell_size, &secondary_index_values_);
+    secondary_index_entries_.push_back(
+        { offset, static_cast<uint32_t>(secondary_index_values_.size() - offset),
+          first_ordinal + static_cast<rowid_t>(i) });
+  }
+}
+
+Status CFileWriter::WriteSecondaryIndex(CFileFooterPB* footer) {
+  const uint8_t* values = secondary_index_values_.data();
+  auto value_of = [&](const SecondaryIndexEntry& e) {
+    return Slice(values + e.offset, e.size);
+  };
+  std::sort(secondary_index_entries_.begin(), secondary_index_entries_.end(),
+            [&](const SecondaryIndexEntry& a, const SecondaryIndexEntry& b) {
+              int c = value_of(a).compare(value_of(b));
+              return c < 0 || (c == 0 && a.ordinal < b.ordinal);
+            });
+
+  SecondaryIndexPB index;
+  faststring block;
+  Slice first_value;
+  auto flush_block = [&]() -> Status {
+    vector<Slice> v;
+    v.push_back(Slice(block));
+    BlockPointer ptr;
+    RETURN_NOT_OK(AddBlock(v, &ptr, "secondary index"));
+    SecondaryIndexPB::BlockPB* block_pb = index.add_blocks();
+    block_pb->set_first_value(first_value.data(), first_value.size());
+    ptr.CopyToPB(block_pb->mutable_ptr());
+    block.clear();
+    return Status::OK();
+  };
+  for (const SecondaryIndexEntry& e : secondary_index_entries_) {
+    if (block.size() >= options_.index_block_size) {
+      RETURN_NOT_OK(flush_block());
+    }
+    Slice value = value_of(e);
+    if (block.size() == 0) {
+      first_value = value;
+    }
+    PutVarint32(&block, value.size());
+    block.append(value.data(), value.size());
+    PutVarint32(&block, e.ordinal);
+  }
+  if (block.size() > 0) {
+    RETURN_NOT_OK(flush_block());
+  }
+  // The entries are no longer needed once written out.
+  secondary_index_entries_.clear();
+  secondary_index_entries_.shrink_to_fit();
+
+  faststring buf;
+  pb_util::SerializeToString(index, &buf);
+  secondary_index_values_.clear();
+  vector<Slice> v;
+  v.push_back(Slice(buf));
+  BlockPointer ptr;
+  RETURN_NOT_OK(AddBlock(v, &ptr, "secondary index directory", BlockCache::HIGH_PRIORITY));
+  ptr.CopyToPB(footer->mutable_secondary_index_ptr());
+  return Status::OK();
+}
+
+Status CFileWriter::WriteColumnStats(CFileFooterPB* footer) {
+  ColumnStatisticsPB pb;
+  column_stats_->ToPB(&pb);
+  faststring buf;
+  pb_util::SerializeToString(pb, &buf);
+  vector<Slice> v;
+  v.push_back(Slice(buf));
+  BlockPointer ptr;
+  RETURN_NOT_OK(AddBlock(v, &ptr, "column statistics"));
+  ptr.CopyToPB(footer->mutable_column_stats_ptr());
+  return Status::OK();
+}
+
+Status CFileWriter::HoldBackDataBlock(const vector<Slice>& data_slices,
+                                      size_t ordinal_pos,
+                                      const void* validx_curr) {
+  unique_ptr<PendingDataBlock> block(new PendingDataBlock());
+  for (const Slice& data : data_slices) {
+    block->data.append(data.data(), data.size());
+  }
+  block->ordinal_pos = ordinal_pos;
+  if (validx_builder_ != nullptr) {
+    // The key may point into the block builder, so it must be encoded now.
+    key_encoder_->ResetAndEncode(validx_curr, &block->validx_key);
+    block->validx_prev.assign_copy(last_key_.data(), last_key_.size());
+  }
+  pending_data_bytes_ += block->data.size();
+  pending_data_blocks_.emplace_back(std::move(block));
+
+  if (pending_data_blocks_.size() >=
+      std::max(1, FLAGS_cfile_zstd_dictionary_training_blocks)) {
+    return TrainDictionaryAndFlushDataBlocks();
+  }
+  return Status::OK();
+}
+
+Status CFileWriter::TrainDictionaryAndFlushDataBlocks() {
+  DCHECK(dictionary_training_pending_);
+  dictionary_training_pending_ = false;
+
+  vector<Slice> samples;
+  for (const auto& block : pending_data_blocks_) {
+    Slice data(block->data);
+    while (!data.empty()) {
+      size_t n = std::min(data.size(), kDictionarySampleSize);
+      samples.emplace_back(data.data(), n);
+      data.remove_prefix(n);
+    }
+  }
+
+  faststring dictionary;
+  Status s = TrainCompressionDictionary(compression_, samples,
+                                        FLAGS_cfile_zstd_dictionary_size, &dictionary);
+  if (s.ok()) {
+    RETURN_NOT_OK(NewCompressionCodecWithDictionary(compression_, Slice(dictionary),
+                                                    &compression_dictionary_codec_));
+    // The dictionary is needed to decompress any other block, so it is
+    // itself stored uncompressed.
+    uint64_t start_offset = off_;
+    RETURN_NOT_OK(WriteRawData(Slice(dictionary)));
+    compression_dictionary_ptr_ = BlockPointer(start_offset, dictionary.size());
+    block_compressor_.reset(new CompressedBlockBuilder(compression_dictionary_codec_.get()));
+    VLOG(1) << "Trained a " << dictionary.size() << " byte compression dictionary for "
+            << ToString();
+  } else {
+    // The data is not suitable for training (e.g. it's too small): just
+    // compress it without a dictionary.
+    VLOG(1) << "Not using a compression dictionary for " << ToString() << ": "
+            << s.ToString();
+  }
+
+  for (const auto& block : pending_data_blocks_) {
+    vector<Slice> v = { Slice(block->data) };
+    RETURN_NOT_OK(AppendBlockAndIndexEntries(v, block->ordinal_pos,
+                                             Slice(block->validx_key),
+                                             Slice(block->validx_prev),
+                                             "data block"));
+  }
+  pending_data_blocks_.clear();
+  pending_data_bytes_ = 0;
+  return Status::OK();
+}
+
 Status CFileWriter::AppendRawBlock(const vector<Slice> &data_slices,
                                    size_t ordinal_pos,
                                    const void *validx_curr,
                                    const Slice &validx_prev,
-                                   const char *name_for_log) {
+                                   const char *name_for_log,
+                                   BlockCache::Priority priority) {
   CHECK_EQ(state_, kWriterWriting);
 
+  if (validx_builder_ != nullptr) {
+    CHECK(validx_curr != nullptr) <<
+      "must pass a key for raw block if validx is configured";
+    key_encoder_->ResetAndEncode(validx_curr, &validx_key_buf_);
+  }
+  return AppendBlockAndIndexEntries(data_slices, ordinal_pos, Slice(validx_key_buf_),
+                                    validx_prev, name_for_log, priority);
+}
+
+Status CFileWriter::AppendBlockAndIndexEntries(const vector<Slice>& data_slices,
+                                               size_t ordinal_pos,
+                                               const Slice& validx_key,
+                                               const Slice& validx_prev,
+                                               const char* name_for_log,
+                                               BlockCache::Priority priority) {
   BlockPointer ptr;
-  Status s = AddBlock(data_slices, &ptr, name_for_log);
+  Status s = AddBlock(data_slices, &ptr, name_for_log, priority);
   if (!s.ok()) {
     LOG(WARNING) << "Unable to append block to file: " << s.ToString();
     return s;
@@ -422,11 +997,7 @@ Status CFileWriter::AppendRawBlock(const vector<Slice> &data_slices,
   }
 
   if (validx_builder_ != nullptr) {
-    CHECK(validx_curr != nullptr) <<
-      "must pass a key for raw block if validx is configured";
-
-    key_encoder_->ResetAndEncode(validx_curr, &tmp_buf_);
-    Slice idx_key = Slice(tmp_buf_);
+    Slice idx_key = validx_key;
     if (options_.optimize_index_keys) {
       GetSeparatingKey(validx_prev, &idx_key);
     }
@@ -445,13 +1016,16 @@ Status CFileWriter::AppendRawBlock(const vector<Slice> &data_slices,
 size_t CFileWriter::written_size() const {
   // This is a low estimate, but that's OK -- this is checked after every block
   // write during flush/compact, so better to give a fast slightly-inaccurate result
-  // than spend a lot of effort trying to improve accuracy by a few KB.
-  return off_;
+  // than spend a lot of effort trying to improve accuracy by a few KB. Data blocks
+  // held back for dictionary training and values held back for the encoding
+  // selection are counted unencoded and uncompressed.
+  return off_ + pending_data_bytes_ + sample_cells_.size() + sample_bytes_;
 }
 
 Status CFileWriter::AddBlock(const vector<Slice> &data_slices,
                              BlockPointer *block_ptr,
-                             const char *name_for_log) {
+                             const char *name_for_log,
+                             BlockCache::Priority priority) {
   uint64_t start_offset = off_;
   vector<Slice> out_slices;
 
@@ -467,18 +1041,58 @@ Status CFileWriter::AddBlock(const vector<Slice> &data_slices,
     out_slices = data_slices;
   }
 
+  uint64_t crc32 = 0;
   for (const Slice &data : out_slices) {
     RETURN_NOT_OK(WriteRawData(data));
+    if (options_.write_checksums) {
+      crc::GetCrc32cInstance()->Compute(data.data(), data.size(), &crc32);
+    }
   }
 
   uint64_t total_size = off_ - start_offset;
+  if (options_.write_checksums) {
+    uint8_t checksum[kBlockChecksumSize];
+    EncodeFixed32(checksum, static_cast<uint32_t>(crc32));
+    RETURN_NOT_OK(WriteRawData(Slice(checksum, kBlockChecksumSize)));
+  }
 
   *block_ptr = BlockPointer(start_offset, total_size);
   VLOG(1) << "Appended " << name_for_log
           << " with " << total_size << " bytes at " << start_offset;
+
+  if (options_.cache_written_blocks) {
+    CacheWrittenBlock(start_offset, data_slices, priority);
+  }
   return Status::OK();
 }
 
+void CFileWriter::CacheWrittenBlock(uint64_t offset, const vector<Slice>& data_slices,
+                                    BlockCache::Priority priority) {
+  size_t size = 0;
+  for (const Slice& data : data_slices) {
+    size += data.size();
+  }
+  if (size == 0) {
+    return;
+  }
+
+  // Cache the block as CFileReader::ReadBlock() would after reading it back:
+  // under the same key, uncompressed.
+  BlockCache* cache = BlockCache::GetSingleton();
+  BlockCache::PendingEntry entry = cache->Allocate(BlockCache::CacheKey(block_->id(), offset),
+                                                   size, priority);
+  if (!entry.valid()) {
+    return;
+  }
+  uint8_t* dst = entry.val_ptr();
+  for (const Slice& data : data_slices) {
+    memcpy(dst, data.data(), data.size());
+    dst += data.size();
+  }
+  BlockCacheHandle handle;
+  cache->Insert(&entry, &handle, options_.block_cache_attribution.get());
+}
+
 Status CFileWriter::WriteRawData(const Slice& data) {
   Status s = block_->Append(data);
   if (!s.ok()) {
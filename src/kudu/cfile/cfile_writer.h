@@ -18,6 +18,7 @@
 #ifndef KUDU_CFILE_CFILE_WRITER_H
 #define KUDU_CFILE_CFILE_WRITER_H
 
+#include <memory>
 #include <unordered_map>
 #include <stdint.h>
 #include <string>
@@ -26,6 +27,7 @@
 
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/block_compression.h"
+#include "kudu/cfile/block_pointer.h"
 #include "kudu/cfile/cfile.pb.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/type_encodings.h"
@@ -42,6 +44,7 @@
 
 namespace kudu {
 class Arena;
+class ColumnStatistics;
 
 namespace cfile {
 using std::unordered_map;
@@ -55,6 +58,10 @@ extern const char kMagicStringV1[];
 extern const char kMagicStringV2[];
 extern const int kMagicLength;
 
+// Size of the checksum which follows each block of files with
+// CFileFooterPB::BLOCK_CHECKSUMS.
+const size_t kBlockChecksumSize = sizeof(uint32_t);
+
 class NullBitmapBuilder {
  public:
   explicit NullBitmapBuilder(size_t initial_row_capacity)
@@ -143,7 +150,8 @@ class CFileWriter {
                         size_t ordinal_pos,
                         const void *validx_curr,
                         const Slice &validx_prev,
-                        const char *name_for_log);
+                        const char *name_for_log,
+                        BlockCache::Priority priority = BlockCache::NORMAL_PRIORITY);
 
 
   // Return the amount of data written so far to this CFile.
@@ -157,6 +165,16 @@ class CFileWriter {
     return value_count_;
   }
 
+  // Return the number of values in the data block being built, i.e. appended
+  // since the last data block was finished: it drops to zero when an append
+  // fills and finishes the block. Only valid for a non-nullable CFile with an
+  // explicit encoding.
+  size_t unfinished_block_value_count() const {
+    DCHECK(!is_nullable_);
+    DCHECK(data_block_);
+    return data_block_->Count();
+  }
+
   std::string ToString() const { return block_->id().ToString(); }
 
   // Wrapper for AddBlock() to append the dictionary block to the end of a Cfile.
@@ -172,15 +190,84 @@ class CFileWriter {
 
   // Append the given block into the file.
   //
-  // Sets *block_ptr to correspond to the newly inserted block.
+  // Sets *block_ptr to correspond to the newly inserted block. 'priority' is
+  // the priority the block is looked up in the block cache with.
   Status AddBlock(const vector<Slice> &data_slices,
                   BlockPointer *block_ptr,
-                  const char *name_for_log);
+                  const char *name_for_log,
+                  BlockCache::Priority priority = BlockCache::NORMAL_PRIORITY);
+
+  // Inserts the block written at 'offset' into the block cache, if there is
+  // room for it. See WriterOptions::cache_written_blocks.
+  void CacheWrittenBlock(uint64_t offset, const vector<Slice>& data_slices,
+                         BlockCache::Priority priority);
 
   Status WriteRawData(const Slice& data);
 
   Status FinishCurDataBlock();
 
+  // Like AppendRawBlock(), but with the value index key already encoded.
+  Status AppendBlockAndIndexEntries(const vector<Slice>& data_slices,
+                                    size_t ordinal_pos,
+                                    const Slice& validx_key,
+                                    const Slice& validx_prev,
+                                    const char* name_for_log,
+                                    BlockCache::Priority priority = BlockCache::NORMAL_PRIORITY);
+
+  // Keep a copy of the given data block instead of writing it, until enough
+  // blocks have been collected to train the compression dictionary on.
+  Status HoldBackDataBlock(const vector<Slice>& data_slices,
+                           size_t ordinal_pos,
+                           const void* validx_curr);
+
+  // Train the compression dictionary on the held back data blocks, write it
+  // out, and write out the held back blocks compressed with it. If training
+  // fails, the blocks are compressed without a dictionary.
+  Status TrainDictionaryAndFlushDataBlocks();
+
+  // Keep a copy of the given cells instead of appending them, until enough
+  // have been collected to choose the encoding of the file.
+  Status SampleEntries(const uint8_t* bitmap, const void* entries, size_t count);
+
+  // Choose the encoding producing the smallest output for the sampled cells,
+  // then append them.
+  Status SelectEncodingAndAppendSample();
+
+  // Set 'size' to the number of bytes the 'count' non-null 'cells' take up
+  // when encoded with 'encoding_info' and compressed.
+  Status EstimateEncodedSize(const TypeEncodingInfo* encoding_info,
+                             const uint8_t* cells,
+                             size_t count,
+                             int64_t* size);
+
+  // Fold the 'count' non-null cells starting at 'cells' into the min/max
+  // statistics of the current data block.
+  void UpdateBlockStats(const uint8_t* cells, size_t count);
+
+  // Write out the accumulated block statistics and point 'footer' at them.
+  Status WriteBlockStats(CFileFooterPB* footer);
+
+  // Add the 'count' non-null cells starting at 'cells' to the value bloom
+  // filters.
+  void AddToValueBloom(const uint8_t* cells, size_t count);
+
+  // Move the filter being built into value_bloom_ and start a new one.
+  void FinishValueBloomFilter();
+
+  // Write out the value bloom filters and point 'footer' at them.
+  Status WriteValueBloom(CFileFooterPB* footer);
+
+  // Add the 'count' non-null cells starting at 'cells', the first of which is
+  // at ordinal 'first_ordinal', to the secondary index.
+  void AddToSecondaryIndex(const uint8_t* cells, size_t count, rowid_t first_ordinal);
+
+  // Sort the secondary index entries, write them out and point 'footer' at
+  // the directory of their blocks.
+  Status WriteSecondaryIndex(CFileFooterPB* footer);
+
+  // Write out the column statistics and point 'footer' at them.
+  Status WriteColumnStats(CFileFooterPB* footer);
+
   // Flush the current unflushed_metadata_ entries into the given protobuf
   // field, clearing the buffer.
   void FlushMetadataToPB(google::protobuf::RepeatedPtrField<FileMetadataPairPB> *field);
@@ -213,6 +300,39 @@ class CFileWriter {
   // a temporary buffer for encoding
   faststring tmp_buf_;
 
+  // The encoded value index key of the block being appended.
+  faststring validx_key_buf_;
+
+  // Statistics of the data blocks written so far, and the minimum and maximum
+  // non-null values of the current data block. Only used if
+  // WriterOptions::write_block_stats is set.
+  BlockStatsPB block_stats_;
+  std::string cur_block_min_;
+  std::string cur_block_max_;
+  bool cur_block_has_values_;
+
+  // The finished value bloom filters, the one being built, and the last value
+  // added to it. Only used if WriterOptions::write_value_bloom is set.
+  ValueBloomFilterPB value_bloom_;
+  gscoped_ptr<BloomFilterBuilder> value_bloom_builder_;
+  faststring last_bloom_value_;
+
+  // The key-encoded values of the non-null cells, and an entry per cell
+  // locating its value and holding its ordinal. The entries are sorted by
+  // value into the secondary index when the file is finished. Only used if
+  // WriterOptions::write_secondary_index is set.
+  struct SecondaryIndexEntry {
+    size_t offset;
+    uint32_t size;
+    rowid_t ordinal;
+  };
+  faststring secondary_index_values_;
+  std::vector<SecondaryIndexEntry> secondary_index_entries_;
+
+  // Statistics over the values appended so far. Only set if
+  // WriterOptions::write_column_stats is set.
+  gscoped_ptr<ColumnStatistics> column_stats_;
+
   // Metadata which has been added to the writer but not yet flushed.
   vector<pair<string, string> > unflushed_metadata_;
 
@@ -222,6 +342,38 @@ class CFileWriter {
   gscoped_ptr<NullBitmapBuilder> null_bitmap_builder_;
   gscoped_ptr<CompressedBlockBuilder> block_compressor_;
 
+  // A data block held back by HoldBackDataBlock().
+  struct PendingDataBlock {
+    faststring data;
+    size_t ordinal_pos;
+    faststring validx_key;
+    faststring validx_prev;
+  };
+
+  // Whether data blocks are being held back until the compression dictionary
+  // is trained, the blocks held back so far, and their total size.
+  bool dictionary_training_pending_;
+  std::vector<std::unique_ptr<PendingDataBlock>> pending_data_blocks_;
+  size_t pending_data_bytes_;
+
+  // The codec using the trained compression dictionary, and the location of
+  // the dictionary in the file. Unset if the file has no dictionary.
+  std::unique_ptr<CompressionCodec> compression_dictionary_codec_;
+  BlockPointer compression_dictionary_ptr_;
+
+  // Whether the cells are being sampled to choose the encoding, the sampled
+  // cells and their null bitmap (if nullable), and the memory holding the
+  // sampled binary values.
+  bool encoding_selection_pending_;
+  faststring sample_cells_;
+  faststring sample_null_bitmap_;
+  size_t num_sample_cells_;
+  size_t sample_bytes_;
+  std::unique_ptr<Arena> sample_arena_;
+
+  // How the encoding was chosen. Empty unless it was chosen by sampling.
+  EncodingSelectionPB encoding_selection_;
+
   enum State {
     kWriterInitialized,
     kWriterWriting,
@@ -0,0 +1,465 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+//
+// Delta encoding with frame-of-reference bit-packing for integer types.
+//
+// The values of a block are split into groups of kDeltaGroupSize values.
+// Within a group, each value after the first is stored as the difference
+// from its predecessor, less the smallest such difference in the group (the
+// group's "frame of reference"). The remainders are bit-packed with the
+// minimal width able to represent the largest of them. Monotonically
+// increasing values with a steady rate, such as timestamps or counters,
+// therefore need only a few bits per value, or none at all if the rate is
+// constant.
+//
+// Block layout:
+//
+//   num_elems      fixed32
+//   ordinal_pos    fixed32
+//   group[0]
+//   ...
+//   group[n-1]
+//   group_offset   fixed32 (one per group, relative to the start of the block)
+//
+// Group layout:
+//
+//   first_value    the first value in the group, in its little-endian cell format
+//   min_delta      zigzag-encoded varint64
+//   bit_width      1 byte
+//   remainders     (count - 1) values of 'bit_width' bits, as packed by BitWriter
+//
+// Each group is self-contained, so seeking to a position only requires
+// decoding the group containing it.
+#ifndef KUDU_CFILE_DELTA_BLOCK_H
+#define KUDU_CFILE_DELTA_BLOCK_H
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#include "kudu/cfile/block_encodings.h"
+#include "kudu/cfile/cfile_util.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/port.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bit-stream-utils.inline.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+
+namespace kudu {
+namespace cfile {
+
+struct WriterOptions;
+
+enum {
+  kDeltaBlockHeaderSize = 8,
+  kDeltaGroupSize = 128
+};
+
+inline uint64_t ZigZagEncode64(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t ZigZagDecode64(uint64_t v) {
+  return static_cast<int64_t>((v >> 1) ^ -(v & 1));
+}
+
+//
+// Delta/frame-of-reference builder for the integer types.
+//
+template<DataType IntType>
+class DeltaBlockBuilder final : public BlockBuilder {
+ public:
+  explicit DeltaBlockBuilder(const WriterOptions* options)
+      : options_(options) {
+    Reset();
+  }
+
+  virtual bool IsBlockFull() const OVERRIDE {
+    return buf_.size() + pending_.size() * kCppTypeSize >
+        options_->storage_attributes.cfile_block_size;
+  }
+
+  virtual int Add(const uint8_t* vals_void, size_t count) OVERRIDE {
+    const CppType* vals = reinterpret_cast<const CppType*>(vals_void);
+    size_t added = 0;
+    while (added < count) {
+      if (PREDICT_FALSE(count_ == 0)) {
+        first_key_ = vals[added];
+      }
+      pending_.push_back(vals[added]);
+      added++;
+      count_++;
+      if (pending_.size() == kDeltaGroupSize) {
+        FlushGroup();
+        // Stop at a group boundary once the block is full, so that the
+        // CFileWriter can start a new block.
+        if (IsBlockFull()) {
+          break;
+        }
+      }
+    }
+    if (added > 0) {
+      last_key_ = vals[added - 1];
+    }
+    return added;
+  }
+
+  virtual Slice Finish(rowid_t ordinal_pos) OVERRIDE {
+    FlushGroup();
+    for (uint32_t offset : group_offsets_) {
+      PutFixed32(&buf_, offset);
+    }
+    InlineEncodeFixed32(&buf_[0], count_);
+    InlineEncodeFixed32(&buf_[4], ordinal_pos);
+    return Slice(buf_);
+  }
+
+  virtual void Reset() OVERRIDE {
+    count_ = 0;
+    pending_.clear();
+    pending_.reserve(kDeltaGroupSize);
+    group_offsets_.clear();
+    buf_.clear();
+    buf_.resize(kDeltaBlockHeaderSize);
+  }
+
+  virtual size_t Count() const OVERRIDE {
+    return count_;
+  }
+
+  virtual Status GetFirstKey(void* key) const OVERRIDE {
+    if (PREDICT_FALSE(count_ == 0)) {
+      return Status::NotFound("No keys in the block");
+    }
+    *reinterpret_cast<CppType*>(key) = first_key_;
+    return Status::OK();
+  }
+
+  virtual Status GetLastKey(void* key) const OVERRIDE {
+    if (PREDICT_FALSE(count_ == 0)) {
+      return Status::NotFound("No keys in the block");
+    }
+    *reinterpret_cast<CppType*>(key) = last_key_;
+    return Status::OK();
+  }
+
+ private:
+  typedef typename TypeTraits<IntType>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+  typedef typename std::make_signed<CppType>::type SignedType;
+
+  enum {
+    kCppTypeSize = TypeTraits<IntType>::size
+  };
+
+  // Encode the pending values as a group at the end of buf_.
+  void FlushGroup() {
+    if (pending_.empty()) {
+      return;
+    }
+    group_offsets_.push_back(buf_.size());
+
+    // Deltas are computed with wrapping unsigned arithmetic and interpreted as
+    // signed, so that any sequence round-trips.
+    const size_t n = pending_.size();
+    SignedType min_delta = 0;
+    for (size_t i = 1; i < n; i++) {
+      SignedType delta = static_cast<SignedType>(Delta(pending_[i - 1], pending_[i]));
+      if (i == 1 || delta < min_delta) {
+        min_delta = delta;
+      }
+    }
+    UnsignedType max_remainder = 0;
+    for (size_t i = 1; i < n; i++) {
+      max_remainder = std::max(max_remainder, Remainder(i, min_delta));
+    }
+    int bit_width = Bits::Log2Floor64(max_remainder) + 1;
+
+    UnsignedType first = pending_[0];
+    buf_.append(&first, kCppTypeSize);
+    PutVarint64(&buf_, ZigZagEncode64(min_delta));
+    buf_.push_back(static_cast<uint8_t>(bit_width));
+    if (bit_width > 0) {
+      BitWriter writer(&packed_);
+      for (size_t i = 1; i < n; i++) {
+        writer.PutValue(Remainder(i, min_delta), bit_width);
+      }
+      writer.Flush();
+      buf_.append(packed_.data(), writer.bytes_written());
+    }
+    pending_.clear();
+  }
+
+  static UnsignedType Delta(CppType prev, CppType cur) {
+    return static_cast<UnsignedType>(static_cast<UnsignedType>(cur) -
+                                     static_cast<UnsignedType>(prev));
+  }
+
+  UnsignedType Remainder(size_t i, SignedType min_delta) const {
+    return static_cast<UnsignedType>(Delta(pending_[i - 1], pending_[i]) -
+                                     static_cast<UnsignedType>(min_delta));
+  }
+
+  CppType first_key_;
+  CppType last_key_;
+  size_t count_;
+
+  // Values not yet encoded into a group.
+  std::vector<CppType> pending_;
+
+  // The offsets of the groups written into buf_.
+  std::vector<uint32_t> group_offsets_;
+
+  faststring buf_;
+
+  // Scratch space for bit-packing a group.
+  faststring packed_;
+
+  const WriterOptions* const options_;
+};
+
+//
+// Delta/frame-of-reference decoder for the integer types.
+//
+template<DataType IntType>
+class DeltaBlockDecoder final : public BlockDecoder {
+ public:
+  explicit DeltaBlockDecoder(Slice slice)
+      : data_(std::move(slice)),
+        parsed_(false),
+        num_elems_(0),
+        ordinal_pos_base_(0),
+        num_groups_(0),
+        group_offsets_(nullptr),
+        cur_idx_(0),
+        decoded_group_(-1),
+        decoded_count_(0) {
+  }
+
+  virtual Status ParseHeader() OVERRIDE {
+    CHECK(!parsed_);
+
+    if (data_.size() < kDeltaBlockHeaderSize) {
+      return Status::Corruption(
+          "not enough bytes for header in DeltaBlockDecoder");
+    }
+
+    num_elems_ = DecodeFixed32(&data_[0]);
+    ordinal_pos_base_ = DecodeFixed32(&data_[4]);
+    num_groups_ = (num_elems_ + kDeltaGroupSize - 1) / kDeltaGroupSize;
+
+    if (data_.size() < kDeltaBlockHeaderSize + num_groups_ * (sizeof(uint32_t) + kCppTypeSize)) {
+      return Status::Corruption(
+          strings::Substitute("not enough bytes for $0 values in DeltaBlockDecoder",
+                              num_elems_));
+    }
+    group_offsets_ = data_.data() + data_.size() - num_groups_ * sizeof(uint32_t);
+
+    // Validate the group offsets up front, so that they can be used without
+    // further checks when seeking.
+    uint32_t prev_end = kDeltaBlockHeaderSize;
+    for (uint32_t i = 0; i < num_groups_; i++) {
+      uint32_t offset = GroupOffset(i);
+      if (offset < prev_end || offset + kCppTypeSize > GroupOffsetsStart()) {
+        return Status::Corruption(
+            strings::Substitute("bad offset $0 for group $1 in DeltaBlockDecoder", offset, i));
+      }
+      prev_end = offset + kCppTypeSize;
+    }
+
+    parsed_ = true;
+    cur_idx_ = 0;
+    return Status::OK();
+  }
+
+  virtual void SeekToPositionInBlock(uint pos) OVERRIDE {
+    CHECK(parsed_) << "Must call ParseHeader()";
+    DCHECK_LE(pos, num_elems_);
+    cur_idx_ = pos;
+  }
+
+  virtual Status SeekAtOrAfterValue(const void* value_void, bool* exact_match) OVERRIDE {
+    DCHECK(parsed_);
+    CppType target = *reinterpret_cast<const CppType*>(value_void);
+
+    // Like the other encodings, this assumes the values are sorted, as is the
+    // case for key columns. Find the first group whose first value is not less
+    // than the target: the target's position is either in the preceding group
+    // or at the start of that one.
+    uint32_t left = 0;
+    uint32_t right = num_groups_;
+    while (left != right) {
+      uint32_t mid = (left + right) / 2;
+      if (GroupFirstValue(mid) < target) {
+        left = mid + 1;
+      } else {
+        right = mid;
+      }
+    }
+    if (left == 0) {
+      cur_idx_ = 0;
+      *exact_match = num_elems_ > 0 && GroupFirstValue(0) == target;
+      return num_elems_ == 0 ? Status::NotFound("after last key in block") : Status::OK();
+    }
+    uint32_t group = left - 1;
+    RETURN_NOT_OK(DecodeGroup(group));
+
+    const CppType* begin = group_values_;
+    const CppType* end = group_values_ + decoded_count_;
+    const CppType* it = std::lower_bound(begin, end, target);
+    cur_idx_ = group * kDeltaGroupSize + (it - begin);
+    if (cur_idx_ == num_elems_) {
+      return Status::NotFound("after last key in block");
+    }
+    // If the target is beyond the group, it is at or before the first value
+    // of the next one.
+    *exact_match = it != end ? *it == target : GroupFirstValue(left) == target;
+    return Status::OK();
+  }
+
+  virtual Status CopyNextValues(size_t* n, ColumnDataView* dst) OVERRIDE {
+    DCHECK(parsed_);
+    DCHECK_LE(*n, dst->nrows());
+    DCHECK_EQ(dst->stride(), sizeof(CppType));
+
+    if (PREDICT_FALSE(*n == 0 || cur_idx_ >= num_elems_)) {
+      *n = 0;
+      return Status::OK();
+    }
+
+    size_t to_fetch = std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_));
+    uint8_t* out = dst->data();
+    size_t fetched = 0;
+    while (fetched < to_fetch) {
+      int group = cur_idx_ / kDeltaGroupSize;
+      if (group != decoded_group_) {
+        RETURN_NOT_OK(DecodeGroup(group));
+      }
+      size_t idx_in_group = cur_idx_ % kDeltaGroupSize;
+      size_t count = std::min(to_fetch - fetched, decoded_count_ - idx_in_group);
+      memcpy(out + fetched * kCppTypeSize, &group_values_[idx_in_group], count * kCppTypeSize);
+      fetched += count;
+      cur_idx_ += count;
+    }
+
+    *n = to_fetch;
+    return Status::OK();
+  }
+
+  virtual bool HasNext() const OVERRIDE {
+    return cur_idx_ < num_elems_;
+  }
+
+  virtual size_t Count() const OVERRIDE {
+    return num_elems_;
+  }
+
+  virtual size_t GetCurrentIndex() const OVERRIDE {
+    return cur_idx_;
+  }
+
+  virtual rowid_t GetFirstRowId() const OVERRIDE {
+    return ordinal_pos_base_;
+  }
+
+ private:
+  typedef typename TypeTraits<IntType>::cpp_type CppType;
+  typedef typename std::make_unsigned<CppType>::type UnsignedType;
+
+  enum {
+    kCppTypeSize = TypeTraits<IntType>::size
+  };
+
+  uint32_t GroupOffsetsStart() const {
+    return group_offsets_ - data_.data();
+  }
+
+  uint32_t GroupOffset(uint32_t group) const {
+    return DecodeFixed32(group_offsets_ + group * sizeof(uint32_t));
+  }
+
+  CppType GroupFirstValue(uint32_t group) const {
+    CppType v;
+    memcpy(&v, data_.data() + GroupOffset(group), kCppTypeSize);
+    return v;
+  }
+
+  // Decode all values of 'group' into group_values_.
+  Status DecodeGroup(uint32_t group) {
+    const uint8_t* p = data_.data() + GroupOffset(group);
+    const uint8_t* limit = data_.data() +
+        (group + 1 < num_groups_ ? GroupOffset(group + 1) : GroupOffsetsStart());
+    size_t count = std::min<size_t>(kDeltaGroupSize, num_elems_ - group * kDeltaGroupSize);
+
+    UnsignedType* values = reinterpret_cast<UnsignedType*>(group_values_);
+    memcpy(&values[0], p, kCppTypeSize);
+    p += kCppTypeSize;
+
+    uint64_t zigzag_min_delta;
+    p = GetVarint64Ptr(p, limit, &zigzag_min_delta);
+    if (PREDICT_FALSE(p == nullptr || p >= limit)) {
+      return Status::Corruption(
+          strings::Substitute("bad header for group $0 in DeltaBlockDecoder", group));
+    }
+    UnsignedType min_delta = static_cast<UnsignedType>(ZigZagDecode64(zigzag_min_delta));
+    int bit_width = *p++;
+    if (PREDICT_FALSE(bit_width > kCppTypeSize * 8)) {
+      return Status::Corruption(
+          strings::Substitute("bad bit width $0 for group $1 in DeltaBlockDecoder",
+                              bit_width, group));
+    }
+
+    if (bit_width == 0) {
+      std::fill(&values[1], &values[count], 0);
+    } else {
+      BitReader reader(p, limit - p);
+      if (PREDICT_FALSE(reader.GetBatch(bit_width, &values[1], count - 1) !=
+                        static_cast<int>(count - 1))) {
+        return Status::Corruption(
+            strings::Substitute("not enough bytes for group $0 in DeltaBlockDecoder", group));
+      }
+    }
+    for (size_t i = 1; i < count; i++) {
+      values[i] = static_cast<UnsignedType>(values[i - 1] + min_delta + values[i]);
+    }
+
+    decoded_group_ = group;
+    decoded_count_ = count;
+    return Status::OK();
+  }
+
+  Slice data_;
+  bool parsed_;
+  uint32_t num_elems_;
+  rowid_t ordinal_pos_base_;
+  uint32_t num_groups_;
+  const uint8_t* group_offsets_;
+  uint32_t cur_idx_;
+
+  // The values of the most recently decoded group.
+  int decoded_group_;
+  size_t decoded_count_;
+  CppType group_values_[kDeltaGroupSize];
+};
+
+} // namespace cfile
+} // namespace kudu
+
+#endif
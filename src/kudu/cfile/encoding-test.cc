@@ -25,6 +25,7 @@
 #include "kudu/cfile/block_encodings.h"
 #include "kudu/cfile/bshuf_block.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/cfile/delta_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
@@ -705,6 +706,45 @@ TEST_F(TestEncoding, TestRleIntBlockEncoder) {
   ASSERT_EQ(14UL, s.size());
 }
 
+TEST_F(TestEncoding, TestDeltaIntBlockEncoder) {
+  unique_ptr<WriterOptions> opts(NewWriterOptions());
+  DeltaBlockBuilder<INT64> ibb(opts.get());
+
+  // Timestamps at a constant rate take no space beyond the group headers.
+  const int kNumValues = 10000;
+  vector<int64_t> timestamps(kNumValues);
+  for (int i = 0; i < kNumValues; i++) {
+    timestamps[i] = 1488000000000000L + i * 1000000L;
+  }
+  ASSERT_EQ(kNumValues, ibb.Add(reinterpret_cast<const uint8_t *>(timestamps.data()),
+                                kNumValues));
+  Slice s = ibb.Finish(12345);
+  LOG(INFO) << "Delta encoded size for 10k regular timestamps: " << s.size();
+  ASSERT_LT(s.size(), kNumValues * sizeof(int64_t) / 32);
+
+  // Jittery timestamps still only need a few bits per value.
+  ibb.Reset();
+  Random rng(SeedRandom());
+  for (int i = 0; i < kNumValues; i++) {
+    timestamps[i] = 1488000000000000L + i * 1000000L + rng.Uniform(1000);
+  }
+  ASSERT_EQ(kNumValues, ibb.Add(reinterpret_cast<const uint8_t *>(timestamps.data()),
+                                kNumValues));
+  s = ibb.Finish(12345);
+  LOG(INFO) << "Delta encoded size for 10k jittery timestamps: " << s.size();
+  ASSERT_LT(s.size(), kNumValues * sizeof(int64_t) / 3);
+
+  DeltaBlockDecoder<INT64> ibd(s);
+  ASSERT_OK(ibd.ParseHeader());
+  vector<int64_t> decoded(kNumValues);
+  ColumnBlock cb(GetTypeInfo(INT64), nullptr, decoded.data(), kNumValues, &arena_);
+  ColumnDataView cdv(&cb);
+  size_t n = kNumValues;
+  ASSERT_OK(ibd.CopyNextValues(&n, &cdv));
+  ASSERT_EQ(kNumValues, n);
+  ASSERT_EQ(timestamps, decoded);
+}
+
 TEST_F(TestEncoding, TestPlainBitMapRoundTrip) {
   TestBoolBlockRoundTrip<PlainBitMapBlockBuilder, PlainBitMapBlockDecoder>();
 }
@@ -789,7 +829,15 @@ struct BitshuffleTestTraits {
     typedef BShufBlockDecoder<type> decoder_type;
   };
 };
-typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits> MyTestFixtures;
+struct DeltaTestTraits {
+  template<DataType type>
+  struct Classes {
+    typedef DeltaBlockBuilder<type> encoder_type;
+    typedef DeltaBlockDecoder<type> decoder_type;
+  };
+};
+typedef testing::Types<RleTestTraits, BitshuffleTestTraits, PlainTestTraits,
+                       DeltaTestTraits> MyTestFixtures;
 TYPED_TEST_CASE(IntEncodingTest, MyTestFixtures);
 
 template<class TestTraits>
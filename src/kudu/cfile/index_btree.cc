@@ -148,7 +148,7 @@ Status IndexTreeBuilder::FinishAndWriteBlock(size_t level, BlockPointer *written
 
   vector<Slice> v;
   v.push_back(data);
-  Status s = writer_->AddBlock(v, written, "index block");
+  Status s = writer_->AddBlock(v, written, "index block", BlockCache::HIGH_PRIORITY);
   if (!s.ok()) {
     LOG(ERROR) << "Unable to append level-" << level << " index "
                << "block to file";
@@ -267,7 +267,8 @@ Status IndexTreeIterator::LoadBlock(const BlockPointer &block, int depth) {
     seeked = seeked_indexes_.back().get();
   }
 
-  RETURN_NOT_OK(reader_->ReadBlock(block, CFileReader::CACHE_BLOCK, &seeked->data));
+  RETURN_NOT_OK(reader_->ReadBlock(block, CFileReader::CACHE_BLOCK, &seeked->data,
+                                   BlockCache::HIGH_PRIORITY));
   seeked->block_ptr = block;
 
   // Parse the new block.
@@ -208,6 +208,20 @@ class PlainBlockDecoder final : public BlockDecoder {
     return Status::OK();
   }
 
+  virtual bool SupportsReferenceNextValues() const OVERRIDE {
+    return true;
+  }
+
+  virtual Status ReferenceNextValues(size_t *n, const uint8_t **data) OVERRIDE {
+    DCHECK(parsed_);
+    size_t max_fetch = cur_idx_ < num_elems_ ?
+        std::min(*n, static_cast<size_t>(num_elems_ - cur_idx_)) : 0;
+    *data = data_.data() + kPlainBlockHeaderSize + cur_idx_ * size_of_type;
+    cur_idx_ += max_fetch;
+    *n = max_fetch;
+    return Status::OK();
+  }
+
   virtual bool HasNext() const OVERRIDE {
     return cur_idx_ < num_elems_;
   }
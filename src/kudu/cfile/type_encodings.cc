@@ -19,10 +19,12 @@
 #include <unordered_map>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 
 #include "kudu/cfile/bshuf_block.h"
+#include "kudu/cfile/delta_block.h"
 #include "kudu/cfile/plain_bitmap_block.h"
 #include "kudu/cfile/plain_block.h"
 #include "kudu/cfile/rle_block.h"
@@ -30,6 +32,7 @@
 #include "kudu/cfile/binary_plain_block.h"
 #include "kudu/cfile/binary_prefix_block.h"
 #include "kudu/common/types.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 
 namespace kudu {
@@ -37,6 +40,7 @@ namespace cfile {
 
 using std::unordered_map;
 using std::shared_ptr;
+using std::vector;
 
 
 template<DataType Type, EncodingType Encoding>
@@ -182,6 +186,21 @@ struct DataTypeEncodingTraits<IntType, RLE> {
   }
 };
 
+template<DataType IntType>
+struct DataTypeEncodingTraits<IntType, DELTA_ENCODING> {
+
+  static Status CreateBlockBuilder(BlockBuilder** bb, const WriterOptions *options) {
+    *bb = new DeltaBlockBuilder<IntType>(options);
+    return Status::OK();
+  }
+
+  static Status CreateBlockDecoder(BlockDecoder** bd, const Slice& slice,
+                                   CFileIterator *iter) {
+    *bd = new DeltaBlockDecoder<IntType>(slice);
+    return Status::OK();
+  }
+};
+
 
 template<typename TypeEncodingTraitsClass>
 TypeEncodingInfo::TypeEncodingInfo(TypeEncodingTraitsClass t)
@@ -232,6 +251,10 @@ class TypeEncodingResolver {
     return default_mapping_[t];
   }
 
+  vector<EncodingType> GetSupportedEncodings(DataType t) {
+    return FindWithDefault(supported_encodings_, t, vector<EncodingType>());
+  }
+
   // Add the encoding mappings
   // the first encoder/decoder to be
   // added to the mapping becomes the default
@@ -240,27 +263,39 @@ class TypeEncodingResolver {
     AddMapping<UINT8, BIT_SHUFFLE>();
     AddMapping<UINT8, PLAIN_ENCODING>();
     AddMapping<UINT8, RLE>();
+    AddMapping<UINT8, DELTA_ENCODING>();
     AddMapping<INT8, BIT_SHUFFLE>();
     AddMapping<INT8, PLAIN_ENCODING>();
     AddMapping<INT8, RLE>();
+    AddMapping<INT8, DELTA_ENCODING>();
     AddMapping<UINT16, BIT_SHUFFLE>();
     AddMapping<UINT16, PLAIN_ENCODING>();
     AddMapping<UINT16, RLE>();
+    AddMapping<UINT16, DELTA_ENCODING>();
     AddMapping<INT16, BIT_SHUFFLE>();
     AddMapping<INT16, PLAIN_ENCODING>();
     AddMapping<INT16, RLE>();
+    AddMapping<INT16, DELTA_ENCODING>();
     AddMapping<UINT32, BIT_SHUFFLE>();
     AddMapping<UINT32, RLE>();
     AddMapping<UINT32, PLAIN_ENCODING>();
+    AddMapping<UINT32, DELTA_ENCODING>();
     AddMapping<INT32, BIT_SHUFFLE>();
     AddMapping<INT32, PLAIN_ENCODING>();
     AddMapping<INT32, RLE>();
+    AddMapping<INT32, DELTA_ENCODING>();
     AddMapping<UINT64, BIT_SHUFFLE>();
     AddMapping<UINT64, PLAIN_ENCODING>();
     AddMapping<UINT64, RLE>();
+    AddMapping<UINT64, DELTA_ENCODING>();
     AddMapping<INT64, BIT_SHUFFLE>();
     AddMapping<INT64, PLAIN_ENCODING>();
     AddMapping<INT64, RLE>();
+    AddMapping<INT64, DELTA_ENCODING>();
+    // RLE and DELTA_ENCODING work on at most 64-bit integers, so DECIMAL128
+    // columns are only bit-shuffled or plain-encoded.
+    AddMapping<INT128, BIT_SHUFFLE>();
+    AddMapping<INT128, PLAIN_ENCODING>();
     AddMapping<FLOAT, BIT_SHUFFLE>();
     AddMapping<FLOAT, PLAIN_ENCODING>();
     AddMapping<DOUBLE, BIT_SHUFFLE>();
@@ -277,6 +312,7 @@ class TypeEncodingResolver {
     pair<DataType, EncodingType> encoding_for_type = make_pair(type, encoding);
     if (mapping_.find(encoding_for_type) == mapping_.end()) {
       default_mapping_.insert(make_pair(type, encoding));
+      supported_encodings_[type].push_back(encoding);
     }
     mapping_.insert(
         make_pair(make_pair(type, encoding),
@@ -289,6 +325,9 @@ class TypeEncodingResolver {
 
   unordered_map<DataType, EncodingType, std::hash<size_t> > default_mapping_;
 
+  // The encodings of each type, in the order they were added.
+  unordered_map<DataType, vector<EncodingType>, std::hash<size_t> > supported_encodings_;
+
   friend class Singleton<TypeEncodingResolver>;
   DISALLOW_COPY_AND_ASSIGN(TypeEncodingResolver);
 };
@@ -305,6 +344,10 @@ const EncodingType TypeEncodingInfo::GetDefaultEncoding(const TypeInfo* typeinfo
   return Singleton<TypeEncodingResolver>::get()->GetDefaultEncoding(typeinfo->physical_type());
 }
 
+vector<EncodingType> TypeEncodingInfo::GetSupportedEncodings(const TypeInfo* typeinfo) {
+  return Singleton<TypeEncodingResolver>::get()->GetSupportedEncodings(typeinfo->physical_type());
+}
+
 }  // namespace cfile
 }  // namespace kudu
 
@@ -17,6 +17,8 @@
 #ifndef KUDU_CFILE_TYPE_ENCODINGS_H_
 #define KUDU_CFILE_TYPE_ENCODINGS_H_
 
+#include <vector>
+
 #include "kudu/common/common.pb.h"
 #include "kudu/util/status.h"
 
@@ -41,6 +43,10 @@ class TypeEncodingInfo {
 
   static const EncodingType GetDefaultEncoding(const TypeInfo* typeinfo);
 
+  // Return all the encodings supported for the given type, beginning with
+  // the default one.
+  static std::vector<EncodingType> GetSupportedEncodings(const TypeInfo* typeinfo);
+
   EncodingType encoding_type() const { return encoding_type_; }
 
   Status CreateBlockBuilder(BlockBuilder **bb, const WriterOptions *options) const;
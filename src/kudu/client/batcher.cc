@@ -49,8 +49,10 @@
 #include "kudu/rpc/request_tracker.h"
 #include "kudu/rpc/retriable_rpc.h"
 #include "kudu/rpc/rpc.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/debug-util.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/pb_util.h"
 
@@ -71,7 +73,12 @@ using rpc::RetriableRpc;
 using rpc::RetriableRpcStatus;
 using rpc::Rpc;
 using rpc::RpcController;
+using rpc::RpcSidecar;
 using rpc::ServerPicker;
+using tserver::MultiTabletWriteRequestPB;
+using tserver::MultiTabletWriteResponsePB;
+using tserver::TabletServerFeatures;
+using tserver::TabletServerServiceProxy;
 using tserver::WriteRequestPB;
 using tserver::WriteResponsePB;
 using tserver::WriteResponsePB_PerRowErrorPB;
@@ -187,6 +194,92 @@ struct InFlightOp {
   }
 };
 
+// Write batches whose encoded rows take at least this many bytes send them in
+// RPC sidecars, which the server decodes in place rather than copying them
+// out of the request.
+const size_t kMinRowOperationsSidecarBytes = 64 * 1024;
+
+// Writes to several tablets led by the same tablet server are combined into
+// MultiTabletWrite RPCs of at most this many bytes of buffered operations.
+const int64_t kMaxMultiTabletWriteBytes = 8 * 1024 * 1024;
+
+// Added operations are routed to their tablets in batches of this many, or
+// when the batch is flushed.
+const int kRoutingBatchSize = 256;
+
+namespace {
+
+// Fills in 'req' to write 'ops', which all belong to tablet 'tablet_id' of
+// 'table', and marks the ops as sent. Returns the size of the ops in the
+// session's buffer.
+int64_t EncodeWriteRequest(KuduSession::ExternalConsistencyMode consistency_mode,
+                           const KuduTable* table,
+                           const vector<InFlightOp*>& ops,
+                           const string& tablet_id,
+                           uint64_t propagated_timestamp,
+                           WriteRequestPB* req) {
+  const Schema* schema = table->schema().schema_;
+
+  req->set_tablet_id(tablet_id);
+  switch (consistency_mode) {
+    case kudu::client::KuduSession::CLIENT_PROPAGATED:
+      req->set_external_consistency_mode(kudu::CLIENT_PROPAGATED);
+      break;
+    case kudu::client::KuduSession::COMMIT_WAIT:
+      req->set_external_consistency_mode(kudu::COMMIT_WAIT);
+      break;
+    default:
+      LOG(FATAL) << "Unsupported consistency mode: " << consistency_mode;
+
+  }
+  // If set, propagate the latest observed timestamp.
+  if (PREDICT_TRUE(propagated_timestamp != KuduClient::kNoTimestamp)) {
+    req->set_propagated_timestamp(propagated_timestamp);
+  }
+
+  // Set up schema
+  CHECK_OK(SchemaToPB(*schema, req->mutable_schema(),
+                      SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
+
+  // Add the rows
+  int ctr = 0;
+  int64_t ops_bytes = 0;
+  RowOperationsPBEncoder enc(req->mutable_row_operations());
+  for (InFlightOp* op : ops) {
+#ifndef NDEBUG
+    const Partition& partition = op->tablet->partition();
+    const PartitionSchema& partition_schema = table->partition_schema();
+    const KuduPartialRow& row = op->write_op->row();
+    bool partition_contains_row;
+    CHECK(partition_schema.PartitionContainsRow(partition, row, &partition_contains_row).ok());
+    CHECK(partition_contains_row)
+        << "Row " << partition_schema.PartitionKeyDebugString(row)
+        << " not in partition " << partition_schema.PartitionDebugString(partition, *schema);
+#endif
+
+    enc.Add(ToInternalWriteType(op->write_op->type()), op->write_op->row());
+    ops_bytes += Batcher::GetOperationSizeInBuffer(op->write_op.get());
+
+    // Set the state now, even though we haven't yet sent it -- at this point
+    // there is no return, and we're definitely going to send it. If we waited
+    // until after we sent it, the RPC callback could fire before we got a chance
+    // to change its state to 'sent'.
+    op->state = InFlightOp::kRequestSent;
+    VLOG(4) << ++ctr << ". Encoded row " << op->ToString();
+  }
+  return ops_bytes;
+}
+
+int64_t OpsSizeInBuffer(const vector<InFlightOp*>& ops) {
+  int64_t bytes = 0;
+  for (const InFlightOp* op : ops) {
+    bytes += Batcher::GetOperationSizeInBuffer(op->write_op.get());
+  }
+  return bytes;
+}
+
+} // anonymous namespace
+
 // A Write RPC which is in-flight to a tablet. Initially, the RPC is sent
 // to the leader replica, but it may be retried with another replica if the
 // leader fails.
@@ -213,6 +306,9 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   const vector<InFlightOp*>& ops() const { return ops_; }
   const WriteResponsePB& resp() const { return resp_; }
   const string& tablet_id() const { return tablet_id_; }
+  int64_t ops_bytes() const { return ops_bytes_; }
+  const string& last_ts_uuid() const { return last_ts_uuid_; }
+  MonoTime last_attempt_start() const { return last_attempt_start_; }
 
  protected:
   void Try(RemoteTabletServer* replica, const ResponseCallback& callback) override;
@@ -220,6 +316,16 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
   void Finish(const Status& status) override;
 
  private:
+  // Moves the rows of the request back into the request from the sidecars,
+  // for servers which don't support ROW_OPERATIONS_IN_SIDECARS.
+  void InlineRowOperations();
+
+  // The encoded rows and indirect data of the request, if they're large
+  // enough to be sent in sidecars, which the server decodes in place. They're
+  // shared with the sidecars of each attempt.
+  shared_ptr<const faststring> rows_sidecar_;
+  shared_ptr<const faststring> indirect_data_sidecar_;
+
   // Pointer back to the batcher. Processes the write response when it
   // completes, regardless of success or failure.
   scoped_refptr<Batcher> batcher_;
@@ -230,6 +336,13 @@ class WriteRpc : public RetriableRpc<RemoteTabletServer, WriteRequestPB, WriteRe
 
   // The id of the tablet being written to.
   string tablet_id_;
+
+  // The size of the operations in the session's buffer.
+  int64_t ops_bytes_;
+
+  // The tablet server the latest attempt was sent to, and when.
+  string last_ts_uuid_;
+  MonoTime last_attempt_start_;
 };
 
 WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
@@ -243,55 +356,25 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
     : RetriableRpc(replica_picker, request_tracker, deadline, std::move(messenger)),
       batcher_(batcher),
       ops_(std::move(ops)),
-      tablet_id_(tablet_id) {
-  const Schema* schema = table()->schema().schema_;
-
-  req_.set_tablet_id(tablet_id_);
-  switch (batcher->external_consistency_mode()) {
-    case kudu::client::KuduSession::CLIENT_PROPAGATED:
-      req_.set_external_consistency_mode(kudu::CLIENT_PROPAGATED);
-      break;
-    case kudu::client::KuduSession::COMMIT_WAIT:
-      req_.set_external_consistency_mode(kudu::COMMIT_WAIT);
-      break;
-    default:
-      LOG(FATAL) << "Unsupported consistency mode: " << batcher->external_consistency_mode();
-
-  }
-  // If set, propagate the latest observed timestamp.
-  if (PREDICT_TRUE(propagated_timestamp != KuduClient::kNoTimestamp)) {
-    req_.set_propagated_timestamp(propagated_timestamp);
-  }
-
-  // Set up schema
-  CHECK_OK(SchemaToPB(*schema, req_.mutable_schema(),
-                      SCHEMA_PB_WITHOUT_STORAGE_ATTRIBUTES | SCHEMA_PB_WITHOUT_IDS));
+      tablet_id_(tablet_id),
+      ops_bytes_(0) {
+  ops_bytes_ = EncodeWriteRequest(batcher->external_consistency_mode(), table(), ops_,
+                                  tablet_id_, propagated_timestamp, &req_);
 
   RowOperationsPB* requested = req_.mutable_row_operations();
-
-  // Add the rows
-  int ctr = 0;
-  RowOperationsPBEncoder enc(requested);
-  for (InFlightOp* op : ops_) {
-#ifndef NDEBUG
-    const Partition& partition = op->tablet->partition();
-    const PartitionSchema& partition_schema = table()->partition_schema();
-    const KuduPartialRow& row = op->write_op->row();
-    bool partition_contains_row;
-    CHECK(partition_schema.PartitionContainsRow(partition, row, &partition_contains_row).ok());
-    CHECK(partition_contains_row)
-        << "Row " << partition_schema.PartitionKeyDebugString(row)
-        << " not in partition " << partition_schema.PartitionDebugString(partition, *schema);
-#endif
-
-    enc.Add(ToInternalWriteType(op->write_op->type()), op->write_op->row());
-
-    // Set the state now, even though we haven't yet sent it -- at this point
-    // there is no return, and we're definitely going to send it. If we waited
-    // until after we sent it, the RPC callback could fire before we got a chance
-    // to change its state to 'sent'.
-    op->state = InFlightOp::kRequestSent;
-    VLOG(4) << ++ctr << ". Encoded row " << op->ToString();
+  if (requested->rows().size() + requested->indirect_data().size() >=
+      kMinRowOperationsSidecarBytes) {
+    auto to_faststring = [](const string& s) {
+      shared_ptr<faststring> f(new faststring);
+      f->append(s.data(), s.size());
+      return f;
+    };
+    rows_sidecar_ = to_faststring(requested->rows());
+    requested->clear_rows();
+    if (!requested->indirect_data().empty()) {
+      indirect_data_sidecar_ = to_faststring(requested->indirect_data());
+      requested->clear_indirect_data();
+    }
   }
 
   if (VLOG_IS_ON(3)) {
@@ -299,6 +382,18 @@ WriteRpc::WriteRpc(const scoped_refptr<Batcher>& batcher,
   }
 }
 
+void WriteRpc::InlineRowOperations() {
+  RowOperationsPB* requested = req_.mutable_row_operations();
+  requested->clear_rows_sidecar();
+  requested->clear_indirect_data_sidecar();
+  requested->set_rows(rows_sidecar_->data(), rows_sidecar_->size());
+  if (indirect_data_sidecar_) {
+    requested->set_indirect_data(indirect_data_sidecar_->data(), indirect_data_sidecar_->size());
+  }
+  rows_sidecar_.reset();
+  indirect_data_sidecar_.reset();
+}
+
 WriteRpc::~WriteRpc() {
   STLDeleteElements(&ops_);
 }
@@ -310,6 +405,23 @@ string WriteRpc::ToString() const {
 
 void WriteRpc::Try(RemoteTabletServer* replica, const ResponseCallback& callback) {
   VLOG(2) << "Tablet " << tablet_id_ << ": Writing batch to replica " << replica->ToString();
+  last_ts_uuid_ = replica->permanent_uuid();
+  last_attempt_start_ = MonoTime::Now();
+  if (rows_sidecar_) {
+    // The controller, and with it the sidecars, are reset between attempts.
+    RpcController* controller = mutable_retrier()->mutable_controller();
+    RowOperationsPB* requested = req_.mutable_row_operations();
+    int idx;
+    CHECK_OK(controller->AddOutboundSidecar(
+        make_gscoped_ptr(new RpcSidecar(rows_sidecar_)), &idx));
+    requested->set_rows_sidecar(idx);
+    if (indirect_data_sidecar_) {
+      CHECK_OK(controller->AddOutboundSidecar(
+          make_gscoped_ptr(new RpcSidecar(indirect_data_sidecar_)), &idx));
+      requested->set_indirect_data_sidecar(idx);
+    }
+    controller->RequireServerFeature(TabletServerFeatures::ROW_OPERATIONS_IN_SIDECARS);
+  }
   replica->proxy()->WriteAsync(req_, &resp_,
                                mutable_retrier()->mutable_controller(),
                                callback);
@@ -345,6 +457,19 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
       result.result = RetriableRpcStatus::SERVER_BUSY;
       return result;
     }
+    // Retry servers which predate row operations in sidecars with the rows
+    // inline.
+    if (err && rows_sidecar_ &&
+        std::find(err->unsupported_feature_flags().begin(),
+                  err->unsupported_feature_flags().end(),
+                  static_cast<uint32_t>(TabletServerFeatures::ROW_OPERATIONS_IN_SIDECARS)) !=
+        err->unsupported_feature_flags().end()) {
+      VLOG(1) << "Tablet " << tablet_id_ << ": server doesn't support row operations "
+              << "in sidecars, sending them inline";
+      InlineRowOperations();
+      result.result = RetriableRpcStatus::SERVER_BUSY;
+      return result;
+    }
   }
 
   // Failover to a replica in the event of any network failure or of a DNS resolution problem.
@@ -389,6 +514,174 @@ RetriableRpcStatus WriteRpc::AnalyzeResponse(const Status& rpc_cb_status) {
   return result;
 }
 
+// A MultiTabletWrite RPC which is in-flight to the tablet server leading all
+// of the tablets it writes to. Unlike a WriteRpc, it isn't retried: any write
+// which the server rejected before applying it is resent on its own as a
+// WriteRpc instead, which then fails over as usual.
+//
+// Keeps a reference on the owning batcher while alive.
+class MultiTabletWriteRpc {
+ public:
+  MultiTabletWriteRpc(const scoped_refptr<Batcher>& batcher,
+                      RemoteTabletServer* ts,
+                      vector<Batcher::TabletOps> writes,
+                      const MonoTime& deadline,
+                      uint64_t propagated_timestamp);
+  ~MultiTabletWriteRpc();
+
+  void SendRpc();
+
+ private:
+  void SendRpcCb();
+
+  // Resends the writes to each tablet in a separate WriteRpc.
+  void ResendWrites();
+
+  // Returns true if the server rejected a write with 'resp' before applying
+  // it, because the write may succeed elsewhere or later.
+  static bool IsRetriable(const WriteResponsePB& resp);
+
+  // Pointer back to the batcher. Processes the write responses when the RPC
+  // completes, regardless of success or failure.
+  scoped_refptr<Batcher> batcher_;
+
+  const string ts_uuid_;
+  const shared_ptr<TabletServerServiceProxy> proxy_;
+
+  // The operations of each tablet which were batched into this RPC, in the
+  // order of the requests. These operations are in kRequestSent state.
+  vector<Batcher::TabletOps> writes_;
+
+  // The size of the operations in the session's buffer.
+  int64_t ops_bytes_;
+
+  MonoTime start_;
+  RpcController controller_;
+  MultiTabletWriteRequestPB req_;
+  MultiTabletWriteResponsePB resp_;
+};
+
+MultiTabletWriteRpc::MultiTabletWriteRpc(const scoped_refptr<Batcher>& batcher,
+                                         RemoteTabletServer* ts,
+                                         vector<Batcher::TabletOps> writes,
+                                         const MonoTime& deadline,
+                                         uint64_t propagated_timestamp)
+    : batcher_(batcher),
+      ts_uuid_(ts->permanent_uuid()),
+      proxy_(ts->proxy()),
+      writes_(std::move(writes)),
+      ops_bytes_(0) {
+  controller_.set_deadline(deadline);
+  for (const Batcher::TabletOps& w : writes_) {
+    ops_bytes_ += EncodeWriteRequest(batcher->external_consistency_mode(),
+                                     w.second[0]->write_op->table(), w.second,
+                                     w.first->tablet_id(), propagated_timestamp,
+                                     req_.add_requests());
+  }
+  if (VLOG_IS_ON(3)) {
+    VLOG(3) << "Created multi-tablet batch for " << ts_uuid_ << ":\n"
+            << SecureShortDebugString(req_);
+  }
+}
+
+MultiTabletWriteRpc::~MultiTabletWriteRpc() {
+  for (Batcher::TabletOps& w : writes_) {
+    STLDeleteElements(&w.second);
+  }
+}
+
+void MultiTabletWriteRpc::SendRpc() {
+  VLOG(2) << "Writing batch for " << writes_.size() << " tablets to " << ts_uuid_;
+  start_ = MonoTime::Now();
+  proxy_->MultiTabletWriteAsync(req_, &resp_, &controller_,
+                                boost::bind(&MultiTabletWriteRpc::SendRpcCb, this));
+}
+
+void MultiTabletWriteRpc::ResendWrites() {
+  for (Batcher::TabletOps& w : writes_) {
+    if (!w.second.empty()) {
+      // The WriteRpc takes ownership of the ops.
+      batcher_->FlushBuffer(w.first, w.second);
+      w.second.clear();
+    }
+  }
+}
+
+bool MultiTabletWriteRpc::IsRetriable(const WriteResponsePB& resp) {
+  // Mirrors the errors which WriteRpc::AnalyzeResponse() retries.
+  if (resp.error().code() == tserver::TabletServerErrorPB::TABLET_NOT_FOUND) {
+    return true;
+  }
+  Status s = StatusFromPB(resp.error().status());
+  return s.IsIllegalState() || s.IsAborted() || s.IsServiceUnavailable();
+}
+
+void MultiTabletWriteRpc::SendRpcCb() {
+  unique_ptr<MultiTabletWriteRpc> this_instance(this);
+  Status s = controller_.status();
+
+  // None of the writes were applied if the server was too busy to handle the
+  // RPC or predates it, or if it couldn't be reached. In the last case, it's
+  // also possible that the writes were applied and only the response was
+  // lost: with no exactly-once semantics for these writes, resending them
+  // might then apply them twice.
+  if (s.IsRemoteError()) {
+    const ErrorStatusPB* err = controller_.error_response();
+    if (err &&
+        err->has_code() &&
+        (err->code() == ErrorStatusPB::ERROR_SERVER_TOO_BUSY ||
+         err->code() == ErrorStatusPB::ERROR_NO_SUCH_METHOD)) {
+      VLOG(1) << "Tablet server " << ts_uuid_ << " rejected a multi-tablet write ("
+              << s.ToString() << "), writing to each tablet separately";
+      ResendWrites();
+      return;
+    }
+  }
+  if (s.IsNetworkError()) {
+    VLOG(1) << "Multi-tablet write to " << ts_uuid_ << " failed (" << s.ToString()
+            << "), writing to each tablet separately";
+    ResendWrites();
+    return;
+  }
+
+  if (s.ok() && resp_.responses_size() != static_cast<int>(writes_.size())) {
+    s = Status::Corruption(Substitute("Got $0 write responses for $1 writes",
+                                      resp_.responses_size(), writes_.size()));
+  }
+  if (s.ok()) {
+    batcher_->WriteRpcSucceeded(ts_uuid_, MonoTime::Now() - start_, ops_bytes_);
+  }
+
+  WriteResponsePB empty_resp;
+  for (int i = 0; i < static_cast<int>(writes_.size()); i++) {
+    Batcher::TabletOps& w = writes_[i];
+    const string& tablet_id = w.first->tablet_id();
+    Status write_status = s;
+    const WriteResponsePB* resp = &empty_resp;
+    if (s.ok()) {
+      resp = &resp_.responses(i);
+      if (resp->has_error()) {
+        if (IsRetriable(*resp)) {
+          VLOG(1) << "Tablet " << tablet_id << ": write batched to " << ts_uuid_
+                  << " failed (" << SecureShortDebugString(resp->error())
+                  << "), resending it";
+          batcher_->FlushBuffer(w.first, w.second);
+          w.second.clear();
+          continue;
+        }
+        write_status = StatusFromPB(resp->error().status());
+      }
+    }
+    if (!write_status.ok()) {
+      write_status = write_status.CloneAndPrepend(
+          Substitute("Failed to write batch of $0 ops to tablet $1",
+                     w.second.size(), tablet_id));
+      KLOG_EVERY_N_SECS(WARNING, 1) << write_status.ToString();
+    }
+    batcher_->ProcessTabletWriteResponse(w.second, *resp, tablet_id, write_status);
+  }
+}
+
 Batcher::Batcher(KuduClient* client,
                  scoped_refptr<ErrorCollector> error_collector,
                  sp::weak_ptr<KuduSession> session,
@@ -402,6 +695,7 @@ Batcher::Batcher(KuduClient* client,
     flush_callback_(nullptr),
     next_op_sequence_number_(0),
     timeout_(client->default_rpc_timeout()),
+    multi_tablet_writes_(false),
     outstanding_lookups_(0),
     buffer_bytes_used_(0) {
 }
@@ -410,7 +704,9 @@ void Batcher::Abort() {
   std::unique_lock<simple_spinlock> l(lock_);
   state_ = kAborted;
 
+  // The ops which weren't routed yet have no lookup which would fail them.
   vector<InFlightOp*> to_abort;
+  to_abort.swap(unrouted_ops_);
   for (InFlightOp* op : ops_) {
     std::lock_guard<simple_spinlock> l(op->lock_);
     if (op->state == InFlightOp::kBufferedToTabletServer) {
@@ -445,6 +741,12 @@ void Batcher::SetTimeout(const MonoDelta& timeout) {
   timeout_ = timeout;
 }
 
+void Batcher::SetMultiTabletWrites(bool enabled) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  CHECK_EQ(state_, kGatheringOps);
+  multi_tablet_writes_ = enabled;
+}
+
 
 bool Batcher::HasPendingOperations() const {
   std::lock_guard<simple_spinlock> l(lock_);
@@ -494,11 +796,19 @@ MonoTime Batcher::ComputeDeadlineUnlocked() const {
 }
 
 void Batcher::FlushAsync(KuduStatusCallback* cb) {
+  const MonoTime flush_start_time = MonoTime::Now();
+
+  // Start looking up the tablets of the ops which aren't routed yet. This
+  // happens before entering the flushing state so that the buffers aren't
+  // flushed before all the ops are buffered or in lookup.
+  RouteOps();
+
   {
     std::lock_guard<simple_spinlock> l(lock_);
     CHECK_EQ(state_, kGatheringOps);
     state_ = kFlushing;
     flush_callback_ = cb;
+    flush_start_time_ = flush_start_time;
     deadline_ = ComputeDeadlineUnlocked();
   }
 
@@ -517,39 +827,85 @@ void Batcher::FlushAsync(KuduStatusCallback* cb) {
 }
 
 Status Batcher::Add(KuduWriteOperation* write_op) {
-  // As soon as we get the op, start looking up where it belongs,
-  // so that when the user calls Flush, we are ready to go.
   gscoped_ptr<InFlightOp> op(new InFlightOp());
-  string partition_key;
-  RETURN_NOT_OK(write_op->table_->partition_schema().EncodeKey(write_op->row(), &partition_key));
   op->write_op.reset(write_op);
   op->state = InFlightOp::kLookingUpTablet;
 
-  AddInFlightOp(op.get());
-  VLOG(3) << "Looking up tablet for " << op->ToString();
-  // Increment our reference count for the outstanding callback.
-  //
-  // deadline_ is set in FlushAsync(), after all Add() calls are done, so
-  // here we're forced to create a new deadline.
-  MonoTime deadline = ComputeDeadlineUnlocked();
-  base::RefCountInc(&outstanding_lookups_);
-  client_->data_->meta_cache_->LookupTabletByKey(
-      op->write_op->table(),
-      std::move(partition_key),
-      deadline,
-      &op->tablet,
-      Bind(&Batcher::TabletLookupFinished, this, op.get()));
+  // The tablet of the op is looked up once a batch of ops has gathered, so
+  // that their partition keys are encoded together, but still well before
+  // the user calls Flush.
+  bool route_ops;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    AddInFlightOpUnlocked(op.get());
+    unrouted_ops_.push_back(op.get());
+    route_ops = unrouted_ops_.size() >= kRoutingBatchSize;
+  }
   IgnoreResult(op.release());
 
   buffer_bytes_used_.IncrementBy(write_op->SizeInBuffer());
 
+  if (route_ops) {
+    RouteOps();
+  }
   return Status::OK();
 }
 
-void Batcher::AddInFlightOp(InFlightOp* op) {
+void Batcher::RouteOps() {
+  vector<InFlightOp*> ops;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    ops.swap(unrouted_ops_);
+  }
+  if (ops.empty()) {
+    return;
+  }
+
+  // deadline_ is set in FlushAsync(), after all Add() calls are done, so
+  // here we're forced to create a new deadline.
+  MonoTime deadline = ComputeDeadlineUnlocked();
+
+  vector<const KuduPartialRow*> rows;
+  vector<string> partition_keys;
+  int start = 0;
+  while (start < ops.size()) {
+    // Encode the partition keys of each run of ops to the same table at once.
+    const KuduTable* table = ops[start]->write_op->table();
+    int end = start + 1;
+    while (end < ops.size() && ops[end]->write_op->table() == table) {
+      end++;
+    }
+    rows.clear();
+    for (int i = start; i < end; i++) {
+      rows.push_back(&ops[i]->write_op->row());
+    }
+    partition_keys.clear();
+    Status s = table->partition_schema().EncodeKeys(rows, &partition_keys);
+
+    for (int i = start; i < end; i++) {
+      InFlightOp* op = ops[i];
+      if (PREDICT_FALSE(!s.ok())) {
+        MarkInFlightOpFailed(op, s);
+        continue;
+      }
+      VLOG(3) << "Looking up tablet for " << op->ToString();
+      // Increment our reference count for the outstanding callback.
+      base::RefCountInc(&outstanding_lookups_);
+      client_->data_->meta_cache_->LookupTabletByKey(
+          table,
+          std::move(partition_keys[i - start]),
+          deadline,
+          &op->tablet,
+          Bind(&Batcher::TabletLookupFinished, this, op));
+    }
+    start = end;
+  }
+}
+
+void Batcher::AddInFlightOpUnlocked(InFlightOp* op) {
+  DCHECK(lock_.is_locked());
   DCHECK_EQ(op->state, InFlightOp::kLookingUpTablet);
 
-  std::lock_guard<simple_spinlock> l(lock_);
   CHECK_EQ(state_, kGatheringOps);
   InsertOrDie(&ops_, op);
   op->sequence_number_ = next_op_sequence_number_++;
@@ -675,15 +1031,42 @@ void Batcher::FlushBuffersIfReady() {
     ops_copy.swap(per_tablet_ops_);
   }
 
-  // Now flush the ops for each tablet.
-  for (const OpsMap::value_type& e : ops_copy) {
+  // Now flush the ops for each tablet. If enabled, small writes to tablets
+  // led by the same tablet server are batched together.
+  unordered_map<RemoteTabletServer*, vector<TabletOps>> per_ts_writes;
+  for (OpsMap::value_type& e : ops_copy) {
     RemoteTablet* tablet = e.first;
-    const vector<InFlightOp*>& ops = e.second;
-
+    vector<InFlightOp*>& ops = e.second;
+
+    if (multi_tablet_writes_) {
+      RemoteTabletServer* leader = tablet->LeaderTServer();
+      if (leader && leader->HasProxy() &&
+          OpsSizeInBuffer(ops) < kMinRowOperationsSidecarBytes) {
+        per_ts_writes[leader].emplace_back(tablet, std::move(ops));
+        continue;
+      }
+    }
     VLOG(3) << "FlushBuffersIfReady: already in flushing state, immediately flushing to "
             << tablet->tablet_id();
     FlushBuffer(tablet, ops);
   }
+
+  for (auto& e : per_ts_writes) {
+    RemoteTabletServer* ts = e.first;
+    vector<TabletOps> batch;
+    int64_t batch_bytes = 0;
+    for (TabletOps& w : e.second) {
+      int64_t bytes = OpsSizeInBuffer(w.second);
+      if (!batch.empty() && batch_bytes + bytes > kMaxMultiTabletWriteBytes) {
+        FlushMultiTabletBuffer(ts, std::move(batch));
+        batch.clear();
+        batch_bytes = 0;
+      }
+      batch.emplace_back(std::move(w));
+      batch_bytes += bytes;
+    }
+    FlushMultiTabletBuffer(ts, std::move(batch));
+  }
 }
 
 void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops) {
@@ -712,8 +1095,44 @@ void Batcher::FlushBuffer(RemoteTablet* tablet, const vector<InFlightOp*>& ops)
   rpc->SendRpc();
 }
 
+void Batcher::FlushMultiTabletBuffer(RemoteTabletServer* ts, vector<TabletOps> writes) {
+  CHECK(!writes.empty());
+  if (writes.size() == 1) {
+    FlushBuffer(writes[0].first, writes[0].second);
+    return;
+  }
+
+  VLOG(3) << "FlushBuffersIfReady: flushing writes to " << writes.size()
+          << " tablets led by " << ts->ToString();
+  // The RPC is freed when its callback completes, and takes ownership of the
+  // ops.
+  MultiTabletWriteRpc* rpc = new MultiTabletWriteRpc(
+      this, ts, std::move(writes), deadline_,
+      client_->data_->GetLatestObservedTimestamp());
+  rpc->SendRpc();
+}
+
+void Batcher::WriteRpcSucceeded(const string& ts_uuid, const MonoDelta& latency,
+                                int64_t bytes) {
+  sp::shared_ptr<KuduSession> session(weak_session_.lock());
+  if (session) {
+    session->data_->WriteRpcFinished(ts_uuid, latency, bytes);
+  }
+}
+
 void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
                                    const Status& s) {
+  if (s.ok()) {
+    WriteRpcSucceeded(rpc.last_ts_uuid(), MonoTime::Now() - rpc.last_attempt_start(),
+                      rpc.ops_bytes());
+  }
+  ProcessTabletWriteResponse(rpc.ops(), rpc.resp(), rpc.tablet_id(), s);
+}
+
+void Batcher::ProcessTabletWriteResponse(const vector<InFlightOp*>& ops,
+                                         const WriteResponsePB& resp,
+                                         const string& tablet_id,
+                                         const Status& s) {
   // TODO: there is a potential race here -- if the Batcher gets destructed while
   // RPCs are in-flight, then accessing state_ will crash. We probably need to keep
   // track of the in-flight RPCs, and in the destructor, change each of them to an
@@ -721,12 +1140,12 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   CHECK_EQ(state_, kFlushing);
 
   if (s.ok()) {
-    if (rpc.resp().has_timestamp()) {
-      client_->data_->UpdateLatestObservedTimestamp(rpc.resp().timestamp());
+    if (resp.has_timestamp()) {
+      client_->data_->UpdateLatestObservedTimestamp(resp.timestamp());
     }
   } else {
     // Mark each of the rows in the write op as failed, since the whole RPC failed.
-    for (InFlightOp* op : rpc.ops()) {
+    for (InFlightOp* op : ops) {
       gscoped_ptr<KuduError> error(new KuduError(op->write_op.release(), s));
       error_collector_->AddError(std::move(error));
     }
@@ -735,19 +1154,19 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   }
 
   // Check individual row errors.
-  for (const WriteResponsePB_PerRowErrorPB& err_pb : rpc.resp().per_row_errors()) {
+  for (const WriteResponsePB_PerRowErrorPB& err_pb : resp.per_row_errors()) {
     // TODO(todd): handle case where we get one of the more specific TS errors
     // like the tablet not being hosted?
 
-    if (err_pb.row_index() >= rpc.ops().size()) {
+    if (err_pb.row_index() >= ops.size()) {
       LOG(ERROR) << "Received a per_row_error for an out-of-bound op index "
                  << err_pb.row_index() << " (sent only "
-                 << rpc.ops().size() << " ops)";
-      LOG(ERROR) << "Response from tablet " << rpc.tablet_id() << ":\n"
-                 << SecureDebugString(rpc.resp());
+                 << ops.size() << " ops)";
+      LOG(ERROR) << "Response from tablet " << tablet_id << ":\n"
+                 << SecureDebugString(resp);
       continue;
     }
-    gscoped_ptr<KuduWriteOperation> op = std::move(rpc.ops()[err_pb.row_index()]->write_op);
+    gscoped_ptr<KuduWriteOperation> op = std::move(ops[err_pb.row_index()]->write_op);
     VLOG(2) << "Error on op " << op->ToString() << ": "
             << SecureShortDebugString(err_pb.error());
     Status op_status = StatusFromPB(err_pb.error());
@@ -777,7 +1196,7 @@ void Batcher::ProcessWriteResponse(const WriteRpc& rpc,
   //     from which the Flush() is being called.
   {
     std::lock_guard<simple_spinlock> l(lock_);
-    for (InFlightOp* op : rpc.ops()) {
+    for (InFlightOp* op : ops) {
       CHECK_EQ(1, ops_.erase(op))
             << "Could not remove op " << op->ToString()
             << " from in-flight list";
@@ -17,8 +17,10 @@
 #ifndef KUDU_CLIENT_BATCHER_H
 #define KUDU_CLIENT_BATCHER_H
 
+#include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "kudu/client/client.h"
@@ -32,6 +34,11 @@
 #include "kudu/util/status.h"
 
 namespace kudu {
+
+namespace tserver {
+class WriteResponsePB;
+} // namespace tserver
+
 namespace client {
 
 class KuduClient;
@@ -44,7 +51,9 @@ namespace internal {
 struct InFlightOp;
 
 class ErrorCollector;
+class MultiTabletWriteRpc;
 class RemoteTablet;
+class RemoteTabletServer;
 class WriteRpc;
 
 // A Batcher is the class responsible for collecting row operations, routing them to the
@@ -82,6 +91,12 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // may time out before even sending an op). TODO: implement that
   void SetTimeout(const MonoDelta& timeout);
 
+  // Set whether buffered writes to small batches of different tablets which
+  // are led by the same tablet server are sent together in one
+  // MultiTabletWrite RPC. Such writes don't have exactly-once semantics.
+  // Must be called before the batch is flushed.
+  void SetMultiTabletWrites(bool enabled);
+
   // Add a new operation to the batch. Requires that the batch has not yet been flushed.
   //
   // NOTE: If this returns not-OK, does not take ownership of 'write_op'.
@@ -117,6 +132,13 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
     return first_op_time_;
   }
 
+  // Get the time when FlushAsync() was called, or an uninitialized MonoTime
+  // if it wasn't called yet.
+  MonoTime flush_start_time() const {
+    std::lock_guard<simple_spinlock> l(lock_);
+    return flush_start_time_;
+  }
+
   // Return the total size (number of bytes) of all pending write operations
   // accumulated by the batcher.
   int64_t buffer_bytes_used() const {
@@ -130,12 +152,19 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
 
  private:
   friend class RefCountedThreadSafe<Batcher>;
+  friend class MultiTabletWriteRpc;
   friend class WriteRpc;
 
+  typedef std::pair<RemoteTablet*, std::vector<InFlightOp*>> TabletOps;
+
   ~Batcher();
 
   // Add an op to the in-flight set and increment the ref-count.
-  void AddInFlightOp(InFlightOp* op);
+  void AddInFlightOpUnlocked(InFlightOp* op);
+
+  // Encodes the partition keys of the ops in 'unrouted_ops_' together and
+  // starts looking up their tablets.
+  void RouteOps();
 
   void RemoveInFlightOp(InFlightOp* op);
 
@@ -157,10 +186,25 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   void FlushBuffersIfReady();
   void FlushBuffer(RemoteTablet* tablet, const std::vector<InFlightOp*>& ops);
 
+  // Sends the buffered writes to several tablets led by 'ts' in a single
+  // MultiTabletWrite RPC, or in a Write RPC if there's only one of them.
+  void FlushMultiTabletBuffer(RemoteTabletServer* ts, std::vector<TabletOps> writes);
+
   // Cleans up an RPC response, scooping out any errors and passing them up
   // to the batcher.
   void ProcessWriteResponse(const WriteRpc& rpc, const Status& s);
 
+  // Does the work of ProcessWriteResponse() for the write of 'ops' to tablet
+  // 'tablet_id', which got the response 'resp' and the overall status 's'.
+  void ProcessTabletWriteResponse(const std::vector<InFlightOp*>& ops,
+                                  const tserver::WriteResponsePB& resp,
+                                  const std::string& tablet_id,
+                                  const Status& s);
+
+  // Reports a successful write RPC to tablet server 'ts_uuid' to the session.
+  void WriteRpcSucceeded(const std::string& ts_uuid, const MonoDelta& latency,
+                         int64_t bytes);
+
   // Async Callbacks.
   void TabletLookupFinished(InFlightOp* op, const Status& s);
 
@@ -191,6 +235,9 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // The time when the very first operation was added into the batcher.
   MonoTime first_op_time_;
 
+  // The time when FlushAsync() was called. Protected by lock_.
+  MonoTime flush_start_time_;
+
   // Set to true if there was at least one error from this Batcher.
   // Protected by lock_
   bool had_errors_;
@@ -202,6 +249,9 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
 
   // All buffered or in-flight ops.
   std::unordered_set<InFlightOp*> ops_;
+  // The ops whose tablets haven't started being looked up yet, in the order
+  // they were added.
+  std::vector<InFlightOp*> unrouted_ops_;
   // Each tablet's buffered ops.
   typedef std::unordered_map<RemoteTablet*, std::vector<InFlightOp*> > OpsMap;
   OpsMap per_tablet_ops_;
@@ -221,6 +271,11 @@ class Batcher : public RefCountedThreadSafe<Batcher> {
   // After flushing, the absolute deadline for all in-flight ops.
   MonoTime deadline_;
 
+  // Whether writes to tablets led by the same tablet server may be batched.
+  //
+  // Set by SetMultiTabletWrites().
+  bool multi_tablet_writes_;
+
   // Number of outstanding lookups across all in-flight ops.
   //
   // Note: _not_ protected by lock_!
@@ -91,6 +91,19 @@ using internal::ConnectToClusterRpc;
 using internal::RemoteTablet;
 using internal::RemoteTabletServer;
 
+namespace {
+
+// A replica only takes over scans from the tablet's preferred replica if its
+// latency score is lower by at least this factor, so that scans don't flap
+// between replicas of about the same speed.
+const double kReplicaSwitchFactor = 0.8;
+
+// How often scans are sent to a replica other than the fastest one, to keep
+// its latency statistics current.
+const int kReplicaProbeIntervalMs = 10000;
+
+} // anonymous namespace
+
 Status RetryFunc(const MonoTime& deadline,
                  const string& retry_msg,
                  const string& timeout_msg,
@@ -341,18 +354,8 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(const scoped_refptr<RemoteTa
         if (!filtered.empty()) {
           ret = filtered[0];
         }
-      } else if (selection == CLOSEST_REPLICA) {
-        // Choose a local replica.
-        for (RemoteTabletServer* rts : filtered) {
-          if (IsTabletServerLocal(*rts)) {
-            ret = rts;
-            break;
-          }
-        }
-        // Fallback to a random replica if none are local.
-        if (ret == nullptr && !filtered.empty()) {
-          ret = filtered[rand() % filtered.size()];
-        }
+      } else if (selection == CLOSEST_REPLICA && !filtered.empty()) {
+        ret = SelectClosestReplica(rt, filtered);
       }
       break;
     }
@@ -365,6 +368,63 @@ RemoteTabletServer* KuduClient::Data::SelectTServer(const scoped_refptr<RemoteTa
   return ret;
 }
 
+RemoteTabletServer* KuduClient::Data::SelectClosestReplica(
+    const scoped_refptr<RemoteTablet>& rt,
+    const vector<RemoteTabletServer*>& candidates) const {
+  DCHECK(!candidates.empty());
+  RemoteTabletServer* local = nullptr;
+  RemoteTabletServer* fastest = nullptr;
+  double fastest_score = 0;
+  RemoteTabletServer* preferred = rt->preferred_replica();
+  double preferred_score = 0;
+  bool preferred_is_candidate = false;
+  for (RemoteTabletServer* rts : candidates) {
+    if (local == nullptr && IsTabletServerLocal(*rts)) {
+      local = rts;
+    }
+    double score;
+    if (!rts->GetLatencyScore(&score)) {
+      continue;
+    }
+    if (fastest == nullptr || score < fastest_score) {
+      fastest = rts;
+      fastest_score = score;
+    }
+    if (rts == preferred) {
+      preferred_score = score;
+      preferred_is_candidate = true;
+    }
+  }
+
+  RemoteTabletServer* ret;
+  if (fastest == nullptr) {
+    // Nothing is known about the latency of the replicas yet: choose a local
+    // replica, falling back to a random one if none are local.
+    ret = local != nullptr ? local : candidates[rand() % candidates.size()];
+  } else if (preferred_is_candidate && fastest_score >= preferred_score * kReplicaSwitchFactor) {
+    ret = preferred;
+  } else {
+    ret = fastest;
+  }
+  if (ret != preferred) {
+    VLOG(2) << "Scans of tablet " << rt->tablet_id() << " now prefer replica " << ret->ToString();
+    rt->set_preferred_replica(ret);
+  }
+
+  // Every so often, divert a scan to one of the other replicas, so that a
+  // replica which was slow but recovered, or which was never tried, gets the
+  // chance to become preferred.
+  MonoTime now = MonoTime::Now();
+  MonoDelta probe_interval = MonoDelta::FromMilliseconds(kReplicaProbeIntervalMs);
+  for (RemoteTabletServer* rts : candidates) {
+    if (rts != ret && rts->TryStartProbe(now, probe_interval)) {
+      VLOG(2) << "Probing replica " << rts->ToString() << " of tablet " << rt->tablet_id();
+      return rts;
+    }
+  }
+  return ret;
+}
+
 Status KuduClient::Data::GetTabletServer(KuduClient* client,
                                          const scoped_refptr<RemoteTablet>& rt,
                                          ReplicaSelection selection,
@@ -560,19 +620,55 @@ Status KuduClient::Data::GetTableSchema(KuduClient* client,
   GetTableSchemaResponsePB resp;
 
   req.mutable_table()->set_table_name(table_name);
+
+  // If the schemas of the table are cached, the master leaves them out of
+  // its response unless they have changed.
+  shared_ptr<const CachedTableSchema> cached;
+  {
+    std::lock_guard<simple_spinlock> l(table_schema_cache_lock_);
+    cached = FindWithDefault(table_schema_cache_, table_name, nullptr);
+  }
+  if (cached) {
+    req.set_cached_table_id(cached->table_id);
+    req.set_cached_schema_version(cached->schema_version);
+  }
   RETURN_NOT_OK((
       SyncLeaderMasterRpc<GetTableSchemaRequestPB, GetTableSchemaResponsePB>(
           deadline, client, req, &resp,
           "GetTableSchema", &MasterServiceProxy::GetTableSchema, {})));
-  // Parse the server schema out of the response.
-  unique_ptr<Schema> new_schema(new Schema());
-  RETURN_NOT_OK(SchemaFromPB(resp.schema(), new_schema.get()));
 
-  // Parse the server partition schema out of the response.
+  unique_ptr<Schema> new_schema(new Schema());
   PartitionSchema new_partition_schema;
-  RETURN_NOT_OK(PartitionSchema::FromPB(resp.partition_schema(),
-                                        *new_schema,
-                                        &new_partition_schema));
+  if (resp.schema_not_modified()) {
+    if (PREDICT_FALSE(!cached || cached->table_id != resp.table_id())) {
+      return Status::IllegalState(
+          Substitute("master reported unchanged schemas for table $0, which aren't cached",
+                     table_name));
+    }
+    *new_schema = cached->schema;
+    new_partition_schema = cached->partition_schema;
+  } else {
+    // Parse the server schema out of the response.
+    RETURN_NOT_OK(SchemaFromPB(resp.schema(), new_schema.get()));
+
+    // Parse the server partition schema out of the response.
+    RETURN_NOT_OK(PartitionSchema::FromPB(resp.partition_schema(),
+                                          *new_schema,
+                                          &new_partition_schema));
+
+    // The schemas may only be cached while no alteration of the table is in
+    // progress, which is when the master reports their version.
+    if (resp.has_schema_version()) {
+      auto entry = std::make_shared<CachedTableSchema>(
+          CachedTableSchema{ resp.table_id(), resp.schema_version(),
+                             *new_schema, new_partition_schema });
+      std::lock_guard<simple_spinlock> l(table_schema_cache_lock_);
+      table_schema_cache_[table_name] = std::move(entry);
+    } else {
+      std::lock_guard<simple_spinlock> l(table_schema_cache_lock_);
+      table_schema_cache_.erase(table_name);
+    }
+  }
   if (schema) {
     delete schema->schema_;
     schema->schema_ = new_schema.release();
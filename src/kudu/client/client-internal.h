@@ -19,8 +19,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -28,6 +30,8 @@
 #include <boost/optional.hpp>
 
 #include "kudu/client/client.h"
+#include "kudu/common/partition.h"
+#include "kudu/common/schema.h"
 #include "kudu/security/token.pb.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
@@ -111,6 +115,9 @@ class KuduClient::Data {
                                    const std::string& alter_name,
                                    const MonoTime& deadline);
 
+  // Fetches the schema, partition schema, ID and number of replicas of a
+  // table from the master. The schemas are cached, and the master only sends
+  // them again if the table has changed since.
   Status GetTableSchema(KuduClient* client,
                         const std::string& table_name,
                         const MonoTime& deadline,
@@ -135,6 +142,16 @@ class KuduClient::Data {
       const std::set<std::string>& blacklist,
       std::vector<internal::RemoteTabletServer*>* candidates) const;
 
+  // Returns the replica of the specified tablet, out of the non-empty
+  // 'candidates', which scans that may go to any replica should be sent to:
+  // usually the one with the lowest weighted RPC latency, with scans sticking
+  // to the tablet's preferred replica unless another is substantially faster,
+  // and with other replicas probed every so often. Replicas are only
+  // preferred for being local as long as none has latency statistics.
+  internal::RemoteTabletServer* SelectClosestReplica(
+      const scoped_refptr<internal::RemoteTablet>& rt,
+      const std::vector<internal::RemoteTabletServer*>& candidates) const;
+
   // Sets 'master_proxy_' from the address specified by 'leader_addr'.
   // Called by ConnectToClusterRpc::SendRpcCb() upon successful completion.
   //
@@ -242,6 +259,22 @@ class KuduClient::Data {
 
   AtomicInt<uint64_t> latest_observed_timestamp_;
 
+  // The latency histograms of the client, see KuduClient::GetLatencyMetrics().
+  ResourceMetrics latency_metrics_;
+
+  // The schemas of a table, as of a schema version.
+  struct CachedTableSchema {
+    std::string table_id;
+    uint32_t schema_version;
+    Schema schema;
+    PartitionSchema partition_schema;
+  };
+
+  // The schemas fetched by GetTableSchema(), by table name.
+  std::unordered_map<std::string, std::shared_ptr<const CachedTableSchema>>
+      table_schema_cache_;  // protected by table_schema_cache_lock_
+  simple_spinlock table_schema_cache_lock_;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
@@ -62,6 +62,7 @@
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/bitmap.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/scoped_cleanup.h"
@@ -86,6 +87,7 @@ DECLARE_int32(scanner_inject_latency_on_each_batch_ms);
 DECLARE_int32(scanner_max_batch_size_bytes);
 DECLARE_int32(scanner_ttl_ms);
 DECLARE_int32(table_locations_ttl_ms);
+DECLARE_int32(tablet_inject_latency_on_apply_write_txn_ms);
 DEFINE_int32(test_scan_num_rows, 1000, "Number of rows to insert and scan");
 
 METRIC_DECLARE_counter(rpcs_queue_overflow);
@@ -365,6 +367,33 @@ class ClientTest : public KuduTest {
       ASSERT_TRUE(ContainsKey(metrics, "cfile_cache_miss_bytes"));
       ASSERT_TRUE(ContainsKey(metrics, "cfile_cache_hit_bytes"));
       ASSERT_GT(metrics["cfile_cache_miss_bytes"] + metrics["cfile_cache_hit_bytes"], 0);
+      ASSERT_FALSE(ContainsKey(metrics, "rowsets_scanned"));
+    }
+
+    KuduScanner profiled_scanner(client_table_.get());
+    ASSERT_OK(profiled_scanner.SetProjectedColumns({ "key", "int_val" }));
+    ASSERT_OK(profiled_scanner.AddConjunctPredicate(
+        client_table_->NewComparisonPredicate("int_val", KuduPredicate::GREATER_EQUAL,
+                                              KuduValue::FromInt(0))));
+    ASSERT_OK(profiled_scanner.SetProfiling(true));
+    LOG_TIMING(INFO, "Scanning disk with a profile") {
+      ASSERT_OK(profiled_scanner.Open());
+      ASSERT_TRUE(profiled_scanner.HasMoreRows());
+      KuduScanBatch batch;
+      while (profiled_scanner.HasMoreRows()) {
+        ASSERT_OK(profiled_scanner.NextBatch(&batch));
+      }
+      std::map<std::string, int64_t> metrics = profiled_scanner.GetResourceMetrics().Get();
+      ASSERT_GE(metrics["rowsets_scanned"], 1);
+      ASSERT_TRUE(ContainsKey(metrics, "rowsets_pruned"));
+      ASSERT_TRUE(ContainsKey(metrics, "queue_duration_nanos"));
+      ASSERT_GT(metrics["data_blocks_decoded"], 0);
+      ASSERT_GT(metrics["predicate_eval_nanos"], 0);
+      ASSERT_GT(metrics["materialize_nanos"], 0);
+      ASSERT_GT(metrics["serialize_nanos"], 0);
+      ASSERT_GT(metrics["data_blocks_decoded.key"], 0);
+      ASSERT_GT(metrics["data_blocks_decoded.int_val"], 0);
+      ASSERT_GT(metrics["predicate_rows_evaluated.int_val"], 0);
     }
   }
 
@@ -707,6 +736,42 @@ TEST_F(ClientTest, TestScan) {
   DoTestScanWithKeyPredicate();
 }
 
+// Test clients which open several connections to each server and share them.
+TEST_F(ClientTest, TestSharedMessengerWithConnectionsPerServer) {
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(KuduClientBuilder()
+      .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr().ToString())
+      .num_connections_per_server(3)
+      .Build(&client));
+  shared_ptr<KuduClient> sharing_client;
+  ASSERT_OK(KuduClientBuilder()
+      .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr().ToString())
+      .share_messenger_with(client)
+      .Build(&sharing_client));
+  ASSERT_EQ(client->data_->messenger_, sharing_client->data_->messenger_);
+
+  // Importing credentials into a shared messenger isn't allowed.
+  string authn_creds;
+  ASSERT_OK(client->ExportAuthenticationCredentials(&authn_creds));
+  shared_ptr<KuduClient> bad_client;
+  Status s = KuduClientBuilder()
+      .add_master_server_addr(cluster_->mini_master()->bound_rpc_addr().ToString())
+      .share_messenger_with(client)
+      .import_authentication_credentials(authn_creds)
+      .Build(&bad_client);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  // Write through both clients, and read the rows back through each.
+  shared_ptr<KuduTable> table;
+  ASSERT_OK(client->OpenTable(kTableName, &table));
+  shared_ptr<KuduTable> sharing_table;
+  ASSERT_OK(sharing_client->OpenTable(kTableName, &sharing_table));
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client.get(), table.get(), 100, 0));
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(sharing_client.get(), sharing_table.get(), 100, 100));
+  ASSERT_EQ(200, CountRowsFromClient(table.get()));
+  ASSERT_EQ(200, CountRowsFromClient(sharing_table.get()));
+}
+
 TEST_F(ClientTest, TestScanAtSnapshot) {
   int half_the_rows = FLAGS_test_scan_num_rows / 2;
 
@@ -934,6 +999,69 @@ TEST_F(ClientTest, TestScanEmptyProjection) {
   }
 }
 
+// Test reading the results of a scan column by column, whether they're
+// returned in the columnar layout or transposed from the row-wise one.
+TEST_F(ClientTest, TestColumnarScan) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(),
+                                         FLAGS_test_scan_num_rows));
+  for (bool columnar_layout : { true, false }) {
+    SCOPED_TRACE(columnar_layout);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetProjectedColumns({ "key", "string_val", "int_val" }));
+    ASSERT_OK(scanner.SetColumnarLayout(columnar_layout));
+    ASSERT_OK(scanner.Open());
+
+    // The old row-based API can't read columnar batches.
+    if (columnar_layout) {
+      vector<KuduRowResult> rows;
+      Status s = scanner.NextBatch(&rows);
+      ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+    }
+
+    KuduScanBatch batch;
+    int count = 0;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      int n_rows = batch.NumRows();
+      count += n_rows;
+      if (n_rows == 0) continue;
+
+      Slice keys, int_vals, offsets, strings, bitmap;
+      ASSERT_OK(batch.GetFixedLengthColumn(0, &keys));
+      ASSERT_OK(batch.GetVariableLengthColumn(1, &offsets, &strings));
+      ASSERT_OK(batch.GetNonNullBitmapForColumn(1, &bitmap));
+      ASSERT_OK(batch.GetFixedLengthColumn(2, &int_vals));
+      ASSERT_EQ(n_rows * sizeof(int32_t), keys.size());
+      ASSERT_EQ(n_rows * sizeof(int32_t), int_vals.size());
+      ASSERT_EQ((n_rows + 1) * sizeof(uint32_t), offsets.size());
+
+      // Mismatched accessors fail.
+      Slice unused;
+      ASSERT_TRUE(batch.GetFixedLengthColumn(1, &unused).IsInvalidArgument());
+      ASSERT_TRUE(batch.GetVariableLengthColumn(0, &unused, &unused).IsInvalidArgument());
+      ASSERT_TRUE(batch.GetFixedLengthColumn(3, &unused).IsInvalidArgument());
+
+      const int32_t* key_cells = reinterpret_cast<const int32_t*>(keys.data());
+      const int32_t* int_cells = reinterpret_cast<const int32_t*>(int_vals.data());
+      const uint32_t* string_offsets = reinterpret_cast<const uint32_t*>(offsets.data());
+      for (int i = 0; i < n_rows; i++) {
+        int32_t key = key_cells[i];
+        ASSERT_EQ(key * 2, int_cells[i]);
+        ASSERT_TRUE(BitmapTest(bitmap.data(), i));
+        Slice str(strings.data() + string_offsets[i], string_offsets[i + 1] - string_offsets[i]);
+        ASSERT_EQ(StringPrintf("hello %d", key), str.ToString());
+        // Row-wise batches can still be read row by row too.
+        if (!columnar_layout) {
+          int32_t row_key;
+          ASSERT_OK(batch.Row(i).GetInt32(0, &row_key));
+          ASSERT_EQ(key, row_key);
+        }
+      }
+    }
+    ASSERT_EQ(FLAGS_test_scan_num_rows, count);
+  }
+}
+
 TEST_F(ClientTest, TestProjectInvalidColumn) {
   KuduScanner scanner(client_table_.get());
   Status s = scanner.SetProjectedColumns({ "column-doesnt-exist" });
@@ -1486,6 +1614,79 @@ TEST_F(ClientTest, TestMetaCacheExpiry) {
   ASSERT_FALSE(entry.stale());
 }
 
+// Test that prefetching the tablet locations of a table caches all of
+// them, including past the number of locations returned by a single lookup.
+TEST_F(ClientTest, TestPrefetchTabletLocations) {
+  const int kNumTablets = 25;
+  vector<unique_ptr<KuduPartialRow>> split_rows;
+  for (int i = 1; i < kNumTablets; i++) {
+    unique_ptr<KuduPartialRow> row(schema_.NewRow());
+    ASSERT_OK(row->SetInt32(0, i * 10));
+    split_rows.push_back(std::move(row));
+  }
+  shared_ptr<KuduTable> table;
+  ASSERT_NO_FATAL_FAILURE(CreateTable("prefetch", 1, std::move(split_rows), {}, &table));
+
+  auto& meta_cache = client_->data_->meta_cache_;
+  meta_cache->ClearCache();
+  internal::MetaCacheEntry entry;
+  ASSERT_FALSE(meta_cache->LookupTabletByKeyFastPath(table.get(), "", &entry));
+
+  ASSERT_OK(table->PrefetchTabletLocations());
+
+  // Walk the cached tablets from the start of the table to its end.
+  string partition_key;
+  int num_tablets = 0;
+  do {
+    ASSERT_TRUE(meta_cache->LookupTabletByKeyFastPath(table.get(), partition_key, &entry));
+    num_tablets++;
+    partition_key = entry.upper_bound_partition_key();
+  } while (!partition_key.empty());
+  ASSERT_EQ(kNumTablets, num_tablets);
+}
+
+TEST_F(ClientTest, TestGetColumnStatistics) {
+  const int kNumRows = 100;
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), kNumRows));
+  // Only the flushed rows have statistics.
+  vector<scoped_refptr<TabletPeer>> tablet_peers;
+  cluster_->mini_tablet_server(0)->server()->tablet_manager()->GetTabletPeers(&tablet_peers);
+  for (const auto& peer : tablet_peers) {
+    ASSERT_OK(peer->tablet()->Flush());
+  }
+
+  vector<KuduColumnStatistics*> stats;
+  ElementDeleter deleter(&stats);
+  ASSERT_OK(client_table_->GetColumnStatistics(&stats));
+  ASSERT_EQ(4, stats.size());
+  for (const KuduColumnStatistics* col : stats) {
+    SCOPED_TRACE(col->column_name());
+    ASSERT_TRUE(col->complete());
+    ASSERT_EQ(0, col->null_count());
+    ASSERT_EQ(kNumRows, col->non_null_count());
+    ASSERT_NEAR(kNumRows, col->distinct_count(), kNumRows * 0.05);
+    ASSERT_NE(nullptr, col->min_value());
+    ASSERT_NE(nullptr, col->max_value());
+  }
+  ASSERT_EQ("key", stats[0]->column_name());
+
+  // The minimum and maximum values can be used in predicates.
+  for (const KuduValue* value : { stats[0]->min_value(), stats[0]->max_value() }) {
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.AddConjunctPredicate(client_table_->NewComparisonPredicate(
+        "key", KuduPredicate::EQUAL, value->Clone())));
+    vector<string> rows;
+    ScanToStrings(&scanner, &rows);
+    ASSERT_EQ(1, rows.size());
+  }
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.AddConjunctPredicate(client_table_->NewComparisonPredicate(
+      "key", KuduPredicate::GREATER, stats[0]->max_value()->Clone())));
+  vector<string> rows;
+  ScanToStrings(&scanner, &rows);
+  ASSERT_TRUE(rows.empty());
+}
+
 TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   shared_ptr<KuduTable> table;
   ASSERT_NO_FATAL_FAILURE(CreateTable("blacklist",
@@ -1563,6 +1764,61 @@ TEST_F(ClientTest, TestGetTabletServerBlacklist) {
   }
 }
 
+// Test that scans which may go to any replica go to the one with the lowest
+// weighted latency, sticking to it until another one is substantially faster.
+TEST_F(ClientTest, TestLatencyBasedReplicaSelection) {
+  shared_ptr<KuduTable> table;
+  ASSERT_NO_FATAL_FAILURE(CreateTable("latency", 3, {}, {}, &table));
+
+  scoped_refptr<internal::RemoteTablet> rt;
+  vector<internal::RemoteTabletServer*> tservers;
+  while (true) {
+    rt = MetaCacheLookup(table.get(), "");
+    ASSERT_TRUE(rt.get() != nullptr);
+    rt->GetRemoteTabletServers(&tservers);
+    if (tservers.size() == 3) {
+      break;
+    }
+    rt->MarkStale();
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+
+  const auto record = [](internal::RemoteTabletServer* ts, int latency_us, bool failed, int n) {
+    for (int i = 0; i < n; i++) {
+      ts->RecordRpcResult(MonoDelta::FromMicroseconds(latency_us), failed);
+    }
+  };
+  const set<string> blacklist;
+  vector<internal::RemoteTabletServer*> candidates;
+  const auto select = [&]() {
+    return client_->data_->SelectTServer(rt, KuduClient::CLOSEST_REPLICA, blacklist, &candidates);
+  };
+
+  // Having results for every replica, none is due for a probe.
+  record(tservers[0], 1000, false, 1);
+  record(tservers[1], 5000, false, 1);
+  record(tservers[2], 10000, false, 1);
+  ASSERT_EQ(tservers[0], select());
+
+  // A replica which is only slightly faster doesn't take over.
+  record(tservers[1], 950, false, 30);
+  ASSERT_EQ(tservers[0], select());
+
+  // A replica which is substantially faster does.
+  record(tservers[1], 300, false, 30);
+  ASSERT_EQ(tservers[1], select());
+  ASSERT_EQ(tservers[1], select());
+
+  // Errors make a replica look slower.
+  record(tservers[1], 300, true, 30);
+  ASSERT_EQ(tservers[0], select());
+
+  // Replicas are probed once their statistics are older than the probe interval.
+  MonoTime later = MonoTime::Now() + MonoDelta::FromSeconds(60);
+  ASSERT_TRUE(tservers[2]->TryStartProbe(later, MonoDelta::FromSeconds(10)));
+  ASSERT_FALSE(tservers[2]->TryStartProbe(later, MonoDelta::FromSeconds(10)));
+}
+
 TEST_F(ClientTest, TestScanWithEncodedRangePredicate) {
   shared_ptr<KuduTable> table;
   ASSERT_NO_FATAL_FAILURE(CreateTable("split-table",
@@ -1754,6 +2010,58 @@ TEST_F(ClientTest, TestScannerKeepAlive) {
   ASSERT_EQ(sum, 499500);
 }
 
+// Test that a scanner set to be kept alive automatically survives its
+// application being idle for longer than the scanner TTL.
+TEST_F(ClientTest, TestScannerAutomaticKeepAlive) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), 1000));
+  FLAGS_scanner_ttl_ms = 100;
+  KuduScanner scanner(client_table_.get());
+  ASSERT_OK(scanner.SetBatchSizeBytes(100));
+  ASSERT_OK(scanner.SetKeepAlivePeriodMillis(20));
+  ASSERT_OK(scanner.Open());
+
+  KuduScanBatch batch;
+  int64_t sum = 0;
+  int num_batches = 0;
+  while (scanner.HasMoreRows()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    sum += SumResults(batch);
+    // Stay idle past the scanner TTL every few batches.
+    if (++num_batches % 10 == 0) {
+      SleepFor(MonoDelta::FromMilliseconds(250));
+    }
+  }
+  ASSERT_EQ(sum, 499500);
+}
+
+// Test that reading batches ahead returns all the rows in order, including
+// with an application slower than the scan.
+TEST_F(ClientTest, TestScanReadAhead) {
+  ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), 1000));
+  for (bool slow_consumer : { false, true }) {
+    SCOPED_TRACE(slow_consumer);
+    KuduScanner scanner(client_table_.get());
+    ASSERT_OK(scanner.SetBatchSizeBytes(100));
+    ASSERT_OK(scanner.SetReadAheadBatches(3));
+    ASSERT_OK(scanner.Open());
+
+    KuduScanBatch batch;
+    int32_t next_key = 0;
+    while (scanner.HasMoreRows()) {
+      ASSERT_OK(scanner.NextBatch(&batch));
+      for (const KuduScanBatch::RowPtr& row : batch) {
+        int32_t key;
+        ASSERT_OK(row.GetInt32(0, &key));
+        ASSERT_EQ(next_key++, key);
+      }
+      if (slow_consumer) {
+        SleepFor(MonoDelta::FromMilliseconds(1));
+      }
+    }
+    ASSERT_EQ(1000, next_key);
+  }
+}
+
 // Test cleanup of scanners on the server side when closed.
 TEST_F(ClientTest, TestCloseScanner) {
   ASSERT_NO_FATAL_FAILURE(InsertTestRows(client_table_.get(), 10));
@@ -1891,6 +2199,39 @@ TEST_F(ClientTest, TestInsertSingleRowManualBatch) {
   FlushSessionOrDie(session);
 }
 
+// Test that operations created by a KuduWriteOperationBuilder, whose rows
+// share their memory, can outlive the builder.
+TEST_F(ClientTest, TestWriteOperationBuilder) {
+  const int kNumRows = 100;
+  shared_ptr<KuduSession> session = client_->NewSession();
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  {
+    KuduWriteOperationBuilder builder(client_table_);
+    string str;
+    for (int i = 0; i < kNumRows; i++) {
+      KuduInsert* insert = builder.NewInsert();
+      KuduPartialRow* row = insert->mutable_row();
+      ASSERT_OK(row->SetInt32(0, i));
+      ASSERT_OK(row->SetInt32(1, i * 2));
+      // The string is copied into the builder's memory.
+      str = StringPrintf("hello %d", i);
+      ASSERT_OK(row->SetStringCopy(2, str));
+      ASSERT_OK(row->SetInt32(3, i * 3));
+      ASSERT_OK(session->Apply(insert));
+    }
+  }
+  FlushSessionOrDie(session);
+
+  vector<string> rows;
+  KuduScanner scanner(client_table_.get());
+  ScanToStrings(&scanner, &rows);
+  ASSERT_EQ(kNumRows, rows.size());
+  ASSERT_EQ(R"((int32 key=0, int32 int_val=0, string string_val="hello 0",)"
+            " int32 non_null_with_default=0)", rows.front());
+  ASSERT_EQ(R"((int32 key=99, int32 int_val=198, string string_val="hello 99",)"
+            " int32 non_null_with_default=297)", rows.back());
+}
+
 TEST_F(ClientTest, TestInsertAutoFlushSync) {
   shared_ptr<KuduSession> session = client_->NewSession();
   ASSERT_FALSE(session->HasPendingOperations());
@@ -2831,6 +3172,136 @@ TEST_F(ClientTest, TestAutoFlushBackgroundPreFlush) {
   EXPECT_EQ(2, CountRowsFromClient(client_table_.get()));
 }
 
+// Test that adaptive flushing exports its decisions, and shrinks the flush
+// watermark and interval once the tablet server's write latency exceeds
+// the latency bound.
+TEST_F(ClientTest, TestAdaptiveFlush) {
+  const size_t kBufferSizeBytes = 1024 * 1024;
+  const int64_t kMaxWatermarkBytes = kBufferSizeBytes / 2;
+  const int kFlushIntervalMs = 1000;
+  const int kMaxLatencyMs = 100;
+
+  shared_ptr<KuduSession> session(client_->NewSession());
+  ASSERT_OK(session->SetMutationBufferSpace(kBufferSizeBytes));
+  ASSERT_OK(session->SetMutationBufferFlushWatermark(0.5));
+  ASSERT_OK(session->SetMutationBufferFlushInterval(kFlushIntervalMs));
+  ASSERT_OK(session->SetMutationBufferAdaptiveFlush(kMaxLatencyMs));
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  session->SetTimeoutMillis(60000);
+  const ResourceMetrics& metrics = session->GetWriteOpMetrics();
+
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 100));
+  FlushSessionOrDie(session);
+  ASSERT_GT(metrics.GetMetric("write_rpcs"), 0);
+  ASSERT_GT(metrics.GetMetric("write_rpc_bytes"), 0);
+  ASSERT_LE(metrics.GetMetric("adaptive_flush_watermark_bytes"), kMaxWatermarkBytes);
+  ASSERT_LE(metrics.GetMetric("adaptive_flush_interval_ms"), kFlushIntervalMs);
+
+  // Slow the writes down beyond the latency bound: every flush halves
+  // the watermark, and the operations are no longer held for the
+  // time-based flush.
+  FLAGS_tablet_inject_latency_on_apply_write_txn_ms = 4 * kMaxLatencyMs;
+  for (int i = 1; i <= 3; i++) {
+    NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 10, i * 100));
+    FlushSessionOrDie(session);
+  }
+  ASSERT_LT(metrics.GetMetric("adaptive_flush_watermark_bytes"), kMaxWatermarkBytes);
+  ASSERT_EQ(1, metrics.GetMetric("adaptive_flush_interval_ms"));
+  ASSERT_GE(metrics.GetMetric("adaptive_flush_worst_ts_latency_us"), kMaxLatencyMs * 1000);
+
+  // Adaptive flushing may not be changed with writes buffered.
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 1, 1000));
+  Status s = session->SetMutationBufferAdaptiveFlush(0);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+  FlushSessionOrDie(session);
+  ASSERT_OK(session->SetMutationBufferAdaptiveFlush(0));
+}
+
+// Test the latency histograms of sessions and of the client.
+TEST_F(ClientTest, TestLatencyMetrics) {
+  const ResourceMetrics& client_metrics = client_->GetLatencyMetrics();
+  const int64_t lookups = client_metrics.GetLatencyCount("meta_cache_miss_latency_us");
+  shared_ptr<KuduTable> table;
+  NO_FATALS(CreateTable("latency_metrics", 1, {}, {}, &table));
+
+  shared_ptr<KuduSession> session(client_->NewSession());
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  session->SetTimeoutMillis(60000);
+  const ResourceMetrics& metrics = session->GetWriteOpMetrics();
+  for (int i = 0; i < 3; i++) {
+    NO_FATALS(InsertTestRows(table.get(), session.get(), 10, i * 10));
+    FlushSessionOrDie(session);
+  }
+
+  // The table's tablet had to be looked up from the master.
+  ASSERT_GT(client_metrics.GetLatencyCount("meta_cache_miss_latency_us"), lookups);
+
+  ASSERT_EQ(3, metrics.GetLatencyCount("flush_latency_us"));
+  ASSERT_GT(metrics.GetLatencyPercentile("flush_latency_us", 50), 0);
+  ASSERT_GE(metrics.GetLatencyPercentile("flush_latency_us", 100),
+            metrics.GetLatencyPercentile("flush_latency_us", 50));
+  ASSERT_EQ(0, metrics.GetLatencyCount("buffer_space_wait_latency_us"));
+  ASSERT_EQ(0, metrics.GetLatencyPercentile("buffer_space_wait_latency_us", 99));
+
+  // There's a histogram of the write RPCs to the only tablet server.
+  const string rpc_histogram = "write_rpc_latency_us." +
+      cluster_->mini_tablet_server(0)->server()->instance_pb().permanent_uuid();
+  ASSERT_EQ(metrics.GetMetric("write_rpcs"), metrics.GetLatencyCount(rpc_histogram));
+  vector<string> names = metrics.GetLatencyHistogramNames();
+  ASSERT_EQ((vector<string>{ "flush_latency_us", rpc_histogram }), names);
+
+  // The client's histograms aggregate the ones of its sessions.
+  ASSERT_GE(client_metrics.GetLatencyCount("flush_latency_us"), 3);
+  ASSERT_GE(client_metrics.GetLatencyCount(rpc_histogram), metrics.GetMetric("write_rpcs"));
+}
+
+// Test that writes to several tablets led by the same tablet server are sent
+// in one RPC when multi-tablet writes are enabled.
+TEST_F(ClientTest, TestMultiTabletWrites) {
+  shared_ptr<KuduSession> session(client_->NewSession());
+  ASSERT_OK(session->SetFlushMode(KuduSession::MANUAL_FLUSH));
+  session->SetTimeoutMillis(60000);
+  const ResourceMetrics& metrics = session->GetWriteOpMetrics();
+
+  // The first writes set up the proxy to the tablet server, and are sent to
+  // each tablet separately. The table is split at row 9.
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 4));
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 4, 10));
+  FlushSessionOrDie(session);
+  const int64_t write_rpcs = metrics.GetMetric("write_rpcs");
+  ASSERT_EQ(2, write_rpcs);
+
+  // The table's two tablets are both led by the only tablet server.
+  ASSERT_OK(session->SetMultiTabletWrites(true));
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 4, 4));
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 4, 14));
+  FlushSessionOrDie(session);
+  ASSERT_EQ(write_rpcs + 1, metrics.GetMetric("write_rpcs"));
+  ASSERT_EQ(16, CountRowsFromClient(client_table_.get()));
+
+  // Row errors are reported for each of the batched writes.
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 4));
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 4, 10));
+  Status s = session->Flush();
+  ASSERT_TRUE(s.IsIOError()) << s.ToString();
+  vector<KuduError*> errors;
+  ElementDeleter d(&errors);
+  bool overflow;
+  session->GetPendingErrors(&errors, &overflow);
+  ASSERT_FALSE(overflow);
+  ASSERT_EQ(8, errors.size());
+  for (const KuduError* error : errors) {
+    ASSERT_TRUE(error->status().IsAlreadyPresent()) << error->status().ToString();
+  }
+
+  // Multi-tablet writes may not be changed with writes buffered.
+  NO_FATALS(InsertTestRows(client_table_.get(), session.get(), 1, 1000));
+  s = session->SetMultiTabletWrites(false);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+  FlushSessionOrDie(session);
+  ASSERT_OK(session->SetMultiTabletWrites(false));
+}
+
 // Test that KuduSession::Apply() call blocks in AUTO_FLUSH_BACKGROUND mode
 // if the write operation/mutation buffer does not have enough space
 // to accommodate an incoming write operation.
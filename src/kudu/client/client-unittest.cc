@@ -134,6 +134,59 @@ TEST(ClientUnitTest, TestSchemaBuilder_DefaultValueString) {
   ASSERT_EQ("OK", b.Build(&s).ToString());
 }
 
+TEST(ClientUnitTest, TestSchemaBuilder_Decimal) {
+  {
+    KuduSchema s;
+    KuduSchemaBuilder b;
+    b.AddColumn("key")->Type(KuduColumnSchema::DECIMAL)->Precision(9)->NotNull()->PrimaryKey();
+    b.AddColumn("price")->Type(KuduColumnSchema::DECIMAL)->Precision(20)->Scale(4)
+      ->Default(KuduValue::FromDecimal(12345, 4));
+    ASSERT_EQ("OK", b.Build(&s).ToString());
+    ASSERT_EQ(KuduColumnSchema::DECIMAL, s.Column(1).type());
+    ASSERT_EQ(20, s.Column(1).type_attributes().precision());
+    ASSERT_EQ(4, s.Column(1).type_attributes().scale());
+  }
+  {
+    KuduSchema s;
+    KuduSchemaBuilder b;
+    b.AddColumn("key")->Type(KuduColumnSchema::DECIMAL)->NotNull()->PrimaryKey();
+    ASSERT_EQ("Invalid argument: no precision provided for decimal column: key",
+              b.Build(&s).ToString());
+  }
+  {
+    KuduSchema s;
+    KuduSchemaBuilder b;
+    b.AddColumn("key")->Type(KuduColumnSchema::DECIMAL)->Precision(39)->NotNull()->PrimaryKey();
+    ASSERT_EQ("Invalid argument: precision must be between 1 and 38: key",
+              b.Build(&s).ToString());
+  }
+  {
+    KuduSchema s;
+    KuduSchemaBuilder b;
+    b.AddColumn("key")->Type(KuduColumnSchema::DECIMAL)->Precision(4)->Scale(5)
+      ->NotNull()->PrimaryKey();
+    ASSERT_EQ("Invalid argument: scale must be between 0 and the precision of the column: key",
+              b.Build(&s).ToString());
+  }
+  {
+    KuduSchema s;
+    KuduSchemaBuilder b;
+    b.AddColumn("key")->Type(KuduColumnSchema::INT32)->Precision(4)->NotNull()->PrimaryKey();
+    ASSERT_EQ("Invalid argument: precision and scale are not valid on a INT32 column: key",
+              b.Build(&s).ToString());
+  }
+  {
+    // The default value must have the scale of the column and fit its precision.
+    KuduSchema s;
+    KuduSchemaBuilder b;
+    b.AddColumn("key")->Type(KuduColumnSchema::INT32)->NotNull()->PrimaryKey();
+    b.AddColumn("x")->Type(KuduColumnSchema::DECIMAL)->Precision(3)->Scale(1)
+      ->Default(KuduValue::FromDecimal(12345, 1));
+    ASSERT_EQ("Invalid argument: value 1234.5 out of range for decimal column 'x' "
+              "of precision 3", b.Build(&s).ToString());
+  }
+}
+
 TEST(ClientUnitTest, TestSchemaBuilder_CompoundKey_KeyNotFirst) {
   KuduSchema s;
   KuduSchemaBuilder b;
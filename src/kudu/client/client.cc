@@ -32,9 +32,11 @@
 #include "kudu/client/callbacks.h"
 #include "kudu/client/client-internal.h"
 #include "kudu/client/client_builder-internal.h"
+#include "kudu/client/column_statistics-internal.h"
 #include "kudu/client/error-internal.h"
 #include "kudu/client/error_collector.h"
 #include "kudu/client/meta_cache.h"
+#include "kudu/client/parallel_scanner-internal.h"
 #include "kudu/client/replica-internal.h"
 #include "kudu/client/row_result.h"
 #include "kudu/client/scan_predicate-internal.h"
@@ -240,6 +242,17 @@ KuduClientBuilder& KuduClientBuilder::import_authentication_credentials(string a
   return *this;
 }
 
+KuduClientBuilder& KuduClientBuilder::num_connections_per_server(int num_connections) {
+  data_->num_connections_per_server_ = num_connections;
+  return *this;
+}
+
+KuduClientBuilder& KuduClientBuilder::share_messenger_with(
+    const shared_ptr<KuduClient>& client) {
+  data_->shared_messenger_ = client->data_->messenger_;
+  return *this;
+}
+
 namespace {
 Status ImportAuthnCredsToMessenger(const string& authn_creds,
                                    Messenger* messenger) {
@@ -270,14 +283,28 @@ Status ImportAuthnCredsToMessenger(const string& authn_creds,
 Status KuduClientBuilder::Build(shared_ptr<KuduClient>* client) {
   RETURN_NOT_OK(CheckCPUFlags());
 
-  // Init messenger.
-  MessengerBuilder builder("client");
-  std::shared_ptr<Messenger> messenger;
-  RETURN_NOT_OK(builder.Build(&messenger));
+  if (data_->num_connections_per_server_ < 1) {
+    return Status::InvalidArgument(Substitute("invalid number of connections per server: $0",
+                                              data_->num_connections_per_server_));
+  }
 
-  // Parse and import the provided authn data, if any.
-  if (!data_->authn_creds_.empty()) {
-    RETURN_NOT_OK(ImportAuthnCredsToMessenger(data_->authn_creds_, messenger.get()));
+  std::shared_ptr<Messenger> messenger;
+  if (data_->shared_messenger_) {
+    if (!data_->authn_creds_.empty()) {
+      return Status::InvalidArgument(
+          "cannot import authentication credentials into a shared messenger");
+    }
+    messenger = data_->shared_messenger_;
+  } else {
+    // Init messenger.
+    MessengerBuilder builder("client");
+    builder.set_num_connections_per_server(data_->num_connections_per_server_);
+    RETURN_NOT_OK(builder.Build(&messenger));
+
+    // Parse and import the provided authn data, if any.
+    if (!data_->authn_creds_.empty()) {
+      RETURN_NOT_OK(ImportAuthnCredsToMessenger(data_->authn_creds_, messenger.get()));
+    }
   }
 
   shared_ptr<KuduClient> c(new KuduClient());
@@ -550,6 +577,10 @@ Status KuduClient::ExportAuthenticationCredentials(string* authn_creds) const {
   return Status::OK();
 }
 
+const ResourceMetrics& KuduClient::GetLatencyMetrics() const {
+  return data_->latency_metrics_;
+}
+
 ////////////////////////////////////////////////////////////
 // KuduTableCreator
 ////////////////////////////////////////////////////////////
@@ -777,6 +808,16 @@ const PartitionSchema& KuduTable::partition_schema() const {
   return data_->partition_schema_;
 }
 
+Status KuduTable::PrefetchTabletLocations() {
+  KuduClient* client = data_->client_.get();
+  MonoTime deadline = MonoTime::Now() + client->default_admin_operation_timeout();
+  return client->data_->meta_cache_->PrefetchTabletLocations(this, "", "", deadline);
+}
+
+Status KuduTable::GetColumnStatistics(vector<KuduColumnStatistics*>* stats) {
+  return KuduColumnStatistics::Data::FetchForTable(this, stats);
+}
+
 KuduPredicate* KuduTable::NewComparisonPredicate(const Slice& col_name,
                                                  KuduPredicate::ComparisonOp op,
                                                  KuduValue* value) {
@@ -804,6 +845,15 @@ KuduPredicate* KuduTable::NewInListPredicate(const Slice& col_name,
   });
 }
 
+KuduPredicate* KuduTable::NewInBloomFilterPredicate(const Slice& col_name,
+                                                    KuduBloomFilter* bloom_filter) {
+  // We always take ownership of the filter; this ensures cleanup if the predicate is invalid.
+  std::shared_ptr<KuduBloomFilter> filter(bloom_filter);
+  return data_->MakePredicate(col_name, [&](const ColumnSchema& col_schema) {
+    return new KuduPredicate(new InBloomFilterPredicateData(col_schema, filter));
+  });
+}
+
 KuduPredicate* KuduTable::NewIsNotNullPredicate(const Slice& col_name) {
   return data_->MakePredicate(col_name, [&](const ColumnSchema& col_schema) {
     return new KuduPredicate(new IsNotNullPredicateData(col_schema));
@@ -881,6 +931,10 @@ Status KuduSession::SetExternalConsistencyMode(ExternalConsistencyMode m) {
   return data_->SetExternalConsistencyMode(m);
 }
 
+Status KuduSession::SetMultiTabletWrites(bool enabled) {
+  return data_->SetMultiTabletWrites(enabled);
+}
+
 Status KuduSession::SetMutationBufferSpace(size_t size) {
   return data_->SetBufferBytesLimit(size);
 }
@@ -898,6 +952,14 @@ Status KuduSession::SetMutationBufferMaxNum(unsigned int max_num) {
   return data_->SetMaxBatchersNum(max_num);
 }
 
+Status KuduSession::SetMutationBufferAdaptiveFlush(unsigned int max_latency_millis) {
+  return data_->SetAdaptiveFlush(max_latency_millis);
+}
+
+const ResourceMetrics& KuduSession::GetWriteOpMetrics() const {
+  return data_->write_op_metrics_;
+}
+
 void KuduSession::SetTimeoutMillis(int timeout_ms) {
   data_->SetTimeoutMillis(timeout_ms);
 }
@@ -1231,6 +1293,63 @@ Status KuduScanner::SetCacheBlocks(bool cache_blocks) {
   return data_->mutable_configuration()->SetCacheBlocks(cache_blocks);
 }
 
+Status KuduScanner::SetCacheBlocksLowPriority(bool low_priority) {
+  if (data_->open_) {
+    return Status::IllegalState("Block caching must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetCacheBlocksLowPriority(low_priority);
+}
+
+Status KuduScanner::SetColumnarLayout(bool columnar_layout) {
+  if (data_->open_) {
+    return Status::IllegalState("Row layout must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetColumnarLayout(columnar_layout);
+}
+
+Status KuduScanner::SetPrefetching(bool prefetching) {
+  if (data_->open_) {
+    return Status::IllegalState("Prefetching must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetPrefetching(prefetching);
+}
+
+Status KuduScanner::SetReadAheadBatches(int num_batches) {
+  if (data_->open_) {
+    return Status::IllegalState("Read ahead must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetReadAheadBatches(num_batches);
+}
+
+Status KuduScanner::SetKeepAlivePeriodMillis(int millis) {
+  if (data_->open_) {
+    return Status::IllegalState("Keep-alive period must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetKeepAlivePeriodMillis(millis);
+}
+
+Status KuduScanner::SetProfiling(bool profiling) {
+  if (data_->open_) {
+    return Status::IllegalState("Profiling must be set before Open()");
+  }
+  return data_->mutable_configuration()->SetProfiling(profiling);
+}
+
+Status KuduScanner::SetSidecarCompression(
+    KuduColumnStorageAttributes::CompressionType compression) {
+  if (data_->open_) {
+    return Status::IllegalState("Sidecar compression must be set before Open()");
+  }
+  if (compression != KuduColumnStorageAttributes::NO_COMPRESSION &&
+      compression != KuduColumnStorageAttributes::LZ4 &&
+      compression != KuduColumnStorageAttributes::ZSTD) {
+    return Status::InvalidArgument(Substitute("unsupported sidecar compression: $0",
+                                              compression));
+  }
+  return data_->mutable_configuration()->SetSidecarCompression(
+      ToInternalCompressionType(compression));
+}
+
 KuduSchema KuduScanner::GetProjectionSchema() const {
   return KuduSchema(*data_->configuration().projection());
 }
@@ -1289,6 +1408,11 @@ Status KuduScanner::Open() {
   RETURN_NOT_OK(data_->OpenNextTablet(deadline, &blacklist));
 
   data_->open_ = true;
+  {
+    MutexLock l(data_->read_ahead_lock_);
+    data_->read_ahead_stopped_ = false;
+  }
+  data_->StartKeepAliveTask();
   return Status::OK();
 }
 
@@ -1301,6 +1425,13 @@ void KuduScanner::Close() {
 
   VLOG(2) << "Ending " << data_->DebugString();
 
+  // Wait for any batch being read ahead, which uses the scan request.
+  data_->StopReadAhead();
+  if (data_->keep_alive_state_) {
+    std::lock_guard<simple_spinlock> l(data_->keep_alive_state_->lock);
+    data_->keep_alive_state_->closed = true;
+  }
+
   // Close the scanner on the server-side, if necessary.
   //
   // If the scan did not match any rows, the tserver will not assign a scanner ID.
@@ -1331,6 +1462,10 @@ bool KuduScanner::HasMoreRows() const {
 }
 
 Status KuduScanner::NextBatch(vector<KuduRowResult>* rows) {
+  if (data_->configuration().columnar_layout()) {
+    return Status::IllegalState("columnar scan results must be read with "
+                                "NextBatch(KuduScanBatch*)");
+  }
   RETURN_NOT_OK(NextBatch(&data_->batch_for_old_api_));
   data_->batch_for_old_api_.data_->ExtractRows(rows);
   return Status::OK();
@@ -1354,20 +1489,40 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
     // We have data from a previous scan.
     VLOG(2) << "Extracting data from " << data_->DebugString();
     data_->data_in_open_ = false;
+    data_->MaybeReadAhead();
+    if (data_->configuration().columnar_layout()) {
+      return batch->data_->ResetColumnar(
+          &data_->controller_,
+          data_->configuration().projection(),
+          data_->configuration().client_projection(),
+          data_->last_response_.sidecar_compression(),
+          make_gscoped_ptr(data_->last_response_.release_columnar_data()));
+    }
     return batch->data_->Reset(&data_->controller_,
                                data_->configuration().projection(),
                                data_->configuration().client_projection(),
-                                make_gscoped_ptr(data_->last_response_.release_data()));
+                               data_->last_response_.sidecar_compression(),
+                               make_gscoped_ptr(data_->last_response_.release_data()));
   } else if (data_->last_response_.has_more_results()) {
     // More data is available in this tablet.
     VLOG(2) << "Continuing " << data_->DebugString();
 
     MonoTime batch_deadline = MonoTime::Now() + data_->configuration().timeout();
-    data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+
+    // A batch read ahead takes the place of the first attempt, and if it
+    // failed, its request is retried below like any other.
+    ScanRpcStatus result;
+    bool read_ahead = data_->TakeReadAheadBatch(&result);
+    if (!read_ahead) {
+      data_->PrepareRequest(KuduScanner::Data::CONTINUE);
+    }
 
     while (true) {
-      bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
-      ScanRpcStatus result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      if (!read_ahead) {
+        bool allow_time_for_failover = data_->configuration().is_fault_tolerant();
+        result = data_->SendScanRpc(batch_deadline, allow_time_for_failover);
+      }
+      read_ahead = false;
 
       // Success case.
       if (result.result == ScanRpcStatus::OK) {
@@ -1375,9 +1530,20 @@ Status KuduScanner::NextBatch(KuduScanBatch* batch) {
           data_->last_primary_key_ = data_->last_response_.last_primary_key();
         }
         data_->scan_attempts_ = 0;
+        data_->UpdateKeepAliveScanner();
+        data_->MaybeReadAhead();
+        if (data_->configuration().columnar_layout()) {
+          return batch->data_->ResetColumnar(
+              &data_->controller_,
+              data_->configuration().projection(),
+              data_->configuration().client_projection(),
+              data_->last_response_.sidecar_compression(),
+              make_gscoped_ptr(data_->last_response_.release_columnar_data()));
+        }
         return batch->data_->Reset(&data_->controller_,
                                    data_->configuration().projection(),
                                    data_->configuration().client_projection(),
+                                   data_->last_response_.sidecar_compression(),
                                    make_gscoped_ptr(data_->last_response_.release_data()));
       }
 
@@ -1542,10 +1708,71 @@ Status KuduScanTokenBuilder::SetCacheBlocks(bool cache_blocks) {
   return data_->mutable_configuration()->SetCacheBlocks(cache_blocks);
 }
 
+Status KuduScanTokenBuilder::SetCacheBlocksLowPriority(bool low_priority) {
+  return data_->mutable_configuration()->SetCacheBlocksLowPriority(low_priority);
+}
+
+Status KuduScanTokenBuilder::SetNumRangesPerTablet(int num_ranges) {
+  if (num_ranges <= 0) {
+    return Status::InvalidArgument("Number of ranges per tablet must be positive");
+  }
+  data_->set_num_ranges_per_tablet(num_ranges);
+  return Status::OK();
+}
+
 Status KuduScanTokenBuilder::Build(vector<KuduScanToken*>* tokens) {
   return data_->Build(tokens);
 }
 
+////////////////////////////////////////////////////////////
+// KuduParallelScanner
+////////////////////////////////////////////////////////////
+
+KuduParallelScanner::KuduParallelScanner(KuduScanTokenBuilder* builder)
+    : data_(new KuduParallelScanner::Data(builder)) {
+}
+
+KuduParallelScanner::~KuduParallelScanner() {
+  delete data_;
+}
+
+Status KuduParallelScanner::SetMaxConcurrentScans(int num_scans) {
+  if (num_scans <= 0) {
+    return Status::InvalidArgument("Number of concurrent scans must be positive");
+  }
+  data_->max_concurrent_scans_ = num_scans;
+  return Status::OK();
+}
+
+Status KuduParallelScanner::SetMaxBufferedBytes(int64_t max_bytes) {
+  if (max_bytes <= 0) {
+    return Status::InvalidArgument("Buffered bytes bound must be positive");
+  }
+  data_->max_buffered_bytes_ = max_bytes;
+  return Status::OK();
+}
+
+Status KuduParallelScanner::Open() {
+  return data_->Open();
+}
+
+bool KuduParallelScanner::HasMoreBatches() {
+  return data_->HasMoreBatches();
+}
+
+Status KuduParallelScanner::NextBatch(KuduScanBatch* batch) {
+  unique_ptr<KuduScanBatch> next;
+  RETURN_NOT_OK(data_->NextBatch(&next));
+  // Hand the rows over to the caller's batch; the caller's previous rows
+  // are released along with 'next'.
+  std::swap(batch->data_, next->data_);
+  return Status::OK();
+}
+
+void KuduParallelScanner::Close() {
+  data_->Close();
+}
+
 ////////////////////////////////////////////////////////////
 // KuduReplica
 ////////////////////////////////////////////////////////////
@@ -1586,6 +1813,46 @@ const vector<const KuduReplica*>& KuduTablet::replicas() const {
   return data_->replicas_;
 }
 
+////////////////////////////////////////////////////////////
+// KuduColumnStatistics
+////////////////////////////////////////////////////////////
+
+KuduColumnStatistics::KuduColumnStatistics()
+  : data_(nullptr) {
+}
+
+KuduColumnStatistics::~KuduColumnStatistics() {
+  delete data_;
+}
+
+const string& KuduColumnStatistics::column_name() const {
+  return data_->column_name_;
+}
+
+int64_t KuduColumnStatistics::null_count() const {
+  return data_->stats_.null_count();
+}
+
+int64_t KuduColumnStatistics::non_null_count() const {
+  return data_->stats_.non_null_count();
+}
+
+uint64_t KuduColumnStatistics::distinct_count() const {
+  return data_->stats_.EstimateDistinctCount();
+}
+
+const KuduValue* KuduColumnStatistics::min_value() const {
+  return data_->min_value_.get();
+}
+
+const KuduValue* KuduColumnStatistics::max_value() const {
+  return data_->max_value_.get();
+}
+
+bool KuduColumnStatistics::complete() const {
+  return data_->complete_;
+}
+
 ////////////////////////////////////////////////////////////
 // KuduTabletServer
 ////////////////////////////////////////////////////////////
@@ -55,6 +55,7 @@ class PartitionSchema;
 
 namespace client {
 
+class KuduColumnStatistics;
 class KuduLoggingCallback;
 class KuduScanToken;
 class KuduSession;
@@ -232,6 +233,33 @@ class KUDU_EXPORT KuduClientBuilder {
   ///   @c KuduClient#exportAuthenticationCredentials in the Java client.
   KuduClientBuilder& import_authentication_credentials(std::string authn_creds);
 
+  /// Set the number of connections the client opens to each server.
+  ///
+  /// Calls to a server are spread round-robin over its connections, which
+  /// are handled by different RPC reactor threads. Using more than one
+  /// connection may raise the throughput of clients sending many concurrent
+  /// requests to the same servers. By default, one connection is opened
+  /// to each server.
+  ///
+  /// @param [in] num_connections
+  ///   Number of connections to open to each server; must be at least 1.
+  /// @return Reference to the updated object.
+  KuduClientBuilder& num_connections_per_server(int num_connections);
+
+  /// Share the RPC messenger of another client, along with its reactor
+  /// threads and connections, rather than creating a new one.
+  ///
+  /// The clients must connect to the same cluster, since the messenger
+  /// also holds the credentials used to authenticate to it. For the same
+  /// reason, authentication credentials cannot be imported into a client
+  /// sharing another client's messenger. The number of connections per
+  /// server is that of the other client.
+  ///
+  /// @param [in] client
+  ///   The client whose messenger to share.
+  /// @return Reference to the updated object.
+  KuduClientBuilder& share_messenger_with(const sp::shared_ptr<KuduClient>& client);
+
   /// Create a client object.
   ///
   /// @note KuduClients objects are shared amongst multiple threads and,
@@ -259,9 +287,11 @@ class KUDU_EXPORT KuduClientBuilder {
 /// perspective, they should only need to create one of these in their
 /// application, likely a singleton -- but it is not a singleton in Kudu in any
 /// way. Different KuduClient objects do not interact with each other -- no
-/// connection pooling, etc. With the exception of common properties
-/// managed by free (non-member) functions in the kudu::client namespace,
-/// each KuduClient object is sandboxed with no global cross-client state.
+/// connection pooling, etc., unless built with
+/// KuduClientBuilder::share_messenger_with(). With the exception of common
+/// properties managed by free (non-member) functions in the kudu::client
+/// namespace, each KuduClient object is sandboxed with no global cross-client
+/// state.
 ///
 /// In the implementation, the client holds various pieces of common
 /// infrastructure which is not table-specific:
@@ -497,6 +527,19 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   ///   The resulting binary authentication credsentials.
   Status ExportAuthenticationCredentials(std::string* authn_creds) const;
 
+  /// Get the latency histograms of this client, in microseconds.
+  ///
+  /// These are the histograms of the sessions' flushes, their write RPCs
+  /// (one histogram per tablet server), and the time spent waiting for
+  /// mutation buffer space (see KuduSession::GetWriteOpMetrics()),
+  /// aggregated over all sessions of this client, along with the histogram
+  /// of the meta cache misses, i.e. the tablet location lookups which had
+  /// to ask the master. The histograms are read through
+  /// ResourceMetrics::GetLatencyPercentile() and friends.
+  ///
+  /// @return The latency metrics of this client.
+  const ResourceMetrics& GetLatencyMetrics() const;
+
  private:
   class KUDU_NO_EXPORT Data;
 
@@ -509,6 +552,7 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   friend class internal::WriteRpc;
   friend class ClientTest;
   friend class KuduClientBuilder;
+  friend class KuduColumnStatistics;
   friend class KuduScanner;
   friend class KuduScanToken;
   friend class KuduScanTokenBuilder;
@@ -520,6 +564,7 @@ class KUDU_EXPORT KuduClient : public sp::enable_shared_from_this<KuduClient> {
   FRIEND_TEST(kudu::ClientStressTest, TestUniqueClientIds);
   FRIEND_TEST(ClientTest, TestGetSecurityInfoFromMaster);
   FRIEND_TEST(ClientTest, TestGetTabletServerBlacklist);
+  FRIEND_TEST(ClientTest, TestLatencyBasedReplicaSelection);
   FRIEND_TEST(ClientTest, TestMasterDown);
   FRIEND_TEST(ClientTest, TestMasterLookupPermits);
   FRIEND_TEST(ClientTest, TestMetaCacheExpiry);
@@ -628,6 +673,56 @@ class KUDU_EXPORT KuduTablet {
   DISALLOW_COPY_AND_ASSIGN(KuduTablet);
 };
 
+/// @brief Statistics over the values of a column of a table.
+///
+/// They are computed as the data of the table is written to disk, and help
+/// query engines plan queries over the table, e.g. to order joins, without
+/// scanning it. They describe the on-disk data of the table as it was
+/// written: rows not flushed to disk yet, and later updates and deletes,
+/// are not reflected, so they are estimates.
+class KUDU_EXPORT KuduColumnStatistics {
+ public:
+  ~KuduColumnStatistics();
+
+  /// @return Name of the column.
+  const std::string& column_name() const;
+
+  /// @return The number of null values of the column.
+  int64_t null_count() const;
+
+  /// @return The number of non-null values of the column.
+  int64_t non_null_count() const;
+
+  /// @return The estimated number of distinct non-null values of the
+  ///   column, usually within a few percent of the exact number.
+  uint64_t distinct_count() const;
+
+  /// @return The minimum non-null value of the column, or @c NULL if it
+  ///   has none. The KuduColumnStatistics object retains ownership.
+  const KuduValue* min_value() const;
+
+  /// @return The maximum non-null value of the column, or @c NULL if it
+  ///   has none. The KuduColumnStatistics object retains ownership.
+  const KuduValue* max_value() const;
+
+  /// @return Whether the statistics cover all of the on-disk data of the
+  ///   table. Data written before the column was added, or while the
+  ///   statistics were disabled on the tablet servers, is not.
+  bool complete() const;
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  friend class KuduTable;
+
+  KuduColumnStatistics();
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduColumnStatistics);
+};
+
 /// @brief A helper class to create a new table with the desired options.
 class KUDU_EXPORT KuduTableCreator {
  public:
@@ -940,6 +1035,34 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
   KuduPredicate* NewInListPredicate(const Slice& col_name,
                                     std::vector<KuduValue*>* values);
 
+  /// Create a new IN Bloom filter predicate which can be used for scanners
+  /// on this table.
+  ///
+  /// The predicate matches the rows whose value in the column may have been
+  /// added to the filter, and is evaluated against the filter by the tablet
+  /// servers rather than shipping and searching every value as an IN list
+  /// does. Since Bloom filters admit false positives, some rows whose value
+  /// was never added may also be returned; callers which need exact results
+  /// must check the returned rows themselves.
+  ///
+  /// The type of the filter must correspond to the type of the column to
+  /// which the predicate is to be applied. Scans with this predicate require
+  /// tablet servers which support it.
+  ///
+  /// @param [in] col_name
+  ///   Name of the column to which the predicate applies.
+  /// @param [in] bloom_filter
+  ///   The filter which the column will be matched against. It must not be
+  ///   modified afterwards.
+  /// @return Raw pointer to an IN Bloom filter predicate. The caller owns the
+  ///   predicate until it is passed into KuduScanner::AddConjunctPredicate().
+  ///   The returned predicate takes ownership of the filter. In the case of
+  ///   an error (e.g. an invalid column name), a non-NULL value is still
+  ///   returned. The error will be returned when attempting to add this
+  ///   predicate to a KuduScanner.
+  KuduPredicate* NewInBloomFilterPredicate(const Slice& col_name,
+                                           KuduBloomFilter* bloom_filter);
+
   /// Create a new IS NOT NULL predicate which can be used for scanners on this
   /// table.
   ///
@@ -971,6 +1094,28 @@ class KUDU_EXPORT KuduTable : public sp::enable_shared_from_this<KuduTable> {
   /// @return The partition schema for the table.
   const PartitionSchema& partition_schema() const;
 
+  /// Fetch the locations of all the tablets of the table into the client's
+  /// location cache.
+  ///
+  /// The locations are otherwise fetched a few tablets at a time, the first
+  /// time a row or scan touches them. For a table with many tablets which
+  /// is about to be written or scanned in full, calling this right after
+  /// opening the table replaces those many round trips to the master with
+  /// a few bulk ones.
+  ///
+  /// @return Operation result status. Failing to prefetch the locations
+  ///   is harmless: they're fetched on demand as usual.
+  Status PrefetchTabletLocations();
+
+  /// Fetch the statistics of the columns of the table, merged over all of
+  /// its tablets.
+  ///
+  /// @param [out] stats
+  ///   The statistics, one entry per column of the table, in the order of
+  ///   the schema. The caller owns the entries.
+  /// @return Operation result status.
+  Status GetColumnStatistics(std::vector<KuduColumnStatistics*>* stats);
+
  private:
   class KUDU_NO_EXPORT Data;
 
@@ -1376,6 +1521,30 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   Status SetExternalConsistencyMode(ExternalConsistencyMode m)
     WARN_UNUSED_RESULT;
 
+  /// Set whether flushed write operations destined to different tablets
+  /// whose leaders are on the same tablet server are sent to that server
+  /// in a single RPC.
+  ///
+  /// This saves RPCs when small batches of write operations are spread
+  /// over many tablets, e.g. for tables with many hash partitions.
+  /// Only small per-tablet batches are combined; larger batches are still
+  /// sent in their own RPCs.
+  ///
+  /// @warning
+  ///   Combined writes are not covered by the exactly-once semantics of
+  ///   regular writes. If the connection to the tablet server fails while
+  ///   such writes are in flight, they are resent, and may be applied twice
+  ///   (e.g. an @c INSERT may then fail with an @c AlreadyPresent error).
+  ///   Writes require tablet servers of a version which supports this;
+  ///   older servers are written to as usual.
+  ///
+  /// @param [in] enabled
+  ///   Whether to combine writes to tablets led by the same tablet server.
+  ///   The default is @c false.
+  /// @return Operation result status. An error is returned if there are
+  ///   any pending writes.
+  Status SetMultiTabletWrites(bool enabled) WARN_UNUSED_RESULT;
+
   /// Set the amount of buffer space used by this session for outbound writes.
   ///
   /// The effect of the buffer size varies based on the flush mode of
@@ -1470,6 +1639,33 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Operation result status.
   Status SetMutationBufferMaxNum(unsigned int max_num) WARN_UNUSED_RESULT;
 
+  /// Enable adaptive flushing of the mutation buffer.
+  ///
+  /// With adaptive flushing, the session tunes the flush watermark and the
+  /// interval of the time-based flushing to the write RPC latency and
+  /// throughput it observes for each tablet server, AIMD-style: after each
+  /// flush, the watermark grows additively while the slowest tablet server
+  /// written to responds within @c max_latency_millis, and is halved once it
+  /// doesn't. The flush interval is shortened so that the time operations
+  /// spend in the buffer plus the time to write them stays within the bound.
+  /// The settings of SetMutationBufferFlushWatermark() and
+  /// SetMutationBufferFlushInterval() are the upper limits of the adjustments.
+  /// The current decisions are exported by GetWriteOpMetrics().
+  ///
+  /// By default, adaptive flushing is disabled.
+  ///
+  /// @note This setting is applicable only for AUTO_FLUSH_BACKGROUND sessions.
+  ///   I.e., calling this method in other flush modes is safe, but
+  ///   the parameter has no effect until the session is switched into
+  ///   AUTO_FLUSH_BACKGROUND mode.
+  ///
+  /// @param [in] max_latency_millis
+  ///   The bound on the latency of buffered operations to work to,
+  ///   in milliseconds. Use @c 0 to disable adaptive flushing.
+  /// @return Operation result status.
+  Status SetMutationBufferAdaptiveFlush(unsigned int max_latency_millis)
+      WARN_UNUSED_RESULT;
+
   /// Set the timeout for writes made in this session.
   ///
   /// @param [in] millis
@@ -1655,6 +1851,19 @@ class KUDU_EXPORT KuduSession : public sp::enable_shared_from_this<KuduSession>
   /// @return Client for the session: pointer to the associated client object.
   KuduClient* client() const;
 
+  /// The metrics include the following latency histograms, in microseconds:
+  ///   @li @c flush_latency_us: the time from the flush of a batch of
+  ///     operations until all of them were written or failed;
+  ///   @li @c buffer_space_wait_latency_us: the time Apply() blocked waiting
+  ///     for mutation buffer space;
+  ///   @li @c write_rpc_latency_us.<uuid>: the time of the successful write
+  ///     RPCs to the tablet server with the given UUID.
+  ///
+  /// @return Cumulative metrics of the session's write RPCs, along with the
+  ///   current flush watermark and interval chosen by adaptive flushing
+  ///   (see SetMutationBufferAdaptiveFlush()).
+  const ResourceMetrics& GetWriteOpMetrics() const;
+
  private:
   class KUDU_NO_EXPORT Data;
 
@@ -1854,6 +2063,117 @@ class KUDU_EXPORT KuduScanner {
   /// @return Operation result status.
   Status SetCacheBlocks(bool cache_blocks);
 
+  /// Set whether cached data blocks are cached with low priority.
+  ///
+  /// Low priority blocks are the first to be evicted from the block cache
+  /// unless they are read again, so that a large scan doesn't evict the
+  /// blocks other scans are using. Index blocks are still cached normally.
+  /// This has no effect if block caching is disabled by SetCacheBlocks().
+  ///
+  /// @param [in] low_priority
+  ///   If @c true, scanned data blocks are cached with low priority.
+  ///   Default is @c false.
+  /// @return Operation result status.
+  Status SetCacheBlocksLowPriority(bool low_priority);
+
+  /// Set whether the results are returned in a columnar layout.
+  ///
+  /// In the columnar layout, the tablet server sends the cells of each
+  /// projected column contiguously, and the batches returned by
+  /// NextBatch(KuduScanBatch*) are read with the columnar accessors of
+  /// KuduScanBatch, such as KuduScanBatch::GetFixedLengthColumn(), rather than
+  /// row by row. This avoids decoding the results one row at a time.
+  /// Scans of tablet servers which don't support the columnar layout fail.
+  ///
+  /// @param [in] columnar_layout
+  ///   If @c true, results are returned in the columnar layout.
+  ///   Default is @c false.
+  /// @return Operation result status.
+  Status SetColumnarLayout(bool columnar_layout) WARN_UNUSED_RESULT;
+
+  /// Set whether tablet servers build the next batch ahead of time.
+  ///
+  /// With prefetching, after returning each batch, the tablet server starts
+  /// building the next one in the background, so that its scan time overlaps
+  /// the time the client spends processing the batch it has. This uses more
+  /// memory on the tablet server, and prefetched batches are only built while
+  /// its scan memory budget allows. Prefetching is ignored with the columnar
+  /// layout, and by tablet servers which don't support it.
+  ///
+  /// @param [in] prefetching
+  ///   If @c true, tablet servers prefetch the next batch.
+  ///   Default is @c false.
+  /// @return Operation result status.
+  Status SetPrefetching(bool prefetching) WARN_UNUSED_RESULT;
+
+  /// Set how many batches the client fetches ahead of NextBatch().
+  ///
+  /// By default, the request for each batch is only sent once NextBatch()
+  /// is called, so the round trip to the tablet server never overlaps the
+  /// time the application spends processing the previous batch. With read
+  /// ahead, the client keeps requesting the next batches in the background,
+  /// buffering up to @c num_batches of them, and NextBatch() returns a
+  /// buffered batch whenever there is one. This uses client memory for the
+  /// buffered batches.
+  ///
+  /// @param [in] num_batches
+  ///   The maximum number of batches buffered ahead. Default is 0, which
+  ///   disables read ahead.
+  /// @return Operation result status.
+  Status SetReadAheadBatches(int num_batches) WARN_UNUSED_RESULT;
+
+  /// Set the scanner to be kept alive automatically while it's open.
+  ///
+  /// Tablet servers expire scanners which go unused for longer than their
+  /// scanner TTL, which fails a scan whose application is slow to call
+  /// NextBatch(). With a keep-alive period, the client sends a keep-alive
+  /// request on its own whenever the scanner has gone unused for that long,
+  /// like KeepAlive() does, until the scanner is closed. The period should be
+  /// well under the scanner TTL of the tablet servers.
+  ///
+  /// @param [in] millis
+  ///   The keep-alive period, in milliseconds. By default, scanners are not
+  ///   kept alive automatically.
+  /// @return Operation result status.
+  Status SetKeepAlivePeriodMillis(int millis) WARN_UNUSED_RESULT;
+
+  /// Set whether tablet servers return a profile of the scan execution.
+  ///
+  /// The profile is added to the metrics returned by GetResourceMetrics():
+  /// @c queue_duration_nanos, the time the RPCs waited to be handled;
+  /// @c rowsets_scanned and @c rowsets_pruned, the rowsets scanned and those
+  /// ruled out by the key bounds; @c delta_stores_consulted, the delta files
+  /// applied to the scanned rowsets; @c data_blocks_decoded and
+  /// @c data_blocks_skipped, the data blocks read and those skipped thanks to
+  /// their statistics; and @c predicate_eval_nanos, @c materialize_nanos and
+  /// @c serialize_nanos, the time spent reading the columns with predicates
+  /// and evaluating the predicates, reading the other columns, and
+  /// serializing the results. The per-column figures are also added, named
+  /// after the metric and the column, as in
+  /// @c data_blocks_skipped.column_name. Tablet servers which don't support
+  /// profiling ignore it.
+  ///
+  /// @param [in] profiling
+  ///   If @c true, tablet servers return a profile of the scan.
+  ///   Default is @c false.
+  /// @return Operation result status.
+  Status SetProfiling(bool profiling) WARN_UNUSED_RESULT;
+
+  /// Set the codec which tablet servers compress the scan results with.
+  ///
+  /// Compressing the results lowers the network bandwidth used by scans of
+  /// compressible data at the cost of CPU time on both ends, so it mostly
+  /// pays off when the network, rather than the scan, is the bottleneck.
+  /// Scans of tablet servers which don't support compressed results fail.
+  ///
+  /// @param [in] compression
+  ///   The codec to use: KuduColumnStorageAttributes::NO_COMPRESSION,
+  ///   KuduColumnStorageAttributes::LZ4 or KuduColumnStorageAttributes::ZSTD.
+  ///   Default is KuduColumnStorageAttributes::NO_COMPRESSION.
+  /// @return Operation result status.
+  Status SetSidecarCompression(KuduColumnStorageAttributes::CompressionType compression)
+      WARN_UNUSED_RESULT;
+
   /// @return Result status of the operation (begin scanning).
   Status Open();
 
@@ -1904,7 +2224,8 @@ class KUDU_EXPORT KuduScanner {
   ///
   /// @param [out] rows
   ///   Placeholder for the result.
-  /// @return Operation result status.
+  /// @return Operation result status. Returns Status::IllegalState if
+  ///   the scanner uses the columnar layout.
   Status NextBatch(std::vector<KuduRowResult>* rows)
       ATTRIBUTE_DEPRECATED("use NextBatch(KuduScanBatch*) instead");
 
@@ -2159,6 +2480,9 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   /// @copydoc KuduScanner::SetCacheBlocks
   Status SetCacheBlocks(bool cache_blocks) WARN_UNUSED_RESULT;
 
+  /// @copydoc KuduScanner::SetCacheBlocksLowPriority
+  Status SetCacheBlocksLowPriority(bool low_priority) WARN_UNUSED_RESULT;
+
   /// Set the hint for the size of the next batch in bytes.
   ///
   /// @param [in] batch_size
@@ -2193,6 +2517,21 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   /// @copydoc KuduScanner::SetTimeoutMillis
   Status SetTimeoutMillis(int millis) WARN_UNUSED_RESULT;
 
+  /// Set the number of tokens to build for each tablet.
+  ///
+  /// The primary key range scanned in each tablet is split into up to
+  /// @c num_ranges disjoint sub-ranges holding roughly the same amount of
+  /// data, with one token per sub-range, so that a single tablet can be
+  /// scanned in parallel. The split keys are sampled by a tablet server while
+  /// building the tokens; fewer sub-ranges may be built e.g. for small
+  /// tablets, or if the tablet server does not support splitting.
+  ///
+  /// @param [in] num_ranges
+  ///   The number of sub-ranges per tablet. The default is 1, i.e. a single
+  ///   token per tablet.
+  /// @return Operation result status.
+  Status SetNumRangesPerTablet(int num_ranges) WARN_UNUSED_RESULT;
+
   /// Build the set of scan tokens.
   ///
   /// The builder may be reused after this call.
@@ -2212,6 +2551,100 @@ class KUDU_EXPORT KuduScanTokenBuilder {
   DISALLOW_COPY_AND_ASSIGN(KuduScanTokenBuilder);
 };
 
+/// @brief Scans the tablets of a table concurrently.
+///
+/// A parallel scanner builds scan tokens with a KuduScanTokenBuilder,
+/// and scans several of them at the same time in background threads.
+/// Each thread scans ahead of the caller while the buffered batches take up
+/// less than a configurable amount of memory. The caller then consumes the
+/// batches of all the tokens, in no particular order:
+/// @code
+///   KuduScanTokenBuilder builder(table);
+///   RETURN_NOT_OK(builder.SetProjectedColumnNames({ "key" }));
+///   KuduParallelScanner scanner(&builder);
+///   RETURN_NOT_OK(scanner.Open());
+///   KuduScanBatch batch;
+///   while (scanner.HasMoreBatches()) {
+///     RETURN_NOT_OK(scanner.NextBatch(&batch));
+///     ...
+///   }
+/// @endcode
+///
+/// Each token's scanner retries and fails over as usual; a token whose scan
+/// fails before any of its batches were handed out is scanned again from
+/// the start. A scan which fails after that fails the whole parallel scan,
+/// unless it's fault-tolerant (see KuduScanTokenBuilder::SetFaultTolerant()),
+/// in which case it resumes on another replica.
+///
+/// @note This class is not thread-safe: only one thread may consume
+///   the batches.
+class KUDU_EXPORT KuduParallelScanner {
+ public:
+  /// Construct an instance of the class.
+  ///
+  /// @param [in] builder
+  ///   The builder of the tokens to scan. The given object must remain valid
+  ///   until Open() returns.
+  explicit KuduParallelScanner(KuduScanTokenBuilder* builder);
+
+  /// Stops the scan (see Close()).
+  ~KuduParallelScanner();
+
+  /// Set the number of tokens scanned concurrently.
+  ///
+  /// @param [in] num_scans
+  ///   The number of tokens to scan concurrently, each in its own thread.
+  ///   The default is 4.
+  /// @return Operation result status.
+  Status SetMaxConcurrentScans(int num_scans) WARN_UNUSED_RESULT;
+
+  /// Set the bound on the memory taken up by buffered batches.
+  ///
+  /// The scanning threads stop scanning ahead once the batches they buffered
+  /// take up this much memory. Since each thread can be fetching a batch when
+  /// the bound is reached, the buffered batches may exceed it by up to one
+  /// batch per thread.
+  ///
+  /// @param [in] max_bytes
+  ///   The bound, in bytes. The default is 64MB.
+  /// @return Operation result status.
+  Status SetMaxBufferedBytes(int64_t max_bytes) WARN_UNUSED_RESULT;
+
+  /// Build the scan tokens and start scanning them.
+  ///
+  /// @return Operation result status.
+  Status Open() WARN_UNUSED_RESULT;
+
+  /// Check whether there are more batches to be fetched, waiting for the
+  /// scanning threads if needed.
+  ///
+  /// @return @c true if there are more batches to fetch, or if the scan
+  ///   failed, in which case NextBatch() returns the error.
+  bool HasMoreBatches();
+
+  /// Fetch the next batch, waiting for the scanning threads if needed.
+  ///
+  /// @param [out] batch
+  ///   Placeholder for the batch. Its rows are only valid until the next
+  ///   call to this method with the same batch, or until the parallel
+  ///   scanner is closed.
+  /// @return Operation result status. Returns the error of the first token
+  ///   scan which failed, if any did.
+  Status NextBatch(KuduScanBatch* batch) WARN_UNUSED_RESULT;
+
+  /// Stop scanning, waiting for the scanning threads to exit, and release
+  /// all the buffered batches.
+  void Close();
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduParallelScanner);
+};
+
 } // namespace client
 } // namespace kudu
 #endif
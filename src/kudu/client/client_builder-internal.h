@@ -17,6 +17,7 @@
 #ifndef KUDU_CLIENT_CLIENT_BUILDER_INTERNAL_H
 #define KUDU_CLIENT_CLIENT_BUILDER_INTERNAL_H
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -24,6 +25,10 @@
 
 namespace kudu {
 
+namespace rpc {
+class Messenger;
+} // namespace rpc
+
 namespace client {
 
 class KuduClientBuilder::Data {
@@ -35,6 +40,8 @@ class KuduClientBuilder::Data {
   MonoDelta default_admin_operation_timeout_;
   MonoDelta default_rpc_timeout_;
   std::string authn_creds_;
+  int num_connections_per_server_;
+  std::shared_ptr<rpc::Messenger> shared_messenger_;
 
   DISALLOW_COPY_AND_ASSIGN(Data);
 };
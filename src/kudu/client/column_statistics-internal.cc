@@ -0,0 +1,195 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/client/column_statistics-internal.h"
+
+#include <cstring>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/client/client-internal.h"
+#include "kudu/client/meta_cache.h"
+#include "kudu/common/common.pb.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/types.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tserver/tserver_service.proxy.h"
+#include "kudu/util/async_util.h"
+#include "kudu/util/int128.h"
+
+using kudu::rpc::RpcController;
+using kudu::tserver::GetColumnStatisticsRequestPB;
+using kudu::tserver::GetColumnStatisticsResponsePB;
+using std::set;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace client {
+
+namespace {
+
+template<typename T>
+T LoadValue(const Slice& bytes) {
+  DCHECK_EQ(sizeof(T), bytes.size());
+  T value;
+  memcpy(&value, bytes.data(), sizeof(T));
+  return value;
+}
+
+} // anonymous namespace
+
+KuduColumnStatistics::Data::Data(const ColumnSchema& col)
+    : column_name_(col.name()),
+      scale_(col.type_attributes().scale),
+      stats_(col.type_info()),
+      complete_(true) {
+}
+
+KuduColumnStatistics::Data::~Data() {
+}
+
+KuduValue* KuduColumnStatistics::Data::MakeValue(const Slice& bytes) const {
+  switch (stats_.type()->type()) {
+    case BOOL:
+      return KuduValue::FromBool(LoadValue<bool>(bytes));
+    case INT8:
+      return KuduValue::FromInt(LoadValue<int8_t>(bytes));
+    case INT16:
+      return KuduValue::FromInt(LoadValue<int16_t>(bytes));
+    case INT32:
+      return KuduValue::FromInt(LoadValue<int32_t>(bytes));
+    case INT64:
+    case UNIXTIME_MICROS:
+      return KuduValue::FromInt(LoadValue<int64_t>(bytes));
+    case FLOAT:
+      return KuduValue::FromFloat(LoadValue<float>(bytes));
+    case DOUBLE:
+      return KuduValue::FromDouble(LoadValue<double>(bytes));
+    case STRING:
+    case BINARY:
+      return KuduValue::CopyString(bytes);
+    case DECIMAL32:
+      return KuduValue::FromDecimal(LoadValue<int32_t>(bytes), scale_);
+    case DECIMAL64:
+      return KuduValue::FromDecimal(LoadValue<int64_t>(bytes), scale_);
+    case DECIMAL128:
+      return KuduValue::FromDecimal(LoadValue<int128_t>(bytes), scale_);
+    default:
+      LOG(FATAL) << "Unexpected column type: " << stats_.type()->name();
+  }
+  return nullptr;
+}
+
+Status KuduColumnStatistics::Data::FetchForTable(KuduTable* table,
+                                                 vector<KuduColumnStatistics*>* stats) {
+  KuduClient* client = table->client();
+  const Schema& schema = *table->schema().schema_;
+  vector<unique_ptr<KuduColumnStatistics>> columns;
+  for (int i = 0; i < schema.num_columns(); i++) {
+    unique_ptr<KuduColumnStatistics> col(new KuduColumnStatistics());
+    col->data_ = new Data(schema.column(i));
+    columns.emplace_back(std::move(col));
+  }
+
+  MonoTime deadline = MonoTime::Now() + client->default_admin_operation_timeout();
+  // Fetch the locations in bulk rather than with a master round trip every
+  // few tablets below. On failure the lookups below fetch them anyway.
+  Status s = client->data_->meta_cache_->PrefetchTabletLocations(table, "", "", deadline);
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG(WARNING) << "Unable to prefetch the tablet locations of table " << table->name()
+                 << ": " << s.ToString();
+  }
+  string partition_key;
+  while (true) {
+    scoped_refptr<internal::RemoteTablet> tablet;
+    Synchronizer sync;
+    client->data_->meta_cache_->LookupTabletByKeyOrNext(table, partition_key, deadline,
+                                                        &tablet, sync.AsStatusCallback());
+    s = sync.Wait();
+    if (s.IsNotFound()) {
+      // No more tablets in the table.
+      break;
+    }
+    RETURN_NOT_OK(s);
+
+    internal::RemoteTabletServer* ts;
+    vector<internal::RemoteTabletServer*> candidates;
+    RETURN_NOT_OK(client->data_->GetTabletServer(client, tablet, KuduClient::CLOSEST_REPLICA,
+                                                 set<string>(), &candidates, &ts));
+    GetColumnStatisticsRequestPB req;
+    req.set_tablet_id(tablet->tablet_id());
+    GetColumnStatisticsResponsePB resp;
+    RpcController rpc;
+    rpc.set_deadline(deadline);
+    RETURN_NOT_OK_PREPEND(ts->proxy()->GetColumnStatistics(req, &resp, &rpc),
+                          Substitute("Unable to fetch the column statistics of tablet $0",
+                                     tablet->tablet_id()));
+    if (resp.has_error()) {
+      return StatusFromPB(resp.error().status());
+    }
+
+    vector<bool> reported(columns.size(), false);
+    for (const auto& col_pb : resp.columns()) {
+      // The schema of the table may have changed since it was opened.
+      int idx = schema.find_column(col_pb.name());
+      if (idx == Schema::kColumnNotFound ||
+          col_pb.type() != schema.column(idx).type_info()->type()) {
+        continue;
+      }
+      Data* data = columns[idx]->data_;
+      ColumnStatistics tablet_stats(data->stats_.type());
+      RETURN_NOT_OK_PREPEND(tablet_stats.FromPB(col_pb.stats()),
+                            Substitute("Invalid statistics of column $0 of tablet $1",
+                                       col_pb.name(), tablet->tablet_id()));
+      RETURN_NOT_OK(data->stats_.Merge(tablet_stats));
+      data->complete_ = data->complete_ && col_pb.complete();
+      reported[idx] = true;
+    }
+    for (int i = 0; i < columns.size(); i++) {
+      if (!reported[i]) {
+        columns[i]->data_->complete_ = false;
+      }
+    }
+
+    partition_key = tablet->partition().partition_key_end();
+    if (partition_key.empty()) {
+      break;
+    }
+  }
+
+  for (auto& col : columns) {
+    Data* data = col->data_;
+    if (data->stats_.non_null_count() > 0) {
+      data->min_value_.reset(data->MakeValue(data->stats_.min_value()));
+      data->max_value_.reset(data->MakeValue(data->stats_.max_value()));
+    }
+    stats->push_back(col.release());
+  }
+  return Status::OK();
+}
+
+} // namespace client
+} // namespace kudu
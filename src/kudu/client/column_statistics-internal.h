@@ -0,0 +1,61 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/client/value.h"
+#include "kudu/common/column_statistics.h"
+#include "kudu/gutil/macros.h"
+
+namespace kudu {
+
+class ColumnSchema;
+
+namespace client {
+
+class KuduColumnStatistics::Data {
+ public:
+  explicit Data(const ColumnSchema& col);
+  ~Data();
+
+  // Fetches the statistics of the tablets of 'table' and merges them into
+  // 'stats', one entry per column of the schema of 'table'.
+  static Status FetchForTable(KuduTable* table, std::vector<KuduColumnStatistics*>* stats);
+
+  const std::string column_name_;
+  const int8_t scale_;
+  ColumnStatistics stats_;
+  bool complete_;
+
+  // Built from 'stats_' once all of them are merged.
+  std::unique_ptr<KuduValue> min_value_;
+  std::unique_ptr<KuduValue> max_value_;
+
+ private:
+  // Returns the value of the column held in 'bytes', encoded as in
+  // ColumnStatistics::min_value().
+  KuduValue* MakeValue(const Slice& bytes) const;
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+} // namespace client
+} // namespace kudu
@@ -36,6 +36,7 @@
 #include "kudu/util/logging.h"
 #include "kudu/util/net/dns_resolver.h"
 #include "kudu/util/net/net_util.h"
+#include "kudu/util/async_util.h"
 #include "kudu/util/pb_util.h"
 
 using std::map;
@@ -63,12 +64,27 @@ namespace internal {
 
 namespace {
 const int MAX_RETURNED_TABLE_LOCATIONS = 10;
+
+// The number of tablet locations asked for at once when prefetching the
+// locations of a range of a table.
+const int MAX_PREFETCHED_TABLE_LOCATIONS = 1000;
+
+// The weight of the most recent RPC in a tablet server's weighted latency
+// and error rate.
+const double kRpcResultWeight = 0.2;
+
+// How much a tablet server's error rate inflates its latency score: a server
+// failing every RPC looks this many times slower than its latency alone.
+const double kErrorRatePenalty = 10;
 } // anonymous namespace
 
 ////////////////////////////////////////////////////////////
 
 RemoteTabletServer::RemoteTabletServer(const master::TSInfoPB& pb)
-  : uuid_(pb.permanent_uuid()) {
+  : uuid_(pb.permanent_uuid()),
+    has_latency_(false),
+    latency_us_(0),
+    error_rate_(0) {
 
   Update(pb);
 }
@@ -147,6 +163,11 @@ shared_ptr<TabletServerServiceProxy> RemoteTabletServer::proxy() const {
   return proxy_;
 }
 
+bool RemoteTabletServer::HasProxy() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return proxy_ != nullptr;
+}
+
 string RemoteTabletServer::ToString() const {
   string ret = uuid_;
   std::lock_guard<simple_spinlock> l(lock_);
@@ -161,6 +182,41 @@ void RemoteTabletServer::GetHostPorts(vector<HostPort>* host_ports) const {
   *host_ports = rpc_hostports_;
 }
 
+void RemoteTabletServer::RecordRpcResult(const MonoDelta& latency, bool failed) {
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(lock_);
+  error_rate_ += kRpcResultWeight * ((failed ? 1 : 0) - error_rate_);
+  if (!failed) {
+    double latency_us = latency.ToMicroseconds();
+    if (has_latency_) {
+      latency_us_ += kRpcResultWeight * (latency_us - latency_us_);
+    } else {
+      latency_us_ = latency_us;
+      has_latency_ = true;
+    }
+  }
+  last_result_time_ = now;
+}
+
+bool RemoteTabletServer::GetLatencyScore(double* score) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (!has_latency_) {
+    return false;
+  }
+  *score = latency_us_ * (1 + kErrorRatePenalty * error_rate_);
+  return true;
+}
+
+bool RemoteTabletServer::TryStartProbe(const MonoTime& now, const MonoDelta& interval) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if ((last_result_time_.Initialized() && now - last_result_time_ < interval) ||
+      (last_probe_time_.Initialized() && now - last_probe_time_ < interval)) {
+    return false;
+  }
+  last_probe_time_ = now;
+  return true;
+}
+
 ////////////////////////////////////////////////////////////
 
 
@@ -273,6 +329,16 @@ void RemoteTablet::MarkTServerAsFollower(const RemoteTabletServer* server) {
   VLOG(3) << "Latest replicas: " << ReplicasAsStringUnlocked();
 }
 
+RemoteTabletServer* RemoteTablet::preferred_replica() const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return preferred_replica_;
+}
+
+void RemoteTablet::set_preferred_replica(RemoteTabletServer* ts) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  preferred_replica_ = ts;
+}
+
 string RemoteTablet::ReplicasAsString() const {
   std::lock_guard<simple_spinlock> l(lock_);
   return ReplicasAsStringUnlocked();
@@ -493,7 +559,7 @@ MetaCache::~MetaCache() {
 }
 
 void MetaCache::UpdateTabletServer(const TSInfoPB& pb) {
-  DCHECK(lock_.is_write_locked());
+  DCHECK(lock_.is_locked());
   RemoteTabletServer* ts = FindPtrOrNull(ts_cache_, pb.permanent_uuid());
   if (ts) {
     ts->Update(pb);
@@ -517,7 +583,8 @@ class LookupRpc : public Rpc {
             scoped_refptr<RemoteTablet>* remote_tablet,
             const MonoTime& deadline,
             shared_ptr<Messenger> messenger,
-            bool is_exact_lookup);
+            bool is_exact_lookup,
+            int max_returned_locations = MAX_RETURNED_TABLE_LOCATIONS);
   virtual ~LookupRpc();
   virtual void SendRpc() OVERRIDE;
   virtual string ToString() const OVERRIDE;
@@ -528,6 +595,7 @@ class LookupRpc : public Rpc {
   const string& table_id() const { return table_->id(); }
   const string& partition_key() const { return partition_key_; }
   bool is_exact_lookup() const { return is_exact_lookup_; }
+  int max_returned_locations() const { return max_returned_locations_; }
   const KuduTable* table() const { return table_; }
 
  private:
@@ -576,6 +644,12 @@ class LookupRpc : public Rpc {
   // partition key. If false, the next tablet after the partition key should be
   // returned if the partition key falls in a non-covered partition range.
   bool is_exact_lookup_;
+
+  // The maximum number of tablet locations to ask the master for.
+  const int max_returned_locations_;
+
+  // When the lookup started, for the client's meta cache miss latency histogram.
+  const MonoTime start_time_;
 };
 
 LookupRpc::LookupRpc(const scoped_refptr<MetaCache>& meta_cache,
@@ -584,7 +658,8 @@ LookupRpc::LookupRpc(const scoped_refptr<MetaCache>& meta_cache,
                      scoped_refptr<RemoteTablet>* remote_tablet,
                      const MonoTime& deadline,
                      shared_ptr<Messenger> messenger,
-                     bool is_exact_lookup)
+                     bool is_exact_lookup,
+                     int max_returned_locations)
     : Rpc(deadline, std::move(messenger)),
       meta_cache_(meta_cache),
       user_cb_(std::move(user_cb)),
@@ -592,7 +667,9 @@ LookupRpc::LookupRpc(const scoped_refptr<MetaCache>& meta_cache,
       partition_key_(std::move(partition_key)),
       remote_tablet_(remote_tablet),
       has_permit_(false),
-      is_exact_lookup_(is_exact_lookup) {
+      is_exact_lookup_(is_exact_lookup),
+      max_returned_locations_(max_returned_locations),
+      start_time_(MonoTime::Now()) {
   DCHECK(deadline.Initialized());
 }
 
@@ -642,7 +719,7 @@ void LookupRpc::SendRpc() {
   // Fill out the request.
   req_.mutable_table()->set_table_id(table_->id());
   req_.set_partition_key_start(partition_key_);
-  req_.set_max_returned_locations(MAX_RETURNED_TABLE_LOCATIONS);
+  req_.set_max_returned_locations(max_returned_locations_);
 
   // The end partition key is left unset intentionally so that we'll prefetch
   // some additional tablets.
@@ -764,6 +841,8 @@ void LookupRpc::SendRpcCb(const Status& status) {
     new_status = new_status.CloneAndPrepend(Substitute("$0 failed", ToString()));
     KLOG_EVERY_N_SECS(WARNING, 1) << new_status.ToString();
   }
+  meta_cache_->client_->data_->latency_metrics_.RecordLatency(
+      "meta_cache_miss_latency_us", (MonoTime::Now() - start_time_).ToMicroseconds());
   user_cb_.Run(new_status);
 }
 
@@ -775,7 +854,7 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
   MonoTime expiration_time = MonoTime::Now() +
       MonoDelta::FromMilliseconds(rpc.resp().ttl_millis());
 
-  std::lock_guard<rw_spinlock> l(lock_);
+  std::lock_guard<percpu_rwlock> l(lock_);
   TabletMap& tablets_by_key = LookupOrInsert(&tablets_by_table_and_key_,
                                              rpc.table_id(), TabletMap());
 
@@ -888,7 +967,7 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
       InsertOrDie(&tablets_by_key, tablet_lower_bound, std::move(entry));
     }
 
-    if (!last_upper_bound.empty() && tablet_locations.size() < MAX_RETURNED_TABLE_LOCATIONS) {
+    if (!last_upper_bound.empty() && tablet_locations.size() < rpc.max_returned_locations()) {
       // There is a non-covered range between the last tablet and the end of the
       // partition key space, such as F.
 
@@ -915,7 +994,9 @@ Status MetaCache::ProcessLookupResponse(const LookupRpc& rpc,
 bool MetaCache::LookupTabletByKeyFastPath(const KuduTable* table,
                                           const string& partition_key,
                                           MetaCacheEntry* entry) {
-  shared_lock<rw_spinlock> l(lock_);
+  // Only this CPU's share of the lock is taken, so concurrent lookups don't
+  // contend on the lock's cache line.
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table->id());
   if (PREDICT_FALSE(!tablets)) {
     // No cache available for this table.
@@ -943,7 +1024,7 @@ bool MetaCache::LookupTabletByKeyFastPath(const KuduTable* table,
 
 void MetaCache::ClearCache() {
   VLOG(3) << "Clearing cache";
-  std::lock_guard<rw_spinlock> l(lock_);
+  std::lock_guard<percpu_rwlock> l(lock_);
   STLDeleteValues(&ts_cache_);
   tablets_by_id_.clear();
   tablets_by_table_and_key_.clear();
@@ -981,10 +1062,72 @@ void MetaCache::LookupTabletByKeyOrNext(const KuduTable* table,
   rpc->SendRpc();
 }
 
+Status MetaCache::PrefetchTabletLocations(const KuduTable* table,
+                                          const string& lower_partition_key,
+                                          const string& upper_partition_key,
+                                          const MonoTime& deadline) {
+  string partition_key = lower_partition_key;
+  while (upper_partition_key.empty() || partition_key < upper_partition_key) {
+    // Skip what's already cached.
+    if (FindCachedRangeEnd(table, &partition_key)) {
+      if (partition_key.empty()) {
+        break;
+      }
+      continue;
+    }
+
+    Synchronizer sync;
+    scoped_refptr<RemoteTablet> tablet;
+    LookupRpc* rpc = new LookupRpc(this,
+                                   sync.AsStatusCallback(),
+                                   table,
+                                   partition_key,
+                                   &tablet,
+                                   deadline,
+                                   client_->data_->messenger_,
+                                   false,
+                                   MAX_PREFETCHED_TABLE_LOCATIONS);
+    rpc->SendRpc();
+    Status s = sync.Wait();
+    if (s.IsNotFound()) {
+      // No more tablets in the table.
+      break;
+    }
+    RETURN_NOT_OK(s);
+
+    const string& tablet_end = tablet->partition().partition_key_end();
+    if (tablet_end.empty()) {
+      break;
+    }
+    partition_key = std::max(partition_key, tablet_end);
+  }
+  return Status::OK();
+}
+
+bool MetaCache::FindCachedRangeEnd(const KuduTable* table, string* partition_key) {
+  shared_lock<rw_spinlock> l(lock_.get_lock());
+  const TabletMap* tablets = FindOrNull(tablets_by_table_and_key_, table->id());
+  if (!tablets) {
+    return false;
+  }
+  bool found = false;
+  while (true) {
+    const MetaCacheEntry* e = FindFloorOrNull(*tablets, *partition_key);
+    if (!e || e->stale() || !e->Contains(*partition_key)) {
+      return found;
+    }
+    found = true;
+    *partition_key = e->upper_bound_partition_key();
+    if (partition_key->empty()) {
+      return true;
+    }
+  }
+}
+
 void MetaCache::MarkTSFailed(RemoteTabletServer* ts,
                              const Status& status) {
   LOG(INFO) << "Marking tablet server " << ts->ToString() << " as failed.";
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
 
   Status ts_status = status.CloneAndPrepend("TS failed");
 
@@ -87,6 +87,9 @@ class RemoteTabletServer {
   // be called prior to this.
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy() const;
 
+  // Return whether InitProxy() has set up a proxy to this tablet server.
+  bool HasProxy() const;
+
   std::string ToString() const;
 
   void GetHostPorts(std::vector<HostPort>* host_ports) const;
@@ -94,6 +97,22 @@ class RemoteTabletServer {
   // Returns the remote server's uuid.
   const std::string& permanent_uuid() const;
 
+  // Records the outcome of an RPC to this tablet server which took
+  // 'latency', updating the server's exponentially weighted RPC latency
+  // and error rate. The latency of failed RPCs isn't taken into account.
+  void RecordRpcResult(const MonoDelta& latency, bool failed);
+
+  // Sets 'score' to the expected cost of an RPC to this tablet server: its
+  // weighted latency in microseconds, penalized by its error rate. Returns
+  // false if no successful RPC to the server was recorded yet.
+  bool GetLatencyScore(double* score) const;
+
+  // Returns true, and records a probe at 'now', if neither an RPC result
+  // nor a probe was recorded for this tablet server within 'interval' of
+  // 'now'. Used to send the occasional RPC to a replica which isn't the
+  // fastest one, so that its statistics don't go stale.
+  bool TryStartProbe(const MonoTime& now, const MonoDelta& interval);
+
  private:
   // Internal callback for DNS resolution.
   void DnsResolutionFinished(const HostPort& hp,
@@ -108,6 +127,14 @@ class RemoteTabletServer {
   std::vector<HostPort> rpc_hostports_;
   std::shared_ptr<tserver::TabletServerServiceProxy> proxy_;
 
+  // The exponentially weighted RPC latency and error rate of this server,
+  // and when they were last updated or the server was last probed.
+  bool has_latency_;
+  double latency_us_;
+  double error_rate_;
+  MonoTime last_result_time_;
+  MonoTime last_probe_time_;
+
   DISALLOW_COPY_AND_ASSIGN(RemoteTabletServer);
 };
 
@@ -174,7 +201,8 @@ class RemoteTablet : public RefCountedThreadSafe<RemoteTablet> {
                Partition partition)
       : tablet_id_(std::move(tablet_id)),
         partition_(std::move(partition)),
-        stale_(false) {
+        stale_(false),
+        preferred_replica_(nullptr) {
   }
 
   // Updates this tablet's replica locations.
@@ -234,6 +262,12 @@ class RemoteTablet : public RefCountedThreadSafe<RemoteTablet> {
   // Return stringified representation of the list of replicas for this tablet.
   std::string ReplicasAsString() const;
 
+  // The replica which scans that may go to any replica of this tablet were
+  // last sent to, or NULL if there's none yet. Scans stick to it until
+  // another replica is substantially faster.
+  RemoteTabletServer* preferred_replica() const;
+  void set_preferred_replica(RemoteTabletServer* ts);
+
  private:
   // Same as ReplicasAsString(), except that the caller must hold lock_.
   std::string ReplicasAsStringUnlocked() const;
@@ -245,6 +279,7 @@ class RemoteTablet : public RefCountedThreadSafe<RemoteTablet> {
   mutable simple_spinlock lock_;
   bool stale_;
   std::vector<RemoteReplica> replicas_;
+  RemoteTabletServer* preferred_replica_;
 
   DISALLOW_COPY_AND_ASSIGN(RemoteTablet);
 };
@@ -380,6 +415,17 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
                                scoped_refptr<RemoteTablet>* remote_tablet,
                                const StatusCallback& callback);
 
+  // Fetches the locations of all the tablets of 'table' covering the
+  // partition keys from 'lower_partition_key' (inclusive) to
+  // 'upper_partition_key' (exclusive, or the end of the table if empty) into
+  // the cache, asking the master for many tablets at a time rather than
+  // the few of each lookup. Synchronous, so it may not be called from an
+  // IO thread.
+  Status PrefetchTabletLocations(const KuduTable* table,
+                                 const std::string& lower_partition_key,
+                                 const std::string& upper_partition_key,
+                                 const MonoTime& deadline);
+
   // Clears the meta cache.
   void ClearCache();
 
@@ -399,6 +445,7 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
 
   FRIEND_TEST(client::ClientTest, TestMasterLookupPermits);
   FRIEND_TEST(client::ClientTest, TestMetaCacheExpiry);
+  FRIEND_TEST(client::ClientTest, TestPrefetchTabletLocations);
 
   // Called on the slow LookupTablet path when the master responds. Populates
   // the tablet caches and returns a reference to the first one.
@@ -410,6 +457,11 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
                                  const std::string& partition_key,
                                  MetaCacheEntry* entry);
 
+  // If 'partition_key' of 'table' is cached with a fresh entry, advances
+  // it to the end of the contiguous range of such cached entries, which is
+  // empty if they extend to the end of the table, and returns true.
+  bool FindCachedRangeEnd(const KuduTable* table, std::string* partition_key);
+
   // Update our information about the given tablet server.
   //
   // This is called when we get some response from the master which contains
@@ -420,7 +472,9 @@ class MetaCache : public RefCountedThreadSafe<MetaCache> {
 
   KuduClient* client_;
 
-  rw_spinlock lock_;
+  // Lookups take a read lock for every operation routed by the client, so
+  // this is a per-CPU lock: readers only touch their own CPU's share of it.
+  percpu_rwlock lock_;
 
   // Cache of Tablet Server locations: TS UUID -> RemoteTabletServer*.
   //
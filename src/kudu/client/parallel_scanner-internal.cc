@@ -0,0 +1,215 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/client/parallel_scanner-internal.h"
+
+#include <algorithm>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "kudu/client/scanner-internal.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/thread.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace client {
+
+namespace {
+
+// The number of times the scan of a token is attempted, as long as it
+// fails before any of its batches were queued.
+const int kMaxTokenScanAttempts = 3;
+
+} // anonymous namespace
+
+KuduParallelScanner::Data::Data(KuduScanTokenBuilder* builder)
+    : max_concurrent_scans_(4),
+      max_buffered_bytes_(64 * 1024 * 1024),
+      builder_(builder),
+      cond_(&lock_),
+      next_token_(0),
+      running_threads_(0),
+      buffered_bytes_(0),
+      closing_(false) {
+}
+
+KuduParallelScanner::Data::~Data() {
+  Close();
+}
+
+Status KuduParallelScanner::Data::Open() {
+  if (!tokens_.empty() || !threads_.empty()) {
+    return Status::IllegalState("parallel scanner already open");
+  }
+  vector<KuduScanToken*> tokens;
+  RETURN_NOT_OK(builder_->Build(&tokens));
+  for (KuduScanToken* token : tokens) {
+    tokens_.emplace_back(token);
+  }
+
+  int num_threads = std::min<int>(max_concurrent_scans_, tokens_.size());
+  VLOG(1) << "Scanning " << tokens_.size() << " tokens with " << num_threads << " threads";
+  {
+    MutexLock l(lock_);
+    running_threads_ = num_threads;
+  }
+  for (int i = 0; i < num_threads; i++) {
+    scoped_refptr<Thread> thread;
+    Status s = Thread::Create("client", Substitute("parallel-scan [worker $0]", i),
+                              &KuduParallelScanner::Data::ScanThread, this, &thread);
+    if (PREDICT_FALSE(!s.ok())) {
+      {
+        MutexLock l(lock_);
+        running_threads_ -= num_threads - i;
+      }
+      Close();
+      return s;
+    }
+    threads_.push_back(std::move(thread));
+  }
+  return Status::OK();
+}
+
+void KuduParallelScanner::Data::ScanThread() {
+  while (true) {
+    int idx;
+    {
+      MutexLock l(lock_);
+      if (closing_ || !status_.ok() || next_token_ == static_cast<int>(tokens_.size())) {
+        break;
+      }
+      idx = next_token_++;
+    }
+
+    Status s;
+    for (int attempt = 1; attempt <= kMaxTokenScanAttempts; attempt++) {
+      bool queued_batches = false;
+      s = ScanToken(idx, &queued_batches);
+      if (s.ok() || queued_batches) {
+        break;
+      }
+      // Nothing of the token has been handed out yet, so its scan can be
+      // started over without returning any row twice.
+      VLOG(1) << "Scan of tablet " << tokens_[idx]->tablet().id() << " failed ("
+              << s.ToString() << "), attempt " << attempt << " of " << kMaxTokenScanAttempts;
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      MutexLock l(lock_);
+      if (status_.ok()) {
+        status_ = s.CloneAndPrepend(
+            Substitute("failed to scan tablet $0", tokens_[idx]->tablet().id()));
+      }
+      cond_.Broadcast();
+      break;
+    }
+  }
+
+  MutexLock l(lock_);
+  running_threads_--;
+  cond_.Broadcast();
+}
+
+Status KuduParallelScanner::Data::ScanToken(int idx, bool* queued_batches) {
+  KuduScanner* scanner_ptr;
+  RETURN_NOT_OK(tokens_[idx]->IntoKuduScanner(&scanner_ptr));
+  unique_ptr<KuduScanner> scanner(scanner_ptr);
+  KuduScanner* scanner_raw = scanner.get();
+  {
+    // Keep the scanner around for the batches which point to its projection.
+    MutexLock l(lock_);
+    scanners_.push_back(std::move(scanner));
+  }
+
+  RETURN_NOT_OK(scanner_raw->Open());
+  while (scanner_raw->HasMoreRows()) {
+    // Only scan ahead while there's room for more buffered batches.
+    {
+      MutexLock l(lock_);
+      while (buffered_bytes_ >= max_buffered_bytes_ && !closing_ && status_.ok()) {
+        cond_.Wait();
+      }
+      if (closing_ || !status_.ok()) {
+        break;
+      }
+    }
+
+    unique_ptr<KuduScanBatch> batch(new KuduScanBatch());
+    RETURN_NOT_OK(scanner_raw->NextBatch(batch.get()));
+    if (batch->NumRows() == 0) {
+      continue;
+    }
+    int64_t bytes = batch->data_->data_size();
+    MutexLock l(lock_);
+    buffered_bytes_ += bytes;
+    batches_.emplace_back(std::move(batch), bytes);
+    *queued_batches = true;
+    cond_.Broadcast();
+  }
+  scanner_raw->Close();
+  return Status::OK();
+}
+
+bool KuduParallelScanner::Data::HasMoreBatches() {
+  MutexLock l(lock_);
+  while (batches_.empty() && running_threads_ > 0 && status_.ok()) {
+    cond_.Wait();
+  }
+  // Report any failure from NextBatch().
+  return !batches_.empty() || !status_.ok();
+}
+
+Status KuduParallelScanner::Data::NextBatch(unique_ptr<KuduScanBatch>* batch) {
+  MutexLock l(lock_);
+  while (batches_.empty() && running_threads_ > 0 && status_.ok()) {
+    cond_.Wait();
+  }
+  RETURN_NOT_OK(status_);
+  if (batches_.empty()) {
+    return Status::IllegalState("no more batches");
+  }
+  *batch = std::move(batches_.front().first);
+  buffered_bytes_ -= batches_.front().second;
+  batches_.pop_front();
+  cond_.Broadcast();
+  return Status::OK();
+}
+
+void KuduParallelScanner::Data::Close() {
+  {
+    MutexLock l(lock_);
+    closing_ = true;
+    cond_.Broadcast();
+  }
+  for (const scoped_refptr<Thread>& thread : threads_) {
+    thread->Join();
+  }
+  threads_.clear();
+
+  // The batches point to the projections of the scanners.
+  batches_.clear();
+  buffered_bytes_ = 0;
+  scanners_.clear();
+}
+
+} // namespace client
+} // namespace kudu
@@ -0,0 +1,102 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class Thread;
+
+namespace client {
+
+class KuduParallelScanner::Data {
+ public:
+  explicit Data(KuduScanTokenBuilder* builder);
+  ~Data();
+
+  Status Open();
+
+  bool HasMoreBatches();
+
+  // Hands the next buffered batch over to the caller.
+  Status NextBatch(std::unique_ptr<KuduScanBatch>* batch);
+
+  void Close();
+
+  // The number of tokens scanned at the same time.
+  int max_concurrent_scans_;
+
+  // The bound on the size of the buffered batches.
+  int64_t max_buffered_bytes_;
+
+ private:
+  // The body of each scanning thread: scans tokens until there are none
+  // left, or the scan fails or is closed.
+  void ScanThread();
+
+  // Scans the token at 'idx', queuing its batches. Sets '*queued_batches'
+  // if any batches were queued, in which case the token can't be retried.
+  Status ScanToken(int idx, bool* queued_batches);
+
+  KuduScanTokenBuilder* const builder_;
+
+  std::vector<std::unique_ptr<KuduScanToken>> tokens_;
+  std::vector<scoped_refptr<Thread>> threads_;
+
+  Mutex lock_;
+
+  // Signalled whenever a batch is queued or dequeued, a scanning thread
+  // exits, or the scan fails or is closed.
+  ConditionVariable cond_;
+
+  // The index of the next token to scan.
+  int next_token_;  // protected by lock_
+
+  // The number of scanning threads still running.
+  int running_threads_;  // protected by lock_
+
+  // The batches which were scanned but not handed out yet, with their sizes.
+  std::deque<std::pair<std::unique_ptr<KuduScanBatch>, int64_t>> batches_;  // protected by lock_
+  int64_t buffered_bytes_;  // protected by lock_
+
+  // The scanners of the tokens which were scanned. They're kept until the
+  // parallel scanner is closed, since their batches point to their
+  // projections.
+  std::vector<std::unique_ptr<KuduScanner>> scanners_;  // protected by lock_
+
+  // The first error any of the scans failed with.
+  Status status_;  // protected by lock_
+
+  bool closing_;  // protected by lock_
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+} // namespace client
+} // namespace kudu
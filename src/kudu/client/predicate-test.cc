@@ -604,6 +604,56 @@ TEST_F(PredicateTest, TestInt8Predicates) {
   CheckIntPredicates<int8_t>(table);
 }
 
+TEST_F(PredicateTest, TestInBloomFilterPredicates) {
+  shared_ptr<KuduTable> table = CreateAndOpenTable(KuduColumnSchema::INT32);
+  shared_ptr<KuduSession> session = CreateSession();
+
+  for (int i = 0; i < 1000; i++) {
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt64("key", i));
+    ASSERT_OK(insert->mutable_row()->SetInt32("value", i));
+    ASSERT_OK(session->Apply(insert.release()));
+  }
+  ASSERT_OK(session->Flush());
+
+  { // value IN BLOOM FILTER (0, 20, ..., 1980)
+    // Half of the values are beyond the rows, and the bounds of the filter
+    // do not rule out any of the others.
+    unique_ptr<KuduBloomFilter> filter(new KuduBloomFilter(KuduColumnSchema::INT32, 100, 0.001));
+    for (int i = 0; i < 2000; i += 20) {
+      ASSERT_OK(filter->AddValue(*unique_ptr<KuduValue>(KuduValue::FromInt(i))));
+    }
+    int count = CountRows(table, { table->NewInBloomFilterPredicate("value", filter.release()) });
+    ASSERT_GE(count, 50);
+    ASSERT_LT(count, 100);
+  }
+
+  { // key IN BLOOM FILTER (500, ..., 509)
+    // The bounds of the filter restrict a predicate on the key to exactly
+    // the values added.
+    unique_ptr<KuduBloomFilter> filter(new KuduBloomFilter(KuduColumnSchema::INT64, 10, 0.01));
+    for (int i = 500; i < 510; i++) {
+      ASSERT_OK(filter->AddValue(*unique_ptr<KuduValue>(KuduValue::FromInt(i))));
+    }
+    ASSERT_EQ(10, CountRows(table, { table->NewInBloomFilterPredicate("key", filter.release()) }));
+  }
+
+  { // An empty filter matches no rows.
+    KuduBloomFilter* filter = new KuduBloomFilter(KuduColumnSchema::INT32, 10, 0.01);
+    ASSERT_EQ(0, CountRows(table, { table->NewInBloomFilterPredicate("value", filter) }));
+  }
+
+  { // The type of the filter must match the column.
+    unique_ptr<KuduBloomFilter> filter(new KuduBloomFilter(KuduColumnSchema::STRING, 10, 0.01));
+    ASSERT_OK(filter->AddValue(*unique_ptr<KuduValue>(KuduValue::CopyString("a"))));
+    ASSERT_TRUE(filter->AddValue(*unique_ptr<KuduValue>(KuduValue::FromInt(1))).IsInvalidArgument());
+    KuduScanner scanner(table.get());
+    Status s = scanner.AddConjunctPredicate(
+        table->NewInBloomFilterPredicate("value", filter.release()));
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  }
+}
+
 TEST_F(PredicateTest, TestInt16Predicates) {
   shared_ptr<KuduTable> table = CreateAndOpenTable(KuduColumnSchema::INT16);
   shared_ptr<KuduSession> session = CreateSession();
@@ -18,14 +18,18 @@
 #define KUDU_CLIENT_RESOURCE_METRICS_INTERNAL_H
 
 #include <map>
+#include <memory>
 #include <mutex>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "kudu/util/locks.h"
 
 namespace kudu {
 
+class HdrHistogram;
+
 namespace client {
 
 class ResourceMetrics::Data {
@@ -42,9 +46,28 @@ class ResourceMetrics::Data {
   // Return metric's current value.
   int64_t GetMetric(const std::string& name) const;
 
+  // Record a sample in the given latency histogram, creating it if needed.
+  void RecordLatency(const std::string& name, int64_t latency_us);
+
+  // Return the names of the latency histograms.
+  std::vector<std::string> GetLatencyHistogramNames() const;
+
+  // Return the number of samples in the given latency histogram.
+  int64_t GetLatencyCount(const std::string& name) const;
+
+  // Return the given percentile of the given latency histogram.
+  int64_t GetLatencyPercentile(const std::string& name, double percentile) const;
+
  private:
+  // Return the given latency histogram, or NULL if it doesn't exist.
+  const HdrHistogram* FindHistogram(const std::string& name) const;
+
   mutable simple_spinlock lock_;
   std::map<std::string, int64_t> counters_;
+
+  // The histograms are never removed, so the pointers to them remain valid
+  // after lock_ is released. Samples are recorded without holding lock_.
+  std::map<std::string, std::unique_ptr<HdrHistogram>> histograms_;
 };
 
 } // namespace client
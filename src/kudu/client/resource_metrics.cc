@@ -18,17 +18,30 @@
 #include "kudu/client/resource_metrics.h"
 #include "kudu/client/resource_metrics-internal.h"
 
+#include <algorithm>
 #include <map>
 #include <mutex>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/map-util.h"
+#include "kudu/util/hdr_histogram.h"
 
 namespace kudu {
 
 namespace client {
 
+namespace {
+
+// The latencies recorded in the histograms are capped to this many
+// microseconds (one minute), and kept with two significant digits, which
+// keeps each histogram to a few tens of kilobytes.
+const int64_t kMaxLatencyUs = 60LL * 1000 * 1000;
+const int kLatencySignificantDigits = 2;
+
+} // anonymous namespace
+
 ResourceMetrics::ResourceMetrics() :
   data_(new Data) {}
 
@@ -48,6 +61,22 @@ int64_t ResourceMetrics::GetMetric(const std::string& name) const {
   return data_->GetMetric(name);
 }
 
+void ResourceMetrics::RecordLatency(const std::string& name, int64_t latency_us) {
+  data_->RecordLatency(name, latency_us);
+}
+
+std::vector<std::string> ResourceMetrics::GetLatencyHistogramNames() const {
+  return data_->GetLatencyHistogramNames();
+}
+
+int64_t ResourceMetrics::GetLatencyCount(const std::string& name) const {
+  return data_->GetLatencyCount(name);
+}
+
+int64_t ResourceMetrics::GetLatencyPercentile(const std::string& name, double percentile) const {
+  return data_->GetLatencyPercentile(name, percentile);
+}
+
 ResourceMetrics::Data::Data() {}
 
 ResourceMetrics::Data::~Data() {}
@@ -67,5 +96,45 @@ int64_t ResourceMetrics::Data::GetMetric(const std::string& name) const {
   return FindWithDefault(counters_, name, 0);
 }
 
+void ResourceMetrics::Data::RecordLatency(const std::string& name, int64_t latency_us) {
+  HdrHistogram* histogram;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    std::unique_ptr<HdrHistogram>& h = histograms_[name];
+    if (!h) {
+      h.reset(new HdrHistogram(kMaxLatencyUs, kLatencySignificantDigits));
+    }
+    histogram = h.get();
+  }
+  histogram->Increment(std::max<int64_t>(0, std::min(latency_us, kMaxLatencyUs)));
+}
+
+std::vector<std::string> ResourceMetrics::Data::GetLatencyHistogramNames() const {
+  std::vector<std::string> names;
+  std::lock_guard<simple_spinlock> l(lock_);
+  AppendKeysFromMap(histograms_, &names);
+  return names;
+}
+
+int64_t ResourceMetrics::Data::GetLatencyCount(const std::string& name) const {
+  const HdrHistogram* histogram = FindHistogram(name);
+  return histogram ? histogram->TotalCount() : 0;
+}
+
+int64_t ResourceMetrics::Data::GetLatencyPercentile(const std::string& name,
+                                                    double percentile) const {
+  const HdrHistogram* histogram = FindHistogram(name);
+  if (!histogram || histogram->TotalCount() == 0) {
+    return 0;
+  }
+  return histogram->ValueAtPercentile(percentile);
+}
+
+const HdrHistogram* ResourceMetrics::Data::FindHistogram(const std::string& name) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  const std::unique_ptr<HdrHistogram>* h = FindOrNull(histograms_, name);
+  return h ? h->get() : nullptr;
+}
+
 } // namespace client
 } // namespace kudu
@@ -20,6 +20,7 @@
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
 #include "kudu/util/kudu_export.h"
 
@@ -53,6 +54,34 @@ class KUDU_EXPORT ResourceMetrics {
   /// @return The metric's current count.
   int64_t GetMetric(const std::string& name) const;
 
+  /// Record a sample in the given latency histogram.
+  ///
+  /// @param [in] name
+  ///   The name of the latency histogram.
+  /// @param [in] latency_us
+  ///   The latency to record, in microseconds.
+  void RecordLatency(const std::string& name, int64_t latency_us);
+
+  /// @return The names of all latency histograms with recorded samples.
+  std::vector<std::string> GetLatencyHistogramNames() const;
+
+  /// Get the number of samples in the specified latency histogram.
+  ///
+  /// @param [in] name
+  ///   Name of the latency histogram in question.
+  /// @return The number of samples recorded in the histogram.
+  int64_t GetLatencyCount(const std::string& name) const;
+
+  /// Get a percentile of the specified latency histogram.
+  ///
+  /// @param [in] name
+  ///   Name of the latency histogram in question.
+  /// @param [in] percentile
+  ///   The percentile, between 0 and 100 (e.g. 99.9).
+  /// @return The latency at the given percentile in microseconds,
+  ///   or 0 if no samples were recorded in the histogram.
+  int64_t GetLatencyPercentile(const std::string& name, double percentile) const;
+
  private:
   class KUDU_NO_EXPORT Data;
   Data* data_;
@@ -54,6 +54,33 @@ const KuduSchema* KuduScanBatch::projection_schema() const {
   return data_->client_projection_;
 }
 
+Status KuduScanBatch::GetFixedLengthColumn(int idx, Slice* data) const {
+  RETURN_NOT_OK(data_->PrepareColumnarAccess(idx));
+  const ColumnSchema& col = data_->projection_->column(idx);
+  if (PREDICT_FALSE(col.type_info()->physical_type() == BINARY)) {
+    return Status::InvalidArgument("column is of a variable-length type", col.name());
+  }
+  *data = data_->columnar_columns_[idx].data;
+  return Status::OK();
+}
+
+Status KuduScanBatch::GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const {
+  RETURN_NOT_OK(data_->PrepareColumnarAccess(idx));
+  const ColumnSchema& col = data_->projection_->column(idx);
+  if (PREDICT_FALSE(col.type_info()->physical_type() != BINARY)) {
+    return Status::InvalidArgument("column is of a fixed-length type", col.name());
+  }
+  *offsets = data_->columnar_columns_[idx].data;
+  *data = data_->columnar_columns_[idx].varlen_data;
+  return Status::OK();
+}
+
+Status KuduScanBatch::GetNonNullBitmapForColumn(int idx, Slice* bitmap) const {
+  RETURN_NOT_OK(data_->PrepareColumnarAccess(idx));
+  *bitmap = data_->columnar_columns_[idx].non_null_bitmap;
+  return Status::OK();
+}
+
 ////////////////////////////////////////////////////////////
 // KuduScanBatch::RowPtr
 ////////////////////////////////////////////////////////////
@@ -187,6 +214,32 @@ Status KuduScanBatch::RowPtr::GetBinary(int col_idx, Slice* val) const {
   return Get<TypeTraits<BINARY> >(col_idx, val);
 }
 
+Status KuduScanBatch::RowPtr::GetUnscaledDecimal(const Slice& col_name, int128_t* val) const {
+  int col_idx;
+  RETURN_NOT_OK(FindColumn(*schema_, col_name, &col_idx));
+  return GetUnscaledDecimal(col_idx, val);
+}
+
+Status KuduScanBatch::RowPtr::GetUnscaledDecimal(int col_idx, int128_t* val) const {
+  switch (schema_->column(col_idx).type_info()->type()) {
+    case DECIMAL32: {
+      int32_t i32;
+      RETURN_NOT_OK(Get<TypeTraits<DECIMAL32> >(col_idx, &i32));
+      *val = i32;
+      return Status::OK();
+    }
+    case DECIMAL64: {
+      int64_t i64;
+      RETURN_NOT_OK(Get<TypeTraits<DECIMAL64> >(col_idx, &i64));
+      *val = i64;
+      return Status::OK();
+    }
+    default:
+      // Fails on the type check for the non-DECIMAL columns.
+      return Get<TypeTraits<DECIMAL128> >(col_idx, val);
+  }
+}
+
 template<typename T>
 Status KuduScanBatch::RowPtr::Get(const Slice& col_name, typename T::cpp_type* val) const {
   int col_idx;
@@ -284,6 +337,15 @@ Status KuduScanBatch::RowPtr::Get<TypeTraits<STRING> >(int col_idx, Slice* val)
 template
 Status KuduScanBatch::RowPtr::Get<TypeTraits<BINARY> >(int col_idx, Slice* val) const;
 
+template
+Status KuduScanBatch::RowPtr::Get<TypeTraits<DECIMAL32> >(int col_idx, int32_t* val) const;
+
+template
+Status KuduScanBatch::RowPtr::Get<TypeTraits<DECIMAL64> >(int col_idx, int64_t* val) const;
+
+template
+Status KuduScanBatch::RowPtr::Get<TypeTraits<DECIMAL128> >(int col_idx, int128_t* val) const;
+
 string KuduScanBatch::RowPtr::ToString() const {
   string ret;
   ret.append("(");
@@ -26,6 +26,7 @@
 #include "kudu/client/stubs.h"
 #endif
 
+#include "kudu/util/int128.h"
 #include "kudu/util/kudu_export.h"
 #include "kudu/util/slice.h"
 
@@ -72,6 +73,20 @@ class KuduSchema;
 ///
 /// @note In the above example, NumRows() is only called once at the
 ///   beginning of the loop to avoid extra calls to the non-inlined method.
+///
+/// The batches of a scanner using the columnar layout (see
+/// KuduScanner::SetColumnarLayout()) can't be read row by row. Instead,
+/// the cells of each column are read in bulk. Batches in the default
+/// row-wise layout can be read in bulk too: the first call to one of the
+/// column accessors transposes all of the batch's rows into columns.
+/// @code
+///   Slice data;
+///   RETURN_NOT_OK(batch.GetFixedLengthColumn(0, &data));
+///   const int32_t* values = reinterpret_cast<const int32_t*>(data.data());
+///   for (int i = 0; i < batch.NumRows(); i++) {
+///     ... values[i]
+///   }
+/// @endcode
 class KUDU_EXPORT KuduScanBatch {
  public:
   /// @brief A single row result from a scan.
@@ -99,6 +114,8 @@ class KUDU_EXPORT KuduScanBatch {
 
   /// Get a row at the specified index.
   ///
+  /// This may not be called on a batch in the columnar layout.
+  ///
   /// @param [in] idx
   ///   The index of the row to return.
   /// @return A reference to one of the rows in this batch.
@@ -116,8 +133,50 @@ class KUDU_EXPORT KuduScanBatch {
   ///   to have this schema.
   const KuduSchema* projection_schema() const;
 
+  /// Get the cells of a fixed-length column of the batch.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] data
+  ///   The NumRows() cells of the column, back to back in their in-memory
+  ///   format (e.g. an @c int32_t per row for an INT32 column). The contents
+  ///   of NULL cells are undefined. The data is only valid for as long as this
+  ///   KuduScanBatch object is valid, and is not necessarily aligned.
+  /// @return Operation result status. Returns Status::InvalidArgument if
+  ///   the column is of a variable-length type.
+  Status GetFixedLengthColumn(int idx, Slice* data) const;
+
+  /// Get the cells of a variable-length (STRING or BINARY) column of the
+  /// batch.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] offsets
+  ///   NumRows() + 1 @c uint32_t offsets into @c data: the cell of row @c i
+  ///   spans the bytes from @c offsets[i] to @c offsets[i+1]. NULL cells are
+  ///   empty. This is empty if the batch holds no rows.
+  /// @param [out] data
+  ///   The cell data. Both slices are only valid for as long as this
+  ///   KuduScanBatch object is valid, and are not necessarily aligned.
+  /// @return Operation result status. Returns Status::InvalidArgument if
+  ///   the column is of a fixed-length type.
+  Status GetVariableLengthColumn(int idx, Slice* offsets, Slice* data) const;
+
+  /// Get the non-null bitmap of a column of the batch.
+  ///
+  /// @param [in] idx
+  ///   The index of the column in the projection.
+  /// @param [out] bitmap
+  ///   A bitmap with bit @c i set if the cell of row @c i isn't NULL, where
+  ///   bit @c i is bit <tt>i % 8</tt> of byte <tt>i / 8</tt>. This is empty
+  ///   if the column isn't nullable. The bitmap is only valid for as long as
+  ///   this KuduScanBatch object is valid.
+  /// @return Operation result status.
+  Status GetNonNullBitmapForColumn(int idx, Slice* bitmap) const;
+
  private:
   class KUDU_NO_EXPORT Data;
+  friend class KuduParallelScanner;
   friend class KuduScanner;
   friend class tools::ReplicaDumper;
 
@@ -197,6 +256,27 @@ class KUDU_EXPORT KuduScanBatch::RowPtr {
   Status GetDouble(int col_idx, double* val) const WARN_UNUSED_RESULT;
   ///@}
 
+  /// @name Getters for DECIMAL columns.
+  ///
+  /// Get the unscaled value of a DECIMAL column, e.g. 12345 for 123.45
+  /// in a column with a scale of 2, whatever the storage size of the column.
+  ///
+  /// @param [in] col_name
+  ///   Name of the column.
+  /// @param [in] col_idx
+  ///   The index of the column.
+  /// @param [out] val
+  ///   Pointer to the placeholder to put the resulting value.
+  /// @return Operation result status. Return a bad Status if at least one
+  ///   of the following is @c true:
+  ///     @li The column isn't a DECIMAL column.
+  ///     @li The value is @c NULL.
+  ///
+  ///@{
+  Status GetUnscaledDecimal(const Slice& col_name, int128_t* val) const WARN_UNUSED_RESULT;
+  Status GetUnscaledDecimal(int col_idx, int128_t* val) const WARN_UNUSED_RESULT;
+  ///@}
+
   /// @name Getters for string/binary column by column name.
   ///
   /// Get the string/binary value for a column by its name.
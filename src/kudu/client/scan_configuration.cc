@@ -44,6 +44,11 @@ ScanConfiguration::ScanConfiguration(KuduTable* table)
       selection_(KuduClient::CLOSEST_REPLICA),
       read_mode_(KuduScanner::READ_LATEST),
       is_fault_tolerant_(false),
+      columnar_layout_(false),
+      prefetching_(false),
+      read_ahead_batches_(0),
+      profiling_(false),
+      sidecar_compression_(NO_COMPRESSION),
       snapshot_timestamp_(kNoTimestamp),
       timeout_(MonoDelta::FromMilliseconds(KuduScanner::kScanTimeoutMillis)),
       arena_(1024, 1024 * 1024) {
@@ -140,6 +145,47 @@ Status ScanConfiguration::SetCacheBlocks(bool cache_blocks) {
   return Status::OK();
 }
 
+Status ScanConfiguration::SetCacheBlocksLowPriority(bool low_priority) {
+  spec_.set_cache_blocks_low_priority(low_priority);
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetColumnarLayout(bool columnar_layout) {
+  columnar_layout_ = columnar_layout;
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetPrefetching(bool prefetching) {
+  prefetching_ = prefetching;
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetReadAheadBatches(int num_batches) {
+  if (num_batches < 0) {
+    return Status::InvalidArgument("number of batches to read ahead must not be negative");
+  }
+  read_ahead_batches_ = num_batches;
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetKeepAlivePeriodMillis(int millis) {
+  if (millis <= 0) {
+    return Status::InvalidArgument("keep-alive period must be positive");
+  }
+  keep_alive_period_ = MonoDelta::FromMilliseconds(millis);
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetProfiling(bool profiling) {
+  profiling_ = profiling;
+  return Status::OK();
+}
+
+Status ScanConfiguration::SetSidecarCompression(CompressionType compression) {
+  sidecar_compression_ = compression;
+  return Status::OK();
+}
+
 Status ScanConfiguration::SetBatchSizeBytes(uint32_t batch_size) {
   has_batch_size_bytes_ = true;
   batch_size_bytes_ = batch_size;
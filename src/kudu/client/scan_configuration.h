@@ -25,6 +25,7 @@
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/util/auto_release_pool.h"
+#include "kudu/util/compression/compression.pb.h"
 #include "kudu/util/memory/arena.h"
 
 namespace kudu {
@@ -61,6 +62,20 @@ class ScanConfiguration {
 
   Status SetCacheBlocks(bool cache_blocks);
 
+  Status SetCacheBlocksLowPriority(bool low_priority);
+
+  Status SetColumnarLayout(bool columnar_layout);
+
+  Status SetPrefetching(bool prefetching);
+
+  Status SetReadAheadBatches(int num_batches);
+
+  Status SetKeepAlivePeriodMillis(int millis);
+
+  Status SetProfiling(bool profiling);
+
+  Status SetSidecarCompression(CompressionType compression);
+
   Status SetBatchSizeBytes(uint32_t batch_size);
 
   Status SetSelection(KuduClient::ReplicaSelection selection) WARN_UNUSED_RESULT;
@@ -120,6 +135,31 @@ class ScanConfiguration {
     return is_fault_tolerant_;
   }
 
+  bool columnar_layout() const {
+    return columnar_layout_;
+  }
+
+  bool prefetching() const {
+    return prefetching_;
+  }
+
+  int read_ahead_batches() const {
+    return read_ahead_batches_;
+  }
+
+  // Uninitialized if the scanner isn't kept alive automatically.
+  const MonoDelta& keep_alive_period() const {
+    return keep_alive_period_;
+  }
+
+  bool profiling() const {
+    return profiling_;
+  }
+
+  CompressionType sidecar_compression() const {
+    return sidecar_compression_;
+  }
+
   bool has_snapshot_timestamp() const {
     return snapshot_timestamp_ != kNoTimestamp;
   }
@@ -163,6 +203,18 @@ class ScanConfiguration {
 
   bool is_fault_tolerant_;
 
+  bool columnar_layout_;
+
+  bool prefetching_;
+
+  int read_ahead_batches_;
+
+  MonoDelta keep_alive_period_;
+
+  bool profiling_;
+
+  CompressionType sidecar_compression_;
+
   uint64_t snapshot_timestamp_;
 
   MonoDelta timeout_;
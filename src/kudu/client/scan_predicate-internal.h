@@ -17,6 +17,8 @@
 #ifndef KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H
 #define KUDU_CLIENT_SCAN_PREDICATE_INTERNAL_H
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "kudu/client/scan_predicate.h"
@@ -24,6 +26,7 @@
 #include "kudu/client/value.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/status.h"
 
@@ -116,6 +119,55 @@ class InListPredicateData : public KuduPredicate::Data {
   std::vector<KuduValue*> vals_;
 };
 
+class KuduBloomFilter::Data {
+ public:
+  Data(DataType type, ColumnTypeAttributes type_attributes,
+       size_t expected_count, double fp_rate);
+
+  // Adds the cell 'value' to the filter and widens the bounds to include it.
+  void AddCell(const void* value);
+
+  // A column of the filter's type, which gives the encoding of its cells.
+  const ColumnSchema col_;
+
+  BloomFilterBuilder builder_;
+
+  // The smallest and largest cells added so far, valid once 'builder_' holds
+  // any keys. For strings, the cells are slices of 'min_data_' and 'max_data_'.
+  uint8_t min_[kLargestTypeSize];
+  uint8_t max_[kLargestTypeSize];
+  std::string min_data_;
+  std::string max_data_;
+
+ private:
+  // Copies 'value' into the cell 'bound', using 'data' to hold string data.
+  void CopyBound(const void* value, uint8_t* bound, std::string* data);
+
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+// A predicate for selecting the values which may be in a Bloom filter.
+class InBloomFilterPredicateData : public KuduPredicate::Data {
+ public:
+  InBloomFilterPredicateData(ColumnSchema col, std::shared_ptr<KuduBloomFilter> bloom_filter)
+      : col_(std::move(col)),
+        bloom_filter_(std::move(bloom_filter)) {
+  }
+
+  Status AddToScanSpec(ScanSpec* spec, Arena* arena) override;
+
+  InBloomFilterPredicateData* Clone() const override {
+    // The filter may no longer be modified, so clones share it.
+    return new InBloomFilterPredicateData(col_, bloom_filter_);
+  }
+
+ private:
+  friend class KuduScanner;
+
+  ColumnSchema col_;
+  std::shared_ptr<KuduBloomFilter> bloom_filter_;
+};
+
 // A predicate for selecting non-null values.
 class IsNotNullPredicateData : public KuduPredicate::Data {
  public:
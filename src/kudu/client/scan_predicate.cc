@@ -17,18 +17,22 @@
 
 #include "kudu/client/scan_predicate.h"
 
+#include <algorithm>
 #include <boost/optional.hpp>
 #include <utility>
 #include <vector>
 
 #include "kudu/client/scan_predicate-internal.h"
+#include "kudu/client/schema-internal.h"
 #include "kudu/client/value-internal.h"
 #include "kudu/client/value.h"
+#include "kudu/common/key_util.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 
 using std::move;
+using std::string;
 using std::vector;
 using boost::optional;
 
@@ -70,7 +74,8 @@ ComparisonPredicateData::~ComparisonPredicateData() {
 Status ComparisonPredicateData::AddToScanSpec(ScanSpec* spec, Arena* arena) {
   void* val_void;
   RETURN_NOT_OK(val_->data_->CheckTypeAndGetPointer(col_.name(),
-                                                    col_.type_info()->physical_type(),
+                                                    col_.type_info()->type(),
+                                                    col_.type_attributes(),
                                                     &val_void));
   switch (op_) {
     case KuduPredicate::LESS_EQUAL: {
@@ -129,7 +134,8 @@ Status InListPredicateData::AddToScanSpec(ScanSpec* spec, Arena* /*arena*/) {
     // passed to the ColumnPredicate::InList constructor. The constructor for
     // ColumnPredicate::InList will assume ownership of the pointers via a swap.
     RETURN_NOT_OK(value->data_->CheckTypeAndGetPointer(col_.name(),
-                                                       col_.type_info()->physical_type(),
+                                                       col_.type_info()->type(),
+                                                       col_.type_attributes(),
                                                        &val_void));
     vals_list.push_back(val_void);
   }
@@ -139,5 +145,96 @@ Status InListPredicateData::AddToScanSpec(ScanSpec* spec, Arena* /*arena*/) {
   return Status::OK();
 }
 
+namespace {
+BloomFilterSizing SizeBloomFilter(size_t expected_count, double fp_rate) {
+  fp_rate = std::min(std::max(fp_rate, 1e-9), 0.5);
+  BloomFilterSizing sizing = BloomFilterSizing::ByCountAndFPRate(
+      std::max<size_t>(expected_count, 1), fp_rate);
+  if (sizing.n_bytes() < BloomFilter::kBucketBytes) {
+    // A blocked filter holds at least one bucket.
+    sizing = BloomFilterSizing::BySizeAndFPRate(BloomFilter::kBucketBytes, fp_rate);
+  }
+  return sizing.WithLayout(BloomFilterLayout::kBlocked);
+}
+} // anonymous namespace
+
+KuduBloomFilter::Data::Data(DataType type, ColumnTypeAttributes type_attributes,
+                            size_t expected_count, double fp_rate)
+    : col_("bloom filter", type, false, nullptr, nullptr, ColumnStorageAttributes(),
+           type_attributes),
+      builder_(SizeBloomFilter(expected_count, fp_rate)) {
+}
+
+void KuduBloomFilter::Data::AddCell(const void* value) {
+  const TypeInfo* type_info = col_.type_info();
+  if (builder_.count() == 0) {
+    CopyBound(value, min_, &min_data_);
+    CopyBound(value, max_, &max_data_);
+  } else if (type_info->Compare(value, min_) < 0) {
+    CopyBound(value, min_, &min_data_);
+  } else if (type_info->Compare(value, max_) > 0) {
+    CopyBound(value, max_, &max_data_);
+  }
+  builder_.AddKey(BloomKeyProbe(ColumnPredicate::BloomFilterKey(col_, value)));
+}
+
+void KuduBloomFilter::Data::CopyBound(const void* value, uint8_t* bound, string* data) {
+  if (col_.type_info()->physical_type() == BINARY) {
+    const Slice* s = static_cast<const Slice*>(value);
+    data->assign(reinterpret_cast<const char*>(s->data()), s->size());
+    *reinterpret_cast<Slice*>(bound) = Slice(*data);
+  } else {
+    memcpy(bound, value, col_.type_info()->size());
+  }
+}
+
+KuduBloomFilter::KuduBloomFilter(KuduColumnSchema::DataType type,
+                                 size_t expected_count, double fp_rate,
+                                 KuduColumnTypeAttributes type_attributes)
+    : data_(new Data(ToInternalDataType(type, type_attributes),
+                     ColumnTypeAttributes(type_attributes.precision(),
+                                          type_attributes.scale()),
+                     expected_count, fp_rate)) {
+}
+
+KuduBloomFilter::~KuduBloomFilter() {
+  delete data_;
+}
+
+Status KuduBloomFilter::AddValue(const KuduValue& value) {
+  void* val_void;
+  RETURN_NOT_OK(value.data_->CheckTypeAndGetPointer(data_->col_.name(),
+                                                    data_->col_.type_info()->type(),
+                                                    data_->col_.type_attributes(),
+                                                    &val_void));
+  data_->AddCell(val_void);
+  return Status::OK();
+}
+
+Status InBloomFilterPredicateData::AddToScanSpec(ScanSpec* spec, Arena* arena) {
+  const KuduBloomFilter::Data* filter = bloom_filter_->data_;
+  if (filter->col_.type_info()->physical_type() != col_.type_info()->physical_type()) {
+    return Status::InvalidArgument(
+        Substitute("Bloom filter of type $0 does not match column $1 of type $2",
+                   filter->col_.type_info()->name(), col_.name(), col_.type_info()->name()));
+  }
+  if (filter->builder_.count() == 0) {
+    spec->AddPredicate(ColumnPredicate::None(col_));
+    return Status::OK();
+  }
+
+  // The largest value added is an inclusive bound, so transform it to an
+  // exclusive one by incrementing a copy of it.
+  size_t size = col_.type_info()->size();
+  void* upper = CHECK_NOTNULL(arena->AllocateBytes(size));
+  memcpy(upper, filter->max_, size);
+  if (!key_util::IncrementCell(col_, upper, arena)) {
+    upper = nullptr;
+  }
+  vector<Slice> bloom_filters = { filter->builder_.slice() };
+  spec->AddPredicate(ColumnPredicate::InBloomFilter(col_, &bloom_filters, filter->min_, upper));
+  return Status::OK();
+}
+
 } // namespace client
 } // namespace kudu
@@ -26,6 +26,7 @@
 
 #include "kudu/client/schema.h"
 #include "kudu/util/kudu_export.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
 namespace client {
@@ -57,6 +58,7 @@ class KUDU_EXPORT KuduPredicate {
  private:
   friend class ComparisonPredicateData;
   friend class ErrorPredicateData;
+  friend class InBloomFilterPredicateData;
   friend class InListPredicateData;
   friend class IsNotNullPredicateData;
   friend class IsNullPredicateData;
@@ -69,6 +71,52 @@ class KUDU_EXPORT KuduPredicate {
   DISALLOW_COPY_AND_ASSIGN(KuduPredicate);
 };
 
+/// @brief A Bloom filter over the values of a column.
+///
+/// Call KuduTable::NewInBloomFilterPredicate() to create a predicate
+/// which matches the rows whose column value may have been added to the
+/// filter, for example to push the keys of the build side of a semi-join
+/// down into a scan. Since Bloom filters admit false positives, such a scan
+/// may also return some rows whose value was never added.
+class KUDU_EXPORT KuduBloomFilter {
+ public:
+  /// Create an empty Bloom filter.
+  ///
+  /// @param [in] type
+  ///   Type of the column to which the filter is to be applied.
+  /// @param [in] expected_count
+  ///   The expected number of distinct values to be added.
+  /// @param [in] fp_rate
+  ///   The target false positive rate once @c expected_count values have
+  ///   been added. Values outside of the range (0, 0.5] are clamped.
+  /// @param [in] type_attributes
+  ///   Type attributes of the column, required for a DECIMAL column.
+  KuduBloomFilter(KuduColumnSchema::DataType type,
+                  size_t expected_count, double fp_rate,
+                  KuduColumnTypeAttributes type_attributes = KuduColumnTypeAttributes());
+
+  ~KuduBloomFilter();
+
+  /// Add a value to the filter.
+  ///
+  /// @param [in] value
+  ///   The value to add. Its type must correspond to the type of the filter
+  ///   as described for KuduTable::NewComparisonPredicate().
+  /// @return Operation result status. An error is returned if the value
+  ///   cannot be converted to the type of the filter.
+  Status AddValue(const KuduValue& value);
+
+ private:
+  friend class InBloomFilterPredicateData;
+
+  class KUDU_NO_EXPORT Data;
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduBloomFilter);
+};
+
 } // namespace client
 } // namespace kudu
 #endif // KUDU_CLIENT_SCAN_PREDICATE_H
@@ -32,9 +32,15 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 
+using kudu::rpc::RpcController;
+using kudu::tserver::SplitKeyRangeRequestPB;
+using kudu::tserver::SplitKeyRangeResponsePB;
+using std::set;
 using std::string;
 using std::unique_ptr;
 using std::vector;
@@ -158,6 +164,7 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
   }
 
   RETURN_NOT_OK(scan_builder->SetCacheBlocks(message.cache_blocks()));
+  RETURN_NOT_OK(scan_builder->SetCacheBlocksLowPriority(message.cache_blocks_low_priority()));
 
   if (message.has_propagated_timestamp()) {
     client->data_->UpdateLatestObservedTimestamp(message.propagated_timestamp());
@@ -168,7 +175,40 @@ Status KuduScanToken::Data::PBIntoScanner(KuduClient* client,
 }
 
 KuduScanTokenBuilder::Data::Data(KuduTable* table)
-    : configuration_(table) {
+    : configuration_(table),
+      num_ranges_per_tablet_(1) {
+}
+
+Status KuduScanTokenBuilder::Data::SplitKeyRange(
+    const scoped_refptr<internal::RemoteTablet>& tablet,
+    const ScanTokenPB& pb,
+    const MonoTime& deadline,
+    vector<string>* split_keys) {
+  KuduClient* client = configuration_.table_->client();
+  internal::RemoteTabletServer* ts;
+  vector<internal::RemoteTabletServer*> candidates;
+  RETURN_NOT_OK(client->data_->GetTabletServer(client, tablet, configuration_.selection(),
+                                               set<string>(), &candidates, &ts));
+
+  SplitKeyRangeRequestPB req;
+  req.set_tablet_id(tablet->tablet_id());
+  if (pb.has_lower_bound_primary_key()) {
+    req.set_start_primary_key(pb.lower_bound_primary_key());
+  }
+  if (pb.has_upper_bound_primary_key()) {
+    req.set_stop_primary_key(pb.upper_bound_primary_key());
+  }
+  req.set_num_ranges(num_ranges_per_tablet_);
+
+  SplitKeyRangeResponsePB resp;
+  RpcController rpc;
+  rpc.set_deadline(deadline);
+  RETURN_NOT_OK(ts->proxy()->SplitKeyRange(req, &resp, &rpc));
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status());
+  }
+  split_keys->assign(resp.split_keys().begin(), resp.split_keys().end());
+  return Status::OK();
 }
 
 Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
@@ -225,6 +265,7 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
   }
 
   pb.set_cache_blocks(configuration_.spec().cache_blocks());
+  pb.set_cache_blocks_low_priority(configuration_.spec().cache_blocks_low_priority());
   pb.set_fault_tolerant(configuration_.is_fault_tolerant());
   pb.set_propagated_timestamp(client->GetLatestObservedTimestamp());
 
@@ -232,6 +273,16 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
 
   PartitionPruner pruner;
   pruner.Init(*table->schema().schema_, table->partition_schema(), configuration_.spec());
+  if (pruner.HasMorePartitionKeyRanges()) {
+    // Fetch the locations in bulk rather than with a master round trip every
+    // few tablets below. On failure the lookups below fetch them anyway.
+    Status s = client->data_->meta_cache_->PrefetchTabletLocations(
+        table, pruner.NextPartitionKey(), "", deadline);
+    if (PREDICT_FALSE(!s.ok())) {
+      LOG(WARNING) << "Unable to prefetch the tablet locations of table " << table->name()
+                   << ": " << s.ToString();
+    }
+  }
   while (pruner.HasMorePartitionKeyRanges()) {
     scoped_refptr<internal::RemoteTablet> tablet;
     Synchronizer sync;
@@ -259,49 +310,72 @@ Status KuduScanTokenBuilder::Data::Build(vector<KuduScanToken*>* tokens) {
       continue;
     }
 
+    // Split the primary key range of the tablet, if requested. Splitting is
+    // only an optimization, so the tablet falls back to a single token if the
+    // split keys can't be fetched, e.g. from a tablet server which predates
+    // the SplitKeyRange RPC.
+    vector<string> split_keys;
+    if (num_ranges_per_tablet_ > 1) {
+      Status s = SplitKeyRange(tablet, pb, deadline, &split_keys);
+      if (!s.ok()) {
+        LOG(WARNING) << "Unable to split the key range of tablet " << tablet->tablet_id()
+                     << ", building a single scan token for it: " << s.ToString();
+        split_keys.clear();
+      }
+    }
+
     vector<internal::RemoteReplica> replicas;
     tablet->GetRemoteReplicas(&replicas);
 
-    vector<const KuduReplica*> client_replicas;
-    ElementDeleter deleter(&client_replicas);
-
-    // Convert the replicas from their internal format to something appropriate
-    // for clients.
-    for (const auto& r : replicas) {
-      vector<HostPort> host_ports;
-      r.ts->GetHostPorts(&host_ports);
-      if (host_ports.empty()) {
-        return Status::IllegalState(Substitute(
-            "No host found for tablet server $0", r.ts->ToString()));
+    for (size_t i = 0; i <= split_keys.size(); i++) {
+      vector<const KuduReplica*> client_replicas;
+      ElementDeleter deleter(&client_replicas);
+
+      // Convert the replicas from their internal format to something appropriate
+      // for clients.
+      for (const auto& r : replicas) {
+        vector<HostPort> host_ports;
+        r.ts->GetHostPorts(&host_ports);
+        if (host_ports.empty()) {
+          return Status::IllegalState(Substitute(
+              "No host found for tablet server $0", r.ts->ToString()));
+        }
+        unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
+        client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
+                                                      host_ports[0]);
+        bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
+        unique_ptr<KuduReplica> client_replica(new KuduReplica);
+        client_replica->data_ = new KuduReplica::Data(is_leader,
+                                                      std::move(client_ts));
+        client_replicas.push_back(client_replica.release());
       }
-      unique_ptr<KuduTabletServer> client_ts(new KuduTabletServer);
-      client_ts->data_ = new KuduTabletServer::Data(r.ts->permanent_uuid(),
-                                                    host_ports[0]);
-      bool is_leader = r.role == consensus::RaftPeerPB::LEADER;
-      unique_ptr<KuduReplica> client_replica(new KuduReplica);
-      client_replica->data_ = new KuduReplica::Data(is_leader,
-                                                    std::move(client_ts));
-      client_replicas.push_back(client_replica.release());
-    }
 
-    unique_ptr<KuduTablet> client_tablet(new KuduTablet);
-    client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
-                                                std::move(client_replicas));
-    client_replicas.clear();
-
-    // Create the scan token itself.
-    ScanTokenPB message;
-    message.CopyFrom(pb);
-    message.set_lower_bound_partition_key(
-        tablet->partition().partition_key_start());
-    message.set_upper_bound_partition_key(
-        tablet->partition().partition_key_end());
-    unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
-    client_scan_token->data_ =
-        new KuduScanToken::Data(table,
-                                std::move(message),
-                                std::move(client_tablet));
-    tokens->push_back(client_scan_token.release());
+      unique_ptr<KuduTablet> client_tablet(new KuduTablet);
+      client_tablet->data_ = new KuduTablet::Data(tablet->tablet_id(),
+                                                  std::move(client_replicas));
+      client_replicas.clear();
+
+      // Create the scan token itself. The split keys lie strictly within the
+      // primary key bounds of the scan, so each one narrows them.
+      ScanTokenPB message;
+      message.CopyFrom(pb);
+      message.set_lower_bound_partition_key(
+          tablet->partition().partition_key_start());
+      message.set_upper_bound_partition_key(
+          tablet->partition().partition_key_end());
+      if (i > 0) {
+        message.set_lower_bound_primary_key(split_keys[i - 1]);
+      }
+      if (i < split_keys.size()) {
+        message.set_upper_bound_primary_key(split_keys[i]);
+      }
+      unique_ptr<KuduScanToken> client_scan_token(new KuduScanToken);
+      client_scan_token->data_ =
+          new KuduScanToken::Data(table,
+                                  std::move(message),
+                                  std::move(client_tablet));
+      tokens->push_back(client_scan_token.release());
+    }
     pruner.RemovePartitionKeyRange(tablet->partition().partition_key_end());
   }
   return Status::OK();
@@ -24,10 +24,16 @@
 #include "kudu/client/client.h"
 #include "kudu/client/client.pb.h"
 #include "kudu/client/scan_configuration.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/monotime.h"
 
 namespace kudu {
 namespace client {
 
+namespace internal {
+class RemoteTablet;
+} // namespace internal
+
 class KuduScanToken::Data {
  public:
   explicit Data(KuduTable* table,
@@ -71,8 +77,22 @@ class KuduScanTokenBuilder::Data {
     return &configuration_;
   }
 
+  void set_num_ranges_per_tablet(int num_ranges) {
+    num_ranges_per_tablet_ = num_ranges;
+  }
+
  private:
+  // Asks a replica of 'tablet' for the keys splitting the primary key range
+  // of 'pb' into 'num_ranges_per_tablet_' sub-ranges.
+  Status SplitKeyRange(const scoped_refptr<internal::RemoteTablet>& tablet,
+                       const ScanTokenPB& pb,
+                       const MonoTime& deadline,
+                       std::vector<std::string>* split_keys);
+
   ScanConfiguration configuration_;
+
+  // The number of tokens to build for each tablet.
+  int num_ranges_per_tablet_;
 };
 
 } // namespace client
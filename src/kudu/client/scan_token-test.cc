@@ -375,6 +375,125 @@ TEST_F(ScanTokenTest, TestScanTokensWithNonCoveringRange) {
   }
 }
 
+// Test that tokens split within a tablet cover disjoint key ranges whose union
+// is the whole tablet.
+TEST_F(ScanTokenTest, TestScanTokensWithRangesPerTablet) {
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("col")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    ASSERT_OK(builder.Build(&schema));
+  }
+
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name("table")
+                            .schema(&schema)
+                            .set_range_partition_columns({ "col" })
+                            .num_replicas(1)
+                            .Create());
+    ASSERT_OK(client_->OpenTable("table", &table));
+  }
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  session->SetTimeoutMillis(10000);
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  for (int i = 0; i < 1000; i++) {
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt64("col", i));
+    ASSERT_OK(session->Apply(insert.release()));
+  }
+  ASSERT_OK(session->Flush());
+
+  { // no predicates
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetNumRangesPerTablet(4));
+    ASSERT_OK(builder.Build(&tokens));
+
+    ASSERT_EQ(4, tokens.size());
+    ASSERT_EQ(1000, CountRows(tokens));
+  }
+
+  { // range predicate
+    vector<KuduScanToken*> tokens;
+    ElementDeleter deleter(&tokens);
+    KuduScanTokenBuilder builder(table.get());
+    ASSERT_OK(builder.SetNumRangesPerTablet(4));
+    unique_ptr<KuduPredicate> predicate(table->NewComparisonPredicate("col",
+                                                                      KuduPredicate::GREATER_EQUAL,
+                                                                      KuduValue::FromInt(500)));
+    ASSERT_OK(builder.AddConjunctPredicate(predicate.release()));
+    ASSERT_OK(builder.Build(&tokens));
+
+    ASSERT_EQ(4, tokens.size());
+    ASSERT_EQ(500, CountRows(tokens));
+  }
+
+  // The number of ranges must be positive.
+  KuduScanTokenBuilder builder(table.get());
+  ASSERT_TRUE(builder.SetNumRangesPerTablet(0).IsInvalidArgument());
+}
+
+// Test scanning the tokens of a table concurrently with a parallel scanner.
+TEST_F(ScanTokenTest, TestParallelScanner) {
+  KuduSchema schema;
+  {
+    KuduSchemaBuilder builder;
+    builder.AddColumn("col")->NotNull()->Type(KuduColumnSchema::INT64)->PrimaryKey();
+    ASSERT_OK(builder.Build(&schema));
+  }
+
+  shared_ptr<KuduTable> table;
+  {
+    unique_ptr<client::KuduTableCreator> table_creator(client_->NewTableCreator());
+    ASSERT_OK(table_creator->table_name("table")
+                            .schema(&schema)
+                            .add_hash_partitions({ "col" }, 8)
+                            .num_replicas(1)
+                            .Create());
+    ASSERT_OK(client_->OpenTable("table", &table));
+  }
+
+  shared_ptr<KuduSession> session = client_->NewSession();
+  session->SetTimeoutMillis(10000);
+  ASSERT_OK(session->SetFlushMode(KuduSession::AUTO_FLUSH_BACKGROUND));
+  for (int i = 0; i < 1000; i++) {
+    unique_ptr<KuduInsert> insert(table->NewInsert());
+    ASSERT_OK(insert->mutable_row()->SetInt64("col", i));
+    ASSERT_OK(session->Apply(insert.release()));
+  }
+  ASSERT_OK(session->Flush());
+
+  // Scan with small batches and buffer bound, so that the scanning threads
+  // have to wait for the batches to be consumed.
+  KuduScanTokenBuilder builder(table.get());
+  ASSERT_OK(builder.SetBatchSizeBytes(100));
+  KuduParallelScanner scanner(&builder);
+  ASSERT_TRUE(scanner.SetMaxConcurrentScans(0).IsInvalidArgument());
+  ASSERT_TRUE(scanner.SetMaxBufferedBytes(0).IsInvalidArgument());
+  ASSERT_OK(scanner.SetMaxConcurrentScans(3));
+  ASSERT_OK(scanner.SetMaxBufferedBytes(1));
+  ASSERT_OK(scanner.Open());
+
+  unordered_set<int64_t> keys;
+  KuduScanBatch batch;
+  while (scanner.HasMoreBatches()) {
+    ASSERT_OK(scanner.NextBatch(&batch));
+    ASSERT_GT(batch.NumRows(), 0);
+    for (int i = 0; i < batch.NumRows(); i++) {
+      int64_t key;
+      ASSERT_OK(batch.Row(i).GetInt64(0, &key));
+      ASSERT_TRUE(keys.insert(key).second) << "duplicate key " << key;
+    }
+  }
+  ASSERT_EQ(1000, keys.size());
+  ASSERT_TRUE(scanner.NextBatch(&batch).IsIllegalState());
+  scanner.Close();
+}
+
 // When building a scanner from a serialized scan token,
 // verify that the propagated timestamp from the token makes its way into the
 // latest observed timestamp of the client object.
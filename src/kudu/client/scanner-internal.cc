@@ -31,6 +31,8 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/rpc_controller.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/hexdump.h"
 
 using google::protobuf::FieldDescriptor;
@@ -38,6 +40,7 @@ using google::protobuf::Reflection;
 
 using std::set;
 using std::string;
+using std::unique_ptr;
 
 namespace kudu {
 
@@ -45,6 +48,7 @@ using rpc::RpcController;
 using strings::Substitute;
 using strings::SubstituteAndAppend;
 using tserver::NewScanRequestPB;
+using tserver::ScanResponsePB;
 using tserver::TabletServerFeatures;
 
 namespace client {
@@ -57,10 +61,17 @@ KuduScanner::Data::Data(KuduTable* table)
     data_in_open_(false),
     short_circuit_(false),
     table_(DCHECK_NOTNULL(table)->shared_from_this()),
-    scan_attempts_(0) {
+    scan_attempts_(0),
+    read_ahead_cond_(&read_ahead_lock_),
+    read_ahead_stopped_(false) {
 }
 
 KuduScanner::Data::~Data() {
+  StopReadAhead();
+  if (keep_alive_state_) {
+    std::lock_guard<simple_spinlock> l(keep_alive_state_->lock);
+    keep_alive_state_->closed = true;
+  }
 }
 
 Status KuduScanner::Data::HandleError(const ScanRpcStatus& err,
@@ -155,6 +166,18 @@ void KuduScanner::Data::UpdateResourceMetrics() {
       }
     }
   }
+  // The per-column figures of scan profiles are named after the column.
+  for (const tserver::ColumnScanProfilePB& profile : last_response_.column_profiles()) {
+    const Reflection* reflection = profile.GetReflection();
+    vector<const FieldDescriptor*> fields;
+    reflection->ListFields(profile, &fields);
+    for (const FieldDescriptor* field : fields) {
+      if (field->cpp_type() == FieldDescriptor::CPPTYPE_INT64) {
+        resource_metrics_.Increment(Substitute("$0.$1", field->name(), profile.column_name()),
+                                    reflection->GetInt64(profile, field));
+      }
+    }
+  }
 }
 
 ScanRpcStatus KuduScanner::Data::AnalyzeResponse(const Status& rpc_status,
@@ -221,8 +244,9 @@ Status KuduScanner::Data::ReopenCurrentTablet(const MonoTime& deadline,
                     blacklist);
 }
 
-ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
-                                             bool allow_time_for_failover) {
+MonoTime KuduScanner::Data::PrepareController(const MonoTime& overall_deadline,
+                                              bool allow_time_for_failover,
+                                              RpcController* controller) const {
   // The user has specified a timeout which should apply to the total time for each call
   // to NextBatch(). However, for fault-tolerant scans, or for when we are first opening
   // a scanner, it's preferable to set a shorter timeout (the "default RPC timeout") for
@@ -236,16 +260,60 @@ ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
     rpc_deadline = overall_deadline;
   }
 
-  controller_.Reset();
-  controller_.set_deadline(rpc_deadline);
+  controller->Reset();
+  controller->set_deadline(rpc_deadline);
   if (!configuration_.spec().predicates().empty()) {
-    controller_.RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
+    controller->RequireServerFeature(TabletServerFeatures::COLUMN_PREDICATES);
+  }
+  for (const auto& col_pred : configuration_.spec().predicates()) {
+    if (col_pred.second.predicate_type() == PredicateType::InBloomFilter) {
+      controller->RequireServerFeature(TabletServerFeatures::BLOOM_FILTER_PREDICATES);
+      break;
+    }
+  }
+  if (configuration_.columnar_layout()) {
+    controller->RequireServerFeature(TabletServerFeatures::COLUMNAR_LAYOUT);
+  }
+  if (configuration_.sidecar_compression() != kudu::NO_COMPRESSION) {
+    controller->RequireServerFeature(TabletServerFeatures::COMPRESSED_SIDECARS);
   }
+  return rpc_deadline;
+}
+
+void KuduScanner::Data::RecordRpcResult(const MonoDelta& latency,
+                                        const ScanRpcStatus& status) {
+  switch (status.result) {
+    case ScanRpcStatus::OK:
+      ts_->RecordRpcResult(latency, false);
+      break;
+    case ScanRpcStatus::SERVER_BUSY:
+    case ScanRpcStatus::RPC_DEADLINE_EXCEEDED:
+    case ScanRpcStatus::OVERALL_DEADLINE_EXCEEDED:
+    case ScanRpcStatus::RPC_ERROR:
+      ts_->RecordRpcResult(latency, true);
+      break;
+    default:
+      // The other errors are about the scan or the tablet rather than the
+      // server, and say nothing about how fast it serves scans.
+      break;
+  }
+}
+
+ScanRpcStatus KuduScanner::Data::SendScanRpc(const MonoTime& overall_deadline,
+                                             bool allow_time_for_failover) {
+  MonoTime rpc_deadline = PrepareController(overall_deadline, allow_time_for_failover,
+                                            &controller_);
+  if (keep_alive_state_) {
+    std::lock_guard<simple_spinlock> l(keep_alive_state_->lock);
+    keep_alive_state_->last_used = MonoTime::Now();
+  }
+  MonoTime start = MonoTime::Now();
   ScanRpcStatus scan_status = AnalyzeResponse(
       proxy_->Scan(next_req_,
                    &last_response_,
                    &controller_),
       rpc_deadline, overall_deadline);
+  RecordRpcResult(MonoTime::Now() - start, scan_status);
   if (scan_status.result == ScanRpcStatus::OK) {
     UpdateResourceMetrics();
   }
@@ -291,6 +359,21 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
   }
 
   scan->set_cache_blocks(configuration_.spec().cache_blocks());
+  if (configuration_.spec().cache_blocks_low_priority()) {
+    scan->set_cache_blocks_low_priority(true);
+  }
+  if (configuration_.columnar_layout()) {
+    scan->set_columnar_layout(true);
+  }
+  if (configuration_.prefetching()) {
+    scan->set_prefetch_next_batch(true);
+  }
+  if (configuration_.profiling()) {
+    scan->set_profile(true);
+  }
+  if (configuration_.sidecar_compression() != kudu::NO_COMPRESSION) {
+    scan->set_sidecar_compression(configuration_.sidecar_compression());
+  }
 
   // For consistent operations, propagate the timestamp among all operations
   // performed the context of the same client.
@@ -428,14 +511,17 @@ Status KuduScanner::Data::OpenTablet(const string& partition_key,
         last_response_.propagated_timestamp());
   }
 
+  UpdateKeepAliveScanner();
   return Status::OK();
 }
 
 Status KuduScanner::Data::KeepAlive() {
   if (!open_) return Status::IllegalState("Scanner was not open.");
   // If there is no scanner to keep alive, we still return Status::OK().
+  // The scanner ID is checked without its presence bit, which read ahead
+  // RPCs may update concurrently.
   if (!last_response_.IsInitialized() || !last_response_.has_more_results() ||
-      !next_req_.has_scanner_id()) {
+      next_req_.scanner_id().empty()) {
     return Status::OK();
   }
 
@@ -451,6 +537,189 @@ Status KuduScanner::Data::KeepAlive() {
   return Status::OK();
 }
 
+namespace {
+struct KeepAliveCallback {
+  RpcController controller;
+  tserver::ScannerKeepAliveRequestPB request;
+  tserver::ScannerKeepAliveResponsePB response;
+  void Callback() {
+    Status s = controller.status();
+    if (s.ok() && response.has_error()) {
+      s = StatusFromPB(response.error().status());
+    }
+    if (!s.ok()) {
+      LOG(WARNING) << "Couldn't keep scanner " << request.scanner_id() << " alive: "
+                   << s.ToString();
+    }
+    delete this;
+  }
+};
+} // anonymous namespace
+
+void KuduScanner::Data::StartKeepAliveTask() {
+  const MonoDelta& period = configuration_.keep_alive_period();
+  if (!period.Initialized()) {
+    return;
+  }
+  keep_alive_state_ = std::make_shared<ScannerKeepAliveState>();
+  UpdateKeepAliveScanner();
+  std::weak_ptr<rpc::Messenger> weak_messenger(table_->client()->data_->messenger_);
+  table_->client()->data_->messenger_->ScheduleOnReactor(
+      boost::bind(&KuduScanner::Data::KeepAliveTask, _1,
+                  std::move(weak_messenger), keep_alive_state_, period),
+      period);
+}
+
+void KuduScanner::Data::UpdateKeepAliveScanner() {
+  if (!keep_alive_state_) {
+    return;
+  }
+  // Once a tablet returned all of its results, the tablet server closed the
+  // scanner.
+  bool has_scanner = last_response_.has_more_results() && !next_req_.scanner_id().empty();
+  std::lock_guard<simple_spinlock> l(keep_alive_state_->lock);
+  keep_alive_state_->proxy = has_scanner ? proxy_ : nullptr;
+  keep_alive_state_->scanner_id = has_scanner ? next_req_.scanner_id() : "";
+  keep_alive_state_->last_used = MonoTime::Now();
+}
+
+void KuduScanner::Data::KeepAliveTask(const Status& status,
+                                      std::weak_ptr<rpc::Messenger> weak_messenger,
+                                      std::shared_ptr<ScannerKeepAliveState> state,
+                                      MonoDelta period) {
+  if (PREDICT_FALSE(!status.ok())) {
+    // The reactor is shutting down.
+    return;
+  }
+
+  MonoDelta next_run = period;
+  std::shared_ptr<tserver::TabletServerServiceProxy> proxy;
+  string scanner_id;
+  {
+    std::lock_guard<simple_spinlock> l(state->lock);
+    if (state->closed) {
+      return;
+    }
+    MonoTime now = MonoTime::Now();
+    MonoTime due = state->last_used + period;
+    if (now < due) {
+      next_run = due - now;
+    } else if (!state->scanner_id.empty()) {
+      proxy = state->proxy;
+      scanner_id = state->scanner_id;
+      state->last_used = now;
+    }
+  }
+
+  if (proxy) {
+    VLOG(2) << "Keeping scanner " << scanner_id << " alive";
+    KeepAliveCallback* cb = new KeepAliveCallback;
+    cb->request.set_scanner_id(scanner_id);
+    cb->controller.set_timeout(period);
+    proxy->ScannerKeepAliveAsync(cb->request, &cb->response, &cb->controller,
+                                 boost::bind(&KeepAliveCallback::Callback, cb));
+  }
+
+  std::shared_ptr<rpc::Messenger> messenger(weak_messenger.lock());
+  if (PREDICT_TRUE(messenger)) {
+    messenger->ScheduleOnReactor(
+        boost::bind(&KuduScanner::Data::KeepAliveTask, _1,
+                    std::move(weak_messenger), std::move(state), period),
+        next_run);
+  }
+}
+
+void KuduScanner::Data::MaybeReadAhead() {
+  if (configuration_.read_ahead_batches() == 0) {
+    return;
+  }
+  {
+    MutexLock l(read_ahead_lock_);
+    if (read_ahead_stopped_ || read_ahead_in_flight_ ||
+        static_cast<int>(read_ahead_batches_.size()) >= configuration_.read_ahead_batches()) {
+      return;
+    }
+    const ScanResponsePB& last = read_ahead_batches_.empty()
+        ? last_response_ : read_ahead_batches_.back()->response;
+    if (!read_ahead_batches_.empty() &&
+        (!read_ahead_batches_.back()->controller.status().ok() || last.has_error())) {
+      return;
+    }
+    if (!last.has_more_results()) {
+      return;
+    }
+    read_ahead_in_flight_.reset(new ReadAheadBatch);
+  }
+  SendReadAheadRpc();
+}
+
+void KuduScanner::Data::SendReadAheadRpc() {
+  // Only this thread touches the batch in flight until its RPC completes.
+  ReadAheadBatch* batch = read_ahead_in_flight_.get();
+  batch->overall_deadline = MonoTime::Now() + configuration_.timeout();
+  batch->rpc_deadline = PrepareController(batch->overall_deadline,
+                                          configuration_.is_fault_tolerant(),
+                                          &batch->controller);
+  PrepareRequest(KuduScanner::Data::CONTINUE);
+  if (keep_alive_state_) {
+    std::lock_guard<simple_spinlock> l(keep_alive_state_->lock);
+    keep_alive_state_->last_used = MonoTime::Now();
+  }
+  batch->sent_time = MonoTime::Now();
+  proxy_->ScanAsync(next_req_, &batch->response, &batch->controller,
+                    boost::bind(&KuduScanner::Data::ReadAheadRpcFinished, this));
+}
+
+void KuduScanner::Data::ReadAheadRpcFinished() {
+  {
+    MutexLock l(read_ahead_lock_);
+    ReadAheadBatch* batch = read_ahead_in_flight_.get();
+    batch->latency = MonoTime::Now() - batch->sent_time;
+    bool failed = !batch->controller.status().ok() || batch->response.has_error();
+    bool more = !failed && batch->response.has_more_results();
+    read_ahead_batches_.push_back(std::move(read_ahead_in_flight_));
+    read_ahead_cond_.Broadcast();
+    if (read_ahead_stopped_ || !more ||
+        static_cast<int>(read_ahead_batches_.size()) >= configuration_.read_ahead_batches()) {
+      return;
+    }
+    read_ahead_in_flight_.reset(new ReadAheadBatch);
+  }
+  SendReadAheadRpc();
+}
+
+bool KuduScanner::Data::TakeReadAheadBatch(ScanRpcStatus* status) {
+  unique_ptr<ReadAheadBatch> batch;
+  {
+    MutexLock l(read_ahead_lock_);
+    while (read_ahead_batches_.empty() && read_ahead_in_flight_) {
+      read_ahead_cond_.Wait();
+    }
+    if (read_ahead_batches_.empty()) {
+      return false;
+    }
+    batch = std::move(read_ahead_batches_.front());
+    read_ahead_batches_.pop_front();
+  }
+  last_response_.Swap(&batch->response);
+  controller_.Swap(&batch->controller);
+  *status = AnalyzeResponse(controller_.status(), batch->rpc_deadline, batch->overall_deadline);
+  RecordRpcResult(batch->latency, *status);
+  if (status->result == ScanRpcStatus::OK) {
+    UpdateResourceMetrics();
+  }
+  return true;
+}
+
+void KuduScanner::Data::StopReadAhead() {
+  MutexLock l(read_ahead_lock_);
+  read_ahead_stopped_ = true;
+  while (read_ahead_in_flight_) {
+    read_ahead_cond_.Wait();
+  }
+  read_ahead_batches_.clear();
+}
+
 bool KuduScanner::Data::MoreTablets() const {
   CHECK(open_);
   // TODO(KUDU-565): add a test which has a scan end on a tablet boundary
@@ -483,7 +752,12 @@ void KuduScanner::Data::UpdateLastError(const Status& error) {
 // KuduScanBatch
 ////////////////////////////////////////////////////////////
 
-KuduScanBatch::Data::Data() : projection_(NULL) {}
+KuduScanBatch::Data::Data()
+    : projection_(NULL),
+      columnar_(false),
+      transposed_(false),
+      codec_(nullptr) {
+}
 
 KuduScanBatch::Data::~Data() {}
 
@@ -495,31 +769,27 @@ size_t KuduScanBatch::Data::CalculateProjectedRowSize(const Schema& proj) {
 Status KuduScanBatch::Data::Reset(RpcController* controller,
                                   const Schema* projection,
                                   const KuduSchema* client_projection,
+                                  CompressionType sidecar_compression,
                                   gscoped_ptr<RowwiseRowBlockPB> data) {
   CHECK(controller->finished());
   controller_.Swap(controller);
   projection_ = projection;
   client_projection_ = client_projection;
+  columnar_ = false;
+  transposed_ = false;
+  columnar_columns_.clear();
   resp_data_.Swap(data.get());
+  RETURN_NOT_OK(SetSidecarCodec(sidecar_compression));
 
   // First, rewrite the relative addresses into absolute ones.
   if (PREDICT_FALSE(!resp_data_.has_rows_sidecar())) {
     return Status::Corruption("Server sent invalid response: no row data");
-  } else {
-    Status s = controller_.GetSidecar(resp_data_.rows_sidecar(), &direct_data_);
-    if (!s.ok()) {
-      return Status::Corruption("Server sent invalid response: row data "
-                                "sidecar index corrupt", s.ToString());
-    }
   }
+  RETURN_NOT_OK(GetSidecar(resp_data_.rows_sidecar(), "row data", &direct_data_));
 
   if (resp_data_.has_indirect_data_sidecar()) {
-    Status s = controller_.GetSidecar(resp_data_.indirect_data_sidecar(),
-                                      &indirect_data_);
-    if (!s.ok()) {
-      return Status::Corruption("Server sent invalid response: indirect data "
-                                "sidecar index corrupt", s.ToString());
-    }
+    RETURN_NOT_OK(GetSidecar(resp_data_.indirect_data_sidecar(), "indirect data",
+                             &indirect_data_));
   }
 
   RETURN_NOT_OK(RewriteRowBlockPointers(*projection_, resp_data_, indirect_data_, &direct_data_));
@@ -527,7 +797,212 @@ Status KuduScanBatch::Data::Reset(RpcController* controller,
   return Status::OK();
 }
 
+Status KuduScanBatch::Data::SetSidecarCodec(CompressionType sidecar_compression) {
+  uncompressed_sidecars_.clear();
+  codec_ = nullptr;
+  if (sidecar_compression == kudu::NO_COMPRESSION) {
+    return Status::OK();
+  }
+  Status s = GetCompressionCodec(sidecar_compression, &codec_);
+  if (PREDICT_FALSE(!s.ok() || codec_ == nullptr)) {
+    return Status::Corruption("Server sent invalid response: unsupported sidecar "
+                              "compression", CompressionType_Name(sidecar_compression));
+  }
+  return Status::OK();
+}
+
+Status KuduScanBatch::Data::GetSidecar(int idx, const string& what, Slice* sidecar) {
+  Status s = controller_.GetSidecar(idx, sidecar);
+  if (!s.ok()) {
+    return Status::Corruption(Substitute("Server sent invalid response: $0 "
+                                         "sidecar index corrupt", what), s.ToString());
+  }
+  if (codec_) {
+    std::unique_ptr<faststring> buf(new faststring());
+    s = UncompressSidecar(*codec_, *sidecar, buf.get());
+    if (!s.ok()) {
+      return Status::Corruption(Substitute("Server sent invalid response: $0 "
+                                           "sidecar corrupt", what), s.ToString());
+    }
+    *sidecar = Slice(*buf);
+    uncompressed_sidecars_.emplace_back(std::move(buf));
+  }
+  return Status::OK();
+}
+
+Status KuduScanBatch::Data::ResetColumnar(RpcController* controller,
+                                          const Schema* projection,
+                                          const KuduSchema* client_projection,
+                                          CompressionType sidecar_compression,
+                                          gscoped_ptr<ColumnarRowBlockPB> data) {
+  CHECK(controller->finished());
+  controller_.Swap(controller);
+  projection_ = projection;
+  client_projection_ = client_projection;
+  columnar_ = true;
+  transposed_ = false;
+  RETURN_NOT_OK(SetSidecarCodec(sidecar_compression));
+  if (data) {
+    columnar_resp_data_.Swap(data.get());
+  } else {
+    columnar_resp_data_.Clear();
+  }
+
+  // A response with no rows may have no columns at all.
+  columnar_columns_.clear();
+  columnar_columns_.resize(projection_->num_columns());
+  int64_t n_rows = columnar_resp_data_.num_rows();
+  if (n_rows == 0 && columnar_resp_data_.columns_size() == 0) {
+    return Status::OK();
+  }
+  if (PREDICT_FALSE(columnar_resp_data_.columns_size() != projection_->num_columns())) {
+    return Status::Corruption(Substitute(
+        "Server sent invalid response: $0 columns, expected $1",
+        columnar_resp_data_.columns_size(), projection_->num_columns()));
+  }
+
+  for (int i = 0; i < projection_->num_columns(); i++) {
+    const ColumnSchema& col = projection_->column(i);
+    const ColumnarRowBlockPB::Column& col_pb = columnar_resp_data_.columns(i);
+    ColumnarColumn* dst = &columnar_columns_[i];
+    if (PREDICT_FALSE(!col_pb.has_data_sidecar())) {
+      return Status::Corruption("Server sent invalid response: no column data", col.name());
+    }
+    RETURN_NOT_OK(GetSidecar(col_pb.data_sidecar(), "column data", &dst->data));
+
+    if (col.type_info()->physical_type() == BINARY) {
+      if (PREDICT_FALSE(!col_pb.has_varlen_data_sidecar() ||
+                        dst->data.size() != (n_rows + 1) * sizeof(uint32_t))) {
+        return Status::Corruption("Server sent invalid response: bad variable-length "
+                                  "column data", col.name());
+      }
+      RETURN_NOT_OK(GetSidecar(col_pb.varlen_data_sidecar(), "variable-length data",
+                               &dst->varlen_data));
+      uint32_t last_offset;
+      memcpy(&last_offset, dst->data.data() + n_rows * sizeof(uint32_t), sizeof(last_offset));
+      if (PREDICT_FALSE(last_offset > dst->varlen_data.size())) {
+        return Status::Corruption("Server sent invalid response: variable-length "
+                                  "offset out of bounds", col.name());
+      }
+    } else if (PREDICT_FALSE(dst->data.size() != n_rows * col.type_info()->size())) {
+      return Status::Corruption("Server sent invalid response: bad column data size",
+                                col.name());
+    }
+
+    if (col.is_nullable()) {
+      if (PREDICT_FALSE(!col_pb.has_non_null_bitmap_sidecar())) {
+        return Status::Corruption("Server sent invalid response: no non-null bitmap",
+                                  col.name());
+      }
+      RETURN_NOT_OK(GetSidecar(col_pb.non_null_bitmap_sidecar(), "non-null bitmap",
+                               &dst->non_null_bitmap));
+      if (PREDICT_FALSE(dst->non_null_bitmap.size() < BitmapSize(n_rows))) {
+        return Status::Corruption("Server sent invalid response: non-null bitmap "
+                                  "too short", col.name());
+      }
+    }
+  }
+  return Status::OK();
+}
+
+int64_t KuduScanBatch::Data::data_size() const {
+  if (!columnar_) {
+    return direct_data_.size() + indirect_data_.size();
+  }
+  int64_t size = 0;
+  for (const ColumnarColumn& col : columnar_columns_) {
+    size += col.data.size() + col.varlen_data.size() + col.non_null_bitmap.size();
+  }
+  return size;
+}
+
+Status KuduScanBatch::Data::PrepareColumnarAccess(int idx) {
+  if (PREDICT_FALSE(idx < 0 || idx >= projection_->num_columns())) {
+    return Status::InvalidArgument(Substitute("column index $0 out of range", idx));
+  }
+  if (!columnar_ && !transposed_) {
+    TransposeRows();
+  }
+  return Status::OK();
+}
+
+void KuduScanBatch::Data::TransposeRows() {
+  DCHECK(!columnar_);
+  const int n_rows = resp_data_.num_rows();
+  const int n_cols = projection_->num_columns();
+
+  // Lay out the columns, and note where each one's cells are in the rows.
+  struct ColumnLayout {
+    size_t offset;
+    size_t size;
+    bool varlen;
+    bool nullable;
+  };
+  vector<ColumnLayout> layouts(n_cols);
+  transposed_columns_.resize(n_cols);
+  for (int i = 0; i < n_cols; i++) {
+    const ColumnSchema& col = projection_->column(i);
+    ColumnLayout* layout = &layouts[i];
+    layout->offset = projection_->column_offset(i);
+    layout->size = col.type_info()->size();
+    layout->varlen = col.type_info()->physical_type() == BINARY;
+    layout->nullable = col.is_nullable();
+
+    TransposedColumn* dst = &transposed_columns_[i];
+    dst->varlen_data.clear();
+    if (layout->varlen) {
+      dst->data.resize((n_rows + 1) * sizeof(uint32_t));
+    } else {
+      dst->data.resize(n_rows * layout->size);
+    }
+    if (layout->nullable) {
+      dst->non_null_bitmap.resize(BitmapSize(n_rows));
+      memset(dst->non_null_bitmap.data(), 0, dst->non_null_bitmap.size());
+    } else {
+      dst->non_null_bitmap.clear();
+    }
+  }
+
+  const size_t null_bitmap_offset = projection_->byte_size();
+  const uint8_t* row = direct_data_.data();
+  for (int r = 0; r < n_rows; r++, row += projected_row_size_) {
+    for (int i = 0; i < n_cols; i++) {
+      const ColumnLayout& layout = layouts[i];
+      TransposedColumn* dst = &transposed_columns_[i];
+      bool is_null = layout.nullable && BitmapTest(row + null_bitmap_offset, i);
+      if (layout.nullable && !is_null) {
+        BitmapSet(dst->non_null_bitmap.data(), r);
+      }
+      if (layout.varlen) {
+        uint32_t offset = dst->varlen_data.size();
+        memcpy(dst->data.data() + r * sizeof(uint32_t), &offset, sizeof(offset));
+        if (!is_null) {
+          const Slice* cell = reinterpret_cast<const Slice*>(row + layout.offset);
+          dst->varlen_data.append(cell->data(), cell->size());
+        }
+      } else {
+        memcpy(dst->data.data() + r * layout.size, row + layout.offset, layout.size);
+      }
+    }
+  }
+
+  columnar_columns_.resize(n_cols);
+  for (int i = 0; i < n_cols; i++) {
+    TransposedColumn* src = &transposed_columns_[i];
+    if (layouts[i].varlen) {
+      uint32_t offset = src->varlen_data.size();
+      memcpy(src->data.data() + n_rows * sizeof(uint32_t), &offset, sizeof(offset));
+    }
+    ColumnarColumn* dst = &columnar_columns_[i];
+    dst->data = Slice(src->data);
+    dst->varlen_data = Slice(src->varlen_data);
+    dst->non_null_bitmap = Slice(src->non_null_bitmap);
+  }
+  transposed_ = true;
+}
+
 void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
+  DCHECK(!columnar_);
   int n_rows = resp_data_.num_rows();
   rows->resize(n_rows);
 
@@ -554,6 +1029,11 @@ void KuduScanBatch::Data::ExtractRows(vector<KuduScanBatch::RowPtr>* rows) {
 
 void KuduScanBatch::Data::Clear() {
   resp_data_.Clear();
+  columnar_resp_data_.Clear();
+  columnar_columns_.clear();
+  transposed_ = false;
+  uncompressed_sidecars_.clear();
+  codec_ = nullptr;
   controller_.Reset();
 }
 
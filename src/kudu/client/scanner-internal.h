@@ -17,6 +17,8 @@
 #ifndef KUDU_CLIENT_SCANNER_INTERNAL_H
 #define KUDU_CLIENT_SCANNER_INTERNAL_H
 
+#include <deque>
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -30,9 +32,21 @@
 #include "kudu/gutil/macros.h"
 #include "kudu/tserver/tserver_service.proxy.h"
 #include "kudu/util/auto_release_pool.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 
 namespace kudu {
 
+class CompressionCodec;
+
+namespace rpc {
+class Messenger;
+} // namespace rpc
+
 namespace client {
 
 // The result of KuduScanner::Data::AnalyzeResponse.
@@ -77,6 +91,22 @@ struct ScanRpcStatus {
   Status status;
 };
 
+// The state shared by a scanner and the reactor task which keeps it alive.
+struct ScannerKeepAliveState {
+  simple_spinlock lock;
+
+  // The tablet server holding the scanner to keep alive, and its ID. The ID
+  // is empty while there's no scanner to keep alive.
+  std::shared_ptr<tserver::TabletServerServiceProxy> proxy;
+  std::string scanner_id;
+
+  // The last time a request was sent for the scanner.
+  MonoTime last_used;
+
+  // Set once the scanner is closed, which ends the task.
+  bool closed = false;
+};
+
 class KuduScanner::Data {
  public:
 
@@ -123,6 +153,29 @@ class KuduScanner::Data {
 
   Status KeepAlive();
 
+  // Starts keeping the scanner alive in the background, if the scan is
+  // configured to.
+  void StartKeepAliveTask();
+
+  // Records the current scanner of the scan, if there's more to scan with it,
+  // as the one to keep alive, and that it was just used.
+  void UpdateKeepAliveScanner();
+
+  // Fetches the next batch of the current tablet in the background if the
+  // scan reads ahead, nothing is being fetched already, fewer batches than
+  // configured are buffered, and the last batch fetched has more after it.
+  void MaybeReadAhead();
+
+  // If a batch was fetched, or is being fetched, ahead of the caller, waits
+  // for it and moves it into 'last_response_' and 'controller_', sets
+  // 'status' to the analysis of its response and returns true. Otherwise,
+  // returns false.
+  bool TakeReadAheadBatch(ScanRpcStatus* status);
+
+  // Stops reading ahead: waits for the batch being fetched, if any, and
+  // drops the buffered batches.
+  void StopReadAhead();
+
   // Returns whether there may exist more tablets to scan.
   //
   // This method does not take into account any non-covered range partitions
@@ -215,6 +268,37 @@ class KuduScanner::Data {
   // The scanner's cumulative resource metrics since the scan was started.
   ResourceMetrics resource_metrics_;
 
+  // A batch fetched ahead of the caller.
+  struct ReadAheadBatch {
+    tserver::ScanResponsePB response;
+    rpc::RpcController controller;
+    MonoTime overall_deadline;
+    MonoTime rpc_deadline;
+    MonoTime sent_time;
+    MonoDelta latency;
+  };
+
+  // Protects the read ahead state below, which the callbacks of the read
+  // ahead RPCs update.
+  Mutex read_ahead_lock_;
+
+  // Signalled when a read ahead RPC completes.
+  ConditionVariable read_ahead_cond_;
+
+  // The batches fetched ahead, in order, and the one being fetched, if any.
+  // Only the last fetched batch may have failed: nothing is fetched after a
+  // failure, leaving it to NextBatch() to handle.
+  std::deque<std::unique_ptr<ReadAheadBatch>> read_ahead_batches_;
+  std::unique_ptr<ReadAheadBatch> read_ahead_in_flight_;
+
+  // Set when reading ahead is stopped, so that in-flight RPCs don't send
+  // more.
+  bool read_ahead_stopped_;
+
+  // Shared with the keep-alive task, if the scanner is kept alive
+  // automatically.
+  std::shared_ptr<ScannerKeepAliveState> keep_alive_state_;
+
   // Returns a text description of the scan suitable for debug printing.
   //
   // This method will not return sensitive predicate information, so it's
@@ -243,6 +327,29 @@ class KuduScanner::Data {
                                 const MonoTime& overall_deadline,
                                 const MonoTime& rpc_deadline);
 
+  // Records the outcome of a scan RPC to the current tablet server, which
+  // took 'latency', for the latency-based selection of replicas.
+  void RecordRpcResult(const MonoDelta& latency, const ScanRpcStatus& status);
+
+  // Computes the deadline of a scan RPC as documented in SendScanRpc(), and
+  // prepares 'controller' for it.
+  MonoTime PrepareController(const MonoTime& overall_deadline,
+                             bool allow_time_for_failover,
+                             rpc::RpcController* controller) const;
+
+  // Sends the next continuation of the scan for reading ahead.
+  void SendReadAheadRpc();
+
+  // The callback of the read ahead RPCs.
+  void ReadAheadRpcFinished();
+
+  // Sends a keep-alive request for the scanner in 'state' if it hasn't been
+  // used for 'period', and reschedules itself.
+  static void KeepAliveTask(const Status& status,
+                            std::weak_ptr<rpc::Messenger> weak_messenger,
+                            std::shared_ptr<ScannerKeepAliveState> state,
+                            MonoDelta period);
+
   void UpdateResourceMetrics();
 
   DISALLOW_COPY_AND_ASSIGN(Data);
@@ -253,16 +360,36 @@ class KuduScanBatch::Data {
   Data();
   ~Data();
 
+  // 'sidecar_compression' is the codec the response's sidecars were
+  // compressed with.
   Status Reset(rpc::RpcController* controller,
                const Schema* projection,
                const KuduSchema* client_projection,
+               CompressionType sidecar_compression,
                gscoped_ptr<RowwiseRowBlockPB> resp_data);
 
+  // Like Reset(), but for the responses of scanners using the columnar
+  // layout. 'resp_data' may be null if the response holds no rows.
+  Status ResetColumnar(rpc::RpcController* controller,
+                       const Schema* projection,
+                       const KuduSchema* client_projection,
+                       CompressionType sidecar_compression,
+                       gscoped_ptr<ColumnarRowBlockPB> resp_data);
+
   int num_rows() const {
-    return resp_data_.num_rows();
+    return columnar_ ? columnar_resp_data_.num_rows() : resp_data_.num_rows();
   }
 
+  // Returns the number of bytes of data the batch holds.
+  int64_t data_size() const;
+
+  // Returns a bad Status if 'idx' isn't the index of a projected column.
+  // Otherwise makes 'columnar_columns_' available: if the batch isn't
+  // columnar, its rows are transposed into columns on the first call.
+  Status PrepareColumnarAccess(int idx);
+
   KuduRowResult row(int idx) {
+    DCHECK(!columnar_);
     DCHECK_GE(idx, 0);
     DCHECK_LT(idx, num_rows());
     int offset = idx * projected_row_size_;
@@ -295,6 +422,55 @@ class KuduScanBatch::Data {
 
   // The number of bytes of direct data for each row.
   size_t projected_row_size_;
+
+  // Whether the batch was returned in the columnar layout, in which case
+  // the members below are used rather than 'resp_data_' and the row data.
+  bool columnar_;
+
+  ColumnarRowBlockPB columnar_resp_data_;
+
+  // The sidecars of a column in the columnar layout. 'varlen_data' and
+  // 'non_null_bitmap' are empty unless the column is respectively of a
+  // BINARY type and nullable.
+  struct ColumnarColumn {
+    Slice data;
+    Slice varlen_data;
+    Slice non_null_bitmap;
+  };
+  std::vector<ColumnarColumn> columnar_columns_;
+
+ private:
+  // Fills 'columnar_columns_' from the rows of a row-wise batch, in a single
+  // pass over the rows.
+  void TransposeRows();
+
+  // Whether the rows of a row-wise batch have been transposed into
+  // 'transposed_columns_'.
+  bool transposed_;
+
+  // The buffers of the columns transposed from the rows of a row-wise batch,
+  // which 'columnar_columns_' then points into.
+  struct TransposedColumn {
+    faststring data;
+    faststring varlen_data;
+    faststring non_null_bitmap;
+  };
+  std::vector<TransposedColumn> transposed_columns_;
+
+  // Sets 'codec_' according to 'sidecar_compression'.
+  Status SetSidecarCodec(CompressionType sidecar_compression);
+
+  // Sets '*sidecar' to the contents of the sidecar at 'idx' of the response,
+  // uncompressing it first if needed. 'what' describes the sidecar for the
+  // error messages.
+  Status GetSidecar(int idx, const std::string& what, Slice* sidecar);
+
+  // The codec the sidecars of the response are compressed with, or null.
+  const CompressionCodec* codec_;
+
+  // The uncompressed copies of the sidecars of the response, if it was
+  // compressed, which the slices above point into.
+  std::vector<std::unique_ptr<faststring>> uncompressed_sidecars_;
 };
 
 } // namespace client
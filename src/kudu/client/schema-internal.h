@@ -38,7 +38,8 @@ KuduColumnStorageAttributes::CompressionType FromInternalCompressionType(
     kudu::CompressionType type);
 
 kudu::DataType ToInternalDataType(
-    KuduColumnSchema::DataType type);
+    KuduColumnSchema::DataType type,
+    KuduColumnTypeAttributes type_attributes = KuduColumnTypeAttributes());
 KuduColumnSchema::DataType FromInternalDataType(
     kudu::DataType type);
 
@@ -48,6 +49,8 @@ class KuduColumnSpec::Data {
   explicit Data(std::string name)
       : name(std::move(name)),
         has_type(false),
+        has_precision(false),
+        has_scale(false),
         has_encoding(false),
         has_compression(false),
         has_block_size(false),
@@ -68,6 +71,12 @@ class KuduColumnSpec::Data {
   bool has_type;
   KuduColumnSchema::DataType type;
 
+  bool has_precision;
+  int8_t precision;
+
+  bool has_scale;
+  int8_t scale;
+
   bool has_encoding;
   KuduColumnStorageAttributes::EncodingType encoding;
 
@@ -22,6 +22,7 @@
 
 #include "kudu/client/schema-internal.h"
 #include "kudu/client/value-internal.h"
+#include "kudu/common/decimal_util.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/map-util.h"
@@ -33,7 +34,7 @@ MAKE_ENUM_LIMITS(kudu::client::KuduColumnStorageAttributes::EncodingType,
 
 MAKE_ENUM_LIMITS(kudu::client::KuduColumnStorageAttributes::CompressionType,
                  kudu::client::KuduColumnStorageAttributes::DEFAULT_COMPRESSION,
-                 kudu::client::KuduColumnStorageAttributes::ZLIB);
+                 kudu::client::KuduColumnStorageAttributes::ZSTD);
 
 MAKE_ENUM_LIMITS(kudu::client::KuduColumnSchema::DataType,
                  kudu::client::KuduColumnSchema::INT8,
@@ -55,6 +56,7 @@ kudu::EncodingType ToInternalEncodingType(KuduColumnStorageAttributes::EncodingT
     case KuduColumnStorageAttributes::GROUP_VARINT: return kudu::GROUP_VARINT;
     case KuduColumnStorageAttributes::RLE: return kudu::RLE;
     case KuduColumnStorageAttributes::BIT_SHUFFLE: return kudu::BIT_SHUFFLE;
+    case KuduColumnStorageAttributes::DELTA_ENCODING: return kudu::DELTA_ENCODING;
     default: LOG(FATAL) << "Unexpected encoding type: " << type;
   }
 }
@@ -68,6 +70,7 @@ KuduColumnStorageAttributes::EncodingType FromInternalEncodingType(kudu::Encodin
     case kudu::GROUP_VARINT: return KuduColumnStorageAttributes::GROUP_VARINT;
     case kudu::RLE: return KuduColumnStorageAttributes::RLE;
     case kudu::BIT_SHUFFLE: return KuduColumnStorageAttributes::BIT_SHUFFLE;
+    case kudu::DELTA_ENCODING: return KuduColumnStorageAttributes::DELTA_ENCODING;
     default: LOG(FATAL) << "Unexpected internal encoding type: " << type;
   }
 }
@@ -79,6 +82,7 @@ kudu::CompressionType ToInternalCompressionType(KuduColumnStorageAttributes::Com
     case KuduColumnStorageAttributes::SNAPPY: return kudu::SNAPPY;
     case KuduColumnStorageAttributes::LZ4: return kudu::LZ4;
     case KuduColumnStorageAttributes::ZLIB: return kudu::ZLIB;
+    case KuduColumnStorageAttributes::ZSTD: return kudu::ZSTD;
     default: LOG(FATAL) << "Unexpected compression type" << type;
   }
 }
@@ -91,11 +95,13 @@ KuduColumnStorageAttributes::CompressionType FromInternalCompressionType(
     case kudu::SNAPPY: return KuduColumnStorageAttributes::SNAPPY;
     case kudu::LZ4: return KuduColumnStorageAttributes::LZ4;
     case kudu::ZLIB: return KuduColumnStorageAttributes::ZLIB;
+    case kudu::ZSTD: return KuduColumnStorageAttributes::ZSTD;
     default: LOG(FATAL) << "Unexpected internal compression type: " << type;
   }
 }
 
-kudu::DataType ToInternalDataType(KuduColumnSchema::DataType type) {
+kudu::DataType ToInternalDataType(KuduColumnSchema::DataType type,
+                                  KuduColumnTypeAttributes type_attributes) {
   switch (type) {
     case KuduColumnSchema::INT8: return kudu::INT8;
     case KuduColumnSchema::INT16: return kudu::INT16;
@@ -107,6 +113,8 @@ kudu::DataType ToInternalDataType(KuduColumnSchema::DataType type) {
     case KuduColumnSchema::STRING: return kudu::STRING;
     case KuduColumnSchema::BINARY: return kudu::BINARY;
     case KuduColumnSchema::BOOL: return kudu::BOOL;
+    case KuduColumnSchema::DECIMAL:
+      return MaxPrecisionToDecimalType(type_attributes.precision());
     default: LOG(FATAL) << "Unexpected data type: " << type;
   }
 }
@@ -123,10 +131,22 @@ KuduColumnSchema::DataType FromInternalDataType(kudu::DataType type) {
     case kudu::STRING: return KuduColumnSchema::STRING;
     case kudu::BINARY: return KuduColumnSchema::BINARY;
     case kudu::BOOL: return KuduColumnSchema::BOOL;
+    case kudu::DECIMAL32:
+    case kudu::DECIMAL64:
+    case kudu::DECIMAL128:
+      return KuduColumnSchema::DECIMAL;
     default: LOG(FATAL) << "Unexpected internal data type: " << type;
   }
 }
 
+////////////////////////////////////////////////////////////
+// KuduColumnTypeAttributes
+////////////////////////////////////////////////////////////
+
+std::string KuduColumnTypeAttributes::ToString() const {
+  return Substitute("($0, $1)", precision_, scale_);
+}
+
 ////////////////////////////////////////////////////////////
 // KuduColumnSpec
 ////////////////////////////////////////////////////////////
@@ -145,6 +165,18 @@ KuduColumnSpec* KuduColumnSpec::Type(KuduColumnSchema::DataType type) {
   return this;
 }
 
+KuduColumnSpec* KuduColumnSpec::Precision(int8_t precision) {
+  data_->has_precision = true;
+  data_->precision = precision;
+  return this;
+}
+
+KuduColumnSpec* KuduColumnSpec::Scale(int8_t scale) {
+  data_->has_scale = true;
+  data_->scale = scale;
+  return this;
+}
+
 KuduColumnSpec* KuduColumnSpec::Default(KuduValue* v) {
   data_->has_default = true;
   delete data_->default_val;
@@ -217,7 +249,33 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
   if (!data_->has_type) {
     return Status::InvalidArgument("no type provided for column", data_->name);
   }
-  DataType internal_type = ToInternalDataType(data_->type);
+
+  KuduColumnTypeAttributes type_attributes;
+  if (data_->type == KuduColumnSchema::DECIMAL) {
+    if (!data_->has_precision) {
+      return Status::InvalidArgument("no precision provided for decimal column",
+                                     data_->name);
+    }
+    if (data_->precision < kMinDecimalPrecision ||
+        data_->precision > kMaxDecimal128Precision) {
+      return Status::InvalidArgument(
+          Substitute("precision must be between $0 and $1",
+                     kMinDecimalPrecision, kMaxDecimal128Precision),
+          data_->name);
+    }
+    int8_t scale = data_->has_scale ? data_->scale : kDefaultDecimalScale;
+    if (scale < 0 || scale > data_->precision) {
+      return Status::InvalidArgument(
+          "scale must be between 0 and the precision of the column", data_->name);
+    }
+    type_attributes = KuduColumnTypeAttributes(data_->precision, scale);
+  } else if (data_->has_precision || data_->has_scale) {
+    return Status::InvalidArgument(
+        Substitute("precision and scale are not valid on a $0 column",
+                   KuduColumnSchema::DataTypeToString(data_->type)),
+        data_->name);
+  }
+  DataType internal_type = ToInternalDataType(data_->type, type_attributes);
 
   bool nullable = data_->has_nullable ? data_->nullable : true;
 
@@ -225,7 +283,10 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
   // TODO: distinguish between DEFAULT NULL and no default?
   if (data_->has_default) {
     RETURN_NOT_OK(data_->default_val->data_->CheckTypeAndGetPointer(
-                      data_->name, internal_type, &default_val));
+                      data_->name, internal_type,
+                      ColumnTypeAttributes(type_attributes.precision(),
+                                           type_attributes.scale()),
+                      &default_val));
   }
 
 
@@ -249,7 +310,8 @@ Status KuduColumnSpec::ToColumnSchema(KuduColumnSchema* col) const {
 
   *col = KuduColumnSchema(data_->name, data_->type, nullable,
                           default_val,
-                          KuduColumnStorageAttributes(encoding, compression, block_size));
+                          KuduColumnStorageAttributes(encoding, compression, block_size),
+                          type_attributes);
 
   return Status::OK();
 }
@@ -388,6 +450,9 @@ Status KuduSchemaBuilder::Build(KuduSchema* schema) {
 ////////////////////////////////////////////////////////////
 
 std::string KuduColumnSchema::DataTypeToString(DataType type) {
+  if (type == DECIMAL) {
+    return "DECIMAL";
+  }
   return DataType_Name(ToInternalDataType(type));
 }
 
@@ -395,12 +460,15 @@ KuduColumnSchema::KuduColumnSchema(const std::string &name,
                                    DataType type,
                                    bool is_nullable,
                                    const void* default_value,
-                                   KuduColumnStorageAttributes attributes) {
+                                   KuduColumnStorageAttributes attributes,
+                                   KuduColumnTypeAttributes type_attributes) {
   ColumnStorageAttributes attr_private;
   attr_private.encoding = ToInternalEncodingType(attributes.encoding());
   attr_private.compression = ToInternalCompressionType(attributes.compression());
-  col_ = new ColumnSchema(name, ToInternalDataType(type), is_nullable,
-                          default_value, default_value, attr_private);
+  ColumnTypeAttributes type_attr_private(type_attributes.precision(),
+                                         type_attributes.scale());
+  col_ = new ColumnSchema(name, ToInternalDataType(type, type_attributes), is_nullable,
+                          default_value, default_value, attr_private, type_attr_private);
 }
 
 KuduColumnSchema::KuduColumnSchema(const KuduColumnSchema& other)
@@ -449,6 +517,11 @@ KuduColumnSchema::DataType KuduColumnSchema::type() const {
   return FromInternalDataType(DCHECK_NOTNULL(col_)->type_info()->type());
 }
 
+KuduColumnTypeAttributes KuduColumnSchema::type_attributes() const {
+  ColumnTypeAttributes type_attributes = DCHECK_NOTNULL(col_)->type_attributes();
+  return KuduColumnTypeAttributes(type_attributes.precision, type_attributes.scale);
+}
+
 
 ////////////////////////////////////////////////////////////
 // KuduSchema
@@ -505,9 +578,11 @@ KuduColumnSchema KuduSchema::Column(size_t idx) const {
   ColumnSchema col(schema_->column(idx));
   KuduColumnStorageAttributes attrs(FromInternalEncodingType(col.attributes().encoding),
                                     FromInternalCompressionType(col.attributes().compression));
+  KuduColumnTypeAttributes type_attrs(col.type_attributes().precision,
+                                      col.type_attributes().scale);
   return KuduColumnSchema(col.name(), FromInternalDataType(col.type_info()->type()),
                           col.is_nullable(), col.read_default_value(),
-                          attrs);
+                          attrs, type_attrs);
 }
 
 KuduPartialRow* KuduSchema::NewRow() const {
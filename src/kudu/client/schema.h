@@ -46,6 +46,7 @@ class WriteRpc;
 } // namespace internal
 
 class KuduClient;
+class KuduColumnStatistics;
 class KuduSchema;
 class KuduSchemaBuilder;
 class KuduWriteOperation;
@@ -61,6 +62,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     RLE = 4,
     DICT_ENCODING = 5,
     BIT_SHUFFLE = 6,
+    DELTA_ENCODING = 7,
 
     /// @deprecated GROUP_VARINT is not supported for valid types, and
     /// will fall back to another encoding on the server side.
@@ -74,6 +76,7 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
     SNAPPY = 2,
     LZ4 = 3,
     ZLIB = 4,
+    ZSTD = 5,
   };
 
 
@@ -117,6 +120,44 @@ class KUDU_EXPORT KuduColumnStorageAttributes {
   int32_t block_size_;
 };
 
+/// @brief Representation of column type attributes.
+///
+/// The precision and the scale of a DECIMAL column: the number of digits
+/// of its values, and how many of those follow the decimal point.
+class KUDU_EXPORT KuduColumnTypeAttributes {
+ public:
+  KuduColumnTypeAttributes()
+      : precision_(0),
+        scale_(0) {
+  }
+
+  /// @param [in] precision
+  ///   The precision of a decimal column.
+  /// @param [in] scale
+  ///   The scale of a decimal column.
+  KuduColumnTypeAttributes(int8_t precision, int8_t scale)
+      : precision_(precision),
+        scale_(scale) {
+  }
+
+  /// @return Precision for the column type.
+  int8_t precision() const {
+    return precision_;
+  }
+
+  /// @return Scale for the column type.
+  int8_t scale() const {
+    return scale_;
+  }
+
+  /// @return String representation of the type attributes.
+  std::string ToString() const;
+
+ private:
+  int8_t precision_;
+  int8_t scale_;
+};
+
 /// @brief Representation of the column schema.
 class KUDU_EXPORT KuduColumnSchema {
  public:
@@ -132,6 +173,7 @@ class KUDU_EXPORT KuduColumnSchema {
     DOUBLE = 7,
     BINARY = 8,
     UNIXTIME_MICROS = 9,
+    DECIMAL = 10,
     TIMESTAMP = UNIXTIME_MICROS //!< deprecated, use UNIXTIME_MICROS
   };
 
@@ -156,11 +198,14 @@ class KUDU_EXPORT KuduColumnSchema {
   ///   Default value for the column.
   /// @param [in] attributes
   ///   Column storage attributes.
+  /// @param [in] type_attributes
+  ///   Column type attributes, only relevant to DECIMAL columns.
   KuduColumnSchema(const std::string &name,
                    DataType type,
                    bool is_nullable = false,
                    const void* default_value = NULL,
-                   KuduColumnStorageAttributes attributes = KuduColumnStorageAttributes())
+                   KuduColumnStorageAttributes attributes = KuduColumnStorageAttributes(),
+                   KuduColumnTypeAttributes type_attributes = KuduColumnTypeAttributes())
       ATTRIBUTE_DEPRECATED("use KuduSchemaBuilder instead");
 
   /// Construct KuduColumnSchema object as a copy of another object.
@@ -203,6 +248,9 @@ class KUDU_EXPORT KuduColumnSchema {
 
   /// @return @c true iff the column schema has the nullable attribute set.
   bool is_nullable() const;
+
+  /// @return Type attributes of the column schema.
+  KuduColumnTypeAttributes type_attributes() const;
   ///@}
 
  private:
@@ -315,6 +363,30 @@ class KUDU_EXPORT KuduColumnSpec {
   ///   The data type to set.
   /// @return Pointer to the modified object.
   KuduColumnSpec* Type(KuduColumnSchema::DataType type);
+
+  /// Set the precision of a DECIMAL column, the total number of digits
+  /// of its values, between 1 and 38.
+  ///
+  /// A DECIMAL column must have a precision. Values with up to 9 digits
+  /// are stored in 4 bytes, with up to 18 in 8 bytes and in 16 bytes
+  /// otherwise.
+  ///
+  /// @note Column precision may not be changed once a table is created.
+  ///
+  /// @param [in] precision
+  ///   The precision to set.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* Precision(int8_t precision);
+
+  /// Set the scale of a DECIMAL column, the number of digits of its values
+  /// after the decimal point, between 0 (the default) and the precision.
+  ///
+  /// @note Column scale may not be changed once a table is created.
+  ///
+  /// @param [in] scale
+  ///   The scale to set.
+  /// @return Pointer to the modified object.
+  KuduColumnSpec* Scale(int8_t scale);
   ///@}
 
   /// @name Operations only relevant for Alter Table
@@ -485,6 +557,7 @@ class KUDU_EXPORT KuduSchema {
 
  private:
   friend class KuduClient;
+  friend class KuduColumnStatistics;
   friend class KuduScanner;
   friend class KuduScanToken;
   friend class KuduScanTokenBuilder;
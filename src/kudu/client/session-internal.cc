@@ -17,10 +17,12 @@
 
 #include "kudu/client/session-internal.h"
 
+#include <algorithm>
 #include <mutex>
 
 #include "kudu/client/batcher.h"
 #include "kudu/client/callbacks.h"
+#include "kudu/client/client-internal.h"
 #include "kudu/client/error_collector.h"
 #include "kudu/client/shared_ptr.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -38,6 +40,17 @@ using internal::ErrorCollector;
 
 using sp::shared_ptr;
 using sp::weak_ptr;
+using std::string;
+
+// Weight of the latest sample in the smoothed per-tablet server statistics.
+static const double kTabletServerStatsWeight = 0.25;
+
+// Statistics of tablet servers which weren't written to for longer than this
+// no longer affect adaptive flushing.
+static const int kTabletServerStatsMaxAgeSecs = 10;
+
+// Adaptive flushing doesn't shrink the flush watermark below this size.
+static const int64_t kMinAdaptiveFlushWatermark = 16 * 1024;
 
 
 KuduSession::Data::Data(shared_ptr<KuduClient> client,
@@ -46,6 +59,7 @@ KuduSession::Data::Data(shared_ptr<KuduClient> client,
       messenger_(std::move(messenger)),
       error_collector_(new ErrorCollector()),
       external_consistency_mode_(CLIENT_PROPAGATED),
+      multi_tablet_writes_(false),
       flush_interval_(MonoDelta::FromMilliseconds(1000)),
       flush_task_active_(false),
       flush_mode_(AUTO_FLUSH_SYNC),
@@ -55,6 +69,7 @@ KuduSession::Data::Data(shared_ptr<KuduClient> client,
       buffer_bytes_limit_(7 * 1024 * 1024),
       buffer_watermark_pct_(50),
       buffer_bytes_used_(0),
+      adaptive_flush_watermark_(0),
       buffer_pre_flush_enabled_(true) {
 }
 
@@ -65,10 +80,18 @@ void KuduSession::Data::Init(weak_ptr<KuduSession> session) {
 
 void KuduSession::Data::FlushFinished(Batcher* batcher) {
   const int64_t bytes_flushed = batcher->buffer_bytes_used();
+  const MonoTime flush_start_time = batcher->flush_start_time();
+  if (flush_start_time.Initialized()) {
+    RecordLatency("flush_latency_us", MonoTime::Now() - flush_start_time);
+  }
   {
     std::lock_guard<Mutex> l(mutex_);
     buffer_bytes_used_ -= bytes_flushed;
     --batchers_num_;
+    if (adaptive_flush_max_latency_.Initialized() &&
+        flush_mode_ == AUTO_FLUSH_BACKGROUND) {
+      AdaptFlushUnlocked(bytes_flushed);
+    }
     // The logic of KuduSession::ApplyWriteOp() needs to know
     // if total number of batchers or buffer byte count decreases.
     // There can be a thread waiting on the corresponding condition
@@ -109,6 +132,20 @@ Status KuduSession::Data::SetExternalConsistencyMode(
   return Status::OK();
 }
 
+Status KuduSession::Data::SetMultiTabletWrites(bool enabled) {
+  std::lock_guard<Mutex> l(mutex_);
+  if (HasPendingOperationsUnlocked()) {
+    // NOTE: this is an artificial restriction.
+    return Status::IllegalState(
+        "Cannot change multi-tablet writes when writes are buffered");
+  }
+  // Thread-safety note: the multi_tablet_writes_ is not supposed
+  // to be accessed or modified from any other thread:
+  // no thread-safety is assumed for the kudu::KuduSession interface.
+  multi_tablet_writes_ = enabled;
+  return Status::OK();
+}
+
 Status KuduSession::Data::SetFlushMode(FlushMode mode) {
   {
     std::lock_guard<Mutex> l(mutex_);
@@ -210,6 +247,136 @@ Status KuduSession::Data::SetMaxBatchersNum(unsigned int max_num) {
   return Status::OK();
 }
 
+Status KuduSession::Data::SetAdaptiveFlush(unsigned int max_latency_ms) {
+  std::lock_guard<Mutex> l(mutex_);
+  if (HasPendingOperationsUnlocked()) {
+    // NOTE: this is an artificial restriction.
+    return Status::IllegalState(
+        "Cannot change adaptive flushing when writes are buffered.");
+  }
+  // Thread-safety note: the adaptive flush settings are updated by the
+  // threads completing flushes, so they should be modified under protection.
+  ts_write_stats_.clear();
+  if (max_latency_ms == 0) {
+    adaptive_flush_max_latency_ = MonoDelta();
+    return Status::OK();
+  }
+  adaptive_flush_max_latency_ = MonoDelta::FromMilliseconds(max_latency_ms);
+  // Start from the configured settings, which remain the upper limits.
+  adaptive_flush_watermark_ = buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
+  adaptive_flush_interval_ = flush_interval_;
+  SetWriteOpMetricUnlocked("adaptive_flush_watermark_bytes", adaptive_flush_watermark_);
+  SetWriteOpMetricUnlocked("adaptive_flush_interval_ms",
+                           adaptive_flush_interval_.ToMilliseconds());
+  return Status::OK();
+}
+
+void KuduSession::Data::WriteRpcFinished(const string& ts_uuid,
+                                         const MonoDelta& latency,
+                                         int64_t bytes) {
+  write_op_metrics_.Increment("write_rpcs", 1);
+  write_op_metrics_.Increment("write_rpc_bytes", bytes);
+  RecordLatency("write_rpc_latency_us." + ts_uuid, latency);
+
+  std::lock_guard<Mutex> l(mutex_);
+  if (!adaptive_flush_max_latency_.Initialized()) {
+    return;
+  }
+  const double latency_us = std::max<double>(latency.ToMicroseconds(), 1);
+  const double bytes_per_sec = bytes * 1e6 / latency_us;
+  const MonoTime now = MonoTime::Now();
+  auto it = ts_write_stats_.find(ts_uuid);
+  if (it == ts_write_stats_.end()) {
+    ts_write_stats_.emplace(ts_uuid, TabletServerWriteStats{ latency_us, bytes_per_sec, now });
+    return;
+  }
+  TabletServerWriteStats& stats = it->second;
+  stats.latency_us += kTabletServerStatsWeight * (latency_us - stats.latency_us);
+  stats.bytes_per_sec += kTabletServerStatsWeight * (bytes_per_sec - stats.bytes_per_sec);
+  stats.last_update = now;
+}
+
+int64_t KuduSession::Data::FlushWatermarkUnlocked() const {
+  mutex_.AssertAcquired();
+  const int64_t watermark = buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
+  if (adaptive_flush_max_latency_.Initialized()) {
+    return std::min(watermark, adaptive_flush_watermark_);
+  }
+  return watermark;
+}
+
+MonoDelta KuduSession::Data::FlushIntervalUnlocked() const {
+  mutex_.AssertAcquired();
+  if (adaptive_flush_max_latency_.Initialized() &&
+      adaptive_flush_interval_ < flush_interval_) {
+    return adaptive_flush_interval_;
+  }
+  return flush_interval_;
+}
+
+void KuduSession::Data::AdaptFlushUnlocked(int64_t bytes_flushed) {
+  mutex_.AssertAcquired();
+  // The slowest tablet server written to lately determines how long
+  // the flushed operations take to land.
+  const MonoTime now = MonoTime::Now();
+  double worst_latency_us = 0;
+  double worst_bytes_per_sec = 0;
+  for (const auto& e : ts_write_stats_) {
+    const TabletServerWriteStats& stats = e.second;
+    if ((now - stats.last_update).ToSeconds() > kTabletServerStatsMaxAgeSecs) {
+      continue;
+    }
+    if (stats.latency_us > worst_latency_us) {
+      worst_latency_us = stats.latency_us;
+      worst_bytes_per_sec = stats.bytes_per_sec;
+    }
+  }
+
+  const int64_t max_watermark = buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
+  const int64_t min_watermark = std::min(max_watermark, kMinAdaptiveFlushWatermark);
+  const double max_latency_us = adaptive_flush_max_latency_.ToMicroseconds();
+  if (worst_latency_us > max_latency_us) {
+    // Multiplicative decrease: smaller batches land sooner.
+    adaptive_flush_watermark_ = std::max(min_watermark, adaptive_flush_watermark_ / 2);
+  } else if (bytes_flushed * 4 >= adaptive_flush_watermark_ * 3) {
+    // Additive increase, but only if the watermark is what triggered the
+    // flush: growing it while the flushes are time-based would only let
+    // a later burst go out as one oversized batch.
+    adaptive_flush_watermark_ = std::min(max_watermark,
+                                         adaptive_flush_watermark_ + max_watermark / 16);
+  }
+  adaptive_flush_watermark_ = std::max(min_watermark,
+                                       std::min(max_watermark, adaptive_flush_watermark_));
+
+  // Operations wait for the time-based flush at most for the part of the
+  // latency bound not needed to write them out.
+  const int64_t interval_us = std::max<int64_t>(
+      1000, static_cast<int64_t>(max_latency_us - worst_latency_us));
+  adaptive_flush_interval_ = std::min(flush_interval_,
+                                      MonoDelta::FromMicroseconds(interval_us));
+
+  SetWriteOpMetricUnlocked("adaptive_flush_watermark_bytes", adaptive_flush_watermark_);
+  SetWriteOpMetricUnlocked("adaptive_flush_interval_ms",
+                           adaptive_flush_interval_.ToMilliseconds());
+  SetWriteOpMetricUnlocked("adaptive_flush_worst_ts_latency_us",
+                           static_cast<int64_t>(worst_latency_us));
+  SetWriteOpMetricUnlocked("adaptive_flush_worst_ts_bytes_per_sec",
+                           static_cast<int64_t>(worst_bytes_per_sec));
+}
+
+void KuduSession::Data::SetWriteOpMetricUnlocked(const string& name, int64_t value) {
+  mutex_.AssertAcquired();
+  // ResourceMetrics only has counters: since these gauges are only ever
+  // updated under mutex_, setting them by their difference is race-free.
+  write_op_metrics_.Increment(name, value - write_op_metrics_.GetMetric(name));
+}
+
+void KuduSession::Data::RecordLatency(const string& name, const MonoDelta& latency) {
+  const int64_t latency_us = latency.ToMicroseconds();
+  write_op_metrics_.RecordLatency(name, latency_us);
+  client_->data_->latency_metrics_.RecordLatency(name, latency_us);
+}
+
 void KuduSession::Data::SetTimeoutMillis(int timeout_ms) {
   if (timeout_ms < 0) {
     timeout_ms = 0;
@@ -338,9 +505,11 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
   // to get away with not protecting the flush_mode_ since it's read-only
   // access here as well, but TSAN does not like that.
   FlushMode flush_mode;
+  int64_t flush_watermark;
   {
     std::lock_guard<Mutex> l(mutex_);
     flush_mode = flush_mode_;
+    flush_watermark = FlushWatermarkUnlocked();
   }
 
   // A sanity check: before trying to validate against any of run-time metrics,
@@ -383,12 +552,16 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
       FlushCurrentBatcher(max_size - required_size + 1, nullptr);
     }
   }
+  MonoTime wait_start_time;
   {
     std::lock_guard<Mutex> l(mutex_);
     if (flush_mode == AUTO_FLUSH_BACKGROUND) {
       // In AUTO_FLUSH_BACKGROUND mode Apply() blocks if total would-be-used
       // buffer space is over the limit. Once amount of buffered data drops
       // below the limit, a blocking call to Apply() is unblocked.
+      if (buffer_bytes_used_ + required_size > max_size) {
+        wait_start_time = MonoTime::Now();
+      }
       while (buffer_bytes_used_ + required_size > max_size) {
         condition_.Wait();
       }
@@ -421,6 +594,7 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
       if (timeout_.Initialized()) {
         batcher->SetTimeout(timeout_);
       }
+      batcher->SetMultiTabletWrites(multi_tablet_writes_);
       batcher.swap(batcher_);
       ++batchers_num_;
     }
@@ -433,10 +607,11 @@ Status KuduSession::Data::ApplyWriteOp(KuduWriteOperation* write_op) {
     // Finally, update the buffer space usage.
     buffer_bytes_used_ += required_size;
   }
+  if (wait_start_time.Initialized()) {
+    RecordLatency("buffer_space_wait_latency_us", MonoTime::Now() - wait_start_time);
+  }
 
   if (flush_mode == AUTO_FLUSH_BACKGROUND) {
-    const size_t flush_watermark =
-        buffer_bytes_limit_ * buffer_watermark_pct_ / 100;
     // In AUTO_FLUSH_BACKGROUND mode it's necessary to flush the newly added
     // operations if the flush watermark is reached. The current batcher is
     // the exclusive and the only container for the newly added operations.
@@ -483,7 +658,7 @@ void KuduSession::Data::TimeBasedFlushTask(
       data->flush_task_active_ = false;
       return;
     }
-    max_batcher_age = data->flush_interval_;
+    max_batcher_age = data->FlushIntervalUnlocked();
   }
 
   // Let's measure the age of a batcher as the time elapsed from the moment
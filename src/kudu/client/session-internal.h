@@ -18,10 +18,14 @@
 #define KUDU_CLIENT_SESSION_INTERNAL_H
 
 #include <memory>
+#include <string>
+#include <unordered_map>
 
 #include "kudu/client/client.h"
+#include "kudu/client/resource_metrics.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/condition_variable.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
 
 namespace kudu {
@@ -73,6 +77,9 @@ class KuduSession::Data {
   // Set external consistency mode for the session.
   Status SetExternalConsistencyMode(KuduSession::ExternalConsistencyMode m);
 
+  // Set whether writes to tablets led by the same tablet server are batched.
+  Status SetMultiTabletWrites(bool enabled);
+
   // Set limit on buffer space consumed by buffered write operations.
   Status SetBufferBytesLimit(size_t size);
 
@@ -85,6 +92,16 @@ class KuduSession::Data {
   // Set the limit on maximum number of batchers with pending operations.
   Status SetMaxBatchersNum(unsigned int period_ms);
 
+  // Enable adaptive flushing with the specified bound on the latency of
+  // the buffered operations, or disable it if the bound is 0.
+  Status SetAdaptiveFlush(unsigned int max_latency_ms);
+
+  // Called by Batcher when a write RPC of 'bytes' worth of operations
+  // to the tablet server 'ts_uuid' succeeded after 'latency'.
+  void WriteRpcFinished(const std::string& ts_uuid,
+                        const MonoDelta& latency,
+                        int64_t bytes);
+
   // Set timeout for write operations, in milliseconds.
   void SetTimeoutMillis(int timeout_ms);
 
@@ -139,6 +156,26 @@ class KuduSession::Data {
                                  sp::weak_ptr<KuduSession> weak_session,
                                  bool do_startup_check);
 
+  // The watermark and the interval at which the current batcher is flushed
+  // in AUTO_FLUSH_BACKGROUND mode. Unless adaptive flushing is enabled,
+  // these are just the configured ones.
+  int64_t FlushWatermarkUnlocked() const;
+  MonoDelta FlushIntervalUnlocked() const;
+
+  // Adjust the adaptive flush watermark and interval upon the completion
+  // of the flush of a batcher of 'bytes_flushed' bytes: the watermark grows
+  // additively while the slowest tablet server written to stays within
+  // the latency bound, and is halved otherwise. The interval leaves room in
+  // the bound for the slowest tablet server's write RPCs.
+  void AdaptFlushUnlocked(int64_t bytes_flushed);
+
+  // Set the value of the gauge-like metric 'name' in write_op_metrics_.
+  void SetWriteOpMetricUnlocked(const std::string& name, int64_t value);
+
+  // Record 'latency' in the latency histogram 'name' of both the session's
+  // write_op_metrics_ and the client's latency metrics.
+  void RecordLatency(const std::string& name, const MonoDelta& latency);
+
   // Get the total size of pending (i.e. both freshly added and
   // in process of being flushed) operations. This method is used by tests only.
   int64_t GetPendingOperationsSizeForTests() const;
@@ -172,6 +209,9 @@ class KuduSession::Data {
 
   kudu::client::KuduSession::ExternalConsistencyMode external_consistency_mode_;
 
+  // Whether writes to tablets led by the same tablet server are batched.
+  bool multi_tablet_writes_;
+
   // Timeout for the next batch.
   MonoDelta timeout_;
 
@@ -229,6 +269,27 @@ class KuduSession::Data {
   // The total number of bytes used by buffered write operations.
   int64_t buffer_bytes_used_;  // protected by mutex_
 
+  // The bound on the latency of buffered operations which adaptive flushing
+  // works to; uninitialized if adaptive flushing is disabled.
+  MonoDelta adaptive_flush_max_latency_;  // protected by mutex_
+
+  // The flush watermark and interval currently chosen by adaptive flushing.
+  int64_t adaptive_flush_watermark_;  // protected by mutex_
+  MonoDelta adaptive_flush_interval_;  // protected by mutex_
+
+  // Smoothed observations of the write RPCs to a tablet server.
+  struct TabletServerWriteStats {
+    double latency_us;
+    double bytes_per_sec;
+    MonoTime last_update;
+  };
+  // Keyed by the permanent uuid of the tablet server.
+  std::unordered_map<std::string, TabletServerWriteStats> ts_write_stats_;  // protected by mutex_
+
+  // Counters of the session's write RPCs, and the current decisions of
+  // adaptive flushing.
+  ResourceMetrics write_op_metrics_;
+
  private:
   FRIEND_TEST(ClientTest, TestAutoFlushBackgroundApplyBlocks);
   FRIEND_TEST(ClientTest, TestAutoFlushBackgroundAndErrorCollector);
@@ -19,6 +19,7 @@
 
 #include <string>
 
+#include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/util/slice.h"
@@ -33,26 +34,31 @@ class KuduValue::Data {
     INT,
     FLOAT,
     DOUBLE,
-    SLICE
+    SLICE,
+    DECIMAL
   };
   Type type_;
   union {
     int64_t int_val_;
     float float_val_;
     double double_val_;
+    int128_t decimal_val_;
   };
   Slice slice_val_;
+  int8_t scale_;
 
   // Check that this value can be converted to the given datatype 't',
   // and return a pointer to the underlying value in '*val_void'.
   //
   // 'col_name' is used to generate reasonable error messages in the case
-  // that the type cannot be coerced.
+  // that the type cannot be coerced. 'type_attributes' are those of the
+  // column, which only matter to the DECIMAL types.
   //
   // The returned pointer in *val_void is only guaranteed to live as long
   // as this KuduValue object.
   Status CheckTypeAndGetPointer(const std::string& col_name,
                                 DataType t,
+                                ColumnTypeAttributes type_attributes,
                                 void** val_void);
 
  private:
@@ -71,6 +77,13 @@ class KuduValue::Data {
   Status CheckAndPointToInt(const std::string& col_name,
                             size_t int_size, void** val_void);
 
+  // Check that this value is a decimal constant with the scale of the column
+  // and within the range of its precision, and set *val_void to point to it
+  // if so.
+  Status CheckAndPointToDecimal(const std::string& col_name,
+                                ColumnTypeAttributes type_attributes,
+                                void** val_void);
+
   // Check that this value is a string constant, and set *val_void to
   // point to it if so.
   Status CheckAndPointToString(const std::string& col_name,
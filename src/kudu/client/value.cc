@@ -17,6 +17,7 @@
 
 #include "kudu/client/value.h"
 #include "kudu/client/value-internal.h"
+#include "kudu/common/decimal_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include <string>
 
@@ -47,6 +48,8 @@ KuduValue* KuduValue::Clone() const {
       return KuduValue::FromFloat(data_->float_val_);
     case Data::SLICE:
       return KuduValue::CopyString(data_->slice_val_);
+    case Data::DECIMAL:
+      return KuduValue::FromDecimal(data_->decimal_val_, data_->scale_);
   }
   LOG(FATAL);
 }
@@ -84,6 +87,15 @@ KuduValue* KuduValue::FromBool(bool v) {
   return new KuduValue(d);
 }
 
+KuduValue* KuduValue::FromDecimal(int128_t dv, int8_t scale) {
+  auto d = new Data;
+  d->type_ = Data::DECIMAL;
+  d->decimal_val_ = dv;
+  d->scale_ = scale;
+
+  return new KuduValue(d);
+}
+
 KuduValue* KuduValue::CopyString(Slice s) {
   auto copy = new uint8_t[s.size()];
   memcpy(copy, s.data(), s.size());
@@ -97,7 +109,11 @@ KuduValue* KuduValue::CopyString(Slice s) {
 
 Status KuduValue::Data::CheckTypeAndGetPointer(const string& col_name,
                                                DataType t,
+                                               ColumnTypeAttributes type_attributes,
                                                void** val_void) {
+  if (IsDecimalType(t)) {
+    return CheckAndPointToDecimal(col_name, type_attributes, val_void);
+  }
   const TypeInfo* ti = GetTypeInfo(t);
   switch (ti->physical_type()) {
     case kudu::INT8:
@@ -181,6 +197,33 @@ Status KuduValue::Data::CheckAndPointToInt(const string& col_name,
   return Status::OK();
 }
 
+Status KuduValue::Data::CheckAndPointToDecimal(const string& col_name,
+                                              ColumnTypeAttributes type_attributes,
+                                              void** val_void) {
+  RETURN_NOT_OK(CheckValType(col_name, KuduValue::Data::DECIMAL, "decimal"));
+  if (type_attributes.precision < kMinDecimalPrecision ||
+      type_attributes.precision > kMaxDecimal128Precision) {
+    return Status::InvalidArgument(
+        Substitute("no valid precision for decimal column '$0'", col_name));
+  }
+  if (scale_ != type_attributes.scale) {
+    return Status::InvalidArgument(
+        Substitute("value scale $0 does not match the scale $1 of decimal column '$2'",
+                   scale_, type_attributes.scale, col_name));
+  }
+  if (decimal_val_ < MinUnscaledDecimal(type_attributes.precision) ||
+      decimal_val_ > MaxUnscaledDecimal(type_attributes.precision)) {
+    return Status::InvalidArgument(
+        Substitute("value $0 out of range for decimal column '$1' of precision $2",
+                   DecimalToString(decimal_val_, scale_), col_name,
+                   type_attributes.precision));
+  }
+  // As for the narrower integers, the value of a DECIMAL32 or DECIMAL64 cell
+  // is the low-order bytes of 'decimal_val_' on little-endian machines.
+  *val_void = &decimal_val_;
+  return Status::OK();
+}
+
 Status KuduValue::Data::CheckAndPointToString(const string& col_name,
                                               void** val_void) {
   RETURN_NOT_OK(CheckValType(col_name, KuduValue::Data::SLICE, "string"));
@@ -23,6 +23,7 @@
 #else
 #include "kudu/client/stubs.h"
 #endif
+#include "kudu/util/int128.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/kudu_export.h"
 
@@ -50,6 +51,18 @@ class KUDU_EXPORT KuduValue {
   static KuduValue* FromBool(bool b);
   ///@}
 
+  /// Construct a decimal KuduValue from its unscaled value and scale.
+  ///
+  /// For example, 123.45 has the unscaled value 12345 and a scale of 2.
+  ///
+  /// @param [in] dv
+  ///   The unscaled value.
+  /// @param [in] scale
+  ///   The number of digits of the value after the decimal point. It must
+  ///   be the scale of the column the value is used for.
+  /// @return A new KuduValue object.
+  static KuduValue* FromDecimal(int128_t dv, int8_t scale);
+
   /// Construct a KuduValue by copying the value of the given Slice.
   ///
   /// @param [in] s
@@ -61,6 +74,7 @@ class KUDU_EXPORT KuduValue {
  private:
   friend class ComparisonPredicateData;
   friend class InListPredicateData;
+  friend class KuduBloomFilter;
   friend class KuduColumnSpec;
 
   class KUDU_NO_EXPORT Data;
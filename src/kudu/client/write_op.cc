@@ -17,8 +17,11 @@
 
 #include "kudu/client/write_op.h"
 
+#include <utility>
+
 #include "kudu/client/client.h"
 #include "kudu/common/encoded_key.h"
+#include "kudu/common/partial_row_arena.h"
 #include "kudu/common/row.h"
 #include "kudu/common/wire_protocol.pb.h"
 
@@ -44,6 +47,12 @@ KuduWriteOperation::KuduWriteOperation(const shared_ptr<KuduTable>& table)
     row_(table->schema().schema_),
     size_in_buffer_(0) {}
 
+KuduWriteOperation::KuduWriteOperation(const shared_ptr<KuduTable>& table,
+                                       PartialRowArena* arena)
+  : table_(table),
+    row_(table->schema().schema_, arena),
+    size_in_buffer_(0) {}
+
 KuduWriteOperation::~KuduWriteOperation() {}
 
 EncodedKey* KuduWriteOperation::CreateKey() const {
@@ -92,6 +101,10 @@ KuduInsert::KuduInsert(const shared_ptr<KuduTable>& table)
   : KuduWriteOperation(table) {
 }
 
+KuduInsert::KuduInsert(const shared_ptr<KuduTable>& table, PartialRowArena* arena)
+  : KuduWriteOperation(table, arena) {
+}
+
 KuduInsert::~KuduInsert() {}
 
 // Update -----------------------------------------------------------------------
@@ -100,6 +113,10 @@ KuduUpdate::KuduUpdate(const shared_ptr<KuduTable>& table)
   : KuduWriteOperation(table) {
 }
 
+KuduUpdate::KuduUpdate(const shared_ptr<KuduTable>& table, PartialRowArena* arena)
+  : KuduWriteOperation(table, arena) {
+}
+
 KuduUpdate::~KuduUpdate() {}
 
 // Delete -----------------------------------------------------------------------
@@ -108,6 +125,10 @@ KuduDelete::KuduDelete(const shared_ptr<KuduTable>& table)
   : KuduWriteOperation(table) {
 }
 
+KuduDelete::KuduDelete(const shared_ptr<KuduTable>& table, PartialRowArena* arena)
+  : KuduWriteOperation(table, arena) {
+}
+
 KuduDelete::~KuduDelete() {}
 
 // Upsert -----------------------------------------------------------------------
@@ -116,8 +137,52 @@ KuduUpsert::KuduUpsert(const shared_ptr<KuduTable>& table)
   : KuduWriteOperation(table) {
 }
 
+KuduUpsert::KuduUpsert(const shared_ptr<KuduTable>& table, PartialRowArena* arena)
+  : KuduWriteOperation(table, arena) {
+}
+
 KuduUpsert::~KuduUpsert() {}
 
 
+// WriteOperationBuilder -------------------------------------------------------
+
+class KuduWriteOperationBuilder::Data {
+ public:
+  explicit Data(shared_ptr<KuduTable> table)
+      : table_(std::move(table)),
+        arena_(new PartialRowArena()) {
+  }
+
+  const shared_ptr<KuduTable> table_;
+  const scoped_refptr<PartialRowArena> arena_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Data);
+};
+
+KuduWriteOperationBuilder::KuduWriteOperationBuilder(const shared_ptr<KuduTable>& table)
+  : data_(new Data(table)) {
+}
+
+KuduWriteOperationBuilder::~KuduWriteOperationBuilder() {
+  delete data_;
+}
+
+KuduInsert* KuduWriteOperationBuilder::NewInsert() {
+  return new KuduInsert(data_->table_, data_->arena_.get());
+}
+
+KuduUpsert* KuduWriteOperationBuilder::NewUpsert() {
+  return new KuduUpsert(data_->table_, data_->arena_.get());
+}
+
+KuduUpdate* KuduWriteOperationBuilder::NewUpdate() {
+  return new KuduUpdate(data_->table_, data_->arena_.get());
+}
+
+KuduDelete* KuduWriteOperationBuilder::NewDelete() {
+  return new KuduDelete(data_->table_, data_->arena_.get());
+}
+
 } // namespace client
 } // namespace kudu
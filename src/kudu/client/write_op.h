@@ -89,6 +89,16 @@ class KUDU_EXPORT KuduWriteOperation {
   ///   Smart pointer to the target table.
   explicit KuduWriteOperation(const sp::shared_ptr<KuduTable>& table);
 
+  /// @internal
+  /// Create a write operation on the specified table, whose row is allocated
+  /// from the specified arena.
+  ///
+  /// @param [in] table
+  ///   Smart pointer to the target table.
+  /// @param [in] arena
+  ///   The arena to allocate the row and the copies of its strings from.
+  KuduWriteOperation(const sp::shared_ptr<KuduTable>& table, PartialRowArena* arena);
+
   /// @return Type of the operation.
   virtual Type type() const = 0;
 
@@ -148,7 +158,9 @@ class KUDU_EXPORT KuduInsert : public KuduWriteOperation {
 
  private:
   friend class KuduTable;
+  friend class KuduWriteOperationBuilder;
   explicit KuduInsert(const sp::shared_ptr<KuduTable>& table);
+  KuduInsert(const sp::shared_ptr<KuduTable>& table, PartialRowArena* arena);
 };
 
 /// @brief A single row upsert to be sent to the cluster.
@@ -173,7 +185,9 @@ class KUDU_EXPORT KuduUpsert : public KuduWriteOperation {
 
  private:
   friend class KuduTable;
+  friend class KuduWriteOperationBuilder;
   explicit KuduUpsert(const sp::shared_ptr<KuduTable>& table);
+  KuduUpsert(const sp::shared_ptr<KuduTable>& table, PartialRowArena* arena);
 };
 
 
@@ -200,7 +214,9 @@ class KUDU_EXPORT KuduUpdate : public KuduWriteOperation {
 
  private:
   friend class KuduTable;
+  friend class KuduWriteOperationBuilder;
   explicit KuduUpdate(const sp::shared_ptr<KuduTable>& table);
+  KuduUpdate(const sp::shared_ptr<KuduTable>& table, PartialRowArena* arena);
 };
 
 
@@ -227,7 +243,73 @@ class KUDU_EXPORT KuduDelete : public KuduWriteOperation {
 
  private:
   friend class KuduTable;
+  friend class KuduWriteOperationBuilder;
   explicit KuduDelete(const sp::shared_ptr<KuduTable>& table);
+  KuduDelete(const sp::shared_ptr<KuduTable>& table, PartialRowArena* arena);
+};
+
+/// @brief A builder of many write operations on a table, whose rows share
+///   their memory.
+///
+/// Every operation created with KuduTable::NewInsert() and the like allocates
+/// its row, as well as a copy of every string set with the
+/// KuduPartialRow::Set*Copy() methods, on its own. The operations created by
+/// a builder instead carve their rows and string copies out of large blocks
+/// of memory shared by all of them, which takes several allocations off of
+/// every row when ingesting many of them.
+///
+/// The operations are otherwise used like any other: each one is owned by
+/// the caller until it's passed to KuduSession::Apply(). The shared memory is
+/// released once the builder and all of the operations it created were
+/// destroyed, so a builder is meant to build a batch of rows, rather than to
+/// outlive many batches.
+///
+/// Typical usage example:
+/// @code
+///   KuduWriteOperationBuilder builder(table);
+///   for (int i = 0; i < 1000; i++) {
+///     KuduInsert* insert = builder.NewInsert();
+///     KUDU_CHECK_OK(insert->mutable_row()->SetInt32("key", i));
+///     KUDU_CHECK_OK(insert->mutable_row()->SetStringCopy("foo", "bar"));
+///     KUDU_CHECK_OK(session->Apply(insert));
+///   }
+/// @endcode
+///
+/// @note This class is not thread-safe.
+class KUDU_EXPORT KuduWriteOperationBuilder {
+ public:
+  /// @param [in] table
+  ///   The table to write to.
+  explicit KuduWriteOperationBuilder(const sp::shared_ptr<KuduTable>& table);
+  ~KuduWriteOperationBuilder();
+
+  /// @return New @c INSERT operation for the table. It is the caller's
+  ///   responsibility to free the result, unless it is passed to
+  ///   KuduSession::Apply().
+  KuduInsert* NewInsert();
+
+  /// @return New @c UPSERT operation for the table. It is the caller's
+  ///   responsibility to free the result, unless it is passed to
+  ///   KuduSession::Apply().
+  KuduUpsert* NewUpsert();
+
+  /// @return New @c UPDATE operation for the table. It is the caller's
+  ///   responsibility to free the result, unless it is passed to
+  ///   KuduSession::Apply().
+  KuduUpdate* NewUpdate();
+
+  /// @return New @c DELETE operation for the table. It is the caller's
+  ///   responsibility to free the result, unless it is passed to
+  ///   KuduSession::Apply().
+  KuduDelete* NewDelete();
+
+ private:
+  class KUDU_NO_EXPORT Data;
+
+  // Owned.
+  Data* data_;
+
+  DISALLOW_COPY_AND_ASSIGN(KuduWriteOperationBuilder);
 };
 
 } // namespace client
@@ -0,0 +1,286 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/codegen/change_list_applier.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/DerivedTypes.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+#include <llvm/Support/Casting.h>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/module_builder.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class LLVMContext;
+} // namespace llvm
+
+using llvm::Argument;
+using llvm::BasicBlock;
+using llvm::Function;
+using llvm::FunctionType;
+using llvm::LLVMContext;
+using llvm::PointerType;
+using llvm::SwitchInst;
+using llvm::Type;
+using llvm::Value;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+DECLARE_bool(codegen_dump_functions);
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// Generates the function which applies a single decoded column update, of
+// the form:
+// i32(i32 col_id, i1 is_null, i8* value, i64 size, i64 col_idx,
+//     ColumnBlock* dst, i64 row_idx, Arena* arena)
+// whose type is that of the last parameter of 'apply_change_list'.
+Function* MakeApplyColumnUpdate(const string& name,
+                                ModuleBuilder* mbuilder,
+                                const Schema& projection,
+                                Function* apply_change_list) {
+  // Get the IRBuilder
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  // Take the type from the precompiled function which calls this one, so
+  // that both agree on it exactly.
+  FunctionType* apply_type = apply_change_list->getFunctionType();
+  FunctionType* fty = llvm::cast<FunctionType>(
+      llvm::cast<PointerType>(apply_type->getParamType(
+          apply_type->getNumParams() - 1))->getElementType());
+  Function* f = mbuilder->Create(fty, name);
+  Function* apply_update = mbuilder->GetFunction("_PrecompiledApplyUpdate");
+
+  // Get the function's Arguments
+  Function::arg_iterator it = f->arg_begin();
+  Argument* col_id = &*it++;
+  Argument* is_null = &*it++;
+  Argument* value = &*it++;
+  Argument* size = &*it++;
+  Argument* col_idx = &*it++;
+  Argument* dst = &*it++;
+  Argument* row_idx = &*it++;
+  Argument* arena = &*it++;
+  DCHECK(it == f->arg_end());
+
+  // Give names to the arguments for debugging IR.
+  col_id->setName("col_id");
+  is_null->setName("is_null");
+  value->setName("value");
+  size->setName("size");
+  col_idx->setName("col_idx");
+  dst->setName("dst");
+  row_idx->setName("row_idx");
+  arena->setName("arena");
+
+  // Apply function in IR (note: values in angle brackets are
+  // constants whose values are determined right now, at JIT time).
+  //
+  // define i32 @name(i32 %col_id, i1 %is_null, i8* %value, i64 %size,
+  //                  i64 %col_idx, ColumnBlock* %dst, i64 %row_idx, Arena* %arena)
+  // entry:
+  //   switch i32 %col_id, label %skip [
+  //     <for each projected column i> i32 <column id>, label %col<i> ]
+  // <for each projected column i>
+  //   col<i>:
+  //     %match<i> = icmp eq i64 %col_idx, <i>
+  //     br i1 %match<i>, label %apply<i>, label %skip
+  //   apply<i>:
+  //     %ret<i> = call i32 @_PrecompiledApplyUpdate(ColumnBlock* %dst, i64 %row_idx,
+  //       i1 %is_null, i8* %value, i64 %size, i64 <cell size>, i1 <nullable>,
+  //       i1 <is binary>, Arena* %arena)
+  //     ret i32 %ret<i>
+  // <end implicit for each>
+  // skip:
+  //   ret i32 0
+  BasicBlock* entry = BasicBlock::Create(context, "entry", f);
+  BasicBlock* skip = BasicBlock::Create(context, "skip", f);
+  builder->SetInsertPoint(entry);
+  SwitchInst* sw = builder->CreateSwitch(col_id, skip, projection.num_columns());
+  for (size_t i = 0; i < projection.num_columns(); i++) {
+    const ColumnSchema& col = projection.column(i);
+    BasicBlock* col_block = BasicBlock::Create(context, StrCat("col", i), f);
+    BasicBlock* apply_block = BasicBlock::Create(context, StrCat("apply", i), f);
+    int32_t col_id_value = projection.column_id(i);
+    sw->addCase(builder->getInt32(col_id_value), col_block);
+
+    builder->SetInsertPoint(col_block);
+    Value* match = builder->CreateICmpEQ(col_idx, builder->getInt64(i));
+    match->setName(StrCat("match", i));
+    builder->CreateCondBr(match, apply_block, skip);
+
+    builder->SetInsertPoint(apply_block);
+    vector<Value*> args = {
+      dst, row_idx, is_null, value, size,
+      builder->getInt64(col.type_info()->size()),
+      builder->getInt1(col.is_nullable()),
+      builder->getInt1(col.type_info()->physical_type() == BINARY),
+      arena };
+    Value* ret = builder->CreateCall(apply_update, args);
+    ret->setName(StrCat("ret", i));
+    builder->CreateRet(ret);
+  }
+  builder->SetInsertPoint(skip);
+  builder->CreateRet(builder->getInt32(0));
+  return f;
+}
+
+// Generates the change list applier function of the form:
+// i32(i8* data, i64 size, i64 col_idx, ColumnBlock* dst, i64 row_idx, Arena* arena)
+// (see ChangeListApplierFunctions::ApplyFunction).
+Function* MakeApplier(const string& name,
+                      ModuleBuilder* mbuilder,
+                      const Schema& projection) {
+  // Get the IRBuilder
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  Function* apply_change_list = mbuilder->GetFunction("_PrecompiledApplyChangeList");
+  Function* apply_column_update = MakeApplyColumnUpdate(
+      StrCat(name, "ColumnUpdate"), mbuilder, projection, apply_change_list);
+
+  // The same parameters as the precompiled loop, but the last.
+  FunctionType* loop_type = apply_change_list->getFunctionType();
+  vector<Type*> argtypes(loop_type->param_begin(), loop_type->param_end() - 1);
+  FunctionType* fty = FunctionType::get(Type::getInt32Ty(context), argtypes, false);
+  Function* f = mbuilder->Create(fty, name);
+
+  // define i32 @name(i8* %data, i64 %size, i64 %col_idx, ColumnBlock* %dst,
+  //                  i64 %row_idx, Arena* %arena)
+  // entry:
+  //   %ret = call i32 @_PrecompiledApplyChangeList(<the same arguments>,
+  //     <@name ColumnUpdate>)
+  //   ret i32 %ret
+  //
+  // The precompiled loop is inlined, and then so is the column update
+  // function it calls through its constant pointer.
+  builder->SetInsertPoint(BasicBlock::Create(context, "entry", f));
+  vector<Value*> args;
+  for (Argument& arg : f->args()) {
+    args.push_back(&arg);
+  }
+  args.push_back(apply_column_update);
+  Value* ret = builder->CreateCall(apply_change_list, args);
+  ret->setName("ret");
+  builder->CreateRet(ret);
+
+  if (FLAGS_codegen_dump_functions) {
+    LOG(INFO) << "Dumping change list applier:";
+    apply_column_update->dump();
+    f->dump();
+  }
+  return f;
+}
+
+// Convenience method which appends to a faststring
+template<typename T>
+void AddNext(faststring* fs, const T& val) {
+  fs->append(&val, sizeof(T));
+}
+
+} // anonymous namespace
+
+ChangeListApplierFunctions::ChangeListApplierFunctions(const Schema& projection,
+                                                       ApplyFunction apply_f,
+                                                       unique_ptr<JITCodeOwner> owner)
+  : JITWrapper(std::move(owner)),
+    projection_(projection),
+    apply_f_(apply_f) {
+  CHECK(apply_f != nullptr)
+    << "Promise to compile apply function not fulfilled by ModuleBuilder";
+}
+
+Status ChangeListApplierFunctions::Create(const Schema& projection,
+                                          scoped_refptr<ChangeListApplierFunctions>* out,
+                                          llvm::TargetMachine** tm) {
+  if (!projection.has_column_ids()) {
+    return Status::InvalidArgument("projection has no column IDs", projection.ToString());
+  }
+
+  ModuleBuilder builder;
+  RETURN_NOT_OK(builder.Init());
+
+  Function* apply = MakeApplier("ChangeListApply", &builder, projection);
+
+  faststring key;
+  RETURN_NOT_OK(EncodeKey(projection, &key));
+  builder.SetObjectCacheKey(Slice(key));
+
+  // Have the ModuleBuilder accept a promise to compile the function
+  ApplyFunction apply_f;
+  builder.AddJITPromise(apply, &apply_f);
+
+  unique_ptr<JITCodeOwner> owner;
+  RETURN_NOT_OK(builder.Compile(&owner));
+
+  if (tm) {
+    *tm = builder.GetTargetMachine();
+  }
+  out->reset(new ChangeListApplierFunctions(projection, apply_f, std::move(owner)));
+  return Status::OK();
+}
+
+// Generates a key for a projection which is unique according to the
+// criteria defined in the CodeCache class' block comment. Names don't
+// affect the generated code, so the projection is encoded as follows, in
+// sequence.
+//
+// (4 bytes) unique type identifier for ChangeListApplierFunctions
+// (8 bytes) number, as unsigned long, of columns
+// for each column, in order:
+//   (4 bytes) column ID
+//   (4 bytes) column physical type
+//   (1 byte) whether the column is nullable
+//
+// Writes to 'out' upon success.
+Status ChangeListApplierFunctions::EncodeKey(const Schema& projection, faststring* out) {
+  if (!projection.has_column_ids()) {
+    return Status::InvalidArgument("projection has no column IDs", projection.ToString());
+  }
+  AddNext(out, JITWrapper::CHANGE_LIST_APPLIER);
+  AddNext(out, projection.num_columns());
+  for (size_t i = 0; i < projection.num_columns(); i++) {
+    AddNext(out, static_cast<int32_t>(projection.column_id(i)));
+    AddNext(out, projection.column(i).type_info()->physical_type());
+    AddNext(out, projection.column(i).is_nullable());
+  }
+  return Status::OK();
+}
+
+} // namespace codegen
+} // namespace kudu
@@ -0,0 +1,128 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CODEGEN_CHANGE_LIST_APPLIER_H
+#define KUDU_CODEGEN_CHANGE_LIST_APPLIER_H
+
+#include <memory>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/row_changelist.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
+namespace kudu {
+
+class Arena;
+class faststring;
+
+namespace codegen {
+
+// The JITWrapper for codegen::ChangeListApplier functions. Contains the
+// compiled function as well as the projection used to generate it.
+//
+// The generated function decodes the column updates of a RowChangeList and
+// writes those to a given projected column directly into its ColumnBlock.
+// The column IDs of the projection are compiled into a switch, and the cell
+// size, nullability and type of each column are baked in as constants. This
+// replaces the column ID lookups and the per-cell type dispatch done by
+// RowChangeListDecoder::ApplyToOneColumn().
+class ChangeListApplierFunctions : public JITWrapper {
+ public:
+  // Compiles the applier function for the given projection.
+  // Writes the llvm::TargetMachine* used to 'tm' (if not NULL)
+  // and the function to 'out' upon success.
+  //
+  // Returns InvalidArgument if the projection has no column IDs.
+  static Status Create(const Schema& projection,
+                       scoped_refptr<ChangeListApplierFunctions>* out,
+                       llvm::TargetMachine** tm = NULL);
+
+  const Schema& projection() const { return projection_; }
+
+  // The generated function takes the body of the change list and its size,
+  // the index of the projected column to apply, the destination column
+  // block, the index of the row in it and the arena to copy binary values
+  // to. It returns 0 upon success, and a non-zero value if the change list
+  // is malformed or the arena is out of memory.
+  typedef int32_t(*ApplyFunction)(const uint8_t*, uint64_t, uint64_t,
+                                  ColumnBlock*, uint64_t, Arena*);
+  ApplyFunction apply() const { return apply_f_; }
+
+  virtual Status EncodeOwnKey(faststring* out) OVERRIDE {
+    return EncodeKey(projection_, out);
+  }
+
+  static Status EncodeKey(const Schema& projection, faststring* out);
+
+ private:
+  ChangeListApplierFunctions(const Schema& projection, ApplyFunction apply_f,
+                             std::unique_ptr<JITCodeOwner> owner);
+
+  const Schema projection_;
+  const ApplyFunction apply_f_;
+};
+
+// Applies the updates of RowChangeLists to the columns of a projection using
+// a code-generated function. Behaves the same as
+// RowChangeListDecoder::ApplyToOneColumn() over 'projection', which must have
+// the same column IDs and types as the schema used to create 'functions'.
+class ChangeListApplier {
+ public:
+  ChangeListApplier(const Schema* projection,
+                    const scoped_refptr<ChangeListApplierFunctions>& functions)
+    : projection_(projection),
+      functions_(functions),
+      apply_f_(functions->apply()) {}
+
+  // Applies the updates to the projected column 'col_idx' made by the
+  // update or reinsert 'changelist' to the cell 'row_idx' of 'dst'.
+  //
+  // If the change list turns out to be malformed, or relocating a binary
+  // value fails, the change list is applied again by RowChangeListDecoder so
+  // as to return the same error.
+  Status ApplyToOneColumn(const RowChangeList& changelist, size_t row_idx,
+                          ColumnBlock* dst, size_t col_idx, Arena* arena) const {
+    const Slice& data = changelist.slice();
+    DCHECK(!data.empty());
+    if (PREDICT_TRUE(apply_f_(data.data() + 1, data.size() - 1, col_idx, dst,
+                              row_idx, arena) == 0)) {
+      return Status::OK();
+    }
+    RowChangeListDecoder decoder(changelist);
+    RETURN_NOT_OK(decoder.Init());
+    return decoder.ApplyToOneColumn(row_idx, dst, *projection_, col_idx, arena);
+  }
+
+ private:
+  const Schema* const projection_;
+  scoped_refptr<ChangeListApplierFunctions> functions_;
+  const ChangeListApplierFunctions::ApplyFunction apply_f_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChangeListApplier);
+};
+
+} // namespace codegen
+} // namespace kudu
+
+#endif
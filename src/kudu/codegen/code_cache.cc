@@ -17,18 +17,73 @@
 
 #include "kudu/codegen/code_cache.h"
 
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/ExecutionEngine/ObjectCache.h>
+#include <llvm/IR/Module.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+
 #include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/precompiled.ll.h"
+#include "kudu/gutil/endian.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/escaping.h"
+#include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/crc.h"
+#include "kudu/util/env.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/oid_generator.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/slice.h"
 
+DEFINE_string(codegen_object_cache_dir, "",
+              "Directory in which the object code of generated functions is "
+              "kept across restarts, so that a restarted server loads the code "
+              "it generated before instead of compiling it again. The code is "
+              "only reused by processes with the same Kudu and LLVM builds, on "
+              "the same kind of CPU. Disabled if empty.");
+TAG_FLAG(codegen_object_cache_dir, experimental);
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
 namespace kudu {
 namespace codegen {
 
 namespace {
 
+// The header of the files of the persistent object cache is:
+//
+// (8 bytes) magic
+// (4 bytes, little-endian) length of the key
+// (4 bytes, little-endian) length of the object code
+// (4 bytes, little-endian) CRC32C of the key and object code
+//
+// followed by the key and the object code.
+const char kObjectFileMagic[] = "kudujit1";
+const size_t kObjectFileMagicLen = 8;
+const size_t kObjectFileHeaderLen = kObjectFileMagicLen + 12;
+const char kObjectFileSuffix[] = ".o";
+
+// Prefix of the identifiers of the modules which may be cached.
+const char kModuleIdPrefix[] = "kudu-jit-";
+
 // The values we store in cache are actually just pointers to JITWrapper
 // objects. This returns the 'unwrapped' pointer from a cache value.
 JITWrapper* CacheValueToJITWrapper(Slice val) {
@@ -53,6 +108,184 @@ class CodeCache::EvictionCallback : public Cache::EvictionCallback {
   DISALLOW_COPY_AND_ASSIGN(EvictionCallback);
 };
 
+// The llvm::ObjectCache which the execution engines consult before
+// compiling a module, and notify after compiling one.
+//
+// NOTE: this subclasses an LLVM interface, so this file is built without
+// RTTI, as LLVM is (see CMakeLists.txt).
+class PersistentObjectCache::LLVMObjectCache : public llvm::ObjectCache {
+ public:
+  explicit LLVMObjectCache(PersistentObjectCache* cache) : cache_(cache) {}
+
+  void notifyObjectCompiled(const llvm::Module* module,
+                            llvm::MemoryBufferRef object) override {
+    const string& module_id = module->getModuleIdentifier();
+    if (!HasPrefixString(module_id, kModuleIdPrefix)) return;
+    WARN_NOT_OK(cache_->Save(module_id, Slice(object.getBufferStart(),
+                                              object.getBufferSize())),
+                "Could not save generated object code");
+  }
+
+  unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module* module) override {
+    const string& module_id = module->getModuleIdentifier();
+    if (!HasPrefixString(module_id, kModuleIdPrefix)) return nullptr;
+    return cache_->Load(module_id);
+  }
+
+ private:
+  PersistentObjectCache* const cache_;
+};
+
+PersistentObjectCache::PersistentObjectCache()
+  : dir_(FLAGS_codegen_object_cache_dir),
+    enabled_(false),
+    num_loaded_(0),
+    num_saved_(0) {
+  if (dir_.empty()) return;
+  Status s = Env::Default()->CreateDir(dir_);
+  if (!s.ok() && !s.IsAlreadyPresent()) {
+    LOG(WARNING) << "Could not create code generation object cache directory "
+                 << dir_ << ", not caching object code: " << s.ToString();
+    return;
+  }
+
+  // Describe everything the generated object code depends on besides the
+  // module itself. The precompiled IR is hashed rather than included, and
+  // the CPU features are sorted since they come out of a hash map.
+  vector<string> features;
+  llvm::StringMap<bool> cpu_features;
+  llvm::sys::getHostCPUFeatures(cpu_features);
+  for (const auto& entry : cpu_features) {
+    features.push_back(StrCat(entry.second ? "+" : "-", entry.first().str()));
+  }
+  std::sort(features.begin(), features.end());
+  char ir_hash[kFastToBufferSize];
+  FastHex64ToBuffer(util_hash::CityHash64(precompiled_ll_data, precompiled_ll_len),
+                    ir_hash);
+  environment_ = StrCat("llvm ", LLVM_VERSION_STRING,
+                        "; cpu ", llvm::sys::getHostCPUName().str(),
+                        "; features ", JoinStrings(features, ","),
+                        "; ir ", ir_hash,
+#ifdef NDEBUG
+                        "; release"
+#else
+                        "; debug"
+#endif
+                        );
+  llvm_cache_.reset(new LLVMObjectCache(this));
+  enabled_ = true;
+  LOG(INFO) << "Caching generated object code in " << dir_;
+}
+
+PersistentObjectCache::~PersistentObjectCache() {}
+
+llvm::ObjectCache* PersistentObjectCache::llvm_cache() {
+  DCHECK(enabled_);
+  return llvm_cache_.get();
+}
+
+string PersistentObjectCache::ModuleIdentifier(const Slice& key) {
+  return StrCat(kModuleIdPrefix, b2a_hex(reinterpret_cast<const char*>(key.data()), key.size()));
+}
+
+string PersistentObjectCache::ObjectPath(const string& module_id, string* file_key) const {
+  *file_key = StrCat(module_id, "; ", environment_);
+  char hash[kFastToBufferSize];
+  FastHex64ToBuffer(util_hash::CityHash64(file_key->data(), file_key->size()), hash);
+  return JoinPathSegments(dir_, StrCat(hash, kObjectFileSuffix));
+}
+
+bool PersistentObjectCache::Prefetch(const string& module_id) {
+  DCHECK(enabled_);
+  unique_ptr<llvm::MemoryBuffer> object = Load(module_id);
+  if (!object) return false;
+  std::lock_guard<simple_spinlock> l(lock_);
+  prefetched_[module_id] = std::move(object);
+  return true;
+}
+
+unique_ptr<llvm::MemoryBuffer> PersistentObjectCache::Load(const string& module_id) {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto it = prefetched_.find(module_id);
+    if (it != prefetched_.end()) {
+      unique_ptr<llvm::MemoryBuffer> object = std::move(it->second);
+      prefetched_.erase(it);
+      num_loaded_.Increment();
+      return object;
+    }
+  }
+
+  string key;
+  string path = ObjectPath(module_id, &key);
+  Env* env = Env::Default();
+  if (!env->FileExists(path)) return nullptr;
+  faststring contents;
+  Status s = ReadFileToString(env, path, &contents);
+  if (!s.ok()) {
+    LOG(WARNING) << "Could not read cached object code " << path << ": " << s.ToString();
+    return nullptr;
+  }
+
+  // Keys whose hashes collide and torn writes are both possible, so check
+  // that the file is complete, intact, and for this module.
+  if (contents.size() < kObjectFileHeaderLen ||
+      memcmp(contents.data(), kObjectFileMagic, kObjectFileMagicLen) != 0) {
+    LOG(WARNING) << "Ignoring cached object code " << path << ": bad header";
+    return nullptr;
+  }
+  const uint8_t* header = contents.data() + kObjectFileMagicLen;
+  uint32_t key_len = LittleEndian::Load32(header);
+  uint32_t object_len = LittleEndian::Load32(header + 4);
+  uint32_t crc = LittleEndian::Load32(header + 8);
+  const uint8_t* body = contents.data() + kObjectFileHeaderLen;
+  if (contents.size() != kObjectFileHeaderLen + static_cast<size_t>(key_len) + object_len ||
+      crc::Crc32c(body, key_len + object_len) != crc) {
+    LOG(WARNING) << "Ignoring cached object code " << path << ": truncated or corrupt";
+    return nullptr;
+  }
+  if (Slice(body, key_len) != Slice(key)) {
+    VLOG(1) << "Ignoring cached object code " << path << " for another module";
+    return nullptr;
+  }
+
+  num_loaded_.Increment();
+  return llvm::MemoryBuffer::getMemBufferCopy(
+      llvm::StringRef(reinterpret_cast<const char*>(body + key_len), object_len), module_id);
+}
+
+Status PersistentObjectCache::Save(const string& module_id, const Slice& object) {
+  DCHECK(enabled_);
+  string key;
+  string path = ObjectPath(module_id, &key);
+
+  faststring contents;
+  contents.append(kObjectFileMagic, kObjectFileMagicLen);
+  uint8_t header[12];
+  LittleEndian::Store32(header, key.size());
+  LittleEndian::Store32(header + 4, object.size());
+  contents.append(header, sizeof(header));
+  contents.append(key);
+  contents.append(object.data(), object.size());
+  LittleEndian::Store32(contents.data() + kObjectFileMagicLen + 8,
+                        crc::Crc32c(contents.data() + kObjectFileHeaderLen,
+                                    key.size() + object.size()));
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // readers (e.g. other servers sharing the directory) never see a partial
+  // file.
+  Env* env = Env::Default();
+  string tmp_path = StrCat(path, ".", ObjectIdGenerator().Next(), ".tmp");
+  RETURN_NOT_OK(WriteStringToFile(env, Slice(contents), tmp_path));
+  Status s = env->RenameFile(tmp_path, path);
+  if (!s.ok()) {
+    WARN_NOT_OK(env->DeleteFile(tmp_path), "Could not delete " + tmp_path);
+    return s;
+  }
+  num_saved_.Increment();
+  return Status::OK();
+}
+
 CodeCache::CodeCache(size_t capacity)
   : cache_(NewLRUCache(DRAM_CACHE, capacity, "code_cache")) {
   eviction_callback_.reset(new EvictionCallback());
@@ -18,10 +18,22 @@
 #ifndef KUDU_CODEGEN_CODE_CACHE_H
 #define KUDU_CODEGEN_CODE_CACHE_H
 
+#include <memory>
+#include <string>
+#include <unordered_map>
+
 #include "kudu/codegen/row_projector.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/singleton.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
+
+namespace llvm {
+class MemoryBuffer;
+class ObjectCache;
+} // namespace llvm
 
 namespace kudu {
 
@@ -87,6 +99,87 @@ class CodeCache {
   DISALLOW_COPY_AND_ASSIGN(CodeCache);
 };
 
+// A persistent object cache keeps the object code of compiled modules in the
+// local directory --codegen_object_cache_dir, so that a restarted server loads
+// the code it generated before instead of compiling it through LLVM again.
+//
+// Modules are identified by the key of the JITWrapper they were compiled for
+// (see JITWrapper::EncodeOwnKey()). The stored code is also keyed by the LLVM
+// version, the host CPU and its features and the precompiled IR, so that it
+// is never loaded into a process whose code generator would have compiled it
+// differently. Files which are truncated, corrupt or were written for another
+// key are ignored.
+//
+// Modules which embed pointers into the memory of the process which compiled
+// them (see ModuleBuilder::GetPointerValue()) must not be cached.
+//
+// This class is thread-safe.
+class PersistentObjectCache {
+ public:
+  static PersistentObjectCache* GetSingleton() {
+    return Singleton<PersistentObjectCache>::get();
+  }
+
+  ~PersistentObjectCache();
+
+  // Whether --codegen_object_cache_dir was set, and its directory could be
+  // created, when the cache was constructed.
+  bool enabled() const { return enabled_; }
+
+  // Returns the module identifier to give to modules compiled for the
+  // JITWrapper key 'key', so that their object code is cached.
+  static std::string ModuleIdentifier(const Slice& key);
+
+  // Reads and verifies the object code stored for the module with the given
+  // identifier, and returns whether there is any. If so, it is handed to the
+  // next execution engine which compiles that module rather than compiled
+  // again.
+  bool Prefetch(const std::string& module_id);
+
+  // The cache to attach to the execution engines of modules which may be
+  // cached. REQUIRES: enabled().
+  llvm::ObjectCache* llvm_cache();
+
+  // The number of modules whose object code was loaded from, and saved to,
+  // the cache directory.
+  int64_t num_loaded() const { return num_loaded_.Load(); }
+  int64_t num_saved() const { return num_saved_.Load(); }
+
+ private:
+  friend class Singleton<PersistentObjectCache>;
+  class LLVMObjectCache;
+
+  PersistentObjectCache();
+
+  // Returns the object code stored for 'module_id', or NULL if there is none.
+  std::unique_ptr<llvm::MemoryBuffer> Load(const std::string& module_id);
+
+  // Stores 'object' as the object code of the module 'module_id'.
+  Status Save(const std::string& module_id, const Slice& object);
+
+  // Returns the path of the file storing the object code of 'module_id', and
+  // the key stored in it, in 'file_key'.
+  std::string ObjectPath(const std::string& module_id, std::string* file_key) const;
+
+  const std::string dir_;
+  bool enabled_;
+
+  // Describes the code generator of this process: LLVM version, CPU and
+  // precompiled IR.
+  std::string environment_;
+
+  std::unique_ptr<LLVMObjectCache> llvm_cache_;
+
+  // Object code read by Prefetch() which wasn't yet handed to an engine.
+  simple_spinlock lock_;
+  std::unordered_map<std::string, std::unique_ptr<llvm::MemoryBuffer>> prefetched_;
+
+  AtomicInt<int64_t> num_loaded_;
+  AtomicInt<int64_t> num_saved_;
+
+  DISALLOW_COPY_AND_ASSIGN(PersistentObjectCache);
+};
+
 } // namespace codegen
 } // namespace kudu
 
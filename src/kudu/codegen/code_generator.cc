@@ -39,8 +39,11 @@
 #include <llvm/Target/TargetRegisterInfo.h>
 #include <llvm/Target/TargetSubtargetInfo.h>
 
+#include "kudu/codegen/change_list_applier.h"
 #include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/key_comparator.h"
 #include "kudu/codegen/module_builder.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -229,5 +232,64 @@ Status CodeGenerator::CompileRowProjector(const Schema& base, const Schema& proj
   return Status::OK();
 }
 
+Status CodeGenerator::CompileKeyComparator(const Schema& schema,
+                                           scoped_refptr<KeyComparatorFunctions>* out) {
+  RETURN_NOT_OK(CheckCodegenEnabled());
+
+  TargetMachine* tm;
+  RETURN_NOT_OK(KeyComparatorFunctions::Create(schema, out, &tm));
+
+  if (FLAGS_codegen_dump_mc) {
+    static const int kInstrMax = 500;
+    std::ostringstream sstr;
+    sstr << "Printing key comparison function:\n";
+    int instrs = DumpAsm((*out)->compare(), *tm, &sstr, kInstrMax);
+    sstr << "Printed " << instrs << " instructions.";
+    LOG(INFO) << sstr.str();
+  }
+
+  return Status::OK();
+}
+
+Status CodeGenerator::CompilePredicateEvaluator(
+    const std::vector<PredicateShape>& shapes,
+    scoped_refptr<PredicateEvaluatorFunctions>* out) {
+  RETURN_NOT_OK(CheckCodegenEnabled());
+
+  TargetMachine* tm;
+  RETURN_NOT_OK(PredicateEvaluatorFunctions::Create(shapes, out, &tm));
+
+  if (FLAGS_codegen_dump_mc) {
+    static const int kInstrMax = 500;
+    std::ostringstream sstr;
+    sstr << "Printing predicate evaluation function:\n";
+    int instrs = DumpAsm((*out)->evaluate(), *tm, &sstr, kInstrMax);
+    sstr << "Printed " << instrs << " instructions.";
+    LOG(INFO) << sstr.str();
+  }
+
+  return Status::OK();
+}
+
+Status CodeGenerator::CompileChangeListApplier(
+    const Schema& projection,
+    scoped_refptr<ChangeListApplierFunctions>* out) {
+  RETURN_NOT_OK(CheckCodegenEnabled());
+
+  TargetMachine* tm;
+  RETURN_NOT_OK(ChangeListApplierFunctions::Create(projection, out, &tm));
+
+  if (FLAGS_codegen_dump_mc) {
+    static const int kInstrMax = 500;
+    std::ostringstream sstr;
+    sstr << "Printing change list application function:\n";
+    int instrs = DumpAsm((*out)->apply(), *tm, &sstr, kInstrMax);
+    sstr << "Printed " << instrs << " instructions.";
+    LOG(INFO) << sstr.str();
+  }
+
+  return Status::OK();
+}
+
 } // namespace codegen
 } // namespace kudu
@@ -18,6 +18,10 @@
 #ifndef KUDU_CODEGEN_CODE_GENERATOR_H
 #define KUDU_CODEGEN_CODE_GENERATOR_H
 
+#include <vector>
+
+#include "kudu/codegen/key_comparator.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
@@ -34,6 +38,9 @@ class Schema;
 
 namespace codegen {
 
+class ChangeListApplierFunctions;
+class KeyComparatorFunctions;
+class PredicateEvaluatorFunctions;
 class RowProjectorFunctions;
 
 // CodeGenerator is a top-level class that manages a per-module
@@ -71,6 +78,23 @@ class CodeGenerator {
   Status CompileRowProjector(const Schema& base, const Schema& proj,
                              scoped_refptr<RowProjectorFunctions>* out);
 
+  // Attempts to initialize a key comparison function by compiling code
+  // for the key columns of the parameter schema. Writes to 'out' upon success.
+  Status CompileKeyComparator(const Schema& schema,
+                              scoped_refptr<KeyComparatorFunctions>* out);
+
+  // Attempts to initialize a predicate evaluation function by compiling
+  // code for the conjunction of predicates of the parameter shapes.
+  // Writes to 'out' upon success.
+  Status CompilePredicateEvaluator(const std::vector<PredicateShape>& shapes,
+                                   scoped_refptr<PredicateEvaluatorFunctions>* out);
+
+  // Attempts to initialize a change list application function by compiling
+  // code for the columns of the parameter projection. Writes to 'out' upon
+  // success.
+  Status CompileChangeListApplier(const Schema& projection,
+                                  scoped_refptr<ChangeListApplierFunctions>* out);
+
  private:
   static void GlobalInit();
 
@@ -23,16 +23,25 @@
 #include <glog/stl_logging.h>
 #include <gmock/gmock.h>
 
+#include "kudu/codegen/change_list_applier.h"
+#include "kudu/codegen/code_cache.h"
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/key_comparator.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/row.h"
+#include "kudu/common/row_changelist.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/util.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/env.h"
 #include "kudu/util/logging_test_util.h"
+#include "kudu/util/path_util.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/test_util.h"
@@ -42,6 +51,7 @@ using std::vector;
 
 DECLARE_bool(codegen_dump_mc);
 DECLARE_int32(codegen_cache_capacity);
+DECLARE_string(codegen_object_cache_dir);
 
 namespace kudu {
 
@@ -49,6 +59,7 @@ typedef RowProjector NoCodegenRP;
 typedef codegen::RowProjector CodegenRP;
 
 using codegen::CompilationManager;
+using codegen::PersistentObjectCache;
 
 class CodegenTest : public KuduTest {
  public:
@@ -365,7 +376,331 @@ TEST_F(CodegenTest, TestDumpMC) {
   EXPECT_THAT(msgs[0], testing::ContainsRegex("retq"));
 }
 
+// Test that the generated key comparator orders rows with a composite key
+// the same way as Schema::Compare().
+TEST_F(CodegenTest, TestKeyComparator) {
+  Schema schema({ ColumnSchema("k_int8", INT8),
+                  ColumnSchema("k_str", STRING),
+                  ColumnSchema("k_int64", INT64),
+                  ColumnSchema("val", INT32) }, 3);
+  codegen::CodeGenerator generator;
+  scoped_refptr<codegen::KeyComparatorFunctions> functions;
+  ASSERT_OK(generator.CompileKeyComparator(schema, &functions));
+  codegen::KeyComparator comparator(functions);
+
+  // Use a small value domain for each key column so that many pairs of
+  // rows share a key prefix and the later columns decide the order.
+  const int kNumRows = 100;
+  const char* kStrs[] = { "", "a", "ab", "b" };
+  Random rng(SeedRandom());
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(schema, kNumRows, &arena);
+  for (int i = 0; i < kNumRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<int8_t*>(row.mutable_cell_ptr(0)) = rng.Uniform(3) - 1;
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = Slice(kStrs[rng.Uniform(4)]);
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) = rng.Uniform(3);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(3)) = rng.Next32();
+  }
+
+  for (int i = 0; i < kNumRows; i++) {
+    for (int j = 0; j < kNumRows; j++) {
+      RowBlockRow lhs = block.row(i);
+      RowBlockRow rhs = block.row(j);
+      int expected = schema.Compare(lhs, rhs);
+      int actual = comparator.Compare(lhs, rhs);
+      SCOPED_TRACE(schema.DebugRow(lhs) + " vs " + schema.DebugRow(rhs));
+      ASSERT_EQ(expected < 0, actual < 0);
+      ASSERT_EQ(expected > 0, actual > 0);
+    }
+  }
+}
+
+TEST_F(CodegenTest, TestPredicateEvaluator) {
+  Schema schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("i64_null", INT64, true),
+                  ColumnSchema("str", STRING),
+                  ColumnSchema("dbl_null", DOUBLE, true),
+                  ColumnSchema("u8", UINT8) }, 1);
+
+  // Use small value domains so that every predicate selects some rows, and
+  // an odd number of rows so that the last byte of the bitmaps is partial.
+  const int kNumRows = 1001;
+  const char* kStrs[] = { "", "a", "ab", "b" };
+  Random rng(SeedRandom());
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(schema, kNumRows, &arena);
+  for (int i = 0; i < kNumRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = rng.Uniform(100);
+    row.cell(1).set_null(rng.OneIn(4));
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(1)) = rng.Uniform(10);
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(2)) = Slice(kStrs[rng.Uniform(4)]);
+    row.cell(3).set_null(rng.OneIn(2));
+    *reinterpret_cast<double*>(row.mutable_cell_ptr(3)) = rng.Uniform(10) / 2.0;
+    *reinterpret_cast<uint8_t*>(row.mutable_cell_ptr(4)) = rng.Uniform(4);
+  }
+
+  int32_t key_lower = 10;
+  int32_t key_upper = 90;
+  int64_t i64_upper = 8;
+  Slice str_value("ab");
+  double dbl_lower = 1.5;
+  uint8_t u8_value = 2;
+  vector<vector<ColumnPredicate>> conjunctions = {
+    { ColumnPredicate::Range(schema.column(0), &key_lower, &key_upper) },
+    { ColumnPredicate::Range(schema.column(0), &key_lower, nullptr),
+      ColumnPredicate::Range(schema.column(1), nullptr, &i64_upper),
+      ColumnPredicate::Equality(schema.column(2), &str_value) },
+    { ColumnPredicate::IsNotNull(schema.column(1)),
+      ColumnPredicate::Range(schema.column(3), &dbl_lower, nullptr),
+      ColumnPredicate::Equality(schema.column(4), &u8_value) },
+    { ColumnPredicate::IsNull(schema.column(3)),
+      ColumnPredicate::Range(schema.column(2), &str_value, nullptr) },
+  };
+
+  codegen::CodeGenerator generator;
+  for (const vector<ColumnPredicate>& predicates : conjunctions) {
+    vector<codegen::PredicateShape> shapes;
+    ASSERT_OK(codegen::PredicateEvaluatorFunctions::GetShapes(schema, predicates, &shapes));
+    scoped_refptr<codegen::PredicateEvaluatorFunctions> functions;
+    ASSERT_OK(generator.CompilePredicateEvaluator(shapes, &functions));
+    codegen::PredicateEvaluator evaluator(functions, predicates);
+
+    // Start from a random selection, as left by MVCC filtering.
+    SelectionVector expected(kNumRows);
+    expected.SetAllTrue();
+    for (int i = 0; i < kNumRows; i++) {
+      if (rng.OneIn(8)) expected.SetRowUnselected(i);
+    }
+    memcpy(block.selection_vector()->mutable_bitmap(), expected.bitmap(),
+           BitmapSize(kNumRows));
+
+    for (const ColumnPredicate& pred : predicates) {
+      pred.Evaluate(block.column_block(schema.find_column(pred.column().name())),
+                    &expected);
+    }
+    evaluator.Evaluate(&block);
+
+    for (int i = 0; i < kNumRows; i++) {
+      SCOPED_TRACE(schema.DebugRow(block.row(i)));
+      ASSERT_EQ(expected.IsRowSelected(i), block.selection_vector()->IsRowSelected(i));
+    }
+  }
+
+  // IN lists aren't code-generated.
+  vector<const void*> in_values = { &key_lower, &key_upper };
+  vector<ColumnPredicate> in_list = {
+    ColumnPredicate::InList(schema.column(0), &in_values) };
+  vector<codegen::PredicateShape> shapes;
+  ASSERT_TRUE(codegen::PredicateEvaluatorFunctions::GetShapes(
+      schema, in_list, &shapes).IsNotSupported());
+}
+
+// Predicates of the same shapes share an evaluator, regardless of their
+// values, and the compilation manager only hands one out once it has been
+// compiled.
+TEST_F(CodegenTest, TestPredicateEvaluatorCache) {
+  Singleton<CompilationManager>::UnsafeReset();
+  CompilationManager* cm = CompilationManager::GetSingleton();
+  Schema schema({ ColumnSchema("key", INT32), ColumnSchema("val", INT64, true) }, 1);
+
+  int32_t lower = 5;
+  int64_t value = 7;
+  vector<ColumnPredicate> predicates = {
+    ColumnPredicate::Range(schema.column(0), &lower, nullptr),
+    ColumnPredicate::Equality(schema.column(1), &value) };
+  gscoped_ptr<codegen::PredicateEvaluator> evaluator;
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&schema, predicates, &evaluator));
+  cm->Wait();
+  ASSERT_TRUE(cm->RequestPredicateEvaluator(&schema, predicates, &evaluator));
+
+  int32_t other_lower = 50;
+  int64_t other_value = 70;
+  vector<ColumnPredicate> other_predicates = {
+    ColumnPredicate::Range(schema.column(0), &other_lower, nullptr),
+    ColumnPredicate::Equality(schema.column(1), &other_value) };
+  ASSERT_TRUE(cm->RequestPredicateEvaluator(&schema, other_predicates, &evaluator));
+
+  // The projection matters, since the column indexes are compiled in.
+  Schema swapped({ ColumnSchema("val", INT64, true), ColumnSchema("key", INT32) }, 1);
+  ASSERT_FALSE(cm->RequestPredicateEvaluator(&swapped, predicates, &evaluator));
+}
+
+// Test that the code-generated change list applier writes the same cells as
+// RowChangeListDecoder::ApplyToOneColumn(), and fails the same way.
+TEST_F(CodegenTest, TestChangeListApplier) {
+  Schema schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("val", INT64, true),
+                  ColumnSchema("str", STRING, true),
+                  ColumnSchema("u8", UINT8) },
+                { ColumnId(10), ColumnId(11), ColumnId(12), ColumnId(13) }, 1);
+  // Project the columns out of order, and without 'u8', so that neither the
+  // column IDs nor the column indexes match.
+  Schema projection({ schema.column(2), schema.column(0), schema.column(1) },
+                    { ColumnId(12), ColumnId(10), ColumnId(11) }, 0);
+  codegen::CodeGenerator generator;
+  scoped_refptr<codegen::ChangeListApplierFunctions> functions;
+  ASSERT_OK(generator.CompileChangeListApplier(projection, &functions));
+  codegen::ChangeListApplier applier(&projection, functions);
+
+  int32_t key = 5;
+  int64_t val = 42;
+  Slice str("hello");
+  uint8_t u8 = 3;
+  faststring bufs[3];
+  RowChangeListEncoder update(&bufs[0]);
+  update.AddColumnUpdate(schema.column(1), 11, &val);
+  update.AddColumnUpdate(schema.column(2), 12, &str);
+  RowChangeListEncoder update_nulls(&bufs[1]);
+  update_nulls.AddColumnUpdate(schema.column(1), 11, nullptr);
+  update_nulls.AddColumnUpdate(schema.column(2), 12, nullptr);
+  RowChangeListEncoder reinsert(&bufs[2]);
+  reinsert.SetToReinsert();
+  reinsert.AddColumnUpdate(schema.column(3), 13, &u8);
+  reinsert.AddColumnUpdate(schema.column(0), 10, &key);
+  reinsert.AddColumnUpdate(schema.column(2), 12, &str);
+  reinsert.AddColumnUpdate(schema.column(1), 11, &val);
+  vector<RowChangeList> changelists = { update.as_changelist(),
+                                        update_nulls.as_changelist(),
+                                        reinsert.as_changelist() };
+
+  const int kNumRows = 4;
+  Arena arena(1024, 1024 * 1024);
+  RowBlock expected(projection, kNumRows, &arena);
+  RowBlock actual(projection, kNumRows, &arena);
+  for (RowBlock* block : { &expected, &actual }) {
+    for (int i = 0; i < kNumRows; i++) {
+      RowBlockRow row = block->row(i);
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(0)) = Slice("x");
+      row.cell(0).set_null(false);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(1)) = i;
+      *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(2)) = i;
+      row.cell(2).set_null(false);
+    }
+  }
+
+  for (const RowChangeList& changelist : changelists) {
+    SCOPED_TRACE(changelist.ToString(schema));
+    for (int i = 0; i < kNumRows; i++) {
+      for (size_t col_idx = 0; col_idx < projection.num_columns(); col_idx++) {
+        ColumnBlock expected_col = expected.column_block(col_idx);
+        RowChangeListDecoder decoder(changelist);
+        ASSERT_OK(decoder.Init());
+        ASSERT_OK(decoder.ApplyToOneColumn(i, &expected_col, projection, col_idx, &arena));
+        ColumnBlock actual_col = actual.column_block(col_idx);
+        ASSERT_OK(applier.ApplyToOneColumn(changelist, i, &actual_col, col_idx, &arena));
+      }
+      ASSERT_EQ(projection.DebugRow(expected.row(i)), projection.DebugRow(actual.row(i)));
+    }
+  }
+
+  // Setting a non-nullable column to NULL is an error.
+  faststring buf;
+  RowChangeListEncoder invalid(&buf);
+  invalid.AddColumnUpdate(ColumnSchema("key", INT32, true), 10, nullptr);
+  ColumnBlock key_col = actual.column_block(1);
+  Status s = applier.ApplyToOneColumn(invalid.as_changelist(), 0, &key_col, 1, &arena);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+
+  // Projections with the same column IDs and types share the applier, but
+  // the column IDs matter.
+  faststring key1, key2;
+  Schema renamed({ ColumnSchema("a", STRING, true), ColumnSchema("b", INT32),
+                   ColumnSchema("c", INT64, true) },
+                 { ColumnId(12), ColumnId(10), ColumnId(11) }, 0);
+  ASSERT_OK(codegen::ChangeListApplierFunctions::EncodeKey(projection, &key1));
+  ASSERT_OK(codegen::ChangeListApplierFunctions::EncodeKey(renamed, &key2));
+  ASSERT_EQ(key1.ToString(), key2.ToString());
+  Schema renumbered({ schema.column(2), schema.column(0), schema.column(1) },
+                    { ColumnId(12), ColumnId(10), ColumnId(14) }, 0);
+  key2.clear();
+  ASSERT_OK(codegen::ChangeListApplierFunctions::EncodeKey(renumbered, &key2));
+  ASSERT_NE(key1.ToString(), key2.ToString());
+}
+
+// Test that compiled object code is saved to the persistent object cache and
+// loaded from it after a (simulated) restart, and that unusable files are
+// ignored.
+TEST_F(CodegenTest, TestPersistentObjectCache) {
+  FLAGS_codegen_object_cache_dir = GetTestPath("object_cache");
+  Singleton<PersistentObjectCache>::UnsafeReset();
+  PersistentObjectCache* cache = PersistentObjectCache::GetSingleton();
+  ASSERT_TRUE(cache->enabled());
+
+  Schema schema({ ColumnSchema("k1", INT32), ColumnSchema("k2", STRING) }, 2);
+  Arena arena(1024, 1024);
+  RowBlock block(schema, 2, &arena);
+  for (int i = 0; i < 2; i++) {
+    *reinterpret_cast<int32_t*>(block.row(i).mutable_cell_ptr(0)) = 1;
+    *reinterpret_cast<Slice*>(block.row(i).mutable_cell_ptr(1)) = Slice(i == 0 ? "a" : "b");
+  }
+
+  codegen::CodeGenerator generator;
+  scoped_refptr<codegen::KeyComparatorFunctions> functions;
+  ASSERT_OK(generator.CompileKeyComparator(schema, &functions));
+  ASSERT_EQ(0, cache->num_loaded());
+  ASSERT_EQ(1, cache->num_saved());
+
+  // After a restart, the code is loaded rather than compiled, and works.
+  Singleton<PersistentObjectCache>::UnsafeReset();
+  cache = PersistentObjectCache::GetSingleton();
+  ASSERT_OK(generator.CompileKeyComparator(schema, &functions));
+  ASSERT_EQ(1, cache->num_loaded());
+  ASSERT_EQ(0, cache->num_saved());
+  codegen::KeyComparator comparator(functions);
+  ASSERT_LT(comparator.Compare(block.row(0), block.row(1)), 0);
+  ASSERT_GT(comparator.Compare(block.row(1), block.row(0)), 0);
+
+  // Projections with default values embed pointers into this process, so
+  // they aren't cached.
+  gscoped_ptr<CodegenRP> projector;
+  ASSERT_OK(Generate(&defaults_, &projector));
+  ASSERT_EQ(0, cache->num_saved());
+
+  // A corrupt file is ignored, and replaced once the code is compiled again.
+  vector<string> children;
+  ASSERT_OK(env_->GetChildren(FLAGS_codegen_object_cache_dir, &children));
+  string object_file;
+  for (const string& child : children) {
+    if (HasSuffixString(child, ".o")) object_file = child;
+  }
+  ASSERT_FALSE(object_file.empty());
+  string path = JoinPathSegments(FLAGS_codegen_object_cache_dir, object_file);
+  faststring contents;
+  ASSERT_OK(ReadFileToString(env_, path, &contents));
+  contents.data()[contents.size() - 1] ^= 0xff;
+  ASSERT_OK(WriteStringToFile(env_, Slice(contents), path));
+
+  Singleton<PersistentObjectCache>::UnsafeReset();
+  cache = PersistentObjectCache::GetSingleton();
+  ASSERT_OK(generator.CompileKeyComparator(schema, &functions));
+  ASSERT_EQ(0, cache->num_loaded());
+  ASSERT_EQ(1, cache->num_saved());
+
+  FLAGS_codegen_object_cache_dir = "";
+  Singleton<PersistentObjectCache>::UnsafeReset();
+}
+
 // Basic test for the CompilationManager code cache.
+// Test that eagerly compiled row projectors are cached for the first
+// request.
+TEST_F(CodegenTest, TestPrecompileRowProjector) {
+  Singleton<CompilationManager>::UnsafeReset();
+  CompilationManager* cm = CompilationManager::GetSingleton();
+  Schema projection = base_.CreateKeyProjection();
+  cm->PrecompileRowProjector(base_, projection);
+  cm->Wait();
+
+  gscoped_ptr<CodegenRP> projector;
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &projection, &projector));
+
+  // Precompiling it again is a no-op.
+  cm->PrecompileRowProjector(base_, projection);
+  cm->Wait();
+  ASSERT_TRUE(cm->RequestRowProjector(&base_, &projection, &projector));
+}
+
 // This runs a bunch of compilation tasks and ensures that the cache
 // sometimes hits on the second attempt for the same projection.
 TEST_F(CodegenTest, TestCodeCache) {
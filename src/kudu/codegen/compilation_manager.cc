@@ -23,11 +23,17 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <memory>
+#include <utility>
+#include <vector>
 
+#include "kudu/codegen/change_list_applier.h"
 #include "kudu/codegen/code_cache.h"
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/key_comparator.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/schema.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -43,6 +49,7 @@
 #include "kudu/util/threadpool.h"
 
 using std::shared_ptr;
+using std::vector;
 
 DEFINE_bool(codegen_time_compilation, false, "Whether to print time that each code "
             "generation request took.");
@@ -53,6 +60,10 @@ DEFINE_int32(codegen_cache_capacity, 100, "Number of entries which may be stored
              "code generation cache.");
 TAG_FLAG(codegen_cache_capacity, experimental);
 
+DEFINE_int32(codegen_precompile_queue_size, 1000, "Maximum number of eager compilations "
+             "of known projections which may be pending. Further ones are dropped.");
+TAG_FLAG(codegen_precompile_queue_size, experimental);
+
 METRIC_DEFINE_gauge_int64(server, code_cache_hits, "Codegen Cache Hits",
                           kudu::MetricUnit::kCacheHits,
                           "Number of codegen cache hits since start",
@@ -119,6 +130,154 @@ class CompilationTask : public Runnable {
   DISALLOW_COPY_AND_ASSIGN(CompilationTask);
 };
 
+// Runs a compilation task at a lower priority than the tasks of an
+// on-demand compilation pool, by waiting for the latter to be idle first.
+class LowPriorityCompilationTask : public Runnable {
+ public:
+  // Requires that 'on_demand_pool' is valid for the lifetime of this object.
+  LowPriorityCompilationTask(gscoped_ptr<Runnable> task, ThreadPool* on_demand_pool)
+    : task_(std::move(task)),
+      on_demand_pool_(on_demand_pool) {}
+
+  void Run() override {
+    on_demand_pool_->Wait();
+    task_->Run();
+  }
+
+ private:
+  gscoped_ptr<Runnable> task_;
+  ThreadPool* const on_demand_pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(LowPriorityCompilationTask);
+};
+
+// Same as CompilationTask, but generates a key comparator for the key
+// columns of a single schema.
+class KeyComparatorCompilationTask : public Runnable {
+ public:
+  // Requires that the cache and generator are valid for the lifetime
+  // of this object.
+  KeyComparatorCompilationTask(const Schema& schema, CodeCache* cache,
+                               CodeGenerator* generator)
+    : schema_(schema),
+      cache_(cache),
+      generator_(generator) {}
+
+  // Can only be run once.
+  void Run() override {
+    WARN_NOT_OK(RunWithStatus(),
+                "Failed compilation of key comparator for schema " +
+                schema_.ToString());
+  }
+
+ private:
+  Status RunWithStatus() {
+    faststring key;
+    RETURN_NOT_OK(KeyComparatorFunctions::EncodeKey(schema_, &key));
+
+    // Check again to make sure we didn't compile it already.
+    if (cache_->Lookup(key)) return Status::OK();
+
+    scoped_refptr<KeyComparatorFunctions> functions;
+    LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating key comparator") {
+      RETURN_NOT_OK(generator_->CompileKeyComparator(schema_, &functions));
+    }
+
+    RETURN_NOT_OK(cache_->AddEntry(functions));
+    return Status::OK();
+  }
+
+  Schema schema_;
+  CodeCache* const cache_;
+  CodeGenerator* const generator_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyComparatorCompilationTask);
+};
+
+// Same as CompilationTask, but generates a predicate evaluator for
+// predicates of the given shapes. Only the shapes are kept, since the
+// predicates' values may not outlive the request.
+class PredicateEvaluatorCompilationTask : public Runnable {
+ public:
+  // Requires that the cache and generator are valid for the lifetime
+  // of this object.
+  PredicateEvaluatorCompilationTask(vector<PredicateShape> shapes, CodeCache* cache,
+                                    CodeGenerator* generator)
+    : shapes_(std::move(shapes)),
+      cache_(cache),
+      generator_(generator) {}
+
+  // Can only be run once.
+  void Run() override {
+    WARN_NOT_OK(RunWithStatus(), "Failed compilation of predicate evaluator");
+  }
+
+ private:
+  Status RunWithStatus() {
+    faststring key;
+    RETURN_NOT_OK(PredicateEvaluatorFunctions::EncodeKey(shapes_, &key));
+
+    // Check again to make sure we didn't compile it already.
+    if (cache_->Lookup(key)) return Status::OK();
+
+    scoped_refptr<PredicateEvaluatorFunctions> functions;
+    LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating predicate evaluator") {
+      RETURN_NOT_OK(generator_->CompilePredicateEvaluator(shapes_, &functions));
+    }
+
+    RETURN_NOT_OK(cache_->AddEntry(functions));
+    return Status::OK();
+  }
+
+  const vector<PredicateShape> shapes_;
+  CodeCache* const cache_;
+  CodeGenerator* const generator_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredicateEvaluatorCompilationTask);
+};
+
+// Same as CompilationTask, but generates a change list applier.
+class ChangeListApplierCompilationTask : public Runnable {
+ public:
+  // Requires that the cache and generator are valid for the lifetime
+  // of this object.
+  ChangeListApplierCompilationTask(const Schema& projection, CodeCache* cache,
+                                   CodeGenerator* generator)
+    : projection_(projection),
+      cache_(cache),
+      generator_(generator) {}
+
+  // Can only be run once.
+  void Run() override {
+    WARN_NOT_OK(RunWithStatus(),
+                "Failed compilation of change list applier for projection " +
+                projection_.ToString());
+  }
+
+ private:
+  Status RunWithStatus() {
+    faststring key;
+    RETURN_NOT_OK(ChangeListApplierFunctions::EncodeKey(projection_, &key));
+
+    // Check again to make sure we didn't compile it already.
+    if (cache_->Lookup(key)) return Status::OK();
+
+    scoped_refptr<ChangeListApplierFunctions> functions;
+    LOG_TIMING_IF(INFO, FLAGS_codegen_time_compilation, "code-generating change list applier") {
+      RETURN_NOT_OK(generator_->CompileChangeListApplier(projection_, &functions));
+    }
+
+    RETURN_NOT_OK(cache_->AddEntry(functions));
+    return Status::OK();
+  }
+
+  Schema projection_;
+  CodeCache* const cache_;
+  CodeGenerator* const generator_;
+
+  DISALLOW_COPY_AND_ASSIGN(ChangeListApplierCompilationTask);
+};
+
 } // anonymous namespace
 
 CompilationManager::CompilationManager()
@@ -130,6 +289,12 @@ CompilationManager::CompilationManager()
            .set_max_threads(1)
            .set_idle_timeout(MonoDelta::FromMilliseconds(kThreadTimeoutMs))
            .Build(&pool_));
+  CHECK_OK(ThreadPoolBuilder("compiler_manager_precompile_pool")
+           .set_min_threads(0)
+           .set_max_threads(1)
+           .set_max_queue_size(FLAGS_codegen_precompile_queue_size)
+           .set_idle_timeout(MonoDelta::FromMilliseconds(kThreadTimeoutMs))
+           .Build(&precompile_pool_));
   // We call std::atexit after the implicit default construction of
   // generator_ to ensure static LLVM constants would not have been destructed
   // when the registered function is called (since this object is a singleton,
@@ -142,10 +307,12 @@ CompilationManager::CompilationManager()
 CompilationManager::~CompilationManager() {}
 
 void CompilationManager::Wait() {
+  precompile_pool_->Wait();
   pool_->Wait();
 }
 
 void CompilationManager::Shutdown() {
+  GetSingleton()->precompile_pool_->Shutdown();
   GetSingleton()->pool_->Shutdown();
 }
 
@@ -196,5 +363,109 @@ bool CompilationManager::RequestRowProjector(const Schema* base_schema,
   return true;
 }
 
+void CompilationManager::PrecompileRowProjector(const Schema& base_schema,
+                                                const Schema& projection) {
+  faststring key;
+  Status s = RowProjectorFunctions::EncodeKey(base_schema, projection, &key);
+  WARN_NOT_OK(s, "RowProjector precompilation request failed");
+  if (!s.ok() || cache_.Lookup(key)) return;
+
+  gscoped_ptr<Runnable> task(
+    new CompilationTask(base_schema, projection, &cache_, &generator_));
+  shared_ptr<Runnable> low_priority_task(
+    new LowPriorityCompilationTask(std::move(task), pool_.get()));
+  s = precompile_pool_->Submit(low_priority_task);
+  // A full queue only means that the rest is compiled on first use.
+  if (!s.ok()) {
+    KLOG_EVERY_N_SECS(INFO, 60) << "RowProjector precompilation request dropped: "
+                                << s.ToString();
+  }
+}
+
+bool CompilationManager::RequestKeyComparator(const Schema* schema,
+                                              gscoped_ptr<KeyComparator>* out) {
+  faststring key;
+  Status s = KeyComparatorFunctions::EncodeKey(*schema, &key);
+  WARN_NOT_OK(s, "KeyComparator compilation request failed");
+  if (!s.ok()) return false;
+  query_counter_.Increment();
+
+  scoped_refptr<KeyComparatorFunctions> cached(
+    down_cast<KeyComparatorFunctions*>(cache_.Lookup(key).get()));
+
+  // If not cached, add a request to compilation pool
+  if (!cached) {
+    shared_ptr<Runnable> task(
+      new KeyComparatorCompilationTask(*schema, &cache_, &generator_));
+    WARN_NOT_OK(pool_->Submit(task),
+                "KeyComparator compilation request failed");
+    return false;
+  }
+
+  hit_counter_.Increment();
+
+  out->reset(new KeyComparator(cached));
+  return true;
+}
+
+bool CompilationManager::RequestPredicateEvaluator(const Schema* projection,
+                                                   const vector<ColumnPredicate>& predicates,
+                                                   gscoped_ptr<PredicateEvaluator>* out) {
+  // Predicates which can't be code-generated are common (e.g. IN lists),
+  // and are evaluated by the caller instead, so this isn't worth a warning.
+  vector<PredicateShape> shapes;
+  if (!PredicateEvaluatorFunctions::GetShapes(*projection, predicates, &shapes).ok()) {
+    return false;
+  }
+  faststring key;
+  Status s = PredicateEvaluatorFunctions::EncodeKey(shapes, &key);
+  WARN_NOT_OK(s, "PredicateEvaluator compilation request failed");
+  if (!s.ok()) return false;
+  query_counter_.Increment();
+
+  scoped_refptr<PredicateEvaluatorFunctions> cached(
+    down_cast<PredicateEvaluatorFunctions*>(cache_.Lookup(key).get()));
+
+  // If not cached, add a request to compilation pool
+  if (!cached) {
+    shared_ptr<Runnable> task(
+      new PredicateEvaluatorCompilationTask(std::move(shapes), &cache_, &generator_));
+    WARN_NOT_OK(pool_->Submit(task),
+                "PredicateEvaluator compilation request failed");
+    return false;
+  }
+
+  hit_counter_.Increment();
+
+  out->reset(new PredicateEvaluator(cached, predicates));
+  return true;
+}
+
+bool CompilationManager::RequestChangeListApplier(const Schema* projection,
+                                                  gscoped_ptr<ChangeListApplier>* out) {
+  faststring key;
+  Status s = ChangeListApplierFunctions::EncodeKey(*projection, &key);
+  WARN_NOT_OK(s, "ChangeListApplier compilation request failed");
+  if (!s.ok()) return false;
+  query_counter_.Increment();
+
+  scoped_refptr<ChangeListApplierFunctions> cached(
+    down_cast<ChangeListApplierFunctions*>(cache_.Lookup(key).get()));
+
+  // If not cached, add a request to compilation pool
+  if (!cached) {
+    shared_ptr<Runnable> task(
+      new ChangeListApplierCompilationTask(*projection, &cache_, &generator_));
+    WARN_NOT_OK(pool_->Submit(task),
+                "ChangeListApplier compilation request failed");
+    return false;
+  }
+
+  hit_counter_.Increment();
+
+  out->reset(new ChangeListApplier(projection, cached));
+  return true;
+}
+
 } // namespace codegen
 } // namespace kudu
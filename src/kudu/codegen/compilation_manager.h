@@ -18,6 +18,8 @@
 #ifndef KUDU_CODEGEN_COMPILATION_MANAGER_H
 #define KUDU_CODEGEN_COMPILATION_MANAGER_H
 
+#include <vector>
+
 #include "kudu/codegen/code_generator.h"
 #include "kudu/codegen/code_cache.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -28,6 +30,7 @@
 
 namespace kudu {
 
+class ColumnPredicate;
 class Counter;
 class MetricEntity;
 class MetricRegistry;
@@ -35,6 +38,9 @@ class ThreadPool;
 
 namespace codegen {
 
+class ChangeListApplier;
+class KeyComparator;
+class PredicateEvaluator;
 class RowProjector;
 
 // The compilation manager is a top-level class which manages the actual
@@ -76,6 +82,38 @@ class CompilationManager {
                            const Schema* projection,
                            gscoped_ptr<RowProjector>* out);
 
+  // Enqueues a low-priority compilation task for the row projector of the
+  // parameter schemas, unless it's already cached, so that a later
+  // RequestRowProjector() for them hits. Used to compile the projections
+  // which are known to be used ahead of their first use.
+  //
+  // Eager compilations run on their own thread, one at a time, and each
+  // waits for the pending on-demand compilations to finish first. Requests
+  // beyond --codegen_precompile_queue_size pending ones are dropped.
+  void PrecompileRowProjector(const Schema& base_schema, const Schema& projection);
+
+  // Same as RequestRowProjector, but for a comparator over the key
+  // columns of 'schema'. Any schema with the same key column types
+  // shares the same compiled comparator.
+  bool RequestKeyComparator(const Schema* schema,
+                            gscoped_ptr<KeyComparator>* out);
+
+  // Same as RequestRowProjector, but for an evaluator of the conjunction
+  // of 'predicates', in order, over row blocks of the 'projection' schema.
+  // Any set of predicates of the same shapes (see
+  // codegen::PredicateShape) shares the same compiled evaluator, so the
+  // evaluation code doesn't depend on the predicates' values.
+  bool RequestPredicateEvaluator(const Schema* projection,
+                                 const std::vector<ColumnPredicate>& predicates,
+                                 gscoped_ptr<PredicateEvaluator>* out);
+
+  // Same as RequestRowProjector, but for an applier of RowChangeLists to the
+  // columns of 'projection'. Any projection with the same column IDs, types
+  // and nullability shares the same compiled applier. 'projection' must
+  // outlive the applier.
+  bool RequestChangeListApplier(const Schema* projection,
+                                gscoped_ptr<ChangeListApplier>* out);
+
   // Waits for all asynchronous compilation tasks to finish.
   void Wait();
 
@@ -95,6 +133,9 @@ class CompilationManager {
   CodeCache cache_;
   gscoped_ptr<ThreadPool> pool_;
 
+  // The pool of eager compilation tasks (see PrecompileRowProjector()).
+  gscoped_ptr<ThreadPool> precompile_pool_;
+
   AtomicInt<int64_t> hit_counter_;
   AtomicInt<int64_t> query_counter_;
 
@@ -49,7 +49,10 @@ typedef llvm::ExecutionEngine JITCodeOwner;
 class JITWrapper : public RefCountedThreadSafe<JITWrapper> {
  public:
   enum JITWrapperType {
-    ROW_PROJECTOR
+    ROW_PROJECTOR,
+    KEY_COMPARATOR,
+    PREDICATE_EVALUATOR,
+    CHANGE_LIST_APPLIER
   };
 
   // Returns the key encoding (for the code cache) for this upon success.
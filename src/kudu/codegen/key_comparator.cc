@@ -0,0 +1,246 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/codegen/key_comparator.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/module_builder.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class LLVMContext;
+} // namespace llvm
+
+using llvm::Argument;
+using llvm::BasicBlock;
+using llvm::Function;
+using llvm::FunctionType;
+using llvm::LLVMContext;
+using llvm::PHINode;
+using llvm::PointerType;
+using llvm::Type;
+using llvm::Value;
+using std::pair;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+DECLARE_bool(codegen_dump_functions);
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// Returns the name of the precompiled function which compares two cells
+// of the given physical type, or NotSupported if there is none.
+Status GetCompareCellsFunctionName(DataType physical_type, string* name) {
+  switch (physical_type) {
+    case UINT8:  *name = "_PrecompiledCompareUInt8Cells"; break;
+    case INT8:   *name = "_PrecompiledCompareInt8Cells"; break;
+    case UINT16: *name = "_PrecompiledCompareUInt16Cells"; break;
+    case INT16:  *name = "_PrecompiledCompareInt16Cells"; break;
+    case UINT32: *name = "_PrecompiledCompareUInt32Cells"; break;
+    case INT32:  *name = "_PrecompiledCompareInt32Cells"; break;
+    case UINT64: *name = "_PrecompiledCompareUInt64Cells"; break;
+    case INT64:  *name = "_PrecompiledCompareInt64Cells"; break;
+    case BINARY: *name = "_PrecompiledCompareBinaryCells"; break;
+    default:
+      return Status::NotSupported("no code-generated comparison for key column type",
+                                  DataType_Name(physical_type));
+  }
+  return Status::OK();
+}
+
+// Generates a key comparison function of the form:
+// i32(RowBlockRow* lhs, RowBlockRow* rhs)
+// which returns a negative, zero or positive value as the key of 'lhs' is
+// less than, equal to or greater than the key of 'rhs'.
+Status MakeComparison(const string& name,
+                      ModuleBuilder* mbuilder,
+                      const Schema& schema,
+                      Function** out) {
+  // Get the IRBuilder
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  // Look up the per-column comparisons up front so that an unsupported
+  // key type fails before any IR is emitted.
+  vector<Function*> compare_cells;
+  for (size_t col_idx = 0; col_idx < schema.num_key_columns(); col_idx++) {
+    string fname;
+    RETURN_NOT_OK(GetCompareCellsFunctionName(
+        schema.column(col_idx).type_info()->physical_type(), &fname));
+    compare_cells.push_back(mbuilder->GetFunction(fname));
+  }
+  if (compare_cells.empty()) {
+    return Status::InvalidArgument("schema has no key columns", schema.ToString());
+  }
+
+  // Create the function after providing a declaration
+  Type* rbrow_type = PointerType::getUnqual(mbuilder->GetType("class.kudu::RowBlockRow"));
+  vector<Type*> argtypes = { rbrow_type, rbrow_type };
+  FunctionType* fty = FunctionType::get(Type::getInt32Ty(context), argtypes, false);
+  Function* f = mbuilder->Create(fty, name);
+
+  // Get the function's Arguments
+  Function::arg_iterator it = f->arg_begin();
+  Argument* lhs = &*it++;
+  Argument* rhs = &*it++;
+  DCHECK(it == f->arg_end());
+
+  // Give names to the arguments for debugging IR.
+  lhs->setName("lhs");
+  rhs->setName("rhs");
+
+  // Compare function in IR (note: values in angle brackets are
+  // constants whose values are determined right now, at JIT time).
+  //
+  // define i32 @name(RowBlockRow* %lhs, RowBlockRow* %rhs)
+  // entry:
+  //   <for each key column but the last>
+  //     %cmp<i> = call i32 @<compare cells function for column type>(
+  //       RowBlockRow* %lhs, RowBlockRow* %rhs, i64 <column index>)
+  //     %ne<i> = icmp ne i32 %cmp<i>, 0
+  //     br i1 %ne<i>, label %done, label %col<i + 1>
+  //   col<i + 1>:
+  //   <end implicit for each>
+  //   %cmp<last> = call i32 @<compare cells function>(...)
+  //   br label %done
+  // done:
+  //   %result = phi i32 [ %cmp<i>, <block of column i> ]...
+  //   ret i32 %result
+  builder->SetInsertPoint(BasicBlock::Create(context, "entry", f));
+  BasicBlock* done = BasicBlock::Create(context, "done");
+  vector<pair<Value*, BasicBlock*>> results;
+  for (size_t col_idx = 0; col_idx < compare_cells.size(); col_idx++) {
+    vector<Value*> args = { lhs, rhs, builder->getInt64(col_idx) };
+    Value* cmp = builder->CreateCall(compare_cells[col_idx], args);
+    cmp->setName(StrCat("cmp", col_idx));
+    results.emplace_back(cmp, builder->GetInsertBlock());
+
+    if (col_idx + 1 == compare_cells.size()) {
+      builder->CreateBr(done);
+      break;
+    }
+    Value* ne = builder->CreateICmpNE(cmp, builder->getInt32(0));
+    ne->setName(StrCat("ne", col_idx));
+    BasicBlock* next = BasicBlock::Create(context, StrCat("col", col_idx + 1), f);
+    builder->CreateCondBr(ne, done, next);
+    builder->SetInsertPoint(next);
+  }
+
+  done->insertInto(f);
+  builder->SetInsertPoint(done);
+  PHINode* result = builder->CreatePHI(Type::getInt32Ty(context), results.size(), "result");
+  for (const pair<Value*, BasicBlock*>& r : results) {
+    result->addIncoming(r.first, r.second);
+  }
+  builder->CreateRet(result);
+
+  if (FLAGS_codegen_dump_functions) {
+    LOG(INFO) << "Dumping key comparison:";
+    f->dump();
+  }
+
+  *out = f;
+  return Status::OK();
+}
+
+// Convenience method which appends to a faststring
+template<typename T>
+void AddNext(faststring* fs, const T& val) {
+  fs->append(&val, sizeof(T));
+}
+
+} // anonymous namespace
+
+KeyComparatorFunctions::KeyComparatorFunctions(const Schema& schema,
+                                               CompareFunction compare_f,
+                                               unique_ptr<JITCodeOwner> owner)
+  : JITWrapper(std::move(owner)),
+    schema_(schema),
+    compare_f_(compare_f) {
+  CHECK(compare_f != nullptr)
+    << "Promise to compile compare function not fulfilled by ModuleBuilder";
+}
+
+Status KeyComparatorFunctions::Create(const Schema& schema,
+                                      scoped_refptr<KeyComparatorFunctions>* out,
+                                      llvm::TargetMachine** tm) {
+  ModuleBuilder builder;
+  RETURN_NOT_OK(builder.Init());
+
+  Function* compare;
+  RETURN_NOT_OK(MakeComparison("KeyCompare", &builder, schema, &compare));
+
+  faststring key;
+  RETURN_NOT_OK(EncodeKey(schema, &key));
+  builder.SetObjectCacheKey(Slice(key));
+
+  // Have the ModuleBuilder accept a promise to compile the function
+  CompareFunction compare_f;
+  builder.AddJITPromise(compare, &compare_f);
+
+  unique_ptr<JITCodeOwner> owner;
+  RETURN_NOT_OK(builder.Compile(&owner));
+
+  if (tm) {
+    *tm = builder.GetTargetMachine();
+  }
+  out->reset(new KeyComparatorFunctions(schema, compare_f, std::move(owner)));
+  return Status::OK();
+}
+
+// Generates a key for a schema's key columns which is unique according to
+// the criteria defined in the CodeCache class' block comment. Only the key
+// column types affect the generated code, so the schema is encoded as
+// follows, in sequence.
+//
+// (4 bytes) unique type identifier for KeyComparatorFunctions
+// (8 bytes) number, as unsigned long, of key columns
+// (4 bytes each) key column physical types, in order
+//
+// Writes to 'out' upon success.
+Status KeyComparatorFunctions::EncodeKey(const Schema& schema, faststring* out) {
+  AddNext(out, JITWrapper::KEY_COMPARATOR);
+  AddNext(out, schema.num_key_columns());
+  for (size_t col_idx = 0; col_idx < schema.num_key_columns(); col_idx++) {
+    AddNext(out, schema.column(col_idx).type_info()->physical_type());
+  }
+  return Status::OK();
+}
+
+} // namespace codegen
+} // namespace kudu
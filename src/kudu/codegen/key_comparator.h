@@ -0,0 +1,105 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CODEGEN_KEY_COMPARATOR_H
+#define KUDU_CODEGEN_KEY_COMPARATOR_H
+
+#include <memory>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
+namespace kudu {
+
+class faststring;
+
+namespace codegen {
+
+// The JITWrapper for codegen::KeyComparator functions. Contains the
+// compiled comparison function as well as the schema used to generate it.
+//
+// The generated function compares the key columns of two rows in turn,
+// with the cell type and size of each column baked in as constants,
+// replacing the per-column type dispatch done by Schema::Compare().
+class KeyComparatorFunctions : public JITWrapper {
+ public:
+  // Compiles the key comparison function for the given schema.
+  // Writes the llvm::TargetMachine* used to 'tm' (if not NULL)
+  // and the function to 'out' upon success.
+  //
+  // Returns NotSupported if some key column has a type that the
+  // code generator does not handle.
+  static Status Create(const Schema& schema,
+                       scoped_refptr<KeyComparatorFunctions>* out,
+                       llvm::TargetMachine** tm = NULL);
+
+  const Schema& schema() { return schema_; }
+
+  typedef int(*CompareFunction)(const RowBlockRow*, const RowBlockRow*);
+  CompareFunction compare() const { return compare_f_; }
+
+  virtual Status EncodeOwnKey(faststring* out) OVERRIDE {
+    return EncodeKey(schema_, out);
+  }
+
+  static Status EncodeKey(const Schema& schema, faststring* out);
+
+ private:
+  KeyComparatorFunctions(const Schema& schema, CompareFunction compare_f,
+                         std::unique_ptr<JITCodeOwner> owner);
+
+  const Schema schema_;
+  const CompareFunction compare_f_;
+};
+
+// Compares rows by their key columns using a code-generated function.
+// Behaves the same as Schema::Compare() for RowBlockRows whose schema
+// has the same key column types as the schema used to create 'functions'.
+class KeyComparator {
+ public:
+  explicit KeyComparator(const scoped_refptr<KeyComparatorFunctions>& functions)
+    : functions_(functions),
+      compare_f_(functions->compare()),
+      num_key_columns_(functions->schema().num_key_columns()) {}
+
+  int Compare(const RowBlockRow& lhs, const RowBlockRow& rhs) const {
+    // The cached functions may have been compiled for a different schema
+    // with the same key column types, so only the key shape is checked.
+    DCHECK_EQ(lhs.schema()->num_key_columns(), num_key_columns_);
+    DCHECK_EQ(rhs.schema()->num_key_columns(), num_key_columns_);
+    return compare_f_(&lhs, &rhs);
+  }
+
+ private:
+  scoped_refptr<KeyComparatorFunctions> functions_;
+  const KeyComparatorFunctions::CompareFunction compare_f_;
+  const size_t num_key_columns_;
+
+  DISALLOW_COPY_AND_ASSIGN(KeyComparator);
+};
+
+} // namespace codegen
+} // namespace kudu
+
+#endif
@@ -43,6 +43,7 @@
 #include <llvm/Transforms/IPO.h>
 #include <llvm/Transforms/IPO/PassManagerBuilder.h>
 
+#include "kudu/codegen/code_cache.h"
 #include "kudu/codegen/precompiled.ll.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
@@ -126,7 +127,8 @@ bool ModuleContains(const Module& m, const Function* fptr) {
 ModuleBuilder::ModuleBuilder()
   : state_(kUninitialized),
     context_(new LLVMContext()),
-    builder_(*context_) {}
+    builder_(*context_),
+    embeds_pointers_(false) {}
 
 ModuleBuilder::~ModuleBuilder() {}
 
@@ -184,8 +186,9 @@ Type* ModuleBuilder::GetType(const string& name) {
   return CHECK_NOTNULL(module_->getTypeByName(name));
 }
 
-Value* ModuleBuilder::GetPointerValue(void* ptr) const {
+Value* ModuleBuilder::GetPointerValue(void* ptr) {
   CHECK_EQ(state_, kBuilding);
+  embeds_pointers_ = true;
   // No direct way of creating constant pointer values in LLVM, so
   // first a constant int has to be created and then casted to a pointer
   IntegerType* llvm_uintptr_t = Type::getIntNTy(*context_, 8 * sizeof(ptr));
@@ -196,6 +199,10 @@ Value* ModuleBuilder::GetPointerValue(void* ptr) const {
   return ConstantExpr::getIntToPtr(llvm_int_value, llvm_ptr_t);
 }
 
+void ModuleBuilder::SetObjectCacheKey(const Slice& key) {
+  CHECK_EQ(state_, kBuilding);
+  object_cache_key_ = key.ToString();
+}
 
 void ModuleBuilder::AddJITPromise(llvm::Function* llvm_f,
                                   FunctionAddress* actual_f) {
@@ -288,8 +295,22 @@ Status ModuleBuilder::Compile(unique_ptr<ExecutionEngine>* out) {
   }
   module->setDataLayout(target_->createDataLayout());
 
+  // If the object code of the module was cached, there is no need to
+  // optimize it: the engine loads the cached code instead of compiling it.
+  PersistentObjectCache* object_cache = PersistentObjectCache::GetSingleton();
+  bool cached = false;
+  if (object_cache->enabled() && !object_cache_key_.empty() && !embeds_pointers_) {
+    module->setModuleIdentifier(PersistentObjectCache::ModuleIdentifier(object_cache_key_));
+    local_engine->setObjectCache(object_cache->llvm_cache());
+    cached = object_cache->Prefetch(module->getModuleIdentifier());
+  }
+
 #if CODEGEN_MODULE_BUILDER_DO_OPTIMIZATIONS
-  DoOptimizations(local_engine.get(), module, GetFunctionNames());
+  if (!cached) {
+    DoOptimizations(local_engine.get(), module, GetFunctionNames());
+  }
+#else
+  ignore_result(cached);
 #endif
 
   // Compile the module
@@ -26,6 +26,7 @@
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/Module.h>
 
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace llvm {
@@ -84,8 +85,16 @@ class ModuleBuilder {
   llvm::Type* GetType(const std::string& name);
   // Retrieve a precompiled function
   llvm::Function* GetFunction(const std::string& name);
-  // Get the LLVM wrapper for a constant pointer value of type i8*
-  llvm::Value* GetPointerValue(void* ptr) const;
+  // Get the LLVM wrapper for a constant pointer value of type i8*.
+  // The compiled code of a module which embeds pointers isn't kept in the
+  // persistent object cache, since they are only valid in this process.
+  llvm::Value* GetPointerValue(void* ptr);
+
+  // Allows the compiled object code of the module to be kept in, and
+  // loaded from, the persistent object cache (see PersistentObjectCache)
+  // under 'key', which must be the key of the JITWrapper that the module
+  // is compiled for.
+  void SetObjectCacheKey(const Slice& key);
 
   LLVMBuilder* builder() { return &builder_; }
 
@@ -143,6 +152,10 @@ class ModuleBuilder {
   LLVMBuilder builder_;
   llvm::TargetMachine* target_; // not owned
 
+  // See SetObjectCacheKey() and GetPointerValue().
+  std::string object_cache_key_;
+  bool embeds_pointers_;
+
   DISALLOW_COPY_AND_ASSIGN(ModuleBuilder);
 };
 
@@ -35,10 +35,14 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <type_traits>
 
+#include "kudu/common/columnblock.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/util/bitmap.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/slice.h"
 
 // Even though this file is only needed for IR purposes, we need to check for
 // IR_BUILD because we use a fake static library target to workaround a cmake
@@ -85,6 +89,106 @@ IR_ALWAYS_INLINE static bool BasicCopyCell(
   return true;
 }
 
+// Returns a negative, zero or positive value as the cell of column 'col' in
+// 'lhs' is less than, equal to or greater than the same cell in 'rhs'.
+// As in _PrecompiledCopyCellToRowBlock, the cell pointers are computed from
+// the statically-known size of T.
+template<class T>
+IR_ALWAYS_INLINE static int CompareCells(
+    const RowBlockRow* lhs, const RowBlockRow* rhs, uint64_t col) {
+  const T* lhs_cell = reinterpret_cast<const T*>(
+      lhs->row_block()->column_data_base_ptr(col) + lhs->row_index() * sizeof(T));
+  const T* rhs_cell = reinterpret_cast<const T*>(
+      rhs->row_block()->column_data_base_ptr(col) + rhs->row_index() * sizeof(T));
+  if (*lhs_cell < *rhs_cell) return -1;
+  if (*rhs_cell < *lhs_cell) return 1;
+  return 0;
+}
+
+template<>
+IR_ALWAYS_INLINE int CompareCells<Slice>(
+    const RowBlockRow* lhs, const RowBlockRow* rhs, uint64_t col) {
+  const Slice* lhs_cell = reinterpret_cast<const Slice*>(
+      lhs->row_block()->column_data_base_ptr(col) + lhs->row_index() * sizeof(Slice));
+  const Slice* rhs_cell = reinterpret_cast<const Slice*>(
+      rhs->row_block()->column_data_base_ptr(col) + rhs->row_index() * sizeof(Slice));
+  return lhs_cell->compare(*rhs_cell);
+}
+
+// Returns whether 'lhs' sorts strictly before 'rhs', in the same order as
+// DataTypeTraits<>::Compare().
+template<class T>
+IR_ALWAYS_INLINE static bool CellLess(const T& lhs, const T& rhs) {
+  return lhs < rhs;
+}
+
+template<>
+IR_ALWAYS_INLINE bool CellLess<Slice>(const Slice& lhs, const Slice& rhs) {
+  return lhs.compare(rhs) < 0;
+}
+
+// Deselects the rows of 'block' whose cell of column 'col' doesn't satisfy
+// 'pred', or is null if 'nullable' is true. Rows which are already
+// deselected are left alone.
+//
+// The cells of fixed-width types are evaluated regardless of whether their
+// row is selected, eight rows at a time, so that the loop has no branches
+// and may be vectorized. Slices may point to uninitialized memory in rows
+// that were deselected, so those are skipped.
+template<class T, class Pred>
+IR_ALWAYS_INLINE static void EvaluateCells(
+    RowBlock* block, uint64_t col, bool nullable, Pred pred) {
+  uint8_t* sel = block->selection_vector()->mutable_bitmap();
+  const T* cells = reinterpret_cast<const T*>(block->column_data_base_ptr(col));
+  const uint8_t* non_null = block->column_null_bitmap_ptr(col);
+  size_t nrows = block->nrows();
+
+  if (std::is_same<T, Slice>::value) {
+    for (size_t i = 0; i < nrows; i++) {
+      if (!BitmapTest(sel, i)) continue;
+      if ((nullable && !BitmapTest(non_null, i)) || !pred(cells[i])) {
+        BitmapClear(sel, i);
+      }
+    }
+    return;
+  }
+
+  for (size_t byte = 0; byte * 8 < nrows; byte++) {
+    size_t base = byte * 8;
+    size_t n = nrows - base < 8 ? nrows - base : 8;
+    // Bits past the last row are kept as they are.
+    uint8_t mask = static_cast<uint8_t>(0xff << n);
+    for (size_t j = 0; j < n; j++) {
+      mask |= static_cast<uint8_t>(pred(cells[base + j])) << j;
+    }
+    if (nullable) {
+      mask &= non_null[byte] | static_cast<uint8_t>(0xff << n);
+    }
+    sel[byte] &= mask;
+  }
+}
+
+template<class T>
+IR_ALWAYS_INLINE static void EvaluateRange(
+    RowBlock* block, uint64_t col, bool nullable,
+    bool has_lower, const void* lower, bool has_upper, const void* upper) {
+  const T* lower_val = reinterpret_cast<const T*>(lower);
+  const T* upper_val = reinterpret_cast<const T*>(upper);
+  EvaluateCells<T>(block, col, nullable, [&](const T& cell) {
+      return (!has_lower || !CellLess(cell, *lower_val)) &&
+             (!has_upper || CellLess(cell, *upper_val));
+    });
+}
+
+template<class T>
+IR_ALWAYS_INLINE static void EvaluateEquality(
+    RowBlock* block, uint64_t col, bool nullable, const void* value) {
+  const T* val = reinterpret_cast<const T*>(value);
+  EvaluateCells<T>(block, col, nullable, [&](const T& cell) {
+      return !CellLess(cell, *val) && !CellLess(*val, cell);
+    });
+}
+
 extern "C" {
 
 // Preface all used functions with _Precompiled to avoid the possibility
@@ -160,5 +264,180 @@ IR_ALWAYS_INLINE void _PrecompiledCopyCellToRowBlockSetNull(
   dst->cell(col).set_null(is_null);
 }
 
+// declare i32 @_PrecompiledCompare<Type>Cells(
+//   RowBlockRow* %lhs, RowBlockRow* %rhs, i64 <column index>)
+//
+//   Compares the (non-null) cells of column 'col' in the rows 'lhs' and
+//   'rhs', which must both be of physical type <Type>. Returns a negative,
+//   zero or positive value as the left cell sorts before, equal to or after
+//   the right one. Used by the generated key comparison functions.
+#define PRECOMPILED_COMPARE_CELLS(Type, CType)                          \
+  IR_ALWAYS_INLINE int _PrecompiledCompare##Type##Cells(                \
+      const RowBlockRow* lhs, const RowBlockRow* rhs, uint64_t col) {   \
+    return CompareCells<CType>(lhs, rhs, col);                          \
+  }
+
+PRECOMPILED_COMPARE_CELLS(UInt8, uint8_t)
+PRECOMPILED_COMPARE_CELLS(Int8, int8_t)
+PRECOMPILED_COMPARE_CELLS(UInt16, uint16_t)
+PRECOMPILED_COMPARE_CELLS(Int16, int16_t)
+PRECOMPILED_COMPARE_CELLS(UInt32, uint32_t)
+PRECOMPILED_COMPARE_CELLS(Int32, int32_t)
+PRECOMPILED_COMPARE_CELLS(UInt64, uint64_t)
+PRECOMPILED_COMPARE_CELLS(Int64, int64_t)
+PRECOMPILED_COMPARE_CELLS(Binary, Slice)
+
+#undef PRECOMPILED_COMPARE_CELLS
+
+// declare void @_PrecompiledEvaluate<Type>Range(
+//   RowBlock* %block, i64 <column index>, i1 <nullable>,
+//   i1 <has lower bound>, i8* %lower, i1 <has upper bound>, i8* %upper)
+//
+//   Deselects the rows of 'block' whose cell of column 'col', of physical
+//   type <Type>, is null or doesn't fall within [lower, upper). A missing
+//   bound is unbounded. Used by the generated predicate evaluators.
+//
+// declare void @_PrecompiledEvaluate<Type>Equality(
+//   RowBlock* %block, i64 <column index>, i1 <nullable>, i8* %value)
+//
+//   Same as above, but deselects the rows whose cell isn't equal to 'value'.
+#define PRECOMPILED_EVALUATE(Type, CType)                               \
+  IR_ALWAYS_INLINE void _PrecompiledEvaluate##Type##Range(              \
+      RowBlock* block, uint64_t col, bool nullable,                     \
+      bool has_lower, const void* lower, bool has_upper, const void* upper) { \
+    EvaluateRange<CType>(block, col, nullable, has_lower, lower,        \
+                         has_upper, upper);                             \
+  }                                                                     \
+  IR_ALWAYS_INLINE void _PrecompiledEvaluate##Type##Equality(           \
+      RowBlock* block, uint64_t col, bool nullable, const void* value) { \
+    EvaluateEquality<CType>(block, col, nullable, value);               \
+  }
+
+PRECOMPILED_EVALUATE(UInt8, uint8_t)
+PRECOMPILED_EVALUATE(Int8, int8_t)
+PRECOMPILED_EVALUATE(UInt16, uint16_t)
+PRECOMPILED_EVALUATE(Int16, int16_t)
+PRECOMPILED_EVALUATE(UInt32, uint32_t)
+PRECOMPILED_EVALUATE(Int32, int32_t)
+PRECOMPILED_EVALUATE(UInt64, uint64_t)
+PRECOMPILED_EVALUATE(Int64, int64_t)
+PRECOMPILED_EVALUATE(Float, float)
+PRECOMPILED_EVALUATE(Double, double)
+PRECOMPILED_EVALUATE(Bool, bool)
+PRECOMPILED_EVALUATE(Binary, Slice)
+
+#undef PRECOMPILED_EVALUATE
+
+// declare void @_PrecompiledEvaluateIsNotNull(
+//   RowBlock* %block, i64 <column index>)
+//
+//   Deselects the rows of 'block' whose cell of column 'col' is null. The
+//   column must be nullable.
+IR_ALWAYS_INLINE void _PrecompiledEvaluateIsNotNull(RowBlock* block, uint64_t col) {
+  uint8_t* sel = block->selection_vector()->mutable_bitmap();
+  const uint8_t* non_null = block->column_null_bitmap_ptr(col);
+  size_t nrows = block->nrows();
+  for (size_t byte = 0; byte * 8 < nrows; byte++) {
+    size_t n = nrows - byte * 8 < 8 ? nrows - byte * 8 : 8;
+    sel[byte] &= non_null[byte] | static_cast<uint8_t>(0xff << n);
+  }
+}
+
+// declare void @_PrecompiledEvaluateIsNull(
+//   RowBlock* %block, i64 <column index>)
+//
+//   Deselects the rows of 'block' whose cell of column 'col' isn't null.
+//   The column must be nullable.
+IR_ALWAYS_INLINE void _PrecompiledEvaluateIsNull(RowBlock* block, uint64_t col) {
+  uint8_t* sel = block->selection_vector()->mutable_bitmap();
+  const uint8_t* non_null = block->column_null_bitmap_ptr(col);
+  size_t nrows = block->nrows();
+  for (size_t byte = 0; byte * 8 < nrows; byte++) {
+    size_t n = nrows - byte * 8 < 8 ? nrows - byte * 8 : 8;
+    sel[byte] &= ~non_null[byte] | static_cast<uint8_t>(0xff << n);
+  }
+}
+
+// declare i32 @_PrecompiledApplyUpdate(
+//   ColumnBlock* %dst, i64 %row_idx, i1 %is_null, i8* %value, i64 %size,
+//   i64 <cell size>, i1 <nullable>, i1 <is binary>, Arena* %arena)
+//
+//   Writes the decoded column update of 'size' bytes at 'value' (or NULL,
+//   if 'is_null' is true) to the cell 'row_idx' of 'dst', relocating binary
+//   values to 'arena' unless it's NULL. Returns 0 upon success, 1 if the
+//   update isn't valid for the column, and 2 if relocation fails for lack
+//   of memory. Used by the generated change list appliers.
+IR_ALWAYS_INLINE int32_t _PrecompiledApplyUpdate(
+    ColumnBlock* dst, uint64_t row_idx, bool is_null, const uint8_t* value,
+    uint64_t size, uint64_t cell_size, bool nullable, bool is_binary, Arena* arena) {
+  if (is_null) {
+    if (!nullable) return 1;
+    BitmapClear(dst->null_bitmap(), row_idx);
+    return 0;
+  }
+  if (!is_binary && size != cell_size) return 1;
+  if (nullable) {
+    BitmapSet(dst->null_bitmap(), row_idx);
+  }
+  uint8_t* cell = dst->data() + row_idx * cell_size;
+  if (is_binary) {
+    Slice val(value, size);
+    if (arena != nullptr) {
+      return arena->RelocateSlice(val, reinterpret_cast<Slice*>(cell)) ? 0 : 2;
+    }
+    memcpy(cell, &val, sizeof(val));
+    return 0;
+  }
+  memcpy(cell, value, cell_size);
+  return 0;
+}
+
+// The type of the generated functions which apply a single decoded column
+// update (see _PrecompiledApplyChangeList).
+typedef int32_t (*ApplyColumnUpdateFunction)(
+    uint32_t col_id, bool is_null, const uint8_t* value, uint64_t size,
+    uint64_t col_idx, ColumnBlock* dst, uint64_t row_idx, Arena* arena);
+
+// declare i32 @_PrecompiledApplyChangeList(
+//   i8* %data, i64 %size, i64 %col_idx, ColumnBlock* %dst, i64 %row_idx,
+//   Arena* %arena, ApplyColumnUpdateFunction <apply>)
+//
+//   Decodes the column updates encoded in the 'size' bytes at 'data' (the
+//   body of an update or reinsert RowChangeList, after its type), and
+//   passes each of them to the generated 'apply' function, which writes it
+//   to 'dst' if it's an update to the projected column 'col_idx'. Since
+//   'apply' is a constant, it is inlined. Returns 0 upon success, or the
+//   first non-zero value returned by 'apply', or 1 if the change list is
+//   malformed.
+IR_ALWAYS_INLINE int32_t _PrecompiledApplyChangeList(
+    const uint8_t* data, uint64_t size, uint64_t col_idx, ColumnBlock* dst,
+    uint64_t row_idx, Arena* arena, ApplyColumnUpdateFunction apply) {
+  const uint8_t* limit = data + size;
+  while (data != limit) {
+    uint32_t col_id;
+    uint32_t value_size;
+    data = GetVarint32Ptr(data, limit, &col_id);
+    if (data == nullptr) return 1;
+    data = GetVarint32Ptr(data, limit, &value_size);
+    if (data == nullptr) return 1;
+    bool is_null = value_size == 0;
+    if (!is_null) {
+      value_size--;
+      if (static_cast<uint64_t>(limit - data) < value_size) return 1;
+    }
+    int32_t ret = apply(col_id, is_null, data, value_size, col_idx, dst, row_idx, arena);
+    if (ret != 0) return ret;
+    data += value_size;
+  }
+  return 0;
+}
+
+// declare i1 @_PrecompiledAnySelected(RowBlock* %block)
+//
+//   Returns whether any row of 'block' is still selected.
+IR_ALWAYS_INLINE bool _PrecompiledAnySelected(RowBlock* block) {
+  return block->selection_vector()->AnySelected();
+}
+
 } // extern "C"
 } // namespace kudu
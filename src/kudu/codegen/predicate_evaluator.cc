@@ -0,0 +1,346 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#include "kudu/codegen/predicate_evaluator.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+#include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/IR/Argument.h>
+#include <llvm/IR/BasicBlock.h>
+#include <llvm/IR/Constants.h>
+#include <llvm/IR/Function.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/Module.h>
+#include <llvm/IR/Type.h>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/codegen/module_builder.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/gutil/strings/strcat.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class LLVMContext;
+} // namespace llvm
+
+using llvm::Argument;
+using llvm::BasicBlock;
+using llvm::Function;
+using llvm::FunctionType;
+using llvm::LLVMContext;
+using llvm::PointerType;
+using llvm::Type;
+using llvm::Value;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+DECLARE_bool(codegen_dump_functions);
+
+namespace kudu {
+namespace codegen {
+
+namespace {
+
+// Returns the name of the type in the names of the precompiled functions
+// which evaluate predicates over cells of the given physical type, or
+// NotSupported if there are none.
+Status GetEvaluateTypeName(DataType physical_type, string* name) {
+  switch (physical_type) {
+    case UINT8:  *name = "UInt8"; break;
+    case INT8:   *name = "Int8"; break;
+    case UINT16: *name = "UInt16"; break;
+    case INT16:  *name = "Int16"; break;
+    case UINT32: *name = "UInt32"; break;
+    case INT32:  *name = "Int32"; break;
+    case UINT64: *name = "UInt64"; break;
+    case INT64:  *name = "Int64"; break;
+    case FLOAT:  *name = "Float"; break;
+    case DOUBLE: *name = "Double"; break;
+    case BOOL:   *name = "Bool"; break;
+    case BINARY: *name = "Binary"; break;
+    default:
+      return Status::NotSupported("no code-generated predicate evaluation for column type",
+                                  DataType_Name(physical_type));
+  }
+  return Status::OK();
+}
+
+// Loads the bound at index 'idx' of the 'bounds' array, or returns a null
+// pointer constant if 'present' is false.
+Value* LoadBound(ModuleBuilder::LLVMBuilder* builder, Value* bounds, size_t idx,
+                 bool present, const string& name) {
+  if (!present) {
+    return llvm::ConstantPointerNull::get(builder->getInt8PtrTy());
+  }
+  Value* bound = builder->CreateLoad(builder->CreateConstGEP1_64(bounds, idx));
+  bound->setName(name);
+  return bound;
+}
+
+// Generates a predicate evaluation function of the form:
+// void(RowBlock* block, i8** bounds)
+// which deselects the rows of 'block' which don't satisfy all of the
+// predicates of the given shapes, whose bounds are in 'bounds'.
+Status MakeEvaluation(const string& name,
+                      ModuleBuilder* mbuilder,
+                      const vector<PredicateShape>& shapes,
+                      Function** out) {
+  // Get the IRBuilder
+  ModuleBuilder::LLVMBuilder* builder = mbuilder->builder();
+  LLVMContext& context = builder->getContext();
+
+  if (shapes.empty()) {
+    return Status::InvalidArgument("no predicates to evaluate");
+  }
+
+  // Look up the per-predicate evaluation functions up front so that an
+  // unsupported type fails before any IR is emitted. Null checks on
+  // non-nullable columns are no-ops and have no function.
+  vector<Function*> evaluate;
+  for (const PredicateShape& shape : shapes) {
+    string fname;
+    switch (shape.predicate_type) {
+      case PredicateType::Range:
+      case PredicateType::Equality: {
+        string type_name;
+        RETURN_NOT_OK(GetEvaluateTypeName(shape.physical_type, &type_name));
+        fname = StrCat("_PrecompiledEvaluate", type_name,
+                       shape.predicate_type == PredicateType::Range ? "Range" : "Equality");
+        break;
+      }
+      case PredicateType::IsNotNull:
+        if (shape.nullable) fname = "_PrecompiledEvaluateIsNotNull";
+        break;
+      case PredicateType::IsNull:
+        if (!shape.nullable) {
+          return Status::InvalidArgument("IS NULL predicate on a non-nullable column");
+        }
+        fname = "_PrecompiledEvaluateIsNull";
+        break;
+      default:
+        return Status::NotSupported("no code-generated evaluation for predicate type");
+    }
+    evaluate.push_back(fname.empty() ? nullptr : mbuilder->GetFunction(fname));
+  }
+  Function* any_selected = mbuilder->GetFunction("_PrecompiledAnySelected");
+
+  // Create the function after providing a declaration
+  Type* rblock_type = PointerType::getUnqual(mbuilder->GetType("class.kudu::RowBlock"));
+  Type* bounds_type = PointerType::getUnqual(builder->getInt8PtrTy());
+  vector<Type*> argtypes = { rblock_type, bounds_type };
+  FunctionType* fty = FunctionType::get(Type::getVoidTy(context), argtypes, false);
+  Function* f = mbuilder->Create(fty, name);
+
+  // Get the function's Arguments
+  Function::arg_iterator it = f->arg_begin();
+  Argument* block = &*it++;
+  Argument* bounds = &*it++;
+  DCHECK(it == f->arg_end());
+
+  // Give names to the arguments for debugging IR.
+  block->setName("block");
+  bounds->setName("bounds");
+
+  // Evaluate function in IR (note: values in angle brackets are
+  // constants whose values are determined right now, at JIT time).
+  //
+  // define void @name(RowBlock* %block, i8** %bounds)
+  // entry:
+  //   <for each predicate i>
+  //     %lower<i> = load i8*, i8** (getelementptr i8*, i8** %bounds, i64 <2 * i>)
+  //     %upper<i> = load i8*, i8** (getelementptr i8*, i8** %bounds, i64 <2 * i + 1>)
+  //     call void @<evaluate function for predicate type and column type>(
+  //       RowBlock* %block, i64 <column index>, i1 <nullable>, <bounds>...)
+  //     <unless this is the last predicate>
+  //       %any<i> = call i1 @_PrecompiledAnySelected(RowBlock* %block)
+  //       br i1 %any<i>, label %pred<i + 1>, label %done
+  //     pred<i + 1>:
+  //   <end implicit for each>
+  //   br label %done
+  // done:
+  //   ret void
+  builder->SetInsertPoint(BasicBlock::Create(context, "entry", f));
+  BasicBlock* done = BasicBlock::Create(context, "done");
+  for (size_t i = 0; i < shapes.size(); i++) {
+    const PredicateShape& shape = shapes[i];
+    if (evaluate[i] != nullptr) {
+      vector<Value*> args = { block, builder->getInt64(shape.col_idx) };
+      switch (shape.predicate_type) {
+        case PredicateType::Range:
+          args.push_back(builder->getInt1(shape.nullable));
+          args.push_back(builder->getInt1(shape.has_lower));
+          args.push_back(LoadBound(builder, bounds, 2 * i, shape.has_lower,
+                                   StrCat("lower", i)));
+          args.push_back(builder->getInt1(shape.has_upper));
+          args.push_back(LoadBound(builder, bounds, 2 * i + 1, shape.has_upper,
+                                   StrCat("upper", i)));
+          break;
+        case PredicateType::Equality:
+          args.push_back(builder->getInt1(shape.nullable));
+          args.push_back(LoadBound(builder, bounds, 2 * i, true, StrCat("value", i)));
+          break;
+        default:
+          break;
+      }
+      builder->CreateCall(evaluate[i], args);
+    }
+
+    if (i + 1 == shapes.size()) {
+      builder->CreateBr(done);
+      break;
+    }
+    vector<Value*> any_args = { block };
+    Value* any = builder->CreateCall(any_selected, any_args);
+    any->setName(StrCat("any", i));
+    BasicBlock* next = BasicBlock::Create(context, StrCat("pred", i + 1), f);
+    builder->CreateCondBr(any, next, done);
+    builder->SetInsertPoint(next);
+  }
+
+  done->insertInto(f);
+  builder->SetInsertPoint(done);
+  builder->CreateRetVoid();
+
+  if (FLAGS_codegen_dump_functions) {
+    LOG(INFO) << "Dumping predicate evaluation:";
+    f->dump();
+  }
+
+  *out = f;
+  return Status::OK();
+}
+
+// Convenience method which appends to a faststring
+template<typename T>
+void AddNext(faststring* fs, const T& val) {
+  fs->append(&val, sizeof(T));
+}
+
+} // anonymous namespace
+
+PredicateEvaluatorFunctions::PredicateEvaluatorFunctions(vector<PredicateShape> shapes,
+                                                         EvaluateFunction evaluate_f,
+                                                         unique_ptr<JITCodeOwner> owner)
+  : JITWrapper(std::move(owner)),
+    shapes_(std::move(shapes)),
+    evaluate_f_(evaluate_f) {
+  CHECK(evaluate_f != nullptr)
+    << "Promise to compile evaluate function not fulfilled by ModuleBuilder";
+}
+
+Status PredicateEvaluatorFunctions::Create(const vector<PredicateShape>& shapes,
+                                           scoped_refptr<PredicateEvaluatorFunctions>* out,
+                                           llvm::TargetMachine** tm) {
+  ModuleBuilder builder;
+  RETURN_NOT_OK(builder.Init());
+
+  Function* evaluate;
+  RETURN_NOT_OK(MakeEvaluation("PredicateEvaluate", &builder, shapes, &evaluate));
+
+  faststring key;
+  RETURN_NOT_OK(EncodeKey(shapes, &key));
+  builder.SetObjectCacheKey(Slice(key));
+
+  // Have the ModuleBuilder accept a promise to compile the function
+  EvaluateFunction evaluate_f;
+  builder.AddJITPromise(evaluate, &evaluate_f);
+
+  unique_ptr<JITCodeOwner> owner;
+  RETURN_NOT_OK(builder.Compile(&owner));
+
+  if (tm) {
+    *tm = builder.GetTargetMachine();
+  }
+  out->reset(new PredicateEvaluatorFunctions(shapes, evaluate_f, std::move(owner)));
+  return Status::OK();
+}
+
+Status PredicateEvaluatorFunctions::GetShapes(const Schema& projection,
+                                              const vector<ColumnPredicate>& predicates,
+                                              vector<PredicateShape>* shapes) {
+  shapes->clear();
+  for (const ColumnPredicate& pred : predicates) {
+    switch (pred.predicate_type()) {
+      case PredicateType::Range:
+      case PredicateType::Equality:
+      case PredicateType::IsNotNull:
+      case PredicateType::IsNull:
+        break;
+      default:
+        return Status::NotSupported("no code-generated evaluation for predicate",
+                                    pred.ToString());
+    }
+    int col_idx = projection.find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      return Status::NotFound("predicate column not in projection", pred.ToString());
+    }
+    const ColumnSchema& col = projection.column(col_idx);
+    if (pred.predicate_type() == PredicateType::IsNull && !col.is_nullable()) {
+      return Status::NotSupported("IS NULL predicate on a non-nullable column",
+                                  pred.ToString());
+    }
+    PredicateShape shape;
+    shape.col_idx = col_idx;
+    shape.physical_type = col.type_info()->physical_type();
+    shape.nullable = col.is_nullable();
+    shape.predicate_type = pred.predicate_type();
+    shape.has_lower = pred.raw_lower() != nullptr;
+    shape.has_upper = pred.raw_upper() != nullptr;
+    shapes->push_back(shape);
+  }
+  return Status::OK();
+}
+
+// Generates a key for a sequence of predicate shapes which is unique
+// according to the criteria defined in the CodeCache class' block comment.
+// The shapes are encoded as follows, in sequence.
+//
+// (4 bytes) unique type identifier for PredicateEvaluatorFunctions
+// (8 bytes) number, as unsigned long, of predicates
+// for each predicate, in order:
+//   (8 bytes) column index in the projection
+//   (4 bytes) column physical type
+//   (4 bytes) predicate type
+//   (1 byte each) whether the column is nullable, and whether the predicate
+//                 has a lower and an upper bound
+//
+// Writes to 'out' upon success.
+Status PredicateEvaluatorFunctions::EncodeKey(const vector<PredicateShape>& shapes,
+                                              faststring* out) {
+  AddNext(out, JITWrapper::PREDICATE_EVALUATOR);
+  AddNext(out, shapes.size());
+  for (const PredicateShape& shape : shapes) {
+    AddNext(out, shape.col_idx);
+    AddNext(out, shape.physical_type);
+    AddNext(out, static_cast<int32_t>(shape.predicate_type));
+    AddNext(out, shape.nullable);
+    AddNext(out, shape.has_lower);
+    AddNext(out, shape.has_upper);
+  }
+  return Status::OK();
+}
+
+} // namespace codegen
+} // namespace kudu
@@ -0,0 +1,143 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CODEGEN_PREDICATE_EVALUATOR_H
+#define KUDU_CODEGEN_PREDICATE_EVALUATOR_H
+
+#include <memory>
+#include <vector>
+
+#include "kudu/codegen/jit_wrapper.h"
+#include "kudu/common/column_predicate.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/status.h"
+
+namespace llvm {
+class TargetMachine;
+} // namespace llvm
+
+namespace kudu {
+
+class faststring;
+
+namespace codegen {
+
+// The part of a column predicate which the code generated to evaluate it
+// depends on: which column of the projection it applies to, the column's
+// type, and the kind of predicate. The bounds themselves are passed to the
+// generated code when it is called, so that scans whose predicates only
+// differ by their values share the same code.
+struct PredicateShape {
+  size_t col_idx;
+  DataType physical_type;
+  bool nullable;
+  PredicateType predicate_type;
+  bool has_lower;
+  bool has_upper;
+};
+
+// The JITWrapper for codegen::PredicateEvaluator functions. Contains the
+// compiled evaluation function as well as the predicate shapes used to
+// generate it.
+//
+// The generated function evaluates the conjunction of the predicates over a
+// RowBlock in turn, with the column index, cell type and nullability of each
+// predicate baked in as constants, and stops as soon as no row remains
+// selected. This replaces the per-predicate type dispatch and the per-row
+// indirect comparisons done by ColumnPredicate::Evaluate().
+class PredicateEvaluatorFunctions : public JITWrapper {
+ public:
+  // Compiles the evaluation function for the given predicate shapes.
+  // Writes the llvm::TargetMachine* used to 'tm' (if not NULL)
+  // and the function to 'out' upon success.
+  static Status Create(const std::vector<PredicateShape>& shapes,
+                       scoped_refptr<PredicateEvaluatorFunctions>* out,
+                       llvm::TargetMachine** tm = NULL);
+
+  // Computes in 'shapes' the shapes of 'predicates', evaluated over row
+  // blocks of the 'projection' schema.
+  //
+  // Returns NotSupported if some predicate is of a kind that the code
+  // generator does not handle, and NotFound if its column isn't part of the
+  // projection.
+  static Status GetShapes(const Schema& projection,
+                          const std::vector<ColumnPredicate>& predicates,
+                          std::vector<PredicateShape>* shapes);
+
+  const std::vector<PredicateShape>& shapes() const { return shapes_; }
+
+  // The generated function takes the row block to evaluate the predicates
+  // over and, for each predicate in order, its lower bound (or equality
+  // value) followed by its upper bound.
+  typedef void(*EvaluateFunction)(RowBlock*, const void* const*);
+  EvaluateFunction evaluate() const { return evaluate_f_; }
+
+  virtual Status EncodeOwnKey(faststring* out) OVERRIDE {
+    return EncodeKey(shapes_, out);
+  }
+
+  static Status EncodeKey(const std::vector<PredicateShape>& shapes,
+                          faststring* out);
+
+ private:
+  PredicateEvaluatorFunctions(std::vector<PredicateShape> shapes,
+                              EvaluateFunction evaluate_f,
+                              std::unique_ptr<JITCodeOwner> owner);
+
+  const std::vector<PredicateShape> shapes_;
+  const EvaluateFunction evaluate_f_;
+};
+
+// Evaluates a conjunction of column predicates over row blocks using a
+// code-generated function. Behaves the same as evaluating each predicate with
+// ColumnPredicate::Evaluate(), in order, for row blocks of a schema in which
+// the predicates have the same shapes as those used to create 'functions'.
+//
+// The values referenced by the predicates must outlive the evaluator.
+class PredicateEvaluator {
+ public:
+  PredicateEvaluator(const scoped_refptr<PredicateEvaluatorFunctions>& functions,
+                     const std::vector<ColumnPredicate>& predicates)
+    : functions_(functions),
+      evaluate_f_(functions->evaluate()) {
+    DCHECK_EQ(predicates.size(), functions->shapes().size());
+    for (const ColumnPredicate& pred : predicates) {
+      bounds_.push_back(pred.raw_lower());
+      bounds_.push_back(pred.raw_upper());
+    }
+  }
+
+  // Deselects the rows of 'block' which don't satisfy all of the predicates.
+  void Evaluate(RowBlock* block) const {
+    if (block->nrows() == 0) return;
+    evaluate_f_(block, bounds_.data());
+  }
+
+ private:
+  scoped_refptr<PredicateEvaluatorFunctions> functions_;
+  const PredicateEvaluatorFunctions::EvaluateFunction evaluate_f_;
+  std::vector<const void*> bounds_;
+
+  DISALLOW_COPY_AND_ASSIGN(PredicateEvaluator);
+};
+
+} // namespace codegen
+} // namespace kudu
+
+#endif
@@ -281,6 +281,12 @@ Status RowProjectorFunctions::Create(const Schema& base_schema,
   Function* read = MakeProjection<true>("ProjRead", &builder, no_codegen);
   Function* write = MakeProjection<false>("ProjWrite", &builder, no_codegen);
 
+  // Projections with default values embed pointers to them, so they won't be
+  // cached (see ModuleBuilder::GetPointerValue()).
+  faststring key;
+  RETURN_NOT_OK(EncodeKey(base_schema, projection, &key));
+  builder.SetObjectCacheKey(Slice(key));
+
   // Have the ModuleBuilder accept promises to compile the functions
   ProjectionFunction read_f, write_f;
   builder.AddJITPromise(read, &read_f);
@@ -17,6 +17,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include "kudu/common/column_predicate.h"
 #include "kudu/common/columnblock.h"
 
@@ -38,14 +40,17 @@ class ColumnMaterializationContext {
       pred_(pred),
       block_(block),
       sel_(sel),
-      decoder_eval_status_(kNotSet) {
+      decoder_eval_status_(kNotSet),
+      zero_copy_allowed_(false),
+      skip_deselected_allowed_(false),
+      external_data_(nullptr) {
       if (!pred_ || !sel || !block) {
         decoder_eval_status_ = kDecoderEvalNotSupported;
       }
   }
 
   // Column index in within the projection schema, not the underlying schema.
-  const size_t col_idx() { return col_idx_; }
+  const size_t col_idx() const { return col_idx_; }
 
   // Predicate being evaluated.
   const ColumnPredicate* pred() { return pred_; }
@@ -104,6 +109,38 @@ class ColumnMaterializationContext {
     decoder_eval_status_ = kDecoderEvalNotSupported;
   }
 
+  // Whether the column iterator may leave the values for this batch in
+  // memory it already holds (see SetExternalData()) instead of copying them
+  // into block(). Only allowed by the owner of the destination RowBlock, and
+  // only if nothing will modify the values after they're materialized.
+  bool zero_copy_allowed() const { return zero_copy_allowed_; }
+  void set_zero_copy_allowed(bool allowed) { zero_copy_allowed_ = allowed; }
+
+  // Whether the column iterator may skip materializing the rows which are
+  // already unselected in sel(), leaving their cells in block() unspecified.
+  // Only allowed if nothing will read the cells of unselected rows.
+  bool skip_deselected_allowed() const { return skip_deselected_allowed_; }
+  void set_skip_deselected_allowed(bool allowed) { skip_deselected_allowed_ = allowed; }
+
+  // Called by a column iterator which, rather than copying the values into
+  // block(), left them at 'data', laid out exactly as they would have been in
+  // block(). 'pin' keeps 'data' alive for as long as it's held. The null
+  // bitmap, if any, is still filled in within block().
+  //
+  // Only allowed if zero_copy_allowed() is true.
+  void SetExternalData(const uint8_t* data, std::shared_ptr<const void> pin) {
+    DCHECK(zero_copy_allowed_);
+    external_data_ = data;
+    external_data_pin_ = std::move(pin);
+  }
+
+  // The data set by SetExternalData(), or nullptr if the values were copied
+  // into block().
+  const uint8_t* external_data() const { return external_data_; }
+  const std::shared_ptr<const void>& external_data_pin() const {
+    return external_data_pin_;
+  }
+
  private:
   enum DecoderEvalStatus {
     // During scan, will try to evaluate with the decoder, after which the
@@ -132,6 +169,13 @@ class ColumnMaterializationContext {
   SelectionVector* const sel_;
 
   DecoderEvalStatus decoder_eval_status_;
+
+  bool zero_copy_allowed_;
+
+  bool skip_deselected_allowed_;
+
+  const uint8_t* external_data_;
+  std::shared_ptr<const void> external_data_pin_;
 };
 
 } // namespace kudu
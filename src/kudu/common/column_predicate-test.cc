@@ -17,14 +17,22 @@
 
 #include "kudu/common/column_predicate.h"
 
+#include <limits>
 #include <vector>
 
 #include <gflags/gflags_declare.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/column_predicate_kernels.h"
+#include "kudu/common/columnblock.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/random.h"
+#include "kudu/util/random_util.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/test_util.h"
 
 DECLARE_bool(log_redact_user_data);
@@ -1085,6 +1093,296 @@ TEST_F(TestColumnPredicate, TestSelectivity) {
             0);
 }
 
+// Test that a predicate is only reported as unable to match a range of values
+// when none of the values in the range can satisfy it.
+TEST_F(TestColumnPredicate, TestMayMatchRange) {
+  ColumnSchema column("c", INT32, true);
+  int32_t five = 5;
+  int32_t seven = 7;
+  int32_t ten = 10;
+  int32_t twenty = 20;
+
+  // Equality.
+  ASSERT_TRUE(ColumnPredicate::Equality(column, &five).MayMatchRange(&five, &ten));
+  ASSERT_TRUE(ColumnPredicate::Equality(column, &ten).MayMatchRange(&five, &ten));
+  ASSERT_TRUE(ColumnPredicate::Equality(column, &seven).MayMatchRange(&five, &ten));
+  ASSERT_FALSE(ColumnPredicate::Equality(column, &twenty).MayMatchRange(&five, &ten));
+  ASSERT_FALSE(ColumnPredicate::Equality(column, &five).MayMatchRange(&seven, &ten));
+
+  // Range, with an exclusive upper bound.
+  ASSERT_TRUE(ColumnPredicate::Range(column, &seven, &twenty).MayMatchRange(&five, &ten));
+  ASSERT_TRUE(ColumnPredicate::Range(column, &ten, &twenty).MayMatchRange(&five, &ten));
+  ASSERT_FALSE(ColumnPredicate::Range(column, &five, &seven).MayMatchRange(&seven, &ten));
+  ASSERT_TRUE(ColumnPredicate::Range(column, &five, &seven).MayMatchRange(&five, &ten));
+  ASSERT_FALSE(ColumnPredicate::Range(column, &twenty, nullptr).MayMatchRange(&five, &ten));
+  ASSERT_TRUE(ColumnPredicate::Range(column, nullptr, &seven).MayMatchRange(&five, &ten));
+  ASSERT_FALSE(ColumnPredicate::Range(column, nullptr, &five).MayMatchRange(&five, &ten));
+
+  // InList.
+  vector<const void*> values = { &five, &twenty };
+  ASSERT_FALSE(ColumnPredicate::InList(column, &values).MayMatchRange(&seven, &ten));
+  values = { &five, &twenty };
+  ASSERT_TRUE(ColumnPredicate::InList(column, &values).MayMatchRange(&five, &ten));
+  values = { &five, &seven, &twenty };
+  ASSERT_TRUE(ColumnPredicate::InList(column, &values).MayMatchRange(&seven, &ten));
+
+  // Null predicates.
+  ASSERT_TRUE(ColumnPredicate::IsNotNull(column).MayMatchRange(&five, &ten));
+  ASSERT_FALSE(ColumnPredicate::IsNull(column).MayMatchRange(&five, &ten));
+
+  // Strings.
+  ColumnSchema column_s("s", STRING, true);
+  Slice a("a");
+  Slice b("b");
+  Slice c("c");
+  ASSERT_TRUE(ColumnPredicate::Range(column_s, &b, &c).MayMatchRange(&a, &b));
+  ASSERT_FALSE(ColumnPredicate::Range(column_s, &c, nullptr).MayMatchRange(&a, &b));
+}
+
+// Test that an IN BLOOM FILTER predicate matches the values added to its
+// filter within its bounds, and that it is simplified and merged correctly.
+TEST_F(TestColumnPredicate, TestInBloomFilter) {
+  ColumnSchema column("c", INT32, true);
+  BloomFilterBuilder builder(BloomFilterSizing::ByCountAndFPRate(100, 0.01)
+                                 .WithLayout(BloomFilterLayout::kBlocked));
+  for (int32_t i = 0; i < 200; i += 2) {
+    builder.AddKey(BloomKeyProbe(ColumnPredicate::BloomFilterKey(column, &i)));
+  }
+  const Slice filter = builder.slice();
+
+  // Every 50th cell is null, and so never matches.
+  const int kNumRows = 1000;
+  ScopedColumnBlock<INT32> block(kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    block[i] = i;
+    block.SetCellIsNull(i, i % 50 == 0);
+  }
+  SelectionVector sel(kNumRows);
+
+  vector<Slice> filters = { filter };
+  ColumnPredicate unbounded = ColumnPredicate::InBloomFilter(column, &filters, nullptr, nullptr);
+  ASSERT_EQ(PredicateType::InBloomFilter, unbounded.predicate_type());
+  ASSERT_EQ("`c` IN 1 BLOOM FILTER(S)", unbounded.ToString());
+  sel.SetAllTrue();
+  unbounded.Evaluate(block, &sel);
+  int false_positives = 0;
+  for (int i = 0; i < kNumRows; i++) {
+    if (i % 50 == 0) {
+      ASSERT_FALSE(sel.IsRowSelected(i)) << i;
+    } else if (i < 200 && i % 2 == 0) {
+      ASSERT_TRUE(sel.IsRowSelected(i)) << i;
+      ASSERT_TRUE(unbounded.EvaluateCell<INT32>(&block[i])) << i;
+    } else if (sel.IsRowSelected(i)) {
+      false_positives++;
+    }
+  }
+  // The filter was sized for a false positive rate of about 1%.
+  ASSERT_LT(false_positives, 50);
+
+  // The bounds rule out any false positives beyond them.
+  int32_t zero = 0;
+  int32_t four = 4;
+  int32_t five = 5;
+  int32_t ten = 10;
+  int32_t twenty = 20;
+  int32_t two_hundred = 200;
+  int32_t three_hundred = 300;
+  int32_t thousand = 1000;
+  filters = { filter };
+  ColumnPredicate bounded = ColumnPredicate::InBloomFilter(column, &filters, &zero, &two_hundred);
+  ASSERT_EQ("`c` IN 1 BLOOM FILTER(S) AND `c` >= 0 AND `c` < 200", bounded.ToString());
+  sel.SetAllTrue();
+  bounded.Evaluate(block, &sel);
+  for (int i = 200; i < kNumRows; i++) {
+    ASSERT_FALSE(sel.IsRowSelected(i)) << i;
+  }
+  ASSERT_TRUE(bounded.MayMatchRange(&ten, &twenty));
+  ASSERT_FALSE(bounded.MayMatchRange(&two_hundred, &thousand));
+
+  // Simplification.
+  filters = {};
+  ASSERT_EQ(PredicateType::Range,
+            ColumnPredicate::InBloomFilter(column, &filters, &zero, &ten).predicate_type());
+  filters = {};
+  ASSERT_EQ(PredicateType::IsNotNull,
+            ColumnPredicate::InBloomFilter(column, &filters, nullptr, nullptr).predicate_type());
+  filters = { filter };
+  ASSERT_EQ(PredicateType::None,
+            ColumnPredicate::InBloomFilter(column, &filters, &ten, &ten).predicate_type());
+  filters = { filter };
+  ColumnPredicate single = ColumnPredicate::InBloomFilter(column, &filters, &four, &five);
+  ASSERT_EQ(ColumnPredicate::Equality(column, &four), single);
+
+  // Merges.
+  TestMerge(bounded,
+            ColumnPredicate::Equality(column, &four),
+            ColumnPredicate::Equality(column, &four),
+            PredicateType::Equality);
+  TestMerge(bounded,
+            ColumnPredicate::Equality(column, &three_hundred),
+            ColumnPredicate::None(column),
+            PredicateType::None);
+
+  vector<const void*> values = { &four, &ten, &three_hundred };
+  vector<const void*> expected_values = { &four, &ten };
+  TestMerge(bounded,
+            ColumnPredicate::InList(column, &values),
+            ColumnPredicate::InList(column, &expected_values),
+            PredicateType::InList);
+
+  filters = { filter };
+  TestMerge(bounded,
+            ColumnPredicate::Range(column, &ten, &three_hundred),
+            ColumnPredicate::InBloomFilter(column, &filters, &ten, &two_hundred),
+            PredicateType::InBloomFilter);
+
+  filters = { filter, filter };
+  TestMerge(bounded,
+            unbounded,
+            ColumnPredicate::InBloomFilter(column, &filters, &zero, &two_hundred),
+            PredicateType::InBloomFilter);
+
+  TestMerge(bounded,
+            ColumnPredicate::IsNotNull(column),
+            bounded,
+            PredicateType::InBloomFilter);
+  TestMerge(bounded,
+            ColumnPredicate::IsNull(column),
+            ColumnPredicate::None(column),
+            PredicateType::None);
+  TestMerge(bounded,
+            ColumnPredicate::None(column),
+            ColumnPredicate::None(column),
+            PredicateType::None);
+}
+
+namespace {
+
+// Returns a small value of the given type, or occasionally a NaN for the
+// floating point types.
+template <DataType Type>
+typename DataTypeTraits<Type>::cpp_type RandomCellValue(Random* rng) {
+  typedef typename DataTypeTraits<Type>::cpp_type cpp_type;
+  if ((Type == FLOAT || Type == DOUBLE) && rng->Uniform(16) == 0) {
+    return std::numeric_limits<cpp_type>::quiet_NaN();
+  }
+  return static_cast<cpp_type>(static_cast<int>(rng->Uniform(20)) - 10);
+}
+
+// Evaluates predicates of every type supported by the batch kernels over a
+// block with some nulls and some rows already deselected, with both the SIMD
+// and the portable kernels, and checks the results against evaluating each
+// cell on its own.
+template <DataType Type>
+void TestBatchEvaluation() {
+  typedef typename DataTypeTraits<Type>::cpp_type cpp_type;
+  SCOPED_TRACE(GetTypeInfo(Type)->name());
+  Random rng(SeedRandom());
+  ColumnSchema column("c", Type, true);
+
+  // Not a multiple of the 32 rows of a kernel group, to cover the tail.
+  const int kNumRows = 1003;
+  ScopedColumnBlock<Type> block(kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    block[i] = RandomCellValue<Type>(&rng);
+    block.SetCellIsNull(i, rng.Uniform(10) == 0);
+  }
+  SelectionVector initial(kNumRows);
+  for (int i = 0; i < kNumRows; i++) {
+    if (rng.Uniform(8) == 0) {
+      initial.SetRowUnselected(i);
+    } else {
+      initial.SetRowSelected(i);
+    }
+  }
+
+  cpp_type lower = -3;
+  cpp_type upper = 4;
+  vector<cpp_type> small_list = { -5, 0, 3 };
+  vector<cpp_type> large_list;
+  for (int i = -9; i < 10; i += 2) {
+    large_list.push_back(i);
+  }
+  vector<const void*> small_values;
+  for (const auto& v : small_list) small_values.push_back(&v);
+  vector<const void*> large_values;
+  for (const auto& v : large_list) large_values.push_back(&v);
+
+  vector<ColumnPredicate> predicates = {
+    ColumnPredicate::Range(column, &lower, &upper),
+    ColumnPredicate::Range(column, &lower, nullptr),
+    ColumnPredicate::Range(column, nullptr, &upper),
+    ColumnPredicate::Equality(column, &lower),
+    ColumnPredicate::InList(column, &small_values),
+    ColumnPredicate::InList(column, &large_values),
+    ColumnPredicate::IsNull(column),
+    ColumnPredicate::IsNotNull(column),
+  };
+
+  for (bool allow_simd : { true, false }) {
+    predicate_kernels::SelectKernels(allow_simd);
+    SCOPED_TRACE(predicate_kernels::SelectedKernelName());
+    for (const auto& pred : predicates) {
+      SCOPED_TRACE(pred.ToString());
+      SelectionVector sel(kNumRows);
+      memcpy(sel.mutable_bitmap(), initial.bitmap(), BitmapSize(kNumRows));
+      pred.Evaluate(block, &sel);
+      for (int i = 0; i < kNumRows; i++) {
+        bool expected = initial.IsRowSelected(i) &&
+            (block.is_null(i) ? pred.predicate_type() == PredicateType::IsNull
+                              : pred.EvaluateCell<Type>(&block[i]));
+        ASSERT_EQ(expected, sel.IsRowSelected(i)) << i;
+      }
+    }
+  }
+  predicate_kernels::SelectKernels(true);
+}
+
+} // anonymous namespace
+
+TEST_F(TestColumnPredicate, TestBatchEvaluation) {
+  TestBatchEvaluation<INT8>();
+  TestBatchEvaluation<INT16>();
+  TestBatchEvaluation<INT32>();
+  TestBatchEvaluation<INT64>();
+  TestBatchEvaluation<FLOAT>();
+  TestBatchEvaluation<DOUBLE>();
+}
+
+// Micro-benchmark of the evaluation of a range predicate over an INT32
+// block, with the SIMD and the portable kernels.
+TEST_F(TestColumnPredicate, BenchmarkRangeEvaluation) {
+  const int kNumRows = 1024;
+  const int kNumIters = AllowSlowTests() ? 100000 : 1000;
+  ColumnSchema column("c", INT32, true);
+  ScopedColumnBlock<INT32> block(kNumRows);
+  Random rng(SeedRandom());
+  for (int i = 0; i < kNumRows; i++) {
+    block[i] = rng.Uniform(1000);
+    block.SetCellIsNull(i, false);
+  }
+  int32_t lower = 100;
+  int32_t upper = 600;
+  ColumnPredicate pred = ColumnPredicate::Range(column, &lower, &upper);
+  SelectionVector sel(kNumRows);
+
+  for (bool allow_simd : { true, false }) {
+    predicate_kernels::SelectKernels(allow_simd);
+    int64_t selected = 0;
+    LOG_TIMING(INFO, strings::Substitute("evaluating $0 rows with $1 kernels",
+                                         kNumRows * kNumIters,
+                                         predicate_kernels::SelectedKernelName())) {
+      for (int i = 0; i < kNumIters; i++) {
+        sel.SetAllTrue();
+        pred.Evaluate(block, &sel);
+        selected += sel.CountSelected();
+      }
+    }
+    ASSERT_GT(selected, 0);
+  }
+  predicate_kernels::SelectKernels(true);
+}
+
 TEST_F(TestColumnPredicate, TestRedaction) {
   FLAGS_log_redact_user_data = true;
   ColumnSchema column_i32("a", INT32, true);
@@ -20,10 +20,12 @@
 #include <algorithm>
 #include <utility>
 
+#include "kudu/common/column_predicate_kernels.h"
 #include "kudu/common/key_util.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
+#include "kudu/util/bloom_filter.h"
 #include "kudu/util/memory/arena.h"
 
 using std::move;
@@ -149,14 +151,33 @@ ColumnPredicate ColumnPredicate::IsNull(ColumnSchema column) {
          None(move(column));
 }
 
+ColumnPredicate ColumnPredicate::InBloomFilter(ColumnSchema column,
+                                               vector<Slice>* bloom_filters,
+                                               const void* lower,
+                                               const void* upper) {
+  CHECK(bloom_filters != nullptr);
+  ColumnPredicate pred(PredicateType::InBloomFilter, move(column), lower, upper);
+  pred.bloom_filters_.swap(*bloom_filters);
+  pred.Simplify();
+  return pred;
+}
+
 ColumnPredicate ColumnPredicate::None(ColumnSchema column) {
   return ColumnPredicate(PredicateType::None, move(column), nullptr, nullptr);
 }
 
+Slice ColumnPredicate::BloomFilterKey(const ColumnSchema& column, const void* value) {
+  if (column.type_info()->physical_type() == BINARY) {
+    return *static_cast<const Slice*>(value);
+  }
+  return Slice(static_cast<const uint8_t*>(value), column.type_info()->size());
+}
+
 void ColumnPredicate::SetToNone() {
   predicate_type_ = PredicateType::None;
   lower_ = nullptr;
   upper_ = nullptr;
+  bloom_filters_.clear();
 }
 
 void ColumnPredicate::Simplify() {
@@ -219,6 +240,36 @@ void ColumnPredicate::Simplify() {
       }
       return;
     };
+    case PredicateType::InBloomFilter: {
+      if (lower_ != nullptr && upper_ != nullptr) {
+        if (type_info->Compare(lower_, upper_) >= 0) {
+          // If the range bounds are empty then no results can be returned.
+          SetToNone();
+          return;
+        }
+        if (type_info->AreConsecutive(lower_, upper_)) {
+          // Only the lower bound can match, so check it against the filters.
+          if (CheckValueInBloomFilter(lower_)) {
+            predicate_type_ = PredicateType::Equality;
+            upper_ = nullptr;
+            bloom_filters_.clear();
+          } else {
+            SetToNone();
+          }
+          return;
+        }
+      }
+      if (bloom_filters_.empty()) {
+        // Without any filters, only the bounds remain.
+        if (lower_ == nullptr && upper_ == nullptr) {
+          predicate_type_ = PredicateType::IsNotNull;
+        } else {
+          predicate_type_ = PredicateType::Range;
+          Simplify();
+        }
+      }
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -247,10 +298,28 @@ void ColumnPredicate::Merge(const ColumnPredicate& other) {
       MergeIntoInList(other);
       return;
     };
+    case PredicateType::InBloomFilter: {
+      MergeIntoInBloomFilter(other);
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
 
+void ColumnPredicate::IntersectBounds(const void* lower, const void* upper) {
+  // Set the lower bound to the larger of the two.
+  if (lower != nullptr &&
+      (lower_ == nullptr || column_.type_info()->Compare(lower_, lower) < 0)) {
+    lower_ = lower;
+  }
+
+  // Set the upper bound to the smaller of the two.
+  if (upper != nullptr &&
+      (upper_ == nullptr || column_.type_info()->Compare(upper_, upper) > 0)) {
+    upper_ = upper;
+  }
+}
+
 void ColumnPredicate::MergeIntoRange(const ColumnPredicate& other) {
   CHECK(predicate_type_ == PredicateType::Range);
 
@@ -261,18 +330,7 @@ void ColumnPredicate::MergeIntoRange(const ColumnPredicate& other) {
     };
 
     case PredicateType::Range: {
-      // Set the lower bound to the larger of the two.
-      if (other.lower_ != nullptr &&
-          (lower_ == nullptr || column_.type_info()->Compare(lower_, other.lower_) < 0)) {
-        lower_ = other.lower_;
-      }
-
-      // Set the upper bound to the smaller of the two.
-      if (other.upper_ != nullptr &&
-          (upper_ == nullptr || column_.type_info()->Compare(upper_, other.upper_) > 0)) {
-        upper_ = other.upper_;
-      }
-
+      IntersectBounds(other.lower_, other.upper_);
       Simplify();
       return;
     };
@@ -313,6 +371,14 @@ void ColumnPredicate::MergeIntoRange(const ColumnPredicate& other) {
       Simplify();
       return;
     };
+    case PredicateType::InBloomFilter: {
+      // The range narrows the bounds of the bloom filter predicate.
+      predicate_type_ = PredicateType::InBloomFilter;
+      bloom_filters_ = other.bloom_filters_;
+      IntersectBounds(other.lower_, other.upper_);
+      Simplify();
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -350,6 +416,12 @@ void ColumnPredicate::MergeIntoEquality(const ColumnPredicate& other) {
       }
       return;
     };
+    case PredicateType::InBloomFilter: {
+      if (!other.CheckValueInBloomFilter(lower_)) {
+        SetToNone();
+      }
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -368,6 +440,7 @@ void ColumnPredicate::MergeIntoIsNotNull(const ColumnPredicate &other) {
       lower_ = other.lower_;
       upper_ = other.upper_;
       values_ = other.values_;
+      bloom_filters_ = other.bloom_filters_;
       return;
     }
   }
@@ -489,6 +562,71 @@ void ColumnPredicate::MergeIntoInList(const ColumnPredicate &other) {
       Simplify();
       return;
     };
+    case PredicateType::InBloomFilter: {
+      // Only the values which may be in the other filters should be retained.
+      values_.erase(std::remove_if(values_.begin(), values_.end(),
+                                   [&other] (const void* v) {
+                                     return !other.CheckValueInBloomFilter(v);
+                                   }), values_.end());
+      Simplify();
+      return;
+    };
+  }
+  LOG(FATAL) << "unknown predicate type";
+}
+
+void ColumnPredicate::MergeIntoInBloomFilter(const ColumnPredicate &other) {
+  CHECK(predicate_type_ == PredicateType::InBloomFilter);
+
+  switch (other.predicate_type()) {
+    case PredicateType::None: {
+      SetToNone();
+      return;
+    };
+    case PredicateType::Range: {
+      IntersectBounds(other.lower_, other.upper_);
+      Simplify();
+      return;
+    };
+    case PredicateType::Equality: {
+      if (CheckValueInBloomFilter(other.lower_)) {
+        predicate_type_ = PredicateType::Equality;
+        lower_ = other.lower_;
+        upper_ = nullptr;
+        bloom_filters_.clear();
+      } else {
+        SetToNone();
+      }
+      return;
+    };
+    case PredicateType::IsNotNull: return;
+    case PredicateType::IsNull: {
+      SetToNone();
+      return;
+    };
+    case PredicateType::InList: {
+      // The IN list is more selective, so retain the values which may be in
+      // this predicate's filters and convert to an InList predicate.
+      values_ = other.values_;
+      values_.erase(std::remove_if(values_.begin(), values_.end(),
+                                   [this] (const void* v) {
+                                     return !CheckValueInBloomFilter(v);
+                                   }), values_.end());
+      predicate_type_ = PredicateType::InList;
+      lower_ = nullptr;
+      upper_ = nullptr;
+      bloom_filters_.clear();
+      Simplify();
+      return;
+    };
+    case PredicateType::InBloomFilter: {
+      // A value must now pass the filters of both predicates.
+      bloom_filters_.insert(bloom_filters_.end(),
+                            other.bloom_filters_.begin(), other.bloom_filters_.end());
+      IntersectBounds(other.lower_, other.upper_);
+      Simplify();
+      return;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -514,14 +652,128 @@ void ApplyPredicate(const ColumnBlock& block, SelectionVector* sel, P p) {
     }
   }
 }
+
+// Evaluates predicates with the batch kernels of column_predicate_kernels.h,
+// which handle all of the fixed-width physical types. BOOL cells are
+// evaluated as bytes.
+template <DataType PhysicalType>
+struct PredicateKernels {
+  typedef typename DataTypeTraits<PhysicalType>::cpp_type cpp_type;
+  static const bool kSupported = true;
+
+  static const cpp_type* values(const ColumnBlock& block) {
+    return reinterpret_cast<const cpp_type*>(block.data());
+  }
+
+  static void Range(const ColumnBlock& block, const void* lower, const void* upper,
+                    SelectionVector* sel) {
+    predicate_kernels::EvaluateRange(values(block), block.null_bitmap(), block.nrows(),
+                                     static_cast<const cpp_type*>(lower),
+                                     static_cast<const cpp_type*>(upper),
+                                     sel->mutable_bitmap());
+  }
+
+  static void Equality(const ColumnBlock& block, const void* value, SelectionVector* sel) {
+    predicate_kernels::EvaluateEquality(values(block), block.null_bitmap(), block.nrows(),
+                                        *static_cast<const cpp_type*>(value),
+                                        sel->mutable_bitmap());
+  }
+
+  static void InList(const ColumnBlock& block, const vector<const void*>& list,
+                     SelectionVector* sel) {
+    DCHECK_LE(list.size(), predicate_kernels::kMaxInListSize);
+    cpp_type list_values[predicate_kernels::kMaxInListSize];
+    for (size_t i = 0; i < list.size(); i++) {
+      list_values[i] = *static_cast<const cpp_type*>(list[i]);
+    }
+    predicate_kernels::EvaluateInList(values(block), block.null_bitmap(), block.nrows(),
+                                      list_values, list.size(), sel->mutable_bitmap());
+  }
+};
+
+template <>
+struct PredicateKernels<BOOL> : public PredicateKernels<UINT8> {};
+
+// The variable-length and 128-bit cells have no batch kernels: they are
+// compared one at a time.
+template <>
+struct PredicateKernels<BINARY> {
+  static const bool kSupported = false;
+
+  static void Range(const ColumnBlock& /* block */, const void* /* lower */,
+                    const void* /* upper */, SelectionVector* /* sel */) {
+    LOG(FATAL) << "the cells are evaluated one at a time";
+  }
+  static void Equality(const ColumnBlock& /* block */, const void* /* value */,
+                       SelectionVector* /* sel */) {
+    LOG(FATAL) << "the cells are evaluated one at a time";
+  }
+  static void InList(const ColumnBlock& /* block */, const vector<const void*>& /* list */,
+                     SelectionVector* /* sel */) {
+    LOG(FATAL) << "the cells are evaluated one at a time";
+  }
+};
+
+template <>
+struct PredicateKernels<INT128> : public PredicateKernels<BINARY> {};
+
+// Returns the bloom filter key of a cell of the given physical type. See
+// ColumnPredicate::BloomFilterKey().
+template <DataType PhysicalType>
+Slice CellBloomFilterKey(const void* cell) {
+  if (PhysicalType == BINARY) {
+    return *static_cast<const Slice*>(cell);
+  }
+  return Slice(static_cast<const uint8_t*>(cell), TypeTraits<PhysicalType>::size);
+}
 } // anonymous namespace
 
+template <DataType PhysicalType>
+void ColumnPredicate::EvaluateInBloomFilter(const ColumnBlock& block,
+                                            SelectionVector* sel) const {
+  // Apply the bounds first. They are cheaper than probing the filters, and
+  // this also deselects the null cells.
+  ApplyPredicate(block, sel, [this] (const void* cell) {
+    return (this->lower_ == nullptr ||
+            DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) >= 0) &&
+           (this->upper_ == nullptr ||
+            DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) < 0);
+  });
+
+  // Probe the filters a batch of rows at a time. The buckets of all of the
+  // rows in a batch are prefetched before any of them are tested, so that the
+  // cache misses of the batch overlap rather than stall one after another.
+  const size_t kBatchSize = 64;
+  BloomKeyProbe probes[kBatchSize];
+  size_t batch_rows[kBatchSize];
+  for (const Slice& data : bloom_filters_) {
+    BloomFilter filter(data, 0, BloomFilterLayout::kBlocked);
+    size_t row = 0;
+    while (row < block.nrows()) {
+      size_t n = 0;
+      for (; row < block.nrows() && n < kBatchSize; row++) {
+        if (!sel->IsRowSelected(row)) continue;
+        probes[n] = BloomKeyProbe(CellBloomFilterKey<PhysicalType>(block.cell_ptr(row)));
+        filter.Prefetch(probes[n]);
+        batch_rows[n++] = row;
+      }
+      for (size_t i = 0; i < n; i++) {
+        if (!filter.MayContainKey(probes[i])) {
+          BitmapClear(sel->mutable_bitmap(), batch_rows[i]);
+        }
+      }
+    }
+  }
+}
+
 template <DataType PhysicalType>
 void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
                                               SelectionVector* sel) const {
   switch (predicate_type()) {
     case PredicateType::Range: {
-      if (lower_ == nullptr) {
+      if (PredicateKernels<PhysicalType>::kSupported) {
+        PredicateKernels<PhysicalType>::Range(block, lower_, upper_, sel);
+      } else if (lower_ == nullptr) {
         ApplyPredicate(block, sel, [this] (const void* cell) {
           return DataTypeTraits<PhysicalType>::Compare(cell, this->upper_) < 0;
         });
@@ -538,6 +790,10 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       return;
     };
     case PredicateType::Equality: {
+      if (PredicateKernels<PhysicalType>::kSupported) {
+        PredicateKernels<PhysicalType>::Equality(block, lower_, sel);
+        return;
+      }
       ApplyPredicate(block, sel, [this] (const void* cell) {
         return DataTypeTraits<PhysicalType>::Compare(cell, this->lower_) == 0;
       });
@@ -545,13 +801,8 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
     };
     case PredicateType::IsNotNull: {
       if (!block.is_nullable()) return;
-      // TODO: make this more efficient by using bitwise operations on the
-      // null and selection vectors.
-      for (size_t i = 0; i < block.nrows(); i++) {
-        if (sel->IsRowSelected(i) && block.is_null(i)) {
-          BitmapClear(sel->mutable_bitmap(), i);
-        }
-      }
+      predicate_kernels::EvaluateIsNotNull(block.null_bitmap(), block.nrows(),
+                                           sel->mutable_bitmap());
       return;
     };
     case PredicateType::IsNull: {
@@ -559,16 +810,16 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
         BitmapChangeBits(sel->mutable_bitmap(), 0, block.nrows(), false);
         return;
       }
-      // TODO(wdberkeley): make this more efficient by using bitwise operations on the
-      // null and selection vectors.
-      for (size_t i = 0; i < block.nrows(); i++) {
-        if (sel->IsRowSelected(i) && !block.is_null(i)) {
-          BitmapClear(sel->mutable_bitmap(), i);
-        }
-      }
+      predicate_kernels::EvaluateIsNull(block.null_bitmap(), block.nrows(),
+                                        sel->mutable_bitmap());
       return;
     }
     case PredicateType::InList: {
+      if (PredicateKernels<PhysicalType>::kSupported &&
+          values_.size() <= predicate_kernels::kMaxInListSize) {
+        PredicateKernels<PhysicalType>::InList(block, values_, sel);
+        return;
+      }
       ApplyPredicate(block, sel, [this] (const void* cell) {
         return std::binary_search(values_.begin(), values_.end(), cell,
                                   [] (const void* lhs, const void* rhs) {
@@ -577,6 +828,10 @@ void ColumnPredicate::EvaluateForPhysicalType(const ColumnBlock& block,
       });
       return;
     };
+    case PredicateType::InBloomFilter: {
+      EvaluateInBloomFilter<PhysicalType>(block, sel);
+      return;
+    };
     case PredicateType::None: LOG(FATAL) << "NONE predicate evaluation";
   }
   LOG(FATAL) << "unknown predicate type";
@@ -590,6 +845,7 @@ void ColumnPredicate::Evaluate(const ColumnBlock& block, SelectionVector* sel) c
     case INT16: return EvaluateForPhysicalType<INT16>(block, sel);
     case INT32: return EvaluateForPhysicalType<INT32>(block, sel);
     case INT64: return EvaluateForPhysicalType<INT64>(block, sel);
+    case INT128: return EvaluateForPhysicalType<INT128>(block, sel);
     case UINT8: return EvaluateForPhysicalType<UINT8>(block, sel);
     case UINT16: return EvaluateForPhysicalType<UINT16>(block, sel);
     case UINT32: return EvaluateForPhysicalType<UINT32>(block, sel);
@@ -641,6 +897,19 @@ string ColumnPredicate::ToString() const {
       ss.append(")");
       return ss;
     };
+    case PredicateType::InBloomFilter: {
+      string ss = strings::Substitute("`$0` IN $1 BLOOM FILTER(S)",
+                                      column_.name(), bloom_filters_.size());
+      if (lower_ != nullptr) {
+        ss.append(strings::Substitute(" AND `$0` >= $1",
+                                      column_.name(), column_.Stringify(lower_)));
+      }
+      if (upper_ != nullptr) {
+        ss.append(strings::Substitute(" AND `$0` < $1",
+                                      column_.name(), column_.Stringify(upper_)));
+      }
+      return ss;
+    };
   }
   LOG(FATAL) << "unknown predicate type";
 }
@@ -652,13 +921,15 @@ bool ColumnPredicate::operator==(const ColumnPredicate& other) const {
   }
   switch (predicate_type_) {
     case PredicateType::Equality: return column_.type_info()->Compare(lower_, other.lower_) == 0;
-    case PredicateType::Range: {
+    case PredicateType::Range:
+    case PredicateType::InBloomFilter: {
       return (lower_ == other.lower_ ||
               (lower_ != nullptr && other.lower_ != nullptr &&
                column_.type_info()->Compare(lower_, other.lower_) == 0)) &&
              (upper_ == other.upper_ ||
               (upper_ != nullptr && other.upper_ != nullptr &&
-               column_.type_info()->Compare(upper_, other.upper_) == 0));
+               column_.type_info()->Compare(upper_, other.upper_) == 0)) &&
+             bloom_filters_ == other.bloom_filters_;
     };
     case PredicateType::InList: {
       if (values_.size() != other.values_.size()) return false;
@@ -687,6 +958,51 @@ bool ColumnPredicate::CheckValueInList(const void* value) const {
                             });
 }
 
+bool ColumnPredicate::CheckValueInBloomFilter(const void* value) const {
+  DCHECK(predicate_type_ == PredicateType::InBloomFilter);
+  const TypeInfo* type_info = column_.type_info();
+  if ((lower_ != nullptr && type_info->Compare(value, lower_) < 0) ||
+      (upper_ != nullptr && type_info->Compare(value, upper_) >= 0)) {
+    return false;
+  }
+  BloomKeyProbe probe(BloomFilterKey(column_, value));
+  for (const Slice& data : bloom_filters_) {
+    if (!BloomFilter(data, 0, BloomFilterLayout::kBlocked).MayContainKey(probe)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ColumnPredicate::MayMatchRange(const void* min, const void* max) const {
+  const TypeInfo* type_info = column_.type_info();
+  DCHECK_LE(type_info->Compare(min, max), 0);
+  switch (predicate_type_) {
+    case PredicateType::None: return false;
+    case PredicateType::IsNull: return false;
+    case PredicateType::IsNotNull: return true;
+    case PredicateType::Equality: {
+      return type_info->Compare(lower_, min) >= 0 &&
+             type_info->Compare(lower_, max) <= 0;
+    };
+    case PredicateType::Range:
+    case PredicateType::InBloomFilter: {
+      return (lower_ == nullptr || type_info->Compare(lower_, max) <= 0) &&
+             (upper_ == nullptr || type_info->Compare(upper_, min) > 0);
+    };
+    case PredicateType::InList: {
+      // The values are sorted, so find the first one which is not below 'min'
+      // and check whether it is beyond 'max'.
+      auto it = std::lower_bound(values_.begin(), values_.end(), min,
+                                 [type_info](const void* lhs, const void* rhs) {
+                                   return type_info->Compare(lhs, rhs) < 0;
+                                 });
+      return it != values_.end() && type_info->Compare(*it, max) <= 0;
+    };
+  }
+  LOG(FATAL) << "unknown predicate type";
+}
+
 namespace {
 int SelectivityRank(const ColumnPredicate& predicate) {
   int rank;
@@ -695,8 +1011,9 @@ int SelectivityRank(const ColumnPredicate& predicate) {
     case PredicateType::IsNull: rank = 1; break;
     case PredicateType::Equality: rank = 2; break;
     case PredicateType::InList: rank = 3; break;
-    case PredicateType::Range: rank = 4; break;
-    case PredicateType::IsNotNull: rank = 5; break;
+    case PredicateType::InBloomFilter: rank = 4; break;
+    case PredicateType::Range: rank = 5; break;
+    case PredicateType::IsNotNull: rank = 6; break;
     default: LOG(FATAL) << "unknown predicate type";
   }
   return rank * (kLargestTypeSize + 1) + predicate.column().type_info()->size();
@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "kudu/common/schema.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 
@@ -52,6 +53,10 @@ enum class PredicateType {
   // A predicate which evaluates to true if the column value is present in
   // a value list.
   InList,
+
+  // A predicate which evaluates to true if the column value may be present
+  // in a set of bloom filters and falls within optional range bounds.
+  InBloomFilter,
 };
 
 // A predicate which can be evaluated over a block of column values.
@@ -126,9 +131,32 @@ class ColumnPredicate {
   // The InList will be simplified into an Equality, Range or None if possible.
   static ColumnPredicate InList(ColumnSchema column, std::vector<const void*>* values);
 
+  // Creates a new IN BLOOM FILTER predicate for the column, which matches
+  // the values which may be contained in every one of the bloom filters and
+  // which fall within the inclusive lower and exclusive upper bound. Either
+  // or both of the bounds may be a nullptr to leave that end unbounded.
+  //
+  // The filters must be in the layout of BloomFilterLayout::kBlocked, with
+  // the keys given by BloomFilterKey(). Since bloom filters admit false
+  // positives, the predicate may also match values which were never added.
+  //
+  // The filter data and bounds are not copied, and must outlive the returned
+  // predicate. The predicate will be simplified into a Range, IsNotNull or
+  // None predicate if possible.
+  static ColumnPredicate InBloomFilter(ColumnSchema column,
+                                       std::vector<Slice>* bloom_filters,
+                                       const void* lower,
+                                       const void* upper);
+
   // Creates a new predicate which matches no values.
   static ColumnPredicate None(ColumnSchema column);
 
+  // Returns the key under which the cell 'value' of 'column' is added to and
+  // looked up in the bloom filters of an IN BLOOM FILTER predicate: the
+  // cell's little-endian in-memory representation, or the string data for
+  // STRING and BINARY columns. The returned slice refers to 'value'.
+  static Slice BloomFilterKey(const ColumnSchema& column, const void* value);
+
   // Returns the type of this predicate.
   PredicateType predicate_type() const {
     return predicate_type_;
@@ -192,10 +220,21 @@ class ColumnPredicate {
                                     return DataTypeTraits<PhysicalType>::Compare(lhs, rhs) < 0;
                                   });
       };
+      case PredicateType::InBloomFilter: {
+        return CheckValueInBloomFilter(cell);
+      };
     }
     LOG(FATAL) << "unknown predicate type";
   }
 
+  // Returns false if it is certain that no non-null value 'v' in the inclusive
+  // range 'min' <= v <= 'max' satisfies the predicate, e.g. because the
+  // range lies entirely outside the predicate bounds. Returns true otherwise.
+  //
+  // This is used to skip whole blocks of data based on summary statistics.
+  // Since null values are not considered, an IS NULL predicate never matches.
+  bool MayMatchRange(const void* min, const void* max) const;
+
   // Print the predicate for debugging.
   std::string ToString() const;
 
@@ -204,13 +243,13 @@ class ColumnPredicate {
   // Predicates over different columns are not equal.
   bool operator==(const ColumnPredicate& other) const;
 
-  // Returns the raw lower bound value if this is a range predicate, or the
-  // equality value if this is an equality predicate.
+  // Returns the raw lower bound value if this is a range or bloom filter
+  // predicate, or the equality value if this is an equality predicate.
   const void* raw_lower() const {
     return lower_;
   }
 
-  // Returns the raw upper bound if this is a range predicate.
+  // Returns the raw upper bound if this is a range or bloom filter predicate.
   const void* raw_upper() const {
     return upper_;
   }
@@ -226,6 +265,11 @@ class ColumnPredicate {
     return values_;
   }
 
+  // Returns the bloom filter data if this is a bloom filter predicate.
+  const std::vector<Slice>& raw_bloom_filters() const {
+    return bloom_filters_;
+  }
+
  private:
 
   friend class TestColumnPredicate;
@@ -268,6 +312,18 @@ class ColumnPredicate {
   // Merge another predicate into this InList predicate.
   void MergeIntoInList(const ColumnPredicate& other);
 
+  // Merge another predicate into this InBloomFilter predicate.
+  void MergeIntoInBloomFilter(const ColumnPredicate& other);
+
+  // Narrow the bounds of this Range or InBloomFilter predicate to their
+  // intersection with the given bounds, either of which may be a nullptr.
+  void IntersectBounds(const void* lower, const void* upper);
+
+  // Templated evaluation of an InBloomFilter predicate, which probes the
+  // filters a batch of rows at a time.
+  template <DataType PhysicalType>
+  void EvaluateInBloomFilter(const ColumnBlock& block, SelectionVector* sel) const;
+
   // For a Range type predicate, this helper function checks
   // whether a given value is in the range.
   bool CheckValueInRange(const void* value) const;
@@ -276,21 +332,30 @@ class ColumnPredicate {
   // whether a given value is in the list.
   bool CheckValueInList(const void* value) const;
 
+  // For an InBloomFilter type predicate, this helper function checks whether
+  // a given value is within the bounds and may be in every filter.
+  bool CheckValueInBloomFilter(const void* value) const;
+
   // The type of this predicate.
   PredicateType predicate_type_;
 
   // The data type of the column. TypeInfo instances have a static lifetime.
   ColumnSchema column_;
 
-  // The inclusive lower bound value if this is a Range predicate, or the
-  // equality value if this is an Equality predicate.
+  // The inclusive lower bound value if this is a Range or InBloomFilter
+  // predicate, or the equality value if this is an Equality predicate.
   const void* lower_;
 
-  // The exclusive upper bound value if this is a Range predicate.
+  // The exclusive upper bound value if this is a Range or InBloomFilter
+  // predicate.
   const void* upper_;
 
   // The list of values to check column against if this is an InList predicate.
   std::vector<const void*> values_;
+
+  // The bloom filters to check the column against if this is an InBloomFilter
+  // predicate.
+  std::vector<Slice> bloom_filters_;
 };
 
 // Compares predicates according to selectivity. Predicates that match fewer
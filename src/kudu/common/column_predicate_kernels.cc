@@ -0,0 +1,482 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_predicate_kernels.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/cpu.h"
+#include "kudu/gutil/port.h"
+#include "kudu/util/bitmap.h"
+
+using base::CPU;
+
+namespace kudu {
+namespace predicate_kernels {
+
+namespace {
+
+// All kernels evaluate 32 rows at a time, i.e. 4 bytes of the bitmaps.
+const size_t kGroupSize = 32;
+
+inline uint32_t LoadWord(const uint8_t* bitmap, size_t group) {
+  uint32_t word;
+  memcpy(&word, bitmap + group * sizeof(word), sizeof(word));
+  return word;
+}
+
+inline void StoreWord(uint8_t* bitmap, size_t group, uint32_t word) {
+  memcpy(bitmap + group * sizeof(word), &word, sizeof(word));
+}
+
+// Element-wise comparisons, matching DataTypeTraits::Compare(): a value is
+// "equal" to another if it is neither less nor greater than it.
+template<typename T>
+inline bool Less(T a, T b) { return a < b; }
+
+template<typename T>
+inline bool Equal(T a, T b) { return !(a < b) && !(b < a); }
+
+// Portable comparisons of a group of 32 values against 'x', returning the
+// result for value 'i' in bit 'i'.
+template<typename T>
+struct ScalarCmp {
+  static uint32_t Lt(const T* v, T x) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupSize; i++) {
+      mask |= static_cast<uint32_t>(Less(v[i], x)) << i;
+    }
+    return mask;
+  }
+
+  static uint32_t Eq(const T* v, T x) {
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupSize; i++) {
+      mask |= static_cast<uint32_t>(Equal(v[i], x)) << i;
+    }
+    return mask;
+  }
+};
+
+// AVX2 comparisons of signed integer lanes of 'W' bits.
+template<int W>
+struct Avx2IntLanes;
+
+template<>
+struct Avx2IntLanes<8> {
+  static const int kLanes = 32;
+  __attribute__((target("avx2")))
+  static __m256i Set1(int64_t x) { return _mm256_set1_epi8(static_cast<int8_t>(x)); }
+  __attribute__((target("avx2")))
+  static __m256i CmpGt(__m256i a, __m256i b) { return _mm256_cmpgt_epi8(a, b); }
+  __attribute__((target("avx2")))
+  static __m256i CmpEq(__m256i a, __m256i b) { return _mm256_cmpeq_epi8(a, b); }
+  __attribute__((target("avx2")))
+  static uint32_t Bits(__m256i r) { return _mm256_movemask_epi8(r); }
+};
+
+template<>
+struct Avx2IntLanes<16> {
+  static const int kLanes = 16;
+  __attribute__((target("avx2")))
+  static __m256i Set1(int64_t x) { return _mm256_set1_epi16(static_cast<int16_t>(x)); }
+  __attribute__((target("avx2")))
+  static __m256i CmpGt(__m256i a, __m256i b) { return _mm256_cmpgt_epi16(a, b); }
+  __attribute__((target("avx2")))
+  static __m256i CmpEq(__m256i a, __m256i b) { return _mm256_cmpeq_epi16(a, b); }
+  __attribute__((target("avx2")))
+  static uint32_t Bits(__m256i r) {
+    // Packing the lanes into bytes leaves those of the first 8 values in
+    // bytes 0-7 and those of the last 8 in bytes 16-23.
+    uint32_t m = _mm256_movemask_epi8(_mm256_packs_epi16(r, r));
+    return (m & 0xff) | ((m >> 8) & 0xff00);
+  }
+};
+
+template<>
+struct Avx2IntLanes<32> {
+  static const int kLanes = 8;
+  __attribute__((target("avx2")))
+  static __m256i Set1(int64_t x) { return _mm256_set1_epi32(static_cast<int32_t>(x)); }
+  __attribute__((target("avx2")))
+  static __m256i CmpGt(__m256i a, __m256i b) { return _mm256_cmpgt_epi32(a, b); }
+  __attribute__((target("avx2")))
+  static __m256i CmpEq(__m256i a, __m256i b) { return _mm256_cmpeq_epi32(a, b); }
+  __attribute__((target("avx2")))
+  static uint32_t Bits(__m256i r) { return _mm256_movemask_ps(_mm256_castsi256_ps(r)); }
+};
+
+template<>
+struct Avx2IntLanes<64> {
+  static const int kLanes = 4;
+  __attribute__((target("avx2")))
+  static __m256i Set1(int64_t x) { return _mm256_set1_epi64x(x); }
+  __attribute__((target("avx2")))
+  static __m256i CmpGt(__m256i a, __m256i b) { return _mm256_cmpgt_epi64(a, b); }
+  __attribute__((target("avx2")))
+  static __m256i CmpEq(__m256i a, __m256i b) { return _mm256_cmpeq_epi64(a, b); }
+  __attribute__((target("avx2")))
+  static uint32_t Bits(__m256i r) { return _mm256_movemask_pd(_mm256_castsi256_pd(r)); }
+};
+
+// AVX2 comparisons of a group of 32 integers against 'x'. AVX2 only compares
+// signed lanes, so unsigned values have their sign bit flipped first.
+template<typename T>
+struct Avx2Cmp {
+  typedef Avx2IntLanes<sizeof(T) * 8> Lanes;
+  static const uint64_t kBias = static_cast<T>(-1) > 0 ? 1ULL << (sizeof(T) * 8 - 1) : 0;
+
+  __attribute__((target("avx2")))
+  static __m256i Load(const T* v, size_t i) {
+    __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(v + i * Lanes::kLanes));
+    return _mm256_xor_si256(x, Lanes::Set1(kBias));
+  }
+
+  __attribute__((target("avx2")))
+  static __m256i Broadcast(T x) {
+    return Lanes::Set1(static_cast<int64_t>(static_cast<uint64_t>(x) ^ kBias));
+  }
+
+  __attribute__((target("avx2")))
+  static uint32_t Lt(const T* v, T x) {
+    const __m256i b = Broadcast(x);
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupSize / Lanes::kLanes; i++) {
+      mask |= Lanes::Bits(Lanes::CmpGt(b, Load(v, i))) << (i * Lanes::kLanes);
+    }
+    return mask;
+  }
+
+  __attribute__((target("avx2")))
+  static uint32_t Eq(const T* v, T x) {
+    const __m256i b = Broadcast(x);
+    uint32_t mask = 0;
+    for (size_t i = 0; i < kGroupSize / Lanes::kLanes; i++) {
+      mask |= Lanes::Bits(Lanes::CmpEq(b, Load(v, i))) << (i * Lanes::kLanes);
+    }
+    return mask;
+  }
+};
+
+// Floating point comparisons use the ordered less-than, which is false for
+// NaNs, and the unordered equality, which is true for them.
+template<>
+struct Avx2Cmp<float> {
+  __attribute__((target("avx2")))
+  static uint32_t Lt(const float* v, float x) {
+    const __m256 b = _mm256_set1_ps(x);
+    uint32_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+      __m256 r = _mm256_cmp_ps(_mm256_loadu_ps(v + i * 8), b, _CMP_LT_OQ);
+      mask |= static_cast<uint32_t>(_mm256_movemask_ps(r)) << (i * 8);
+    }
+    return mask;
+  }
+
+  __attribute__((target("avx2")))
+  static uint32_t Eq(const float* v, float x) {
+    const __m256 b = _mm256_set1_ps(x);
+    uint32_t mask = 0;
+    for (int i = 0; i < 4; i++) {
+      __m256 r = _mm256_cmp_ps(_mm256_loadu_ps(v + i * 8), b, _CMP_EQ_UQ);
+      mask |= static_cast<uint32_t>(_mm256_movemask_ps(r)) << (i * 8);
+    }
+    return mask;
+  }
+};
+
+template<>
+struct Avx2Cmp<double> {
+  __attribute__((target("avx2")))
+  static uint32_t Lt(const double* v, double x) {
+    const __m256d b = _mm256_set1_pd(x);
+    uint32_t mask = 0;
+    for (int i = 0; i < 8; i++) {
+      __m256d r = _mm256_cmp_pd(_mm256_loadu_pd(v + i * 4), b, _CMP_LT_OQ);
+      mask |= static_cast<uint32_t>(_mm256_movemask_pd(r)) << (i * 4);
+    }
+    return mask;
+  }
+
+  __attribute__((target("avx2")))
+  static uint32_t Eq(const double* v, double x) {
+    const __m256d b = _mm256_set1_pd(x);
+    uint32_t mask = 0;
+    for (int i = 0; i < 8; i++) {
+      __m256d r = _mm256_cmp_pd(_mm256_loadu_pd(v + i * 4), b, _CMP_EQ_UQ);
+      mask |= static_cast<uint32_t>(_mm256_movemask_pd(r)) << (i * 4);
+    }
+    return mask;
+  }
+};
+
+// The kernels evaluate 'num_groups' whole groups. Groups whose rows are all
+// deselected (or null) aren't compared at all.
+//
+// The AVX2 kernels repeat the portable ones so that the comparisons are
+// compiled, and inlined, with AVX2 enabled.
+template<typename T>
+struct ScalarKernels {
+  typedef ScalarCmp<T> Cmp;
+
+  static void Range(const T* values, const uint8_t* non_null, size_t num_groups,
+                    const T* lower, const T* upper, uint8_t* sel) {
+    for (size_t g = 0; g < num_groups; g++, values += kGroupSize) {
+      uint32_t word = LoadWord(sel, g);
+      if (non_null != nullptr) word &= LoadWord(non_null, g);
+      if (word == 0) continue;
+      if (lower != nullptr) word &= ~Cmp::Lt(values, *lower);
+      if (upper != nullptr) word &= Cmp::Lt(values, *upper);
+      StoreWord(sel, g, word);
+    }
+  }
+
+  static void Equality(const T* values, const uint8_t* non_null, size_t num_groups,
+                       T value, uint8_t* sel) {
+    for (size_t g = 0; g < num_groups; g++, values += kGroupSize) {
+      uint32_t word = LoadWord(sel, g);
+      if (non_null != nullptr) word &= LoadWord(non_null, g);
+      if (word == 0) continue;
+      StoreWord(sel, g, word & Cmp::Eq(values, value));
+    }
+  }
+
+  static void InList(const T* values, const uint8_t* non_null, size_t num_groups,
+                     const T* list, size_t list_size, uint8_t* sel) {
+    for (size_t g = 0; g < num_groups; g++, values += kGroupSize) {
+      uint32_t word = LoadWord(sel, g);
+      if (non_null != nullptr) word &= LoadWord(non_null, g);
+      if (word == 0) continue;
+      uint32_t in_list = 0;
+      for (size_t j = 0; j < list_size; j++) {
+        in_list |= Cmp::Eq(values, list[j]);
+      }
+      StoreWord(sel, g, word & in_list);
+    }
+  }
+};
+
+template<typename T>
+struct Avx2Kernels {
+  typedef Avx2Cmp<T> Cmp;
+
+  __attribute__((target("avx2")))
+  static void Range(const T* values, const uint8_t* non_null, size_t num_groups,
+                    const T* lower, const T* upper, uint8_t* sel) {
+    for (size_t g = 0; g < num_groups; g++, values += kGroupSize) {
+      uint32_t word = LoadWord(sel, g);
+      if (non_null != nullptr) word &= LoadWord(non_null, g);
+      if (word == 0) continue;
+      if (lower != nullptr) word &= ~Cmp::Lt(values, *lower);
+      if (upper != nullptr) word &= Cmp::Lt(values, *upper);
+      StoreWord(sel, g, word);
+    }
+  }
+
+  __attribute__((target("avx2")))
+  static void Equality(const T* values, const uint8_t* non_null, size_t num_groups,
+                       T value, uint8_t* sel) {
+    for (size_t g = 0; g < num_groups; g++, values += kGroupSize) {
+      uint32_t word = LoadWord(sel, g);
+      if (non_null != nullptr) word &= LoadWord(non_null, g);
+      if (word == 0) continue;
+      StoreWord(sel, g, word & Cmp::Eq(values, value));
+    }
+  }
+
+  __attribute__((target("avx2")))
+  static void InList(const T* values, const uint8_t* non_null, size_t num_groups,
+                     const T* list, size_t list_size, uint8_t* sel) {
+    for (size_t g = 0; g < num_groups; g++, values += kGroupSize) {
+      uint32_t word = LoadWord(sel, g);
+      if (non_null != nullptr) word &= LoadWord(non_null, g);
+      if (word == 0) continue;
+      uint32_t in_list = 0;
+      for (size_t j = 0; j < list_size; j++) {
+        in_list |= Cmp::Eq(values, list[j]);
+      }
+      StoreWord(sel, g, word & in_list);
+    }
+  }
+};
+
+template<typename T>
+struct Kernels {
+  typedef void (*RangeFn)(const T*, const uint8_t*, size_t, const T*, const T*, uint8_t*);
+  typedef void (*EqualityFn)(const T*, const uint8_t*, size_t, T, uint8_t*);
+  typedef void (*InListFn)(const T*, const uint8_t*, size_t, const T*, size_t, uint8_t*);
+
+  static RangeFn range;
+  static EqualityFn equality;
+  static InListFn in_list;
+
+  template<template<typename> class Impl>
+  static void Select() {
+    range = &Impl<T>::Range;
+    equality = &Impl<T>::Equality;
+    in_list = &Impl<T>::InList;
+  }
+};
+
+template<typename T>
+typename Kernels<T>::RangeFn Kernels<T>::range = &ScalarKernels<T>::Range;
+template<typename T>
+typename Kernels<T>::EqualityFn Kernels<T>::equality = &ScalarKernels<T>::Equality;
+template<typename T>
+typename Kernels<T>::InListFn Kernels<T>::in_list = &ScalarKernels<T>::InList;
+
+const char* g_selected_kernel_name = "scalar";
+
+template<template<typename> class Impl>
+void SelectAllKernels(const char* name) {
+  Kernels<int8_t>::Select<Impl>();
+  Kernels<int16_t>::Select<Impl>();
+  Kernels<int32_t>::Select<Impl>();
+  Kernels<int64_t>::Select<Impl>();
+  Kernels<uint8_t>::Select<Impl>();
+  Kernels<uint16_t>::Select<Impl>();
+  Kernels<uint32_t>::Select<Impl>();
+  Kernels<uint64_t>::Select<Impl>();
+  Kernels<float>::Select<Impl>();
+  Kernels<double>::Select<Impl>();
+  g_selected_kernel_name = name;
+}
+
+__attribute__((constructor))
+void SelectPredicateKernels() {
+  SelectKernels(true);
+}
+
+// Returns whether row 'i' is selected and not null.
+inline bool IsCandidate(const uint8_t* non_null, const uint8_t* sel, size_t i) {
+  return BitmapTest(sel, i) && (non_null == nullptr || BitmapTest(non_null, i));
+}
+
+} // anonymous namespace
+
+template<typename T>
+void EvaluateRange(const T* values, const uint8_t* non_null, size_t nrows,
+                   const T* lower, const T* upper, uint8_t* sel) {
+  size_t num_groups = nrows / kGroupSize;
+  Kernels<T>::range(values, non_null, num_groups, lower, upper, sel);
+  for (size_t i = num_groups * kGroupSize; i < nrows; i++) {
+    if (!IsCandidate(non_null, sel, i) ||
+        (lower != nullptr && Less(values[i], *lower)) ||
+        (upper != nullptr && !Less(values[i], *upper))) {
+      BitmapClear(sel, i);
+    }
+  }
+}
+
+template<typename T>
+void EvaluateEquality(const T* values, const uint8_t* non_null, size_t nrows,
+                      T value, uint8_t* sel) {
+  size_t num_groups = nrows / kGroupSize;
+  Kernels<T>::equality(values, non_null, num_groups, value, sel);
+  for (size_t i = num_groups * kGroupSize; i < nrows; i++) {
+    if (!IsCandidate(non_null, sel, i) || !Equal(values[i], value)) {
+      BitmapClear(sel, i);
+    }
+  }
+}
+
+template<typename T>
+void EvaluateInList(const T* values, const uint8_t* non_null, size_t nrows,
+                    const T* list, size_t list_size, uint8_t* sel) {
+  DCHECK_LE(list_size, kMaxInListSize);
+  size_t num_groups = nrows / kGroupSize;
+  Kernels<T>::in_list(values, non_null, num_groups, list, list_size, sel);
+  for (size_t i = num_groups * kGroupSize; i < nrows; i++) {
+    if (!IsCandidate(non_null, sel, i)) {
+      BitmapClear(sel, i);
+      continue;
+    }
+    bool in_list = false;
+    for (size_t j = 0; j < list_size && !in_list; j++) {
+      in_list = Equal(values[i], list[j]);
+    }
+    if (!in_list) {
+      BitmapClear(sel, i);
+    }
+  }
+}
+
+// The null bitmaps are simply ANDed into the selection bitmap, a byte at a
+// time (which the compiler vectorizes), leaving the bits past 'nrows' alone.
+void EvaluateIsNotNull(const uint8_t* non_null, size_t nrows, uint8_t* sel) {
+  size_t num_bytes = nrows / 8;
+  for (size_t i = 0; i < num_bytes; i++) {
+    sel[i] &= non_null[i];
+  }
+  if (nrows % 8 != 0) {
+    uint8_t tail_mask = (1 << (nrows % 8)) - 1;
+    sel[num_bytes] &= non_null[num_bytes] | ~tail_mask;
+  }
+}
+
+void EvaluateIsNull(const uint8_t* non_null, size_t nrows, uint8_t* sel) {
+  size_t num_bytes = nrows / 8;
+  for (size_t i = 0; i < num_bytes; i++) {
+    sel[i] &= ~non_null[i];
+  }
+  if (nrows % 8 != 0) {
+    uint8_t tail_mask = (1 << (nrows % 8)) - 1;
+    sel[num_bytes] &= ~(non_null[num_bytes] & tail_mask);
+  }
+}
+
+void SelectKernels(bool allow_simd) {
+  CPU cpu;
+  if (allow_simd && cpu.has_avx2()) {
+    SelectAllKernels<Avx2Kernels>("avx2");
+  } else {
+    SelectAllKernels<ScalarKernels>("scalar");
+  }
+}
+
+const char* SelectedKernelName() {
+  return g_selected_kernel_name;
+}
+
+#define INSTANTIATE_KERNELS(T)                                                     \
+  template void EvaluateRange<T>(const T* values, const uint8_t* non_null,         \
+                                 size_t nrows, const T* lower, const T* upper,     \
+                                 uint8_t* sel);                                    \
+  template void EvaluateEquality<T>(const T* values, const uint8_t* non_null,      \
+                                    size_t nrows, T value, uint8_t* sel);          \
+  template void EvaluateInList<T>(const T* values, const uint8_t* non_null,        \
+                                  size_t nrows, const T* list, size_t list_size,   \
+                                  uint8_t* sel)
+
+INSTANTIATE_KERNELS(int8_t);
+INSTANTIATE_KERNELS(int16_t);
+INSTANTIATE_KERNELS(int32_t);
+INSTANTIATE_KERNELS(int64_t);
+INSTANTIATE_KERNELS(uint8_t);
+INSTANTIATE_KERNELS(uint16_t);
+INSTANTIATE_KERNELS(uint32_t);
+INSTANTIATE_KERNELS(uint64_t);
+INSTANTIATE_KERNELS(float);
+INSTANTIATE_KERNELS(double);
+
+#undef INSTANTIATE_KERNELS
+
+} // namespace predicate_kernels
+} // namespace kudu
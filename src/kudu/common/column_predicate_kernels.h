@@ -0,0 +1,82 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_COMMON_COLUMN_PREDICATE_KERNELS_H
+#define KUDU_COMMON_COLUMN_PREDICATE_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace kudu {
+namespace predicate_kernels {
+
+// Batch evaluation of column predicates over blocks of fixed-width values.
+//
+// Each function deselects, in the selection bitmap 'sel', the first 'nrows'
+// rows whose value in 'values' doesn't satisfy the predicate. If 'non_null'
+// isn't null, it is the null bitmap of the column (a set bit meaning the cell
+// isn't null) and the null rows are deselected as well. Rows which are
+// already deselected are left alone, and bits past 'nrows' are untouched.
+//
+// Values are compared as DataTypeTraits::Compare() does, so a NaN compares
+// equal to everything.
+//
+// Whole groups of 32 rows are evaluated by kernels selected once at startup
+// according to the CPU features (AVX2 or portable): each group is turned into
+// a 32-bit mask which is ANDed into the selection bitmap. The trailing rows
+// are evaluated one at a time.
+//
+// T may be any of int8_t, int16_t, int32_t, int64_t, their unsigned
+// counterparts, float or double.
+
+// Range predicate: lower <= value < upper. Either bound may be null.
+template<typename T>
+void EvaluateRange(const T* values, const uint8_t* non_null, size_t nrows,
+                   const T* lower, const T* upper, uint8_t* sel);
+
+// Equality predicate: value == 'value'.
+template<typename T>
+void EvaluateEquality(const T* values, const uint8_t* non_null, size_t nrows,
+                      T value, uint8_t* sel);
+
+// The largest IN list evaluated by EvaluateInList(). Larger lists are better
+// served by a binary search per row.
+const size_t kMaxInListSize = 8;
+
+// IN list predicate: value is one of the 'list_size' values of 'list'.
+// 'list_size' must be at most kMaxInListSize.
+template<typename T>
+void EvaluateInList(const T* values, const uint8_t* non_null, size_t nrows,
+                    const T* list, size_t list_size, uint8_t* sel);
+
+// IS NOT NULL and IS NULL predicates, evaluated on the null bitmap alone.
+void EvaluateIsNotNull(const uint8_t* non_null, size_t nrows, uint8_t* sel);
+void EvaluateIsNull(const uint8_t* non_null, size_t nrows, uint8_t* sel);
+
+// Selects the kernels to use: the best ones supported by the CPU if
+// 'allow_simd' is true, or the portable ones otherwise. The former are
+// selected at startup. Exposed for benchmarks and tests; not thread-safe
+// with respect to concurrent evaluation.
+void SelectKernels(bool allow_simd);
+
+// Returns the name of the kernel set currently selected ("avx2" or
+// "scalar").
+const char* SelectedKernelName();
+
+} // namespace predicate_kernels
+} // namespace kudu
+
+#endif
@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_statistics.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/types.h"
+#include "kudu/util/test_macros.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+TEST(ColumnStatisticsTest, TestInt32) {
+  ColumnStatistics stats(GetTypeInfo(INT32));
+  EXPECT_EQ("nulls=0, non-nulls=0, distinct~0", stats.ToString());
+
+  vector<int32_t> values = { 5, -3, 12, 5, 7 };
+  stats.AddValues(reinterpret_cast<const uint8_t*>(values.data()), values.size());
+  stats.AddNulls(2);
+  EXPECT_EQ("nulls=2, non-nulls=5, distinct~4, min=-3, max=12", stats.ToString());
+
+  ColumnStatistics other(GetTypeInfo(INT32));
+  values = { 20, 1 };
+  other.AddValues(reinterpret_cast<const uint8_t*>(values.data()), values.size());
+  ASSERT_OK(stats.Merge(other));
+  EXPECT_EQ("nulls=2, non-nulls=7, distinct~6, min=-3, max=20", stats.ToString());
+
+  // Merging statistics without values keeps the bounds.
+  ASSERT_OK(stats.Merge(ColumnStatistics(GetTypeInfo(INT32))));
+  EXPECT_EQ("nulls=2, non-nulls=7, distinct~6, min=-3, max=20", stats.ToString());
+
+  ColumnStatisticsPB pb;
+  stats.ToPB(&pb);
+  ColumnStatistics copy(GetTypeInfo(INT32));
+  ASSERT_OK(copy.FromPB(pb));
+  EXPECT_EQ(stats.ToString(), copy.ToString());
+
+  // The values must fit the type.
+  pb.set_min_value("x");
+  Status s = copy.FromPB(pb);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  pb.clear_min_value();
+  s = copy.FromPB(pb);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
+TEST(ColumnStatisticsTest, TestString) {
+  ColumnStatistics stats(GetTypeInfo(STRING));
+  vector<Slice> values = { "b", "abc", "b", "ba" };
+  stats.AddValues(reinterpret_cast<const uint8_t*>(values.data()), values.size());
+  EXPECT_EQ("abc", stats.min_value().ToString());
+  EXPECT_EQ("ba", stats.max_value().ToString());
+  EXPECT_EQ(3, stats.EstimateDistinctCount());
+
+  // The statistics don't refer to the added cells.
+  ColumnStatistics other(GetTypeInfo(STRING));
+  {
+    string value = "zzz";
+    Slice cell(value);
+    other.AddValues(reinterpret_cast<const uint8_t*>(&cell), 1);
+  }
+  ASSERT_OK(stats.Merge(other));
+  EXPECT_EQ("abc", stats.min_value().ToString());
+  EXPECT_EQ("zzz", stats.max_value().ToString());
+  EXPECT_EQ(4, stats.non_null_count());
+}
+
+} // namespace kudu
@@ -0,0 +1,166 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/column_statistics.h"
+
+#include <glog/logging.h>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/common/types.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/logging.h"
+
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+// The bytes holding the value of 'cell': the cell itself for fixed size
+// types, or the referenced bytes for binary types.
+Slice ValueBytes(const TypeInfo* type, const void* cell) {
+  if (type->physical_type() == BINARY) {
+    return *reinterpret_cast<const Slice*>(cell);
+  }
+  return Slice(reinterpret_cast<const uint8_t*>(cell), type->size());
+}
+
+// The inverse of ValueBytes(). For binary types, the cell is stored in
+// 'slice_cell' and refers to 'value'.
+const void* ValueCell(const TypeInfo* type, const string& value, Slice* slice_cell) {
+  if (type->physical_type() == BINARY) {
+    *slice_cell = Slice(value);
+    return slice_cell;
+  }
+  return value.data();
+}
+
+} // anonymous namespace
+
+ColumnStatistics::ColumnStatistics(const TypeInfo* type)
+    : type_(type),
+      null_count_(0),
+      non_null_count_(0) {
+}
+
+void ColumnStatistics::AddValues(const uint8_t* cells, size_t count) {
+  if (count == 0) {
+    return;
+  }
+  const size_t cell_size = type_->size();
+  const uint8_t* min_cell = nullptr;
+  const uint8_t* max_cell = nullptr;
+  Slice min_slice;
+  Slice max_slice;
+  const void* min = non_null_count_ > 0 ? ValueCell(type_, min_, &min_slice) : cells;
+  const void* max = non_null_count_ > 0 ? ValueCell(type_, max_, &max_slice) : cells;
+  if (non_null_count_ == 0) {
+    min_cell = max_cell = cells;
+  }
+  for (const uint8_t* cell = cells; cell < cells + count * cell_size; cell += cell_size) {
+    sketch_.Add(ValueBytes(type_, cell));
+    if (type_->Compare(cell, min) < 0) {
+      min = min_cell = cell;
+    } else if (type_->Compare(cell, max) > 0) {
+      max = max_cell = cell;
+    }
+  }
+  // Only copy out the new extremes once, since 'cells' stays valid until we return.
+  if (min_cell != nullptr) {
+    ValueBytes(type_, min_cell).ToString().swap(min_);
+  }
+  if (max_cell != nullptr) {
+    ValueBytes(type_, max_cell).ToString().swap(max_);
+  }
+  non_null_count_ += count;
+}
+
+Status ColumnStatistics::Merge(const ColumnStatistics& other) {
+  DCHECK_EQ(type_->type(), other.type_->type());
+  RETURN_NOT_OK(sketch_.Merge(other.sketch_));
+  if (other.non_null_count_ > 0) {
+    Slice scratch;
+    Slice other_scratch;
+    if (non_null_count_ == 0 ||
+        type_->Compare(ValueCell(type_, other.min_, &other_scratch),
+                       ValueCell(type_, min_, &scratch)) < 0) {
+      min_ = other.min_;
+    }
+    if (non_null_count_ == 0 ||
+        type_->Compare(ValueCell(type_, other.max_, &other_scratch),
+                       ValueCell(type_, max_, &scratch)) > 0) {
+      max_ = other.max_;
+    }
+  }
+  null_count_ += other.null_count_;
+  non_null_count_ += other.non_null_count_;
+  return Status::OK();
+}
+
+void ColumnStatistics::ToPB(ColumnStatisticsPB* pb) const {
+  pb->Clear();
+  pb->set_null_count(null_count_);
+  pb->set_non_null_count(non_null_count_);
+  if (non_null_count_ > 0) {
+    pb->set_min_value(min_);
+    pb->set_max_value(max_);
+  }
+  pb->set_distinct_sketch(sketch_.registers());
+}
+
+Status ColumnStatistics::FromPB(const ColumnStatisticsPB& pb) {
+  if (pb.null_count() < 0 || pb.non_null_count() < 0) {
+    return Status::Corruption("negative value count in column statistics");
+  }
+  bool has_values = pb.non_null_count() > 0;
+  if (has_values != pb.has_min_value() || has_values != pb.has_max_value()) {
+    return Status::Corruption("missing or unexpected minimum or maximum value "
+                              "in column statistics");
+  }
+  if (has_values && type_->physical_type() != BINARY &&
+      (pb.min_value().size() != type_->size() || pb.max_value().size() != type_->size())) {
+    return Status::Corruption(
+        Substitute("invalid size of minimum or maximum value for type $0", type_->name()));
+  }
+  HyperLogLog sketch;
+  if (pb.has_distinct_sketch()) {
+    RETURN_NOT_OK(sketch.FromRegisters(pb.distinct_sketch()));
+  }
+  null_count_ = pb.null_count();
+  non_null_count_ = pb.non_null_count();
+  min_ = pb.min_value();
+  max_ = pb.max_value();
+  sketch_ = std::move(sketch);
+  return Status::OK();
+}
+
+string ColumnStatistics::ToString() const {
+  string ret = Substitute("nulls=$0, non-nulls=$1, distinct~$2",
+                          null_count_, non_null_count_, EstimateDistinctCount());
+  if (non_null_count_ > 0) {
+    Slice scratch;
+    string min;
+    string max;
+    type_->AppendDebugStringForValue(ValueCell(type_, min_, &scratch), &min);
+    type_->AppendDebugStringForValue(ValueCell(type_, max_, &scratch), &max);
+    ret.append(Substitute(", min=$0, max=$1", KUDU_REDACT(min), KUDU_REDACT(max)));
+  }
+  return ret;
+}
+
+} // namespace kudu
@@ -0,0 +1,81 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_COMMON_COLUMN_STATISTICS_H
+#define KUDU_COMMON_COLUMN_STATISTICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+#include "kudu/util/hyperloglog.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnStatisticsPB;
+class TypeInfo;
+
+// Statistics over the values of a column: the number of null and non-null
+// values, the minimum and maximum values, and a sketch estimating the number
+// of distinct values. They are computed as rowsets are written, and merged
+// across rowsets and tablets to help query engines plan queries.
+class ColumnStatistics {
+ public:
+  explicit ColumnStatistics(const TypeInfo* type);
+
+  // Add the 'count' non-null cells starting at 'cells'.
+  void AddValues(const uint8_t* cells, size_t count);
+
+  void AddNulls(size_t count) { null_count_ += count; }
+
+  // Merge the statistics of 'other', over values of the same type, into
+  // these. Returns InvalidArgument if their sketches can't be merged.
+  Status Merge(const ColumnStatistics& other);
+
+  void ToPB(ColumnStatisticsPB* pb) const;
+
+  // Replace the statistics with those of 'pb'. Returns Corruption if the
+  // values don't fit the type or the sketch is invalid.
+  Status FromPB(const ColumnStatisticsPB& pb);
+
+  const TypeInfo* type() const { return type_; }
+  int64_t null_count() const { return null_count_; }
+  int64_t non_null_count() const { return non_null_count_; }
+
+  // The minimum and maximum non-null values, encoded like the bounds of
+  // ColumnPredicatePB::Range. Empty if there are no non-null values.
+  Slice min_value() const { return Slice(min_); }
+  Slice max_value() const { return Slice(max_); }
+
+  // The estimated number of distinct non-null values.
+  uint64_t EstimateDistinctCount() const { return sketch_.Estimate(); }
+
+  std::string ToString() const;
+
+ private:
+  const TypeInfo* type_;
+  int64_t null_count_;
+  int64_t non_null_count_;
+  std::string min_;
+  std::string max_;
+  HyperLogLog sketch_;
+};
+
+} // namespace kudu
+
+#endif
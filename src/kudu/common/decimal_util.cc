@@ -0,0 +1,75 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/common/decimal_util.h"
+
+#include <sstream>
+
+#include <glog/logging.h>
+
+using std::string;
+
+namespace kudu {
+
+int128_t MaxUnscaledDecimal(int8_t precision) {
+  DCHECK_GE(precision, kMinDecimalPrecision);
+  DCHECK_LE(precision, kMaxDecimal128Precision);
+  int128_t result = 1;
+  for (; precision > 0; precision--) {
+    result *= 10;
+  }
+  return result - 1;
+}
+
+int128_t MinUnscaledDecimal(int8_t precision) {
+  return -MaxUnscaledDecimal(precision);
+}
+
+DataType MaxPrecisionToDecimalType(int8_t precision) {
+  if (precision <= kMaxDecimal32Precision) {
+    return DECIMAL32;
+  }
+  if (precision <= kMaxDecimal64Precision) {
+    return DECIMAL64;
+  }
+  return DECIMAL128;
+}
+
+string DecimalToString(int128_t d, int8_t scale) {
+  std::ostringstream ss;
+  if (d < 0) {
+    ss << '-';
+  }
+  // Work on the magnitude in the unsigned domain, where negating the smallest
+  // value doesn't overflow.
+  uint128_t abs = d < 0 ? ~static_cast<uint128_t>(d) + 1 : static_cast<uint128_t>(d);
+  if (scale == 0) {
+    ss << abs;
+    return ss.str();
+  }
+  uint128_t divisor = 1;
+  for (int i = 0; i < scale; i++) {
+    divisor *= 10;
+  }
+  std::ostringstream fraction;
+  fraction << abs % divisor;
+  ss << abs / divisor << '.'
+     << string(scale - fraction.str().size(), '0') << fraction.str();
+  return ss.str();
+}
+
+} // namespace kudu
@@ -0,0 +1,56 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_COMMON_DECIMAL_UTIL_H_
+#define KUDU_COMMON_DECIMAL_UTIL_H_
+
+#include <cstdint>
+#include <string>
+
+#include "kudu/common/common.pb.h"
+#include "kudu/util/int128.h"
+
+namespace kudu {
+
+// The precisions a DECIMAL column may have, and the largest precision each
+// of the storage types holds.
+static const int8_t kMinDecimalPrecision = 1;
+static const int8_t kMaxDecimal32Precision = 9;
+static const int8_t kMaxDecimal64Precision = 18;
+static const int8_t kMaxDecimal128Precision = 38;
+
+static const int8_t kDefaultDecimalScale = 0;
+
+// Returns the largest unscaled value of a decimal of 'precision' digits,
+// that is 10^precision - 1. The smallest is its negation.
+int128_t MaxUnscaledDecimal(int8_t precision);
+int128_t MinUnscaledDecimal(int8_t precision);
+
+// Returns the narrowest DECIMAL type holding 'precision' digits.
+DataType MaxPrecisionToDecimalType(int8_t precision);
+
+// Returns whether 'type' is one of the DECIMAL types.
+inline bool IsDecimalType(DataType type) {
+  return type == DECIMAL32 || type == DECIMAL64 || type == DECIMAL128;
+}
+
+// Formats the unscaled value 'd' of a decimal with 'scale' digits after the
+// decimal point, e.g. 12345 with a scale of 2 is "123.45".
+std::string DecimalToString(int128_t d, int8_t scale);
+
+} // namespace kudu
+
+#endif // KUDU_COMMON_DECIMAL_UTIL_H_
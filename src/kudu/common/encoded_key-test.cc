@@ -19,12 +19,15 @@
 
 #include <gtest/gtest.h>
 
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/random.h"
 #include "kudu/util/random_util.h"
 #include "kudu/util/test_util.h"
+#include "kudu/util/memory/arena.h"
 #include "kudu/util/test_macros.h"
 
 namespace kudu {
@@ -281,6 +284,75 @@ static void NoInlineDoEncode(Slice s, bool is_last, faststring* dst)  {
   KeyEncoderTraits<BINARY, faststring>::EncodeWithSeparators(s, is_last, dst);
 }
 
+// Test that the batch key encoder produces the same keys as
+// Schema::EncodeComparableKey(), for both the RowBlock and the contiguous row
+// inputs, including strings with embedded zeros in the middle and at the end
+// of the key.
+TEST_F(EncodedKeyTest, TestBatchKeyEncoder) {
+  Schema schema({ ColumnSchema("a", INT8),
+                  ColumnSchema("b", STRING),
+                  ColumnSchema("c", INT64),
+                  ColumnSchema("d", STRING),
+                  ColumnSchema("v", INT32, true) }, 4);
+  const int kNumRows = 100;
+  Random r(SeedRandom());
+
+  vector<string> strings;
+  for (int i = 0; i < kNumRows * 2; i++) {
+    string s(r.Uniform(8), 'x');
+    RandomString(&s[0], s.size(), &r);
+    if (r.OneIn(3)) {
+      s.insert(r.Uniform(s.size() + 1), 1, '\0');
+    }
+    strings.push_back(s);
+  }
+
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(schema, kNumRows, &arena);
+  vector<faststring> row_data(kNumRows);
+  vector<const uint8_t*> rows;
+  for (int i = 0; i < kNumRows; i++) {
+    int8_t a = static_cast<int8_t>(r.Next32());
+    Slice b(strings[i * 2]);
+    int64_t c = static_cast<int64_t>(r.Next64());
+    Slice d(strings[i * 2 + 1]);
+
+    RowBlockRow brow = block.row(i);
+    row_data[i].resize(schema.byte_size());
+    ContiguousRow crow(&schema, row_data[i].data());
+    memcpy(brow.mutable_cell_ptr(0), &a, sizeof(a));
+    memcpy(crow.mutable_cell_ptr(0), &a, sizeof(a));
+    memcpy(brow.mutable_cell_ptr(1), &b, sizeof(b));
+    memcpy(crow.mutable_cell_ptr(1), &b, sizeof(b));
+    memcpy(brow.mutable_cell_ptr(2), &c, sizeof(c));
+    memcpy(crow.mutable_cell_ptr(2), &c, sizeof(c));
+    memcpy(brow.mutable_cell_ptr(3), &d, sizeof(d));
+    memcpy(crow.mutable_cell_ptr(3), &d, sizeof(d));
+    rows.push_back(row_data[i].data());
+  }
+
+  BatchKeyEncoder encoder(&schema);
+  Arena key_arena(1024, 1024 * 1024);
+  vector<Slice> block_keys;
+  ASSERT_OK(encoder.EncodeKeys(block, &key_arena, &block_keys));
+  vector<Slice> row_keys;
+  ASSERT_OK(encoder.EncodeKeys(rows, &key_arena, &row_keys));
+  ASSERT_EQ(kNumRows, block_keys.size());
+  ASSERT_EQ(kNumRows, row_keys.size());
+
+  faststring buf;
+  for (int i = 0; i < kNumRows; i++) {
+    SCOPED_TRACE(i);
+    Slice expected = schema.EncodeComparableKey(block.row(i), &buf);
+    EXPECT_EQ(expected.ToDebugString(), block_keys[i].ToDebugString());
+    EXPECT_EQ(expected.ToDebugString(), row_keys[i].ToDebugString());
+  }
+
+  // An empty batch encodes no keys.
+  ASSERT_OK(encoder.EncodeKeys(vector<const uint8_t*>(), &key_arena, &row_keys));
+  ASSERT_TRUE(row_keys.empty());
+}
+
 TEST_F(EncodedKeyTest, BenchmarkStringEncoding) {
   string data;
   for (int i = 0; i < 100; i++) {
@@ -15,19 +15,241 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <cstring>
 #include <vector>
 
 #include "kudu/common/encoded_key.h"
 #include "kudu/common/key_encoder.h"
 #include "kudu/common/key_util.h"
 #include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
 
 namespace kudu {
 
 using std::string;
 
 
+namespace {
+
+// The cells of a column of a RowBlock.
+class ColumnBlockCells {
+ public:
+  ColumnBlockCells(const uint8_t* base, size_t stride)
+    : base_(base),
+      stride_(stride) {
+  }
+
+  const void* cell(size_t row_idx) const {
+    return base_ + row_idx * stride_;
+  }
+
+ private:
+  const uint8_t* const base_;
+  const size_t stride_;
+};
+
+// The rows of a RowBlock.
+class RowBlockRows {
+ public:
+  explicit RowBlockRows(const RowBlock& block) : block_(block) {}
+
+  ColumnBlockCells column(size_t col_idx) const {
+    ColumnBlock cblock = block_.column_block(col_idx);
+    return ColumnBlockCells(cblock.cell_ptr(0), cblock.stride());
+  }
+
+ private:
+  const RowBlock& block_;
+};
+
+// The cells of a column of rows in the contiguous row format.
+class ContiguousCells {
+ public:
+  ContiguousCells(const uint8_t* const* rows, size_t offset)
+    : rows_(rows),
+      offset_(offset) {
+  }
+
+  const void* cell(size_t row_idx) const {
+    return rows_[row_idx] + offset_;
+  }
+
+ private:
+  const uint8_t* const* const rows_;
+  const size_t offset_;
+};
+
+// Rows in the contiguous row format of a schema.
+class ContiguousRows {
+ public:
+  ContiguousRows(const Schema& schema, const vector<const uint8_t*>& rows)
+    : schema_(schema),
+      rows_(rows) {
+  }
+
+  ContiguousCells column(size_t col_idx) const {
+    return ContiguousCells(rows_.data(), schema_.column_offset(col_idx));
+  }
+
+ private:
+  const Schema& schema_;
+  const vector<const uint8_t*>& rows_;
+};
+
+// Returns the size of 's' once encoded as a middle component of a
+// composite key (see KeyEncoderTraits<BINARY>::EncodeWithSeparators()).
+size_t EncodedSizeWithSeparators(const Slice& s) {
+  size_t size = s.size() + 2;
+  const uint8_t* p = s.data();
+  const uint8_t* end = p + s.size();
+  while ((p = static_cast<const uint8_t*>(memchr(p, '\0', end - p))) != nullptr) {
+    size++;
+    p++;
+  }
+  return size;
+}
+
+// Encodes 's' as a middle component of a composite key into 'dst', and
+// returns the end of the encoded component.
+uint8_t* EncodeWithSeparators(const Slice& s, uint8_t* dst) {
+  const uint8_t* p = s.data();
+  const uint8_t* end = p + s.size();
+  while (p != end) {
+    const uint8_t* zero = static_cast<const uint8_t*>(memchr(p, '\0', end - p));
+    const uint8_t* run_end = zero != nullptr ? zero : end;
+    memcpy(dst, p, run_end - p);
+    dst += run_end - p;
+    if (zero == nullptr) {
+      break;
+    }
+    *dst++ = 0;
+    *dst++ = 1;
+    p = zero + 1;
+  }
+  *dst++ = 0;
+  *dst++ = 0;
+  return dst;
+}
+
+// Encodes the integer key column of type 'Type' of each row, at
+// 'cursors[row_idx]', and advances the cursors past it.
+template<DataType Type, class Cells>
+void EncodeIntegerColumn(const Cells& cells, size_t nrows, uint8_t** cursors) {
+  typedef KeyEncoderTraits<Type, faststring> Traits;
+  const size_t size = sizeof(typename DataTypeTraits<Type>::cpp_type);
+  for (size_t i = 0; i < nrows; i++) {
+    Traits::EncodeTo(cells.cell(i), cursors[i]);
+    cursors[i] += size;
+  }
+}
+
+// Same as EncodeIntegerColumn(), but for a BINARY key column.
+template<class Cells>
+void EncodeBinaryColumn(const Cells& cells, size_t nrows, bool is_last, uint8_t** cursors) {
+  for (size_t i = 0; i < nrows; i++) {
+    const Slice* s = reinterpret_cast<const Slice*>(cells.cell(i));
+    if (is_last) {
+      memcpy(cursors[i], s->data(), s->size());
+      cursors[i] += s->size();
+    } else {
+      cursors[i] = EncodeWithSeparators(*s, cursors[i]);
+    }
+  }
+}
+
+} // anonymous namespace
+
+BatchKeyEncoder::BatchKeyEncoder(const Schema* schema)
+  : schema_(schema),
+    fixed_key_size_(0) {
+  for (size_t i = 0; i < schema_->num_key_columns(); i++) {
+    const ColumnSchema& col = schema_->column(i);
+    DCHECK(!col.is_nullable());
+    DataType type = col.type_info()->physical_type();
+    key_types_.push_back(type);
+    if (type != BINARY) {
+      fixed_key_size_ += col.type_info()->size();
+    }
+  }
+}
+
+Status BatchKeyEncoder::EncodeKeys(const RowBlock& block, Arena* arena,
+                                   vector<Slice>* keys) const {
+  DCHECK_KEY_PROJECTION_SCHEMA_EQ(*schema_, block.schema());
+  return DoEncodeKeys(RowBlockRows(block), block.nrows(), arena, keys);
+}
+
+Status BatchKeyEncoder::EncodeKeys(const vector<const uint8_t*>& rows, Arena* arena,
+                                   vector<Slice>* keys) const {
+  return DoEncodeKeys(ContiguousRows(*schema_, rows), rows.size(), arena, keys);
+}
+
+template<class Rows>
+Status BatchKeyEncoder::DoEncodeKeys(const Rows& rows, size_t nrows, Arena* arena,
+                                     vector<Slice>* keys) const {
+  size_t num_key_columns = key_types_.size();
+
+  // First, size each key, so that all of them are allocated at once.
+  vector<size_t> sizes(nrows, fixed_key_size_);
+  for (size_t col_idx = 0; col_idx < num_key_columns; col_idx++) {
+    if (key_types_[col_idx] != BINARY) {
+      continue;
+    }
+    bool is_last = col_idx == num_key_columns - 1;
+    auto cells = rows.column(col_idx);
+    for (size_t i = 0; i < nrows; i++) {
+      const Slice* s = reinterpret_cast<const Slice*>(cells.cell(i));
+      sizes[i] += is_last ? s->size() : EncodedSizeWithSeparators(*s);
+    }
+  }
+  size_t total_size = 0;
+  for (size_t size : sizes) {
+    total_size += size;
+  }
+  uint8_t* data = static_cast<uint8_t*>(arena->AllocateBytes(total_size));
+  if (PREDICT_FALSE(data == nullptr && total_size > 0)) {
+    return Status::RuntimeError("unable to allocate encoded keys from arena");
+  }
+
+  keys->resize(nrows);
+  vector<uint8_t*> cursors(nrows);
+  uint8_t* key_data = data;
+  for (size_t i = 0; i < nrows; i++) {
+    (*keys)[i] = Slice(key_data, sizes[i]);
+    cursors[i] = key_data;
+    key_data += sizes[i];
+  }
+
+  // Then encode each key column of every row.
+  for (size_t col_idx = 0; col_idx < num_key_columns; col_idx++) {
+    auto cells = rows.column(col_idx);
+    switch (key_types_[col_idx]) {
+      case UINT8: EncodeIntegerColumn<UINT8>(cells, nrows, cursors.data()); break;
+      case INT8: EncodeIntegerColumn<INT8>(cells, nrows, cursors.data()); break;
+      case UINT16: EncodeIntegerColumn<UINT16>(cells, nrows, cursors.data()); break;
+      case INT16: EncodeIntegerColumn<INT16>(cells, nrows, cursors.data()); break;
+      case UINT32: EncodeIntegerColumn<UINT32>(cells, nrows, cursors.data()); break;
+      case INT32: EncodeIntegerColumn<INT32>(cells, nrows, cursors.data()); break;
+      case UINT64: EncodeIntegerColumn<UINT64>(cells, nrows, cursors.data()); break;
+      case INT64: EncodeIntegerColumn<INT64>(cells, nrows, cursors.data()); break;
+      case INT128: EncodeIntegerColumn<INT128>(cells, nrows, cursors.data()); break;
+      case BINARY:
+        EncodeBinaryColumn(cells, nrows, col_idx == num_key_columns - 1, cursors.data());
+        break;
+      default:
+        LOG(FATAL) << "type not allowed in keys: " << DataType_Name(key_types_[col_idx]);
+    }
+  }
+#ifndef NDEBUG
+  for (size_t i = 0; i < nrows; i++) {
+    DCHECK_EQ(cursors[i], (*keys)[i].data() + (*keys)[i].size());
+  }
+#endif
+  return Status::OK();
+}
+
 EncodedKey::EncodedKey(faststring* data,
                        vector<const void *> *raw_keys,
                        size_t num_key_cols)
@@ -25,7 +25,9 @@
 
 namespace kudu {
 
+class Arena;
 class ConstContiguousRow;
+class RowBlock;
 
 class EncodedKey {
  public:
@@ -88,6 +90,45 @@ class EncodedKey {
   vector<const void *> raw_keys_;
 };
 
+// Encodes the primary keys of many rows at once, one key column at a time.
+//
+// The physical types of the key columns are resolved once per schema rather
+// than once per cell, and each key column is encoded for all of the rows by
+// a loop specialized for its type. The keys are the same as those encoded by
+// Schema::EncodeComparableKey(), and are all allocated at once from an arena.
+class BatchKeyEncoder {
+ public:
+  // 'schema' must remain valid for the lifetime of the BatchKeyEncoder.
+  explicit BatchKeyEncoder(const Schema* schema);
+
+  // Encodes the key of every row of 'block', selected or not, into 'arena'
+  // and sets 'keys' to them, in order. 'block' must have the key columns of
+  // the schema first.
+  //
+  // Returns RuntimeError if the keys can't be allocated from the arena.
+  Status EncodeKeys(const RowBlock& block, Arena* arena, vector<Slice>* keys) const;
+
+  // Same as above, but for the rows at 'rows', in the contiguous row format
+  // of the schema (or of its key projection).
+  Status EncodeKeys(const vector<const uint8_t*>& rows, Arena* arena,
+                    vector<Slice>* keys) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BatchKeyEncoder);
+
+  template<class Rows>
+  Status DoEncodeKeys(const Rows& rows, size_t nrows, Arena* arena,
+                      vector<Slice>* keys) const;
+
+  const Schema* const schema_;
+
+  // The physical types of the key columns.
+  vector<DataType> key_types_;
+
+  // The total size of the fixed-width key columns.
+  size_t fixed_key_size_;
+};
+
 // A builder for encoded key: creates an encoded key from
 // one or more key columns specified as raw pointers.
 class EncodedKeyBuilder {
@@ -29,6 +29,7 @@
 #include "kudu/common/schema.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/mathlimits.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
@@ -37,9 +38,12 @@ DEFINE_int32(num_lists, 3, "Number of lists to merge");
 DEFINE_int32(num_rows, 1000, "Number of entries per list");
 DEFINE_int32(num_iters, 1, "Number of times to run merge");
 
+DECLARE_int32(materializing_iterator_predicate_order_sample_batches);
+
 namespace kudu {
 
 using std::shared_ptr;
+using std::get;
 
 static const Schema kIntSchema({ ColumnSchema("val", UINT32) }, 1);
 
@@ -117,6 +121,129 @@ class VectorIterator : public ColumnwiseIterator {
   size_t prepared_;
 };
 
+static const Schema kTwoIntSchema({ ColumnSchema("a", UINT32),
+                                   ColumnSchema("b", UINT32) }, 1);
+
+// Test iterator which yields rows of kTwoIntSchema from a vector per column.
+class TwoColumnVectorIterator : public ColumnwiseIterator {
+ public:
+  TwoColumnVectorIterator(vector<uint32_t> a, vector<uint32_t> b)
+      : columns_({ std::move(a), std::move(b) }),
+        cur_idx_(0),
+        prepared_(0) {
+    CHECK_EQ(columns_[0].size(), columns_[1].size());
+  }
+
+  Status Init(ScanSpec *spec) OVERRIDE {
+    return Status::OK();
+  }
+
+  virtual Status PrepareBatch(size_t* nrows) OVERRIDE {
+    prepared_ = std::min(columns_[0].size() - cur_idx_, *nrows);
+    *nrows = prepared_;
+    return Status::OK();
+  }
+
+  virtual Status InitializeSelectionVector(SelectionVector *sel_vec) OVERRIDE {
+    sel_vec->SetAllTrue();
+    return Status::OK();
+  }
+
+  Status MaterializeColumn(ColumnMaterializationContext* ctx) override {
+    ctx->SetDecoderEvalNotSupported();
+    const vector<uint32_t>& column = columns_[ctx->col_idx()];
+    for (size_t i = 0; i < prepared_; i++) {
+      ctx->block()->SetCellValue(i, &column[cur_idx_ + i]);
+    }
+    return Status::OK();
+  }
+
+  virtual Status FinishBatch() OVERRIDE {
+    cur_idx_ += prepared_;
+    prepared_ = 0;
+    return Status::OK();
+  }
+
+  virtual bool HasNext() const OVERRIDE {
+    return cur_idx_ < columns_[0].size();
+  }
+
+  virtual string ToString() const OVERRIDE {
+    return string("TwoColumnVectorIterator");
+  }
+
+  virtual const Schema &schema() const OVERRIDE {
+    return kTwoIntSchema;
+  }
+
+  virtual void GetIteratorStats(vector<IteratorStats>* stats) const OVERRIDE {
+    stats->resize(schema().num_columns());
+  }
+
+ private:
+  vector<vector<uint32_t>> columns_;
+  size_t cur_idx_;
+  size_t prepared_;
+};
+
+// Test that the MaterializingIterator moves a predicate which filters out
+// nothing behind one which filters out most rows once it has sampled a few
+// batches.
+TEST(TestMaterializingIterator, TestAdaptivePredicateOrder) {
+  FLAGS_materializing_iterator_predicate_order_sample_batches = 4;
+  const int kNumRows = 1000;
+  const int kBatchSize = 100;
+
+  // Every row has a == 7, and one in ten has b < 10.
+  vector<uint32_t> a(kNumRows, 7);
+  vector<uint32_t> b;
+  for (int i = 0; i < kNumRows; i++) {
+    b.push_back(i % kBatchSize);
+  }
+  uint32_t a_value = 7;
+  uint32_t b_lower = 0;
+  uint32_t b_upper = 10;
+  ScanSpec spec;
+  spec.AddPredicate(ColumnPredicate::Equality(kTwoIntSchema.column(0), &a_value));
+  spec.AddPredicate(ColumnPredicate::Range(kTwoIntSchema.column(1), &b_lower, &b_upper));
+
+  shared_ptr<TwoColumnVectorIterator> colwise(new TwoColumnVectorIterator(a, b));
+  MaterializingIterator materializing(colwise);
+  ASSERT_OK(materializing.Init(&spec));
+  ASSERT_EQ(2, materializing.col_idx_predicates_.size());
+
+  // Start out evaluating the predicate on 'a' first.
+  if (get<0>(materializing.col_idx_predicates_[0]) != 0) {
+    std::swap(materializing.col_idx_predicates_[0], materializing.col_idx_predicates_[1]);
+  }
+
+  Arena arena(1024, 1024);
+  RowBlock dst(kTwoIntSchema, kBatchSize, &arena);
+  int num_batches = 0;
+  while (materializing.HasNext()) {
+    ASSERT_OK(materializing.NextBlock(&dst));
+    ASSERT_EQ(kBatchSize, dst.nrows());
+    ASSERT_EQ(10, dst.selection_vector()->CountSelected());
+    num_batches++;
+    if (num_batches < 4) {
+      ASSERT_EQ(0, get<0>(materializing.col_idx_predicates_[0]));
+    } else {
+      ASSERT_EQ(1, get<0>(materializing.col_idx_predicates_[0]));
+    }
+  }
+  ASSERT_EQ(kNumRows / kBatchSize, num_batches);
+
+  // The predicate on 'a' saw every row of the first four batches, but only the
+  // rows which passed the predicate on 'b' afterwards.
+  vector<IteratorStats> stats;
+  materializing.GetIteratorStats(&stats);
+  ASSERT_EQ(2, stats.size());
+  ASSERT_EQ(4 * kBatchSize + 6 * 10, stats[0].predicate_rows_evaluated);
+  ASSERT_EQ(4 * kBatchSize + 6 * 10, stats[0].predicate_rows_passed);
+  ASSERT_EQ(kNumRows, stats[1].predicate_rows_evaluated);
+  ASSERT_EQ(kNumRows / 10, stats[1].predicate_rows_passed);
+}
+
 // Test that empty input to a merger behaves correctly.
 TEST(TestMergeIterator, TestMergeEmpty) {
   vector<uint32_t> empty_vec;
@@ -228,6 +355,157 @@ TEST(TestMergeIterator, TestMergePredicate2) {
   TestMerge(predicate);
 }
 
+// Returns iterators over 'num_lists' sorted lists which interleave the
+// integers [0, num_lists * num_rows).
+static vector<shared_ptr<RowwiseIterator>> InterleavedIterators(int num_lists, int num_rows) {
+  vector<shared_ptr<RowwiseIterator>> iters;
+  for (int i = 0; i < num_lists; i++) {
+    vector<uint32_t> ints;
+    for (int j = 0; j < num_rows; j++) {
+      ints.push_back(j * num_lists + i);
+    }
+    shared_ptr<VectorIterator> it(new VectorIterator(ints));
+    it->set_block_size(10);
+    iters.emplace_back(new MaterializingIterator(it));
+  }
+  return iters;
+}
+
+// Test that a merge with a limit returns the smallest rows which pass the
+// predicates, and stops there.
+TEST(TestMergeIterator, TestMergeWithLimit) {
+  const int kLimit = 150;
+  TestIntRangePredicate predicate(10, MathLimits<uint32_t>::kMax);
+  ScanSpec spec;
+  spec.AddPredicate(predicate.pred_);
+  spec.set_limit(kLimit);
+
+  MergeIterator merger(kIntSchema, InterleavedIterators(3, 500));
+  ASSERT_OK(merger.Init(&spec));
+
+  RowBlock dst(kIntSchema, 100, nullptr);
+  vector<uint32_t> results;
+  while (merger.HasNext()) {
+    ASSERT_OK(merger.NextBlock(&dst));
+    for (int i = 0; i < dst.nrows(); i++) {
+      results.push_back(*kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+    }
+  }
+  ASSERT_EQ(kLimit, results.size());
+  for (int i = 0; i < kLimit; i++) {
+    ASSERT_EQ(i + 10, results[i]);
+  }
+}
+
+// Returns iterators over 'num_lists' sorted lists whose key ranges don't
+// overlap, together covering the integers [0, num_lists * num_rows), in the
+// order 'num_lists - 1' down to 0.
+static vector<shared_ptr<RowwiseIterator>> DisjointIterators(int num_lists, int num_rows) {
+  vector<shared_ptr<RowwiseIterator>> iters;
+  for (int i = num_lists - 1; i >= 0; i--) {
+    vector<uint32_t> ints;
+    for (int j = 0; j < num_rows; j++) {
+      ints.push_back(i * num_rows + j);
+    }
+    shared_ptr<VectorIterator> it(new VectorIterator(ints));
+    it->set_block_size(100);
+    iters.emplace_back(new MaterializingIterator(it));
+  }
+  return iters;
+}
+
+// Merges the same number of rows spread over an increasing number of
+// sub-iterators, whose key ranges either interleave or are disjoint, and
+// checks that the merged rows come out in order.
+TEST(TestMergeIterator, BenchmarkMergeManyIterators) {
+  const int kTotalRows = AllowSlowTests() ? 1000000 : 50000;
+  for (int num_lists : { 1, 10, 100, 500, 1000 }) {
+    for (bool disjoint : { false, true }) {
+      int num_rows = kTotalRows / num_lists;
+      vector<shared_ptr<RowwiseIterator>> iters = disjoint ?
+          DisjointIterators(num_lists, num_rows) : InterleavedIterators(num_lists, num_rows);
+      MergeIterator merger(kIntSchema, iters);
+      ASSERT_OK(merger.Init(nullptr));
+
+      RowBlock dst(kIntSchema, 100, nullptr);
+      uint32_t expected = 0;
+      LOG_TIMING(INFO, strings::Substitute("merging $0 rows from $1 $2 iterators",
+                                           num_lists * num_rows, num_lists,
+                                           disjoint ? "disjoint" : "interleaved")) {
+        while (merger.HasNext()) {
+          ASSERT_OK(merger.NextBlock(&dst));
+          for (int i = 0; i < dst.nrows(); i++) {
+            ASSERT_EQ(expected++, *kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+          }
+        }
+      }
+      ASSERT_EQ(static_cast<uint32_t>(num_lists * num_rows), expected);
+    }
+  }
+}
+
+// Test that a union with a limit deselects the rows past the limit and stops
+// there.
+TEST(TestUnionIterator, TestUnionWithLimit) {
+  const int kLimit = 155;
+  TestIntRangePredicate predicate(10, MathLimits<uint32_t>::kMax);
+  ScanSpec spec;
+  spec.AddPredicate(predicate.pred_);
+  spec.set_limit(kLimit);
+
+  UnionIterator union_iter(InterleavedIterators(3, 500));
+  ASSERT_OK(union_iter.Init(&spec));
+
+  Arena arena(1024, 1024);
+  RowBlock dst(kIntSchema, 100, &arena);
+  int num_selected = 0;
+  while (union_iter.HasNext()) {
+    ASSERT_OK(union_iter.NextBlock(&dst));
+    num_selected += dst.selection_vector()->CountSelected();
+  }
+  ASSERT_EQ(kLimit, num_selected);
+}
+
+// Test that a union which prefetches the first blocks of its next
+// sub-iterators returns the same rows, in the same order, as one which
+// doesn't, including the rows deselected by predicates.
+TEST(TestUnionIterator, TestUnionWithPrefetch) {
+  const int kNumLists = 10;
+  const int kNumRows = 500;
+  TestIntRangePredicate predicate(100, MathLimits<uint32_t>::kMax);
+
+  for (int prefetch_depth : { 0, 1, 3, kNumLists + 1 }) {
+    SCOPED_TRACE(prefetch_depth);
+    ScanSpec spec;
+    spec.AddPredicate(predicate.pred_);
+    UnionIterator union_iter(InterleavedIterators(kNumLists, kNumRows), prefetch_depth);
+    ASSERT_OK(union_iter.Init(&spec));
+
+    Arena arena(1024, 1024);
+    RowBlock dst(kIntSchema, 100, &arena);
+    vector<uint32_t> results;
+    while (union_iter.HasNext()) {
+      ASSERT_OK(union_iter.NextBlock(&dst));
+      for (int i = 0; i < dst.nrows(); i++) {
+        if (dst.selection_vector()->IsRowSelected(i)) {
+          results.push_back(*kIntSchema.ExtractColumnFromRow<UINT32>(dst.row(i), 0));
+        }
+      }
+    }
+
+    vector<uint32_t> expected;
+    for (int i = 0; i < kNumLists; i++) {
+      for (int j = 0; j < kNumRows; j++) {
+        uint32_t val = j * kNumLists + i;
+        if (val >= predicate.lower_) {
+          expected.push_back(val);
+        }
+      }
+    }
+    ASSERT_EQ(expected, results);
+  }
+}
+
 // Test that the MaterializingIterator properly evaluates predicates when they apply
 // to single columns.
 TEST(TestMaterializingIterator, TestMaterializingPredicatePushdown) {
@@ -16,7 +16,9 @@
 // under the License.
 
 #include <algorithm>
+#include <limits>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <tuple>
 #include <utility>
@@ -28,16 +30,27 @@
 #include "kudu/common/rowblock.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/singleton.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/io_rate_limiter.h"
 #include "kudu/util/memory/arena.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/threadpool.h"
 
 using std::all_of;
 using std::get;
+using std::iota;
+using std::make_heap;
 using std::move;
+using std::numeric_limits;
+using std::pop_heap;
+using std::push_heap;
 using std::remove_if;
 using std::shared_ptr;
 using std::sort;
+using std::stable_sort;
 using std::string;
 using std::unique_ptr;
 using std::tuple;
@@ -49,6 +62,30 @@ DEFINE_bool(materializing_iterator_decoder_eval, true,
             "Should MaterializingIterator do decoder-level evaluation");
 TAG_FLAG(materializing_iterator_decoder_eval, hidden);
 TAG_FLAG(materializing_iterator_decoder_eval, runtime);
+DEFINE_bool(materializing_iterator_zero_copy, true,
+            "Should MaterializingIterator let column iterators reference values "
+            "in memory they already hold (e.g. cached blocks) instead of copying them");
+TAG_FLAG(materializing_iterator_zero_copy, advanced);
+TAG_FLAG(materializing_iterator_zero_copy, runtime);
+DEFINE_bool(materializing_iterator_skip_deselected, true,
+            "Should MaterializingIterator let column iterators skip decoding the "
+            "values of rows already filtered out of the batch");
+TAG_FLAG(materializing_iterator_skip_deselected, advanced);
+TAG_FLAG(materializing_iterator_skip_deselected, runtime);
+DEFINE_bool(materializing_iterator_adaptive_predicate_order, true,
+            "Should MaterializingIterator reorder the predicates it evaluates by "
+            "their observed selectivity and cost once the first batches are scanned");
+TAG_FLAG(materializing_iterator_adaptive_predicate_order, advanced);
+TAG_FLAG(materializing_iterator_adaptive_predicate_order, runtime);
+DEFINE_int32(materializing_iterator_predicate_order_sample_batches, 4,
+             "Number of batches MaterializingIterator scans before reordering "
+             "its predicates, if --materializing_iterator_adaptive_predicate_order "
+             "is set");
+TAG_FLAG(materializing_iterator_predicate_order_sample_batches, advanced);
+DEFINE_int32(union_iterator_prefetch_threads, 4,
+             "Maximum number of threads used to read the first blocks of the "
+             "sub-iterators of unordered scans ahead of their turn.");
+TAG_FLAG(union_iterator_prefetch_threads, experimental);
 
 namespace kudu {
 
@@ -59,15 +96,43 @@ namespace kudu {
 // TODO: size by bytes, not # rows
 static const int kMergeRowBuffer = 1000;
 
+// The smallest block read from each sub-iterator of a merge with a limit.
+// Smaller blocks would make the per-block overhead of evaluating predicates
+// dominate.
+static const int kMinLimitedMergeRowBuffer = 100;
+
+namespace {
+
+// Deselects the rows of 'sel' past its first 'max_selected' selected rows.
+// Returns the number of rows left selected.
+size_t LimitSelectedRows(SelectionVector* sel, size_t max_selected) {
+  size_t num_selected = sel->CountSelected();
+  if (num_selected <= max_selected) {
+    return num_selected;
+  }
+  size_t kept = 0;
+  for (size_t i = 0; i < sel->nrows(); i++) {
+    if (!sel->IsRowSelected(i)) continue;
+    if (kept == max_selected) {
+      BitmapChangeBits(sel->mutable_bitmap(), i, sel->nrows() - i, false);
+      break;
+    }
+    kept++;
+  }
+  return max_selected;
+}
+
+} // anonymous namespace
+
 // MergeIterState wraps a RowwiseIterator for use by the MergeIterator.
 // Importantly, it also filters out unselected rows from the wrapped RowwiseIterator,
 // such that all returned rows are valid.
 class MergeIterState {
  public:
-  explicit MergeIterState(const shared_ptr<RowwiseIterator> &iter) :
+  MergeIterState(const shared_ptr<RowwiseIterator> &iter, size_t block_rows) :
     iter_(iter),
     arena_(1024, 256*1024),
-    read_block_(iter->schema(), kMergeRowBuffer, &arena_),
+    read_block_(iter->schema(), block_rows, &arena_),
     next_row_idx_(0),
     num_advanced_(0),
     num_valid_(0)
@@ -159,9 +224,13 @@ class MergeIterState {
 
 MergeIterator::MergeIterator(
   const Schema &schema,
-  const vector<shared_ptr<RowwiseIterator> > &iters)
+  const vector<shared_ptr<RowwiseIterator> > &iters,
+  RowComparator comparator)
   : schema_(schema),
-    initted_(false) {
+    comparator_(std::move(comparator)),
+    initted_(false),
+    limit_(-1),
+    num_returned_(0) {
   CHECK_GT(iters.size(), 0);
   CHECK_GT(schema.num_key_columns(), 0);
   orig_iters_.assign(iters.begin(), iters.end());
@@ -173,6 +242,9 @@ Status MergeIterator::Init(ScanSpec *spec) {
   CHECK(!initted_);
   // TODO: check that schemas match up!
 
+  if (spec != nullptr) {
+    limit_ = spec->limit();
+  }
   RETURN_NOT_OK(InitSubIterators(spec));
 
   for (unique_ptr<MergeIterState> &state : iters_) {
@@ -187,6 +259,10 @@ Status MergeIterator::Init(ScanSpec *spec) {
         return PREDICT_FALSE(iter->IsFullyExhausted());
       }),
       iters_.end());
+  make_heap(iters_.begin(), iters_.end(),
+            [this] (const unique_ptr<MergeIterState>& a, const unique_ptr<MergeIterState>& b) {
+              return HeapOrder(a, b);
+            });
 
   initted_ = true;
   return Status::OK();
@@ -194,15 +270,23 @@ Status MergeIterator::Init(ScanSpec *spec) {
 
 bool MergeIterator::HasNext() const {
   CHECK(initted_);
-  return !iters_.empty();
+  return !iters_.empty() && (limit_ < 0 || num_returned_ < limit_);
 }
 
 Status MergeIterator::InitSubIterators(ScanSpec *spec) {
+  // No sub-iterator contributes more rows than the limit, so there's no point
+  // in reading much larger blocks from them.
+  size_t block_rows = kMergeRowBuffer;
+  if (limit_ >= 0) {
+    block_rows = std::min<int64_t>(kMergeRowBuffer,
+                                   std::max<int64_t>(limit_, kMinLimitedMergeRowBuffer));
+  }
+
   // Initialize all the sub iterators.
   for (shared_ptr<RowwiseIterator> &iter : orig_iters_) {
     ScanSpec *spec_copy = spec != nullptr ? scan_spec_copies_.Construct(*spec) : nullptr;
     RETURN_NOT_OK(PredicateEvaluatingIterator::InitAndMaybeWrap(&iter, spec_copy));
-    iters_.push_back(unique_ptr<MergeIterState>(new MergeIterState(iter)));
+    iters_.push_back(unique_ptr<MergeIterState>(new MergeIterState(iter, block_rows)));
   }
 
   // Since we handle predicates in all the wrapped iterators, we can clear
@@ -219,6 +303,7 @@ Status MergeIterator::NextBlock(RowBlock* dst) {
 
   PrepareBatch(dst);
   RETURN_NOT_OK(MaterializeBlock(dst));
+  num_returned_ += dst->nrows();
 
   return Status::OK();
 }
@@ -235,44 +320,61 @@ void MergeIterator::PrepareBatch(RowBlock* dst) {
     available += iter->remaining_in_block();
   }
 
-  dst->Resize(std::min(dst->row_capacity(), available));
+  size_t nrows = std::min(dst->row_capacity(), available);
+  if (limit_ >= 0) {
+    nrows = std::min<int64_t>(nrows, limit_ - num_returned_);
+  }
+  dst->Resize(nrows);
+}
+
+// The comparisons below are the hot spot of merging scans, which is why callers
+// may supply a code-generated comparator in place of Schema::Compare().
+int MergeIterator::CompareRows(const RowBlockRow& a, const RowBlockRow& b) const {
+  return comparator_ ? comparator_(a, b) : schema_.Compare(a, b);
+}
+
+bool MergeIterator::HeapOrder(const unique_ptr<MergeIterState>& a,
+                              const unique_ptr<MergeIterState>& b) const {
+  // The standard heap algorithms keep the largest element on top.
+  return CompareRows(a->next_row(), b->next_row()) > 0;
 }
 
-// TODO: this is an obvious spot to add codegen - there's a ton of branching
-// and such around the comparisons. A simple experiment indicated there's some
-// 2x to be gained.
 Status MergeIterator::MaterializeBlock(RowBlock *dst) {
+  auto heap_order = [this] (const unique_ptr<MergeIterState>& a,
+                            const unique_ptr<MergeIterState>& b) {
+    return HeapOrder(a, b);
+  };
+
   // Initialize the selection vector.
   // MergeIterState only returns selected rows.
   dst->selection_vector()->SetAllTrue();
-  for (size_t dst_row_idx = 0; dst_row_idx < dst->nrows(); dst_row_idx++) {
-    RowBlockRow dst_row = dst->row(dst_row_idx);
-
-    // Find the sub-iterator which is currently smallest
-    MergeIterState *smallest = nullptr;
-    ssize_t smallest_idx = -1;
-
-    // Typically the number of iters_ is not that large, so using a priority
-    // queue is not worth it
-    for (size_t i = 0; i < iters_.size(); i++) {
-      unique_ptr<MergeIterState> &state = iters_[i];
-
-      if (smallest == nullptr ||
-          schema_.Compare(state->next_row(), smallest->next_row()) < 0) {
-        smallest = state.get();
-        smallest_idx = i;
-      }
-    }
-
+  size_t dst_row_idx = 0;
+  while (dst_row_idx < dst->nrows()) {
     // If no iterators had any row left, then we're done iterating.
-    if (PREDICT_FALSE(smallest == nullptr)) break;
-
-    // Otherwise, copy the row from the smallest one, and advance it
-    RETURN_NOT_OK(CopyRow(smallest->next_row(), &dst_row, dst->arena()));
-    RETURN_NOT_OK(smallest->Advance());
+    if (PREDICT_FALSE(iters_.empty())) break;
+
+    // Take the sub-iterator which is currently smallest off the heap.
+    pop_heap(iters_.begin(), iters_.end(), heap_order);
+    MergeIterState* smallest = iters_.back().get();
+
+    // Copy rows from it for as long as they're smaller than the next row of
+    // every other sub-iterator, i.e. the top of the remaining heap. When the
+    // key ranges of the sub-iterators don't overlap (e.g. compacted rowsets),
+    // this copies whole runs of rows for a single comparison each, without
+    // touching the heap.
+    const RowBlockRow* bound = iters_.size() > 1 ? &iters_.front()->next_row() : nullptr;
+    do {
+      RowBlockRow dst_row = dst->row(dst_row_idx++);
+      RETURN_NOT_OK(CopyRow(smallest->next_row(), &dst_row, dst->arena()));
+      RETURN_NOT_OK(smallest->Advance());
+    } while (dst_row_idx < dst->nrows() &&
+             !smallest->IsFullyExhausted() &&
+             (bound == nullptr || CompareRows(smallest->next_row(), *bound) < 0));
 
     if (smallest->IsFullyExhausted()) {
-      iters_.erase(iters_.begin() + smallest_idx);
+      iters_.pop_back();
+    } else {
+      push_heap(iters_.begin(), iters_.end(), heap_order);
     }
   }
 
@@ -321,17 +423,79 @@ void MergeIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
 // Union iterator
 ////////////////////////////////////////////////////////////
 
-UnionIterator::UnionIterator(const vector<shared_ptr<RowwiseIterator> > &iters)
+namespace {
+
+// Process-wide pool of threads which read blocks ahead from the
+// sub-iterators of UnionIterators.
+class UnionPrefetchPool {
+ public:
+  static ThreadPool* Get() {
+    return Singleton<UnionPrefetchPool>::get()->pool_.get();
+  }
+
+ private:
+  friend class Singleton<UnionPrefetchPool>;
+
+  UnionPrefetchPool() {
+    CHECK_OK(ThreadPoolBuilder("union-prefetch")
+             .set_max_threads(FLAGS_union_iterator_prefetch_threads)
+             .Build(&pool_));
+  }
+
+  gscoped_ptr<ThreadPool> pool_;
+};
+
+} // anonymous namespace
+
+struct UnionIterator::PrefetchedBlock {
+  PrefetchedBlock(const Schema& schema, size_t nrows)
+    : arena(1024, 1024 * 1024),
+      block(schema, nrows, &arena),
+      next_row_idx(0),
+      done(1) {
+  }
+
+  Arena arena;
+  RowBlock block;
+
+  // The result of reading 'block', set before 'done' is counted down.
+  Status status;
+
+  // The first row of 'block' not yet returned.
+  size_t next_row_idx;
+
+  CountDownLatch done;
+};
+
+UnionIterator::UnionIterator(const vector<shared_ptr<RowwiseIterator> > &iters,
+                             int prefetch_depth)
   : initted_(false),
-    iters_(iters.size()) {
+    iters_(iters.size()),
+    prefetch_depth_(prefetch_depth),
+    prefetched_(iters.size()),
+    limit_(-1),
+    num_returned_(0) {
   CHECK_GT(iters.size(), 0);
   iters_.assign(iters.begin(), iters.end());
   all_iters_.assign(iters.begin(), iters.end());
 }
 
+UnionIterator::~UnionIterator() {
+  // The prefetching threads may still be reading from the sub-iterators.
+  for (const shared_ptr<PrefetchedBlock>& pb : prefetched_) {
+    if (pb) {
+      pb->done.Wait();
+    }
+  }
+}
+
 Status UnionIterator::Init(ScanSpec *spec) {
   CHECK(!initted_);
 
+  if (spec != nullptr) {
+    limit_ = spec->limit();
+  }
+
   // Initialize the underlying iterators
   RETURN_NOT_OK(InitSubIterators(spec));
 
@@ -368,8 +532,11 @@ Status UnionIterator::InitSubIterators(ScanSpec *spec) {
 
 bool UnionIterator::HasNext() const {
   CHECK(initted_);
-  for (const shared_ptr<RowwiseIterator> &iter : iters_) {
-    if (iter->HasNext()) return true;
+  if (limit_ >= 0 && num_returned_ >= limit_) {
+    return false;
+  }
+  for (size_t i = 0; i < iters_.size(); i++) {
+    if (prefetched_[i] || iters_[i]->HasNext()) return true;
   }
 
   return false;
@@ -380,27 +547,95 @@ Status UnionIterator::NextBlock(RowBlock* dst) {
   PrepareBatch();
   RETURN_NOT_OK(MaterializeBlock(dst));
   FinishBatch();
+  if (limit_ >= 0) {
+    num_returned_ += LimitSelectedRows(dst->selection_vector(), limit_ - num_returned_);
+  }
   return Status::OK();
 }
 
 void UnionIterator::PrepareBatch() {
   CHECK(initted_);
+  last_prefetched_.reset();
 
   while (!iters_.empty() &&
+         !prefetched_.front() &&
          !iters_.front()->HasNext()) {
-    iters_.pop_front();
+    PopFront();
   }
 }
 
 Status UnionIterator::MaterializeBlock(RowBlock *dst) {
+  if (prefetch_depth_ > 0) {
+    StartPrefetches(*dst);
+  }
+  if (prefetched_.front()) {
+    return CopyPrefetchedRows(prefetched_.front().get(), dst);
+  }
   return iters_.front()->NextBlock(dst);
 }
 
 void UnionIterator::FinishBatch() {
-  if (!iters_.front()->HasNext()) {
+  const shared_ptr<PrefetchedBlock>& pb = prefetched_.front();
+  if (pb && pb->next_row_idx == pb->block.nrows()) {
+    last_prefetched_ = pb;
+    prefetched_.front().reset();
+  }
+  if (!prefetched_.front() && !iters_.front()->HasNext()) {
     // Iterator exhausted, remove it.
-    iters_.pop_front();
+    PopFront();
+  }
+}
+
+void UnionIterator::PopFront() {
+  iters_.pop_front();
+  prefetched_.pop_front();
+}
+
+void UnionIterator::StartPrefetches(const RowBlock& dst) {
+  ThreadPool* pool = UnionPrefetchPool::Get();
+  for (size_t i = 1; i < iters_.size() && i <= static_cast<size_t>(prefetch_depth_); i++) {
+    if (prefetched_[i] || !iters_[i]->HasNext()) {
+      continue;
+    }
+    shared_ptr<RowwiseIterator> iter = iters_[i];
+    auto pb = std::make_shared<PrefetchedBlock>(iter->schema(), dst.row_capacity());
+    bool background_io = IoRateLimiter::IsBackgroundIoThread();
+    Status s = pool->SubmitFunc([iter, pb, background_io]() {
+        ScopedBackgroundIo scope(background_io);
+        pb->status = iter->NextBlock(&pb->block);
+        pb->done.CountDown();
+      });
+    if (PREDICT_FALSE(!s.ok())) {
+      // The iterator is read in the foreground once its turn comes.
+      VLOG(1) << "Unable to prefetch from " << iter->ToString() << ": " << s.ToString();
+      return;
+    }
+    prefetched_[i] = std::move(pb);
+  }
+}
+
+Status UnionIterator::CopyPrefetchedRows(PrefetchedBlock* pb, RowBlock* dst) {
+  pb->done.Wait();
+  RETURN_NOT_OK(pb->status);
+
+  if (dst->arena()) {
+    dst->arena()->Reset();
+  }
+  const RowBlock& src = pb->block;
+  size_t nrows = std::min(dst->row_capacity(), src.nrows() - pb->next_row_idx);
+  dst->Resize(nrows);
+  SelectionVector* sel = dst->selection_vector();
+  sel->SetAllTrue();
+  for (size_t i = 0; i < nrows; i++) {
+    size_t src_idx = pb->next_row_idx + i;
+    RowBlockRow dst_row = dst->row(i);
+    RETURN_NOT_OK(CopyRow(src.row(src_idx), &dst_row, dst->arena()));
+    if (!src.selection_vector()->IsRowSelected(src_idx)) {
+      sel->SetRowUnselected(i);
+    }
   }
+  pb->next_row_idx += nrows;
+  return Status::OK();
 }
 
 
@@ -421,6 +656,12 @@ string UnionIterator::ToString() const {
 
 void UnionIterator::GetIteratorStats(std::vector<IteratorStats>* stats) const {
   CHECK(initted_);
+  // Don't race with the prefetching threads on the sub-iterators' stats.
+  for (const shared_ptr<PrefetchedBlock>& pb : prefetched_) {
+    if (pb) {
+      pb->done.Wait();
+    }
+  }
   vector<vector<IteratorStats> > stats_by_iter;
   for (const shared_ptr<RowwiseIterator>& iter : all_iters_) {
     vector<IteratorStats> stats_for_iter;
@@ -443,7 +684,10 @@ void UnionIterator::GetIteratorStats(std::vector<IteratorStats>* stats) const {
 MaterializingIterator::MaterializingIterator(shared_ptr<ColumnwiseIterator> iter)
     : iter_(move(iter)),
       disallow_pushdown_for_tests_(!FLAGS_materializing_iterator_do_pushdown),
-      disallow_decoder_eval_(!FLAGS_materializing_iterator_decoder_eval) {
+      disallow_decoder_eval_(!FLAGS_materializing_iterator_decoder_eval),
+      allow_zero_copy_(FLAGS_materializing_iterator_zero_copy),
+      allow_skip_deselected_(FLAGS_materializing_iterator_skip_deselected),
+      adaptive_predicate_order_(FLAGS_materializing_iterator_adaptive_predicate_order) {
 }
 
 Status MaterializingIterator::Init(ScanSpec *spec) {
@@ -489,6 +733,9 @@ Status MaterializingIterator::Init(ScanSpec *spec) {
            const tuple<int32_t, ColumnPredicate>& right) {
          return SelectivityComparator(get<1>(left), get<1>(right));
        });
+  predicate_stats_.assign(col_idx_predicates_.size(), PredicateStats());
+  materialize_nanos_.assign(non_predicate_column_indexes_.size(), 0);
+  sampled_batches_ = 0;
 
   return Status::OK();
 }
@@ -508,6 +755,12 @@ Status MaterializingIterator::NextBlock(RowBlock* dst) {
   RETURN_NOT_OK(MaterializeBlock(dst));
   RETURN_NOT_OK(iter_->FinishBatch());
 
+  if (adaptive_predicate_order_ &&
+      sampled_batches_ < FLAGS_materializing_iterator_predicate_order_sample_batches &&
+      ++sampled_batches_ == FLAGS_materializing_iterator_predicate_order_sample_batches) {
+    ReorderPredicates();
+  }
+
   return Status::OK();
 }
 
@@ -515,8 +768,13 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
   // Initialize the selection vector indicating which rows have been
   // been deleted.
   RETURN_NOT_OK(iter_->InitializeSelectionVector(dst->selection_vector()));
+  size_t rows_selected = dst->selection_vector()->CountSelected();
+
+  for (size_t i = 0; i < col_idx_predicates_.size(); i++) {
+    auto& col_pred = col_idx_predicates_[i];
+    PredicateStats* pred_stats = &predicate_stats_[i];
+    MonoTime start = MonoTime::Now();
 
-  for (const auto& col_pred : col_idx_predicates_) {
     // Materialize the column itself into the row block.
     ColumnBlock dst_col(dst->column_block(get<0>(col_pred)));
     ColumnMaterializationContext ctx(get<0>(col_pred),
@@ -528,27 +786,44 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
     if (disallow_decoder_eval_) {
       ctx.SetDecoderEvalNotSupported();
     }
+    ctx.set_zero_copy_allowed(allow_zero_copy_);
+    // Predicates aren't evaluated on rows which are already unselected.
+    ctx.set_skip_deselected_allowed(allow_skip_deselected_);
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
+    MaybeSetExternalColumnData(ctx, dst, &dst_col);
     if (ctx.DecoderEvalNotSupported()) {
       get<1>(col_pred).Evaluate(dst_col, dst->selection_vector());
     }
 
+    pred_stats->rows_evaluated += rows_selected;
+    rows_selected = dst->selection_vector()->CountSelected();
+    pred_stats->rows_passed += rows_selected;
+    pred_stats->eval_nanos += (MonoTime::Now() - start).ToNanoseconds();
+
     // If after evaluating this predicate the entire row block has been filtered
     // out, we don't need to materialize other columns at all.
-    if (!dst->selection_vector()->AnySelected()) {
+    if (rows_selected == 0) {
       DVLOG(1) << "0/" << dst->nrows() << " passed predicate";
       return Status::OK();
     }
   }
 
-  for (size_t col_idx : non_predicate_column_indexes_) {
+  for (size_t i = 0; i < non_predicate_column_indexes_.size(); i++) {
+    size_t col_idx = non_predicate_column_indexes_[i];
+    MonoTime start = MonoTime::Now();
+
     // Materialize the column itself into the row block.
     ColumnBlock dst_col(dst->column_block(col_idx));
     ColumnMaterializationContext ctx(col_idx,
                                      nullptr,
                                      &dst_col,
                                      dst->selection_vector());
+    ctx.set_zero_copy_allowed(allow_zero_copy_);
+    // Only the selected rows of the block are ever read.
+    ctx.set_skip_deselected_allowed(allow_skip_deselected_);
     RETURN_NOT_OK(iter_->MaterializeColumn(&ctx));
+    MaybeSetExternalColumnData(ctx, dst, &dst_col);
+    materialize_nanos_[i] += (MonoTime::Now() - start).ToNanoseconds();
   }
 
   DVLOG(1) << dst->selection_vector()->CountSelected() << "/"
@@ -556,6 +831,76 @@ Status MaterializingIterator::MaterializeBlock(RowBlock *dst) {
   return Status::OK();
 }
 
+void MaterializingIterator::ReorderPredicates() {
+  if (col_idx_predicates_.size() < 2) {
+    return;
+  }
+
+  // Evaluating a predicate of per-row cost 'c' which passes a fraction 'p' of
+  // its rows ahead of one of cost c' and pass rate p' is cheaper whenever
+  // c / (1 - p) < c' / (1 - p'), so order the predicates by that rank.
+  // Predicates which haven't discarded any of the rows they saw (or never saw
+  // any, because earlier ones discarded them all) go last, in their current
+  // order.
+  vector<double> ranks;
+  ranks.reserve(predicate_stats_.size());
+  for (const auto& pred_stats : predicate_stats_) {
+    if (pred_stats.rows_passed == pred_stats.rows_evaluated) {
+      ranks.push_back(numeric_limits<double>::infinity());
+      continue;
+    }
+    double cost = static_cast<double>(pred_stats.eval_nanos) / pred_stats.rows_evaluated;
+    double drop_rate = 1.0 - static_cast<double>(pred_stats.rows_passed) /
+                             pred_stats.rows_evaluated;
+    ranks.push_back(cost / drop_rate);
+  }
+
+  vector<size_t> order(col_idx_predicates_.size());
+  iota(order.begin(), order.end(), 0);
+  stable_sort(order.begin(), order.end(),
+              [&] (size_t left, size_t right) { return ranks[left] < ranks[right]; });
+
+  vector<tuple<int32_t, ColumnPredicate>> col_idx_predicates;
+  vector<PredicateStats> predicate_stats;
+  col_idx_predicates.reserve(order.size());
+  predicate_stats.reserve(order.size());
+  for (size_t i : order) {
+    VLOG(1) << "Evaluating predicate " << get<1>(col_idx_predicates_[i]).ToString()
+            << " at position " << col_idx_predicates.size() << " (passed "
+            << predicate_stats_[i].rows_passed << "/" << predicate_stats_[i].rows_evaluated
+            << " rows in " << predicate_stats_[i].eval_nanos << "ns)";
+    col_idx_predicates.emplace_back(move(col_idx_predicates_[i]));
+    predicate_stats.push_back(predicate_stats_[i]);
+  }
+  col_idx_predicates_.swap(col_idx_predicates);
+  predicate_stats_.swap(predicate_stats);
+}
+
+void MaterializingIterator::GetIteratorStats(vector<IteratorStats>* stats) const {
+  iter_->GetIteratorStats(stats);
+  for (size_t i = 0; i < col_idx_predicates_.size(); i++) {
+    size_t col_idx = get<0>(col_idx_predicates_[i]);
+    DCHECK_LT(col_idx, stats->size());
+    (*stats)[col_idx].predicate_rows_evaluated += predicate_stats_[i].rows_evaluated;
+    (*stats)[col_idx].predicate_rows_passed += predicate_stats_[i].rows_passed;
+    (*stats)[col_idx].predicate_eval_nanos += predicate_stats_[i].eval_nanos;
+  }
+  for (size_t i = 0; i < non_predicate_column_indexes_.size(); i++) {
+    size_t col_idx = non_predicate_column_indexes_[i];
+    DCHECK_LT(col_idx, stats->size());
+    (*stats)[col_idx].materialize_nanos += materialize_nanos_[i];
+  }
+}
+
+void MaterializingIterator::MaybeSetExternalColumnData(
+    const ColumnMaterializationContext& ctx, RowBlock* dst, ColumnBlock* dst_col) {
+  if (ctx.external_data() == nullptr) {
+    return;
+  }
+  dst->SetExternalColumnData(ctx.col_idx(), ctx.external_data(), ctx.external_data_pin());
+  *dst_col = dst->column_block(ctx.col_idx());
+}
+
 string MaterializingIterator::ToString() const {
   string s;
   s.append("Materializing(").append(iter_->ToString()).append(")");
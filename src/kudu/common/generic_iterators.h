@@ -18,6 +18,7 @@
 #define KUDU_COMMON_MERGE_ITERATOR_H
 
 #include <deque>
+#include <functional>
 #include <gtest/gtest_prod.h>
 #include <memory>
 #include <string>
@@ -33,19 +34,31 @@ namespace kudu {
 
 class Arena;
 class MergeIterState;
+class RowBlockRow;
 
 // An iterator which merges the results of other iterators, comparing
 // based on keys.
 class MergeIterator : public RowwiseIterator {
  public:
+  // Compares the keys of two rows, returning a negative, zero or positive
+  // value like Schema::Compare().
+  typedef std::function<int(const RowBlockRow&, const RowBlockRow&)> RowComparator;
+
   // TODO: clarify whether schema is just the projection, or must include the merge
   // key columns. It should probably just be the required projection, which must be
   // a subset of the columns in 'iters'.
+  //
+  // If 'comparator' is set, it is used in place of Schema::Compare() to order
+  // rows across the sub-iterators (e.g. a code-generated key comparator).
   MergeIterator(const Schema &schema,
-                const std::vector<std::shared_ptr<RowwiseIterator> > &iters);
+                const std::vector<std::shared_ptr<RowwiseIterator> > &iters,
+                RowComparator comparator = RowComparator());
   virtual ~MergeIterator();
 
   // The passed-in iterators should be already initialized.
+  //
+  // If 'spec' has a limit, the iterator stops once it has returned that many
+  // rows, and reads correspondingly smaller blocks from its sub-iterators.
   Status Init(ScanSpec *spec) OVERRIDE;
 
   virtual bool HasNext() const OVERRIDE;
@@ -63,13 +76,32 @@ class MergeIterator : public RowwiseIterator {
   Status MaterializeBlock(RowBlock* dst);
   Status InitSubIterators(ScanSpec *spec);
 
+  // Compares the keys of two rows with comparator_ if set, or with
+  // schema_.Compare() otherwise.
+  int CompareRows(const RowBlockRow& a, const RowBlockRow& b) const;
+
+  // Orders the sub-iterators in iters_ as a binary min-heap on their next row.
+  bool HeapOrder(const std::unique_ptr<MergeIterState>& a,
+                 const std::unique_ptr<MergeIterState>& b) const;
+
   const Schema schema_;
 
+  // If set, used instead of schema_.Compare() to merge rows.
+  const RowComparator comparator_;
+
   bool initted_;
 
+  // The limit of the scan spec, or -1 if there is none, and the number of
+  // rows returned so far.
+  int64_t limit_;
+  int64_t num_returned_;
+
   // Holds the subiterators until Init is called.
   // This is required because we can't create a MergeIterState of an uninitialized iterator.
   std::deque<std::shared_ptr<RowwiseIterator> > orig_iters_;
+
+  // The sub-iterators which have rows left, kept as a binary min-heap ordered
+  // by their next row (see HeapOrder()) once initialized.
   std::vector<std::unique_ptr<MergeIterState> > iters_;
 
   // When the underlying iterators are initialized, each needs its own
@@ -92,8 +124,19 @@ class UnionIterator : public RowwiseIterator {
   //
   // All passed-in iterators must be fully able to evaluate all predicates - i.e.
   // calling iter->Init(spec) should remove all predicates from the spec.
-  explicit UnionIterator(const std::vector<std::shared_ptr<RowwiseIterator> > &iters);
-
+  //
+  // If 'prefetch_depth' is positive, the first block of each of the next
+  // 'prefetch_depth' iterators is read in the background while the current
+  // one is being drained, so that the I/O of opening an iterator (index and
+  // first data blocks of a rowset, say) overlaps with the reading of the
+  // previous ones. Each prefetched block takes the row capacity of the blocks
+  // passed to NextBlock().
+  explicit UnionIterator(const std::vector<std::shared_ptr<RowwiseIterator> > &iters,
+                         int prefetch_depth = 0);
+  virtual ~UnionIterator();
+
+  // If 'spec' has a limit, the iterator stops once it has returned that many
+  // selected rows, deselecting the rows past the limit in the last block.
   Status Init(ScanSpec *spec) OVERRIDE;
 
   bool HasNext() const OVERRIDE;
@@ -111,16 +154,46 @@ class UnionIterator : public RowwiseIterator {
   virtual Status NextBlock(RowBlock* dst) OVERRIDE;
 
  private:
+  struct PrefetchedBlock;
+
   void PrepareBatch();
   Status MaterializeBlock(RowBlock* dst);
   void FinishBatch();
   Status InitSubIterators(ScanSpec *spec);
 
+  // Starts reading the first block of the iterators which follow the current
+  // one, up to 'prefetch_depth_' of them, if not started already.
+  void StartPrefetches(const RowBlock& dst);
+
+  // Returns the next rows of the prefetched block 'pb' into 'dst', waiting for
+  // the block to be read if necessary.
+  Status CopyPrefetchedRows(PrefetchedBlock* pb, RowBlock* dst);
+
+  // Removes the current iterator.
+  void PopFront();
+
   // Schema: initialized during Init()
   gscoped_ptr<Schema> schema_;
   bool initted_;
   std::deque<std::shared_ptr<RowwiseIterator> > iters_;
 
+  const int prefetch_depth_;
+
+  // For each iterator of 'iters_', the block being or having been read ahead
+  // from it, if any. An iterator with a prefetched block belongs to the
+  // prefetching thread until the block is read, and has rows left until the
+  // block is fully returned.
+  std::deque<std::shared_ptr<PrefetchedBlock> > prefetched_;
+
+  // The last fully returned prefetched block, whose indirect data may be
+  // referred to by the last block returned if it had no arena.
+  std::shared_ptr<PrefetchedBlock> last_prefetched_;
+
+  // The limit of the scan spec, or -1 if there is none, and the number of
+  // selected rows returned so far.
+  int64_t limit_;
+  int64_t num_returned_;
+
   // Since we pop from 'iters_' this field is needed in order to keep
   // the underlying iterators available for GetIteratorStats.
   std::vector<std::shared_ptr<RowwiseIterator> > all_iters_;
@@ -153,29 +226,78 @@ class MaterializingIterator : public RowwiseIterator {
     return iter_->schema();
   }
 
-  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE {
-    iter_->GetIteratorStats(stats);
-  }
+  // Returns the stats of the underlying iterator, along with the number of
+  // rows each pushed-down predicate was evaluated against and passed.
+  virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
 
   virtual Status NextBlock(RowBlock* dst) OVERRIDE;
 
  private:
   FRIEND_TEST(TestMaterializingIterator, TestPredicatePushdown);
+  FRIEND_TEST(TestMaterializingIterator, TestAdaptivePredicateOrder);
+
+  // The observed cost and selectivity of a pushed-down predicate.
+  struct PredicateStats {
+    PredicateStats() : rows_evaluated(0), rows_passed(0), eval_nanos(0) {}
+
+    // Rows which were selected when the predicate was evaluated, and which
+    // remained selected afterwards.
+    int64_t rows_evaluated;
+    int64_t rows_passed;
+
+    // Time spent materializing the column and evaluating the predicate.
+    int64_t eval_nanos;
+  };
   FRIEND_TEST(TestPredicateEvaluatingIterator, TestPredicateEvaluation);
 
   Status MaterializeBlock(RowBlock *dst);
 
+  // Reorders 'col_idx_predicates_' (and 'predicate_stats_' along with it) so
+  // that the predicates expected to discard the most rows per unit of time
+  // are evaluated first, based on the stats gathered so far.
+  void ReorderPredicates();
+
+  // If the column iterator left the values of 'ctx' in its own memory, point
+  // the column of 'dst' at them, and refresh 'dst_col' accordingly.
+  static void MaybeSetExternalColumnData(const ColumnMaterializationContext& ctx,
+                                         RowBlock* dst, ColumnBlock* dst_col);
+
   std::shared_ptr<ColumnwiseIterator> iter_;
 
   // List of (column index, predicate) in order of most to least selective.
+  // Initially ordered by SelectivityComparator, and then by the observed
+  // selectivity and cost once enough batches have been sampled.
   std::vector<std::tuple<int32_t, ColumnPredicate>> col_idx_predicates_;
 
+  // The stats of each element of 'col_idx_predicates_'.
+  std::vector<PredicateStats> predicate_stats_;
+
+  // The number of batches materialized so far, up to the number sampled
+  // before reordering the predicates.
+  int sampled_batches_;
+
   // List of column indexes without predicates to materialize.
   std::vector<int32_t> non_predicate_column_indexes_;
 
+  // The time spent materializing each element of
+  // 'non_predicate_column_indexes_'.
+  std::vector<int64_t> materialize_nanos_;
+
   // Set only by test code to disallow pushdown.
   bool disallow_pushdown_for_tests_;
   bool disallow_decoder_eval_;
+
+  // Whether column iterators may reference their values in place rather
+  // than copy them into the destination block.
+  bool allow_zero_copy_;
+
+  // Whether column iterators may skip the rows already filtered out of the
+  // batch.
+  bool allow_skip_deselected_;
+
+  // Whether the predicates are reordered once the first batches have been
+  // sampled.
+  bool adaptive_predicate_order_;
 };
 
 // An iterator which wraps another iterator and evaluates any predicates that the
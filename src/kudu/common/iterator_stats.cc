@@ -27,37 +27,67 @@ using strings::Substitute;
 
 IteratorStats::IteratorStats()
     : data_blocks_read_from_disk(0),
+      data_blocks_skipped(0),
       bytes_read_from_disk(0),
-      cells_read_from_disk(0) {
+      cells_read_from_disk(0),
+      predicate_rows_evaluated(0),
+      predicate_rows_passed(0),
+      predicate_eval_nanos(0),
+      materialize_nanos(0) {
 }
 
 string IteratorStats::ToString() const {
   return Substitute("data_blocks_read_from_disk=$0 "
-                    "bytes_read_from_disk=$1 "
-                    "cells_read_from_disk=$2",
+                    "data_blocks_skipped=$1 "
+                    "bytes_read_from_disk=$2 "
+                    "cells_read_from_disk=$3 "
+                    "predicate_rows_evaluated=$4 "
+                    "predicate_rows_passed=$5 "
+                    "predicate_eval_nanos=$6 "
+                    "materialize_nanos=$7",
                     data_blocks_read_from_disk,
+                    data_blocks_skipped,
                     bytes_read_from_disk,
-                    cells_read_from_disk);
+                    cells_read_from_disk,
+                    predicate_rows_evaluated,
+                    predicate_rows_passed,
+                    predicate_eval_nanos,
+                    materialize_nanos);
 }
 
 void IteratorStats::AddStats(const IteratorStats& other) {
   data_blocks_read_from_disk += other.data_blocks_read_from_disk;
+  data_blocks_skipped += other.data_blocks_skipped;
   bytes_read_from_disk += other.bytes_read_from_disk;
   cells_read_from_disk += other.cells_read_from_disk;
+  predicate_rows_evaluated += other.predicate_rows_evaluated;
+  predicate_rows_passed += other.predicate_rows_passed;
+  predicate_eval_nanos += other.predicate_eval_nanos;
+  materialize_nanos += other.materialize_nanos;
   DCheckNonNegative();
 }
 
 void IteratorStats::SubtractStats(const IteratorStats& other) {
   data_blocks_read_from_disk -= other.data_blocks_read_from_disk;
+  data_blocks_skipped -= other.data_blocks_skipped;
   bytes_read_from_disk -= other.bytes_read_from_disk;
   cells_read_from_disk -= other.cells_read_from_disk;
+  predicate_rows_evaluated -= other.predicate_rows_evaluated;
+  predicate_rows_passed -= other.predicate_rows_passed;
+  predicate_eval_nanos -= other.predicate_eval_nanos;
+  materialize_nanos -= other.materialize_nanos;
   DCheckNonNegative();
 }
 
 void IteratorStats::DCheckNonNegative() const {
   DCHECK_GE(data_blocks_read_from_disk, 0);
+  DCHECK_GE(data_blocks_skipped, 0);
   DCHECK_GE(bytes_read_from_disk, 0);
   DCHECK_GE(cells_read_from_disk, 0);
+  DCHECK_GE(predicate_rows_evaluated, 0);
+  DCHECK_GE(predicate_rows_passed, 0);
+  DCHECK_GE(predicate_eval_nanos, 0);
+  DCHECK_GE(materialize_nanos, 0);
 }
 
 
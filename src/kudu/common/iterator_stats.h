@@ -30,6 +30,10 @@ struct IteratorStats {
   // The number of data blocks read from disk (or cache) by the iterator.
   int64_t data_blocks_read_from_disk;
 
+  // The number of data blocks which weren't read at all because their
+  // statistics ruled out every row the predicate on the column could match.
+  int64_t data_blocks_skipped;
+
   // The number of bytes read from disk (or cache) by the iterator.
   int64_t bytes_read_from_disk;
 
@@ -37,6 +41,19 @@ struct IteratorStats {
   // they were decoded/materialized.
   int64_t cells_read_from_disk;
 
+  // The number of rows a predicate on the column was evaluated against, and
+  // the number of those which passed it. Comparing these across columns shows
+  // the order in which the predicates ended up being evaluated: those
+  // evaluated first see the most rows.
+  int64_t predicate_rows_evaluated;
+  int64_t predicate_rows_passed;
+
+  // The time spent materializing the column: in 'predicate_eval_nanos',
+  // which includes evaluating the predicate, if the column has a predicate,
+  // and in 'materialize_nanos' otherwise.
+  int64_t predicate_eval_nanos;
+  int64_t materialize_nanos;
+
   // Add statistics contained 'other' to this object (for each field
   // in this object, increment it by the value of the equivalent field
   // in 'other').
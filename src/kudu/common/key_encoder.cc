@@ -54,6 +54,7 @@ class EncoderResolver {
     AddMapping<INT32>();
     AddMapping<UINT64>();
     AddMapping<INT64>();
+    AddMapping<INT128>();
     AddMapping<BINARY>();
   }
 
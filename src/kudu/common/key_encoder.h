@@ -77,6 +77,13 @@ struct KeyEncoderTraits<Type,
   }
 
   static void Encode(const void* key_ptr, Buffer* dst) {
+    uint8_t encoded[sizeof(cpp_type)];
+    EncodeTo(key_ptr, encoded);
+    dst->append(reinterpret_cast<const char*>(encoded), sizeof(encoded));
+  }
+
+  // Encodes the key at 'key_ptr' into the sizeof(cpp_type) bytes at 'dst'.
+  static void EncodeTo(const void* key_ptr, uint8_t* dst) {
     unsigned_cpp_type key_unsigned;
     memcpy(&key_unsigned, key_ptr, sizeof(key_unsigned));
 
@@ -85,7 +92,7 @@ struct KeyEncoderTraits<Type,
       key_unsigned ^= 1UL << (sizeof(key_unsigned) * CHAR_BIT - 1);
     }
     key_unsigned = SwapEndian(key_unsigned);
-    dst->append(reinterpret_cast<const char*>(&key_unsigned), sizeof(key_unsigned));
+    memcpy(dst, &key_unsigned, sizeof(key_unsigned));
   }
 
   static void EncodeWithSeparators(const void* key, bool is_last, Buffer* dst) {
@@ -112,6 +119,58 @@ struct KeyEncoderTraits<Type,
   }
 };
 
+// 128-bit integers, which the integral specialization above can't handle
+// since there are no MathLimits nor byte swaps for them: like the other
+// signed integers, the MSB is flipped and the result is stored big-endian.
+template<typename Buffer>
+struct KeyEncoderTraits<INT128, Buffer> {
+  static const DataType key_type = INT128;
+
+  static void Encode(int128_t key, Buffer* dst) {
+    Encode(&key, dst);
+  }
+
+  static void Encode(const void* key_ptr, Buffer* dst) {
+    uint8_t encoded[sizeof(int128_t)];
+    EncodeTo(key_ptr, encoded);
+    dst->append(reinterpret_cast<const char*>(encoded), sizeof(encoded));
+  }
+
+  static void EncodeTo(const void* key_ptr, uint8_t* dst) {
+    uint128_t key_unsigned;
+    memcpy(&key_unsigned, key_ptr, sizeof(key_unsigned));
+    key_unsigned ^= static_cast<uint128_t>(1) << (sizeof(key_unsigned) * CHAR_BIT - 1);
+    uint64_t hi = BigEndian::FromHost64(static_cast<uint64_t>(key_unsigned >> 64));
+    uint64_t lo = BigEndian::FromHost64(static_cast<uint64_t>(key_unsigned));
+    memcpy(dst, &hi, sizeof(hi));
+    memcpy(dst + sizeof(hi), &lo, sizeof(lo));
+  }
+
+  static void EncodeWithSeparators(const void* key, bool is_last, Buffer* dst) {
+    Encode(key, dst);
+  }
+
+  static Status DecodeKeyPortion(Slice* encoded_key,
+                                 bool /*is_last*/,
+                                 Arena* /*arena*/,
+                                 uint8_t* cell_ptr) {
+    if (PREDICT_FALSE(encoded_key->size() < sizeof(int128_t))) {
+      return Status::InvalidArgument("key too short", KUDU_REDACT(encoded_key->ToDebugString()));
+    }
+
+    uint64_t hi;
+    uint64_t lo;
+    memcpy(&hi, encoded_key->data(), sizeof(hi));
+    memcpy(&lo, encoded_key->data() + sizeof(hi), sizeof(lo));
+    uint128_t val = (static_cast<uint128_t>(BigEndian::ToHost64(hi)) << 64) |
+                    BigEndian::ToHost64(lo);
+    val ^= static_cast<uint128_t>(1) << (sizeof(val) * CHAR_BIT - 1);
+    memcpy(cell_ptr, &val, sizeof(val));
+    encoded_key->remove_prefix(sizeof(int128_t));
+    return Status::OK();
+  }
+};
+
 template<typename Buffer>
 struct KeyEncoderTraits<BINARY, Buffer> {
 
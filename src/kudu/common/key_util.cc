@@ -80,8 +80,8 @@ bool IncrementIntCell(void* cell_ptr) {
   } else {
     // Signed overflow is undefined in C. So, we'll use a branch here
     // instead of counting on undefined behavior.
-    if (orig == MathLimits<cpp_type>::kMax) {
-      inc = MathLimits<cpp_type>::kMin;
+    if (orig == *traits::max_value()) {
+      inc = *traits::min_value();
     } else {
       inc = orig + 1;
     }
@@ -104,8 +104,8 @@ bool DecrementIntCell(void* cell_ptr) {
   } else {
     // Signed overflow is undefined in C. So, we'll use a branch here
     // instead of counting on undefined behavior.
-    if (orig == MathLimits<cpp_type>::kMin) {
-      dec = MathLimits<cpp_type>::kMax;
+    if (orig == *traits::min_value()) {
+      dec = *traits::max_value();
     } else {
       dec = orig - 1;
     }
@@ -219,6 +219,7 @@ int PushUpperBoundKeyPredicates(ColIdxIter first,
         pushed_predicates++;
         break;
       case PredicateType::Range:
+      case PredicateType::InBloomFilter:
         if (predicate->raw_upper() != nullptr) {
           memcpy(row->mutable_cell_ptr(*col_idx_it), predicate->raw_upper(), size);
           pushed_predicates++;
@@ -285,6 +286,7 @@ int PushLowerBoundKeyPredicates(ColIdxIter first,
 
     switch (predicate->predicate_type()) {
       case PredicateType::Range:
+      case PredicateType::InBloomFilter:
         if (predicate->raw_lower() == nullptr) {
           break_loop = true;
           break;
@@ -342,6 +344,7 @@ bool IncrementCell(const ColumnSchema& col, void* cell_ptr, Arena* arena) {
     HANDLE_TYPE(INT32);
     HANDLE_TYPE(UNIXTIME_MICROS);
     HANDLE_TYPE(INT64);
+    HANDLE_TYPE(INT128);
     case FLOAT:
       return IncrementFloatingPointCell<FLOAT>(cell_ptr);
     case DOUBLE:
@@ -371,6 +374,7 @@ bool TryDecrementCell(const ColumnSchema &col, void *cell_ptr) {
     HANDLE_TYPE(INT32);
     HANDLE_TYPE(UNIXTIME_MICROS);
     HANDLE_TYPE(INT64);
+    HANDLE_TYPE(INT128);
     case FLOAT:
       return DecrementFloatingPointCell<FLOAT>(cell_ptr);
     case DOUBLE:
@@ -304,4 +304,50 @@ TEST_F(PartialRowTest, TestSetString) {
       2, COPY);
 }
 
+// Check that the unscaled values of the DECIMAL columns round-trip through
+// the storage type of each precision, and are checked against the precision.
+TEST_F(PartialRowTest, TestDecimal) {
+  Schema schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("dec32", DECIMAL32, false, nullptr, nullptr,
+                               ColumnStorageAttributes(), ColumnTypeAttributes(5, 2)),
+                  ColumnSchema("dec64", DECIMAL64, false, nullptr, nullptr,
+                               ColumnStorageAttributes(), ColumnTypeAttributes(18, 0)),
+                  ColumnSchema("dec128", DECIMAL128, true, nullptr, nullptr,
+                               ColumnStorageAttributes(), ColumnTypeAttributes(38, 10)) },
+                1);
+  KuduPartialRow row(&schema);
+
+  ASSERT_OK(row.SetUnscaledDecimal("dec32", -12345));
+  ASSERT_OK(row.SetUnscaledDecimal("dec64", 999999999999999999LL));
+  int128_t big = static_cast<int128_t>(999999999999999999LL) * 1000000000000000000LL;
+  ASSERT_OK(row.SetUnscaledDecimal("dec128", big));
+  EXPECT_EQ("decimal32 dec32=-123.45, "
+            "decimal64 dec64=999999999999999999, "
+            "decimal128 dec128=99999999999999999900000000.0000000000",
+            row.ToString());
+
+  int128_t val;
+  ASSERT_OK(row.GetUnscaledDecimal("dec32", &val));
+  EXPECT_TRUE(val == -12345);
+  ASSERT_OK(row.GetUnscaledDecimal("dec64", &val));
+  EXPECT_TRUE(val == 999999999999999999LL);
+  ASSERT_OK(row.GetUnscaledDecimal("dec128", &val));
+  EXPECT_TRUE(val == big);
+
+  // The values must fit the precision of the column, not just its storage.
+  Status s = row.SetUnscaledDecimal("dec32", 100000);
+  EXPECT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  EXPECT_EQ("Invalid argument: value 1000.00 out of range for column 'dec32' of precision 5",
+            s.ToString());
+  ASSERT_OK(row.SetUnscaledDecimal("dec32", -99999));
+  s = row.SetUnscaledDecimal("dec64", -1000000000000000000LL);
+  EXPECT_TRUE(s.IsInvalidArgument()) << s.ToString();
+
+  // Only the DECIMAL columns have unscaled values.
+  s = row.SetUnscaledDecimal("key", 1);
+  EXPECT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = row.GetUnscaledDecimal("key", &val);
+  EXPECT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 } // namespace kudu
@@ -22,6 +22,8 @@
 #include <string>
 
 #include "kudu/common/common.pb.h"
+#include "kudu/common/decimal_util.h"
+#include "kudu/common/partial_row_arena.h"
 #include "kudu/common/row.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.pb.h"
@@ -47,18 +49,14 @@ inline Status FindColumn(const Schema& schema, const Slice& col_name, int* idx)
 } // anonymous namespace
 
 KuduPartialRow::KuduPartialRow(const Schema* schema)
-  : schema_(schema) {
+  : schema_(schema),
+    arena_(nullptr) {
   DCHECK(schema_->initialized());
+  AllocateStorage();
   size_t column_bitmap_size = BitmapSize(schema_->num_columns());
   size_t row_size = ContiguousRowHelper::row_size(*schema);
 
-  auto dst = new uint8_t[2 * column_bitmap_size + row_size];
-  isset_bitmap_ = dst;
-  owned_strings_bitmap_ = isset_bitmap_ + column_bitmap_size;
-
   memset(isset_bitmap_, 0, 2 * column_bitmap_size);
-
-  row_data_ = owned_strings_bitmap_ + column_bitmap_size;
 #ifndef NDEBUG
   OverwriteWithPattern(reinterpret_cast<char*>(row_data_),
                        row_size, "NEWNEWNEWNEWNEW");
@@ -67,25 +65,44 @@ KuduPartialRow::KuduPartialRow(const Schema* schema)
     *schema_, row_data_, ContiguousRowHelper::null_bitmap_size(*schema_));
 }
 
+KuduPartialRow::KuduPartialRow(const Schema* schema, PartialRowArena* arena)
+  : schema_(schema),
+    arena_(arena) {
+  DCHECK(schema_->initialized());
+  DCHECK(arena_);
+  arena_->AddRef();
+  AllocateStorage();
+  size_t column_bitmap_size = BitmapSize(schema_->num_columns());
+  memset(isset_bitmap_, 0, 2 * column_bitmap_size);
+  ContiguousRowHelper::InitNullsBitmap(
+    *schema_, row_data_, ContiguousRowHelper::null_bitmap_size(*schema_));
+}
+
 KuduPartialRow::~KuduPartialRow() {
   DeallocateOwnedStrings();
-  // Both the row data and bitmap came from the same allocation.
-  // The bitmap is at the start of it.
-  delete [] isset_bitmap_;
+  if (arena_) {
+    arena_->Release();
+  } else {
+    // Both the row data and bitmap came from the same allocation.
+    // The bitmap is at the start of it.
+    delete [] isset_bitmap_;
+  }
 }
 
 KuduPartialRow::KuduPartialRow(const KuduPartialRow& other)
-    : schema_(other.schema_) {
+    : schema_(other.schema_),
+      arena_(other.arena_) {
+  // A copy of a row backed by an arena shares the arena: the strings it
+  // doesn't own may have been copied into it.
+  if (arena_) {
+    arena_->AddRef();
+  }
+  AllocateStorage();
   size_t column_bitmap_size = BitmapSize(schema_->num_columns());
   size_t row_size = ContiguousRowHelper::row_size(*schema_);
 
-  size_t len = 2 * column_bitmap_size + row_size;
-  isset_bitmap_ = new uint8_t[len];
-  owned_strings_bitmap_ = isset_bitmap_ + column_bitmap_size;
-  row_data_ = owned_strings_bitmap_ + column_bitmap_size;
-
   // Copy all bitmaps and row data.
-  memcpy(isset_bitmap_, other.isset_bitmap_, len);
+  memcpy(isset_bitmap_, other.isset_bitmap_, 2 * column_bitmap_size + row_size);
 
   // Copy owned strings.
   for (int col_idx = 0; col_idx < schema_->num_columns(); col_idx++) {
@@ -103,9 +120,24 @@ KuduPartialRow& KuduPartialRow::operator=(KuduPartialRow other) {
   std::swap(isset_bitmap_, other.isset_bitmap_);
   std::swap(owned_strings_bitmap_, other.owned_strings_bitmap_);
   std::swap(row_data_, other.row_data_);
+  std::swap(arena_, other.arena_);
   return *this;
 }
 
+void KuduPartialRow::AllocateStorage() {
+  size_t column_bitmap_size = BitmapSize(schema_->num_columns());
+  size_t row_size = ContiguousRowHelper::row_size(*schema_);
+  size_t len = 2 * column_bitmap_size + row_size;
+
+  isset_bitmap_ = arena_ ? arena_->Allocate(len) : new uint8_t[len];
+  owned_strings_bitmap_ = isset_bitmap_ + column_bitmap_size;
+  row_data_ = owned_strings_bitmap_ + column_bitmap_size;
+}
+
+uint8_t* KuduPartialRow::AllocateStringCopy(size_t size) {
+  return arena_ ? arena_->Allocate(size) : new uint8_t[size];
+}
+
 template<typename T>
 Status KuduPartialRow::Set(const Slice& col_name,
                            const typename T::cpp_type& val,
@@ -192,6 +224,20 @@ Status KuduPartialRow::Set(int32_t column_idx, const uint8_t* val) {
       RETURN_NOT_OK(SetUnixTimeMicros(column_idx, *reinterpret_cast<const int64_t*>(val)));
       break;
     };
+    case DECIMAL32: {
+      RETURN_NOT_OK(SetUnscaledDecimal(column_idx, *reinterpret_cast<const int32_t*>(val)));
+      break;
+    };
+    case DECIMAL64: {
+      RETURN_NOT_OK(SetUnscaledDecimal(column_idx, *reinterpret_cast<const int64_t*>(val)));
+      break;
+    };
+    case DECIMAL128: {
+      int128_t unscaled;
+      memcpy(&unscaled, val, sizeof(unscaled));
+      RETURN_NOT_OK(SetUnscaledDecimal(column_idx, unscaled));
+      break;
+    };
     default: {
       return Status::InvalidArgument("Unknown column type in schema",
                                      column_schema.ToString());
@@ -274,6 +320,39 @@ Status KuduPartialRow::SetDouble(int col_idx, double val) {
   return Set<TypeTraits<DOUBLE> >(col_idx, val);
 }
 
+Status KuduPartialRow::SetUnscaledDecimal(const Slice& col_name, int128_t val) {
+  int col_idx;
+  RETURN_NOT_OK(FindColumn(*schema_, col_name, &col_idx));
+  return SetUnscaledDecimal(col_idx, val);
+}
+
+Status KuduPartialRow::SetUnscaledDecimal(int col_idx, int128_t val) {
+  const ColumnSchema& col = schema_->column(col_idx);
+  const DataType type = col.type_info()->type();
+  if (PREDICT_FALSE(!IsDecimalType(type))) {
+    return Status::InvalidArgument(
+      Substitute("invalid type decimal provided for column '$0' (expected $1)",
+                 col.name(), col.type_info()->name()));
+  }
+  int8_t precision = col.type_attributes().precision;
+  if (PREDICT_FALSE(val < MinUnscaledDecimal(precision) ||
+                    val > MaxUnscaledDecimal(precision))) {
+    return Status::InvalidArgument(
+      Substitute("value $0 out of range for column '$1' of precision $2",
+                 DecimalToString(val, col.type_attributes().scale),
+                 col.name(), precision));
+  }
+  // The range check above ensures the value fits the storage type.
+  switch (type) {
+    case DECIMAL32:
+      return Set<TypeTraits<DECIMAL32> >(col_idx, static_cast<int32_t>(val));
+    case DECIMAL64:
+      return Set<TypeTraits<DECIMAL64> >(col_idx, static_cast<int64_t>(val));
+    default:
+      return Set<TypeTraits<DECIMAL128> >(col_idx, val);
+  }
+}
+
 Status KuduPartialRow::SetBinary(const Slice& col_name, const Slice& val) {
   return SetBinaryCopy(col_name, val);
 }
@@ -315,11 +394,13 @@ Status KuduPartialRow::SetStringNoCopy(int col_idx, const Slice& val) {
 
 template<typename T>
 Status KuduPartialRow::SetSliceCopy(const Slice& col_name, const Slice& val) {
-  auto relocated = new uint8_t[val.size()];
+  uint8_t* relocated = AllocateStringCopy(val.size());
   memcpy(relocated, val.data(), val.size());
   Slice relocated_val(relocated, val.size());
-  Status s = Set<T>(col_name, relocated_val, true);
-  if (!s.ok()) {
+  // Copies in the arena are released along with it.
+  bool owned = arena_ == nullptr;
+  Status s = Set<T>(col_name, relocated_val, owned);
+  if (!s.ok() && owned) {
     delete [] relocated;
   }
   return s;
@@ -327,11 +408,13 @@ Status KuduPartialRow::SetSliceCopy(const Slice& col_name, const Slice& val) {
 
 template<typename T>
 Status KuduPartialRow::SetSliceCopy(int col_idx, const Slice& val) {
-  auto relocated = new uint8_t[val.size()];
+  uint8_t* relocated = AllocateStringCopy(val.size());
   memcpy(relocated, val.data(), val.size());
   Slice relocated_val(relocated, val.size());
-  Status s = Set<T>(col_idx, relocated_val, true);
-  if (!s.ok()) {
+  // Copies in the arena are released along with it.
+  bool owned = arena_ == nullptr;
+  Status s = Set<T>(col_idx, relocated_val, owned);
+  if (!s.ok() && owned) {
     delete [] relocated;
   }
   return s;
@@ -588,6 +671,32 @@ Status KuduPartialRow::GetBinary(int col_idx, Slice* val) const {
   return Get<TypeTraits<BINARY> >(col_idx, val);
 }
 
+Status KuduPartialRow::GetUnscaledDecimal(const Slice& col_name, int128_t* val) const {
+  int col_idx;
+  RETURN_NOT_OK(FindColumn(*schema_, col_name, &col_idx));
+  return GetUnscaledDecimal(col_idx, val);
+}
+
+Status KuduPartialRow::GetUnscaledDecimal(int col_idx, int128_t* val) const {
+  switch (schema_->column(col_idx).type_info()->type()) {
+    case DECIMAL32: {
+      int32_t i32;
+      RETURN_NOT_OK(Get<TypeTraits<DECIMAL32> >(col_idx, &i32));
+      *val = i32;
+      return Status::OK();
+    }
+    case DECIMAL64: {
+      int64_t i64;
+      RETURN_NOT_OK(Get<TypeTraits<DECIMAL64> >(col_idx, &i64));
+      *val = i64;
+      return Status::OK();
+    }
+    default:
+      // Fails on the type check for the non-DECIMAL columns.
+      return Get<TypeTraits<DECIMAL128> >(col_idx, val);
+  }
+}
+
 template<typename T>
 Status KuduPartialRow::Get(const Slice& col_name,
                            typename T::cpp_type* val) const {
@@ -31,6 +31,7 @@
 #include "kudu/client/stubs.h"
 #endif
 
+#include "kudu/util/int128.h"
 #include "kudu/util/kudu_export.h"
 #include "kudu/util/slice.h"
 
@@ -45,6 +46,7 @@ template<typename KeyTypeWrapper> struct IntKeysTestSetup;
 /// @endcond
 
 class Schema;
+class PartialRowArena;
 class PartialRowPB;
 
 /// @brief A row which may only contain values for a subset of the columns.
@@ -126,6 +128,27 @@ class KUDU_EXPORT KuduPartialRow {
   Status SetDouble(int col_idx, double val) WARN_UNUSED_RESULT;
   ///@}
 
+  /// @name Setters for decimal columns.
+  ///
+  /// Set the value of a DECIMAL column by its unscaled value, e.g. 12345
+  /// for 123.45 in a column with a scale of 2. The value is stored in the
+  /// 32, 64 or 128-bit integer the precision of the column calls for.
+  ///
+  /// @param [in] col_name
+  ///   Name of the target column.
+  /// @param [in] col_idx
+  ///   The index of the target column.
+  /// @param [in] val
+  ///   The unscaled value to set.
+  /// @return Operation result status. Return a bad Status if the column
+  ///   isn't a DECIMAL column, or if the value has more digits than the
+  ///   precision of the column.
+  ///
+  ///@{
+  Status SetUnscaledDecimal(const Slice& col_name, int128_t val) WARN_UNUSED_RESULT;
+  Status SetUnscaledDecimal(int col_idx, int128_t val) WARN_UNUSED_RESULT;
+  ///@}
+
   /// @name Setters for binary/string columns by name (copying).
   ///
   /// Set the binary/string value for a column by name, copying the specified
@@ -377,6 +400,28 @@ class KUDU_EXPORT KuduPartialRow {
   Status GetDouble(int col_idx, double* val) const WARN_UNUSED_RESULT;
   ///@}
 
+  /// @name Getters for decimal columns.
+  ///
+  /// Get the unscaled value of a DECIMAL column, whatever the width it is
+  /// stored with.
+  ///
+  /// @param [in] col_name
+  ///   Name of the column.
+  /// @param [in] col_idx
+  ///   The index of the column.
+  /// @param [out] val
+  ///   Pointer to the placeholder to put the resulting value.
+  /// @return Operation result status. Return a bad Status if at least one
+  ///   of the following is @c true:
+  ///     @li The column isn't a DECIMAL column.
+  ///     @li The value is unset.
+  ///     @li The value is @c NULL.
+  ///
+  ///@{
+  Status GetUnscaledDecimal(const Slice& col_name, int128_t* val) const WARN_UNUSED_RESULT;
+  Status GetUnscaledDecimal(int col_idx, int128_t* val) const WARN_UNUSED_RESULT;
+  ///@}
+
   /// @name Getters for string/binary column by column name.
   ///
   /// Get the string/binary value for a column by its name.
@@ -481,6 +526,17 @@ class KUDU_EXPORT KuduPartialRow {
   FRIEND_TEST(PartitionPrunerTest, TestPrimaryKeyRangePruning);
   FRIEND_TEST(PartitionPrunerTest, TestPartialPrimaryKeyRangePruning);
 
+  // Creates a row whose storage and copies of strings are allocated from
+  // 'arena' instead of the heap. The row holds a reference to 'arena'.
+  KuduPartialRow(const Schema* schema, PartialRowArena* arena);
+
+  // Allocates the storage of the row, from 'arena_' if it's set.
+  void AllocateStorage();
+
+  // Allocates 'size' bytes for a copy of a string. The copy is owned by this
+  // instance (and must be marked so) unless it came from 'arena_'.
+  uint8_t* AllocateStringCopy(size_t size);
+
   template<typename T>
   Status Set(const Slice& col_name, const typename T::cpp_type& val,
              bool owned = false);
@@ -528,6 +584,10 @@ class KUDU_EXPORT KuduPartialRow {
   // The normal "contiguous row" format row data. Any column whose data is unset
   // or NULL can have undefined bytes.
   uint8_t* row_data_;
+
+  // If set, the bitmaps, row data and string copies above were allocated from
+  // this arena, which this instance holds a reference to.
+  PartialRowArena* arena_;
 };
 
 } // namespace kudu
@@ -0,0 +1,56 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_COMMON_PARTIAL_ROW_ARENA_H
+#define KUDU_COMMON_PARTIAL_ROW_ARENA_H
+
+#include <stdint.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/memory/arena.h"
+
+namespace kudu {
+
+// Memory shared by many KuduPartialRows: their storage and the copies of
+// their strings are carved out of it rather than allocated one by one. Each
+// row holds a reference to the arena, so it's released along with the last
+// of them.
+class PartialRowArena : public RefCountedThreadSafe<PartialRowArena> {
+ public:
+  PartialRowArena()
+      : arena_(kInitialBufferSize, kMaxBufferSize) {
+  }
+
+  uint8_t* Allocate(size_t size) {
+    return static_cast<uint8_t*>(arena_.AllocateBytesAligned(size, sizeof(void*)));
+  }
+
+ private:
+  friend class RefCountedThreadSafe<PartialRowArena>;
+  ~PartialRowArena() {}
+
+  static const size_t kInitialBufferSize = 64 * 1024;
+  static const size_t kMaxBufferSize = 1024 * 1024;
+
+  // Thread-safe since copies of rows may be made from any thread.
+  ThreadSafeArena arena_;
+
+  DISALLOW_COPY_AND_ASSIGN(PartialRowArena);
+};
+
+} // namespace kudu
+#endif /* KUDU_COMMON_PARTIAL_ROW_ARENA_H */
@@ -19,6 +19,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -39,7 +40,9 @@
 using boost::optional;
 using std::pair;
 using std::string;
+using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 DECLARE_bool(log_redact_user_data);
 
@@ -310,6 +313,48 @@ TEST_F(PartitionTest, TestPartitionKeyEncoding) {
   }
 }
 
+// Tests that encoding the partition keys of a batch of rows matches encoding
+// each of them on its own.
+TEST_F(PartitionTest, TestBatchPartitionKeyEncoding) {
+  // CREATE TABLE t (a INT32, b VARCHAR, c VARCHAR, PRIMARY KEY (a, b, c))
+  // PARITITION BY [HASH BUCKET (a, b), HASH BUCKET (c), RANGE (a, b, c)];
+  Schema schema({ ColumnSchema("a", INT32),
+                  ColumnSchema("b", STRING),
+                  ColumnSchema("c", STRING) },
+                { ColumnId(0), ColumnId(1), ColumnId(2) }, 3);
+
+  PartitionSchemaPB schema_builder;
+  AddHashBucketComponent(&schema_builder, { "a", "b" }, 32, 0);
+  AddHashBucketComponent(&schema_builder, { "c" }, 32, 42);
+  PartitionSchema partition_schema;
+  ASSERT_OK(PartitionSchema::FromPB(schema_builder, schema, &partition_schema));
+
+  vector<unique_ptr<KuduPartialRow>> rows;
+  vector<const KuduPartialRow*> row_ptrs;
+  for (int i = 0; i < 100; i++) {
+    unique_ptr<KuduPartialRow> row(new KuduPartialRow(&schema));
+    ASSERT_OK(row->SetInt32("a", i));
+    // Leave some of the columns unset.
+    if (i % 3 != 0) {
+      ASSERT_OK(row->SetStringCopy("b", Substitute("b$0", i)));
+    }
+    if (i % 5 != 0) {
+      ASSERT_OK(row->SetStringCopy("c", Substitute("c$0", i * 7)));
+    }
+    row_ptrs.push_back(row.get());
+    rows.push_back(std::move(row));
+  }
+
+  vector<string> keys;
+  ASSERT_OK(partition_schema.EncodeKeys(row_ptrs, &keys));
+  ASSERT_EQ(rows.size(), keys.size());
+  for (int i = 0; i < rows.size(); i++) {
+    string key;
+    ASSERT_OK(partition_schema.EncodeKey(*rows[i], &key));
+    EXPECT_EQ(key, keys[i]);
+  }
+}
+
 TEST_F(PartitionTest, TestCreateRangePartitions) {
   {
     // Splits:
@@ -23,6 +23,7 @@
 #include <utility>
 #include <vector>
 
+#include "kudu/common/decimal_util.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/map-util.h"
@@ -207,6 +208,83 @@ Status PartitionSchema::EncodeKey(const ConstContiguousRow& row, string* buf) co
   return EncodeColumns(row, range_schema_.column_ids, buf);
 }
 
+namespace {
+
+// A partition column of a row schema, along with its key encoder.
+struct ResolvedColumn {
+  int idx;
+  const TypeInfo* type_info;
+  const KeyEncoder<string>* encoder;
+};
+
+void ResolveColumns(const Schema& schema,
+                    const vector<ColumnId>& column_ids,
+                    vector<ResolvedColumn>* columns) {
+  columns->clear();
+  columns->reserve(column_ids.size());
+  for (ColumnId column_id : column_ids) {
+    int32_t column_idx = schema.find_column_by_id(column_id);
+    CHECK(column_idx != Schema::kColumnNotFound);
+    const TypeInfo* type_info = schema.column(column_idx).type_info();
+    columns->push_back({ column_idx, type_info, &GetKeyEncoder<string>(type_info) });
+  }
+}
+
+// Same as PartitionSchema::EncodeColumns(), with the columns resolved.
+// 'cont_row' is a view of the data of 'row'.
+void EncodeResolvedColumns(const KuduPartialRow& row,
+                           const ContiguousRow& cont_row,
+                           const vector<ResolvedColumn>& columns,
+                           string* buf) {
+  for (int i = 0; i < columns.size(); i++) {
+    const ResolvedColumn& column = columns[i];
+    bool is_last = i + 1 == columns.size();
+    if (PREDICT_FALSE(!row.IsColumnSet(column.idx))) {
+      uint8_t min_value[kLargestTypeSize];
+      column.type_info->CopyMinValue(min_value);
+      column.encoder->Encode(min_value, is_last, buf);
+    } else {
+      column.encoder->Encode(cont_row.cell_ptr(column.idx), is_last, buf);
+    }
+  }
+}
+
+} // anonymous namespace
+
+Status PartitionSchema::EncodeKeys(const vector<const KuduPartialRow*>& rows,
+                                   vector<string>* bufs) const {
+  const KeyEncoder<string>& hash_encoder = GetKeyEncoder<string>(GetTypeInfo(UINT32));
+  bufs->resize(rows.size());
+
+  const Schema* schema = nullptr;
+  vector<vector<ResolvedColumn>> hash_columns(hash_bucket_schemas_.size());
+  vector<ResolvedColumn> range_columns;
+  string hash_buf;
+  for (int i = 0; i < rows.size(); i++) {
+    const KuduPartialRow& row = *rows[i];
+    // The rows of a batch nearly always share their schema, so the columns
+    // are only resolved again when it changes.
+    if (PREDICT_FALSE(row.schema() != schema)) {
+      schema = row.schema();
+      for (int j = 0; j < hash_bucket_schemas_.size(); j++) {
+        ResolveColumns(*schema, hash_bucket_schemas_[j].column_ids, &hash_columns[j]);
+      }
+      ResolveColumns(*schema, range_schema_.column_ids, &range_columns);
+    }
+
+    ContiguousRow cont_row(schema, row.row_data_);
+    string* buf = &(*bufs)[i];
+    for (int j = 0; j < hash_bucket_schemas_.size(); j++) {
+      hash_buf.clear();
+      EncodeResolvedColumns(row, cont_row, hash_columns[j], &hash_buf);
+      int32_t bucket = BucketForEncodedColumns(hash_buf, hash_bucket_schemas_[j]);
+      hash_encoder.Encode(&bucket, buf);
+    }
+    EncodeResolvedColumns(row, cont_row, range_columns, buf);
+  }
+  return Status::OK();
+}
+
 Status PartitionSchema::EncodeRangeKey(const KuduPartialRow& row,
                                        const Schema& schema,
                                        string* key) const {
@@ -1001,6 +1079,13 @@ namespace {
       case UNIXTIME_MICROS:
         RETURN_NOT_OK(row->SetInt64(idx, INT64_MIN + 1));
         break;
+      case DECIMAL32:
+      case DECIMAL64:
+      case DECIMAL128: {
+        int8_t precision = row->schema()->column(idx).type_attributes().precision;
+        RETURN_NOT_OK(row->SetUnscaledDecimal(idx, MinUnscaledDecimal(precision) + 1));
+        break;
+      }
       case STRING:
         RETURN_NOT_OK(row->SetStringCopy(idx, Slice("\0", 1)));
         break;
@@ -1070,6 +1155,19 @@ namespace {
         }
         break;
       }
+      case DECIMAL32:
+      case DECIMAL64:
+      case DECIMAL128: {
+        int128_t value;
+        RETURN_NOT_OK(row->GetUnscaledDecimal(idx, &value));
+        int8_t precision = row->schema()->column(idx).type_attributes().precision;
+        if (value < MaxUnscaledDecimal(precision)) {
+          RETURN_NOT_OK(row->SetUnscaledDecimal(idx, value + 1));
+        } else {
+          *success = false;
+        }
+        break;
+      }
       case BINARY: {
         Slice value;
         RETURN_NOT_OK(row->GetBinary(idx, &value));
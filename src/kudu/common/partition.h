@@ -150,6 +150,15 @@ class PartitionSchema {
   Status EncodeKey(const KuduPartialRow& row, std::string* buf) const WARN_UNUSED_RESULT;
   Status EncodeKey(const ConstContiguousRow& row, std::string* buf) const WARN_UNUSED_RESULT;
 
+  // Appends the encoded partition key of each of 'rows' into the
+  // corresponding entry of 'bufs', which is resized to match. This is
+  // equivalent to calling EncodeKey() on every row, but looks up the
+  // partition columns and their encoders once per batch instead of once per
+  // row, and reuses a single scratch buffer for hashing. Meant for routing
+  // many writes at once.
+  Status EncodeKeys(const std::vector<const KuduPartialRow*>& rows,
+                    std::vector<std::string>* bufs) const WARN_UNUSED_RESULT;
+
   // Creates the set of table partitions for a partition schema and collection
   // of split rows and split bounds.
   //
@@ -181,6 +181,26 @@ TEST_F(TestRowChangeList, TestReinserts) {
             RowChangeList(Slice(buf2)).ToString(schema_));
 }
 
+TEST_F(TestRowChangeList, TestFullRowUpdates) {
+  faststring buf;
+  RowChangeListEncoder enc(&buf);
+  {
+    RowBuilder rb(schema_);
+    rb.AddString(Slice("hello"));
+    rb.AddString(Slice("world"));
+    rb.AddUint32(12345);
+    rb.AddNull();
+    enc.SetToFullRowUpdate(rb.row());
+  }
+
+  // The key isn't part of the update, and the indirect data was copied.
+  EXPECT_EQ(R"(SET col2="world", col3=12345, col4=NULL)",
+            RowChangeList(Slice(buf)).ToString(schema_));
+  RowChangeListDecoder dec((RowChangeList(buf)));
+  ASSERT_OK(dec.Init());
+  ASSERT_TRUE(dec.is_update());
+}
+
 TEST_F(TestRowChangeList, TestInvalid_EmptySlice) {
   RowChangeListDecoder decoder((RowChangeList(Slice())));
   ASSERT_STR_CONTAINS(decoder.Init().ToString(),
@@ -168,6 +168,12 @@ class RowChangeListEncoder {
   template<class RowType>
   void SetToReinsert(const RowType& src_row);
 
+  // Encodes an UPDATE which sets every non-key column to its value in
+  // 'src_row'. Like SetToReinsert(), this copies both direct and indirect
+  // data from 'src_row'.
+  template<class RowType>
+  void SetToFullRowUpdate(const RowType& src_row);
+
   // Add a column update, given knowledge of the schema.
   //
   // If 'cell_ptr' is NULL, then 'col_schema' must refer to a nullable
@@ -235,6 +241,10 @@ class RowChangeListEncoder {
   // it is the fixed-length representation of the type.
   void EncodeColumnMutationRaw(int col_id, bool is_null, Slice new_val);
 
+  // Encode a mutation of each of the non-key columns of 'src_row'.
+  template<class RowType>
+  void EncodeNonKeyColumns(const RowType& src_row);
+
   RowChangeList::ChangeType type_;
   faststring *dst_;
 };
@@ -243,10 +253,21 @@ template<class RowType>
 void RowChangeListEncoder::SetToReinsert(const RowType& src_row) {
   DCHECK_EQ(RowChangeList::kUninitialized, type_);
   SetType(RowChangeList::kReinsert);
+  // Reinserts don't need to store the keys.
+  EncodeNonKeyColumns(src_row);
+}
+
+template<class RowType>
+void RowChangeListEncoder::SetToFullRowUpdate(const RowType& src_row) {
+  DCHECK_EQ(RowChangeList::kUninitialized, type_);
+  SetType(RowChangeList::kUpdate);
+  EncodeNonKeyColumns(src_row);
+}
+
+template<class RowType>
+void RowChangeListEncoder::EncodeNonKeyColumns(const RowType& src_row) {
   const Schema* schema = src_row.schema();
-  for (int i = 0; i < schema->num_columns(); ++i) {
-    // Reinserts don't need to store the keys.
-    if (schema->is_key_column(i)) continue;
+  for (int i = schema->num_key_columns(); i < schema->num_columns(); ++i) {
     ColumnId col_id = schema->column_id(i);
     const ColumnSchema& col_schema = schema->column(i);
     if (col_schema.is_nullable() && src_row.is_null(i)) {
@@ -689,4 +689,67 @@ TEST_F(RowOperationsTest, SplitKeyRoundTrip) {
   CHECK(!row2->IsColumnSet("missing"));
 }
 
+// Test that operations from separately-encoded batches can be appended
+// together, with the indirect string data rebased, and decoded as one batch.
+TEST_F(RowOperationsTest, TestAppendRowOperations) {
+  Schema client_schema({ ColumnSchema("key", INT32),
+                         ColumnSchema("int_val", INT32),
+                         ColumnSchema("string_val", STRING, true) },
+                       1);
+
+  RowOperationsPB merged;
+  vector<string> expected;
+  for (int batch = 0; batch < 3; batch++) {
+    RowOperationsPB pb;
+    RowOperationsPBEncoder enc(&pb);
+    for (int i = 0; i < batch + 1; i++) {
+      int key = batch * 10 + i;
+      KuduPartialRow row(&client_schema);
+      CHECK_OK(row.SetInt32("key", key));
+      CHECK_OK(row.SetInt32("int_val", key * 2));
+      if (i % 2 == 0) {
+        CHECK_OK(row.SetStringCopy("string_val", Substitute("batch $0 row $1", batch, i)));
+        expected.push_back(Substitute(
+            R"(INSERT (int32 key=$0, int32 int_val=$1, string string_val="batch $2 row $3"))",
+            key, key * 2, batch, i));
+      } else {
+        CHECK_OK(row.SetNull("string_val"));
+        expected.push_back(Substitute(
+            "INSERT (int32 key=$0, int32 int_val=$1, string string_val=NULL)", key, key * 2));
+      }
+      enc.Add(RowOperationsPB::INSERT, row);
+    }
+    int num_ops;
+    ASSERT_OK(AppendRowOperations(client_schema, pb, &merged, &num_ops));
+    ASSERT_EQ(batch + 1, num_ops);
+  }
+
+  vector<DecodedRowOperation> ops;
+  RowOperationsPBDecoder dec(&merged, &client_schema, &schema_, &arena_);
+  ASSERT_OK(dec.DecodeOperations(&ops));
+  ASSERT_EQ(expected.size(), ops.size());
+  for (int i = 0; i < ops.size(); i++) {
+    EXPECT_EQ(expected[i], ops[i].ToString(schema_));
+  }
+
+  // A malformed batch is rejected without touching what was already there.
+  RowOperationsPB bad;
+  {
+    RowOperationsPBEncoder enc(&bad);
+    KuduPartialRow row(&client_schema);
+    CHECK_OK(row.SetInt32("key", 100));
+    CHECK_OK(row.SetInt32("int_val", 200));
+    CHECK_OK(row.SetStringCopy("string_val", "hello"));
+    enc.Add(RowOperationsPB::INSERT, row);
+  }
+  bad.mutable_indirect_data()->resize(2);
+  string rows_before = merged.rows();
+  string indirect_before = merged.indirect_data();
+  int num_ops;
+  Status s = AppendRowOperations(client_schema, bad, &merged, &num_ops);
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  EXPECT_EQ(rows_before, merged.rows());
+  EXPECT_EQ(indirect_before, merged.indirect_data());
+}
+
 } // namespace kudu
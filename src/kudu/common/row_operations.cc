@@ -17,6 +17,8 @@
 
 #include "kudu/common/row_operations.h"
 
+#include <cstring>
+
 #include "kudu/common/partial_row.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/schema.h"
@@ -135,13 +137,22 @@ RowOperationsPBDecoder::RowOperationsPBDecoder(const RowOperationsPB* pb,
                                                const Schema* client_schema,
                                                const Schema* tablet_schema,
                                                Arena* dst_arena)
-  : pb_(pb),
+  : RowOperationsPBDecoder(pb->rows(), pb->indirect_data(),
+                           client_schema, tablet_schema, dst_arena) {
+}
+
+RowOperationsPBDecoder::RowOperationsPBDecoder(Slice rows,
+                                               Slice indirect_data,
+                                               const Schema* client_schema,
+                                               const Schema* tablet_schema,
+                                               Arena* dst_arena)
+  : indirect_data_(indirect_data),
     client_schema_(client_schema),
     tablet_schema_(tablet_schema),
     dst_arena_(dst_arena),
     bm_size_(BitmapSize(client_schema_->num_columns())),
     tablet_row_size_(ContiguousRowHelper::row_size(*tablet_schema_)),
-    src_(pb->rows().data(), pb->rows().size()) {
+    src_(rows) {
 }
 
 RowOperationsPBDecoder::~RowOperationsPBDecoder() {
@@ -192,11 +203,11 @@ Status RowOperationsPBDecoder::GetColumnSlice(const ColumnSchema& col, Slice* sl
     size_t offset_in_indirect = reinterpret_cast<uintptr_t>(ptr_slice->data());
     bool overflowed = false;
     size_t max_offset = AddWithOverflowCheck(offset_in_indirect, ptr_slice->size(), &overflowed);
-    if (PREDICT_FALSE(overflowed || max_offset > pb_->indirect_data().size())) {
+    if (PREDICT_FALSE(overflowed || max_offset > indirect_data_.size())) {
       return Status::Corruption("Bad indirect slice");
     }
 
-    *slice = Slice(&pb_->indirect_data()[offset_in_indirect], ptr_slice->size());
+    *slice = Slice(indirect_data_.data() + offset_in_indirect, ptr_slice->size());
   } else {
     *slice = Slice(src_.data(), size);
   }
@@ -599,4 +610,76 @@ Status RowOperationsPBDecoder::DecodeOperations(vector<DecodedRowOperation>* ops
   return Status::OK();
 }
 
+Status AppendRowOperations(const Schema& client_schema,
+                           const RowOperationsPB& src,
+                           RowOperationsPB* dst,
+                           int* num_ops) {
+  const int bm_size = BitmapSize(client_schema.num_columns());
+  const int null_bm_size = client_schema.has_nullables() ? bm_size : 0;
+  const size_t indirect_base = dst->indirect_data().size();
+  const size_t src_indirect_size = src.indirect_data().size();
+
+  // Copy the rows first and patch the indirect offsets in the copy, so that
+  // a malformed 'src' can be discarded by truncating back to 'old_size'.
+  string* rows = dst->mutable_rows();
+  const size_t old_size = rows->size();
+  rows->append(src.rows());
+  uint8_t* p = reinterpret_cast<uint8_t*>(&(*rows)[old_size]);
+  const uint8_t* end = p + src.rows().size();
+
+  Status s;
+  int count = 0;
+  while (p != end) {
+    if (PREDICT_FALSE(!RowOperationsPB_Type_IsValid(*p))) {
+      s = Status::Corruption(Substitute("Unknown operation type: $0", *p));
+      break;
+    }
+    p++;
+    if (PREDICT_FALSE(end - p < bm_size + null_bm_size)) {
+      s = Status::Corruption("Cannot find isset or null bitmap");
+      break;
+    }
+    const uint8_t* isset_bm = p;
+    const uint8_t* null_bm = null_bm_size > 0 ? p + bm_size : nullptr;
+    p += bm_size + null_bm_size;
+
+    for (int i = 0; i < client_schema.num_columns() && s.ok(); i++) {
+      if (!BitmapTest(isset_bm, i)) continue;
+      const ColumnSchema& col = client_schema.column(i);
+      if (col.is_nullable() && BitmapTest(null_bm, i)) continue;
+
+      const int size = col.type_info()->size();
+      if (PREDICT_FALSE(end - p < size)) {
+        s = Status::Corruption("Not enough data for column", col.ToString());
+        break;
+      }
+      if (col.type_info()->physical_type() == BINARY) {
+        // The cells may be unaligned within the buffer, so go through a copy.
+        Slice cell;
+        memcpy(&cell, p, sizeof(Slice));
+        size_t offset = reinterpret_cast<uintptr_t>(cell.data());
+        bool overflowed = false;
+        size_t max_offset = AddWithOverflowCheck(offset, cell.size(), &overflowed);
+        if (PREDICT_FALSE(overflowed || max_offset > src_indirect_size)) {
+          s = Status::Corruption("Bad indirect slice");
+          break;
+        }
+        cell = Slice(reinterpret_cast<const uint8_t*>(offset + indirect_base), cell.size());
+        memcpy(p, &cell, sizeof(Slice));
+      }
+      p += size;
+    }
+    if (!s.ok()) break;
+    count++;
+  }
+
+  if (PREDICT_FALSE(!s.ok())) {
+    rows->resize(old_size);
+    return s;
+  }
+  dst->mutable_indirect_data()->append(src.indirect_data());
+  *num_ops = count;
+  return Status::OK();
+}
+
 } // namespace kudu
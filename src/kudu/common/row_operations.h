@@ -24,6 +24,7 @@
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -76,6 +77,16 @@ class RowOperationsPBDecoder {
                          const Schema* client_schema,
                          const Schema* tablet_schema,
                          Arena* dst_arena);
+
+  // Like the above, but decodes the operations from 'rows' and
+  // 'indirect_data', encoded like the fields of RowOperationsPB, e.g. when
+  // they were received as RPC sidecars. The decoded operations may point into
+  // both, which must outlive them.
+  RowOperationsPBDecoder(Slice rows,
+                         Slice indirect_data,
+                         const Schema* client_schema,
+                         const Schema* tablet_schema,
+                         Arena* dst_arena);
   ~RowOperationsPBDecoder();
 
   Status DecodeOperations(std::vector<DecodedRowOperation>* ops);
@@ -103,7 +114,7 @@ class RowOperationsPBDecoder {
   Status DecodeSplitRow(const ClientServerMapping& mapping,
                         DecodedRowOperation* op);
 
-  const RowOperationsPB* const pb_;
+  const Slice indirect_data_;
   const Schema* const client_schema_;
   const Schema* const tablet_schema_;
   Arena* const dst_arena_;
@@ -115,5 +126,17 @@ class RowOperationsPBDecoder {
 
   DISALLOW_COPY_AND_ASSIGN(RowOperationsPBDecoder);
 };
+
+// Appends the operations encoded in 'src' to those already in 'dst', copying
+// the indirect data along and rebasing the offsets of the BINARY cells which
+// refer to it. Both must have been encoded against 'client_schema'.
+//
+// On success, sets '*num_ops' to the number of operations appended. If 'src'
+// is malformed, returns Corruption and leaves 'dst' unmodified.
+Status AppendRowOperations(const Schema& client_schema,
+                           const RowOperationsPB& src,
+                           RowOperationsPB* dst,
+                           int* num_ops);
+
 } // namespace kudu
 #endif /* KUDU_COMMON_ROW_OPERATIONS_H */
@@ -77,7 +77,7 @@ RowBlock::RowBlock(const Schema &schema,
                    size_t nrows,
                    Arena *arena)
   : schema_(schema),
-    columns_data_(schema.num_columns()),
+    owned_columns_data_(schema.num_columns()),
     column_null_bitmaps_(schema.num_columns()),
     row_capacity_(nrows),
     nrows_(nrows),
@@ -89,16 +89,17 @@ RowBlock::RowBlock(const Schema &schema,
   for (size_t i = 0; i < schema.num_columns(); ++i) {
     const ColumnSchema& col_schema = schema.column(i);
     size_t col_size = row_capacity_ * col_schema.type_info()->size();
-    columns_data_[i] = new uint8_t[col_size];
+    owned_columns_data_[i] = new uint8_t[col_size];
 
     if (col_schema.is_nullable()) {
       column_null_bitmaps_[i] = new uint8_t[bitmap_size];
     }
   }
+  columns_data_ = owned_columns_data_;
 }
 
 RowBlock::~RowBlock() {
-  for (uint8_t *column_data : columns_data_) {
+  for (uint8_t *column_data : owned_columns_data_) {
     delete[] column_data;
   }
   for (uint8_t *bitmap_data : column_null_bitmaps_) {
@@ -110,6 +111,25 @@ void RowBlock::Resize(size_t new_size) {
   CHECK_LE(new_size, row_capacity_);
   nrows_ = new_size;
   sel_vec_.Resize(new_size);
+  ResetExternalColumnData();
+}
+
+void RowBlock::SetExternalColumnData(size_t col_idx, const uint8_t* data,
+                                     std::shared_ptr<const void> pin) {
+  DCHECK_LT(col_idx, columns_data_.size());
+  DCHECK(data != nullptr);
+  // The block never writes into external data, and callers are not allowed
+  // to either.
+  columns_data_[col_idx] = const_cast<uint8_t*>(data);
+  external_data_pins_.emplace_back(std::move(pin));
+}
+
+void RowBlock::ResetExternalColumnData() {
+  if (PREDICT_TRUE(external_data_pins_.empty())) {
+    return;
+  }
+  columns_data_ = owned_columns_data_;
+  external_data_pins_.clear();
 }
 
 } // namespace kudu
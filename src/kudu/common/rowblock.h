@@ -17,6 +17,7 @@
 #ifndef KUDU_COMMON_ROWBLOCK_H
 #define KUDU_COMMON_ROWBLOCK_H
 
+#include <memory>
 #include <vector>
 #include "kudu/common/columnblock.h"
 #include "kudu/common/schema.h"
@@ -53,9 +54,21 @@ class SelectionVector {
   // Resize the selection vector to the given number of rows.
   // This size must be <= the allocated capacity.
   //
-  // Ensures that all rows for indices < n_rows are unmodified.
+  // Ensures that all rows for indices < n_rows are unmodified, except that
+  // any column data set by SetExternalColumnData() is dropped: callers resize
+  // a block before refilling it, and must never write into borrowed memory.
   void Resize(size_t n_rows);
 
+  // Point the data of column 'col_idx' at 'data' rather than at the block's
+  // own buffer, until the next call to Resize(). 'data' must hold nrows()
+  // cells and must not be modified through this block; 'pin' is held until
+  // then to keep it alive. The column's null bitmap, if any, is unaffected.
+  //
+  // This lets iterators hand out values straight from memory they already
+  // hold (e.g. a cached CFile block) without copying them.
+  void SetExternalColumnData(size_t col_idx, const uint8_t* data,
+                             std::shared_ptr<const void> pin);
+
   // Return the number of selected rows.
   size_t CountSelected() const;
 
@@ -147,6 +160,20 @@ class SelectionVectorView {
     DCHECK_LE(nrows, sel_vec_->nrows() - row_offset_);
     BitmapChangeBits(sel_vec_->mutable_bitmap(), row_offset_, nrows, false);
   }
+  // Return the number of consecutive rows, starting at 'row_idx' and at most
+  // 'nrows' of them, which are all selected or all unselected. Sets
+  // '*selected' to which.
+  size_t GetRun(size_t row_idx, size_t nrows, bool* selected) const {
+    DCHECK_LE(row_idx + nrows, sel_vec_->nrows() - row_offset_);
+    DCHECK_GT(nrows, 0);
+    size_t start = row_offset_ + row_idx;
+    *selected = BitmapTest(sel_vec_->bitmap(), start);
+    size_t end;
+    if (!BitmapFindFirst(sel_vec_->bitmap(), start, start + nrows, !*selected, &end)) {
+      return nrows;
+    }
+    return end - start;
+  }
  private:
   SelectionVector* sel_vec_;
   size_t row_offset_;
@@ -175,9 +202,21 @@ class RowBlock {
   // Resize the block to the given number of rows.
   // This size must be <= the the allocated capacity row_capacity().
   //
-  // Ensures that all rows for indices < n_rows are unmodified.
+  // Ensures that all rows for indices < n_rows are unmodified, except that
+  // any column data set by SetExternalColumnData() is dropped: callers resize
+  // a block before refilling it, and must never write into borrowed memory.
   void Resize(size_t n_rows);
 
+  // Point the data of column 'col_idx' at 'data' rather than at the block's
+  // own buffer, until the next call to Resize(). 'data' must hold nrows()
+  // cells and must not be modified through this block; 'pin' is held until
+  // then to keep it alive. The column's null bitmap, if any, is unaffected.
+  //
+  // This lets iterators hand out values straight from memory they already
+  // hold (e.g. a cached CFile block) without copying them.
+  void SetExternalColumnData(size_t col_idx, const uint8_t* data,
+                             std::shared_ptr<const void> pin);
+
   size_t row_capacity() const {
     return row_capacity_;
   }
@@ -211,6 +250,14 @@ class RowBlock {
     return columns_data_[col_idx];
   }
 
+  // Return the null bitmap of the given column, or NULL if it isn't nullable.
+  //
+  // As above, this is used by the codegen code.
+  uint8_t* column_null_bitmap_ptr(size_t col_idx) const {
+    DCHECK_LT(col_idx, column_null_bitmaps_.size());
+    return column_null_bitmaps_[col_idx];
+  }
+
   // Return the number of rows in the row block. Note that this includes
   // rows which were filtered out by the selection vector.
   size_t nrows() const { return nrows_; }
@@ -223,7 +270,7 @@ class RowBlock {
     for (size_t i = 0; i < schema_.num_columns(); ++i) {
       const ColumnSchema& col_schema = schema_.column(i);
       size_t col_size = col_schema.type_info()->size() * row_capacity_;
-      memset(columns_data_[i], '\0', col_size);
+      memset(owned_columns_data_[i], '\0', col_size);
 
       if (column_null_bitmaps_[i] != NULL) {
         memset(column_null_bitmaps_[i], '\0', bitmap_size);
@@ -261,10 +308,20 @@ class RowBlock {
     return block_size;
   }
 
+  // Drop any column data set by SetExternalColumnData().
+  void ResetExternalColumnData();
+
   Schema schema_;
+
+  // The current data of each column: either the block's own buffer from
+  // 'owned_columns_data_' or memory set by SetExternalColumnData().
   std::vector<uint8_t *> columns_data_;
+  std::vector<uint8_t *> owned_columns_data_;
   std::vector<uint8_t *> column_null_bitmaps_;
 
+  // Keeps the memory set by SetExternalColumnData() alive.
+  std::vector<std::shared_ptr<const void>> external_data_pins_;
+
   // The maximum number of rows that can be stored in our allocated buffer.
   size_t row_capacity_;
 
@@ -378,6 +378,43 @@ TEST_F(CompositeIntKeysTest, TestInListPushdownWithRange) {
             spec.ToString(schema_));
 }
 
+// Test the ranges of keys derived from an IN list on the first key column,
+// with and without primary key bounds.
+TEST_F(CompositeIntKeysTest, TestKeyInListRanges) {
+  vector<EncodedKeyRange> ranges;
+  {
+    ScanSpec spec;
+    AddInPredicate<int8_t>(&spec, "b", { 0, 10 });
+    ASSERT_FALSE(spec.GetKeyInListRanges(schema_, &ranges));
+  }
+  {
+    ScanSpec spec;
+    AddInPredicate<int8_t>(&spec, "a", { 0, 10, 127 });
+    ASSERT_TRUE(spec.GetKeyInListRanges(schema_, &ranges));
+    ASSERT_EQ(3, ranges.size());
+    EXPECT_EQ(string("\x80", 1), ranges[0].lower);
+    EXPECT_EQ(string("\x81", 1), ranges[0].upper);
+    EXPECT_EQ(string("\x8a", 1), ranges[1].lower);
+    EXPECT_EQ(string("\x8b", 1), ranges[1].upper);
+    // There's no key prefix above 0xff.
+    EXPECT_EQ(string("\xff", 1), ranges[2].lower);
+    EXPECT_EQ("", ranges[2].upper);
+  }
+  {
+    ScanSpec spec;
+    AddInPredicate<int8_t>(&spec, "a", { 0, 10 });
+    AddInPredicate<int8_t>(&spec, "b", { 50, 100 });
+    spec.OptimizeScan(schema_, &arena_, &pool_, true);
+    ASSERT_TRUE(spec.GetKeyInListRanges(schema_, &ranges));
+    ASSERT_EQ(2, ranges.size());
+    // Clipped to PK >= (0, 50, -128) AND PK < (10, 101, -128).
+    EXPECT_EQ(string("\x80\xb2\x00", 3), ranges[0].lower);
+    EXPECT_EQ(string("\x81", 1), ranges[0].upper);
+    EXPECT_EQ(string("\x8a", 1), ranges[1].lower);
+    EXPECT_EQ(string("\x8a\xe5\x00", 3), ranges[1].upper);
+  }
+}
+
 // Tests that a scan spec without primary key bounds will not have predicates
 // after optimization.
 TEST_F(CompositeIntKeysTest, TestLiftPrimaryKeyBounds_NoBounds) {
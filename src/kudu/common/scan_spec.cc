@@ -22,6 +22,7 @@
 #include <utility>
 #include <vector>
 
+#include "kudu/common/key_encoder.h"
 #include "kudu/common/key_util.h"
 #include "kudu/common/row.h"
 #include "kudu/gutil/map-util.h"
@@ -55,6 +56,10 @@ void ScanSpec::RemovePredicates() {
 }
 
 bool ScanSpec::CanShortCircuit() const {
+  if (limit_ == 0) {
+    return true;
+  }
+
   if (lower_bound_key_ &&
       exclusive_upper_bound_key_ &&
       lower_bound_key_->encoded_key().compare(exclusive_upper_bound_key_->encoded_key()) >= 0) {
@@ -114,6 +119,65 @@ string ScanSpec::ToString(const Schema& schema) const {
   return JoinStrings(preds, " AND ");
 }
 
+bool ScanSpec::GetKeyInListRanges(const Schema& schema, vector<EncodedKeyRange>* ranges) const {
+  const ColumnSchema& col = schema.column(0);
+  const ColumnPredicate* pred = FindOrNull(predicates_, col.name());
+  if (pred == nullptr || pred->predicate_type() != PredicateType::InList) {
+    return false;
+  }
+
+  Slice bound_lower = lower_bound_key_ ? lower_bound_key_->encoded_key() : Slice();
+  Slice bound_upper = exclusive_upper_bound_key_ ?
+      exclusive_upper_bound_key_->encoded_key() : Slice();
+  bool single_column_key = schema.num_key_columns() == 1;
+  const KeyEncoder<faststring>& encoder = GetKeyEncoder<faststring>(col.type_info());
+
+  ranges->clear();
+  ranges->reserve(pred->raw_values().size());
+  faststring buf;
+  // The values are sorted, and the key encoding preserves their order.
+  for (const void* value : pred->raw_values()) {
+    buf.clear();
+    encoder.Encode(value, single_column_key, &buf);
+    EncodedKeyRange range;
+    range.value = value;
+    range.lower = buf.ToString();
+
+    if (single_column_key) {
+      if (Slice(range.lower).compare(bound_lower) < 0 ||
+          (!bound_upper.empty() && Slice(range.lower).compare(bound_upper) >= 0)) {
+        continue;
+      }
+      ranges->push_back(std::move(range));
+      continue;
+    }
+
+    // The keys starting with the encoded value are below its successor as a
+    // prefix: the value with trailing 0xff bytes dropped, and the last
+    // remaining byte incremented.
+    range.upper = range.lower;
+    while (!range.upper.empty() && static_cast<uint8_t>(range.upper.back()) == 0xff) {
+      range.upper.pop_back();
+    }
+    if (!range.upper.empty()) {
+      range.upper.back() = static_cast<char>(static_cast<uint8_t>(range.upper.back()) + 1);
+    }
+
+    if (Slice(range.lower).compare(bound_lower) < 0) {
+      range.lower = bound_lower.ToString();
+    }
+    if (!bound_upper.empty() &&
+        (range.upper.empty() || Slice(range.upper).compare(bound_upper) > 0)) {
+      range.upper = bound_upper.ToString();
+    }
+    if (!range.upper.empty() && Slice(range.lower).compare(range.upper) >= 0) {
+      continue;
+    }
+    ranges->push_back(std::move(range));
+  }
+  return true;
+}
+
 void ScanSpec::OptimizeScan(const Schema& schema,
                             Arena* arena,
                             AutoReleasePool* pool,
@@ -167,9 +231,9 @@ void ScanSpec::PushPredicatesIntoPrimaryKeyBounds(const Schema& schema,
       } else if (type == PredicateType::Range) {
         RemovePredicate(column);
         break;
-      } else if (type == PredicateType::InList) {
-        // InList predicates should not be removed as the full constraints imposed by an InList
-        // cannot be translated into only a single set of lower and upper bound primary keys
+      } else if (type == PredicateType::InList || type == PredicateType::InBloomFilter) {
+        // InList and InBloomFilter predicates should not be removed as the full constraints they
+        // impose cannot be translated into only a single set of lower and upper bound primary keys
         break;
       } else {
         LOG(FATAL) << "Can not remove unknown predicate type";
@@ -19,6 +19,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "kudu/common/schema.h"
 #include "kudu/common/column_predicate.h"
@@ -29,6 +30,15 @@ namespace kudu {
 class AutoReleasePool;
 class Arena;
 
+// A range [lower, upper) of encoded primary keys whose first key column is
+// 'value'. See ScanSpec::GetKeyInListRanges().
+struct EncodedKeyRange {
+  const void* value;
+  std::string lower;
+  // Empty if the range has no upper bound.
+  std::string upper;
+};
+
 class ScanSpec {
  public:
   ScanSpec()
@@ -37,7 +47,10 @@ class ScanSpec {
       exclusive_upper_bound_key_(nullptr),
       lower_bound_partition_key_(),
       exclusive_upper_bound_partition_key_(),
-      cache_blocks_(true) {
+      cache_blocks_(true),
+      cache_blocks_low_priority_(false),
+      readahead_blocks_(-1),
+      limit_(-1) {
   }
 
   // Add a predicate on the column.
@@ -118,8 +131,57 @@ class ScanSpec {
     cache_blocks_ = cache_blocks;
   }
 
+  // Whether cached data blocks are inserted as the next ones to evict, so
+  // that they're only kept if they're read again. Index blocks are cached
+  // normally. Only meaningful if cache_blocks() is true.
+  bool cache_blocks_low_priority() const {
+    return cache_blocks_low_priority_;
+  }
+
+  void set_cache_blocks_low_priority(bool low_priority) {
+    cache_blocks_low_priority_ = low_priority;
+  }
+
+  // The number of data blocks of each column to read ahead once the scan is
+  // found to be reading sequentially, or -1 to use the server default.
+  int readahead_blocks() const {
+    return readahead_blocks_;
+  }
+
+  void set_readahead_blocks(int readahead_blocks) {
+    readahead_blocks_ = readahead_blocks;
+  }
+
+  // The maximum number of rows the scan needs to return, or -1 if it needs
+  // all of them. Iterators which evaluate all of the predicates of their
+  // sub-iterators (MergeIterator, UnionIterator) stop returning rows once
+  // they've returned this many.
+  int64_t limit() const {
+    return limit_;
+  }
+
+  bool has_limit() const {
+    return limit_ >= 0;
+  }
+
+  void set_limit(int64_t limit) {
+    limit_ = limit;
+  }
+
   std::string ToString(const Schema& s) const;
 
+  // If the scan has an IN list predicate on the first primary key column of
+  // 'schema', returns true and sets '*ranges' to the ranges of encoded primary
+  // keys which hold the rows matching the predicate, one per value of the list
+  // in ascending order, clipped to the scan's primary key bounds. Returns
+  // false otherwise.
+  //
+  // If the primary key has a single column, each range is made of the key
+  // 'lower' alone.
+  //
+  // The ranges point into the predicate, and are only valid as long as it is.
+  bool GetKeyInListRanges(const Schema& schema, std::vector<EncodedKeyRange>* ranges) const;
+
  private:
 
   // Lift implicit predicates specified as part of the lower and upper bound
@@ -148,6 +210,9 @@ class ScanSpec {
   std::string lower_bound_partition_key_;
   std::string exclusive_upper_bound_partition_key_;
   bool cache_blocks_;
+  bool cache_blocks_low_priority_;
+  int readahead_blocks_;
+  int64_t limit_;
 };
 
 } // namespace kudu
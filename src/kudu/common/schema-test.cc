@@ -117,6 +117,31 @@ TEST_F(TestSchema, TestReset) {
   ASSERT_TRUE(schema2.initialized());
 }
 
+TEST_F(TestSchema, TestResetWithTtl) {
+  ColumnStorageAttributes ttl;
+  ttl.ttl_seconds = 3600;
+  Schema schema;
+  ASSERT_OK(schema.Reset({ ColumnSchema("key", INT32),
+                           ColumnSchema("ts", UNIXTIME_MICROS, false, nullptr, nullptr, ttl) },
+                         1));
+  ASSERT_EQ(1, schema.find_ttl_column());
+
+  // The TTL column must be a single non-nullable timestamp.
+  Status s = schema.Reset({ ColumnSchema("key", INT32),
+                            ColumnSchema("ts", INT64, false, nullptr, nullptr, ttl) },
+                          1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = schema.Reset({ ColumnSchema("key", INT32),
+                     ColumnSchema("ts", UNIXTIME_MICROS, true, nullptr, nullptr, ttl) },
+                   1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  s = schema.Reset({ ColumnSchema("key", INT32),
+                     ColumnSchema("ts1", UNIXTIME_MICROS, false, nullptr, nullptr, ttl),
+                     ColumnSchema("ts2", UNIXTIME_MICROS, false, nullptr, nullptr, ttl) },
+                   1);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
 // Test for KUDU-943, a bug where we suspected that Variant didn't behave
 // correctly with empty strings.
 TEST_F(TestSchema, TestEmptyVariant) {
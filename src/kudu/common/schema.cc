@@ -20,9 +20,11 @@
 #include <set>
 #include <algorithm>
 
+#include "kudu/common/decimal_util.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/strcat.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/status.h"
 #include "kudu/common/row.h"
@@ -46,10 +48,29 @@ static const ColumnId  kFirstColumnId(10);
 #endif
 
 string ColumnStorageAttributes::ToString() const {
-  return strings::Substitute("encoding=$0, compression=$1, cfile_block_size=$2",
+  return strings::Substitute("encoding=$0, compression=$1, cfile_block_size=$2, "
+                             "bloom_filter=$3, secondary_index=$4, ttl_seconds=$5",
                              EncodingType_Name(encoding),
                              CompressionType_Name(compression),
-                             cfile_block_size);
+                             cfile_block_size,
+                             bloom_filter,
+                             secondary_index,
+                             ttl_seconds);
+}
+
+bool ColumnTypeAttributes::EqualsForType(const ColumnTypeAttributes& other,
+                                         DataType type) const {
+  if (IsDecimalType(type)) {
+    return precision == other.precision && scale == other.scale;
+  }
+  return true;
+}
+
+string ColumnTypeAttributes::ToStringForType(DataType type) const {
+  if (IsDecimalType(type)) {
+    return strings::Substitute("($0, $1)", precision, scale);
+  }
+  return "";
 }
 
 // TODO: include attributes_.ToString() -- need to fix unit tests
@@ -61,11 +82,35 @@ string ColumnSchema::ToString() const {
 }
 
 string ColumnSchema::TypeToString() const {
-  return strings::Substitute("$0 $1",
+  return strings::Substitute("$0$1 $2",
                              type_info_->name(),
+                             type_attributes_.ToStringForType(type_info_->type()),
                              is_nullable_ ? "NULLABLE" : "NOT NULL");
 }
 
+void ColumnSchema::AppendDebugStringForValue(const void* cell, string* ret) const {
+  if (KUDU_SHOULD_REDACT()) {
+    ret->append(kRedactionMessage);
+    return;
+  }
+  switch (type_info_->type()) {
+    case DECIMAL32:
+      ret->append(DecimalToString(*reinterpret_cast<const int32_t*>(cell),
+                                  type_attributes_.scale));
+      break;
+    case DECIMAL64:
+      ret->append(DecimalToString(*reinterpret_cast<const int64_t*>(cell),
+                                  type_attributes_.scale));
+      break;
+    case DECIMAL128:
+      ret->append(DecimalToString(*reinterpret_cast<const int128_t*>(cell),
+                                  type_attributes_.scale));
+      break;
+    default:
+      type_info_->AppendDebugStringForValue(cell, ret);
+  }
+}
+
 size_t ColumnSchema::memory_footprint_excluding_this() const {
   // Rough approximation.
   return name_.capacity();
@@ -151,6 +196,29 @@ Status Schema::Reset(const vector<ColumnSchema>& cols,
     }
   }
 
+  // Verify that at most one column has a TTL, and that it is a non-nullable
+  // timestamp.
+  bool has_ttl = false;
+  for (const ColumnSchema& col : cols_) {
+    if (col.attributes().ttl_seconds == 0) {
+      continue;
+    }
+    if (PREDICT_FALSE(col.attributes().ttl_seconds < 0)) {
+      return Status::InvalidArgument(
+        "Bad schema", strings::Substitute("Negative TTL on column $0", col.name()));
+    }
+    if (PREDICT_FALSE(col.type_info()->type() != UNIXTIME_MICROS || col.is_nullable())) {
+      return Status::InvalidArgument(
+        "Bad schema", strings::Substitute("TTL on column $0, which is not a non-nullable "
+                                          "timestamp", col.name()));
+    }
+    if (PREDICT_FALSE(has_ttl)) {
+      return Status::InvalidArgument(
+        "Bad schema", "A TTL may be set on at most one column");
+    }
+    has_ttl = true;
+  }
+
   // Calculate the offset of each column in the row format.
   col_offsets_.reserve(cols_.size() + 1);  // Include space for total byte size at the end.
   size_t off = 0;
@@ -85,13 +85,19 @@ struct ColumnStorageAttributes {
   ColumnStorageAttributes()
     : encoding(AUTO_ENCODING),
       compression(DEFAULT_COMPRESSION),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      bloom_filter(false),
+      secondary_index(false),
+      ttl_seconds(0) {
   }
 
   ColumnStorageAttributes(EncodingType enc, CompressionType cmp)
     : encoding(enc),
       compression(cmp),
-      cfile_block_size(0) {
+      cfile_block_size(0),
+      bloom_filter(false),
+      secondary_index(false),
+      ttl_seconds(0) {
   }
 
   string ToString() const;
@@ -102,6 +108,47 @@ struct ColumnStorageAttributes {
   // The preferred block size for cfile blocks. If 0, uses the
   // server-wide default.
   int32_t cfile_block_size;
+
+  // Whether to store bloom filters over the values of the column, allowing
+  // scans with equality or IN-list predicates on the column to skip rowsets
+  // which hold no matching value. Ignored for floating point columns.
+  bool bloom_filter;
+
+  // Whether to index the rows of each rowset by the value of the column,
+  // allowing selective scans with equality, range or IN-list predicates on
+  // the column to read only the matching rows. Ignored for BOOL and floating
+  // point columns.
+  bool secondary_index;
+
+  // If positive, the rows whose value of the column is older than this many
+  // seconds are expired: scans don't return them and compactions drop them.
+  // Only valid for a single non-nullable UNIXTIME_MICROS column of the schema.
+  int64_t ttl_seconds;
+};
+
+// The attributes of a parameterized column type, for now the precision and
+// the scale of the DECIMAL types. They are zero for the other types.
+struct ColumnTypeAttributes {
+ public:
+  ColumnTypeAttributes()
+    : precision(0),
+      scale(0) {
+  }
+
+  ColumnTypeAttributes(int8_t precision, int8_t scale)
+    : precision(precision),
+      scale(scale) {
+  }
+
+  // Returns whether the attributes that matter to 'type' are equal.
+  bool EqualsForType(const ColumnTypeAttributes& other, DataType type) const;
+
+  // Returns the attributes that matter to 'type' as the suffix of its type
+  // name, e.g. "(10, 2)" for a DECIMAL, or an empty string.
+  string ToStringForType(DataType type) const;
+
+  int8_t precision;
+  int8_t scale;
 };
 
 // The schema for a given column.
@@ -126,15 +173,19 @@ class ColumnSchema {
   //   ColumnSchema col_c("c", INT32, false, &default_i32);
   //   Slice default_str("Hello");
   //   ColumnSchema col_d("d", STRING, false, &default_str);
+  //   ColumnSchema col_e("e", DECIMAL64, false, NULL, NULL,
+  //                      ColumnStorageAttributes(), ColumnTypeAttributes(18, 2));
   ColumnSchema(string name, DataType type, bool is_nullable = false,
                const void* read_default = NULL,
                const void* write_default = NULL,
-               ColumnStorageAttributes attributes = ColumnStorageAttributes())
+               ColumnStorageAttributes attributes = ColumnStorageAttributes(),
+               ColumnTypeAttributes type_attributes = ColumnTypeAttributes())
       : name_(std::move(name)),
         type_info_(GetTypeInfo(type)),
         is_nullable_(is_nullable),
         read_default_(read_default ? new Variant(type, read_default) : NULL),
-        attributes_(std::move(attributes)) {
+        attributes_(std::move(attributes)),
+        type_attributes_(type_attributes) {
     if (write_default == read_default) {
       write_default_ = read_default_;
     } else if (write_default != NULL) {
@@ -208,7 +259,8 @@ class ColumnSchema {
 
   bool EqualsType(const ColumnSchema &other) const {
     return is_nullable_ == other.is_nullable_ &&
-           type_info()->type() == other.type_info()->type();
+           type_info()->type() == other.type_info()->type() &&
+           type_attributes_.EqualsForType(other.type_attributes_, type_info()->type());
   }
 
   bool Equals(const ColumnSchema &other, bool check_defaults) const {
@@ -242,6 +294,10 @@ class ColumnSchema {
     return attributes_;
   }
 
+  const ColumnTypeAttributes& type_attributes() const {
+    return type_attributes_;
+  }
+
   int Compare(const void *lhs, const void *rhs) const {
     return type_info_->Compare(lhs, rhs);
   }
@@ -250,7 +306,7 @@ class ColumnSchema {
   // and doesn't include the column name or type.
   string Stringify(const void *cell) const {
     string ret;
-    type_info_->AppendDebugStringForValue(cell, &ret);
+    AppendDebugStringForValue(cell, &ret);
     return ret;
   }
 
@@ -265,10 +321,14 @@ class ColumnSchema {
     if (is_nullable_ && cell.is_null()) {
       ret->append("NULL");
     } else {
-      type_info_->AppendDebugStringForValue(cell.ptr(), ret);
+      AppendDebugStringForValue(cell.ptr(), ret);
     }
   }
 
+  // Appends the debug string of the non-null 'cell', formatting the DECIMAL
+  // values with the scale of the column.
+  void AppendDebugStringForValue(const void* cell, string* ret) const;
+
   // Returns the memory usage of this object without the object itself. Should
   // be used when embedded inside another object.
   size_t memory_footprint_excluding_this() const;
@@ -291,6 +351,7 @@ class ColumnSchema {
   std::shared_ptr<Variant> read_default_;
   std::shared_ptr<Variant> write_default_;
   ColumnStorageAttributes attributes_;
+  ColumnTypeAttributes type_attributes_;
 };
 
 class ContiguousRow;
@@ -449,6 +510,17 @@ class Schema {
     }
   }
 
+  // Returns the index of the column with a TTL, see
+  // ColumnStorageAttributes::ttl_seconds, or -1 if there is none.
+  int find_ttl_column() const {
+    for (int i = 0; i < cols_.size(); ++i) {
+      if (cols_[i].attributes().ttl_seconds > 0) {
+        return i;
+      }
+    }
+    return -1;
+  }
+
   // Returns true if the schema contains nullable columns
   bool has_nullables() const {
     return has_nullables_;
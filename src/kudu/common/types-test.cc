@@ -23,6 +23,7 @@
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/decimal_util.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/test_util.h"
@@ -122,6 +123,47 @@ TEST_F(TestTypes, TestAreConsecutiveInteger) {
   TestAreConsecutive(INT64, test_cases);
 }
 
+TEST_F(TestTypes, TestAreConsecutiveInt128) {
+  vector<tuple<int128_t, int128_t, bool>> test_cases {
+    make_tuple(0, 0, false),
+    make_tuple(0, 1, true),
+    make_tuple(-1, 0, true),
+    make_tuple(INT128_MAX - 1, INT128_MAX, true),
+    make_tuple(INT128_MIN, INT128_MIN + 1, true),
+    make_tuple(INT128_MIN, INT128_MAX, false),
+    make_tuple(static_cast<int128_t>(INT64_MAX), static_cast<int128_t>(INT64_MAX) + 1, true),
+  };
+  TestAreConsecutive(INT128, test_cases);
+}
+
+TEST_F(TestTypes, TestInt128Printing) {
+  const TypeInfo* info = GetTypeInfo(INT128);
+  string result;
+  info->AppendDebugStringForValue(info->min_value(), &result);
+  ASSERT_EQ("-170141183460469231731687303715884105728", result);
+  result = "";
+  info->AppendDebugStringForValue(info->max_value(), &result);
+  ASSERT_EQ("170141183460469231731687303715884105727", result);
+}
+
+TEST_F(TestTypes, TestDecimalToString) {
+  ASSERT_EQ("0", DecimalToString(0, 0));
+  ASSERT_EQ("0.00", DecimalToString(0, 2));
+  ASSERT_EQ("123.45", DecimalToString(12345, 2));
+  ASSERT_EQ("-123.45", DecimalToString(-12345, 2));
+  ASSERT_EQ("-0.05", DecimalToString(-5, 2));
+  ASSERT_EQ("0.00001", DecimalToString(1, 5));
+  ASSERT_EQ("9999999999999999999999999999.9999999999",
+            DecimalToString(MaxUnscaledDecimal(kMaxDecimal128Precision), 10));
+  ASSERT_EQ("-170141183460469231731687303715884105728", DecimalToString(INT128_MIN, 0));
+
+  // The narrowest storage type holding each precision.
+  ASSERT_EQ(DECIMAL32, MaxPrecisionToDecimalType(kMaxDecimal32Precision));
+  ASSERT_EQ(DECIMAL64, MaxPrecisionToDecimalType(kMaxDecimal32Precision + 1));
+  ASSERT_EQ(DECIMAL64, MaxPrecisionToDecimalType(kMaxDecimal64Precision));
+  ASSERT_EQ(DECIMAL128, MaxPrecisionToDecimalType(kMaxDecimal64Precision + 1));
+}
+
 TEST_F(TestTypes, TestAreConsecutiveDouble) {
   vector<tuple<double, double, bool>> test_cases {
     make_tuple(0.0, 1.0, false),
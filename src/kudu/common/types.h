@@ -21,6 +21,7 @@
 #include <glog/logging.h>
 
 #include <cmath>
+#include <sstream>
 #include <stdint.h>
 #include <string>
 
@@ -28,6 +29,7 @@
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/strings/escaping.h"
 #include "kudu/gutil/strings/numbers.h"
+#include "kudu/util/int128.h"
 #include "kudu/util/slice.h"
 
 namespace kudu {
@@ -314,6 +316,33 @@ struct DataTypeTraits<INT64> {
   }
 };
 
+template<>
+struct DataTypeTraits<INT128> {
+  static const DataType physical_type = INT128;
+  typedef int128_t cpp_type;
+  static const char *name() {
+    return "int128";
+  }
+  static void AppendDebugStringForValue(const void *val, string *str) {
+    std::ostringstream ss;
+    // The overload is global, which the operators of namespace kudu hide.
+    ::operator<<(ss, *reinterpret_cast<const int128_t *>(val));
+    str->append(ss.str());
+  }
+  static int Compare(const void *lhs, const void *rhs) {
+    return GenericCompare<INT128>(lhs, rhs);
+  }
+  static bool AreConsecutive(const void* a, const void* b) {
+    return AreIntegersConsecutive<INT128>(a, b);
+  }
+  static const cpp_type* min_value() {
+    return &INT128_MIN;
+  }
+  static const cpp_type* max_value() {
+    return &INT128_MAX;
+  }
+};
+
 template<>
 struct DataTypeTraits<FLOAT> {
   static const DataType physical_type = FLOAT;
@@ -500,6 +529,43 @@ struct DataTypeTraits<UNIXTIME_MICROS> : public DerivedTypeTraits<INT64>{
   }
 };
 
+// The DECIMAL types are stored as their unscaled value. The scale is an
+// attribute of the column rather than of the type, so the debug strings of
+// the values are the unscaled values, suffixed by the type to tell them
+// apart from plain integers. ColumnSchema formats them with their scale.
+template<>
+struct DataTypeTraits<DECIMAL32> : public DerivedTypeTraits<INT32>{
+  static const char* name() {
+    return "decimal32";
+  }
+  static void AppendDebugStringForValue(const void *val, string *str) {
+    DataTypeTraits<physical_type>::AppendDebugStringForValue(val, str);
+    str->append("_D32");
+  }
+};
+
+template<>
+struct DataTypeTraits<DECIMAL64> : public DerivedTypeTraits<INT64>{
+  static const char* name() {
+    return "decimal64";
+  }
+  static void AppendDebugStringForValue(const void *val, string *str) {
+    DataTypeTraits<physical_type>::AppendDebugStringForValue(val, str);
+    str->append("_D64");
+  }
+};
+
+template<>
+struct DataTypeTraits<DECIMAL128> : public DerivedTypeTraits<INT128>{
+  static const char* name() {
+    return "decimal128";
+  }
+  static void AppendDebugStringForValue(const void *val, string *str) {
+    DataTypeTraits<physical_type>::AppendDebugStringForValue(val, str);
+    str->append("_D128");
+  }
+};
+
 // Instantiate this template to get static access to the type traits.
 template<DataType datatype>
 struct TypeTraits : public DataTypeTraits<datatype> {
@@ -556,6 +622,7 @@ class Variant {
       case UINT16:
         numeric_.u16 = *static_cast<const uint16_t *>(value);
         break;
+      case DECIMAL32:
       case INT32:
         numeric_.i32 = *static_cast<const int32_t *>(value);
         break;
@@ -563,9 +630,14 @@ class Variant {
         numeric_.u32 = *static_cast<const uint32_t *>(value);
         break;
       case UNIXTIME_MICROS:
+      case DECIMAL64:
       case INT64:
         numeric_.i64 = *static_cast<const int64_t *>(value);
         break;
+      case DECIMAL128:
+      case INT128:
+        numeric_.i128 = *static_cast<const int128_t *>(value);
+        break;
       case UINT64:
         numeric_.u64 = *static_cast<const uint64_t *>(value);
         break;
@@ -630,9 +702,13 @@ class Variant {
       case INT16:        return &(numeric_.i16);
       case UINT16:       return &(numeric_.u16);
       case INT32:        return &(numeric_.i32);
+      case DECIMAL32:    return &(numeric_.i32);
       case UINT32:       return &(numeric_.u32);
       case INT64:        return &(numeric_.i64);
       case UNIXTIME_MICROS:    return &(numeric_.i64);
+      case DECIMAL64:    return &(numeric_.i64);
+      case INT128:       return &(numeric_.i128);
+      case DECIMAL128:   return &(numeric_.i128);
       case UINT64:       return &(numeric_.u64);
       case FLOAT:        return (&numeric_.float_val);
       case DOUBLE:       return (&numeric_.double_val);
@@ -673,6 +749,7 @@ class Variant {
     uint32_t u32;
     int64_t  i64;
     uint64_t u64;
+    int128_t i128;
     float    float_val;
     double   double_val;
   };
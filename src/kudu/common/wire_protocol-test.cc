@@ -24,6 +24,10 @@
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
@@ -227,6 +231,77 @@ TEST_F(WireProtocolTest, TestColumnarRowBlockToPB) {
   }
 }
 
+// Serialize a block with columns of every cell size, both nullable and not,
+// only some of whose rows are selected, through a projection which reorders
+// and drops columns, and ensure that the selected rows round-trip.
+TEST_F(WireProtocolTest, TestRowBlockToPBWithSelectionAndProjection) {
+  Schema schema({ ColumnSchema("key", INT32),
+                  ColumnSchema("i8", INT8, true),
+                  ColumnSchema("i16", INT16),
+                  ColumnSchema("i64", INT64, true),
+                  ColumnSchema("str", STRING, true),
+                  ColumnSchema("bin", BINARY),
+                  ColumnSchema("dropped", DOUBLE) }, 1);
+  Schema projection({ ColumnSchema("key", INT32),
+                      ColumnSchema("str", STRING, true),
+                      ColumnSchema("i64", INT64, true),
+                      ColumnSchema("bin", BINARY),
+                      ColumnSchema("i8", INT8, true),
+                      ColumnSchema("i16", INT16) }, 1);
+  const int kNumRows = 100;
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(schema, kNumRows, &arena);
+  block.selection_vector()->SetAllTrue();
+  for (int i = 0; i < kNumRows; i++) {
+    RowBlockRow row = block.row(i);
+    *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+    *reinterpret_cast<int8_t*>(row.mutable_cell_ptr(1)) = i;
+    row.cell(1).set_null(i % 3 == 0);
+    *reinterpret_cast<int16_t*>(row.mutable_cell_ptr(2)) = -i;
+    *reinterpret_cast<int64_t*>(row.mutable_cell_ptr(3)) = i * 1000000000L;
+    row.cell(3).set_null(i % 5 == 0);
+    Slice str;
+    CHECK(arena.RelocateSlice(strings::Substitute("str $0", i), &str));
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(4)) = str;
+    row.cell(4).set_null(i % 7 == 0);
+    *reinterpret_cast<Slice*>(row.mutable_cell_ptr(5)) = i % 2 ? Slice("bin") : Slice("");
+    *reinterpret_cast<double*>(row.mutable_cell_ptr(6)) = i;
+    if (i % 4 == 1 || (i >= 40 && i < 60)) {
+      block.selection_vector()->SetRowUnselected(i);
+    }
+  }
+
+  RowwiseRowBlockPB pb;
+  faststring direct, indirect;
+  SerializeRowBlock(block, &pb, &projection, &direct, &indirect);
+  ASSERT_EQ(block.selection_vector()->CountSelected(), pb.num_rows());
+
+  vector<const uint8_t*> row_ptrs;
+  Slice direct_sidecar = direct;
+  ASSERT_OK(ExtractRowsFromRowBlockPB(projection, pb, indirect, &direct_sidecar, &row_ptrs));
+  ASSERT_EQ(pb.num_rows(), row_ptrs.size());
+  int row_idx = 0;
+  for (int i = 0; i < kNumRows; i++) {
+    if (!block.selection_vector()->IsRowSelected(i)) {
+      continue;
+    }
+    RowBlockRow row = block.row(i);
+    ConstContiguousRow row_roundtripped(&projection, row_ptrs[row_idx++]);
+    vector<string> expected;
+    for (int j = 0; j < projection.num_columns(); j++) {
+      int col_idx = schema.find_column(projection.column(j).name());
+      expected.push_back(row.is_null(col_idx) ? "NULL" :
+                         schema.column(col_idx).Stringify(row.cell_ptr(col_idx)));
+    }
+    vector<string> actual;
+    for (int j = 0; j < projection.num_columns(); j++) {
+      actual.push_back(row_roundtripped.is_null(j) ? "NULL" :
+                       projection.column(j).Stringify(row_roundtripped.cell_ptr(j)));
+    }
+    ASSERT_EQ(expected, actual);
+  }
+}
+
 #ifdef NDEBUG
 TEST_F(WireProtocolTest, TestColumnarRowBlockToPBBenchmark) {
   Arena arena(1024, 1024 * 1024);
@@ -246,6 +321,64 @@ TEST_F(WireProtocolTest, TestColumnarRowBlockToPBBenchmark) {
 }
 #endif
 
+// Serialize some blocks in the columnar layout and check the per-column
+// buffers, including a projection which reorders and drops columns.
+TEST_F(WireProtocolTest, TestColumnarSerializedBatch) {
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(schema_, 10, &arena);
+  FillRowBlockWithTestRows(&block);
+  // Make every third cell of 'col3' NULL, and unselect the odd rows, so that
+  // each block contributes 5 rows and the non-null bitmap spans bytes.
+  for (int i = 0; i < block.nrows(); i++) {
+    if (i % 3 == 0) {
+      block.row(i).cell(2).set_null(true);
+    }
+    if (i % 2 == 1) {
+      block.selection_vector()->SetRowUnselected(i);
+    }
+  }
+
+  Schema projection({ ColumnSchema("col3", UINT32, true /* nullable */),
+                      ColumnSchema("col1", STRING) }, 0);
+  ColumnarSerializedBatch batch(&projection);
+  batch.AddRowBlock(block);
+  batch.AddRowBlock(block);
+  ASSERT_EQ(10, batch.num_rows());
+  const vector<ColumnarSerializedBatch::Column>& cols = batch.columns();
+  ASSERT_EQ(2, cols.size());
+
+  // 'col3': fixed-size cells with a non-null bitmap.
+  ASSERT_EQ(10 * sizeof(uint32_t), cols[0].data->size());
+  ASSERT_FALSE(cols[0].varlen_data);
+  ASSERT_TRUE(cols[0].non_null_bitmap);
+  ASSERT_EQ(BitmapSize(10), cols[0].non_null_bitmap->size());
+  const uint32_t* vals = reinterpret_cast<const uint32_t*>(cols[0].data->data());
+  for (int i = 0; i < 10; i++) {
+    int src_row = (i % 5) * 2;
+    SCOPED_TRACE(i);
+    bool non_null = src_row % 3 != 0;
+    ASSERT_EQ(non_null, BitmapTest(cols[0].non_null_bitmap->data(), i));
+    if (non_null) {
+      ASSERT_EQ(static_cast<uint32_t>(src_row), vals[i]);
+    }
+  }
+
+  // 'col1': offsets into the variable-length data, and no bitmap.
+  ASSERT_EQ(11 * sizeof(uint32_t), cols[1].data->size());
+  ASSERT_TRUE(cols[1].varlen_data);
+  ASSERT_FALSE(cols[1].non_null_bitmap);
+  const uint32_t* offsets = reinterpret_cast<const uint32_t*>(cols[1].data->data());
+  ASSERT_EQ(0U, offsets[0]);
+  for (int i = 0; i < 10; i++) {
+    Slice cell(cols[1].varlen_data->data() + offsets[i], offsets[i + 1] - offsets[i]);
+    ASSERT_EQ("hello world col1", cell.ToString());
+  }
+  ASSERT_EQ(offsets[10], cols[1].varlen_data->size());
+  ASSERT_EQ(batch.TotalSize(),
+            cols[0].data->size() + cols[0].non_null_bitmap->size() +
+            cols[1].data->size() + cols[1].varlen_data->size());
+}
+
 // Test that trying to extract rows from an invalid block correctly returns
 // Corruption statuses.
 TEST_F(WireProtocolTest, TestInvalidRowBlock) {
@@ -394,4 +527,68 @@ TEST_F(WireProtocolTest, TestColumnPredicateInList) {
     ASSERT_TRUE(ColumnPredicateFromPB(schema, &arena, pb, &predicate).IsInvalidArgument());
   }
 }
+
+TEST_F(WireProtocolTest, TestColumnPredicateInBloomFilter) {
+  ColumnSchema col1("col1", INT32);
+  vector<ColumnSchema> cols = { col1 };
+  Schema schema(cols, 1);
+  Arena arena(1024, 1024 * 1024);
+  boost::optional<ColumnPredicate> predicate;
+
+  BloomFilterBuilder builder(BloomFilterSizing::ByCountAndFPRate(10, 0.01)
+                                 .WithLayout(BloomFilterLayout::kBlocked));
+  int five = 5;
+  int ten = 10;
+  builder.AddKey(BloomKeyProbe(ColumnPredicate::BloomFilterKey(col1, &five)));
+
+  { // col1 IN BLOOM FILTER AND col1 < 10
+    vector<Slice> filters = { builder.slice() };
+    ColumnPredicate cp = ColumnPredicate::InBloomFilter(col1, &filters, nullptr, &ten);
+    ColumnPredicatePB pb;
+    ASSERT_NO_FATAL_FAILURE(ColumnPredicateToPB(cp, &pb));
+    ASSERT_FALSE(pb.in_bloom_filter().has_lower());
+
+    ASSERT_OK(ColumnPredicateFromPB(schema, &arena, pb, &predicate));
+    ASSERT_EQ(cp, *predicate);
+    ASSERT_TRUE(predicate->EvaluateCell<INT32>(&five));
+  }
+
+  { // Filters must be a whole number of buckets.
+    ColumnPredicatePB pb;
+    pb.set_column("col1");
+    pb.mutable_in_bloom_filter()->add_bloom_filters(string(BloomFilter::kBucketBytes + 1, '\0'));
+    ASSERT_TRUE(ColumnPredicateFromPB(schema, &arena, pb, &predicate).IsInvalidArgument());
+  }
+}
+
+TEST_F(WireProtocolTest, TestCompressedSidecar) {
+  string data;
+  for (int i = 0; i < 1000; i++) {
+    data.append(std::to_string(i % 17));
+  }
+  for (CompressionType type : { LZ4, ZSTD }) {
+    SCOPED_TRACE(CompressionType_Name(type));
+    const CompressionCodec* codec;
+    ASSERT_OK(GetCompressionCodec(type, &codec));
+
+    faststring compressed;
+    ASSERT_OK(CompressSidecar(*codec, Slice(data), &compressed));
+    ASSERT_LT(compressed.size(), data.size());
+    faststring uncompressed;
+    ASSERT_OK(UncompressSidecar(*codec, Slice(compressed), &uncompressed));
+    ASSERT_EQ(data, uncompressed.ToString());
+
+    // An empty sidecar round-trips too.
+    ASSERT_OK(CompressSidecar(*codec, Slice(), &compressed));
+    ASSERT_OK(UncompressSidecar(*codec, Slice(compressed), &uncompressed));
+    ASSERT_EQ(0, uncompressed.size());
+
+    // Truncated sidecars are rejected.
+    ASSERT_TRUE(UncompressSidecar(*codec, Slice("abc"), &uncompressed).IsCorruption());
+    ASSERT_OK(CompressSidecar(*codec, Slice(data), &compressed));
+    Status s = UncompressSidecar(*codec, Slice(compressed.data(), compressed.size() / 2),
+                                 &uncompressed);
+    ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  }
+}
 } // namespace kudu
@@ -17,16 +17,23 @@
 
 #include "kudu/common/wire_protocol.h"
 
+#include <cstring>
+#include <limits>
 #include <string>
 #include <vector>
 
 #include "kudu/common/column_predicate.h"
+#include "kudu/common/decimal_util.h"
 #include "kudu/common/row.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/gutil/port.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/fastmem.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/bloom_filter.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/coding-inl.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/net/net_util.h"
@@ -197,6 +204,13 @@ void ColumnSchemaToPB(const ColumnSchema& col_schema, ColumnSchemaPB *pb, int fl
     pb->set_encoding(col_schema.attributes().encoding);
     pb->set_compression(col_schema.attributes().compression);
     pb->set_cfile_block_size(col_schema.attributes().cfile_block_size);
+    pb->set_bloom_filter(col_schema.attributes().bloom_filter);
+    pb->set_secondary_index(col_schema.attributes().secondary_index);
+    pb->set_ttl_seconds(col_schema.attributes().ttl_seconds);
+  }
+  if (IsDecimalType(col_schema.type_info()->type())) {
+    pb->mutable_type_attributes()->set_precision(col_schema.type_attributes().precision);
+    pb->mutable_type_attributes()->set_scale(col_schema.type_attributes().scale);
   }
   if (col_schema.has_read_default()) {
     if (col_schema.type_info()->physical_type() == BINARY) {
@@ -251,9 +265,49 @@ ColumnSchema ColumnSchemaFromPB(const ColumnSchemaPB& pb) {
   if (pb.has_cfile_block_size()) {
     attributes.cfile_block_size = pb.cfile_block_size();
   }
+  if (pb.has_bloom_filter()) {
+    attributes.bloom_filter = pb.bloom_filter();
+  }
+  if (pb.has_secondary_index()) {
+    attributes.secondary_index = pb.secondary_index();
+  }
+  if (pb.has_ttl_seconds()) {
+    attributes.ttl_seconds = pb.ttl_seconds();
+  }
+  ColumnTypeAttributes type_attributes;
+  if (pb.has_type_attributes()) {
+    type_attributes.precision = pb.type_attributes().precision();
+    type_attributes.scale = pb.type_attributes().scale();
+  }
   return ColumnSchema(pb.name(), pb.type(), pb.is_nullable(),
                       read_default_ptr, write_default_ptr,
-                      attributes);
+                      attributes, type_attributes);
+}
+
+Status ValidateColumnTypeAttributes(const ColumnSchemaPB& pb) {
+  if (!IsDecimalType(pb.type())) {
+    return Status::OK();
+  }
+  int32_t precision = pb.type_attributes().precision();
+  int32_t scale = pb.type_attributes().scale();
+  int32_t max_precision = kMaxDecimal128Precision;
+  if (pb.type() == DECIMAL32) {
+    max_precision = kMaxDecimal32Precision;
+  } else if (pb.type() == DECIMAL64) {
+    max_precision = kMaxDecimal64Precision;
+  }
+  if (precision < kMinDecimalPrecision || precision > max_precision) {
+    return Status::InvalidArgument(
+        strings::Substitute("invalid precision $0 of $1 column $2: must be between $3 and $4",
+                            precision, DataType_Name(pb.type()), pb.name(),
+                            kMinDecimalPrecision, max_precision));
+  }
+  if (scale < 0 || scale > precision) {
+    return Status::InvalidArgument(
+        strings::Substitute("invalid scale $0 of column $1: must be between 0 and the "
+                            "precision $2", scale, pb.name(), precision));
+  }
+  return Status::OK();
 }
 
 Status ColumnPBsToSchema(const RepeatedPtrField<ColumnSchemaPB>& column_pbs,
@@ -265,6 +319,7 @@ Status ColumnPBsToSchema(const RepeatedPtrField<ColumnSchemaPB>& column_pbs,
   int num_key_columns = 0;
   bool is_handling_key = true;
   for (const ColumnSchemaPB& pb : column_pbs) {
+    RETURN_NOT_OK(ValidateColumnTypeAttributes(pb));
     columns.push_back(ColumnSchemaFromPB(pb));
     if (pb.is_key()) {
       if (!is_handling_key) {
@@ -396,6 +451,24 @@ void ColumnPredicateToPB(const ColumnPredicate& predicate,
       }
       return;
     };
+    case PredicateType::InBloomFilter: {
+      auto* bloom_pred = pb->mutable_in_bloom_filter();
+      for (const Slice& bloom_filter : predicate.raw_bloom_filters()) {
+        bloom_pred->add_bloom_filters()->assign(
+            reinterpret_cast<const char*>(bloom_filter.data()), bloom_filter.size());
+      }
+      if (predicate.raw_lower() != nullptr) {
+        CopyPredicateBoundToPB(predicate.column(),
+                               predicate.raw_lower(),
+                               bloom_pred->mutable_lower());
+      }
+      if (predicate.raw_upper() != nullptr) {
+        CopyPredicateBoundToPB(predicate.column(),
+                               predicate.raw_upper(),
+                               bloom_pred->mutable_upper());
+      }
+      return;
+    };
     case PredicateType::None: LOG(FATAL) << "None predicate may not be converted to protobuf";
   }
   LOG(FATAL) << "unknown predicate type";
@@ -457,6 +530,31 @@ Status ColumnPredicateFromPB(const Schema& schema,
       *predicate = ColumnPredicate::InList(col, &values);
       break;
     };
+    case ColumnPredicatePB::kInBloomFilter: {
+      const auto& bloom_pred = pb.in_bloom_filter();
+      vector<Slice> bloom_filters;
+      for (const string& pb_filter : bloom_pred.bloom_filters()) {
+        if (pb_filter.empty() || pb_filter.size() % BloomFilter::kBucketBytes != 0) {
+          return Status::InvalidArgument(
+              strings::Substitute("Invalid bloom filter predicate on column $0: "
+                                  "filter size $1 is not a positive multiple of $2",
+                                  col.name(), pb_filter.size(), BloomFilter::kBucketBytes));
+        }
+        uint8_t* data_copy = static_cast<uint8_t*>(arena->AllocateBytes(pb_filter.size()));
+        memcpy(data_copy, pb_filter.data(), pb_filter.size());
+        bloom_filters.emplace_back(data_copy, pb_filter.size());
+      }
+      const void* lower = nullptr;
+      const void* upper = nullptr;
+      if (bloom_pred.has_lower()) {
+        RETURN_NOT_OK(CopyPredicateBoundFromPB(col, bloom_pred.lower(), arena, &lower));
+      }
+      if (bloom_pred.has_upper()) {
+        RETURN_NOT_OK(CopyPredicateBoundFromPB(col, bloom_pred.upper(), arena, &upper));
+      }
+      *predicate = ColumnPredicate::InBloomFilter(col, &bloom_filters, lower, upper);
+      break;
+    };
     case ColumnPredicatePB::kIsNotNull: {
       *predicate = ColumnPredicate::IsNotNull(col);
       break;
@@ -600,69 +698,128 @@ void AppendRowToString<RowBlockRow>(const RowBlockRow& row, string* buf) {
   CHECK_OK(CopyRow(row, &copied_row, reinterpret_cast<Arena*>(NULL)));
 }
 
-// Copy a column worth of data from the given RowBlock into the output
-// protobuf.
+// Copy the cells of the selected rows of a fixed-width column into the
+// output protobuf. 'sel_rows' holds the indexes of the 'num_sel_rows'
+// selected rows of 'cblock', in order. They are copied to column
+// 'dst_col_idx' of the rows at 'dst_base', laid out according to
+// 'dst_schema'.
 //
 // IS_NULLABLE: true if the column is nullable
-// IS_VARLEN: true if the column is of variable length
+// CELL_SIZE: the size of the column's cells, or 0 if it isn't one of the
+//            common sizes and is only known at runtime
 //
 // These are template parameters rather than normal function arguments
-// so that there are fewer branches inside the loop.
-//
-// NOTE: 'dst_schema' must either be NULL or a subset of the specified's
-// RowBlock's schema. If not NULL, then column at 'col_idx' in 'block' will
-// be copied to column 'dst_col_idx' in the output protobuf; otherwise,
-// dst_col_idx must be equal to col_idx.
-template<bool IS_NULLABLE, bool IS_VARLEN>
-static void CopyColumn(const RowBlock& block, int col_idx,
-                       int dst_col_idx, uint8_t* dst_base,
-                       faststring* indirect_data, const Schema* dst_schema) {
-  DCHECK(dst_schema);
-  ColumnBlock cblock = block.column_block(col_idx);
-  size_t row_stride = ContiguousRowHelper::row_size(*dst_schema);
-  uint8_t* dst = dst_base + dst_schema->column_offset(dst_col_idx);
-  size_t offset_to_null_bitmap = dst_schema->byte_size() - dst_schema->column_offset(dst_col_idx);
-
-  size_t cell_size = cblock.stride();
+// so that there are fewer branches inside the loop, and so that the copy
+// of a cell compiles down to a single load and store.
+template<bool IS_NULLABLE, size_t CELL_SIZE>
+static void CopyFixedWidthColumn(const ColumnBlock& cblock,
+                                 const uint32_t* sel_rows, int num_sel_rows,
+                                 int dst_col_idx, uint8_t* dst_base,
+                                 const Schema& dst_schema) {
+  const size_t cell_size = CELL_SIZE != 0 ? CELL_SIZE : cblock.stride();
+  size_t row_stride = ContiguousRowHelper::row_size(dst_schema);
+  uint8_t* dst = dst_base + dst_schema.column_offset(dst_col_idx);
+  size_t offset_to_null_bitmap = dst_schema.byte_size() - dst_schema.column_offset(dst_col_idx);
   const uint8_t* src = cblock.cell_ptr(0);
 
-  BitmapIterator selected_row_iter(block.selection_vector()->bitmap(),
-                                   block.nrows());
-  int run_size;
-  bool selected;
-  int row_idx = 0;
-  while ((run_size = selected_row_iter.Next(&selected))) {
-    if (!selected) {
-      src += run_size * cell_size;
-      row_idx += run_size;
-      continue;
+  for (int i = 0; i < num_sel_rows; i++) {
+    size_t row_idx = sel_rows[i];
+    if (IS_NULLABLE && cblock.is_null(row_idx)) {
+      memset(dst, 0, cell_size);
+      BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, true);
+    } else {
+      memcpy(dst, src + row_idx * cell_size, cell_size);
+      if (IS_NULLABLE) {
+        BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, false);
+      }
     }
-    for (int i = 0; i < run_size; i++) {
-      if (IS_NULLABLE && cblock.is_null(row_idx)) {
-        memset(dst, 0, cell_size);
-        BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, true);
-      } else if (IS_VARLEN) {
-        const Slice *slice = reinterpret_cast<const Slice *>(src);
-        size_t offset_in_indirect = indirect_data->size();
-        indirect_data->append(reinterpret_cast<const char*>(slice->data()),
-                              slice->size());
-
-        Slice *dst_slice = reinterpret_cast<Slice *>(dst);
-        *dst_slice = Slice(reinterpret_cast<const uint8_t*>(offset_in_indirect),
-                           slice->size());
-        if (IS_NULLABLE) {
-          BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, false);
-        }
-      } else { // non-string, non-null
-        strings::memcpy_inlined(dst, src, cell_size);
-        if (IS_NULLABLE) {
-          BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, false);
-        }
+    dst += row_stride;
+  }
+}
+
+// Same as CopyFixedWidthColumn(), but for a column of variable length. The
+// indirect data of all the copied cells is appended to 'indirect_data' at
+// once, and the cells are set to the offsets of their data in it.
+template<bool IS_NULLABLE>
+static void CopyVarlenColumn(const ColumnBlock& cblock,
+                             const uint32_t* sel_rows, int num_sel_rows,
+                             int dst_col_idx, uint8_t* dst_base,
+                             const Schema& dst_schema, faststring* indirect_data) {
+  size_t row_stride = ContiguousRowHelper::row_size(dst_schema);
+  uint8_t* dst = dst_base + dst_schema.column_offset(dst_col_idx);
+  size_t offset_to_null_bitmap = dst_schema.byte_size() - dst_schema.column_offset(dst_col_idx);
+  const Slice* src = reinterpret_cast<const Slice*>(cblock.cell_ptr(0));
+
+  size_t indirect_size = 0;
+  for (int i = 0; i < num_sel_rows; i++) {
+    size_t row_idx = sel_rows[i];
+    if (!IS_NULLABLE || !cblock.is_null(row_idx)) {
+      indirect_size += src[row_idx].size();
+    }
+  }
+  size_t offset_in_indirect = indirect_data->size();
+  indirect_data->resize(offset_in_indirect + indirect_size);
+  uint8_t* indirect = indirect_data->data();
+
+  for (int i = 0; i < num_sel_rows; i++) {
+    size_t row_idx = sel_rows[i];
+    if (IS_NULLABLE && cblock.is_null(row_idx)) {
+      memset(dst, 0, sizeof(Slice));
+      BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, true);
+    } else {
+      const Slice& slice = src[row_idx];
+      strings::memcpy_inlined(indirect + offset_in_indirect, slice.data(), slice.size());
+      Slice *dst_slice = reinterpret_cast<Slice *>(dst);
+      *dst_slice = Slice(reinterpret_cast<const uint8_t*>(offset_in_indirect),
+                         slice.size());
+      offset_in_indirect += slice.size();
+      if (IS_NULLABLE) {
+        BitmapChange(dst + offset_to_null_bitmap, dst_col_idx, false);
       }
-      dst += row_stride;
-      src += cell_size;
-      row_idx++;
     }
+    dst += row_stride;
+  }
+}
+
+// Copy a column worth of data from the given RowBlock into the output
+// protobuf, dispatching to the copy function specialized for the column's
+// nullability, physical type and cell size.
+//
+// NOTE: 'dst_schema' must be a subset of the specified RowBlock's schema.
+// The column at 'col_idx' in 'block' will be copied to column 'dst_col_idx'
+// in the output protobuf.
+template<bool IS_NULLABLE>
+static void CopyColumn(const RowBlock& block, int col_idx,
+                       const uint32_t* sel_rows, int num_sel_rows,
+                       int dst_col_idx, uint8_t* dst_base,
+                       faststring* indirect_data, const Schema& dst_schema) {
+  ColumnBlock cblock = block.column_block(col_idx);
+  if (cblock.type_info()->physical_type() == BINARY) {
+    CopyVarlenColumn<IS_NULLABLE>(cblock, sel_rows, num_sel_rows, dst_col_idx, dst_base,
+                                  dst_schema, indirect_data);
+    return;
+  }
+  switch (cblock.stride()) {
+    case 1:
+      CopyFixedWidthColumn<IS_NULLABLE, 1>(cblock, sel_rows, num_sel_rows, dst_col_idx,
+                                           dst_base, dst_schema);
+      break;
+    case 2:
+      CopyFixedWidthColumn<IS_NULLABLE, 2>(cblock, sel_rows, num_sel_rows, dst_col_idx,
+                                           dst_base, dst_schema);
+      break;
+    case 4:
+      CopyFixedWidthColumn<IS_NULLABLE, 4>(cblock, sel_rows, num_sel_rows, dst_col_idx,
+                                           dst_base, dst_schema);
+      break;
+    case 8:
+      CopyFixedWidthColumn<IS_NULLABLE, 8>(cblock, sel_rows, num_sel_rows, dst_col_idx,
+                                           dst_base, dst_schema);
+      break;
+    default:
+      CopyFixedWidthColumn<IS_NULLABLE, 0>(cblock, sel_rows, num_sel_rows, dst_col_idx,
+                                           dst_base, dst_schema);
+      break;
   }
 }
 
@@ -685,6 +842,28 @@ void SerializeRowBlock(const RowBlock& block, RowwiseRowBlockPB* rowblock_pb,
   data_buf->resize(old_size + row_stride * num_rows);
   uint8_t* base = reinterpret_cast<uint8_t*>(&(*data_buf)[old_size]);
 
+  // Collect the indexes of the selected rows once, rather than walking the
+  // selection vector again for each column.
+  vector<uint32_t> sel_rows;
+  if (projection_schema->num_columns() > 0) {
+    sel_rows.resize(num_rows);
+    BitmapIterator selected_row_iter(block.selection_vector()->bitmap(),
+                                     block.nrows());
+    int run_size;
+    bool selected;
+    uint32_t row_idx = 0;
+    uint32_t* sel_row = sel_rows.data();
+    while ((run_size = selected_row_iter.Next(&selected))) {
+      if (selected) {
+        for (int i = 0; i < run_size; i++) {
+          *sel_row++ = row_idx + i;
+        }
+      }
+      row_idx += run_size;
+    }
+    DCHECK_EQ(sel_row, sel_rows.data() + num_rows);
+  }
+
   size_t proj_schema_idx = 0;
   for (int t_schema_idx = 0; t_schema_idx < tablet_schema.num_columns(); t_schema_idx++) {
     const ColumnSchema& col = tablet_schema.column(t_schema_idx);
@@ -695,27 +874,182 @@ void SerializeRowBlock(const RowBlock& block, RowwiseRowBlockPB* rowblock_pb,
 
     // Generating different functions for each of these cases makes them much less
     // branch-heavy -- we do the branch once outside the loop, and then have a
-    // compiled version for each combination below.
-    // TODO: Using LLVM to build a specialized CopyColumn on the fly should have
-    // even bigger gains, since we could inline the constant cell sizes and column
-    // offsets.
-    if (col.is_nullable() && col.type_info()->physical_type() == BINARY) {
-      CopyColumn<true, true>(block, t_schema_idx, proj_schema_idx, base, indirect_data,
-                             projection_schema);
-    } else if (col.is_nullable() && col.type_info()->physical_type() != BINARY) {
-      CopyColumn<true, false>(block, t_schema_idx, proj_schema_idx, base, indirect_data,
-                              projection_schema);
-    } else if (!col.is_nullable() && col.type_info()->physical_type() == BINARY) {
-      CopyColumn<false, true>(block, t_schema_idx, proj_schema_idx, base, indirect_data,
-                              projection_schema);
-    } else if (!col.is_nullable() && col.type_info()->physical_type() != BINARY) {
-      CopyColumn<false, false>(block, t_schema_idx, proj_schema_idx, base, indirect_data,
-                               projection_schema);
+    // compiled version for each combination of nullability, physical type and
+    // cell size.
+    if (col.is_nullable()) {
+      CopyColumn<true>(block, t_schema_idx, sel_rows.data(), num_rows, proj_schema_idx,
+                       base, indirect_data, *projection_schema);
     } else {
-      LOG(FATAL) << "cannot reach here";
+      CopyColumn<false>(block, t_schema_idx, sel_rows.data(), num_rows, proj_schema_idx,
+                        base, indirect_data, *projection_schema);
     }
   }
   rowblock_pb->set_num_rows(rowblock_pb->num_rows() + num_rows);
 }
 
+ColumnarSerializedBatch::ColumnarSerializedBatch(const Schema* projection_schema)
+    : projection_schema_(DCHECK_NOTNULL(projection_schema)),
+      num_rows_(0) {
+  columns_.resize(projection_schema_->num_columns());
+  for (int i = 0; i < projection_schema_->num_columns(); i++) {
+    const ColumnSchema& col = projection_schema_->column(i);
+    Column* dst = &columns_[i];
+    dst->data.reset(new faststring());
+    if (col.type_info()->physical_type() == BINARY) {
+      dst->varlen_data.reset(new faststring());
+      // The offsets are stored as ends, so start with the offset of row 0.
+      uint32_t first_offset = 0;
+      dst->data->append(&first_offset, sizeof(first_offset));
+    }
+    if (col.is_nullable()) {
+      dst->non_null_bitmap.reset(new faststring());
+    }
+  }
+}
+
+ColumnarSerializedBatch::~ColumnarSerializedBatch() {}
+
+int64_t ColumnarSerializedBatch::TotalSize() const {
+  int64_t size = 0;
+  for (const Column& col : columns_) {
+    size += col.data->size();
+    if (col.varlen_data) {
+      size += col.varlen_data->size();
+    }
+    if (col.non_null_bitmap) {
+      size += col.non_null_bitmap->size();
+    }
+  }
+  return size;
+}
+
+// The largest uncompressed sidecar accepted, which bounds the memory allocated
+// for a sidecar whose uncompressed size is corrupt.
+static const uint64_t kMaxUncompressedSidecarSize = std::numeric_limits<int32_t>::max();
+
+Status CompressSidecar(const CompressionCodec& codec, const Slice& data,
+                       faststring* compressed) {
+  compressed->resize(sizeof(uint64_t) + codec.MaxCompressedLength(data.size()));
+  InlineEncodeFixed64(compressed->data(), data.size());
+  size_t compressed_size;
+  RETURN_NOT_OK(codec.Compress(data, compressed->data() + sizeof(uint64_t), &compressed_size));
+  compressed->resize(sizeof(uint64_t) + compressed_size);
+  return Status::OK();
+}
+
+Status UncompressSidecar(const CompressionCodec& codec, const Slice& compressed,
+                         faststring* data) {
+  if (PREDICT_FALSE(compressed.size() < sizeof(uint64_t))) {
+    return Status::Corruption("compressed sidecar too short");
+  }
+  uint64_t size = DecodeFixed64(compressed.data());
+  if (PREDICT_FALSE(size > kMaxUncompressedSidecarSize)) {
+    return Status::Corruption(strings::Substitute(
+        "compressed sidecar has invalid uncompressed size $0", size));
+  }
+  data->resize(size);
+  Status s = codec.Uncompress(Slice(compressed.data() + sizeof(uint64_t),
+                                    compressed.size() - sizeof(uint64_t)),
+                              data->data(), size);
+  if (PREDICT_FALSE(!s.ok())) {
+    return Status::Corruption("unable to uncompress sidecar", s.ToString());
+  }
+  return Status::OK();
+}
+
+// Appends the 'num_selected' selected cells of column 'col_idx' in 'block'
+// to 'dst', whose first 'dst_row_idx' rows are already filled in.
+//
+// As with CopyColumn(), IS_NULLABLE and IS_VARLEN are template parameters so
+// that the branches on them are taken outside of the loop.
+template<bool IS_NULLABLE, bool IS_VARLEN>
+static void CopyColumnToColumnar(const RowBlock& block, int col_idx,
+                                 int num_selected, int64_t dst_row_idx,
+                                 ColumnarSerializedBatch::Column* dst) {
+  ColumnBlock cblock = block.column_block(col_idx);
+  size_t cell_size = cblock.stride();
+  const uint8_t* src = cblock.cell_ptr(0);
+
+  size_t old_size = dst->data->size();
+  dst->data->resize(old_size + num_selected * (IS_VARLEN ? sizeof(uint32_t) : cell_size));
+  uint8_t* dst_cell = dst->data->data() + old_size;
+
+  uint8_t* non_null_bitmap = nullptr;
+  if (IS_NULLABLE) {
+    size_t old_bitmap_size = dst->non_null_bitmap->size();
+    size_t new_bitmap_size = BitmapSize(dst_row_idx + num_selected);
+    dst->non_null_bitmap->resize(new_bitmap_size);
+    non_null_bitmap = dst->non_null_bitmap->data();
+    memset(non_null_bitmap + old_bitmap_size, 0, new_bitmap_size - old_bitmap_size);
+  }
+
+  BitmapIterator selected_row_iter(block.selection_vector()->bitmap(),
+                                   block.nrows());
+  int run_size;
+  bool selected;
+  int row_idx = 0;
+  while ((run_size = selected_row_iter.Next(&selected))) {
+    if (!selected) {
+      src += run_size * cell_size;
+      row_idx += run_size;
+      continue;
+    }
+    for (int i = 0; i < run_size; i++) {
+      bool is_null = IS_NULLABLE && cblock.is_null(row_idx);
+      if (IS_NULLABLE) {
+        BitmapChange(non_null_bitmap, dst_row_idx, !is_null);
+      }
+      if (IS_VARLEN) {
+        if (!is_null) {
+          const Slice* slice = reinterpret_cast<const Slice*>(src);
+          dst->varlen_data->append(slice->data(), slice->size());
+        }
+        DCHECK_LE(dst->varlen_data->size(), std::numeric_limits<uint32_t>::max());
+        uint32_t end_offset = dst->varlen_data->size();
+        memcpy(dst_cell, &end_offset, sizeof(end_offset));
+        dst_cell += sizeof(end_offset);
+      } else {
+        if (is_null) {
+          memset(dst_cell, 0, cell_size);
+        } else {
+          strings::memcpy_inlined(dst_cell, src, cell_size);
+        }
+        dst_cell += cell_size;
+      }
+      src += cell_size;
+      row_idx++;
+      dst_row_idx++;
+    }
+  }
+}
+
+ATTRIBUTE_NO_ADDRESS_SAFETY_ANALYSIS
+void ColumnarSerializedBatch::AddRowBlock(const RowBlock& block) {
+  const Schema& block_schema = block.schema();
+  int num_selected = block.selection_vector()->CountSelected();
+  if (num_selected == 0) {
+    return;
+  }
+
+  for (int proj_idx = 0; proj_idx < projection_schema_->num_columns(); proj_idx++) {
+    const ColumnSchema& col = projection_schema_->column(proj_idx);
+    int block_idx = block_schema.find_column(col.name());
+    DCHECK_NE(block_idx, Schema::kColumnNotFound) << col.name();
+    DCHECK_EQ(block_schema.column(block_idx).is_nullable(), col.is_nullable());
+    Column* dst = &columns_[proj_idx];
+
+    bool is_varlen = col.type_info()->physical_type() == BINARY;
+    if (col.is_nullable() && is_varlen) {
+      CopyColumnToColumnar<true, true>(block, block_idx, num_selected, num_rows_, dst);
+    } else if (col.is_nullable() && !is_varlen) {
+      CopyColumnToColumnar<true, false>(block, block_idx, num_selected, num_rows_, dst);
+    } else if (!col.is_nullable() && is_varlen) {
+      CopyColumnToColumnar<false, true>(block, block_idx, num_selected, num_rows_, dst);
+    } else {
+      CopyColumnToColumnar<false, false>(block, block_idx, num_selected, num_rows_, dst);
+    }
+  }
+  num_rows_ += num_selected;
+}
+
 } // namespace kudu
@@ -20,9 +20,11 @@
 #define KUDU_COMMON_WIRE_PROTOCOL_H
 
 #include <boost/optional.hpp>
+#include <memory>
 #include <vector>
 
 #include "kudu/common/wire_protocol.pb.h"
+#include "kudu/gutil/macros.h"
 #include "kudu/util/status.h"
 
 using boost::optional;
@@ -31,6 +33,7 @@ namespace kudu {
 
 class Arena;
 class ColumnPredicate;
+class CompressionCodec;
 class ColumnSchema;
 class ConstContiguousRow;
 class faststring;
@@ -85,6 +88,10 @@ void ColumnSchemaToPB(const ColumnSchema& schema, ColumnSchemaPB *pb, int flags
 // Return the ColumnSchema created from the specified protobuf.
 ColumnSchema ColumnSchemaFromPB(const ColumnSchemaPB& pb);
 
+// Returns InvalidArgument if the type attributes of the specified column,
+// such as the precision and the scale of a DECIMAL, don't fit its type.
+Status ValidateColumnTypeAttributes(const ColumnSchemaPB& pb);
+
 // Convert the given list of ColumnSchemaPB objects into a Schema object.
 //
 // Returns InvalidArgument if the provided columns don't make a valid Schema
@@ -128,6 +135,64 @@ void SerializeRowBlock(const RowBlock& block, RowwiseRowBlockPB* rowblock_pb,
                        const Schema* client_projection_schema,
                        faststring* data_buf, faststring* indirect_data);
 
+// Accumulates the selected rows of one or more RowBlocks in the layout of
+// ColumnarRowBlockPB: a buffer of cell data per projected column, plus a
+// buffer of variable-length data for BINARY columns and a non-null bitmap
+// for nullable columns. Each buffer is meant to be sent as its own sidecar.
+class ColumnarSerializedBatch {
+ public:
+  struct Column {
+    // The cells, or for BINARY columns, num_rows() + 1 uint32 offsets into
+    // 'varlen_data'.
+    std::unique_ptr<faststring> data;
+
+    // Only set for BINARY columns.
+    std::unique_ptr<faststring> varlen_data;
+
+    // Only set for nullable columns.
+    std::unique_ptr<faststring> non_null_bitmap;
+  };
+
+  // Prepares an empty batch with the columns of 'projection_schema', which
+  // must outlive the batch. Every column of 'projection_schema' must also be
+  // in the schema of the blocks passed to AddRowBlock().
+  explicit ColumnarSerializedBatch(const Schema* projection_schema);
+  ~ColumnarSerializedBatch();
+
+  // Appends the selected rows of 'block'. The data is copied, so 'block' may
+  // be destroyed safely after this returns.
+  void AddRowBlock(const RowBlock& block);
+
+  int64_t num_rows() const { return num_rows_; }
+
+  // Returns the total size of all the buffers.
+  int64_t TotalSize() const;
+
+  const std::vector<Column>& columns() const { return columns_; }
+  std::vector<Column>* mutable_columns() { return &columns_; }
+
+ private:
+  const Schema* const projection_schema_;
+  std::vector<Column> columns_;
+  int64_t num_rows_;
+
+  DISALLOW_COPY_AND_ASSIGN(ColumnarSerializedBatch);
+};
+
+// Compresses the scan response sidecar 'data' with 'codec' into
+// 'compressed', whose contents are replaced. A compressed sidecar is the
+// fixed64 size of the uncompressed data followed by the compressed data.
+Status CompressSidecar(const CompressionCodec& codec, const Slice& data,
+                       faststring* compressed);
+
+// Uncompresses the scan response sidecar 'compressed', produced by
+// CompressSidecar() with the same type of codec, into 'data', whose contents
+// are replaced.
+//
+// Returns a bad Status if the provided data is invalid or corrupt.
+Status UncompressSidecar(const CompressionCodec& codec, const Slice& compressed,
+                         faststring* data);
+
 // Rewrites the data pointed-to by row data slice 'row_data_slice' by replacing
 // relative indirect data pointers with absolute ones in 'indirect_data_slice'.
 // At the time of this writing, this rewriting is only done for STRING types.
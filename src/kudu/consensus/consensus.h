@@ -61,6 +61,7 @@ class ConsensusCommitContinuation;
 class ConsensusRound;
 class ReplicaTransactionFactory;
 class TimeManager;
+struct PeerReplicationStats;
 
 typedef int64_t ConsensusTerm;
 
@@ -270,6 +271,10 @@ class Consensus : public RefCountedThreadSafe<Consensus> {
 
   virtual void DumpStatusHtml(std::ostream& out) const = 0;
 
+  // Fills 'stats' with the state of the replication to each peer if this is the
+  // leader, or leaves it empty otherwise.
+  virtual void GetPeerReplicationStats(std::vector<PeerReplicationStats>* stats) const = 0;
+
   // Stops running the consensus algorithm.
   virtual void Shutdown() = 0;
 
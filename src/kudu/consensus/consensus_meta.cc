@@ -17,6 +17,12 @@
 #include "kudu/consensus/consensus_meta.h"
 
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <gflags/gflags.h>
 
 #include "kudu/consensus/log_util.h"
 #include "kudu/consensus/metadata.pb.h"
@@ -24,17 +30,131 @@
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/stopwatch.h"
 
+DEFINE_bool(cmeta_group_commit, false,
+            "Whether to group-commit the consensus metadata flushes of the tablets of "
+            "a server, so that concurrent flushes, e.g. when many tablets hold elections "
+            "at once, are written and synced together, and their directory is synced once.");
+TAG_FLAG(cmeta_group_commit, experimental);
+
 namespace kudu {
 namespace consensus {
 
+using std::pair;
 using std::string;
 using std::unique_ptr;
+using std::unordered_map;
+using std::vector;
 using strings::Substitute;
 
+namespace {
+
+// Group-commits the flushes of the consensus metadata files of a directory.
+//
+// A flushing thread queues its file and, unless a group is already being
+// written, writes the whole queue itself with WritePBContainersToPaths().
+// Threads which queue meanwhile wait for that group to complete, and then one
+// of them writes the next group.
+class FlushGroupCommitter {
+ public:
+  FlushGroupCommitter()
+      : cond_(&lock_),
+        writing_(false) {
+  }
+
+  // Returns the committer of the directory 'dir'.
+  static FlushGroupCommitter* Get(const string& dir);
+
+  // Writes 'pb' to 'path' in the next group, and returns once it is written.
+  // 'env' and 'sync' are those of the group it is written in.
+  Status Flush(Env* env, const string& path, const ConsensusMetadataPB& pb,
+               pb_util::SyncMode sync);
+
+ private:
+  struct PendingFlush {
+    PendingFlush(const string* path, const ConsensusMetadataPB* pb)
+        : path(path),
+          pb(pb),
+          done(false) {
+    }
+
+    const string* path;
+    const ConsensusMetadataPB* pb;
+    Status status;
+    bool done;
+  };
+
+  Mutex lock_;
+  ConditionVariable cond_;
+
+  // Whether a group is being written.
+  bool writing_;
+
+  // The flushes to write in the next group.
+  vector<PendingFlush*> queue_;
+
+  DISALLOW_COPY_AND_ASSIGN(FlushGroupCommitter);
+};
+
+FlushGroupCommitter* FlushGroupCommitter::Get(const string& dir) {
+  struct Committers {
+    simple_spinlock lock;
+    unordered_map<string, unique_ptr<FlushGroupCommitter>> by_dir;
+  };
+  // Never destroyed, since tablets may flush until the process exits.
+  static Committers* committers = new Committers();
+
+  std::lock_guard<simple_spinlock> l(committers->lock);
+  unique_ptr<FlushGroupCommitter>& committer = committers->by_dir[dir];
+  if (!committer) {
+    committer.reset(new FlushGroupCommitter());
+  }
+  return committer.get();
+}
+
+Status FlushGroupCommitter::Flush(Env* env, const string& path, const ConsensusMetadataPB& pb,
+                                  pb_util::SyncMode sync) {
+  PendingFlush flush(&path, &pb);
+  MutexLock l(lock_);
+  queue_.push_back(&flush);
+  while (!flush.done) {
+    if (writing_) {
+      cond_.Wait();
+      continue;
+    }
+    vector<PendingFlush*> group;
+    group.swap(queue_);
+    writing_ = true;
+    l.Unlock();
+
+    vector<pair<string, const google::protobuf::Message*>> msgs;
+    msgs.reserve(group.size());
+    for (const PendingFlush* f : group) {
+      msgs.emplace_back(*f->path, f->pb);
+    }
+    vector<Status> statuses;
+    pb_util::WritePBContainersToPaths(env, msgs, sync, &statuses);
+
+    l.Lock();
+    for (int i = 0; i < group.size(); i++) {
+      group[i]->status = statuses[i];
+      group[i]->done = true;
+    }
+    writing_ = false;
+    cond_.Broadcast();
+  }
+  return flush.status;
+}
+
+} // anonymous namespace
+
 Status ConsensusMetadata::Create(FsManager* fs_manager,
                                  const string& tablet_id,
                                  const std::string& peer_uuid,
@@ -206,16 +326,20 @@ Status ConsensusMetadata::Flush() {
   }
 
   string meta_file_path = fs_manager_->GetConsensusMetadataPath(tablet_id_);
-  RETURN_NOT_OK_PREPEND(pb_util::WritePBContainerToPath(
-      fs_manager_->env(), meta_file_path, pb_,
-      pb_util::OVERWRITE,
-      // We use FLAGS_log_force_fsync_all here because the consensus metadata is
-      // essentially an extension of the primary durability mechanism of the
-      // consensus subsystem: the WAL. Using the same flag ensures that the WAL
-      // and the consensus metadata get the same durability guarantees.
-      FLAGS_log_force_fsync_all ? pb_util::SYNC : pb_util::NO_SYNC),
-          Substitute("Unable to write consensus meta file for tablet $0 to path $1",
-                     tablet_id_, meta_file_path));
+  // We use FLAGS_log_force_fsync_all here because the consensus metadata is
+  // essentially an extension of the primary durability mechanism of the
+  // consensus subsystem: the WAL. Using the same flag ensures that the WAL
+  // and the consensus metadata get the same durability guarantees.
+  pb_util::SyncMode sync = FLAGS_log_force_fsync_all ? pb_util::SYNC : pb_util::NO_SYNC;
+  Status s;
+  if (FLAGS_cmeta_group_commit) {
+    s = FlushGroupCommitter::Get(dir)->Flush(fs_manager_->env(), meta_file_path, pb_, sync);
+  } else {
+    s = pb_util::WritePBContainerToPath(fs_manager_->env(), meta_file_path, pb_,
+                                        pb_util::OVERWRITE, sync);
+  }
+  RETURN_NOT_OK_PREPEND(s, Substitute("Unable to write consensus meta file for tablet $0 "
+                                      "to path $1", tablet_id_, meta_file_path));
   return Status::OK();
 }
 
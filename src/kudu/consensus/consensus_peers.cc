@@ -30,9 +30,12 @@
 #include "kudu/consensus/consensus_peers.h"
 #include "kudu/consensus/consensus_queue.h"
 #include "kudu/consensus/log.h"
+#include "kudu/consensus/multi_raft_batcher.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
@@ -53,6 +56,20 @@ DEFINE_int32(raft_get_node_instance_timeout_ms, 30000,
              "Timeout for retrieving node instance data over RPC.");
 TAG_FLAG(consensus_rpc_timeout_ms, hidden);
 
+DEFINE_int32(consensus_max_requests_in_flight_per_peer, 1,
+             "Maximum number of UpdateConsensus requests a leader keeps in flight to "
+             "each follower. Beyond the first, requests carry the operations following "
+             "those of the requests in flight, so that replication to distant followers "
+             "isn't limited to one batch per round trip.");
+TAG_FLAG(consensus_max_requests_in_flight_per_peer, experimental);
+
+DEFINE_bool(consensus_send_ops_in_sidecar, true,
+            "Whether to send the operations replicated to followers in an RPC sidecar, "
+            "serialized once for all the followers, rather than serializing them as "
+            "part of the request to each follower.");
+TAG_FLAG(consensus_send_ops_in_sidecar, advanced);
+TAG_FLAG(consensus_send_ops_in_sidecar, runtime);
+
 DECLARE_int32(raft_heartbeat_interval_ms);
 
 DEFINE_double(fault_crash_on_leader_request_fraction, 0.0,
@@ -78,6 +95,7 @@ namespace kudu {
 namespace consensus {
 
 using std::shared_ptr;
+using std::vector;
 using rpc::Messenger;
 using rpc::RpcController;
 using strings::Substitute;
@@ -111,6 +129,7 @@ Peer::Peer(const RaftPeerPB& peer_pb, string tablet_id, string leader_uuid,
       proxy_(std::move(proxy)),
       queue_(queue),
       failed_attempts_(0),
+      last_request_committed_index_(kMinimumOpIdIndex),
       heartbeater_(
           peer_pb.permanent_uuid(),
           MonoDelta::FromMilliseconds(FLAGS_raft_heartbeat_interval_ms),
@@ -144,10 +163,13 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // Only allow one request at a time.
-  if (request_pending_) {
+  // Allow up to FLAGS_consensus_max_requests_in_flight_per_peer update
+  // requests at a time, and nothing else if a tablet copy is in flight.
+  if (tablet_copy_pending_ ||
+      num_requests_in_flight_ >= std::max(FLAGS_consensus_max_requests_in_flight_per_peer, 1)) {
     return;
   }
+  bool pipelined = num_requests_in_flight_ > 0;
 
   // For the first request sent by the peer, we send it even if the queue is empty,
   // which it will always appear to be for the first request, since this is the
@@ -171,14 +193,14 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
     return;
   }
 
-  // The peer has no pending request nor is sending: send the request.
+  // The peer has room for another request: send it.
+  shared_ptr<UpdateRequest> req(new UpdateRequest(last_request_seq_no_ + 1));
   bool needs_tablet_copy = false;
-  int64_t commit_index_before = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
-  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &request_,
-                                    &replicate_msg_refs_, &needs_tablet_copy);
-  int64_t commit_index_after = request_.has_committed_index() ?
-      request_.committed_index() : kMinimumOpIdIndex;
+  int64_t commit_index_before = last_request_committed_index_;
+  Status s = queue_->RequestForPeer(peer_pb_.permanent_uuid(), &req->request,
+                                    &req->replicate_msg_refs, &needs_tablet_copy, pipelined);
+  int64_t commit_index_after = req->request.has_committed_index() ?
+      req->request.committed_index() : kMinimumOpIdIndex;
 
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(INFO) << "Could not obtain request from queue for peer: "
@@ -187,32 +209,39 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
   }
 
   if (PREDICT_FALSE(needs_tablet_copy)) {
+    // Wait for the requests in flight before asking for a tablet copy.
+    if (pipelined) {
+      return;
+    }
     Status s = PrepareTabletCopyRequest();
     if (!s.ok()) {
       LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to generate Tablet Copy request for peer: "
                                         << s.ToString();
     }
 
-    controller_.Reset();
-    request_pending_ = true;
+    tc_controller_.Reset();
+    tablet_copy_pending_ = true;
     l.unlock();
     // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
     // that this object outlives the RPC.
-    proxy_->StartTabletCopy(&tc_request_, &tc_response_, &controller_,
+    proxy_->StartTabletCopy(&tc_request_, &tc_response_, &tc_controller_,
                             [s_this = shared_from_this()]() {
                               s_this->ProcessTabletCopyResponse();
                             });
     return;
   }
+  last_request_committed_index_ = commit_index_after;
 
-  request_.set_tablet_id(tablet_id_);
-  request_.set_caller_uuid(leader_uuid_);
-  request_.set_dest_uuid(peer_pb_.permanent_uuid());
+  req->request.set_tablet_id(tablet_id_);
+  req->request.set_caller_uuid(leader_uuid_);
+  req->request.set_dest_uuid(peer_pb_.permanent_uuid());
 
-  bool req_has_ops = request_.ops_size() > 0 || (commit_index_after > commit_index_before);
+  bool req_has_ops = req->request.ops_size() > 0 || (commit_index_after > commit_index_before);
   // If the queue is empty, check if we were told to send a status-only
-  // message, if not just return.
-  if (PREDICT_FALSE(!req_has_ops && !even_if_queue_empty)) {
+  // message, if not just return. Requests pipelined behind others are only
+  // worth sending with new operations.
+  if (PREDICT_FALSE((!req_has_ops && !even_if_queue_empty) ||
+                    (pipelined && req->request.ops_size() == 0))) {
     return;
   }
 
@@ -226,31 +255,50 @@ void Peer::SendNextRequest(bool even_if_queue_empty) {
 
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Sending to peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(request_);
-  controller_.Reset();
-
-  request_pending_ = true;
+      << SecureShortDebugString(req->request);
+
+  last_request_seq_no_ = req->seq_no;
+  req->send_time = MonoTime::Now();
+  num_requests_in_flight_++;
+  // If the request carries operations and there's room for another one,
+  // pipeline the next operations behind it, if any.
+  bool pipeline_next = req->request.ops_size() > 0 &&
+      num_requests_in_flight_ < FLAGS_consensus_max_requests_in_flight_per_peer;
   l.unlock();
   // Capture a shared_ptr reference into the RPC callback so that we're guaranteed
   // that this object outlives the RPC.
-  proxy_->UpdateAsync(&request_, &response_, &controller_,
-                      [s_this = shared_from_this()]() {
-                        s_this->ProcessResponse();
-                      });
+  UpdateRequest* req_ptr = req.get();
+  rpc::ResponseCallback callback = [s_this = shared_from_this(), req = std::move(req)]() {
+    s_this->ProcessResponse(req);
+  };
+  if (req_ptr->request.ops_size() > 0) {
+    proxy_->UpdateWithOpsAsync(&req_ptr->request, req_ptr->replicate_msg_refs,
+                               &req_ptr->response, &req_ptr->controller, callback);
+  } else if (req_has_ops) {
+    proxy_->UpdateAsync(&req_ptr->request, &req_ptr->response, &req_ptr->controller, callback);
+  } else {
+    proxy_->HeartbeatAsync(&req_ptr->request, &req_ptr->response, &req_ptr->controller,
+                           callback);
+  }
+  if (pipeline_next) {
+    ignore_result(SignalRequest());
+  }
 }
 
-void Peer::ProcessResponse() {
+void Peer::ProcessResponse(const shared_ptr<UpdateRequest>& req) {
   // Note: This method runs on the reactor thread.
   std::unique_lock<simple_spinlock> lock(peer_lock_);
   if (closed_) {
     return;
   }
-  CHECK(request_pending_);
+  CHECK_GT(num_requests_in_flight_, 0);
 
   MAYBE_FAULT(FLAGS_fault_crash_after_leader_request_fraction);
 
-  if (!controller_.status().ok()) {
-    if (controller_.status().IsRemoteError()) {
+  const rpc::RpcController& controller = req->controller;
+  const ConsensusResponsePB& response = req->response;
+  if (!controller.status().ok()) {
+    if (controller.status().IsRemoteError()) {
       // Most controller errors are caused by network issues or corner cases
       // like shutdown and failure to serialize a protobuf. Therefore, we
       // generally consider these errors to indicate an unreachable peer.
@@ -259,20 +307,20 @@ void Peer::ProcessResponse() {
       // the queue know that the remote is responsive.
       queue_->NotifyPeerIsResponsiveDespiteError(peer_pb_.permanent_uuid());
     }
-    ProcessResponseError(controller_.status());
+    ProcessResponseError(*req, controller.status());
     return;
   }
 
   // Pass through errors we can respond to, like not found, since in that case
   // we will need to start a Tablet Copy. TODO: Handle DELETED response once implemented.
-  if ((response_.has_error() &&
-      response_.error().code() != TabletServerErrorPB::TABLET_NOT_FOUND) ||
-      (response_.status().has_error() &&
-          response_.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE)) {
+  if ((response.has_error() &&
+      response.error().code() != TabletServerErrorPB::TABLET_NOT_FOUND) ||
+      (response.status().has_error() &&
+          response.status().error().code() == consensus::ConsensusErrorPB::CANNOT_PREPARE)) {
     // Again, let the queue know that the remote is still responsive, since we
     // will not be sending this error response through to the queue.
     queue_->NotifyPeerIsResponsiveDespiteError(peer_pb_.permanent_uuid());
-    ProcessResponseError(StatusFromPB(response_.error().status()));
+    ProcessResponseError(*req, StatusFromPB(response.error().status()));
     return;
   }
 
@@ -280,29 +328,37 @@ void Peer::ProcessResponse() {
   // the WAL) and SendNextRequest() may do the same thing. So we run the rest
   // of the response handling logic on our thread pool and not on the reactor
   // thread.
-  Status s = thread_pool_->SubmitFunc([s_this = shared_from_this()]() {
-      s_this->DoProcessResponse();
+  Status s = thread_pool_->SubmitFunc([s_this = shared_from_this(), req]() {
+      s_this->DoProcessResponse(req);
     });
   if (PREDICT_FALSE(!s.ok())) {
     LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Unable to process peer response: " << s.ToString()
-        << ": " << SecureShortDebugString(response_);
-    request_pending_ = false;
+        << ": " << SecureShortDebugString(response);
+    num_requests_in_flight_--;
   }
 }
 
-void Peer::DoProcessResponse() {
+void Peer::DoProcessResponse(const shared_ptr<UpdateRequest>& req) {
 
   VLOG_WITH_PREFIX_UNLOCKED(2) << "Response from peer " << peer_pb().permanent_uuid() << ": "
-      << SecureShortDebugString(response_);
+      << SecureShortDebugString(req->response);
+
+  bool out_of_order;
+  {
+    std::lock_guard<simple_spinlock> lock(peer_lock_);
+    out_of_order = req->seq_no < last_handled_seq_no_;
+    last_handled_seq_no_ = std::max(last_handled_seq_no_, req->seq_no);
+  }
 
   bool more_pending;
-  queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), response_, &more_pending);
+  queue_->ResponseFromPeer(peer_pb_.permanent_uuid(), req->response, &more_pending,
+                           out_of_order, req->send_time);
 
   {
     std::unique_lock<simple_spinlock> lock(peer_lock_);
-    CHECK(request_pending_);
+    CHECK_GT(num_requests_in_flight_, 0);
     failed_attempts_ = 0;
-    request_pending_ = false;
+    num_requests_in_flight_--;
   }
   // We're OK to read the state_ without a lock here -- if we get a race,
   // the worst thing that could happen is that we'll make one more request before
@@ -330,11 +386,11 @@ void Peer::ProcessTabletCopyResponse() {
     if (closed_) {
       return;
     }
-    CHECK(request_pending_);
-    request_pending_ = false;
+    CHECK(tablet_copy_pending_);
+    tablet_copy_pending_ = false;
   }
 
-  if (controller_.status().ok() && tc_response_.has_error()) {
+  if (tc_controller_.status().ok() && tc_response_.has_error()) {
     // ALREADY_INPROGRESS is expected, so we do not log this error.
     if (tc_response_.error().code() ==
         TabletServerErrorPB::TabletServerErrorPB::ALREADY_INPROGRESS) {
@@ -346,13 +402,13 @@ void Peer::ProcessTabletCopyResponse() {
   }
 }
 
-void Peer::ProcessResponseError(const Status& status) {
+void Peer::ProcessResponseError(const UpdateRequest& req, const Status& status) {
   failed_attempts_++;
   string resp_err_info;
-  if (response_.has_error()) {
+  if (req.response.has_error()) {
     resp_err_info = Substitute(" Error code: $0 ($1).",
-                               TabletServerErrorPB::Code_Name(response_.error().code()),
-                               response_.error().code());
+                               TabletServerErrorPB::Code_Name(req.response.error().code()),
+                               req.response.error().code());
   }
   LOG_WITH_PREFIX_UNLOCKED(WARNING) << "Couldn't send request to peer " << peer_pb_.permanent_uuid()
       << " for tablet " << tablet_id_ << "."
@@ -360,7 +416,7 @@ void Peer::ProcessResponseError(const Status& status) {
       << " Status: " << status.ToString() << "."
       << " Retrying in the next heartbeat period."
       << " Already tried " << failed_attempts_ << " times.";
-  request_pending_ = false;
+  num_requests_in_flight_--;
 }
 
 string Peer::LogPrefixUnlocked() const {
@@ -385,15 +441,21 @@ void Peer::Close() {
 
 Peer::~Peer() {
   Close();
+}
+
+Peer::UpdateRequest::~UpdateRequest() {
   // We don't own the ops (the queue does).
-  request_.mutable_ops()->ExtractSubrange(0, request_.ops_size(), nullptr);
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
 }
 
 
 RpcPeerProxy::RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy)
+                           gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+                           shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher)
     : hostport_(std::move(hostport)),
-      consensus_proxy_(std::move(consensus_proxy)) {
+      consensus_proxy_(std::move(consensus_proxy)),
+      heartbeat_batcher_(std::move(heartbeat_batcher)),
+      ops_in_sidecar_supported_(true) {
 }
 
 void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
@@ -404,6 +466,72 @@ void RpcPeerProxy::UpdateAsync(const ConsensusRequestPB* request,
   consensus_proxy_->UpdateConsensusAsync(*request, response, controller, callback);
 }
 
+void RpcPeerProxy::HeartbeatAsync(const ConsensusRequestPB* request,
+                                  ConsensusResponsePB* response,
+                                  rpc::RpcController* controller,
+                                  const rpc::ResponseCallback& callback) {
+  if (!heartbeat_batcher_) {
+    UpdateAsync(request, response, controller, callback);
+    return;
+  }
+  controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  heartbeat_batcher_->AddRequest(request, response, controller, callback);
+}
+
+void RpcPeerProxy::UpdateWithOpsAsync(ConsensusRequestPB* request,
+                                      const vector<ReplicateRefPtr>& ops,
+                                      ConsensusResponsePB* response,
+                                      rpc::RpcController* controller,
+                                      const rpc::ResponseCallback& callback) {
+  DCHECK_EQ(request->ops_size(), ops.size());
+  if (!FLAGS_consensus_send_ops_in_sidecar || !ops_in_sidecar_supported_) {
+    UpdateAsync(request, response, controller, callback);
+    return;
+  }
+
+  // The messages are serialized by the first peer they're sent to; the others
+  // just copy the bytes.
+  size_t size = 0;
+  for (const auto& op : ops) {
+    size += op->serialized().size();
+  }
+  gscoped_ptr<faststring> data(new faststring);
+  data->reserve(size);
+  for (const auto& op : ops) {
+    Slice serialized = op->serialized();
+    data->append(serialized.data(), serialized.size());
+  }
+  int idx;
+  Status s = controller->AddOutboundSidecar(
+      make_gscoped_ptr(new rpc::RpcSidecar(std::move(data))), &idx);
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG(DFATAL) << "Unable to add the operations sidecar: " << s.ToString();
+    UpdateAsync(request, response, controller, callback);
+    return;
+  }
+  // We don't own the ops (the queue does).
+  request->mutable_ops()->ExtractSubrange(0, request->ops_size(), nullptr);
+  request->set_ops_sidecar_idx(idx);
+  controller->RequireServerFeature(OPS_IN_SIDECAR);
+  controller->set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+
+  // The proxy is owned by the Peer, which the callback keeps alive.
+  consensus_proxy_->UpdateConsensusAsync(
+      *request, response, controller, [this, controller, callback]() {
+        const rpc::ErrorStatusPB* err = controller->error_response();
+        if (err && std::find(err->unsupported_feature_flags().begin(),
+                             err->unsupported_feature_flags().end(),
+                             static_cast<uint32_t>(OPS_IN_SIDECAR)) !=
+                   err->unsupported_feature_flags().end()) {
+          if (ops_in_sidecar_supported_.exchange(false)) {
+            LOG(INFO) << "Peer " << hostport_->ToString() << " doesn't support "
+                      << "operations in sidecars, sending them inline";
+          }
+        }
+        callback();
+      });
+}
+
 void RpcPeerProxy::RequestConsensusVoteAsync(const VoteRequestPB* request,
                                              VoteResponsePB* response,
                                              rpc::RpcController* controller,
@@ -438,8 +566,10 @@ Status CreateConsensusServiceProxyForHost(const shared_ptr<Messenger>& messenger
 
 } // anonymous namespace
 
-RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger)
-    : messenger_(std::move(messenger)) {}
+RpcPeerProxyFactory::RpcPeerProxyFactory(shared_ptr<Messenger> messenger,
+                                         MultiRaftManager* multi_raft_manager)
+    : messenger_(std::move(messenger)),
+      multi_raft_manager_(multi_raft_manager) {}
 
 Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
                                      gscoped_ptr<PeerProxy>* proxy) {
@@ -447,7 +577,12 @@ Status RpcPeerProxyFactory::NewProxy(const RaftPeerPB& peer_pb,
   RETURN_NOT_OK(HostPortFromPB(peer_pb.last_known_addr(), hostport.get()));
   gscoped_ptr<ConsensusServiceProxy> new_proxy;
   RETURN_NOT_OK(CreateConsensusServiceProxyForHost(messenger_, *hostport, &new_proxy));
-  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy)));
+  shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher;
+  if (multi_raft_manager_) {
+    RETURN_NOT_OK(multi_raft_manager_->GetHeartbeatBatcher(peer_pb, &heartbeat_batcher));
+  }
+  proxy->reset(new RpcPeerProxy(std::move(hostport), std::move(new_proxy),
+                                std::move(heartbeat_batcher)));
   return Status::OK();
 }
 
@@ -18,6 +18,7 @@
 #ifndef KUDU_CONSENSUS_CONSENSUS_PEERS_H_
 #define KUDU_CONSENSUS_CONSENSUS_PEERS_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -29,6 +30,7 @@
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/resettable_heartbeater.h"
 #include "kudu/util/semaphore.h"
 #include "kudu/util/status.h"
@@ -48,6 +50,8 @@ class RpcController;
 
 namespace consensus {
 class ConsensusServiceProxy;
+class MultiRaftHeartbeatBatcher;
+class MultiRaftManager;
 class OpId;
 class PeerProxy;
 class PeerProxyFactory;
@@ -118,16 +122,38 @@ class Peer : public std::enable_shared_from_this<Peer> {
        gscoped_ptr<PeerProxy> proxy, PeerMessageQueue* queue,
        ThreadPool* thread_pool);
 
+  // An UpdateConsensus RPC in flight to the peer.
+  struct UpdateRequest {
+    explicit UpdateRequest(uint64_t seq_no) : seq_no(seq_no) {}
+    ~UpdateRequest();
+
+    // The order in which the request was sent, starting at 1.
+    const uint64_t seq_no;
+
+    // The time at which the request was sent.
+    MonoTime send_time;
+
+    ConsensusRequestPB request;
+    ConsensusResponsePB response;
+    rpc::RpcController controller;
+
+    // Reference-counted pointers to the ReplicateMsgs of 'request'. We may
+    // have loaded these messages from the LogCache, in which case we are
+    // potentially sharing the same object as other peers. Since the PB request
+    // itself can't hold reference counts, this holds them.
+    std::vector<ReplicateRefPtr> replicate_msg_refs;
+  };
+
   void SendNextRequest(bool even_if_queue_empty);
 
-  // Signals that a response was received from the peer.
+  // Signals that a response to 'req' was received from the peer.
   // This method is called from the reactor thread and calls
   // DoProcessResponse() on thread_pool_ to do any work that requires IO or
   // lock-taking.
-  void ProcessResponse();
+  void ProcessResponse(const std::shared_ptr<UpdateRequest>& req);
 
   // Run on 'thread_pool'. Does response handling that requires IO or may block.
-  void DoProcessResponse();
+  void DoProcessResponse(const std::shared_ptr<UpdateRequest>& req);
 
   // Fetch the desired tablet copy request from the queue and set up
   // tc_request_ appropriately.
@@ -139,8 +165,9 @@ class Peer : public std::enable_shared_from_this<Peer> {
   // Handle RPC callback from initiating tablet copy.
   void ProcessTabletCopyResponse();
 
-  // Signals there was an error sending the request to the peer.
-  void ProcessResponseError(const Status& status);
+  // Signals there was an error sending 'req' to the peer. Called with
+  // 'peer_lock_' held.
+  void ProcessResponseError(const UpdateRequest& req, const Status& status);
 
   std::string LogPrefixUnlocked() const;
 
@@ -156,21 +183,13 @@ class Peer : public std::enable_shared_from_this<Peer> {
   PeerMessageQueue* queue_;
   uint64_t failed_attempts_;
 
-  // The latest consensus update request and response.
-  ConsensusRequestPB request_;
-  ConsensusResponsePB response_;
+  // The committed index sent in the latest consensus update request.
+  int64_t last_request_committed_index_;
 
   // The latest tablet copy request and response.
   StartTabletCopyRequestPB tc_request_;
   StartTabletCopyResponsePB tc_response_;
-
-  // Reference-counted pointers to any ReplicateMsgs which are in-flight to the peer. We
-  // may have loaded these messages from the LogCache, in which case we are potentially
-  // sharing the same object as other peers. Since the PB request_ itself can't hold
-  // reference counts, this holds them.
-  std::vector<ReplicateRefPtr> replicate_msg_refs_;
-
-  rpc::RpcController controller_;
+  rpc::RpcController tc_controller_;
 
   // Heartbeater for remote peer implementations.
   // This will send status only requests to the remote peers
@@ -183,10 +202,20 @@ class Peer : public std::enable_shared_from_this<Peer> {
 
   // lock that protects Peer state changes, initialization, etc.
   mutable simple_spinlock peer_lock_;
-  bool request_pending_ = false;
+
+  // The consensus update requests in flight, at most
+  // FLAGS_consensus_max_requests_in_flight_per_peer of them. Beyond the
+  // first, they only carry operations following those of the others.
+  int num_requests_in_flight_ = 0;
+  bool tablet_copy_pending_ = false;
   bool closed_ = false;
   bool has_sent_first_request_ = false;
 
+  // The sequence number of the last request sent, and the highest one whose
+  // response was handled.
+  uint64_t last_request_seq_no_ = 0;
+  uint64_t last_handled_seq_no_ = 0;
+
 };
 
 // A proxy to another peer. Usually a thin wrapper around an rpc proxy but can
@@ -200,6 +229,28 @@ class PeerProxy {
                            rpc::RpcController* controller,
                            const rpc::ResponseCallback& callback) = 0;
 
+  // Sends a status-only request, asynchronously, to a remote peer.
+  // Implementations may hold it back to send it along with the heartbeats of
+  // other tablets to the same server.
+  virtual void HeartbeatAsync(const ConsensusRequestPB* request,
+                              ConsensusResponsePB* response,
+                              rpc::RpcController* controller,
+                              const rpc::ResponseCallback& callback) {
+    UpdateAsync(request, response, controller, callback);
+  }
+
+  // Sends a request carrying operations, asynchronously, to a remote peer.
+  // 'ops' hold the operations of 'request', which implementations may send in
+  // their cached serialized form (see RefCountedReplicate::serialized())
+  // rather than as part of 'request'; hence 'request' may be modified.
+  virtual void UpdateWithOpsAsync(ConsensusRequestPB* request,
+                                  const std::vector<ReplicateRefPtr>& ops,
+                                  ConsensusResponsePB* response,
+                                  rpc::RpcController* controller,
+                                  const rpc::ResponseCallback& callback) {
+    UpdateAsync(request, response, controller, callback);
+  }
+
   // Sends a RequestConsensusVote to a remote peer.
   virtual void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                          VoteResponsePB* response,
@@ -228,17 +279,32 @@ class PeerProxyFactory {
   virtual ~PeerProxyFactory() {}
 };
 
-// PeerProxy implementation that does RPC calls
+// PeerProxy implementation that does RPC calls. Heartbeats go through
+// 'heartbeat_batcher', if not null.
 class RpcPeerProxy : public PeerProxy {
  public:
   RpcPeerProxy(gscoped_ptr<HostPort> hostport,
-               gscoped_ptr<ConsensusServiceProxy> consensus_proxy);
+               gscoped_ptr<ConsensusServiceProxy> consensus_proxy,
+               std::shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher = nullptr);
 
   virtual void UpdateAsync(const ConsensusRequestPB* request,
                            ConsensusResponsePB* response,
                            rpc::RpcController* controller,
                            const rpc::ResponseCallback& callback) OVERRIDE;
 
+  virtual void HeartbeatAsync(const ConsensusRequestPB* request,
+                              ConsensusResponsePB* response,
+                              rpc::RpcController* controller,
+                              const rpc::ResponseCallback& callback) OVERRIDE;
+
+  // Sends the operations in an RPC sidecar, unless the peer has been found not
+  // to support it.
+  virtual void UpdateWithOpsAsync(ConsensusRequestPB* request,
+                                  const std::vector<ReplicateRefPtr>& ops,
+                                  ConsensusResponsePB* response,
+                                  rpc::RpcController* controller,
+                                  const rpc::ResponseCallback& callback) OVERRIDE;
+
   virtual void RequestConsensusVoteAsync(const VoteRequestPB* request,
                                          VoteResponsePB* response,
                                          rpc::RpcController* controller,
@@ -254,12 +320,19 @@ class RpcPeerProxy : public PeerProxy {
  private:
   gscoped_ptr<HostPort> hostport_;
   gscoped_ptr<ConsensusServiceProxy> consensus_proxy_;
+  std::shared_ptr<MultiRaftHeartbeatBatcher> heartbeat_batcher_;
+
+  // Cleared once the peer rejects a request with operations in a sidecar.
+  std::atomic<bool> ops_in_sidecar_supported_;
 };
 
-// PeerProxyFactory implementation that generates RPCPeerProxies
+// PeerProxyFactory implementation that generates RPCPeerProxies. If
+// 'multi_raft_manager' isn't null, the heartbeats of the proxies are batched
+// with those of the other tablets of the server; it must outlive the factory.
 class RpcPeerProxyFactory : public PeerProxyFactory {
  public:
-  explicit RpcPeerProxyFactory(std::shared_ptr<rpc::Messenger> messenger);
+  explicit RpcPeerProxyFactory(std::shared_ptr<rpc::Messenger> messenger,
+                               MultiRaftManager* multi_raft_manager = nullptr);
 
   virtual Status NewProxy(const RaftPeerPB& peer_pb,
                           gscoped_ptr<PeerProxy>* proxy) OVERRIDE;
@@ -267,6 +340,7 @@ class RpcPeerProxyFactory : public PeerProxyFactory {
   virtual ~RpcPeerProxyFactory();
  private:
   std::shared_ptr<rpc::Messenger> messenger_;
+  MultiRaftManager* multi_raft_manager_;
 };
 
 // Query the consensus service at last known host/port that is
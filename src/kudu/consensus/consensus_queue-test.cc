@@ -36,6 +36,8 @@
 #include "kudu/util/test_util.h"
 
 DECLARE_int32(consensus_max_batch_size_bytes);
+DECLARE_bool(raft_enable_leader_leases);
+DECLARE_int32(raft_heartbeat_interval_ms);
 
 METRIC_DECLARE_entity(tablet);
 
@@ -75,10 +77,10 @@ class ConsensusQueueTest : public KuduTest {
   void CloseAndReopenQueue() {
     scoped_refptr<server::Clock> clock(new server::HybridClock());
     ASSERT_OK(clock->Init());
-    scoped_refptr<TimeManager> time_manager(new TimeManager(clock, Timestamp::kMin));
+    time_manager_.reset(new TimeManager(clock, Timestamp::kMin));
     queue_.reset(new PeerMessageQueue(metric_entity_,
                                       log_.get(),
-                                      time_manager,
+                                      time_manager_,
                                       FakeRaftPeerPB(kLeaderUuid),
                                       kTestTablet));
   }
@@ -193,6 +195,7 @@ class ConsensusQueueTest : public KuduTest {
   gscoped_ptr<PeerMessageQueue> queue_;
   scoped_refptr<log::LogAnchorRegistry> registry_;
   scoped_refptr<server::Clock> clock_;
+  scoped_refptr<TimeManager> time_manager_;
 };
 
 // Tests that the queue is able to track a peer when it starts tracking a peer
@@ -303,6 +306,81 @@ TEST_F(ConsensusQueueTest, TestGetPagedMessages) {
   request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
 }
 
+// Tests that requests pipelined behind those in flight carry the following
+// operations, that out-of-order responses don't move the peer backwards, and
+// that a rejection rewinds the pipeline.
+TEST_F(ConsensusQueueTest, TestPipelinedRequests) {
+  queue_->Init(MinimumOpId(), MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+
+  // Make each request carry 10 operations, as in TestGetPagedMessages.
+  ConsensusRequestPB page_size_estimator;
+  page_size_estimator.set_caller_term(14);
+  page_size_estimator.set_committed_index(0);
+  page_size_estimator.set_all_replicated_index(0);
+  page_size_estimator.mutable_preceding_id()->CopyFrom(MinimumOpId());
+  const int kOpsPerRequest = 10;
+  for (int i = 0; i < kOpsPerRequest; i++) {
+    page_size_estimator.mutable_ops()->AddAllocated(
+        CreateDummyReplicate(0, 0, clock_->Now(), 0).release());
+  }
+  google::FlagSaver saver;
+  FLAGS_consensus_max_batch_size_bytes = page_size_estimator.ByteSize();
+
+  ConsensusRequestPB request;
+  ConsensusResponsePB response;
+  bool more_pending = false;
+  UpdatePeerWatermarkToOp(&request, &response, MinimumOpId(), MinimumOpId(), &more_pending);
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 100);
+
+  // Send three requests back to back.
+  ConsensusRequestPB requests[3];
+  vector<ReplicateRefPtr> refs[3];
+  bool needs_tablet_copy;
+  for (int i = 0; i < 3; i++) {
+    ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &requests[i], &refs[i], &needs_tablet_copy,
+                                     i > 0));
+    ASSERT_FALSE(needs_tablet_copy);
+    ASSERT_GT(requests[i].ops_size(), 0);
+    int64_t first_index = requests[i].ops(0).id().index();
+    ASSERT_EQ(i == 0 ? 1 : requests[i - 1].ops(requests[i - 1].ops_size() - 1).id().index() + 1,
+              first_index);
+  }
+  OpId last_of_first = requests[0].ops(requests[0].ops_size() - 1).id();
+  OpId last_of_second = requests[1].ops(requests[1].ops_size() - 1).id();
+
+  // The second request is acked before the first.
+  ConsensusResponsePB second_response;
+  second_response.set_responder_uuid(kPeerUuid);
+  SetLastReceivedAndLastCommitted(&second_response, last_of_second);
+  queue_->ResponseFromPeer(kPeerUuid, second_response, &more_pending);
+  ConsensusResponsePB first_response;
+  first_response.set_responder_uuid(kPeerUuid);
+  SetLastReceivedAndLastCommitted(&first_response, last_of_first);
+  queue_->ResponseFromPeer(kPeerUuid, first_response, &more_pending, true);
+  ASSERT_TRUE(more_pending);
+  ASSERT_EQ(last_of_second.index(),
+            queue_->GetTrackedPeerForTests(kPeerUuid).last_received.index());
+
+  // The third request is rejected: the next request starts over after the
+  // second one, rather than after the third.
+  ConsensusResponsePB third_response;
+  third_response.set_responder_uuid(kPeerUuid);
+  RefuseWithLogPropertyMismatch(&third_response, last_of_second, last_of_second);
+  third_response.mutable_status()->set_last_committed_idx(last_of_second.index());
+  queue_->ResponseFromPeer(kPeerUuid, third_response, &more_pending);
+  ASSERT_TRUE(more_pending);
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &request, &refs[0], &needs_tablet_copy, true));
+  ASSERT_GT(request.ops_size(), 0);
+  ASSERT_EQ(last_of_second.index() + 1, request.ops(0).id().index());
+
+  // Extract the ops from the requests to avoid double frees.
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+  for (ConsensusRequestPB& req : requests) {
+    req.mutable_ops()->ExtractSubrange(0, req.ops_size(), nullptr);
+  }
+}
+
 TEST_F(ConsensusQueueTest, TestPeersDontAckBeyondWatermarks) {
   queue_->Init(MinimumOpId(), MinimumOpId());
   queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
@@ -817,6 +895,125 @@ TEST_F(ConsensusQueueTest, TestTriggerTabletCopyIfTabletNotFound) {
             SecureShortDebugString(tc_req.copy_peer_addr()));
 }
 
+// Tests that the leader holds a lease while a majority of the voters has
+// recently accepted its requests, but not during the first lease duration of
+// its leadership.
+TEST_F(ConsensusQueueTest, TestLeaderLease) {
+  FLAGS_raft_enable_leader_leases = true;
+  FLAGS_raft_heartbeat_interval_ms = 100;
+  const MonoDelta lease_duration = PeerMessageQueue::LeaderLeaseDuration();
+
+  queue_->Init(MinimumOpId(), MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(3));
+  queue_->TrackPeer("peer-1");
+  queue_->TrackPeer("peer-2");
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  ConsensusResponsePB response;
+  response.set_responder_term(kMinimumTerm);
+  SetLastReceivedAndLastCommitted(&response, MinimumOpId(), MinimumOpId().index());
+  bool more_pending;
+
+  // A majority accepted a request sent right now, but the leader was elected
+  // too recently to hold a lease.
+  response.set_responder_uuid("peer-1");
+  queue_->ResponseFromPeer("peer-1", response, &more_pending, false, MonoTime::Now());
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  SleepFor(lease_duration);
+
+  // A response without a send time, or to a request sent too long ago,
+  // doesn't extend the lease.
+  response.set_responder_uuid("peer-2");
+  queue_->ResponseFromPeer("peer-2", response, &more_pending);
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  queue_->ResponseFromPeer("peer-2", response, &more_pending, false,
+                           MonoTime::Now() - lease_duration);
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  // A response to a request sent now does.
+  queue_->ResponseFromPeer("peer-2", response, &more_pending, false, MonoTime::Now());
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+
+  // The lease expires unless another request is acked.
+  SleepFor(lease_duration);
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  // Requests with operations carry safe time too, since the leader holds a lease.
+  response.set_responder_uuid("peer-1");
+  queue_->ResponseFromPeer("peer-1", response, &more_pending, false, MonoTime::Now());
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 1);
+  WaitForLocalPeerToAckIndex(1);
+  ConsensusRequestPB request;
+  vector<ReplicateRefPtr> refs;
+  bool needs_tablet_copy;
+  ASSERT_OK(queue_->RequestForPeer("peer-1", &request, &refs, &needs_tablet_copy));
+  ASSERT_EQ(1, request.ops_size());
+  ASSERT_TRUE(request.has_safe_timestamp());
+  ASSERT_GE(request.safe_timestamp(), request.ops(0).timestamp());
+
+  // Stepping down loses the lease.
+  queue_->SetNonLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+}
+
+TEST_F(ConsensusQueueTest, TestPeerReplicationStats) {
+  queue_->Init(MinimumOpId(), MinimumOpId());
+  queue_->SetLeaderMode(kMinimumOpIdIndex, kMinimumTerm, BuildRaftConfigPBForTests(2));
+  queue_->TrackPeer(kPeerUuid);
+  AppendReplicateMessagesToQueue(queue_.get(), clock_, 1, 10);
+  WaitForLocalPeerToAckIndex(10);
+
+  // The local peer isn't listed, and the remote one never acked.
+  vector<PeerReplicationStats> stats;
+  queue_->GetPeerReplicationStats(&stats);
+  ASSERT_EQ(1, stats.size());
+  ASSERT_EQ(kPeerUuid, stats[0].uuid);
+  ASSERT_EQ(10, stats[0].lag_ops);
+  ASSERT_EQ(0, stats[0].num_requests);
+  ASSERT_FALSE(stats[0].time_since_last_ack.Initialized());
+
+  // The peer has all the operations up to 5. Sending it the rest puts them in
+  // flight.
+  ConsensusResponsePB response;
+  response.set_responder_uuid(kPeerUuid);
+  response.set_responder_term(kMinimumTerm);
+  SetLastReceivedAndLastCommitted(&response, MakeOpId(0, 5), 5);
+  bool more_pending;
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending, false,
+                           MonoTime::Now() - MonoDelta::FromMilliseconds(10));
+  ConsensusRequestPB request;
+  vector<ReplicateRefPtr> refs;
+  bool needs_tablet_copy;
+  ASSERT_OK(queue_->RequestForPeer(kPeerUuid, &request, &refs, &needs_tablet_copy));
+  ASSERT_EQ(5, request.ops_size());
+  queue_->GetPeerReplicationStats(&stats);
+  ASSERT_EQ(1, stats.size());
+  ASSERT_EQ(5, stats[0].lag_ops);
+  ASSERT_EQ(5, stats[0].ops_in_flight);
+  ASSERT_GT(stats[0].bytes_in_flight, 0);
+  ASSERT_EQ(1, stats[0].num_requests);
+  ASSERT_GE(stats[0].rtt_p50_us, 10000);
+  ASSERT_TRUE(stats[0].time_since_last_ack.Initialized());
+  request.mutable_ops()->ExtractSubrange(0, request.ops_size(), nullptr);
+
+  // Acking them leaves nothing in flight.
+  SetLastReceivedAndLastCommitted(&response, MakeOpId(1, 10), 5);
+  queue_->ResponseFromPeer(kPeerUuid, response, &more_pending, false, MonoTime::Now());
+  queue_->GetPeerReplicationStats(&stats);
+  ASSERT_EQ(0, stats[0].lag_ops);
+  ASSERT_EQ(0, stats[0].ops_in_flight);
+  ASSERT_EQ(0, stats[0].bytes_in_flight);
+  ASSERT_EQ(2, stats[0].num_requests);
+  ASSERT_GE(stats[0].rtt_max_us, 10000);
+
+  // Only leaders replicate to peers.
+  queue_->SetNonLeaderMode();
+  queue_->GetPeerReplicationStats(&stats);
+  ASSERT_TRUE(stats.empty());
+}
+
 TEST_F(ConsensusQueueTest, TestFollowerCommittedIndexAndMetrics) {
   queue_->Init(MinimumOpId(), MinimumOpId());
   queue_->SetNonLeaderMode();
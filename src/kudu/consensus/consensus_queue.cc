@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <boost/optional.hpp>
 #include <boost/optional/optional_io.hpp>
+#include <functional>
 #include <gflags/gflags.h>
 #include <iostream>
 #include <mutex>
@@ -67,6 +68,9 @@ DEFINE_int32(consensus_inject_latency_ms_in_notifications, 0,
 TAG_FLAG(consensus_inject_latency_ms_in_notifications, hidden);
 TAG_FLAG(consensus_inject_latency_ms_in_notifications, unsafe);
 
+DECLARE_bool(raft_enable_leader_leases);
+DECLARE_double(leader_failure_max_missed_heartbeat_periods);
+DECLARE_int32(raft_heartbeat_interval_ms);
 DECLARE_bool(safe_time_advancement_without_writes);
 
 namespace kudu {
@@ -83,22 +87,34 @@ METRIC_DEFINE_gauge_int64(tablet, in_progress_ops, "Operations in Progress",
                           MetricUnit::kOperations,
                           "Number of operations in the peer's queue ack'd by a minority of "
                           "peers.");
+METRIC_DEFINE_gauge_int64(tablet, max_peer_lag_ops, "Leader Maximum Peer Lag",
+                          MetricUnit::kOperations,
+                          "Number of operations in the leader's log not ack'd by the peer "
+                          "which lags the most. This metric is always zero for followers.");
+METRIC_DEFINE_histogram(tablet, peer_update_rtt, "Leader Peer Update Round Trip Time",
+                        MetricUnit::kMicroseconds,
+                        "Round-trip times of the leader's UpdateConsensus requests to its "
+                        "peers, including the time spent queued before processing the "
+                        "responses.",
+                        60000000LU, 2);
 
 std::string PeerMessageQueue::TrackedPeer::ToString() const {
   return Substitute("Peer: $0, Is new: $1, Last received: $2, Next index: $3, "
                     "Last known committed idx: $4, Last exchange result: $5, "
-                    "Needs tablet copy: $6",
+                    "Needs tablet copy: $6, Next index to send: $7",
                     uuid, is_new, OpIdToString(last_received), next_index,
                     last_known_committed_index,
                     is_last_exchange_successful ? "SUCCESS" : "ERROR",
-                    needs_tablet_copy);
+                    needs_tablet_copy, next_index_to_send());
 }
 
 #define INSTANTIATE_METRIC(x) \
   x.Instantiate(metric_entity, 0)
 PeerMessageQueue::Metrics::Metrics(const scoped_refptr<MetricEntity>& metric_entity)
   : num_majority_done_ops(INSTANTIATE_METRIC(METRIC_majority_done_ops)),
-    num_in_progress_ops(INSTANTIATE_METRIC(METRIC_in_progress_ops)) {
+    num_in_progress_ops(INSTANTIATE_METRIC(METRIC_in_progress_ops)),
+    max_peer_lag_ops(INSTANTIATE_METRIC(METRIC_max_peer_lag_ops)),
+    peer_update_rtt(METRIC_peer_update_rtt.Instantiate(metric_entity)) {
 }
 #undef INSTANTIATE_METRIC
 
@@ -140,6 +156,10 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
                                      int64_t current_term,
                                      const RaftConfigPB& active_config) {
   std::lock_guard<simple_spinlock> lock(queue_lock_);
+  // This is also called on configuration changes, which don't start a new
+  // leadership.
+  bool new_leadership = queue_state_.mode != LEADER ||
+      current_term != queue_state_.current_term;
   if (current_term != queue_state_.current_term) {
     CHECK_GT(current_term, queue_state_.current_term) << "Terms should only increase";
     queue_state_.first_index_in_current_term = boost::none;
@@ -164,8 +184,15 @@ void PeerMessageQueue::SetLeaderMode(int64_t committed_index,
   MonoTime now(MonoTime::Now());
   for (const PeersMap::value_type& entry : peers_map_) {
     entry.second->last_successful_communication_time = now;
+    if (new_leadership) {
+      entry.second->last_acked_request_send_time = MonoTime::Min();
+    }
+  }
+  if (new_leadership) {
+    leader_since_ = now;
   }
   time_manager_->SetLeaderMode();
+  UpdateLeaderLeaseUnlocked();
 }
 
 void PeerMessageQueue::SetNonLeaderMode() {
@@ -175,9 +202,46 @@ void PeerMessageQueue::SetNonLeaderMode() {
   queue_state_.majority_size_ = -1;
   LOG_WITH_PREFIX_UNLOCKED(INFO) << "Queue going to NON_LEADER mode. State: "
       << queue_state_.ToString();
+  for (const PeersMap::value_type& entry : peers_map_) {
+    log_cache_.DropReadAhead(entry.first);
+  }
   time_manager_->SetNonLeaderMode();
 }
 
+MonoDelta PeerMessageQueue::LeaderLeaseDuration() {
+  // Leave a 10% margin for the clock drift.
+  return MonoDelta::FromMilliseconds(0.9 * FLAGS_leader_failure_max_missed_heartbeat_periods *
+                                     FLAGS_raft_heartbeat_interval_ms);
+}
+
+void PeerMessageQueue::UpdateLeaderLeaseUnlocked() {
+  if (PREDICT_TRUE(!FLAGS_raft_enable_leader_leases) || queue_state_.mode != LEADER) {
+    return;
+  }
+  // Find the latest time such that a majority of the voters have accepted a
+  // request sent no earlier, counting the leader itself as up to date.
+  vector<MonoTime> send_times;
+  for (const PeersMap::value_type& entry : peers_map_) {
+    if (!IsRaftConfigVoter(entry.first, *queue_state_.active_config)) continue;
+    if (entry.first == local_peer_pb_.permanent_uuid()) {
+      send_times.push_back(MonoTime::Max());
+    } else {
+      send_times.push_back(entry.second->last_acked_request_send_time);
+    }
+  }
+  if (static_cast<int>(send_times.size()) < queue_state_.majority_size_) return;
+  auto nth = send_times.begin() + queue_state_.majority_size_ - 1;
+  std::nth_element(send_times.begin(), nth, send_times.end(), std::greater<MonoTime>());
+  MonoDelta duration = LeaderLeaseDuration();
+  MonoTime expiration = *nth == MonoTime::Max() ? MonoTime::Max() : *nth + duration;
+
+  // The lease of the previous leader expires before a majority votes for
+  // another candidate, unless the election was forced, e.g. by a leader
+  // stepping down. To cover the latter, the lease only starts after a lease
+  // duration into our leadership.
+  time_manager_->SetLeaderLease(leader_since_ + duration, expiration);
+}
+
 void PeerMessageQueue::TrackPeer(const string& uuid) {
   std::lock_guard<simple_spinlock> lock(queue_lock_);
   TrackPeerUnlocked(uuid);
@@ -212,6 +276,7 @@ void PeerMessageQueue::UntrackPeer(const string& uuid) {
   if (peer != nullptr) {
     delete peer;
   }
+  log_cache_.DropReadAhead(uuid);
 }
 
 void PeerMessageQueue::CheckPeersInActiveConfigIfLeaderUnlocked() const {
@@ -284,14 +349,6 @@ Status PeerMessageQueue::AppendOperations(const vector<ReplicateRefPtr>& msgs,
     }
   }
 
-  // Update safe time in the TimeManager if we're leader.
-  // This will 'unpin' safe time advancement, which had stopped since we assigned a timestamp to
-  // the message.
-  // Until we have leader leases, replicas only call this when the message is committed.
-  if (queue_state_.mode == LEADER) {
-    time_manager_->AdvanceSafeTimeWithMessage(*msgs.back()->get());
-  }
-
   // Unlock ourselves during Append to prevent a deadlock: it's possible that
   // the log buffer is full, in which case AppendOperations would block. However,
   // for the log buffer to empty, it may need to call LocalPeerAppendFinished()
@@ -304,6 +361,15 @@ Status PeerMessageQueue::AppendOperations(const vector<ReplicateRefPtr>& msgs,
                                                  log_append_callback)));
   lock.lock();
   queue_state_.last_appended = last_id;
+
+  // Update safe time in the TimeManager if we're leader.
+  // This will 'unpin' safe time advancement, which had stopped since we assigned a timestamp to
+  // the message. Doing so only once the messages are in the log cache guarantees that requests
+  // built from the cache include all the messages whose timestamps are lower than safe time.
+  // Replicas only call this when the message is committed.
+  if (queue_state_.mode == LEADER) {
+    time_manager_->AdvanceSafeTimeWithMessage(*msgs.back()->get());
+  }
   UpdateMetrics();
 
   return Status::OK();
@@ -338,9 +404,15 @@ OpId PeerMessageQueue::GetNextOpId() const {
 Status PeerMessageQueue::RequestForPeer(const string& uuid,
                                         ConsensusRequestPB* request,
                                         vector<ReplicateRefPtr>* msg_refs,
-                                        bool* needs_tablet_copy) {
+                                        bool* needs_tablet_copy,
+                                        bool pipelined) {
   TrackedPeer* peer = nullptr;
   OpId preceding_id;
+  bool peer_is_new;
+  int64_t next_index;
+  const bool leader_leases = FLAGS_raft_enable_leader_leases;
+  Timestamp safe_time;
+  int64_t last_appended_index = 0;
   {
     std::lock_guard<simple_spinlock> lock(queue_lock_);
     DCHECK_EQ(queue_state_.state, kQueueOpen);
@@ -360,6 +432,17 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     request->set_committed_index(queue_state_.committed_index);
     request->set_all_replicated_index(queue_state_.all_replicated_index);
     request->set_caller_term(queue_state_.current_term);
+
+    // Responses to the requests in flight may update these concurrently.
+    peer_is_new = peer->is_new;
+    next_index = pipelined ? peer->next_index_to_send() : peer->next_index;
+
+    // All the operations whose timestamps are lower than safe time are in
+    // the log cache by now, up to 'last_appended_index'.
+    if (leader_leases) {
+      safe_time = time_manager_->GetSafeTime();
+      last_appended_index = queue_state_.last_appended.index();
+    }
   }
 
   MonoDelta unreachable_time =
@@ -387,18 +470,20 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
 
   // If we've never communicated with the peer, we don't know what messages to
   // send, so we'll send a status-only request. Otherwise, we grab requests
-  // from the log starting at the last_received point.
-  if (!peer->is_new) {
+  // from the log starting at the last_received point, or after the requests
+  // in flight if pipelining.
+  if (!peer_is_new) {
 
     // The batch of messages to send to the peer.
     vector<ReplicateRefPtr> messages;
     int max_batch_size = FLAGS_consensus_max_batch_size_bytes - request->ByteSize();
 
     // We try to get the follower's next_index from our log.
-    Status s = log_cache_.ReadOps(peer->next_index - 1,
+    Status s = log_cache_.ReadOps(next_index - 1,
                                   max_batch_size,
                                   &messages,
-                                  &preceding_id);
+                                  &preceding_id,
+                                  uuid);
     if (PREDICT_FALSE(!s.ok())) {
       // It's normal to have a NotFound() here if a follower falls behind where
       // the leader has GCed its logs.
@@ -432,6 +517,18 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
     }
     msg_refs->swap(messages);
     DCHECK_LE(request->ByteSize(), FLAGS_consensus_max_batch_size_bytes);
+
+    if (request->ops_size() > 0) {
+      int64_t batch_bytes = 0;
+      for (const ReplicateMsg& op : request->ops()) {
+        batch_bytes += op.ByteSize();
+      }
+      int64_t last_index = request->ops(request->ops_size() - 1).id().index();
+      std::lock_guard<simple_spinlock> lock(queue_lock_);
+      peer->pipelined_next_index = last_index + 1;
+      peer->stats->batches_in_flight.emplace_back(last_index, batch_bytes);
+      peer->stats->bytes_in_flight += batch_bytes;
+    }
   }
 
   DCHECK(preceding_id.IsInitialized());
@@ -448,8 +545,14 @@ Status PeerMessageQueue::RequestForPeer(const string& uuid,
           << (request->committed_index() - last_op_sent)
           << " ops behind the committed index " << THROTTLE_MSG;
     }
+    // With leader leases, the safe time of a leader which may have been
+    // deposed doesn't move, and so it can be sent along with operations, as
+    // long as these reach all those with lower timestamps. The follower only
+    // advances safe time if it manages to start all of them.
+    if (leader_leases && last_op_sent >= last_appended_index) {
+      request->set_safe_timestamp(safe_time.value());
+    }
   // If we're not sending ops to the follower, set the safe time on the request.
-  // TODO(dralves) When we have leader leases, send this all the time.
   } else {
     if (PREDICT_TRUE(FLAGS_safe_time_advancement_without_writes)) {
       request->set_safe_timestamp(time_manager_->GetSafeTime().value());
@@ -591,7 +694,9 @@ void PeerMessageQueue::NotifyPeerIsResponsiveDespiteError(const std::string& pee
 
 void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
                                         const ConsensusResponsePB& response,
-                                        bool* more_pending) {
+                                        bool* more_pending,
+                                        bool out_of_order,
+                                        const MonoTime& request_send_time) {
   DCHECK(response.IsInitialized()) << "Error: Uninitialized: "
       << response.InitializationErrorString() << ". Response: " << SecureShortDebugString(response);
 
@@ -642,6 +747,40 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     const ConsensusStatusPB& status = response.status();
 
+    if (request_send_time.Initialized()) {
+      int64_t rtt_us = (MonoTime::Now() - request_send_time).ToMicroseconds();
+      metrics_.peer_update_rtt->Increment(rtt_us);
+      peer->stats->rtt_histogram.Increment(
+          std::min<int64_t>(rtt_us, peer->stats->rtt_histogram.highest_trackable_value()));
+    }
+    if (!status.has_error()) {
+      peer->stats->last_ack_time = MonoTime::Now();
+    }
+
+    // The peer withholds its vote for an election timeout after accepting a
+    // request without errors, so that extends our lease.
+    if (!status.has_error() && request_send_time.Initialized() &&
+        request_send_time > peer->last_acked_request_send_time) {
+      peer->last_acked_request_send_time = request_send_time;
+      UpdateLeaderLeaseUnlocked();
+    }
+
+    // A response to a pipelined request which reports less than the peer
+    // already acked predates that ack, and only tells us that the peer is
+    // alive.
+    bool invalid_term = status.has_error() &&
+        status.error().code() == ConsensusErrorPB::INVALID_TERM;
+    if (out_of_order && peer->is_last_exchange_successful && !invalid_term &&
+        status.last_received().index() < peer->last_received.index()) {
+      VLOG_WITH_PREFIX_UNLOCKED(2) << "Disregarding stale response from peer ("
+                                   << peer->ToString() << "): "
+                                   << SecureShortDebugString(response);
+      peer->last_successful_communication_time = MonoTime::Now();
+      *more_pending = log_cache_.HasOpBeenWritten(peer->next_index_to_send()) ||
+          (peer->last_known_committed_index < queue_state_.committed_index);
+      return;
+    }
+
     // Take a snapshot of the current peer status.
     TrackedPeer previous = *peer;
 
@@ -687,6 +826,11 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     if (PREDICT_FALSE(status.has_error())) {
       peer->is_last_exchange_successful = false;
+      // Resend from where the peer's log ends rather than after the requests
+      // in flight, which it will reject as well.
+      peer->pipelined_next_index = peer->next_index;
+      peer->stats->batches_in_flight.clear();
+      peer->stats->bytes_in_flight = 0;
       switch (status.error().code()) {
         case ConsensusErrorPB::PRECEDING_ENTRY_DIDNT_MATCH: {
           DCHECK(status.has_last_received());
@@ -717,6 +861,12 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     peer->is_last_exchange_successful = true;
 
+    auto* batches = &peer->stats->batches_in_flight;
+    while (!batches->empty() && batches->front().first <= peer->last_received.index()) {
+      peer->stats->bytes_in_flight -= batches->front().second;
+      batches->pop_front();
+    }
+
     if (response.has_responder_term()) {
       // The peer must have responded with a term that is greater than or equal to
       // the last known term for that peer.
@@ -788,7 +938,7 @@ void PeerMessageQueue::ResponseFromPeer(const std::string& peer_uuid,
 
     // If our log has the next request for the peer or if the peer's committed index is
     // lower than our own, set 'more_pending' to true.
-    *more_pending = log_cache_.HasOpBeenWritten(peer->next_index) ||
+    *more_pending = log_cache_.HasOpBeenWritten(peer->next_index_to_send()) ||
         (peer->last_known_committed_index < queue_state_.committed_index);
 
     log_cache_.EvictThroughOp(queue_state_.all_replicated_index);
@@ -839,6 +989,48 @@ void PeerMessageQueue::UpdateMetrics() {
     : 0);
   metrics_.num_in_progress_ops->set_value(
     queue_state_.last_appended.index() - queue_state_.committed_index);
+
+  int64_t max_peer_lag = 0;
+  if (queue_state_.mode == LEADER) {
+    for (const PeersMap::value_type& entry : peers_map_) {
+      max_peer_lag = std::max(max_peer_lag, queue_state_.last_appended.index() -
+                                            entry.second->last_received.index());
+    }
+  }
+  metrics_.max_peer_lag_ops->set_value(max_peer_lag);
+}
+
+void PeerMessageQueue::GetPeerReplicationStats(vector<PeerReplicationStats>* stats) const {
+  std::lock_guard<simple_spinlock> lock(queue_lock_);
+  GetPeerReplicationStatsUnlocked(stats);
+}
+
+void PeerMessageQueue::GetPeerReplicationStatsUnlocked(
+    vector<PeerReplicationStats>* stats) const {
+  stats->clear();
+  if (queue_state_.mode != LEADER) return;
+  MonoTime now = MonoTime::Now();
+  for (const PeersMap::value_type& entry : peers_map_) {
+    if (entry.first == local_peer_pb_.permanent_uuid()) continue;
+    const TrackedPeer& peer = *entry.second;
+    PeerReplicationStats s;
+    s.uuid = peer.uuid;
+    s.lag_ops = std::max<int64_t>(
+        queue_state_.last_appended.index() - peer.last_received.index(), 0);
+    s.ops_in_flight = std::max<int64_t>(peer.next_index_to_send() - peer.next_index, 0);
+    s.bytes_in_flight = peer.stats->bytes_in_flight;
+    if (peer.stats->last_ack_time.Initialized()) {
+      s.time_since_last_ack = now - peer.stats->last_ack_time;
+    }
+    const HdrHistogram& rtt = peer.stats->rtt_histogram;
+    s.num_requests = rtt.TotalCount();
+    if (s.num_requests > 0) {
+      s.rtt_p50_us = rtt.ValueAtPercentile(50);
+      s.rtt_p99_us = rtt.ValueAtPercentile(99);
+      s.rtt_max_us = rtt.MaxValue();
+    }
+    stats->emplace_back(std::move(s));
+  }
 }
 
 void PeerMessageQueue::DumpToStrings(vector<string>* lines) const {
@@ -870,6 +1062,26 @@ void PeerMessageQueue::DumpToHtml(std::ostream& out) const {
   }
   out << "</table>" << endl;
 
+  vector<PeerReplicationStats> stats;
+  GetPeerReplicationStatsUnlocked(&stats);
+  if (!stats.empty()) {
+    out << "<h3>Replication</h3>" << endl;
+    out << "<table>" << endl;
+    out << "  <tr><th>Peer</th><th>Lag (ops)</th><th>Ops in flight</th>"
+        << "<th>Bytes in flight</th><th>Since last ack</th><th>Requests</th>"
+        << "<th>RTT p50 (us)</th><th>RTT p99 (us)</th><th>RTT max (us)</th></tr>" << endl;
+    for (const PeerReplicationStats& s : stats) {
+      out << Substitute("  <tr><td>$0</td><td>$1</td><td>$2</td><td>$3</td><td>$4</td>"
+                        "<td>$5</td><td>$6</td><td>$7</td><td>$8</td></tr>",
+                        EscapeForHtmlToString(s.uuid), s.lag_ops, s.ops_in_flight,
+                        HumanReadableNumBytes::ToString(s.bytes_in_flight),
+                        s.time_since_last_ack.Initialized() ?
+                            s.time_since_last_ack.ToString() : "never",
+                        s.num_requests, s.rtt_p50_us, s.rtt_p99_us, s.rtt_max_us) << endl;
+    }
+    out << "</table>" << endl;
+  }
+
   log_cache_.DumpToHtml(out);
 }
 
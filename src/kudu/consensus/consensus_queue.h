@@ -18,9 +18,12 @@
 #ifndef KUDU_CONSENSUS_CONSENSUS_QUEUE_H_
 #define KUDU_CONSENSUS_CONSENSUS_QUEUE_H_
 
+#include <algorithm>
 #include <boost/optional.hpp>
+#include <deque>
 #include <iosfwd>
 #include <map>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -32,13 +35,16 @@
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/ref_counted_replicate.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/hdr_histogram.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 template<class T>
 class AtomicGauge;
+class Histogram;
 class MemTracker;
 class MetricEntity;
 class ThreadPool;
@@ -54,6 +60,28 @@ class TimeManager;
 // The id for the server-wide consensus queue MemTracker.
 extern const char kConsensusQueueParentTrackerId[];
 
+// The state of the replication to a peer, as seen by its leader.
+struct PeerReplicationStats {
+  std::string uuid;
+
+  // The number of operations in the leader's log which the peer hasn't acked.
+  int64_t lag_ops = 0;
+
+  // The operations sent to the peer which it hasn't acked yet, and their size.
+  int64_t ops_in_flight = 0;
+  int64_t bytes_in_flight = 0;
+
+  // The time since the peer last accepted a request without errors, or an
+  // uninitialized MonoDelta if it never did in the current leadership.
+  MonoDelta time_since_last_ack;
+
+  // The round-trip times of the requests to the peer, in microseconds.
+  uint64_t num_requests = 0;
+  uint64_t rtt_p50_us = 0;
+  uint64_t rtt_p99_us = 0;
+  uint64_t rtt_max_us = 0;
+};
+
 // Tracks the state of the peers and which transactions they have replicated.
 // Owns the LogCache which actually holds the replicate messages which are
 // en route to the various peers.
@@ -73,11 +101,14 @@ class PeerMessageQueue {
         : uuid(std::move(uuid)),
           is_new(true),
           next_index(kInvalidOpIdIndex),
+          pipelined_next_index(kInvalidOpIdIndex),
           last_received(MinimumOpId()),
           last_known_committed_index(MinimumOpId().index()),
           is_last_exchange_successful(false),
           last_successful_communication_time(MonoTime::Now()),
+          last_acked_request_send_time(MonoTime::Min()),
           needs_tablet_copy(false),
+          stats(std::make_shared<Stats>()),
           last_seen_term_(0) {}
 
     // Check that the terms seen from a given peer only increase
@@ -99,6 +130,16 @@ class PeerMessageQueue {
     // This corresponds to "nextIndex" as specified in Raft.
     int64_t next_index;
 
+    // The index following the last operation sent to the peer, if requests
+    // may still be in flight past 'next_index'. Pipelined requests start
+    // there. Rewound to 'next_index' when the peer rejects a request.
+    int64_t pipelined_next_index;
+
+    // The next index to send in a request pipelined behind those in flight.
+    int64_t next_index_to_send() const {
+      return std::max(next_index, pipelined_next_index);
+    }
+
     // The last operation that we've sent to this peer and that
     // it acked. Used for watermark movement.
     OpId last_received;
@@ -114,6 +155,11 @@ class PeerMessageQueue {
     // successful communication ever took place.
     MonoTime last_successful_communication_time;
 
+    // The time at which the latest request the peer accepted without errors
+    // was sent. Since the peer withholds its vote for an election timeout
+    // after accepting a request, this is used to calculate the leader's lease.
+    MonoTime last_acked_request_send_time;
+
     // Whether the follower was detected to need tablet copy.
     bool needs_tablet_copy;
 
@@ -121,6 +167,28 @@ class PeerMessageQueue {
     // peer (eg when it is lagging, etc).
     logging::LogThrottler status_log_throttler;
 
+    // Replication statistics for the peer. These are not part of the state
+    // snapshotted by copying this struct, so they're shared by the copies.
+    struct Stats {
+      // The largest round-trip time recorded, in microseconds. Kept small,
+      // along with the precision, since there's a histogram per peer.
+      static const uint64_t kMaxRttMicros = 10 * 1000 * 1000;
+
+      Stats() : rtt_histogram(kMaxRttMicros, 1) {}
+
+      // Round-trip times of the requests to the peer, in microseconds.
+      HdrHistogram rtt_histogram;
+
+      // The index of the last op and the size of each batch of ops sent to
+      // the peer and not acked yet, with the total size of the batches.
+      std::deque<std::pair<int64_t, int64_t>> batches_in_flight;
+      int64_t bytes_in_flight = 0;
+
+      // The last time the peer accepted a request without errors.
+      MonoTime last_ack_time;
+    };
+    std::shared_ptr<Stats> stats;
+
    private:
     // The last term we saw from a given peer.
     // This is only used for sanity checking that a peer doesn't
@@ -211,10 +279,15 @@ class PeerMessageQueue {
   // instance of ConsensusRequestPB to RequestForPeer(): the buffer will
   // replace the old entries with new ones without de-allocating the old
   // ones if they are still required.
+  //
+  // If 'pipelined' is true, the request follows those still in flight to the
+  // peer, and its operations start after the last ones sent to it. No
+  // operations are pipelined before the peer first responds.
   Status RequestForPeer(const std::string& uuid,
                         ConsensusRequestPB* request,
                         std::vector<ReplicateRefPtr>* msg_refs,
-                        bool* needs_tablet_copy);
+                        bool* needs_tablet_copy,
+                        bool pipelined = false);
 
   // Fill in a StartTabletCopyRequest for the specified peer.
   // If that peer should not initiate Tablet Copy, returns a non-OK status.
@@ -230,9 +303,28 @@ class PeerMessageQueue {
 
   // Updates the request queue with the latest response of a peer, returns
   // whether this peer has more requests pending.
+  //
+  // 'out_of_order' is true if the response is to a pipelined request which was
+  // sent before another one whose response was already handled. If it reports
+  // less progress than the peer already acked, it's stale and only tells that
+  // the peer is alive.
+  //
+  // 'request_send_time' is the time at which the request was sent, if known.
+  // It extends the leader's lease if leader leases are enabled.
   void ResponseFromPeer(const std::string& peer_uuid,
                         const ConsensusResponsePB& response,
-                        bool* more_pending);
+                        bool* more_pending,
+                        bool out_of_order = false,
+                        const MonoTime& request_send_time = MonoTime());
+
+  // Fills 'stats' with the state of the replication to each remote peer.
+  // Leaves it empty unless the queue is in LEADER mode.
+  void GetPeerReplicationStats(std::vector<PeerReplicationStats>* stats) const;
+
+  // Returns the duration of the leader's lease past the time a request
+  // acked by a majority was sent: slightly less than the minimum election
+  // timeout, to allow for the clocks of the peers running at different rates.
+  static MonoDelta LeaderLeaseDuration();
 
   // Called by the consensus implementation to update the queue's watermarks
   // based on information provided by the leader. This is used for metrics and
@@ -281,6 +373,10 @@ class PeerMessageQueue {
     scoped_refptr<AtomicGauge<int64_t> > num_majority_done_ops;
     // Keeps track of the number of ops. that are still in progress (IsDone() returns false).
     scoped_refptr<AtomicGauge<int64_t> > num_in_progress_ops;
+    // Keeps track of the number of ops. the peer which lags the most hasn't acked.
+    scoped_refptr<AtomicGauge<int64_t> > max_peer_lag_ops;
+    // Round-trip times of the requests to the peers.
+    scoped_refptr<Histogram> peer_update_rtt;
 
     explicit Metrics(const scoped_refptr<MetricEntity>& metric_entity);
   };
@@ -376,6 +472,8 @@ class PeerMessageQueue {
 
   void DumpToStringsUnlocked(std::vector<std::string>* lines) const;
 
+  void GetPeerReplicationStatsUnlocked(std::vector<PeerReplicationStats>* stats) const;
+
   // Updates the metrics based on index math.
   void UpdateMetrics();
 
@@ -397,6 +495,11 @@ class PeerMessageQueue {
                                const StatusCallback& callback,
                                const Status& status);
 
+  // Calculates the leader's lease from the times at which the requests acked
+  // by the voters were sent, and hands it to the TimeManager. Does nothing
+  // unless leader leases are enabled and the queue is in LEADER mode.
+  void UpdateLeaderLeaseUnlocked();
+
   // Advances 'watermark' to the smallest op that 'num_peers_required' have.
   void AdvanceQueueWatermark(const char* type,
                              int64_t* watermark,
@@ -421,6 +524,10 @@ class PeerMessageQueue {
 
   // The currently tracked peers.
   PeersMap peers_map_;
+
+  // The time at which the queue went to LEADER mode in the current term.
+  MonoTime leader_since_;
+
   mutable simple_spinlock queue_lock_; // TODO: rename
 
   // We assume that we never have multiple threads racing to append to the queue.
@@ -19,6 +19,7 @@
 #include <limits>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/bind.hpp>
@@ -43,6 +44,9 @@ DECLARE_double(log_inject_io_error_on_preallocate_fraction);
 DECLARE_int64(fs_wal_dir_reserved_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 DECLARE_string(log_compression_codec);
+DECLARE_bool(log_group_commit_across_tablets);
+DECLARE_int32(log_group_commit_max_delay_us);
+DECLARE_int32(log_index_checkpoint_interval_bytes);
 
 namespace kudu {
 namespace log {
@@ -397,6 +401,59 @@ TEST_P(LogTestOptionalCompression, TestSegmentRollover) {
   ASSERT_EQ(num_entries, entries_.size());
 }
 
+// Tests that index checkpoints are written to the segments, and that they are
+// used to rebuild the footer of a segment left without one and to seek to
+// ops without a LogIndex.
+TEST_P(LogTestOptionalCompression, TestIndexCheckpoints) {
+  // Write a checkpoint before every batch.
+  FLAGS_log_index_checkpoint_interval_bytes = 1;
+  ASSERT_OK(BuildLog());
+  const int kNumEntries = 20;
+  OpId op_id = MakeOpId(1, 1);
+  ASSERT_OK(AppendNoOps(&op_id, kNumEntries));
+
+  // The active segment has no footer yet, so a new reader has to rebuild it.
+  shared_ptr<LogReader> reader;
+  ASSERT_OK(LogReader::Open(fs_manager_.get(), nullptr, kTestTablet, nullptr, &reader));
+  SegmentSequence segments;
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+  ASSERT_EQ(1, segments.size());
+  LogSegmentFooterPB rebuilt_footer = segments[0]->footer();
+  ASSERT_EQ(kNumEntries, rebuilt_footer.num_entries());
+  ASSERT_EQ(1, rebuilt_footer.min_replicate_index());
+  ASSERT_EQ(kNumEntries, rebuilt_footer.max_replicate_index());
+  ASSERT_EQ(kNumEntries, rebuilt_footer.index_checkpoints_size());
+
+  // Seek to every op without a LogIndex.
+  vector<ReplicateMsg*> replicates;
+  ElementDeleter d(&replicates);
+  ASSERT_OK(reader->ReadReplicatesInRange(1, kNumEntries, LogReader::kNoSizeLimit,
+                                          &replicates));
+  ASSERT_EQ(kNumEntries, replicates.size());
+  for (int i = 0; i < kNumEntries; i++) {
+    ASSERT_EQ(i + 1, replicates[i]->id().index());
+  }
+
+  // Once the segment is closed, its footer should describe the same regions.
+  ASSERT_OK(log_->Close());
+  ASSERT_OK(LogReader::Open(fs_manager_.get(), nullptr, kTestTablet, nullptr, &reader));
+  ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+  ASSERT_EQ(1, segments.size());
+  const LogSegmentFooterPB& footer = segments[0]->footer();
+  ASSERT_EQ(rebuilt_footer.num_entries(), footer.num_entries());
+  ASSERT_EQ(rebuilt_footer.index_checkpoints_size(), footer.index_checkpoints_size());
+  for (int i = 0; i < footer.index_checkpoints_size(); i++) {
+    ASSERT_EQ(SecureShortDebugString(rebuilt_footer.index_checkpoints(i)),
+              SecureShortDebugString(footer.index_checkpoints(i)));
+  }
+  ASSERT_OK(segments[0]->ReadEntries(&entries_));
+  ASSERT_EQ(kNumEntries, entries_.size());
+  OpId found_op_id;
+  ASSERT_OK(reader->LookupOpId(kNumEntries / 2, &found_op_id));
+  ASSERT_EQ(kNumEntries / 2, found_op_id.index());
+  ASSERT_TRUE(reader->LookupOpId(kNumEntries + 1, &found_op_id).IsNotFound());
+}
+
 TEST_F(LogTest, TestWriteAndReadToAndFromInProgressSegment) {
   FLAGS_log_compression_codec = "none";
 
@@ -741,6 +798,55 @@ TEST_P(LogTestOptionalCompression, TestWriteManyBatches) {
   }
 }
 
+// Tests that the logs of several tablets sharing an append thread each get
+// their own entries, including those appended while they're being closed.
+TEST_F(LogTest, TestGroupCommitAcrossTablets) {
+  FLAGS_log_group_commit_across_tablets = true;
+  options_.force_fsync_all = true;
+  const int kNumLogs = 4;
+  const int kNumBatches = 20;
+  const Schema schema_with_ids = SchemaBuilder(schema_).Build();
+
+  vector<scoped_refptr<Log>> logs(kNumLogs);
+  for (int i = 0; i < kNumLogs; i++) {
+    ASSERT_OK(Log::Open(options_, fs_manager_.get(), Substitute("tablet-$0", i),
+                        schema_with_ids, 0, nullptr, &logs[i]));
+  }
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumLogs; i++) {
+    threads.emplace_back([&, i]() {
+      OpId op_id = MakeOpId(1, 1);
+      for (int j = 0; j < kNumBatches; j++) {
+        CHECK_OK(AppendNoOpsToLogSync(clock_, logs[i].get(), &op_id, i + 1));
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (const auto& log : logs) {
+    ASSERT_OK(log->Close());
+  }
+
+  for (int i = 0; i < kNumLogs; i++) {
+    shared_ptr<LogReader> reader;
+    ASSERT_OK(LogReader::Open(fs_manager_.get(), nullptr, Substitute("tablet-$0", i),
+                              nullptr, &reader));
+    SegmentSequence segments;
+    ASSERT_OK(reader->GetSegmentsSnapshot(&segments));
+    int num_entries = 0;
+    for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
+      STLDeleteElements(&entries_);
+      ASSERT_OK(segment->ReadEntries(&entries_));
+      for (const LogEntryPB* entry : entries_) {
+        ASSERT_EQ(REPLICATE, entry->type());
+        ASSERT_EQ(++num_entries, entry->replicate().id().index());
+      }
+    }
+    ASSERT_EQ(kNumBatches * (i + 1), num_entries);
+  }
+}
+
 // This tests that querying LogReader works.
 // This sets up a reader with some segments to query which amount to the
 // following:
@@ -1076,5 +1182,59 @@ TEST_F(LogTest, TestDiskSpaceCheck) {
   // detect that we are past the preallocation limit.
 }
 
+// Tests that the group commit delay follows the sync latency and the arrival
+// rate of the entry batches.
+TEST(GroupCommitTunerTest, TestDelay) {
+  const MonoDelta kMaxDelay = MonoDelta::FromMilliseconds(10);
+  GroupCommitTuner tuner;
+
+  // Nothing is known yet.
+  ASSERT_EQ(0, tuner.Delay(kMaxDelay).ToMicroseconds());
+
+  // Syncs take 4ms. A batch per 100us is expected to bring batches while
+  // waiting for half a sync.
+  MonoTime now = MonoTime::Now();
+  for (int i = 0; i < 100; i++) {
+    tuner.RecordSync(MonoDelta::FromMilliseconds(4));
+    now += MonoDelta::FromMilliseconds(4);
+    tuner.RecordGroup(40, now);
+  }
+  MonoDelta delay = tuner.Delay(kMaxDelay);
+  ASSERT_NEAR(2000, delay.ToMicroseconds(), 10);
+
+  // The delay is bounded.
+  ASSERT_EQ(1000, tuner.Delay(MonoDelta::FromMilliseconds(1)).ToMicroseconds());
+  ASSERT_EQ(0, tuner.Delay(MonoDelta::FromMicroseconds(0)).ToMicroseconds());
+
+  // When a batch arrives every 100ms, none is expected within the delay.
+  for (int i = 0; i < 100; i++) {
+    now += MonoDelta::FromMilliseconds(100);
+    tuner.RecordGroup(1, now);
+  }
+  ASSERT_EQ(0, tuner.Delay(kMaxDelay).ToMicroseconds());
+}
+
+// Tests that a log waiting for groups to grow still appends everything.
+TEST_F(LogTest, TestAdaptiveGroupCommit) {
+  FLAGS_log_group_commit_max_delay_us = 5000;
+  options_.force_fsync_all = true;
+  ASSERT_OK(BuildLog());
+
+  OpId opid = MakeOpId(1, 1);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_OK(AppendNoOp(&opid));
+  }
+  ASSERT_OK(log_->Close());
+
+  vector<LogEntryPB*> entries;
+  ElementDeleter deleter(&entries);
+  SegmentSequence segments;
+  ASSERT_OK(log_->reader()->GetSegmentsSnapshot(&segments));
+  for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
+    ASSERT_OK(segment->ReadEntries(&entries));
+  }
+  ASSERT_EQ(100, entries.size());
+}
+
 } // namespace log
 } // namespace kudu
@@ -21,6 +21,8 @@
 #include <limits>
 #include <memory>
 #include <mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <boost/range/adaptor/reversed.hpp>
 
@@ -29,6 +31,7 @@
 #include "kudu/consensus/log_metrics.h"
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/log_util.h"
+#include "kudu/fs/dir_io_metrics.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/ref_counted.h"
@@ -37,6 +40,7 @@
 #include "kudu/gutil/walltime.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env_util.h"
@@ -45,6 +49,7 @@
 #include "kudu/util/kernel_stack_watchdog.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random.h"
@@ -77,6 +82,33 @@ DEFINE_int32(group_commit_queue_size_bytes, 4 * 1024 * 1024,
              "Maximum size of the group commit queue in bytes");
 TAG_FLAG(group_commit_queue_size_bytes, advanced);
 
+DEFINE_bool(log_group_commit_across_tablets, false,
+            "If true, the logs of all the tablets in the same WAL directory are "
+            "appended to and synced by a single thread, which group-commits the "
+            "entry batches of all the tablets together, rather than each log having "
+            "its own append thread. This makes the syncs of many tablets overlap "
+            "rather than queue up behind each other; see --log_force_fsync_all.");
+TAG_FLAG(log_group_commit_across_tablets, experimental);
+
+DEFINE_int32(log_group_commit_max_delay_us, 0,
+             "Maximum number of microseconds the log append thread waits, once it "
+             "has entry batches to append, for more to arrive before appending and "
+             "syncing them as one group. The actual delay is tuned from the measured "
+             "fsync latency of the log and the arrival rate of the entry batches, and "
+             "is zero when the log is lightly loaded. If 0, the thread never waits. "
+             "Only effective if --log_force_fsync_all is set.");
+TAG_FLAG(log_group_commit_max_delay_us, experimental);
+TAG_FLAG(log_group_commit_max_delay_us, runtime);
+
+
+DEFINE_int32(log_index_checkpoint_interval_bytes, 1024 * 1024,
+             "Number of bytes of entries after which an index checkpoint is written to "
+             "the active WAL segment. Index checkpoints let readers seek to an op in a "
+             "segment, and let a segment left without a footer by a crash be recovered "
+             "by reading only the entries after the last checkpoint. If 0, no index "
+             "checkpoints are written.");
+TAG_FLAG(log_index_checkpoint_interval_bytes, experimental);
+TAG_FLAG(log_index_checkpoint_interval_bytes, runtime);
 
 // Compression configuration.
 // -----------------------------
@@ -186,11 +218,175 @@ Status Log::AppendThread::Init() {
   return Status::OK();
 }
 
+// This class is responsible for managing the thread that appends to, and
+// syncs, all the logs in a WAL directory when --log_group_commit_across_tablets
+// is set.
+//
+// Each round, the thread appends the batches queued by every log which has
+// any, starting the writeback of each segment to be synced as soon as its
+// batches are appended, and only then waits for each of the syncs. The syncs
+// of many tablets thus overlap, as those of the blocks closed together by the
+// block managers do.
+class Log::SharedAppendThread {
+ public:
+  // Sets 'thread' to the thread for the logs in 'wal_dir', starting it if
+  // there is none.
+  static Status Get(const string& wal_dir, shared_ptr<SharedAppendThread>* thread);
+
+  // Stops the thread. All the logs must have been unregistered.
+  ~SharedAppendThread();
+
+  // Adds 'log' to the logs processed by the thread.
+  void Register(Log* log);
+
+  // Signals that 'log' has batches ready to be appended.
+  void Notify(Log* log);
+
+  // Removes 'log' from the logs processed by the thread, waiting for the
+  // round processing it, if any, to finish. Batches queued by 'log' after
+  // that round are left in its queue.
+  void Unregister(Log* log);
+
+ private:
+  explicit SharedAppendThread(string wal_dir);
+
+  void RunThread();
+
+  const string wal_dir_;
+
+  // Protects the members below.
+  Mutex lock_;
+  ConditionVariable cond_;
+
+  std::unordered_set<Log*> registered_;
+
+  // The logs to process in the next round, and in the current one.
+  std::unordered_set<Log*> pending_;
+  std::unordered_set<Log*> active_;
+
+  bool shutting_down_;
+
+  scoped_refptr<Thread> thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedAppendThread);
+};
+
+Status Log::SharedAppendThread::Get(const string& wal_dir,
+                                    shared_ptr<SharedAppendThread>* thread) {
+  static std::mutex registry_lock;
+  static auto* registry = new std::unordered_map<string, std::weak_ptr<SharedAppendThread>>();
+
+  std::lock_guard<std::mutex> l(registry_lock);
+  *thread = (*registry)[wal_dir].lock();
+  if (*thread) {
+    return Status::OK();
+  }
+  shared_ptr<SharedAppendThread> new_thread(new SharedAppendThread(wal_dir));
+  RETURN_NOT_OK(kudu::Thread::Create("log", "shared-appender",
+      &SharedAppendThread::RunThread, new_thread.get(), &new_thread->thread_));
+  (*registry)[wal_dir] = new_thread;
+  *thread = std::move(new_thread);
+  return Status::OK();
+}
+
+Log::SharedAppendThread::SharedAppendThread(string wal_dir)
+    : wal_dir_(std::move(wal_dir)),
+      cond_(&lock_),
+      shutting_down_(false) {
+}
+
+Log::SharedAppendThread::~SharedAppendThread() {
+  {
+    MutexLock l(lock_);
+    DCHECK(registered_.empty());
+    shutting_down_ = true;
+    cond_.Broadcast();
+  }
+  if (thread_) {
+    CHECK_OK(ThreadJoiner(thread_.get()).Join());
+  }
+}
+
+void Log::SharedAppendThread::Register(Log* log) {
+  MutexLock l(lock_);
+  InsertOrDie(&registered_, log);
+}
+
+void Log::SharedAppendThread::Notify(Log* log) {
+  MutexLock l(lock_);
+  if (PREDICT_FALSE(!ContainsKey(registered_, log))) {
+    return;
+  }
+  if (pending_.empty()) {
+    cond_.Signal();
+  }
+  pending_.insert(log);
+}
+
+void Log::SharedAppendThread::Unregister(Log* log) {
+  MutexLock l(lock_);
+  registered_.erase(log);
+  pending_.erase(log);
+  while (ContainsKey(active_, log)) {
+    cond_.Wait();
+  }
+}
+
+void Log::SharedAppendThread::RunThread() {
+  while (true) {
+    vector<Log*> logs;
+    {
+      MutexLock l(lock_);
+      while (pending_.empty() && !shutting_down_) {
+        cond_.Wait();
+      }
+      if (pending_.empty()) {
+        break;
+      }
+      DCHECK(active_.empty());
+      active_.swap(pending_);
+      logs.assign(active_.begin(), active_.end());
+    }
+    TRACE_EVENT1("log", "shared batch", "num_logs", logs.size());
+
+    vector<vector<LogEntryBatch*>> entry_batches(logs.size());
+    vector<bool> needs_sync(logs.size());
+    for (int i = 0; i < logs.size(); i++) {
+      Log* log = logs[i];
+      // The batches may have been appended by an earlier round.
+      if (!log->entry_queue()->DrainTo(&entry_batches[i])) {
+        continue;
+      }
+      if (log->metrics_) {
+        log->metrics_->entry_batches_per_group->Increment(entry_batches[i].size());
+      }
+      needs_sync[i] = log->AppendBatches(entry_batches[i]);
+      if (needs_sync[i]) {
+        WARN_NOT_OK(log->StartSync(), log->LogPrefix() + "Unable to start syncing log");
+      }
+    }
+    for (int i = 0; i < logs.size(); i++) {
+      if (entry_batches[i].empty()) {
+        continue;
+      }
+      Status s;
+      if (needs_sync[i]) {
+        s = logs[i]->Sync();
+      }
+      logs[i]->CompleteBatches(&entry_batches[i], s);
+    }
+
+    MutexLock l(lock_);
+    active_.clear();
+    cond_.Broadcast();
+  }
+  VLOG(1) << "Exiting shared AppendThread for " << wal_dir_;
+}
+
 void Log::AppendThread::RunThread() {
   bool shutting_down = false;
   while (PREDICT_TRUE(!shutting_down)) {
     vector<LogEntryBatch*> entry_batches;
-    ElementDeleter d(&entry_batches);
 
     // We shut down the entry_queue when it's time to shut down the append
     // thread, which causes this call to return false, while still populating
@@ -201,6 +397,16 @@ void Log::AppendThread::RunThread() {
       shutting_down = true;
     }
 
+    // Give more batches a chance to join the group, if they're expected to
+    // arrive soon enough.
+    MonoDelta delay = log_->group_commit_tuner_.Delay(
+        MonoDelta::FromMicroseconds(FLAGS_log_group_commit_max_delay_us));
+    if (!shutting_down && delay.ToMicroseconds() > 0) {
+      SleepFor(delay);
+      log_->entry_queue()->DrainTo(&entry_batches);
+    }
+    log_->group_commit_tuner_.RecordGroup(entry_batches.size(), MonoTime::Now());
+
     if (log_->metrics_) {
       log_->metrics_->entry_batches_per_group->Increment(entry_batches.size());
     }
@@ -208,56 +414,64 @@ void Log::AppendThread::RunThread() {
 
     SCOPED_LATENCY_METRIC(log_->metrics_, group_commit_latency);
 
-    bool is_all_commits = true;
-    for (LogEntryBatch* entry_batch : entry_batches) {
-      entry_batch->WaitForReady();
-      TRACE_EVENT_FLOW_END0("log", "Batch", entry_batch);
-      Status s = log_->DoAppend(entry_batch);
-      if (PREDICT_FALSE(!s.ok())) {
-        LOG_WITH_PREFIX(ERROR) << "Error appending to the log: " << s.ToString();
-        entry_batch->set_failed_to_append();
-        // TODO(af): If a single transaction fails to append, should we
-        // abort all subsequent transactions in this batch or allow
-        // them to be appended? What about transactions in future
-        // batches?
-        if (!entry_batch->callback().is_null()) {
-          entry_batch->callback().Run(s);
-        }
-      }
-      if (is_all_commits && entry_batch->type_ != COMMIT) {
-        is_all_commits = false;
-      }
-    }
-
     Status s;
-    if (!is_all_commits) {
+    if (log_->AppendBatches(entry_batches)) {
       s = log_->Sync();
     }
+    log_->CompleteBatches(&entry_batches, s);
+  }
+  VLOG_WITH_PREFIX(1) << "Exiting AppendThread";
+}
+
+bool Log::AppendBatches(const vector<LogEntryBatch*>& entry_batches) {
+  bool is_all_commits = true;
+  for (LogEntryBatch* entry_batch : entry_batches) {
+    entry_batch->WaitForReady();
+    TRACE_EVENT_FLOW_END0("log", "Batch", entry_batch);
+    Status s = DoAppend(entry_batch);
     if (PREDICT_FALSE(!s.ok())) {
-      LOG_WITH_PREFIX(ERROR) << "Error syncing log: " << s.ToString();
-      for (LogEntryBatch* entry_batch : entry_batches) {
-        if (!entry_batch->callback().is_null()) {
-          entry_batch->callback().Run(s);
-        }
+      LOG_WITH_PREFIX(ERROR) << "Error appending to the log: " << s.ToString();
+      entry_batch->set_failed_to_append();
+      // TODO(af): If a single transaction fails to append, should we
+      // abort all subsequent transactions in this batch or allow
+      // them to be appended? What about transactions in future
+      // batches?
+      if (!entry_batch->callback().is_null()) {
+        entry_batch->callback().Run(s);
       }
-    } else {
-      TRACE_EVENT0("log", "Callbacks");
-      VLOG_WITH_PREFIX(2) << "Synchronized " << entry_batches.size() << " entry batches";
-      SCOPED_WATCH_STACK(100);
-      for (LogEntryBatch* entry_batch : entry_batches) {
-        if (PREDICT_TRUE(!entry_batch->failed_to_append()
-                         && !entry_batch->callback().is_null())) {
-          entry_batch->callback().Run(Status::OK());
-        }
-        // It's important to delete each batch as we see it, because
-        // deleting it may free up memory from memory trackers, and the
-        // callback of a later batch may want to use that memory.
-        delete entry_batch;
+    }
+    if (is_all_commits && entry_batch->type_ != COMMIT) {
+      is_all_commits = false;
+    }
+  }
+  return !is_all_commits;
+}
+
+void Log::CompleteBatches(vector<LogEntryBatch*>* entry_batches, const Status& s) {
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG_WITH_PREFIX(ERROR) << "Error syncing log: " << s.ToString();
+    for (LogEntryBatch* entry_batch : *entry_batches) {
+      if (!entry_batch->callback().is_null()) {
+        entry_batch->callback().Run(s);
       }
-      entry_batches.clear();
     }
+    STLDeleteElements(entry_batches);
+    return;
   }
-  VLOG_WITH_PREFIX(1) << "Exiting AppendThread";
+  TRACE_EVENT0("log", "Callbacks");
+  VLOG_WITH_PREFIX(2) << "Synchronized " << entry_batches->size() << " entry batches";
+  SCOPED_WATCH_STACK(100);
+  for (LogEntryBatch* entry_batch : *entry_batches) {
+    if (PREDICT_TRUE(!entry_batch->failed_to_append()
+                     && !entry_batch->callback().is_null())) {
+      entry_batch->callback().Run(Status::OK());
+    }
+    // It's important to delete each batch as we see it, because
+    // deleting it may free up memory from memory trackers, and the
+    // callback of a later batch may want to use that memory.
+    delete entry_batch;
+  }
+  entry_batches->clear();
 }
 
 void Log::AppendThread::Shutdown() {
@@ -320,11 +534,13 @@ Log::Log(LogOptions options, FsManager* fs_manager, string log_path,
       schema_version_(schema_version),
       active_segment_sequence_number_(0),
       log_state_(kLogInitialized),
+      last_index_checkpoint_offset_(-1),
       max_segment_size_(options_.segment_size_mb * 1024 * 1024),
       entry_batch_queue_(FLAGS_group_commit_queue_size_bytes),
       append_thread_(new AppendThread(this)),
       force_sync_all_(options_.force_fsync_all),
       sync_disabled_(false),
+      unsynced_bytes_(0),
       allocation_state_(kAllocationNotStarted),
       codec_(nullptr),
       metric_entity_(metric_entity) {
@@ -381,7 +597,13 @@ Status Log::Init() {
   RETURN_NOT_OK(allocation_status_.Get());
   RETURN_NOT_OK(SwitchToAllocatedSegment());
 
-  RETURN_NOT_OK(append_thread_->Init());
+  if (FLAGS_log_group_commit_across_tablets) {
+    RETURN_NOT_OK(SharedAppendThread::Get(fs_manager_->GetWalsRootDir(),
+                                          &shared_append_thread_));
+    shared_append_thread_->Register(this);
+  } else {
+    RETURN_NOT_OK(append_thread_->Init());
+  }
   log_state_ = kLogWriting;
   return Status::OK();
 }
@@ -404,6 +626,12 @@ Status Log::CloseCurrentSegment() {
   VLOG_WITH_PREFIX(2) << "Segment footer for " << active_segment_->path()
                       << ": " << SecureShortDebugString(footer_builder_);
 
+  // The footer also describes the region following the last checkpoint, so
+  // that the whole segment is indexed.
+  if (footer_builder_.index_checkpoints_size() > 0 ||
+      FLAGS_log_index_checkpoint_interval_bytes > 0) {
+    *footer_builder_.add_index_checkpoints() = index_checkpoint_builder_;
+  }
   footer_builder_.set_close_timestamp_micros(GetCurrentTimeMicros());
   RETURN_NOT_OK(active_segment_->WriteFooterAndClose(footer_builder_));
 
@@ -475,6 +703,9 @@ void Log::AsyncAppend(LogEntryBatch* entry_batch, const StatusCallback& callback
   TRACE("Serialized $0 byte log entry", entry_batch->total_size_bytes());
   TRACE_EVENT_FLOW_BEGIN0("log", "Batch", entry_batch);
   entry_batch->MarkReady();
+  if (shared_append_thread_) {
+    shared_append_thread_->Notify(this);
+  }
 }
 
 Status Log::AsyncAppendReplicates(const vector<ReplicateRefPtr>& replicates,
@@ -554,13 +785,23 @@ Status Log::DoAppend(LogEntryBatch* entry_batch) {
     VLOG_WITH_PREFIX(1) << "Segment allocation already in progress...";
   }
 
+  if (FLAGS_log_index_checkpoint_interval_bytes > 0 &&
+      active_segment_->written_offset() - index_checkpoint_builder_.region_offset() >=
+      FLAGS_log_index_checkpoint_interval_bytes) {
+    RETURN_NOT_OK(WriteIndexCheckpoint());
+  }
+
   int64_t start_offset = active_segment_->written_offset();
 
   LOG_SLOW_EXECUTION(WARNING, 50, Substitute("$0Append to log took a long time", LogPrefix())) {
     SCOPED_LATENCY_METRIC(metrics_, append_latency);
     SCOPED_WATCH_STACK(500);
 
-    RETURN_NOT_OK(active_segment_->WriteEntryBatch(entry_batch_data, codec_));
+    {
+      fs::ScopedDirIo io(fs_manager_->wal_io_metrics(), fs::DirIoMetrics::WRITE,
+                         active_segment_->path());
+      RETURN_NOT_OK(active_segment_->WriteEntryBatch(entry_batch_data, codec_));
+    }
 
     // Update the reader on how far it can read the active segment.
     reader_->UpdateLastSegmentOffset(active_segment_->written_offset());
@@ -573,6 +814,7 @@ Status Log::DoAppend(LogEntryBatch* entry_batch) {
   if (metrics_) {
     metrics_->bytes_logged->IncrementBy(entry_batch_bytes);
   }
+  unsynced_bytes_ += entry_batch_bytes;
 
   CHECK_OK(UpdateIndexForBatch(*entry_batch, start_offset));
   UpdateFooterForBatch(entry_batch);
@@ -597,8 +839,33 @@ Status Log::UpdateIndexForBatch(const LogEntryBatch& batch,
   return Status::OK();
 }
 
+Status Log::WriteIndexCheckpoint() {
+  LogEntryBatchPB batch;
+  LogSegmentIndexCheckpointPB* checkpoint = batch.mutable_index_checkpoint();
+  *checkpoint = index_checkpoint_builder_;
+  if (last_index_checkpoint_offset_ >= 0) {
+    checkpoint->set_previous_checkpoint_offset(last_index_checkpoint_offset_);
+  }
+  faststring buf;
+  pb_util::AppendToString(batch, &buf);
+
+  int64_t offset = active_segment_->written_offset();
+  RETURN_NOT_OK(active_segment_->WriteEntryBatch(Slice(buf), codec_));
+  reader_->UpdateLastSegmentOffset(active_segment_->written_offset());
+  unsynced_bytes_ += active_segment_->written_offset() - offset;
+
+  *footer_builder_.add_index_checkpoints() = index_checkpoint_builder_;
+  last_index_checkpoint_offset_ = offset;
+  index_checkpoint_builder_.Clear();
+  index_checkpoint_builder_.set_region_offset(active_segment_->written_offset());
+  index_checkpoint_builder_.set_num_entries(0);
+  return Status::OK();
+}
+
 void Log::UpdateFooterForBatch(LogEntryBatch* batch) {
   footer_builder_.set_num_entries(footer_builder_.num_entries() + batch->count());
+  index_checkpoint_builder_.set_num_entries(
+      index_checkpoint_builder_.num_entries() + batch->count());
 
   // We keep track of the last-written OpId here.
   // This is needed to initialize Consensus on startup.
@@ -609,6 +876,7 @@ void Log::UpdateFooterForBatch(LogEntryBatch* batch) {
     // Update the index bounds for the current segment.
     for (const LogEntryPB& entry_pb : batch->entry_batch_pb_->entry()) {
       UpdateFooterForReplicateEntry(entry_pb, &footer_builder_);
+      UpdateIndexCheckpointForReplicateEntry(entry_pb, &index_checkpoint_builder_);
     }
   }
 }
@@ -637,14 +905,24 @@ Status Log::Sync() {
   }
 
   if (force_sync_all_ && !sync_disabled_) {
+    MonoTime start = MonoTime::Now();
     LOG_SLOW_EXECUTION(WARNING, 50, Substitute("$0Fsync log took a long time", LogPrefix())) {
-      RETURN_NOT_OK(active_segment_->Sync());
+      {
+        fs::ScopedDirIo io(fs_manager_->wal_io_metrics(), fs::DirIoMetrics::SYNC,
+                           active_segment_->path());
+        RETURN_NOT_OK(active_segment_->Sync());
+      }
 
       if (log_hooks_) {
         RETURN_NOT_OK_PREPEND(log_hooks_->PostSyncIfFsyncEnabled(),
                               "PostSyncIfFsyncEnabled hook failed");
       }
     }
+    group_commit_tuner_.RecordSync(MonoTime::Now() - start);
+    if (metrics_) {
+      metrics_->bytes_per_sync->Increment(unsynced_bytes_);
+    }
+    unsynced_bytes_ = 0;
   }
 
   if (log_hooks_) {
@@ -653,6 +931,44 @@ Status Log::Sync() {
   return Status::OK();
 }
 
+Status Log::StartSync() {
+  if (force_sync_all_ && !sync_disabled_) {
+    return active_segment_->FlushAsync();
+  }
+  return Status::OK();
+}
+
+// The weight of the latest sample in the moving averages of GroupCommitTuner.
+static const double kGroupCommitTunerAlpha = 0.2;
+
+GroupCommitTuner::GroupCommitTuner()
+    : sync_latency_us_(0),
+      batches_per_us_(0) {
+}
+
+void GroupCommitTuner::RecordGroup(int num_batches, const MonoTime& now) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (last_group_time_.Initialized()) {
+    double interval_us = std::max<double>((now - last_group_time_).ToMicroseconds(), 1);
+    batches_per_us_ += kGroupCommitTunerAlpha * (num_batches / interval_us - batches_per_us_);
+  }
+  last_group_time_ = now;
+}
+
+void GroupCommitTuner::RecordSync(const MonoDelta& latency) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  sync_latency_us_ += kGroupCommitTunerAlpha * (latency.ToMicroseconds() - sync_latency_us_);
+}
+
+MonoDelta GroupCommitTuner::Delay(const MonoDelta& max_delay) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  double delay_us = std::min<double>(sync_latency_us_ / 2, max_delay.ToMicroseconds());
+  if (delay_us <= 0 || batches_per_us_ * delay_us < 1) {
+    return MonoDelta::FromMicroseconds(0);
+  }
+  return MonoDelta::FromMicroseconds(static_cast<int64_t>(delay_us));
+}
+
 int GetPrefixSizeToGC(RetentionIndexes retention_indexes, const SegmentSequence& segments) {
   int rem_segs = segments.size();
   int prefix_size = 0;
@@ -822,7 +1138,21 @@ void Log::SetSchemaForNextLogSegment(const Schema& schema,
 
 Status Log::Close() {
   allocation_pool_->Shutdown();
-  append_thread_->Shutdown();
+  if (shared_append_thread_) {
+    // Append whatever the shared thread left in the queue ourselves.
+    entry_batch_queue_.Shutdown();
+    shared_append_thread_->Unregister(this);
+    vector<LogEntryBatch*> entry_batches;
+    if (entry_batch_queue_.DrainTo(&entry_batches)) {
+      Status s;
+      if (AppendBatches(entry_batches)) {
+        s = Sync();
+      }
+      CompleteBatches(&entry_batches, s);
+    }
+  } else {
+    append_thread_->Shutdown();
+  }
 
   std::lock_guard<percpu_rwlock> l(state_lock_);
   switch (log_state_) {
@@ -945,6 +1275,10 @@ Status Log::SwitchToAllocatedSegment() {
   }
 
   RETURN_NOT_OK(new_segment->WriteHeaderAndOpen(header));
+  index_checkpoint_builder_.Clear();
+  index_checkpoint_builder_.set_region_offset(new_segment->first_entry_offset());
+  index_checkpoint_builder_.set_num_entries(0);
+  last_index_checkpoint_offset_ = -1;
 
   // Transform the currently-active segment into a readable one, since we
   // need to be able to replay the segments for other peers.
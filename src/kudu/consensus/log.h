@@ -33,6 +33,7 @@
 #include "kudu/util/async_util.h"
 #include "kudu/util/blocking_queue.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/rw_mutex.h"
 #include "kudu/util/promise.h"
 #include "kudu/util/status.h"
@@ -54,6 +55,44 @@ class LogReader;
 
 typedef BlockingQueue<LogEntryBatch*, LogEntryBatchLogicalSize> LogEntryBatchQueue;
 
+// Tunes how long a log append thread waits, once it has drained some entry
+// batches from the queue, for more to arrive before appending and syncing
+// them as one group (see --log_group_commit_max_delay_us).
+//
+// Waiting is only worth it if the wait is short compared to a sync, and if
+// another batch is likely to arrive meanwhile. So the delay is half of the
+// average sync latency, bounded by the maximum, and zero unless the average
+// arrival rate of the batches makes at least one arrival expected within it.
+// This keeps a lightly loaded log from waiting at all.
+//
+// Thread-safe.
+class GroupCommitTuner {
+ public:
+  GroupCommitTuner();
+
+  // Records that 'num_batches' entry batches were drained from the queue, as
+  // one group, at time 'now'.
+  void RecordGroup(int num_batches, const MonoTime& now);
+
+  // Records the latency of a sync of the log.
+  void RecordSync(const MonoDelta& latency);
+
+  // Returns how long to wait for more batches to join a group, at most
+  // 'max_delay'.
+  MonoDelta Delay(const MonoDelta& max_delay) const;
+
+ private:
+  mutable simple_spinlock lock_;
+
+  // Exponentially-weighted moving averages of the sync latency and of the
+  // number of batches arriving per microsecond.
+  double sync_latency_us_;
+  double batches_per_us_;
+
+  // The time the last group was drained, or uninitialized if none was.
+  MonoTime last_group_time_;
+};
+
 // Log interface, inspired by Raft's (logcabin) Log. Provides durability to
 // Kudu as a normal Write Ahead Log and also plays the role of persistent
 // storage for the consensus state machine.
@@ -256,6 +295,7 @@ class Log : public RefCountedThreadSafe<Log> {
   FRIEND_TEST(LogTest, TestWriteAndReadToAndFromInProgressSegment);
 
   class AppendThread;
+  class SharedAppendThread;
 
   // Log state.
   enum LogState {
@@ -308,6 +348,10 @@ class Log : public RefCountedThreadSafe<Log> {
   // Update footer_builder_ to reflect the log indexes seen in 'batch'.
   void UpdateFooterForBatch(LogEntryBatch* batch);
 
+  // Writes an index checkpoint for the current region of the active segment
+  // to the segment, and starts a new region.
+  Status WriteIndexCheckpoint();
+
   // Update the LogIndex to include entries for the replicate messages found in
   // 'batch'. The index entry points to the offset 'start_offset' in the current
   // log segment.
@@ -320,6 +364,19 @@ class Log : public RefCountedThreadSafe<Log> {
 
   Status Sync();
 
+  // Starts writing back the data appended to the active segment, if it's
+  // synced at all, so that Sync() has less to wait for.
+  Status StartSync();
+
+  // Appends 'entry_batches', which were drained from the entry queue, to the
+  // active segment. Those which fail to be appended are completed with the
+  // error. Returns true if any of them must be synced, i.e. isn't a COMMIT.
+  bool AppendBatches(const std::vector<LogEntryBatch*>& entry_batches);
+
+  // Completes 'entry_batches' once they were synced, with 's' the result of
+  // syncing them, and deletes them.
+  void CompleteBatches(std::vector<LogEntryBatch*>* entry_batches, const Status& s);
+
   // Helper method to get the segment sequence to GC based on the provided 'retention' struct.
   Status GetSegmentsToGCUnlocked(RetentionIndexes retention_indexes,
                                  SegmentSequence* segments_to_gc) const;
@@ -388,6 +445,14 @@ class Log : public RefCountedThreadSafe<Log> {
   // When the segment is closed, it will be written.
   LogSegmentFooterPB footer_builder_;
 
+  // The index checkpoint being prepared for the current region of the active
+  // segment, i.e. the batches written since the last checkpoint.
+  LogSegmentIndexCheckpointPB index_checkpoint_builder_;
+
+  // The offset of the last index checkpoint written to the active segment,
+  // or -1 if none was.
+  int64_t last_index_checkpoint_offset_;
+
   // The maximum segment size, in bytes.
   uint64_t max_segment_size_;
 
@@ -395,8 +460,10 @@ class Log : public RefCountedThreadSafe<Log> {
   // Reserve() and the Log Appender thread
   LogEntryBatchQueue entry_batch_queue_;
 
-  // Thread writing to the log
+  // Thread writing to the log, or, if --log_group_commit_across_tablets is
+  // set, the thread shared with all the logs in the same WAL directory.
   gscoped_ptr<AppendThread> append_thread_;
+  std::shared_ptr<SharedAppendThread> shared_append_thread_;
 
   gscoped_ptr<ThreadPool> allocation_pool_;
 
@@ -407,6 +474,12 @@ class Log : public RefCountedThreadSafe<Log> {
   // This is used to disable fsync during bootstrap.
   bool sync_disabled_;
 
+  // The number of bytes appended since the last sync of the active segment.
+  // Only accessed by the thread appending to the log.
+  int64_t unsynced_bytes_;
+
+  GroupCommitTuner group_commit_tuner_;
+
   // The status of the most recent log-allocation action.
   Promise<Status> allocation_status_;
 
@@ -25,11 +25,13 @@
 #include "kudu/consensus/log_cache.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/bind_helpers.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/test_util.h"
+#include "kudu/util/threadpool.h"
 
 using std::shared_ptr;
 
@@ -220,6 +222,71 @@ TEST_F(LogCacheTest, TestCacheEdgeCases) {
   ASSERT_OPID_EQ(MakeOpId(0, 0), preceding);
 }
 
+// Tests that reading evicted ops for a peer reads the following ones ahead,
+// and that the next reads are served from them.
+TEST_F(LogCacheTest, TestReadAhead) {
+  const int kNumOps = 100;
+  ASSERT_OK(AppendReplicateMessagesToCache(1, kNumOps, 1024));
+  log_->WaitUntilAllFlushed();
+  cache_->EvictThroughOp(kNumOps);
+  ASSERT_EQ(0, cache_->num_cached_ops());
+
+  // Reads which aren't on behalf of a peer don't read ahead.
+  vector<ReplicateRefPtr> messages;
+  OpId preceding;
+  ASSERT_OK(cache_->ReadOps(0, 10 * 1024, &messages, &preceding));
+  ASSERT_GT(messages.size(), 0);
+  cache_->read_ahead_pool_->Wait();
+  ASSERT_TRUE(cache_->read_ahead_.empty());
+
+  // Reads on behalf of a peer do.
+  messages.clear();
+  ASSERT_OK(cache_->ReadOps(0, 10 * 1024, &messages, &preceding, "peer"));
+  ASSERT_GT(messages.size(), 0);
+  int64_t next_index = messages.back()->get()->id().index() + 1;
+  cache_->read_ahead_pool_->Wait();
+  {
+    std::lock_guard<simple_spinlock> l(cache_->lock_);
+    const auto& buffer = FindOrDie(cache_->read_ahead_, "peer");
+    ASSERT_EQ(next_index, buffer->ops.front()->get()->id().index());
+    ASSERT_EQ(kNumOps, buffer->ops.back()->get()->id().index());
+    ASSERT_EQ(buffer->bytes, cache_->read_ahead_tracker_->consumption());
+  }
+
+  // The next read is served from the ops read ahead, which are then released
+  // as the peer caught up.
+  messages.clear();
+  ASSERT_OK(cache_->ReadOps(next_index - 1, 8 * 1024 * 1024, &messages, &preceding, "peer"));
+  ASSERT_EQ(kNumOps - next_index + 1, messages.size());
+  for (int i = 0; i < messages.size(); i++) {
+    ASSERT_EQ(next_index + i, messages[i]->get()->id().index());
+  }
+  cache_->read_ahead_pool_->Wait();
+  ASSERT_TRUE(cache_->read_ahead_.empty());
+  ASSERT_EQ(0, cache_->read_ahead_tracker_->consumption());
+
+  // A peer going back is served from disk, and truncation drops the ops
+  // read ahead.
+  messages.clear();
+  ASSERT_OK(cache_->ReadOps(0, 10 * 1024, &messages, &preceding, "peer"));
+  cache_->read_ahead_pool_->Wait();
+  ASSERT_GT(cache_->read_ahead_tracker_->consumption(), 0);
+  messages.clear();
+  ASSERT_OK(cache_->ReadOps(0, 10 * 1024, &messages, &preceding, "peer"));
+  ASSERT_EQ(1, messages.front()->get()->id().index());
+  cache_->read_ahead_pool_->Wait();
+  cache_->TruncateOpsAfter(kNumOps / 2);
+  ASSERT_EQ(0, cache_->read_ahead_tracker_->consumption());
+
+  // So does dropping the peer.
+  messages.clear();
+  ASSERT_OK(cache_->ReadOps(0, 10 * 1024, &messages, &preceding, "peer"));
+  cache_->read_ahead_pool_->Wait();
+  ASSERT_GT(cache_->read_ahead_tracker_->consumption(), 0);
+  cache_->DropReadAhead("peer");
+  ASSERT_EQ(0, cache_->read_ahead_tracker_->consumption());
+  ASSERT_TRUE(cache_->read_ahead_.empty());
+}
 
 TEST_F(LogCacheTest, TestMemoryLimit) {
   FLAGS_log_cache_size_limit_mb = 1;
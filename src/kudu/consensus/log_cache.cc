@@ -40,6 +40,7 @@
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(log_cache_size_limit_mb, 128,
              "The total per-tablet size of consensus entries which may be kept in memory. "
@@ -53,6 +54,15 @@ DEFINE_int32(global_log_cache_size_limit_mb, 1024,
              "caching log entries across all tablets is kept under this threshold.");
 TAG_FLAG(global_log_cache_size_limit_mb, advanced);
 
+DEFINE_int64(log_cache_read_ahead_bytes, 4 * 1024 * 1024,
+             "The amount of operations which are read ahead from the log in the background "
+             "for each peer catching up on operations which have been evicted from the log "
+             "cache, in bytes. The memory used is charged to the server-wide log cache limit, "
+             "and read-ahead is skipped when that limit would be exceeded. 0 disables "
+             "read-ahead.");
+TAG_FLAG(log_cache_read_ahead_bytes, advanced);
+
+using std::shared_ptr;
 using strings::Substitute;
 
 namespace kudu {
@@ -66,6 +76,20 @@ METRIC_DEFINE_gauge_int64(tablet, log_cache_size, "Log Cache Memory Usage",
                           "Amount of memory in use for caching the local log.");
 
 static const char kParentMemTrackerId[] = "log_cache";
+static const char kSerializedMemTrackerId[] = "log_cache:serialized_ops";
+static const char kReadAheadMemTrackerId[] = "log_cache:read_ahead";
+
+// Returns the tracker 'id' shared by all the log caches, a child of 'parent'.
+static shared_ptr<MemTracker> FindOrCreateSharedTracker(const string& id,
+                                                        const shared_ptr<MemTracker>& parent) {
+  static std::mutex lock;
+  std::lock_guard<std::mutex> l(lock);
+  shared_ptr<MemTracker> tracker;
+  if (!MemTracker::FindTracker(id, &tracker, parent)) {
+    tracker = MemTracker::CreateTracker(-1, id, parent);
+  }
+  return tracker;
+}
 
 typedef vector<const ReplicateMsg*>::const_iterator MsgIter;
 
@@ -78,6 +102,7 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
     tablet_id_(tablet_id),
     next_sequential_op_index_(0),
     min_pinned_op_index_(0),
+    read_ahead_generation_(0),
     metrics_(metric_entity) {
 
 
@@ -94,6 +119,10 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
       max_ops_size_bytes, Substitute("$0:$1:$2", kParentMemTrackerId,
                                      local_uuid, tablet_id),
       parent_tracker_);
+  serialized_tracker_ = FindOrCreateSharedTracker(kSerializedMemTrackerId, parent_tracker_);
+  read_ahead_tracker_ = FindOrCreateSharedTracker(kReadAheadMemTrackerId, parent_tracker_);
+  CHECK_OK(ThreadPoolBuilder("log-cache-read-ahead").set_max_threads(1)
+           .Build(&read_ahead_pool_));
 
   // Put a fake message at index 0, since this simplifies a lot of our
   // code paths elsewhere.
@@ -103,6 +132,10 @@ LogCache::LogCache(const scoped_refptr<MetricEntity>& metric_entity,
 }
 
 LogCache::~LogCache() {
+  read_ahead_pool_->Shutdown();
+  for (const auto& entry : read_ahead_) {
+    ClearReadAheadUnlocked(entry.second.get());
+  }
   tracker_->Release(tracker_->consumption());
   cache_.clear();
 }
@@ -134,6 +167,12 @@ void LogCache::TruncateOpsAfterUnlocked(int64_t index) {
     }
   }
   next_sequential_op_index_ = index + 1;
+
+  // The ops read ahead may have been truncated too.
+  for (const auto& entry : read_ahead_) {
+    ClearReadAheadUnlocked(entry.second.get());
+  }
+  read_ahead_generation_++;
 }
 
 Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
@@ -156,6 +195,7 @@ Status LogCache::AppendOperations(const vector<ReplicateRefPtr>& msgs,
   int64_t mem_required = 0;
   for (const auto& msg : msgs) {
     mem_required += msg->get()->SpaceUsed();
+    msg->set_mem_tracker(serialized_tracker_);
   }
 
   // Try to consume the memory. If it can't be consumed, we may need to evict.
@@ -280,12 +320,14 @@ int64_t TotalByteSizeForMessage(const ReplicateMsg& msg) {
 Status LogCache::ReadOps(int64_t after_op_index,
                          int max_size_bytes,
                          std::vector<ReplicateRefPtr>* messages,
-                         OpId* preceding_op) {
+                         OpId* preceding_op,
+                         const string& peer_uuid) {
   DCHECK_GE(after_op_index, 0);
   RETURN_NOT_OK(LookupOpId(after_op_index, preceding_op));
 
   std::unique_lock<simple_spinlock> l(lock_);
   int64_t next_index = after_op_index + 1;
+  bool read_from_disk = false;
 
   // Return as many operations as we can, up to the limit
   int64_t remaining_space = max_size_bytes;
@@ -304,6 +346,17 @@ Status LogCache::ReadOps(int64_t after_op_index,
         up_to = iter->first - 1;
       }
 
+      // Serve what we can from the ops read ahead for the peer.
+      if (!peer_uuid.empty()) {
+        shared_ptr<ReadAheadBuffer> buffer = FindWithDefault(read_ahead_, peer_uuid, nullptr);
+        if (buffer && ConsumeReadAheadUnlocked(buffer.get(), up_to, &next_index,
+                                               &remaining_space, messages)) {
+          read_from_disk = true;
+          continue;
+        }
+      }
+      read_from_disk = true;
+
       l.unlock();
 
       vector<ReplicateMsg*> raw_replicate_ptrs;
@@ -323,6 +376,7 @@ Status LogCache::ReadOps(int64_t after_op_index,
         remaining_space -= TotalByteSizeForMessage(*msg);
         if (remaining_space > 0 || messages->empty()) {
           messages->push_back(make_scoped_refptr_replicate(msg));
+          messages->back()->set_mem_tracker(serialized_tracker_);
           next_index++;
         } else {
           delete msg;
@@ -348,9 +402,145 @@ Status LogCache::ReadOps(int64_t after_op_index,
       }
     }
   }
+
+  if (read_from_disk && !peer_uuid.empty() && FLAGS_log_cache_read_ahead_bytes > 0) {
+    MaybeReadAheadUnlocked(peer_uuid, next_index);
+  }
   return Status::OK();
 }
 
+bool LogCache::ConsumeReadAheadUnlocked(ReadAheadBuffer* buffer,
+                                        int64_t up_to,
+                                        int64_t* next_index,
+                                        int64_t* remaining_space,
+                                        vector<ReplicateRefPtr>* messages) {
+  DCHECK(lock_.is_locked());
+  auto pop_front = [&]() {
+    int64_t size = buffer->ops.front()->get()->SpaceUsed();
+    buffer->bytes -= size;
+    read_ahead_tracker_->Release(size);
+    buffer->ops.pop_front();
+  };
+  while (!buffer->ops.empty() && buffer->ops.front()->get()->id().index() < *next_index) {
+    pop_front();
+  }
+  if (buffer->ops.empty() || buffer->ops.front()->get()->id().index() != *next_index) {
+    // The peer went back, e.g. after rejecting a request.
+    ClearReadAheadUnlocked(buffer);
+    return false;
+  }
+
+  bool consumed = false;
+  while (!buffer->ops.empty() && *next_index <= up_to && *remaining_space > 0) {
+    const ReplicateRefPtr& msg = buffer->ops.front();
+    int64_t size = TotalByteSizeForMessage(*msg->get());
+    if (*remaining_space - size < 0 && !messages->empty()) {
+      *remaining_space -= size;
+      break;
+    }
+    *remaining_space -= size;
+    messages->push_back(msg);
+    messages->back()->set_mem_tracker(serialized_tracker_);
+    pop_front();
+    (*next_index)++;
+    consumed = true;
+  }
+  return consumed;
+}
+
+void LogCache::MaybeReadAheadUnlocked(const string& peer_uuid, int64_t next_index) {
+  DCHECK(lock_.is_locked());
+  shared_ptr<ReadAheadBuffer>& buffer = read_ahead_[peer_uuid];
+  if (!buffer) {
+    buffer = std::make_shared<ReadAheadBuffer>();
+  }
+  if (buffer->reading || buffer->bytes >= FLAGS_log_cache_read_ahead_bytes) {
+    return;
+  }
+  int64_t from_index = buffer->ops.empty() ?
+      next_index : buffer->ops.back()->get()->id().index() + 1;
+
+  // Read up to the next op that's in the cache. Once the peer gets there,
+  // there's nothing left to read ahead.
+  MessageCache::const_iterator iter = cache_.lower_bound(from_index);
+  int64_t up_to = iter == cache_.end() ? next_sequential_op_index_ - 1 : iter->first - 1;
+  if (up_to < from_index) {
+    if (buffer->ops.empty()) {
+      read_ahead_.erase(peer_uuid);
+    }
+    return;
+  }
+
+  buffer->reading = true;
+  int64_t max_bytes = FLAGS_log_cache_read_ahead_bytes - buffer->bytes;
+  int64_t generation = read_ahead_generation_;
+  Status s = read_ahead_pool_->SubmitFunc(
+      [this, peer_uuid, buffer, from_index, up_to, max_bytes, generation]() {
+        ReadAheadTask(peer_uuid, buffer, from_index, up_to, max_bytes, generation);
+      });
+  if (PREDICT_FALSE(!s.ok())) {
+    buffer->reading = false;
+  }
+}
+
+void LogCache::ReadAheadTask(const string& peer_uuid,
+                             const shared_ptr<ReadAheadBuffer>& buffer,
+                             int64_t from_index,
+                             int64_t up_to,
+                             int64_t max_bytes,
+                             int64_t generation) {
+  vector<ReplicateMsg*> raw_replicate_ptrs;
+  ElementDeleter d(&raw_replicate_ptrs);
+  Status s = log_->reader()->ReadReplicatesInRange(from_index, up_to, max_bytes,
+                                                   &raw_replicate_ptrs);
+  int64_t bytes = 0;
+  for (const ReplicateMsg* msg : raw_replicate_ptrs) {
+    bytes += msg->SpaceUsed();
+  }
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  buffer->reading = false;
+  // Keep the ops only if they're still wanted: they mustn't have been
+  // truncated, and the peer mustn't have been dropped or gone elsewhere.
+  if (!s.ok() || raw_replicate_ptrs.empty() ||
+      generation != read_ahead_generation_ ||
+      FindWithDefault(read_ahead_, peer_uuid, nullptr) != buffer ||
+      (!buffer->ops.empty() && buffer->ops.back()->get()->id().index() + 1 != from_index)) {
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "Discarding ops " << from_index << ".." << up_to
+                                 << " read ahead for peer " << peer_uuid << ": "
+                                 << s.ToString();
+    return;
+  }
+  if (!read_ahead_tracker_->TryConsume(bytes)) {
+    VLOG_WITH_PREFIX_UNLOCKED(2) << "Not enough memory to read ahead for peer " << peer_uuid;
+    return;
+  }
+  VLOG_WITH_PREFIX_UNLOCKED(2) << "Read ahead " << raw_replicate_ptrs.size() << " ops ("
+                               << from_index << ".."
+                               << (from_index + raw_replicate_ptrs.size() - 1)
+                               << ") for peer " << peer_uuid;
+  for (ReplicateMsg* msg : raw_replicate_ptrs) {
+    buffer->ops.push_back(make_scoped_refptr_replicate(msg));
+  }
+  raw_replicate_ptrs.clear();
+  buffer->bytes += bytes;
+}
+
+void LogCache::ClearReadAheadUnlocked(ReadAheadBuffer* buffer) {
+  read_ahead_tracker_->Release(buffer->bytes);
+  buffer->bytes = 0;
+  buffer->ops.clear();
+}
+
+void LogCache::DropReadAhead(const string& peer_uuid) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  shared_ptr<ReadAheadBuffer> buffer = FindWithDefault(read_ahead_, peer_uuid, nullptr);
+  if (buffer) {
+    ClearReadAheadUnlocked(buffer.get());
+    read_ahead_.erase(peer_uuid);
+  }
+}
+
 
 void LogCache::EvictThroughOp(int64_t index) {
   std::lock_guard<simple_spinlock> lock(lock_);
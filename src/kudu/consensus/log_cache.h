@@ -17,9 +17,11 @@
 #ifndef KUDU_CONSENSUS_LOG_CACHE_H
 #define KUDU_CONSENSUS_LOG_CACHE_H
 
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/consensus/consensus.pb.h"
@@ -36,6 +38,7 @@ namespace kudu {
 
 class MetricEntity;
 class MemTracker;
+class ThreadPool;
 
 namespace log {
 class Log;
@@ -82,10 +85,20 @@ class LogCache {
   // If the ops being requested are not available in the log, this will synchronously
   // read these ops from disk. Therefore, this function may take a substantial amount
   // of time and should not be called with important locks held, etc.
+  //
+  // If 'peer_uuid' is set, the ops are read on behalf of that peer, which is
+  // expected to read the following ones next. If they have to be read from
+  // disk, up to --log_cache_read_ahead_bytes of the following ones are then
+  // read ahead in the background, so that the next reads of a peer catching
+  // up from disk are usually served from memory.
   Status ReadOps(int64_t after_op_index,
                  int max_size_bytes,
                  std::vector<ReplicateRefPtr>* messages,
-                 OpId* preceding_op);
+                 OpId* preceding_op,
+                 const std::string& peer_uuid = "");
+
+  // Drops the ops read ahead for 'peer_uuid', if any.
+  void DropReadAhead(const std::string& peer_uuid);
 
   // Append the operations into the log and the cache.
   // When the messages have completed writing into the on-disk log, fires 'callback'.
@@ -147,8 +160,47 @@ class LogCache {
   FRIEND_TEST(LogCacheTest, TestGlobalMemoryLimit);
   FRIEND_TEST(LogCacheTest, TestReplaceMessages);
   FRIEND_TEST(LogCacheTest, TestTruncation);
+  FRIEND_TEST(LogCacheTest, TestReadAhead);
   friend class LogCacheTest;
 
+  // Ops read ahead from disk for a peer.
+  struct ReadAheadBuffer {
+    // Consecutive ops, starting with the next one the peer is expected to read.
+    std::deque<ReplicateRefPtr> ops;
+
+    // The memory used by 'ops', charged to 'read_ahead_tracker_'.
+    int64_t bytes = 0;
+
+    // Whether a background read into the buffer is in progress.
+    bool reading = false;
+  };
+
+  // Moves the ops of '*buffer' which follow 'messages' and precede 'up_to'
+  // into 'messages', as ReadOps() would read them from disk. Any ops before
+  // '*next_index' are dropped first. Returns whether any op was moved.
+  bool ConsumeReadAheadUnlocked(ReadAheadBuffer* buffer,
+                                int64_t up_to,
+                                int64_t* next_index,
+                                int64_t* remaining_space,
+                                std::vector<ReplicateRefPtr>* messages);
+
+  // Starts reading ahead the ops which 'peer_uuid' will read after
+  // 'next_index' in the background, unless they're cached or a read is
+  // already in progress for the peer.
+  void MaybeReadAheadUnlocked(const std::string& peer_uuid, int64_t next_index);
+
+  // Reads the ops in [from_index, up_to] into the read-ahead buffer of
+  // 'peer_uuid', up to 'max_bytes' of them. Runs on 'read_ahead_pool_'.
+  void ReadAheadTask(const std::string& peer_uuid,
+                     const std::shared_ptr<ReadAheadBuffer>& buffer,
+                     int64_t from_index,
+                     int64_t up_to,
+                     int64_t max_bytes,
+                     int64_t generation);
+
+  // Releases the memory of the ops in '*buffer' and clears it.
+  void ClearReadAheadUnlocked(ReadAheadBuffer* buffer);
+
   // Try to evict the oldest operations from the queue, stopping either when
   // 'bytes_to_evict' bytes have been evicted, or the op with index
   // 'stop_after_index' has been evicted, whichever comes first.
@@ -210,6 +262,27 @@ class LogCache {
   // A MemTracker for this instance.
   std::shared_ptr<MemTracker> tracker_;
 
+  // A child of 'parent_tracker_', shared by all log caches, charged with the
+  // serialized form of the cached messages (see RefCountedReplicate). This
+  // memory isn't charged to 'tracker_' since it's only allocated once the
+  // messages are sent to a peer, and may outlive their eviction.
+  std::shared_ptr<MemTracker> serialized_tracker_;
+
+  // A child of 'parent_tracker_', shared by all log caches, charged with the
+  // ops read ahead for peers. Read-ahead is skipped when this can't be
+  // charged without exceeding a limit.
+  std::shared_ptr<MemTracker> read_ahead_tracker_;
+
+  // The read-ahead buffers, by peer UUID. Protected by lock_.
+  std::unordered_map<std::string, std::shared_ptr<ReadAheadBuffer>> read_ahead_;
+
+  // Incremented whenever truncation invalidates the ops read ahead, so that
+  // the reads in progress discard theirs. Protected by lock_.
+  int64_t read_ahead_generation_;
+
+  // Pool for the background reads, one at a time.
+  gscoped_ptr<ThreadPool> read_ahead_pool_;
+
   struct Metrics {
     explicit Metrics(const scoped_refptr<MetricEntity>& metric_entity);
 
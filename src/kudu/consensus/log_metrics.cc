@@ -48,6 +48,12 @@ METRIC_DEFINE_histogram(tablet, log_entry_batches_per_group, "Log Group Commit B
                         "Number of log entry batches in a group commit group",
                         1024, 2);
 
+METRIC_DEFINE_histogram(tablet, log_bytes_per_sync, "Log Bytes Per Sync",
+                        kudu::MetricUnit::kBytes,
+                        "Number of bytes appended to the log segment file between two "
+                        "fsyncs of it, only recorded if --log_force_fsync_all is set",
+                        1024LU * 1024 * 1024, 2);
+
 namespace kudu {
 namespace log {
 
@@ -58,7 +64,8 @@ LogMetrics::LogMetrics(const scoped_refptr<MetricEntity>& metric_entity)
       MINIT(append_latency),
       MINIT(group_commit_latency),
       MINIT(roll_latency),
-      MINIT(entry_batches_per_group) {
+      MINIT(entry_batches_per_group),
+      MINIT(bytes_per_sync) {
 }
 #undef MINIT
 
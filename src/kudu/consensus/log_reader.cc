@@ -266,13 +266,47 @@ Status LogReader::ReadBatchUsingIndexEntry(const LogIndexEntry& index_entry,
   return Status::OK();
 }
 
+Status LogReader::LookupIndexEntry(int64_t index, LogIndexEntry* entry) const {
+  if (log_index_) {
+    Status s = log_index_->GetEntry(index, entry);
+    if (!s.IsNotFound()) {
+      return s;
+    }
+  }
+
+  SegmentSequence segments;
+  {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    segments.assign(segments_.begin(), segments_.end());
+  }
+  for (auto it = segments.rbegin(); it != segments.rend(); ++it) {
+    const scoped_refptr<ReadableLogSegment>& segment = *it;
+    if (!segment->HasFooter() ||
+        index < segment->footer().min_replicate_index() ||
+        index > segment->footer().max_replicate_index()) {
+      continue;
+    }
+    int64_t offset;
+    OpId op_id;
+    Status s = segment->FindReplicateBatch(index, &offset, &op_id);
+    if (s.IsNotFound()) {
+      continue;
+    }
+    RETURN_NOT_OK(s);
+    entry->op_id = op_id;
+    entry->segment_sequence_number = segment->header().sequence_number();
+    entry->offset_in_segment = offset;
+    return Status::OK();
+  }
+  return Status::NotFound(Substitute("op $0 not found", index));
+}
+
 Status LogReader::ReadReplicatesInRange(int64_t starting_at,
                                         int64_t up_to,
                                         int64_t max_bytes_to_read,
                                         vector<ReplicateMsg*>* replicates) const {
   DCHECK_GT(starting_at, 0);
   DCHECK_GE(up_to, starting_at);
-  DCHECK(log_index_) << "Require an index to random-read logs";
 
   vector<ReplicateMsg*> replicates_tmp;
   ElementDeleter d(&replicates_tmp);
@@ -284,7 +318,7 @@ Status LogReader::ReadReplicatesInRange(int64_t starting_at,
   gscoped_ptr<LogEntryBatchPB> batch;
   for (int index = starting_at; index <= up_to && !limit_exceeded; index++) {
     LogIndexEntry index_entry;
-    RETURN_NOT_OK_PREPEND(log_index_->GetEntry(index, &index_entry),
+    RETURN_NOT_OK_PREPEND(LookupIndexEntry(index, &index_entry),
                           Substitute("Failed to read log index for op $0", index));
 
     // Since a given LogEntryBatchPB may contain multiple REPLICATE messages,
@@ -345,7 +379,7 @@ Status LogReader::ReadReplicatesInRange(int64_t starting_at,
 
 Status LogReader::LookupOpId(int64_t op_index, OpId* op_id) const {
   LogIndexEntry index_entry;
-  RETURN_NOT_OK_PREPEND(log_index_->GetEntry(op_index, &index_entry),
+  RETURN_NOT_OK_PREPEND(LookupIndexEntry(op_index, &index_entry),
                         strings::Substitute("Failed to read log index for op $0", op_index));
   *op_id = index_entry.op_id;
   return Status::OK();
@@ -49,8 +49,8 @@ class LogReader {
   // Opens a LogReader on the default tablet log directory, and sets
   // 'reader' to the newly created LogReader.
   //
-  // 'index' may be NULL, but if it is, ReadReplicatesInRange() may not
-  // be used.
+  // 'index' may be NULL, but if it is, ReadReplicatesInRange() and
+  // LookupOpId() may only find the ops of segments with index checkpoints.
   static Status Open(FsManager* fs_manager,
                      const scoped_refptr<LogIndex>& index,
                      const std::string& tablet_id,
@@ -82,8 +82,6 @@ class LogReader {
   // Will attempt to read no more than 'max_bytes_to_read', unless it is set to
   // LogReader::kNoSizeLimit. If the size limit would prevent reading any operations at
   // all, then will read exactly one operation.
-  //
-  // Requires that a LogIndex was passed into LogReader::Open().
   Status ReadReplicatesInRange(
       int64_t starting_at,
       int64_t up_to,
@@ -154,6 +152,11 @@ class LogReader {
                                   faststring* tmp_buf,
                                   gscoped_ptr<LogEntryBatchPB>* batch) const;
 
+  // Looks up the index entry of the op with index 'index' in the LogIndex,
+  // falling back to the index checkpoints of the segments if the LogIndex
+  // is absent or doesn't have it.
+  Status LookupIndexEntry(int64_t index, LogIndexEntry* entry) const;
+
   LogReader(FsManager* fs_manager, const scoped_refptr<LogIndex>& index,
             std::string tablet_id,
             const scoped_refptr<MetricEntity>& metric_entity);
@@ -114,16 +114,12 @@ LogEntryReader::LogEntryReader(ReadableLogSegment* seg)
       num_entries_read_(0),
       offset_(seg_->first_entry_offset()) {
 
-  int64_t readable_to_offset = seg_->readable_to_offset_.Load();
-
   // If we have a footer we only read up to it. If we don't we likely crashed
   // and always read to the end.
-  read_up_to_ = (seg_->footer_.IsInitialized() && !seg_->footer_was_rebuilt_) ?
-      seg_->file_size() - seg_->footer_.ByteSize() - kLogSegmentFooterMagicAndFooterLength :
-      readable_to_offset;
+  read_up_to_ = seg_->entries_end_offset();
   VLOG(1) << "Reading segment entries from "
           << seg_->path_ << ": offset=" << offset_ << " file_size="
-          << seg_->file_size() << " readable_to_offset=" << readable_to_offset;
+          << seg_->file_size() << " readable_to_offset=" << seg_->readable_up_to();
 }
 
 LogEntryReader::~LogEntryReader() {}
@@ -353,12 +349,25 @@ void ReadableLogSegment::UpdateReadableToOffset(int64_t readable_to_offset) {
   file_size_.StoreMax(readable_to_offset);
 }
 
+int64_t ReadableLogSegment::entries_end_offset() const {
+  if (footer_.IsInitialized() && !footer_was_rebuilt_) {
+    return file_size() - footer_.ByteSize() - kLogSegmentFooterMagicAndFooterLength;
+  }
+  return readable_to_offset_.Load();
+}
+
 Status ReadableLogSegment::RebuildFooterByScanning() {
   TRACE_EVENT1("log", "ReadableLogSegment::RebuildFooterByScanning",
                "path", path_);
 
   DCHECK(!footer_.IsInitialized());
 
+  bool rebuilt;
+  RETURN_NOT_OK(RebuildFooterFromIndexCheckpoints(&rebuilt));
+  if (rebuilt) {
+    return Status::OK();
+  }
+
   LogEntryReader reader(this);
 
   LogSegmentFooterPB new_footer;
@@ -386,6 +395,178 @@ Status ReadableLogSegment::RebuildFooterByScanning() {
   return Status::OK();
 }
 
+namespace {
+
+// Accounts for the region described by 'checkpoint' in 'footer'.
+void UpdateFooterForIndexCheckpoint(const LogSegmentIndexCheckpointPB& checkpoint,
+                                    LogSegmentFooterPB* footer) {
+  footer->set_num_entries(footer->num_entries() + checkpoint.num_entries());
+  if (checkpoint.has_min_replicate_index() &&
+      (!footer->has_min_replicate_index() ||
+       checkpoint.min_replicate_index() < footer->min_replicate_index())) {
+    footer->set_min_replicate_index(checkpoint.min_replicate_index());
+  }
+  if (checkpoint.has_max_replicate_index() &&
+      (!footer->has_max_replicate_index() ||
+       checkpoint.max_replicate_index() > footer->max_replicate_index())) {
+    footer->set_max_replicate_index(checkpoint.max_replicate_index());
+  }
+  LogSegmentIndexCheckpointPB* footer_checkpoint = footer->add_index_checkpoints();
+  *footer_checkpoint = checkpoint;
+  footer_checkpoint->clear_previous_checkpoint_offset();
+}
+
+} // anonymous namespace
+
+Status ReadableLogSegment::RebuildFooterFromIndexCheckpoints(bool* rebuilt) {
+  *rebuilt = false;
+
+  // Skip over the batches using their headers alone, stopping at the first
+  // one which isn't entirely readable.
+  vector<int64_t> batch_offsets;
+  int64_t offset = first_entry_offset_;
+  const int64_t limit = readable_to_offset_.Load();
+  while (offset + entry_header_size() < limit) {
+    int64_t batch_offset = offset;
+    EntryHeader header;
+    Status s = ReadEntryHeader(&batch_offset, &header);
+    if (s.IsCorruption()) {
+      break;
+    }
+    RETURN_NOT_OK(s);
+    if (header.msg_length == 0 ||
+        batch_offset + header.msg_length_compressed > limit) {
+      break;
+    }
+    batch_offsets.push_back(offset);
+    offset = batch_offset + header.msg_length_compressed;
+  }
+  if (offset < limit) {
+    // Like LogEntryReader, only tolerate a partially written last batch.
+    bool has_valid_entries;
+    RETURN_NOT_OK_PREPEND(ScanForValidEntryHeaders(offset + entry_header_size(),
+                                                   &has_valid_entries),
+                          "Scanning forward for valid entries");
+    if (has_valid_entries) {
+      return Status::OK();
+    }
+  }
+  const int64_t end_offset = offset;
+
+  // Read the batches from the end back to the last checkpoint, accounting for
+  // the ones following it.
+  LogSegmentIndexCheckpointPB tail;
+  tail.set_num_entries(0);
+  faststring tmp_buf;
+  gscoped_ptr<LogEntryBatchPB> batch;
+  int i = batch_offsets.size() - 1;
+  for (; i >= 0; i--) {
+    int64_t batch_offset = batch_offsets[i];
+    Status s = ReadEntryHeaderAndBatch(&batch_offset, &tmp_buf, &batch);
+    if (s.IsCorruption()) {
+      return Status::OK();
+    }
+    RETURN_NOT_OK(s);
+    if (batch->has_index_checkpoint()) {
+      break;
+    }
+    tail.set_num_entries(tail.num_entries() + batch->entry_size());
+    for (const LogEntryPB& entry : batch->entry()) {
+      if (entry.has_replicate()) {
+        UpdateIndexCheckpointForReplicateEntry(entry, &tail);
+      }
+    }
+  }
+  if (i < 0) {
+    tail.set_region_offset(first_entry_offset_);
+  } else {
+    tail.set_region_offset(i + 1 < batch_offsets.size() ? batch_offsets[i + 1] : end_offset);
+  }
+
+  // Follow the chain of checkpoints back to the start of the segment.
+  vector<LogSegmentIndexCheckpointPB> checkpoints;
+  if (i >= 0) {
+    checkpoints.push_back(batch->index_checkpoint());
+    int64_t checkpoint_offset = batch_offsets[i];
+    while (checkpoints.back().has_previous_checkpoint_offset()) {
+      int64_t prev_offset = checkpoints.back().previous_checkpoint_offset();
+      if (prev_offset < first_entry_offset_ || prev_offset >= checkpoint_offset) {
+        return Status::OK();
+      }
+      checkpoint_offset = prev_offset;
+      Status s = ReadEntryHeaderAndBatch(&prev_offset, &tmp_buf, &batch);
+      if (s.IsCorruption() || (s.ok() && !batch->has_index_checkpoint())) {
+        return Status::OK();
+      }
+      RETURN_NOT_OK(s);
+      checkpoints.push_back(batch->index_checkpoint());
+    }
+    std::reverse(checkpoints.begin(), checkpoints.end());
+    if (checkpoints.front().region_offset() != first_entry_offset_) {
+      return Status::OK();
+    }
+  }
+  checkpoints.push_back(std::move(tail));
+
+  LogSegmentFooterPB new_footer;
+  new_footer.set_num_entries(0);
+  for (const LogSegmentIndexCheckpointPB& checkpoint : checkpoints) {
+    UpdateFooterForIndexCheckpoint(checkpoint, &new_footer);
+  }
+  footer_ = new_footer;
+  DCHECK(footer_.IsInitialized());
+  footer_was_rebuilt_ = true;
+  readable_to_offset_.Store(end_offset);
+  *rebuilt = true;
+
+  LOG(INFO) << "Successfully rebuilt footer for segment: " << path_
+            << " from " << checkpoints.size() - 1 << " index checkpoints"
+            << " (valid entries through byte offset " << end_offset << ")";
+  return Status::OK();
+}
+
+Status ReadableLogSegment::FindReplicateBatch(int64_t index, int64_t* offset, OpId* op_id) {
+  if (!HasFooter() || footer_.index_checkpoints_size() == 0) {
+    return Status::NotFound("segment has no index checkpoints");
+  }
+
+  // Due to log truncation, an index may appear in several regions, and only
+  // its last occurrence is valid: look for it starting from the last region.
+  const auto& checkpoints = footer_.index_checkpoints();
+  faststring tmp_buf;
+  gscoped_ptr<LogEntryBatchPB> batch;
+  for (int i = checkpoints.size() - 1; i >= 0; i--) {
+    const LogSegmentIndexCheckpointPB& checkpoint = checkpoints.Get(i);
+    if (!checkpoint.has_min_replicate_index() ||
+        index < checkpoint.min_replicate_index() ||
+        index > checkpoint.max_replicate_index()) {
+      continue;
+    }
+    int64_t region_end = i + 1 < checkpoints.size() ?
+        checkpoints.Get(i + 1).region_offset() : entries_end_offset();
+    bool found = false;
+    int64_t batch_offset = checkpoint.region_offset();
+    while (batch_offset < region_end) {
+      int64_t next_offset = batch_offset;
+      RETURN_NOT_OK_PREPEND(ReadEntryHeaderAndBatch(&next_offset, &tmp_buf, &batch),
+                            Substitute("Could not read log batch at offset $0 of $1",
+                                       batch_offset, path_));
+      for (const LogEntryPB& entry : batch->entry()) {
+        if (entry.has_replicate() && entry.replicate().id().index() == index) {
+          *offset = batch_offset;
+          *op_id = entry.replicate().id();
+          found = true;
+        }
+      }
+      batch_offset = next_offset;
+    }
+    if (found) {
+      return Status::OK();
+    }
+  }
+  return Status::NotFound(Substitute("op $0 not found in segment $1", index, path_));
+}
+
 Status ReadableLogSegment::ReadFileSize() {
   // Check the size of the file.
   // Env uses uint here, even though we generally prefer signed ints to avoid
@@ -870,19 +1051,33 @@ bool IsLogFileName(const string& fname) {
   return true;
 }
 
-void UpdateFooterForReplicateEntry(const LogEntryPB& entry_pb,
-                                   LogSegmentFooterPB* footer) {
+namespace {
+
+template<class PB>
+void UpdateReplicateIndexBounds(const LogEntryPB& entry_pb, PB* pb) {
   DCHECK(entry_pb.has_replicate());
   int64_t index = entry_pb.replicate().id().index();
-  if (!footer->has_min_replicate_index() ||
-      index < footer->min_replicate_index()) {
-    footer->set_min_replicate_index(index);
+  if (!pb->has_min_replicate_index() ||
+      index < pb->min_replicate_index()) {
+    pb->set_min_replicate_index(index);
   }
-  if (!footer->has_max_replicate_index() ||
-      index > footer->max_replicate_index()) {
-    footer->set_max_replicate_index(index);
+  if (!pb->has_max_replicate_index() ||
+      index > pb->max_replicate_index()) {
+    pb->set_max_replicate_index(index);
   }
 }
 
+} // anonymous namespace
+
+void UpdateFooterForReplicateEntry(const LogEntryPB& entry_pb,
+                                   LogSegmentFooterPB* footer) {
+  UpdateReplicateIndexBounds(entry_pb, footer);
+}
+
+void UpdateIndexCheckpointForReplicateEntry(const LogEntryPB& entry_pb,
+                                            LogSegmentIndexCheckpointPB* checkpoint) {
+  UpdateReplicateIndexBounds(entry_pb, checkpoint);
+}
+
 }  // namespace log
 }  // namespace kudu
@@ -193,9 +193,19 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
   // Rebuilds this segment's footer by scanning its entries.
   // This is an expensive operation as it reads and parses the whole segment
   // so it should be only used in the case of a crash, where the footer is
-  // missing because we didn't have the time to write it out.
+  // missing because we didn't have the time to write it out. If the segment
+  // holds index checkpoints, only the batches following the last one are
+  // read and parsed.
   Status RebuildFooterByScanning();
 
+  // Finds the batch holding the last REPLICATE message with index 'index'
+  // in this segment using the segment's index checkpoints, setting 'offset'
+  // to the offset of the batch and 'op_id' to the message's OpId.
+  //
+  // Returns NotFound if there is no such message, or if the segment has no
+  // footer or no index checkpoints.
+  Status FindReplicateBatch(int64_t index, int64_t* offset, consensus::OpId* op_id);
+
   bool IsInitialized() const {
     return is_initialized_;
   }
@@ -305,6 +315,18 @@ class ReadableLogSegment : public RefCountedThreadSafe<ReadableLogSegment> {
 
   Status ParseFooterMagicAndFooterLength(const Slice &data, uint32_t *parsed_len);
 
+  // Rebuilds the footer from the index checkpoints written to the segment,
+  // reading only the headers of the batches preceding the last checkpoint.
+  //
+  // Sets 'rebuilt' to false and leaves the footer alone if the segment's
+  // batches can't be accounted for this way, e.g. because they are corrupt,
+  // in which case they should be scanned instead.
+  Status RebuildFooterFromIndexCheckpoints(bool* rebuilt);
+
+  // Returns the offset at which the segment's entries end: the start of the
+  // footer if the segment has one on disk, the readable offset otherwise.
+  int64_t entries_end_offset() const;
+
   // Starting at 'offset', read the rest of the log file, looking for any
   // valid log entry headers. If any are found, sets *has_valid_entries to true.
   //
@@ -409,6 +431,12 @@ class WritableLogSegment {
     return writable_file_->Sync();
   }
 
+  // Starts writing back the data of the underlying writable file, without
+  // waiting for it to reach the disk.
+  Status FlushAsync() {
+    return writable_file_->Flush(WritableFile::FLUSH_ASYNC);
+  }
+
   // Returns true if the segment header has already been written to disk.
   bool IsHeaderWritten() const {
     return is_header_written_;
@@ -488,6 +516,10 @@ bool IsLogFileName(const std::string& fname);
 void UpdateFooterForReplicateEntry(
     const LogEntryPB& entry_pb, LogSegmentFooterPB* footer);
 
+// Same as above, for the region of a segment described by 'checkpoint'.
+void UpdateIndexCheckpointForReplicateEntry(
+    const LogEntryPB& entry_pb, LogSegmentIndexCheckpointPB* checkpoint);
+
 }  // namespace log
 }  // namespace kudu
 
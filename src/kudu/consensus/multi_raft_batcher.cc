@@ -0,0 +1,229 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/multi_raft_batcher.h"
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "kudu/common/wire_protocol.h"
+#include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/consensus.proxy.h"
+#include "kudu/consensus/metadata.pb.h"
+#include "kudu/rpc/messenger.h"
+#include "kudu/rpc/rpc_controller.h"
+#include "kudu/rpc/rpc_header.pb.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/net/net_util.h"
+#include "kudu/util/net/sockaddr.h"
+
+// This file uses C++14 'generalized lambda capture' syntax, which is supported
+// in C++11 mode both by clang and by GCC. Disable the accompanying warning.
+#pragma clang diagnostic ignored "-Wc++14-extensions"
+
+DEFINE_int32(raft_heartbeat_batching_window_ms, 0,
+             "How long, in milliseconds, a leader holds back a heartbeat to a "
+             "follower so that it can be sent in a single RPC along with the "
+             "heartbeats of the other tablets whose followers are hosted by the "
+             "same server. Must be well below --raft_heartbeat_interval_ms. "
+             "0 disables batching.");
+TAG_FLAG(raft_heartbeat_batching_window_ms, experimental);
+TAG_FLAG(raft_heartbeat_batching_window_ms, runtime);
+
+DECLARE_int32(consensus_rpc_timeout_ms);
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace consensus {
+
+// A heartbeat added to a batch.
+struct MultiRaftHeartbeatBatcher::Entry {
+  const ConsensusRequestPB* request;
+  ConsensusResponsePB* response;
+  rpc::RpcController* controller;
+  rpc::ResponseCallback callback;
+};
+
+// A set of heartbeats sent in a single RPC.
+class MultiRaftHeartbeatBatcher::Batch {
+ public:
+  explicit Batch(int64_t seq) : seq(seq) {}
+
+  const int64_t seq;
+
+  MultiRaftConsensusRequestPB request;
+  MultiRaftConsensusResponsePB response;
+  rpc::RpcController controller;
+
+  // The heartbeats, in the order of 'request.requests()'.
+  vector<Entry> entries;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Batch);
+};
+
+MultiRaftHeartbeatBatcher::MultiRaftHeartbeatBatcher(string dest_uuid,
+                                                     shared_ptr<rpc::Messenger> messenger,
+                                                     gscoped_ptr<ConsensusServiceProxy> proxy)
+    : dest_uuid_(std::move(dest_uuid)),
+      messenger_(std::move(messenger)),
+      proxy_(std::move(proxy)),
+      next_seq_(0),
+      supported_(true) {
+}
+
+MultiRaftHeartbeatBatcher::~MultiRaftHeartbeatBatcher() {
+  DCHECK(!pending_);
+}
+
+void MultiRaftHeartbeatBatcher::AddRequest(const ConsensusRequestPB* request,
+                                           ConsensusResponsePB* response,
+                                           rpc::RpcController* controller,
+                                           rpc::ResponseCallback callback) {
+  const int32_t window_ms = FLAGS_raft_heartbeat_batching_window_ms;
+  Entry entry = { request, response, controller, std::move(callback) };
+  bool batched = false;
+  bool schedule = false;
+  int64_t seq;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (window_ms > 0 && supported_) {
+      batched = true;
+      if (!pending_) {
+        pending_.reset(new Batch(next_seq_++));
+        schedule = true;
+        seq = pending_->seq;
+      }
+      pending_->request.add_requests()->CopyFrom(*request);
+      pending_->entries.emplace_back(std::move(entry));
+    }
+  }
+
+  if (!batched) {
+    SendAlone(entry);
+    return;
+  }
+  if (schedule) {
+    shared_ptr<MultiRaftHeartbeatBatcher> self = shared_from_this();
+    messenger_->ScheduleOnReactor([self, seq](const Status& s) { self->FlushTask(seq, s); },
+                                  MonoDelta::FromMilliseconds(window_ms));
+  }
+}
+
+void MultiRaftHeartbeatBatcher::FlushTask(int64_t seq, const Status& /* s */) {
+  // Send the batch even if the reactor is shutting down, so that its
+  // heartbeats get a response.
+  shared_ptr<Batch> to_send;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (pending_ && pending_->seq == seq) {
+      to_send = std::move(pending_);
+    }
+  }
+  if (to_send) SendBatch(std::move(to_send));
+}
+
+void MultiRaftHeartbeatBatcher::SendBatch(shared_ptr<Batch> batch) {
+  DCHECK(!batch->entries.empty());
+  batch->request.set_dest_uuid(dest_uuid_);
+  batch->controller.set_timeout(MonoDelta::FromMilliseconds(FLAGS_consensus_rpc_timeout_ms));
+  Batch* batch_ptr = batch.get();
+  proxy_->MultiRaftUpdateConsensusAsync(batch_ptr->request, &batch_ptr->response,
+                                        &batch_ptr->controller,
+                                        [self = shared_from_this(), batch = std::move(batch)]() {
+                                          self->ProcessBatchResponse(batch);
+                                        });
+}
+
+void MultiRaftHeartbeatBatcher::ProcessBatchResponse(const shared_ptr<Batch>& batch) {
+  // Note: This method runs on the reactor thread.
+  const Status& s = batch->controller.status();
+  MultiRaftConsensusResponsePB* resp = &batch->response;
+  if (PREDICT_TRUE(s.ok() && !resp->has_error() &&
+                   resp->responses_size() == batch->entries.size())) {
+    for (int i = 0; i < batch->entries.size(); i++) {
+      const Entry& entry = batch->entries[i];
+      entry.response->Swap(resp->mutable_responses(i));
+      entry.callback();
+    }
+    return;
+  }
+
+  const rpc::ErrorStatusPB* err = batch->controller.error_response();
+  if (s.IsRemoteError() && err && err->code() == rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD) {
+    LOG(INFO) << "Server " << dest_uuid_ << " doesn't support batched heartbeats, "
+              << "sending them one by one";
+    std::lock_guard<simple_spinlock> l(lock_);
+    supported_ = false;
+  } else {
+    Status batch_status = s.ok() ? StatusFromPB(resp->error().status()) : s;
+    VLOG(1) << "Couldn't send a batch of " << batch->entries.size() << " heartbeats to "
+            << dest_uuid_ << ", sending them one by one: " << batch_status.ToString();
+  }
+  for (const Entry& entry : batch->entries) {
+    SendAlone(entry);
+  }
+}
+
+void MultiRaftHeartbeatBatcher::SendAlone(const Entry& entry) {
+  proxy_->UpdateConsensusAsync(*entry.request, entry.response, entry.controller, entry.callback);
+}
+
+MultiRaftManager::MultiRaftManager(shared_ptr<rpc::Messenger> messenger)
+    : messenger_(std::move(messenger)) {
+}
+
+MultiRaftManager::~MultiRaftManager() {
+}
+
+Status MultiRaftManager::GetHeartbeatBatcher(const RaftPeerPB& peer_pb,
+                                             shared_ptr<MultiRaftHeartbeatBatcher>* batcher) {
+  const string& uuid = peer_pb.permanent_uuid();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto it = batchers_.find(uuid);
+    if (it != batchers_.end()) {
+      *batcher = it->second;
+      return Status::OK();
+    }
+  }
+
+  HostPort hostport;
+  RETURN_NOT_OK(HostPortFromPB(peer_pb.last_known_addr(), &hostport));
+  vector<Sockaddr> addrs;
+  RETURN_NOT_OK(hostport.ResolveAddresses(&addrs));
+  if (addrs.empty()) {
+    return Status::NetworkError("Unable to resolve address", hostport.ToString());
+  }
+  gscoped_ptr<ConsensusServiceProxy> proxy(new ConsensusServiceProxy(messenger_, addrs[0]));
+  shared_ptr<MultiRaftHeartbeatBatcher> new_batcher(
+      new MultiRaftHeartbeatBatcher(uuid, messenger_, std::move(proxy)));
+
+  std::lock_guard<simple_spinlock> l(lock_);
+  *batcher = batchers_.emplace(uuid, std::move(new_batcher)).first->second;
+  return Status::OK();
+}
+
+} // namespace consensus
+} // namespace kudu
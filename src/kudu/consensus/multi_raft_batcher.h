@@ -0,0 +1,133 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_CONSENSUS_MULTI_RAFT_BATCHER_H_
+#define KUDU_CONSENSUS_MULTI_RAFT_BATCHER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/rpc/response_callback.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+namespace rpc {
+class Messenger;
+class RpcController;
+}
+
+namespace consensus {
+
+class ConsensusRequestPB;
+class ConsensusResponsePB;
+class ConsensusServiceProxy;
+class RaftPeerPB;
+
+// Groups the heartbeats which the leaders hosted by this server send to their
+// followers hosted by one other server, so that they share a single
+// MultiRaftUpdateConsensus RPC rather than costing one RPC each.
+//
+// A heartbeat is held back for up to --raft_heartbeat_batching_window_ms, and
+// sent along with all the heartbeats to the same server added in the
+// meantime. Each heartbeat is then completed with its own response, as if it
+// had been sent on its own. If the batch as a whole fails (for example if
+// the remote server is unreachable, or too old to support the RPC), each of
+// its heartbeats is resent as a single UpdateConsensus RPC, so that errors
+// are reported to each leader just as they would be without batching.
+//
+// This class is thread-safe.
+class MultiRaftHeartbeatBatcher : public std::enable_shared_from_this<MultiRaftHeartbeatBatcher> {
+ public:
+  MultiRaftHeartbeatBatcher(std::string dest_uuid,
+                            std::shared_ptr<rpc::Messenger> messenger,
+                            gscoped_ptr<ConsensusServiceProxy> proxy);
+
+  ~MultiRaftHeartbeatBatcher();
+
+  // Sends 'request' to the destination server as part of the next batch, or
+  // on its own if batching is disabled. The arguments are the same as
+  // ConsensusServiceProxy::UpdateConsensusAsync()'s: 'callback' runs on a
+  // reactor thread once 'response' and 'controller' hold the result, and
+  // 'request', 'response' and 'controller' must stay valid until then.
+  void AddRequest(const ConsensusRequestPB* request,
+                  ConsensusResponsePB* response,
+                  rpc::RpcController* controller,
+                  rpc::ResponseCallback callback);
+
+ private:
+  struct Entry;
+  class Batch;
+
+  // Called on a reactor thread once the batching window of the batch with
+  // sequence number 'seq' has elapsed. Sends that batch if it's still
+  // pending.
+  void FlushTask(int64_t seq, const Status& s);
+
+  void SendBatch(std::shared_ptr<Batch> batch);
+  void ProcessBatchResponse(const std::shared_ptr<Batch>& batch);
+
+  // Sends the request of 'entry' as a single UpdateConsensus RPC.
+  void SendAlone(const Entry& entry);
+
+  const std::string dest_uuid_;
+  const std::shared_ptr<rpc::Messenger> messenger_;
+  const gscoped_ptr<ConsensusServiceProxy> proxy_;
+
+  // Protects the members below.
+  simple_spinlock lock_;
+  std::shared_ptr<Batch> pending_;
+  int64_t next_seq_;
+
+  // Set to false once the destination server turns out not to support
+  // MultiRaftUpdateConsensus.
+  bool supported_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiRaftHeartbeatBatcher);
+};
+
+// Hands out the heartbeat batchers of a server, one per destination server.
+//
+// This class is thread-safe.
+class MultiRaftManager {
+ public:
+  explicit MultiRaftManager(std::shared_ptr<rpc::Messenger> messenger);
+  ~MultiRaftManager();
+
+  // Sets 'batcher' to the batcher for the heartbeats sent to the server
+  // hosting 'peer_pb', creating it if needed.
+  Status GetHeartbeatBatcher(const RaftPeerPB& peer_pb,
+                             std::shared_ptr<MultiRaftHeartbeatBatcher>* batcher);
+
+ private:
+  const std::shared_ptr<rpc::Messenger> messenger_;
+
+  // The batchers, keyed by the permanent UUID of their destination server.
+  simple_spinlock lock_;
+  std::unordered_map<std::string, std::shared_ptr<MultiRaftHeartbeatBatcher>> batchers_;
+
+  DISALLOW_COPY_AND_ASSIGN(MultiRaftManager);
+};
+
+} // namespace consensus
+} // namespace kudu
+
+#endif /* KUDU_CONSENSUS_MULTI_RAFT_BATCHER_H_ */
@@ -169,8 +169,10 @@ scoped_refptr<RaftConsensus> RaftConsensus::Create(
     const shared_ptr<rpc::Messenger>& messenger,
     const scoped_refptr<log::Log>& log,
     const shared_ptr<MemTracker>& parent_mem_tracker,
-    const Callback<void(const std::string& reason)>& mark_dirty_clbk) {
-  gscoped_ptr<PeerProxyFactory> rpc_factory(new RpcPeerProxyFactory(messenger));
+    const Callback<void(const std::string& reason)>& mark_dirty_clbk,
+    MultiRaftManager* multi_raft_manager) {
+  gscoped_ptr<PeerProxyFactory> rpc_factory(new RpcPeerProxyFactory(messenger,
+                                                                    multi_raft_manager));
 
   // The message queue that keeps track of which operations need to be replicated
   // where.
@@ -1238,10 +1240,9 @@ Status RaftConsensus::UpdateReplica(const ConsensusRequestPB* request,
     }
 
     // All transactions that are going to be prepared were started, advance the safe timestamp.
-    // TODO(dralves) This is only correct because the queue only sets safe time when the request is
-    // an empty heartbeat. If we actually start setting this on a consensus request along with
-    // actual messages we need to be careful to ignore it if any of the messages fails to prepare.
-    if (request->has_safe_timestamp()) {
+    // With leader leases, the leader also sets safe time on requests with messages, in which case
+    // it's only safe if all of them were started.
+    if (request->has_safe_timestamp() && prepare_status.ok()) {
       time_manager_->AdvanceSafeTime(Timestamp(request->safe_timestamp()));
     }
 
@@ -1832,6 +1833,10 @@ RaftConfigPB RaftConsensus::CommittedConfig() const {
   return state_->GetCommittedConfigUnlocked();
 }
 
+void RaftConsensus::GetPeerReplicationStats(vector<PeerReplicationStats>* stats) const {
+  queue_->GetPeerReplicationStats(stats);
+}
+
 void RaftConsensus::DumpStatusHtml(std::ostream& out) const {
   out << "<h1>Raft Consensus State</h1>" << std::endl;
 
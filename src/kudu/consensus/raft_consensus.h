@@ -54,6 +54,7 @@ class Messenger;
 
 namespace consensus {
 class ConsensusMetadata;
+class MultiRaftManager;
 class Peer;
 class PeerProxyFactory;
 class PeerManager;
@@ -73,7 +74,8 @@ class RaftConsensus : public Consensus,
     const std::shared_ptr<rpc::Messenger>& messenger,
     const scoped_refptr<log::Log>& log,
     const std::shared_ptr<MemTracker>& parent_mem_tracker,
-    const Callback<void(const std::string& reason)>& mark_dirty_clbk);
+    const Callback<void(const std::string& reason)>& mark_dirty_clbk,
+    MultiRaftManager* multi_raft_manager = nullptr);
 
   RaftConsensus(const ConsensusOptions& options,
                 std::unique_ptr<ConsensusMetadata> cmeta,
@@ -141,6 +143,8 @@ class RaftConsensus : public Consensus,
 
   void DumpStatusHtml(std::ostream& out) const override;
 
+  void GetPeerReplicationStats(std::vector<PeerReplicationStats>* stats) const override;
+
   void Shutdown() override;
 
   // Makes this peer advance it's term (and step down if leader), for tests.
@@ -0,0 +1,66 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/consensus/ref_counted_replicate.h"
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/mem_tracker.h"
+
+namespace kudu {
+namespace consensus {
+
+RefCountedReplicate::~RefCountedReplicate() {
+  if (mem_tracker_) {
+    mem_tracker_->Release(serialized_.capacity());
+  }
+}
+
+Slice RefCountedReplicate::serialized() {
+  std::call_once(serialize_once_, [this]() {
+    int size = msg_->ByteSize();
+    serialized_.reserve(VarintLength(size) + size);
+    PutVarint32(&serialized_, size);
+    int prefix_len = serialized_.size();
+    serialized_.resize(prefix_len + size);
+    msg_->SerializeWithCachedSizesToArray(serialized_.data() + prefix_len);
+    if (mem_tracker_) {
+      mem_tracker_->Consume(serialized_.capacity());
+    }
+  });
+  return Slice(serialized_);
+}
+
+Status DecodeSerializedReplicates(
+    Slice data, google::protobuf::RepeatedPtrField<ReplicateMsg>* msgs) {
+  while (!data.empty()) {
+    Slice msg_data;
+    if (PREDICT_FALSE(!GetLengthPrefixedSlice(&data, &msg_data))) {
+      return Status::Corruption("truncated serialized ReplicateMsg");
+    }
+    ReplicateMsg* msg = msgs->Add();
+    if (PREDICT_FALSE(!msg->ParseFromArray(msg_data.data(), msg_data.size()))) {
+      return Status::Corruption(strings::Substitute(
+          "unable to parse serialized ReplicateMsg: $0",
+          msg->InitializationErrorString()));
+    }
+  }
+  return Status::OK();
+}
+
+} // namespace consensus
+} // namespace kudu
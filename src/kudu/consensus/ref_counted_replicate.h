@@ -14,18 +14,29 @@
 // KIND, either express or implied.  See the License for the
 // specific language governing permissions and limitations
 // under the License.
-
 #ifndef KUDU_CONSENSUS_REF_COUNTED_REPLICATE_H_
 #define KUDU_CONSENSUS_REF_COUNTED_REPLICATE_H_
 
+#include <memory>
+#include <mutex>
+
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
+
+class MemTracker;
+
 namespace consensus {
 
 // A simple ref-counted wrapper around ReplicateMsg.
+//
+// The wrapper also caches the serialized form of the message, so that a
+// message sent to several peers is serialized only once.
 class RefCountedReplicate : public RefCountedThreadSafe<RefCountedReplicate> {
  public:
   explicit RefCountedReplicate(ReplicateMsg* msg) : msg_(msg) {}
@@ -34,8 +45,27 @@ class RefCountedReplicate : public RefCountedThreadSafe<RefCountedReplicate> {
     return msg_.get();
   }
 
+  // Sets the tracker charged with the memory used by the serialized form of
+  // the message, for as long as this object lives. Must not be called
+  // concurrently with serialized().
+  void set_mem_tracker(std::shared_ptr<MemTracker> mem_tracker) {
+    mem_tracker_ = std::move(mem_tracker);
+  }
+
+  // Returns the message serialized with a varint32 length prefix, as expected
+  // by DecodeSerializedReplicates(). The message is serialized on the first
+  // call only, so it must not be modified afterwards. Thread-safe.
+  Slice serialized();
+
  private:
+  friend class RefCountedThreadSafe<RefCountedReplicate>;
+  ~RefCountedReplicate();
+
   gscoped_ptr<ReplicateMsg> msg_;
+
+  std::once_flag serialize_once_;
+  faststring serialized_;
+  std::shared_ptr<MemTracker> mem_tracker_;
 };
 
 typedef scoped_refptr<RefCountedReplicate> ReplicateRefPtr;
@@ -44,6 +74,11 @@ inline ReplicateRefPtr make_scoped_refptr_replicate(ReplicateMsg* replicate) {
   return ReplicateRefPtr(new RefCountedReplicate(replicate));
 }
 
+// Decodes 'data', a concatenation of messages as returned by
+// RefCountedReplicate::serialized(), appending the messages to 'msgs'.
+Status DecodeSerializedReplicates(
+    Slice data, google::protobuf::RepeatedPtrField<ReplicateMsg>* msgs);
+
 } // namespace consensus
 } // namespace kudu
 
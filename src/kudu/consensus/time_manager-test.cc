@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <gflags/gflags.h>
 #include <thread>
 #include <gtest/gtest.h>
 
@@ -26,6 +27,8 @@
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
 
+DECLARE_bool(raft_enable_leader_leases);
+
 namespace kudu {
 namespace consensus {
 
@@ -196,5 +199,54 @@ TEST_F(TimeManagerTest, TestTimeManagerLeaderMode) {
   after_latch->Wait();
 }
 
+// Tests that with leader leases a leader only moves safe time with the clock, and serves
+// scans at the current time, while it holds a lease.
+TEST_F(TimeManagerTest, TestTimeManagerLeaderLease) {
+  FLAGS_raft_enable_leader_leases = true;
+  Timestamp init = clock_->Now();
+  InitTimeManager(init);
+  time_manager_->SetLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+
+  // Without a lease, safe time is pinned and scans at the current time are rejected.
+  ASSERT_EQ(time_manager_->GetSafeTime(), init);
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromSeconds(10);
+  ASSERT_TRUE(time_manager_->WaitUntilSafe(clock_->Now(), deadline).IsServiceUnavailable());
+
+  // A lease which hasn't started yet doesn't help either.
+  MonoTime now = MonoTime::Now();
+  time_manager_->SetLeaderLease(now + MonoDelta::FromSeconds(10),
+                                now + MonoDelta::FromSeconds(20));
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  ASSERT_EQ(time_manager_->GetSafeTime(), init);
+
+  // Once the leader holds a lease, safe time moves with the clock.
+  time_manager_->SetLeaderLease(now, now + MonoDelta::FromSeconds(10));
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+  ASSERT_OK(time_manager_->WaitUntilSafe(clock_->Now(), deadline));
+  Timestamp safe_with_lease = time_manager_->GetSafeTime();
+  ASSERT_GT(safe_with_lease, init);
+
+  // Once it expires, safe time stops moving again.
+  time_manager_->SetLeaderLease(now, MonoTime::Now());
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  ASSERT_EQ(time_manager_->GetSafeTime(), safe_with_lease);
+  ASSERT_TRUE(time_manager_->WaitUntilSafe(clock_->Now(), deadline).IsServiceUnavailable());
+
+  // Messages appended to the queue still move it.
+  ReplicateMsg message;
+  ASSERT_OK(time_manager_->AssignTimestamp(&message));
+  time_manager_->AdvanceSafeTimeWithMessage(message);
+  ASSERT_EQ(time_manager_->GetSafeTime(), Timestamp(message.timestamp()));
+
+  // Leases are lost when changing modes, and aren't held by non-leaders.
+  time_manager_->SetLeaderLease(now, now + MonoDelta::FromSeconds(10));
+  ASSERT_TRUE(time_manager_->HasLeaderLease());
+  time_manager_->SetNonLeaderMode();
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+  time_manager_->SetLeaderLease(now, now + MonoDelta::FromSeconds(10));
+  ASSERT_FALSE(time_manager_->HasLeaderLease());
+}
+
 } // namespace consensus
 } // namespace kudu
@@ -39,6 +39,14 @@ DEFINE_int32(safe_time_max_lag_ms, 30 * 1000,
              "before forcing the client to retry, in milliseconds.");
 TAG_FLAG(safe_time_max_lag_ms, experimental);
 
+DEFINE_bool(raft_enable_leader_leases, false,
+            "Whether leaders hold leases, acquired from a majority of the voters, before "
+            "considering the current time safe. This makes snapshot scans at the current time "
+            "on leaders linearizable, and allows leaders to send safe time to followers along "
+            "with operations. Leaders which don't hold a lease, for instance during the first "
+            "election timeout of their term, reject such scans.");
+TAG_FLAG(raft_enable_leader_leases, experimental);
+
 DECLARE_int32(raft_heartbeat_interval_ms);
 DECLARE_int32(scanner_max_wait_ms);
 
@@ -66,17 +74,47 @@ TimeManager::TimeManager(scoped_refptr<Clock> clock, Timestamp initial_safe_time
     last_safe_ts_(initial_safe_time),
     last_advanced_safe_time_(MonoTime::Now()),
     mode_(NON_LEADER),
+    leader_lease_start_(MonoTime::Min()),
+    leader_lease_expiration_(MonoTime::Min()),
     clock_(std::move(clock)) {}
 
 void TimeManager::SetLeaderMode() {
   Lock l(lock_);
   mode_ = LEADER;
-  AdvanceSafeTimeAndWakeUpWaitersUnlocked(clock_->Now());
+  leader_lease_start_ = MonoTime::Min();
+  leader_lease_expiration_ = MonoTime::Min();
+  if (MayAdvanceLeaderSafeTimeUnlocked()) {
+    AdvanceSafeTimeAndWakeUpWaitersUnlocked(clock_->Now());
+  }
 }
 
 void TimeManager::SetNonLeaderMode() {
   Lock l(lock_);
   mode_ = NON_LEADER;
+  leader_lease_start_ = MonoTime::Min();
+  leader_lease_expiration_ = MonoTime::Min();
+}
+
+void TimeManager::SetLeaderLease(const MonoTime& start, const MonoTime& expiration) {
+  Lock l(lock_);
+  if (mode_ != LEADER) return;
+  leader_lease_start_ = start;
+  leader_lease_expiration_ = expiration;
+}
+
+bool TimeManager::HasLeaderLease() {
+  Lock l(lock_);
+  return HasLeaderLeaseUnlocked();
+}
+
+bool TimeManager::HasLeaderLeaseUnlocked() {
+  if (mode_ != LEADER) return false;
+  MonoTime now = MonoTime::Now();
+  return leader_lease_start_ <= now && now < leader_lease_expiration_;
+}
+
+bool TimeManager::MayAdvanceLeaderSafeTimeUnlocked() {
+  return PREDICT_TRUE(!FLAGS_raft_enable_leader_leases) || HasLeaderLeaseUnlocked();
 }
 
 Status TimeManager::AssignTimestamp(ReplicateMsg* message) {
@@ -187,10 +225,16 @@ Status TimeManager::WaitUntilSafe(Timestamp timestamp, const MonoTime& deadline)
   // - If this timestamp is before the last safe time return.
   // - If we're not the leader make sure we've heard from the leader recently.
   // - If we're not the leader make sure safe time isn't lagging too much.
+  // - If we're the leader make sure we hold a lease, if leases are enabled.
   {
     Lock l(lock_);
     if (timestamp < GetSafeTimeUnlocked()) return Status::OK();
 
+    if (mode_ == LEADER && !MayAdvanceLeaderSafeTimeUnlocked()) {
+      return Status::ServiceUnavailable("Leader doesn't hold a lease: it might have been "
+                                        "deposed, or it was elected too recently");
+    }
+
     if (mode_ == NON_LEADER) {
       if (IsSafeTimeLaggingUnlocked(timestamp, &error_message)) {
         return Status::TimedOut(error_message);
@@ -287,8 +331,10 @@ Timestamp TimeManager::GetSafeTimeUnlocked() {
       //                    \- last_safe_ts_
       //
       // If the current internal state is a), then we can advance safe time to 'N'. We know the
-      // leader will never assign a new timestamp lower than it.
-      if (PREDICT_TRUE(last_serial_ts_assigned_ <= last_safe_ts_)) {
+      // leader will never assign a new timestamp lower than it. With leader leases, we also
+      // need to know that no other leader may have been elected, i.e. to hold a lease.
+      if (PREDICT_TRUE(last_serial_ts_assigned_ <= last_safe_ts_) &&
+          MayAdvanceLeaderSafeTimeUnlocked()) {
         last_safe_ts_ = clock_->Now();
         last_advanced_safe_time_ = MonoTime::Now();
         return last_safe_ts_;
@@ -52,8 +52,14 @@ class ReplicateMsg;
 // when it advances.
 //
 // This class's leadership status is meant to be in tune with the queue's as the queue
-// is responsible for broadcasting safe time from a leader (and will eventually be responsible
-// for calculating that leader's lease).
+// is responsible for broadcasting safe time from a leader and for calculating that leader's
+// lease.
+//
+// With --raft_enable_leader_leases, a leader only moves safe time with the clock, and only
+// serves snapshot scans which aren't safe yet, while it holds a lease: a majority of the
+// voters has acked a request sent by this leader recently enough that none of them will vote
+// for another candidate until the lease expires. A leader which may have been deposed thus
+// never considers the current time safe.
 //
 // See: docs/design-docs/repeatable-reads.md
 //
@@ -110,11 +116,20 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // Requires non-leader mode (CHECK failure if it isn't).
   void AdvanceSafeTime(Timestamp safe_time);
 
+  // Sets the leader's lease to be held from 'start' until 'expiration'.
+  //
+  // Called by the queue as the followers ack its requests. Ignored in non-leader mode.
+  void SetLeaderLease(const MonoTime& start, const MonoTime& expiration);
+
+  // Returns whether this is a leader which currently holds a lease.
+  bool HasLeaderLease();
+
   // Waits until 'timestamp' is less than or equal to safe time or until 'deadline' has elapsed.
   //
   // Returns Status::OK() if it safe time advanced past 'timestamp' before 'deadline'
   // Returns Status::TimeOut() if deadline elapsed without safe time moving enough.
-  // Returns Status::ServiceUnavailable() is the request should be retried somewhere else.
+  // Returns Status::ServiceUnavailable() is the request should be retried somewhere else,
+  // e.g. if leader leases are enabled and this leader doesn't hold one.
   //
   // TODO(KUDU-1127) make this return another status if safe time is too far back in the past
   // or hasn't moved in a long time.
@@ -180,6 +195,13 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // Internal, unlocked implementation of GetSafeTime();
   Timestamp GetSafeTimeUnlocked();
 
+  // Internal, unlocked implementation of HasLeaderLease().
+  bool HasLeaderLeaseUnlocked();
+
+  // Returns whether the leader's safe time may move with the clock, i.e. whether leader
+  // leases are disabled or this leader holds one.
+  bool MayAdvanceLeaderSafeTimeUnlocked();
+
   // Lock to protect the non-const fields below.
   mutable simple_spinlock lock_;
 
@@ -200,6 +222,10 @@ class TimeManager : public RefCountedThreadSafe<TimeManager> {
   // The current mode of the TimeManager.
   Mode mode_;
 
+  // The interval during which this leader holds a lease, empty if it doesn't.
+  MonoTime leader_lease_start_;
+  MonoTime leader_lease_expiration_;
+
   const scoped_refptr<server::Clock> clock_;
   const std::string local_peer_uuid_;
 };
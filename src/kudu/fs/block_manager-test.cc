@@ -16,11 +16,13 @@
 // under the License.
 
 #include <memory>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <string>
 #include <vector>
 
+#include "kudu/fs/data_dirs.h"
 #include "kudu/fs/file_block_manager.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/log_block_manager.h"
@@ -28,6 +30,7 @@
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
@@ -54,13 +57,27 @@ DECLARE_uint64(log_container_max_size);
 DECLARE_int64(fs_data_dirs_reserved_bytes);
 DECLARE_int64(disk_reserved_bytes_free_for_testing);
 DECLARE_int64(log_container_max_blocks);
+DECLARE_int32(log_container_metadata_compaction_min_records);
+DECLARE_double(log_container_defrag_live_ratio);
 
 DECLARE_int32(fs_data_dirs_full_disk_cache_seconds);
+DECLARE_bool(fs_data_dirs_load_aware_placement);
+DECLARE_bool(block_manager_direct_io_reads);
+DECLARE_bool(block_manager_mmap_reads);
+DECLARE_bool(block_coalesce_close);
+DECLARE_int32(fs_data_dirs_degraded_write_latency_ms);
+DECLARE_int32(fs_data_dirs_degraded_exclusion_seconds);
+DECLARE_string(fs_data_dirs_fast_tier);
 
 DECLARE_string(block_manager);
 
 DECLARE_double(env_inject_io_error_on_write_or_preallocate);
 
+METRIC_DECLARE_entity(directory);
+METRIC_DECLARE_histogram(dir_read_latency);
+METRIC_DECLARE_histogram(dir_sync_latency);
+METRIC_DECLARE_gauge_uint64(dir_reads_in_flight);
+
 // Generic block manager metrics.
 METRIC_DECLARE_gauge_uint64(block_manager_blocks_open_reading);
 METRIC_DECLARE_gauge_uint64(block_manager_blocks_open_writing);
@@ -441,6 +458,144 @@ TYPED_TEST(BlockManagerTest, EndToEndTest) {
               .IsNotFound());
 }
 
+TYPED_TEST(BlockManagerTest, DirectIoReadTest) {
+  FLAGS_block_manager_direct_io_reads = true;
+  ASSERT_OK(this->ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                                     shared_ptr<MemTracker>(),
+                                     { this->test_dir_ },
+                                     false));
+
+  // Write blocks of unaligned sizes, so that reads are unaligned.
+  Random rand(SeedRandom());
+  vector<BlockId> ids;
+  vector<string> contents;
+  for (int i = 0; i < 4; i++) {
+    gscoped_ptr<WritableBlock> written_block;
+    ASSERT_OK(this->bm_->CreateBlock(&written_block));
+    string data(1000 + rand.Uniform(10000), 'a' + i);
+    ASSERT_OK(written_block->Append(data));
+    ASSERT_OK(written_block->Close());
+    ids.push_back(written_block->id());
+    contents.push_back(std::move(data));
+  }
+
+  // Read them back, both before and after reopening the block manager.
+  for (int reopen = 0; reopen < 2; reopen++) {
+    if (reopen) {
+      ASSERT_OK(this->ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                                         shared_ptr<MemTracker>(),
+                                         { this->test_dir_ },
+                                         false));
+    }
+    for (int i = 0; i < ids.size(); i++) {
+      gscoped_ptr<ReadableBlock> read_block;
+      ASSERT_OK(this->bm_->OpenBlock(ids[i], &read_block));
+      Slice data;
+      gscoped_ptr<uint8_t[]> scratch(new uint8_t[contents[i].size()]);
+      ASSERT_OK(read_block->Read(1, contents[i].size() - 1, &data, scratch.get()));
+      ASSERT_EQ(contents[i].substr(1), data);
+    }
+  }
+}
+
+TYPED_TEST(BlockManagerTest, MmapReadTest) {
+  FLAGS_block_manager_mmap_reads = true;
+  ASSERT_OK(this->ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                                     shared_ptr<MemTracker>(),
+                                     { this->test_dir_ },
+                                     false));
+
+  // Write blocks of unaligned sizes, so that their mappings are unaligned
+  // within log block containers.
+  Random rand(SeedRandom());
+  vector<BlockId> ids;
+  vector<string> contents;
+  for (int i = 0; i < 4; i++) {
+    gscoped_ptr<WritableBlock> written_block;
+    ASSERT_OK(this->bm_->CreateBlock(&written_block));
+    string data(1000 + rand.Uniform(10000), 'a' + i);
+    ASSERT_OK(written_block->Append(data));
+    ASSERT_OK(written_block->Close());
+    ids.push_back(written_block->id());
+    contents.push_back(std::move(data));
+  }
+
+  // Each block maps exactly its own contents, both before and after
+  // reopening the block manager, and can still be read as usual.
+  for (int reopen = 0; reopen < 2; reopen++) {
+    if (reopen) {
+      ASSERT_OK(this->ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                                         shared_ptr<MemTracker>(),
+                                         { this->test_dir_ },
+                                         false));
+    }
+    for (int i = 0; i < ids.size(); i++) {
+      gscoped_ptr<ReadableBlock> read_block;
+      ASSERT_OK(this->bm_->OpenBlock(ids[i], &read_block));
+      const MemoryMappedRegion* region = read_block->mapped_region();
+      ASSERT_TRUE(region != nullptr);
+      ASSERT_EQ(contents[i], region->data());
+      region->Advise(0, contents[i].size(), MemoryMappedRegion::SEQUENTIAL);
+      Slice data;
+      gscoped_ptr<uint8_t[]> scratch(new uint8_t[contents[i].size()]);
+      ASSERT_OK(read_block->Read(0, contents[i].size(), &data, scratch.get()));
+      ASSERT_EQ(contents[i], data);
+    }
+  }
+
+  // Without the flag, blocks aren't mapped.
+  FLAGS_block_manager_mmap_reads = false;
+  gscoped_ptr<ReadableBlock> read_block;
+  ASSERT_OK(this->bm_->OpenBlock(ids[0], &read_block));
+  ASSERT_TRUE(read_block->mapped_region() == nullptr);
+}
+
+TYPED_TEST(BlockManagerTest, ReadAsyncTest) {
+  // Write a block made of several chunks.
+  const int kNumChunks = 8;
+  const int kChunkSize = 4096;
+  string test_data;
+  for (int i = 0; i < kNumChunks; i++) {
+    test_data.append(kChunkSize, 'a' + i);
+  }
+  gscoped_ptr<WritableBlock> written_block;
+  ASSERT_OK(this->bm_->CreateBlock(&written_block));
+  ASSERT_OK(written_block->Append(test_data));
+  ASSERT_OK(written_block->Close());
+
+  // Read all the chunks at once.
+  gscoped_ptr<ReadableBlock> read_block;
+  ASSERT_OK(this->bm_->OpenBlock(written_block->id(), &read_block));
+  vector<Slice> results(kNumChunks);
+  vector<Status> statuses(kNumChunks);
+  gscoped_ptr<uint8_t[]> scratch(new uint8_t[test_data.length()]);
+  CountDownLatch latch(kNumChunks);
+  for (int i = 0; i < kNumChunks; i++) {
+    read_block->ReadAsync(i * kChunkSize, kChunkSize, &results[i],
+                          scratch.get() + i * kChunkSize,
+                          [&, i](const Status& s) {
+                            statuses[i] = s;
+                            latch.CountDown();
+                          });
+  }
+  latch.Wait();
+  for (int i = 0; i < kNumChunks; i++) {
+    ASSERT_OK(statuses[i]);
+    ASSERT_EQ(test_data.substr(i * kChunkSize, kChunkSize), results[i]);
+  }
+
+  // Reads past the end of the block fail as Read() does.
+  Status past_end = Status::OK();
+  CountDownLatch past_end_latch(1);
+  read_block->ReadAsync(test_data.length(), 1, &results[0], scratch.get(),
+                        [&](const Status& s) {
+                          past_end = s;
+                          past_end_latch.CountDown();
+                        });
+  past_end_latch.Wait();
+  ASSERT_FALSE(past_end.ok());
+}
+
 // Test that we can still read from an opened block after deleting it
 // (even if we can't open it again).
 TYPED_TEST(BlockManagerTest, ReadAfterDeleteTest) {
@@ -515,6 +670,40 @@ TYPED_TEST(BlockManagerTest, CloseManyBlocksTest) {
   }
 }
 
+TYPED_TEST(BlockManagerTest, CloseBlocksTest) {
+  const int kNumBlocks = 10;
+
+  for (bool coalesce : { false, true }) {
+    FLAGS_block_coalesce_close = coalesce;
+
+    // Write some blocks, one of which is closed ahead of the others.
+    vector<WritableBlock*> dirty_blocks;
+    ElementDeleter deleter(&dirty_blocks);
+    vector<string> test_data;
+    for (int i = 0; i < kNumBlocks; i++) {
+      gscoped_ptr<WritableBlock> written_block;
+      ASSERT_OK(this->bm_->CreateBlock(&written_block));
+      test_data.emplace_back(Substitute("test data $0 ($1)", i, coalesce));
+      ASSERT_OK(written_block->Append(test_data.back()));
+      dirty_blocks.push_back(written_block.release());
+    }
+    ASSERT_OK(dirty_blocks[0]->Close());
+
+    ASSERT_OK(this->bm_->CloseBlocks(dirty_blocks));
+
+    // All the blocks are closed and can be read back.
+    for (int i = 0; i < kNumBlocks; i++) {
+      ASSERT_EQ(WritableBlock::CLOSED, dirty_blocks[i]->state());
+      gscoped_ptr<ReadableBlock> read_block;
+      ASSERT_OK(this->bm_->OpenBlock(dirty_blocks[i]->id(), &read_block));
+      gscoped_ptr<uint8_t[]> scratch(new uint8_t[test_data[i].length()]);
+      Slice data;
+      ASSERT_OK(read_block->Read(0, test_data[i].length(), &data, scratch.get()));
+      ASSERT_EQ(test_data[i], data);
+    }
+  }
+}
+
 // We can't really test that FlushDataAsync() "works", but we can test that
 // it doesn't break anything.
 TYPED_TEST(BlockManagerTest, FlushDataAsyncTest) {
@@ -568,9 +757,9 @@ static void CheckMetrics(const scoped_refptr<MetricEntity>& metrics,
                          int blocks_open_reading, int blocks_open_writing,
                          int total_readable_blocks, int total_writable_blocks,
                          int total_bytes_read, int total_bytes_written) {
-  ASSERT_EQ(blocks_open_reading, down_cast<AtomicGauge<uint64_t>*>(
+  ASSERT_EQ(blocks_open_reading, down_cast<StripedGauge<uint64_t>*>(
                 metrics->FindOrNull(METRIC_block_manager_blocks_open_reading).get())->value());
-  ASSERT_EQ(blocks_open_writing, down_cast<AtomicGauge<uint64_t>*>(
+  ASSERT_EQ(blocks_open_writing, down_cast<StripedGauge<uint64_t>*>(
                 metrics->FindOrNull(METRIC_block_manager_blocks_open_writing).get())->value());
   ASSERT_EQ(total_readable_blocks, down_cast<Counter*>(
                 metrics->FindOrNull(METRIC_block_manager_total_readable_blocks).get())->value());
@@ -673,6 +862,119 @@ TYPED_TEST(BlockManagerTest, MultiPathTest) {
   ASSERT_NO_FATAL_FAILURE(this->RunMultipathTest(paths));
 }
 
+class DataDirManagerTest : public KuduTest {};
+
+TEST_F(DataDirManagerTest, TestLoadAwarePlacement) {
+  FLAGS_fs_data_dirs_load_aware_placement = true;
+  FLAGS_fs_data_dirs_degraded_write_latency_ms = 100;
+  FLAGS_fs_data_dirs_degraded_exclusion_seconds = 1;
+
+  vector<string> paths = { GetTestPath("path0"), GetTestPath("path1") };
+  DataDirManager dd_manager(env_, scoped_refptr<MetricEntity>(), "file", paths);
+  ASSERT_OK(dd_manager.Create(0));
+  ASSERT_OK(dd_manager.Open(kuint16max, DataDirManager::LockMode::NONE));
+  DataDir* dd0 = dd_manager.data_dirs()[0].get();
+  DataDir* dd1 = dd_manager.data_dirs()[1].get();
+
+  // New blocks stay away from a dir with writes in flight.
+  for (int i = 0; i < 4; i++) {
+    dd0->IoStarted(DirIoMetrics::WRITE);
+  }
+  for (int i = 0; i < 20; i++) {
+    DataDir* dir;
+    ASSERT_OK(dd_manager.GetNextDataDir(&dir));
+    ASSERT_EQ(dd1, dir);
+  }
+  for (int i = 0; i < 4; i++) {
+    dd0->IoFinished(DirIoMetrics::WRITE, "f", MonoDelta::FromMilliseconds(1));
+  }
+
+  // A dir whose writes are slow is degraded and excluded for a while, even
+  // though it has the least writes in flight.
+  dd1->IoStarted(DirIoMetrics::WRITE);
+  dd1->IoFinished(DirIoMetrics::WRITE, "f", MonoDelta::FromSeconds(10));
+  ASSERT_TRUE(dd1->GetLoad(MonoTime::Now()).degraded);
+  dd0->IoStarted(DirIoMetrics::WRITE);
+  for (int i = 0; i < 20; i++) {
+    DataDir* dir;
+    ASSERT_OK(dd_manager.GetNextDataDir(&dir));
+    ASSERT_EQ(dd0, dir);
+  }
+  dd0->IoFinished(DirIoMetrics::WRITE, "f", MonoDelta::FromMilliseconds(1));
+
+  // Once the exclusion is over, the dir starts over with a clean slate.
+  SleepFor(MonoDelta::FromSeconds(1));
+  DataDir::Load load = dd1->GetLoad(MonoTime::Now());
+  ASSERT_FALSE(load.degraded);
+  ASSERT_EQ(0, load.avg_write_latency_us);
+
+  // All else being equal, the dir with more free space is cheaper.
+  DataDir::Load emptier = { 0, 1000, 1000, false };
+  DataDir::Load fuller = { 0, 1000, 100, false };
+  ASSERT_LT(DataDirManager::LoadCost(emptier, 1000),
+            DataDirManager::LoadCost(fuller, 1000));
+}
+
+TEST_F(DataDirManagerTest, TestTieredPlacement) {
+  vector<string> paths = { GetTestPath("path0"), GetTestPath("path1"),
+                           GetTestPath("path2") };
+  FLAGS_fs_data_dirs_fast_tier = paths[0];
+  DataDirManager dd_manager(env_, scoped_refptr<MetricEntity>(), "file", paths);
+  ASSERT_OK(dd_manager.Create(0));
+  ASSERT_OK(dd_manager.Open(kuint16max, DataDirManager::LockMode::NONE));
+  DataDir* dd0 = dd_manager.data_dirs()[0].get();
+  ASSERT_EQ(StorageTier::FAST, dd0->tier());
+  ASSERT_EQ(StorageTier::SLOW, dd_manager.data_dirs()[1]->tier());
+
+  // Each tier gets the blocks meant for it, and the others go anywhere.
+  CreateBlockOptions fast_opts;
+  fast_opts.tier = StorageTier::FAST;
+  CreateBlockOptions slow_opts;
+  slow_opts.tier = StorageTier::SLOW;
+  unordered_set<DataDir*> any_dirs;
+  for (int i = 0; i < 20; i++) {
+    DataDir* dir;
+    ASSERT_OK(dd_manager.GetNextDataDir(fast_opts, &dir));
+    ASSERT_EQ(dd0, dir);
+    ASSERT_OK(dd_manager.GetNextDataDir(slow_opts, &dir));
+    ASSERT_NE(dd0, dir);
+    ASSERT_OK(dd_manager.GetNextDataDir(CreateBlockOptions(), &dir));
+    any_dirs.insert(dir);
+  }
+  ASSERT_EQ(3, any_dirs.size());
+
+  // Entries which aren't data dirs are rejected.
+  FLAGS_fs_data_dirs_fast_tier = GetTestPath("other");
+  DataDirManager bad_manager(env_, scoped_refptr<MetricEntity>(), "file", paths);
+  Status s = bad_manager.Open(kuint16max, DataDirManager::LockMode::NONE);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST_F(DataDirManagerTest, TestDirIoMetrics) {
+  MetricRegistry registry;
+  vector<string> paths = { GetTestPath("path0"), GetTestPath("path1") };
+  DataDirManager dd_manager(env_, scoped_refptr<MetricEntity>(), "file", paths,
+                            &registry);
+  ASSERT_OK(dd_manager.Create(0));
+  ASSERT_OK(dd_manager.Open(kuint16max, DataDirManager::LockMode::NONE));
+  DataDir* dd0 = dd_manager.data_dirs()[0].get();
+
+  // Each dir has metrics of its own.
+  scoped_refptr<MetricEntity> entity0 =
+      METRIC_ENTITY_directory.Instantiate(&registry, dd0->dir());
+  scoped_refptr<MetricEntity> entity1 = METRIC_ENTITY_directory.Instantiate(
+      &registry, dd_manager.data_dirs()[1]->dir());
+  scoped_refptr<AtomicGauge<uint64_t>> in_flight =
+      METRIC_dir_reads_in_flight.Instantiate(entity0, 0);
+  dd0->IoStarted(DirIoMetrics::READ);
+  ASSERT_EQ(1, in_flight->value());
+  dd0->IoFinished(DirIoMetrics::READ, "f", MonoDelta::FromMilliseconds(5));
+  ASSERT_EQ(0, in_flight->value());
+  ASSERT_EQ(1, METRIC_dir_read_latency.Instantiate(entity0)->TotalCount());
+  ASSERT_EQ(0, METRIC_dir_sync_latency.Instantiate(entity0)->TotalCount());
+  ASSERT_EQ(0, METRIC_dir_read_latency.Instantiate(entity1)->TotalCount());
+}
+
 static void CloseHelper(ReadableBlock* block) {
   CHECK_OK(block->Close());
 }
@@ -1103,6 +1405,156 @@ TEST_F(LogBlockManagerTest, TestPreallocationAndTruncation) {
   }
 }
 
+// Test that the metadata of a container holding mostly deleted blocks is
+// compacted when the block manager is opened.
+TEST_F(LogBlockManagerTest, TestMetadataCompaction) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+
+  FLAGS_log_container_metadata_compaction_min_records = 10;
+
+  // Create some blocks and delete all but two of them, including the one
+  // ending last in the container.
+  const int kNumBlocks = 50;
+  vector<BlockId> created_blocks;
+  for (int i = 0; i < kNumBlocks; i++) {
+    gscoped_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(&writer));
+    ASSERT_OK(writer->Append(Substitute("block $0", i)));
+    created_blocks.push_back(writer->id());
+    ASSERT_OK(writer->Close());
+  }
+  ASSERT_EQ(1, bm_->all_containers_.size());
+  for (int i = 0; i < kNumBlocks; i++) {
+    if (i != 0 && i != kNumBlocks / 2) {
+      ASSERT_OK(bm_->DeleteBlock(created_blocks[i]));
+    }
+  }
+
+  string path = LogBlockManager::ContainerPathForTests(bm_->all_containers_.front());
+  string metadata_path = path + LogBlockManager::kContainerMetadataFileSuffix;
+  string data_path = path + LogBlockManager::kContainerDataFileSuffix;
+  uint64_t meta_size_before;
+  ASSERT_OK(env_->GetFileSize(metadata_path, &meta_size_before));
+  uint64_t data_size_before;
+  ASSERT_OK(env_->GetFileSize(data_path, &data_size_before));
+
+  // Reopen the block manager; the metadata should shrink while the container
+  // keeps its extent.
+  ASSERT_OK(ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                               shared_ptr<MemTracker>(),
+                               { this->test_dir_ },
+                               false));
+  uint64_t meta_size_after;
+  ASSERT_OK(env_->GetFileSize(metadata_path, &meta_size_after));
+  ASSERT_LT(meta_size_after, meta_size_before);
+  ASSERT_EQ(2, bm_->CountBlocksForTests());
+  for (int i : { 0, kNumBlocks / 2 }) {
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(bm_->OpenBlock(created_blocks[i], &block));
+    string expected = Substitute("block $0", i);
+    uint64_t size;
+    ASSERT_OK(block->Size(&size));
+    ASSERT_EQ(expected.size(), size);
+    Slice data;
+    gscoped_ptr<uint8_t[]> scratch(new uint8_t[size]);
+    ASSERT_OK(block->Read(0, size, &data, scratch.get()));
+    ASSERT_EQ(expected, data);
+  }
+
+  // New blocks must not reuse the space of the deleted ones.
+  {
+    gscoped_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(&writer));
+    ASSERT_OK(writer->Append("new block"));
+    ASSERT_OK(writer->Close());
+  }
+  uint64_t data_size_after;
+  ASSERT_OK(env_->GetFileSize(data_path, &data_size_after));
+  ASSERT_GT(data_size_after, data_size_before);
+
+  // The compacted metadata must itself be readable.
+  ASSERT_OK(ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                               shared_ptr<MemTracker>(),
+                               { this->test_dir_ },
+                               false));
+  ASSERT_EQ(3, bm_->CountBlocksForTests());
+}
+
+TEST_F(LogBlockManagerTest, TestDefragmentContainers) {
+  RETURN_NOT_LOG_BLOCK_MANAGER();
+
+  FLAGS_log_container_max_blocks = 10;
+  FLAGS_log_container_defrag_live_ratio = 0.5;
+  ASSERT_OK(ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                               shared_ptr<MemTracker>(),
+                               { this->test_dir_ },
+                               false));
+
+  // Fill a container and delete most of its blocks.
+  const int kNumBlocks = 10;
+  vector<BlockId> created_blocks;
+  for (int i = 0; i < kNumBlocks; i++) {
+    gscoped_ptr<WritableBlock> writer;
+    ASSERT_OK(bm_->CreateBlock(&writer));
+    ASSERT_OK(writer->Append(Substitute("block $0", i)));
+    created_blocks.push_back(writer->id());
+    ASSERT_OK(writer->Close());
+  }
+  ASSERT_EQ(1, bm_->all_containers_.size());
+  string path = LogBlockManager::ContainerPathForTests(bm_->all_containers_.front());
+  const vector<int> kLiveBlocks = { 3, 7 };
+  for (int i = 0; i < kNumBlocks; i++) {
+    if (std::find(kLiveBlocks.begin(), kLiveBlocks.end(), i) == kLiveBlocks.end()) {
+      ASSERT_OK(bm_->DeleteBlock(created_blocks[i]));
+    }
+  }
+
+  auto check_blocks = [&]() {
+    ASSERT_EQ(kLiveBlocks.size(), bm_->CountBlocksForTests());
+    for (int i : kLiveBlocks) {
+      gscoped_ptr<ReadableBlock> block;
+      ASSERT_OK(bm_->OpenBlock(created_blocks[i], &block));
+      string expected = Substitute("block $0", i);
+      uint64_t size;
+      ASSERT_OK(block->Size(&size));
+      ASSERT_EQ(expected.size(), size);
+      Slice data;
+      gscoped_ptr<uint8_t[]> scratch(new uint8_t[size]);
+      ASSERT_OK(block->Read(0, size, &data, scratch.get()));
+      ASSERT_EQ(expected, data);
+    }
+  };
+
+  // A block opened before the defragmentation stays readable until it's
+  // closed, which the deletion of the container waits for.
+  gscoped_ptr<ReadableBlock> reader;
+  ASSERT_OK(bm_->OpenBlock(created_blocks[kLiveBlocks[0]], &reader));
+  std::thread defrag([&]() { bm_->DefragmentContainers(); });
+  NO_FATALS(check_blocks());
+  uint64_t size;
+  ASSERT_OK(reader->Size(&size));
+  Slice data;
+  gscoped_ptr<uint8_t[]> scratch(new uint8_t[size]);
+  ASSERT_OK(reader->Read(0, size, &data, scratch.get()));
+  ASSERT_EQ(Substitute("block $0", kLiveBlocks[0]), data);
+  reader.reset();
+  defrag.join();
+
+  // The live blocks now live in a new container, and the old one is gone.
+  ASSERT_EQ(1, bm_->all_containers_.size());
+  ASSERT_NE(path, LogBlockManager::ContainerPathForTests(bm_->all_containers_.front()));
+  ASSERT_FALSE(env_->FileExists(path + LogBlockManager::kContainerDataFileSuffix));
+  ASSERT_FALSE(env_->FileExists(path + LogBlockManager::kContainerMetadataFileSuffix));
+  NO_FATALS(check_blocks());
+
+  // The moves are persisted.
+  ASSERT_OK(ReopenBlockManager(scoped_refptr<MetricEntity>(),
+                               shared_ptr<MemTracker>(),
+                               { this->test_dir_ },
+                               false));
+  NO_FATALS(check_blocks());
+}
+
 TYPED_TEST(BlockManagerTest, TestDiskSpaceCheck) {
   // Reopen the block manager with metrics enabled.
   MetricRegistry registry;
@@ -21,14 +21,20 @@
 
 #include <glog/logging.h>
 
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/integral_types.h"
+#include "kudu/gutil/singleton.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/io_rate_limiter.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/threadpool.h"
 
-DEFINE_bool(block_coalesce_close, false,
-            "Coalesce synchronization of data during CloseBlocks()");
+DEFINE_bool(block_coalesce_close, true,
+            "Coalesce synchronization of data and metadata during CloseBlocks(): "
+            "each dirty file and directory is synchronized once for the whole "
+            "group of blocks, in parallel across data directories");
 TAG_FLAG(block_coalesce_close, experimental);
 
 DEFINE_bool(block_manager_lock_dirs, true,
@@ -43,13 +49,74 @@ DEFINE_int64(block_manager_max_open_files, -1,
 TAG_FLAG(block_manager_max_open_files, advanced);
 TAG_FLAG(block_manager_max_open_files, evolving);
 
+DEFINE_bool(block_manager_direct_io_reads, false,
+            "Whether to read data blocks with direct I/O, bypassing the OS "
+            "page cache. This avoids caching CFile and delta file blocks "
+            "both in the page cache and in the block cache, and keeps "
+            "compactions from churning the page cache, but every read that "
+            "misses the block cache then goes to disk. Mostly useful when "
+            "the block cache holds much of the data.");
+TAG_FLAG(block_manager_direct_io_reads, experimental);
+
+DEFINE_int32(block_manager_async_read_threads, 16,
+             "Maximum number of threads performing the asynchronous block "
+             "reads issued by CFile read-ahead, and thus the maximum number "
+             "of such reads in flight at once. Fast devices (e.g. NVMe) may "
+             "need more for scans to keep them busy.");
+TAG_FLAG(block_manager_async_read_threads, experimental);
+
+DEFINE_bool(block_manager_mmap_reads, false,
+            "Whether to memory map data blocks opened for reading. Blocks "
+            "of uncompressed CFiles are then read straight from the "
+            "mapping, without copying them into the block cache; this suits "
+            "hot data on fast devices which the page cache holds anyway. "
+            "Blocks which cannot be mapped are read as usual.");
+TAG_FLAG(block_manager_mmap_reads, experimental);
+
 using strings::Substitute;
 
 namespace kudu {
 namespace fs {
 
+namespace {
+
+// Process-wide pool of threads which perform ReadableBlock::ReadAsync().
+class AsyncReadPool {
+ public:
+  static ThreadPool* Get() {
+    return Singleton<AsyncReadPool>::get()->pool_.get();
+  }
+
+ private:
+  friend class Singleton<AsyncReadPool>;
+
+  AsyncReadPool() {
+    CHECK_OK(ThreadPoolBuilder("block-read")
+             .set_max_threads(FLAGS_block_manager_async_read_threads)
+             .Build(&pool_));
+  }
+
+  gscoped_ptr<ThreadPool> pool_;
+};
+
+} // anonymous namespace
+
+void ReadableBlock::ReadAsync(uint64_t offset, size_t length, Slice* result,
+                              uint8_t* scratch, ReadCallback callback) const {
+  bool background_io = IoRateLimiter::IsBackgroundIoThread();
+  Status s = AsyncReadPool::Get()->SubmitFunc(
+      [this, offset, length, result, scratch, callback, background_io]() {
+        ScopedBackgroundIo scope(background_io);
+        callback(Read(offset, length, result, scratch));
+      });
+  if (PREDICT_FALSE(!s.ok())) {
+    callback(Read(offset, length, result, scratch));
+  }
+}
+
 BlockManagerOptions::BlockManagerOptions()
-  : read_only(false) {
+  : metric_registry(nullptr),
+    read_only(false) {
 }
 
 BlockManagerOptions::~BlockManagerOptions() {
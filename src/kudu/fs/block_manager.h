@@ -19,6 +19,7 @@
 #define KUDU_FS_BLOCK_MANAGER_H
 
 #include <cstddef>
+#include <functional>
 #include <memory>
 #include <stdint.h>
 #include <string>
@@ -37,7 +38,9 @@ namespace kudu {
 
 class Env;
 class MemTracker;
+class MemoryMappedRegion;
 class MetricEntity;
+class MetricRegistry;
 class Slice;
 
 namespace fs {
@@ -69,8 +72,9 @@ class Block {
 // 1. FlushDataAsync() before Close(). If there's enough work to be done
 //    between the two calls, there will be less outstanding I/O to wait for
 //    during Close().
-// 2. CloseBlocks() on a group of blocks. This at least ensures that, when
-//    waiting on outstanding I/O, the waiting is done in parallel.
+// 2. CloseBlocks() on a group of blocks. Each dirty file and directory is
+//    synchronized once for the whole group, and the synchronization is done
+//    in parallel across data directories.
 //
 // NOTE: if a WritableBlock is not explicitly Close()ed, it will be aborted
 // (i.e. deleted).
@@ -153,12 +157,49 @@ class ReadableBlock : public Block {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const = 0;
 
+  typedef std::function<void(const Status&)> ReadCallback;
+
+  // Like Read(), but returns immediately: the read is done by one of a
+  // process-wide pool of I/O threads, which then invokes 'callback' with its
+  // status. If the read cannot be queued, it is done (and 'callback' invoked)
+  // by the calling thread instead. The block, 'result' and 'scratch' must
+  // remain alive until 'callback' has been invoked.
+  //
+  // Up to --block_manager_async_read_threads reads issued this way are in
+  // flight at once, regardless of which threads issued them. Background I/O
+  // accounting (see ScopedBackgroundIo) is inherited from the calling thread.
+  virtual void ReadAsync(uint64_t offset, size_t length, Slice* result,
+                         uint8_t* scratch, ReadCallback callback) const;
+
+  // With --block_manager_mmap_reads, returns the memory mapping of the
+  // block's entire contents, which may then be used instead of Read(). The
+  // mapping is owned by the block and is valid until the block is destroyed.
+  //
+  // Returns null if the block isn't memory mapped.
+  virtual const MemoryMappedRegion* mapped_region() const { return nullptr; }
+
   // Returns the memory usage of this object including the object itself.
   virtual size_t memory_footprint() const = 0;
 };
 
+// The storage tiers to which data directories belong.
+enum class StorageTier {
+  // No particular tier. Only meaningful as a placement hint.
+  ANY,
+
+  // Fast storage such as NVMe drives, for hot data.
+  FAST,
+
+  // Slow storage such as spinning disks, for cold data. Data directories
+  // belong to this tier unless --fs_data_dirs_fast_tier says otherwise.
+  SLOW,
+};
+
 // Provides options and hints for block placement.
 struct CreateBlockOptions {
+  // The tier on which to place the block. If none of the tier's data
+  // directories has free space, the block is placed on any tier.
+  StorageTier tier = StorageTier::ANY;
 };
 
 // Block manager creation options.
@@ -172,6 +213,12 @@ struct BlockManagerOptions {
   // Defaults to NULL.
   scoped_refptr<MetricEntity> metric_entity;
 
+  // The registry with which the metrics of each data directory are
+  // registered, as entities of their own. If NULL, they will not be produced.
+  //
+  // Defaults to NULL.
+  MetricRegistry* metric_registry;
+
   // The memory tracker under which all new memory trackers will be parented.
   // If NULL, new memory trackers will be parented to the root tracker.
   std::shared_ptr<MemTracker> parent_mem_tracker;
@@ -54,7 +54,7 @@ namespace fs {
 namespace internal {
 
 #define MINIT(x) x(METRIC_block_manager_##x.Instantiate(entity))
-#define GINIT(x) x(METRIC_block_manager_##x.Instantiate(entity, 0))
+#define GINIT(x) x(METRIC_block_manager_##x.InstantiateStriped(entity))
 BlockManagerMetrics::BlockManagerMetrics(const scoped_refptr<MetricEntity>& entity)
   : GINIT(blocks_open_reading),
     GINIT(blocks_open_writing),
@@ -24,9 +24,9 @@
 namespace kudu {
 
 class Counter;
-template<class T>
-class AtomicGauge;
 class MetricEntity;
+template<class T>
+class StripedGauge;
 
 namespace fs {
 namespace internal {
@@ -34,8 +34,9 @@ namespace internal {
 struct BlockManagerMetrics {
   explicit BlockManagerMetrics(const scoped_refptr<MetricEntity>& metric_entity);
 
-  scoped_refptr<AtomicGauge<uint64_t> > blocks_open_reading;
-  scoped_refptr<AtomicGauge<uint64_t> > blocks_open_writing;
+  // Opened and closed concurrently by many threads, so striped.
+  scoped_refptr<StripedGauge<uint64_t> > blocks_open_reading;
+  scoped_refptr<StripedGauge<uint64_t> > blocks_open_writing;
 
   scoped_refptr<Counter> total_readable_blocks;
   scoped_refptr<Counter> total_writable_blocks;
@@ -17,6 +17,7 @@
 
 #include "kudu/fs/data_dirs.h"
 
+#include <algorithm>
 #include <cerrno>
 #include <deque>
 #include <memory>
@@ -37,16 +38,20 @@
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/path_util.h"
+#include "kudu/util/random_util.h"
 #include "kudu/util/status.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/threadpool.h"
@@ -62,6 +67,43 @@ DEFINE_int32(fs_data_dirs_full_disk_cache_seconds, 30,
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, advanced);
 TAG_FLAG(fs_data_dirs_full_disk_cache_seconds, evolving);
 
+DEFINE_bool(fs_data_dirs_load_aware_placement, false,
+            "Whether to place new blocks in the less loaded of two data "
+            "directories picked at random, accounting for their writes in "
+            "flight, their recent write latency and their free space, rather "
+            "than in each data directory in turn. Data directories whose "
+            "writes are slow are then excluded for a while.");
+TAG_FLAG(fs_data_dirs_load_aware_placement, experimental);
+TAG_FLAG(fs_data_dirs_load_aware_placement, runtime);
+
+DEFINE_int32(fs_data_dirs_degraded_write_latency_ms, 1000,
+             "Average write latency above which a data directory is considered "
+             "degraded by load-aware block placement.");
+TAG_FLAG(fs_data_dirs_degraded_write_latency_ms, experimental);
+TAG_FLAG(fs_data_dirs_degraded_write_latency_ms, runtime);
+
+DEFINE_int32(fs_data_dirs_degraded_exclusion_seconds, 60,
+             "Number of seconds for which load-aware block placement excludes "
+             "a degraded data directory, unless all of them are degraded.");
+TAG_FLAG(fs_data_dirs_degraded_exclusion_seconds, experimental);
+TAG_FLAG(fs_data_dirs_degraded_exclusion_seconds, runtime);
+
+DEFINE_string(background_io_max_mb_per_sec_by_dir, "",
+              "Comma-separated list of <data dir>:<MB per second> pairs which override "
+              "--background_io_max_mb_per_sec for specific data directories, e.g. to "
+              "allow more background IO on SSDs than on spinning disks. The data "
+              "directories must be spelled as in --fs_data_dirs. Only read when the "
+              "directories are opened.");
+TAG_FLAG(background_io_max_mb_per_sec_by_dir, experimental);
+
+DEFINE_string(fs_data_dirs_fast_tier, "",
+              "Comma-separated list of the data directories which are on fast "
+              "storage, such as NVMe drives, spelled as in --fs_data_dirs. New "
+              "flushes and hot rowsets are placed on these directories, and cold "
+              "rowsets on the others. If empty, blocks are placed without regard "
+              "to storage tiers. Only read when the directories are opened.");
+TAG_FLAG(fs_data_dirs_fast_tier, experimental);
+
 METRIC_DEFINE_gauge_uint64(server, data_dirs_full,
                            "Data Directories Full",
                            kudu::MetricUnit::kDataDirectories,
@@ -129,6 +171,39 @@ Status CheckHolePunch(Env* env, const string& path) {
   return Status::OK();
 }
 
+// Parses --background_io_max_mb_per_sec_by_dir into 'limits', keyed by
+// directory, in bytes per second.
+Status ParseBackgroundIoLimits(const string& flag,
+                               std::unordered_map<string, int64_t>* limits) {
+  vector<string> entries = strings::Split(flag, ",", strings::SkipEmpty());
+  for (const string& entry : entries) {
+    size_t sep = entry.rfind(':');
+    int64_t mb_per_sec;
+    if (sep == string::npos || sep == 0 ||
+        !safe_strto64(entry.substr(sep + 1), &mb_per_sec) || mb_per_sec < 0) {
+      return Status::InvalidArgument(
+          "Invalid entry in --background_io_max_mb_per_sec_by_dir", entry);
+    }
+    (*limits)[entry.substr(0, sep)] = mb_per_sec * 1024 * 1024;
+  }
+  return Status::OK();
+}
+
+// Parses --fs_data_dirs_fast_tier into 'fast_dirs', checking that each entry
+// is one of 'paths'.
+Status ParseFastTierDirs(const string& flag, const vector<string>& paths,
+                         unordered_set<string>* fast_dirs) {
+  vector<string> entries = strings::Split(flag, ",", strings::SkipEmpty());
+  for (const string& entry : entries) {
+    if (std::find(paths.begin(), paths.end(), entry) == paths.end()) {
+      return Status::InvalidArgument(
+          "Entry in --fs_data_dirs_fast_tier is not a data directory", entry);
+    }
+    fast_dirs->insert(entry);
+  }
+  return Status::OK();
+}
+
 } // anonymous namespace
 
 #define GINIT(x) x(METRIC_##x.Instantiate(entity, 0))
@@ -142,14 +217,23 @@ DataDir::DataDir(Env* env,
                  DataDirMetrics* metrics,
                  string dir,
                  unique_ptr<PathInstanceMetadataFile> metadata_file,
-                 unique_ptr<ThreadPool> pool)
+                 unique_ptr<ThreadPool> pool,
+                 int64_t max_background_io_bytes_per_sec,
+                 MetricRegistry* metric_registry,
+                 StorageTier tier)
     : env_(env),
       metrics_(metrics),
       dir_(std::move(dir)),
       metadata_file_(std::move(metadata_file)),
       pool_(std::move(pool)),
+      tier_(tier),
       is_shutdown_(false),
-      is_full_(false) {
+      is_full_(false),
+      bytes_free_(0),
+      avg_write_latency_us_(0),
+      writes_in_flight_(0),
+      io_rate_limiter_(max_background_io_bytes_per_sec),
+      io_metrics_(metric_registry, dir_) {
 }
 
 DataDir::~DataDir() {
@@ -186,32 +270,33 @@ Status DataDir::RefreshIsFull(RefreshMode mode) {
       DCHECK(last_check_is_full_.Initialized());
       MonoTime expiry = last_check_is_full_ + MonoDelta::FromSeconds(
           FLAGS_fs_data_dirs_full_disk_cache_seconds);
-      if (!is_full_ || MonoTime::Now() < expiry) {
+      // Load-aware placement also needs the free space of the dirs which
+      // aren't full to be reasonably recent.
+      if ((!is_full_ && !FLAGS_fs_data_dirs_load_aware_placement) ||
+          MonoTime::Now() < expiry) {
         break;
       }
       FALLTHROUGH_INTENDED; // Root was previously full, check again.
     }
     case RefreshMode::ALWAYS: {
-      Status s = env_util::VerifySufficientDiskSpace(
-          env_, dir_, 0, FLAGS_fs_data_dirs_reserved_bytes);
-      bool is_full_new;
-      if (PREDICT_FALSE(s.IsIOError() && s.posix_code() == ENOSPC)) {
+      int64_t bytes_free;
+      RETURN_NOT_OK(env_util::GetBytesFree(env_, dir_, &bytes_free));
+      bool is_full_new = bytes_free < FLAGS_fs_data_dirs_reserved_bytes;
+      if (PREDICT_FALSE(is_full_new)) {
         LOG(WARNING) << Substitute(
             "Insufficient disk space under path $0: creation of new data "
-            "blocks under this path can be retried after $1 seconds: $2",
-            dir_, FLAGS_fs_data_dirs_full_disk_cache_seconds, s.ToString());
-        s = Status::OK();
-        is_full_new = true;
-      } else {
-        is_full_new = false;
+            "blocks under this path can be retried after $1 seconds: "
+            "$2 bytes free vs $3 bytes reserved",
+            dir_, FLAGS_fs_data_dirs_full_disk_cache_seconds, bytes_free,
+            FLAGS_fs_data_dirs_reserved_bytes);
       }
-      RETURN_NOT_OK(s); // Catch other types of IOErrors, etc.
       {
         std::lock_guard<simple_spinlock> l(lock_);
         if (metrics_ && is_full_ != is_full_new) {
           metrics_->data_dirs_full->IncrementBy(is_full_new ? 1 : -1);
         }
         is_full_ = is_full_new;
+        bytes_free_ = bytes_free;
         last_check_is_full_ = MonoTime::Now();
       }
       break;
@@ -222,14 +307,69 @@ Status DataDir::RefreshIsFull(RefreshMode mode) {
   return Status::OK();
 }
 
+void DataDir::IoStarted(DirIoMetrics::IoType type) {
+  io_metrics_.IoStarted(type);
+  if (type != DirIoMetrics::READ) {
+    writes_in_flight_.Increment();
+  }
+}
+
+void DataDir::IoFinished(DirIoMetrics::IoType type, const string& file,
+                         MonoDelta latency) {
+  // Weight of the latest write in the moving average.
+  static const double kLatencyAlpha = 0.1;
+
+  io_metrics_.IoFinished(type, file, latency);
+  if (type == DirIoMetrics::READ) {
+    return;
+  }
+  DCHECK_GT(writes_in_flight_.Load(), 0);
+  writes_in_flight_.IncrementBy(-1);
+  MonoTime now = MonoTime::Now();
+  std::lock_guard<simple_spinlock> l(lock_);
+  avg_write_latency_us_ += kLatencyAlpha *
+      (latency.ToMicroseconds() - avg_write_latency_us_);
+  bool degraded = degraded_until_.Initialized() && now < degraded_until_;
+  if (!degraded && FLAGS_fs_data_dirs_degraded_write_latency_ms > 0 &&
+      avg_write_latency_us_ > FLAGS_fs_data_dirs_degraded_write_latency_ms * 1000L) {
+    LOG(WARNING) << Substitute(
+        "Data directory $0 is degraded: its writes took $1 ms on average. "
+        "New blocks will not be placed in it for $2 seconds, unless all data "
+        "directories are degraded",
+        dir_, static_cast<int64_t>(avg_write_latency_us_ / 1000),
+        FLAGS_fs_data_dirs_degraded_exclusion_seconds);
+    degraded_until_ = now + MonoDelta::FromSeconds(
+        FLAGS_fs_data_dirs_degraded_exclusion_seconds);
+  }
+}
+
+DataDir::Load DataDir::GetLoad(MonoTime now) {
+  Load load;
+  load.writes_in_flight = writes_in_flight_.Load();
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (degraded_until_.Initialized() && now >= degraded_until_) {
+    // The exclusion is over: start over from a clean slate, or the dir would
+    // hardly ever be picked, and its average never updated.
+    degraded_until_ = MonoTime();
+    avg_write_latency_us_ = 0;
+  }
+  load.avg_write_latency_us = static_cast<int64_t>(avg_write_latency_us_);
+  load.bytes_free = bytes_free_;
+  load.degraded = degraded_until_.Initialized();
+  return load;
+}
+
 DataDirManager::DataDirManager(Env* env,
                                scoped_refptr<MetricEntity> metric_entity,
                                string block_manager_type,
-                               vector<string> paths)
+                               vector<string> paths,
+                               MetricRegistry* metric_registry)
     : env_(env),
+      metric_registry_(metric_registry),
       block_manager_type_(std::move(block_manager_type)),
       paths_(std::move(paths)),
-      data_dirs_next_(0) {
+      data_dirs_next_(0),
+      rand_(GetRandomSeed32()) {
   DCHECK_GT(paths_.size(), 0);
 
   if (metric_entity) {
@@ -306,6 +446,12 @@ Status DataDirManager::Open(int max_data_dirs, LockMode mode) {
   vector<PathInstanceMetadataFile*> instances;
   vector<unique_ptr<DataDir>> dds;
 
+  std::unordered_map<string, int64_t> background_io_limits;
+  RETURN_NOT_OK(ParseBackgroundIoLimits(FLAGS_background_io_max_mb_per_sec_by_dir,
+                                        &background_io_limits));
+  unordered_set<string> fast_dirs;
+  RETURN_NOT_OK(ParseFastTierDirs(FLAGS_fs_data_dirs_fast_tier, paths_, &fast_dirs));
+
   int i = 0;
   for (const auto& p : paths_) {
     // Open and lock the data dir's metadata instance file.
@@ -341,7 +487,10 @@ Status DataDirManager::Open(int max_data_dirs, LockMode mode) {
     unique_ptr<DataDir> dd(new DataDir(
         env_, metrics_.get(), p,
         unique_ptr<PathInstanceMetadataFile>(instance.release()),
-        unique_ptr<ThreadPool>(pool.release())));
+        unique_ptr<ThreadPool>(pool.release()),
+        FindWithDefault(background_io_limits, p, -1),
+        metric_registry_,
+        ContainsKey(fast_dirs, p) ? StorageTier::FAST : StorageTier::SLOW));
 
     // Initialize the 'fullness' status of the data directory.
     RETURN_NOT_OK(dd->RefreshIsFull(DataDir::RefreshMode::ALWAYS));
@@ -375,13 +524,116 @@ Status DataDirManager::Open(int max_data_dirs, LockMode mode) {
     InsertOrDie(&uuid_idx_by_dd, dd.get(), idx);
   }
 
+  vector<DataDir*> all_dirs;
+  vector<DataDir*> fast_tier_dirs;
+  vector<DataDir*> slow_tier_dirs;
+  for (const auto& dd : dds) {
+    all_dirs.push_back(dd.get());
+    if (dd->tier() == StorageTier::FAST) {
+      fast_tier_dirs.push_back(dd.get());
+    } else {
+      slow_tier_dirs.push_back(dd.get());
+    }
+  }
+
   data_dirs_.swap(dds);
+  all_dirs_.swap(all_dirs);
+  fast_dirs_.swap(fast_tier_dirs);
+  slow_dirs_.swap(slow_tier_dirs);
   data_dir_by_uuid_idx_.swap(dd_by_uuid_idx);
   uuid_idx_by_data_dir_.swap(uuid_idx_by_dd);
   return Status::OK();
 }
 
+double DataDirManager::LoadCost(const DataDir::Load& load, int64_t max_bytes_free) {
+  // Floors which keep a dir whose writes have been really fast, or which is
+  // almost full, from dominating the comparison.
+  static const double kMinWriteLatencyUs = 100;
+  static const double kMinFreeSpaceShare = 0.05;
+
+  double latency_us = std::max<double>(load.avg_write_latency_us, kMinWriteLatencyUs);
+  double free_share = max_bytes_free > 0 ?
+      static_cast<double>(load.bytes_free) / max_bytes_free : 1;
+  return (load.writes_in_flight + 1) * latency_us /
+      std::max(free_share, kMinFreeSpaceShare);
+}
+
 Status DataDirManager::GetNextDataDir(DataDir** dir) {
+  return GetNextDataDir(CreateBlockOptions(), dir);
+}
+
+Status DataDirManager::GetNextDataDir(const CreateBlockOptions& opts, DataDir** dir) {
+  const vector<DataDir*>* tier_dirs = nullptr;
+  switch (opts.tier) {
+    case StorageTier::FAST: tier_dirs = &fast_dirs_; break;
+    case StorageTier::SLOW: tier_dirs = &slow_dirs_; break;
+    case StorageTier::ANY: break;
+  }
+  if (tier_dirs && !tier_dirs->empty() && tier_dirs->size() < all_dirs_.size()) {
+    Status s = GetNextDataDirFrom(*tier_dirs, dir);
+    if (s.ok() || s.posix_code() != ENOSPC) {
+      return s;
+    }
+    // The whole tier is full; spill over to the other tier.
+    KLOG_EVERY_N_SECS(WARNING, 10)
+        << "All data directories of the requested storage tier are full, "
+        << "placing block on any tier" << THROTTLE_MSG;
+  }
+  return GetNextDataDirFrom(all_dirs_, dir);
+}
+
+Status DataDirManager::GetNextDataDirFrom(const vector<DataDir*>& candidate_dirs,
+                                          DataDir** dir) {
+  if (FLAGS_fs_data_dirs_load_aware_placement && candidate_dirs.size() > 1) {
+    MonoTime now = MonoTime::Now();
+    vector<DataDir*> candidates;
+    vector<DataDir::Load> loads;
+    vector<DataDir*> degraded;
+    vector<DataDir::Load> degraded_loads;
+    for (DataDir* dd : candidate_dirs) {
+      RETURN_NOT_OK(dd->RefreshIsFull(DataDir::RefreshMode::EXPIRED_ONLY));
+      if (dd->is_full()) {
+        continue;
+      }
+      DataDir::Load load = dd->GetLoad(now);
+      if (load.degraded) {
+        degraded.push_back(dd);
+        degraded_loads.push_back(load);
+      } else {
+        candidates.push_back(dd);
+        loads.push_back(load);
+      }
+    }
+    if (candidates.empty()) {
+      candidates.swap(degraded);
+      loads.swap(degraded_loads);
+    }
+    if (candidates.empty()) {
+      return Status::IOError(
+          "All data directories are full. Please free some disk space or "
+          "consider changing the fs_data_dirs_reserved_bytes configuration "
+          "parameter", "", ENOSPC);
+    }
+    if (candidates.size() == 1) {
+      *dir = candidates[0];
+      return Status::OK();
+    }
+
+    int64_t max_bytes_free = 0;
+    for (const DataDir::Load& load : loads) {
+      max_bytes_free = std::max(max_bytes_free, load.bytes_free);
+    }
+    int first = rand_.Uniform(candidates.size());
+    int second = rand_.Uniform(candidates.size() - 1);
+    if (second >= first) {
+      second++;
+    }
+    *dir = LoadCost(loads[first], max_bytes_free) <=
+           LoadCost(loads[second], max_bytes_free) ?
+        candidates[first] : candidates[second];
+    return Status::OK();
+  }
+
   // Round robin through the data dirs, ignoring ones that are full.
   unordered_set<DataDir*> full_dds;
   while (true) {
@@ -389,10 +641,12 @@ Status DataDirManager::GetNextDataDir(DataDir** dir) {
     int32_t next_idx;
     do {
       cur_idx = data_dirs_next_.Load();
-      next_idx = (cur_idx + 1) % data_dirs_.size();
+      next_idx = (cur_idx + 1) % candidate_dirs.size();
     } while (!data_dirs_next_.CompareAndSet(cur_idx, next_idx));
 
-    DataDir* candidate = data_dirs_[cur_idx].get();
+    // The shared index may be past the end if the last call considered more
+    // candidates.
+    DataDir* candidate = candidate_dirs[cur_idx % candidate_dirs.size()];
     RETURN_NOT_OK(candidate->RefreshIsFull(
         DataDir::RefreshMode::EXPIRED_ONLY));
     if (!candidate->is_full()) {
@@ -402,7 +656,7 @@ Status DataDirManager::GetNextDataDir(DataDir** dir) {
 
     // This data dir was full. If all are full, we can't satisfy the request.
     full_dds.insert(candidate);
-    if (full_dds.size() == data_dirs_.size()) {
+    if (full_dds.size() == candidate_dirs.size()) {
       return Status::IOError(
           "All data directories are full. Please free some disk space or "
           "consider changing the fs_data_dirs_reserved_bytes configuration "
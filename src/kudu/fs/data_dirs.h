@@ -23,12 +23,16 @@
 #include <unordered_map>
 #include <vector>
 
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/dir_io_metrics.h"
 #include "kudu/gutil/callback_forward.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/io_rate_limiter.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/random.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -36,6 +40,7 @@ template<typename T>
 class AtomicGauge;
 class Env;
 class MetricEntity;
+class MetricRegistry;
 class ThreadPool;
 
 namespace fs {
@@ -50,11 +55,18 @@ struct DataDirMetrics {
 // Representation of a data directory in use by the block manager.
 class DataDir {
  public:
+  // 'max_background_io_bytes_per_sec' is the limit of the dir's
+  // IoRateLimiter; a negative value means --background_io_max_mb_per_sec.
+  // The dir's DirIoMetrics are registered with 'metric_registry', if set.
+  // 'tier' is the storage tier of the dir; it may not be ANY.
   DataDir(Env* env,
           DataDirMetrics* metrics,
           std::string dir,
           std::unique_ptr<PathInstanceMetadataFile> metadata_file,
-          std::unique_ptr<ThreadPool> pool);
+          std::unique_ptr<ThreadPool> pool,
+          int64_t max_background_io_bytes_per_sec = -1,
+          MetricRegistry* metric_registry = nullptr,
+          StorageTier tier = StorageTier::SLOW);
   ~DataDir();
 
   // Shuts down this dir's thread pool, waiting for any closures submitted via
@@ -87,6 +99,8 @@ class DataDir {
 
   const std::string& dir() const { return dir_; }
 
+  StorageTier tier() const { return tier_; }
+
   const PathInstanceMetadataFile* instance() const {
     return metadata_file_.get();
   }
@@ -96,19 +110,55 @@ class DataDir {
     return is_full_;
   }
 
+  // Limits the IO of flushes and compactions to this dir. Block managers
+  // charge it for the reads and writes of threads in a ScopedBackgroundIo,
+  // and report to it the latency of the other reads.
+  IoRateLimiter* io_rate_limiter() const { return &io_rate_limiter_; }
+
+  // Record the start and the end of an I/O to 'file' in the dir, for its
+  // metrics and, for writes and syncs, for the load-aware placement of new
+  // blocks. A dir whose recent writes were slower than
+  // --fs_data_dirs_degraded_write_latency_ms on average is considered
+  // degraded for --fs_data_dirs_degraded_exclusion_seconds.
+  void IoStarted(DirIoMetrics::IoType type);
+  void IoFinished(DirIoMetrics::IoType type, const std::string& file,
+                  MonoDelta latency);
+
+  // A snapshot of the load of the dir, as used for block placement.
+  struct Load {
+    int32_t writes_in_flight;
+    // Exponentially weighted moving average of the latency of recent writes.
+    int64_t avg_write_latency_us;
+    // As of the last RefreshIsFull().
+    int64_t bytes_free;
+    bool degraded;
+  };
+  Load GetLoad(MonoTime now);
+
  private:
   Env* env_;
   DataDirMetrics* metrics_;
   const std::string dir_;
   const std::unique_ptr<PathInstanceMetadataFile> metadata_file_;
   const std::unique_ptr<ThreadPool> pool_;
+  const StorageTier tier_;
 
   bool is_shutdown_;
 
-  // Protects 'last_check_is_full_' and 'is_full_'.
+  // Protects 'last_check_is_full_', 'is_full_', 'bytes_free_',
+  // 'avg_write_latency_us_' and 'degraded_until_'.
   mutable simple_spinlock lock_;
   MonoTime last_check_is_full_;
   bool is_full_;
+  int64_t bytes_free_;
+  double avg_write_latency_us_;
+  MonoTime degraded_until_;
+
+  AtomicInt<int32_t> writes_in_flight_;
+
+  mutable IoRateLimiter io_rate_limiter_;
+
+  DirIoMetrics io_metrics_;
 
   DISALLOW_COPY_AND_ASSIGN(DataDir);
 };
@@ -127,10 +177,13 @@ class DataDirManager {
     NONE,
   };
 
+  // The metrics of each directory are registered with 'metric_registry',
+  // if set.
   DataDirManager(Env* env,
                  scoped_refptr<MetricEntity> metric_entity,
                  std::string block_manager_type,
-                 std::vector<std::string> paths);
+                 std::vector<std::string> paths,
+                 MetricRegistry* metric_registry = nullptr);
   ~DataDirManager();
 
   // Shuts down all directories' thread pools.
@@ -150,8 +203,16 @@ class DataDirManager {
   // Retrieves the next data directory that isn't full. Directories are rotated
   // via round-robin. Full directories are skipped.
   //
+  // With --fs_data_dirs_load_aware_placement, two of the directories which
+  // aren't full or degraded are instead picked at random, and the one with
+  // the least load is retrieved. See DataDirManager::LoadCost().
+  //
+  // If 'opts' asks for a storage tier, only the directories of that tier are
+  // considered, unless they're all full.
+  //
   // Returns an error if all data directories are full, or upon filesystem
   // error. On success, 'dir' is guaranteed to be set.
+  Status GetNextDataDir(const CreateBlockOptions& opts, DataDir** dir);
   Status GetNextDataDir(DataDir** dir);
 
   // Finds a data directory by uuid index, returning nullptr if it can't be
@@ -161,6 +222,13 @@ class DataDirManager {
   // can be found next to PathSetPB in fs.proto.
   DataDir* FindDataDirByUuidIndex(uint16_t uuid_idx) const;
 
+  // Returns the cost of placing a block in a dir with load 'load', given
+  // that the dir with the most free space among the candidates has
+  // 'max_bytes_free' bytes free: the expected latency of a write to the dir,
+  // given the writes it already has in flight, divided by its share of free
+  // space relative to the emptiest candidate.
+  static double LoadCost(const DataDir::Load& load, int64_t max_bytes_free);
+
   // Finds a uuid index by data directory, returning false if it can't be found.
   bool FindUuidIndexByDataDir(DataDir* dir,
                               uint16_t* uuid_idx) const;
@@ -170,7 +238,12 @@ class DataDirManager {
   }
 
  private:
+  // Like GetNextDataDir(), but only considering 'candidates'.
+  Status GetNextDataDirFrom(const std::vector<DataDir*>& candidates,
+                            DataDir** dir);
+
   Env* env_;
+  MetricRegistry* const metric_registry_;
   const std::string block_manager_type_;
   const std::vector<std::string> paths_;
 
@@ -178,8 +251,16 @@ class DataDirManager {
 
   std::vector<std::unique_ptr<DataDir>> data_dirs_;
 
+  // All of 'data_dirs_', and those of each tier.
+  std::vector<DataDir*> all_dirs_;
+  std::vector<DataDir*> fast_dirs_;
+  std::vector<DataDir*> slow_dirs_;
+
   AtomicInt<int32_t> data_dirs_next_;
 
+  // Used to pick the candidates of load-aware placement.
+  ThreadSafeRandom rand_;
+
   typedef std::unordered_map<uint16_t, DataDir*> UuidIndexMap;
   UuidIndexMap data_dir_by_uuid_idx_;
 
@@ -0,0 +1,121 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/fs/dir_io_metrics.h"
+
+#include <utility>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
+
+DEFINE_int32(fs_slow_io_threshold_ms, 1000,
+             "I/Os to data and WAL directories which take longer than this "
+             "many milliseconds are logged. 0 disables the logging.");
+TAG_FLAG(fs_slow_io_threshold_ms, advanced);
+TAG_FLAG(fs_slow_io_threshold_ms, runtime);
+
+METRIC_DEFINE_entity(directory);
+
+METRIC_DEFINE_histogram(directory, dir_read_latency, "Directory Read Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Microseconds spent reading from files of the directory",
+                        60000000LU, 2);
+METRIC_DEFINE_histogram(directory, dir_write_latency, "Directory Write Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Microseconds spent writing to files of the directory",
+                        60000000LU, 2);
+METRIC_DEFINE_histogram(directory, dir_sync_latency, "Directory Sync Latency",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Microseconds spent synchronizing files of the directory",
+                        60000000LU, 2);
+
+METRIC_DEFINE_gauge_uint64(directory, dir_reads_in_flight,
+                           "Directory Reads In Flight",
+                           kudu::MetricUnit::kOperations,
+                           "Number of reads from files of the directory in progress");
+METRIC_DEFINE_gauge_uint64(directory, dir_writes_in_flight,
+                           "Directory Writes In Flight",
+                           kudu::MetricUnit::kOperations,
+                           "Number of writes to files of the directory in progress");
+METRIC_DEFINE_gauge_uint64(directory, dir_syncs_in_flight,
+                           "Directory Syncs In Flight",
+                           kudu::MetricUnit::kOperations,
+                           "Number of syncs of files of the directory in progress");
+
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+namespace fs {
+
+namespace {
+
+const char* IoTypeToString(DirIoMetrics::IoType type) {
+  switch (type) {
+    case DirIoMetrics::READ: return "read";
+    case DirIoMetrics::WRITE: return "write";
+    case DirIoMetrics::SYNC: return "sync";
+  }
+  LOG(FATAL) << "Unknown I/O type";
+  return "";
+}
+
+} // anonymous namespace
+
+DirIoMetrics::DirIoMetrics(MetricRegistry* registry, string dir)
+    : dir_(std::move(dir)) {
+  if (!registry) {
+    return;
+  }
+  entity_ = METRIC_ENTITY_directory.Instantiate(registry, dir_, { { "path", dir_ } });
+  latency_[READ] = METRIC_dir_read_latency.Instantiate(entity_);
+  latency_[WRITE] = METRIC_dir_write_latency.Instantiate(entity_);
+  latency_[SYNC] = METRIC_dir_sync_latency.Instantiate(entity_);
+  in_flight_[READ] = METRIC_dir_reads_in_flight.Instantiate(entity_, 0);
+  in_flight_[WRITE] = METRIC_dir_writes_in_flight.Instantiate(entity_, 0);
+  in_flight_[SYNC] = METRIC_dir_syncs_in_flight.Instantiate(entity_, 0);
+}
+
+DirIoMetrics::~DirIoMetrics() {
+}
+
+void DirIoMetrics::IoStarted(IoType type) {
+  if (entity_) {
+    in_flight_[type]->Increment();
+  }
+}
+
+void DirIoMetrics::IoFinished(IoType type, const string& file, MonoDelta latency) {
+  if (entity_) {
+    in_flight_[type]->Decrement();
+    latency_[type]->Increment(latency.ToMicroseconds());
+  }
+  int32_t threshold_ms = FLAGS_fs_slow_io_threshold_ms;
+  if (PREDICT_FALSE(threshold_ms > 0 && latency.ToMilliseconds() > threshold_ms)) {
+    KLOG_EVERY_N_SECS(WARNING, 1) << Substitute(
+        "Slow $0 of $1 in directory $2: took $3 ms",
+        IoTypeToString(type), file, dir_, latency.ToMilliseconds()) << THROTTLE_MSG;
+  }
+}
+
+} // namespace fs
+} // namespace kudu
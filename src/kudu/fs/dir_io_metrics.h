@@ -0,0 +1,110 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_FS_DIR_IO_METRICS_H
+#define KUDU_FS_DIR_IO_METRICS_H
+
+#include <stdint.h>
+
+#include <string>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+
+template<class T>
+class AtomicGauge;
+class Histogram;
+class MetricEntity;
+class MetricRegistry;
+
+namespace fs {
+
+// Metrics of the I/O done to one directory (a data directory or the WAL
+// directory): the latency histograms and in-flight gauges of its reads,
+// writes and syncs. They are grouped under a "directory" metric entity whose
+// id is the directory's path.
+//
+// I/Os slower than --fs_slow_io_threshold_ms are also logged, along with the
+// file they went to.
+//
+// This class is thread-safe.
+class DirIoMetrics {
+ public:
+  enum IoType {
+    READ,
+    WRITE,
+    SYNC,
+  };
+
+  // If 'registry' is null, no metrics are produced but slow I/Os are still
+  // logged.
+  DirIoMetrics(MetricRegistry* registry, std::string dir);
+  ~DirIoMetrics();
+
+  // Record the start and the end of an I/O of type 'type' to 'file', which
+  // took 'latency'.
+  void IoStarted(IoType type);
+  void IoFinished(IoType type, const std::string& file, MonoDelta latency);
+
+  const std::string& dir() const { return dir_; }
+
+ private:
+  const std::string dir_;
+
+  scoped_refptr<MetricEntity> entity_;
+  scoped_refptr<Histogram> latency_[SYNC + 1];
+  scoped_refptr<AtomicGauge<uint64_t>> in_flight_[SYNC + 1];
+
+  DISALLOW_COPY_AND_ASSIGN(DirIoMetrics);
+};
+
+// Records an I/O to a directory for the duration of the scope.
+class ScopedDirIo {
+ public:
+  // 'metrics' may be null, in which case nothing is recorded.
+  ScopedDirIo(DirIoMetrics* metrics, DirIoMetrics::IoType type,
+              const std::string& file)
+      : metrics_(metrics),
+        type_(type),
+        file_(file) {
+    if (metrics_) {
+      metrics_->IoStarted(type_);
+      start_ = MonoTime::Now();
+    }
+  }
+
+  ~ScopedDirIo() {
+    if (metrics_) {
+      metrics_->IoFinished(type_, file_, MonoTime::Now() - start_);
+    }
+  }
+
+ private:
+  DirIoMetrics* const metrics_;
+  const DirIoMetrics::IoType type_;
+  const std::string& file_;
+  MonoTime start_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedDirIo);
+};
+
+} // namespace fs
+} // namespace kudu
+
+#endif // KUDU_FS_DIR_IO_METRICS_H
@@ -19,15 +19,20 @@
 
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
 #include "kudu/fs/block_manager_metrics.h"
 #include "kudu/fs/data_dirs.h"
+#include "kudu/gutil/bind.h"
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/atomic.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/file_cache.h"
+#include "kudu/util/io_rate_limiter.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
@@ -37,11 +42,14 @@
 
 using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 
 DECLARE_bool(enable_data_block_fsync);
 DECLARE_bool(block_manager_lock_dirs);
+DECLARE_bool(block_manager_direct_io_reads);
+DECLARE_bool(block_manager_mmap_reads);
 
 namespace kudu {
 namespace fs {
@@ -227,7 +235,6 @@ class FileWritableBlock : public WritableBlock {
 
   virtual State state() const OVERRIDE;
 
- private:
   enum SyncMode {
     SYNC,
     NO_SYNC
@@ -236,6 +243,12 @@ class FileWritableBlock : public WritableBlock {
   // Close the block, optionally synchronizing dirty data and metadata.
   Status Close(SyncMode mode);
 
+  // Synchronize the block's data (but not its metadata) with the disk.
+  Status SyncData();
+
+  const FileBlockLocation& location() const { return location_; }
+
+ private:
   // Back pointer to the block manager.
   //
   // Should remain alive for the lifetime of this block.
@@ -297,7 +310,15 @@ Status FileWritableBlock::Append(const Slice& data) {
   DCHECK(state_ == CLEAN || state_ == DIRTY)
       << "Invalid state: " << state_;
 
-  RETURN_NOT_OK(writer_->Append(data));
+  DataDir* dir = location_.data_dir();
+  if (IoRateLimiter::IsBackgroundIoThread()) {
+    dir->io_rate_limiter()->Request(data.size());
+  }
+  dir->IoStarted(DirIoMetrics::WRITE);
+  MonoTime start_time = MonoTime::Now();
+  Status s = writer_->Append(data);
+  dir->IoFinished(DirIoMetrics::WRITE, writer_->filename(), MonoTime::Now() - start_time);
+  RETURN_NOT_OK(s);
   RETURN_NOT_OK(location_.data_dir()->RefreshIsFull(
       DataDir::RefreshMode::ALWAYS));
   state_ = DIRTY;
@@ -335,9 +356,7 @@ Status FileWritableBlock::Close(SyncMode mode) {
       (state_ == CLEAN || state_ == DIRTY || state_ == FLUSHING)) {
     // Safer to synchronize data first, then metadata.
     VLOG(3) << "Syncing block " << id();
-    if (FLAGS_enable_data_block_fsync) {
-      sync = writer_->Sync();
-    }
+    sync = SyncData();
     if (sync.ok()) {
       sync = block_manager_->SyncMetadata(location_);
     }
@@ -357,6 +376,20 @@ Status FileWritableBlock::Close(SyncMode mode) {
   return !close.ok() ? close : sync;
 }
 
+Status FileWritableBlock::SyncData() {
+  DCHECK_NE(CLOSED, state_);
+  if (!FLAGS_enable_data_block_fsync) {
+    return Status::OK();
+  }
+  DataDir* dir = location_.data_dir();
+  dir->IoStarted(DirIoMetrics::SYNC);
+  MonoTime start_time = MonoTime::Now();
+  Status s = writer_->Sync();
+  dir->IoFinished(DirIoMetrics::SYNC, writer_->filename(),
+                  MonoTime::Now() - start_time);
+  return s;
+}
+
 ////////////////////////////////////////////////////////////
 // FileReadableBlock
 ////////////////////////////////////////////////////////////
@@ -369,7 +402,8 @@ Status FileWritableBlock::Close(SyncMode mode) {
 class FileReadableBlock : public ReadableBlock {
  public:
   FileReadableBlock(const FileBlockManager* block_manager, BlockId block_id,
-                    shared_ptr<RandomAccessFile> reader);
+                    shared_ptr<RandomAccessFile> reader,
+                    unique_ptr<MemoryMappedRegion> mapped_region);
 
   virtual ~FileReadableBlock();
 
@@ -382,6 +416,10 @@ class FileReadableBlock : public ReadableBlock {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const OVERRIDE;
 
+  virtual const MemoryMappedRegion* mapped_region() const OVERRIDE {
+    return mapped_region_.get();
+  }
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
@@ -394,6 +432,10 @@ class FileReadableBlock : public ReadableBlock {
   // The underlying opened file backing this block.
   shared_ptr<RandomAccessFile> reader_;
 
+  // With --block_manager_mmap_reads, the mapping of the whole file. Unlike
+  // 'reader_', it is kept until the block is destroyed.
+  const unique_ptr<MemoryMappedRegion> mapped_region_;
+
   // Whether or not this block has been closed. Close() is thread-safe, so
   // this must be an atomic primitive.
   AtomicBool closed_;
@@ -403,10 +445,12 @@ class FileReadableBlock : public ReadableBlock {
 
 FileReadableBlock::FileReadableBlock(const FileBlockManager* block_manager,
                                      BlockId block_id,
-                                     shared_ptr<RandomAccessFile> reader)
+                                     shared_ptr<RandomAccessFile> reader,
+                                     unique_ptr<MemoryMappedRegion> mapped_region)
     : block_manager_(block_manager),
       block_id_(block_id),
       reader_(std::move(reader)),
+      mapped_region_(std::move(mapped_region)),
       closed_(false) {
   if (block_manager_->metrics_) {
     block_manager_->metrics_->blocks_open_reading->Increment();
@@ -444,7 +488,26 @@ Status FileReadableBlock::Read(uint64_t offset, size_t length,
                                Slice* result, uint8_t* scratch) const {
   DCHECK(!closed_.Load());
 
-  RETURN_NOT_OK(env_util::ReadFully(reader_.get(), offset, length, result, scratch));
+  DataDir* dir = block_manager_->dd_manager_.FindDataDirByUuidIndex(
+      internal::FileBlockLocation::GetDataDirIdx(block_id_));
+  bool background = IoRateLimiter::IsBackgroundIoThread();
+  if (dir && background) {
+    dir->io_rate_limiter()->Request(length);
+  }
+
+  if (dir) {
+    dir->IoStarted(DirIoMetrics::READ);
+  }
+  MonoTime start_time = MonoTime::Now();
+  Status s = env_util::ReadFully(reader_.get(), offset, length, result, scratch);
+  MonoTime end_time = MonoTime::Now();
+  if (dir) {
+    dir->IoFinished(DirIoMetrics::READ, reader_->filename(), end_time - start_time);
+  }
+  RETURN_NOT_OK(s);
+  if (dir && !background) {
+    dir->io_rate_limiter()->ReportForegroundLatency(end_time, end_time - start_time);
+  }
   if (block_manager_->metrics_) {
     block_manager_->metrics_->total_bytes_read->IncrementBy(length);
   }
@@ -454,7 +517,8 @@ Status FileReadableBlock::Read(uint64_t offset, size_t length,
 
 size_t FileReadableBlock::memory_footprint() const {
   DCHECK(reader_);
-  return kudu_malloc_usable_size(this) + reader_->memory_footprint();
+  return kudu_malloc_usable_size(this) + reader_->memory_footprint() +
+      (mapped_region_ ? kudu_malloc_usable_size(mapped_region_.get()) : 0);
 }
 
 } // namespace internal
@@ -504,7 +568,8 @@ bool FileBlockManager::FindBlockPath(const BlockId& block_id,
 FileBlockManager::FileBlockManager(Env* env, const BlockManagerOptions& opts)
   : env_(DCHECK_NOTNULL(env)),
     read_only_(opts.read_only),
-    dd_manager_(env, opts.metric_entity, kBlockManagerType, opts.root_paths),
+    dd_manager_(env, opts.metric_entity, kBlockManagerType, opts.root_paths,
+                opts.metric_registry),
     rand_(GetRandomSeed32()),
     next_block_id_(rand_.Next64()),
     mem_tracker_(MemTracker::CreateTracker(-1,
@@ -517,6 +582,7 @@ FileBlockManager::FileBlockManager(Env* env, const BlockManagerOptions& opts)
                                                       env_,
                                                       file_cache_capacity,
                                                       opts.metric_entity));
+    file_cache_->set_direct_io(FLAGS_block_manager_direct_io_reads);
   }
 
   if (opts.metric_entity) {
@@ -555,7 +621,7 @@ Status FileBlockManager::CreateBlock(const CreateBlockOptions& opts,
   CHECK(!read_only_);
 
   DataDir* dir;
-  RETURN_NOT_OK(dd_manager_.GetNextDataDir(&dir));
+  RETURN_NOT_OK(dd_manager_.GetNextDataDir(opts, &dir));
   uint16_t uuid_idx;
   CHECK(dd_manager_.FindUuidIndexByDataDir(dir, &uuid_idx));
 
@@ -625,9 +691,27 @@ Status FileBlockManager::OpenBlock(const BlockId& block_id,
   if (file_cache_) {
     RETURN_NOT_OK(file_cache_->OpenExistingFile(path, &reader));
   } else {
-    RETURN_NOT_OK(env_util::OpenFileForRandom(env_, path, &reader));
+    RandomAccessFileOptions opts;
+    opts.direct_io = FLAGS_block_manager_direct_io_reads;
+    std::unique_ptr<RandomAccessFile> r;
+    RETURN_NOT_OK(env_->NewRandomAccessFile(opts, path, &r));
+    reader.reset(r.release());
   }
-  block->reset(new internal::FileReadableBlock(this, block_id, reader));
+  unique_ptr<MemoryMappedRegion> region;
+  if (FLAGS_block_manager_mmap_reads) {
+    uint64_t size;
+    RETURN_NOT_OK(reader->Size(&size));
+    if (size > 0) {
+      // Fall back to regular reads if the file can't be mapped.
+      Status s = reader->Map(0, size, &region);
+      if (!s.ok()) {
+        KLOG_EVERY_N_SECS(WARNING, 60) << "Could not memory map block "
+                                       << block_id.ToString() << ": " << s.ToString();
+      }
+    }
+  }
+  block->reset(new internal::FileReadableBlock(this, block_id, reader,
+                                               std::move(region)));
   return Status::OK();
 }
 
@@ -657,20 +741,58 @@ Status FileBlockManager::DeleteBlock(const BlockId& block_id) {
   return Status::OK();
 }
 
+static void SyncBlockDataAsync(internal::FileWritableBlock* block,
+                               Status* status) {
+  *status = block->SyncData();
+}
+
 Status FileBlockManager::CloseBlocks(const vector<WritableBlock*>& blocks) {
   VLOG(3) << "Closing " << blocks.size() << " blocks";
-  if (FLAGS_block_coalesce_close) {
-    // Ask the kernel to begin writing out each block's dirty data. This is
-    // done up-front to give the kernel opportunities to coalesce contiguous
-    // dirty pages.
+  if (!FLAGS_block_coalesce_close) {
+    // Close each block, waiting for each to become durable.
     for (WritableBlock* block : blocks) {
-      RETURN_NOT_OK(block->FlushDataAsync());
+      RETURN_NOT_OK(block->Close());
     }
+    return Status::OK();
   }
 
-  // Now close each block, waiting for each to become durable.
+  // Ask the kernel to begin writing out each block's dirty data. This is
+  // done up-front to give the kernel opportunities to coalesce contiguous
+  // dirty pages.
+  vector<internal::FileWritableBlock*> to_sync;
+  std::unordered_set<DataDir*> dirs;
   for (WritableBlock* block : blocks) {
-    RETURN_NOT_OK(block->Close());
+    if (block->state() == WritableBlock::CLOSED) {
+      continue;
+    }
+    RETURN_NOT_OK(block->FlushDataAsync());
+    auto* fwb = down_cast<internal::FileWritableBlock*>(block);
+    to_sync.push_back(fwb);
+    dirs.insert(fwb->location().data_dir());
+  }
+
+  // Synchronize the blocks' data, in parallel across data directories.
+  vector<Status> statuses(to_sync.size());
+  for (int i = 0; i < to_sync.size(); i++) {
+    to_sync[i]->location().data_dir()->ExecClosure(
+        Bind(&SyncBlockDataAsync, to_sync[i], &statuses[i]));
+  }
+  for (DataDir* dir : dirs) {
+    dir->WaitOnClosures();
+  }
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+
+  // Synchronize the metadata. Each dirty parent directory is synchronized
+  // just once, no matter how many of the blocks it holds.
+  for (internal::FileWritableBlock* block : to_sync) {
+    RETURN_NOT_OK(SyncMetadata(block->location()));
+  }
+
+  // Now close each block without synchronizing it again.
+  for (internal::FileWritableBlock* block : to_sync) {
+    RETURN_NOT_OK(block->Close(internal::FileWritableBlock::NO_SYNC));
   }
   return Status::OK();
 }
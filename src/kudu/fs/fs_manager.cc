@@ -29,6 +29,7 @@
 #include <google/protobuf/message.h>
 
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/dir_io_metrics.h"
 #include "kudu/fs/file_block_manager.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/fs/log_block_manager.h"
@@ -82,6 +83,7 @@ DECLARE_string(umask);
 using kudu::env_util::ScopedFileDeleter;
 using kudu::fs::BlockManagerOptions;
 using kudu::fs::CreateBlockOptions;
+using kudu::fs::DirIoMetrics;
 using kudu::fs::FileBlockManager;
 using kudu::fs::LogBlockManager;
 using kudu::fs::ReadableBlock;
@@ -108,7 +110,8 @@ const char *FsManager::kInstanceMetadataFileName = "instance";
 const char *FsManager::kConsensusMetadataDirName = "consensus-meta";
 
 FsManagerOpts::FsManagerOpts()
-  : wal_path(FLAGS_fs_wal_dir),
+  : metric_registry(nullptr),
+    wal_path(FLAGS_fs_wal_dir),
     read_only(false) {
   data_paths = strings::Split(FLAGS_fs_data_dirs, ",", strings::SkipEmpty());
 }
@@ -122,6 +125,7 @@ FsManager::FsManager(Env* env, const string& root_path)
     wal_fs_root_(root_path),
     data_fs_roots_({ root_path }),
     metric_entity_(nullptr),
+    metric_registry_(nullptr),
     initted_(false) {
 }
 
@@ -132,6 +136,7 @@ FsManager::FsManager(Env* env,
     wal_fs_root_(opts.wal_path),
     data_fs_roots_(opts.data_paths),
     metric_entity_(opts.metric_entity),
+    metric_registry_(opts.metric_registry),
     parent_mem_tracker_(opts.parent_mem_tracker),
     initted_(false) {
 }
@@ -213,12 +218,14 @@ Status FsManager::Init() {
   InitBlockManager();
 
   initted_ = true;
+  wal_io_metrics_.reset(new DirIoMetrics(metric_registry_, GetWalsRootDir()));
   return Status::OK();
 }
 
 void FsManager::InitBlockManager() {
   BlockManagerOptions opts;
   opts.metric_entity = metric_entity_;
+  opts.metric_registry = metric_registry_;
   opts.parent_mem_tracker = parent_mem_tracker_;
   opts.root_paths = GetDataRootDirs();
   opts.read_only = read_only_;
@@ -568,6 +575,13 @@ void FsManager::DumpFileSystemTree(ostream& out, const string& prefix,
 //  Data read/write interfaces
 // ==========================================================================
 
+Status FsManager::CreateNewBlock(const CreateBlockOptions& opts,
+                                 gscoped_ptr<WritableBlock>* block) {
+  CHECK(!read_only_);
+
+  return block_manager_->CreateBlock(opts, block);
+}
+
 Status FsManager::CreateNewBlock(gscoped_ptr<WritableBlock>* block) {
   CHECK(!read_only_);
 
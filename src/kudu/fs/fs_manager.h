@@ -44,9 +44,12 @@ namespace kudu {
 
 class MemTracker;
 class MetricEntity;
+class MetricRegistry;
 
 namespace fs {
 class BlockManager;
+struct CreateBlockOptions;
+class DirIoMetrics;
 class ReadableBlock;
 class WritableBlock;
 } // namespace fs
@@ -68,6 +71,13 @@ struct FsManagerOpts {
   // Defaults to NULL.
   scoped_refptr<MetricEntity> metric_entity;
 
+  // The registry with which the metrics of each data directory and of the
+  // WAL directory are registered, as entities of their own. If NULL, they
+  // will not be produced.
+  //
+  // Defaults to NULL.
+  MetricRegistry* metric_registry;
+
   // The memory tracker under which all new memory trackers will be parented.
   // If NULL, new memory trackers will be parented to the root tracker.
   std::shared_ptr<MemTracker> parent_mem_tracker;
@@ -126,9 +136,11 @@ class FsManager {
   //  Data read/write interfaces
   // ==========================================================================
 
-  // Creates a new anonymous block.
+  // Creates a new anonymous block, placed according to 'opts'.
   //
   // Block will be synced on close.
+  Status CreateNewBlock(const fs::CreateBlockOptions& opts,
+                        gscoped_ptr<fs::WritableBlock>* block);
   Status CreateNewBlock(gscoped_ptr<fs::WritableBlock>* block);
 
   Status OpenBlock(const BlockId& block_id,
@@ -203,6 +215,12 @@ class FsManager {
     return block_manager_.get();
   }
 
+  // The metrics of the I/O done to the WAL directory, recorded by the
+  // WALs. Set once the FsManager has been opened.
+  fs::DirIoMetrics* wal_io_metrics() const {
+    return wal_io_metrics_.get();
+  }
+
  private:
   FRIEND_TEST(FsManagerTestBase, TestDuplicatePaths);
   friend class itest::ExternalMiniClusterFsInspector; // for access to directory names
@@ -266,6 +284,7 @@ class FsManager {
   const std::vector<std::string> data_fs_roots_;
 
   scoped_refptr<MetricEntity> metric_entity_;
+  MetricRegistry* metric_registry_;
 
   std::shared_ptr<MemTracker> parent_mem_tracker_;
 
@@ -283,6 +302,8 @@ class FsManager {
 
   gscoped_ptr<fs::BlockManager> block_manager_;
 
+  std::unique_ptr<fs::DirIoMetrics> wal_io_metrics_;
+
   bool initted_;
 
   DISALLOW_COPY_AND_ASSIGN(FsManager);
@@ -27,6 +27,7 @@
 #include "kudu/fs/data_dirs.h"
 #include "kudu/fs/fs.pb.h"
 #include "kudu/gutil/callback.h"
+#include "kudu/gutil/casts.h"
 #include "kudu/gutil/integral_types.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/numbers.h"
@@ -41,7 +42,9 @@
 #include "kudu/util/env_util.h"
 #include "kudu/util/file_cache.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/io_rate_limiter.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/malloc.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/mutex.h"
@@ -51,11 +54,14 @@
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_util_prod.h"
+#include "kudu/util/thread.h"
 #include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DECLARE_bool(enable_data_block_fsync);
 DECLARE_bool(block_manager_lock_dirs);
+DECLARE_bool(block_manager_direct_io_reads);
+DECLARE_bool(block_manager_mmap_reads);
 
 // TODO(unknown): How should this be configured? Should provide some guidance.
 DEFINE_uint64(log_container_max_size, 10LU * 1024 * 1024 * 1024,
@@ -78,6 +84,38 @@ DEFINE_bool(log_block_manager_test_hole_punching, true,
 TAG_FLAG(log_block_manager_test_hole_punching, advanced);
 TAG_FLAG(log_block_manager_test_hole_punching, unsafe);
 
+DEFINE_double(log_container_live_metadata_before_compact_ratio, 0.5,
+              "Ratio of the records of a log container's metadata file which describe "
+              "live blocks, below which the metadata file is rewritten with only those "
+              "records when the block manager is opened. The records of deleted blocks "
+              "only slow down the next opening. 0 means the metadata is never compacted.");
+TAG_FLAG(log_container_live_metadata_before_compact_ratio, experimental);
+
+DEFINE_int32(log_container_metadata_compaction_min_records, 10000,
+             "Minimum number of records in a log container's metadata file for it "
+             "to be compacted when the block manager is opened.");
+TAG_FLAG(log_container_metadata_compaction_min_records, experimental);
+
+DEFINE_int32(log_block_manager_open_threads_per_dir, 4,
+             "Number of threads opening the log containers of each data directory, "
+             "and reading their metadata, in parallel when the block manager is "
+             "opened.");
+TAG_FLAG(log_block_manager_open_threads_per_dir, advanced);
+
+DEFINE_double(log_container_defrag_live_ratio, 0,
+              "Full log block containers whose live blocks take up less than this "
+              "fraction of their size are defragmented in the background: their "
+              "live blocks are copied into other containers, after which their files "
+              "are deleted. The copies are throttled by "
+              "--background_io_max_mb_per_sec_by_dir. 0 disables defragmentation.");
+TAG_FLAG(log_container_defrag_live_ratio, experimental);
+TAG_FLAG(log_container_defrag_live_ratio, runtime);
+
+DEFINE_int32(log_container_defrag_interval_ms, 60 * 1000,
+             "How often to look for log block containers to defragment. See "
+             "--log_container_defrag_live_ratio.");
+TAG_FLAG(log_container_defrag_interval_ms, experimental);
+
 METRIC_DEFINE_gauge_uint64(server, log_block_manager_bytes_under_management,
                            "Bytes Under Management",
                            kudu::MetricUnit::kBytes,
@@ -104,6 +142,18 @@ METRIC_DEFINE_counter(server, log_block_manager_unavailable_containers,
                       "Number of non-full log block containers that are under root paths "
                       "whose disks are full");
 
+METRIC_DEFINE_counter(server, log_block_manager_defragmented_containers,
+                      "Number of Defragmented Log Block Containers",
+                      kudu::MetricUnit::kLogBlockContainers,
+                      "Number of sparse log block containers deleted after their live "
+                      "blocks were copied into other containers");
+
+METRIC_DEFINE_counter(server, log_block_manager_defragmented_bytes,
+                      "Bytes Copied Defragmenting Log Block Containers",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of live blocks copied out of sparse log block "
+                      "containers");
+
 namespace kudu {
 
 namespace fs {
@@ -140,6 +190,8 @@ struct LogBlockManagerMetrics {
 
   scoped_refptr<Counter> containers;
   scoped_refptr<Counter> full_containers;
+  scoped_refptr<Counter> defragmented_containers;
+  scoped_refptr<Counter> defragmented_bytes;
 };
 
 #define MINIT(x) x(METRIC_log_block_manager_##x.Instantiate(metric_entity))
@@ -149,7 +201,9 @@ LogBlockManagerMetrics::LogBlockManagerMetrics(const scoped_refptr<MetricEntity>
     GINIT(bytes_under_management),
     GINIT(blocks_under_management),
     MINIT(containers),
-    MINIT(full_containers) {
+    MINIT(full_containers),
+    MINIT(defragmented_containers),
+    MINIT(defragmented_bytes) {
 }
 #undef GINIT
 #undef MINIT
@@ -220,10 +274,19 @@ class LogBlockContainer {
   // The on-disk effects of this call are made durable only after SyncData().
   Status WriteData(int64_t offset, const Slice& data);
 
+  // With --block_manager_direct_io_reads or --block_manager_mmap_reads,
+  // opens the handle with which ReadData() and MapData() read the data file.
+  Status OpenDataReader();
+
   // See RWFile::Read().
   Status ReadData(int64_t offset, size_t length,
                   Slice* result, uint8_t* scratch) const;
 
+  // See RandomAccessFile::Map(). Returns NotSupported without
+  // --block_manager_mmap_reads.
+  Status MapData(int64_t offset, size_t length,
+                 unique_ptr<MemoryMappedRegion>* region) const;
+
   // Appends 'pb' to this container's metadata file.
   //
   // The on-disk effects of this call are made durable only after SyncMetadata().
@@ -254,6 +317,10 @@ class LogBlockContainer {
   // TODO(unknown): Add support to synchronize just a range.
   Status SyncMetadata();
 
+  // Synchronizes this container's data file and then its metadata file with
+  // the disk, recording the latency of the data sync.
+  Status SyncDataAndMetadata();
+
   // Truncates this container's data file to 'total_bytes_written_' if it is
   // full. This effectively removes any preallocated but unused space.
   //
@@ -268,6 +335,13 @@ class LogBlockContainer {
   // returning the records.
   Status ReadContainerRecords(deque<BlockRecordPB>* records) const;
 
+  // Replaces the container's metadata file with one holding only 'records',
+  // and reopens it for appending. The replacement is atomic.
+  //
+  // This function is thread unsafe, and may only be called before the
+  // container is made available.
+  Status RewriteMetadata(const vector<BlockRecordPB>& records);
+
   // Updates 'total_bytes_written_' and 'total_blocks_written_', marking this
   // container as full if needed. Should only be called when a block is fully
   // written, as it will round up the container data file's position.
@@ -296,6 +370,34 @@ class LogBlockContainer {
   const DataDir* data_dir() const { return data_dir_; }
   DataDir* mutable_data_dir() const { return data_dir_; }
   const PathInstanceMetadataPB* instance() const { return data_dir_->instance()->metadata(); }
+  const boost::optional<int64_t>& max_num_blocks() const { return max_num_blocks_; }
+
+  // Accounting of the live blocks of the container, i.e. those in the block
+  // manager's block map. Must hold the block manager's lock.
+  void BlockAdded(int64_t length) {
+    live_blocks_++;
+    live_bytes_ += length;
+  }
+  void BlockRemoved(int64_t length) {
+    live_blocks_--;
+    live_bytes_ -= length;
+  }
+  int64_t live_blocks() const { return live_blocks_; }
+  int64_t live_bytes() const { return live_bytes_; }
+
+  // Whether the container was handed out to a writer. Must hold the block
+  // manager's lock.
+  bool in_use() const { return in_use_; }
+  void set_in_use(bool in_use) { in_use_ = in_use; }
+
+  // The number of LogBlocks of the container in memory, including deleted
+  // blocks still open for reading or whose space is yet to be freed. The
+  // container may only be destroyed once there are none.
+  AtomicInt<int64_t>* log_blocks_in_memory() { return &log_blocks_in_memory_; }
+
+  // Returns the paths of the container's files.
+  const string& data_path() const { return data_file_->filename(); }
+  string metadata_path() const { return metadata_file_->filename(); }
 
  private:
   LogBlockContainer(LogBlockManager* block_manager, DataDir* data_dir,
@@ -322,12 +424,23 @@ class LogBlockContainer {
   unique_ptr<WritablePBContainerFile> metadata_file_;
   shared_ptr<RWFile> data_file_;
 
+  // With --block_manager_direct_io_reads or --block_manager_mmap_reads, a
+  // handle to the data file which reads it (with direct I/O if enabled) and
+  // maps it. Block data is always written via 'data_file_'.
+  shared_ptr<RandomAccessFile> data_reader_;
+
   // The amount of data written thus far in the container.
   int64_t total_bytes_written_ = 0;
 
   // The number of blocks written thus far in the container.
   int64_t total_blocks_written_ = 0;
 
+  // See BlockAdded(), in_use() and log_blocks_in_memory().
+  int64_t live_blocks_ = 0;
+  int64_t live_bytes_ = 0;
+  bool in_use_ = false;
+  AtomicInt<int64_t> log_blocks_in_memory_ { 0 };
+
   // The metrics. Not owned by the log container; it has the same lifespan
   // as the block manager.
   const LogBlockManagerMetrics* metrics_;
@@ -412,6 +525,7 @@ Status LogBlockContainer::Create(LogBlockManager* block_manager,
                                            dir,
                                            std::move(metadata_file),
                                            std::move(cached_data_file)));
+    RETURN_NOT_OK((*container)->OpenDataReader());
     VLOG(1) << "Created log block container " << (*container)->ToString();
   }
 
@@ -506,6 +620,7 @@ Status LogBlockContainer::Open(LogBlockManager* block_manager,
                                                                       std::move(metadata_pb_writer),
                                                                       std::move(data_file)));
   open_container->preallocated_offset_ = data_file_size;
+  RETURN_NOT_OK(open_container->OpenDataReader());
   VLOG(1) << "Opened log block container " << open_container->ToString();
   container->swap(open_container);
   return Status::OK();
@@ -704,9 +819,38 @@ Status LogBlockContainer::ReadData(int64_t offset, size_t length,
                                    Slice* result, uint8_t* scratch) const {
   DCHECK_GE(offset, 0);
 
+  if (data_reader_) {
+    return data_reader_->Read(offset, length, result, scratch);
+  }
   return data_file_->Read(offset, length, result, scratch);
 }
 
+Status LogBlockContainer::MapData(int64_t offset, size_t length,
+                                  unique_ptr<MemoryMappedRegion>* region) const {
+  DCHECK_GE(offset, 0);
+
+  if (!FLAGS_block_manager_mmap_reads || !data_reader_) {
+    return Status::NotSupported("memory mapping not enabled", data_path());
+  }
+  return data_reader_->Map(offset, length, region);
+}
+
+Status LogBlockContainer::OpenDataReader() {
+  if (!FLAGS_block_manager_direct_io_reads && !FLAGS_block_manager_mmap_reads) {
+    return Status::OK();
+  }
+  if (block_manager_->read_file_cache_) {
+    return block_manager_->read_file_cache_->OpenExistingFile(
+        data_path(), &data_reader_);
+  }
+  RandomAccessFileOptions opts;
+  opts.direct_io = FLAGS_block_manager_direct_io_reads;
+  unique_ptr<RandomAccessFile> reader;
+  RETURN_NOT_OK(block_manager_->env()->NewRandomAccessFile(opts, data_path(), &reader));
+  data_reader_ = std::move(reader);
+  return Status::OK();
+}
+
 Status LogBlockContainer::AppendMetadata(const BlockRecordPB& pb) {
   // Note: We don't check for sufficient disk space for metadata writes in
   // order to allow for block deletion on full disks.
@@ -737,6 +881,63 @@ Status LogBlockContainer::SyncMetadata() {
   return Status::OK();
 }
 
+Status LogBlockContainer::SyncDataAndMetadata() {
+  // TODO(unknown): Sync just the dirty data and metadata.
+  data_dir_->IoStarted(DirIoMetrics::SYNC);
+  MonoTime start_time = MonoTime::Now();
+  Status s = SyncData();
+  data_dir_->IoFinished(DirIoMetrics::SYNC, data_path(),
+                        MonoTime::Now() - start_time);
+  RETURN_NOT_OK(s);
+  return SyncMetadata();
+}
+
+Status LogBlockContainer::RewriteMetadata(const vector<BlockRecordPB>& records) {
+  Env* env = block_manager_->env();
+  string metadata_path = metadata_file_->filename();
+  string tmp_path = StrCat(metadata_path, kTmpInfix);
+
+  // Write the records to a temporary file first, so that a crash leaves either
+  // the old or the new file in place.
+  {
+    RWFileOptions opts;
+    opts.mode = Env::CREATE_IF_NON_EXISTING_TRUNCATE;
+    unique_ptr<RWFile> tmp_file;
+    RETURN_NOT_OK(env->NewRWFile(opts, tmp_path, &tmp_file));
+    WritablePBContainerFile tmp_writer(std::move(tmp_file));
+    RETURN_NOT_OK(tmp_writer.Init(BlockRecordPB()));
+    for (const BlockRecordPB& record : records) {
+      RETURN_NOT_OK(tmp_writer.Append(record));
+    }
+    if (FLAGS_enable_data_block_fsync) {
+      RETURN_NOT_OK(tmp_writer.Sync());
+    }
+    RETURN_NOT_OK(tmp_writer.Close());
+  }
+
+  // Drop the handle on the old file, which the rename unlinks.
+  metadata_file_.reset();
+  RETURN_NOT_OK(env->RenameFile(tmp_path, metadata_path));
+  if (FLAGS_enable_data_block_fsync) {
+    RETURN_NOT_OK(env->SyncDir(data_dir_->dir()));
+  }
+
+  if (block_manager_->file_cache_) {
+    block_manager_->file_cache_->Invalidate(metadata_path);
+    shared_ptr<RWFile> metadata_writer;
+    RETURN_NOT_OK(block_manager_->file_cache_->OpenExistingFile(
+        metadata_path, &metadata_writer));
+    metadata_file_.reset(new WritablePBContainerFile(std::move(metadata_writer)));
+  } else {
+    RWFileOptions opts;
+    opts.mode = Env::OPEN_EXISTING;
+    unique_ptr<RWFile> metadata_writer;
+    RETURN_NOT_OK(env->NewRWFile(opts, metadata_path, &metadata_writer));
+    metadata_file_.reset(new WritablePBContainerFile(std::move(metadata_writer)));
+  }
+  return metadata_file_->Reopen();
+}
+
 Status LogBlockContainer::EnsurePreallocated(int64_t block_start_offset,
                                              size_t next_append_length) {
   DCHECK_GE(block_start_offset, 0);
@@ -864,6 +1065,7 @@ LogBlock::LogBlock(LogBlockContainer* container, BlockId block_id,
       deleted_(false) {
   DCHECK_GE(offset, 0);
   DCHECK_GE(length, 0);
+  container_->log_blocks_in_memory()->Increment();
 }
 
 static void DeleteBlockAsync(LogBlockContainer* container,
@@ -876,12 +1078,15 @@ static void DeleteBlockAsync(LogBlockContainer* container,
   VLOG(3) << "Freeing space belonging to block " << block_id;
   WARN_NOT_OK(container->DeleteBlock(offset, length),
               Substitute("Could not delete block $0", block_id.ToString()));
+  container->log_blocks_in_memory()->IncrementBy(-1);
 }
 
 LogBlock::~LogBlock() {
   if (deleted_) {
     container_->ExecClosure(Bind(&DeleteBlockAsync, container_, block_id_,
                                  offset_, length_));
+  } else {
+    container_->log_blocks_in_memory()->IncrementBy(-1);
   }
 }
 
@@ -935,6 +1140,8 @@ class LogWritableBlock : public WritableBlock {
   // Does not synchronize the written data; that takes place in Close().
   Status AppendMetadata();
 
+  LogBlockContainer* container() const { return container_; }
+
  private:
   // The owning container. Must outlive the block.
   LogBlockContainer* container_;
@@ -1009,9 +1216,18 @@ Status LogWritableBlock::Append(const Slice& data) {
   int64_t cur_block_offset = block_offset_ + block_length_;
   RETURN_NOT_OK(container_->EnsurePreallocated(cur_block_offset, data.size()));
 
+  if (IoRateLimiter::IsBackgroundIoThread()) {
+    container_->mutable_data_dir()->io_rate_limiter()->Request(data.size());
+  }
+
+  DataDir* dir = container_->mutable_data_dir();
+  dir->IoStarted(DirIoMetrics::WRITE);
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
-  RETURN_NOT_OK(container_->WriteData(cur_block_offset, data));
+  Status s = container_->WriteData(cur_block_offset, data);
   MicrosecondsInt64 end_time = GetMonoTimeMicros();
+  dir->IoFinished(DirIoMetrics::WRITE, container_->data_path(),
+                  MonoDelta::FromMicroseconds(end_time - start_time));
+  RETURN_NOT_OK(s);
 
   int64_t dur = end_time - start_time;
   TRACE_COUNTER_INCREMENT("lbm_write_time_us", dur);
@@ -1082,13 +1298,7 @@ Status LogWritableBlock::DoClose(SyncMode mode) {
     if (mode == SYNC &&
         (state_ == CLEAN || state_ == DIRTY || state_ == FLUSHING)) {
       VLOG(3) << "Syncing block " << id();
-
-      // TODO(unknown): Sync just this block's dirty data.
-      s = container_->SyncData();
-      RETURN_NOT_OK(s);
-
-      // TODO(unknown): Sync just this block's dirty metadata.
-      s = container_->SyncMetadata();
+      s = container_->SyncDataAndMetadata();
       RETURN_NOT_OK(s);
     }
   }
@@ -1116,7 +1326,8 @@ Status LogWritableBlock::AppendMetadata() {
 class LogReadableBlock : public ReadableBlock {
  public:
   LogReadableBlock(LogBlockContainer* container,
-                   const scoped_refptr<LogBlock>& log_block);
+                   const scoped_refptr<LogBlock>& log_block,
+                   unique_ptr<MemoryMappedRegion> mapped_region);
 
   virtual ~LogReadableBlock();
 
@@ -1129,6 +1340,10 @@ class LogReadableBlock : public ReadableBlock {
   virtual Status Read(uint64_t offset, size_t length,
                       Slice* result, uint8_t* scratch) const OVERRIDE;
 
+  virtual const MemoryMappedRegion* mapped_region() const OVERRIDE {
+    return mapped_region_.get();
+  }
+
   virtual size_t memory_footprint() const OVERRIDE;
 
  private:
@@ -1138,6 +1353,10 @@ class LogReadableBlock : public ReadableBlock {
   // A reference to this block's metadata.
   scoped_refptr<internal::LogBlock> log_block_;
 
+  // With --block_manager_mmap_reads, the mapping of the block's range of the
+  // container's data file. Kept until the block is destroyed.
+  const unique_ptr<MemoryMappedRegion> mapped_region_;
+
   // Whether or not this block has been closed. Close() is thread-safe, so
   // this must be an atomic primitive.
   AtomicBool closed_;
@@ -1146,9 +1365,11 @@ class LogReadableBlock : public ReadableBlock {
 };
 
 LogReadableBlock::LogReadableBlock(LogBlockContainer* container,
-                                   const scoped_refptr<LogBlock>& log_block)
+                                   const scoped_refptr<LogBlock>& log_block,
+                                   unique_ptr<MemoryMappedRegion> mapped_region)
   : container_(container),
     log_block_(log_block),
+    mapped_region_(std::move(mapped_region)),
     closed_(false) {
   if (container_->metrics()) {
     container_->metrics()->generic_metrics.blocks_open_reading->Increment();
@@ -1197,11 +1418,25 @@ Status LogReadableBlock::Read(uint64_t offset, size_t length,
                                       log_block_->offset() + log_block_->length()));
   }
 
+  bool background = IoRateLimiter::IsBackgroundIoThread();
+  IoRateLimiter* limiter = container_->mutable_data_dir()->io_rate_limiter();
+  if (background) {
+    limiter->Request(length);
+  }
+
+  DataDir* dir = container_->mutable_data_dir();
+  dir->IoStarted(DirIoMetrics::READ);
   MicrosecondsInt64 start_time = GetMonoTimeMicros();
-  RETURN_NOT_OK(container_->ReadData(read_offset, length, result, scratch));
+  Status s = container_->ReadData(read_offset, length, result, scratch);
   MicrosecondsInt64 end_time = GetMonoTimeMicros();
-
   int64_t dur = end_time - start_time;
+  dir->IoFinished(DirIoMetrics::READ, container_->data_path(),
+                  MonoDelta::FromMicroseconds(dur));
+  RETURN_NOT_OK(s);
+
+  if (!background) {
+    limiter->ReportForegroundLatency(MonoTime::Now(), MonoDelta::FromMicroseconds(dur));
+  }
   TRACE_COUNTER_INCREMENT("lbm_read_time_us", dur);
 
   const char* counter = BUCKETED_COUNTER_NAME("lbm_reads", dur);
@@ -1214,7 +1449,8 @@ Status LogReadableBlock::Read(uint64_t offset, size_t length,
 }
 
 size_t LogReadableBlock::memory_footprint() const {
-  return kudu_malloc_usable_size(this);
+  return kudu_malloc_usable_size(this) +
+      (mapped_region_ ? kudu_malloc_usable_size(mapped_region_.get()) : 0);
 }
 
 } // namespace internal
@@ -1239,7 +1475,8 @@ LogBlockManager::LogBlockManager(Env* env, const BlockManagerOptions& opts)
   : mem_tracker_(MemTracker::CreateTracker(-1,
                                            "log_block_manager",
                                            opts.parent_mem_tracker)),
-    dd_manager_(env, opts.metric_entity, kBlockManagerType, opts.root_paths),
+    dd_manager_(env, opts.metric_entity, kBlockManagerType, opts.root_paths,
+                opts.metric_registry),
     blocks_by_block_id_(10,
                         BlockMap::hasher(),
                         BlockMap::key_equal(),
@@ -1247,10 +1484,19 @@ LogBlockManager::LogBlockManager(Env* env, const BlockManagerOptions& opts)
     env_(DCHECK_NOTNULL(env)),
     read_only_(opts.read_only),
     buggy_el6_kernel_(IsBuggyEl6Kernel(env->GetKernelRelease())),
-    next_block_id_(1) {
+    next_block_id_(1),
+    defrag_shutdown_latch_(1) {
 
   int64_t file_cache_capacity = GetFileCacheCapacityForBlockManager(env_);
   if (file_cache_capacity != kint64max) {
+    // Direct I/O and memory mapped reads take a second descriptor per data
+    // file.
+    if (FLAGS_block_manager_direct_io_reads || FLAGS_block_manager_mmap_reads) {
+      file_cache_capacity = std::max<int64_t>(file_cache_capacity / 2, 1);
+      read_file_cache_.reset(new FileCache<RandomAccessFile>(
+          "lbm-read", env_, file_cache_capacity, opts.metric_entity));
+      read_file_cache_->set_direct_io(FLAGS_block_manager_direct_io_reads);
+    }
     file_cache_.reset(new FileCache<RWFile>("lbm",
                                             env_,
                                             file_cache_capacity,
@@ -1275,6 +1521,11 @@ LogBlockManager::LogBlockManager(Env* env, const BlockManagerOptions& opts)
 }
 
 LogBlockManager::~LogBlockManager() {
+  defrag_shutdown_latch_.CountDown();
+  if (defrag_thread_) {
+    defrag_thread_->Join();
+  }
+
   // Release all of the memory accounted by the blocks.
   int64_t mem = 0;
   for (const auto& entry : blocks_by_block_id_) {
@@ -1314,6 +1565,9 @@ Status LogBlockManager::Open() {
   if (file_cache_) {
     RETURN_NOT_OK(file_cache_->Init());
   }
+  if (read_file_cache_) {
+    RETURN_NOT_OK(read_file_cache_->Init());
+  }
 
   // Establish (and log) block limits for each data directory using kernel,
   // filesystem, and gflags information.
@@ -1381,6 +1635,10 @@ Status LogBlockManager::Open() {
     }
   }
 
+  if (!read_only_) {
+    RETURN_NOT_OK(Thread::Create("lbm", "defrag", &LogBlockManager::RunDefragThread,
+                                 this, &defrag_thread_));
+  }
   return Status::OK();
 }
 
@@ -1393,7 +1651,7 @@ Status LogBlockManager::CreateBlock(const CreateBlockOptions& opts,
   // TODO(unknown): should we cap the number of outstanding containers and
   // force callers to block if we've reached it?
   LogBlockContainer* container;
-  RETURN_NOT_OK(GetOrCreateContainer(&container));
+  RETURN_NOT_OK(GetOrCreateContainer(opts, &container));
 
   // Generate a free block ID.
   // We have to loop here because earlier versions used non-sequential block IDs,
@@ -1426,8 +1684,18 @@ Status LogBlockManager::OpenBlock(const BlockId& block_id,
     return Status::NotFound("Can't find block", block_id.ToString());
   }
 
+  unique_ptr<MemoryMappedRegion> region;
+  if (FLAGS_block_manager_mmap_reads && lb->length() > 0) {
+    // Fall back to regular reads if the block can't be mapped.
+    Status s = lb->container()->MapData(lb->offset(), lb->length(), &region);
+    if (!s.ok()) {
+      KLOG_EVERY_N_SECS(WARNING, 60) << "Could not memory map block "
+                                     << block_id.ToString() << ": " << s.ToString();
+    }
+  }
   block->reset(new internal::LogReadableBlock(lb->container(),
-                                              lb.get()));
+                                              lb.get(),
+                                              std::move(region)));
   VLOG(3) << "Opened block " << (*block)->id()
           << " from container " << lb->container()->ToString();
   return Status::OK();
@@ -1463,20 +1731,61 @@ Status LogBlockManager::DeleteBlock(const BlockId& block_id) {
   return Status::OK();
 }
 
+static void SyncContainerAsync(LogBlockContainer* container, Status* status) {
+  *status = container->SyncDataAndMetadata();
+}
+
 Status LogBlockManager::CloseBlocks(const std::vector<WritableBlock*>& blocks) {
   VLOG(3) << "Closing " << blocks.size() << " blocks";
-  if (FLAGS_block_coalesce_close) {
-    // Ask the kernel to begin writing out each block's dirty data. This is
-    // done up-front to give the kernel opportunities to coalesce contiguous
-    // dirty pages.
+  if (!FLAGS_block_coalesce_close) {
+    // Close each block, waiting for each to become durable.
     for (WritableBlock* block : blocks) {
-      RETURN_NOT_OK(block->FlushDataAsync());
+      RETURN_NOT_OK(block->Close());
     }
+    return Status::OK();
   }
 
-  // Now close each block, waiting for each to become durable.
+  // Ask the kernel to begin writing out each block's dirty data, and append
+  // each block's metadata. This is done up-front to give the kernel
+  // opportunities to coalesce contiguous dirty pages.
+  //
+  // Along the way, collect the containers that must be synchronized.
+  vector<LogBlockContainer*> containers;
+  std::unordered_set<LogBlockContainer*> seen_containers;
+  std::unordered_set<DataDir*> dirs;
   for (WritableBlock* block : blocks) {
-    RETURN_NOT_OK(block->Close());
+    if (block->state() == WritableBlock::CLOSED) {
+      continue;
+    }
+    RETURN_NOT_OK(block->FlushDataAsync());
+    LogBlockContainer* container =
+        down_cast<internal::LogWritableBlock*>(block)->container();
+    if (InsertIfNotPresent(&seen_containers, container)) {
+      containers.push_back(container);
+      dirs.insert(container->mutable_data_dir());
+    }
+  }
+
+  // Synchronize each container once, in parallel across data directories.
+  vector<Status> statuses(containers.size());
+  for (int i = 0; i < containers.size(); i++) {
+    containers[i]->ExecClosure(Bind(&SyncContainerAsync,
+                                    containers[i],
+                                    &statuses[i]));
+  }
+  for (DataDir* dir : dirs) {
+    dir->WaitOnClosures();
+  }
+  for (const auto& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+
+  // Now close each block without synchronizing it again. The first block
+  // closed in each dirty data directory synchronizes the directory itself
+  // (see SyncContainer()).
+  for (WritableBlock* block : blocks) {
+    RETURN_NOT_OK(down_cast<internal::LogWritableBlock*>(block)->DoClose(
+        internal::LogWritableBlock::NO_SYNC));
   }
   return Status::OK();
 }
@@ -1497,9 +1806,10 @@ void LogBlockManager::AddNewContainerUnlocked(LogBlockContainer* container) {
   }
 }
 
-Status LogBlockManager::GetOrCreateContainer(LogBlockContainer** container) {
+Status LogBlockManager::GetOrCreateContainer(const CreateBlockOptions& opts,
+                                             LogBlockContainer** container) {
   DataDir* dir;
-  RETURN_NOT_OK(dd_manager_.GetNextDataDir(&dir));
+  RETURN_NOT_OK(dd_manager_.GetNextDataDir(opts, &dir));
 
   {
     std::lock_guard<simple_spinlock> l(lock_);
@@ -1507,6 +1817,7 @@ Status LogBlockManager::GetOrCreateContainer(LogBlockContainer** container) {
     if (!d.empty()) {
       *container = d.front();
       d.pop_front();
+      (*container)->set_in_use(true);
       return Status::OK();
     }
   }
@@ -1521,6 +1832,7 @@ Status LogBlockManager::GetOrCreateContainer(LogBlockContainer** container) {
     std::lock_guard<simple_spinlock> l(lock_);
     dirty_dirs_.insert(dir->dir());
     AddNewContainerUnlocked(new_container.get());
+    new_container->set_in_use(true);
   }
   *container = new_container.release();
   return Status::OK();
@@ -1533,6 +1845,7 @@ void LogBlockManager::MakeContainerAvailable(LogBlockContainer* container) {
 
 void LogBlockManager::MakeContainerAvailableUnlocked(LogBlockContainer* container) {
   DCHECK(lock_.is_locked());
+  container->set_in_use(false);
   if (container->full()) {
     return;
   }
@@ -1601,6 +1914,7 @@ bool LogBlockManager::AddLogBlockUnlocked(const scoped_refptr<LogBlock>& lb) {
   // There may already be an entry in open_block_ids_ (e.g. we just finished
   // writing out a block).
   open_block_ids_.erase(lb->block_id());
+  lb->container()->BlockAdded(lb->length());
   if (metrics()) {
     metrics()->blocks_under_management->Increment();
     metrics()->bytes_under_management->IncrementBy(lb->length());
@@ -1617,6 +1931,7 @@ scoped_refptr<LogBlock> LogBlockManager::RemoveLogBlock(const BlockId& block_id)
                           result->offset(), result->length());
 
     mem_tracker_->Release(kudu_malloc_usable_size(result.get()));
+    result->container()->BlockRemoved(result->length());
 
     if (metrics()) {
       metrics()->blocks_under_management->Decrement();
@@ -1629,7 +1944,7 @@ scoped_refptr<LogBlock> LogBlockManager::RemoveLogBlock(const BlockId& block_id)
 
 void LogBlockManager::OpenDataDir(DataDir* dir,
                                   Status* result_status) {
-  // Find all containers and open them.
+  // Find all containers.
   vector<string> children;
   Status s = env_->GetChildren(dir->dir(), &children);
   if (!s.ok()) {
@@ -1637,96 +1952,437 @@ void LogBlockManager::OpenDataDir(DataDir* dir,
         "Could not list children of $0", dir->dir()));
     return;
   }
+  vector<string> container_ids;
   for (const string& child : children) {
     string id;
-    if (!TryStripSuffixString(child, LogBlockManager::kContainerMetadataFileSuffix, &id)) {
+    if (TryStripSuffixString(child, LogBlockManager::kContainerMetadataFileSuffix, &id)) {
+      container_ids.emplace_back(std::move(id));
+    }
+  }
+
+  // Open the containers in parallel: most of the time goes to reading and
+  // parsing their metadata, one record at a time.
+  gscoped_ptr<ThreadPool> pool;
+  s = ThreadPoolBuilder("lbm-open")
+      .set_min_threads(0)
+      .set_max_threads(std::max(FLAGS_log_block_manager_open_threads_per_dir, 1))
+      .Build(&pool);
+  if (!s.ok()) {
+    *result_status = s.CloneAndPrepend(Substitute(
+        "Could not create thread pool to open $0", dir->dir()));
+    return;
+  }
+  vector<Status> statuses(container_ids.size());
+  for (int i = 0; i < container_ids.size(); i++) {
+    s = pool->SubmitFunc([this, dir, &container_ids, &statuses, i]() {
+        statuses[i] = OpenContainer(dir, container_ids[i]);
+      });
+    if (!s.ok()) {
+      statuses[i] = s.CloneAndPrepend(Substitute(
+          "Could not open container $0", container_ids[i]));
+      break;
+    }
+  }
+  pool->Wait();
+  pool->Shutdown();
+
+  // Ensure that no open failed.
+  for (const Status& container_status : statuses) {
+    if (!container_status.ok()) {
+      *result_status = container_status;
+      return;
+    }
+  }
+  *result_status = Status::OK();
+}
+
+Status LogBlockManager::OpenContainer(DataDir* dir, const string& id) {
+  unique_ptr<LogBlockContainer> container;
+  Status s = LogBlockContainer::Open(this, dir, id, &container);
+  if (s.IsAborted()) {
+    // Skip the container. Open() already handled logging for us.
+    return Status::OK();
+  }
+  RETURN_NOT_OK_PREPEND(s, Substitute("Could not open container $0", id));
+
+  // Populate the in-memory block maps using each container's records.
+  deque<BlockRecordPB> records;
+  RETURN_NOT_OK_PREPEND(container->ReadContainerRecords(&records), Substitute(
+      "Could not read records from container $0", container->ToString()));
+
+  // Process the records, building a container-local map.
+  //
+  // It's important that we don't try to add these blocks to the global map
+  // incrementally as we see each record, since it's possible that one container
+  // has a "CREATE <b>" while another has a "CREATE <b> ; DELETE <b>" pair.
+  // If we processed those two containers in this order, then upon processing
+  // the second container, we'd think there was a duplicate block. Building
+  // the container-local map first ensures that we discount deleted blocks
+  // before checking for duplicate IDs.
+  //
+  // NOTE: Since KUDU-1538, we allocate sequential block IDs, which makes reuse
+  // exceedingly unlikely. However, we might have old data which still exhibits
+  // the above issue.
+  //
+  // There are at most as many live blocks as records, so the map never needs
+  // to be rehashed.
+  UntrackedBlockMap blocks_in_container;
+  blocks_in_container.reserve(records.size());
+  uint64_t max_block_id = 0;
+  for (const BlockRecordPB& r : records) {
+    RETURN_NOT_OK_PREPEND(ProcessBlockRecord(r, container.get(), &blocks_in_container),
+                          Substitute("Could not process record in container $0",
+                                     container->ToString()));
+    max_block_id = std::max(max_block_id, r.block_id().id());
+  }
+
+  // Having processed the block records, it is now safe to truncate the
+  // preallocated space off of the end of the container. This is a no-op for
+  // non-full containers, where excess preallocated space is expected to be
+  // (eventually) used.
+  if (!read_only_) {
+    RETURN_NOT_OK_PREPEND(container->TruncateDataToTotalBytesWritten(), Substitute(
+        "Could not truncate container $0", container->ToString()));
+    RETURN_NOT_OK_PREPEND(MaybeCompactContainerMetadata(container.get(), records,
+                                                        blocks_in_container),
+                          Substitute("Could not compact the metadata of container $0",
+                                     container->ToString()));
+  }
+
+  next_block_id_.StoreMax(max_block_id + 1);
+
+  // Under the lock, merge this map into the main block map and add
+  // the container.
+  vector<scoped_refptr<LogBlock>> duplicates;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    // To avoid cacheline contention during startup, we aggregate all of the
+    // memory in a local and add it to the mem-tracker in a single increment
+    // at the end of this loop.
+    int64_t mem_usage = 0;
+    for (const UntrackedBlockMap::value_type& e : blocks_in_container) {
+      if (!AddLogBlockUnlocked(e.second)) {
+        // A crash in the middle of the defragmentation of a container may
+        // leave a block live in both the container it was copied out of and
+        // the one it was copied into. The copy was synced before it was
+        // recorded, so either will do.
+        const scoped_refptr<LogBlock>& existing = FindOrDie(blocks_by_block_id_, e.first);
+        if (existing->length() != e.second->length()) {
+          LOG(FATAL) << "Found duplicate CREATE record for block " << e.first
+                     << " which already is alive from another container when "
+                     << " processing container " << container->ToString();
+        }
+        duplicates.push_back(e.second);
+        continue;
+      }
+      mem_usage += kudu_malloc_usable_size(e.second.get());
+    }
+
+    mem_tracker_->Consume(mem_usage);
+    AddNewContainerUnlocked(container.get());
+  }
+  // The block manager owns the container from now on.
+  LogBlockContainer* c = container.release();
+
+  // Drop the extra copies for good.
+  for (const scoped_refptr<LogBlock>& lb : duplicates) {
+    LOG(WARNING) << Substitute("Dropping duplicate copy of block $0 in container $1",
+                               lb->block_id().ToString(), c->ToString());
+    if (read_only_) {
       continue;
     }
-    unique_ptr<LogBlockContainer> container;
-    s = LogBlockContainer::Open(this, dir, id, &container);
-    if (s.IsAborted()) {
-      // Skip the container. Open() already handled logging for us.
+    BlockRecordPB record;
+    lb->block_id().CopyToPB(record.mutable_block_id());
+    record.set_op_type(DELETE);
+    record.set_timestamp_us(GetCurrentTimeMicros());
+    RETURN_NOT_OK_PREPEND(c->AppendMetadata(record), Substitute(
+        "Could not drop duplicate block $0 from container $1",
+        lb->block_id().ToString(), c->ToString()));
+    lb->Delete();
+  }
+  duplicates.clear();
+
+  MakeContainerAvailable(c);
+  return Status::OK();
+}
+
+Status LogBlockManager::MaybeCompactContainerMetadata(
+    LogBlockContainer* container,
+    const deque<BlockRecordPB>& records,
+    const UntrackedBlockMap& live_blocks) {
+  // The block limit of KUDU-1508 counts every block ever written to the
+  // container, which only the records of the deleted blocks account for.
+  if (container->max_num_blocks() ||
+      records.size() < FLAGS_log_container_metadata_compaction_min_records ||
+      live_blocks.size() >=
+          records.size() * FLAGS_log_container_live_metadata_before_compact_ratio) {
+    return Status::OK();
+  }
+
+  // Keep the CREATE record of each live block. A block ID may have been
+  // reused within a container before KUDU-1538, so the offset tells which
+  // CREATE record is the live one.
+  auto is_live = [&](const BlockRecordPB& r) {
+    const scoped_refptr<LogBlock>* lb = FindOrNull(live_blocks, BlockId::FromPB(r.block_id()));
+    return lb && (*lb)->offset() == r.offset();
+  };
+  vector<BlockRecordPB> compacted;
+  compacted.reserve(live_blocks.size() + 2);
+  const BlockRecordPB* last_create = nullptr;
+  for (const BlockRecordPB& r : records) {
+    if (r.op_type() != CREATE) {
       continue;
     }
-    if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not open container $0", id));
-      return;
+    if (!last_create ||
+        r.offset() + r.length() > last_create->offset() + last_create->length()) {
+      last_create = &r;
+    }
+    if (is_live(r)) {
+      compacted.push_back(r);
     }
+  }
 
-    // Populate the in-memory block maps using each container's records.
-    deque<BlockRecordPB> records;
-    s = container->ReadContainerRecords(&records);
-    if (!s.ok()) {
-      *result_status = s.CloneAndPrepend(Substitute(
-          "Could not read records from container $0", container->ToString()));
+  // The container's extent is derived from its records, and its byte ranges
+  // must never be reused. If the block ending last was deleted, keep its
+  // CREATE and DELETE records, ahead of the others in case its ID was reused.
+  if (last_create && !is_live(*last_create)) {
+    BlockRecordPB deletion;
+    *deletion.mutable_block_id() = last_create->block_id();
+    deletion.set_op_type(DELETE);
+    deletion.set_timestamp_us(GetCurrentTimeMicros());
+    compacted.insert(compacted.begin(), { *last_create, deletion });
+  }
+
+  LOG(INFO) << Substitute("Compacting the metadata of container $0 from $1 to $2 records",
+                          container->ToString(), records.size(), compacted.size());
+  return container->RewriteMetadata(compacted);
+}
+
+void LogBlockManager::RunDefragThread() {
+  // The copies are throttled along with the other background writes.
+  ScopedBackgroundIo background_io;
+  while (!defrag_shutdown_latch_.WaitFor(
+      MonoDelta::FromMilliseconds(FLAGS_log_container_defrag_interval_ms))) {
+    DefragmentContainers();
+  }
+}
+
+void LogBlockManager::DefragmentContainers() {
+  double ratio = FLAGS_log_container_defrag_live_ratio;
+  if (ratio <= 0) {
+    return;
+  }
+
+  // Full containers are never handed out to writers again. Containers are
+  // only ever destroyed by this thread, so the pointers stay valid.
+  vector<LogBlockContainer*> sparse;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (LogBlockContainer* container : all_containers_) {
+      if (container->full() && !container->in_use() &&
+          container->live_bytes() < container->total_bytes_written() * ratio) {
+        sparse.push_back(container);
+      }
+    }
+  }
+  for (LogBlockContainer* container : sparse) {
+    if (defrag_shutdown_latch_.count() == 0) {
       return;
     }
+    WARN_NOT_OK(DefragmentContainer(container),
+                Substitute("Could not defragment container $0", container->ToString()));
+  }
+}
 
-    // Process the records, building a container-local map.
-    //
-    // It's important that we don't try to add these blocks to the global map
-    // incrementally as we see each record, since it's possible that one container
-    // has a "CREATE <b>" while another has a "CREATE <b> ; DELETE <b>" pair.
-    // If we processed those two containers in this order, then upon processing
-    // the second container, we'd think there was a duplicate block. Building
-    // the container-local map first ensures that we discount deleted blocks
-    // before checking for duplicate IDs.
-    //
-    // NOTE: Since KUDU-1538, we allocate sequential block IDs, which makes reuse
-    // exceedingly unlikely. However, we might have old data which still exhibits
-    // the above issue.
-    UntrackedBlockMap blocks_in_container;
-    uint64_t max_block_id = 0;
-    for (const BlockRecordPB& r : records) {
-      s = ProcessBlockRecord(r, container.get(), &blocks_in_container);
-      if (!s.ok()) {
-        *result_status = s.CloneAndPrepend(Substitute(
-            "Could not process record in container $0", container->ToString()));
-        return;
+Status LogBlockManager::DefragmentContainer(LogBlockContainer* container) {
+  // Copy the live blocks in the order they are laid out.
+  vector<scoped_refptr<LogBlock>> blocks;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (const auto& e : blocks_by_block_id_) {
+      if (e.second->container() == container) {
+        blocks.push_back(e.second);
       }
-      max_block_id = std::max(max_block_id, r.block_id().id());
     }
+  }
+  std::sort(blocks.begin(), blocks.end(),
+            [](const scoped_refptr<LogBlock>& a, const scoped_refptr<LogBlock>& b) {
+              return a->offset() < b->offset();
+            });
+  if (!blocks.empty()) {
+    LOG(INFO) << Substitute("Defragmenting container $0: copying $1 live block(s) out of it",
+                            container->ToString(), blocks.size());
+  }
 
-    // Having processed the block records, it is now safe to truncate the
-    // preallocated space off of the end of the container. This is a no-op for
-    // non-full containers, where excess preallocated space is expected to be
-    // (eventually) used.
-    if (!read_only_) {
-      s = container->TruncateDataToTotalBytesWritten();
-      if (!s.ok()) {
-        *result_status = s.CloneAndPrepend(Substitute(
-            "Could not truncate container $0", container->ToString()));
-        return;
+  const size_t kCopyChunkBytes = 1024 * 1024;
+  unique_ptr<uint8_t[]> scratch(new uint8_t[kCopyChunkBytes]);
+  LogBlockContainer* dest = nullptr;
+  auto release_dest = MakeScopedCleanup([&]() {
+    if (dest) {
+      MakeContainerAvailable(dest);
+    }
+  });
+  vector<std::pair<scoped_refptr<LogBlock>, scoped_refptr<LogBlock>>> copies;
+  for (const scoped_refptr<LogBlock>& lb : blocks) {
+    if (defrag_shutdown_latch_.count() == 0) {
+      break;
+    }
+    if (!dest) {
+      // Keep the blocks on the storage tier they were placed on.
+      CreateBlockOptions opts;
+      opts.tier = container->data_dir()->tier();
+      RETURN_NOT_OK(GetOrCreateContainer(opts, &dest));
+    }
+    int64_t dest_offset = dest->total_bytes_written();
+    RETURN_NOT_OK(dest->EnsurePreallocated(dest_offset, lb->length()));
+    for (int64_t pos = 0; pos < lb->length(); pos += kCopyChunkBytes) {
+      size_t n = std::min<int64_t>(kCopyChunkBytes, lb->length() - pos);
+      Slice data;
+      RETURN_NOT_OK(container->ReadData(lb->offset() + pos, n, &data, scratch.get()));
+      dest->mutable_data_dir()->io_rate_limiter()->Request(n);
+      RETURN_NOT_OK(dest->WriteData(dest_offset + pos, data));
+    }
+    copies.emplace_back(lb, new LogBlock(dest, lb->block_id(), dest_offset, lb->length()));
+    dest->UpdateBytesWrittenAndTotalBlocks(dest_offset, lb->length());
+    if (dest->full()) {
+      if (metrics()) {
+        metrics()->full_containers->Increment();
       }
+      RETURN_NOT_OK(CommitBlockCopies(container, dest, &copies));
+      RETURN_NOT_OK(dest->TruncateDataToTotalBytesWritten());
+      MakeContainerAvailable(dest);
+      dest = nullptr;
     }
+  }
+  if (dest) {
+    RETURN_NOT_OK(CommitBlockCopies(container, dest, &copies));
+  }
 
-    next_block_id_.StoreMax(max_block_id + 1);
+  // Wait for the readers of the container's blocks to be done, and for the
+  // space of its deleted blocks to be freed, before deleting it.
+  blocks.clear();
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (container->live_blocks() > 0) {
+      // Interrupted by a shutdown.
+      return Status::OK();
+    }
+  }
+  while (container->log_blocks_in_memory()->Load() > 0) {
+    if (defrag_shutdown_latch_.WaitFor(MonoDelta::FromMilliseconds(100))) {
+      return Status::OK();
+    }
+  }
+  return DeleteContainer(container);
+}
+
+Status LogBlockManager::CommitBlockCopies(
+    LogBlockContainer* container,
+    LogBlockContainer* dest,
+    vector<std::pair<scoped_refptr<LogBlock>, scoped_refptr<LogBlock>>>* copies) {
+  // Make the copies durable before recording them, so that if both the
+  // original and the copy are found live at startup, either will do.
+  RETURN_NOT_OK(dest->SyncData());
+  for (const auto& copy : *copies) {
+    const LogBlock* lb = copy.second.get();
+    BlockRecordPB record;
+    lb->block_id().CopyToPB(record.mutable_block_id());
+    record.set_op_type(CREATE);
+    record.set_offset(lb->offset());
+    record.set_length(lb->length());
+    record.set_timestamp_us(GetCurrentTimeMicros());
+    RETURN_NOT_OK(dest->AppendMetadata(record));
+  }
+  RETURN_NOT_OK(dest->SyncMetadata());
+  RETURN_NOT_OK(SyncContainer(*dest));
 
-    // Under the lock, merge this map into the main block map and add
-    // the container.
-    {
-      std::lock_guard<simple_spinlock> l(lock_);
-      // To avoid cacheline contention during startup, we aggregate all of the
-      // memory in a local and add it to the mem-tracker in a single increment
-      // at the end of this loop.
-      int64_t mem_usage = 0;
-      for (const UntrackedBlockMap::value_type& e : blocks_in_container) {
-        if (!AddLogBlockUnlocked(e.second)) {
-          LOG(FATAL) << "Found duplicate CREATE record for block " << e.first
-                     << " which already is alive from another container when "
-                     << " processing container " << container->ToString();
-        }
-        mem_usage += kudu_malloc_usable_size(e.second.get());
+  // Switch the readers over to the copies, unless the blocks were deleted
+  // in the meantime.
+  vector<scoped_refptr<LogBlock>> deleted_copies;
+  int64_t bytes_moved = 0;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    for (auto& copy : *copies) {
+      scoped_refptr<LogBlock>* lb = FindOrNull(blocks_by_block_id_, copy.first->block_id());
+      if (!lb || lb->get() != copy.first.get()) {
+        deleted_copies.emplace_back(std::move(copy.second));
+        continue;
       }
+      mem_tracker_->Consume(kudu_malloc_usable_size(copy.second.get()));
+      mem_tracker_->Release(kudu_malloc_usable_size(lb->get()));
+      container->BlockRemoved(copy.first->length());
+      dest->BlockAdded(copy.second->length());
+      *lb = copy.second;
+      bytes_moved += copy.first->length();
+    }
+  }
 
-      mem_tracker_->Consume(mem_usage);
-      AddNewContainerUnlocked(container.get());
-      MakeContainerAvailableUnlocked(container.release());
+  // Free the space of the originals once their readers are done, and record
+  // the moves in the original container. These records aren't synced: a
+  // block found live in both containers at startup is dropped from one.
+  for (const auto& copy : *copies) {
+    if (!copy.second) {
+      continue;
     }
+    copy.first->Delete();
+    BlockRecordPB record;
+    copy.first->block_id().CopyToPB(record.mutable_block_id());
+    record.set_op_type(DELETE);
+    record.set_timestamp_us(GetCurrentTimeMicros());
+    RETURN_NOT_OK(container->AppendMetadata(record));
+  }
+  copies->clear();
+
+  // Copies of deleted blocks must not come back to life at startup.
+  for (const scoped_refptr<LogBlock>& lb : deleted_copies) {
+    BlockRecordPB record;
+    lb->block_id().CopyToPB(record.mutable_block_id());
+    record.set_op_type(DELETE);
+    record.set_timestamp_us(GetCurrentTimeMicros());
+    RETURN_NOT_OK(dest->AppendMetadata(record));
+    lb->Delete();
+  }
+  if (!deleted_copies.empty()) {
+    RETURN_NOT_OK(dest->SyncMetadata());
   }
 
-  *result_status = Status::OK();
+  if (metrics()) {
+    metrics()->defragmented_bytes->IncrementBy(bytes_moved);
+  }
+  return Status::OK();
+}
+
+Status LogBlockManager::DeleteContainer(LogBlockContainer* container) {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    auto it = std::find(all_containers_.begin(), all_containers_.end(), container);
+    DCHECK(it != all_containers_.end());
+    all_containers_.erase(it);
+  }
+  string data_path = container->data_path();
+  string metadata_path = container->metadata_path();
+  DataDir* dir = container->mutable_data_dir();
+  LOG(INFO) << "Deleting defragmented container " << container->ToString();
+  delete container;
+
+  // Any descriptor cached for the files must be closed for them to go away.
+  if (read_file_cache_) {
+    read_file_cache_->Invalidate(data_path);
+  }
+  if (file_cache_) {
+    RETURN_NOT_OK(file_cache_->DeleteFile(data_path));
+    RETURN_NOT_OK(file_cache_->DeleteFile(metadata_path));
+  } else {
+    RETURN_NOT_OK(env_->DeleteFile(data_path));
+    RETURN_NOT_OK(env_->DeleteFile(metadata_path));
+  }
+  if (FLAGS_enable_data_block_fsync) {
+    RETURN_NOT_OK(env_->SyncDir(dir->dir()));
+  }
+  if (metrics()) {
+    metrics()->defragmented_containers->Increment();
+  }
+  return Status::OK();
 }
 
 Status LogBlockManager::ProcessBlockRecord(const BlockRecordPB& record,
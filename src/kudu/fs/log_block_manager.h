@@ -37,6 +37,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/random.h"
@@ -46,7 +47,9 @@ class Env;
 template <class FileType>
 class FileCache;
 class MetricEntity;
+class RandomAccessFile;
 class RWFile;
+class Thread;
 class ThreadPool;
 
 namespace fs {
@@ -184,7 +187,9 @@ class LogBlockManager : public BlockManager {
   int64_t CountBlocksForTests() const;
 
  private:
+  FRIEND_TEST(LogBlockManagerTest, TestDefragmentContainers);
   FRIEND_TEST(LogBlockManagerTest, TestLookupBlockLimit);
+  FRIEND_TEST(LogBlockManagerTest, TestMetadataCompaction);
   FRIEND_TEST(LogBlockManagerTest, TestMetadataTruncation);
   FRIEND_TEST(LogBlockManagerTest, TestParseKernelRelease);
   FRIEND_TEST(LogBlockManagerTest, TestReuseBlockIds);
@@ -212,12 +217,14 @@ class LogBlockManager : public BlockManager {
   void AddNewContainerUnlocked(internal::LogBlockContainer* container);
 
   // Returns the next container available for writing using a round-robin
-  // selection policy, creating a new one if necessary.
+  // selection policy, creating a new one if necessary. The container's data
+  // dir is chosen according to 'opts'.
   //
   // After returning, the container is considered to be in use. When
   // writing is finished, call MakeContainerAvailable() to make it
   // available to other writers.
-  Status GetOrCreateContainer(internal::LogBlockContainer** container);
+  Status GetOrCreateContainer(const CreateBlockOptions& opts,
+                              internal::LogBlockContainer** container);
 
   // Indicate that this container is no longer in use and can be handed out
   // to other writers.
@@ -266,6 +273,40 @@ class LogBlockManager : public BlockManager {
   // Success or failure is set in 'result_status'.
   void OpenDataDir(DataDir* dir, Status* result_status);
 
+  // Open the container 'id' of 'dir', adding its blocks to the block map.
+  Status OpenContainer(DataDir* dir, const std::string& id);
+
+  // Rewrites the metadata of 'container' with the records of 'live_blocks'
+  // alone if most of its 'records' belong to deleted blocks.
+  Status MaybeCompactContainerMetadata(internal::LogBlockContainer* container,
+                                       const std::deque<BlockRecordPB>& records,
+                                       const UntrackedBlockMap& live_blocks);
+
+  // Body of the thread which defragments the containers.
+  void RunDefragThread();
+
+  // Defragments the full containers whose live blocks take up less than
+  // --log_container_defrag_live_ratio of their size.
+  void DefragmentContainers();
+
+  // Copies the live blocks of 'container' into other containers, then
+  // deletes it. Returns early, leaving the container in place, on
+  // shutdown.
+  Status DefragmentContainer(internal::LogBlockContainer* container);
+
+  // Records the blocks of 'container' copied into 'dest' and switches the
+  // block map over to the copies. 'copies' holds (original, copy) pairs and
+  // is cleared.
+  Status CommitBlockCopies(
+      internal::LogBlockContainer* container,
+      internal::LogBlockContainer* dest,
+      std::vector<std::pair<scoped_refptr<internal::LogBlock>,
+                            scoped_refptr<internal::LogBlock>>>* copies);
+
+  // Deletes 'container' and its files. It must have no blocks left in
+  // memory.
+  Status DeleteContainer(internal::LogBlockContainer* container);
+
   // Perform basic initialization.
   Status Init();
 
@@ -307,6 +348,11 @@ class LogBlockManager : public BlockManager {
   // Manages files opened for reading.
   std::unique_ptr<FileCache<RWFile>> file_cache_;
 
+  // Manages the data files opened for direct I/O reads or for memory mapping,
+  // with --block_manager_direct_io_reads or --block_manager_mmap_reads.
+  // Shares the open file budget with 'file_cache_'.
+  std::unique_ptr<FileCache<RandomAccessFile>> read_file_cache_;
+
   // Maps block IDs to blocks that are now readable, either because they
   // already existed on disk when the block manager was opened, or because
   // they're WritableBlocks that were closed.
@@ -354,6 +400,11 @@ class LogBlockManager : public BlockManager {
   // May be null if instantiated without metrics.
   gscoped_ptr<internal::LogBlockManagerMetrics> metrics_;
 
+  // The thread which defragments the containers, if not read-only, and the
+  // latch counted down to shut it down.
+  scoped_refptr<Thread> defrag_thread_;
+  CountDownLatch defrag_shutdown_latch_;
+
   DISALLOW_COPY_AND_ASSIGN(LogBlockManager);
 };
 
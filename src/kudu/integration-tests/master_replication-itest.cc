@@ -33,6 +33,8 @@
 #include "kudu/util/pb_util.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int32(catalog_manager_follower_refresh_interval_ms);
+
 using std::vector;
 
 namespace kudu {
@@ -255,6 +257,56 @@ TEST_F(MasterReplicationTest, TestHeartbeatAcceptedByAnyMaster) {
       MiniCluster::MatchMode::DO_NOT_MATCH_TSERVERS, &descs));
 }
 
+// Test that, with follower reads enabled, follower masters answer metadata
+// reads which accept stale results, and tag them with their staleness.
+TEST_F(MasterReplicationTest, TestFollowerMetadataReads) {
+  FLAGS_catalog_manager_follower_refresh_interval_ms = 100;
+
+  shared_ptr<KuduClient> client;
+  ASSERT_OK(CreateClient(&client));
+  ASSERT_OK(CreateTable(client, kTableId1));
+
+  std::shared_ptr<rpc::Messenger> messenger;
+  rpc::MessengerBuilder bld("Client");
+  ASSERT_OK(bld.Build(&messenger));
+  AssertEventually([&]() {
+    int num_follower_responses = 0;
+    for (int i = 0; i < cluster_->num_masters(); i++) {
+      MasterServiceProxy proxy(messenger, cluster_->mini_master(i)->bound_rpc_addr());
+      ListTablesRequestPB req;
+      ListTablesResponsePB resp;
+      rpc::RpcController rpc;
+      req.set_name_filter(kTableId1);
+      req.set_follower_max_staleness_ms(60 * 1000);
+      ASSERT_OK(proxy.ListTables(req, &resp, &rpc));
+      SCOPED_TRACE(SecureDebugString(resp));
+      ASSERT_FALSE(resp.has_error());
+      ASSERT_EQ(1, resp.tables_size());
+      ASSERT_EQ(kTableId1, resp.tables(0).name());
+      if (resp.has_follower_staleness_ms()) {
+        ASSERT_LE(resp.follower_staleness_ms(), 60 * 1000);
+        num_follower_responses++;
+      }
+    }
+    ASSERT_EQ(cluster_->num_masters() - 1, num_follower_responses);
+  });
+
+  // Without a staleness bound, followers refuse to answer.
+  int num_not_the_leader = 0;
+  for (int i = 0; i < cluster_->num_masters(); i++) {
+    MasterServiceProxy proxy(messenger, cluster_->mini_master(i)->bound_rpc_addr());
+    ListTablesRequestPB req;
+    ListTablesResponsePB resp;
+    rpc::RpcController rpc;
+    ASSERT_OK(proxy.ListTables(req, &resp, &rpc));
+    if (resp.has_error()) {
+      ASSERT_EQ(MasterErrorPB::NOT_THE_LEADER, resp.error().code());
+      num_not_the_leader++;
+    }
+  }
+  ASSERT_EQ(cluster_->num_masters() - 1, num_not_the_leader);
+}
+
 TEST_F(MasterReplicationTest, TestMasterPeerSetsDontMatch) {
   // Restart one master with an additional entry in --master_addresses. The
   // discrepancy with the on-disk list of masters should trigger a failure.
@@ -14,6 +14,8 @@
 // KIND, either express or implied.  See the License for the
 // specific language governing permissions and limitations
 // under the License.
+#include <memory>
+
 #include <gtest/gtest.h>
 
 #include "kudu/gutil/strings/substitute.h"
@@ -83,6 +85,39 @@ TEST(TableInfoTest, TestAssignmentRanges) {
   }
 }
 
+// Test that the cached locations of a tablet are only returned for the
+// versions they were built from.
+TEST(TabletInfoTest, TestCachedLocations) {
+  scoped_refptr<TableInfo> table(new TableInfo(CURRENT_TEST_NAME()));
+  scoped_refptr<TabletInfo> tablet(new TabletInfo(table, "tablet"));
+  const int64_t initial_version = tablet->metadata().version();
+  ASSERT_FALSE(tablet->GetCachedLocations(initial_version, 0));
+
+  {
+    TabletMetadataLock meta_lock(tablet.get(), TabletMetadataLock::WRITE);
+    meta_lock.mutable_data()->pb.set_state(SysTabletsEntryPB::RUNNING);
+    meta_lock.Commit();
+  }
+  const int64_t version = tablet->metadata().version();
+  ASSERT_GT(version, initial_version);
+
+  auto locs = std::make_shared<TabletLocationsPB>();
+  locs->set_tablet_id(tablet->tablet_id());
+  tablet->SetCachedLocations(version, 0, locs);
+  ASSERT_EQ(locs, tablet->GetCachedLocations(version, 0));
+
+  // A tablet server registered.
+  ASSERT_FALSE(tablet->GetCachedLocations(version, 1));
+
+  // The tablet's metadata changed.
+  {
+    TabletMetadataLock meta_lock(tablet.get(), TabletMetadataLock::WRITE);
+    meta_lock.mutable_data()->pb.set_state_msg("changed");
+    meta_lock.Commit();
+  }
+  ASSERT_FALSE(tablet->GetCachedLocations(tablet->metadata().version(), 0));
+}
+
 TEST(TestTSDescriptor, TestReplicaCreationsDecay) {
   TSDescriptor ts("test");
   ASSERT_EQ(0, ts.RecentReplicaCreations());
@@ -81,6 +81,7 @@
 #include "kudu/master/ts_manager.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/security/cert.h"
 #include "kudu/security/crypto.h"
 #include "kudu/security/tls_context.h"
@@ -91,6 +92,7 @@
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/random_util.h"
@@ -154,10 +156,22 @@ DEFINE_int32(catalog_manager_bg_task_wait_ms, 1000,
              "between runs");
 TAG_FLAG(catalog_manager_bg_task_wait_ms, hidden);
 
+DEFINE_int32(catalog_manager_load_threads, 8,
+             "Number of threads which load the tables and tablets from the system "
+             "catalog when the master becomes the leader. Each thread scans and "
+             "decodes a range of the table and tablet IDs.");
+TAG_FLAG(catalog_manager_load_threads, advanced);
+
 DEFINE_int32(max_create_tablets_per_ts, 20,
              "The number of tablets per TS that can be requested for a new table.");
 TAG_FLAG(max_create_tablets_per_ts, advanced);
 
+DEFINE_int32(catalog_manager_create_tablets_batch_size, 64,
+             "The maximum number of tablet replicas the master asks a tablet server "
+             "to create with a single CreateTablets RPC when creating tables. If 1 "
+             "or less, a CreateTablet RPC is sent per replica.");
+TAG_FLAG(catalog_manager_create_tablets_batch_size, advanced);
+
 DEFINE_int32(master_failover_catchup_timeout_ms, 30 * 1000, // 30 sec
              "Amount of time to give a newly-elected leader master to load"
              " the previous master's metadata and become active. If this time"
@@ -187,6 +201,14 @@ DEFINE_int32(table_locations_ttl_ms, 5 * 60 * 1000, // 5 minutes
              "until after waiting for the ttl period.");
 TAG_FLAG(table_locations_ttl_ms, advanced);
 
+DEFINE_double(replica_placement_load_weight, 1.0,
+              "The weight given to the load statistics reported by tablet servers "
+              "(on-disk size, MemRowSet memory, WAL write rate and scan rate) when "
+              "placing new tablet replicas, relative to the number of replicas on "
+              "each server. 0 places replicas by replica count only.");
+TAG_FLAG(replica_placement_load_weight, advanced);
+TAG_FLAG(replica_placement_load_weight, runtime);
+
 DEFINE_bool(catalog_manager_fail_ts_rpcs, false,
             "Whether all master->TS async calls should fail. Only for testing!");
 TAG_FLAG(catalog_manager_fail_ts_rpcs, hidden);
@@ -200,6 +222,52 @@ DEFINE_bool(catalog_manager_delete_orphaned_tablets, false,
             "master failures!");
 TAG_FLAG(catalog_manager_delete_orphaned_tablets, advanced);
 
+DEFINE_int32(catalog_manager_follower_refresh_interval_ms, 0,
+             "Interval at which follower masters reload their copy of the catalog "
+             "from their replica of the sys catalog, so that they may answer "
+             "metadata reads from clients which accept stale results. 0 disables "
+             "follower reads.");
+TAG_FLAG(catalog_manager_follower_refresh_interval_ms, experimental);
+TAG_FLAG(catalog_manager_follower_refresh_interval_ms, runtime);
+
+DEFINE_bool(catalog_manager_rebalance_leaders, false,
+            "Whether the leader master should periodically ask tablet servers "
+            "leading more than their share of a table's tablets to step down, "
+            "so that leadership spreads evenly across the tablet servers.");
+TAG_FLAG(catalog_manager_rebalance_leaders, experimental);
+TAG_FLAG(catalog_manager_rebalance_leaders, runtime);
+
+DEFINE_int32(leader_rebalance_interval_ms, 60 * 1000,
+             "Interval at which the leader master looks for tablet leaders to "
+             "rebalance, when --catalog_manager_rebalance_leaders is set. Should "
+             "be long enough for the new leaders to be reported.");
+TAG_FLAG(leader_rebalance_interval_ms, experimental);
+TAG_FLAG(leader_rebalance_interval_ms, runtime);
+
+DEFINE_int32(leader_rebalance_max_step_downs, 10,
+             "Maximum number of leaders asked to step down per leader rebalancing "
+             "round, across all tables.");
+TAG_FLAG(leader_rebalance_max_step_downs, experimental);
+TAG_FLAG(leader_rebalance_max_step_downs, runtime);
+
+DEFINE_int32(leader_rebalance_tolerance, 1,
+             "Number of leaders of a table a tablet server may have above its even "
+             "share before some of them are asked to step down.");
+TAG_FLAG(leader_rebalance_tolerance, experimental);
+TAG_FLAG(leader_rebalance_tolerance, runtime);
+
+METRIC_DEFINE_counter(server, leader_rebalance_step_downs,
+                      "Leader Rebalancing Step Downs",
+                      kudu::MetricUnit::kTablets,
+                      "Number of tablet leaders asked to step down by the leader master "
+                      "to spread leadership evenly across the tablet servers.");
+METRIC_DEFINE_gauge_int64(server, leader_rebalance_excess_leaders,
+                          "Leader Rebalancing Excess Leaders",
+                          kudu::MetricUnit::kTablets,
+                          "Number of tablet leaders above the even share of their tablet "
+                          "server, summed across tables, as of the last leader rebalancing "
+                          "round.");
+
 using std::pair;
 using std::set;
 using std::shared_ptr;
@@ -236,6 +304,21 @@ using tablet::TabletPeer;
 using tablet::TabletStatePB;
 using tserver::TabletServerErrorPB;
 
+////////////////////////////////////////////////////////////
+// MetadataLockWaitTimer
+////////////////////////////////////////////////////////////
+
+MetadataLockWaitTimer::MetadataLockWaitTimer()
+    : trace_(Trace::CurrentTrace()),
+      start_micros_(trace_ ? GetMonoTimeMicros() : 0) {
+}
+
+void MetadataLockWaitTimer::StopWaitTimer() {
+  if (trace_) {
+    trace_->metrics()->Increment("metadata_lock_wait_us", GetMonoTimeMicros() - start_micros_);
+  }
+}
+
 ////////////////////////////////////////////////////////////
 // Table Loader
 ////////////////////////////////////////////////////////////
@@ -246,20 +329,23 @@ class TableLoader : public TableVisitor {
     : catalog_manager_(catalog_manager) {
   }
 
+  // May be called concurrently for different tables.
   virtual Status VisitTable(const std::string& table_id,
                             const SysTablesEntryPB& metadata) OVERRIDE {
-    CHECK(!ContainsKey(catalog_manager_->table_ids_map_, table_id))
-          << "Table already exists: " << table_id;
-
     // Set up the table info.
     TableInfo *table = new TableInfo(table_id);
     TableMetadataLock l(table, TableMetadataLock::WRITE);
     l.mutable_data()->pb.CopyFrom(metadata);
 
     // Add the tablet to the IDs map and to the name map (if the table is not deleted).
-    catalog_manager_->table_ids_map_[table->id()] = table;
-    if (!l.data().is_deleted()) {
-      catalog_manager_->table_names_map_[l.data().name()] = table;
+    {
+      std::lock_guard<simple_spinlock> maps_lock(lock_);
+      CHECK(!ContainsKey(catalog_manager_->table_ids_map_, table_id))
+            << "Table already exists: " << table_id;
+      catalog_manager_->table_ids_map_[table->id()] = table;
+      if (!l.data().is_deleted()) {
+        catalog_manager_->table_names_map_[l.data().name()] = table;
+      }
     }
     l.Commit();
 
@@ -272,6 +358,9 @@ class TableLoader : public TableVisitor {
  private:
   CatalogManager *catalog_manager_;
 
+  // Protects the catalog manager's table maps against concurrent visits.
+  simple_spinlock lock_;
+
   DISALLOW_COPY_AND_ASSIGN(TableLoader);
 };
 
@@ -285,6 +374,8 @@ class TabletLoader : public TabletVisitor {
     : catalog_manager_(catalog_manager) {
   }
 
+  // May be called concurrently for different tablets. The tables are all
+  // loaded before, so the table map isn't modified anymore.
   virtual Status VisitTablet(const std::string& table_id,
                              const std::string& tablet_id,
                              const SysTabletsEntryPB& metadata) OVERRIDE {
@@ -305,7 +396,10 @@ class TabletLoader : public TabletVisitor {
     l.mutable_data()->pb.CopyFrom(metadata);
 
     // Add the tablet to the tablet manager.
-    catalog_manager_->tablet_map_[tablet->tablet_id()] = tablet;
+    {
+      std::lock_guard<simple_spinlock> map_lock(lock_);
+      catalog_manager_->tablet_map_[tablet->tablet_id()] = tablet;
+    }
 
     // Add the tablet to the Tablet.
     bool is_deleted = l.mutable_data()->is_deleted();
@@ -323,6 +417,9 @@ class TabletLoader : public TabletVisitor {
  private:
   CatalogManager *catalog_manager_;
 
+  // Protects the catalog manager's tablet map against concurrent visits.
+  simple_spinlock lock_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletLoader);
 };
 
@@ -441,6 +538,7 @@ void CatalogManagerBgTasks::Shutdown() {
 
 void CatalogManagerBgTasks::Run() {
   while (!NoBarrier_Load(&closing_)) {
+    bool is_follower = false;
     {
       CatalogManager::ScopedLeaderSharedLock l(catalog_manager_);
       if (!l.catalog_status().ok()) {
@@ -478,8 +576,17 @@ void CatalogManagerBgTasks::Run() {
                 "aborting the current task: " << s.ToString();
           }
         }
+
+        // Spread tablet leadership evenly, if it's time to.
+        catalog_manager_->RebalanceLeaders();
+      } else {
+        is_follower = l.leader_status().IsIllegalState();
       }
     }
+    if (is_follower) {
+      // Reloading the catalog requires the leader lock for writing.
+      catalog_manager_->RefreshFollowerCatalog();
+    }
     // Wait for a notification or a timeout expiration.
     //  - CreateTable will call Wake() to notify about the tablets to add
     //  - HandleReportedTablet/ProcessPendingAssignments will call WakeIfHasPendingUpdates()
@@ -675,6 +782,10 @@ CatalogManager::CatalogManager(Master *master)
            // closely timed consecutive elections).
            .set_max_threads(1)
            .Build(&leader_election_pool_));
+  leader_rebalance_step_downs_ =
+      METRIC_leader_rebalance_step_downs.Instantiate(master_->metric_entity());
+  leader_rebalance_excess_leaders_ =
+      METRIC_leader_rebalance_excess_leaders.Instantiate(master_->metric_entity(), 0);
 }
 
 CatalogManager::~CatalogManager() {
@@ -844,6 +955,7 @@ void CatalogManager::VisitTablesAndTabletsTask() {
                        "Loading metadata into memory") {
       CHECK_OK(VisitTablesAndTabletsUnlocked());
     }
+    follower_catalog_load_time_ = MonoTime();
 
     // TODO(PKI): this should not be done in case of external PKI.
     // TODO(PKI): should be there a flag to reset already existing CA info?
@@ -936,14 +1048,52 @@ Status CatalogManager::VisitTablesAndTabletsUnlocked() {
 
   // Visit tables and tablets, load them into memory.
   TableLoader table_loader(this);
-  RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTables(&table_loader),
+  RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTables(&table_loader,
+                                                  FLAGS_catalog_manager_load_threads),
                         "Failed while visiting tables in sys catalog");
   TabletLoader tablet_loader(this);
-  RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTablets(&tablet_loader),
+  RETURN_NOT_OK_PREPEND(sys_catalog_->VisitTablets(&tablet_loader,
+                                                   FLAGS_catalog_manager_load_threads),
                         "Failed while visiting tablets in sys catalog");
   return Status::OK();
 }
 
+void CatalogManager::RefreshFollowerCatalog() {
+  if (FLAGS_catalog_manager_follower_refresh_interval_ms <= 0) {
+    return;
+  }
+  MonoTime now = MonoTime::Now();
+  {
+    shared_lock<RWMutex> l(leader_lock_);
+    if (follower_catalog_load_time_.Initialized() &&
+        now - follower_catalog_load_time_ < MonoDelta::FromMilliseconds(
+            FLAGS_catalog_manager_follower_refresh_interval_ms)) {
+      return;
+    }
+  }
+
+  // Block catalog reads while the maps are reloaded.
+  std::lock_guard<RWMutex> leader_lock_guard(leader_lock_);
+
+  // Once elected, it's up to VisitTablesAndTabletsTask() to load the catalog,
+  // which it does after waiting for the catalog to be caught up.
+  if (sys_catalog_->tablet_peer()->consensus()->role() == RaftPeerPB::LEADER) {
+    return;
+  }
+  Status s;
+  LOG_SLOW_EXECUTION(WARNING, 1000, LogPrefix() +
+                     "Reloading follower metadata into memory") {
+    s = VisitTablesAndTabletsUnlocked();
+  }
+  if (!s.ok()) {
+    LOG(WARNING) << LogPrefix() << "Failed to reload follower metadata: " << s.ToString();
+    follower_catalog_load_time_ = MonoTime();
+    return;
+  }
+  // The catalog is at least as fresh as it was when the reload started.
+  follower_catalog_load_time_ = now;
+}
+
 // This method is called by tests only.
 Status CatalogManager::VisitTablesAndTablets() {
   // Block new catalog operations, and wait for existing operations to finish.
@@ -1538,6 +1688,7 @@ Status CatalogManager::ApplyAlterSchemaSteps(const SysTablesEntryPB& current_pb,
                                          SecureShortDebugString(new_col_pb));
         }
         RETURN_NOT_OK(ProcessColumnPBDefaults(&new_col_pb));
+        RETURN_NOT_OK(ValidateColumnTypeAttributes(new_col_pb));
 
         // Can't accept a NOT NULL column without a default.
         ColumnSchema new_col = ColumnSchemaFromPB(new_col_pb);
@@ -2082,13 +2233,22 @@ Status CatalogManager::GetTableSchema(const GetTableSchemaRequestPB* req,
     // schema that has reached every TS.
     CHECK_EQ(SysTablesEntryPB::ALTERING, l.data().pb.state());
     resp->mutable_schema()->CopyFrom(l.data().pb.fully_applied_schema());
+    resp->mutable_partition_schema()->CopyFrom(l.data().pb.partition_schema());
   } else {
-    // There's no AlterTable, the regular schema is "fully applied".
-    resp->mutable_schema()->CopyFrom(l.data().pb.schema());
+    // There's no AlterTable, the regular schema is "fully applied", and its
+    // version identifies it: the client's cached copy may still be current.
+    uint32_t version = l.data().pb.version();
+    resp->set_schema_version(version);
+    if (req->has_cached_table_id() && req->cached_table_id() == table->id() &&
+        req->has_cached_schema_version() && req->cached_schema_version() == version) {
+      resp->set_schema_not_modified(true);
+    } else {
+      resp->mutable_schema()->CopyFrom(l.data().pb.schema());
+      resp->mutable_partition_schema()->CopyFrom(l.data().pb.partition_schema());
+    }
   }
   resp->set_num_replicas(l.data().pb.num_replicas());
   resp->set_table_id(table->id());
-  resp->mutable_partition_schema()->CopyFrom(l.data().pb.partition_schema());
   resp->set_create_table_done(!table->IsCreateInProgress());
   resp->set_table_name(l.data().pb.name());
 
@@ -2159,6 +2319,15 @@ void CatalogManager::NotifyTabletDeleteSuccess(const string& permanent_uuid,
   // tablet.
 }
 
+// The tablet mutations and follow-up tasks which result from a tablet report.
+// They're deferred until all of the reported tablets have been handled, so
+// that the mutations are persisted with a single write to the sys catalog.
+struct DeferredReportActions {
+  vector<TabletInfo*> tablets_to_update;
+  vector<scoped_refptr<TabletInfo>> needs_alter;
+  vector<pair<scoped_refptr<TabletInfo>, uint32_t>> schema_versions;
+};
+
 Status CatalogManager::ProcessTabletReport(TSDescriptor* ts_desc,
                                            const TabletReportPB& report,
                                            TabletReportUpdatesPB *report_update,
@@ -2178,12 +2347,87 @@ Status CatalogManager::ProcessTabletReport(TSDescriptor* ts_desc,
   // the server should have, compare vs the ones being reported, and somehow mark
   // any that have been "lost" (eg somehow the tablet metadata got corrupted or something).
 
-  for (const ReportedTabletPB& reported : report.updated_tablets()) {
-    ReportedTabletUpdatesPB *tablet_report = report_update->add_tablets();
-    tablet_report->set_tablet_id(reported.tablet_id());
-    RETURN_NOT_OK_PREPEND(HandleReportedTablet(ts_desc, reported, tablet_report),
-                          Substitute("Error handling $0", SecureShortDebugString(reported)));
+  // Look up all of the reported tablets at once, and handle them in tablet ID
+  // order so that their write locks may be held at the same time (see the
+  // locking rules at the top of the file).
+  vector<pair<scoped_refptr<TabletInfo>, int>> tablets;
+  vector<const ReportedTabletPB*> unknown_tablets;
+  {
+    shared_lock<LockType> l(lock_);
+    for (int i = 0; i < report.updated_tablets_size(); i++) {
+      const ReportedTabletPB& reported = report.updated_tablets(i);
+      ReportedTabletUpdatesPB* tablet_report = report_update->add_tablets();
+      tablet_report->set_tablet_id(reported.tablet_id());
+      scoped_refptr<TabletInfo> tablet = FindPtrOrNull(tablet_map_, reported.tablet_id());
+      if (tablet) {
+        tablets.emplace_back(std::move(tablet), i);
+      } else {
+        unknown_tablets.push_back(&reported);
+      }
+    }
+  }
+  for (const ReportedTabletPB* reported : unknown_tablets) {
+    HandleUnknownReportedTablet(ts_desc, *reported);
+  }
+  std::sort(tablets.begin(), tablets.end(),
+            [](const pair<scoped_refptr<TabletInfo>, int>& left,
+               const pair<scoped_refptr<TabletInfo>, int>& right) {
+              return left.first->tablet_id() < right.first->tablet_id();
+            });
+
+  // The write locks of the tablets mutated by the report are held until the
+  // mutations of the whole report are persisted with a single write to the
+  // sys catalog. The locks of the unmodified tablets are released right away.
+  DeferredReportActions deferred;
+  vector<unique_ptr<TabletMetadataLock>> tablet_locks;
+  Status s;
+  for (const auto& tablet_and_idx : tablets) {
+    const scoped_refptr<TabletInfo>& tablet = tablet_and_idx.first;
+    const ReportedTabletPB& reported = report.updated_tablets(tablet_and_idx.second);
+    DCHECK(tablet->table()); // guaranteed by TabletLoader
+
+    TableMetadataLock table_lock(tablet->table().get(), TableMetadataLock::READ);
+    unique_ptr<TabletMetadataLock> tablet_lock(
+        new TabletMetadataLock(tablet.get(), TabletMetadataLock::WRITE));
+    size_t num_updated = deferred.tablets_to_update.size();
+    s = HandleReportedTablet(ts_desc, reported, tablet, &table_lock, tablet_lock.get(),
+                             report_update->mutable_tablets(tablet_and_idx.second),
+                             &deferred);
+    if (PREDICT_FALSE(!s.ok())) {
+      s = s.CloneAndPrepend(Substitute("Error handling $0", SecureShortDebugString(reported)));
+      break;
+    }
+    if (deferred.tablets_to_update.size() > num_updated) {
+      tablet_locks.emplace_back(std::move(tablet_lock));
+    }
+  }
+
+  // Persist the mutations of the tablets handled so far, even if handling one
+  // of the reported tablets failed.
+  if (!deferred.tablets_to_update.empty()) {
+    SysCatalogTable::Actions actions;
+    actions.tablets_to_update = deferred.tablets_to_update;
+    Status write_status = sys_catalog_->Write(actions);
+    if (!write_status.ok()) {
+      LOG(WARNING) << "Error updating tablets: " << write_status.ToString()
+                   << ". Tablet report was: " << SecureShortDebugString(report);
+      return write_status;
+    }
+    for (const auto& tablet_lock : tablet_locks) {
+      tablet_lock->Commit();
+    }
+  }
+
+  // Need to defer the AlterTable commands to after we've committed the new
+  // tablet data, since the tablet report may also be updating the raft config,
+  // and the AlterTable request needs to know who the most recent leader is.
+  for (const auto& tablet : deferred.needs_alter) {
+    SendAlterTabletRequest(tablet);
+  }
+  for (const auto& tablet_and_version : deferred.schema_versions) {
+    HandleTabletSchemaVersionReport(tablet_and_version.first.get(), tablet_and_version.second);
   }
+  RETURN_NOT_OK(s);
 
   if (report.updated_tablets_size() > 0) {
     background_tasks_->WakeIfHasPendingUpdates();
@@ -2210,51 +2454,46 @@ bool ShouldTransitionTabletToRunning(const ReportedTabletPB& report) {
 }
 } // anonymous namespace
 
+void CatalogManager::HandleUnknownReportedTablet(TSDescriptor* ts_desc,
+                                                 const ReportedTabletPB& report) {
+  // It'd be unsafe to ask the tserver to delete this tablet without first
+  // replicating something to our followers (i.e. to guarantee that we're the
+  // leader). For example, if we were a rogue master, we might be deleting a
+  // tablet created by a new master accidentally. But masters retain metadata
+  // for deleted tablets forever, so a tablet can only be truly unknown in
+  // the event of a serious misconfiguration, such as a tserver heartbeating
+  // to the wrong cluster. Therefore, it should be reasonable to ignore it
+  // and wait for an operator fix the situation.
+  if (FLAGS_catalog_manager_delete_orphaned_tablets) {
+    LOG(INFO) << "Deleting unknown tablet " << report.tablet_id();
+    SendDeleteReplicaRequest(report.tablet_id(), TABLET_DATA_DELETED,
+                             boost::none, nullptr, ts_desc->permanent_uuid(),
+                             "Report from unknown tablet");
+  } else {
+    LOG(WARNING) << "Ignoring report from unknown tablet: "
+                 << report.tablet_id();
+  }
+}
+
 Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
                                             const ReportedTabletPB& report,
-                                            ReportedTabletUpdatesPB *report_updates) {
+                                            const scoped_refptr<TabletInfo>& tablet,
+                                            TableMetadataLock* table_lock,
+                                            TabletMetadataLock* tablet_lock,
+                                            ReportedTabletUpdatesPB* report_updates,
+                                            DeferredReportActions* deferred) {
   TRACE_EVENT1("master", "HandleReportedTablet",
                "tablet_id", report.tablet_id());
-  scoped_refptr<TabletInfo> tablet;
-  {
-    shared_lock<LockType> l(lock_);
-    tablet = FindPtrOrNull(tablet_map_, report.tablet_id());
-  }
-  if (!tablet) {
-    // It'd be unsafe to ask the tserver to delete this tablet without first
-    // replicating something to our followers (i.e. to guarantee that we're the
-    // leader). For example, if we were a rogue master, we might be deleting a
-    // tablet created by a new master accidentally. But masters retain metadata
-    // for deleted tablets forever, so a tablet can only be truly unknown in
-    // the event of a serious misconfiguration, such as a tserver heartbeating
-    // to the wrong cluster. Therefore, it should be reasonable to ignore it
-    // and wait for an operator fix the situation.
-    if (FLAGS_catalog_manager_delete_orphaned_tablets) {
-      LOG(INFO) << "Deleting unknown tablet " << report.tablet_id();
-      SendDeleteReplicaRequest(report.tablet_id(), TABLET_DATA_DELETED,
-                               boost::none, nullptr, ts_desc->permanent_uuid(),
-                               "Report from unknown tablet");
-    } else {
-      LOG(WARNING) << "Ignoring report from unknown tablet: "
-                   << report.tablet_id();
-    }
-    return Status::OK();
-  }
-  DCHECK(tablet->table()); // guaranteed by TabletLoader
+  DCHECK(tablet_lock->is_write_locked());
 
   VLOG(3) << "tablet report: " << SecureShortDebugString(report);
 
-  // TODO: we don't actually need to do the COW here until we see we're going
-  // to change the state. Can we change CowedObject to lazily do the copy?
-  TableMetadataLock table_lock(tablet->table().get(), TableMetadataLock::READ);
-  TabletMetadataLock tablet_lock(tablet.get(), TabletMetadataLock::WRITE);
-
   // If the TS is reporting a tablet which has been deleted, or a tablet from
   // a table which has been deleted, send it an RPC to delete it.
-  if (tablet_lock.data().is_deleted() ||
-      table_lock.data().is_deleted()) {
-    report_updates->set_state_msg(tablet_lock.data().pb.state_msg());
-    const string msg = tablet_lock.data().pb.state_msg();
+  if (tablet_lock->data().is_deleted() ||
+      table_lock->data().is_deleted()) {
+    report_updates->set_state_msg(tablet_lock->data().pb.state_msg());
+    const string msg = tablet_lock->data().pb.state_msg();
     LOG(INFO) << "Got report from deleted tablet " << tablet->ToString()
               << " (" << msg << "): Sending delete request for this tablet";
     // TODO: Cancel tablet creation, instead of deleting, in cases where
@@ -2265,29 +2504,30 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
     return Status::OK();
   }
 
-  if (!table_lock.data().is_running()) {
+  if (!table_lock->data().is_running()) {
     LOG(INFO) << "Got report from tablet " << tablet->tablet_id()
               << " for non-running table " << tablet->table()->ToString() << ": "
-              << tablet_lock.data().pb.state_msg();
-    report_updates->set_state_msg(tablet_lock.data().pb.state_msg());
+              << tablet_lock->data().pb.state_msg();
+    report_updates->set_state_msg(tablet_lock->data().pb.state_msg());
     return Status::OK();
   }
 
   // Check if the tablet requires an "alter table" call
+  bool tablet_updated = false;
   bool tablet_needs_alter = false;
   if (report.has_schema_version() &&
-      table_lock.data().pb.version() != report.schema_version()) {
-    if (report.schema_version() > table_lock.data().pb.version()) {
+      table_lock->data().pb.version() != report.schema_version()) {
+    if (report.schema_version() > table_lock->data().pb.version()) {
       LOG(ERROR) << "TS " << ts_desc->ToString()
                  << " has reported a schema version greater than the current one "
                  << " for tablet " << tablet->ToString()
-                 << ". Expected version " << table_lock.data().pb.version()
+                 << ". Expected version " << table_lock->data().pb.version()
                  << " got " << report.schema_version()
                  << " (corruption)";
     } else {
       LOG(INFO) << "TS " << ts_desc->ToString()
             << " does not have the latest schema for tablet " << tablet->ToString()
-            << ". Expected version " << table_lock.data().pb.version()
+            << ". Expected version " << table_lock->data().pb.version()
             << " got " << report.schema_version();
     }
     // It's possible that the tablet being reported is a laggy replica, and in fact
@@ -2309,7 +2549,7 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
   // The report will not have a committed_consensus_state if it is in the
   // middle of starting up, such as during tablet bootstrap.
   if (report.has_committed_consensus_state()) {
-    const ConsensusStatePB& prev_cstate = tablet_lock.data().pb.committed_consensus_state();
+    const ConsensusStatePB& prev_cstate = tablet_lock->data().pb.committed_consensus_state();
     ConsensusStatePB cstate = report.committed_consensus_state();
 
     // Check if we got a report from a tablet that is no longer part of the raft
@@ -2337,16 +2577,15 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
     // could incorrectly consider a tablet created when only a minority of its replicas
     // were successful. In that case, the tablet would be stuck in this bad state
     // forever.
-    if (!tablet_lock.data().is_running() && ShouldTransitionTabletToRunning(report)) {
-      DCHECK_EQ(SysTabletsEntryPB::CREATING, tablet_lock.data().pb.state())
+    if (!tablet_lock->data().is_running() && ShouldTransitionTabletToRunning(report)) {
+      DCHECK_EQ(SysTabletsEntryPB::CREATING, tablet_lock->data().pb.state())
           << "Tablet in unexpected state: " << tablet->ToString()
-          << ": " << SecureShortDebugString(tablet_lock.data().pb);
+          << ": " << SecureShortDebugString(tablet_lock->data().pb);
       // Mark the tablet as running
-      // TODO: we could batch the IO onto a background thread, or at least
-      // across multiple tablets in the same report.
       VLOG(1) << "Tablet " << tablet->ToString() << " is now online";
-      tablet_lock.mutable_data()->set_state(SysTabletsEntryPB::RUNNING,
+      tablet_lock->mutable_data()->set_state(SysTabletsEntryPB::RUNNING,
                                             "Tablet reported with an active leader");
+      tablet_updated = true;
     }
 
     // The Master only accepts committed consensus configurations since it needs the committed index
@@ -2410,31 +2649,21 @@ Status CatalogManager::HandleReportedTablet(TSDescriptor* ts_desc,
               << final_report->committed_consensus_state().current_term();
 
       RETURN_NOT_OK(HandleRaftConfigChanged(*final_report, tablet,
-                                            &tablet_lock, &table_lock));
-
+                                            tablet_lock, table_lock));
+      tablet_updated = true;
     }
   }
 
-  table_lock.Unlock();
-  // We update the tablets each time that someone reports it.
-  // This shouldn't be very frequent and should only happen when something in fact changed.
-  SysCatalogTable::Actions actions;
-  actions.tablets_to_update.push_back(tablet.get());
-  Status s = sys_catalog_->Write(actions);
-  if (!s.ok()) {
-    LOG(WARNING) << "Error updating tablets: " << s.ToString() << ". Tablet report was: "
-                 << SecureShortDebugString(report);
-    return s;
+  // The tablet is only written to the sys catalog if something in fact
+  // changed; the write is done by the caller, along with those of the other
+  // tablets in the same report.
+  if (tablet_updated) {
+    deferred->tablets_to_update.push_back(tablet.get());
   }
-  tablet_lock.Commit();
-
-  // Need to defer the AlterTable command to after we've committed the new tablet data,
-  // since the tablet report may also be updating the raft config, and the Alter Table
-  // request needs to know who the most recent leader is.
   if (tablet_needs_alter) {
-    SendAlterTabletRequest(tablet);
+    deferred->needs_alter.push_back(tablet);
   } else if (report.has_schema_version()) {
-    HandleTabletSchemaVersionReport(tablet.get(), report.schema_version());
+    deferred->schema_versions.emplace_back(tablet, report.schema_version());
   }
 
   return Status::OK();
@@ -2812,6 +3041,29 @@ class RetrySpecificTSRpcTask : public RetryingTSRpcTask {
   const string permanent_uuid_;
 };
 
+namespace {
+
+// Fills 'req' with the request to create a replica of 'tablet' on the tablet
+// server with UUID 'permanent_uuid'.
+void FillCreateTabletRequest(const string& permanent_uuid,
+                             const TabletInfo& tablet,
+                             const TabletMetadataLock& tablet_lock,
+                             const TableMetadataLock& table_lock,
+                             tserver::CreateTabletRequestPB* req) {
+  req->set_dest_uuid(permanent_uuid);
+  req->set_table_id(tablet.table()->id());
+  req->set_tablet_id(tablet.tablet_id());
+  req->mutable_partition()->CopyFrom(tablet_lock.data().pb.partition());
+  req->set_table_name(table_lock.data().pb.name());
+  req->mutable_schema()->CopyFrom(table_lock.data().pb.schema());
+  req->mutable_partition_schema()->CopyFrom(
+      table_lock.data().pb.partition_schema());
+  req->mutable_config()->CopyFrom(
+      tablet_lock.data().pb.committed_consensus_state().config());
+}
+
+} // anonymous namespace
+
 // Fire off the async create tablet.
 // This requires that the new tablet info is locked for write, and the
 // consensus configuration information has been filled into the 'dirty' data.
@@ -2828,16 +3080,17 @@ class AsyncCreateReplica : public RetrySpecificTSRpcTask {
     deadline_ = start_ts_ + MonoDelta::FromMilliseconds(FLAGS_tablet_creation_timeout_ms);
 
     TableMetadataLock table_lock(tablet->table().get(), TableMetadataLock::READ);
-    req_.set_dest_uuid(permanent_uuid);
-    req_.set_table_id(tablet->table()->id());
-    req_.set_tablet_id(tablet->tablet_id());
-    req_.mutable_partition()->CopyFrom(tablet_lock.data().pb.partition());
-    req_.set_table_name(table_lock.data().pb.name());
-    req_.mutable_schema()->CopyFrom(table_lock.data().pb.schema());
-    req_.mutable_partition_schema()->CopyFrom(
-        table_lock.data().pb.partition_schema());
-    req_.mutable_config()->CopyFrom(
-        tablet_lock.data().pb.committed_consensus_state().config());
+    FillCreateTabletRequest(permanent_uuid, *tablet, tablet_lock, table_lock, &req_);
+  }
+
+  // Sends the already filled 'req'.
+  AsyncCreateReplica(Master *master,
+                     const scoped_refptr<TableInfo>& table,
+                     tserver::CreateTabletRequestPB req)
+    : RetrySpecificTSRpcTask(master, req.dest_uuid(), table),
+      tablet_id_(req.tablet_id()),
+      req_(std::move(req)) {
+    deadline_ = start_ts_ + MonoDelta::FromMilliseconds(FLAGS_tablet_creation_timeout_ms);
   }
 
   virtual string type_name() const OVERRIDE { return "Create Tablet"; }
@@ -2882,6 +3135,118 @@ class AsyncCreateReplica : public RetrySpecificTSRpcTask {
   tserver::CreateTabletResponsePB resp_;
 };
 
+// Send a CreateTablets() RPC request, creating replicas of several tablets of
+// the same table on one tablet server. On retries, only the replicas which
+// failed to be created are sent again.
+//
+// Tablet servers which don't support the RPC are sent a CreateTablet() RPC
+// per replica instead.
+class AsyncCreateReplicas : public RetrySpecificTSRpcTask {
+ public:
+  // The tablets need not be locked when making this call.
+  AsyncCreateReplicas(Master *master,
+                      const string& permanent_uuid,
+                      const scoped_refptr<TableInfo>& table,
+                      const vector<scoped_refptr<TabletInfo>>& tablets)
+    : RetrySpecificTSRpcTask(master, permanent_uuid, table) {
+    deadline_ = start_ts_ + MonoDelta::FromMilliseconds(FLAGS_tablet_creation_timeout_ms);
+
+    req_.set_dest_uuid(permanent_uuid);
+    TableMetadataLock table_lock(table.get(), TableMetadataLock::READ);
+    for (const auto& tablet : tablets) {
+      TabletMetadataLock tablet_lock(tablet.get(), TabletMetadataLock::READ);
+      FillCreateTabletRequest(permanent_uuid, *tablet, tablet_lock, table_lock,
+                              req_.add_tablets());
+    }
+  }
+
+  virtual string type_name() const OVERRIDE { return "Create Tablets"; }
+
+  virtual string description() const OVERRIDE {
+    return Substitute("CreateTablets RPC for $0 tablets of table $1 on TS $2",
+                      req_.tablets_size(), table_->ToString(), permanent_uuid_);
+  }
+
+ protected:
+  virtual string tablet_id() const OVERRIDE {
+    if (req_.tablets_size() == 0) {
+      return "";
+    }
+    return Substitute("$0 (and $1 others)", req_.tablets(0).tablet_id(),
+                      req_.tablets_size() - 1);
+  }
+
+  virtual void HandleResponse(int attempt) OVERRIDE {
+    if (resp_.has_error()) {
+      LOG(WARNING) << "CreateTablets RPC on TS " << target_ts_desc_->ToString() << " failed: "
+                   << StatusFromPB(resp_.error().status()).ToString();
+      return;
+    }
+    if (resp_.tablets_size() != req_.tablets_size()) {
+      LOG(WARNING) << "CreateTablets RPC on TS " << target_ts_desc_->ToString() << " returned "
+                   << resp_.tablets_size() << " results for " << req_.tablets_size()
+                   << " tablets";
+      return;
+    }
+
+    // Keep only the tablets which failed to be created, to retry them.
+    tserver::CreateTabletsRequestPB retry_req;
+    retry_req.set_dest_uuid(req_.dest_uuid());
+    for (int i = 0; i < req_.tablets_size(); i++) {
+      const tserver::CreateTabletResponsePB& tablet_resp = resp_.tablets(i);
+      if (!tablet_resp.has_error()) {
+        continue;
+      }
+      const string& tablet_id = req_.tablets(i).tablet_id();
+      Status s = StatusFromPB(tablet_resp.error().status());
+      if (s.IsAlreadyPresent()) {
+        LOG(INFO) << "CreateTablets RPC for tablet " << tablet_id
+                  << " on TS " << target_ts_desc_->ToString() << " returned already present: "
+                  << s.ToString();
+        continue;
+      }
+      LOG(WARNING) << "CreateTablets RPC for tablet " << tablet_id
+                   << " on TS " << target_ts_desc_->ToString() << " failed: " << s.ToString();
+      retry_req.add_tablets()->Swap(req_.mutable_tablets(i));
+    }
+    if (retry_req.tablets_size() == 0) {
+      MarkComplete();
+    } else {
+      req_.Swap(&retry_req);
+    }
+  }
+
+  virtual bool SendRequest(int attempt) OVERRIDE {
+    VLOG(1) << "Send create tablets request for " << req_.tablets_size() << " tablets to "
+            << target_ts_desc_->ToString() << " (attempt " << attempt << ")";
+    ts_proxy_->CreateTabletsAsync(req_, &resp_, &rpc_,
+                                  boost::bind(&AsyncCreateReplicas::CreateTabletsCallback, this));
+    return true;
+  }
+
+ private:
+  // Runs on a reactor thread, so should not block or do any IO.
+  void CreateTabletsCallback() {
+    const rpc::ErrorStatusPB* err = rpc_.error_response();
+    if (rpc_.status().IsRemoteError() && err &&
+        err->code() == rpc::ErrorStatusPB::ERROR_NO_SUCH_METHOD &&
+        state() == kStateRunning) {
+      LOG(INFO) << "TS " << target_ts_desc_->ToString() << " doesn't support CreateTablets, "
+                << "creating the replicas of " << req_.tablets_size() << " tablets one by one";
+      for (int i = 0; i < req_.tablets_size(); i++) {
+        auto* task = new AsyncCreateReplica(master_, table_, req_.tablets(i));
+        table_->AddTask(task);
+        WARN_NOT_OK(task->Run(), "Failed to send new tablet request");
+      }
+      MarkComplete();
+    }
+    RpcCallback();
+  }
+
+  tserver::CreateTabletsRequestPB req_;
+  tserver::CreateTabletsResponsePB resp_;
+};
+
 // Send a DeleteTablet() RPC request.
 class AsyncDeleteReplica : public RetrySpecificTSRpcTask {
  public:
@@ -3196,6 +3561,174 @@ void AsyncAddServerTask::HandleResponse(int attempt) {
   }
 }
 
+// Asks the leader replica of a tablet to step down, so that one of the
+// followers takes over leadership. The request is sent once: if the replica
+// isn't the leader anymore, there's nothing left to do.
+class AsyncLeaderStepDownTask : public RetrySpecificTSRpcTask {
+ public:
+  AsyncLeaderStepDownTask(Master* master,
+                          const scoped_refptr<TabletInfo>& tablet,
+                          const string& leader_uuid)
+    : RetrySpecificTSRpcTask(master, leader_uuid, tablet->table()),
+      tablet_(tablet) {
+    deadline_ = start_ts_ + MonoDelta::FromMilliseconds(FLAGS_master_ts_rpc_timeout_ms);
+  }
+
+  virtual string type_name() const OVERRIDE { return "LeaderStepDown"; }
+
+  virtual string description() const OVERRIDE {
+    return Substitute("LeaderStepDown RPC for tablet $0 on TS $1",
+                      tablet_->tablet_id(), permanent_uuid_);
+  }
+
+ protected:
+  virtual bool SendRequest(int attempt) OVERRIDE {
+    req_.set_dest_uuid(permanent_uuid_);
+    req_.set_tablet_id(tablet_->tablet_id());
+    VLOG(1) << "Sending LeaderStepDown request to " << target_ts_desc_->ToString()
+            << " for tablet " << tablet_->tablet_id();
+    consensus_proxy_->LeaderStepDownAsync(
+        req_, &resp_, &rpc_, boost::bind(&AsyncLeaderStepDownTask::RpcCallback, this));
+    return true;
+  }
+
+  virtual void HandleResponse(int attempt) OVERRIDE {
+    if (resp_.has_error()) {
+      LOG_WITH_PREFIX(INFO) << "LeaderStepDown() failed: "
+                            << StatusFromPB(resp_.error().status()).ToString();
+      MarkFailed();
+      return;
+    }
+    MarkComplete();
+  }
+
+ private:
+  virtual string tablet_id() const OVERRIDE { return tablet_->tablet_id(); }
+
+  const scoped_refptr<TabletInfo> tablet_;
+
+  consensus::LeaderStepDownRequestPB req_;
+  consensus::LeaderStepDownResponsePB resp_;
+};
+
+void CatalogManager::SendLeaderStepDownRequest(const scoped_refptr<TabletInfo>& tablet,
+                                               const string& leader_uuid) {
+  auto call = new AsyncLeaderStepDownTask(master_, tablet, leader_uuid);
+  tablet->table()->AddTask(call);
+  WARN_NOT_OK(call->Run(), "Failed to send leader step down request");
+}
+
+void CatalogManager::RebalanceLeaders() {
+  if (!FLAGS_catalog_manager_rebalance_leaders) {
+    return;
+  }
+  MonoTime now = MonoTime::Now();
+  if (last_leader_rebalance_.Initialized() &&
+      now - last_leader_rebalance_ < MonoDelta::FromMilliseconds(
+          FLAGS_leader_rebalance_interval_ms)) {
+    return;
+  }
+  last_leader_rebalance_ = now;
+
+  TSDescriptorVector ts_descs;
+  master_->ts_manager()->GetAllLiveDescriptors(&ts_descs);
+  unordered_set<string> live_uuids;
+  for (const auto& ts_desc : ts_descs) {
+    live_uuids.insert(ts_desc->permanent_uuid());
+  }
+
+  vector<scoped_refptr<TableInfo>> tables;
+  {
+    shared_lock<LockType> l(lock_);
+    AppendValuesFromMap(table_ids_map_, &tables);
+  }
+
+  int step_downs_left = FLAGS_leader_rebalance_max_step_downs;
+  int64_t excess_leaders = 0;
+  for (const auto& table : tables) {
+    {
+      TableMetadataLock l(table.get(), TableMetadataLock::READ);
+      if (!l.data().is_running()) {
+        continue;
+      }
+    }
+
+    // Count the leaders of the table on each live tablet server hosting one
+    // of its voters, and note which servers each leader could move to.
+    struct LeaderInfo {
+      scoped_refptr<TabletInfo> tablet;
+      string leader_uuid;
+      vector<string> follower_uuids;
+    };
+    vector<LeaderInfo> leaders;
+    std::unordered_map<string, int> leader_counts;
+    vector<scoped_refptr<TabletInfo>> tablets;
+    table->GetAllTablets(&tablets);
+    for (const auto& tablet : tablets) {
+      TabletMetadataLock l(tablet.get(), TabletMetadataLock::READ);
+      if (!l.data().is_running()) {
+        continue;
+      }
+      const ConsensusStatePB& cstate = l.data().pb.committed_consensus_state();
+      LeaderInfo info;
+      for (const RaftPeerPB& peer : cstate.config().peers()) {
+        if (peer.member_type() != RaftPeerPB::VOTER ||
+            !ContainsKey(live_uuids, peer.permanent_uuid())) {
+          continue;
+        }
+        leader_counts.insert({ peer.permanent_uuid(), 0 });
+        if (cstate.has_leader_uuid() && peer.permanent_uuid() == cstate.leader_uuid()) {
+          info.leader_uuid = peer.permanent_uuid();
+        } else {
+          info.follower_uuids.push_back(peer.permanent_uuid());
+        }
+      }
+      if (!info.leader_uuid.empty()) {
+        leader_counts[info.leader_uuid]++;
+        info.tablet = tablet;
+        leaders.emplace_back(std::move(info));
+      }
+    }
+    if (leader_counts.size() < 2) {
+      continue;
+    }
+
+    // A server is only relieved of leaders once it's beyond its even share by
+    // more than the tolerance, and only in favor of servers below their even
+    // share, so that leadership doesn't flap between servers.
+    int even_ceil = (leaders.size() + leader_counts.size() - 1) / leader_counts.size();
+    int even_floor = leaders.size() / leader_counts.size();
+    for (const auto& entry : leader_counts) {
+      excess_leaders += std::max(0, entry.second - even_ceil);
+    }
+    for (const auto& info : leaders) {
+      if (step_downs_left == 0) {
+        break;
+      }
+      if (leader_counts[info.leader_uuid] <= even_ceil + FLAGS_leader_rebalance_tolerance) {
+        continue;
+      }
+      for (const string& follower_uuid : info.follower_uuids) {
+        if (leader_counts[follower_uuid] < even_floor) {
+          LOG(INFO) << Substitute("Asking TS $0, which leads $1 of the $2 tablets of table $3, "
+                                  "to step down as leader of tablet $4",
+                                  info.leader_uuid, leader_counts[info.leader_uuid],
+                                  leaders.size(), table->ToString(), info.tablet->tablet_id());
+          SendLeaderStepDownRequest(info.tablet, info.leader_uuid);
+          leader_rebalance_step_downs_->Increment();
+          step_downs_left--;
+          // Any of the followers may be elected, but assume the underloaded
+          // one is, so that it isn't counted on to take over several leaders.
+          leader_counts[info.leader_uuid]--;
+          leader_counts[follower_uuid]++;
+          break;
+        }
+      }
+    }
+  }
+  leader_rebalance_excess_leaders_->set_value(excess_leaders);
+}
+
 void CatalogManager::SendAlterTableRequest(const scoped_refptr<TableInfo>& table) {
   vector<scoped_refptr<TabletInfo> > tablets;
   table->GetAllTablets(&tablets);
@@ -3555,10 +4088,7 @@ Status CatalogManager::ProcessPendingAssignments(
     }
   }
   // Send the CreateTablet() requests to the servers. This is asynchronous / non-blocking.
-  for (TabletInfo* tablet : deferred.needs_create_rpc) {
-    TabletMetadataLock l(tablet, TabletMetadataLock::READ);
-    SendCreateTabletRequest(tablet, l);
-  }
+  SendCreateTabletRequests(deferred.needs_create_rpc);
   return Status::OK();
 }
 
@@ -3613,6 +4143,46 @@ void CatalogManager::SendCreateTabletRequest(const scoped_refptr<TabletInfo>& ta
   }
 }
 
+void CatalogManager::SendCreateTabletRequests(const vector<TabletInfo*>& tablets) {
+  if (FLAGS_catalog_manager_create_tablets_batch_size <= 1) {
+    for (TabletInfo* tablet : tablets) {
+      TabletMetadataLock l(tablet, TabletMetadataLock::READ);
+      SendCreateTabletRequest(tablet, l);
+    }
+    return;
+  }
+
+  // Group the replicas to create by table and by tablet server, so that each
+  // server is sent a few CreateTablets() RPCs rather than one CreateTablet()
+  // RPC per replica.
+  map<pair<TableInfo*, string>, vector<scoped_refptr<TabletInfo>>> replicas_by_ts;
+  MonoTime now = MonoTime::Now();
+  for (TabletInfo* tablet : tablets) {
+    TabletMetadataLock l(tablet, TabletMetadataLock::READ);
+    tablet->set_last_create_tablet_time(now);
+    for (const RaftPeerPB& peer : l.data().pb.committed_consensus_state().config().peers()) {
+      replicas_by_ts[std::make_pair(tablet->table().get(), peer.permanent_uuid())]
+          .emplace_back(tablet);
+    }
+  }
+
+  for (const auto& entry : replicas_by_ts) {
+    scoped_refptr<TableInfo> table(entry.first.first);
+    const string& ts_uuid = entry.first.second;
+    const auto& replicas = entry.second;
+    int num_replicas = replicas.size();
+    for (int start = 0; start < num_replicas;
+         start += FLAGS_catalog_manager_create_tablets_batch_size) {
+      int end = std::min(num_replicas, start + FLAGS_catalog_manager_create_tablets_batch_size);
+      vector<scoped_refptr<TabletInfo>> batch(replicas.begin() + start,
+                                              replicas.begin() + end);
+      AsyncCreateReplicas* task = new AsyncCreateReplicas(master_, ts_uuid, table, batch);
+      table->AddTask(task);
+      WARN_NOT_OK(task->Run(), "Failed to send new tablets request");
+    }
+  }
+}
+
 shared_ptr<TSDescriptor> CatalogManager::PickBetterReplicaLocation(
     const TSDescriptorVector& two_choices) {
   DCHECK_EQ(two_choices.size(), 2);
@@ -3634,10 +4204,40 @@ shared_ptr<TSDescriptor> CatalogManager::PickBetterReplicaLocation(
   // we batch the selection process before sending any creation commands to the
   // servers themselves.
   //
-  // TODO: in the future we may want to factor in other items such as available disk space,
-  // actual request load, etc.
+  // On top of that, the load statistics reported by the servers are weighed,
+  // so that new replicas don't land on servers which have few replicas but are
+  // already saturated, e.g. because they host a hot table. A server's load is
+  // raised by its average share of the pair's statistics, in units of the
+  // pair's replicas, so that servers with equal statistics are still only told
+  // apart by their replicas.
   double load_a = a->RecentReplicaCreations() + a->num_live_replicas();
   double load_b = b->RecentReplicaCreations() + b->num_live_replicas();
+  if (FLAGS_replica_placement_load_weight > 0) {
+    TSLoadStatsPB stats_a;
+    TSLoadStatsPB stats_b;
+    a->GetLoadStats(&stats_a);
+    b->GetLoadStats(&stats_b);
+    double share_a = 0;
+    double share_b = 0;
+    int num_stats = 0;
+    auto add_shares = [&](double value_a, double value_b) {
+      if (value_a + value_b > 0) {
+        share_a += value_a / (value_a + value_b);
+        share_b += value_b / (value_a + value_b);
+        num_stats++;
+      }
+    };
+    add_shares(stats_a.on_disk_size_bytes(), stats_b.on_disk_size_bytes());
+    add_shares(stats_a.memrowset_size_bytes(), stats_b.memrowset_size_bytes());
+    add_shares(stats_a.wal_bytes_per_sec(), stats_b.wal_bytes_per_sec());
+    add_shares(stats_a.scans_per_sec(), stats_b.scans_per_sec());
+    if (num_stats > 0) {
+      double scale = FLAGS_replica_placement_load_weight * std::max(1.0, load_a + load_b) /
+          num_stats;
+      load_a += scale * share_a;
+      load_b += scale * share_b;
+    }
+  }
   if (load_a < load_b) {
     return a;
   } else if (load_b < load_a) {
@@ -3726,7 +4326,24 @@ void CatalogManager::SelectReplicas(const TSDescriptorVector& ts_descs,
 
 Status CatalogManager::BuildLocationsForTablet(const scoped_refptr<TabletInfo>& tablet,
                                                TabletLocationsPB* locs_pb) {
+  // Fast path: the locations were built before, and neither the tablet's
+  // metadata nor the set of registered tablet servers changed since. This
+  // takes neither the tablet's lock nor the tablet server manager's.
+  //
+  // The tablet server registration version is loaded before the tablet
+  // servers are looked up below, so that locations built while a tablet
+  // server registers are never cached under the new version.
+  const int64_t ts_version = master_->ts_manager()->registration_version();
+  shared_ptr<const TabletLocationsPB> cached =
+      tablet->GetCachedLocations(tablet->metadata().version(), ts_version);
+  if (cached) {
+    locs_pb->CopyFrom(*cached);
+    return Status::OK();
+  }
+
+  shared_ptr<TabletLocationsPB> locs = std::make_shared<TabletLocationsPB>();
   TabletMetadataLock l_tablet(tablet.get(), TabletMetadataLock::READ);
+  const int64_t metadata_version = tablet->metadata().version();
   if (PREDICT_FALSE(l_tablet.data().is_deleted())) {
     return Status::NotFound("Tablet deleted", l_tablet.data().pb.state_msg());
   }
@@ -3742,7 +4359,7 @@ Status CatalogManager::BuildLocationsForTablet(const scoped_refptr<TabletInfo>&
   for (const consensus::RaftPeerPB& peer : cstate.config().peers()) {
     // TODO: GetConsensusRole() iterates over all of the peers, making this an
     // O(n^2) loop. If replication counts get high, it should be optimized.
-    TabletLocationsPB_ReplicaPB* replica_pb = locs_pb->add_replicas();
+    TabletLocationsPB_ReplicaPB* replica_pb = locs->add_replicas();
     replica_pb->set_role(GetConsensusRole(peer.permanent_uuid(), cstate));
 
     TSInfoPB* tsinfo_pb = replica_pb->mutable_ts_info();
@@ -3762,12 +4379,14 @@ Status CatalogManager::BuildLocationsForTablet(const scoped_refptr<TabletInfo>&
     }
   }
 
-  locs_pb->mutable_partition()->CopyFrom(tablet->metadata().state().pb.partition());
-  locs_pb->set_tablet_id(tablet->tablet_id());
+  locs->mutable_partition()->CopyFrom(tablet->metadata().state().pb.partition());
+  locs->set_tablet_id(tablet->tablet_id());
 
   // No longer used; always set to false.
-  locs_pb->set_deprecated_stale(false);
+  locs->set_deprecated_stale(false);
 
+  locs_pb->CopyFrom(*locs);
+  tablet->SetCachedLocations(metadata_version, ts_version, std::move(locs));
   return Status::OK();
 }
 
@@ -3987,6 +4606,26 @@ bool CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndIsLeaderOrResp
   return false;
 }
 
+template<typename ReqClass, typename RespClass>
+bool CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndCanServeReadOrRespond(
+    const ReqClass& req, RespClass* resp, RpcContext* rpc) {
+  if (PREDICT_TRUE(first_failed_status().ok())) {
+    return true;
+  }
+  if (catalog_status_.ok() &&
+      req.has_follower_max_staleness_ms() &&
+      leader_shared_lock_.owns_lock() &&
+      catalog_->follower_catalog_load_time_.Initialized()) {
+    int64_t staleness_ms =
+        (MonoTime::Now() - catalog_->follower_catalog_load_time_).ToMilliseconds();
+    if (staleness_ms <= req.follower_max_staleness_ms()) {
+      resp->set_follower_staleness_ms(staleness_ms);
+      return true;
+    }
+  }
+  return CheckIsInitializedAndIsLeaderOrRespond(resp, rpc);
+}
+
 // Explicit specialization for callers outside this compilation unit.
 #define INITTED_OR_RESPOND(RespClass) \
   template bool \
@@ -3996,6 +4635,10 @@ bool CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndIsLeaderOrResp
   template bool \
   CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndIsLeaderOrRespond( \
       RespClass* resp, RpcContext* rpc)
+#define INITTED_AND_CAN_SERVE_READ_OR_RESPOND(ReqClass, RespClass) \
+  template bool \
+  CatalogManager::ScopedLeaderSharedLock::CheckIsInitializedAndCanServeReadOrRespond( \
+      const ReqClass& req, RespClass* resp, RpcContext* rpc)
 
 INITTED_OR_RESPOND(ConnectToMasterResponsePB);
 INITTED_OR_RESPOND(GetMasterRegistrationResponsePB);
@@ -4010,9 +4653,13 @@ INITTED_AND_LEADER_OR_RESPOND(ListTabletServersResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTableLocationsResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTableSchemaResponsePB);
 INITTED_AND_LEADER_OR_RESPOND(GetTabletLocationsResponsePB);
+INITTED_AND_CAN_SERVE_READ_OR_RESPOND(ListTablesRequestPB, ListTablesResponsePB);
+INITTED_AND_CAN_SERVE_READ_OR_RESPOND(GetTableLocationsRequestPB, GetTableLocationsResponsePB);
+INITTED_AND_CAN_SERVE_READ_OR_RESPOND(GetTableSchemaRequestPB, GetTableSchemaResponsePB);
 
 #undef INITTED_OR_RESPOND
 #undef INITTED_AND_LEADER_OR_RESPOND
+#undef INITTED_AND_CAN_SERVE_READ_OR_RESPOND
 
 ////////////////////////////////////////////////////////////
 // TabletInfo
@@ -4023,7 +4670,9 @@ TabletInfo::TabletInfo(const scoped_refptr<TableInfo>& table,
     : tablet_id_(std::move(tablet_id)),
       table_(table),
       last_create_tablet_time_(MonoTime::Now()),
-      reported_schema_version_(0) {}
+      reported_schema_version_(0),
+      cached_locations_metadata_version_(-1),
+      cached_locations_ts_version_(-1) {}
 
 TabletInfo::~TabletInfo() {
 }
@@ -4052,6 +4701,25 @@ uint32_t TabletInfo::reported_schema_version() const {
   return reported_schema_version_;
 }
 
+shared_ptr<const TabletLocationsPB> TabletInfo::GetCachedLocations(int64_t metadata_version,
+                                                                   int64_t ts_version) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (cached_locations_metadata_version_ != metadata_version ||
+      cached_locations_ts_version_ != ts_version) {
+    return nullptr;
+  }
+  return cached_locations_;
+}
+
+void TabletInfo::SetCachedLocations(int64_t metadata_version,
+                                    int64_t ts_version,
+                                    shared_ptr<const TabletLocationsPB> locations) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  cached_locations_ = std::move(locations);
+  cached_locations_metadata_version_ = metadata_version;
+  cached_locations_ts_version_ = ts_version;
+}
+
 std::string TabletInfo::ToString() const {
   return Substitute("$0 (table $1)", tablet_id_,
                     (table_ != nullptr ? table_->ToString() : "MISSING"));
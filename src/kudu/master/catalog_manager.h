@@ -45,8 +45,13 @@
 
 namespace kudu {
 
+class Counter;
 class Schema;
 class ThreadPool;
+class Trace;
+
+template<typename T>
+class AtomicGauge;
 
 // Working around FRIEND_TEST() ugliness.
 namespace client {
@@ -75,6 +80,7 @@ class TableInfo;
 class TSDescriptor;
 
 struct DeferredAssignmentActions;
+struct DeferredReportActions;
 
 // The data related to a tablet which is persisted on disk.
 // This portion of TableInfo is managed via CowObject.
@@ -135,6 +141,17 @@ class TabletInfo : public RefCountedThreadSafe<TabletInfo> {
   bool set_reported_schema_version(uint32_t version);
   uint32_t reported_schema_version() const;
 
+  // Return the cached locations of the tablet if they were built from the
+  // given version of the tablet's metadata and of the tablet server
+  // registrations (see TSManager::registration_version()), or NULL.
+  std::shared_ptr<const TabletLocationsPB> GetCachedLocations(int64_t metadata_version,
+                                                              int64_t ts_version) const;
+
+  // Cache the locations of the tablet, built from the given versions.
+  void SetCachedLocations(int64_t metadata_version,
+                          int64_t ts_version,
+                          std::shared_ptr<const TabletLocationsPB> locations);
+
   // No synchronization needed.
   std::string ToString() const;
 
@@ -157,6 +174,12 @@ class TabletInfo : public RefCountedThreadSafe<TabletInfo> {
   // Reported schema version (in-memory only).
   uint32_t reported_schema_version_;
 
+  // The last built locations of the tablet, and the versions they were
+  // built from (in-memory only).
+  std::shared_ptr<const TabletLocationsPB> cached_locations_;
+  int64_t cached_locations_metadata_version_;
+  int64_t cached_locations_ts_version_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletInfo);
 };
 
@@ -277,16 +300,36 @@ class TableInfo : public RefCountedThreadSafe<TableInfo> {
   DISALLOW_COPY_AND_ASSIGN(TableInfo);
 };
 
+// Measures the time from its construction until StopWaitTimer() is called,
+// and adds it to the "metadata_lock_wait_us" counter of the current trace.
+// Does nothing if no trace is active.
+class MetadataLockWaitTimer {
+ protected:
+  MetadataLockWaitTimer();
+  void StopWaitTimer();
+
+ private:
+  Trace* const trace_;
+  const int64_t start_micros_;
+};
+
 // Helper to manage locking on the persistent metadata of TabletInfo or TableInfo.
+//
+// The time spent waiting for the lock is recorded in the trace of the calling
+// RPC: the timer base class is constructed before the CowLock one, which
+// acquires the lock.
 template<class MetadataClass>
-class MetadataLock : public CowLock<typename MetadataClass::cow_state> {
+class MetadataLock : private MetadataLockWaitTimer,
+                     public CowLock<typename MetadataClass::cow_state> {
  public:
   typedef CowLock<typename MetadataClass::cow_state> super;
   MetadataLock(MetadataClass* info, typename super::LockMode mode)
     : super(DCHECK_NOTNULL(info)->mutable_metadata(), mode) {
+    StopWaitTimer();
   }
   MetadataLock(const MetadataClass* info, typename super::LockMode mode)
     : super(&(DCHECK_NOTNULL(info))->metadata(), mode) {
+    StopWaitTimer();
   }
 };
 
@@ -371,6 +414,19 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
     template<typename RespClass>
     bool CheckIsInitializedAndIsLeaderOrRespond(RespClass* resp, rpc::RpcContext* rpc);
 
+    // Check that the catalog manager is initialized and that it may answer
+    // the metadata read 'req': either it is the leader of its Raft
+    // configuration, or it is a follower whose copy of the catalog is no
+    // staler than the request's 'follower_max_staleness_ms'. In the latter
+    // case, the staleness is set in 'resp'.
+    //
+    // Otherwise, responds like CheckIsInitializedAndIsLeaderOrRespond() and
+    // returns false.
+    template<typename ReqClass, typename RespClass>
+    bool CheckIsInitializedAndCanServeReadOrRespond(const ReqClass& req,
+                                                    RespClass* resp,
+                                                    rpc::RpcContext* rpc);
+
    private:
     CatalogManager* catalog_;
     shared_lock<RWMutex> leader_shared_lock_;
@@ -607,17 +663,31 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   // Builds the TabletLocationsPB for a tablet based on the provided TabletInfo.
   // Populates locs_pb and returns true on success.
   // Returns Status::ServiceUnavailable if tablet is not running.
+  //
+  // The locations are cached in the TabletInfo, and are only built again
+  // once the tablet's metadata changed or a new tablet server registered.
   Status BuildLocationsForTablet(const scoped_refptr<TabletInfo>& tablet,
                                  TabletLocationsPB* locs_pb);
 
   Status FindTable(const TableIdentifierPB& table_identifier,
                    scoped_refptr<TableInfo>* table_info);
 
-  // Handle one of the tablets in a tablet reported.
-  // Requires that the lock is already held.
+  // Handle a tablet report from a tablet which isn't known to the master.
+  void HandleUnknownReportedTablet(TSDescriptor* ts_desc,
+                                   const ReportedTabletPB& report);
+
+  // Handle one of the tablets in a tablet report. The caller must hold
+  // 'table_lock' for reading and 'tablet_lock' for writing.
+  //
+  // If the tablet is mutated, it's added to 'deferred->tablets_to_update' and
+  // the caller must keep 'tablet_lock' until the mutation is persisted.
   Status HandleReportedTablet(TSDescriptor* ts_desc,
                               const ReportedTabletPB& report,
-                              ReportedTabletUpdatesPB *report_updates);
+                              const scoped_refptr<TabletInfo>& tablet,
+                              TableMetadataLock* table_lock,
+                              TabletMetadataLock* tablet_lock,
+                              ReportedTabletUpdatesPB* report_updates,
+                              DeferredReportActions* deferred);
 
   Status HandleRaftConfigChanged(const ReportedTabletPB& report,
                                  const scoped_refptr<TabletInfo>& tablet,
@@ -711,6 +781,14 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   void SendCreateTabletRequest(const scoped_refptr<TabletInfo>& tablet,
                                const TabletMetadataLock& tablet_lock);
 
+  // Like SendCreateTabletRequest(), for several tablets at once: the replicas
+  // which belong to the same table and tablet server are created with a
+  // single CreateTablets() RPC, up to --catalog_manager_create_tablets_batch_size
+  // replicas per RPC.
+  //
+  // The tablets must not be locked when making this call.
+  void SendCreateTabletRequests(const std::vector<TabletInfo*>& tablets);
+
   // Send the "alter table request" to all tablets of the specified table.
   void SendAlterTableRequest(const scoped_refptr<TableInfo>& table);
 
@@ -718,6 +796,25 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   // tablet.
   void SendAlterTabletRequest(const scoped_refptr<TabletInfo>& tablet);
 
+  // Start the background task to ask the leader replica of this tablet, on
+  // the tablet server with the given UUID, to step down.
+  void SendLeaderStepDownRequest(const scoped_refptr<TabletInfo>& tablet,
+                                 const std::string& leader_uuid);
+
+  // If follower reads are enabled, this master isn't the leader, and it's
+  // time to, reload its copy of the catalog from the local replica of the
+  // sys catalog, so that it may answer metadata reads.
+  //
+  // Only called by the background task thread, without the leader lock held.
+  void RefreshFollowerCatalog();
+
+  // If leader rebalancing is enabled and it's time to, ask tablet servers
+  // which lead too many of the tablets of a table to step down as leaders of
+  // some of them, in favor of tablet servers which lead too few.
+  //
+  // Only called by the background task thread, with the leader lock held.
+  void RebalanceLeaders();
+
   // Send the "delete tablet request" to all replicas of all tablets of the
   // specified table.
   void SendDeleteTableRequest(const scoped_refptr<TableInfo>& table,
@@ -827,6 +924,18 @@ class CatalogManager : public tserver::TabletPeerLookupIf {
   // Always acquire this lock before state_lock_.
   RWMutex leader_lock_;
 
+  // The time at which RefreshFollowerCatalog() last started loading the
+  // catalog, or uninitialized if the loaded catalog isn't a follower's.
+  // Protected by leader_lock_.
+  MonoTime follower_catalog_load_time_;
+
+  // The last time RebalanceLeaders() looked for leaders to move. Only
+  // accessed by the background task thread.
+  MonoTime last_leader_rebalance_;
+
+  scoped_refptr<Counter> leader_rebalance_step_downs_;
+  scoped_refptr<AtomicGauge<int64_t>> leader_rebalance_excess_leaders_;
+
   // Async operations are accessing some private methods
   // (TODO: this stuff should be deferred and done in the background thread)
   friend class AsyncAlterTable;
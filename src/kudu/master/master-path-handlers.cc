@@ -122,43 +122,72 @@ void MasterPathHandlers::HandleTabletServers(const Webserver::WebRequest& req,
   generate_table(dead_tserver_rows, "Dead Tablet Servers", output);
 }
 
+namespace {
+
+// What the tables page shows of a table.
+struct TableSummary {
+  string name;
+  string id;
+  string state;
+  string state_msg;
+};
+
+} // anonymous namespace
+
 void MasterPathHandlers::HandleCatalogManager(const Webserver::WebRequest& req,
-                                              ostringstream* output) {
-  CatalogManager::ScopedLeaderSharedLock l(master_->catalog_manager());
-  if (!l.first_failed_status().ok()) {
-    *output << "Master is not ready: " << l.first_failed_status().ToString();
-    return;
+                                              Webserver::WebResponseStream* stream) {
+  ostringstream* output = stream->output();
+
+  // The catalog manager's lock is only held to copy the state of the tables,
+  // the page is rendered from that copy.
+  vector<TableSummary> summaries;
+  {
+    CatalogManager::ScopedLeaderSharedLock l(master_->catalog_manager());
+    if (!l.first_failed_status().ok()) {
+      *output << "Master is not ready: " << l.first_failed_status().ToString();
+      return;
+    }
+
+    std::vector<scoped_refptr<TableInfo>> tables;
+    master_->catalog_manager()->GetAllTables(&tables);
+    summaries.reserve(tables.size());
+    for (const scoped_refptr<TableInfo>& table : tables) {
+      TableMetadataLock l(table.get(), TableMetadataLock::READ);
+      if (!l.data().is_running()) {
+        continue;
+      }
+      TableSummary summary;
+      summary.name = l.data().name();
+      summary.id = table->id();
+      summary.state = SysTablesEntryPB_State_Name(l.data().pb.state());
+      summary.state_msg = l.data().pb.state_msg();
+      summaries.emplace_back(std::move(summary));
+    }
   }
+  std::sort(summaries.begin(), summaries.end(),
+            [](const TableSummary& a, const TableSummary& b) { return a.name < b.name; });
 
   *output << "<h1>Tables</h1>\n";
 
-  std::vector<scoped_refptr<TableInfo>> tables;
-  master_->catalog_manager()->GetAllTables(&tables);
-
+  HtmlPage page = ParseHtmlPage(req, summaries.size());
+  HtmlOutputPageLinks("/tables", page, output);
   *output << "<table class='table table-striped'>\n";
   *output << "  <tr><th>Table Name</th><th>Table Id</th>" <<
       "<th>State</th><th>State Message</th></tr>\n";
-  typedef std::map<string, string> StringMap;
-  StringMap ordered_tables;
-  for (const scoped_refptr<TableInfo>& table : tables) {
-    TableMetadataLock l(table.get(), TableMetadataLock::READ);
-    if (!l.data().is_running()) {
-      continue;
-    }
-    string state = SysTablesEntryPB_State_Name(l.data().pb.state());
-    Capitalize(&state);
-    ordered_tables[l.data().name()] = Substitute(
+  for (int i = page.first; i < page.last; i++) {
+    TableSummary& summary = summaries[i];
+    Capitalize(&summary.state);
+    *output << Substitute(
         "<tr><th>$0</th><td><a href=\"/table?id=$1\">$1</a></td>"
             "<td>$2</td><td>$3</td></tr>\n",
-        EscapeForHtmlToString(l.data().name()),
-        EscapeForHtmlToString(table->id()),
-        state,
-        EscapeForHtmlToString(l.data().pb.state_msg()));
-  }
-  for (const StringMap::value_type& table : ordered_tables) {
-    *output << table.second;
+        EscapeForHtmlToString(summary.name),
+        EscapeForHtmlToString(summary.id),
+        summary.state,
+        EscapeForHtmlToString(summary.state_msg));
+    stream->Flush();
   }
   *output << "</table>\n";
+  HtmlOutputPageLinks("/tables", page, output);
 }
 
 namespace {
@@ -567,9 +596,10 @@ Status MasterPathHandlers::Register(Webserver* server) {
   server->RegisterPathHandler("/tablet-servers", "Tablet Servers",
                               boost::bind(&MasterPathHandlers::HandleTabletServers, this, _1, _2),
                               is_styled, is_on_nav_bar);
-  server->RegisterPathHandler("/tables", "Tables",
-                              boost::bind(&MasterPathHandlers::HandleCatalogManager, this, _1, _2),
-                              is_styled, is_on_nav_bar);
+  server->RegisterStreamingPathHandler(
+      "/tables", "Tables",
+      boost::bind(&MasterPathHandlers::HandleCatalogManager, this, _1, _2),
+      is_styled, is_on_nav_bar);
   server->RegisterPathHandler("/table", "",
                               boost::bind(&MasterPathHandlers::HandleTablePage, this, _1, _2),
                               is_styled, false);
@@ -49,7 +49,7 @@ class MasterPathHandlers {
   void HandleTabletServers(const Webserver::WebRequest& req,
                            std::ostringstream* output);
   void HandleCatalogManager(const Webserver::WebRequest& req,
-                            std::ostringstream* output);
+                            Webserver::WebResponseStream* stream);
   void HandleTablePage(const Webserver::WebRequest& req,
                        std::ostringstream *output);
   void HandleMasters(const Webserver::WebRequest& req,
@@ -268,6 +268,25 @@ TEST_F(MasterTest, TestRegisterAndHeartbeat) {
     ASSERT_TRUE(resp.has_tablet_report());
   }
 
+  // The load statistics sent in a heartbeat are kept by the master, to be
+  // used when placing new replicas.
+  {
+    TSHeartbeatRequestPB req;
+    TSHeartbeatResponsePB resp;
+    RpcController rpc;
+    req.mutable_common()->CopyFrom(common);
+    TSLoadStatsPB* stats = req.mutable_load_stats();
+    stats->set_on_disk_size_bytes(1024);
+    stats->set_memrowset_size_bytes(512);
+    stats->set_wal_bytes_per_sec(100);
+    stats->set_scans_per_sec(10);
+    ASSERT_OK(proxy_->TSHeartbeat(req, &resp, &rpc));
+
+    TSLoadStatsPB reported;
+    ts_desc->GetLoadStats(&reported);
+    ASSERT_EQ(SecureDebugString(*stats), SecureDebugString(reported));
+  }
+
   master_->ts_manager()->GetAllDescriptors(&descs);
   ASSERT_EQ(1, descs.size()) << "Should still only have one TS registered";
 
@@ -793,6 +812,64 @@ TEST_F(MasterTest, TestGetTableSchemaIsAtomicWithCreateTable) {
   t.join();
 }
 
+// Tests that the schemas of a table are left out of GetTableSchema() responses
+// when the request shows the client has the current ones cached.
+TEST_F(MasterTest, TestGetTableSchemaNotModified) {
+  const char* kTableName = "testtb";
+  const Schema kTableSchema({ ColumnSchema("key", INT32),
+                              ColumnSchema("v1", UINT64) },
+                            1);
+  ASSERT_OK(CreateTable(kTableName, kTableSchema));
+
+  GetTableSchemaRequestPB req;
+  req.mutable_table()->set_table_name(kTableName);
+  GetTableSchemaResponsePB resp;
+  {
+    RpcController controller;
+    ASSERT_OK(proxy_->GetTableSchema(req, &resp, &controller));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.has_schema_version());
+    ASSERT_FALSE(resp.schema_not_modified());
+    ASSERT_TRUE(resp.has_schema());
+    ASSERT_TRUE(resp.has_partition_schema());
+  }
+  const string table_id = resp.table_id();
+  const uint32_t version = resp.schema_version();
+
+  // The cached schemas are current.
+  req.set_cached_table_id(table_id);
+  req.set_cached_schema_version(version);
+  {
+    RpcController controller;
+    ASSERT_OK(proxy_->GetTableSchema(req, &resp, &controller));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.schema_not_modified());
+    ASSERT_FALSE(resp.has_schema());
+    ASSERT_FALSE(resp.has_partition_schema());
+    ASSERT_EQ(table_id, resp.table_id());
+    ASSERT_EQ(version, resp.schema_version());
+  }
+
+  // The cached schemas are of another version, or of another table.
+  req.set_cached_schema_version(version + 1);
+  {
+    RpcController controller;
+    ASSERT_OK(proxy_->GetTableSchema(req, &resp, &controller));
+    ASSERT_FALSE(resp.schema_not_modified());
+    ASSERT_TRUE(resp.has_schema());
+  }
+  req.set_cached_table_id("other-table-id");
+  req.set_cached_schema_version(version);
+  {
+    RpcController controller;
+    ASSERT_OK(proxy_->GetTableSchema(req, &resp, &controller));
+    ASSERT_FALSE(resp.schema_not_modified());
+    ASSERT_TRUE(resp.has_schema());
+  }
+}
+
 // Verifies that on-disk master metadata is self-consistent and matches a set
 // of expected contents.
 //
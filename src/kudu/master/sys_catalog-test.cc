@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -25,6 +26,8 @@
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/catalog_manager.h"
 #include "kudu/master/master.h"
 #include "kudu/master/master.proxy.h"
@@ -35,6 +38,7 @@
 #include "kudu/security/crypto.h"
 #include "kudu/security/openssl_util.h"
 #include "kudu/server/rpc_server.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
@@ -47,6 +51,7 @@ using kudu::rpc::MessengerBuilder;
 using kudu::security::Cert;
 using kudu::security::DataFormat;
 using kudu::security::PrivateKey;
+using strings::Substitute;
 
 namespace kudu {
 namespace master {
@@ -354,6 +359,56 @@ TEST_F(SysCatalogTest, TestSysCatalogTabletsOperations) {
   }
 }
 
+// A tablet visitor which may be called concurrently, collecting the IDs
+// of the visited tablets.
+class TabletIdCollector : public TabletVisitor {
+ public:
+  virtual Status VisitTablet(const std::string& table_id,
+                             const std::string& tablet_id,
+                             const SysTabletsEntryPB& metadata) OVERRIDE {
+    std::lock_guard<simple_spinlock> l(lock_);
+    tablet_ids.push_back(tablet_id);
+    return Status::OK();
+  }
+
+  simple_spinlock lock_;
+  vector<string> tablet_ids;
+};
+
+// Test that visiting the tablets with several threads visits each of them
+// exactly once, including the ones whose IDs aren't hexadecimal.
+TEST_F(SysCatalogTest, TestVisitTabletsInParallel) {
+  scoped_refptr<TableInfo> table(new TableInfo("abc"));
+  vector<scoped_refptr<TabletInfo>> tablets;
+  vector<string> expected_ids = { "-first", "Zmiddle", "~last" };
+  for (int i = 0; i < 256; i++) {
+    expected_ids.push_back(Substitute("$0tablet", StringPrintf("%02x", i)));
+  }
+  vector<TabletInfo*> to_add;
+  vector<std::unique_ptr<TabletMetadataLock>> locks;
+  for (const string& id : expected_ids) {
+    tablets.emplace_back(CreateTablet(table.get(), id, "", ""));
+    to_add.push_back(tablets.back().get());
+    locks.emplace_back(new TabletMetadataLock(tablets.back().get(), TabletMetadataLock::WRITE));
+  }
+  SysCatalogTable* sys_catalog = master_->catalog_manager()->sys_catalog();
+  SysCatalogTable::Actions actions;
+  actions.tablets_to_add = to_add;
+  ASSERT_OK(sys_catalog->Write(actions));
+  for (const auto& l : locks) {
+    l->Commit();
+  }
+  std::sort(expected_ids.begin(), expected_ids.end());
+
+  for (int num_threads : { 1, 3, 4, 16, 32 }) {
+    SCOPED_TRACE(num_threads);
+    TabletIdCollector collector;
+    ASSERT_OK(sys_catalog->VisitTablets(&collector, num_threads));
+    std::sort(collector.tablet_ids.begin(), collector.tablet_ids.end());
+    ASSERT_EQ(expected_ids, collector.tablet_ids);
+  }
+}
+
 // Verify that data mutations are not available from metadata() until commit.
 TEST_F(SysCatalogTest, TestTabletInfoCommit) {
   scoped_refptr<TabletInfo> tablet(new TabletInfo(nullptr, "123"));
@@ -22,6 +22,7 @@
 #include <iomanip>
 #include <iterator>
 #include <memory>
+#include <mutex>
 #include <set>
 #include <vector>
 
@@ -55,14 +56,24 @@
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/threadpool.h"
+#include "kudu/util/trace.h"
 
 DEFINE_double(sys_catalog_fail_during_write, 0.0,
               "Fraction of the time when system table writes will fail");
 TAG_FLAG(sys_catalog_fail_during_write, hidden);
 
+METRIC_DEFINE_histogram(server, sys_catalog_write_duration,
+                        "System Catalog Write Duration",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Time taken by writes of the master's metadata to the system "
+                        "catalog table, until they're committed.",
+                        60000000LU, 2);
+
 using kudu::consensus::CONSENSUS_CONFIG_COMMITTED;
 using kudu::consensus::ConsensusMetadata;
 using kudu::consensus::ConsensusStatePB;
@@ -99,6 +110,7 @@ SysCatalogTable::SysCatalogTable(Master* master, MetricRegistry* metrics,
                                  ElectedLeaderCallback leader_cb)
     : metric_registry_(metrics),
       master_(master),
+      write_duration_(METRIC_sys_catalog_write_duration.Instantiate(master->metric_entity())),
       leader_cb_(std::move(leader_cb)) {
   CHECK_OK(ThreadPoolBuilder("apply").Build(&apply_pool_));
 }
@@ -359,6 +371,11 @@ Status SysCatalogTable::SyncWrite(const WriteRequestPB *req, WriteResponsePB *re
   MAYBE_RETURN_FAILURE(FLAGS_sys_catalog_fail_during_write,
                        Status::RuntimeError(kInjectedFailureStatusMsg));
 
+  // Also account for the write in the trace of the calling RPC, so that the
+  // samples of the slowest RPCs show how much of their time it took.
+  TRACE_COUNTER_SCOPE_LATENCY_US("sys_catalog_write_us");
+  ScopedLatencyMetric write_latency(write_duration_.get());
+
   CountDownLatch latch(1);
   gscoped_ptr<tablet::TransactionCompletionCallback> txn_callback(
       new LatchTransactionCompletionCallback<WriteResponsePB>(&latch, resp));
@@ -482,14 +499,14 @@ string SysCatalogTable::TskSeqNumberToEntryId(int64_t seq_number) {
   return entry_id;
 }
 
-Status SysCatalogTable::VisitTables(TableVisitor* visitor) {
+Status SysCatalogTable::VisitTables(TableVisitor* visitor, int num_threads) {
   TRACE_EVENT0("master", "SysCatalogTable::VisitTables");
   auto processor = [&](
       const string& entry_id,
       const SysTablesEntryPB& entry_data) {
     return visitor->VisitTable(entry_id, entry_data);
   };
-  return ProcessRows<SysTablesEntryPB, TABLES_ENTRY>(processor);
+  return ProcessRowsInParallel<SysTablesEntryPB, TABLES_ENTRY>(processor, num_threads);
 }
 
 template<typename T>
@@ -512,7 +529,9 @@ Status SysCatalogTable::GetEntryFromRow(
 // with each entry found.
 template<typename T, SysCatalogTable::CatalogEntryType entry_type>
 Status SysCatalogTable::ProcessRows(
-    function<Status(const string&, const T&)> processor) const {
+    function<Status(const string&, const T&)> processor,
+    const string& id_lower,
+    const string& id_upper) const {
   const int type_col_idx = schema_.find_column(kSysCatalogTableColType);
   CHECK(type_col_idx != Schema::kColumnNotFound)
       << "cannot find sys catalog table column " << kSysCatalogTableColType
@@ -523,6 +542,14 @@ Status SysCatalogTable::ProcessRows(
                                         &kEntryType);
   ScanSpec spec;
   spec.AddPredicate(pred);
+  Slice lower(id_lower);
+  Slice upper(id_upper);
+  if (!id_lower.empty() || !id_upper.empty()) {
+    const int id_col_idx = schema_.find_column(kSysCatalogTableColId);
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(id_col_idx),
+                                             id_lower.empty() ? nullptr : &lower,
+                                             id_upper.empty() ? nullptr : &upper));
+  }
 
   gscoped_ptr<RowwiseIterator> iter;
   RETURN_NOT_OK(tablet_peer_->tablet()->NewRowIterator(schema_, &iter));
@@ -546,6 +573,43 @@ Status SysCatalogTable::ProcessRows(
   return Status::OK();
 }
 
+template<typename T, SysCatalogTable::CatalogEntryType entry_type>
+Status SysCatalogTable::ProcessRowsInParallel(
+    function<Status(const string&, const T&)> processor,
+    int num_threads) const {
+  // The IDs of the tables and tablets are hexadecimal strings, so splitting
+  // on their first digit makes for evenly sized ranges. The first range also
+  // takes whatever sorts before "0" and the last one whatever sorts after "f",
+  // so that the ranges cover all possible IDs regardless.
+  static const char* const kHexDigits = "0123456789abcdef";
+  const int num_ranges = std::min(num_threads, 16);
+  if (num_ranges <= 1) {
+    return ProcessRows<T, entry_type>(std::move(processor));
+  }
+
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("sys-catalog-load")
+                .set_max_threads(num_ranges)
+                .Build(&pool));
+  simple_spinlock lock;
+  Status first_error;
+  for (int i = 0; i < num_ranges; i++) {
+    string id_lower = i == 0 ? "" : string(1, kHexDigits[i * 16 / num_ranges]);
+    string id_upper = i == num_ranges - 1 ? "" : string(1, kHexDigits[(i + 1) * 16 / num_ranges]);
+    RETURN_NOT_OK(pool->SubmitFunc([=, &processor, &lock, &first_error]() {
+      Status s = ProcessRows<T, entry_type>(processor, id_lower, id_upper);
+      if (PREDICT_FALSE(!s.ok())) {
+        std::lock_guard<simple_spinlock> l(lock);
+        if (first_error.ok()) {
+          first_error = s;
+        }
+      }
+    }));
+  }
+  pool->Wait();
+  return first_error;
+}
+
 Status SysCatalogTable::VisitTskEntries(TskEntryVisitor* visitor) {
   TRACE_EVENT0("master", "SysCatalogTable::VisitTskEntries");
   auto processor = [&](
@@ -684,7 +748,7 @@ void SysCatalogTable::ReqDeleteTablets(WriteRequestPB* req,
   }
 }
 
-Status SysCatalogTable::VisitTablets(TabletVisitor* visitor) {
+Status SysCatalogTable::VisitTablets(TabletVisitor* visitor, int num_threads) {
   TRACE_EVENT0("master", "SysCatalogTable::VisitTablets");
   auto processor = [&](
       const string& entry_id,
@@ -702,7 +766,7 @@ Status SysCatalogTable::VisitTablets(TabletVisitor* visitor) {
     metadata.clear_deprecated_end_key();
     return visitor->VisitTablet(metadata.table_id(), entry_id, metadata);
   };
-  return ProcessRows<SysTabletsEntryPB, TABLETS_ENTRY>(processor);
+  return ProcessRowsInParallel<SysTabletsEntryPB, TABLETS_ENTRY>(processor, num_threads);
 }
 
 void SysCatalogTable::InitLocalRaftPeerPB() {
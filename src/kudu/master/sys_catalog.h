@@ -29,8 +29,9 @@
 
 namespace kudu {
 
-class Schema;
 class FsManager;
+class Histogram;
+class Schema;
 
 namespace tserver {
 class WriteRequestPB;
@@ -136,10 +137,14 @@ class SysCatalogTable {
   Status Write(const Actions& actions);
 
   // Scan of the table-related entries.
-  Status VisitTables(TableVisitor* visitor);
+  //
+  // If 'num_threads' is greater than 1, the entries are split into ranges of
+  // their IDs which are scanned and decoded concurrently, so the visitor must
+  // be thread-safe.
+  Status VisitTables(TableVisitor* visitor, int num_threads = 1);
 
-  // Scan of the tablet-related entries.
-  Status VisitTablets(TabletVisitor* visitor);
+  // Scan of the tablet-related entries. See VisitTables() for 'num_threads'.
+  Status VisitTablets(TabletVisitor* visitor, int num_threads = 1);
 
   // Scan for TSK-related entries in the system table.
   Status VisitTskEntries(TskEntryVisitor* visitor);
@@ -207,8 +212,19 @@ class SysCatalogTable {
   Status GetEntryFromRow(const RowBlockRow& row,
                          std::string* entry_id, T* entry_data) const;
 
+  // Scan for entries of the specified type whose IDs are within
+  // ['id_lower', 'id_upper'), and run the specified function with each
+  // entry found. Empty bounds are unbounded.
   template<typename T, CatalogEntryType entry_type>
-  Status ProcessRows(std::function<Status(const std::string&, const T&)>) const;
+  Status ProcessRows(std::function<Status(const std::string&, const T&)> processor,
+                     const std::string& id_lower = "",
+                     const std::string& id_upper = "") const;
+
+  // Same as ProcessRows(), but scans up to 'num_threads' ranges of the entry
+  // IDs concurrently, running the function from multiple threads.
+  template<typename T, CatalogEntryType entry_type>
+  Status ProcessRowsInParallel(std::function<Status(const std::string&, const T&)> processor,
+                               int num_threads) const;
 
   // Tablet related private methods.
 
@@ -251,6 +267,10 @@ class SysCatalogTable {
 
   Master* master_;
 
+  // The time taken by each write to the table, from submitting it to the
+  // write being committed.
+  scoped_refptr<Histogram> write_duration_;
+
   ElectedLeaderCallback leader_cb_;
 
   consensus::RaftPeerPB local_peer_pb_;
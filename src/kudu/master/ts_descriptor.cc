@@ -25,6 +25,7 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus.proxy.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/master/master.pb.h"
 #include "kudu/tserver/tserver_admin.proxy.h"
 #include "kudu/util/flag_tags.h"
@@ -55,10 +56,11 @@ Status TSDescriptor::RegisterNew(const NodeInstancePB& instance,
 TSDescriptor::TSDescriptor(std::string perm_id)
     : permanent_uuid_(std::move(perm_id)),
       latest_seqno_(-1),
-      last_heartbeat_(MonoTime::Now()),
+      last_heartbeat_micros_(GetMonoTimeMicros()),
       recent_replica_creations_(0),
       last_replica_creations_decay_(MonoTime::Now()),
-      num_live_replicas_(0) {
+      num_live_replicas_(0),
+      load_stats_(new TSLoadStatsPB()) {
 }
 
 TSDescriptor::~TSDescriptor() {
@@ -112,20 +114,21 @@ Status TSDescriptor::Register(const NodeInstancePB& instance,
         SecureShortDebugString(registration));
   }
 
-  if (instance.instance_seqno() < latest_seqno_) {
+  int64_t latest_seqno = latest_seqno_.Load();
+  if (instance.instance_seqno() < latest_seqno) {
     return Status::AlreadyPresent(
       strings::Substitute("Cannot register with sequence number $0:"
                           " Already have a registration from sequence number $1",
                           instance.instance_seqno(),
-                          latest_seqno_));
-  } else if (instance.instance_seqno() == latest_seqno_) {
+                          latest_seqno));
+  } else if (instance.instance_seqno() == latest_seqno) {
     // It's possible that the TS registered, but our response back to it
     // got lost, so it's trying to register again with the same sequence
     // number. That's fine.
     LOG(INFO) << "Processing retry of TS registration from " << SecureShortDebugString(instance);
   }
 
-  latest_seqno_ = instance.instance_seqno();
+  latest_seqno_.Store(instance.instance_seqno(), kMemOrderRelease);
   registration_.reset(new ServerRegistrationPB(registration));
   ts_admin_proxy_.reset();
   consensus_proxy_.reset();
@@ -134,14 +137,12 @@ Status TSDescriptor::Register(const NodeInstancePB& instance,
 }
 
 void TSDescriptor::UpdateHeartbeatTime() {
-  std::lock_guard<simple_spinlock> l(lock_);
-  last_heartbeat_ = MonoTime::Now();
+  last_heartbeat_micros_.StoreMax(GetMonoTimeMicros());
 }
 
 MonoDelta TSDescriptor::TimeSinceHeartbeat() const {
-  MonoTime now(MonoTime::Now());
-  std::lock_guard<simple_spinlock> l(lock_);
-  return now - last_heartbeat_;
+  int64_t last_heartbeat_micros = last_heartbeat_micros_.Load();
+  return MonoDelta::FromMicroseconds(GetMonoTimeMicros() - last_heartbeat_micros);
 }
 
 bool TSDescriptor::PresumedDead() const {
@@ -149,8 +150,7 @@ bool TSDescriptor::PresumedDead() const {
 }
 
 int64_t TSDescriptor::latest_seqno() const {
-  std::lock_guard<simple_spinlock> l(lock_);
-  return latest_seqno_;
+  return latest_seqno_.Load(kMemOrderAcquire);
 }
 
 void TSDescriptor::DecayRecentReplicaCreationsUnlocked() {
@@ -182,6 +182,16 @@ double TSDescriptor::RecentReplicaCreations() {
   return recent_replica_creations_;
 }
 
+void TSDescriptor::set_load_stats(const TSLoadStatsPB& stats) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  load_stats_->CopyFrom(stats);
+}
+
+void TSDescriptor::GetLoadStats(TSLoadStatsPB* stats) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  CHECK_NOTNULL(stats)->CopyFrom(*load_stats_);
+}
+
 void TSDescriptor::GetRegistration(ServerRegistrationPB* reg) const {
   std::lock_guard<simple_spinlock> l(lock_);
   CHECK(registration_) << "No registration";
@@ -191,7 +201,7 @@ void TSDescriptor::GetRegistration(ServerRegistrationPB* reg) const {
 void TSDescriptor::GetNodeInstancePB(NodeInstancePB* instance_pb) const {
   std::lock_guard<simple_spinlock> l(lock_);
   instance_pb->set_permanent_uuid(permanent_uuid_);
-  instance_pb->set_instance_seqno(latest_seqno_);
+  instance_pb->set_instance_seqno(latest_seqno_.Load());
 }
 
 Status TSDescriptor::ResolveSockaddr(Sockaddr* addr) const {
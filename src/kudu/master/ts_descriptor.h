@@ -22,6 +22,7 @@
 #include <string>
 
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/make_shared.h"
 #include "kudu/util/monotime.h"
@@ -47,10 +48,14 @@ class TabletServerAdminServiceProxy;
 
 namespace master {
 
+class TSLoadStatsPB;
+
 // Master-side view of a single tablet server.
 //
 // Tracks the last heartbeat, status, instance identifier, etc.
-// This class is thread-safe.
+// This class is thread-safe. The state read on every heartbeat and
+// location lookup (the last heartbeat time, the instance sequence number
+// and the number of live replicas) is read without taking any lock.
 class TSDescriptor {
  public:
   static Status RegisterNew(const NodeInstancePB& instance,
@@ -104,16 +109,21 @@ class TSDescriptor {
   // Set the number of live replicas (i.e. running or bootstrapping).
   void set_num_live_replicas(int n) {
     DCHECK_GE(n, 0);
-    std::lock_guard<simple_spinlock> l(lock_);
-    num_live_replicas_ = n;
+    num_live_replicas_.Store(n);
   }
 
   // Return the number of live replicas (i.e running or bootstrapping).
   int num_live_replicas() const {
-    std::lock_guard<simple_spinlock> l(lock_);
-    return num_live_replicas_;
+    return num_live_replicas_.Load();
   }
 
+  // Set the load statistics, from the last heartbeat.
+  void set_load_stats(const TSLoadStatsPB& stats);
+
+  // Copy the load statistics from the last heartbeat into the given PB
+  // object. The object is left empty if none have been reported.
+  void GetLoadStats(TSLoadStatsPB* stats) const;
+
   // Return a string form of this TS, suitable for printing.
   // Includes the UUID as well as last known host/port.
   std::string ToString() const;
@@ -131,10 +141,13 @@ class TSDescriptor {
   mutable simple_spinlock lock_;
 
   const std::string permanent_uuid_;
-  int64_t latest_seqno_;
 
-  // The last time a heartbeat was received for this node.
-  MonoTime last_heartbeat_;
+  // Only written with 'lock_' held, but read without it.
+  AtomicInt<int64_t> latest_seqno_;
+
+  // The last time a heartbeat was received for this node, as returned by
+  // GetMonoTimeMicros().
+  AtomicInt<int64_t> last_heartbeat_micros_;
 
   // The number of times this tablet server has recently been selected to create a
   // tablet replica. This value decays back to 0 over time.
@@ -142,7 +155,10 @@ class TSDescriptor {
   MonoTime last_replica_creations_decay_;
 
   // The number of live replicas on this host, from the last heartbeat.
-  int num_live_replicas_;
+  AtomicInt<int32_t> num_live_replicas_;
+
+  // The load statistics of this host, from the last heartbeat.
+  gscoped_ptr<TSLoadStatsPB> load_stats_;
 
   gscoped_ptr<ServerRegistrationPB> registration_;
 
@@ -34,7 +34,8 @@ using strings::Substitute;
 namespace kudu {
 namespace master {
 
-TSManager::TSManager() {
+TSManager::TSManager()
+    : registration_version_(0) {
 }
 
 TSManager::~TSManager() {
@@ -42,7 +43,7 @@ TSManager::~TSManager() {
 
 Status TSManager::LookupTS(const NodeInstancePB& instance,
                            shared_ptr<TSDescriptor>* ts_desc) const {
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   const shared_ptr<TSDescriptor>* found_ptr =
     FindOrNull(servers_by_id_, instance.permanent_uuid());
   if (!found_ptr) {
@@ -61,20 +62,21 @@ Status TSManager::LookupTS(const NodeInstancePB& instance,
 
 bool TSManager::LookupTSByUUID(const string& uuid,
                                std::shared_ptr<TSDescriptor>* ts_desc) const {
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   return FindCopy(servers_by_id_, uuid, ts_desc);
 }
 
 Status TSManager::RegisterTS(const NodeInstancePB& instance,
                              const ServerRegistrationPB& registration,
                              std::shared_ptr<TSDescriptor>* desc) {
-  std::lock_guard<rw_spinlock> l(lock_);
+  std::lock_guard<percpu_rwlock> l(lock_);
   const string& uuid = instance.permanent_uuid();
 
   if (!ContainsKey(servers_by_id_, uuid)) {
     shared_ptr<TSDescriptor> new_desc;
     RETURN_NOT_OK(TSDescriptor::RegisterNew(instance, registration, &new_desc));
     InsertOrDie(&servers_by_id_, uuid, new_desc);
+    registration_version_.Increment(kMemOrderBarrier);
     LOG(INFO) << Substitute("Registered new tserver with Master: $0",
                             new_desc->ToString());
     desc->swap(new_desc);
@@ -91,14 +93,14 @@ Status TSManager::RegisterTS(const NodeInstancePB& instance,
 
 void TSManager::GetAllDescriptors(vector<shared_ptr<TSDescriptor> > *descs) const {
   descs->clear();
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   AppendValuesFromMap(servers_by_id_, descs);
 }
 
 void TSManager::GetAllLiveDescriptors(vector<shared_ptr<TSDescriptor> > *descs) const {
   descs->clear();
 
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   descs->reserve(servers_by_id_.size());
   for (const TSDescriptorMap::value_type& entry : servers_by_id_) {
     const shared_ptr<TSDescriptor>& ts = entry.second;
@@ -109,7 +111,7 @@ void TSManager::GetAllLiveDescriptors(vector<shared_ptr<TSDescriptor> > *descs)
 }
 
 int TSManager::GetCount() const {
-  shared_lock<rw_spinlock> l(lock_);
+  shared_lock<rw_spinlock> l(lock_.get_lock());
   return servers_by_id_.size();
 }
 
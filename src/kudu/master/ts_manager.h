@@ -23,6 +23,7 @@
 #include <vector>
 
 #include "kudu/gutil/macros.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
@@ -84,13 +85,25 @@ class TSManager {
   // Get the TS count.
   int GetCount() const;
 
+  // Return a number which changes whenever a new tablet server registers.
+  // Since the addresses of registered tablet servers can't change, anything
+  // derived from looking tablet servers up remains valid as long as this
+  // doesn't change. Doesn't take any lock.
+  int64_t registration_version() const {
+    return registration_version_.Load(kMemOrderAcquire);
+  }
+
  private:
-  mutable rw_spinlock lock_;
+  // Lookups happen on every heartbeat and for every location request, while
+  // registrations are rare, so readers only take the lock of their own CPU.
+  mutable percpu_rwlock lock_;
 
   typedef std::unordered_map<
     std::string, std::shared_ptr<TSDescriptor> > TSDescriptorMap;
   TSDescriptorMap servers_by_id_;
 
+  AtomicInt<int64_t> registration_version_;
+
   DISALLOW_COPY_AND_ASSIGN(TSManager);
 };
 
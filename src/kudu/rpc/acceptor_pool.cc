@@ -20,6 +20,7 @@
 #include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <inttypes.h>
+#include <algorithm>
 #include <iostream>
 #include <pthread.h>
 #include <stdint.h>
@@ -39,6 +40,7 @@
 
 using google::protobuf::Message;
 using std::string;
+using std::vector;
 
 METRIC_DEFINE_counter(server, rpc_connections_accepted,
                       "RPC Connections Accepted",
@@ -60,23 +62,40 @@ namespace rpc {
 AcceptorPool::AcceptorPool(Messenger* messenger, Socket* socket,
                            Sockaddr bind_address)
     : messenger_(messenger),
-      socket_(socket->Release()),
       bind_address_(std::move(bind_address)),
       rpc_connections_accepted_(METRIC_rpc_connections_accepted.Instantiate(
           messenger->metric_entity())),
-      closing_(false) {}
+      closing_(false) {
+  sockets_.emplace_back(new Socket(socket->Release()));
+}
+
+AcceptorPool::AcceptorPool(Messenger* messenger, vector<Socket>* sockets,
+                           Sockaddr bind_address)
+    : messenger_(messenger),
+      bind_address_(std::move(bind_address)),
+      rpc_connections_accepted_(METRIC_rpc_connections_accepted.Instantiate(
+          messenger->metric_entity())),
+      closing_(false) {
+  DCHECK(!sockets->empty());
+  for (Socket& socket : *sockets) {
+    sockets_.emplace_back(new Socket(socket.Release()));
+  }
+}
 
 AcceptorPool::~AcceptorPool() {
   Shutdown();
 }
 
 Status AcceptorPool::Start(int num_threads) {
-  RETURN_NOT_OK(socket_.Listen(FLAGS_rpc_acceptor_listen_backlog));
+  for (const auto& socket : sockets_) {
+    RETURN_NOT_OK(socket->Listen(FLAGS_rpc_acceptor_listen_backlog));
+  }
 
-  for (int i = 0; i < num_threads; i++) {
+  int num_sockets = sockets_.size();
+  for (int i = 0; i < std::max(num_threads, num_sockets); i++) {
     scoped_refptr<kudu::Thread> new_thread;
     Status s = kudu::Thread::Create("acceptor pool", "acceptor",
-        &AcceptorPool::RunThread, this, &new_thread);
+        &AcceptorPool::RunThread, this, i % num_sockets, &new_thread);
     if (!s.ok()) {
       Shutdown();
       return s;
@@ -96,9 +115,11 @@ void AcceptorPool::Shutdown() {
 #if defined(__linux__)
   // Closing the socket will break us out of accept() if we're in it, and
   // prevent future accepts.
-  WARN_NOT_OK(socket_.Shutdown(true, true),
-              strings::Substitute("Could not shut down acceptor socket on $0",
-                                  bind_address_.ToString()));
+  for (const auto& socket : sockets_) {
+    WARN_NOT_OK(socket->Shutdown(true, true),
+                strings::Substitute("Could not shut down acceptor socket on $0",
+                                    bind_address_.ToString()));
+  }
 #else
   // Calling shutdown on an accepting (non-connected) socket is illegal on most
   // platforms (but not Linux). Instead, the accepting threads are interrupted
@@ -119,16 +140,17 @@ Sockaddr AcceptorPool::bind_address() const {
 }
 
 Status AcceptorPool::GetBoundAddress(Sockaddr* addr) const {
-  return socket_.GetSocketAddress(addr);
+  return sockets_[0]->GetSocketAddress(addr);
 }
 
-void AcceptorPool::RunThread() {
+void AcceptorPool::RunThread(int socket_idx) {
+  Socket* socket = sockets_[socket_idx].get();
   while (true) {
     Socket new_sock;
     Sockaddr remote;
-    VLOG(2) << "calling accept() on socket " << socket_.GetFd()
+    VLOG(2) << "calling accept() on socket " << socket->GetFd()
             << " listening on " << bind_address_.ToString();
-    Status s = socket_.Accept(&new_sock, &remote, Socket::FLAG_NONBLOCKING);
+    Status s = socket->Accept(&new_sock, &remote, Socket::FLAG_NONBLOCKING);
     if (!s.ok()) {
       if (Release_Load(&closing_)) {
         break;
@@ -145,7 +167,11 @@ void AcceptorPool::RunThread() {
       continue;
     }
     rpc_connections_accepted_->Increment();
-    messenger_->RegisterInboundSocket(&new_sock, remote);
+    if (sockets_.size() > 1) {
+      messenger_->RegisterInboundSocket(&new_sock, remote, socket_idx);
+    } else {
+      messenger_->RegisterInboundSocket(&new_sock, remote);
+    }
   }
   VLOG(1) << "AcceptorPool shutting down.";
 }
@@ -18,6 +18,7 @@
 #ifndef KUDU_RPC_ACCEPTOR_POOL_H
 #define KUDU_RPC_ACCEPTOR_POOL_H
 
+#include <memory>
 #include <vector>
 
 #include "kudu/gutil/atomicops.h"
@@ -44,9 +45,15 @@ class AcceptorPool {
   // socket.
   // 'socket' must be already bound, but should not yet be listening.
   AcceptorPool(Messenger *messenger, Socket *socket, Sockaddr bind_address);
+
+  // Like the above, but accepts connections on several sockets bound to the
+  // same address with SO_REUSEPORT. Connections accepted on the i-th socket
+  // are handled by the messenger's i-th reactor.
+  AcceptorPool(Messenger *messenger, std::vector<Socket>* sockets, Sockaddr bind_address);
   ~AcceptorPool();
 
-  // Start listening and accepting connections.
+  // Start listening and accepting connections. At least one thread is
+  // started per socket.
   Status Start(int num_threads);
   void Shutdown();
 
@@ -60,10 +67,10 @@ class AcceptorPool {
   Status GetBoundAddress(Sockaddr* addr) const;
 
  private:
-  void RunThread();
+  void RunThread(int socket_idx);
 
   Messenger *messenger_;
-  Socket socket_;
+  std::vector<std::unique_ptr<Socket>> sockets_;
   Sockaddr bind_address_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
 
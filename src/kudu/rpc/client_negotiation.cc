@@ -110,6 +110,7 @@ ClientNegotiation::ClientNegotiation(unique_ptr<Socket> socket,
       helper_(SaslHelper::CLIENT),
       tls_context_(tls_context),
       tls_negotiated_(false),
+      compression_enabled_(false),
       authn_token_(authn_token),
       negotiated_authn_(AuthenticationType::INVALID),
       negotiated_mech_(SaslMechanism::INVALID),
@@ -290,6 +291,9 @@ Status ClientNegotiation::SendNegotiate() {
 
   // Advertise our supported features.
   client_features_ = kSupportedClientRpcFeatureFlags;
+  if (compression_enabled_) {
+    client_features_.insert(PAYLOAD_COMPRESSION);
+  }
   // If the remote peer is local, then we allow using TLS for authentication
   // without encryption or integrity.
   if (socket_->IsLoopbackConnection() && !FLAGS_rpc_encrypt_loopback_connections) {
@@ -71,6 +71,11 @@ class ClientNegotiation {
   // Must be called before Negotiate().
   Status EnableGSSAPI();
 
+  // Advertise PAYLOAD_COMPRESSION, i.e. that this side of the connection
+  // wants to compress call payloads.
+  // Must be called before Negotiate().
+  void EnableCompression() { compression_enabled_ = true; }
+
   // Returns mechanism negotiated by this connection.
   // Must be called after Negotiate().
   SaslMechanism::Type negotiated_mechanism() const;
@@ -209,6 +214,9 @@ class ClientNegotiation {
   security::TlsHandshake tls_handshake_;
   bool tls_negotiated_;
 
+  // Whether to advertise PAYLOAD_COMPRESSION.
+  bool compression_enabled_;
+
   // TSK state.
   boost::optional<security::SignedTokenPB> authn_token_;
 
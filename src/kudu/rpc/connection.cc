@@ -17,7 +17,9 @@
 
 #include "kudu/rpc/connection.h"
 
+#include <limits.h>
 #include <stdint.h>
+#include <sys/uio.h>
 
 #include <algorithm>
 #include <iostream>
@@ -40,6 +42,7 @@
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
+#include "kudu/rpc/serialization.h"
 #include "kudu/rpc/transfer.h"
 #include "kudu/util/debug-util.h"
 #include "kudu/util/flag_tags.h"
@@ -49,6 +52,12 @@
 #include "kudu/util/status.h"
 #include "kudu/util/trace.h"
 
+DEFINE_int32(rpc_max_write_batch_bytes, 1024 * 1024,
+             "Number of bytes of outbound RPC requests and responses above which a "
+             "connection stops gathering more of them into the same write to its "
+             "socket.");
+TAG_FLAG(rpc_max_write_batch_bytes, advanced);
+
 using std::function;
 using std::includes;
 using std::set;
@@ -70,6 +79,7 @@ Connection::Connection(ReactorThread *reactor_thread,
     : reactor_thread_(reactor_thread),
       remote_(remote),
       socket_(std::move(socket)),
+      idx_(0),
       direction_(direction),
       last_activity_time_(MonoTime::Now()),
       is_epoll_registered_(false),
@@ -292,7 +302,7 @@ void Connection::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
 
   // Serialize the actual bytes to be put on the wire.
   slices_tmp_.clear();
-  Status s = call->SerializeTo(&slices_tmp_);
+  Status s = call->SerializeTo(this, &slices_tmp_);
   if (PREDICT_FALSE(!s.ok())) {
     call->SetFailed(s);
     return;
@@ -411,6 +421,28 @@ class QueueTransferTask : public ReactorTask {
   Connection *conn_;
 };
 
+bool Connection::MaybeCompressPayload(const Slice& message_buf,
+                                      const vector<Slice>& sidecars,
+                                      faststring* compressed_buf,
+                                      uint32_t* payload_len) const {
+  const Messenger* messenger = reactor_thread_->reactor()->messenger();
+  int min_bytes = messenger->compression_min_bytes();
+  if (min_bytes <= 0 || !ContainsKey(remote_features_, PAYLOAD_COMPRESSION)) {
+    return false;
+  }
+  size_t wire_len = message_buf.size();
+  for (const Slice& sidecar : sidecars) {
+    wire_len += sidecar.size();
+  }
+  if (wire_len < static_cast<size_t>(min_bytes)) {
+    return false;
+  }
+  bool compressed = serialization::CompressPayload(message_buf, sidecars, compressed_buf,
+                                                   payload_len);
+  messenger->RecordPayloadCompression(wire_len, compressed ? compressed_buf->size() : wire_len);
+  return compressed;
+}
+
 void Connection::QueueResponseForCall(gscoped_ptr<InboundCall> call) {
   // This is usually called by the IPC worker thread when the response
   // is set, but in some circumstances may also be called by the
@@ -548,7 +580,6 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
   }
   DVLOG(3) << ToString() << ": writeHandler: revents = " << revents;
 
-  OutboundTransfer *transfer;
   if (outbound_transfers_.empty()) {
     LOG(WARNING) << ToString() << " got a ready-to-write callback, but there is "
       "nothing to write.";
@@ -556,57 +587,61 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
     return;
   }
 
+  // Gather the ready transfers into batches of up to IOV_MAX slices and about
+  // --rpc_max_write_batch_bytes bytes, and send each batch with one writev(),
+  // so that many small calls don't each cost a syscall.
+  struct iovec iov[IOV_MAX];
   while (!outbound_transfers_.empty()) {
-    transfer = &(outbound_transfers_.front());
-
-    if (!transfer->TransferStarted()) {
-
-      if (transfer->is_for_outbound_call()) {
-        CallAwaitingResponse* car = FindOrDie(awaiting_response_, transfer->call_id());
-        if (!car->call) {
-          // If the call has already timed out, then the 'call' field will have been nulled.
-          // In that case, we don't need to bother sending it.
-          outbound_transfers_.pop_front();
-          transfer->Abort(Status::Aborted("already timed out"));
-          delete transfer;
-          continue;
-        }
-
-        // If this is the start of the transfer, then check if the server has the
-        // required RPC flags. We have to wait until just before the transfer in
-        // order to ensure that the negotiation has taken place, so that the flags
-        // are available.
-        const set<RpcFeatureFlag>& required_features = car->call->required_rpc_features();
-        if (!includes(remote_features_.begin(), remote_features_.end(),
-                      required_features.begin(), required_features.end())) {
-          outbound_transfers_.pop_front();
-          Status s = Status::NotSupported("server does not support the required RPC features");
-          transfer->Abort(s);
-          car->call->SetFailed(s);
-          car->call.reset();
-          delete transfer;
-          continue;
-        }
-
-        car->call->SetSending();
+    int n_iov = 0;
+    int64_t n_bytes = 0;
+    int n_transfers = 0;
+    auto it = outbound_transfers_.begin();
+    while (it != outbound_transfers_.end() &&
+           (n_transfers == 0 || n_bytes < FLAGS_rpc_max_write_batch_bytes)) {
+      OutboundTransfer* transfer = &*it;
+      if (!transfer->TransferStarted() && !PrepareToSend(transfer)) {
+        it = outbound_transfers_.erase(it);
+        delete transfer;
+        continue;
+      }
+      if (n_iov + transfer->num_unsent_slices() > IOV_MAX) {
+        break;
       }
+      n_bytes += transfer->FillIovecs(&iov[n_iov]);
+      n_iov += transfer->num_unsent_slices();
+      n_transfers++;
+      ++it;
+    }
+    if (n_transfers == 0) {
+      // All the remaining transfers were aborted.
+      continue;
     }
 
     last_activity_time_ = reactor_thread_->cur_time();
-    Status status = transfer->SendBuffer(*socket_);
+    int32_t written;
+    Status status = socket_->Writev(iov, n_iov, &written);
     if (PREDICT_FALSE(!status.ok())) {
+      if (Socket::IsTemporarySocketError(status.posix_code())) {
+        return;
+      }
       LOG(WARNING) << ToString() << " send error: " << status.ToString();
       reactor_thread_->DestroyConnection(this, status);
       return;
     }
-
-    if (!transfer->TransferFinished()) {
-      DVLOG(3) << ToString() << ": writeHandler: xfer not finished.";
-      return;
+    reactor_thread_->reactor()->messenger()->RecordOutboundWrite(n_transfers);
+
+    // Account the written bytes to the transfers in order, retiring those
+    // which are complete.
+    for (int i = 0; i < n_transfers; i++) {
+      OutboundTransfer* transfer = &outbound_transfers_.front();
+      written = transfer->Advance(written);
+      if (!transfer->TransferFinished()) {
+        DVLOG(3) << ToString() << ": writeHandler: xfer not finished.";
+        return;
+      }
+      outbound_transfers_.pop_front();
+      delete transfer;
     }
-
-    outbound_transfers_.pop_front();
-    delete transfer;
   }
 
   // If we were able to write all of our outbound transfers,
@@ -614,6 +649,37 @@ void Connection::WriteHandler(ev::io &watcher, int revents) {
   write_io_.stop();
 }
 
+bool Connection::PrepareToSend(OutboundTransfer* transfer) {
+  if (!transfer->is_for_outbound_call()) {
+    return true;
+  }
+
+  CallAwaitingResponse* car = FindOrDie(awaiting_response_, transfer->call_id());
+  if (!car->call) {
+    // If the call has already timed out, then the 'call' field will have been nulled.
+    // In that case, we don't need to bother sending it.
+    transfer->Abort(Status::Aborted("already timed out"));
+    return false;
+  }
+
+  // If this is the start of the transfer, then check if the server has the
+  // required RPC flags. We have to wait until just before the transfer in
+  // order to ensure that the negotiation has taken place, so that the flags
+  // are available.
+  const set<RpcFeatureFlag>& required_features = car->call->required_rpc_features();
+  if (!includes(remote_features_.begin(), remote_features_.end(),
+                required_features.begin(), required_features.end())) {
+    Status s = Status::NotSupported("server does not support the required RPC features");
+    transfer->Abort(s);
+    car->call->SetFailed(s);
+    car->call.reset();
+    return false;
+  }
+
+  car->call->SetSending();
+  return true;
+}
+
 std::string Connection::ToString() const {
   // This may be called from other threads, so we cannot
   // include anything in the output about the current state,
@@ -134,6 +134,18 @@ class Connection : public RefCountedThreadSafe<Connection> {
     return local_user_credentials_;
   }
 
+  // Set the index of an outbound connection among those to the same remote
+  // with the same credentials. See ConnectionId::idx().
+  void set_idx(int idx) {
+    DCHECK_EQ(direction_, CLIENT);
+    idx_ = idx;
+  }
+
+  int idx() const {
+    DCHECK_EQ(direction_, CLIENT);
+    return idx_;
+  }
+
   RpczStore* rpcz_store();
 
   // libev callback when data is available to read.
@@ -172,6 +184,15 @@ class Connection : public RefCountedThreadSafe<Connection> {
     remote_features_ = std::move(remote_features);
   }
 
+  // Compresses the payload of a call sent on this connection if both sides
+  // negotiated PAYLOAD_COMPRESSION and the payload is at least the messenger's
+  // compression_min_bytes() long. See serialization::CompressPayload().
+  // May be called from any thread once negotiation is complete.
+  bool MaybeCompressPayload(const Slice& message_buf,
+                            const std::vector<Slice>& sidecars,
+                            faststring* compressed_buf,
+                            uint32_t* payload_len) const;
+
   void set_remote_user(RemoteUser user) {
     DCHECK_EQ(direction_, SERVER);
     remote_user_ = std::move(user);
@@ -238,6 +259,11 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // This must be called from the reactor thread.
   void QueueOutbound(gscoped_ptr<OutboundTransfer> transfer);
 
+  // Performs the checks due before the first byte of 'transfer' is sent.
+  // Returns false, having aborted the transfer, if it must not be sent.
+  // This must be called from the reactor thread.
+  bool PrepareToSend(OutboundTransfer* transfer);
+
   // The reactor thread that created this connection.
   ReactorThread* const reactor_thread_;
 
@@ -250,6 +276,9 @@ class Connection : public RefCountedThreadSafe<Connection> {
   // The credentials of the user operating on this connection (if a client user).
   UserCredentials local_user_credentials_;
 
+  // The index of the connection (if a client connection).
+  int idx_;
+
   // The authenticated remote user (if this is an inbound connection on the server).
   RemoteUser remote_user_;
 
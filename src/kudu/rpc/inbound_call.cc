@@ -55,7 +55,8 @@ InboundCall::~InboundCall() {}
 Status InboundCall::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   TRACE_EVENT_FLOW_BEGIN0("rpc", "InboundCall", this);
   TRACE_EVENT0("rpc", "InboundCall::ParseFrom");
-  RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_, &serialized_request_));
+  Slice entire_message;
+  RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_, &entire_message));
 
   // Adopt the service/method info from the header as soon as it's available.
   if (PREDICT_FALSE(!header_.has_remote_method())) {
@@ -67,6 +68,17 @@ Status InboundCall::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   }
   remote_method_.FromPB(header_.remote_method());
 
+  if (header_.has_uncompressed_payload_size()) {
+    RETURN_NOT_OK(serialization::UncompressPayload(entire_message,
+                                                   header_.uncompressed_payload_size(),
+                                                   &uncompressed_payload_));
+    entire_message = Slice(uncompressed_payload_);
+  }
+
+  // Extract the request sidecars, if any.
+  RETURN_NOT_OK(RpcSidecar::ParseSidecars(header_.sidecar_offsets(), entire_message,
+                                          &serialized_request_, inbound_sidecar_slices_));
+
   // Retain the buffer that we have a view into.
   transfer_.swap(transfer);
   return Status::OK();
@@ -159,6 +171,23 @@ void InboundCall::SerializeResponseBuffer(const MessageLite& response,
   int additional_size = absolute_sidecar_offset - protobuf_msg_size;
   serialization::SerializeMessage(response, &response_msg_buf_,
                                   additional_size, true);
+
+  vector<Slice> sidecar_slices;
+  sidecar_slices.reserve(sidecars_.size());
+  for (RpcSidecar* car : sidecars_) {
+    sidecar_slices.push_back(car->AsSlice());
+  }
+  faststring compressed_buf;
+  uint32_t payload_len;
+  if (conn_->MaybeCompressPayload(Slice(response_msg_buf_), sidecar_slices, &compressed_buf,
+                                  &payload_len)) {
+    // The sidecars are part of the compressed response now.
+    resp_hdr.set_uncompressed_payload_size(payload_len);
+    response_msg_buf_.swap(compressed_buf);
+    STLDeleteElements(&sidecars_);
+    additional_size = 0;
+  }
+
   int main_msg_size = additional_size + response_msg_buf_.size();
   serialization::SerializeHeader(resp_hdr, main_msg_size,
                                  &response_hdr_buf_);
@@ -188,6 +217,15 @@ Status InboundCall::AddRpcSidecar(gscoped_ptr<RpcSidecar> car, int* idx) {
   return Status::OK();
 }
 
+Status InboundCall::GetInboundSidecar(int idx, Slice* sidecar) const {
+  if (idx < 0 || idx >= header_.sidecar_offsets_size()) {
+    return Status::InvalidArgument(strings::Substitute(
+        "Index $0 does not reference a valid sidecar", idx));
+  }
+  *sidecar = inbound_sidecar_slices_[idx];
+  return Status::OK();
+}
+
 string InboundCall::ToString() const {
   if (header_.has_request_id()) {
     return Substitute("Call $0 from $1 (ReqId={client: $2, seq_no=$3, attempt_no=$4})",
@@ -280,6 +318,13 @@ MonoTime InboundCall::GetTimeReceived() const {
   return timing_.time_received;
 }
 
+MonoDelta InboundCall::GetTimeInQueue() const {
+  if (!timing_.time_handled.Initialized()) {
+    return MonoDelta::FromNanoseconds(0);
+  }
+  return timing_.time_handled - timing_.time_received;
+}
+
 vector<uint32_t> InboundCall::GetRequiredFeatures() const {
   vector<uint32_t> features;
   for (uint32_t feature : header_.required_feature_flags()) {
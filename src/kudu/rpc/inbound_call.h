@@ -126,6 +126,9 @@ class InboundCall {
   // See RpcContext::AddRpcSidecar()
   Status AddRpcSidecar(gscoped_ptr<RpcSidecar> car, int* idx);
 
+  // See RpcContext::GetInboundSidecar()
+  Status GetInboundSidecar(int idx, Slice* sidecar) const;
+
   std::string ToString() const;
 
   void DumpPB(const DumpRunningRpcsRequestPB& req, RpcCallInProgressPB* resp);
@@ -183,6 +186,10 @@ class InboundCall {
   // Return the time when this call was received.
   MonoTime GetTimeReceived() const;
 
+  // Return the time this call waited to be handled since it was received,
+  // or zero if it hasn't been handled yet.
+  MonoDelta GetTimeInQueue() const;
+
   // Returns the set of application-specific feature flags required to service
   // the RPC.
   std::vector<uint32_t> GetRequiredFeatures() const;
@@ -213,9 +220,18 @@ class InboundCall {
   RequestHeader header_;
 
   // The serialized bytes of the request param protobuf. Set by ParseFrom().
-  // This references memory held by 'transfer_'.
+  // This references memory held by 'transfer_', or by 'uncompressed_payload_'
+  // if the request was compressed.
   Slice serialized_request_;
 
+  // The sidecars sent with the request. Set by ParseFrom().
+  // These also reference memory held by 'transfer_' or 'uncompressed_payload_'.
+  Slice inbound_sidecar_slices_[OutboundTransfer::kMaxPayloadSlices];
+
+  // The uncompressed request param and sidecars, if the request was
+  // compressed. Set by ParseFrom().
+  faststring uncompressed_payload_;
+
   // The transfer that produced the call.
   // This is kept around because it retains the memory referred to
   // by 'serialized_request_' above.
@@ -18,6 +18,7 @@
 #include "kudu/rpc/messenger.h"
 
 #include <arpa/inet.h>
+#include <sched.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -25,15 +26,18 @@
 #include <boost/algorithm/string/predicate.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <algorithm>
 #include <list>
 #include <mutex>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/rpc/acceptor_pool.h"
 #include "kudu/rpc/connection.h"
 #include "kudu/rpc/constants.h"
@@ -58,6 +62,7 @@
 
 using std::string;
 using std::shared_ptr;
+using std::vector;
 using strings::Substitute;
 
 DEFINE_string(rpc_authentication, "optional",
@@ -103,6 +108,36 @@ DEFINE_int32(rpc_default_keepalive_time_ms, 65000,
              "will disconnect the client.");
 TAG_FLAG(rpc_default_keepalive_time_ms, advanced);
 
+DEFINE_int32(rpc_compression_min_bytes, 0,
+             "Minimum size, in bytes, of the RPC messages, including their sidecars, "
+             "which are LZ4-compressed on the wire. Only messages exchanged with peers "
+             "which enable compression as well are compressed. Compression helps "
+             "bandwidth-limited links, such as those between datacenters, at the "
+             "cost of CPU time. 0 disables compression.");
+TAG_FLAG(rpc_compression_min_bytes, advanced);
+TAG_FLAG(rpc_compression_min_bytes, experimental);
+
+METRIC_DEFINE_counter(server, rpc_compression_payload_bytes,
+                      "RPC Compressed Payload Bytes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes of the RPC messages and sidecars which were large "
+                      "enough to be compressed, before compression. Together with "
+                      "rpc_compression_wire_bytes, this gives the compression ratio.");
+METRIC_DEFINE_counter(server, rpc_compression_wire_bytes,
+                      "RPC Compressed Wire Bytes",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes sent on the wire for the RPC messages and sidecars "
+                      "which were large enough to be compressed. Payloads which don't "
+                      "shrink are sent uncompressed and counted as is.");
+
+METRIC_DEFINE_histogram(server, rpc_outbound_transfers_per_write,
+                        "RPC Transfers per Write",
+                        kudu::MetricUnit::kMessages,
+                        "Number of RPC requests and responses sent with each write to "
+                        "a connection's socket. Its mean is the average number of "
+                        "messages per write syscall.",
+                        1024, 2);
+
 DECLARE_string(keytab_file);
 
 namespace kudu {
@@ -111,6 +146,31 @@ namespace rpc {
 class Messenger;
 class ServerBuilder;
 
+// Returns the CPUs which this process may run on.
+static vector<int> GetAllowedCpus() {
+  vector<int> cpus;
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        cpus.push_back(cpu);
+      }
+    }
+  } else {
+    int err = errno;
+    LOG(WARNING) << "could not get the CPU affinity of the process: " << ErrnoToString(err);
+  }
+#endif
+  if (cpus.empty()) {
+    for (int cpu = 0; cpu < base::NumCPUs(); cpu++) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
 template <typename T>
 static Status ParseTriState(const char* flag_name, const string& flag_value, T* tri_state) {
   if (boost::iequals(flag_value, "required")) {
@@ -183,6 +243,9 @@ MessengerBuilder::MessengerBuilder(std::string name)
       connection_keepalive_time_(
           MonoDelta::FromMilliseconds(FLAGS_rpc_default_keepalive_time_ms)),
       num_reactors_(4),
+      reactor_per_core_(false),
+      compression_min_bytes_(FLAGS_rpc_compression_min_bytes),
+      num_connections_per_server_(1),
       min_negotiation_threads_(0),
       max_negotiation_threads_(4),
       coarse_timer_granularity_(MonoDelta::FromMilliseconds(100)),
@@ -199,6 +262,11 @@ MessengerBuilder& MessengerBuilder::set_num_reactors(int num_reactors) {
   return *this;
 }
 
+MessengerBuilder& MessengerBuilder::set_reactor_per_core(bool reactor_per_core) {
+  reactor_per_core_ = reactor_per_core;
+  return *this;
+}
+
 MessengerBuilder& MessengerBuilder::set_min_negotiation_threads(int min_negotiation_threads) {
   min_negotiation_threads_ = min_negotiation_threads;
   return *this;
@@ -214,6 +282,17 @@ MessengerBuilder& MessengerBuilder::set_coarse_timer_granularity(const MonoDelta
   return *this;
 }
 
+MessengerBuilder& MessengerBuilder::set_compression_min_bytes(int compression_min_bytes) {
+  compression_min_bytes_ = compression_min_bytes;
+  return *this;
+}
+
+MessengerBuilder& MessengerBuilder::set_num_connections_per_server(
+    int num_connections_per_server) {
+  num_connections_per_server_ = num_connections_per_server;
+  return *this;
+}
+
 MessengerBuilder &MessengerBuilder::set_metric_entity(
     const scoped_refptr<MetricEntity>& metric_entity) {
   metric_entity_ = metric_entity;
@@ -316,13 +395,29 @@ Status Messenger::AddAcceptorPool(const Sockaddr &accept_addr,
                           "GSSAPI/Kerberos not properly configured");
   }
 
-  Socket sock;
-  RETURN_NOT_OK(sock.Init(0));
-  RETURN_NOT_OK(sock.SetReuseAddr(true));
-  RETURN_NOT_OK(sock.Bind(accept_addr));
-  Sockaddr remote;
-  RETURN_NOT_OK(sock.GetSocketAddress(&remote));
-  shared_ptr<AcceptorPool> acceptor_pool(new AcceptorPool(this, &sock, remote));
+  // With a reactor per core, each reactor gets its own listening socket, so
+  // that connections are accepted and served without crossing cores. Only
+  // Linux balances connections across SO_REUSEPORT sockets.
+  int num_sockets = 1;
+#if defined(__linux__)
+  if (reactor_per_core_) {
+    num_sockets = reactors_.size();
+  }
+#endif
+  vector<Socket> socks(num_sockets);
+  Sockaddr remote = accept_addr;
+  for (Socket& sock : socks) {
+    RETURN_NOT_OK(sock.Init(0));
+    RETURN_NOT_OK(sock.SetReuseAddr(true));
+    if (num_sockets > 1) {
+      RETURN_NOT_OK(sock.SetReusePort(true));
+    }
+    // If 'accept_addr' has port 0, the other sockets bind to the port picked
+    // for the first one.
+    RETURN_NOT_OK(sock.Bind(remote));
+    RETURN_NOT_OK(sock.GetSocketAddress(&remote));
+  }
+  shared_ptr<AcceptorPool> acceptor_pool(new AcceptorPool(this, &socks, remote));
 
   std::lock_guard<percpu_rwlock> guard(lock_);
   acceptor_pools_.push_back(acceptor_pool);
@@ -360,7 +455,12 @@ Status Messenger::UnregisterService(const string& service_name) {
 }
 
 void Messenger::QueueOutboundCall(const shared_ptr<OutboundCall> &call) {
-  Reactor *reactor = RemoteToReactor(call->conn_id().remote());
+  if (num_connections_per_server_ > 1) {
+    call->set_connection_idx(
+        next_connection_idx_.fetch_add(1, std::memory_order_relaxed) %
+        num_connections_per_server_);
+  }
+  Reactor *reactor = RemoteToReactor(call->conn_id().remote(), call->conn_id().idx());
   reactor->QueueOutboundCall(call);
 }
 
@@ -387,18 +487,42 @@ void Messenger::RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote
   reactor->RegisterInboundSocket(new_socket, remote);
 }
 
+void Messenger::RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote,
+                                      int reactor_idx) {
+  DCHECK_LT(reactor_idx, num_reactors());
+  reactors_[reactor_idx]->RegisterInboundSocket(new_socket, remote);
+}
+
 Messenger::Messenger(const MessengerBuilder &bld)
   : name_(bld.name_),
     closing_(false),
     authentication_(RpcAuthentication::REQUIRED),
     encryption_(RpcEncryption::REQUIRED),
+    reactor_per_core_(bld.reactor_per_core_),
+    compression_min_bytes_(bld.compression_min_bytes_),
+    num_connections_per_server_(std::max(bld.num_connections_per_server_, 1)),
+    next_connection_idx_(0),
     tls_context_(new security::TlsContext()),
     token_verifier_(new security::TokenVerifier()),
     rpcz_store_(new RpczStore()),
     metric_entity_(bld.metric_entity_),
     retain_self_(this) {
-  for (int i = 0; i < bld.num_reactors_; i++) {
-    reactors_.push_back(new Reactor(retain_self_, i, bld));
+  if (metric_entity_) {
+    rpc_compression_payload_bytes_ =
+        METRIC_rpc_compression_payload_bytes.Instantiate(metric_entity_);
+    rpc_compression_wire_bytes_ = METRIC_rpc_compression_wire_bytes.Instantiate(metric_entity_);
+    rpc_outbound_transfers_per_write_ =
+        METRIC_rpc_outbound_transfers_per_write.Instantiate(metric_entity_);
+  }
+  if (reactor_per_core_) {
+    vector<int> cpus = GetAllowedCpus();
+    for (int i = 0; i < static_cast<int>(cpus.size()); i++) {
+      reactors_.push_back(new Reactor(retain_self_, i, cpus[i], bld));
+    }
+  } else {
+    for (int i = 0; i < bld.num_reactors_; i++) {
+      reactors_.push_back(new Reactor(retain_self_, i, -1, bld));
+    }
   }
   CHECK_OK(ThreadPoolBuilder("negotiator")
               .set_min_threads(bld.min_negotiation_threads_)
@@ -412,9 +536,11 @@ Messenger::~Messenger() {
   STLDeleteElements(&reactors_);
 }
 
-Reactor* Messenger::RemoteToReactor(const Sockaddr &remote) {
+Reactor* Messenger::RemoteToReactor(const Sockaddr &remote, int conn_idx) {
   uint32_t hashCode = remote.HashCode();
-  int reactor_idx = hashCode % reactors_.size();
+  // The connections to a remote go to consecutive reactors, so that they
+  // share the load of the remote's calls.
+  int reactor_idx = (hashCode + conn_idx) % reactors_.size();
   // This is just a static partitioning; we could get a lot
   // fancier with assigning Sockaddrs to Reactors.
   return reactors_[reactor_idx];
@@ -429,6 +555,19 @@ Status Messenger::Init() {
   return Status::OK();
 }
 
+void Messenger::RecordPayloadCompression(size_t payload_len, size_t wire_len) const {
+  if (rpc_compression_payload_bytes_) {
+    rpc_compression_payload_bytes_->IncrementBy(payload_len);
+    rpc_compression_wire_bytes_->IncrementBy(wire_len);
+  }
+}
+
+void Messenger::RecordOutboundWrite(int num_transfers) const {
+  if (rpc_outbound_transfers_per_write_) {
+    rpc_outbound_transfers_per_write_->Increment(num_transfers);
+  }
+}
+
 Status Messenger::DumpRunningRpcs(const DumpRunningRpcsRequestPB& req,
                                   DumpRunningRpcsResponsePB* resp) {
   shared_lock<rw_spinlock> guard(lock_.get_lock());
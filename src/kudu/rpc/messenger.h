@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <list>
 #include <memory>
 #include <string>
@@ -103,6 +104,12 @@ class MessengerBuilder {
   // receiving.
   MessengerBuilder &set_num_reactors(int num_reactors);
 
+  // Run one reactor thread per CPU which the process may run on, pinned to
+  // that CPU, rather than the number set by set_num_reactors(). On Linux,
+  // each acceptor pool then listens on one SO_REUSEPORT socket per reactor,
+  // and the kernel spreads inbound connections across them.
+  MessengerBuilder &set_reactor_per_core(bool reactor_per_core);
+
   // Set the minimum number of connection-negotiation threads that will be used
   // to handle the blocking connection-negotiation step.
   MessengerBuilder &set_min_negotiation_threads(int min_negotiation_threads);
@@ -114,6 +121,17 @@ class MessengerBuilder {
   // Set the granularity with which connections are checked for keepalive.
   MessengerBuilder &set_coarse_timer_granularity(const MonoDelta &granularity);
 
+  // Set the minimum size of the call payloads, i.e. messages and their
+  // sidecars, which are LZ4-compressed on the wire. 0 disables compression.
+  // Payloads are only compressed on connections to peers which enable
+  // compression too. Defaults to --rpc_compression_min_bytes.
+  MessengerBuilder &set_compression_min_bytes(int compression_min_bytes);
+
+  // Set the number of connections opened to each remote server, for each set
+  // of user credentials. Outbound calls are spread over these connections
+  // round-robin, and the connections over the reactors. Defaults to 1.
+  MessengerBuilder &set_num_connections_per_server(int num_connections_per_server);
+
   // Set metric entity for use by RPC systems.
   MessengerBuilder &set_metric_entity(const scoped_refptr<MetricEntity>& metric_entity);
 
@@ -126,6 +144,9 @@ class MessengerBuilder {
   const std::string name_;
   MonoDelta connection_keepalive_time_;
   int num_reactors_;
+  bool reactor_per_core_;
+  int compression_min_bytes_;
+  int num_connections_per_server_;
   int min_negotiation_threads_;
   int max_negotiation_threads_;
   MonoDelta coarse_timer_granularity_;
@@ -195,6 +216,10 @@ class Messenger {
   // Take ownership of the socket via Socket::Release
   void RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote);
 
+  // Like the above, but hands the connection to the reactor with index
+  // 'reactor_idx' rather than the one 'remote' hashes to.
+  void RegisterInboundSocket(Socket *new_socket, const Sockaddr &remote, int reactor_idx);
+
   // Dump the current RPCs into the given protobuf.
   Status DumpRunningRpcs(const DumpRunningRpcsRequestPB& req,
                          DumpRunningRpcsResponsePB* resp);
@@ -230,6 +255,17 @@ class Messenger {
 
   int num_reactors() const { return reactors_.size(); }
 
+  // See MessengerBuilder::set_compression_min_bytes().
+  int compression_min_bytes() const { return compression_min_bytes_; }
+
+  // Records that a call payload of 'payload_len' bytes was sent as
+  // 'wire_len' bytes because it was large enough to be compressed.
+  void RecordPayloadCompression(size_t payload_len, size_t wire_len) const;
+
+  // Records that one write to a socket sent 'num_transfers' requests and
+  // responses.
+  void RecordOutboundWrite(int num_transfers) const;
+
   std::string name() const {
     return name_;
   }
@@ -245,10 +281,13 @@ class Messenger {
 
  private:
   FRIEND_TEST(TestRpc, TestConnectionKeepalive);
+  FRIEND_TEST(TestRpc, TestMultipleConnectionsPerServer);
 
   explicit Messenger(const MessengerBuilder &bld);
 
-  Reactor* RemoteToReactor(const Sockaddr &remote);
+  // Returns the reactor which handles the connection with index 'conn_idx' to
+  // 'remote'.
+  Reactor* RemoteToReactor(const Sockaddr &remote, int conn_idx = 0);
   Status Init();
   void RunTimeoutThread();
   void UpdateCurTime();
@@ -271,6 +310,18 @@ class Messenger {
   RpcAuthentication authentication_;
   RpcEncryption encryption_;
 
+  // Whether there's one reactor per CPU. See
+  // MessengerBuilder::set_reactor_per_core().
+  const bool reactor_per_core_;
+
+  const int compression_min_bytes_;
+
+  // See MessengerBuilder::set_num_connections_per_server().
+  const int num_connections_per_server_;
+
+  // Used to pick the connection for the next outbound call round-robin.
+  std::atomic<uint32_t> next_connection_idx_;
+
   // Pools which are listening on behalf of this messenger.
   // Note that the user may have called Shutdown() on one of these
   // pools, so even though we retain the reference, it may no longer
@@ -297,6 +348,15 @@ class Messenger {
 
   scoped_refptr<MetricEntity> metric_entity_;
 
+  // The sizes of the call payloads which were large enough to be compressed,
+  // before and after compression. Unset if there's no metric entity.
+  scoped_refptr<Counter> rpc_compression_payload_bytes_;
+  scoped_refptr<Counter> rpc_compression_wire_bytes_;
+
+  // The number of transfers sent with each socket write. Unset if there's no
+  // metric entity.
+  scoped_refptr<Histogram> rpc_outbound_transfers_per_write_;
+
   // The ownership of the Messenger object is somewhat subtle. The pointer graph
   // looks like this:
   //
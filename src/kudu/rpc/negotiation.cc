@@ -180,6 +180,9 @@ static Status DoClientNegotiation(Connection* conn, MonoTime deadline) {
   }
 
   RETURN_NOT_OK(client_negotiation.EnablePlain(conn->local_user_credentials().real_user(), ""));
+  if (messenger->compression_min_bytes() > 0) {
+    client_negotiation.EnableCompression();
+  }
   client_negotiation.set_deadline(deadline);
 
   RETURN_NOT_OK(WaitForClientConnect(client_negotiation.socket(), deadline));
@@ -215,6 +218,9 @@ static Status DoServerNegotiation(Connection* conn, const MonoTime& deadline) {
   } else {
     RETURN_NOT_OK(server_negotiation.EnableGSSAPI());
   }
+  if (messenger->compression_min_bytes() > 0) {
+    server_negotiation.EnableCompression();
+  }
   server_negotiation.set_deadline(deadline);
 
   RETURN_NOT_OK(server_negotiation.socket()->SetNonBlocking(false));
@@ -26,9 +26,11 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/rpc/outbound_call.h"
+#include "kudu/rpc/connection.h"
 #include "kudu/rpc/constants.h"
 #include "kudu/rpc/rpc_controller.h"
 #include "kudu/rpc/rpc_introspection.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/rpc/serialization.h"
 #include "kudu/rpc/transfer.h"
 #include "kudu/util/flag_tags.h"
@@ -87,9 +89,8 @@ OutboundCall::~OutboundCall() {
   DVLOG(4) << "OutboundCall " << this << " destroyed with state_: " << StateName(state_);
 }
 
-Status OutboundCall::SerializeTo(vector<Slice>* slices) {
-  size_t param_len = request_buf_.size();
-  if (PREDICT_FALSE(param_len == 0)) {
+Status OutboundCall::SerializeTo(const Connection* conn, vector<Slice>* slices) {
+  if (PREDICT_FALSE(request_buf_.size() == 0)) {
     return Status::InvalidArgument("Must call SetRequestParam() before SerializeTo()");
   }
 
@@ -102,16 +103,48 @@ Status OutboundCall::SerializeTo(vector<Slice>* slices) {
     header_.add_required_feature_flags(feature);
   }
 
+  vector<Slice> sidecar_slices;
+  sidecar_slices.reserve(sidecars_.size());
+  for (const auto& car : sidecars_) {
+    sidecar_slices.push_back(car->AsSlice());
+  }
+  faststring compressed_buf;
+  uint32_t payload_len;
+  if (conn->MaybeCompressPayload(Slice(request_buf_), sidecar_slices, &compressed_buf,
+                                 &payload_len)) {
+    // The sidecars are part of the compressed request now.
+    header_.set_uncompressed_payload_size(payload_len);
+    request_buf_.swap(compressed_buf);
+    sidecars_.clear();
+  }
+
+  size_t param_len = request_buf_.size();
+  for (const auto& car : sidecars_) {
+    param_len += car->AsSlice().size();
+  }
   serialization::SerializeHeader(header_, param_len, &header_buf_);
 
   // Return the concatenated packet.
+  slices->reserve(slices->size() + 2 + sidecars_.size());
   slices->push_back(Slice(header_buf_));
   slices->push_back(Slice(request_buf_));
+  for (const auto& car : sidecars_) {
+    slices->push_back(car->AsSlice());
+  }
   return Status::OK();
 }
 
 void OutboundCall::SetRequestParam(const Message& message) {
-  serialization::SerializeMessage(message, &request_buf_);
+  sidecars_ = std::move(controller_->outbound_sidecars_);
+  controller_->outbound_sidecars_.clear();
+  uint32_t protobuf_msg_size = message.ByteSize();
+  uint32_t absolute_sidecar_offset = protobuf_msg_size;
+  for (const auto& car : sidecars_) {
+    header_.add_sidecar_offsets(absolute_sidecar_offset);
+    absolute_sidecar_offset += car->AsSlice().size();
+  }
+  int additional_size = absolute_sidecar_offset - protobuf_msg_size;
+  serialization::SerializeMessage(message, &request_buf_, additional_size, true);
 }
 
 Status OutboundCall::status() const {
@@ -357,13 +390,14 @@ void OutboundCall::DumpPB(const DumpRunningRpcsRequestPB& req,
 /// ConnectionId
 ///
 
-ConnectionId::ConnectionId() {}
+ConnectionId::ConnectionId() : idx_(0) {}
 
 ConnectionId::ConnectionId(const ConnectionId& other) {
   DoCopyFrom(other);
 }
 
-ConnectionId::ConnectionId(const Sockaddr& remote, UserCredentials user_credentials) {
+ConnectionId::ConnectionId(const Sockaddr& remote, UserCredentials user_credentials)
+    : idx_(0) {
   remote_ = remote;
   user_credentials_ = std::move(user_credentials);
 }
@@ -382,26 +416,30 @@ void ConnectionId::CopyFrom(const ConnectionId& other) {
 
 string ConnectionId::ToString() const {
   // Does not print the password.
-  return StringPrintf("{remote=%s, user_credentials=%s}",
+  return StringPrintf("{remote=%s, user_credentials=%s, idx=%d}",
       remote_.ToString().c_str(),
-      user_credentials_.ToString().c_str());
+      user_credentials_.ToString().c_str(),
+      idx_);
 }
 
 void ConnectionId::DoCopyFrom(const ConnectionId& other) {
   remote_ = other.remote_;
   user_credentials_ = other.user_credentials_;
+  idx_ = other.idx_;
 }
 
 size_t ConnectionId::HashCode() const {
   size_t seed = 0;
   boost::hash_combine(seed, remote_.HashCode());
   boost::hash_combine(seed, user_credentials_.HashCode());
+  boost::hash_combine(seed, idx_);
   return seed;
 }
 
 bool ConnectionId::Equals(const ConnectionId& other) const {
   return (remote() == other.remote()
-       && user_credentials().Equals(other.user_credentials()));
+       && user_credentials().Equals(other.user_credentials())
+       && idx() == other.idx());
 }
 
 size_t ConnectionIdHash::operator() (const ConnectionId& conn_id) const {
@@ -436,41 +474,16 @@ Status CallResponse::ParseFrom(gscoped_ptr<InboundTransfer> transfer) {
   RETURN_NOT_OK(serialization::ParseMessage(transfer->data(), &header_,
                                             &entire_message));
 
-  // Use information from header to extract the payload slices.
-  int last = header_.sidecar_offsets_size() - 1;
-
-  if (last >= OutboundTransfer::kMaxPayloadSlices) {
-    return Status::Corruption(strings::Substitute(
-        "Received $0 additional payload slices, expected at most %d",
-        last, OutboundTransfer::kMaxPayloadSlices));
+  if (header_.has_uncompressed_payload_size()) {
+    RETURN_NOT_OK(serialization::UncompressPayload(entire_message,
+                                                   header_.uncompressed_payload_size(),
+                                                   &uncompressed_payload_));
+    entire_message = Slice(uncompressed_payload_);
   }
 
-  if (last >= 0) {
-    serialized_response_ = Slice(entire_message.data(),
-                                 header_.sidecar_offsets(0));
-    for (int i = 0; i < last; ++i) {
-      uint32_t next_offset = header_.sidecar_offsets(i);
-      int32_t len = header_.sidecar_offsets(i + 1) - next_offset;
-      if (next_offset + len > entire_message.size() || len < 0) {
-        return Status::Corruption(strings::Substitute(
-            "Invalid sidecar offsets; sidecar $0 apparently starts at $1,"
-            " has length $2, but the entire message has length $3",
-            i, next_offset, len, entire_message.size()));
-      }
-      sidecar_slices_[i] = Slice(entire_message.data() + next_offset, len);
-    }
-    uint32_t next_offset = header_.sidecar_offsets(last);
-    if (next_offset > entire_message.size()) {
-        return Status::Corruption(strings::Substitute(
-            "Invalid sidecar offsets; the last sidecar ($0) apparently starts "
-            "at $1, but the entire message has length $3",
-            last, next_offset, entire_message.size()));
-    }
-    sidecar_slices_[last] = Slice(entire_message.data() + next_offset,
-                                  entire_message.size() - next_offset);
-  } else {
-    serialized_response_ = entire_message;
-  }
+  // Use information from header to extract the payload slices.
+  RETURN_NOT_OK(RpcSidecar::ParseSidecars(header_.sidecar_offsets(), entire_message,
+                                          &serialized_response_, sidecar_slices_));
 
   transfer_.swap(transfer);
   parsed_ = true;
@@ -17,6 +17,7 @@
 #ifndef KUDU_RPC_CLIENT_CALL_H
 #define KUDU_RPC_CLIENT_CALL_H
 
+#include <memory>
 #include <set>
 #include <string>
 #include <vector>
@@ -52,6 +53,7 @@ class DumpRunningRpcsRequestPB;
 class InboundTransfer;
 class RpcCallInProgressPB;
 class RpcController;
+class RpcSidecar;
 
 
 // Used to key on Connection information.
@@ -76,6 +78,11 @@ class ConnectionId {
   const UserCredentials& user_credentials() const { return user_credentials_; }
   UserCredentials* mutable_user_credentials() { return &user_credentials_; }
 
+  // The index of the connection among those to the same remote with the same
+  // credentials. See MessengerBuilder::set_num_connections_per_server().
+  void set_idx(int idx) { idx_ = idx; }
+  int idx() const { return idx_; }
+
   // Copy state from another object to this one.
   void CopyFrom(const ConnectionId& other);
 
@@ -89,6 +96,7 @@ class ConnectionId {
   // Remember to update HashCode() and Equals() when new fields are added.
   Sockaddr remote_;
   UserCredentials user_credentials_;
+  int idx_;
 
   // Implementation of CopyFrom that can be shared with copy constructor.
   void DoCopyFrom(const ConnectionId& other);
@@ -127,7 +135,8 @@ class OutboundCall {
   // Serialize the given request PB into this call's internal storage.
   //
   // Because the data is fully serialized by this call, 'req' may be
-  // subsequently mutated with no ill effects.
+  // subsequently mutated with no ill effects. The sidecars added to the
+  // controller are moved into the call, to be sent after 'req'.
   void SetRequestParam(const google::protobuf::Message& req);
 
   // Assign the call ID for this call. This is called from the reactor
@@ -137,9 +146,10 @@ class OutboundCall {
     header_.set_call_id(call_id);
   }
 
-  // Serialize the call for the wire. Requires that SetRequestParam()
-  // is called first. This is called from the Reactor thread.
-  Status SerializeTo(std::vector<Slice>* slices);
+  // Serialize the call for the wire, to be sent on 'conn', which may compress
+  // the payload. Requires that SetRequestParam() is called first. This is
+  // called from the Reactor thread.
+  Status SerializeTo(const Connection* conn, std::vector<Slice>* slices);
 
   // Callback after the call has been put on the outbound connection queue.
   void SetQueued();
@@ -182,6 +192,10 @@ class OutboundCall {
   ////////////////////////////////////////////////////////////
 
   const ConnectionId& conn_id() const { return conn_id_; }
+
+  // Select the connection to the remote which the call is sent on. Must be
+  // called before the call is queued on a reactor.
+  void set_connection_idx(int idx) { conn_id_.set_idx(idx); }
   const RemoteMethod& remote_method() const { return remote_method_; }
   const ResponseCallback &callback() const { return callback_; }
   RpcController* controller() { return controller_; }
@@ -265,6 +279,9 @@ class OutboundCall {
   faststring header_buf_;
   faststring request_buf_;
 
+  // The sidecars sent after the request. See RpcController::AddOutboundSidecar().
+  std::vector<std::unique_ptr<RpcSidecar>> sidecars_;
+
   // Once a response has been received for this call, contains that response.
   // Otherwise NULL.
   gscoped_ptr<CallResponse> call_response_;
@@ -318,12 +335,17 @@ class CallResponse {
   ResponseHeader header_;
 
   // The slice of data for the encoded protobuf response.
-  // This slice refers to memory allocated by transfer_
+  // This slice refers to memory allocated by transfer_, or by
+  // uncompressed_payload_ if the response was compressed.
   Slice serialized_response_;
 
-  // Slices of data for rpc sidecars. They point into memory owned by transfer_.
+  // Slices of data for rpc sidecars. They point into memory owned by transfer_,
+  // or by uncompressed_payload_.
   Slice sidecar_slices_[OutboundTransfer::kMaxPayloadSlices];
 
+  // The uncompressed message and sidecars, if the response was compressed.
+  faststring uncompressed_payload_;
+
   // The incoming transfer data - retained because serialized_response_
   // and sidecar_slices_ refer into its data.
   gscoped_ptr<InboundTransfer> transfer_;
@@ -209,6 +209,7 @@ class MethodSubstitutions : public Substituter {
     bool track_result = static_cast<bool>(method_->options().GetExtension(track_rpc_result));
     (*map)["track_result"] = track_result ? " true" : "false";
     (*map)["authz_method"] = GetAuthzMethod(*method_).get_value_or("AuthorizeAllowAll");
+    (*map)["priority"] = RpcPriority_Name(method_->options().GetExtension(rpc_priority));
   }
 
   // Strips the package from method arguments if they are in the same package as
@@ -512,6 +513,7 @@ class CodeGenerator : public ::google::protobuf::compiler::CodeGenerator {
               "                           ctx);\n"
               "    };\n"
               "    mi->track_result = $track_result$;\n"
+              "    mi->priority = ::kudu::rpc::$priority$;\n"
               "    mi->handler_latency_histogram =\n"
               "        METRIC_handler_latency_$rpc_full_name_plainchars$.Instantiate(entity);\n"
               "    mi->func = [this](const Message* req, Message* resp, RpcContext* ctx) {\n"
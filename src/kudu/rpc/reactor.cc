@@ -19,6 +19,8 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <sys/socket.h>
 #include <sys/types.h>
@@ -312,6 +314,18 @@ bool ReactorThread::IsCurrentThread() const {
 void ReactorThread::RunThread() {
   ThreadRestrictions::SetWaitAllowed(false);
   ThreadRestrictions::SetIOAllowed(false);
+#if defined(__linux__)
+  if (reactor_->cpu() >= 0) {
+    // Keep the connections of this reactor, and the calls read from them, in
+    // the caches of one core.
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(reactor_->cpu(), &cpus);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    LOG_IF(WARNING, err != 0) << name() << ": could not pin reactor thread to CPU "
+                              << reactor_->cpu() << ": " << ErrnoToString(err);
+  }
+#endif
   DVLOG(6) << "Calling ReactorThread::RunThread()...";
   loop_.run(0);
   VLOG(1) << name() << " thread exiting.";
@@ -345,6 +359,7 @@ Status ReactorThread::FindOrStartConnection(const ConnectionId& conn_id,
   // Register the new connection in our map.
   *conn = new Connection(this, conn_id.remote(), std::move(new_socket), Connection::CLIENT);
   (*conn)->set_local_user_credentials(conn_id.user_credentials());
+  (*conn)->set_idx(conn_id.idx());
 
   // Kick off blocking client connection negotiation.
   Status s = StartConnectionNegotiation(*conn);
@@ -436,6 +451,7 @@ void ReactorThread::DestroyConnection(Connection *conn,
   // Unlink connection from lists.
   if (conn->direction() == Connection::CLIENT) {
     ConnectionId conn_id(conn->remote(), conn->local_user_credentials());
+    conn_id.set_idx(conn->idx());
     auto it = client_conns_.find(conn_id);
     CHECK(it != client_conns_.end()) << "Couldn't find connection " << conn->ToString();
     client_conns_.erase(it);
@@ -491,9 +507,10 @@ void DelayedTask::TimerHandler(ev::timer& watcher, int revents) {
 }
 
 Reactor::Reactor(shared_ptr<Messenger> messenger,
-                 int index, const MessengerBuilder& bld)
+                 int index, int cpu, const MessengerBuilder& bld)
     : messenger_(std::move(messenger)),
       name_(StringPrintf("%s_R%03d", messenger_->name().c_str(), index)),
+      cpu_(cpu),
       closing_(false),
       thread_(this, bld) {
 }
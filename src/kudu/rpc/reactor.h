@@ -161,6 +161,9 @@ class ReactorThread {
   // This may be called from another thread.
   const std::string &name() const;
 
+  // The CPU which the reactor thread is pinned to, or -1 if it isn't pinned.
+  int cpu() const { return cpu_; }
+
   MonoTime cur_time() const;
 
   // This may be called from another thread.
@@ -269,8 +272,10 @@ class ReactorThread {
 // A Reactor manages a ReactorThread
 class Reactor {
  public:
+  // If 'cpu' is non-negative, the reactor thread is pinned to that CPU.
   Reactor(std::shared_ptr<Messenger> messenger,
           int index,
+          int cpu,
           const MessengerBuilder &bld);
   Status Init();
 
@@ -335,6 +340,8 @@ class Reactor {
 
   const std::string name_;
 
+  const int cpu_;
+
   // Whether the reactor is shutting down.
   // Guarded by lock_.
   bool closing_;
@@ -15,47 +15,140 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <fstream>
 #include <functional>
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <thread>
+#include <vector>
 
 #include "kudu/gutil/atomicops.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/rpc-test-base.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/rpc/rtest.proxy.h"
 #include "kudu/util/countdown_latch.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/jsonwriter.h"
 #include "kudu/util/test_util.h"
 
 using std::bind;
+using std::ofstream;
+using std::ostringstream;
 using std::shared_ptr;
 using std::string;
 using std::thread;
 using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
-DEFINE_int32(client_threads, 16,
-             "Number of client threads. For the synchronous benchmark, each thread has "
-             "a single outstanding synchronous request at a time. For the async "
-             "benchmark, this determines the number of client reactors.");
+// Each of the flags below which takes a list makes the benchmark sweep over
+// its values: every test runs once per combination of them.
 
-DEFINE_int32(async_call_concurrency, 60,
-             "Number of concurrent requests that will be outstanding at a time for the "
-             "async benchmark. The requests are multiplexed across the number of "
-             "reactors specified by the 'client_threads' flag.");
+DEFINE_string(client_threads, "16",
+              "Comma-separated list of numbers of client threads. For the synchronous "
+              "benchmark, each thread has a single outstanding synchronous request at a "
+              "time. For the async benchmark, this determines the number of client "
+              "reactors.");
 
-DEFINE_int32(worker_threads, 1,
-             "Number of server worker threads");
+DEFINE_string(async_call_concurrency, "60",
+              "Comma-separated list of numbers of concurrent requests that will be "
+              "outstanding at a time for the async benchmark. The requests are "
+              "multiplexed across the number of reactors specified by the "
+              "'client_threads' flag.");
 
-DEFINE_int32(server_reactors, 4,
-             "Number of server reactor threads");
+DEFINE_string(connections_per_server, "1",
+              "Comma-separated list of numbers of connections each client messenger "
+              "opens to the server.");
 
-DEFINE_int32(run_seconds, 1, "Seconds to run the test");
+DEFINE_string(payload_bytes, "0",
+              "Comma-separated list of sizes of the payload carried in each request, "
+              "and echoed back in each response.");
+
+DEFINE_string(sidecars, "0",
+              "Comma-separated list of numbers of sidecars attached to each request.");
+
+DEFINE_int32(sidecar_bytes, 1024, "Size of each request sidecar");
+
+DEFINE_string(worker_threads, "1",
+              "Comma-separated list of numbers of server worker threads");
+
+DEFINE_string(server_reactors, "4",
+              "Comma-separated list of numbers of server reactor threads");
+
+DEFINE_string(enable_tls, "false",
+              "Comma-separated list of whether to encrypt the connections with TLS");
+
+DEFINE_int32(run_seconds, 1, "Seconds to run each benchmark configuration");
+
+DEFINE_string(results_file, "",
+              "If set, the results of each benchmark configuration are appended to "
+              "this file as a line of JSON, besides being logged.");
 
 namespace kudu {
 namespace rpc {
 
+namespace {
+
+vector<int> ParseIntList(const string& flag_name, const string& value) {
+  vector<int> ret;
+  vector<string> elems = strings::Split(value, ",", strings::SkipEmpty());
+  for (const string& elem : elems) {
+    int i;
+    CHECK(safe_strto32(elem, &i) && i >= 0)
+        << "invalid value '" << elem << "' in --" << flag_name;
+    ret.push_back(i);
+  }
+  CHECK(!ret.empty()) << "--" << flag_name << " may not be empty";
+  return ret;
+}
+
+vector<bool> ParseBoolList(const string& flag_name, const string& value) {
+  vector<bool> ret;
+  vector<string> elems = strings::Split(value, ",", strings::SkipEmpty());
+  for (const string& elem : elems) {
+    if (elem == "true") {
+      ret.push_back(true);
+    } else if (elem == "false") {
+      ret.push_back(false);
+    } else {
+      LOG(FATAL) << "invalid value '" << elem << "' in --" << flag_name;
+    }
+  }
+  CHECK(!ret.empty()) << "--" << flag_name << " may not be empty";
+  return ret;
+}
+
+} // anonymous namespace
+
+// One point of the benchmark's parameter space.
+struct BenchConfig {
+  bool sync;
+  int client_threads;
+  // The number of outstanding calls. Equal to 'client_threads' when 'sync'.
+  int concurrency;
+  int connections_per_server;
+  int payload_bytes;
+  int sidecars;
+  int worker_threads;
+  int server_reactors;
+  bool enable_tls;
+
+  string ToString() const {
+    return Substitute("$0 client_threads=$1 concurrency=$2 connections=$3 "
+                      "payload_bytes=$4 sidecars=$5 worker_threads=$6 "
+                      "server_reactors=$7 tls=$8",
+                      sync ? "sync" : "async", client_threads, concurrency,
+                      connections_per_server, payload_bytes, sidecars,
+                      worker_threads, server_reactors, enable_tls);
+  }
+};
+
 class RpcBench : public RpcTestBase {
  public:
   RpcBench()
@@ -64,37 +157,145 @@ class RpcBench : public RpcTestBase {
   {}
 
   void SetUp() override {
+    RpcTestBase::SetUp();
     OverrideFlagForSlowTests("run_seconds", "10");
+  }
 
-    n_worker_threads_ = FLAGS_worker_threads;
-    n_server_reactor_threads_ = FLAGS_server_reactors;
+  // Returns every combination of the values of the sweep flags.
+  static vector<BenchConfig> AllConfigs(bool sync) {
+    vector<BenchConfig> configs;
+    for (int client_threads : ParseIntList("client_threads", FLAGS_client_threads)) {
+      vector<int> concurrencies = sync ?
+          vector<int>{ client_threads } :
+          ParseIntList("async_call_concurrency", FLAGS_async_call_concurrency);
+      for (int concurrency : concurrencies) {
+        for (int conns : ParseIntList("connections_per_server", FLAGS_connections_per_server)) {
+          for (int payload : ParseIntList("payload_bytes", FLAGS_payload_bytes)) {
+            for (int sidecars : ParseIntList("sidecars", FLAGS_sidecars)) {
+              for (int workers : ParseIntList("worker_threads", FLAGS_worker_threads)) {
+                for (int reactors : ParseIntList("server_reactors", FLAGS_server_reactors)) {
+                  for (bool tls : ParseBoolList("enable_tls", FLAGS_enable_tls)) {
+                    configs.push_back({ sync, client_threads, concurrency, conns, payload,
+                                        sidecars, workers, reactors, tls });
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+    return configs;
+  }
 
-    // Set up server.
-    StartTestServerWithGeneratedCode(&server_addr_);
+  void StartServer(const BenchConfig& config) {
+    n_worker_threads_ = config.worker_threads;
+    n_server_reactor_threads_ = config.server_reactors;
+    StartTestServerWithGeneratedCode(&server_addr_, config.enable_tls);
   }
 
-  void SummarizePerf(CpuTimes elapsed, int total_reqs, bool sync) {
-    float reqs_per_second = static_cast<float>(total_reqs / elapsed.wall_seconds());
-    float user_cpu_micros_per_req = static_cast<float>(elapsed.user / 1000.0 / total_reqs);
-    float sys_cpu_micros_per_req = static_cast<float>(elapsed.system / 1000.0 / total_reqs);
-    float csw_per_req = static_cast<float>(elapsed.context_switches) / total_reqs;
+  void StopServer() {
+    server_messenger_->UnregisterService(service_name_);
+    service_pool_->Shutdown();
+    service_pool_.reset();
+    server_messenger_->Shutdown();
+    server_messenger_.reset();
+  }
 
-    LOG(INFO) << "Mode:            " << (sync ? "Sync" : "Async");
-    if (sync) {
-      LOG(INFO) << "Client threads:   " << FLAGS_client_threads;
-    } else {
-      LOG(INFO) << "Client reactors:  " << FLAGS_client_threads;
-      LOG(INFO) << "Call concurrency: " << FLAGS_async_call_concurrency;
+  shared_ptr<Messenger> CreateClientMessenger(const BenchConfig& config) {
+    MessengerBuilder bld("Client");
+    bld.set_num_connections_per_server(config.connections_per_server);
+    shared_ptr<Messenger> messenger;
+    CHECK_OK(bld.Build(&messenger));
+    return messenger;
+  }
+
+  // Prepares a call: fills in the payload and attaches the sidecars.
+  void PrepareCall(EchoRequestPB* req, RpcController* controller) const {
+    controller->Reset();
+    controller->set_timeout(MonoDelta::FromSeconds(10));
+    req->set_data(payload_);
+    for (int i = 0; i < config_.sidecars; i++) {
+      gscoped_ptr<faststring> data(new faststring);
+      data->append(sidecar_data_);
+      int idx;
+      CHECK_OK(controller->AddOutboundSidecar(
+          make_gscoped_ptr(new RpcSidecar(std::move(data))), &idx));
     }
+  }
 
-    LOG(INFO) << "Worker threads:   " << FLAGS_worker_threads;
-    LOG(INFO) << "Server reactors:  " << FLAGS_server_reactors;
+  // Starts a server for 'config', runs the client workload of 'config'
+  // against it for --run_seconds, and reports the results.
+  void RunConfig(const BenchConfig& config);
+
+  void SummarizePerf(CpuTimes elapsed, int64_t total_reqs) {
+    double reqs_per_second = total_reqs / elapsed.wall_seconds();
+    double user_cpu_micros_per_req = elapsed.user / 1000.0 / total_reqs;
+    double sys_cpu_micros_per_req = elapsed.system / 1000.0 / total_reqs;
+    double csw_per_req = static_cast<double>(elapsed.context_switches) / total_reqs;
+
+    LOG(INFO) << "Config:           " << config_.ToString();
     LOG(INFO) << "----------------------------------";
     LOG(INFO) << "Reqs/sec:         " << reqs_per_second;
     LOG(INFO) << "User CPU per req: " << user_cpu_micros_per_req << "us";
     LOG(INFO) << "Sys CPU per req:  " << sys_cpu_micros_per_req << "us";
     LOG(INFO) << "Ctx Sw. per req:  " << csw_per_req;
-
+    LOG(INFO) << "Latency p50:      " << latency_->ValueAtPercentile(50) << "us";
+    LOG(INFO) << "Latency p99:      " << latency_->ValueAtPercentile(99) << "us";
+    LOG(INFO) << "Latency p99.9:    " << latency_->ValueAtPercentile(99.9) << "us";
+
+    ostringstream out;
+    JsonWriter jw(&out, JsonWriter::COMPACT);
+    jw.StartObject();
+    jw.String("mode");
+    jw.String(config_.sync ? "sync" : "async");
+    jw.String("client_threads");
+    jw.Int(config_.client_threads);
+    jw.String("concurrency");
+    jw.Int(config_.concurrency);
+    jw.String("connections_per_server");
+    jw.Int(config_.connections_per_server);
+    jw.String("payload_bytes");
+    jw.Int(config_.payload_bytes);
+    jw.String("sidecars");
+    jw.Int(config_.sidecars);
+    jw.String("sidecar_bytes");
+    jw.Int(FLAGS_sidecar_bytes);
+    jw.String("worker_threads");
+    jw.Int(config_.worker_threads);
+    jw.String("server_reactors");
+    jw.Int(config_.server_reactors);
+    jw.String("tls");
+    jw.Bool(config_.enable_tls);
+    jw.String("total_reqs");
+    jw.Int64(total_reqs);
+    jw.String("reqs_per_sec");
+    jw.Double(reqs_per_second);
+    jw.String("user_cpu_us_per_req");
+    jw.Double(user_cpu_micros_per_req);
+    jw.String("sys_cpu_us_per_req");
+    jw.Double(sys_cpu_micros_per_req);
+    jw.String("ctx_switches_per_req");
+    jw.Double(csw_per_req);
+    jw.String("latency_us");
+    jw.StartObject();
+    jw.String("mean");
+    jw.Double(latency_->MeanValue());
+    for (double p : { 50.0, 90.0, 99.0, 99.9, 99.99 }) {
+      jw.String(Substitute("p$0", p));
+      jw.Int64(latency_->ValueAtPercentile(p));
+    }
+    jw.String("max");
+    jw.Int64(latency_->MaxValue());
+    jw.EndObject();
+    jw.EndObject();
+
+    LOG(INFO) << "Result: " << out.str();
+    if (!FLAGS_results_file.empty()) {
+      ofstream results(FLAGS_results_file, std::ios::app);
+      results << out.str() << std::endl;
+      CHECK(results.good()) << "couldn't write to " << FLAGS_results_file;
+    }
   }
 
  protected:
@@ -104,6 +305,14 @@ class RpcBench : public RpcTestBase {
   Sockaddr server_addr_;
   Atomic32 should_run_;
   CountDownLatch stop_;
+
+  // The configuration being run, and its payloads.
+  BenchConfig config_;
+  string payload_;
+  string sidecar_data_;
+
+  // Latencies of the calls of the configuration being run, in microseconds.
+  unique_ptr<HdrHistogram> latency_;
 };
 
 class ClientThread {
@@ -122,81 +331,54 @@ class ClientThread {
   }
 
   void Run() {
-    shared_ptr<Messenger> client_messenger = bench_->CreateMessenger("Client");
+    shared_ptr<Messenger> client_messenger = bench_->CreateClientMessenger(bench_->config_);
 
     CalculatorServiceProxy p(client_messenger, bench_->server_addr_);
 
-    AddRequestPB req;
-    AddResponsePB resp;
+    EchoRequestPB req;
+    EchoResponsePB resp;
+    RpcController controller;
     while (Acquire_Load(&bench_->should_run_)) {
-      req.set_x(request_count_);
-      req.set_y(request_count_);
-      RpcController controller;
-      controller.set_timeout(MonoDelta::FromSeconds(10));
-      CHECK_OK(p.Add(req, &resp, &controller));
-      CHECK_EQ(req.x() + req.y(), resp.result());
+      bench_->PrepareCall(&req, &controller);
+      MonoTime start = MonoTime::Now();
+      CHECK_OK(p.Echo(req, &resp, &controller));
+      bench_->latency_->Increment((MonoTime::Now() - start).ToMicroseconds());
+      CHECK_EQ(req.data().size(), resp.data().size());
       request_count_++;
     }
   }
 
   unique_ptr<thread> thread_;
   RpcBench *bench_;
-  int request_count_;
+  int64_t request_count_;
 };
 
-
-// Test making successful RPC calls.
-TEST_F(RpcBench, BenchmarkCalls) {
-  Stopwatch sw(Stopwatch::ALL_THREADS);
-  sw.start();
-
-  vector<unique_ptr<ClientThread>> threads;
-  for (int i = 0; i < FLAGS_client_threads; i++) {
-    threads.emplace_back(new ClientThread(this));
-    threads.back()->Start();
-  }
-
-  SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
-  Release_Store(&should_run_, false);
-
-  int total_reqs = 0;
-
-  for (auto& thr : threads) {
-    thr->Join();
-    total_reqs += thr->request_count_;
-  }
-  sw.stop();
-
-  SummarizePerf(sw.elapsed(), total_reqs, true);
-}
-
 class ClientAsyncWorkload {
  public:
   ClientAsyncWorkload(RpcBench *bench, shared_ptr<Messenger> messenger)
     : bench_(bench),
       messenger_(std::move(messenger)),
       request_count_(0) {
-    controller_.set_timeout(MonoDelta::FromSeconds(10));
     proxy_.reset(new CalculatorServiceProxy(messenger_, bench_->server_addr_));
   }
 
   void CallOneRpc() {
     if (request_count_ > 0) {
+      bench_->latency_->Increment((MonoTime::Now() - start_).ToMicroseconds());
       CHECK_OK(controller_.status());
-      CHECK_EQ(req_.x() + req_.y(), resp_.result());
+      CHECK_EQ(req_.data().size(), resp_.data().size());
     }
     if (!Acquire_Load(&bench_->should_run_)) {
       bench_->stop_.CountDown();
       return;
     }
-    controller_.Reset();
-    req_.set_x(request_count_);
-    req_.set_y(request_count_);
+    bench_->PrepareCall(&req_, &controller_);
     request_count_++;
-    proxy_->AddAsync(req_,
-                     &resp_,
-                     &controller_,
-                     bind(&ClientAsyncWorkload::CallOneRpc, this));
+    start_ = MonoTime::Now();
+    proxy_->EchoAsync(req_,
+                      &resp_,
+                      &controller_,
+                      bind(&ClientAsyncWorkload::CallOneRpc, this));
   }
 
   void Start() {
@@ -206,50 +388,87 @@ class ClientAsyncWorkload {
   RpcBench *bench_;
   shared_ptr<Messenger> messenger_;
   unique_ptr<CalculatorServiceProxy> proxy_;
-  uint32_t request_count_;
+  int64_t request_count_;
+  MonoTime start_;
   RpcController controller_;
-  AddRequestPB req_;
-  AddResponsePB resp_;
+  EchoRequestPB req_;
+  EchoResponsePB resp_;
 };
 
-TEST_F(RpcBench, BenchmarkCallsAsync) {
-  int threads = FLAGS_client_threads;
-  int concurrency = FLAGS_async_call_concurrency;
+void RpcBench::RunConfig(const BenchConfig& config) {
+  config_ = config;
+  payload_.assign(config.payload_bytes, 'x');
+  sidecar_data_.assign(FLAGS_sidecar_bytes, 'y');
+  latency_.reset(new HdrHistogram(60 * 1000 * 1000, 3));
+  Release_Store(&should_run_, true);
+  NO_FATALS(StartServer(config));
 
-  vector<shared_ptr<Messenger>> messengers;
-  for (int i = 0; i < threads; i++) {
-    messengers.push_back(CreateMessenger("Client"));
-  }
+  int64_t total_reqs = 0;
+  Stopwatch sw(Stopwatch::ALL_THREADS);
+  if (config.sync) {
+    sw.start();
 
-  vector<unique_ptr<ClientAsyncWorkload>> workloads;
-  for (int i = 0; i < concurrency; i++) {
-    workloads.emplace_back(
-        new ClientAsyncWorkload(this, messengers[i % threads]));
-  }
+    vector<unique_ptr<ClientThread>> threads;
+    for (int i = 0; i < config.client_threads; i++) {
+      threads.emplace_back(new ClientThread(this));
+      threads.back()->Start();
+    }
 
-  stop_.Reset(concurrency);
+    SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
+    Release_Store(&should_run_, false);
 
-  Stopwatch sw(Stopwatch::ALL_THREADS);
-  sw.start();
+    for (auto& thr : threads) {
+      thr->Join();
+      total_reqs += thr->request_count_;
+    }
+    sw.stop();
+  } else {
+    vector<shared_ptr<Messenger>> messengers;
+    for (int i = 0; i < config.client_threads; i++) {
+      messengers.push_back(CreateClientMessenger(config));
+    }
 
-  for (int i = 0; i < concurrency; i++) {
-    workloads[i]->Start();
-  }
+    vector<unique_ptr<ClientAsyncWorkload>> workloads;
+    for (int i = 0; i < config.concurrency; i++) {
+      workloads.emplace_back(
+          new ClientAsyncWorkload(this, messengers[i % config.client_threads]));
+    }
+
+    stop_.Reset(config.concurrency);
+
+    sw.start();
+
+    for (int i = 0; i < config.concurrency; i++) {
+      workloads[i]->Start();
+    }
+
+    SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
+    Release_Store(&should_run_, false);
+
+    sw.stop();
 
-  SleepFor(MonoDelta::FromSeconds(FLAGS_run_seconds));
-  Release_Store(&should_run_, false);
+    stop_.Wait();
+    for (int i = 0; i < config.concurrency; i++) {
+      total_reqs += workloads[i]->request_count_;
+    }
+  }
 
-  sw.stop();
+  SummarizePerf(sw.elapsed(), total_reqs);
+  StopServer();
+}
 
-  stop_.Wait();
-  int total_reqs = 0;
-  for (int i = 0; i < concurrency; i++) {
-    total_reqs += workloads[i]->request_count_;
+// Test making successful RPC calls.
+TEST_F(RpcBench, BenchmarkCalls) {
+  for (const auto& config : AllConfigs(true)) {
+    NO_FATALS(RunConfig(config));
   }
+}
 
-  SummarizePerf(sw.elapsed(), total_reqs, false);
+TEST_F(RpcBench, BenchmarkCallsAsync) {
+  for (const auto& config : AllConfigs(false)) {
+    NO_FATALS(RunConfig(config));
+  }
 }
 
 } // namespace rpc
 } // namespace kudu
-
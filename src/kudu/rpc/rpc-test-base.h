@@ -65,6 +65,8 @@ using kudu::rpc_test::ExactlyOnceResponsePB;
 using kudu::rpc_test::FeatureFlags;
 using kudu::rpc_test::PanicRequestPB;
 using kudu::rpc_test::PanicResponsePB;
+using kudu::rpc_test::PushTwoStringsRequestPB;
+using kudu::rpc_test::PushTwoStringsResponsePB;
 using kudu::rpc_test::SendTwoStringsRequestPB;
 using kudu::rpc_test::SendTwoStringsResponsePB;
 using kudu::rpc_test::SleepRequestPB;
@@ -84,6 +86,7 @@ class GenericCalculatorService : public ServiceIf {
   static const char *kAddMethodName;
   static const char *kSleepMethodName;
   static const char *kSendTwoStringsMethodName;
+  static const char *kPushTwoStringsMethodName;
   static const char *kAddExactlyOnce;
 
   static const char* kFirstString;
@@ -105,6 +108,8 @@ class GenericCalculatorService : public ServiceIf {
       DoSleep(incoming);
     } else if (incoming->remote_method().method_name() == kSendTwoStringsMethodName) {
       DoSendTwoStrings(incoming);
+    } else if (incoming->remote_method().method_name() == kPushTwoStringsMethodName) {
+      DoPushTwoStrings(incoming);
     } else {
       incoming->RespondFailure(ErrorStatusPB::ERROR_NO_SUCH_METHOD,
                                Status::InvalidArgument("bad method"));
@@ -156,6 +161,23 @@ class GenericCalculatorService : public ServiceIf {
     incoming->RespondSuccess(resp);
   }
 
+  void DoPushTwoStrings(InboundCall* incoming) {
+    Slice param(incoming->serialized_request());
+    PushTwoStringsRequestPB req;
+    if (!req.ParseFromArray(param.data(), param.size())) {
+      LOG(FATAL) << "couldn't parse: " << param.ToDebugString();
+    }
+
+    Slice first, second;
+    CHECK_OK(incoming->GetInboundSidecar(req.sidecar1(), &first));
+    CHECK_OK(incoming->GetInboundSidecar(req.sidecar2(), &second));
+
+    PushTwoStringsResponsePB resp;
+    resp.set_data1(first.ToString());
+    resp.set_data2(second.ToString());
+    incoming->RespondSuccess(resp);
+  }
+
   void DoSleep(InboundCall *incoming) {
     Slice param(incoming->serialized_request());
     SleepRequestPB req;
@@ -327,6 +349,7 @@ const char *GenericCalculatorService::kFullServiceName = "kudu.rpc.GenericCalcul
 const char *GenericCalculatorService::kAddMethodName = "Add";
 const char *GenericCalculatorService::kSleepMethodName = "Sleep";
 const char *GenericCalculatorService::kSendTwoStringsMethodName = "SendTwoStrings";
+const char *GenericCalculatorService::kPushTwoStringsMethodName = "PushTwoStrings";
 const char *GenericCalculatorService::kAddExactlyOnce = "AddExactlyOnce";
 
 const char *GenericCalculatorService::kFirstString =
@@ -338,8 +361,10 @@ class RpcTestBase : public KuduTest {
  public:
   RpcTestBase()
     : n_worker_threads_(3),
+      n_high_priority_worker_threads_(0),
       service_queue_length_(100),
       n_server_reactor_threads_(3),
+      server_reactor_per_core_(false),
       keepalive_time_ms_(1000),
       metric_entity_(METRIC_ENTITY_server.Instantiate(&metric_registry_, "test.rpc_test")) {
   }
@@ -362,7 +387,8 @@ class RpcTestBase : public KuduTest {
  protected:
   std::shared_ptr<Messenger> CreateMessenger(const string &name,
                                              int n_reactors = 1,
-                                             bool enable_ssl = false) {
+                                             bool enable_ssl = false,
+                                             bool reactor_per_core = false) {
     MessengerBuilder bld(name);
 
     if (enable_ssl) {
@@ -370,6 +396,7 @@ class RpcTestBase : public KuduTest {
     }
 
     bld.set_num_reactors(n_reactors);
+    bld.set_reactor_per_core(reactor_per_core);
     bld.set_connection_keepalive_time(
       MonoDelta::FromMilliseconds(keepalive_time_ms_));
     // In order for the keepalive timing to be accurate, we need to scan connections
@@ -396,6 +423,35 @@ class RpcTestBase : public KuduTest {
     return Status::OK();
   }
 
+  void DoTestRequestSidecar(const Proxy &p, int size1, int size2) {
+    Random rng(12345);
+    gscoped_ptr<faststring> first(new faststring);
+    first->resize(size1);
+    RandomString(first->data(), size1, &rng);
+    gscoped_ptr<faststring> second(new faststring);
+    second->resize(size2);
+    RandomString(second->data(), size2, &rng);
+    std::string expected1 = Slice(*first).ToString();
+    std::string expected2 = Slice(*second).ToString();
+
+    RpcController controller;
+    controller.set_timeout(MonoDelta::FromMilliseconds(10000));
+    PushTwoStringsRequestPB req;
+    int idx1, idx2;
+    CHECK_OK(controller.AddOutboundSidecar(
+        make_gscoped_ptr(new RpcSidecar(std::move(first))), &idx1));
+    CHECK_OK(controller.AddOutboundSidecar(
+        make_gscoped_ptr(new RpcSidecar(std::move(second))), &idx2));
+    req.set_sidecar1(idx1);
+    req.set_sidecar2(idx2);
+
+    PushTwoStringsResponsePB resp;
+    CHECK_OK(p.SyncRequest(GenericCalculatorService::kPushTwoStringsMethodName,
+                           req, &resp, &controller));
+    CHECK_EQ(expected1, resp.data1());
+    CHECK_EQ(expected2, resp.data2());
+  }
+
   void DoTestSidecar(const Proxy &p, int size1, int size2) {
     const uint32_t kSeed = 12345;
 
@@ -483,7 +539,8 @@ class RpcTestBase : public KuduTest {
 
   template<class ServiceClass>
   void DoStartTestServer(Sockaddr *server_addr, bool enable_ssl = false) {
-    server_messenger_ = CreateMessenger("TestServer", n_server_reactor_threads_, enable_ssl);
+    server_messenger_ = CreateMessenger("TestServer", n_server_reactor_threads_, enable_ssl,
+                                        server_reactor_per_core_);
     std::shared_ptr<AcceptorPool> pool;
     ASSERT_OK(server_messenger_->AddAcceptorPool(Sockaddr(), &pool));
     ASSERT_OK(pool->Start(2));
@@ -496,6 +553,7 @@ class RpcTestBase : public KuduTest {
     scoped_refptr<MetricEntity> metric_entity = server_messenger_->metric_entity();
     service_pool_ = new ServicePool(std::move(service), metric_entity, service_queue_length_);
     server_messenger_->RegisterService(service_name_, service_pool_);
+    service_pool_->ReserveThreads(HIGH_PRIORITY, n_high_priority_worker_threads_);
     ASSERT_OK(service_pool_->Init(n_worker_threads_));
   }
 
@@ -506,8 +564,10 @@ class RpcTestBase : public KuduTest {
   std::shared_ptr<kudu::MemTracker> mem_tracker_;
   scoped_refptr<ResultTracker> result_tracker_;
   int n_worker_threads_;
+  int n_high_priority_worker_threads_;
   int service_queue_length_;
   int n_server_reactor_threads_;
+  bool server_reactor_per_core_;
   int keepalive_time_ms_;
 
   MetricRegistry metric_registry_;
@@ -37,8 +37,13 @@
 
 METRIC_DECLARE_histogram(handler_latency_kudu_rpc_test_CalculatorService_Sleep);
 METRIC_DECLARE_histogram(rpc_incoming_queue_time);
+METRIC_DECLARE_counter(rpc_compression_payload_bytes);
+METRIC_DECLARE_counter(rpc_compression_wire_bytes);
+METRIC_DECLARE_histogram(rpc_outbound_transfers_per_write);
 
+DECLARE_int32(rpc_compression_min_bytes);
 DECLARE_int32(rpc_negotiation_inject_delay_ms);
+DECLARE_bool(rpc_tls_kernel_offload);
 
 using std::shared_ptr;
 using std::string;
@@ -122,6 +127,26 @@ TEST_P(TestRpc, TestCall) {
   }
 }
 
+// Test making RPC calls to a server with a reactor per core, each accepting
+// connections on its own socket.
+TEST_P(TestRpc, TestCallWithReactorPerCore) {
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  server_reactor_per_core_ = true;
+  StartTestServer(&server_addr, enable_ssl);
+  ASSERT_GE(server_messenger_->num_reactors(), 1);
+
+  // Use several client messengers, so that the calls arrive on several
+  // connections.
+  for (int i = 0; i < 4; i++) {
+    shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, enable_ssl));
+    Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+    for (int j = 0; j < 5; j++) {
+      ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+    }
+  }
+}
+
 // Test that connecting to an invalid server properly throws an error.
 TEST_P(TestRpc, TestCallToBadServer) {
   shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, GetParam()));
@@ -248,6 +273,33 @@ TEST_P(TestRpc, TestConnectionKeepalive) {
   ASSERT_EQ(0, metrics.num_client_connections_) << "Client should have 0 client connections";
 }
 
+// Test that a messenger with several connections per server spreads its calls
+// over them, with each connection on its own reactor.
+TEST_P(TestRpc, TestMultipleConnectionsPerServer) {
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServer(&server_addr, enable_ssl);
+
+  MessengerBuilder bld("Client");
+  if (enable_ssl) {
+    bld.enable_inbound_tls();
+  }
+  bld.set_num_reactors(2);
+  bld.set_num_connections_per_server(2);
+  shared_ptr<Messenger> client_messenger;
+  ASSERT_OK(bld.Build(&client_messenger));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+  for (int i = 0; i < 4; i++) {
+    ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  }
+
+  for (Reactor* reactor : client_messenger->reactors_) {
+    ReactorMetrics metrics;
+    ASSERT_OK(reactor->GetMetrics(&metrics));
+    ASSERT_EQ(1, metrics.num_client_connections_);
+  }
+}
+
 // Test that a call which takes longer than the keepalive time
 // succeeds -- i.e that we don't consider a connection to be "idle" on the
 // server if there is a call outstanding on it.
@@ -296,6 +348,146 @@ TEST_P(TestRpc, TestRpcSidecar) {
   DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
 }
 
+// Test that calls and sidecars get through when the kernel is asked to take
+// over TLS encryption, whether or not the platform supports it.
+TEST_P(TestRpc, TestRpcSidecarWithKernelTls) {
+  FLAGS_rpc_tls_kernel_offload = true;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServer(&server_addr, enable_ssl);
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+
+  ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  DoTestSidecar(p, 123, 456);
+  DoTestSidecar(p, 3000 * 1024, 2000 * 1024);
+}
+
+// Test that sidecars attached to requests reach the server.
+TEST_P(TestRpc, TestRpcRequestSidecar) {
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServer(&server_addr, enable_ssl);
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, GetParam()));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+
+  DoTestRequestSidecar(p, 0, 0);
+  DoTestRequestSidecar(p, 123, 456);
+
+  // Sidecars too large to be written to the socket in a single call.
+  DoTestRequestSidecar(p, 3000 * 1024, 2000 * 1024);
+
+  // There are at most 8 sidecars per call.
+  RpcController controller;
+  int idx;
+  for (int i = 0; i < 8; i++) {
+    ASSERT_OK(controller.AddOutboundSidecar(
+        make_gscoped_ptr(new RpcSidecar(make_gscoped_ptr(new faststring))), &idx));
+    ASSERT_EQ(i, idx);
+  }
+  Status s = controller.AddOutboundSidecar(
+      make_gscoped_ptr(new RpcSidecar(make_gscoped_ptr(new faststring))), &idx);
+  ASSERT_TRUE(s.IsServiceUnavailable()) << s.ToString();
+}
+
+// Test that call payloads are compressed on connections where both sides
+// enable compression, and sent as is otherwise.
+TEST_P(TestRpc, TestPayloadCompression) {
+  FLAGS_rpc_compression_min_bytes = 1024;
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServer(&server_addr, enable_ssl);
+
+  // Push compressible sidecars, which the server echoes in its response.
+  const string kData(64 * 1024, 'x');
+  auto make_sidecar = [&]() {
+    gscoped_ptr<faststring> data(new faststring);
+    data->append(kData);
+    return make_gscoped_ptr(new RpcSidecar(std::move(data)));
+  };
+  auto push = [&](const Proxy& p) {
+    RpcController controller;
+    PushTwoStringsRequestPB req;
+    int idx1, idx2;
+    ASSERT_OK(controller.AddOutboundSidecar(make_sidecar(), &idx1));
+    ASSERT_OK(controller.AddOutboundSidecar(make_sidecar(), &idx2));
+    req.set_sidecar1(idx1);
+    req.set_sidecar2(idx2);
+    PushTwoStringsResponsePB resp;
+    ASSERT_OK(p.SyncRequest(GenericCalculatorService::kPushTwoStringsMethodName,
+                            req, &resp, &controller));
+    ASSERT_EQ(kData, resp.data1());
+    ASSERT_EQ(kData, resp.data2());
+  };
+  auto metric_map = metric_entity_->UnsafeMetricsMapForTests();
+  Counter* payload_bytes = down_cast<Counter*>(
+      FindOrDie(metric_map, &METRIC_rpc_compression_payload_bytes).get());
+  Counter* wire_bytes = down_cast<Counter*>(
+      FindOrDie(metric_map, &METRIC_rpc_compression_wire_bytes).get());
+
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+  NO_FATALS(push(p));
+
+  // Both the request and the response were compressed.
+  int64_t compressed_payload_bytes = payload_bytes->value();
+  ASSERT_GE(compressed_payload_bytes, 4 * static_cast<int64_t>(kData.size()));
+  ASSERT_LT(wire_bytes->value(), compressed_payload_bytes / 10);
+
+  // Small calls aren't compressed.
+  ASSERT_OK(DoTestSyncCall(p, GenericCalculatorService::kAddMethodName));
+  ASSERT_EQ(compressed_payload_bytes, payload_bytes->value());
+
+  // Nor are calls from clients which don't enable compression.
+  FLAGS_rpc_compression_min_bytes = 0;
+  shared_ptr<Messenger> plain_messenger(CreateMessenger("PlainClient", 1, enable_ssl));
+  Proxy plain_p(plain_messenger, server_addr, GenericCalculatorService::static_service_name());
+  NO_FATALS(push(plain_p));
+  ASSERT_EQ(compressed_payload_bytes, payload_bytes->value());
+}
+
+// Test that calls queued while a connection is being negotiated are sent
+// together once it's ready, rather than with one write each.
+TEST_P(TestRpc, TestOutboundCallsAreCoalesced) {
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServer(&server_addr, enable_ssl);
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, GenericCalculatorService::static_service_name());
+
+  const int kNumCalls = 100;
+  AddRequestPB req;
+  req.set_x(1);
+  req.set_y(2);
+  vector<AddResponsePB> resps(kNumCalls);
+  vector<unique_ptr<RpcController>> controllers;
+  CountDownLatch latch(kNumCalls);
+  for (int i = 0; i < kNumCalls; i++) {
+    controllers.emplace_back(new RpcController());
+    p.AsyncRequest(GenericCalculatorService::kAddMethodName, req, &resps[i],
+                   controllers.back().get(),
+                   boost::bind(&CountDownLatch::CountDown, boost::ref(latch)));
+  }
+  latch.Wait();
+  for (int i = 0; i < kNumCalls; i++) {
+    ASSERT_OK(controllers[i]->status());
+    ASSERT_EQ(3, resps[i].result());
+  }
+
+  auto metric_map = metric_entity_->UnsafeMetricsMapForTests();
+  Histogram* transfers_per_write = down_cast<Histogram*>(
+      FindOrDie(metric_map, &METRIC_rpc_outbound_transfers_per_write).get());
+  ASSERT_GT(transfers_per_write->TotalCount(), 0);
+  ASSERT_GT(transfers_per_write->MaxValueForTests(), 1);
+}
+
 // Test that timeouts are properly handled.
 TEST_P(TestRpc, TestCallTimeout) {
   Sockaddr server_addr;
@@ -505,6 +697,52 @@ TEST_P(TestRpc, TestRpcHandlerLatencyMetric) {
   ASSERT_TRUE(FindOrDie(metric_map, &METRIC_rpc_incoming_queue_time));
 }
 
+// Test that calls to high priority methods are served by their reserved
+// threads while the regular worker threads are busy.
+TEST_P(TestRpc, TestHighPriorityCallsUseReservedThreads) {
+  n_worker_threads_ = 1;
+  n_high_priority_worker_threads_ = 1;
+
+  // Set up server.
+  Sockaddr server_addr;
+  bool enable_ssl = GetParam();
+  StartTestServerWithGeneratedCode(&server_addr, enable_ssl);
+
+  // Set up client.
+  shared_ptr<Messenger> client_messenger(CreateMessenger("Client", 1, enable_ssl));
+  Proxy p(client_messenger, server_addr, CalculatorService::static_service_name());
+
+  // Occupy the only regular worker thread with a long Sleep() call, and wait
+  // until it is being handled.
+  RpcController sleep_controller;
+  sleep_controller.set_timeout(MonoDelta::FromSeconds(30));
+  SleepRequestPB sleep_req;
+  sleep_req.set_sleep_micros(3 * 1000 * 1000);
+  SleepResponsePB sleep_resp;
+  CountDownLatch sleep_latch(1);
+  p.AsyncRequest("Sleep", sleep_req, &sleep_resp, &sleep_controller,
+                 boost::bind(&CountDownLatch::CountDown, &sleep_latch));
+  const Histogram* queue_time = service_pool_->IncomingQueueTimeMetricForTests();
+  while (queue_time->TotalCount() < 1) {
+    SleepFor(MonoDelta::FromMilliseconds(1));
+  }
+
+  // Echo() is a high priority method, so it doesn't wait for the Sleep() call.
+  RpcController controller;
+  controller.set_timeout(MonoDelta::FromSeconds(1));
+  EchoRequestPB req;
+  req.set_data("hello");
+  EchoResponsePB resp;
+  ASSERT_OK(p.SyncRequest("Echo", req, &resp, &controller));
+  ASSERT_EQ("hello", resp.data());
+  ASSERT_EQ(1, sleep_latch.count());
+  ASSERT_EQ(1, service_pool_->IncomingQueueTimeMetricForTests(HIGH_PRIORITY)->TotalCount());
+  ASSERT_EQ(1, service_pool_->IncomingQueueTimeMetricForTests(NORMAL_PRIORITY)->TotalCount());
+
+  sleep_latch.Wait();
+  ASSERT_OK(sleep_controller.status());
+}
+
 static void DestroyMessengerCallback(shared_ptr<Messenger>* messenger,
                                      CountDownLatch* latch) {
   messenger->reset();
@@ -17,6 +17,7 @@
 
 #include "kudu/rpc/rpc_context.h"
 
+#include <memory>
 #include <ostream>
 #include <sstream>
 
@@ -32,6 +33,7 @@
 #include "kudu/util/trace.h"
 
 using google::protobuf::Message;
+using std::unique_ptr;
 
 namespace kudu {
 namespace rpc {
@@ -41,6 +43,7 @@ RpcContext::RpcContext(InboundCall *call,
                        google::protobuf::Message *response_pb,
                        const scoped_refptr<ResultTracker>& result_tracker)
   : call_(CHECK_NOTNULL(call)),
+    method_info_(call->method_info()),
     request_pb_(request_pb),
     response_pb_(response_pb),
     result_tracker_(result_tracker) {
@@ -52,6 +55,12 @@ RpcContext::RpcContext(InboundCall *call,
 }
 
 RpcContext::~RpcContext() {
+  // The call itself may already be gone, but the method outlives it.
+  if (method_info_) {
+    method_info_->req_pool.Put(unique_ptr<Message>(
+        const_cast<Message*>(request_pb_.release())));
+    method_info_->resp_pool.Put(unique_ptr<Message>(response_pb_.release()));
+  }
 }
 
 void RpcContext::RespondSuccess() {
@@ -145,6 +154,10 @@ Status RpcContext::AddRpcSidecar(gscoped_ptr<RpcSidecar> car, int* idx) {
   return call_->AddRpcSidecar(std::move(car), idx);
 }
 
+Status RpcContext::GetInboundSidecar(int idx, Slice* sidecar) const {
+  return call_->GetInboundSidecar(idx, sidecar);
+}
+
 const RemoteUser& RpcContext::remote_user() const {
   return call_->remote_user();
 }
@@ -162,6 +175,10 @@ MonoTime RpcContext::GetClientDeadline() const {
   return call_->GetClientDeadline();
 }
 
+MonoDelta RpcContext::GetTimeInQueue() const {
+  return call_->GetTimeInQueue();
+}
+
 Trace* RpcContext::trace() {
   return call_->trace();
 }
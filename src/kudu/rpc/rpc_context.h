@@ -155,6 +155,11 @@ class RpcContext {
   // by the RPC response.
   Status AddRpcSidecar(gscoped_ptr<RpcSidecar> car, int* idx);
 
+  // Fills 'sidecar' with the data of the idx-th sidecar sent with the request
+  // (see RpcController::AddOutboundSidecar()). The data remains valid until
+  // a response is sent. May fail if the index is invalid.
+  Status GetInboundSidecar(int idx, Slice* sidecar) const;
+
   // Return the identity of remote user who made this call.
   const RemoteUser& remote_user() const;
 
@@ -173,6 +178,10 @@ class RpcContext {
   // If the client did not specify a deadline, returns MonoTime::Max().
   MonoTime GetClientDeadline() const;
 
+  // Return the time the call waited in the service queue before its handler
+  // was kicked off.
+  MonoDelta GetTimeInQueue() const;
+
   // Whether the results of this RPC are tracked with a ResultTracker.
   // If this returns true, both result_tracker() and request_id() should return non-null results.
   bool AreResultsTracked() const { return result_tracker_.get() != nullptr; }
@@ -196,8 +205,11 @@ class RpcContext {
  private:
   friend class ResultTracker;
   InboundCall* const call_;
-  const gscoped_ptr<const google::protobuf::Message> request_pb_;
-  const gscoped_ptr<google::protobuf::Message> response_pb_;
+  // The method of the call, whose message pools the request and response
+  // are returned to once the call is done with them.
+  const scoped_refptr<RpcMethodInfo> method_info_;
+  gscoped_ptr<const google::protobuf::Message> request_pb_;
+  gscoped_ptr<google::protobuf::Message> response_pb_;
   scoped_refptr<ResultTracker> result_tracker_;
 };
 
@@ -23,6 +23,8 @@
 
 #include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/outbound_call.h"
+#include "kudu/rpc/rpc_sidecar.h"
+#include "kudu/rpc/transfer.h"
 
 namespace kudu { namespace rpc {
 
@@ -45,6 +47,7 @@ void RpcController::Swap(RpcController* other) {
 
   std::swap(timeout_, other->timeout_);
   std::swap(call_, other->call_);
+  std::swap(outbound_sidecars_, other->outbound_sidecars_);
 }
 
 void RpcController::Reset() {
@@ -54,6 +57,7 @@ void RpcController::Reset() {
   }
   call_.reset();
   required_server_features_.clear();
+  outbound_sidecars_.clear();
 }
 
 bool RpcController::finished() const {
@@ -81,6 +85,16 @@ Status RpcController::GetSidecar(int idx, Slice* sidecar) const {
   return call_->call_response_->GetSidecar(idx, sidecar);
 }
 
+Status RpcController::AddOutboundSidecar(gscoped_ptr<RpcSidecar> car, int* idx) {
+  // Two payload slices are used up by the header and main message protobufs.
+  if (outbound_sidecars_.size() + 2 >= OutboundTransfer::kMaxPayloadSlices) {
+    return Status::ServiceUnavailable("All available sidecars already used");
+  }
+  outbound_sidecars_.emplace_back(car.release());
+  *idx = outbound_sidecars_.size() - 1;
+  return Status::OK();
+}
+
 void RpcController::set_timeout(const MonoDelta& timeout) {
   std::lock_guard<simple_spinlock> l(lock_);
   DCHECK(!call_ || call_->state() == OutboundCall::READY);
@@ -21,7 +21,9 @@
 #include <glog/logging.h>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/monotime.h"
@@ -33,6 +35,7 @@ namespace rpc {
 class ErrorStatusPB;
 class OutboundCall;
 class RequestIdPB;
+class RpcSidecar;
 
 // Controller for managing properties of a single RPC call, on the client side.
 //
@@ -179,6 +182,18 @@ class RpcController {
   // May fail if index is invalid.
   Status GetSidecar(int idx, Slice* sidecar) const;
 
+  // Adds a sidecar to the request of the next call made with this controller.
+  // See RpcContext::AddRpcSidecar() for the response counterpart.
+  //
+  // Must be called before the call is sent. Upon success, writes the index of
+  // the sidecar, to be communicated to the server (e.g. via the request
+  // protobuf), to 'idx'. May fail if all sidecars have already been used.
+  //
+  // Servers which predate request sidecars can't tell them apart from the
+  // request protobuf, so the call should also require a server feature which
+  // implies their support (see RequireServerFeature()).
+  Status AddOutboundSidecar(gscoped_ptr<RpcSidecar> car, int* idx);
+
  private:
   friend class OutboundCall;
   friend class Proxy;
@@ -195,6 +210,10 @@ class RpcController {
   // Once the call is sent, it is tracked here.
   std::shared_ptr<OutboundCall> call_;
 
+  // The sidecars to send with the next call.
+  // Ownership is transfered to OutboundCall once the call is sent.
+  std::vector<std::unique_ptr<RpcSidecar>> outbound_sidecars_;
+
   DISALLOW_COPY_AND_ASSIGN(RpcController);
 };
 
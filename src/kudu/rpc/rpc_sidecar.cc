@@ -0,0 +1,73 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/rpc/rpc_sidecar.h"
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/rpc/transfer.h"
+
+namespace kudu {
+namespace rpc {
+
+using strings::Substitute;
+
+Status RpcSidecar::ParseSidecars(
+    const google::protobuf::RepeatedField<google::protobuf::uint32>& offsets,
+    const Slice& buffer, Slice* msg, Slice* sidecars) {
+  int last = offsets.size() - 1;
+  if (last < 0) {
+    *msg = buffer;
+    return Status::OK();
+  }
+
+  if (last >= OutboundTransfer::kMaxPayloadSlices) {
+    return Status::Corruption(Substitute(
+        "Received $0 additional payload slices, expected at most $1",
+        last, OutboundTransfer::kMaxPayloadSlices));
+  }
+
+  if (offsets.Get(0) > buffer.size()) {
+    return Status::Corruption(Substitute(
+        "Invalid sidecar offsets; the first sidecar apparently starts at $0, "
+        "but the entire message has length $1", offsets.Get(0), buffer.size()));
+  }
+  *msg = Slice(buffer.data(), offsets.Get(0));
+  for (int i = 0; i < last; ++i) {
+    uint32_t next_offset = offsets.Get(i);
+    int32_t len = offsets.Get(i + 1) - next_offset;
+    if (next_offset + len > buffer.size() || len < 0) {
+      return Status::Corruption(Substitute(
+          "Invalid sidecar offsets; sidecar $0 apparently starts at $1,"
+          " has length $2, but the entire message has length $3",
+          i, next_offset, len, buffer.size()));
+    }
+    sidecars[i] = Slice(buffer.data() + next_offset, len);
+  }
+  uint32_t next_offset = offsets.Get(last);
+  if (next_offset > buffer.size()) {
+    return Status::Corruption(Substitute(
+        "Invalid sidecar offsets; the last sidecar ($0) apparently starts "
+        "at $1, but the entire message has length $2",
+        last, next_offset, buffer.size()));
+  }
+  sidecars[last] = Slice(buffer.data() + next_offset,
+                         buffer.size() - next_offset);
+  return Status::OK();
+}
+
+} // namespace rpc
+} // namespace kudu
@@ -17,9 +17,14 @@
 #ifndef KUDU_RPC_RPC_SIDECAR_H
 #define KUDU_RPC_RPC_SIDECAR_H
 
+#include <memory>
+
+#include <google/protobuf/repeated_field.h>
+
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/slice.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
 namespace rpc {
@@ -49,16 +54,34 @@ namespace rpc {
 // RpcController's interface) is able to offer retrieval of the sidecar data
 // through the same indices that were returned by InboundCall (or indirectly
 // through the RpcContext wrapper) on the client side.
+//
+// Sidecars may also be attached to requests, through
+// RpcController::AddOutboundSidecar(), in which case the roles above are
+// reversed: the server retrieves them through RpcContext::GetInboundSidecar().
 class RpcSidecar {
  public:
   // Generates a sidecar with the parameter faststring as its data.
-  explicit RpcSidecar(gscoped_ptr<faststring> data) : data_(std::move(data)) {}
+  explicit RpcSidecar(gscoped_ptr<faststring> data) : data_(data.release()) {}
+
+  // Generates a sidecar with the parameter faststring as its data. The data
+  // may be shared, e.g. with a cache or other sidecars, but must not be
+  // modified while the sidecar exists.
+  explicit RpcSidecar(std::shared_ptr<const faststring> data) : data_(std::move(data)) {}
 
   // Returns a Slice representation of the sidecar's data.
   Slice AsSlice() const { return *data_; }
 
+  // Splits 'buffer', the main message of a call or of a call response, into
+  // the serialized protobuf ('msg') and the sidecars whose starting offsets
+  // within 'buffer' are 'offsets'. 'sidecars' must have room for at least
+  // OutboundTransfer::kMaxPayloadSlices entries. The resulting slices point
+  // into 'buffer'.
+  static Status ParseSidecars(
+      const google::protobuf::RepeatedField<google::protobuf::uint32>& offsets,
+      const Slice& buffer, Slice* msg, Slice* sidecars);
+
  private:
-  const gscoped_ptr<faststring> data_;
+  const std::shared_ptr<const faststring> data_;
 
   DISALLOW_COPY_AND_ASSIGN(RpcSidecar);
 };
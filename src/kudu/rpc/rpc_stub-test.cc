@@ -39,6 +39,9 @@
 #include "kudu/util/user.h"
 
 DEFINE_bool(is_panic_test_child, false, "Used by TestRpcPanic");
+DECLARE_bool(rpc_reject_unmeetable_deadlines);
+DECLARE_int64(rpc_max_pooled_message_bytes);
+DECLARE_int32(rpc_slow_call_trace_threshold_ms);
 DECLARE_bool(socket_inject_short_recvs);
 
 using std::shared_ptr;
@@ -91,6 +94,26 @@ TEST_F(RpcStubTest, TestShortRecvs) {
   }
 }
 
+// Test that requests and responses recycled from earlier calls don't leak
+// any of their contents into later ones.
+TEST_F(RpcStubTest, TestRecycledMessages) {
+  FLAGS_rpc_max_pooled_message_bytes = 1024 * 1024;
+  CalculatorServiceProxy p(client_messenger_, server_addr_);
+
+  for (int i = 0; i < 100; i++) {
+    // Alternate between long and short payloads so that a short one is
+    // parsed into a message which held a long one.
+    string data(i % 2 == 0 ? 64 * 1024 : i, 'a' + i % 26);
+    EchoRequestPB req;
+    req.set_data(data);
+    EchoResponsePB resp;
+    RpcController controller;
+    ASSERT_OK(p.Echo(req, &resp, &controller));
+    ASSERT_EQ(data, resp.data());
+    NO_FATALS(SendSimpleCall());
+  }
+}
+
 // Test calls which are rather large.
 // This test sends many of them at once using the async API and then
 // waits for them all to return. This is meant to ensure that the
@@ -452,6 +475,57 @@ TEST_F(RpcStubTest, TestDontHandleTimedOutCalls) {
 //
 // With EDF scheduling, the retries take priority over the original requests (because
 // they retain their original deadlines). This prevents starvation of unlucky threads.
+// Test that, with --rpc_reject_unmeetable_deadlines, a call which can't be
+// handled before its deadline is rejected as soon as it arrives.
+TEST_F(RpcStubTest, TestRejectCallsWithUnmeetableDeadlines) {
+  FLAGS_rpc_reject_unmeetable_deadlines = true;
+  CalculatorServiceProxy p(client_messenger_, server_addr_);
+
+  // Let the server measure how long a 100ms sleep call takes to handle.
+  for (int i = 0; i < 10; i++) {
+    RpcController rpc;
+    SleepRequestPB req;
+    SleepResponsePB resp;
+    req.set_sleep_micros(100*1000); // 100ms
+    ASSERT_OK(p.Sleep(req, &resp, &rpc));
+  }
+
+  // Occupy the worker threads, and wait until they are handling the calls.
+  vector<AsyncSleep*> sleeps;
+  ElementDeleter d(&sleeps);
+  const Histogram* queue_time_metric = service_pool_->IncomingQueueTimeMetricForTests();
+  int64_t handled = queue_time_metric->TotalCount();
+  for (int i = 0; i < n_worker_threads_; i++) {
+    gscoped_ptr<AsyncSleep> sleep(new AsyncSleep);
+    sleep->rpc.set_timeout(MonoDelta::FromSeconds(10));
+    sleep->req.set_sleep_micros(100*1000); // 100ms
+    p.SleepAsync(sleep->req, &sleep->resp, &sleep->rpc,
+                 boost::bind(&CountDownLatch::CountDown, &sleep->latch));
+    sleeps.push_back(sleep.release());
+  }
+  while (queue_time_metric->TotalCount() < handled + n_worker_threads_) {
+    SleepFor(MonoDelta::FromMilliseconds(1));
+  }
+
+  // A call with a deadline shorter than the measured service time is rejected
+  // without being queued.
+  RpcController rpc;
+  SleepRequestPB req;
+  SleepResponsePB resp;
+  req.set_sleep_micros(1000);
+  rpc.set_timeout(MonoDelta::FromMilliseconds(20));
+  Status s = p.Sleep(req, &resp, &rpc);
+  ASSERT_TRUE(s.IsRemoteError()) << s.ToString();
+  ASSERT_EQ(ErrorStatusPB::ERROR_SERVER_TOO_BUSY, rpc.error_response()->code());
+
+  for (AsyncSleep* sleep : sleeps) {
+    sleep->latch.Wait();
+    ASSERT_OK(sleep->rpc.status());
+  }
+  ASSERT_EQ(1, service_pool_->RpcsRejectedUnmeetableDeadlineMetricForTests()->value());
+  ASSERT_EQ(0, service_pool_->RpcsTimedOutInQueueMetricForTests()->value());
+}
+
 TEST_F(RpcStubTest, TestEarliestDeadlineFirstQueue) {
   const int num_client_threads = service_queue_length_ + n_worker_threads_ + 5;
   vector<std::thread> threads;
@@ -603,6 +677,38 @@ TEST_F(RpcStubTest, TestDumpSampledCalls) {
   ASSERT_STR_CONTAINS(SecureDebugString(sampled_rpcs), "duration_ms");
 }
 
+TEST_F(RpcStubTest, TestDumpSlowCalls) {
+  FLAGS_rpc_slow_call_trace_threshold_ms = 100;
+  CalculatorServiceProxy p(client_messenger_, server_addr_);
+
+  // Issue one call below the slow call threshold and one above it.
+  AsyncSleep sleeps[2];
+  sleeps[0].req.set_sleep_micros(10 * 1000); // 10ms
+  sleeps[1].req.set_sleep_micros(150 * 1000); // 150ms
+
+  for (auto& sleep : sleeps) {
+    p.SleepAsync(sleep.req, &sleep.resp, &sleep.rpc,
+                 boost::bind(&CountDownLatch::CountDown, &sleep.latch));
+  }
+  for (auto& sleep : sleeps) {
+    sleep.latch.Wait();
+  }
+
+  // Only the slow call is kept, with its full trace.
+  DumpRpczStoreResponsePB sampled_rpcs;
+  server_messenger_->rpcz_store()->DumpPB(DumpRpczStoreRequestPB(), &sampled_rpcs);
+  ASSERT_EQ(1, sampled_rpcs.slow_calls_size());
+  const auto& slow_call = sampled_rpcs.slow_calls(0);
+  ASSERT_GE(slow_call.duration_ms(), 150);
+  ASSERT_EQ("Sleep", slow_call.header().remote_method().method_name());
+  ASSERT_STR_CONTAINS(slow_call.trace(), "Inserting onto call queue");
+  ASSERT_STR_CONTAINS(SecureDebugString(slow_call),
+                      "  metrics {\n"
+                      "    key: \"test_sleep_us\"\n"
+                      "    value: 150000\n"
+                      "  }\n");
+}
+
 namespace {
 struct RefCountedTest : public RefCountedThreadSafe<RefCountedTest> {
 };
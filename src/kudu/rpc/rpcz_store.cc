@@ -40,7 +40,20 @@ DEFINE_bool(rpc_dump_all_traces, false,
 TAG_FLAG(rpc_dump_all_traces, advanced);
 TAG_FLAG(rpc_dump_all_traces, runtime);
 
+DEFINE_int32(rpc_slow_call_trace_threshold_ms, 500,
+             "Calls which take longer than this many milliseconds to complete are "
+             "kept with their traces in a buffer of the most recent slow calls, "
+             "shown on /rpcz. A negative value disables keeping them.");
+TAG_FLAG(rpc_slow_call_trace_threshold_ms, advanced);
+TAG_FLAG(rpc_slow_call_trace_threshold_ms, runtime);
+
+DEFINE_int32(rpc_num_slow_call_traces, 100,
+             "The maximum number of recent slow calls whose traces are kept. "
+             "See --rpc_slow_call_trace_threshold_ms.");
+TAG_FLAG(rpc_num_slow_call_traces, advanced);
+
 using std::pair;
+using std::string;
 using std::vector;
 using std::unique_ptr;
 
@@ -55,6 +68,32 @@ static const int kSampleIntervalMs = 1000;
 static const int kBucketThresholdsMs[] = {10, 100, 1000};
 static constexpr int kNumBuckets = arraysize(kBucketThresholdsMs) + 1;
 
+// Convert the trace metrics from 't' into protobuf entries in 'sample_pb'.
+// This function recurses through the parent-child relationship graph,
+// keeping the current tree path in 'child_path' (empty at the root).
+static void GetTraceMetrics(const Trace& t,
+                            const string& child_path,
+                            RpczSamplePB* sample_pb) {
+  auto m = t.metrics().Get();
+  for (const auto& e : m) {
+    auto* pb = sample_pb->add_metrics();
+    pb->set_key(e.first);
+    pb->set_value(e.second);
+    if (!child_path.empty()) {
+      pb->set_child_path(child_path);
+    }
+  }
+
+  for (const auto& child_pair : t.ChildTraces()) {
+    string path = child_path;
+    if (!path.empty()) {
+      path += ".";
+    }
+    path += child_pair.first.ToString();
+    GetTraceMetrics(*child_pair.second.get(), path, sample_pb);
+  }
+}
+
 // An instance of this class is created For each RPC method implemented
 // on the server. It keeps several recent samples for each RPC, currently
 // based on fixed time buckets.
@@ -70,13 +109,6 @@ class MethodSampler {
   void GetSamplePBs(RpczMethodPB* pb);
 
  private:
-  // Convert the trace metrics from 't' into protobuf entries in 'sample_pb'.
-  // This function recurses through the parent-child relationship graph,
-  // keeping the current tree path in 'child_path' (empty at the root).
-  static void GetTraceMetrics(const Trace& t,
-                              const std::string& child_path,
-                              RpczSamplePB* sample_pb);
-
   // An individual recorded sample.
   struct Sample {
     RequestHeader header;
@@ -98,6 +130,80 @@ class MethodSampler {
   DISALLOW_COPY_AND_ASSIGN(MethodSampler);
 };
 
+// Keeps the most recent calls which took longer than
+// --rpc_slow_call_trace_threshold_ms, with their traces, in a ring buffer.
+class SlowCallBuffer {
+ public:
+  explicit SlowCallBuffer(int capacity)
+      : capacity_(capacity),
+        next_(0) {
+  }
+
+  // Keep the call if it was slow enough.
+  void MaybeAddCall(InboundCall* call);
+
+  // Dump the kept calls, oldest first.
+  void GetSamplePBs(DumpRpczStoreResponsePB* resp);
+
+ private:
+  struct Sample {
+    RequestHeader header;
+    scoped_refptr<Trace> trace;
+    int duration_ms;
+  };
+
+  const int capacity_;
+
+  simple_spinlock lock_;
+  // The kept calls. Once the buffer is full, 'next_' is the index of the
+  // oldest call, which the next slow call replaces.
+  vector<Sample> samples_;  // protected by lock_
+  int next_;  // protected by lock_
+
+  DISALLOW_COPY_AND_ASSIGN(SlowCallBuffer);
+};
+
+void SlowCallBuffer::MaybeAddCall(InboundCall* call) {
+  int threshold_ms = FLAGS_rpc_slow_call_trace_threshold_ms;
+  if (threshold_ms < 0 || capacity_ <= 0) {
+    return;
+  }
+  int duration_ms = call->timing().TotalDuration().ToMilliseconds();
+  if (duration_ms <= threshold_ms) {
+    return;
+  }
+
+  // Copy the header before taking the lock.
+  Sample new_sample = {call->header(), call->trace(), duration_ms};
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (static_cast<int>(samples_.size()) < capacity_) {
+    samples_.emplace_back();
+    std::swap(samples_.back(), new_sample);
+    return;
+  }
+  std::swap(samples_[next_], new_sample);
+  next_ = (next_ + 1) % capacity_;
+  // The replaced sample, and its trace, are destroyed once the lock is released.
+}
+
+void SlowCallBuffer::GetSamplePBs(DumpRpczStoreResponsePB* resp) {
+  vector<Sample> samples;
+  int next;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    samples = samples_;
+    next = next_;
+  }
+  for (size_t i = 0; i < samples.size(); i++) {
+    const Sample& sample = samples[(next + i) % samples.size()];
+    auto* sample_pb = resp->add_slow_calls();
+    sample_pb->mutable_header()->CopyFrom(sample.header);
+    sample_pb->set_trace(sample.trace->DumpToString(Trace::INCLUDE_TIME_DELTAS));
+    GetTraceMetrics(*sample.trace.get(), "", sample_pb);
+    sample_pb->set_duration_ms(sample.duration_ms);
+  }
+}
+
 MethodSampler* RpczStore::SamplerForCall(InboundCall* call) {
   if (PREDICT_FALSE(!call->method_info())) {
     return nullptr;
@@ -153,29 +259,6 @@ void MethodSampler::SampleCall(InboundCall* call) {
   }
 }
 
-void MethodSampler::GetTraceMetrics(const Trace& t,
-                                    const string& child_path,
-                                    RpczSamplePB* sample_pb) {
-  auto m = t.metrics().Get();
-  for (const auto& e : m) {
-    auto* pb = sample_pb->add_metrics();
-    pb->set_key(e.first);
-    pb->set_value(e.second);
-    if (!child_path.empty()) {
-      pb->set_child_path(child_path);
-    }
-  }
-
-  for (const auto& child_pair : t.ChildTraces()) {
-    string path = child_path;
-    if (!path.empty()) {
-      path += ".";
-    }
-    path += child_pair.first.ToString();
-    GetTraceMetrics(*child_pair.second.get(), path, sample_pb);
-  }
-}
-
 void MethodSampler::GetSamplePBs(RpczMethodPB* method_pb) {
   for (auto& bucket : buckets_) {
     if (bucket.last_sample_time.Load() == 0) continue;
@@ -190,11 +273,15 @@ void MethodSampler::GetSamplePBs(RpczMethodPB* method_pb) {
   }
 }
 
-RpczStore::RpczStore() {}
+RpczStore::RpczStore()
+    : slow_calls_(new SlowCallBuffer(FLAGS_rpc_num_slow_call_traces)) {
+}
+
 RpczStore::~RpczStore() {}
 
 void RpczStore::AddCall(InboundCall* call) {
   LogTrace(call);
+  slow_calls_->MaybeAddCall(call);
   auto* sampler = SamplerForCall(call);
   if (PREDICT_FALSE(!sampler)) return;
 
@@ -221,6 +308,8 @@ void RpczStore::DumpPB(const DumpRpczStoreRequestPB& req,
     method_pb->set_method_name(p.first->req_prototype->GetTypeName());
     sampler->GetSamplePBs(method_pb);
   }
+
+  slow_calls_->GetSamplePBs(resp);
 }
 
 void RpczStore::LogTrace(InboundCall* call) {
@@ -31,9 +31,14 @@ class DumpRpczStoreResponsePB;
 class InboundCall;
 class MethodSampler;
 struct RpcMethodInfo;
+class SlowCallBuffer;
 
 // Responsible for storing sampled traces associated with completed calls.
 // Before each call is responded to, it is added to this store.
+//
+// Besides the periodic samples per method and latency bucket, the calls
+// slower than --rpc_slow_call_trace_threshold_ms are all kept, with their
+// traces, in a bounded buffer of the most recent ones.
 class RpczStore {
  public:
   RpczStore();
@@ -67,6 +72,8 @@ class RpczStore {
   // Protected by samplers_lock_.
   std::unordered_map<RpcMethodInfo*, std::unique_ptr<MethodSampler>> method_samplers_;
 
+  const std::unique_ptr<SlowCallBuffer> slow_calls_;
+
   DISALLOW_COPY_AND_ASSIGN(RpczStore);
 };
 
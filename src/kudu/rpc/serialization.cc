@@ -20,11 +20,13 @@
 #include <glog/logging.h>
 #include <google/protobuf/message_lite.h>
 #include <google/protobuf/io/coded_stream.h>
+#include <lz4.h>
 
 #include "kudu/gutil/endian.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/rpc/constants.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/faststring.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/slice.h"
@@ -35,6 +37,7 @@ DECLARE_int32(rpc_max_message_size);
 using google::protobuf::MessageLite;
 using google::protobuf::io::CodedInputStream;
 using google::protobuf::io::CodedOutputStream;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -153,6 +156,62 @@ Status ParseMessage(const Slice& buf,
   return Status::OK();
 }
 
+bool CompressPayload(const Slice& message_buf,
+                     const vector<Slice>& sidecars,
+                     faststring* compressed_buf,
+                     uint32_t* payload_len) {
+  // Strip the length prefix written by SerializeMessage().
+  CodedInputStream in(message_buf.data(), message_buf.size());
+  uint32_t len;
+  CHECK(in.ReadVarint32(&len));
+  vector<Slice> payload;
+  payload.reserve(1 + sidecars.size());
+  payload.emplace_back(message_buf.data() + in.CurrentPosition(),
+                       message_buf.size() - in.CurrentPosition());
+  payload.insert(payload.end(), sidecars.begin(), sidecars.end());
+
+  const CompressionCodec* codec;
+  CHECK_OK(GetCompressionCodec(LZ4, &codec));
+  size_t max_compressed_len = codec->MaxCompressedLength(len);
+  int max_delim_len = CodedOutputStream::VarintSize32(max_compressed_len);
+  compressed_buf->resize(max_delim_len + max_compressed_len);
+  size_t compressed_len;
+  CHECK_OK(codec->Compress(payload, compressed_buf->data() + max_delim_len, &compressed_len));
+  int delim_len = CodedOutputStream::VarintSize32(compressed_len);
+  if (compressed_len + delim_len >= len + in.CurrentPosition()) {
+    return false;
+  }
+
+  // Move the compressed bytes up against their length prefix.
+  memmove(compressed_buf->data() + delim_len, compressed_buf->data() + max_delim_len,
+          compressed_len);
+  CodedOutputStream::WriteVarint32ToArray(compressed_len, compressed_buf->data());
+  compressed_buf->resize(delim_len + compressed_len);
+  *payload_len = len;
+  return true;
+}
+
+Status UncompressPayload(const Slice& compressed,
+                         uint32_t payload_len,
+                         faststring* payload_buf) {
+  if (PREDICT_FALSE(static_cast<int64_t>(payload_len) > FLAGS_rpc_max_message_size)) {
+    return Status::Corruption(Substitute(
+        "Invalid packet: uncompressed payload of $0 bytes is larger than the maximum "
+        "configured RPC message size ($1 bytes)", payload_len, FLAGS_rpc_max_message_size));
+  }
+  // Unlike the LZ4 codec, which trusts its input, bound the reads by the size
+  // of the compressed payload, since it comes from the network.
+  payload_buf->resize(payload_len);
+  int n = LZ4_decompress_safe(reinterpret_cast<const char*>(compressed.data()),
+                              reinterpret_cast<char*>(payload_buf->data()),
+                              compressed.size(), payload_len);
+  if (PREDICT_FALSE(n != static_cast<int>(payload_len))) {
+    return Status::Corruption("Invalid packet: unable to uncompress payload",
+                              KUDU_REDACT(compressed.ToDebugString(100)));
+  }
+  return Status::OK();
+}
+
 void SerializeConnHeader(uint8_t* buf) {
   memcpy(reinterpret_cast<char *>(buf), kMagicNumber, kMagicNumberLength);
   buf += kMagicNumberLength;
@@ -74,6 +74,28 @@ Status ParseMessage(const Slice& buf,
                     google::protobuf::MessageLite* parsed_header,
                     Slice* parsed_main_message);
 
+// LZ4-compress the main payload of a call, i.e. the serialized message and
+// the sidecars which follow it.
+// In: 'message_buf' as populated by SerializeMessage(),
+//     the sidecars of the call, in order.
+// Out: 'compressed_buf' to be populated with the compressed payload, prefixed
+//        with its length like 'message_buf',
+//      'payload_len' set to the length of the uncompressed payload.
+// Returns false, leaving the payload to be sent uncompressed, if compressing
+// it doesn't make it smaller.
+bool CompressPayload(const Slice& message_buf,
+                     const std::vector<Slice>& sidecars,
+                     faststring* compressed_buf,
+                     uint32_t* payload_len);
+
+// Uncompress a main payload compressed by CompressPayload().
+// In: 'compressed' main payload, as returned by ParseMessage(),
+//     'payload_len' from the header of the call.
+// Out: 'payload_buf' to be populated with the uncompressed payload.
+Status UncompressPayload(const Slice& compressed,
+                         uint32_t payload_len,
+                         faststring* payload_buf);
+
 // Serialize the RPC connection header (magic number + flags).
 // buf must have 7 bytes available (kMagicNumberLength + kHeaderFlagsLength).
 void SerializeConnHeader(uint8_t* buf);
@@ -80,6 +80,7 @@ ServerNegotiation::ServerNegotiation(unique_ptr<Socket> socket,
       helper_(SaslHelper::SERVER),
       tls_context_(tls_context),
       tls_negotiated_(false),
+      compression_enabled_(false),
       token_verifier_(token_verifier),
       negotiated_authn_(AuthenticationType::INVALID),
       negotiated_mech_(SaslMechanism::INVALID),
@@ -399,6 +400,9 @@ Status ServerNegotiation::HandleNegotiate(const NegotiatePB& request) {
 
   // Tell the client which features we support.
   server_features_ = kSupportedServerRpcFeatureFlags;
+  if (compression_enabled_) {
+    server_features_.insert(PAYLOAD_COMPRESSION);
+  }
   if (tls_context_->has_cert()) {
     server_features_.insert(TLS);
     // If the remote peer is local, then we allow using TLS for authentication
@@ -18,6 +18,7 @@
 #include "kudu/rpc/service_if.h"
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <google/protobuf/descriptor.pb.h>
 
@@ -35,6 +36,18 @@
 DEFINE_bool(enable_exactly_once, true, "Whether to enable exactly once semantics.");
 TAG_FLAG(enable_exactly_once, hidden);
 
+DEFINE_int32(rpc_max_pooled_messages_per_method, 32,
+             "Maximum number of cleared request and response protobufs of each RPC "
+             "method kept for reuse by later calls. 0 disables the reuse.");
+TAG_FLAG(rpc_max_pooled_messages_per_method, advanced);
+TAG_FLAG(rpc_max_pooled_messages_per_method, runtime);
+
+DEFINE_int64(rpc_max_pooled_message_bytes, 256 * 1024,
+             "Request and response protobufs which hold more memory than this "
+             "are freed rather than kept for reuse by later calls.");
+TAG_FLAG(rpc_max_pooled_message_bytes, advanced);
+TAG_FLAG(rpc_max_pooled_message_bytes, runtime);
+
 using google::protobuf::Message;
 using std::string;
 using std::unique_ptr;
@@ -43,6 +56,29 @@ using strings::Substitute;
 namespace kudu {
 namespace rpc {
 
+unique_ptr<Message> MessagePool::Get(const Message& prototype) {
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    if (!free_.empty()) {
+      unique_ptr<Message> msg = std::move(free_.back());
+      free_.pop_back();
+      return msg;
+    }
+  }
+  return unique_ptr<Message>(prototype.New());
+}
+
+void MessagePool::Put(unique_ptr<Message> msg) {
+  if (msg->SpaceUsed() > FLAGS_rpc_max_pooled_message_bytes) {
+    return;
+  }
+  msg->Clear();
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (static_cast<int>(free_.size()) < FLAGS_rpc_max_pooled_messages_per_method) {
+    free_.emplace_back(std::move(msg));
+  }
+}
+
 ServiceIf::~ServiceIf() {
 }
 
@@ -93,11 +129,12 @@ void GeneratedServiceIf::Handle(InboundCall *call) {
     RespondBadMethod(call);
     return;
   }
-  unique_ptr<Message> req(method_info->req_prototype->New());
+  unique_ptr<Message> req(method_info->req_pool.Get(*method_info->req_prototype));
   if (PREDICT_FALSE(!ParseParam(call, req.get()))) {
+    method_info->req_pool.Put(std::move(req));
     return;
   }
-  Message* resp = method_info->resp_prototype->New();
+  Message* resp = method_info->resp_pool.Get(*method_info->resp_prototype).release();
 
   bool track_result = call->header().has_request_id()
                       && method_info->track_result
@@ -144,6 +181,15 @@ RpcMethodInfo* GeneratedServiceIf::LookupMethod(const RemoteMethod& method) {
   return it->second.get();
 }
 
+bool GeneratedServiceIf::HasMethodsWithPriority(RpcPriority priority) const {
+  for (const auto& entry : methods_by_name_) {
+    if (entry.second->priority == priority) {
+      return true;
+    }
+  }
+  return false;
+}
+
 
 } // namespace rpc
 } // namespace kudu
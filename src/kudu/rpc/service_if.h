@@ -17,14 +17,18 @@
 #ifndef KUDU_RPC_SERVICE_IF_H
 #define KUDU_RPC_SERVICE_IF_H
 
+#include <memory>
 #include <unordered_map>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/net/sockaddr.h"
 #include "kudu/rpc/result_tracker.h"
+#include "kudu/rpc/rpc_header.pb.h"
 
 namespace google {
 namespace protobuf {
@@ -43,6 +47,34 @@ class RemoteMethod;
 class RpcContext;
 class ServiceIf;
 
+// A bounded free list of cleared protobuf messages of one type.
+//
+// Clearing a protobuf keeps the capacity of its strings and the elements of
+// its repeated fields, so a call which reuses a message from an earlier call
+// mostly parses into memory that is already allocated, rather than making
+// the allocator churn through a message's worth of small objects per call.
+//
+// This class is thread-safe.
+class MessagePool {
+ public:
+  MessagePool() {}
+
+  // Returns an empty message of the same type as 'prototype', either taken
+  // from the pool or newly allocated.
+  std::unique_ptr<google::protobuf::Message> Get(const google::protobuf::Message& prototype);
+
+  // Clears 'msg' and keeps it for a later Get(). The message is freed instead
+  // if the pool is full, or if it holds more than --rpc_max_pooled_message_bytes
+  // of memory, so that one large call doesn't pin its memory indefinitely.
+  void Put(std::unique_ptr<google::protobuf::Message> msg);
+
+ private:
+  simple_spinlock lock_;
+  std::vector<std::unique_ptr<google::protobuf::Message>> free_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessagePool);
+};
+
 // Generated services define an instance of this class for each
 // method that they implement. The generic server code implemented
 // by GeneratedServiceIf look up the RpcMethodInfo in order to handle
@@ -54,11 +86,20 @@ struct RpcMethodInfo : public RefCountedThreadSafe<RpcMethodInfo> {
   std::unique_ptr<google::protobuf::Message> req_prototype;
   std::unique_ptr<google::protobuf::Message> resp_prototype;
 
+  // Recycled request and response protobufs, which are handed to calls in
+  // preference to new clones of the prototypes.
+  MessagePool req_pool;
+  MessagePool resp_pool;
+
   scoped_refptr<Histogram> handler_latency_histogram;
 
   // Whether we should track this method's result, using ResultTracker.
   bool track_result;
 
+  // The priority class of the method, which selects the service queue its
+  // calls are put on.
+  RpcPriority priority = NORMAL_PRIORITY;
+
   // The authorization function for this RPC. If this function
   // returns false, the RPC has already been handled (i.e. rejected)
   // by the authorization function.
@@ -92,6 +133,11 @@ class ServiceIf {
     return nullptr;
   }
 
+  // Returns true if any method of the service is of priority class 'priority'.
+  virtual bool HasMethodsWithPriority(RpcPriority priority) const {
+    return false;
+  }
+
   // Default authorization method, which just allows all RPCs.
   //
   // See docs/design-docs/rpc.md for details on how to add custom
@@ -121,6 +167,8 @@ class GeneratedServiceIf : public ServiceIf {
 
   RpcMethodInfo* LookupMethod(const RemoteMethod& method) override;
 
+  bool HasMethodsWithPriority(RpcPriority priority) const override;
+
  protected:
   // For each method, stores the relevant information about how to handle the
   // call. Methods are inserted by the constructor of the generated subclass.
@@ -17,6 +17,8 @@
 
 #include "kudu/rpc/service_pool.h"
 
+#include <algorithm>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <memory>
 #include <string>
@@ -29,8 +31,10 @@
 #include "kudu/rpc/service_if.h"
 #include "kudu/rpc/service_queue.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/status.h"
 #include "kudu/util/thread.h"
 #include "kudu/util/trace.h"
@@ -38,10 +42,41 @@
 using std::shared_ptr;
 using strings::Substitute;
 
+DEFINE_bool(rpc_reject_unmeetable_deadlines, false,
+            "Whether to reject incoming RPC requests as soon as they arrive if, "
+            "judging by the requests queued ahead of them and the measured time "
+            "it takes to handle a request, they are not expected to be handled "
+            "before their deadline. Requests whose deadline passes while they "
+            "are queued are dropped regardless.");
+TAG_FLAG(rpc_reject_unmeetable_deadlines, advanced);
+TAG_FLAG(rpc_reject_unmeetable_deadlines, experimental);
+TAG_FLAG(rpc_reject_unmeetable_deadlines, runtime);
+
 METRIC_DEFINE_histogram(server, rpc_incoming_queue_time,
                         "RPC Queue Time",
                         kudu::MetricUnit::kMicroseconds,
                         "Number of microseconds incoming RPC requests spend in the worker queue",
+                        60000000LU, 3, kudu::STRIPED_HISTOGRAM);
+
+METRIC_DEFINE_histogram(server, rpc_incoming_queue_time_normal_priority,
+                        "RPC Queue Time (Normal Priority)",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Number of microseconds incoming RPC requests spend in the worker "
+                        "queue of calls without reserved worker threads",
+                        60000000LU, 3);
+
+METRIC_DEFINE_histogram(server, rpc_incoming_queue_time_high_priority,
+                        "RPC Queue Time (High Priority)",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Number of microseconds incoming high priority RPC requests spend "
+                        "in the worker queue of their reserved worker threads",
+                        60000000LU, 3);
+
+METRIC_DEFINE_histogram(server, rpc_incoming_queue_time_low_priority,
+                        "RPC Queue Time (Low Priority)",
+                        kudu::MetricUnit::kMicroseconds,
+                        "Number of microseconds incoming low priority RPC requests spend "
+                        "in the worker queue of their reserved worker threads",
                         60000000LU, 3);
 
 METRIC_DEFINE_counter(server, rpcs_timed_out_in_queue,
@@ -50,6 +85,12 @@ METRIC_DEFINE_counter(server, rpcs_timed_out_in_queue,
                       "Number of RPCs whose timeout elapsed while waiting "
                       "in the service queue, and thus were not processed.");
 
+METRIC_DEFINE_counter(server, rpcs_rejected_unmeetable_deadline,
+                      "RPC Unmeetable Deadline Rejections",
+                      kudu::MetricUnit::kRequests,
+                      "Number of RPCs rejected on arrival because they were not "
+                      "expected to be handled before their deadline.");
+
 METRIC_DEFINE_counter(server, rpcs_queue_overflow,
                       "RPC Queue Overflows",
                       kudu::MetricUnit::kRequests,
@@ -63,29 +104,56 @@ ServicePool::ServicePool(gscoped_ptr<ServiceIf> service,
                          const scoped_refptr<MetricEntity>& entity,
                          size_t service_queue_length)
   : service_(std::move(service)),
-    service_queue_(service_queue_length),
+    service_queue_length_(service_queue_length),
     incoming_queue_time_(METRIC_rpc_incoming_queue_time.Instantiate(entity)),
     rpcs_timed_out_in_queue_(METRIC_rpcs_timed_out_in_queue.Instantiate(entity)),
     rpcs_queue_overflow_(METRIC_rpcs_queue_overflow.Instantiate(entity)),
+    rpcs_rejected_unmeetable_deadline_(
+        METRIC_rpcs_rejected_unmeetable_deadline.Instantiate(entity)),
     closing_(false) {
+  queues_[NORMAL_PRIORITY].reset(new PriorityQueue(NORMAL_PRIORITY, service_queue_length_));
+  class_queue_time_[NORMAL_PRIORITY] =
+      METRIC_rpc_incoming_queue_time_normal_priority.Instantiate(entity);
+  class_queue_time_[HIGH_PRIORITY] =
+      METRIC_rpc_incoming_queue_time_high_priority.Instantiate(entity);
+  class_queue_time_[LOW_PRIORITY] =
+      METRIC_rpc_incoming_queue_time_low_priority.Instantiate(entity);
 }
 
 ServicePool::~ServicePool() {
   Shutdown();
 }
 
+void ServicePool::ReserveThreads(RpcPriority priority, int num_threads) {
+  DCHECK_NE(NORMAL_PRIORITY, priority);
+  DCHECK(threads_.empty()) << "threads must be reserved before Init()";
+  if (num_threads <= 0 || !service_->HasMethodsWithPriority(priority)) {
+    return;
+  }
+  if (!queues_[priority]) {
+    queues_[priority].reset(new PriorityQueue(priority, service_queue_length_));
+  }
+  queues_[priority]->num_threads = num_threads;
+}
+
 Status ServicePool::Init(int num_threads) {
-  for (int i = 0; i < num_threads; i++) {
-    scoped_refptr<kudu::Thread> new_thread;
-    CHECK_OK(kudu::Thread::Create("service pool", "rpc worker",
-        &ServicePool::RunThread, this, &new_thread));
-    threads_.push_back(new_thread);
+  queues_[NORMAL_PRIORITY]->num_threads = num_threads;
+  for (const auto& queue : queues_) {
+    if (!queue) continue;
+    for (int i = 0; i < queue->num_threads; i++) {
+      scoped_refptr<kudu::Thread> new_thread;
+      CHECK_OK(kudu::Thread::Create("service pool", "rpc worker",
+          &ServicePool::RunThread, this, queue.get(), &new_thread));
+      threads_.push_back(new_thread);
+    }
   }
   return Status::OK();
 }
 
 void ServicePool::Shutdown() {
-  service_queue_.Shutdown();
+  for (const auto& queue : queues_) {
+    if (queue) queue->queue.Shutdown();
+  }
 
   MutexLock lock(shutdown_lock_);
   if (closing_) return;
@@ -95,30 +163,53 @@ void ServicePool::Shutdown() {
     CHECK_OK(ThreadJoiner(thread.get()).Join());
   }
 
-  // Now we must drain the service queue.
+  // Now we must drain the service queues.
   Status status = Status::ServiceUnavailable("Service is shutting down");
-  std::unique_ptr<InboundCall> incoming;
-  while (service_queue_.BlockingGet(&incoming)) {
-    incoming.release()->RespondFailure(ErrorStatusPB::FATAL_SERVER_SHUTTING_DOWN, status);
+  for (const auto& queue : queues_) {
+    if (!queue) continue;
+    std::unique_ptr<InboundCall> incoming;
+    while (queue->queue.BlockingGet(&incoming)) {
+      incoming.release()->RespondFailure(ErrorStatusPB::FATAL_SERVER_SHUTTING_DOWN, status);
+    }
   }
 
   service_->Shutdown();
 }
 
-void ServicePool::RejectTooBusy(InboundCall* c) {
+void ServicePool::RejectTooBusy(InboundCall* c, const LifoServiceQueue& queue) {
   string err_msg =
       Substitute("$0 request on $1 from $2 dropped due to backpressure. "
                  "The service queue is full; it has $3 items.",
                  c->remote_method().method_name(),
                  service_->service_name(),
                  c->remote_address().ToString(),
-                 service_queue_.max_size());
+                 queue.max_size());
   rpcs_queue_overflow_->Increment();
   KLOG_EVERY_N_SECS(WARNING, 1) << err_msg;
   c->RespondFailure(ErrorStatusPB::ERROR_SERVER_TOO_BUSY,
                     Status::ServiceUnavailable(err_msg));
   DLOG(INFO) << err_msg << " Contents of service queue:\n"
-             << service_queue_.ToString();
+             << queue.ToString();
+}
+
+ServicePool::PriorityQueue* ServicePool::QueueFor(InboundCall* c) {
+  const RpcMethodInfo* method_info = c->method_info();
+  if (method_info && queues_[method_info->priority]) {
+    return queues_[method_info->priority].get();
+  }
+  return queues_[NORMAL_PRIORITY].get();
+}
+
+bool ServicePool::CannotMeetDeadline(InboundCall* c, PriorityQueue* queue) {
+  MonoTime deadline = c->GetClientDeadline();
+  if (deadline == MonoTime::Max() || queue->queue.estimated_idle_worker_count() > 0) {
+    return false;
+  }
+  // The threads work through the calls ahead of 'c' in rounds of 'num_threads'
+  // calls, and then handle 'c' itself.
+  int64_t rounds = queue->queue.NumQueuedAhead(c) / std::max(queue->num_threads, 1) + 1;
+  int64_t service_time_us = queue->service_time_us.load(std::memory_order_relaxed);
+  return MonoTime::Now() + MonoDelta::FromMicroseconds(rounds * service_time_us) > deadline;
 }
 
 RpcMethodInfo* ServicePool::LookupMethod(const RemoteMethod& method) {
@@ -142,16 +233,31 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
 
   TRACE_TO(c->trace(), "Inserting onto call queue");
 
+  PriorityQueue* priority_queue = QueueFor(c);
+  if (FLAGS_rpc_reject_unmeetable_deadlines && CannotMeetDeadline(c, priority_queue)) {
+    string err_msg =
+        Substitute("$0 request on $1 from $2 rejected since it is not expected to be "
+                   "handled before its deadline.",
+                   c->remote_method().method_name(),
+                   service_->service_name(),
+                   c->remote_address().ToString());
+    rpcs_rejected_unmeetable_deadline_->Increment();
+    KLOG_EVERY_N_SECS(WARNING, 1) << err_msg;
+    c->RespondFailure(ErrorStatusPB::ERROR_SERVER_TOO_BUSY, Status::TimedOut(err_msg));
+    return Status::OK();
+  }
+
   // Queue message on service queue
+  LifoServiceQueue* queue = &priority_queue->queue;
   boost::optional<InboundCall*> evicted;
-  auto queue_status = service_queue_.Put(c, &evicted);
+  auto queue_status = queue->Put(c, &evicted);
   if (queue_status == QUEUE_FULL) {
-    RejectTooBusy(c);
+    RejectTooBusy(c, *queue);
     return Status::OK();
   }
 
   if (PREDICT_FALSE(evicted != boost::none)) {
-    RejectTooBusy(*evicted);
+    RejectTooBusy(*evicted, *queue);
   }
 
   if (PREDICT_TRUE(queue_status == QUEUE_SUCCESS)) {
@@ -172,15 +278,17 @@ Status ServicePool::QueueInboundCall(gscoped_ptr<InboundCall> call) {
   return status;
 }
 
-void ServicePool::RunThread() {
+void ServicePool::RunThread(PriorityQueue* queue) {
+  const scoped_refptr<Histogram>& class_queue_time = class_queue_time_[queue->priority];
   while (true) {
     std::unique_ptr<InboundCall> incoming;
-    if (!service_queue_.BlockingGet(&incoming)) {
+    if (!queue->queue.BlockingGet(&incoming)) {
       VLOG(1) << "ServicePool: messenger shutting down.";
       return;
     }
 
     incoming->RecordHandlingStarted(incoming_queue_time_);
+    class_queue_time->Increment(incoming->GetTimeInQueue().ToMicroseconds());
     ADOPT_TRACE(incoming->trace());
 
     if (PREDICT_FALSE(incoming->ClientTimedOut())) {
@@ -203,7 +311,16 @@ void ServicePool::RunThread() {
 
     // Release the InboundCall pointer -- when the call is responded to,
     // it will get deleted at that point.
+    MonoTime handling_started = MonoTime::Now();
     service_->Handle(incoming.release());
+
+    // Fold the handling time into the moving average used to predict whether
+    // new calls can meet their deadline. Concurrent updates may overwrite one
+    // another, which is fine for an estimate.
+    int64_t sample_us = (MonoTime::Now() - handling_started).ToMicroseconds();
+    int64_t average_us = queue->service_time_us.load(std::memory_order_relaxed);
+    queue->service_time_us.store(average_us + (sample_us - average_us) / 8,
+                                 std::memory_order_relaxed);
   }
 }
 
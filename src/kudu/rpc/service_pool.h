@@ -18,12 +18,15 @@
 #ifndef KUDU_SERVICE_POOL_H
 #define KUDU_SERVICE_POOL_H
 
+#include <atomic>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/rpc/rpc_header.pb.h"
 #include "kudu/rpc/rpc_service.h"
 #include "kudu/rpc/service_queue.h"
 #include "kudu/util/mutex.h"
@@ -44,6 +47,11 @@ class ServiceIf;
 
 // A pool of threads that handle new incoming RPC calls.
 // Also includes a queue that calls get pushed onto for handling by the pool.
+//
+// Threads may be reserved for the methods of a priority class other than
+// NORMAL_PRIORITY. Calls to those methods then get a queue of their own, served
+// only by the reserved threads, so that they never wait behind the calls to the
+// rest of the service.
 class ServicePool : public RpcService {
  public:
   ServicePool(gscoped_ptr<ServiceIf> service,
@@ -51,7 +59,13 @@ class ServicePool : public RpcService {
               size_t service_queue_length);
   virtual ~ServicePool();
 
-  // Start up the thread pool.
+  // Reserves 'num_threads' threads for the calls to the methods of priority
+  // class 'priority'. Has no effect if 'num_threads' is 0 or the service has no
+  // such methods. Must be called before Init().
+  void ReserveThreads(RpcPriority priority, int num_threads);
+
+  // Start up the thread pool, with 'num_threads' threads for the calls which
+  // have no reserved threads, in addition to any reserved ones.
   virtual Status Init(int num_threads);
 
   // Shut down the queue and the thread pool.
@@ -69,6 +83,14 @@ class ServicePool : public RpcService {
     return incoming_queue_time_.get();
   }
 
+  const Histogram* IncomingQueueTimeMetricForTests(RpcPriority priority) const {
+    return class_queue_time_[priority].get();
+  }
+
+  const Counter* RpcsRejectedUnmeetableDeadlineMetricForTests() const {
+    return rpcs_rejected_unmeetable_deadline_.get();
+  }
+
   const Counter* RpcsQueueOverflowMetric() const {
     return rpcs_queue_overflow_.get();
   }
@@ -76,15 +98,49 @@ class ServicePool : public RpcService {
   const std::string service_name() const;
 
  private:
-  void RunThread();
-  void RejectTooBusy(InboundCall* c);
+  // The queue of the calls of one priority class, along with the threads
+  // that serve it.
+  struct PriorityQueue {
+    PriorityQueue(RpcPriority priority, size_t max_size)
+        : priority(priority),
+          queue(max_size),
+          num_threads(0),
+          service_time_us(0) {
+    }
+
+    const RpcPriority priority;
+    LifoServiceQueue queue;
+    int num_threads;
+
+    // Moving average of the time the threads spend handling a call.
+    std::atomic<int64_t> service_time_us;
+  };
+
+  // Returns the queue that 'c' should be put on.
+  PriorityQueue* QueueFor(InboundCall* c);
+
+  // Returns true if 'c', were it put on 'queue' now, is not expected to be
+  // handled before its deadline, judging by the calls queued ahead of it and
+  // the measured service time of the queue's calls.
+  bool CannotMeetDeadline(InboundCall* c, PriorityQueue* queue);
+
+  void RunThread(PriorityQueue* queue);
+  void RejectTooBusy(InboundCall* c, const LifoServiceQueue& queue);
 
   gscoped_ptr<ServiceIf> service_;
   std::vector<scoped_refptr<kudu::Thread> > threads_;
-  LifoServiceQueue service_queue_;
+  const size_t service_queue_length_;
+
+  // Indexed by priority class. The NORMAL_PRIORITY queue always exists and
+  // holds the calls of any class without reserved threads.
+  std::unique_ptr<PriorityQueue> queues_[RpcPriority_ARRAYSIZE];
+
   scoped_refptr<Histogram> incoming_queue_time_;
+  // Queue times of the calls served from each queue, indexed by priority class.
+  scoped_refptr<Histogram> class_queue_time_[RpcPriority_ARRAYSIZE];
   scoped_refptr<Counter> rpcs_timed_out_in_queue_;
   scoped_refptr<Counter> rpcs_queue_overflow_;
+  scoped_refptr<Counter> rpcs_rejected_unmeetable_deadline_;
 
   mutable Mutex shutdown_lock_;
   bool closing_;
@@ -17,6 +17,7 @@
 
 #include "kudu/rpc/service_queue.h"
 
+#include <iterator>
 #include <mutex>
 
 #include "kudu/util/logging.h"
@@ -127,6 +128,11 @@ int LifoServiceQueue::max_size() const {
   return max_queue_size_;
 }
 
+int LifoServiceQueue::NumQueuedAhead(InboundCall* call) const {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return std::distance(queue_.begin(), queue_.lower_bound(call));
+}
+
 std::string LifoServiceQueue::ToString() const {
   std::string ret;
 
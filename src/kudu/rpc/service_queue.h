@@ -100,6 +100,10 @@ class LifoServiceQueue {
 
   std::string ToString() const;
 
+  // Returns the number of queued calls which would be dequeued before 'call',
+  // were it put on the queue now.
+  int NumQueuedAhead(InboundCall* call) const;
+
   // Return an estimate of the current queue length.
   int estimated_queue_length() const {
     ANNOTATE_IGNORE_READS_BEGIN();
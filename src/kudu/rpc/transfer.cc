@@ -179,40 +179,38 @@ void OutboundTransfer::Abort(const Status &status) {
   aborted_ = true;
 }
 
-Status OutboundTransfer::SendBuffer(Socket &socket) {
+int32_t OutboundTransfer::FillIovecs(struct ::iovec* iov) const {
   CHECK_LT(cur_slice_idx_, n_payload_slices_);
 
-  int n_iovecs = n_payload_slices_ - cur_slice_idx_;
-  struct iovec iovec[n_iovecs];
-  {
-    int offset_in_slice = cur_offset_in_slice_;
-    for (int i = 0; i < n_iovecs; i++) {
-      Slice &slice = payload_slices_[cur_slice_idx_ + i];
-      iovec[i].iov_base = slice.mutable_data() + offset_in_slice;
-      iovec[i].iov_len = slice.size() - offset_in_slice;
+  int32_t nbytes = 0;
+  int offset_in_slice = cur_offset_in_slice_;
+  for (int i = 0; i < num_unsent_slices(); i++) {
+    const Slice& slice = payload_slices_[cur_slice_idx_ + i];
+    iov[i].iov_base = const_cast<uint8_t*>(slice.data()) + offset_in_slice;
+    iov[i].iov_len = slice.size() - offset_in_slice;
+    nbytes += iov[i].iov_len;
 
-      offset_in_slice = 0;
-    }
+    offset_in_slice = 0;
   }
+  return nbytes;
+}
 
-  int32_t written;
-  Status status = socket.Writev(iovec, n_iovecs, &written);
-  RETURN_ON_ERROR_OR_SOCKET_NOT_READY(status);
-
+int32_t OutboundTransfer::Advance(int32_t nbytes) {
   // Adjust our accounting of current writer position.
   for (int i = cur_slice_idx_; i < n_payload_slices_; i++) {
     Slice &slice = payload_slices_[i];
     int rem_in_slice = slice.size() - cur_offset_in_slice_;
     DCHECK_GE(rem_in_slice, 0);
 
-    if (written >= rem_in_slice) {
+    if (nbytes >= rem_in_slice) {
       // Used up this entire slice, advance to the next slice.
       cur_slice_idx_++;
       cur_offset_in_slice_ = 0;
-      written -= rem_in_slice;
+      nbytes -= rem_in_slice;
     } else {
       // Partially used up this slice, just advance the offset within it.
-      cur_offset_in_slice_ += written;
+      cur_offset_in_slice_ += nbytes;
+      nbytes = 0;
       break;
     }
   }
@@ -221,11 +219,12 @@ Status OutboundTransfer::SendBuffer(Socket &socket) {
     callbacks_->NotifyTransferFinished();
     DCHECK_EQ(0, cur_offset_in_slice_);
   } else {
+    DCHECK_EQ(0, nbytes);
     DCHECK_LT(cur_slice_idx_, n_payload_slices_);
     DCHECK_LT(cur_offset_in_slice_, payload_slices_[cur_slice_idx_].size());
   }
 
-  return Status::OK();
+  return nbytes;
 }
 
 bool OutboundTransfer::TransferStarted() const {
@@ -23,6 +23,7 @@
 #include <set>
 #include <stdint.h>
 #include <string>
+#include <sys/uio.h>
 #include <vector>
 
 #include "kudu/rpc/constants.h"
@@ -127,8 +128,21 @@ class OutboundTransfer : public boost::intrusive::list_base_hook<> {
   // This triggers TransferCallbacks::NotifyTransferAborted.
   void Abort(const Status &status);
 
-  // send from our buffers into the sock
-  Status SendBuffer(Socket &socket);
+  // The number of slices which have not been entirely sent yet.
+  int num_unsent_slices() const {
+    return n_payload_slices_ - cur_slice_idx_;
+  }
+
+  // Fills 'iov' with the unsent part of the transfer. 'iov' must have room for
+  // num_unsent_slices() entries. Returns the number of bytes to be sent.
+  int32_t FillIovecs(struct ::iovec* iov) const;
+
+  // Accounts for the first 'nbytes' bytes of the unsent part of the transfer
+  // having been written to the socket, triggering
+  // TransferCallbacks::NotifyTransferFinished if that completes the transfer.
+  // Returns the number of the written bytes beyond the end of the transfer,
+  // which belong to later transfers.
+  int32_t Advance(int32_t nbytes);
 
   // Return true if any bytes have yet been sent.
   bool TransferStarted() const;
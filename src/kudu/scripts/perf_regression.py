@@ -0,0 +1,327 @@
+#!/usr/bin/env python
+#
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""
+Runs a fixed set of micro and macro benchmarks and compares their results
+against a baseline, to catch performance regressions between builds.
+
+  # Run the benchmarks of a release build, writing the results.
+  perf_regression.py run --build-dir build/release --output results.json
+
+  # Compare the results against those of another build.
+  perf_regression.py compare baseline.json results.json --threshold-pct 10
+
+The benchmarks are a subset of those run by benchmarks.sh, sized to run in
+a few minutes: inserts and scans through the full stack, rowset compaction,
+tablet bootstrap, RPC and a few micro-benchmarks. Each one runs
+--samples times, and its metrics are reported as the median of the samples.
+
+The results file is JSON with the following schema, which only changes
+along with SCHEMA_VERSION:
+
+  {
+    "schema_version": 1,
+    "environment": {
+      "timestamp": <seconds since the epoch>,
+      "git_hash": <commit of the source tree, or null>,
+      "build_type": <CMAKE_BUILD_TYPE of the build, or null>,
+      "hostname": ..., "kernel": ..., "cpu_model": ...,
+      "num_cpus": ..., "mem_total_kb": ...
+    },
+    "metrics": {
+      <metric name>: {
+        "unit": "s" or "ops/s",
+        "higher_is_better": <bool>,
+        "samples": [<value>, ...],
+        "median": <value>
+      }, ...
+    }
+  }
+
+'compare' exits with status 1 if any metric is worse than the baseline by
+more than the threshold. The baseline file may carry a "thresholds" object
+mapping metric names to their own threshold, in percent, for the metrics
+noisier than the others.
+"""
+
+import argparse
+import json
+import multiprocessing
+import os
+import platform
+import re
+import socket
+import subprocess
+import sys
+import time
+
+SCHEMA_VERSION = 1
+
+# The real time of a LOG_TIMING scope, e.g.
+#   "Time spent compacting with overlap: real 0.557s user 0.546s sys 0.010s"
+def timing(msg):
+  return r"Time spent %s.*: real ([0-9.]+)s" % re.escape(msg)
+
+# Each benchmark runs a test binary with the given arguments and extracts
+# its metrics from the output: (name, regex, unit, higher_is_better).
+BENCHMARKS = [
+  dict(name="full_stack_insert_scan",
+       binary="full_stack-insert-scan-test",
+       args=["--gtest_filter=FullStackInsertScanTest.WithDiskStressTest",
+             "--concurrent_inserts=10",
+             "--inserts_per_client=100000",
+             "--rows_per_batch=1000"],
+       metrics=[
+         ("insert_with_disk", timing("concurrent inserts"), "s", False),
+         ("scan_full_schema", timing("full schema scan"), "s", False),
+         ("scan_key", timing("key scan"), "s", False),
+         ("scan_string_projection", timing("String projection"), "s", False),
+         ("scan_int64_projection", timing("Int64 projection"), "s", False),
+       ]),
+  dict(name="compaction_merge",
+       binary="compaction-test",
+       args=["--gtest_filter=TestCompaction.BenchmarkMerge*"],
+       env=dict(KUDU_ALLOW_SLOW_TESTS="true"),
+       metrics=[
+         ("compaction_merge_with_overlap", timing("compacting with overlap"), "s", False),
+         ("compaction_merge_without_overlap", timing("compacting without overlap"),
+          "s", False),
+       ]),
+  dict(name="bootstrap",
+       binary="tablet_bootstrap-test",
+       args=["--gtest_filter=BootstrapTest.BenchmarkBootstrap",
+             "--bootstrap_benchmark_num_ops=50000"],
+       metrics=[
+         ("bootstrap_replay", timing("bootstrapping"), "s", False),
+       ]),
+  dict(name="rpc",
+       binary="rpc-bench",
+       args=["--gtest_filter=*BenchmarkCalls", "--run_seconds=5"],
+       env=dict(KUDU_ALLOW_SLOW_TESTS="true"),
+       metrics=[
+         ("rpc_sync_calls", r"Reqs/sec:\s+([0-9.]+)", "ops/s", True),
+       ]),
+  dict(name="memrowset",
+       binary="memrowset-test",
+       args=["--gtest_filter=*InsertCount*", "--roundtrip_num_rows=1000000"],
+       metrics=[
+         ("memrowset_insert", timing("Inserting"), "s", False),
+         ("memrowset_scan_all_committed", timing("Scanning rows where all"), "s", False),
+       ]),
+  dict(name="wire_protocol",
+       binary="wire_protocol-test",
+       args=["--gtest_filter=*Benchmark"],
+       env=dict(KUDU_ALLOW_SLOW_TESTS="true"),
+       metrics=[
+         ("wire_protocol_convert", timing("Converting"), "s", False),
+       ]),
+]
+
+
+def median(values):
+  values = sorted(values)
+  n = len(values)
+  if n % 2 == 1:
+    return values[n // 2]
+  return (values[n // 2 - 1] + values[n // 2]) / 2.0
+
+
+def run_command(argv, cwd=None):
+  """ Returns the stripped output of 'argv', or None if it fails. """
+  try:
+    with open(os.devnull, "w") as devnull:
+      return subprocess.check_output(argv, cwd=cwd, stderr=devnull).decode("utf-8").strip()
+  except (OSError, subprocess.CalledProcessError):
+    return None
+
+
+def read_proc_field(path, field):
+  """ Returns the value of 'field' in a '<field> : <value>' /proc file. """
+  try:
+    with open(path) as f:
+      for line in f:
+        key, _, value = line.partition(":")
+        if key.strip() == field:
+          return value.strip()
+  except IOError:
+    pass
+  return None
+
+
+def environment(build_dir):
+  """ Collects the metadata of the machine and build the results come from. """
+  build_type = None
+  try:
+    with open(os.path.join(build_dir, "CMakeCache.txt")) as f:
+      for line in f:
+        if line.startswith("CMAKE_BUILD_TYPE:"):
+          build_type = line.split("=", 1)[1].strip()
+  except IOError:
+    pass
+  mem_total = read_proc_field("/proc/meminfo", "MemTotal")
+  return dict(
+    timestamp=int(time.time()),
+    git_hash=run_command(["git", "rev-parse", "HEAD"],
+                         cwd=os.path.dirname(os.path.abspath(__file__))),
+    build_type=build_type,
+    hostname=socket.gethostname(),
+    kernel=platform.release(),
+    cpu_model=read_proc_field("/proc/cpuinfo", "model name"),
+    num_cpus=multiprocessing.cpu_count(),
+    mem_total_kb=int(mem_total.split()[0]) if mem_total else None)
+
+
+def run_benchmark(bench, build_dir, log_dir, sample):
+  """
+  Runs one sample of 'bench', returning the values of its metrics keyed by
+  name. The output of the run is kept in 'log_dir'.
+  """
+  argv = [os.path.join(build_dir, "bin", bench["binary"])] + bench["args"]
+  env = dict(os.environ)
+  env.update(bench.get("env", {}))
+  log_path = os.path.join(log_dir, "%s.%d.log" % (bench["name"], sample))
+  with open(log_path, "w") as log:
+    ret = subprocess.call(argv, env=env, stdout=log, stderr=subprocess.STDOUT)
+  if ret != 0:
+    raise Exception("%s failed with status %d, see %s" % (" ".join(argv), ret, log_path))
+  with open(log_path) as log:
+    output = log.read()
+  values = {}
+  for name, regex, _, _ in bench["metrics"]:
+    m = re.search(regex, output)
+    if not m:
+      raise Exception("no value for metric %s in %s" % (name, log_path))
+    values[name] = float(m.group(1))
+  return values
+
+
+def run(args):
+  if not os.path.isdir(args.log_dir):
+    os.makedirs(args.log_dir)
+  benchmarks = [b for b in BENCHMARKS
+                if not args.benchmarks or b["name"] in args.benchmarks.split(",")]
+  metrics = {}
+  for bench in benchmarks:
+    for name, _, unit, higher_is_better in bench["metrics"]:
+      metrics[name] = dict(unit=unit, higher_is_better=higher_is_better, samples=[])
+    for sample in range(args.samples):
+      print("Running %s (%d/%d)" % (bench["name"], sample + 1, args.samples))
+      sys.stdout.flush()
+      for name, value in run_benchmark(bench, args.build_dir, args.log_dir,
+                                       sample).items():
+        metrics[name]["samples"].append(value)
+  for m in metrics.values():
+    m["median"] = median(m["samples"])
+
+  results = dict(schema_version=SCHEMA_VERSION,
+                 environment=environment(args.build_dir),
+                 metrics=metrics)
+  with open(args.output, "w") as f:
+    json.dump(results, f, indent=2, sort_keys=True)
+  print("Wrote the results to %s" % args.output)
+  return 0
+
+
+def load_results(path):
+  with open(path) as f:
+    results = json.load(f)
+  if results.get("schema_version") != SCHEMA_VERSION:
+    raise Exception("%s has schema version %s, expected %d" %
+                    (path, results.get("schema_version"), SCHEMA_VERSION))
+  return results
+
+
+def compare(args):
+  baseline = load_results(args.baseline)
+  current = load_results(args.current)
+  thresholds = baseline.get("thresholds", {})
+
+  for key in ("git_hash", "build_type", "cpu_model", "num_cpus"):
+    b = baseline["environment"].get(key)
+    c = current["environment"].get(key)
+    print("%-12s %-42s %s" % (key, b, c))
+    if key != "git_hash" and b != c:
+      print("WARNING: the %s differs, the results may not be comparable" % key)
+  print("")
+
+  regressions = []
+  print("%-36s %14s %14s %9s" % ("metric", "baseline", "current", "change"))
+  for name in sorted(current["metrics"]):
+    cur = current["metrics"][name]
+    if name not in baseline["metrics"]:
+      print("%-36s %14s %14.3f %9s" % (name, "-", cur["median"], "new"))
+      continue
+    base = baseline["metrics"][name]
+    if base["median"] == 0:
+      continue
+    change_pct = 100.0 * (cur["median"] - base["median"]) / base["median"]
+    # A positive 'worse_pct' is a regression, whatever the unit of the metric.
+    worse_pct = -change_pct if cur["higher_is_better"] else change_pct
+    threshold = thresholds.get(name, args.threshold_pct)
+    flag = ""
+    if worse_pct > threshold:
+      regressions.append(name)
+      flag = "  REGRESSION (threshold %g%%)" % threshold
+    print("%-36s %14.3f %14.3f %+8.1f%%%s" %
+          (name, base["median"], cur["median"], change_pct, flag))
+
+  if regressions:
+    print("\n%d metric(s) regressed: %s" % (len(regressions), ", ".join(regressions)))
+    return 1
+  print("\nNo regression")
+  return 0
+
+
+def main():
+  parser = argparse.ArgumentParser(
+      description="Run benchmarks and compare them against a baseline.")
+  subparsers = parser.add_subparsers(dest="command")
+
+  run_parser = subparsers.add_parser("run", help="run the benchmarks")
+  run_parser.add_argument("--build-dir", default="build/latest",
+                          help="the build directory whose binaries to run")
+  run_parser.add_argument("--output", default="perf-results.json",
+                          help="the file to write the results to")
+  run_parser.add_argument("--log-dir", default="perf-logs",
+                          help="the directory to keep the benchmark output in")
+  run_parser.add_argument("--samples", type=int, default=3,
+                          help="the number of times to run each benchmark")
+  run_parser.add_argument("--benchmarks", default="",
+                          help="comma-separated list of the benchmarks to run, "
+                          "all of them by default: %s" %
+                          ", ".join(b["name"] for b in BENCHMARKS))
+
+  compare_parser = subparsers.add_parser(
+      "compare", help="compare results against a baseline")
+  compare_parser.add_argument("baseline", help="the results to compare against")
+  compare_parser.add_argument("current", help="the results to compare")
+  compare_parser.add_argument("--threshold-pct", type=float, default=10.0,
+                              help="how much worse than the baseline, in percent, "
+                              "a metric may be before it counts as a regression")
+
+  args = parser.parse_args()
+  if args.command == "run":
+    return run(args)
+  if args.command == "compare":
+    return compare(args)
+  parser.print_help()
+  return 2
+
+
+if __name__ == "__main__":
+  sys.exit(main())
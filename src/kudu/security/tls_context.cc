@@ -74,6 +74,16 @@ DEFINE_string(rpc_tls_min_protocol, "TLSv1",
               "'TLSv1.2'.");
 TAG_FLAG(rpc_tls_min_protocol, advanced);
 
+DEFINE_bool(rpc_tls_kernel_offload, false,
+            "Whether to hand the encryption of outbound data on TLS-secured RPC "
+            "connections over to the kernel (kTLS) once the TLS handshake completes. "
+            "The kernel, or a NIC supporting TLS offload, then encrypts the data, "
+            "and RPC sidecars are sent with scatter-gather writes. Only takes effect "
+            "on connections using TLSv1.3, with an OpenSSL build and a kernel "
+            "supporting kTLS.");
+TAG_FLAG(rpc_tls_kernel_offload, advanced);
+TAG_FLAG(rpc_tls_kernel_offload, experimental);
+
 namespace kudu {
 namespace security {
 
@@ -136,6 +146,12 @@ Status TlsContext::Init() {
                                    FLAGS_rpc_tls_min_protocol);
   }
 
+#if defined(SSL_OP_ENABLE_KTLS)
+  if (FLAGS_rpc_tls_kernel_offload) {
+    options |= SSL_OP_ENABLE_KTLS;
+  }
+#endif
+
   SSL_CTX_set_options(ctx_.get(), options);
 
   OPENSSL_RET_NOT_OK(
@@ -202,7 +202,9 @@ Status TlsHandshake::Finish(unique_ptr<Socket>* socket) {
   }
 
   // Transfer the SSL instance to the socket.
-  socket->reset(new TlsSocket(fd, std::move(ssl_)));
+  unique_ptr<TlsSocket> tls_socket(new TlsSocket(fd, std::move(ssl_)));
+  RETURN_NOT_OK(tls_socket->MaybeEnableKernelTls());
+  *socket = std::move(tls_socket);
 
   return Status::OK();
 }
@@ -31,7 +31,8 @@ namespace security {
 
 TlsSocket::TlsSocket(int fd, c_unique_ptr<SSL> ssl)
     : Socket(fd),
-      ssl_(std::move(ssl)) {
+      ssl_(std::move(ssl)),
+      kernel_tls_send_(false) {
 }
 
 TlsSocket::~TlsSocket() {
@@ -49,6 +50,10 @@ Status TlsSocket::Write(const uint8_t *buf, int32_t amt, int32_t *nwritten) {
     return Status::OK();
   }
 
+  if (kernel_tls_send_) {
+    return Socket::Write(buf, amt, nwritten);
+  }
+
   ERR_clear_error();
   errno = 0;
   int32_t bytes_written = SSL_write(ssl_.get(), buf, amt);
@@ -68,6 +73,11 @@ Status TlsSocket::Write(const uint8_t *buf, int32_t amt, int32_t *nwritten) {
 
 Status TlsSocket::Writev(const struct ::iovec *iov, int iov_len, int32_t *nwritten) {
   CHECK(ssl_);
+  if (kernel_tls_send_) {
+    // The kernel frames and encrypts the data, so it can be gathered from all
+    // the buffers in one call.
+    return Socket::Writev(iov, iov_len, nwritten);
+  }
   ERR_clear_error();
   int32_t total_written = 0;
   // Allows packets to be aggresively be accumulated before sending.
@@ -126,6 +136,26 @@ Status TlsSocket::Recv(uint8_t *buf, int32_t amt, int32_t *nread) {
   return Status::OK();
 }
 
+Status TlsSocket::MaybeEnableKernelTls() {
+#if defined(SSL_OP_ENABLE_KTLS) && defined(TLS1_3_VERSION)
+  if (!(SSL_get_options(ssl_.get()) & SSL_OP_ENABLE_KTLS) ||
+      SSL_version(ssl_.get()) != TLS1_3_VERSION) {
+    return Status::OK();
+  }
+  // The handshake ran over memory BIOs, so OpenSSL could not pass the session
+  // keys to the kernel then. Now that the SSL handle writes to the socket,
+  // updating the sending keys makes OpenSSL install the new ones in the kernel.
+  // The peer follows the key update as part of the regular TLSv1.3 protocol.
+  ERR_clear_error();
+  if (SSL_key_update(ssl_.get(), SSL_KEY_UPDATE_NOT_REQUESTED) != 1 ||
+      SSL_do_handshake(ssl_.get()) != 1) {
+    return Status::NetworkError("failed to update TLS keys", GetOpenSSLErrors());
+  }
+  kernel_tls_send_ = BIO_get_ktls_send(SSL_get_wbio(ssl_.get())) != 0;
+#endif
+  return Status::OK();
+}
+
 Status TlsSocket::Close() {
   ERR_clear_error();
   errno = 0;
@@ -48,8 +48,17 @@ class TlsSocket : public Socket {
 
   TlsSocket(int fd, c_unique_ptr<SSL> ssl);
 
+  // Hands the encryption of outbound data over to the kernel, if enabled with
+  // --rpc_tls_kernel_offload and supported. Must be called once the handshake
+  // has completed, with the socket in blocking mode.
+  Status MaybeEnableKernelTls() WARN_UNUSED_RESULT;
+
   // Owned SSL handle.
   c_unique_ptr<SSL> ssl_;
+
+  // Whether the kernel encrypts outbound data. Data is then written to the
+  // socket directly rather than through OpenSSL.
+  bool kernel_tls_send_;
 };
 
 } // namespace security
@@ -186,6 +186,22 @@ static void WriteMetricsAsJson(const MetricRegistry* const metrics,
     string arg = FindWithDefault(req.parsed_args, "include_schema", "false");
     opts.include_schema_info = ParseLeadingBoolValue(arg.c_str(), false);
   }
+  {
+    const string* arg = FindOrNull(req.parsed_args, "types");
+    if (arg != nullptr) {
+      SplitStringUsing(*arg, ",", &opts.entity_types);
+    }
+  }
+  {
+    const string* arg = FindOrNull(req.parsed_args, "merge");
+    if (arg != nullptr) {
+      SplitStringUsing(*arg, ",", &opts.merged_entity_types);
+    }
+  }
+  {
+    string arg = FindWithDefault(req.parsed_args, "epoch", "0");
+    opts.only_modified_in_or_after_epoch = ParseLeadingInt64Value(arg.c_str(), 0);
+  }
   JsonWriter::Mode json_mode;
   {
     string arg = FindWithDefault(req.parsed_args, "compact", "false");
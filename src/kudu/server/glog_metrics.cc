@@ -18,7 +18,9 @@
 
 #include <glog/logging.h>
 
+#include "kudu/gutil/bind.h"
 #include "kudu/gutil/once.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/metrics.h"
 
 METRIC_DEFINE_counter(server, glog_info_messages,
@@ -33,6 +35,18 @@ METRIC_DEFINE_counter(server, glog_error_messages,
                       "ERROR-level Log Messages", kudu::MetricUnit::kMessages,
                       "Number of ERROR-level log messages emitted by the application.");
 
+METRIC_DEFINE_gauge_int64(server, glog_async_blocked_time_us,
+                          "Time Blocked on Async Logging", kudu::MetricUnit::kMicroseconds,
+                          "Total time threads were blocked logging because the async "
+                          "log buffers were full.",
+                          kudu::EXPOSE_AS_COUNTER);
+
+METRIC_DEFINE_gauge_int64(server, glog_async_dropped_messages,
+                          "Dropped Log Messages", kudu::MetricUnit::kMessages,
+                          "Number of log messages dropped because the async log "
+                          "buffers were full.",
+                          kudu::EXPOSE_AS_COUNTER);
+
 namespace kudu {
 
 class MetricsSink : public google::LogSink {
@@ -75,6 +89,13 @@ class MetricsSink : public google::LogSink {
 ScopedGLogMetrics::ScopedGLogMetrics(const scoped_refptr<MetricEntity>& entity)
   : sink_(new MetricsSink(entity)) {
   google::AddLogSink(sink_.get());
+  // The async loggers are never destroyed, so these gauges needn't be detached.
+  entity->NeverRetire(
+      METRIC_glog_async_blocked_time_us.InstantiateFunctionGauge(
+          entity, Bind(&GetAsyncLoggingBlockedMicros)));
+  entity->NeverRetire(
+      METRIC_glog_async_dropped_messages.InstantiateFunctionGauge(
+          entity, Bind(&GetAsyncLoggingDroppedMessages)));
 }
 
 ScopedGLogMetrics::~ScopedGLogMetrics() {
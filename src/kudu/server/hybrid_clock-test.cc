@@ -18,6 +18,9 @@
 #include <algorithm>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/util/monotime.h"
@@ -26,6 +29,11 @@
 #include "kudu/util/test_util.h"
 
 DECLARE_bool(use_mock_wall_clock);
+DECLARE_int32(hybrid_clock_max_error_refresh_interval_ms);
+
+using std::thread;
+using std::unordered_set;
+using std::vector;
 
 namespace kudu {
 namespace server {
@@ -279,6 +287,50 @@ TEST_F(HybridClockTest, TestClockDoesntGoBackwardsWithUpdates) {
   }
 }
 
+// Test that threads reading the clock concurrently are never handed the same
+// timestamp, now that the clock is read without a lock.
+TEST_F(HybridClockTest, TestConcurrentNowIsUnique) {
+  const int kNumThreads = 4;
+  const int kReadsPerThread = 10000;
+  vector<vector<uint64_t>> values(kNumThreads);
+  vector<thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&, i]() {
+      for (int j = 0; j < kReadsPerThread; j++) {
+        values[i].push_back(clock_->Now().value());
+      }
+    });
+  }
+  for (thread& t : threads) {
+    t.join();
+  }
+
+  unordered_set<uint64_t> all;
+  for (const vector<uint64_t>& thread_values : values) {
+    for (int j = 1; j < thread_values.size(); j++) {
+      ASSERT_LT(thread_values[j - 1], thread_values[j]);
+    }
+    all.insert(thread_values.begin(), thread_values.end());
+  }
+  ASSERT_EQ(kNumThreads * kReadsPerThread, all.size());
+}
+
+// Test that, between two reads of the max error from the kernel, the error
+// grows with the time elapsed rather than staying at the last value read.
+TEST_F(HybridClockTest, TestMaxErrorIsExtrapolatedBetweenRefreshes) {
+  FLAGS_hybrid_clock_max_error_refresh_interval_ms = 3600 * 1000;
+  scoped_refptr<HybridClock> clock(new HybridClock);
+  ASSERT_OK(clock->Init());
+
+  Timestamp now1, now2;
+  uint64_t error_usec1, error_usec2;
+  clock->NowWithError(&now1, &error_usec1);
+  SleepFor(MonoDelta::FromMilliseconds(100));
+  clock->NowWithError(&now2, &error_usec2);
+  ASSERT_GT(now2.value(), now1.value());
+  ASSERT_GE(error_usec2, error_usec1);
+}
+
 TEST_F(HybridClockTest, TestGetPhysicalComponentDifference) {
   Timestamp now1 = HybridClock::TimestampFromMicrosecondsAndLogicalValue(100, 100);
   SleepFor(MonoDelta::FromMilliseconds(1));
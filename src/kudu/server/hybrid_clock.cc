@@ -18,6 +18,7 @@
 #include "kudu/server/hybrid_clock.h"
 
 #include <algorithm>
+#include <cmath>
 #include <glog/logging.h>
 #include <mutex>
 
@@ -42,6 +43,13 @@ DEFINE_int32(max_clock_sync_error_usec, 10 * 1000 * 1000, // 10 secs
 TAG_FLAG(max_clock_sync_error_usec, advanced);
 TAG_FLAG(max_clock_sync_error_usec, runtime);
 
+DEFINE_int32(hybrid_clock_max_error_refresh_interval_ms, 1000,
+             "How often the maximum error of the clock is read from the kernel, "
+             "which takes a system call. In between, the last error read is "
+             "extrapolated by the clock tolerance.");
+TAG_FLAG(hybrid_clock_max_error_refresh_interval_ms, advanced);
+TAG_FLAG(hybrid_clock_max_error_refresh_interval_ms, runtime);
+
 DEFINE_bool(use_hybrid_clock, true,
             "Whether HybridClock should be used as the default clock"
             " implementation. This should be disabled for testing purposes only.");
@@ -139,6 +147,8 @@ HybridClock::HybridClock()
       divisor_(1),
 #endif
       tolerance_adjustment_(1),
+      max_error_usec_(0),
+      max_error_refresh_usec_(0),
       next_timestamp_(0),
       state_(kNotInitialized) {
 }
@@ -153,11 +163,6 @@ Status HybridClock::Init() {
   LOG(WARNING) << "HybridClock initialized in local mode (OS X only). "
                << "Not suitable for distributed clusters.";
 #else
-  // Read the current time. This will return an error if the clock is not synchronized.
-  uint64_t now_usec;
-  uint64_t error_usec;
-  RETURN_NOT_OK(WalltimeWithError(&now_usec, &error_usec));
-
   timex timex;
   RETURN_NOT_OK(GetClockModes(&timex));
   // read whether the STA_NANO bit is set to know whether we'll get back nanos
@@ -174,6 +179,15 @@ Status HybridClock::Init() {
   // Tolerance comes in parts per million but needs to be applied a scaling factor.
   tolerance_adjustment_ = (1 + ((timex.tolerance / kAdjtimexScalingFactor) / 1000000.0));
 
+  // Read the current time. This will return an error if the clock is not synchronized.
+  {
+    std::lock_guard<simple_spinlock> lock(lock_);
+    RETURN_NOT_OK(RefreshMaxErrorUnlocked());
+  }
+  uint64_t now_usec;
+  uint64_t error_usec;
+  RETURN_NOT_OK(WalltimeWithError(&now_usec, &error_usec));
+
   LOG(INFO) << "HybridClock initialized. Resolution in nanos?: " << (divisor_ == 1000)
             << " Wait times tolerance adjustment: " << tolerance_adjustment_
             << " Current error: " << error_usec;
@@ -187,8 +201,6 @@ Status HybridClock::Init() {
 Timestamp HybridClock::Now() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return now;
 }
@@ -196,11 +208,7 @@ Timestamp HybridClock::Now() {
 Timestamp HybridClock::NowLatest() {
   Timestamp now;
   uint64_t error;
-
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   uint64_t now_latest = GetPhysicalValueMicros(now) + error;
   uint64_t now_logical = GetLogicalValue(now);
@@ -231,9 +239,15 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
   // If the physical time from the system clock is higher than our last-returned
   // time, we should use the physical timestamp.
   uint64_t candidate_phys_timestamp = now_usec << kBitsToShift;
-  if (PREDICT_TRUE(candidate_phys_timestamp > next_timestamp_)) {
-    next_timestamp_ = candidate_phys_timestamp;
-    *timestamp = Timestamp(next_timestamp_++);
+  uint64_t next = next_timestamp_.load(std::memory_order_acquire);
+  uint64_t issued;
+  do {
+    issued = std::max(candidate_phys_timestamp, next);
+  } while (!next_timestamp_.compare_exchange_weak(next, issued + 1,
+                                                  std::memory_order_acq_rel));
+  *timestamp = Timestamp(issued);
+
+  if (PREDICT_TRUE(issued == candidate_phys_timestamp)) {
     *max_error_usec = error_usec;
     if (PREDICT_FALSE(VLOG_IS_ON(2))) {
       VLOG(2) << "Current clock is higher than the last one. Resetting logical values."
@@ -261,8 +275,7 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
   // This broadens the error interval for both cases but always returns
   // a correct error interval.
 
-  *max_error_usec = (next_timestamp_ >> kBitsToShift) - (now_usec - error_usec);
-  *timestamp = Timestamp(next_timestamp_++);
+  *max_error_usec = (issued >> kBitsToShift) - (now_usec - error_usec);
   if (PREDICT_FALSE(VLOG_IS_ON(2))) {
     VLOG(2) << "Current clock is lower than the last one. Returning last read and incrementing"
         " logical values. Clock: " + Stringify(*timestamp) << " Error: " << *max_error_usec;
@@ -270,7 +283,6 @@ void HybridClock::NowWithError(Timestamp* timestamp, uint64_t* max_error_usec) {
 }
 
 Status HybridClock::Update(const Timestamp& to_update) {
-  std::lock_guard<simple_spinlock> lock(lock_);
   Timestamp now;
   uint64_t error_ignored;
   NowWithError(&now, &error_ignored);
@@ -292,8 +304,12 @@ Status HybridClock::Update(const Timestamp& to_update) {
   }
 
   // Our next timestamp must be higher than the one that we are updating
-  // from.
-  next_timestamp_ = to_update.value() + 1;
+  // from. Another thread may have moved it further in the meantime.
+  uint64_t next = next_timestamp_.load(std::memory_order_acquire);
+  while (next <= to_update.value() &&
+         !next_timestamp_.compare_exchange_weak(next, to_update.value() + 1,
+                                                std::memory_order_acq_rel)) {
+  }
   return Status::OK();
 }
 
@@ -314,10 +330,7 @@ Status HybridClock::WaitUntilAfter(const Timestamp& then,
   TRACE_EVENT0("clock", "HybridClock::WaitUntilAfter");
   Timestamp now;
   uint64_t error;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    NowWithError(&now, &error);
-  }
+  NowWithError(&now, &error);
 
   // "unshift" the timestamps so that we can measure actual time
   uint64_t now_usec = GetPhysicalValueMicros(now);
@@ -358,10 +371,7 @@ Status HybridClock::WaitUntilAfterLocally(const Timestamp& then,
   while (true) {
     Timestamp now;
     uint64_t error;
-    {
-      std::lock_guard<simple_spinlock> lock(lock_);
-      NowWithError(&now, &error);
-    }
+    NowWithError(&now, &error);
     if (now > then) {
       return Status::OK();
     }
@@ -379,16 +389,14 @@ bool HybridClock::IsAfter(Timestamp t) {
   uint64_t error_usec;
   CHECK_OK(WalltimeWithError(&now_usec, &error_usec));
 
-  Timestamp now;
-  {
-    std::lock_guard<simple_spinlock> lock(lock_);
-    now = Timestamp(std::max(next_timestamp_, now_usec << kBitsToShift));
-  }
+  Timestamp now(std::max(next_timestamp_.load(std::memory_order_acquire),
+                         now_usec << kBitsToShift));
   return t.value() < now.value();
 }
 
 kudu::Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec) {
   if (PREDICT_FALSE(FLAGS_use_mock_wall_clock)) {
+    std::lock_guard<simple_spinlock> lock(lock_);
     VLOG(1) << "Current clock time: " << mock_clock_time_usec_ << " error: "
             << mock_clock_max_error_usec_ << ". Updating to time: " << now_usec
             << " and error: " << error_usec;
@@ -400,11 +408,10 @@ kudu::Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_
     *error_usec = 0;
   }
 #else
-    // Read the time. This will return an error if the clock is not synchronized.
-    ntptimeval timeval;
-    RETURN_NOT_OK(GetClockTime(&timeval));
-    *now_usec = timeval.time.tv_sec * kNanosPerSec + timeval.time.tv_usec / divisor_;
-    *error_usec = timeval.maxerror;
+    // clock_gettime() is served by the vDSO, unlike ntp_gettime() which is a
+    // system call: the latter is only made to refresh the max error.
+    *now_usec = GetCurrentTimeMicros();
+    RETURN_NOT_OK(GetMaxErrorUsec(*now_usec, error_usec));
   }
 
   // If the clock is synchronized but has max_error beyond max_clock_sync_error_usec
@@ -417,6 +424,45 @@ kudu::Status HybridClock::WalltimeWithError(uint64_t* now_usec, uint64_t* error_
   return kudu::Status::OK();
 }
 
+#if !defined(__APPLE__)
+Status HybridClock::GetMaxErrorUsec(uint64_t now_usec, uint64_t* error_usec) {
+  uint64_t refresh_usec = max_error_refresh_usec_.load(std::memory_order_acquire);
+  uint64_t refresh_interval_usec =
+      static_cast<uint64_t>(FLAGS_hybrid_clock_max_error_refresh_interval_ms) * 1000;
+  if (PREDICT_FALSE(now_usec < refresh_usec ||
+                    now_usec - refresh_usec >= refresh_interval_usec)) {
+    // Only one thread refreshes the error, the others keep extrapolating the
+    // previous one meanwhile.
+    std::unique_lock<simple_spinlock> lock(lock_, std::try_to_lock);
+    if (lock.owns_lock()) {
+      RETURN_NOT_OK(RefreshMaxErrorUnlocked());
+      refresh_usec = max_error_refresh_usec_.load(std::memory_order_acquire);
+    }
+  }
+  uint64_t error = max_error_usec_.load(std::memory_order_relaxed);
+
+  // The kernel grows the max error by the clock tolerance every second, until
+  // NTP resets it.
+  if (now_usec > refresh_usec) {
+    error += static_cast<uint64_t>(
+        std::ceil((now_usec - refresh_usec) * (tolerance_adjustment_ - 1)));
+  }
+  *error_usec = error;
+  return Status::OK();
+}
+
+Status HybridClock::RefreshMaxErrorUnlocked() {
+  DCHECK(lock_.is_locked());
+  ntptimeval timeval;
+  RETURN_NOT_OK(GetClockTime(&timeval));
+  max_error_usec_.store(timeval.maxerror, std::memory_order_relaxed);
+  max_error_refresh_usec_.store(
+      timeval.time.tv_sec * kNanosPerSec + timeval.time.tv_usec / divisor_,
+      std::memory_order_release);
+  return Status::OK();
+}
+#endif // !defined(__APPLE__)
+
 void HybridClock::SetMockClockWallTimeForTests(uint64_t now_usec) {
   CHECK(FLAGS_use_mock_wall_clock);
   std::lock_guard<simple_spinlock> lock(lock_);
@@ -439,8 +485,6 @@ uint64_t HybridClock::NowForMetrics() {
 uint64_t HybridClock::ErrorForMetrics() {
   Timestamp now;
   uint64_t error;
-
-  std::lock_guard<simple_spinlock> lock(lock_);
   NowWithError(&now, &error);
   return error;
 }
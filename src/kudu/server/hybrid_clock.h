@@ -18,6 +18,7 @@
 #ifndef KUDU_SERVER_HYBRID_CLOCK_H_
 #define KUDU_SERVER_HYBRID_CLOCK_H_
 
+#include <atomic>
 #include <string>
 
 #include "kudu/gutil/ref_counted.h"
@@ -119,6 +120,9 @@ class HybridClock : public Clock {
   // error in micros. This may fail if the clock is unsynchronized or synchronized
   // but the error is too high and, since we can't do anything about it,
   // LOG(FATAL)'s in that case.
+  //
+  // This doesn't take any lock, and only makes a system call to refresh the
+  // max error once per --hybrid_clock_max_error_refresh_interval_ms.
   void NowWithError(Timestamp* timestamp, uint64_t* max_error_usec);
 
   virtual std::string Stringify(Timestamp timestamp) OVERRIDE;
@@ -170,6 +174,18 @@ class HybridClock : public Clock {
   // On OS X, the error will always be 0.
   kudu::Status WalltimeWithError(uint64_t* now_usec, uint64_t* error_usec);
 
+#if !defined(__APPLE__)
+  // Obtains the maximum error of the clock at the wallclock time 'now_usec'.
+  // The error read from the kernel at the last refresh grows by the clock
+  // tolerance since then; the kernel is read again once the last refresh is
+  // older than --hybrid_clock_max_error_refresh_interval_ms.
+  kudu::Status GetMaxErrorUsec(uint64_t now_usec, uint64_t* error_usec);
+
+  // Reads the maximum error of the clock from the kernel, and checks if the
+  // clock is synchronized. Requires 'lock_' to be held.
+  kudu::Status RefreshMaxErrorUnlocked();
+#endif
+
   // Used to get the timestamp for metrics.
   uint64_t NowForMetrics();
 
@@ -190,11 +206,20 @@ class HybridClock : public Clock {
 
   double tolerance_adjustment_;
 
+  // Protects the mock clock values, and serializes the refreshes of the
+  // max error.
   mutable simple_spinlock lock_;
 
+  // The max error read from the kernel at the last refresh, and the wallclock
+  // time of the refresh. The error is stored before the time, so that a
+  // reader which loads the time first sees an error at least as recent.
+  std::atomic<uint64_t> max_error_usec_;
+  std::atomic<uint64_t> max_error_refresh_usec_;
+
   // The next timestamp to be generated from this clock, assuming that
   // the physical clock hasn't advanced beyond the value stored here.
-  uint64_t next_timestamp_;
+  // Only ever increases, by compare-and-swap.
+  std::atomic<uint64_t> next_timestamp_;
 
   // How many bits to left shift a microseconds clock read. The remainder
   // of the timestamp will be reserved for logical values.
@@ -35,6 +35,7 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/sysinfo.h"
 #include "kudu/server/webserver.h"
+#include "kudu/util/cpu_profiling.h"
 #include "kudu/util/env.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/monotime.h"
@@ -108,6 +109,12 @@ static void PprofCpuProfileHandler(const Webserver::WebRequest& req, ostringstre
 #ifndef TCMALLOC_ENABLED
   (*output) << "CPU profiling is not available without tcmalloc.";
 #else
+  // Both profilers use SIGPROF.
+  if (IsContinuousCpuProfilingRunning()) {
+    (*output) << "CPU profiling is running continuously. See /pprof/folded.";
+    return;
+  }
+
   auto it = req.parsed_args.find("seconds");
   int seconds = PPROF_DEFAULT_SAMPLE_SECS;
   if (it != req.parsed_args.end()) {
@@ -128,6 +135,20 @@ static void PprofCpuProfileHandler(const Webserver::WebRequest& req, ostringstre
 #endif
 }
 
+// Serves the samples of the continuous CPU profiler from the last
+// /pprof/folded?seconds=XX as folded stacks, which flame graph tools take
+// as input. See --continuous_cpu_profiling_frequency_hz.
+static void PprofFoldedHandler(const Webserver::WebRequest& req, ostringstream* output) {
+  if (!IsContinuousCpuProfilingRunning()) {
+    (*output) << "Continuous CPU profiling is not running. "
+              << "See --continuous_cpu_profiling_frequency_hz.";
+    return;
+  }
+  string secs_str = FindWithDefault(req.parsed_args, "seconds", "");
+  int32_t seconds = ParseLeadingInt32Value(secs_str.c_str(), PPROF_DEFAULT_SAMPLE_SECS);
+  DumpContinuousCpuProfile(MonoDelta::FromSeconds(seconds), output);
+}
+
 // pprof asks for the url /pprof/growth to get heap-profiling delta (growth) information.
 // The server should respond by calling:
 // MallocExtension::instance()->GetHeapGrowthStacks(&output);
@@ -235,6 +256,7 @@ void AddPprofPathHandlers(Webserver* webserver) {
   webserver->RegisterPathHandler("/pprof/profile", "", PprofCpuProfileHandler, false, false);
   webserver->RegisterPathHandler("/pprof/symbol", "", PprofSymbolHandler, false, false);
   webserver->RegisterPathHandler("/pprof/contention", "", PprofContentionHandler, false, false);
+  webserver->RegisterPathHandler("/pprof/folded", "", PprofFoldedHandler, false, false);
 }
 
 } // namespace kudu
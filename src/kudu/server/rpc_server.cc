@@ -55,6 +55,20 @@ DEFINE_int32(rpc_num_service_threads, 10,
              "Number of RPC worker threads to run");
 TAG_FLAG(rpc_num_service_threads, advanced);
 
+DEFINE_int32(rpc_num_high_priority_service_threads, 2,
+             "Number of RPC worker threads reserved for the high priority methods "
+             "of a service, such as Raft heartbeats and vote requests. If 0, those "
+             "methods share the regular worker threads.");
+TAG_FLAG(rpc_num_high_priority_service_threads, advanced);
+TAG_FLAG(rpc_num_high_priority_service_threads, experimental);
+
+DEFINE_int32(rpc_num_low_priority_service_threads, 0,
+             "Number of RPC worker threads reserved for the low priority methods "
+             "of a service, such as scans. If 0, those methods share the regular "
+             "worker threads.");
+TAG_FLAG(rpc_num_low_priority_service_threads, advanced);
+TAG_FLAG(rpc_num_low_priority_service_threads, experimental);
+
 DEFINE_int32(rpc_service_queue_length, 50,
              "Default length of queue for incoming RPC requests");
 TAG_FLAG(rpc_service_queue_length, advanced);
@@ -70,6 +84,8 @@ RpcServerOptions::RpcServerOptions()
   : rpc_bind_addresses(FLAGS_rpc_bind_addresses),
     num_acceptors_per_address(FLAGS_rpc_num_acceptors_per_address),
     num_service_threads(FLAGS_rpc_num_service_threads),
+    num_high_priority_service_threads(FLAGS_rpc_num_high_priority_service_threads),
+    num_low_priority_service_threads(FLAGS_rpc_num_low_priority_service_threads),
     default_port(0),
     service_queue_length(FLAGS_rpc_service_queue_length) {
 }
@@ -119,6 +135,8 @@ Status RpcServer::RegisterService(gscoped_ptr<rpc::ServiceIf> service) {
   string service_name = service->service_name();
   scoped_refptr<rpc::ServicePool> service_pool =
     new rpc::ServicePool(std::move(service), metric_entity, options_.service_queue_length);
+  service_pool->ReserveThreads(rpc::HIGH_PRIORITY, options_.num_high_priority_service_threads);
+  service_pool->ReserveThreads(rpc::LOW_PRIORITY, options_.num_low_priority_service_threads);
   RETURN_NOT_OK(service_pool->Init(options_.num_service_threads));
   RETURN_NOT_OK(messenger_->RegisterService(service_name, service_pool));
   return Status::OK();
@@ -41,6 +41,8 @@ struct RpcServerOptions {
   std::string rpc_bind_addresses;
   uint32_t num_acceptors_per_address;
   uint32_t num_service_threads;
+  uint32_t num_high_priority_service_threads;
+  uint32_t num_low_priority_service_threads;
   uint16_t default_port;
   size_t service_queue_length;
 };
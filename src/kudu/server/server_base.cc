@@ -45,6 +45,7 @@
 #include "kudu/server/tracing-path-handlers.h"
 #include "kudu/server/webserver.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/cpu_profiling.h"
 #include "kudu/util/env.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/jsonwriter.h"
@@ -63,6 +64,12 @@
 
 DEFINE_int32(num_reactor_threads, 4, "Number of libev reactor threads to start.");
 TAG_FLAG(num_reactor_threads, advanced);
+DEFINE_bool(rpc_reactor_per_core, false,
+            "Whether to start one libev reactor thread per CPU, pinned to that CPU, "
+            "instead of --num_reactor_threads. Each reactor then accepts its own "
+            "inbound connections on a separate SO_REUSEPORT socket.");
+TAG_FLAG(rpc_reactor_per_core, advanced);
+TAG_FLAG(rpc_reactor_per_core, experimental);
 
 DEFINE_int32(min_negotiation_threads, 0, "Minimum number of connection negotiation threads.");
 TAG_FLAG(min_negotiation_threads, advanced);
@@ -70,6 +77,20 @@ TAG_FLAG(min_negotiation_threads, advanced);
 DEFINE_int32(max_negotiation_threads, 50, "Maximum number of connection negotiation threads.");
 TAG_FLAG(max_negotiation_threads, advanced);
 
+DEFINE_int32(continuous_cpu_profiling_frequency_hz, 0,
+             "If greater than 0, the server continuously samples the stacks of its "
+             "threads this many times per second of consumed CPU time, and serves the "
+             "recent samples as folded stacks at /pprof/folded. While enabled, the "
+             "on-demand CPU profile at /pprof/profile is unavailable.");
+TAG_FLAG(continuous_cpu_profiling_frequency_hz, advanced);
+TAG_FLAG(continuous_cpu_profiling_frequency_hz, experimental);
+
+DEFINE_int32(continuous_cpu_profiling_max_samples, 60000,
+             "The number of most recent samples kept by the continuous CPU profiler. "
+             "See --continuous_cpu_profiling_frequency_hz.");
+TAG_FLAG(continuous_cpu_profiling_max_samples, advanced);
+TAG_FLAG(continuous_cpu_profiling_max_samples, experimental);
+
 DECLARE_bool(use_hybrid_clock);
 
 using std::ostringstream;
@@ -114,6 +135,7 @@ ServerBase::ServerBase(string name, const ServerBaseOptions& options,
       stop_background_threads_latch_(1) {
   FsManagerOpts fs_opts;
   fs_opts.metric_entity = metric_entity_;
+  fs_opts.metric_registry = metric_registry_.get();
   fs_opts.parent_mem_tracker = mem_tracker_;
   fs_opts.wal_path = options.fs_opts.wal_path;
   fs_opts.data_paths = options.fs_opts.data_paths;
@@ -169,6 +191,16 @@ Status ServerBase::Init() {
 
   InitSpinLockContentionProfiling();
 
+  if (FLAGS_continuous_cpu_profiling_frequency_hz > 0) {
+    Status s = StartContinuousCpuProfiling(FLAGS_continuous_cpu_profiling_frequency_hz,
+                                           FLAGS_continuous_cpu_profiling_max_samples);
+    // The profiler is process-wide, so it may have been started by another
+    // server in this process.
+    if (!s.IsIllegalState()) {
+      RETURN_NOT_OK_PREPEND(s, "Cannot start continuous CPU profiling");
+    }
+  }
+
   // Initialize the clock immediately. This checks that the clock is synchronized
   // so we're less likely to get into a partially initialized state on disk during startup
   // if we're having clock problems.
@@ -191,6 +223,7 @@ Status ServerBase::Init() {
   rpc::MessengerBuilder builder(name_);
 
   builder.set_num_reactors(FLAGS_num_reactor_threads)
+         .set_reactor_per_core(FLAGS_rpc_reactor_per_core)
          .set_min_negotiation_threads(FLAGS_min_negotiation_threads)
          .set_max_negotiation_threads(FLAGS_max_negotiation_threads)
          .set_metric_entity(metric_entity())
@@ -283,6 +316,10 @@ void ServerBase::MetricsLoggingThread() {
 
 
   MonoTime next_log = MonoTime::Now();
+  // The epoch started by the last successful dump: after the first dump, which
+  // logs all the metrics, only the metrics modified since the last dump are
+  // logged.
+  int64_t prev_log_epoch = 0;
   while (!stop_background_threads_latch_.WaitUntil(next_log)) {
     next_log = MonoTime::Now() +
         MonoDelta::FromMilliseconds(options_.metrics_log_interval_ms);
@@ -295,6 +332,8 @@ void ServerBase::MetricsLoggingThread() {
     metrics.push_back("*");
     MetricJsonOptions opts;
     opts.include_raw_histograms = true;
+    opts.only_modified_in_or_after_epoch = prev_log_epoch;
+    int64_t this_log_epoch = Metric::IncrementEpoch();
 
     JsonWriter writer(&buf, JsonWriter::COMPACT);
     Status s = metric_registry_->WriteAsJson(&writer, metrics, opts);
@@ -312,6 +351,7 @@ void ServerBase::MetricsLoggingThread() {
       next_log += kWaitBetweenFailures;
       continue;
     }
+    prev_log_epoch = this_log_epoch;
   }
 
   WARN_NOT_OK(log.Close(), "Unable to close metric log");
@@ -35,6 +35,7 @@
 using std::string;
 
 DECLARE_int32(webserver_max_post_length_bytes);
+DECLARE_int32(webserver_streaming_chunk_bytes);
 
 DEFINE_bool(test_sensitive_flag, false, "a sensitive flag");
 TAG_FLAG(test_sensitive_flag, sensitive);
@@ -183,6 +184,28 @@ TEST_F(WebserverTest, TestPostTooBig) {
   ASSERT_EQ("Remote error: HTTP 413", s.ToString());
 }
 
+// Test that a streaming page is received whole, however many chunks it is
+// sent in.
+TEST_F(WebserverTest, TestStreamingPathHandler) {
+  FLAGS_webserver_streaming_chunk_bytes = 100;
+  server_->RegisterStreamingPathHandler(
+      "/streaming", "",
+      [](const Webserver::WebRequest& req, Webserver::WebResponseStream* stream) {
+        for (int i = 0; i < 1000; i++) {
+          *stream->output() << strings::Substitute("row $0\n", i);
+          stream->Flush();
+        }
+      },
+      false /* styled */, false /* is_on_nav_bar */);
+  ASSERT_OK(curl_.FetchURL(strings::Substitute("http://$0/streaming", addr_.ToString()),
+                           &buf_));
+  string expected;
+  for (int i = 0; i < 1000; i++) {
+    expected += strings::Substitute("row $0\n", i);
+  }
+  ASSERT_EQ(expected, buf_.ToString());
+}
+
 // Test that static files are served and that directory listings are
 // disabled.
 TEST_F(WebserverTest, TestStaticFiles) {
@@ -65,8 +65,56 @@ DEFINE_int32(webserver_max_post_length_bytes, 1024 * 1024,
 TAG_FLAG(webserver_max_post_length_bytes, advanced);
 TAG_FLAG(webserver_max_post_length_bytes, runtime);
 
+DEFINE_int32(webserver_streaming_chunk_bytes, 64 * 1024,
+             "The amount of output a streaming page of the embedded web server "
+             "buffers before sending it to the client.");
+TAG_FLAG(webserver_streaming_chunk_bytes, advanced);
+TAG_FLAG(webserver_streaming_chunk_bytes, runtime);
+
 namespace kudu {
 
+namespace {
+
+// Sends the output of a path handler to the client. If 'chunked', the output
+// is sent with chunked transfer encoding as soon as enough of it is buffered,
+// otherwise it is all buffered until the handler is done.
+class ResponseStream : public WebCallbackRegistry::WebResponseStream {
+ public:
+  ResponseStream(struct sq_connection* connection, bool chunked)
+      : connection_(connection),
+        chunked_(chunked) {
+  }
+
+  ostringstream* output() OVERRIDE { return &output_; }
+
+  void Flush() OVERRIDE {
+    if (chunked_ && output_.tellp() >= FLAGS_webserver_streaming_chunk_bytes) {
+      SendChunk();
+    }
+  }
+
+  // Sends whatever is buffered as a chunk, if chunked.
+  void SendChunk() {
+    DCHECK(chunked_);
+    string str = output_.str();
+    if (str.empty()) {
+      return;
+    }
+    sq_printf(connection_, "%zx\r\n", str.length());
+    // Make sure to use sq_write for printing the body; sq_printf truncates at 8kb
+    sq_write(connection_, str.c_str(), str.length());
+    sq_write(connection_, "\r\n", 2);
+    output_.str("");
+  }
+
+ private:
+  struct sq_connection* connection_;
+  const bool chunked_;
+  ostringstream output_;
+};
+
+} // anonymous namespace
+
 Webserver::Webserver(const WebserverOptions& opts)
   : opts_(opts),
     context_(nullptr) {
@@ -381,27 +429,35 @@ int Webserver::RunPathHandler(const PathHandler& handler,
     use_style = false;
   }
 
-  ostringstream output;
-  if (use_style) BootstrapPageHeader(&output);
-  for (const PathHandlerCallback& callback_ : handler.callbacks()) {
-    callback_(req, &output);
-  }
-  if (use_style) BootstrapPageFooter(&output);
-
-  string str = output.str();
   // Without styling, render the page as plain text
-  if (!use_style) {
+  const char* content_type = use_style ? "text/html" : "text/plain";
+  if (handler.is_streaming()) {
     sq_printf(connection, "HTTP/1.1 200 OK\r\n"
-              "Content-Type: text/plain\r\n"
-              "Content-Length: %zd\r\n"
-              "\r\n", str.length());
-  } else {
-    sq_printf(connection, "HTTP/1.1 200 OK\r\n"
-              "Content-Type: text/html\r\n"
-              "Content-Length: %zd\r\n"
-              "\r\n", str.length());
+              "Content-Type: %s\r\n"
+              "Transfer-Encoding: chunked\r\n"
+              "\r\n", content_type);
+  }
+
+  ResponseStream stream(connection, handler.is_streaming());
+  if (use_style) BootstrapPageHeader(stream.output());
+  for (const StreamingPathHandlerCallback& callback_ : handler.callbacks()) {
+    callback_(req, &stream);
+  }
+  if (use_style) BootstrapPageFooter(stream.output());
+
+  if (handler.is_streaming()) {
+    stream.SendChunk();
+    // The last, empty chunk ends the response.
+    sq_write(connection, "0\r\n\r\n", 5);
+    return 1;
   }
 
+  string str = stream.output()->str();
+  sq_printf(connection, "HTTP/1.1 200 OK\r\n"
+            "Content-Type: %s\r\n"
+            "Content-Length: %zd\r\n"
+            "\r\n", content_type, str.length());
+
   // Make sure to use sq_write for printing the body; sq_printf truncates at 8kb
   sq_write(connection, str.c_str(), str.length());
   return 1;
@@ -418,6 +474,17 @@ void Webserver::RegisterPathHandler(const string& path, const string& alias,
   it->second->AddCallback(callback);
 }
 
+void Webserver::RegisterStreamingPathHandler(const string& path, const string& alias,
+    const StreamingPathHandlerCallback& callback, bool is_styled, bool is_on_nav_bar) {
+  std::lock_guard<RWMutex> l(lock_);
+  auto it = path_handlers_.find(path);
+  if (it == path_handlers_.end()) {
+    it = path_handlers_.insert(
+        make_pair(path, new PathHandler(is_styled, is_on_nav_bar, alias))).first;
+  }
+  it->second->AddStreamingCallback(callback);
+}
+
 const char* const PAGE_HEADER = "<!DOCTYPE html>"
 " <html>"
 "   <head><title>Kudu</title>"
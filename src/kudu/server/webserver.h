@@ -59,6 +59,11 @@ class Webserver : public WebCallbackRegistry {
                                    const PathHandlerCallback& callback,
                                    bool is_styled = true, bool is_on_nav_bar = true) OVERRIDE;
 
+  virtual void RegisterStreamingPathHandler(const std::string& path, const std::string& alias,
+                                            const StreamingPathHandlerCallback& callback,
+                                            bool is_styled = true,
+                                            bool is_on_nav_bar = true) OVERRIDE;
+
   // Change the footer HTML to be displayed at the bottom of all styled web pages.
   void set_footer_html(const std::string& html);
 
@@ -71,16 +76,25 @@ class Webserver : public WebCallbackRegistry {
     PathHandler(bool is_styled, bool is_on_nav_bar, std::string alias)
         : is_styled_(is_styled),
           is_on_nav_bar_(is_on_nav_bar),
+          is_streaming_(false),
           alias_(std::move(alias)) {}
 
     void AddCallback(const PathHandlerCallback& callback) {
+      callbacks_.push_back([callback](const WebRequest& req, WebResponseStream* stream) {
+          callback(req, stream->output());
+        });
+    }
+
+    void AddStreamingCallback(const StreamingPathHandlerCallback& callback) {
       callbacks_.push_back(callback);
+      is_streaming_ = true;
     }
 
     bool is_styled() const { return is_styled_; }
     bool is_on_nav_bar() const { return is_on_nav_bar_; }
+    bool is_streaming() const { return is_streaming_; }
     const std::string& alias() const { return alias_; }
-    const std::vector<PathHandlerCallback>& callbacks() const { return callbacks_; }
+    const std::vector<StreamingPathHandlerCallback>& callbacks() const { return callbacks_; }
 
    private:
     // If true, the page appears is rendered styled.
@@ -89,11 +103,15 @@ class Webserver : public WebCallbackRegistry {
     // If true, the page appears in the navigation bar.
     bool is_on_nav_bar_;
 
+    // If true, the page is sent with chunked transfer encoding as it is
+    // rendered. Set if any of the callbacks is a streaming one.
+    bool is_streaming_;
+
     // Alias used when displaying this link on the nav bar.
     std::string alias_;
 
     // List of callbacks to render output for this page, called in order.
-    std::vector<PathHandlerCallback> callbacks_;
+    std::vector<StreamingPathHandlerCallback> callbacks_;
   };
 
   bool static_pages_available() const;
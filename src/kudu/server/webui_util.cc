@@ -17,16 +17,27 @@
 
 #include "kudu/server/webui_util.h"
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 
+#include <gflags/gflags.h>
+
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/human_readable.h"
+#include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/server/monitored_task.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/url-coding.h"
 
+DEFINE_int32(webserver_rows_per_page, 1000,
+             "The default number of rows of the large tables of the web UI, "
+             "such as the tablets of a tablet server, rendered on one page.");
+TAG_FLAG(webserver_rows_per_page, advanced);
+TAG_FLAG(webserver_rows_per_page, runtime);
+
 using strings::Substitute;
 
 namespace kudu {
@@ -125,4 +136,43 @@ void HtmlOutputTaskList(const std::vector<scoped_refptr<MonitoredTask> >& tasks,
   }
   *output << "</table>\n";
 }
+
+HtmlPage ParseHtmlPage(const WebCallbackRegistry::WebRequest& req, int num_rows) {
+  HtmlPage page;
+  page.num_rows = num_rows;
+  int32_t offset = 0;
+  int32_t limit = FLAGS_webserver_rows_per_page;
+  string arg;
+  if (FindCopy(req.parsed_args, "offset", &arg) && !safe_strto32(arg, &offset)) {
+    offset = 0;
+  }
+  if (FindCopy(req.parsed_args, "limit", &arg) && !safe_strto32(arg, &limit)) {
+    limit = FLAGS_webserver_rows_per_page;
+  }
+  page.limit = std::max(1, limit);
+  page.first = std::min(std::max(0, offset), num_rows);
+  page.last = page.first + std::min(page.limit, num_rows - page.first);
+  return page;
+}
+
+void HtmlOutputPageLinks(const std::string& path, const HtmlPage& page,
+                         std::ostringstream* output) {
+  if (page.first == 0 && page.last == page.num_rows) {
+    return;
+  }
+  *output << "<p>";
+  if (page.first > 0) {
+    *output << Substitute("<a href=\"$0?offset=$1&limit=$2\">&laquo; Previous</a> ",
+                          path, std::max(0, page.first - page.limit), page.limit);
+  }
+  *output << Substitute("Showing $0 to $1 of $2",
+                        page.first + (page.last > page.first ? 1 : 0),
+                        page.last, page.num_rows);
+  if (page.last < page.num_rows) {
+    *output << Substitute(" <a href=\"$0?offset=$1&limit=$2\">Next &raquo;</a>",
+                          path, page.last, page.limit);
+  }
+  *output << "</p>\n";
+}
+
 } // namespace kudu
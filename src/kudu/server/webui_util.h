@@ -23,6 +23,7 @@
 
 #include "kudu/common/schema.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/web_callback_registry.h"
 
 namespace kudu {
 
@@ -37,6 +38,25 @@ void HtmlOutputImpalaSchema(const std::string& table_name,
                             std::ostringstream* output);
 void HtmlOutputTaskList(const std::vector<scoped_refptr<MonitoredTask> >& tasks,
                         std::ostringstream* output);
+
+// A range of the rows of a table to render on a page, parsed from the
+// 'offset' and 'limit' arguments of a request.
+struct HtmlPage {
+  // The first row of the page.
+  int first;
+  // One past the last row of the page.
+  int last;
+  // The number of rows per page.
+  int limit;
+  // The total number of rows.
+  int num_rows;
+};
+HtmlPage ParseHtmlPage(const WebCallbackRegistry::WebRequest& req, int num_rows);
+
+// Renders which rows of the table 'page' shows, with links to the previous
+// and next pages of 'path'.
+void HtmlOutputPageLinks(const std::string& path, const HtmlPage& page,
+                         std::ostringstream* output);
 } // namespace kudu
 
 #endif // KUDU_SERVER_WEBUI_UTIL_H
@@ -15,8 +15,10 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <string>
 #include <thread>
 #include <unordered_set>
 
@@ -27,6 +29,7 @@
 #include "kudu/util/hexdump.h"
 #include "kudu/util/memory/memory.h"
 #include "kudu/util/memory/overwrite.h"
+#include "kudu/util/random.h"
 #include "kudu/util/stopwatch.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
@@ -35,6 +38,7 @@ namespace kudu {
 namespace tablet {
 namespace btree {
 
+using std::string;
 using std::thread;
 using std::unordered_set;
 using std::vector;
@@ -312,6 +316,60 @@ static void InsertRandomKeys(TREE *t, int n_keys,
   }
 }
 
+// Keys whose 8-byte prefixes are equal, or which differ only in trailing
+// zero bytes, must still be ordered by comparing the whole key.
+TEST_F(TestCBTree, TestKeysWithEqualPrefixes) {
+  CBTree<SmallFanoutTraits> t;
+  vector<string> keys = {
+    "",
+    string("\0", 1),
+    string("\0\0\0\0\0\0\0\0\0", 9),
+    "a",
+    string("a\0", 2),
+    string("a\0\0\0\0\0\0\0", 8),
+    string("a\0\0\0\0\0\0\0\0", 9),
+    "abcdefgh",
+    "abcdefgh0",
+    "abcdefgh1",
+    "abcdefghi",
+    "\xff\xff\xff\xff\xff\xff\xff\xff",
+    "\xff\xff\xff\xff\xff\xff\xff\xff\xff",
+  };
+  for (int i = 0; i < 500; i++) {
+    keys.push_back(StringPrintf("shared_prefix_%05d", i));
+  }
+  vector<string> shuffled = keys;
+  std::random_shuffle(shuffled.begin(), shuffled.end());
+  for (const string& key : shuffled) {
+    ASSERT_TRUE(t.Insert(Slice(key), Slice(key))) << HexDump(Slice(key));
+  }
+  for (const string& key : keys) {
+    ASSERT_FALSE(t.Insert(Slice(key), Slice("dup"))) << HexDump(Slice(key));
+    NO_FATALS(VerifyGet(t, Slice(key), Slice(key)));
+  }
+
+  std::sort(keys.begin(), keys.end());
+  gscoped_ptr<CBTreeIterator<SmallFanoutTraits> > iter(t.NewIterator());
+  bool exact;
+  ASSERT_TRUE(iter->SeekAtOrAfter(Slice(""), &exact));
+  for (const string& key : keys) {
+    ASSERT_TRUE(iter->IsValid());
+    Slice k, v;
+    iter->GetCurrentEntry(&k, &v);
+    ASSERT_EQ(0, k.compare(Slice(key))) << HexDump(k) << " vs " << HexDump(Slice(key));
+    iter->Next();
+  }
+  ASSERT_FALSE(iter->IsValid());
+
+  ASSERT_TRUE(iter->SeekAtOrAfter(Slice("abcdefgh"), &exact));
+  ASSERT_TRUE(exact);
+  ASSERT_TRUE(iter->SeekAtOrAfter(Slice("abcdefgh00"), &exact));
+  ASSERT_FALSE(exact);
+  Slice k, v;
+  iter->GetCurrentEntry(&k, &v);
+  ASSERT_EQ("abcdefgh1", k.ToString());
+}
+
 // Similar to above, but inserts in random order
 TEST_F(TestCBTree, TestInsertAndVerifyRandom) {
   CBTree<SmallFanoutTraits> t;
@@ -777,6 +835,53 @@ TEST_F(TestCBTree, TestScanPerformance) {
   }
 }
 
+// Check the performance of inserting, looking up and scanning string keys
+// which share a long common prefix, such as the encoded composite keys of a
+// table whose first key column has few distinct values.
+TEST_F(TestCBTree, TestSharedPrefixKeyPerformance) {
+  CBTree<BTreeTraits> tree;
+#ifndef NDEBUG
+  int n_keys = 10000;
+#else
+  int n_keys = 500000;
+#endif
+  if (AllowSlowTests()) {
+    n_keys = 2000000;
+  }
+  Random rng(SeedRandom());
+  vector<string> keys;
+  keys.reserve(n_keys);
+  for (int i = 0; i < n_keys; i++) {
+    keys.push_back(StringPrintf("host-%02d.datacenter.example.com/metric/%010u",
+                                i % 4, rng.Next()));
+  }
+
+  int n_inserted = 0;
+  LOG_TIMING(INFO, StringPrintf("Insert %d shared-prefix keys", n_keys)) {
+    for (const string& key : keys) {
+      n_inserted += tree.Insert(Slice(key), Slice("v"));
+    }
+  }
+  LOG_TIMING(INFO, StringPrintf("Look up %d shared-prefix keys", n_keys)) {
+    char vbuf[8];
+    for (const string& key : keys) {
+      size_t len = sizeof(vbuf);
+      ASSERT_EQ(CBTree<BTreeTraits>::GET_SUCCESS, tree.GetCopy(Slice(key), vbuf, &len));
+    }
+  }
+  LOG_TIMING(INFO, StringPrintf("Scan %d shared-prefix keys", n_keys)) {
+    gscoped_ptr<CBTreeIterator<BTreeTraits> > iter(tree.NewIterator());
+    bool exact;
+    iter->SeekAtOrAfter(Slice(""), &exact);
+    int count = 0;
+    while (iter->IsValid()) {
+      count++;
+      iter->Next();
+    }
+    ASSERT_EQ(n_inserted, count);
+  }
+}
+
 } // namespace btree
 } // namespace tablet
 } // namespace kudu
@@ -38,7 +38,8 @@ class TestCFileSet : public KuduRowSetTest {
   TestCFileSet() :
     KuduRowSetTest(Schema({ ColumnSchema("c0", INT32),
                             ColumnSchema("c1", INT32, false, nullptr, nullptr, GetRLEStorage()),
-                            ColumnSchema("c2", INT32) }, 1))
+                            ColumnSchema("c2", INT32, false, nullptr, nullptr,
+                                         GetIndexedStorage()) }, 1))
   {}
 
   virtual void SetUp() OVERRIDE {
@@ -52,7 +53,8 @@ class TestCFileSet : public KuduRowSetTest {
   // Write out a test rowset with two int columns.
   // The first column contains the row index * 2.
   // The second contains the row index * 10.
-  // The third column contains index * 100, but is never read.
+  // The third column contains index * 100, but is never read, except for
+  // its bloom filters and secondary index.
   void WriteTestRowSet(int nrows) {
     DiskRowSetWriter rsw(rowset_meta_.get(), &schema_,
                          BloomFilterSizing::BySizeAndFPRate(32*1024, 0.01f));
@@ -120,6 +122,13 @@ class TestCFileSet : public KuduRowSetTest {
     return attr;
   }
 
+  ColumnStorageAttributes GetIndexedStorage() const {
+    ColumnStorageAttributes attr;
+    attr.bloom_filter = true;
+    attr.secondary_index = true;
+    return attr;
+  }
+
  protected:
   static const int32_t kNoBound;
   google::FlagSaver saver;
@@ -133,7 +142,7 @@ TEST_F(TestCFileSet, TestPartiallyMaterialize) {
   WriteTestRowSet(kNumRows);
 
   shared_ptr<CFileSet> fileset;
-  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
 
   gscoped_ptr<CFileSet::Iterator> iter(fileset->NewIterator(&schema_));
   ASSERT_OK(iter->Init(nullptr));
@@ -213,7 +222,7 @@ TEST_F(TestCFileSet, TestIteratePartialSchema) {
   WriteTestRowSet(kNumRows);
 
   shared_ptr<CFileSet> fileset;
-  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
 
   Schema new_schema;
   ASSERT_OK(schema_.CreateProjectionByNames({ "c0", "c2" }, &new_schema));
@@ -246,7 +255,7 @@ TEST_F(TestCFileSet, TestRangeScan) {
   WriteTestRowSet(kNumRows);
 
   shared_ptr<CFileSet> fileset;
-  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
 
   // Create iterator.
   shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
@@ -291,6 +300,49 @@ TEST_F(TestCFileSet, TestRangeScan) {
   EXPECT_EQ(stats[2].data_blocks_read_from_disk, 1);
 }
 
+// Test that an IN list predicate on the key column is turned into reads of
+// the matching rows only.
+TEST_F(TestCFileSet, TestKeyInListScan) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+
+  shared_ptr<CFileSet::Iterator> cfile_iter(fileset->NewIterator(&schema_));
+  gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+  Arena arena(1024, 256 * 1024);
+  AutoReleasePool pool;
+
+  // The key column is the rowidx * 2, so the odd values and those out of
+  // [0, 2 * kNumRows) match no row.
+  vector<int32_t> values = { -4, 1, 2000, 2001, 2002, 10000, 19998, 30000 };
+  vector<const void*> value_ptrs;
+  for (const int32_t& value : values) {
+    value_ptrs.push_back(&value);
+  }
+  ScanSpec spec;
+  spec.AddPredicate(ColumnPredicate::InList(schema_.column(0), &value_ptrs));
+  spec.OptimizeScan(schema_, &arena, &pool, true);
+  ASSERT_OK(iter->Init(&spec));
+
+  // Rows 1000 and 1001 are adjacent, which leaves three ranges of rows.
+  ASSERT_EQ(3, cfile_iter->key_ranges_.size());
+  EXPECT_EQ(1000, cfile_iter->key_ranges_[0].first);
+  EXPECT_EQ(1002, cfile_iter->key_ranges_[0].second);
+  EXPECT_EQ(5000, cfile_iter->key_ranges_[1].first);
+  EXPECT_EQ(9999, cfile_iter->key_ranges_[2].first);
+  EXPECT_EQ(kNumRows, cfile_iter->key_ranges_[2].second);
+
+  vector<string> results;
+  ASSERT_OK(IterateToStringList(iter.get(), &results));
+  ASSERT_EQ(4, results.size());
+  EXPECT_EQ("(int32 c0=2000, int32 c1=10000, int32 c2=100000)", results[0]);
+  EXPECT_EQ("(int32 c0=2002, int32 c1=10010, int32 c2=100100)", results[1]);
+  EXPECT_EQ("(int32 c0=10000, int32 c1=50000, int32 c2=500000)", results[2]);
+  EXPECT_EQ("(int32 c0=19998, int32 c1=99990, int32 c2=999900)", results[3]);
+}
+
 // Several other black-box tests for range scans. These are similar to
 // TestRangeScan above, except don't inspect internal state.
 TEST_F(TestCFileSet, TestRangePredicates2) {
@@ -298,7 +350,7 @@ TEST_F(TestCFileSet, TestRangePredicates2) {
   WriteTestRowSet(kNumRows);
 
   shared_ptr<CFileSet> fileset;
-  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), &fileset));
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
 
   // Range scan where rows match on both ends
   DoTestRangeScan(fileset, 2000, 2010);
@@ -318,6 +370,119 @@ TEST_F(TestCFileSet, TestRangePredicates2) {
   DoTestRangeScan(fileset, kNumRows * 10, kNoBound);
 }
 
+// Test that equality and IN-list predicates which the bloom filters of a
+// column rule out skip the whole rowset.
+TEST_F(TestCFileSet, TestBloomFilterPredicates) {
+  const int kNumRows = 1000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+
+  auto HasRows = [&](const ColumnPredicate& pred, bool* has_rows) {
+    ScanSpec spec;
+    spec.AddPredicate(pred);
+    gscoped_ptr<CFileSet::Iterator> iter(fileset->NewIterator(&schema_));
+    ASSERT_OK(iter->Init(&spec));
+    *has_rows = iter->HasNext();
+  };
+
+  bool has_rows;
+  int32_t present = 500;
+  int32_t absent = 550;
+  int32_t other_absent = 650;
+  HasRows(ColumnPredicate::Equality(schema_.column(2), &present), &has_rows);
+  ASSERT_TRUE(has_rows);
+  HasRows(ColumnPredicate::Equality(schema_.column(2), &absent), &has_rows);
+  ASSERT_FALSE(has_rows);
+
+  vector<const void*> values = { &absent, &other_absent };
+  HasRows(ColumnPredicate::InList(schema_.column(2), &values), &has_rows);
+  ASSERT_FALSE(has_rows);
+  values = { &absent, &present };
+  HasRows(ColumnPredicate::InList(schema_.column(2), &values), &has_rows);
+  ASSERT_TRUE(has_rows);
+
+  // The second column has no bloom filters, so it never skips the rowset.
+  int32_t absent_from_c1 = 15;
+  HasRows(ColumnPredicate::Equality(schema_.column(1), &absent_from_c1), &has_rows);
+  ASSERT_TRUE(has_rows);
+}
+
+// Test that predicates on a column with a secondary index are turned into
+// reads of the matching rows only, unless they match too many rows.
+TEST_F(TestCFileSet, TestSecondaryIndexScan) {
+  const int kNumRows = 10000;
+  WriteTestRowSet(kNumRows);
+
+  shared_ptr<CFileSet> fileset;
+  ASSERT_OK(CFileSet::Open(rowset_meta_, MemTracker::GetRootTracker(), nullptr, &fileset));
+
+  Arena arena(1024, 256 * 1024);
+  AutoReleasePool pool;
+  shared_ptr<CFileSet::Iterator> cfile_iter;
+  auto Scan = [&](ScanSpec* spec, vector<string>* results) {
+    cfile_iter.reset(fileset->NewIterator(&schema_));
+    gscoped_ptr<RowwiseIterator> iter(new MaterializingIterator(cfile_iter));
+    spec->OptimizeScan(schema_, &arena, &pool, true);
+    ASSERT_OK(iter->Init(spec));
+    ASSERT_OK(IterateToStringList(iter.get(), results));
+  };
+
+  // The third column is the rowidx * 100.
+  {
+    int32_t lower = 200000;
+    int32_t upper = 200450;
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(2), &lower, &upper));
+    vector<string> results;
+    NO_FATALS(Scan(&spec, &results));
+    EXPECT_EQ(2000, cfile_iter->lower_bound_idx_);
+    EXPECT_EQ(2005, cfile_iter->upper_bound_idx_);
+    EXPECT_TRUE(cfile_iter->key_ranges_.empty());
+    ASSERT_EQ(5, results.size());
+    EXPECT_EQ("(int32 c0=4000, int32 c1=20000, int32 c2=200000)", results[0]);
+    EXPECT_EQ("(int32 c0=4008, int32 c1=20040, int32 c2=200400)", results[4]);
+  }
+
+  // An IN list, combined with a range on the key: the value 100 is in row 1,
+  // before the range, and 555 matches no row.
+  {
+    vector<int32_t> values = { 100, 300000, 300100, 555, 999900 };
+    vector<const void*> value_ptrs;
+    for (const int32_t& value : values) {
+      value_ptrs.push_back(&value);
+    }
+    int32_t key_lower = 6000;
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::InList(schema_.column(2), &value_ptrs));
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(0), &key_lower, nullptr));
+    vector<string> results;
+    NO_FATALS(Scan(&spec, &results));
+    ASSERT_EQ(2, cfile_iter->key_ranges_.size());
+    EXPECT_EQ(3000, cfile_iter->key_ranges_[0].first);
+    EXPECT_EQ(3002, cfile_iter->key_ranges_[0].second);
+    EXPECT_EQ(9999, cfile_iter->key_ranges_[1].first);
+    EXPECT_EQ(kNumRows, cfile_iter->key_ranges_[1].second);
+    ASSERT_EQ(3, results.size());
+    EXPECT_EQ("(int32 c0=6000, int32 c1=30000, int32 c2=300000)", results[0]);
+    EXPECT_EQ("(int32 c0=6002, int32 c1=30010, int32 c2=300100)", results[1]);
+    EXPECT_EQ("(int32 c0=19998, int32 c1=99990, int32 c2=999900)", results[2]);
+  }
+
+  // A predicate matching most rows is evaluated by scanning them all.
+  {
+    int32_t lower = 100;
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Range(schema_.column(2), &lower, nullptr));
+    vector<string> results;
+    NO_FATALS(Scan(&spec, &results));
+    EXPECT_EQ(0, cfile_iter->lower_bound_idx_);
+    EXPECT_EQ(kNumRows, cfile_iter->upper_bound_idx_);
+    EXPECT_TRUE(cfile_iter->key_ranges_.empty());
+    ASSERT_EQ(kNumRows - 1, results.size());
+  }
+}
 
 } // namespace tablet
 } // namespace kudu
@@ -24,20 +24,33 @@
 #include "kudu/cfile/bloomfile.h"
 #include "kudu/cfile/cfile_util.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/common/column_statistics.h"
+#include "kudu/common/columnblock.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/column_materialization_context.h"
+#include "kudu/common/row.h"
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/cfile_set.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/memory/arena.h"
 
 DEFINE_bool(consult_bloom_filters, true, "Whether to consult bloom filters on row presence checks");
 TAG_FLAG(consult_bloom_filters, hidden);
 
+DEFINE_double(tablet_secondary_index_max_match_ratio, 0.1,
+              "Largest fraction of the rows of a rowset scan which a predicate "
+              "may match for the scan to only read the matching rows through the "
+              "secondary index of the column. Less selective predicates are "
+              "evaluated by scanning the rows sequentially.");
+TAG_FLAG(tablet_secondary_index_max_match_ratio, advanced);
+TAG_FLAG(tablet_secondary_index_max_match_ratio, runtime);
+
 namespace kudu {
 namespace tablet {
 
@@ -45,6 +58,7 @@ using cfile::ReaderOptions;
 using cfile::DefaultColumnValueIterator;
 using fs::ReadableBlock;
 using std::shared_ptr;
+using std::vector;
 using strings::Substitute;
 
 ////////////////////////////////////////////////////////////
@@ -53,6 +67,7 @@ using strings::Substitute;
 
 static Status OpenReader(FsManager* fs,
                          shared_ptr<MemTracker> parent_mem_tracker,
+                         scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution,
                          const BlockId& block_id,
                          gscoped_ptr<CFileReader> *new_reader) {
   gscoped_ptr<ReadableBlock> block;
@@ -60,6 +75,7 @@ static Status OpenReader(FsManager* fs,
 
   ReaderOptions opts;
   opts.parent_mem_tracker = std::move(parent_mem_tracker);
+  opts.block_cache_attribution = std::move(block_cache_attribution);
   return CFileReader::OpenNoInit(std::move(block),
                                  std::move(opts),
                                  new_reader);
@@ -70,9 +86,11 @@ static Status OpenReader(FsManager* fs,
 ////////////////////////////////////////////////////////////
 
 CFileSet::CFileSet(shared_ptr<RowSetMetadata> rowset_metadata,
-                   shared_ptr<MemTracker> parent_mem_tracker)
+                   shared_ptr<MemTracker> parent_mem_tracker,
+                   scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution)
     : rowset_metadata_(std::move(rowset_metadata)),
-      parent_mem_tracker_(std::move(parent_mem_tracker)) {
+      parent_mem_tracker_(std::move(parent_mem_tracker)),
+      block_cache_attribution_(std::move(block_cache_attribution)) {
 }
 
 CFileSet::~CFileSet() {
@@ -80,9 +98,11 @@ CFileSet::~CFileSet() {
 
 Status CFileSet::Open(shared_ptr<RowSetMetadata> rowset_metadata,
                       shared_ptr<MemTracker> parent_mem_tracker,
+                      scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution,
                       shared_ptr<CFileSet>* cfile_set) {
   shared_ptr<CFileSet> cfs(new CFileSet(std::move(rowset_metadata),
-                                        std::move(parent_mem_tracker)));
+                                        std::move(parent_mem_tracker),
+                                        std::move(block_cache_attribution)));
   RETURN_NOT_OK(cfs->DoOpen());
 
   cfile_set->swap(cfs);
@@ -102,6 +122,7 @@ Status CFileSet::DoOpen() {
     gscoped_ptr<CFileReader> reader;
     RETURN_NOT_OK(OpenReader(rowset_metadata_->fs_manager(),
                              parent_mem_tracker_,
+                             block_cache_attribution_,
                              rowset_metadata_->column_data_block_for_col_id(col_id),
                              &reader));
     readers_by_col_id_[col_id] = shared_ptr<CFileReader>(reader.release());
@@ -112,6 +133,7 @@ Status CFileSet::DoOpen() {
   if (rowset_metadata_->has_adhoc_index_block()) {
     RETURN_NOT_OK(OpenReader(rowset_metadata_->fs_manager(),
                              parent_mem_tracker_,
+                             block_cache_attribution_,
                              rowset_metadata_->adhoc_index_block(),
                              &ad_hoc_idx_reader_));
   }
@@ -133,6 +155,7 @@ Status CFileSet::OpenBloomReader() {
 
   ReaderOptions opts;
   opts.parent_mem_tracker = parent_mem_tracker_;
+  opts.block_cache_attribution = block_cache_attribution_;
   Status s = BloomFileReader::OpenNoInit(std::move(block),
                                          std::move(opts),
                                          &bloom_reader_);
@@ -179,6 +202,59 @@ Status CFileSet::NewColumnIterator(ColumnId col_id, CFileReader::CacheControl ca
   return FindOrDie(readers_by_col_id_, col_id)->NewIterator(iter, cache_blocks);
 }
 
+Status CFileSet::CheckValueMayBePresent(ColumnId col_id, const void* cell,
+                                        bool* maybe_present) const {
+  const shared_ptr<CFileReader>& reader = FindOrDie(readers_by_col_id_, col_id);
+  // Fully open the CFileReader if it was lazily opened earlier.
+  RETURN_NOT_OK(reader->Init());
+  if (!reader->has_value_bloom()) {
+    *maybe_present = true;
+    return Status::OK();
+  }
+  return reader->CheckValueMayBePresent(cell, maybe_present);
+}
+
+Status CFileSet::SearchSecondaryIndex(ColumnId col_id, const ColumnPredicate& pred,
+                                      size_t max_rows, vector<rowid_t>* rowids,
+                                      bool* used) const {
+  const shared_ptr<CFileReader>& reader = FindOrDie(readers_by_col_id_, col_id);
+  // Fully open the CFileReader if it was lazily opened earlier.
+  RETURN_NOT_OK(reader->Init());
+  rowids->clear();
+  if (!reader->has_secondary_index()) {
+    *used = false;
+    return Status::OK();
+  }
+  bool exceeded;
+  RETURN_NOT_OK(reader->SearchSecondaryIndex(pred, max_rows, rowids, &exceeded));
+  if (exceeded) {
+    rowids->clear();
+  }
+  *used = !exceeded;
+  return Status::OK();
+}
+
+Status CFileSet::MergeColumnStatistics(ColumnId col_id, ColumnStatistics* stats,
+                                       bool* found) const {
+  // The column may have been added after the rowset was written.
+  const shared_ptr<CFileReader>* reader_ptr = FindOrNull(readers_by_col_id_, col_id);
+  if (reader_ptr == nullptr) {
+    *found = false;
+    return Status::OK();
+  }
+  const shared_ptr<CFileReader>& reader = *reader_ptr;
+  RETURN_NOT_OK(reader->Init());
+  if (!reader->has_column_stats()) {
+    *found = false;
+    return Status::OK();
+  }
+  ColumnStatistics rowset_stats(stats->type());
+  RETURN_NOT_OK(reader->ReadColumnStats(&rowset_stats));
+  RETURN_NOT_OK(stats->Merge(rowset_stats));
+  *found = true;
+  return Status::OK();
+}
+
 CFileSet::Iterator *CFileSet::NewIterator(const Schema *projection) const {
   return new CFileSet::Iterator(shared_from_this(), projection);
 }
@@ -194,6 +270,50 @@ Status CFileSet::GetBounds(string* min_encoded_key,
   return Status::OK();
 }
 
+Status CFileSet::SampleKeys(int num_samples, vector<string>* encoded_keys) const {
+  rowid_t num_rows;
+  RETURN_NOT_OK(CountRows(&num_rows));
+  if (num_rows == 0 || num_samples <= 0) {
+    return Status::OK();
+  }
+
+  CFileIterator* raw_iter = nullptr;
+  RETURN_NOT_OK(NewKeyIterator(&raw_iter));
+  gscoped_ptr<CFileIterator> key_iter(raw_iter);
+
+  // The ad-hoc index stores the encoded keys themselves. Otherwise the key
+  // index is the (only) key column, whose values must be encoded.
+  const CFileReader* reader = key_index_reader();
+  const Schema key_schema = tablet_schema().CreateKeyProjection();
+  Arena arena(1024, 1024 * 1024);
+  uint8_t* cell = static_cast<uint8_t*>(arena.AllocateBytes(reader->type_info()->size()));
+  ColumnBlock block(reader->type_info(), nullptr, cell, 1, &arena);
+  ColumnMaterializationContext ctx(0, nullptr, &block, nullptr);
+  faststring enc_key;
+
+  uint64_t prev_ord = num_rows;
+  for (int i = 1; i <= num_samples; i++) {
+    rowid_t ord = static_cast<uint64_t>(num_rows) * i / (num_samples + 1);
+    if (ord == prev_ord) continue;
+    prev_ord = ord;
+
+    RETURN_NOT_OK(key_iter->SeekToOrdinal(ord));
+    size_t n = 1;
+    RETURN_NOT_OK(key_iter->CopyNextValues(&n, &ctx));
+    if (PREDICT_FALSE(n != 1)) {
+      return Status::Corruption(Substitute("Could not read key at ordinal $0", ord),
+                                ToString());
+    }
+    if (ad_hoc_idx_reader_) {
+      encoded_keys->push_back(reinterpret_cast<const Slice*>(cell)->ToString());
+    } else {
+      ConstContiguousRow row(&key_schema, cell);
+      encoded_keys->push_back(key_schema.EncodeComparableKey(row, &enc_key).ToString());
+    }
+  }
+  return Status::OK();
+}
+
 uint64_t CFileSet::EstimateOnDiskSize() const {
   uint64_t ret = 0;
   for (const ReaderMap::value_type& e : readers_by_col_id_) {
@@ -255,6 +375,56 @@ Status CFileSet::CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
   return s;
 }
 
+Status CFileSet::CheckRowsPresent(const RowSetKeyProbe* const* probes, int num_probes,
+                                  bool* present, rowid_t* rowids,
+                                  ProbeStats* const* stats) const {
+  // Until shown otherwise by the bloom filter, every key may be present.
+  std::fill(present, present + num_probes, true);
+  if (bloom_reader_ != nullptr && FLAGS_consult_bloom_filters) {
+    RETURN_NOT_OK(bloom_reader_->Init());
+
+    std::vector<const BloomKeyProbe*> bloom_probes(num_probes);
+    for (int i = 0; i < num_probes; i++) {
+      bloom_probes[i] = &probes[i]->bloom_probe();
+      stats[i]->blooms_consulted++;
+    }
+    Status s = bloom_reader_->CheckKeysPresent(bloom_probes.data(), num_probes, present);
+    if (!s.ok()) {
+      LOG(WARNING) << "Unable to query bloom: " << s.ToString()
+                   << " (disabling bloom for this rowset from this point forward)";
+      const_cast<CFileSet *>(this)->bloom_reader_.reset(nullptr);
+      // Continue with the slow path
+      std::fill(present, present + num_probes, true);
+    }
+  }
+
+  gscoped_ptr<CFileIterator> key_iter;
+  for (int i = 0; i < num_probes; i++) {
+    if (!present[i]) {
+      continue;
+    }
+    if (!key_iter) {
+      CFileIterator* iter = nullptr;
+      RETURN_NOT_OK(NewKeyIterator(&iter));
+      key_iter.reset(iter);
+    }
+    stats[i]->keys_consulted++;
+    bool exact;
+    Status s = key_iter->SeekAtOrAfter(probes[i]->encoded_key(), &exact);
+    if (s.IsNotFound()) {
+      // The key comes past the end of the file, and so do the ones after it.
+      std::fill(present + i, present + num_probes, false);
+      break;
+    }
+    RETURN_NOT_OK(s);
+    present[i] = exact;
+    if (exact) {
+      rowids[i] = key_iter->GetCurrentOrdinal();
+    }
+  }
+  return Status::OK();
+}
+
 Status CFileSet::NewKeyIterator(CFileIterator **key_iter) const {
   return key_index_reader()->NewIterator(key_iter, CFileReader::CACHE_BLOCK);
 }
@@ -275,6 +445,8 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
   CFileReader::CacheControl cache_blocks = CFileReader::CACHE_BLOCK;
   if (spec && !spec->cache_blocks()) {
     cache_blocks = CFileReader::DONT_CACHE_BLOCK;
+  } else if (spec && spec->cache_blocks_low_priority()) {
+    cache_blocks = CFileReader::CACHE_BLOCK_LOW_PRIORITY;
   }
 
   for (int proj_col_idx = 0;
@@ -299,6 +471,9 @@ Status CFileSet::Iterator::CreateColumnIterators(const ScanSpec* spec) {
     RETURN_NOT_OK_PREPEND(base_data_->NewColumnIterator(col_id, cache_blocks, &iter),
                           Substitute("could not create iterator for column $0",
                                      projection_->column(proj_col_idx).ToString()));
+    if (spec && spec->readahead_blocks() >= 0) {
+      iter->set_readahead_depth(spec->readahead_blocks());
+    }
     ret_iters.push_back(iter);
   }
 
@@ -321,6 +496,12 @@ Status CFileSet::Iterator::Init(ScanSpec *spec) {
   // ordinal range.
   RETURN_NOT_OK(PushdownRangeScanPredicate(spec));
 
+  RETURN_NOT_OK(PushdownKeyInListPredicate(spec));
+
+  RETURN_NOT_OK(PushdownBloomFilterPredicates(spec));
+
+  RETURN_NOT_OK(PushdownSecondaryIndexPredicates(spec));
+
   initted_ = true;
 
   // Don't actually seek -- we'll seek when we first actually read the
@@ -390,6 +571,208 @@ Status CFileSet::Iterator::PushdownRangeScanPredicate(ScanSpec *spec) {
   return Status::OK();
 }
 
+Status CFileSet::Iterator::PushdownKeyInListPredicate(const ScanSpec* spec) {
+  key_ranges_.clear();
+  cur_key_range_idx_ = 0;
+  vector<EncodedKeyRange> ranges;
+  if (spec == nullptr || lower_bound_idx_ >= upper_bound_idx_ ||
+      !spec->GetKeyInListRanges(base_data_->tablet_schema(), &ranges)) {
+    return Status::OK();
+  }
+
+  size_t num_key_columns = base_data_->tablet_schema().num_key_columns();
+  Slice min_key(base_data_->min_encoded_key_);
+  Slice max_key(base_data_->max_encoded_key_);
+  for (const EncodedKeyRange& range : ranges) {
+    // Skip the ranges outside of the rowset without seeking.
+    if (Slice(range.lower).compare(max_key) > 0) {
+      break;
+    }
+    if (num_key_columns == 1 ? Slice(range.lower).compare(min_key) < 0
+                             : !range.upper.empty() && Slice(range.upper).compare(min_key) <= 0) {
+      continue;
+    }
+
+    faststring lower_data;
+    lower_data.append(range.lower);
+    vector<const void*> raw_keys = { range.value };
+    EncodedKey lower(&lower_data, &raw_keys, num_key_columns);
+    bool exact;
+    Status s = key_iter_->SeekAtOrAfter(lower, &exact);
+    if (s.IsNotFound()) {
+      break;
+    }
+    RETURN_NOT_OK(s);
+    rowid_t start = key_iter_->GetCurrentOrdinal();
+
+    rowid_t end;
+    if (num_key_columns == 1) {
+      end = exact ? start + 1 : start;
+    } else if (range.upper.empty() || Slice(range.upper).compare(max_key) > 0) {
+      end = row_count_;
+    } else {
+      faststring upper_data;
+      upper_data.append(range.upper);
+      raw_keys = { range.value };
+      EncodedKey upper(&upper_data, &raw_keys, num_key_columns);
+      s = key_iter_->SeekAtOrAfter(upper, &exact);
+      if (s.IsNotFound()) {
+        end = row_count_;
+      } else {
+        RETURN_NOT_OK(s);
+        end = key_iter_->GetCurrentOrdinal();
+      }
+    }
+
+    start = std::max(start, lower_bound_idx_);
+    end = std::min(end, upper_bound_idx_);
+    if (start >= end) {
+      continue;
+    }
+    if (!key_ranges_.empty() && key_ranges_.back().second == start) {
+      key_ranges_.back().second = end;
+    } else {
+      key_ranges_.emplace_back(start, end);
+    }
+  }
+
+  VLOG(1) << "Pushed IN list predicate on the key as " << key_ranges_.size()
+          << " row ranges out of " << ranges.size() << " values";
+  if (key_ranges_.empty()) {
+    upper_bound_idx_ = lower_bound_idx_;
+    return Status::OK();
+  }
+  lower_bound_idx_ = key_ranges_.front().first;
+  upper_bound_idx_ = key_ranges_.back().second;
+  if (key_ranges_.size() == 1) {
+    // A single range is just narrower bounds.
+    key_ranges_.clear();
+  }
+  return Status::OK();
+}
+
+Status CFileSet::Iterator::PushdownBloomFilterPredicates(const ScanSpec* spec) {
+  if (spec == nullptr || value_lookups_disabled_ || lower_bound_idx_ >= upper_bound_idx_) {
+    return Status::OK();
+  }
+
+  for (const auto& entry : spec->predicates()) {
+    const ColumnPredicate& pred = entry.second;
+    if (pred.predicate_type() != PredicateType::Equality &&
+        pred.predicate_type() != PredicateType::InList) {
+      continue;
+    }
+    int col_idx = projection_->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      continue;
+    }
+    ColumnId col_id = projection_->column_id(col_idx);
+    if (!base_data_->has_data_for_column_id(col_id) ||
+        ContainsKey(value_lookups_disabled_col_ids_, col_id)) {
+      continue;
+    }
+
+    bool maybe_present = false;
+    if (pred.predicate_type() == PredicateType::Equality) {
+      RETURN_NOT_OK(base_data_->CheckValueMayBePresent(col_id, pred.raw_lower(),
+                                                       &maybe_present));
+    } else {
+      for (const void* value : pred.raw_values()) {
+        RETURN_NOT_OK(base_data_->CheckValueMayBePresent(col_id, value, &maybe_present));
+        if (maybe_present) break;
+      }
+    }
+    if (!maybe_present) {
+      VLOG(1) << "Bloom filters of " << base_data_->ToString() << " rule out predicate "
+              << pred.ToString();
+      upper_bound_idx_ = lower_bound_idx_;
+      key_ranges_.clear();
+      return Status::OK();
+    }
+  }
+  return Status::OK();
+}
+
+Status CFileSet::Iterator::PushdownSecondaryIndexPredicates(const ScanSpec* spec) {
+  if (spec == nullptr || value_lookups_disabled_ || lower_bound_idx_ >= upper_bound_idx_) {
+    return Status::OK();
+  }
+
+  for (const auto& entry : spec->predicates()) {
+    const ColumnPredicate& pred = entry.second;
+    if (pred.predicate_type() != PredicateType::Equality &&
+        pred.predicate_type() != PredicateType::Range &&
+        pred.predicate_type() != PredicateType::InList) {
+      continue;
+    }
+    int col_idx = projection_->find_column(pred.column().name());
+    if (col_idx == Schema::kColumnNotFound) {
+      continue;
+    }
+    ColumnId col_id = projection_->column_id(col_idx);
+    if (!base_data_->has_data_for_column_id(col_id) ||
+        ContainsKey(value_lookups_disabled_col_ids_, col_id)) {
+      continue;
+    }
+
+    size_t max_rows = static_cast<size_t>(
+        (upper_bound_idx_ - lower_bound_idx_) * FLAGS_tablet_secondary_index_max_match_ratio);
+    vector<rowid_t> rowids;
+    bool used;
+    RETURN_NOT_OK(base_data_->SearchSecondaryIndex(col_id, pred, max_rows, &rowids, &used));
+    if (!used) {
+      continue;
+    }
+
+    // Intersect the runs of consecutive matching rows with the ranges of rows
+    // left to read, which are the bounds if there are no key ranges.
+    vector<std::pair<rowid_t, rowid_t>> ranges;
+    if (key_ranges_.empty()) {
+      ranges.emplace_back(lower_bound_idx_, upper_bound_idx_);
+    } else {
+      ranges.swap(key_ranges_);
+    }
+    auto range = ranges.begin();
+    for (auto it = rowids.begin(); it != rowids.end() && range != ranges.end();) {
+      rowid_t start = *it;
+      rowid_t end = start + 1;
+      for (++it; it != rowids.end() && *it == end; ++it) {
+        end++;
+      }
+      while (range != ranges.end() && range->second <= start) {
+        ++range;
+      }
+      for (auto r = range; r != ranges.end() && r->first < end; ++r) {
+        rowid_t s = std::max(start, r->first);
+        rowid_t e = std::min(end, r->second);
+        if (s >= e) {
+          continue;
+        }
+        if (!key_ranges_.empty() && key_ranges_.back().second == s) {
+          key_ranges_.back().second = e;
+        } else {
+          key_ranges_.emplace_back(s, e);
+        }
+      }
+    }
+
+    VLOG(1) << "Pushed predicate " << pred.ToString() << " on the secondary index of "
+            << base_data_->ToString() << " as " << key_ranges_.size() << " row ranges "
+            << "holding " << rowids.size() << " rows";
+    if (key_ranges_.empty()) {
+      upper_bound_idx_ = lower_bound_idx_;
+      return Status::OK();
+    }
+    lower_bound_idx_ = key_ranges_.front().first;
+    upper_bound_idx_ = key_ranges_.back().second;
+    if (key_ranges_.size() == 1) {
+      // A single range is just narrower bounds.
+      key_ranges_.clear();
+    }
+  }
+  return Status::OK();
+}
+
 void CFileSet::Iterator::Unprepare() {
   prepared_count_ = 0;
   cols_prepared_.assign(col_iters_.size(), false);
@@ -398,7 +781,9 @@ void CFileSet::Iterator::Unprepare() {
 Status CFileSet::Iterator::PrepareBatch(size_t *n) {
   DCHECK_EQ(prepared_count_, 0) << "Already prepared";
 
-  size_t remaining = upper_bound_idx_ - cur_idx_;
+  rowid_t end_idx = key_ranges_.empty() ? upper_bound_idx_
+                                        : key_ranges_[cur_key_range_idx_].second;
+  size_t remaining = end_idx - cur_idx_;
   if (*n > remaining) {
     *n = remaining;
   }
@@ -455,9 +840,24 @@ Status CFileSet::Iterator::MaterializeColumn(ColumnMaterializationContext *ctx)
   CHECK_EQ(prepared_count_, ctx->block()->nrows());
   DCHECK_LT(ctx->col_idx(), col_iters_.size());
 
-  RETURN_NOT_OK(PrepareColumn(ctx));
   ColumnIterator* iter = col_iters_[ctx->col_idx()];
 
+  // If the predicate may be evaluated against the base data (i.e. there are no
+  // deltas which could change the values), check whether the block statistics
+  // rule out every row in the batch. In that case there's no need to read the
+  // column at all.
+  if (ctx->pred() != nullptr && ctx->DecoderEvalNotDisabled() &&
+      !cols_prepared_[ctx->col_idx()]) {
+    bool can_skip;
+    RETURN_NOT_OK(iter->CanSkipRows(*ctx->pred(), cur_idx_, prepared_count_, &can_skip));
+    if (can_skip) {
+      ctx->sel()->SetAllFalse();
+      ctx->SetDecoderEvalSupported();
+      return Status::OK();
+    }
+  }
+
+  RETURN_NOT_OK(PrepareColumn(ctx));
   RETURN_NOT_OK(iter->Scan(ctx));
 
   return Status::OK();
@@ -477,6 +877,14 @@ Status CFileSet::Iterator::FinishBatch() {
   }
 
   cur_idx_ += prepared_count_;
+  if (!key_ranges_.empty() &&
+      cur_idx_ == key_ranges_[cur_key_range_idx_].second &&
+      cur_key_range_idx_ + 1 < key_ranges_.size()) {
+    // Move on to the next range of rows to read. The columns seek there
+    // when they're next prepared.
+    cur_key_range_idx_++;
+    cur_idx_ = key_ranges_[cur_key_range_idx_].first;
+  }
   Unprepare();
 
   return Status::OK();
@@ -19,6 +19,7 @@
 
 #include <gtest/gtest_prod.h>
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -38,6 +39,8 @@
 
 namespace kudu {
 
+class ColumnStatistics;
+
 namespace tablet {
 
 using kudu::cfile::BloomFileReader;
@@ -53,8 +56,10 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
  public:
   class Iterator;
 
+  // 'block_cache_attribution' may be null.
   static Status Open(std::shared_ptr<RowSetMetadata> rowset_metadata,
                      std::shared_ptr<MemTracker> parent_mem_tracker,
+                     scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution,
                      std::shared_ptr<CFileSet>* cfile_set);
 
   // Create an iterator with the given projection. 'projection' must remain valid
@@ -69,6 +74,11 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
 
   uint64_t EstimateOnDiskSize() const;
 
+  // Append to 'encoded_keys' the encoded keys of up to 'num_samples' rows,
+  // evenly spaced by ordinal across the file and in ascending order. Used to
+  // split the key range of compactions.
+  Status SampleKeys(int num_samples, std::vector<std::string>* encoded_keys) const;
+
   // Determine the index of the given row key.
   Status FindRow(const RowSetKeyProbe &probe, rowid_t *idx, ProbeStats* stats) const;
 
@@ -81,11 +91,24 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   Status CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
                          rowid_t *rowid, ProbeStats* stats) const;
 
+  // Like CheckRowPresent(), for each of the 'num_probes' probes, which must
+  // be in ascending key order. Sets present[i], and rowids[i] if the row is
+  // present, and updates *stats[i] for probes[i].
+  //
+  // The bloom filter is consulted for the whole batch at once, and a single
+  // key iterator then seeks forward through the keys which may be present.
+  Status CheckRowsPresent(const RowSetKeyProbe* const* probes, int num_probes,
+                          bool* present, rowid_t* rowids, ProbeStats* const* stats) const;
+
   // Return true if there exists a CFile for the given column ID.
   bool has_data_for_column_id(ColumnId col_id) const {
     return ContainsKey(readers_by_col_id_, col_id);
   }
 
+  // Merges the statistics stored for the given column into 'stats'. Sets
+  // *found to false if none were stored, or if the rowset has no such column.
+  Status MergeColumnStatistics(ColumnId col_id, ColumnStatistics* stats, bool* found) const;
+
   virtual ~CFileSet();
 
  private:
@@ -95,7 +118,8 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
   DISALLOW_COPY_AND_ASSIGN(CFileSet);
 
   CFileSet(std::shared_ptr<RowSetMetadata> rowset_metadata,
-           std::shared_ptr<MemTracker> parent_mem_tracker);
+           std::shared_ptr<MemTracker> parent_mem_tracker,
+           scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution);
 
   Status DoOpen();
   Status OpenBloomReader();
@@ -106,6 +130,19 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
                            CFileIterator **iter) const;
   Status NewKeyIterator(CFileIterator **iter) const;
 
+  // Sets *maybe_present to false if the value bloom filters of the given
+  // column show that no row holds the value of 'cell'. Sets it to true if
+  // they don't, or if the column has no value bloom filters.
+  Status CheckValueMayBePresent(ColumnId col_id, const void* cell,
+                                bool* maybe_present) const;
+
+  // Looks up the rows matching 'pred' in the secondary index of the given
+  // column, see CFileReader::SearchSecondaryIndex(). Sets *used to false,
+  // leaving 'rowids' empty, if the column has no secondary index or more
+  // than 'max_rows' rows match.
+  Status SearchSecondaryIndex(ColumnId col_id, const ColumnPredicate& pred, size_t max_rows,
+                              std::vector<rowid_t>* rowids, bool* used) const;
+
   // Return the CFileReader responsible for reading the key index.
   // (the ad-hoc reader for composite keys, otherwise the key column reader)
   CFileReader* key_index_reader() const;
@@ -114,6 +151,7 @@ class CFileSet : public std::enable_shared_from_this<CFileSet> {
 
   std::shared_ptr<RowSetMetadata> rowset_metadata_;
   std::shared_ptr<MemTracker> parent_mem_tracker_;
+  scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution_;
 
   std::string min_encoded_key_;
   std::string max_encoded_key_;
@@ -158,6 +196,17 @@ class CFileSet::Iterator : public ColumnwiseIterator {
     return string("rowset iterator for ") + base_data_->ToString();
   }
 
+  // Prevent the value bloom filters and the secondary indexes of the given
+  // columns, or of all columns if 'all_columns' is true, from being used to
+  // narrow the scan. They only reflect the values the rowset was written
+  // with, so this must be used for columns which may have been updated since.
+  // Must be called before Init().
+  void DisableValueLookupsForColumns(std::set<ColumnId> col_ids, bool all_columns) {
+    DCHECK(!initted_);
+    value_lookups_disabled_col_ids_ = std::move(col_ids);
+    value_lookups_disabled_ = all_columns;
+  }
+
   const Schema &schema() const OVERRIDE {
     return *projection_;
   }
@@ -175,6 +224,8 @@ class CFileSet::Iterator : public ColumnwiseIterator {
  private:
   DISALLOW_COPY_AND_ASSIGN(Iterator);
   FRIEND_TEST(TestCFileSet, TestRangeScan);
+  FRIEND_TEST(TestCFileSet, TestKeyInListScan);
+  FRIEND_TEST(TestCFileSet, TestSecondaryIndexScan);
   friend class CFileSet;
 
   // 'projection' must remain valid for the lifetime of this object.
@@ -183,7 +234,9 @@ class CFileSet::Iterator : public ColumnwiseIterator {
         projection_(projection),
         initted_(false),
         cur_idx_(0),
-        prepared_count_(0) {
+        prepared_count_(0),
+        cur_key_range_idx_(0),
+        value_lookups_disabled_(false) {
     CHECK_OK(base_data_->CountRows(&row_count_));
   }
 
@@ -195,6 +248,23 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   // store it in member fields.
   Status PushdownRangeScanPredicate(ScanSpec *spec);
 
+  // If the scan has an IN list predicate on the first key column, seek the key
+  // column's index to the rows of each of its values, and store the ranges of
+  // row indexes to read in key_ranges_. The bounds are narrowed accordingly.
+  Status PushdownKeyInListPredicate(const ScanSpec* spec);
+
+  // Check the equality and IN-list predicates of the scan against the value
+  // bloom filters of their columns. If they show that no row can match one of
+  // the predicates, empty the range of the scan.
+  Status PushdownBloomFilterPredicates(const ScanSpec* spec);
+
+  // Look up the equality, range and IN-list predicates of the scan on the
+  // columns with a secondary index, and restrict the ranges of row indexes to
+  // read to the rows they match. A predicate matching more than
+  // --tablet_secondary_index_max_match_ratio of the rows in the bounds is
+  // left to the sequential scan.
+  Status PushdownSecondaryIndexPredicates(const ScanSpec* spec);
+
   void Unprepare();
 
   // Prepare the given column if not already prepared.
@@ -222,6 +292,18 @@ class CFileSet::Iterator : public ColumnwiseIterator {
   rowid_t lower_bound_idx_;
   rowid_t upper_bound_idx_;
 
+  // If not empty, the disjoint ranges [first, second) of row indexes within
+  // the bounds above which may hold rows, in ascending order, and the index of
+  // the one being read. Batches don't cross ranges: once one is read, the
+  // iterator moves on to the start of the next.
+  std::vector<std::pair<rowid_t, rowid_t>> key_ranges_;
+  size_t cur_key_range_idx_;
+
+  // Columns whose value bloom filters and secondary indexes must not be
+  // used, and whether none may be used. See DisableValueLookupsForColumns().
+  std::set<ColumnId> value_lookups_disabled_col_ids_;
+  bool value_lookups_disabled_;
+
 
   // The underlying columns are prepared lazily, so that if a column is never
   // materialized, it doesn't need to be read off disk.
@@ -22,6 +22,7 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid_util.h"
@@ -997,6 +998,70 @@ TEST_F(TestCompaction, TestMergeMRS) {
                 "Redo Mutations: [];", out[19]);
 }
 
+// Test that compaction inputs restricted to the key ranges picked by
+// RowSetsInCompaction::PickSplitKeys() together yield all the rows of the
+// unrestricted input, in order and with their mutations.
+TEST_F(TestCompaction, TestKeyRangeInputs) {
+  RowSetsInCompaction rowsets;
+  for (int delta = 0; delta < 2; delta++) {
+    shared_ptr<MemRowSet> mrs;
+    ASSERT_OK(MemRowSet::Create(delta, schema_, log_anchor_registry_.get(),
+                                mem_trackers_.tablet_tracker, &mrs));
+    InsertRows(mrs.get(), 1000, delta);
+    shared_ptr<DiskRowSet> rs;
+    FlushMRSAndReopenNoRoll(*mrs, schema_, &rs);
+    ASSERT_NO_FATAL_FAILURE();
+    // Leave mutations both in delta files and in the DMS.
+    UpdateRows(rs.get(), 1000, delta, 1);
+    ASSERT_OK(rs->FlushDeltas());
+    UpdateRows(rs.get(), 1000, delta, 2);
+    std::unique_lock<std::mutex> lock(*rs->compact_flush_lock());
+    rowsets.AddRowSet(rs, std::move(lock));
+  }
+
+  vector<string> split_keys;
+  ASSERT_OK(rowsets.PickSplitKeys(4, &split_keys));
+  ASSERT_EQ(3, split_keys.size());
+
+  // Strips the index of the row in its block, which depends on the range.
+  auto strip_row_idx = [](vector<string>* rows) {
+    for (string& row : *rows) {
+      row = row.substr(row.find(';'));
+    }
+  };
+
+  MvccSnapshot snap(mvcc_);
+  shared_ptr<CompactionInput> input;
+  ASSERT_OK(rowsets.CreateCompactionInput(snap, &schema_, &input));
+  vector<string> expected;
+  IterateInput(input.get(), &expected);
+  ASSERT_EQ(2000, expected.size());
+  strip_row_idx(&expected);
+
+  Arena arena(1024, 1024);
+  vector<string> actual;
+  for (int i = 0; i <= split_keys.size(); i++) {
+    gscoped_ptr<EncodedKey> lower;
+    gscoped_ptr<EncodedKey> upper;
+    if (i > 0) {
+      ASSERT_OK(EncodedKey::DecodeEncodedString(schema_, &arena, split_keys[i - 1], &lower));
+    }
+    if (i < split_keys.size()) {
+      ASSERT_OK(EncodedKey::DecodeEncodedString(schema_, &arena, split_keys[i], &upper));
+    }
+    ASSERT_OK(rowsets.CreateCompactionInput(snap, &schema_, &input));
+    ASSERT_OK(input->SetKeyRange(lower.get(), upper.get()));
+    vector<string> range_rows;
+    IterateInput(input.get(), &range_rows);
+    // The split keys balance the ranges.
+    ASSERT_GT(range_rows.size(), 2000 / 8);
+    ASSERT_LT(range_rows.size(), 2000 / 2);
+    strip_row_idx(&range_rows);
+    actual.insert(actual.end(), range_rows.begin(), range_rows.end());
+  }
+  ASSERT_EQ(expected, actual);
+}
+
 #ifdef NDEBUG
 // Benchmark for the compaction merge input for the case where the inputs
 // contain non-overlapping data. In this case the merge can be optimized
@@ -17,13 +17,17 @@
 
 #include "kudu/tablet/compaction.h"
 
+#include <algorithm>
 #include <deque>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <memory>
 #include <string>
 #include <unordered_set>
 #include <vector>
 
+#include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/key_comparator.h"
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/gutil/macros.h"
@@ -38,6 +42,11 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/util/debug/trace_event.h"
+#include "kudu/util/flag_tags.h"
+
+DEFINE_bool(merge_use_codegen, true, "whether compactions and ordered scans should "
+            "use code generation to compare row keys while merging their inputs");
+TAG_FLAG(merge_use_codegen, hidden);
 
 using kudu::server::HybridClock;
 using std::shared_ptr;
@@ -164,13 +173,96 @@ class MemRowSetCompactionInput : public CompactionInput {
 
 ////////////////////////////////////////////////////////////
 
+// CompactionInput yielding rows which have not been written anywhere yet, each
+// with an UNDO that deletes it as of its insertion.
+class SortedRowsCompactionInput : public CompactionInput {
+ public:
+  SortedRowsCompactionInput(const vector<ConstContiguousRow>& rows,
+                            const Schema* schema,
+                            Timestamp insertion_timestamp)
+    : rows_(rows),
+      schema_(schema),
+      insertion_timestamp_(insertion_timestamp),
+      arena_(32*1024, 128*1024),
+      block_(*schema, kRowsPerBlock, nullptr),
+      next_row_(0) {
+  }
+
+  Status Init() override {
+    return Status::OK();
+  }
+
+  bool HasMoreBlocks() override {
+    return next_row_ < rows_.size();
+  }
+
+  Status PrepareBlock(vector<CompactionInputRow> *block) override {
+    int num_in_block = std::min<int>(kRowsPerBlock, rows_.size() - next_row_);
+    block->resize(num_in_block);
+
+    arena_.Reset();
+    RowChangeListEncoder undo_encoder(&buffer_);
+    for (int i = 0; i < num_in_block; i++) {
+      const ConstContiguousRow& src = rows_[next_row_ + i];
+      DCHECK_SCHEMA_EQ(*src.schema(), *schema_);
+      CompactionInputRow& input_row = block->at(i);
+      input_row.row.Reset(&block_, i);
+      RETURN_NOT_OK(CopyRow(src, &input_row.row, static_cast<Arena*>(nullptr)));
+      input_row.redo_head = nullptr;
+      input_row.previous_ghost = nullptr;
+
+      undo_encoder.SetToDelete();
+      input_row.undo_head = Mutation::CreateInArena(&arena_,
+                                                    insertion_timestamp_,
+                                                    undo_encoder.as_changelist());
+      undo_encoder.Reset();
+    }
+    next_row_ += num_in_block;
+    return Status::OK();
+  }
+
+  Arena* PreparedBlockArena() override { return &arena_; }
+
+  Status FinishBlock() override {
+    return Status::OK();
+  }
+
+  const Schema &schema() const override {
+    return *schema_;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(SortedRowsCompactionInput);
+
+  const vector<ConstContiguousRow>& rows_;
+  const Schema* schema_;
+  const Timestamp insertion_timestamp_;
+
+  // Arena used to store the undo mutations of the current block.
+  Arena arena_;
+  faststring buffer_;
+
+  RowBlock block_;
+  size_t next_row_;
+
+  enum {
+    kRowsPerBlock = 100
+  };
+};
+
+////////////////////////////////////////////////////////////
+
 // CompactionInput yielding rows and mutations from an on-disk DiskRowSet.
 class DiskRowSetCompactionInput : public CompactionInput {
  public:
+  // 'base_cfile_iter' is the iterator over the base data wrapped by
+  // 'base_iter', and is owned by it.
   DiskRowSetCompactionInput(gscoped_ptr<RowwiseIterator> base_iter,
+                            const CFileSet::Iterator* base_cfile_iter,
                             unique_ptr<DeltaIterator> redo_delta_iter,
                             unique_ptr<DeltaIterator> undo_delta_iter)
       : base_iter_(std::move(base_iter)),
+        base_cfile_iter_(base_cfile_iter),
         redo_delta_iter_(std::move(redo_delta_iter)),
         undo_delta_iter_(std::move(undo_delta_iter)),
         arena_(32 * 1024, 128 * 1024),
@@ -179,14 +271,23 @@ class DiskRowSetCompactionInput : public CompactionInput {
         undo_mutation_block_(kRowsPerBlock, static_cast<Mutation *>(nullptr)),
         first_rowid_in_block_(0) {}
 
+  Status SetKeyRange(const EncodedKey* lower_bound,
+                     const EncodedKey* exclusive_upper_bound) override {
+    spec_.SetLowerBoundKey(lower_bound);
+    spec_.SetExclusiveUpperBoundKey(exclusive_upper_bound);
+    return Status::OK();
+  }
+
   Status Init() override {
-    ScanSpec spec;
-    spec.set_cache_blocks(false);
-    RETURN_NOT_OK(base_iter_->Init(&spec));
-    RETURN_NOT_OK(redo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(0));
-    RETURN_NOT_OK(undo_delta_iter_->Init(&spec));
-    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(0));
+    spec_.set_cache_blocks(false);
+    RETURN_NOT_OK(base_iter_->Init(&spec_));
+    // With a key range, the base data doesn't start at the first row: line
+    // the deltas up with it.
+    first_rowid_in_block_ = base_cfile_iter_->cur_ordinal_idx();
+    RETURN_NOT_OK(redo_delta_iter_->Init(&spec_));
+    RETURN_NOT_OK(redo_delta_iter_->SeekToOrdinal(first_rowid_in_block_));
+    RETURN_NOT_OK(undo_delta_iter_->Init(&spec_));
+    RETURN_NOT_OK(undo_delta_iter_->SeekToOrdinal(first_rowid_in_block_));
     return Status::OK();
   }
 
@@ -234,9 +335,13 @@ class DiskRowSetCompactionInput : public CompactionInput {
  private:
   DISALLOW_COPY_AND_ASSIGN(DiskRowSetCompactionInput);
   gscoped_ptr<RowwiseIterator> base_iter_;
+  const CFileSet::Iterator* base_cfile_iter_;
   unique_ptr<DeltaIterator> redo_delta_iter_;
   unique_ptr<DeltaIterator> undo_delta_iter_;
 
+  // Holds the key range, if any, set by SetKeyRange().
+  ScanSpec spec_;
+
   Arena arena_;
 
   // The current block of data which has come from the input iterator
@@ -388,6 +493,7 @@ class MergeCompactionInput : public CompactionInput {
   MergeCompactionInput(const vector<shared_ptr<CompactionInput> > &inputs,
                        const Schema* schema)
     : schema_(schema),
+      comparator_(MakeMergeKeyComparator(*schema)),
       num_dup_rows_(0) {
     for (const shared_ptr<CompactionInput> &input : inputs) {
       gscoped_ptr<MergeState> state(new MergeState);
@@ -400,6 +506,14 @@ class MergeCompactionInput : public CompactionInput {
     STLDeleteElements(&states_);
   }
 
+  Status SetKeyRange(const EncodedKey* lower_bound,
+                     const EncodedKey* exclusive_upper_bound) override {
+    for (MergeState *state : states_) {
+      RETURN_NOT_OK(state->input->SetKeyRange(lower_bound, exclusive_upper_bound));
+    }
+    return Status::OK();
+  }
+
   Status Init() override {
     for (MergeState *state : states_) {
       RETURN_NOT_OK(state->input->Init());
@@ -453,7 +567,8 @@ class MergeCompactionInput : public CompactionInput {
           smallest = state->next();
           continue;
         }
-        int row_comp = schema_->Compare(state->next()->row, smallest->row);
+        int row_comp = comparator_ ? comparator_(state->next()->row, smallest->row)
+                                   : schema_->Compare(state->next()->row, smallest->row);
         if (row_comp < 0) {
           smallest_idx = i;
           smallest = state->next();
@@ -660,6 +775,8 @@ class MergeCompactionInput : public CompactionInput {
   }
 
   const Schema* schema_;
+  // If set, used instead of schema_->Compare() to order the merged rows.
+  const MergeIterator::RowComparator comparator_;
   vector<MergeState *> states_;
   Arena* prepared_block_arena_;
 
@@ -783,8 +900,44 @@ void SetHead(Mutation** current_head, Mutation* new_head) {
   *current_head = new_head;
 }
 
+// Returns the index of the TTL column of 'history_gc_opts' in 'schema', or
+// Schema::kColumnNotFound if the rows don't expire.
+int FindTtlColumn(const HistoryGcOpts& history_gc_opts, const Schema& schema) {
+  if (!history_gc_opts.row_expiration_enabled()) {
+    return Schema::kColumnNotFound;
+  }
+  return schema.find_column_by_id(history_gc_opts.ttl_col_id());
+}
+
+// Returns true if 'row' is expired by its value of the TTL column at index
+// 'ttl_col_idx', as found by FindTtlColumn().
+bool IsRowExpired(const HistoryGcOpts& history_gc_opts,
+                  int ttl_col_idx,
+                  const RowBlockRow& row) {
+  if (ttl_col_idx == Schema::kColumnNotFound) {
+    return false;
+  }
+  int64_t micros = *reinterpret_cast<const int64_t*>(row.cell_ptr(ttl_col_idx));
+  return history_gc_opts.IsExpired(micros);
+}
+
 } // anonymous namespace
 
+MergeIterator::RowComparator MakeMergeKeyComparator(const Schema& schema) {
+  if (!FLAGS_merge_use_codegen) {
+    return MergeIterator::RowComparator();
+  }
+  gscoped_ptr<codegen::KeyComparator> comparator;
+  if (!codegen::CompilationManager::GetSingleton()->RequestKeyComparator(
+          &schema, &comparator)) {
+    return MergeIterator::RowComparator();
+  }
+  shared_ptr<codegen::KeyComparator> shared_comparator(comparator.release());
+  return [shared_comparator](const RowBlockRow& lhs, const RowBlockRow& rhs) {
+    return shared_comparator->Compare(lhs, rhs);
+  };
+}
+
 string RowToString(const RowBlockRow& row, const Mutation* redo_head, const Mutation* undo_head) {
   return Substitute("RowIdxInBlock: $0; Base: $1; Undo Mutations: $2; Redo Mutations: $3;",
                     row.row_index(), row.schema()->DebugRow(row),
@@ -816,7 +969,8 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
                                gscoped_ptr<CompactionInput>* out) {
   CHECK(projection->has_column_ids());
 
-  shared_ptr<ColumnwiseIterator> base_cwise(rowset.base_data_->NewIterator(projection));
+  CFileSet::Iterator* base_cfile_iter = rowset.base_data_->NewIterator(projection);
+  shared_ptr<ColumnwiseIterator> base_cwise(base_cfile_iter);
   gscoped_ptr<RowwiseIterator> base_iter(new MaterializingIterator(base_cwise));
 
   // Creates a DeltaIteratorMerger that will only include the relevant REDO deltas.
@@ -831,6 +985,7 @@ Status CompactionInput::Create(const DiskRowSet &rowset,
       DeltaTracker::UNDOS_ONLY, &undo_deltas), "Could not open UNDOs");
 
   out->reset(new DiskRowSetCompactionInput(std::move(base_iter),
+                                           base_cfile_iter,
                                            std::move(redo_deltas),
                                            std::move(undo_deltas)));
   return Status::OK();
@@ -843,6 +998,13 @@ CompactionInput *CompactionInput::Create(const MemRowSet &memrowset,
   return new MemRowSetCompactionInput(memrowset, snap, projection);
 }
 
+CompactionInput *CompactionInput::CreateFromSortedRows(const vector<ConstContiguousRow>& rows,
+                                                       const Schema* schema,
+                                                       Timestamp insertion_timestamp) {
+  CHECK(schema->has_column_ids());
+  return new SortedRowsCompactionInput(rows, schema, insertion_timestamp);
+}
+
 CompactionInput *CompactionInput::Merge(const vector<shared_ptr<CompactionInput> > &inputs,
                                         const Schema* schema) {
   CHECK(schema->has_column_ids());
@@ -873,6 +1035,11 @@ Status RowSetsInCompaction::CreateCompactionInput(const MvccSnapshot &snap,
   return Status::OK();
 }
 
+Status RowSetsInCompaction::PickSplitKeys(int num_ranges,
+                                          vector<string>* split_keys) const {
+  return tablet::PickSplitKeys(rowsets_, num_ranges, "", "", split_keys);
+}
+
 void RowSetsInCompaction::DumpToLog() const {
   LOG(INFO) << "Selected " << rowsets_.size() << " rowsets to compact:";
   // Dump the selected rowsets to the log, and collect corresponding iterators.
@@ -1058,6 +1225,7 @@ Status FlushCompactionInput(CompactionInput* input,
   DCHECK(out->schema().has_column_ids());
 
   RowBlock block(out->schema(), 100, nullptr);
+  const int ttl_col_idx = FindTtlColumn(history_gc_opts, out->schema());
 
   while (input->HasMoreBlocks()) {
     RETURN_NOT_OK(input->PrepareBlock(&rows));
@@ -1108,6 +1276,13 @@ Status FlushCompactionInput(CompactionInput* input,
         continue;
       }
 
+      // Expired rows are dropped along with their history, exactly as if
+      // they had been garbage collected.
+      if (IsRowExpired(history_gc_opts, ttl_col_idx, dst_row)) {
+        DVLOG(4) << "Dropping expired row: " << dst_row.schema()->DebugRow(dst_row);
+        continue;
+      }
+
       rowid_t index_in_current_drs;
 
       if (new_undos_head != nullptr) {
@@ -1178,6 +1353,11 @@ Status ReupdateMissedDeltas(const string &tablet_name,
   RETURN_NOT_OK(key_projector.Init());
   faststring buf;
 
+  // To find which rows the first pass dropped as expired, the rows are
+  // rebuilt as of 'snap_to_exclude' in a scratch block.
+  const int ttl_col_idx = FindTtlColumn(history_gc_opts, *schema);
+  RowBlock expiration_block(*schema, 1, nullptr);
+
   rowid_t output_row_offset = 0;
   while (input->HasMoreBlocks()) {
     RETURN_NOT_OK(input->PrepareBlock(&rows));
@@ -1185,6 +1365,23 @@ Status ReupdateMissedDeltas(const string &tablet_name,
     for (const CompactionInputRow &row : rows) {
       DVLOG(4) << "Revisiting row: " << CompactionInputRowToString(row);
 
+      if (ttl_col_idx != Schema::kColumnNotFound) {
+        RowBlockRow dst_row = expiration_block.row(0);
+        RETURN_NOT_OK(CopyRow(row.row, &dst_row, static_cast<Arena*>(nullptr)));
+        Mutation* undo_head = nullptr;
+        Mutation* redo_head = nullptr;
+        RETURN_NOT_OK(ApplyMutationsAndGenerateUndos(snap_to_exclude, row, &undo_head, &redo_head,
+                                                     input->PreparedBlockArena(), &dst_row));
+        if (IsRowExpired(history_gc_opts, ttl_col_idx, dst_row)) {
+          // The first pass dropped the row: there is no output row to update
+          // nor to count in the output row offset. The updates which missed
+          // the first pass are lost with the row.
+          DVLOG(4) << "Skipping expired input row: " << schema->DebugRow(row.row)
+                   << " while reupdating missed deltas";
+          continue;
+        }
+      }
+
       bool is_garbage_collected = false;
       for (const Mutation *mut = row.redo_head;
            mut != nullptr;
@@ -60,10 +60,39 @@ class HistoryGcOpts {
     return ancient_history_mark_;
   }
 
+  // Returns a copy of these options which also expires the rows whose value
+  // of the TTL column 'ttl_col_id' is older than 'expiration_cutoff_micros'.
+  // Compactions drop the expired rows along with their history.
+  HistoryGcOpts WithRowExpiration(ColumnId ttl_col_id,
+                                  int64_t expiration_cutoff_micros) const {
+    return HistoryGcOpts(gc_enabled_, ancient_history_mark_,
+                         ttl_col_id, expiration_cutoff_micros);
+  }
+
+  // Returns true if the rows are expired by a TTL column.
+  bool row_expiration_enabled() const {
+    return ttl_col_id_ >= 0;
+  }
+
+  // Returns the ID of the TTL column, if row_expiration_enabled().
+  ColumnId ttl_col_id() const {
+    return ttl_col_id_;
+  }
+
+  // Returns true if a row whose value of the TTL column is 'micros' is
+  // expired. Always false if !row_expiration_enabled().
+  bool IsExpired(int64_t micros) const {
+    return row_expiration_enabled() && micros < expiration_cutoff_micros_;
+  }
+
  private:
-  HistoryGcOpts(bool gc_enabled, Timestamp ahm)
+  HistoryGcOpts(bool gc_enabled, Timestamp ahm,
+                ColumnId ttl_col_id = ColumnId(-1),
+                int64_t expiration_cutoff_micros = 0)
       : gc_enabled_(gc_enabled),
-        ancient_history_mark_(ahm) {
+        ancient_history_mark_(ahm),
+        ttl_col_id_(ttl_col_id),
+        expiration_cutoff_micros_(expiration_cutoff_micros) {
   }
 
   // Whether historical records prior to the ancient history mark should be
@@ -73,6 +102,13 @@ class HistoryGcOpts {
   // A timestamp prior to which no history will be preserved.
   // Ignored if 'enabled' != GC_ENABLED.
   const Timestamp ancient_history_mark_;
+
+  // The TTL column of the rows, or -1 if the rows don't expire.
+  const ColumnId ttl_col_id_;
+
+  // The time, in microseconds since the Unix epoch, before which the values
+  // of the TTL column are expired.
+  const int64_t expiration_cutoff_micros_;
 };
 
 // Interface for an input feeding into a compaction or flush.
@@ -98,11 +134,31 @@ class CompactionInput {
                                  const Schema* projection,
                                  const MvccSnapshot &snap);
 
+  // Create an input which yields the given rows, as if each had been inserted at
+  // 'insertion_timestamp' and never mutated since. The rows must be in 'schema',
+  // sorted by primary key with no duplicates, and must remain valid for the
+  // lifetime of the returned input. Used for bulk ingest.
+  static CompactionInput *CreateFromSortedRows(const vector<ConstContiguousRow>& rows,
+                                               const Schema* schema,
+                                               Timestamp insertion_timestamp);
+
   // Create an input which merges several other compaction inputs. The inputs are merged
   // in key-order according to the given schema. All inputs must have matching schemas.
   static CompactionInput *Merge(const vector<std::shared_ptr<CompactionInput> > &inputs,
                                 const Schema *schema);
 
+  // Restricts this input to the rows whose keys are at or after
+  // 'lower_bound' and before 'exclusive_upper_bound'. Either bound may be
+  // null, meaning the range is unbounded on that side. The keys must remain
+  // valid for the lifetime of the input.
+  //
+  // Must be called before Init(). Returns NotSupported if the input can't be
+  // restricted.
+  virtual Status SetKeyRange(const EncodedKey* lower_bound,
+                             const EncodedKey* exclusive_upper_bound) {
+    return Status::NotSupported("compaction input can't be restricted to a key range");
+  }
+
   virtual Status Init() = 0;
   virtual Status PrepareBlock(vector<CompactionInputRow> *block) = 0;
 
@@ -139,6 +195,13 @@ class RowSetsInCompaction {
                                const Schema* schema,
                                std::shared_ptr<CompactionInput> *out) const;
 
+  // Picks at most 'num_ranges' - 1 distinct encoded keys, in ascending order,
+  // which split the keys of the input rowsets in ranges holding roughly the
+  // same number of rows. The keys are sampled from the key indexes of the
+  // rowsets, which must all be DiskRowSets. Fewer keys, possibly none, are
+  // picked if the rowsets are too small to be split that many times.
+  Status PickSplitKeys(int num_ranges, vector<std::string>* split_keys) const;
+
   // Dump a log message indicating the chosen rowsets.
   void DumpToLog() const;
 
@@ -234,6 +297,13 @@ Status ReupdateMissedDeltas(const string &tablet_name,
 // This consumes all of the input in the compaction input.
 Status DebugDumpCompactionInput(CompactionInput *input, vector<string> *lines);
 
+// Returns a comparator over the key columns of 'schema' which is backed by a
+// code-generated function, for use when merging rows from several inputs.
+// Until that function has been compiled (the first request schedules it), or
+// if code generation is disabled, returns an empty comparator and callers
+// should fall back to Schema::Compare().
+MergeIterator::RowComparator MakeMergeKeyComparator(const Schema& schema);
+
 // Helper methods to print a row with full history.
 string RowToString(const RowBlockRow& row, const Mutation* redo_head, const Mutation* undo_head);
 string CompactionInputRowToString(const CompactionInputRow& input_row);
@@ -21,6 +21,7 @@
 #include <unordered_set>
 #include <string>
 
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -60,6 +61,45 @@ TEST(TestCompactionPolicy, TestBudgetedSelection) {
   ASSERT_GE(quality, 1.0);
 }
 
+// With one pair of rowsets fully overlapping in a cold key range and one
+// pair partially overlapping in a hot key range, and a budget for only one
+// pair, the budgeted policy picks the cold pair, which reduces the overlap
+// the most, while the access-weighted policy picks the hot pair.
+TEST(TestCompactionPolicy, TestAccessWeightedSelection) {
+  RowSetVector vec;
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "c")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("a", "c")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("x", "z")));
+  vec.push_back(shared_ptr<RowSet>(new MockDiskRowSet("y", "z")));
+
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+
+  // Write to the hot range, which looks up the rowsets covering it.
+  for (int i = 0; i < 100; i++) {
+    vector<RowSet*> rowsets;
+    tree.FindRowSetsWithKeyInRange("yy", &rowsets);
+    ASSERT_EQ(2, rowsets.size());
+  }
+  SleepFor(MonoDelta::FromMilliseconds(1));
+
+  const int kBudgetMb = 2;
+  unordered_set<RowSet*> picked;
+  double quality = 0;
+  BudgetedCompactionPolicy budgeted(kBudgetMb);
+  ASSERT_OK(budgeted.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_EQ(2, picked.size());
+  ASSERT_TRUE(ContainsKey(picked, vec[0].get()));
+  ASSERT_TRUE(ContainsKey(picked, vec[1].get()));
+
+  picked.clear();
+  AccessWeightedCompactionPolicy weighted(kBudgetMb);
+  ASSERT_OK(weighted.PickRowSets(tree, &picked, &quality, nullptr));
+  ASSERT_EQ(2, picked.size());
+  ASSERT_TRUE(ContainsKey(picked, vec[2].get()));
+  ASSERT_TRUE(ContainsKey(picked, vec[3].get()));
+}
+
 // Return the directory of the currently-running executable.
 static string GetExecutableDir() {
   string exec;
@@ -73,18 +113,8 @@ static RowSetVector LoadFile(const string& name) {
   faststring data;
   CHECK_OK_PREPEND(ReadFileToString(Env::Default(), path, &data),
                    strings::Substitute("Unable to load test data file $0", path));
-  vector<string> lines = strings::Split(data.ToString(), "\n");
-  for (const auto& line : lines) {
-    if (line.empty() || line[0] == '#') continue;
-    vector<string> fields = strings::Split(line, "\t");
-    CHECK_EQ(3, fields.size()) << "Expected 3 fields on line: " << line;
-    int size_mb = ParseLeadingInt32Value(fields[0], -1);
-    CHECK_GE(size_mb, 1) << "Expected size at least 1MB on line: " << line;
-    ret.emplace_back(new MockDiskRowSet(fields[1] /* min key */,
-                                        fields[2] /* max key */,
-                                        size_mb * 1024 * 1024));
-  }
-
+  CHECK_OK_PREPEND(ParseMockRowSetLayout(data.ToString(), &ret),
+                   strings::Substitute("Unable to parse test data file $0", path));
   return ret;
 }
 
@@ -32,6 +32,7 @@
 #include "kudu/tablet/svg_dump.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/knapsack_solver.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
@@ -49,6 +50,19 @@ DEFINE_double(compaction_approximation_ratio, 1.05f,
               "if it is known to be within 5% of the optimal solution.");
 TAG_FLAG(compaction_approximation_ratio, experimental);
 
+DEFINE_double(access_weighted_compaction_max_weight, 10,
+              "When the access-weighted compaction policy is used, the weight of the "
+              "data of the most accessed rowset of a tablet, relative to the data of a "
+              "rowset which is never accessed.");
+TAG_FLAG(access_weighted_compaction_max_weight, experimental);
+TAG_FLAG(access_weighted_compaction_max_weight, runtime);
+
+DEFINE_int32(access_weighted_compaction_half_life_sec, 300,
+             "When the access-weighted compaction policy is used, the half-life of the "
+             "access rates of rowsets, in seconds.");
+TAG_FLAG(access_weighted_compaction_half_life_sec, experimental);
+TAG_FLAG(access_weighted_compaction_half_life_sec, runtime);
+
 namespace kudu {
 namespace tablet {
 
@@ -89,7 +103,10 @@ uint64_t BudgetedCompactionPolicy::target_rowset_size() const {
 void BudgetedCompactionPolicy::SetupKnapsackInput(const RowSetTree &tree,
                                                   vector<RowSetInfo>* min_key,
                                                   vector<RowSetInfo>* max_key) {
-  RowSetInfo::CollectOrdered(tree, min_key, max_key);
+  std::unordered_map<RowSet*, double> weights;
+  ComputeWeights(tree, &weights);
+  RowSetInfo::CollectOrdered(tree, min_key, max_key,
+                             weights.empty() ? nullptr : &weights);
 
   if (min_key->size() < 2) {
     // require at least 2 rowsets to compact
@@ -447,5 +464,34 @@ Status BudgetedCompactionPolicy::PickRowSets(const RowSetTree &tree,
   return Status::OK();
 }
 
+////////////////////////////////////////////////////////////
+// AccessWeightedCompactionPolicy
+////////////////////////////////////////////////////////////
+
+AccessWeightedCompactionPolicy::AccessWeightedCompactionPolicy(int size_budget_mb)
+    : BudgetedCompactionPolicy(size_budget_mb) {
+}
+
+void AccessWeightedCompactionPolicy::ComputeWeights(
+    const RowSetTree& tree, std::unordered_map<RowSet*, double>* weights) {
+  MonoTime now = MonoTime::Now();
+  MonoDelta half_life = MonoDelta::FromSeconds(
+      std::max(FLAGS_access_weighted_compaction_half_life_sec, 1));
+  std::unordered_map<RowSet*, double> rates;
+  double max_rate = 0;
+  for (const auto& rs : tree.all_rowsets()) {
+    double rate = rs->access_stats()->RecentRate(now, half_life);
+    rates[rs.get()] = rate;
+    max_rate = std::max(rate, max_rate);
+  }
+  if (max_rate <= 0) {
+    return;
+  }
+  double max_boost = std::max(FLAGS_access_weighted_compaction_max_weight, 1.0) - 1;
+  for (const auto& rs_rate : rates) {
+    (*weights)[rs_rate.first] = 1 + max_boost * rs_rate.second / max_rate;
+  }
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -18,6 +18,7 @@
 #define KUDU_TABLET_COMPACTION_POLICY_H
 
 #include <string>
+#include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
@@ -85,6 +86,16 @@ class BudgetedCompactionPolicy : public CompactionPolicy {
 
   virtual uint64_t target_rowset_size() const OVERRIDE;
 
+ protected:
+  // Sets the weights of the rowsets of 'tree' in the cdf along which the
+  // value of a compaction is measured (see RowSetInfo::CollectOrdered()).
+  // Compacting a key range whose data weighs twice as much is worth twice
+  // as much. Rowsets left out of 'weights' weigh 1.
+  //
+  // By default, all rowsets weigh the same.
+  virtual void ComputeWeights(const RowSetTree& tree,
+                              std::unordered_map<RowSet*, double>* weights) {}
+
  private:
   struct SolutionAndValue {
     std::unordered_set<RowSet*> rowsets;
@@ -126,6 +137,25 @@ class BudgetedCompactionPolicy : public CompactionPolicy {
   size_t size_budget_mb_;
 };
 
+// Budgeted compaction policy which weighs rowsets by how often they are
+// accessed, so that compactions of the key ranges which are written and
+// scanned the most are preferred. For example, in an append-mostly
+// time-series table, this favors compacting the newest key range over old
+// ranges which are still overlapping but no longer accessed.
+//
+// The accesses are those recorded by the RowSetTree in each rowset's
+// RowSetAccessStats. The hottest rowset weighs
+// --access_weighted_compaction_max_weight, and the others proportionally
+// less, down to 1 for rowsets which are never accessed.
+class AccessWeightedCompactionPolicy : public BudgetedCompactionPolicy {
+ public:
+  explicit AccessWeightedCompactionPolicy(int size_budget_mb);
+
+ protected:
+  virtual void ComputeWeights(const RowSetTree& tree,
+                              std::unordered_map<RowSet*, double>* weights) OVERRIDE;
+};
+
 } // namespace tablet
 } // namespace kudu
 #endif
@@ -49,6 +49,7 @@
 #include <memory>
 #include <string>
 
+#include "kudu/gutil/endian.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/gutil/port.h"
@@ -304,11 +305,38 @@ class ValueSlice {
   const uint8_t* ptr_;
 } PACKED;
 
+// Return the first 8 bytes of 'key' as a big-endian integer, padded with
+// zeros if the key is shorter.
+//
+// If KeyPrefix(a) < KeyPrefix(b) then a < b, so the nodes keep the prefix of
+// each key beside the key's pointer and only need to follow the pointer to
+// compare the full keys when the prefixes are equal.
+inline uint64_t KeyPrefix(const Slice& key) {
+  if (PREDICT_TRUE(key.size() >= sizeof(uint64_t))) {
+    return BigEndian::Load64(key.data());
+  }
+  uint8_t buf[sizeof(uint64_t)] = { 0 };
+  memcpy(buf, key.data(), key.size());
+  return BigEndian::Load64(buf);
+}
+
+// Compare the key stored in 'slice', whose prefix is 'prefix', to 'key', whose
+// prefix is 'key_prefix'.
+template<size_t N>
+inline int ComparePrefixedKey(const InlineSlice<N, true>& slice, uint64_t prefix,
+                              const Slice& key, uint64_t key_prefix) {
+  if (prefix != key_prefix) {
+    return prefix < key_prefix ? -1 : 1;
+  }
+  return slice.as_slice().compare(key);
+}
+
 // Return the index of the first entry in the array which is
-// >= the given value
+// >= the given value. 'prefixes' holds the KeyPrefix() of each
+// entry of 'array'.
 template<size_t N>
-size_t FindInSliceArray(const InlineSlice<N, true> *array, ssize_t num_entries,
-                        const Slice &key, bool *exact) {
+size_t FindInSliceArray(const InlineSlice<N, true> *array, const uint64_t* prefixes,
+                        ssize_t num_entries, const Slice &key, bool *exact) {
   DCHECK_GE(num_entries, 0);
 
   if (PREDICT_FALSE(num_entries == 0)) {
@@ -318,12 +346,11 @@ size_t FindInSliceArray(const InlineSlice<N, true> *array, ssize_t num_entries,
 
   size_t left = 0;
   size_t right = num_entries - 1;
+  const uint64_t key_prefix = KeyPrefix(key);
 
   while (left < right) {
     int mid = (left + right + 1) / 2;
-    // TODO: inline slices with more than 8 bytes will store a prefix of the
-    // slice inline, which we could use to short circuit some of these comparisons.
-    int compare = array[mid].as_slice().compare(key);
+    int compare = ComparePrefixedKey(array[mid], prefixes[mid], key, key_prefix);
     if (compare < 0) { // mid < key
       left = mid;
     } else if (compare > 0) { // mid > search
@@ -334,7 +361,7 @@ size_t FindInSliceArray(const InlineSlice<N, true> *array, ssize_t num_entries,
     }
   }
 
-  int compare = array[left].as_slice().compare(key);
+  int compare = ComparePrefixedKey(array[left], prefixes[left], key, key_prefix);
   *exact = compare == 0;
   if (compare < 0) { // key > left
     left++;
@@ -354,6 +381,18 @@ static void InsertInSliceArray(ISlice *array, size_t num_entries,
   array[idx].set(src, arena);
 }
 
+// Like InsertInSliceArray(), for an array of keys and the parallel array of
+// their prefixes.
+template<class ISlice, class ArenaType>
+static void InsertInKeyArray(ISlice *keys, uint64_t* prefixes, size_t num_entries,
+                             const Slice &src, size_t idx, ArenaType *arena) {
+  InsertInSliceArray(keys, num_entries, src, idx, arena);
+  for (size_t i = num_entries - 1; i > idx; i--) {
+    prefixes[i] = prefixes[i - 1];
+  }
+  prefixes[idx] = KeyPrefix(src);
+}
+
 
 template<class Traits>
 class NodeBase {
@@ -528,6 +567,7 @@ class PACKED InternalNode : public NodeBase<Traits> {
     VersionField::SetLockedInsertingNoBarrier(&this->version_);
 
     keys_[0].set(split_key, arena);
+    key_prefixes_[0] = KeyPrefix(split_key);
     DCHECK_GT(split_key.size(), 0);
     child_pointers_[0] = lchild;
     child_pointers_[1] = rchild;
@@ -562,7 +602,7 @@ class PACKED InternalNode : public NodeBase<Traits> {
 
     // Insert the key and child pointer in the right spot in the list
     int new_num_children = num_children_ + 1;
-    InsertInSliceArray(keys_, new_num_children, key, idx, arena);
+    InsertInKeyArray(keys_, key_prefixes_, new_num_children, key, idx, arena);
     for (int i = new_num_children - 1; i > idx + 1; i--) {
       child_pointers_[i] = child_pointers_[i - 1];
     }
@@ -580,7 +620,7 @@ class PACKED InternalNode : public NodeBase<Traits> {
   // For example, if the key is less than the first discriminating
   // node, returns 0. If it is between 0 and 1, returns 1, etc.
   size_t Find(const Slice &key, bool *exact) {
-    return FindInSliceArray(keys_, key_count(), key, exact);
+    return FindInSliceArray(keys_, key_prefixes_, key_count(), key, exact);
   }
 
   // Find the child whose subtree may contain the given key.
@@ -657,12 +697,16 @@ class PACKED InternalNode : public NodeBase<Traits> {
     constant_overhead = sizeof(NodeBase<Traits>) // base class
                       + sizeof(uint32_t), // num_children_
     keyptr_space = Traits::internal_node_size - constant_overhead,
-    kFanout = keyptr_space / (sizeof(KeyInlineSlice) + sizeof(NodePtr<Traits>))
+    kFanout = keyptr_space / (sizeof(KeyInlineSlice) + sizeof(uint64_t) +
+                              sizeof(NodePtr<Traits>))
   };
 
   // This ordering of members ensures KeyInlineSlices are properly aligned
   // for atomic ops
   KeyInlineSlice keys_[kFanout];
+  // The KeyPrefix() of each of keys_, kept apart from them so that a search
+  // through the node touches few cache lines.
+  uint64_t key_prefixes_[kFanout];
   NodePtr<Traits> child_pointers_[kFanout];
   uint32_t num_children_;
 } PACKED;
@@ -723,7 +767,7 @@ class LeafNode : public NodeBase<Traits> {
     // The following inserts should always succeed because we
     // verified that there is space available above.
     num_entries_++;
-    InsertInSliceArray(keys_, num_entries_, key, idx, arena);
+    InsertInKeyArray(keys_, key_prefixes_, num_entries_, key, idx, arena);
     DebugRacyPoint<Traits>();
     InsertInSliceArray(vals_, num_entries_, val, idx, arena);
 
@@ -739,7 +783,7 @@ class LeafNode : public NodeBase<Traits> {
   // Note that, if the lock is not held, this may return
   // bogus results, in which case OCC must be used to verify.
   size_t Find(const Slice &key, bool *exact) const {
-    return FindInSliceArray(keys_, num_entries_, key, exact);
+    return FindInSliceArray(keys_, key_prefixes_, num_entries_, key, exact);
   }
 
   // Get the slice corresponding to the nth key.
@@ -810,12 +854,14 @@ class LeafNode : public NodeBase<Traits> {
                         + sizeof(LeafNode<Traits>*) // next_
                         + sizeof(uint8_t), // num_entries_
     kv_space = Traits::leaf_node_size - constant_overhead,
-    kMaxEntries = kv_space / (sizeof(KeyInlineSlice) + sizeof(ValueSlice))
+    kMaxEntries = kv_space / (sizeof(KeyInlineSlice) + sizeof(uint64_t) + sizeof(ValueSlice))
   };
 
   // This ordering of members keeps KeyInlineSlices so pointers are aligned
   LeafNode<Traits>* next_;
   KeyInlineSlice keys_[kMaxEntries];
+  // The KeyPrefix() of each of keys_. See InternalNode::key_prefixes_.
+  uint64_t key_prefixes_[kMaxEntries];
   ValueSlice vals_[kMaxEntries];
   uint8_t num_entries_;
 } PACKED;
@@ -1447,6 +1493,8 @@ class CBTree {
 
     std::copy(node->keys_ + copy_start, node->keys_ + node->num_entries(),
               new_leaf->keys_);
+    std::copy(node->key_prefixes_ + copy_start, node->key_prefixes_ + node->num_entries(),
+              new_leaf->key_prefixes_);
     std::copy(node->vals_ + copy_start, node->vals_ + node->num_entries(),
               new_leaf->vals_);
     new_leaf->num_entries_ = node->num_entries() - copy_start;
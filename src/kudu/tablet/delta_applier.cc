@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/delta_applier.h"
 
+#include <set>
 #include <string>
 #include <vector>
 
@@ -37,14 +38,24 @@ DeltaApplier::DeltaApplier(shared_ptr<CFileSet::Iterator> base_iter,
                            unique_ptr<DeltaIterator> delta_iter)
     : base_iter_(std::move(base_iter)),
       delta_iter_(std::move(delta_iter)),
-      first_prepare_(true) {}
+      first_prepare_(true),
+      next_delta_idx_(0) {}
 
 DeltaApplier::~DeltaApplier() {
 }
 
 Status DeltaApplier::Init(ScanSpec *spec) {
-  RETURN_NOT_OK(base_iter_->Init(spec));
   RETURN_NOT_OK(delta_iter_->Init(spec));
+
+  // The value bloom filters and secondary indexes of the base data don't
+  // reflect updates.
+  std::set<ColumnId> updated_col_ids;
+  bool all_columns_updated = false;
+  RETURN_NOT_OK(delta_iter_->CollectColumnIdsWithUpdates(&updated_col_ids,
+                                                         &all_columns_updated));
+  base_iter_->DisableValueLookupsForColumns(std::move(updated_col_ids), all_columns_updated);
+
+  RETURN_NOT_OK(base_iter_->Init(spec));
   return Status::OK();
 }
 
@@ -75,12 +86,18 @@ Status DeltaApplier::PrepareBatch(size_t *nrows) {
   // The initial seek is deferred from Init() into the first PrepareBatch()
   // because it requires a loaded delta file, and we don't want to require
   // that at Init() time.
-  if (first_prepare_) {
-    RETURN_NOT_OK(delta_iter_->SeekToOrdinal(base_iter_->cur_ordinal_idx()));
+  //
+  // The base iterator may also skip rows between batches (see
+  // CFileSet::Iterator::PushdownKeyInListPredicate()), in which case the
+  // delta iterator seeks along.
+  rowid_t cur_idx = base_iter_->cur_ordinal_idx();
+  if (first_prepare_ || cur_idx != next_delta_idx_) {
+    RETURN_NOT_OK(delta_iter_->SeekToOrdinal(cur_idx));
     first_prepare_ = false;
   }
   RETURN_NOT_OK(base_iter_->PrepareBatch(nrows));
   RETURN_NOT_OK(delta_iter_->PrepareBatch(*nrows, DeltaIterator::PREPARE_FOR_APPLY));
+  next_delta_idx_ = cur_idx + *nrows;
   return Status::OK();
 }
 
@@ -99,8 +116,16 @@ Status DeltaApplier::MaterializeColumn(ColumnMaterializationContext *ctx) {
   // Data with updates cannot be evaluated at the decoder-level.
   if (delta_iter_->MayHaveDeltas()) {
     ctx->SetDecoderEvalNotSupported();
+    // The updates are applied in place, so the base data must be copied.
+    ctx->set_zero_copy_allowed(false);
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
-    RETURN_NOT_OK(delta_iter_->ApplyUpdates(ctx->col_idx(), ctx->block()));
+    if (ctx->skip_deselected_allowed()) {
+      RETURN_NOT_OK(delta_iter_->ApplyUpdates(ctx->col_idx(), ctx->block(), *ctx->sel()));
+    } else {
+      SelectionVector all_rows(ctx->block()->nrows());
+      all_rows.SetAllTrue();
+      RETURN_NOT_OK(delta_iter_->ApplyUpdates(ctx->col_idx(), ctx->block(), all_rows));
+    }
   } else {
     RETURN_NOT_OK(base_iter_->MaterializeColumn(ctx));
   }
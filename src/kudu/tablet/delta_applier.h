@@ -78,6 +78,9 @@ class DeltaApplier : public ColumnwiseIterator {
   std::unique_ptr<DeltaIterator> delta_iter_;
 
   bool first_prepare_;
+
+  // The row index the delta iterator is positioned at after the last batch.
+  rowid_t next_delta_idx_;
 };
 
 } // namespace tablet
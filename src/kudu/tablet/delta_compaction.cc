@@ -18,6 +18,7 @@
 #include "kudu/tablet/delta_compaction.h"
 
 #include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
@@ -62,16 +63,22 @@ MajorDeltaCompaction::MajorDeltaCompaction(
     unique_ptr<DeltaIterator> delta_iter,
     vector<shared_ptr<DeltaStore> > included_stores,
     vector<ColumnId> col_ids,
-    HistoryGcOpts history_gc_opts)
+    HistoryGcOpts history_gc_opts,
+    Mode mode,
+    fs::CreateBlockOptions block_opts)
     : fs_manager_(fs_manager),
       base_schema_(base_schema),
       column_ids_(std::move(col_ids)),
       history_gc_opts_(std::move(history_gc_opts)),
+      mode_(mode),
+      block_opts_(block_opts),
       base_data_(base_data),
       included_stores_(std::move(included_stores)),
       delta_iter_(std::move(delta_iter)),
       redo_delta_mutations_written_(0),
       undo_delta_mutations_written_(0),
+      redo_delta_mutations_read_(0),
+      redo_delta_mutations_merged_(0),
       state_(kInitialized) {
   CHECK(!column_ids_.empty());
 }
@@ -218,11 +225,13 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas() {
   if (redo_delta_mutations_written_ > 0) {
     new_redo_delta_writer_->WriteDeltaStats(redo_stats);
     RETURN_NOT_OK(new_redo_delta_writer_->Finish());
+    new_redo_delta_summary_ = { redo_stats.max_timestamp(), redo_stats.delete_count() };
   }
 
   if (undo_delta_mutations_written_ > 0) {
     new_undo_delta_writer_->WriteDeltaStats(undo_stats);
     RETURN_NOT_OK(new_undo_delta_writer_->Finish());
+    new_undo_delta_max_timestamp_ = undo_stats.max_timestamp();
   }
 
   DVLOG(1) << "Applied all outstanding deltas for columns "
@@ -237,10 +246,121 @@ Status MajorDeltaCompaction::FlushRowSetAndDeltas() {
   return Status::OK();
 }
 
+Status MajorDeltaCompaction::RewriteRedoDeltas() {
+  CHECK_EQ(state_, kInitialized);
+
+  rowid_t num_rows;
+  RETURN_NOT_OK(base_data_->CountRows(&num_rows));
+
+  ScanSpec spec;
+  spec.set_cache_blocks(false);
+  RETURN_NOT_OK(delta_iter_->Init(&spec));
+  RETURN_NOT_OK(delta_iter_->SeekToOrdinal(0));
+
+  DVLOG(1) << "Rewriting REDO deltas without touching the base data";
+  Arena arena(32 * 1024, 128 * 1024);
+  DeltaStats redo_stats;
+  vector<Mutation*> redo_mutation_block;
+  for (rowid_t start = 0; start < num_rows; start += kRowsPerBlock) {
+    size_t n = std::min<size_t>(kRowsPerBlock, num_rows - start);
+    arena.Reset();
+    redo_mutation_block.assign(n, nullptr);
+    RETURN_NOT_OK(delta_iter_->PrepareBatch(n, DeltaIterator::PREPARE_FOR_COLLECT));
+    RETURN_NOT_OK(delta_iter_->CollectMutations(&redo_mutation_block, &arena));
+    for (size_t i = 0; i < n; i++) {
+      Mutation* head = redo_mutation_block[i];
+      if (head == nullptr) continue;
+      Mutation::ReverseMutationList(&head);
+      RETURN_NOT_OK(AppendMergedRedos(start + i, head, &redo_stats));
+    }
+  }
+
+  if (redo_delta_mutations_written_ > 0) {
+    new_redo_delta_writer_->WriteDeltaStats(redo_stats);
+    RETURN_NOT_OK(new_redo_delta_writer_->Finish());
+    new_redo_delta_summary_ = { redo_stats.max_timestamp(), redo_stats.delete_count() };
+  }
+
+  DVLOG(1) << "Rewrote " << redo_delta_mutations_read_ << " REDO delta mutations into "
+           << redo_delta_mutations_written_ << ", merging away "
+           << redo_delta_mutations_merged_ << " ancient updates";
+
+  state_ = kFinished;
+  return Status::OK();
+}
+
+Status MajorDeltaCompaction::AppendMergedRedos(rowid_t row_id,
+                                               const Mutation* head,
+                                               DeltaStats* stats) {
+  // The updates are merged by keeping, for each column, the value of the
+  // last one. A DELETE or a REINSERT ends the merged prefix, since the
+  // updates before it don't survive it.
+  std::map<ColumnId, RowChangeListDecoder::DecodedUpdate> merged;
+  const Mutation* last_merged = nullptr;
+  int num_merged = 0;
+  const Mutation* mut = head;
+  for (; mut != nullptr; mut = mut->next()) {
+    RowChangeList changelist = mut->changelist();
+    if (!history_gc_opts_.IsAncientHistory(mut->timestamp()) ||
+        changelist.is_delete() || changelist.is_reinsert()) {
+      break;
+    }
+    RowChangeListDecoder decoder(changelist);
+    RETURN_NOT_OK(decoder.Init());
+    while (decoder.HasNext()) {
+      RowChangeListDecoder::DecodedUpdate update;
+      RETURN_NOT_OK(decoder.DecodeNext(&update));
+      merged[update.col_id] = update;
+    }
+    last_merged = mut;
+    num_merged++;
+  }
+
+  if (!new_redo_delta_writer_) {
+    RETURN_NOT_OK(OpenRedoDeltaFileWriter());
+  }
+
+  auto append = [&](Timestamp timestamp, const RowChangeList& update) -> Status {
+    DeltaKey key(row_id, timestamp);
+    RETURN_NOT_OK_PREPEND(new_redo_delta_writer_->AppendDelta<REDO>(key, update),
+                          "Failed to append a delta");
+    WARN_NOT_OK(stats->UpdateStats(timestamp, update), "Failed to update stats");
+    redo_delta_mutations_written_++;
+    return Status::OK();
+  };
+
+  redo_delta_mutations_read_ += num_merged;
+  if (num_merged == 1) {
+    RETURN_NOT_OK(append(last_merged->timestamp(), last_merged->changelist()));
+  } else if (num_merged > 1) {
+    faststring buf;
+    RowChangeListEncoder encoder(&buf);
+    for (const auto& col_and_update : merged) {
+      int col_idx;
+      const void* value;
+      RETURN_NOT_OK(col_and_update.second.Validate(base_schema_, &col_idx, &value));
+      // Updates of dropped columns are never read again.
+      if (col_idx == Schema::kColumnNotFound) continue;
+      encoder.AddColumnUpdate(base_schema_.column(col_idx), col_and_update.first, value);
+    }
+    if (!encoder.is_empty()) {
+      RETURN_NOT_OK(append(last_merged->timestamp(), encoder.as_changelist()));
+    }
+    redo_delta_mutations_merged_ += num_merged - 1;
+  }
+
+  for (; mut != nullptr; mut = mut->next()) {
+    redo_delta_mutations_read_++;
+    RETURN_NOT_OK(append(mut->timestamp(), mut->changelist()));
+  }
+  return Status::OK();
+}
+
 Status MajorDeltaCompaction::OpenBaseDataWriter() {
   CHECK(!base_data_writer_);
 
-  gscoped_ptr<MultiColumnWriter> w(new MultiColumnWriter(fs_manager_, &partial_schema_));
+  gscoped_ptr<MultiColumnWriter> w(new MultiColumnWriter(fs_manager_, &partial_schema_,
+                                                          false, nullptr, block_opts_));
   RETURN_NOT_OK(w->Open());
   base_data_writer_.swap(w);
   return Status::OK();
@@ -248,7 +368,7 @@ Status MajorDeltaCompaction::OpenBaseDataWriter() {
 
 Status MajorDeltaCompaction::OpenRedoDeltaFileWriter() {
   gscoped_ptr<WritableBlock> block;
-  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(block_opts_, &block),
                         "Unable to create REDO delta output block");
   new_redo_delta_block_ = block->id();
   new_redo_delta_writer_.reset(new DeltaFileWriter(std::move(block)));
@@ -257,7 +377,7 @@ Status MajorDeltaCompaction::OpenRedoDeltaFileWriter() {
 
 Status MajorDeltaCompaction::OpenUndoDeltaFileWriter() {
   gscoped_ptr<WritableBlock> block;
-  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs_manager_->CreateNewBlock(block_opts_, &block),
                         "Unable to create UNDO delta output block");
   new_undo_delta_block_ = block->id();
   new_undo_delta_writer_.reset(new DeltaFileWriter(std::move(block)));
@@ -274,6 +394,14 @@ Status MajorDeltaCompaction::Compact() {
     LOG(INFO) << "Preparing to major compact delta file: " << ds->ToString();
   }
 
+  if (mode_ == REWRITE_DELTAS_ONLY) {
+    RETURN_NOT_OK(RewriteRedoDeltas());
+    LOG(INFO) << "Finished major delta compaction of REDO deltas only, merging away "
+              << redo_delta_mutations_merged_ << " of " << redo_delta_mutations_read_
+              << " mutations";
+    return Status::OK();
+  }
+
   // We defer calling OpenRedoDeltaFileWriter() since we might not need to flush.
   RETURN_NOT_OK(OpenBaseDataWriter());
   RETURN_NOT_OK(FlushRowSetAndDeltas());
@@ -296,13 +424,19 @@ Status MajorDeltaCompaction::CreateMetadataUpdate(
   vector<BlockId> new_delta_blocks;
   if (redo_delta_mutations_written_ > 0) {
     new_delta_blocks.push_back(new_redo_delta_block_);
+    update->SetRedoBlockSummary(new_redo_delta_block_, new_redo_delta_summary_);
   }
 
   update->ReplaceRedoDeltaBlocks(compacted_delta_blocks,
                                  new_delta_blocks);
 
+  if (mode_ == REWRITE_DELTAS_ONLY) {
+    // The base data is unchanged.
+    return Status::OK();
+  }
+
   if (undo_delta_mutations_written_ > 0) {
-    update->SetNewUndoBlock(new_undo_delta_block_);
+    update->SetNewUndoBlock(new_undo_delta_block_, new_undo_delta_max_timestamp_);
   }
 
   // Replace old column blocks with new ones
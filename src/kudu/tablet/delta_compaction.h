@@ -40,12 +40,25 @@ class MultiColumnWriter;
 // of a DiskRowSet, writing out an updated DiskRowSet without re-writing the
 // unchanged columns (see RowSetColumnUpdater), and writing out a new
 // deltafile which does not contain the deltas applied to the specific rows.
+//
+// When the deltas only touch a small part of a large DiskRowSet, rewriting
+// whole columns costs much more IO than the deltas themselves. In the
+// REWRITE_DELTAS_ONLY mode, the base data is left alone, and the REDO
+// deltas are instead rewritten into a single deltafile in which the
+// ancient history updates of each row are merged into one. Scans then apply
+// at most one ancient update per row instead of its whole update chain.
 class MajorDeltaCompaction {
  public:
+  enum Mode {
+    REWRITE_BASE_DATA,
+    REWRITE_DELTAS_ONLY
+  };
+
   // Creates a new major delta compaction. The given 'base_data' should already
   // be open and must remain valid for the lifetime of this object.
   // 'delta_iter' must not be initialized.
   // 'col_ids' determines which columns of 'base_schema' should be compacted.
+  // The output blocks are created with 'block_opts'.
   //
   // TODO: is base_schema supposed to be the same as base_data->schema()? how about
   // in an ALTER scenario?
@@ -54,9 +67,13 @@ class MajorDeltaCompaction {
       std::unique_ptr<DeltaIterator> delta_iter,
       std::vector<std::shared_ptr<DeltaStore> > included_stores,
       std::vector<ColumnId> col_ids,
-      HistoryGcOpts history_gc_opts);
+      HistoryGcOpts history_gc_opts,
+      Mode mode = REWRITE_BASE_DATA,
+      fs::CreateBlockOptions block_opts = fs::CreateBlockOptions());
   ~MajorDeltaCompaction();
 
+  Mode mode() const { return mode_; }
+
   // Executes the compaction.
   // This has no effect on the metadata of the tablet, etc.
   Status Compact();
@@ -70,6 +87,11 @@ class MajorDeltaCompaction {
   // Apply the changes to the given delta tracker.
   Status UpdateDeltaTracker(DeltaTracker* tracker);
 
+  // The number of REDO mutations read, and of those merged away by a
+  // REWRITE_DELTAS_ONLY compaction.
+  size_t redo_delta_mutations_read() const { return redo_delta_mutations_read_; }
+  size_t redo_delta_mutations_merged() const { return redo_delta_mutations_merged_; }
+
  private:
   std::string ColumnNamesToString() const;
 
@@ -89,6 +111,16 @@ class MajorDeltaCompaction {
   // deltas need to be written back into a delta file.
   Status FlushRowSetAndDeltas();
 
+  // Reads all the REDO deltas and writes them back into a single delta file,
+  // merging the ancient history updates of each row. Used instead of
+  // FlushRowSetAndDeltas() in the REWRITE_DELTAS_ONLY mode.
+  Status RewriteRedoDeltas();
+
+  // Appends the REDO mutations of 'row_id', listed in ascending timestamp
+  // order from 'head', to the new REDO delta file, merging its leading
+  // ancient history updates into one.
+  Status AppendMergedRedos(rowid_t row_id, const Mutation* head, DeltaStats* stats);
+
   FsManager* const fs_manager_;
 
   // TODO: doc me
@@ -103,6 +135,10 @@ class MajorDeltaCompaction {
 
   const HistoryGcOpts history_gc_opts_;
 
+  const Mode mode_;
+
+  const fs::CreateBlockOptions block_opts_;
+
   // Inputs:
   //-----------------
 
@@ -123,9 +159,14 @@ class MajorDeltaCompaction {
 
   gscoped_ptr<DeltaFileWriter> new_undo_delta_writer_;
   BlockId new_undo_delta_block_;
+  // The maximum timestamp of the deltas written to 'new_undo_delta_block_'.
+  Timestamp new_undo_delta_max_timestamp_;
+  RowSetMetadata::RedoDeltaSummary new_redo_delta_summary_;
 
   size_t redo_delta_mutations_written_;
   size_t undo_delta_mutations_written_;
+  size_t redo_delta_mutations_read_;
+  size_t redo_delta_mutations_merged_;
 
   enum State {
     kInitialized = 1,
@@ -58,9 +58,10 @@ Status DeltaIteratorMerger::PrepareBatch(size_t nrows, PrepareFlag flag) {
   return Status::OK();
 }
 
-Status DeltaIteratorMerger::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
+Status DeltaIteratorMerger::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                                         const SelectionVector& filter) {
   for (const unique_ptr<DeltaIterator> &iter : iters_) {
-    RETURN_NOT_OK(iter->ApplyUpdates(col_to_apply, dst));
+    RETURN_NOT_OK(iter->ApplyUpdates(col_to_apply, dst, filter));
   }
   return Status::OK();
 }
@@ -120,6 +121,14 @@ bool DeltaIteratorMerger::MayHaveDeltas() {
   return false;
 }
 
+Status DeltaIteratorMerger::CollectColumnIdsWithUpdates(std::set<ColumnId>* col_ids,
+                                                        bool* all_columns) {
+  for (const unique_ptr<DeltaIterator>& iter : iters_) {
+    RETURN_NOT_OK(iter->CollectColumnIdsWithUpdates(col_ids, all_columns));
+  }
+  return Status::OK();
+}
+
 string DeltaIteratorMerger::ToString() const {
   string ret;
   ret.append("DeltaIteratorMerger(");
@@ -50,7 +50,8 @@ class DeltaIteratorMerger : public DeltaIterator {
   virtual Status Init(ScanSpec *spec) OVERRIDE;
   virtual Status SeekToOrdinal(rowid_t idx) OVERRIDE;
   virtual Status PrepareBatch(size_t nrows, PrepareFlag flag) OVERRIDE;
-  virtual Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) OVERRIDE;
+  virtual Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                              const SelectionVector& filter) OVERRIDE;
   virtual Status ApplyDeletes(SelectionVector *sel_vec) OVERRIDE;
   virtual Status CollectMutations(vector<Mutation *> *dst, Arena *arena) OVERRIDE;
   virtual Status FilterColumnIdsAndCollectDeltas(const std::vector<ColumnId>& col_ids,
@@ -58,6 +59,8 @@ class DeltaIteratorMerger : public DeltaIterator {
                                                  Arena* arena) OVERRIDE;
   virtual bool HasNext() OVERRIDE;
   bool MayHaveDeltas() override;
+
+  Status CollectColumnIdsWithUpdates(std::set<ColumnId>* col_ids, bool* all_columns) override;
   virtual std::string ToString() const OVERRIDE;
 
  private:
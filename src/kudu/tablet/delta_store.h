@@ -18,6 +18,7 @@
 #define KUDU_TABLET_DELTA_STORE_H
 
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -97,10 +98,10 @@ typedef std::vector<std::shared_ptr<DeltaStore> > SharedDeltaStoreVector;
 //     clear row block
 //     CHECK_OK(iter->PrepareBatch(rowblock.size()));
 //     ... read column 0 from base data into row block ...
-//     CHECK_OK(iter->ApplyUpdates(0, rowblock.column(0))
+//     CHECK_OK(iter->ApplyUpdates(0, rowblock.column(0), *rowblock.selection_vector())
 //     ... check predicates for column ...
 //     ... read another column from base data...
-//     CHECK_OK(iter->ApplyUpdates(1, rowblock.column(1)))
+//     CHECK_OK(iter->ApplyUpdates(1, rowblock.column(1), *rowblock.selection_vector()))
 //     ...
 //  }
 
@@ -145,8 +146,10 @@ class DeltaIterator {
 
   // Apply the snapshotted updates to one of the columns.
   // 'dst' must be the same length as was previously passed to PrepareBatch()
+  // Updates to rows which are unselected in 'filter' may be skipped.
   // Must have called PrepareBatch() with flag = PREPARE_FOR_APPLY.
-  virtual Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) = 0;
+  virtual Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                              const SelectionVector& filter) = 0;
 
   // Apply any deletes to the given selection vector.
   // Rows which have been deleted in the associated MVCC snapshot are set to
@@ -184,6 +187,13 @@ class DeltaIterator {
   // Must have called PrepareBatch() with flag = PREPARE_FOR_APPLY.
   virtual bool MayHaveDeltas() = 0;
 
+  // Add the IDs of the columns which this iterator may update to 'col_ids'.
+  // If they can't be determined, sets *all_columns to true instead. It is safe
+  // to conservatively add columns which aren't updated.
+  // Must have called Init().
+  virtual Status CollectColumnIdsWithUpdates(std::set<ColumnId>* col_ids,
+                                             bool* all_columns) = 0;
+
   // Return a string representation suitable for debug printouts.
   virtual std::string ToString() const = 0;
 
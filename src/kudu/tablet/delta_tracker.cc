@@ -22,6 +22,7 @@
 #include <mutex>
 #include <set>
 
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/strip.h"
 #include "kudu/gutil/strings/substitute.h"
@@ -30,9 +31,11 @@
 #include "kudu/tablet/delta_iterator_merger.h"
 #include "kudu/tablet/delta_store.h"
 #include "kudu/tablet/deltafile.h"
+#include "kudu/tablet/deltamemstore.h"
 #include "kudu/tablet/diskrowset.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/util/status.h"
+#include "kudu/util/trace.h"
 
 namespace kudu {
 namespace tablet {
@@ -88,6 +91,7 @@ Status DeltaTracker::OpenDeltaReaders(const vector<BlockId>& blocks,
     shared_ptr<DeltaFileReader> dfr;
     ReaderOptions options;
     options.parent_mem_tracker = mem_trackers_.tablet_tracker;
+    options.block_cache_attribution = mem_trackers_.block_cache_attribution;
     s = DeltaFileReader::OpenNoInit(std::move(block),
                                     type,
                                     std::move(options),
@@ -347,7 +351,7 @@ Status DeltaTracker::CompactStores(int start_idx, int end_idx) {
   // Open a writer for the new destination delta block
   FsManager* fs = rowset_metadata_->fs_manager();
   gscoped_ptr<WritableBlock> block;
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(rowset_metadata_->block_create_options(), &block),
                         "Could not allocate delta block");
   BlockId new_block_id(block->id());
 
@@ -361,6 +365,15 @@ Status DeltaTracker::CompactStores(int start_idx, int end_idx) {
   RowSetMetadataUpdate update;
   update.ReplaceRedoDeltaBlocks(compacted_blocks, new_blocks);
 
+  // The compaction merges away no delta, so the new block deletes exactly the
+  // rows its inputs did. The inputs were opened to be merged.
+  RowSetMetadata::RedoDeltaSummary summary = { Timestamp::kMin, 0 };
+  for (const auto& store : compacted_stores) {
+    summary.max_timestamp = std::max(summary.max_timestamp, store->delta_stats().max_timestamp());
+    summary.delete_count += store->delta_stats().delete_count();
+  }
+  update.SetRedoBlockSummary(new_block_id, summary);
+
   LOG_WITH_PREFIX(INFO) << "Flushing compaction of redo delta blocks { " << compacted_blocks
                         << " } into block " << new_block_id;
   RETURN_NOT_OK_PREPEND(CommitDeltaStoreMetadataUpdate(update, compacted_stores, new_blocks, REDO,
@@ -378,9 +391,11 @@ Status DeltaTracker::EstimateBytesInPotentiallyAncientUndoDeltas(Timestamp ancie
 
   int64_t tmp_bytes = 0;
   for (const auto& undo : boost::adaptors::reverse(undos_newest_first)) {
-    // Short-circuit once we hit an initialized delta block with 'max_timestamp' > AHM.
-    if (undo->Initted() &&
-        undo->delta_stats().max_timestamp() >= ancient_history_mark) {
+    // Short-circuit once we hit a delta block known to have 'max_timestamp' > AHM.
+    // Blocks whose max timestamp is unknown are counted as potentially ancient.
+    Timestamp max_timestamp;
+    if (GetUndoMaxTimestampNoInit(undo, &max_timestamp) &&
+        max_timestamp >= ancient_history_mark) {
       break;
     }
     tmp_bytes += undo->EstimateSize(); // Can be called before Init().
@@ -399,19 +414,26 @@ Status DeltaTracker::InitUndoDeltas(Timestamp ancient_history_mark,
   int64_t tmp_blocks_initialized = 0;
   int64_t tmp_bytes_in_ancient_undos = 0;
 
-  // Traverse oldest-first, initializing delta stores as we go.
+  // Traverse oldest-first, initializing delta stores as we go. Stores whose
+  // max timestamp was recorded in the rowset metadata do not need to be
+  // initialized to tell whether they are ancient, unless the caller asked for
+  // all of them to be initialized.
   for (auto& undo : boost::adaptors::reverse(undos_newest_first)) {
-    if (deadline.Initialized() && MonoTime::Now() >= deadline) break;
-
-    if (!undo->Initted()) {
-      RETURN_NOT_OK(undo->Init());
-      tmp_blocks_initialized++;
+    Timestamp max_timestamp;
+    if (ancient_history_mark == Timestamp::kInvalidTimestamp ||
+        !GetUndoMaxTimestampNoInit(undo, &max_timestamp)) {
+      if (!undo->Initted()) {
+        if (deadline.Initialized() && MonoTime::Now() >= deadline) break;
+        RETURN_NOT_OK(undo->Init());
+        tmp_blocks_initialized++;
+      }
+      max_timestamp = undo->delta_stats().max_timestamp();
     }
 
     // Stop initializing delta files once we start hitting newer deltas that
     // are not GC'able.
     if (ancient_history_mark != Timestamp::kInvalidTimestamp &&
-        undo->delta_stats().max_timestamp() >= ancient_history_mark) break;
+        max_timestamp >= ancient_history_mark) break;
 
     // We only want to count the bytes in the ancient undos so this needs to
     // come after the short-circuit above.
@@ -451,8 +473,10 @@ Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
 
   // Traverse oldest-first.
   for (auto& undo : boost::adaptors::reverse(undos_newest_first)) {
-    if (!undo->Initted()) break; // Never initialize the deltas in this code path (it's slow).
-    if (undo->delta_stats().max_timestamp() >= ancient_history_mark) break;
+    // Never initialize the deltas in this code path (it's slow).
+    Timestamp max_timestamp;
+    if (!GetUndoMaxTimestampNoInit(undo, &max_timestamp)) break;
+    if (max_timestamp >= ancient_history_mark) break;
     tmp_blocks_deleted++;
     tmp_bytes_deleted += undo->EstimateSize();
     // This is always a safe downcast because UNDO deltas are always on disk.
@@ -477,6 +501,17 @@ Status DeltaTracker::DeleteAncientUndoDeltas(Timestamp ancient_history_mark,
   return Status::OK();
 }
 
+bool DeltaTracker::GetUndoMaxTimestampNoInit(const shared_ptr<DeltaStore>& undo,
+                                             Timestamp* max_timestamp) const {
+  if (undo->Initted()) {
+    *max_timestamp = undo->delta_stats().max_timestamp();
+    return true;
+  }
+  // This is always a safe downcast because UNDO deltas are always on disk.
+  const BlockId& block_id = down_cast<DeltaFileReader*>(undo.get())->block_id();
+  return rowset_metadata_->GetUndoDeltaMaxTimestamp(block_id, max_timestamp);
+}
+
 Status DeltaTracker::DoCompactStores(size_t start_idx, size_t end_idx,
          gscoped_ptr<WritableBlock> block,
          vector<shared_ptr<DeltaStore> > *compacted_stores,
@@ -552,13 +587,55 @@ Status DeltaTracker::NewDeltaFileIterator(
   return DeltaIteratorMerger::Create(*included_stores, schema, snap, out);
 }
 
+void DeltaTracker::CollectStoresForScan(const Schema& projection,
+                                        const MvccSnapshot& snap,
+                                        vector<shared_ptr<DeltaStore>>* stores) const {
+  vector<shared_ptr<DeltaStore>> all_stores;
+  CollectStores(&all_stores, UNDOS_AND_REDOS);
+  stores->clear();
+  for (shared_ptr<DeltaStore>& store : all_stores) {
+    if (store.get() == dms_.get()) {
+      if (!dms_->Empty()) {
+        stores->emplace_back(std::move(store));
+      }
+      continue;
+    }
+    // Only use the stats of the files already initialized: initializing a
+    // file reads it, which its iterator defers to the first seek.
+    if (!store->Initted()) {
+      stores->emplace_back(std::move(store));
+      continue;
+    }
+    if (!down_cast<DeltaFileReader*>(store.get())->IsRelevantForSnapshot(snap)) {
+      continue;
+    }
+    const DeltaStats& stats = store->delta_stats();
+    bool may_affect_scan = stats.delete_count() > 0 || stats.reinsert_count() > 0;
+    for (int i = 0; !may_affect_scan && i < projection.num_columns(); i++) {
+      may_affect_scan = stats.update_count_for_col_id(projection.column_id(i)) > 0;
+    }
+    if (may_affect_scan) {
+      stores->emplace_back(std::move(store));
+    }
+  }
+}
+
 Status DeltaTracker::WrapIterator(const shared_ptr<CFileSet::Iterator> &base,
                                   const MvccSnapshot &mvcc_snap,
-                                  gscoped_ptr<ColumnwiseIterator>* out) const {
-  unique_ptr<DeltaIterator> iter;
-  RETURN_NOT_OK(NewDeltaIterator(&base->schema(), mvcc_snap, &iter));
+                                  shared_ptr<ColumnwiseIterator>* out) const {
+  vector<shared_ptr<DeltaStore>> stores;
+  CollectStoresForScan(base->schema(), mvcc_snap, &stores);
+  if (stores.empty()) {
+    TRACE_COUNTER_INCREMENT("rowset_iterators_without_deltas", 1);
+    *out = base;
+    return Status::OK();
+  }
 
-  out->reset(new DeltaApplier(base, std::move(iter)));
+  unique_ptr<DeltaIterator> iter;
+  RETURN_NOT_OK(DeltaIteratorMerger::Create(stores, &base->schema(), mvcc_snap, &iter));
+  // The DeltaApplier can only be destroyed through its base class.
+  gscoped_ptr<ColumnwiseIterator> applier(new DeltaApplier(base, std::move(iter)));
+  out->reset(applier.release());
   return Status::OK();
 }
 
@@ -607,13 +684,63 @@ Status DeltaTracker::CheckRowDeleted(rowid_t row_idx, bool *deleted,
   return Status::OK();
 }
 
+bool DeltaTracker::CountDeletedRowsNoInit(const MvccSnapshot& snap, int64_t* deleted) const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+
+  // The base data reflects every UNDO, so none of them may be needed.
+  for (const auto& undo : undo_delta_stores_) {
+    Timestamp max_timestamp;
+    if (!GetUndoMaxTimestampNoInit(undo, &max_timestamp) ||
+        snap.MayHaveUncommittedTransactionsAtOrBefore(max_timestamp)) {
+      return false;
+    }
+  }
+
+  // A row has at most one REDO DELETE, since it can only be reinserted
+  // into another rowset, so the deletes can simply be added up. Updates
+  // don't change the row count, but the max timestamps of delta files cover
+  // them too, which only makes the check conservative.
+  int64_t count = 0;
+  for (const auto& redo : redo_delta_stores_) {
+    Timestamp max_timestamp;
+    const DeltaMemStore* dms = dynamic_cast<const DeltaMemStore*>(redo.get());
+    if (dms) {
+      // A DMS which is being flushed.
+      count += dms->CountDeletes(&max_timestamp);
+    } else if (redo->Initted()) {
+      count += redo->delta_stats().delete_count();
+      max_timestamp = redo->delta_stats().max_timestamp();
+    } else {
+      RowSetMetadata::RedoDeltaSummary summary;
+      const BlockId& block_id = down_cast<DeltaFileReader*>(redo.get())->block_id();
+      if (!rowset_metadata_->GetRedoDeltaSummary(block_id, &summary)) {
+        return false;
+      }
+      count += summary.delete_count;
+      max_timestamp = summary.max_timestamp;
+    }
+    if (snap.MayHaveUncommittedTransactionsAtOrBefore(max_timestamp)) {
+      return false;
+    }
+  }
+
+  Timestamp max_timestamp;
+  count += dms_->CountDeletes(&max_timestamp);
+  if (snap.MayHaveUncommittedTransactionsAtOrBefore(max_timestamp)) {
+    return false;
+  }
+  *deleted = count;
+  return true;
+}
+
 Status DeltaTracker::FlushDMS(DeltaMemStore* dms,
                               shared_ptr<DeltaFileReader>* dfr,
                               MetadataFlushType flush_type) {
   // Open file for write.
   FsManager* fs = rowset_metadata_->fs_manager();
   gscoped_ptr<WritableBlock> writable_block;
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(&writable_block),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(rowset_metadata_->block_create_options(),
+                                           &writable_block),
                         "Unable to allocate new delta data writable_block");
   BlockId block_id(writable_block->id());
 
@@ -634,13 +761,15 @@ Status DeltaTracker::FlushDMS(DeltaMemStore* dms,
   RETURN_NOT_OK(fs->OpenBlock(block_id, &readable_block));
   ReaderOptions options;
   options.parent_mem_tracker = mem_trackers_.tablet_tracker;
+  options.block_cache_attribution = mem_trackers_.block_cache_attribution;
   RETURN_NOT_OK(DeltaFileReader::OpenNoInit(std::move(readable_block),
                                             REDO,
                                             std::move(options),
                                             dfr));
   LOG_WITH_PREFIX(INFO) << "Reopened delta block for read: " << block_id.ToString();
 
-  RETURN_NOT_OK(rowset_metadata_->CommitRedoDeltaDataBlock(dms->id(), block_id));
+  RowSetMetadata::RedoDeltaSummary summary = { stats->max_timestamp(), stats->delete_count() };
+  RETURN_NOT_OK(rowset_metadata_->CommitRedoDeltaDataBlock(dms->id(), block_id, &summary));
   if (flush_type == FLUSH_METADATA) {
     RETURN_NOT_OK_PREPEND(rowset_metadata_->Flush(),
                           Substitute("Unable to commit Delta block metadata for: $0",
@@ -743,6 +872,15 @@ uint64_t DeltaTracker::EstimateOnDiskSize() const {
   return size;
 }
 
+uint64_t DeltaTracker::EstimateUndoDeltasOnDiskSize() const {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  uint64_t size = 0;
+  for (const shared_ptr<DeltaStore>& ds : undo_delta_stores_) {
+    size += ds->EstimateSize();
+  }
+  return size;
+}
+
 void DeltaTracker::GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const {
   shared_lock<rw_spinlock> lock(component_lock_);
 
@@ -758,6 +896,21 @@ void DeltaTracker::GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const
   col_ids->assign(column_ids_with_updates.begin(), column_ids_with_updates.end());
 }
 
+Status DeltaTracker::MayHaveUpdatesToColumn(ColumnId col_id, bool* updated) {
+  shared_lock<rw_spinlock> lock(component_lock_);
+  if (!dms_->Empty()) {
+    *updated = true;
+    return Status::OK();
+  }
+  set<ColumnId> column_ids_with_updates;
+  for (const shared_ptr<DeltaStore>& ds : redo_delta_stores_) {
+    RETURN_NOT_OK(ds->Init());
+    ds->delta_stats().AddColumnIdsWithUpdates(&column_ids_with_updates);
+  }
+  *updated = ContainsKey(column_ids_with_updates, col_id);
+  return Status::OK();
+}
+
 Status DeltaTracker::InitAllDeltaStoresForTests(WhichStores stores) {
   shared_lock<rw_spinlock> lock(component_lock_);
   if (stores == UNDOS_AND_REDOS || stores == UNDOS_ONLY) {
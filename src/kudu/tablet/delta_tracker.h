@@ -71,9 +71,12 @@ class DeltaTracker {
                      const TabletMemTrackers& mem_trackers,
                      gscoped_ptr<DeltaTracker>* delta_tracker);
 
+  // Wraps 'base' with the deltas which may change the rows it reads under
+  // 'mvcc_snap'. If no delta store may, e.g. on a rowset without updates to
+  // the projected columns, 'base' is returned as is.
   Status WrapIterator(const std::shared_ptr<CFileSet::Iterator> &base,
                       const MvccSnapshot &mvcc_snap,
-                      gscoped_ptr<ColumnwiseIterator>* out) const;
+                      std::shared_ptr<ColumnwiseIterator>* out) const;
 
   // Enum used for NewDeltaIterator() and CollectStores() below.
   // Determines whether all types of stores should be considered,
@@ -137,6 +140,17 @@ class DeltaTracker {
   // Sets *deleted to true if so; otherwise sets it to false.
   Status CheckRowDeleted(rowid_t row_idx, bool *deleted, ProbeStats* stats) const;
 
+  // If every delta of this tracker which may change whether a row is live
+  // is committed in 'snap', and that can be told without opening any delta
+  // file, sets '*deleted' to the number of rows deleted by the REDO deltas
+  // and returns true. Otherwise, counting the rows live in 'snap' requires
+  // applying the deltas, and false is returned.
+  //
+  // Relies on the delete counts and max timestamps of the delta blocks
+  // recorded in the rowset metadata, or the stats of those delta files
+  // which are already open.
+  bool CountDeletedRowsNoInit(const MvccSnapshot& snap, int64_t* deleted) const;
+
   // Compacts all REDO delta files.
   //
   // TODO keep metadata in the delta stores to indicate whether or not
@@ -218,9 +232,17 @@ class DeltaTracker {
 
   uint64_t EstimateOnDiskSize() const;
 
+  // Return the estimated size of the undo delta stores on disk.
+  uint64_t EstimateUndoDeltasOnDiskSize() const;
+
   // Retrieves the list of column indexes that currently have updates.
   void GetColumnIdsWithUpdates(std::vector<ColumnId>* col_ids) const;
 
+  // Sets 'updated' to whether the REDO deltas may update the column 'col_id'.
+  // Unlike GetColumnIdsWithUpdates(), initializes the delta files to read
+  // their stats, and considers that a non-empty DMS may update any column.
+  Status MayHaveUpdatesToColumn(ColumnId col_id, bool* updated);
+
   Mutex* compact_flush_lock() {
     return &compact_flush_lock_;
   }
@@ -241,6 +263,13 @@ class DeltaTracker {
 
   Status DoOpen();
 
+  // Sets 'max_timestamp' to the maximum delta timestamp of the UNDO store
+  // 'undo' if it can be determined without initializing the store: either
+  // because it is already initialized or because the timestamp was recorded
+  // in the rowset metadata when the block was written. Returns false otherwise.
+  bool GetUndoMaxTimestampNoInit(const std::shared_ptr<DeltaStore>& undo,
+                                 Timestamp* max_timestamp) const;
+
   Status OpenDeltaReaders(const std::vector<BlockId>& blocks,
                           std::vector<std::shared_ptr<DeltaStore> >* stores,
                           DeltaType type);
@@ -253,6 +282,15 @@ class DeltaTracker {
   void CollectStores(vector<std::shared_ptr<DeltaStore>>* stores,
                      WhichStores which) const;
 
+  // Collects into '*stores' the undo and redo stores which may change the
+  // rows of a scan of 'projection' under 'snap': leaves out the empty DMS and
+  // the initialized delta files whose stats show that their deltas are
+  // outside the snapshot, or have no deletes or reinserts and don't update
+  // any projected column.
+  void CollectStoresForScan(const Schema& projection,
+                            const MvccSnapshot& snap,
+                            vector<std::shared_ptr<DeltaStore>>* stores) const;
+
   // Performs the actual compaction. Results of compaction are written to "block",
   // while delta stores that underwent compaction are appended to "compacted_stores", while
   // their corresponding block ids are appended to "compacted_blocks".
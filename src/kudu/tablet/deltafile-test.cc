@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <cstring>
 #include <memory>
 
 #include <gflags/gflags.h>
@@ -28,6 +29,7 @@
 #include "kudu/tablet/delta_tracker.h"
 #include "kudu/tablet/deltafile.h"
 #include "kudu/util/test_util.h"
+#include "kudu/util/trace.h"
 
 DECLARE_int32(deltafile_default_block_size);
 DEFINE_int32(first_row_to_update, 10000, "the first row to update");
@@ -149,6 +151,8 @@ class TestDeltaFile : public KuduTest {
     // past the updates, to ensure that nothing breaks on the boundaries.
     ASSERT_OK(it->SeekToOrdinal(0));
 
+    SelectionVector sel(block.nrows());
+    sel.SetAllTrue();
     int start_row = 0;
     while (start_row < FLAGS_last_row_to_update + 10000) {
       block.ZeroMemory();
@@ -156,7 +160,7 @@ class TestDeltaFile : public KuduTest {
 
       ASSERT_OK_FAST(it->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
       ColumnBlock dst_col = block.column_block(0);
-      ASSERT_OK_FAST(it->ApplyUpdates(0, &dst_col));
+      ASSERT_OK_FAST(it->ApplyUpdates(0, &dst_col, sel));
 
       for (int i = 0; i < block.nrows(); i++) {
         uint32_t row = start_row + i;
@@ -361,6 +365,100 @@ TEST_F(TestDeltaFile, TestLazyInit) {
   ASSERT_EQ(bytes_read_after_init, bytes_read);
 }
 
+// Check that the iterator doesn't read the delta blocks which, according to
+// their block stats, are irrelevant to the snapshot or to the projection.
+TEST_F(TestDeltaFile, TestSkipsIrrelevantDeltaBlocks) {
+  google::FlagSaver saver;
+  FLAGS_deltafile_default_block_size = 256;
+  const uint32_t kNumRows = 2000;
+
+  // Update every row, the first half at timestamp 10 and the others at 30.
+  {
+    gscoped_ptr<WritableBlock> block;
+    ASSERT_OK(fs_manager_->CreateNewBlock(&block));
+    test_block_ = block->id();
+    DeltaFileWriter dfw(std::move(block));
+    ASSERT_OK(dfw.Start());
+    faststring buf;
+    DeltaStats stats;
+    for (uint32_t i = 0; i < kNumRows; i++) {
+      buf.clear();
+      RowChangeListEncoder update(&buf);
+      update.AddColumnUpdate(schema_.column(0), schema_.column_id(0), &i);
+      DeltaKey key(i, Timestamp(i < kNumRows / 2 ? 10 : 30));
+      RowChangeList rcl(buf);
+      ASSERT_OK_FAST(dfw.AppendDelta<REDO>(key, rcl));
+      ASSERT_OK_FAST(stats.UpdateStats(key.timestamp(), rcl));
+    }
+    dfw.WriteDeltaStats(stats);
+    ASSERT_OK(dfw.Finish());
+  }
+  shared_ptr<DeltaFileReader> reader;
+  ASSERT_OK(OpenDeltaFileReader(test_block_, &reader));
+
+  // Iterates over the rows, storing their updated values into 'values' if
+  // it's set, and returns the number of delta blocks skipped.
+  auto scan = [&](const Schema& projection, const MvccSnapshot& snap,
+                  DeltaIterator::PrepareFlag flag, vector<uint32_t>* values) -> int64_t {
+    DeltaIterator* raw_iter;
+    CHECK_OK(reader->NewDeltaIterator(&projection, snap, &raw_iter));
+    gscoped_ptr<DeltaIterator> it(raw_iter);
+    CHECK_OK(it->Init(nullptr));
+    CHECK_OK(it->SeekToOrdinal(0));
+    scoped_refptr<Trace> trace(new Trace);
+    ADOPT_TRACE(trace.get());
+    RowBlock block(projection, 100, &arena_);
+    SelectionVector sel(block.nrows());
+    sel.SetAllTrue();
+    for (uint32_t start_row = 0; start_row < kNumRows; start_row += block.nrows()) {
+      CHECK_OK(it->PrepareBatch(block.nrows(), flag));
+      if (values != nullptr) {
+        block.ZeroMemory();
+        ColumnBlock dst_col = block.column_block(0);
+        CHECK_OK(it->ApplyUpdates(0, &dst_col, sel));
+        for (int i = 0; i < block.nrows(); i++) {
+          values->push_back(*projection.ExtractColumnFromRow<UINT32>(block.row(i), 0));
+        }
+      }
+    }
+    for (const auto& e : trace->metrics()->Get()) {
+      if (strcmp(e.first, "delta_blocks_skipped") == 0) {
+        return e.second;
+      }
+    }
+    return 0;
+  };
+
+  // All the blocks are read for a snapshot including every update.
+  vector<uint32_t> values;
+  MvccSnapshot snap_all = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  ASSERT_EQ(0, scan(schema_, snap_all, DeltaIterator::PREPARE_FOR_APPLY, &values));
+  ASSERT_EQ(kNumRows, values.size());
+  for (uint32_t i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(i, values[i]);
+  }
+
+  // The blocks of the updates at timestamp 30 are skipped for a snapshot at
+  // timestamp 20, except the one holding updates at both timestamps.
+  values.clear();
+  ASSERT_GT(scan(schema_, MvccSnapshot(Timestamp(20)),
+                 DeltaIterator::PREPARE_FOR_APPLY, &values), 0);
+  ASSERT_EQ(kNumRows, values.size());
+  for (uint32_t i = 0; i < kNumRows; i++) {
+    ASSERT_EQ(i < kNumRows / 2 ? i : 0, values[i]);
+  }
+
+  // All the blocks are skipped when applying to a projection without the
+  // updated column, but not when collecting the mutations.
+  Schema other_projection({ ColumnSchema("other", UINT32) },
+                          { ColumnId(schema_.column_id(0) + 1) }, 0);
+  int64_t num_skipped = scan(other_projection, snap_all, DeltaIterator::PREPARE_FOR_APPLY,
+                             nullptr);
+  // Each delta takes more than 4 bytes, so the file has more blocks than that.
+  ASSERT_GT(num_skipped, kNumRows * 4 / FLAGS_deltafile_default_block_size);
+  ASSERT_EQ(0, scan(other_projection, snap_all, DeltaIterator::PREPARE_FOR_COLLECT, nullptr));
+}
+
 // Check that, if a delta file is opened but no deltas are written,
 // Finish() will return Status::Aborted().
 TEST_F(TestDeltaFile, TestEmptyFileIsAborted) {
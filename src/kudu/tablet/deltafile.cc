@@ -18,6 +18,7 @@
 #include "kudu/tablet/deltafile.h"
 
 #include <arpa/inet.h>
+#include <algorithm>
 #include <memory>
 #include <string>
 
@@ -27,6 +28,8 @@
 #include "kudu/cfile/block_handle.h"
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/codegen/change_list_applier.h"
+#include "kudu/codegen/compilation_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/mathlimits.h"
 #include "kudu/tablet/mutation.h"
@@ -48,8 +51,13 @@ DEFINE_string(deltafile_default_compression_codec, "lz4",
               "The compression codec used when writing deltafiles.");
 TAG_FLAG(deltafile_default_compression_codec, experimental);
 
+DEFINE_bool(deltafile_use_codegen, true, "whether delta file iterators should "
+            "apply updates using code-generated functions");
+TAG_FLAG(deltafile_use_codegen, hidden);
+
 using std::shared_ptr;
 using std::unique_ptr;
+using std::vector;
 
 namespace kudu {
 
@@ -65,14 +73,16 @@ using fs::WritableBlock;
 namespace tablet {
 
 const char * const DeltaFileReader::kDeltaStatsEntryName = "deltafilestats";
+const char * const DeltaFileReader::kDeltaBlockStatsEntryName = "deltablockstats";
 
 namespace {
 
 } // namespace
 
 DeltaFileWriter::DeltaFileWriter(gscoped_ptr<WritableBlock> block)
+ : cur_block_open_(false)
 #ifndef NDEBUG
- : has_appended_(false)
+ , has_appended_(false)
 #endif
 { // NOLINT(*)
   cfile::WriterOptions opts;
@@ -101,6 +111,10 @@ Status DeltaFileWriter::FinishAndReleaseBlock(ScopedWritableBlockCloser* closer)
   if (writer_->written_value_count() == 0) {
     return Status::Aborted("no deltas written");
   }
+  FinishBlockStats();
+  faststring buf;
+  pb_util::SerializeToString(block_stats_, &buf);
+  writer_->AddMetadataPair(DeltaFileReader::kDeltaBlockStatsEntryName, buf.ToString());
   return writer_->FinishAndReleaseBlock(closer);
 }
 
@@ -115,7 +129,59 @@ Status DeltaFileWriter::DoAppendDelta(const DeltaKey &key,
   tmp_buf_.append(delta_slice.data(), delta_slice.size());
   Slice tmp_buf_slice(tmp_buf_);
 
-  return writer_->AppendEntries(&tmp_buf_slice, 1);
+  RETURN_NOT_OK(UpdateBlockStats(key, delta));
+  RETURN_NOT_OK(writer_->AppendEntries(&tmp_buf_slice, 1));
+  if (writer_->unfinished_block_value_count() == 0) {
+    // The delta filled its block, which is now finished.
+    FinishBlockStats();
+  }
+  return Status::OK();
+}
+
+Status DeltaFileWriter::UpdateBlockStats(const DeltaKey &key,
+                                         const RowChangeList &delta) {
+  RowChangeListDecoder decoder(delta);
+  RETURN_NOT_OK(decoder.Init());
+
+  uint64_t timestamp = key.timestamp().ToUint64();
+  DeltaBlockStatsPB::BlockStats* block;
+  if (!cur_block_open_) {
+    // The delta is the first one of a new block.
+    block = block_stats_.add_blocks();
+    block->set_first_row_idx(key.row_idx());
+    block->set_first_timestamp(timestamp);
+    block->set_min_timestamp(timestamp);
+    block->set_max_timestamp(timestamp);
+    block->set_has_deletes_or_reinserts(false);
+    cur_block_open_ = true;
+  } else {
+    block = block_stats_.mutable_blocks(block_stats_.blocks_size() - 1);
+    block->set_min_timestamp(std::min(block->min_timestamp(), timestamp));
+    block->set_max_timestamp(std::max(block->max_timestamp(), timestamp));
+  }
+  block->set_last_row_idx(key.row_idx());
+
+  if (decoder.is_update()) {
+    vector<ColumnId> col_ids;
+    RETURN_NOT_OK(decoder.GetIncludedColumnIds(&col_ids));
+    cur_block_col_ids_.insert(col_ids.begin(), col_ids.end());
+  } else {
+    block->set_has_deletes_or_reinserts(true);
+  }
+  return Status::OK();
+}
+
+void DeltaFileWriter::FinishBlockStats() {
+  if (!cur_block_open_) {
+    return;
+  }
+  DeltaBlockStatsPB::BlockStats* block =
+      block_stats_.mutable_blocks(block_stats_.blocks_size() - 1);
+  for (ColumnId col_id : cur_block_col_ids_) {
+    block->add_updated_col_ids(col_id);
+  }
+  cur_block_col_ids_.clear();
+  cur_block_open_ = false;
 }
 
 template<>
@@ -225,6 +291,7 @@ Status DeltaFileReader::InitOnce() {
 
   // Initialize delta file stats
   RETURN_NOT_OK(ReadDeltaStats());
+  RETURN_NOT_OK(ReadDeltaBlockStats());
   return Status::OK();
 }
 
@@ -244,6 +311,54 @@ Status DeltaFileReader::ReadDeltaStats() {
   return Status::OK();
 }
 
+Status DeltaFileReader::ReadDeltaBlockStats() {
+  string blockstats_pb_buf;
+  if (!reader_->GetMetadataEntry(kDeltaBlockStatsEntryName, &blockstats_pb_buf)) {
+    return Status::OK();
+  }
+
+  DeltaBlockStatsPB blockstats_pb;
+  if (!blockstats_pb.ParseFromString(blockstats_pb_buf)) {
+    return Status::Corruption("unable to parse the delta block stats protobuf");
+  }
+  block_stats_.clear();
+  block_stats_.reserve(blockstats_pb.blocks_size());
+  for (const DeltaBlockStatsPB::BlockStats& block_pb : blockstats_pb.blocks()) {
+    DeltaBlockStats block;
+    block.first_key = DeltaKey(block_pb.first_row_idx(),
+                               Timestamp(block_pb.first_timestamp()));
+    block.last_row_idx = block_pb.last_row_idx();
+    block.min_timestamp = Timestamp(block_pb.min_timestamp());
+    block.max_timestamp = Timestamp(block_pb.max_timestamp());
+    for (int32_t col_id : block_pb.updated_col_ids()) {
+      block.updated_col_ids.emplace_back(col_id);
+    }
+    block.has_deletes_or_reinserts = block_pb.has_deletes_or_reinserts();
+    block_stats_.emplace_back(std::move(block));
+  }
+  return Status::OK();
+}
+
+const DeltaBlockStats* DeltaFileReader::FindBlockStats(const DeltaKey& first_key) const {
+  // The blocks are sorted by the row index of their first delta. Two blocks
+  // may start with the same key if the deltas of a transaction to a single
+  // row fill a block: then the stats are ambiguous and not used.
+  auto it = std::lower_bound(block_stats_.begin(), block_stats_.end(), first_key.row_idx(),
+                             [](const DeltaBlockStats& block, rowid_t row_idx) {
+                               return block.first_key.row_idx() < row_idx;
+                             });
+  const DeltaBlockStats* found = nullptr;
+  for (; it != block_stats_.end() && it->first_key.row_idx() == first_key.row_idx(); ++it) {
+    if (it->first_key.timestamp() == first_key.timestamp()) {
+      if (found != nullptr) {
+        return nullptr;
+      }
+      found = &*it;
+    }
+  }
+  return found;
+}
+
 bool DeltaFileReader::IsRelevantForSnapshot(const MvccSnapshot& snap) const {
   if (!init_once_.initted()) {
     // If we're not initted, it means we have no delta stats and must
@@ -369,12 +484,24 @@ DeltaFileIterator::DeltaFileIterator(shared_ptr<DeltaFileReader> dfr,
       delta_type_(delta_type),
       cache_blocks_(CFileReader::CACHE_BLOCK) {}
 
+DeltaFileIterator::~DeltaFileIterator() {}
+
 Status DeltaFileIterator::Init(ScanSpec *spec) {
   DCHECK(!initted_) << "Already initted";
 
   if (spec) {
-    cache_blocks_ = spec->cache_blocks() ? CFileReader::CACHE_BLOCK :
-                                           CFileReader::DONT_CACHE_BLOCK;
+    if (!spec->cache_blocks()) {
+      cache_blocks_ = CFileReader::DONT_CACHE_BLOCK;
+    } else if (spec->cache_blocks_low_priority()) {
+      cache_blocks_ = CFileReader::CACHE_BLOCK_LOW_PRIORITY;
+    }
+  }
+
+  // If the applier isn't compiled yet, this scan decodes the deltas itself
+  // while it compiles in the background.
+  if (FLAGS_deltafile_use_codegen && projection_->has_column_ids()) {
+    codegen::CompilationManager::GetSingleton()->RequestChangeListApplier(
+        projection_, &applier_);
   }
 
   initted_ = true;
@@ -477,6 +604,50 @@ Status DeltaFileIterator::GetLastRowIndexInDecodedBlock(const BinaryPlainBlockDe
 }
 
 
+Status DeltaFileIterator::CanSkipCurrentBlock(rowid_t start_row, PrepareFlag flag,
+                                              bool* skip) {
+  DCHECK(index_iter_) << "Must call SeekToOrdinal()";
+  *skip = false;
+
+  Slice index_entry = index_iter_->GetCurrentKey();
+  DeltaKey first_key;
+  RETURN_NOT_OK(first_key.DecodeFrom(&index_entry));
+  const DeltaBlockStats* stats = dfr_->FindBlockStats(first_key);
+  if (stats == nullptr) {
+    return Status::OK();
+  }
+
+  // The seek may position the iterator on a block which ends before the
+  // first row to prepare.
+  if (stats->last_row_idx < start_row) {
+    *skip = true;
+    return Status::OK();
+  }
+
+  // As in DeltaFileReader::IsRelevantForSnapshot(), but for the block.
+  if (delta_type_ == REDO ?
+      !mvcc_snap_.MayHaveCommittedTransactionsAtOrAfter(stats->min_timestamp) :
+      !mvcc_snap_.MayHaveUncommittedTransactionsAtOrBefore(stats->max_timestamp)) {
+    *skip = true;
+    return Status::OK();
+  }
+
+  // Collecting the mutations needs the updates to every column, and the
+  // liveness of the rows needs the deletes and reinserts.
+  if (flag != PREPARE_FOR_APPLY ||
+      stats->has_deletes_or_reinserts ||
+      !projection_->has_column_ids()) {
+    return Status::OK();
+  }
+  for (ColumnId col_id : stats->updated_col_ids) {
+    if (projection_->find_column_by_id(col_id) != Schema::kColumnNotFound) {
+      return Status::OK();
+    }
+  }
+  *skip = true;
+  return Status::OK();
+}
+
 string DeltaFileIterator::PreparedDeltaBlock::ToString() const {
   return StringPrintf("%d-%d (%s)", first_updated_idx_, last_updated_idx_,
                       block_ptr_.ToString().c_str());
@@ -507,7 +678,13 @@ Status DeltaFileIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
       break;
     }
 
-    RETURN_NOT_OK(ReadCurrentBlockOntoQueue());
+    bool skip;
+    RETURN_NOT_OK(CanSkipCurrentBlock(start_row, flag, &skip));
+    if (skip) {
+      TRACE_COUNTER_INCREMENT("delta_blocks_skipped", 1);
+    } else {
+      RETURN_NOT_OK(ReadCurrentBlockOntoQueue());
+    }
 
     Status s = index_iter_->Next();
     if (s.IsNotFound()) {
@@ -643,14 +820,22 @@ struct ApplyingVisitor {
   inline Status ApplyMutation(const DeltaKey &key, const Slice &deltas) {
     int64_t rel_idx = key.row_idx() - dfi->prepared_idx_;
     DCHECK_GE(rel_idx, 0);
+    if (!filter->IsRowSelected(rel_idx)) {
+      return Status::OK();
+    }
 
     // TODO: this code looks eerily similar to DMSIterator::ApplyUpdates!
     // I bet it can be combined.
 
     const Schema* schema = dfi->projection_;
-    RowChangeListDecoder decoder((RowChangeList(deltas)));
+    RowChangeList changelist(deltas);
+    RowChangeListDecoder decoder(changelist);
     RETURN_NOT_OK(decoder.Init());
     if (decoder.is_update() || decoder.is_reinsert()) {
+      if (dfi->applier_) {
+        return dfi->applier_->ApplyToOneColumn(changelist, rel_idx, dst, col_to_apply,
+                                               dst->arena());
+      }
       return decoder.ApplyToOneColumn(rel_idx, dst, *schema, col_to_apply, dst->arena());
     }
 
@@ -662,6 +847,7 @@ struct ApplyingVisitor {
   DeltaFileIterator *dfi;
   size_t col_to_apply;
   ColumnBlock *dst;
+  const SelectionVector* filter;
 };
 
 template<>
@@ -688,16 +874,17 @@ inline Status ApplyingVisitor<UNDO>::Visit(const DeltaKey& key,
   return Status::OK();
 }
 
-Status DeltaFileIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
+Status DeltaFileIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                                       const SelectionVector& filter) {
   DCHECK_LE(prepared_count_, dst->nrows());
 
   if (delta_type_ == REDO) {
     DVLOG(3) << "Applying REDO mutations to " << col_to_apply;
-    ApplyingVisitor<REDO> visitor = {this, col_to_apply, dst};
+    ApplyingVisitor<REDO> visitor = {this, col_to_apply, dst, &filter};
     return VisitMutations(&visitor);
   }
   DVLOG(3) << "Applying UNDO mutations to " << col_to_apply;
-  ApplyingVisitor<UNDO> visitor = {this, col_to_apply, dst};
+  ApplyingVisitor<UNDO> visitor = {this, col_to_apply, dst, &filter};
   return VisitMutations(&visitor);
 }
 
@@ -829,6 +1016,15 @@ bool DeltaFileIterator::HasNext() {
   return !exhausted_ || !delta_blocks_.empty();
 }
 
+Status DeltaFileIterator::CollectColumnIdsWithUpdates(std::set<ColumnId>* col_ids,
+                                                      bool* /* all_columns */) {
+  // Finish the initialization of any lazily-initialized state, so that the
+  // delta stats are available.
+  RETURN_NOT_OK(dfr_->Init());
+  dfr_->delta_stats().AddColumnIdsWithUpdates(col_ids);
+  return Status::OK();
+}
+
 bool DeltaFileIterator::MayHaveDeltas() {
   // TODO: change the API to take in the col_to_apply and check for deltas on
   // that column only.
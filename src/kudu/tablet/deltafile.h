@@ -19,6 +19,7 @@
 
 #include <deque>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -44,6 +45,10 @@ namespace cfile {
 class BinaryPlainBlockDecoder;
 } // namespace cfile
 
+namespace codegen {
+class ChangeListApplier;
+} // namespace codegen
+
 namespace tablet {
 
 class DeltaFileIterator;
@@ -85,8 +90,21 @@ class DeltaFileWriter {
  private:
   Status DoAppendDelta(const DeltaKey &key, const RowChangeList &delta);
 
+  // Adds 'delta' to the stats of the data block being built.
+  Status UpdateBlockStats(const DeltaKey &key, const RowChangeList &delta);
+
+  // Completes the stats of the data block being built, once it's finished.
+  void FinishBlockStats();
+
   gscoped_ptr<cfile::CFileWriter> writer_;
 
+  // The stats of the data blocks of the file, written along with the file.
+  // While 'cur_block_open_' is set, the last entry is the block being built,
+  // whose updated columns are collected in 'cur_block_col_ids_'.
+  DeltaBlockStatsPB block_stats_;
+  std::set<ColumnId> cur_block_col_ids_;
+  bool cur_block_open_;
+
   // Buffer used as a temporary for storing the serialized form
   // of the deltas
   faststring tmp_buf_;
@@ -102,10 +120,21 @@ class DeltaFileWriter {
   DISALLOW_COPY_AND_ASSIGN(DeltaFileWriter);
 };
 
+// The stats of one data block of a delta file, see DeltaBlockStatsPB.
+struct DeltaBlockStats {
+  DeltaKey first_key;
+  rowid_t last_row_idx;
+  Timestamp min_timestamp;
+  Timestamp max_timestamp;
+  std::vector<ColumnId> updated_col_ids;
+  bool has_deletes_or_reinserts;
+};
+
 class DeltaFileReader : public DeltaStore,
                         public std::enable_shared_from_this<DeltaFileReader> {
  public:
   static const char * const kDeltaStatsEntryName;
+  static const char * const kDeltaBlockStatsEntryName;
 
   // Fully open a delta file using a previously opened block.
   //
@@ -181,9 +210,20 @@ class DeltaFileReader : public DeltaStore,
 
   Status ReadDeltaStats();
 
+  // Reads the stats of the data blocks, if the file has them: files written
+  // before they were introduced don't.
+  Status ReadDeltaBlockStats();
+
+  // Returns the stats of the data block whose first delta has the key
+  // 'first_key', or nullptr if they're unknown.
+  const DeltaBlockStats* FindBlockStats(const DeltaKey& first_key) const;
+
   std::shared_ptr<cfile::CFileReader> reader_;
   gscoped_ptr<DeltaStats> delta_stats_;
 
+  // The stats of the data blocks, in file order.
+  std::vector<DeltaBlockStats> block_stats_;
+
   // The type of this delta, i.e. UNDO or REDO.
   const DeltaType delta_type_;
 
@@ -195,11 +235,14 @@ class DeltaFileReader : public DeltaStore,
 // See DeltaIterator for details.
 class DeltaFileIterator : public DeltaIterator {
  public:
+  ~DeltaFileIterator();
+
   Status Init(ScanSpec *spec) OVERRIDE;
 
   Status SeekToOrdinal(rowid_t idx) OVERRIDE;
   Status PrepareBatch(size_t nrows, PrepareFlag flag) OVERRIDE;
-  Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) OVERRIDE;
+  Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                      const SelectionVector& filter) OVERRIDE;
   Status ApplyDeletes(SelectionVector *sel_vec) OVERRIDE;
   Status CollectMutations(vector<Mutation *> *dst, Arena *arena) OVERRIDE;
   Status FilterColumnIdsAndCollectDeltas(const std::vector<ColumnId>& col_ids,
@@ -209,6 +252,8 @@ class DeltaFileIterator : public DeltaIterator {
   virtual bool HasNext() OVERRIDE;
   bool MayHaveDeltas() override;
 
+  Status CollectColumnIdsWithUpdates(std::set<ColumnId>* col_ids, bool* all_columns) override;
+
  private:
   friend class DeltaFileReader;
   friend struct ApplyingVisitor<REDO>;
@@ -276,6 +321,13 @@ class DeltaFileIterator : public DeltaIterator {
   // onto the end of the delta_blocks_ queue.
   Status ReadCurrentBlockOntoQueue();
 
+  // Sets 'skip' to whether the block at the current position in the file
+  // holds no delta to prepare for the rows from 'start_row' on, according to
+  // its block stats: all its deltas are for earlier rows, or irrelevant to the
+  // snapshot, or, when preparing to apply, only update columns not in the
+  // projection.
+  Status CanSkipCurrentBlock(rowid_t start_row, PrepareFlag flag, bool* skip);
+
   // Visit all mutations in the currently prepared row range with the specified
   // visitor class.
   template<class Visitor>
@@ -315,6 +367,10 @@ class DeltaFileIterator : public DeltaIterator {
   const DeltaType delta_type_;
 
   CFileReader::CacheControl cache_blocks_;
+
+  // If code generation is enabled and the applier for the projection has
+  // already been compiled, applies the updates in ApplyUpdates().
+  gscoped_ptr<codegen::ChangeListApplier> applier_;
 };
 
 
@@ -15,16 +15,20 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <gtest/gtest.h>
 #include <memory>
 #include <stdlib.h>
+#include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "kudu/common/schema.h"
 #include "kudu/consensus/consensus.pb.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/gutil/casts.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/server/logical_clock.h"
 #include "kudu/tablet/deltamemstore.h"
 #include "kudu/tablet/deltafile.h"
@@ -35,9 +39,13 @@
 #include "kudu/util/test_util.h"
 
 DEFINE_int32(benchmark_num_passes, 100, "Number of passes to apply deltas in the benchmark");
+DECLARE_bool(deltamemstore_columnar_updates);
 
 using std::shared_ptr;
+using std::string;
 using std::unordered_set;
+using std::vector;
+using strings::Substitute;
 
 namespace kudu {
 namespace tablet {
@@ -109,7 +117,9 @@ class TestDeltaMemStore : public KuduTest {
     ASSERT_OK(iter->Init(nullptr));
     ASSERT_OK(iter->SeekToOrdinal(row_idx));
     ASSERT_OK(iter->PrepareBatch(cb->nrows(), DeltaIterator::PREPARE_FOR_APPLY));
-    ASSERT_OK(iter->ApplyUpdates(0, cb));
+    SelectionVector sel(cb->nrows());
+    sel.SetAllTrue();
+    ASSERT_OK(iter->ApplyUpdates(0, cb, sel));
   }
 
 
@@ -426,9 +436,11 @@ TEST_F(TestDeltaMemStore, TestIteratorDoesUpdates) {
   ASSERT_OK(iter->Init(nullptr));
 
   int block_start_row = 50;
+  SelectionVector sel(block.nrows());
+  sel.SetAllTrue();
   ASSERT_OK(iter->SeekToOrdinal(block_start_row));
   ASSERT_OK(iter->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
-  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block));
+  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block, sel));
 
   for (int i = 0; i < 100; i++) {
     int actual_row = block_start_row + i;
@@ -438,11 +450,26 @@ TEST_F(TestDeltaMemStore, TestIteratorDoesUpdates) {
   // Apply the next block
   block_start_row += block.nrows();
   ASSERT_OK(iter->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
-  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block));
+  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block, sel));
   for (int i = 0; i < 100; i++) {
     int actual_row = block_start_row + i;
     ASSERT_EQ(actual_row * 10, block[i]) << "at row " << actual_row;
   }
+
+  // Updates to unselected rows may be skipped, and the DMS skips them.
+  block_start_row += block.nrows();
+  for (int i = 0; i < 100; i++) {
+    block[i] = 0;
+    if (i % 3 == 0) {
+      sel.SetRowUnselected(i);
+    }
+  }
+  ASSERT_OK(iter->PrepareBatch(block.nrows(), DeltaIterator::PREPARE_FOR_APPLY));
+  ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block, sel));
+  for (int i = 0; i < 100; i++) {
+    int actual_row = block_start_row + i;
+    ASSERT_EQ(i % 3 == 0 ? 0 : actual_row * 10, block[i]) << "at row " << actual_row;
+  }
 }
 
 TEST_F(TestDeltaMemStore, TestCollectMutations) {
@@ -505,5 +532,161 @@ TEST_F(TestDeltaMemStore, TestCollectMutations) {
   }
 }
 
+// Reads rows [0, nrows) of column 'col_idx' from 'dms' as of 'snap', in
+// batches of 'batch_size', applying both updates and deletes. Deleted rows
+// are returned as "<deleted>".
+static vector<string> ReadColumn(const shared_ptr<DeltaMemStore>& dms,
+                                 const Schema& schema,
+                                 const MvccSnapshot& snap,
+                                 size_t col_idx,
+                                 int nrows,
+                                 int batch_size) {
+  Schema projection({ schema.column(col_idx) }, { schema.column_id(col_idx) }, 0);
+  DeltaIterator* raw_iter;
+  CHECK_OK(dms->NewDeltaIterator(&projection, snap, &raw_iter));
+  gscoped_ptr<DeltaIterator> iter(raw_iter);
+  CHECK_OK(iter->Init(nullptr));
+  CHECK_OK(iter->SeekToOrdinal(0));
+
+  vector<string> ret;
+  for (int start = 0; start < nrows; start += batch_size) {
+    int n = std::min(batch_size, nrows - start);
+    Arena arena(1024, 1024 * 1024);
+    ScopedColumnBlock<STRING> strings(n);
+    ScopedColumnBlock<UINT32> ints(n);
+    ColumnBlock* block = schema.column(col_idx).type_info()->type() == STRING ?
+        static_cast<ColumnBlock*>(&strings) : static_cast<ColumnBlock*>(&ints);
+    for (int i = 0; i < n; i++) {
+      strings[i] = Slice("<unset>");
+      ints[i] = 0;
+    }
+    SelectionVector sel(n);
+    sel.SetAllTrue();
+    CHECK_OK(iter->PrepareBatch(n, DeltaIterator::PREPARE_FOR_APPLY));
+    CHECK_OK(iter->ApplyUpdates(0, block, sel));
+    CHECK_OK(iter->ApplyDeletes(&sel));
+    for (int i = 0; i < n; i++) {
+      if (!sel.IsRowSelected(i)) {
+        ret.emplace_back("<deleted>");
+      } else if (block == &strings) {
+        ret.push_back(strings[i].ToString());
+      } else {
+        ret.push_back(std::to_string(ints[i]));
+      }
+    }
+  }
+  return ret;
+}
+
+// Test that a DMS which also lays its updates out per column reads back the
+// same values and deletes as one which doesn't, as of several snapshots.
+TEST_F(TestDeltaMemStore, TestColumnarUpdates) {
+  FLAGS_deltamemstore_columnar_updates = true;
+  shared_ptr<DeltaMemStore> columnar;
+  ASSERT_OK(DeltaMemStore::Create(1, 0, new log::LogAnchorRegistry(),
+                                  MemTracker::GetRootTracker(), &columnar));
+  ASSERT_TRUE(columnar->has_column_layout());
+  ASSERT_FALSE(dms_->has_column_layout());
+
+  const int kNumRows = 300;
+  faststring update_buf;
+  RowChangeListEncoder update(&update_buf);
+  auto apply = [&](Timestamp ts, rowid_t row) {
+    ASSERT_OK(dms_->Update(ts, row, RowChangeList(update_buf), op_id_));
+    ASSERT_OK(columnar->Update(ts, row, RowChangeList(update_buf), op_id_));
+  };
+
+  // Update both columns of every row, then only the int column of every other
+  // row, twice in the same transaction for some of them, then delete some.
+  for (uint32_t i = 0; i < kNumRows; i++) {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    update.Reset();
+    uint32_t val = i * 10;
+    update.AddColumnUpdate(schema_.column(kIntColumn), schema_.column_id(kIntColumn), &val);
+    string str = Substitute("hello $0", i);
+    Slice s(str);
+    update.AddColumnUpdate(schema_.column(kStringColumn), schema_.column_id(kStringColumn), &s);
+    apply(tx.timestamp(), i);
+    tx.Commit();
+  }
+  MvccSnapshot snap_after_first_pass(mvcc_);
+
+  for (uint32_t i = 0; i < kNumRows; i += 2) {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    for (int j = 0; j < (i % 3 == 0 ? 2 : 1); j++) {
+      update.Reset();
+      uint32_t val = i * 20 + j;
+      update.AddColumnUpdate(schema_.column(kIntColumn), schema_.column_id(kIntColumn), &val);
+      apply(tx.timestamp(), i);
+    }
+    tx.Commit();
+  }
+  for (uint32_t i = 0; i < kNumRows; i += 7) {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    update.Reset();
+    update.SetToDelete();
+    apply(tx.timestamp(), i);
+    tx.Commit();
+  }
+  MvccSnapshot snap_after_deletes(mvcc_);
+
+  // An update which isn't committed shouldn't be visible.
+  ScopedTransaction uncommitted(&mvcc_, clock_->Now());
+  uncommitted.StartApplying();
+  update.Reset();
+  uint32_t val = 12345;
+  update.AddColumnUpdate(schema_.column(kIntColumn), schema_.column_id(kIntColumn), &val);
+  apply(uncommitted.timestamp(), 1);
+  MvccSnapshot snap_with_uncommitted(mvcc_);
+
+  ASSERT_EQ(dms_->Count(), columnar->Count());
+  for (const MvccSnapshot* snap : { &snap_after_first_pass,
+                                    &snap_after_deletes,
+                                    &snap_with_uncommitted }) {
+    for (size_t col_idx : { kStringColumn, kIntColumn }) {
+      SCOPED_TRACE(Substitute("$0, column $1", snap->ToString(), col_idx));
+      vector<string> expected = ReadColumn(dms_, schema_, *snap, col_idx, kNumRows, 64);
+      ASSERT_EQ(expected, ReadColumn(columnar, schema_, *snap, col_idx, kNumRows, 64));
+      ASSERT_EQ(expected, ReadColumn(columnar, schema_, *snap, col_idx, kNumRows, 7));
+    }
+  }
+
+  // Mixing batches prepared for apply and for collect on the same iterator
+  // keeps both layouts' iterators in the right place.
+  DeltaIterator* raw_iter;
+  ASSERT_OK(columnar->NewDeltaIterator(&schema_, snap_after_first_pass, &raw_iter));
+  gscoped_ptr<DeltaIterator> iter(raw_iter);
+  ASSERT_OK(iter->Init(nullptr));
+  ASSERT_OK(iter->SeekToOrdinal(0));
+  const int kBatchSize = 10;
+  for (int batch = 0; batch < 4; batch++) {
+    if (batch % 2 == 0) {
+      ScopedColumnBlock<UINT32> block(kBatchSize);
+      SelectionVector sel(kBatchSize);
+      sel.SetAllTrue();
+      ASSERT_OK(iter->PrepareBatch(kBatchSize, DeltaIterator::PREPARE_FOR_APPLY));
+      ASSERT_OK(iter->ApplyUpdates(kIntColumn, &block, sel));
+      for (int i = 0; i < kBatchSize; i++) {
+        ASSERT_EQ((batch * kBatchSize + i) * 10, block[i]);
+      }
+    } else {
+      Arena arena(1024, 1024);
+      vector<Mutation*> mutations(kBatchSize, nullptr);
+      ASSERT_OK(iter->PrepareBatch(kBatchSize, DeltaIterator::PREPARE_FOR_COLLECT));
+      ASSERT_OK(iter->CollectMutations(&mutations, &arena));
+      for (int i = 0; i < kBatchSize; i++) {
+        ASSERT_EQ(Substitute(R"([@$0(SET col3=$1, col2="hello $2")])",
+                             batch * kBatchSize + i + 1,
+                             (batch * kBatchSize + i) * 10,
+                             batch * kBatchSize + i),
+                  Mutation::StringifyMutationList(schema_, mutations[i]));
+      }
+    }
+  }
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -15,6 +15,8 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <gflags/gflags.h>
+#include <mutex>
 #include <utility>
 
 #include "kudu/consensus/consensus.pb.h"
@@ -22,17 +24,29 @@
 #include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/deltamemstore.h"
 #include "kudu/tablet/delta_tracker.h"
+#include "kudu/tablet/memrowset.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/tablet/tablet.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/hexdump.h"
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/status.h"
 
+DEFINE_bool(deltamemstore_columnar_updates, false,
+            "Whether DeltaMemStores also lay their updates out by column, so that "
+            "scans only touch the updates to the columns they project. This speeds "
+            "up reads of tables where a few columns are updated very often, at the "
+            "expense of keeping each update in memory twice. Only applies to "
+            "DeltaMemStores created after the flag is set.");
+TAG_FLAG(deltamemstore_columnar_updates, experimental);
+TAG_FLAG(deltamemstore_columnar_updates, runtime);
+
 namespace kudu {
 namespace tablet {
 
 using log::LogAnchorRegistry;
 using std::shared_ptr;
+using std::unique_ptr;
 using strings::Substitute;
 
 ////////////////////////////////////////////////////////////
@@ -62,13 +76,18 @@ DeltaMemStore::DeltaMemStore(int64_t id,
   : id_(id),
     rs_id_(rs_id),
     allocator_(new MemoryTrackingBufferAllocator(
-        HeapBufferAllocator::Get(), std::move(parent_tracker))),
+        MemStoreBufferAllocator(), std::move(parent_tracker))),
     arena_(new ThreadSafeMemoryTrackingArena(
         kInitialArenaSize, kMaxArenaBufferSize, allocator_)),
     tree_(arena_),
     anchorer_(log_anchor_registry,
               Substitute("Rowset-$0/DeltaMemStore-$1", rs_id_, id_)),
-    disambiguator_sequence_number_(0) {
+    disambiguator_sequence_number_(0),
+    delete_count_(0),
+    max_delete_timestamp_(Timestamp::kMin.ToUint64()) {
+  if (FLAGS_deltamemstore_columnar_updates) {
+    deletes_tree_.reset(new DMSTree(arena_));
+  }
 }
 
 Status DeltaMemStore::Init() {
@@ -100,15 +119,74 @@ Status DeltaMemStore::Update(Timestamp timestamp,
       << "Appended a sequence number but still hit a duplicate "
       << "for rowid " << row_idx << " at timestamp " << timestamp;
   }
+  if (update.is_delete()) {
+    max_delete_timestamp_.StoreMax(timestamp.ToUint64(), kMemOrderRelease);
+  }
   if (PREDICT_FALSE(!mutation.Insert(update.slice()))) {
     return Status::IOError("Unable to insert into tree");
   }
+  if (update.is_delete()) {
+    delete_count_.IncrementBy(1, kMemOrderRelease);
+  }
+  if (has_column_layout()) {
+    RETURN_NOT_OK(AddToColumnLayout(key_slice, update));
+  }
 
   anchorer_.AnchorIfMinimum(op_id.index());
 
   return Status::OK();
 }
 
+Status DeltaMemStore::AddToColumnLayout(const Slice& key, const RowChangeList& update) {
+  RowChangeListDecoder decoder(update);
+  RETURN_NOT_OK(decoder.Init());
+  DCHECK(!decoder.is_reinsert()) << "Reinserts are not supported in the DeltaMemStore.";
+  if (decoder.is_delete()) {
+    btree::PreparedMutation<DMSTreeTraits> mutation(key);
+    mutation.Prepare(deletes_tree_.get());
+    if (PREDICT_FALSE(!mutation.Insert(Slice()))) {
+      return Status::IOError("Unable to insert into deletes tree");
+    }
+    return Status::OK();
+  }
+
+  faststring val;
+  while (decoder.HasNext()) {
+    RowChangeListDecoder::DecodedUpdate dec;
+    RETURN_NOT_OK(decoder.DecodeNext(&dec));
+    val.clear();
+    val.push_back(dec.null ? 1 : 0);
+    val.append(dec.raw_value.data(), dec.raw_value.size());
+
+    btree::PreparedMutation<DMSTreeTraits> mutation(key);
+    mutation.Prepare(FindOrCreateColumnTree(dec.col_id));
+    if (PREDICT_FALSE(!mutation.Insert(Slice(val)))) {
+      return Status::IOError("Unable to insert into column tree");
+    }
+  }
+  return Status::OK();
+}
+
+const DeltaMemStore::DMSTree* DeltaMemStore::FindColumnTree(ColumnId col_id) const {
+  shared_lock<rw_spinlock> l(column_trees_lock_);
+  auto it = column_trees_.find(col_id);
+  return it == column_trees_.end() ? nullptr : it->second.get();
+}
+
+DeltaMemStore::DMSTree* DeltaMemStore::FindOrCreateColumnTree(ColumnId col_id) {
+  {
+    shared_lock<rw_spinlock> l(column_trees_lock_);
+    auto it = column_trees_.find(col_id);
+    if (it != column_trees_.end()) return it->second.get();
+  }
+  std::lock_guard<rw_spinlock> l(column_trees_lock_);
+  unique_ptr<DMSTree>& tree = column_trees_[col_id];
+  if (!tree) {
+    tree.reset(new DMSTree(arena_));
+  }
+  return tree.get();
+}
+
 Status DeltaMemStore::FlushToFile(DeltaFileWriter *dfw,
                                   gscoped_ptr<DeltaStats>* stats_ret) {
   gscoped_ptr<DeltaStats> stats(new DeltaStats());
@@ -192,20 +270,43 @@ DMSIterator::DMSIterator(const shared_ptr<const DeltaMemStore>& dms,
       prepared_count_(0),
       prepared_for_(NOT_PREPARED),
       seeked_(false),
-      projection_(projection) {}
-
-Status DMSIterator::Init(ScanSpec *spec) {
-  initted_ = true;
-  return Status::OK();
+      projection_(projection),
+      use_column_layout_(dms->has_column_layout()),
+      iter_row_(0),
+      layout_iters_row_(0),
+      layout_iters_seeked_(false) {
+  if (use_column_layout_) {
+    col_iters_.resize(projection_->num_columns());
+    for (int i = 0; i < projection_->num_columns(); i++) {
+      const DeltaMemStore::DMSTree* tree = dms->FindColumnTree(projection_->column_id(i));
+      if (tree != nullptr) {
+        col_iters_[i].reset(tree->NewIterator());
+      }
+    }
+    deletes_iter_.reset(dms->deletes_tree_->NewIterator());
+  }
 }
 
-Status DMSIterator::SeekToOrdinal(rowid_t row_idx) {
+// Positions 'iter' at the first delta for row 'row_idx' or a later row.
+static void SeekToRow(DeltaMemStore::DMSTreeIter* iter, rowid_t row_idx) {
   faststring buf;
   DeltaKey key(row_idx, Timestamp(0));
   key.EncodeTo(&buf);
 
   bool exact; /* unused */
-  iter_->SeekAtOrAfter(Slice(buf), &exact);
+  iter->SeekAtOrAfter(Slice(buf), &exact);
+}
+
+Status DMSIterator::Init(ScanSpec *spec) {
+  initted_ = true;
+  return Status::OK();
+}
+
+Status DMSIterator::SeekToOrdinal(rowid_t row_idx) {
+  SeekToRow(iter_.get(), row_idx);
+  iter_row_ = row_idx;
+  // The per-column iterators are only sought once needed.
+  layout_iters_seeked_ = false;
   prepared_idx_ = row_idx;
   prepared_count_ = 0;
   prepared_for_ = NOT_PREPARED;
@@ -239,6 +340,18 @@ Status DMSIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
   deleted_.clear();
   prepared_deltas_.clear();
 
+  if (flag == PREPARE_FOR_APPLY && use_column_layout_) {
+    RETURN_NOT_OK(PrepareBatchFromColumnLayout(start_row, stop_row));
+    prepared_idx_ = start_row;
+    prepared_count_ = nrows;
+    prepared_for_ = PREPARED_FOR_APPLY;
+    return Status::OK();
+  }
+
+  if (iter_row_ != start_row) {
+    // The previous batch was prepared from the per-column layout.
+    SeekToRow(iter_.get(), start_row);
+  }
   while (iter_->IsValid()) {
     Slice key_slice, val;
     iter_->GetCurrentEntry(&key_slice, &val);
@@ -303,13 +416,85 @@ Status DMSIterator::PrepareBatch(size_t nrows, PrepareFlag flag) {
 
     iter_->Next();
   }
+  iter_row_ = stop_row + 1;
   prepared_idx_ = start_row;
   prepared_count_ = nrows;
   prepared_for_ = flag == PREPARE_FOR_APPLY ? PREPARED_FOR_APPLY : PREPARED_FOR_COLLECT;
   return Status::OK();
 }
 
-Status DMSIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
+Status DMSIterator::PrepareBatchFromColumnLayout(rowid_t start_row, rowid_t stop_row) {
+  bool seek = !layout_iters_seeked_ || layout_iters_row_ != start_row;
+
+  for (int col_idx = 0; col_idx < col_iters_.size(); col_idx++) {
+    DeltaMemStore::DMSTreeIter* iter = col_iters_[col_idx].get();
+    if (iter == nullptr) continue;
+    if (seek) SeekToRow(iter, start_row);
+
+    const ColumnSchema& col = projection_->column(col_idx);
+    const bool is_binary = col.type_info()->physical_type() == BINARY;
+    const size_t col_size = col.type_info()->size();
+    UpdatesForColumn& updates = updates_by_col_[col_idx];
+    for (; iter->IsValid(); iter->Next()) {
+      Slice key_slice, val;
+      iter->GetCurrentEntry(&key_slice, &val);
+      DeltaKey key;
+      RETURN_NOT_OK(key.DecodeFrom(&key_slice));
+      DCHECK_GE(key.row_idx(), start_row);
+      if (key.row_idx() > stop_row) break;
+      if (!mvcc_snapshot_.IsCommitted(key.timestamp())) continue;
+
+      if (PREDICT_FALSE(val.empty() ||
+                        (!is_binary && val[0] == 0 && val.size() != col_size + 1))) {
+        return Status::Corruption(Substitute("bad update for column $0 in DMS",
+                                             col.ToString()));
+      }
+      const bool is_null = val[0] != 0;
+      if (PREDICT_FALSE(is_null && !col.is_nullable())) {
+        return Status::Corruption(Substitute("NULL update for non-nullable column $0 in DMS",
+                                             col.ToString()));
+      }
+
+      // As in PrepareBatch(), a later update to the same row overwrites an
+      // earlier one.
+      if (updates.empty() || updates.back().row_id != key.row_idx()) {
+        updates.push_back(ColumnUpdate());
+      }
+      ColumnUpdate& cu = updates.back();
+      cu.row_id = key.row_idx();
+      if (is_null) {
+        cu.new_val_ptr = nullptr;
+      } else {
+        // The value lives in the DMS arena, so for strings it's enough to
+        // point at it.
+        Slice new_val(val.data() + 1, val.size() - 1);
+        if (is_binary) {
+          memcpy(cu.new_val_buf, &new_val, sizeof(Slice));
+        } else {
+          memcpy(cu.new_val_buf, new_val.data(), col_size);
+        }
+        cu.new_val_ptr = cu.new_val_buf;
+      }
+    }
+  }
+
+  if (seek) SeekToRow(deletes_iter_.get(), start_row);
+  for (; deletes_iter_->IsValid(); deletes_iter_->Next()) {
+    Slice key_slice = deletes_iter_->GetCurrentKey();
+    DeltaKey key;
+    RETURN_NOT_OK(key.DecodeFrom(&key_slice));
+    if (key.row_idx() > stop_row) break;
+    if (!mvcc_snapshot_.IsCommitted(key.timestamp())) continue;
+    deleted_.push_back(key.row_idx());
+  }
+
+  layout_iters_row_ = stop_row + 1;
+  layout_iters_seeked_ = true;
+  return Status::OK();
+}
+
+Status DMSIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                                 const SelectionVector& filter) {
   DCHECK_EQ(prepared_for_, PREPARED_FOR_APPLY);
   DCHECK_EQ(prepared_count_, dst->nrows());
 
@@ -317,6 +502,9 @@ Status DMSIterator::ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) {
   for (const ColumnUpdate& cu : updates_by_col_[col_to_apply]) {
     int32_t idx_in_block = cu.row_id - prepared_idx_;
     DCHECK_GE(idx_in_block, 0);
+    if (!filter.IsRowSelected(idx_in_block)) {
+      continue;
+    }
     SimpleConstCell src(col_schema, cu.new_val_ptr);
     ColumnBlock::Cell dst_cell = dst->cell(idx_in_block);
     RETURN_NOT_OK(CopyCell(src, &dst_cell, dst->arena()));
@@ -378,6 +566,15 @@ bool DMSIterator::MayHaveDeltas() {
   return false;
 }
 
+Status DMSIterator::CollectColumnIdsWithUpdates(std::set<ColumnId>* /* col_ids */,
+                                                bool* all_columns) {
+  // The DeltaMemStore doesn't keep track of the columns it updates.
+  if (!dms_->Empty()) {
+    *all_columns = true;
+  }
+  return Status::OK();
+}
+
 string DMSIterator::ToString() const {
   return "DMSIterator";
 }
@@ -19,6 +19,7 @@
 
 #include <deque>
 #include <gtest/gtest_prod.h>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -36,6 +37,7 @@
 #include "kudu/tablet/delta_stats.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
 #include "kudu/util/memory/arena.h"
 
 namespace kudu {
@@ -57,6 +59,14 @@ struct DMSTreeTraits : public btree::BTreeTraits {
 // In-memory storage for data which has been recently updated.
 // This essentially tracks a 'diff' per row, which contains the
 // modified columns.
+//
+// With --deltamemstore_columnar_updates, the updates are additionally laid
+// out per column: each updated column gets a tree of its own, keyed like the
+// main tree but holding only that column's new values, and deletes are kept
+// in a separate tree. Applying the deltas of a projection then only touches
+// the updates to the projected columns, rather than decoding the change list
+// of every updated row. The main tree still holds every change list, and
+// remains what flushes, mutation collection and deletion checks read.
 
 class DeltaMemStore : public DeltaStore,
                       public std::enable_shared_from_this<DeltaMemStore> {
@@ -87,6 +97,19 @@ class DeltaMemStore : public DeltaStore,
     return tree_.empty();
   }
 
+  // Returns the number of DELETE mutations in this DMS, and sets
+  // 'max_timestamp' to the maximum timestamp of any of them which may be
+  // counted (Timestamp::kMin if there are none).
+  //
+  // A concurrent delete may be missed, but only if it isn't reflected in
+  // 'max_timestamp' either, so it can only be missed by readers of snapshots
+  // in which it isn't committed.
+  int64_t CountDeletes(Timestamp* max_timestamp) const {
+    int64_t count = delete_count_.Load(kMemOrderAcquire);
+    *max_timestamp = Timestamp(max_delete_timestamp_.Load(kMemOrderAcquire));
+    return count;
+  }
+
   // Dump a debug version of the tree to the logs. This is not thread-safe, so
   // is only really useful in unit tests.
   void DebugPrint() const;
@@ -136,6 +159,11 @@ class DeltaMemStore : public DeltaStore,
     return delta_stats_;
   }
 
+  // Whether updates are also laid out per column. Fixed at construction.
+  bool has_column_layout() const {
+    return deletes_tree_ != nullptr;
+  }
+
  private:
   friend class DMSIterator;
 
@@ -148,6 +176,17 @@ class DeltaMemStore : public DeltaStore,
     return tree_;
   }
 
+  // Adds 'update', stored in the main tree under 'key', to the per-column
+  // trees.
+  Status AddToColumnLayout(const Slice& key, const RowChangeList& update);
+
+  // Returns the per-column tree of updates to 'col_id', or NULL if that
+  // column hasn't been updated.
+  const DMSTree* FindColumnTree(ColumnId col_id) const;
+
+  // Like FindColumnTree(), but creates the tree if it doesn't exist.
+  DMSTree* FindOrCreateColumnTree(ColumnId col_id);
+
   const int64_t id_;    // DeltaMemStore ID.
   const int64_t rs_id_; // Rowset ID.
 
@@ -158,6 +197,16 @@ class DeltaMemStore : public DeltaStore,
   // Concurrent B-Tree storing <key index> -> RowChangeList
   DMSTree tree_;
 
+  // The per-column layout, if enabled.
+  //
+  // Each column tree maps the same keys as 'tree_' to a single byte, set if
+  // the column was set to NULL, followed by the column's new value (the
+  // string itself for BINARY columns). 'deletes_tree_' holds an empty value
+  // for each delete.
+  gscoped_ptr<DMSTree> deletes_tree_;
+  mutable rw_spinlock column_trees_lock_;
+  std::map<ColumnId, std::unique_ptr<DMSTree>> column_trees_;
+
   log::MinLogIndexAnchorer anchorer_;
 
   const DeltaStats delta_stats_;
@@ -170,6 +219,11 @@ class DeltaMemStore : public DeltaStore,
   // number, and is only used in the case that such a collision occurs.
   AtomicInt<Atomic32> disambiguator_sequence_number_;
 
+  // The number of DELETE mutations, and the maximum timestamp of any of them,
+  // which is raised before a delete is inserted (see CountDeletes()).
+  AtomicInt<int64_t> delete_count_;
+  AtomicInt<uint64_t> max_delete_timestamp_;
+
   DISALLOW_COPY_AND_ASSIGN(DeltaMemStore);
 };
 
@@ -190,7 +244,8 @@ class DMSIterator : public DeltaIterator {
 
   Status PrepareBatch(size_t nrows, PrepareFlag flag) OVERRIDE;
 
-  Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst) OVERRIDE;
+  Status ApplyUpdates(size_t col_to_apply, ColumnBlock *dst,
+                      const SelectionVector& filter) OVERRIDE;
 
   Status ApplyDeletes(SelectionVector *sel_vec) OVERRIDE;
 
@@ -206,6 +261,8 @@ class DMSIterator : public DeltaIterator {
 
   bool MayHaveDeltas() override;
 
+  Status CollectColumnIdsWithUpdates(std::set<ColumnId>* col_ids, bool* all_columns) override;
+
  private:
   DISALLOW_COPY_AND_ASSIGN(DMSIterator);
   FRIEND_TEST(TestDeltaMemStore, TestIteratorDoesUpdates);
@@ -219,6 +276,10 @@ class DMSIterator : public DeltaIterator {
   DMSIterator(const std::shared_ptr<const DeltaMemStore> &dms,
               const Schema *projection, MvccSnapshot snapshot);
 
+  // Prepares the rows [start_row, stop_row] for apply from the per-column
+  // layout of the DMS.
+  Status PrepareBatchFromColumnLayout(rowid_t start_row, rowid_t stop_row);
+
   const std::shared_ptr<const DeltaMemStore> dms_;
 
   // MVCC state which allows us to ignore uncommitted transactions.
@@ -270,6 +331,23 @@ class DMSIterator : public DeltaIterator {
   // Temporary buffer used for RowChangeList projection.
   faststring delta_buf_;
 
+  // Whether the DMS has a per-column layout. If so, batches prepared for
+  // apply are read from the iterators below instead of 'iter_'.
+  const bool use_column_layout_;
+
+  // Iterators over the per-column tree of each projected column (NULL for
+  // columns without updates) and over the deletes tree. A column tree created
+  // after this iterator only holds updates which aren't committed in its
+  // snapshot, so it's safe to pick the trees up once, at construction.
+  std::vector<std::unique_ptr<DeltaMemStore::DMSTreeIter>> col_iters_;
+  gscoped_ptr<DeltaMemStore::DMSTreeIter> deletes_iter_;
+
+  // The row at which 'iter_' and the iterators above are positioned,
+  // respectively, since batches prepared for apply and for collect advance
+  // different iterators.
+  rowid_t iter_row_;
+  rowid_t layout_iters_row_;
+  bool layout_iters_seeked_;
 };
 
 } // namespace tablet
@@ -69,7 +69,12 @@ class TestRowSet : public KuduRowSetTest {
   static Schema CreateTestSchema() {
     SchemaBuilder builder;
     CHECK_OK(builder.AddKeyColumn("key", STRING));
-    CHECK_OK(builder.AddColumn("val", UINT32));
+    // The value column carries a value bloom filter so that the rowset
+    // tests also cover the bloom write path and its interaction with deltas.
+    ColumnStorageAttributes val_attrs;
+    val_attrs.bloom_filter = true;
+    CHECK_OK(builder.AddColumn(ColumnSchema("val", UINT32, false, nullptr, nullptr,
+                                            val_attrs), false));
     return builder.BuildWithoutIds();
   }
 
@@ -36,6 +36,8 @@
 DEFINE_double(update_fraction, 0.1f, "fraction of rows to update");
 DECLARE_bool(cfile_lazy_open);
 DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(flush_column_writer_min_columns_per_thread);
+DECLARE_int32(flush_column_writer_threads);
 DECLARE_double(tablet_delta_store_major_compact_min_ratio);
 DECLARE_int32(tablet_delta_store_minor_compact_max);
 
@@ -127,6 +129,22 @@ TEST_F(TestRowSet, TestRowSetRoundTrip) {
   }
 }
 
+// Test round-trip writing and reading back a rowset whose columns are
+// written by different threads.
+TEST_F(TestRowSet, TestRowSetRoundTripParallelColumns) {
+  FLAGS_flush_column_writer_threads = 4;
+  FLAGS_flush_column_writer_min_columns_per_thread = 1;
+  // Use small blocks so that many of them are compressed and flushed by
+  // the pool's threads.
+  FLAGS_cfile_default_block_size = 512;
+  WriteTestRowSet();
+
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+  IterateProjection(*rs, schema_, n_rows_);
+  NO_FATALS(VerifyUpdates(*rs, unordered_set<uint32_t>()));
+}
+
 // Test writing a rowset, and then updating some rows in it.
 TEST_F(TestRowSet, TestRowSetUpdate) {
   WriteTestRowSet();
@@ -199,6 +217,91 @@ TEST_F(TestRowSet, TestRandomRead) {
   NO_FATALS();
 }
 
+// Test that the value bloom filter on the 'val' column does not hide rows
+// whose value was changed by an update, whether the update is still in the
+// DMS or has been flushed to a delta file.
+TEST_F(TestRowSet, TestValueBloomWithUpdates) {
+  WriteTestRowSet(100);
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  const uint32_t kNewVal = 12345;
+  auto count_rows_scanned = [&]() {
+    Arena arena(256, 1024);
+    AutoReleasePool pool;
+    ScanSpec spec;
+    spec.AddPredicate(ColumnPredicate::Equality(schema_.column(1), &kNewVal));
+    spec.OptimizeScan(schema_, &arena, &pool, false);
+
+    MvccSnapshot snap = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+    gscoped_ptr<RowwiseIterator> row_iter;
+    CHECK_OK(rs->NewRowIterator(&schema_, snap, UNORDERED, &row_iter));
+    CHECK_OK(row_iter->Init(&spec));
+    vector<string> rows;
+    CHECK_OK(IterateToStringList(row_iter.get(), &rows));
+    return rows.size();
+  };
+
+  // No row has the value yet, so the bloom filter rules out the whole rowset.
+  ASSERT_EQ(0, count_rows_scanned());
+
+  // Once a row is updated to the value, the rowset must be scanned again.
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(rs.get(), 50, kNewVal, &result));
+  ASSERT_GT(count_rows_scanned(), 0);
+
+  ASSERT_OK(rs->FlushDeltas());
+  ASSERT_GT(count_rows_scanned(), 0);
+}
+
+// Test that a scan only goes through the delta layer when a delta store may
+// change the rows it reads.
+TEST_F(TestRowSet, TestScanSkipsIrrelevantDeltas) {
+  WriteTestRowSet(100);
+  shared_ptr<DiskRowSet> rs;
+  ASSERT_OK(OpenTestRowSet(&rs));
+
+  Schema key_projection = schema_.CreateKeyProjection();
+  MvccSnapshot snap_all = MvccSnapshot::CreateSnapshotIncludingAllTransactions();
+  MvccSnapshot snap_none = MvccSnapshot::CreateSnapshotIncludingNoTransactions();
+  auto has_delta_layer = [&](const Schema& projection, const MvccSnapshot& snap) {
+    gscoped_ptr<RowwiseIterator> row_iter;
+    CHECK_OK(rs->NewRowIterator(&projection, snap, UNORDERED, &row_iter));
+    return row_iter->ToString().find("DeltaApplier") != string::npos;
+  };
+  auto count_rows = [&](const Schema& projection) {
+    gscoped_ptr<RowwiseIterator> row_iter;
+    CHECK_OK(rs->NewRowIterator(&projection, snap_all, UNORDERED, &row_iter));
+    CHECK_OK(row_iter->Init(nullptr));
+    vector<string> rows;
+    CHECK_OK(IterateToStringList(row_iter.get(), &rows));
+    return rows.size();
+  };
+  ASSERT_FALSE(has_delta_layer(schema_, snap_all));
+
+  // Any scan may be affected by the updates in the DMS.
+  OperationResultPB result;
+  ASSERT_OK(UpdateRow(rs.get(), 50, 12345, &result));
+  ASSERT_TRUE(has_delta_layer(key_projection, snap_all));
+
+  // The flushed delta file is opened lazily: its stats, which show the scans
+  // its updates affect, are only known once a scan has read it.
+  ASSERT_OK(rs->FlushDeltas());
+  ASSERT_TRUE(has_delta_layer(key_projection, snap_all));
+  ASSERT_EQ(100, count_rows(schema_));
+  ASSERT_TRUE(has_delta_layer(schema_, snap_all));
+  ASSERT_FALSE(has_delta_layer(key_projection, snap_all));
+  ASSERT_FALSE(has_delta_layer(schema_, snap_none));
+  ASSERT_EQ(100, count_rows(key_projection));
+
+  // A delete affects the scans of any column.
+  ASSERT_OK(DeleteRow(rs.get(), 10, &result));
+  ASSERT_OK(rs->FlushDeltas());
+  ASSERT_EQ(99, count_rows(schema_));
+  ASSERT_TRUE(has_delta_layer(key_projection, snap_all));
+  ASSERT_EQ(99, count_rows(key_projection));
+}
+
 // Test Delete() support within a DiskRowSet.
 TEST_F(TestRowSet, TestDelete) {
   // Write and open a DiskRowSet with 2 rows.
@@ -52,6 +52,16 @@ DEFINE_double(tablet_delta_store_major_compact_min_ratio, 0.1f,
              "can run (Advanced option)");
 TAG_FLAG(tablet_delta_store_major_compact_min_ratio, experimental);
 
+DEFINE_double(tablet_delta_store_major_compact_deltas_only_max_update_ratio, 0,
+              "If positive, a major delta compaction whose REDO deltas hold fewer updates "
+              "of the compacted columns than this fraction of the rowset's rows, mostly "
+              "older than the ancient history mark, leaves the base data alone. It "
+              "rewrites the REDO deltas instead, merging the ancient updates of each row "
+              "into one, so that a few heavily updated rows don't cause rewrites of "
+              "whole columns.");
+TAG_FLAG(tablet_delta_store_major_compact_deltas_only_max_update_ratio, experimental);
+TAG_FLAG(tablet_delta_store_major_compact_deltas_only_max_update_ratio, runtime);
+
 DEFINE_int32(default_composite_key_index_block_size_bytes, 4096,
              "Block size used for composite key indexes.");
 TAG_FLAG(default_composite_key_index_block_size_bytes, experimental);
@@ -66,18 +76,26 @@ using log::LogAnchorRegistry;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 const char *DiskRowSet::kMinKeyMetaEntryName = "min_key";
 const char *DiskRowSet::kMaxKeyMetaEntryName = "max_key";
 
 DiskRowSetWriter::DiskRowSetWriter(RowSetMetadata* rowset_metadata,
                                    const Schema* schema,
-                                   BloomFilterSizing bloom_sizing)
+                                   BloomFilterSizing bloom_sizing,
+                                   bool cache_written_blocks,
+                                   scoped_refptr<cfile::BlockCacheAttribution>
+                                       block_cache_attribution)
     : rowset_metadata_(rowset_metadata),
       schema_(schema),
       bloom_sizing_(std::move(bloom_sizing)),
+      cache_written_blocks_(cache_written_blocks),
+      block_cache_attribution_(std::move(block_cache_attribution)),
       finished_(false),
-      written_count_(0) {
+      written_count_(0),
+      key_encoder_(schema),
+      key_arena_(32 * 1024, 1024 * 1024) {
   CHECK(schema->has_column_ids());
 }
 
@@ -85,7 +103,9 @@ Status DiskRowSetWriter::Open() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::Open");
 
   FsManager* fs = rowset_metadata_->fs_manager();
-  col_writer_.reset(new MultiColumnWriter(fs, schema_));
+  col_writer_.reset(new MultiColumnWriter(fs, schema_, cache_written_blocks_,
+                                          block_cache_attribution_,
+                                          rowset_metadata_->block_create_options()));
   RETURN_NOT_OK(col_writer_->Open());
 
   // Open bloom filter.
@@ -103,11 +123,13 @@ Status DiskRowSetWriter::InitBloomFileWriter() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::InitBloomFileWriter");
   gscoped_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(rowset_metadata_->block_create_options(), &block),
                         "Couldn't allocate a block for bloom filter");
   rowset_metadata_->set_bloom_block(block->id());
 
-  bloom_writer_.reset(new cfile::BloomFileWriter(std::move(block), bloom_sizing_));
+  bloom_writer_.reset(new cfile::BloomFileWriter(std::move(block), bloom_sizing_,
+                                                 cache_written_blocks_,
+                                                 block_cache_attribution_));
   RETURN_NOT_OK(bloom_writer_->Start());
   return Status::OK();
 }
@@ -116,7 +138,7 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
   TRACE_EVENT0("tablet", "DiskRowSetWriter::InitAdHocIndexWriter");
   gscoped_ptr<WritableBlock> block;
   FsManager* fs = rowset_metadata_->fs_manager();
-  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(&block),
+  RETURN_NOT_OK_PREPEND(fs->CreateNewBlock(rowset_metadata_->block_create_options(), &block),
                         "Couldn't allocate a block for compoound index");
 
   rowset_metadata_->set_adhoc_index_block(block->id());
@@ -138,6 +160,9 @@ Status DiskRowSetWriter::InitAdHocIndexWriter() {
   opts.storage_attributes.compression = LZ4;
   opts.storage_attributes.cfile_block_size = FLAGS_default_composite_key_index_block_size_bytes;
 
+  opts.cache_written_blocks = cache_written_blocks_;
+  opts.block_cache_attribution = block_cache_attribution_;
+
   // Create the CFile writer for the ad-hoc index.
   ad_hoc_index_writer_.reset(new cfile::CFileWriter(
       opts,
@@ -152,46 +177,43 @@ Status DiskRowSetWriter::AppendBlock(const RowBlock &block) {
   DCHECK_EQ(block.schema().num_columns(), schema_->num_columns());
   CHECK(!finished_);
 
-  // If this is the very first block, encode the first key and save it as metadata
-  // in the index column.
+  if (block.nrows() == 0) {
+    return Status::OK();
+  }
+
+  // Encode the keys of the whole batch at once.
+  key_arena_.Reset();
+  RETURN_NOT_OK(key_encoder_.EncodeKeys(block, &key_arena_, &encoded_keys_));
+
+  // If this is the very first block, save the first key as metadata in the
+  // index column.
   if (written_count_ == 0) {
-    Slice enc_key = schema_->EncodeComparableKey(block.row(0), &last_encoded_key_);
-    key_index_writer()->AddMetadataPair(DiskRowSet::kMinKeyMetaEntryName, enc_key);
-    last_encoded_key_.clear();
+    key_index_writer()->AddMetadataPair(DiskRowSet::kMinKeyMetaEntryName, encoded_keys_[0]);
   }
 
   // Write the batch to each of the columns
   RETURN_NOT_OK(col_writer_->AppendBlock(block));
 
 #ifndef NDEBUG
-    faststring prev_key;
+  Slice prev_key(last_encoded_key_);
+  for (const Slice& enc_key : encoded_keys_) {
+    CHECK_LT(prev_key.compare(enc_key), 0)
+      << KUDU_REDACT(enc_key.ToDebugString()) << " appended to file not > previous key "
+      << KUDU_REDACT(prev_key.ToDebugString());
+    prev_key = enc_key;
+  }
 #endif
 
   // Write the batch to the bloom and optionally the ad-hoc index
-  for (size_t i = 0; i < block.nrows(); i++) {
-#ifndef NDEBUG
-    prev_key.assign_copy(last_encoded_key_.data(), last_encoded_key_.size());
-#endif
-
-    // TODO: performance might be better if we actually batch this -
-    // encode a bunch of key slices, then pass them all in one go.
-    RowBlockRow row = block.row(i);
-    // Insert the encoded key into the bloom.
-    Slice enc_key = schema_->EncodeComparableKey(row, &last_encoded_key_);
-    RETURN_NOT_OK(bloom_writer_->AppendKeys(&enc_key, 1));
-
-    // Write the batch to the ad hoc index if we're using one
-    if (ad_hoc_index_writer_ != nullptr) {
-      RETURN_NOT_OK(ad_hoc_index_writer_->AppendEntries(&enc_key, 1));
-    }
-
-#ifndef NDEBUG
-    CHECK_LT(Slice(prev_key).compare(enc_key), 0)
-      << KUDU_REDACT(enc_key.ToDebugString()) << " appended to file not > previous key "
-      << KUDU_REDACT(Slice(prev_key).ToDebugString());
-#endif
+  RETURN_NOT_OK(bloom_writer_->AppendKeys(encoded_keys_.data(), encoded_keys_.size()));
+  if (ad_hoc_index_writer_ != nullptr) {
+    RETURN_NOT_OK(ad_hoc_index_writer_->AppendEntries(encoded_keys_.data(),
+                                                      encoded_keys_.size()));
   }
 
+  const Slice& last_key = encoded_keys_.back();
+  last_encoded_key_.assign_copy(last_key.data(), last_key.size());
+
   written_count_ += block.nrows();
 
   return Status::OK();
@@ -279,12 +301,18 @@ DiskRowSetWriter::~DiskRowSetWriter() {
 
 RollingDiskRowSetWriter::RollingDiskRowSetWriter(
     TabletMetadata* tablet_metadata, const Schema& schema,
-    BloomFilterSizing bloom_sizing, size_t target_rowset_size)
+    BloomFilterSizing bloom_sizing, size_t target_rowset_size,
+    bool cache_written_blocks,
+    scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution,
+    bool cold)
     : state_(kInitialized),
       tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       schema_(schema),
       bloom_sizing_(std::move(bloom_sizing)),
       target_rowset_size_(target_rowset_size),
+      cache_written_blocks_(cache_written_blocks),
+      block_cache_attribution_(std::move(block_cache_attribution)),
+      cold_(cold),
       row_idx_in_cur_drs_(0),
       can_roll_(false),
       written_count_(0),
@@ -307,15 +335,18 @@ Status RollingDiskRowSetWriter::RollWriter() {
   RETURN_NOT_OK(FinishCurrentWriter());
 
   RETURN_NOT_OK(tablet_metadata_->CreateRowSet(&cur_drs_metadata_, schema_));
+  cur_drs_metadata_->set_cold(cold_);
 
-  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_));
+  cur_writer_.reset(new DiskRowSetWriter(cur_drs_metadata_.get(), &schema_, bloom_sizing_,
+                                         cache_written_blocks_, block_cache_attribution_));
   RETURN_NOT_OK(cur_writer_->Open());
 
   FsManager* fs = tablet_metadata_->fs_manager();
   gscoped_ptr<WritableBlock> undo_data_block;
   gscoped_ptr<WritableBlock> redo_data_block;
-  RETURN_NOT_OK(fs->CreateNewBlock(&undo_data_block));
-  RETURN_NOT_OK(fs->CreateNewBlock(&redo_data_block));
+  fs::CreateBlockOptions block_opts = cur_drs_metadata_->block_create_options();
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &undo_data_block));
+  RETURN_NOT_OK(fs->CreateNewBlock(block_opts, &redo_data_block));
   cur_undo_ds_block_id_ = undo_data_block->id();
   cur_redo_ds_block_id_ = redo_data_block->id();
   cur_undo_writer_.reset(new DeltaFileWriter(std::move(undo_data_block)));
@@ -410,7 +441,8 @@ Status RollingDiskRowSetWriter::FinishCurrentWriter() {
     Status s = cur_undo_writer_->FinishAndReleaseBlock(&block_closer_);
     if (!s.IsAborted()) {
       RETURN_NOT_OK(s);
-      cur_drs_metadata_->CommitUndoDeltaDataBlock(cur_undo_ds_block_id_);
+      cur_drs_metadata_->CommitUndoDeltaDataBlock(cur_undo_ds_block_id_,
+                                                  cur_undo_delta_stats->max_timestamp());
     } else {
       DCHECK_EQ(cur_undo_delta_stats->min_timestamp(), Timestamp::kMax);
     }
@@ -419,7 +451,9 @@ Status RollingDiskRowSetWriter::FinishCurrentWriter() {
     s = cur_redo_writer_->FinishAndReleaseBlock(&block_closer_);
     if (!s.IsAborted()) {
       RETURN_NOT_OK(s);
-      cur_drs_metadata_->CommitRedoDeltaDataBlock(0, cur_redo_ds_block_id_);
+      RowSetMetadata::RedoDeltaSummary summary = { cur_redo_delta_stats->max_timestamp(),
+                                                   cur_redo_delta_stats->delete_count() };
+      cur_drs_metadata_->CommitRedoDeltaDataBlock(0, cur_redo_ds_block_id_, &summary);
     } else {
       DCHECK_EQ(cur_redo_delta_stats->min_timestamp(), Timestamp::kMax);
     }
@@ -481,12 +515,14 @@ DiskRowSet::DiskRowSet(shared_ptr<RowSetMetadata> rowset_metadata,
     : rowset_metadata_(std::move(rowset_metadata)),
       open_(false),
       log_anchor_registry_(log_anchor_registry),
-      mem_trackers_(mem_trackers) {}
+      mem_trackers_(mem_trackers),
+      force_base_data_rewrite_(false) {}
 
 Status DiskRowSet::Open() {
   TRACE_EVENT0("tablet", "DiskRowSet::Open");
   RETURN_NOT_OK(CFileSet::Open(rowset_metadata_,
                                mem_trackers_.tablet_tracker,
+                               mem_trackers_.block_cache_attribution,
                                &base_data_));
 
   rowid_t num_rows;
@@ -544,22 +580,69 @@ Status DiskRowSet::MajorCompactDeltaStoresWithColumnIds(const vector<ColumnId>&
   // delta tracker's stores. Those stores should match the blocks in the
   // metadata so, since we've already updated the metadata, we use CHECK_OK
   // here.
+  bool rewrote_base_data = compaction->mode() == MajorDeltaCompaction::REWRITE_BASE_DATA;
   shared_ptr<CFileSet> new_base;
-  RETURN_NOT_OK(CFileSet::Open(rowset_metadata_,
-                               mem_trackers_.tablet_tracker,
-                               &new_base));
+  if (rewrote_base_data) {
+    RETURN_NOT_OK(CFileSet::Open(rowset_metadata_,
+                                 mem_trackers_.tablet_tracker,
+                                 mem_trackers_.block_cache_attribution,
+                                 &new_base));
+  }
   {
     std::lock_guard<percpu_rwlock> lock(component_lock_);
     CHECK_OK(compaction->UpdateDeltaTracker(delta_tracker_.get()));
-    base_data_.swap(new_base);
+    if (rewrote_base_data) {
+      base_data_.swap(new_base);
+    }
   }
 
+  // If rewriting the deltas merged away less than half of them, doing it
+  // again is unlikely to be better: rewrite the base data next time.
+  force_base_data_rewrite_ = !rewrote_base_data &&
+      compaction->redo_delta_mutations_merged() * 2 < compaction->redo_delta_mutations_read();
+
   // We don't CHECK_OK on Flush here because if we don't successfully flush we
   // don't have consistency problems in the case of major delta compaction --
   // we are not adding additional mutations that weren't already present.
   return rowset_metadata_->Flush();
 }
 
+bool DiskRowSet::ShouldRewriteDeltasOnly(const vector<ColumnId>& col_ids,
+                                         const SharedDeltaStoreVector& stores,
+                                         const HistoryGcOpts& history_gc_opts) const {
+  double max_update_ratio = FLAGS_tablet_delta_store_major_compact_deltas_only_max_update_ratio;
+  if (max_update_ratio <= 0 || force_base_data_rewrite_) {
+    return false;
+  }
+
+  // Count the updates of the compacted columns, and those in stores which
+  // are entirely ancient history.
+  int64_t updates = 0;
+  int64_t ancient_updates = 0;
+  for (const shared_ptr<DeltaStore>& store : stores) {
+    if (!store->Init().ok()) {
+      return false;
+    }
+    const DeltaStats& stats = store->delta_stats();
+    int64_t store_updates = 0;
+    for (ColumnId col_id : col_ids) {
+      store_updates += stats.update_count_for_col_id(col_id);
+    }
+    updates += store_updates;
+    if (history_gc_opts.IsAncientHistory(stats.max_timestamp())) {
+      ancient_updates += store_updates;
+    }
+  }
+
+  rowid_t num_rows;
+  if (!base_data_->CountRows(&num_rows).ok()) {
+    return false;
+  }
+  return ancient_updates > 0 &&
+      ancient_updates * 2 >= updates &&
+      updates < num_rows * max_update_ratio;
+}
+
 Status DiskRowSet::NewMajorDeltaCompaction(const vector<ColumnId>& col_ids,
                                            HistoryGcOpts history_gc_opts,
                                            gscoped_ptr<MajorDeltaCompaction>* out) const {
@@ -577,13 +660,18 @@ Status DiskRowSet::NewMajorDeltaCompaction(const vector<ColumnId>& col_ids,
     &included_stores,
     &delta_iter));
 
+  MajorDeltaCompaction::Mode mode =
+      ShouldRewriteDeltasOnly(col_ids, included_stores, history_gc_opts) ?
+      MajorDeltaCompaction::REWRITE_DELTAS_ONLY : MajorDeltaCompaction::REWRITE_BASE_DATA;
   out->reset(new MajorDeltaCompaction(rowset_metadata_->fs_manager(),
                                       *schema,
                                       base_data_.get(),
                                       std::move(delta_iter),
                                       std::move(included_stores),
                                       col_ids,
-                                      std::move(history_gc_opts)));
+                                      std::move(history_gc_opts),
+                                      mode,
+                                      rowset_metadata_->block_create_options()));
   return Status::OK();
 }
 
@@ -595,11 +683,10 @@ Status DiskRowSet::NewRowIterator(const Schema *projection,
   shared_lock<rw_spinlock> l(component_lock_.get_lock());
 
   shared_ptr<CFileSet::Iterator> base_iter(base_data_->NewIterator(projection));
-  gscoped_ptr<ColumnwiseIterator> col_iter;
+  shared_ptr<ColumnwiseIterator> col_iter;
   RETURN_NOT_OK(delta_tracker_->WrapIterator(base_iter, mvcc_snap, &col_iter));
 
-  out->reset(new MaterializingIterator(
-      shared_ptr<ColumnwiseIterator>(col_iter.release())));
+  out->reset(new MaterializingIterator(std::move(col_iter)));
   return Status::OK();
 }
 
@@ -654,6 +741,25 @@ Status DiskRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+Status DiskRowSet::CheckRowsPresent(const RowSetKeyProbe* const* probes, int num_probes,
+                                    bool* present, ProbeStats* const* stats) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
+
+  std::vector<rowid_t> row_idxs(num_probes);
+  RETURN_NOT_OK(base_data_->CheckRowsPresent(probes, num_probes, present,
+                                             row_idxs.data(), stats));
+  // Rows in the base data might have been deleted since.
+  for (int i = 0; i < num_probes; i++) {
+    if (present[i]) {
+      bool deleted = false;
+      RETURN_NOT_OK(delta_tracker_->CheckRowDeleted(row_idxs[i], &deleted, stats[i]));
+      present[i] = !deleted;
+    }
+  }
+  return Status::OK();
+}
+
 Status DiskRowSet::CountRows(rowid_t *count) const {
   DCHECK(open_);
   shared_lock<rw_spinlock> l(component_lock_.get_lock());
@@ -661,6 +767,28 @@ Status DiskRowSet::CountRows(rowid_t *count) const {
   return base_data_->CountRows(count);
 }
 
+bool DiskRowSet::CountLiveRowsFromMetadata(const MvccSnapshot& snap, rowid_t* count) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
+
+  rowid_t num_rows;
+  int64_t num_deleted;
+  if (!base_data_->CountRows(&num_rows).ok() ||
+      !delta_tracker_->CountDeletedRowsNoInit(snap, &num_deleted)) {
+    return false;
+  }
+  DCHECK_LE(num_deleted, num_rows);
+  *count = num_rows - num_deleted;
+  return true;
+}
+
+Status DiskRowSet::MergeColumnStatistics(ColumnId col_id, ColumnStatistics* stats,
+                                         bool* found) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
+  return base_data_->MergeColumnStatistics(col_id, stats, found);
+}
+
 Status DiskRowSet::GetBounds(std::string* min_encoded_key,
                              std::string* max_encoded_key) const {
   DCHECK(open_);
@@ -668,6 +796,12 @@ Status DiskRowSet::GetBounds(std::string* min_encoded_key,
   return base_data_->GetBounds(min_encoded_key, max_encoded_key);
 }
 
+Status DiskRowSet::SampleKeys(int num_samples, vector<string>* encoded_keys) const {
+  DCHECK(open_);
+  shared_lock<rw_spinlock> l(component_lock_.get_lock());
+  return base_data_->SampleKeys(num_samples, encoded_keys);
+}
+
 uint64_t DiskRowSet::EstimateBaseDataDiskSize() const {
   DCHECK(open_);
   shared_lock<rw_spinlock> l(component_lock_.get_lock());
@@ -28,6 +28,7 @@
 #include <string>
 #include <vector>
 
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/row.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_manager.h"
@@ -40,15 +41,18 @@
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/mem_tracker.h"
+#include "kudu/util/memory/arena.h"
 
 namespace kudu {
 
+class ColumnStatistics;
 class FsManager;
 class MemTracker;
 class RowBlock;
 class RowChangeList;
 
 namespace cfile {
+class BlockCacheAttribution;
 class BloomFileWriter;
 class CFileWriter;
 }
@@ -62,6 +66,7 @@ namespace tablet {
 class CFileSet;
 class DeltaFileWriter;
 class DeltaStats;
+class DeltaStore;
 class DeltaTracker;
 class HistoryGcOpts;
 class MultiColumnWriter;
@@ -71,8 +76,14 @@ class OperationResultPB;
 class DiskRowSetWriter {
  public:
   // TODO: document ownership of rowset_metadata
+  //
+  // If 'cache_written_blocks' is true, the blocks of the base data, including
+  // its bloom filter and indexes, are inserted into the block cache as they
+  // are written, accounted for in 'block_cache_attribution' if it is not null.
   DiskRowSetWriter(RowSetMetadata* rowset_metadata, const Schema* schema,
-                   BloomFilterSizing bloom_sizing);
+                   BloomFilterSizing bloom_sizing,
+                   bool cache_written_blocks = false,
+                   scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution = nullptr);
 
   ~DiskRowSetWriter();
 
@@ -125,6 +136,9 @@ class DiskRowSetWriter {
 
   BloomFilterSizing bloom_sizing_;
 
+  const bool cache_written_blocks_;
+  const scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution_;
+
   bool finished_;
   rowid_t written_count_;
   gscoped_ptr<MultiColumnWriter> col_writer_;
@@ -133,6 +147,11 @@ class DiskRowSetWriter {
 
   // The last encoded key written.
   faststring last_encoded_key_;
+
+  // Encodes the keys of each appended block at once, into 'key_arena_'.
+  BatchKeyEncoder key_encoder_;
+  Arena key_arena_;
+  std::vector<Slice> encoded_keys_;
 };
 
 
@@ -146,9 +165,18 @@ class RollingDiskRowSetWriter {
   // Create a new rolling writer. The given 'tablet_metadata' must stay valid
   // for the lifetime of this writer, and is used to construct the new rowsets
   // that this RollingDiskRowSetWriter creates.
+  //
+  // See DiskRowSetWriter for 'cache_written_blocks' and
+  // 'block_cache_attribution'. If 'cold' is true, the new rowsets are cold
+  // and their blocks are placed on the slow storage tier (see
+  // RowSetMetadata::cold()).
   RollingDiskRowSetWriter(TabletMetadata* tablet_metadata, const Schema& schema,
                           BloomFilterSizing bloom_sizing,
-                          size_t target_rowset_size);
+                          size_t target_rowset_size,
+                          bool cache_written_blocks = false,
+                          scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution =
+                              nullptr,
+                          bool cold = false);
   ~RollingDiskRowSetWriter();
 
   Status Open();
@@ -224,6 +252,9 @@ class RollingDiskRowSetWriter {
   std::shared_ptr<RowSetMetadata> cur_drs_metadata_;
   const BloomFilterSizing bloom_sizing_;
   const size_t target_rowset_size_;
+  const bool cache_written_blocks_;
+  const scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution_;
+  const bool cold_;
 
   gscoped_ptr<DiskRowSetWriter> cur_writer_;
 
@@ -309,6 +340,9 @@ class DiskRowSet : public RowSet {
                          bool *present,
                          ProbeStats* stats) const OVERRIDE;
 
+  Status CheckRowsPresent(const RowSetKeyProbe* const* probes, int num_probes,
+                          bool* present, ProbeStats* const* stats) const OVERRIDE;
+
   ////////////////////
   // Read functions.
   ////////////////////
@@ -324,10 +358,22 @@ class DiskRowSet : public RowSet {
   // Count the number of rows in this rowset.
   Status CountRows(rowid_t *count) const OVERRIDE;
 
+  // The base data holds every row, and the rows deleted in 'snap' are those
+  // with a REDO DELETE, which the delta tracker can count from the recorded
+  // statistics of its stores if all of their deltas are committed in 'snap'.
+  bool CountLiveRowsFromMetadata(const MvccSnapshot& snap, rowid_t* count) const OVERRIDE;
+
+  // See CFileSet::MergeColumnStatistics(). The statistics are those of the
+  // base data, as it was written: updates and deletes are not reflected.
+  Status MergeColumnStatistics(ColumnId col_id, ColumnStatistics* stats, bool* found) const;
+
   // See RowSet::GetBounds(...)
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const OVERRIDE;
 
+  // See CFileSet::SampleKeys().
+  Status SampleKeys(int num_samples, std::vector<std::string>* encoded_keys) const OVERRIDE;
+
   // Estimate the number of bytes on-disk for the base data.
   uint64_t EstimateBaseDataDiskSize() const;
 
@@ -402,6 +448,14 @@ class DiskRowSet : public RowSet {
 
   Status Open();
 
+  // Returns whether a major delta compaction of 'col_ids' over the REDO delta
+  // 'stores' should use the REWRITE_DELTAS_ONLY mode of MajorDeltaCompaction:
+  // when the deltas update few rows relative to the size of the rowset, and
+  // most of them are ancient history which can be merged.
+  bool ShouldRewriteDeltasOnly(const std::vector<ColumnId>& col_ids,
+                               const std::vector<std::shared_ptr<DeltaStore>>& stores,
+                               const HistoryGcOpts& history_gc_opts) const;
+
   // Create a new major delta compaction object to compact the specified columns.
   Status NewMajorDeltaCompaction(const std::vector<ColumnId>& col_ids,
                                  HistoryGcOpts history_gc_opts,
@@ -428,6 +482,12 @@ class DiskRowSet : public RowSet {
   // no other compactor will attempt to include this rowset.
   std::mutex compact_flush_lock_;
 
+  // Set when a REWRITE_DELTAS_ONLY major delta compaction merged away too
+  // few mutations to be worth repeating, so that the next major delta
+  // compaction rewrites the base data. Protected by the delta tracker's
+  // compact_flush_lock.
+  bool force_base_data_rewrite_;
+
   DISALLOW_COPY_AND_ASSIGN(DiskRowSet);
 };
 
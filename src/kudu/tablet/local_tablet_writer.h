@@ -119,6 +119,11 @@ class LocalTabletWriter {
     return Status::OK();
   }
 
+  // Return the results of the row operations of the last write.
+  const TxResultPB& last_write_result() const {
+    return result_;
+  }
+
   // Return the result of the last row operation run against the tablet.
   const OperationResultPB& last_op_result() {
     CHECK_GE(result_.ops_size(), 1);
@@ -29,8 +29,9 @@
 #include "kudu/util/test_util.h"
 #include "kudu/util/thread.h"
 
-using std::vector;
 using std::shared_ptr;
+using std::string;
+using std::vector;
 
 DEFINE_int32(num_test_threads, 10, "number of stress test client threads");
 DEFINE_int32(num_iterations, 1000, "number of iterations per client thread");
@@ -104,6 +105,61 @@ TEST_F(LockManagerTest, TestMoveLock) {
   ASSERT_FALSE(row_lock.acquired());
 }
 
+TEST_F(LockManagerTest, TestAcquireLocks) {
+  Slice key_a("a"), key_b("b"), key_c("c");
+  vector<Slice> keys = { key_c, key_a, key_b, key_a };
+  {
+    vector<ScopedRowLock> locks;
+    lock_manager_.AcquireLocks(kFakeTransaction, keys, LockManager::LOCK_EXCLUSIVE, &locks);
+    ASSERT_EQ(keys.size(), locks.size());
+    for (const ScopedRowLock& l : locks) {
+      ASSERT_TRUE(l.acquired());
+    }
+    VerifyAlreadyLocked(key_a);
+    VerifyAlreadyLocked(key_b);
+    VerifyAlreadyLocked(key_c);
+
+    // Releasing one of the two locks on a duplicated key leaves it locked.
+    locks[1].Release();
+    VerifyAlreadyLocked(key_a);
+  }
+
+  // Once the batch goes out of scope all of the keys may be locked again.
+  ScopedRowLock la(&lock_manager_, kFakeTransaction, key_a, LockManager::LOCK_EXCLUSIVE);
+  ScopedRowLock lb(&lock_manager_, kFakeTransaction, key_b, LockManager::LOCK_EXCLUSIVE);
+  ScopedRowLock lc(&lock_manager_, kFakeTransaction, key_c, LockManager::LOCK_EXCLUSIVE);
+  ASSERT_TRUE(la.acquired() && lb.acquired() && lc.acquired());
+}
+
+// Test that many threads locking overlapping batches of keys, each given in a
+// different order, don't deadlock.
+TEST_F(LockManagerTest, TestAcquireLocksConcurrently) {
+  const int kNumKeys = 100;
+  vector<string> key_strings;
+  for (int i = 0; i < kNumKeys; i++) {
+    key_strings.push_back(StringPrintf("key%03d", i));
+  }
+  vector<scoped_refptr<kudu::Thread>> threads;
+  for (int t = 0; t < FLAGS_num_test_threads; t++) {
+    scoped_refptr<kudu::Thread> thread;
+    CHECK_OK(kudu::Thread::Create("test", "test", [&, t]() {
+        const TransactionState* my_txn = reinterpret_cast<TransactionState*>(t + 1);
+        vector<Slice> keys;
+        for (int i = 0; i < kNumKeys; i++) {
+          keys.emplace_back(key_strings[(i * (t + 1)) % kNumKeys]);
+        }
+        for (int i = 0; i < FLAGS_num_iterations; i++) {
+          vector<ScopedRowLock> locks;
+          lock_manager_.AcquireLocks(my_txn, keys, LockManager::LOCK_EXCLUSIVE, &locks);
+        }
+      }, &thread));
+    threads.push_back(thread);
+  }
+  for (const scoped_refptr<kudu::Thread>& thread : threads) {
+    CHECK_OK(ThreadJoiner(thread.get()).warn_after_ms(1000).warn_every_ms(5000).Join());
+  }
+}
+
 class LmTestResource {
  public:
   explicit LmTestResource(const Slice* id)
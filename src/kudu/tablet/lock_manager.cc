@@ -17,10 +17,12 @@
 
 #include "kudu/tablet/lock_manager.h"
 
+#include <algorithm>
 #include <glog/logging.h>
 #include <mutex>
 #include <semaphore.h>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/dynamic_annotations.h"
 #include "kudu/gutil/gscoped_ptr.h"
@@ -31,11 +33,17 @@
 #include "kudu/util/semaphore.h"
 #include "kudu/util/trace.h"
 
+using std::vector;
+
 namespace kudu {
 namespace tablet {
 
 class TransactionState;
 
+static uint64_t HashKey(const Slice& key) {
+  return util_hash::CityHash64(reinterpret_cast<const char *>(key.data()), key.size());
+}
+
 // ============================================================================
 //  LockTable
 // ============================================================================
@@ -44,10 +52,10 @@ class TransactionState;
 // Callers should generally use ScopedRowLock (see below).
 class LockEntry {
  public:
-  explicit LockEntry(const Slice& key)
+  LockEntry(const Slice& key, uint64_t hash)
   : sem(1),
     recursion_(0) {
-    key_hash_ = util_hash::CityHash64(reinterpret_cast<const char *>(key.data()), key.size());
+    key_hash_ = hash;
     key_ = key;
     refs_ = 1;
   }
@@ -116,7 +124,7 @@ class LockTable {
     }
   }
 
-  LockEntry *GetLockEntry(const Slice &key);
+  LockEntry *GetLockEntry(const Slice &key, uint64_t hash);
   void ReleaseLockEntry(LockEntry *entry);
 
  private:
@@ -162,8 +170,8 @@ class LockTable {
   base::subtle::Atomic64 item_count_;
 };
 
-LockEntry *LockTable::GetLockEntry(const Slice& key) {
-  auto new_entry = new LockEntry(key);
+LockEntry *LockTable::GetLockEntry(const Slice& key, uint64_t hash) {
+  auto new_entry = new LockEntry(key, hash);
   LockEntry *old_entry;
 
   {
@@ -281,6 +289,16 @@ ScopedRowLock::ScopedRowLock(LockManager *manager,
   }
 }
 
+ScopedRowLock::ScopedRowLock(LockManager* manager,
+                             LockEntry* entry,
+                             LockManager::LockStatus ls)
+  : manager_(DCHECK_NOTNULL(manager)),
+    acquired_(ls == LockManager::LOCK_ACQUIRED),
+    entry_(entry),
+    ls_(ls) {
+  CHECK_NE(ls_, LockManager::LOCK_BUSY);
+}
+
 ScopedRowLock::ScopedRowLock(ScopedRowLock&& other) {
   TakeState(&other);
 }
@@ -317,18 +335,54 @@ void ScopedRowLock::Release() {
 // ============================================================================
 
 LockManager::LockManager()
-  : locks_(new LockTable()) {
+  : shards_(new LockTable[kNumShards]) {
 }
 
 LockManager::~LockManager() {
-  delete locks_;
+}
+
+LockTable* LockManager::Shard(uint64_t hash) const {
+  // The low bits of the hash select the bucket within a shard, so use the
+  // high bits to select the shard.
+  return &shards_[hash >> (64 - kShardBits)];
+}
+
+void LockManager::AcquireLocks(const TransactionState* tx,
+                               const vector<Slice>& keys,
+                               LockManager::LockMode mode,
+                               vector<ScopedRowLock>* locks) {
+  // Lock in key order, so that concurrent batches always take any locks they
+  // have in common in the same order.
+  vector<int> order(keys.size());
+  for (int i = 0; i < keys.size(); i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+      return keys[a].compare(keys[b]) < 0;
+    });
+
+  locks->clear();
+  locks->resize(keys.size());
+  for (int i : order) {
+    LockEntry* entry;
+    LockStatus ls = Lock(keys[i], HashKey(keys[i]), tx, mode, &entry);
+    (*locks)[i] = ScopedRowLock(this, entry, ls);
+  }
+}
+
+LockManager::LockStatus LockManager::Lock(const Slice& key,
+                                          const TransactionState* tx,
+                                          LockManager::LockMode mode,
+                                          LockEntry** entry) {
+  return Lock(key, HashKey(key), tx, mode, entry);
 }
 
 LockManager::LockStatus LockManager::Lock(const Slice& key,
+                                          uint64_t hash,
                                           const TransactionState* tx,
                                           LockManager::LockMode mode,
                                           LockEntry** entry) {
-  *entry = locks_->GetLockEntry(key);
+  *entry = Shard(hash)->GetLockEntry(key, hash);
 
   // We expect low contention, so just try to try_lock first. This is faster
   // than a timed_lock, since we don't have to do a syscall to get the current
@@ -378,10 +432,12 @@ LockManager::LockStatus LockManager::TryLock(const Slice& key,
                                              const TransactionState* tx,
                                              LockManager::LockMode mode,
                                              LockEntry **entry) {
-  *entry = locks_->GetLockEntry(key);
+  uint64_t hash = HashKey(key);
+  LockTable* shard = Shard(hash);
+  *entry = shard->GetLockEntry(key, hash);
   bool locked = (*entry)->sem.TryAcquire();
   if (!locked) {
-    locks_->ReleaseLockEntry(*entry);
+    shard->ReleaseLockEntry(*entry);
     return LOCK_BUSY;
   }
   (*entry)->holder_ = tx;
@@ -397,7 +453,7 @@ void LockManager::Release(LockEntry *lock, LockStatus ls) {
       lock->sem.Release();
     }
   }
-  locks_->ReleaseLockEntry(lock);
+  Shard(lock->key_hash_)->ReleaseLockEntry(lock);
 }
 
 } // namespace tablet
@@ -17,6 +17,9 @@
 #ifndef KUDU_TABLET_LOCK_MANAGER_H
 #define KUDU_TABLET_LOCK_MANAGER_H
 
+#include <vector>
+
+#include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/move.h"
 #include "kudu/util/slice.h"
@@ -26,11 +29,17 @@ namespace kudu { namespace tablet {
 class LockManager;
 class LockTable;
 class LockEntry;
+class ScopedRowLock;
 class TransactionState;
 
 // Super-simple lock manager implementation. This only supports exclusive
 // locks, and makes no attempt to prevent deadlocks if a single thread
-// takes multiple locks.
+// takes multiple locks one at a time. Callers which need several locks
+// should take them together with AcquireLocks(), which orders them.
+//
+// The locks are kept in a hash table split into a fixed number of shards, each
+// of which is resized independently, so that lock traffic on different keys
+// rarely contends on the same table.
 //
 // In the future when we want to support multi-row transactions of some kind
 // we'll have to implement a proper lock manager with all its trappings,
@@ -49,17 +58,38 @@ class LockManager {
     LOCK_EXCLUSIVE
   };
 
+  // Acquire locks on all of 'keys' on behalf of 'tx', blocking until they are
+  // all held. The locks are taken in key order, so two batches with
+  // overlapping keys can't deadlock against each other. 'keys' may contain
+  // duplicates, in which case the same lock is held more than once.
+  //
+  // On return, locks[i] holds the lock for keys[i]. As with ScopedRowLock,
+  // the key slices must remain valid and un-changed while the locks are held.
+  void AcquireLocks(const TransactionState* tx,
+                    const std::vector<Slice>& keys,
+                    LockMode mode,
+                    std::vector<ScopedRowLock>* locks);
+
  private:
   friend class ScopedRowLock;
   friend class LockManagerTest;
 
+  // The lock table is split into 2^kShardBits shards.
+  static const int kShardBits = 4;
+  static const int kNumShards = 1 << kShardBits;
+
   LockStatus Lock(const Slice& key, const TransactionState* tx,
                   LockMode mode, LockEntry **entry);
+  LockStatus Lock(const Slice& key, uint64_t hash, const TransactionState* tx,
+                  LockMode mode, LockEntry **entry);
   LockStatus TryLock(const Slice& key, const TransactionState* tx,
                      LockMode mode, LockEntry **entry);
   void Release(LockEntry *lock, LockStatus ls);
 
-  LockTable *locks_;
+  // Return the shard of the lock table responsible for keys with 'hash'.
+  LockTable* Shard(uint64_t hash) const;
+
+  gscoped_array<LockTable> shards_;
 
   DISALLOW_COPY_AND_ASSIGN(LockManager);
 };
@@ -116,6 +146,11 @@ class ScopedRowLock {
   ~ScopedRowLock();
 
  private:
+  friend class LockManager;
+
+  // Take ownership of 'entry', which was locked in 'manager' with status 'ls'.
+  ScopedRowLock(LockManager* manager, LockEntry* entry, LockManager::LockStatus ls);
+
   void TakeState(ScopedRowLock* other);
 
   LockManager *manager_;
@@ -23,6 +23,7 @@
 #include "kudu/common/scan_spec.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/server/logical_clock.h"
 #include "kudu/tablet/memrowset.h"
 #include "kudu/tablet/tablet-test-util.h"
@@ -33,6 +34,8 @@ DEFINE_int32(roundtrip_num_rows, 10000,
              "Number of rows to use for the round-trip test");
 DEFINE_int32(num_scan_passes, 1,
              "Number of passes to run the scan portion of the round-trip test");
+DECLARE_bool(mrs_use_columnwise_projection);
+DECLARE_string(memstore_arena_huge_pages);
 
 namespace kudu {
 namespace tablet {
@@ -450,6 +453,33 @@ TEST_F(TestMemRowSet, TestMemRowSetInsertCountAndScan) {
     }
   }
 }
+// Compare insert and point lookup times with and without huge-page backed
+// arenas. Can operate as a benchmark by setting --roundtrip_num_rows to a
+// high value like 10M.
+TEST_F(TestMemRowSet, TestInsertAndLookupWithHugePages) {
+  for (const char* mode : { "none", "transparent", "explicit" }) {
+    FLAGS_memstore_arena_huge_pages = mode;
+    shared_ptr<MemRowSet> mrs;
+    ASSERT_OK(MemRowSet::Create(0, schema_, log_anchor_registry_.get(),
+                                MemTracker::GetRootTracker(), &mrs));
+
+    LOG_TIMING(INFO, strings::Substitute("Inserting rows (huge pages: $0)", mode)) {
+      ASSERT_OK(InsertRows(mrs.get(), FLAGS_roundtrip_num_rows));
+    }
+
+    LOG_TIMING(INFO, strings::Substitute("Looking up rows (huge pages: $0)", mode)) {
+      char keybuf[256];
+      for (int i = 0; i < FLAGS_roundtrip_num_rows; i++) {
+        snprintf(keybuf, sizeof(keybuf), "hello %d", i);
+        bool present;
+        ASSERT_OK(CheckRowPresent(*mrs, keybuf, &present));
+        ASSERT_TRUE(present) << keybuf;
+      }
+    }
+    ASSERT_EQ(FLAGS_roundtrip_num_rows, mrs->entry_count());
+  }
+}
+
 // Test that scanning at past MVCC snapshots will hide rows which are
 // not committed in that snapshot.
 TEST_F(TestMemRowSet, TestInsertionMVCC) {
@@ -534,5 +564,90 @@ TEST_F(TestMemRowSet, TestUpdateMVCC) {
   }
 }
 
+// Test that projecting the rows of a scan one column at a time returns the
+// same rows as projecting them one row at a time, with nulls, indirect data,
+// mutations and columns which aren't in the MemRowSet.
+TEST_F(TestMemRowSet, TestColumnwiseProjection) {
+  SchemaBuilder builder;
+  ASSERT_OK(builder.AddKeyColumn("key", STRING));
+  ASSERT_OK(builder.AddColumn("int_val", INT32));
+  ASSERT_OK(builder.AddNullableColumn("string_val", STRING));
+  for (int i = 0; i < 20; i++) {
+    ASSERT_OK(builder.AddColumn(strings::Substitute("filler_$0", i), INT64));
+  }
+  Schema schema = builder.Build();
+
+  shared_ptr<MemRowSet> mrs;
+  ASSERT_OK(MemRowSet::Create(0, schema, log_anchor_registry_.get(),
+                              MemTracker::GetRootTracker(), &mrs));
+  for (int32_t i = 0; i < 300; i++) {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    RowBuilder rb(schema);
+    rb.AddString(strings::Substitute("row $0", i));
+    rb.AddInt32(i);
+    if (i % 3 == 0) {
+      rb.AddNull();
+    } else {
+      rb.AddString(strings::Substitute("string $0", i));
+    }
+    for (int j = 0; j < 20; j++) {
+      rb.AddInt64(j);
+    }
+    tx.StartApplying();
+    ASSERT_OK(mrs->Insert(tx.timestamp(), rb.row(), op_id_));
+    tx.Commit();
+  }
+
+  // Update some rows, and delete some others.
+  Schema key_schema = schema.CreateKeyProjection();
+  for (int32_t i = 0; i < 300; i += 7) {
+    ScopedTransaction tx(&mvcc_, clock_->Now());
+    tx.StartApplying();
+    mutation_buf_.clear();
+    RowChangeListEncoder encoder(&mutation_buf_);
+    if (i % 2 == 0) {
+      int32_t new_val = -i;
+      encoder.AddColumnUpdate(schema.column(1), schema.column_id(1), &new_val);
+    } else {
+      encoder.SetToDelete();
+    }
+    RowBuilder rb(key_schema);
+    rb.AddString(strings::Substitute("row $0", i));
+    RowSetKeyProbe probe(rb.row());
+    ProbeStats stats;
+    OperationResultPB result;
+    ASSERT_OK(mrs->MutateRow(tx.timestamp(), probe, RowChangeList(mutation_buf_),
+                             op_id_, &stats, &result));
+    tx.Commit();
+  }
+
+  // Project a few of the columns, and one which was added after the
+  // MemRowSet was created.
+  SchemaBuilder altered(schema);
+  int32_t added_default = 12345;
+  ASSERT_OK(altered.AddColumn("added", INT32, false, &added_default, &added_default));
+  Schema altered_schema = altered.Build();
+  Schema projection;
+  ASSERT_OK(altered_schema.CreateProjectionByNames({ "string_val", "added", "int_val" },
+                                                   &projection));
+
+  auto scan = [&](vector<string>* rows) {
+    gscoped_ptr<MemRowSet::Iterator> iter(mrs->NewIterator(&projection, MvccSnapshot(mvcc_)));
+    ASSERT_OK(iter->Init(nullptr));
+    ASSERT_OK(IterateToStringList(iter.get(), rows));
+  };
+  vector<string> columnwise_rows;
+  FLAGS_mrs_use_columnwise_projection = true;
+  NO_FATALS(scan(&columnwise_rows));
+  vector<string> rowwise_rows;
+  FLAGS_mrs_use_columnwise_projection = false;
+  NO_FATALS(scan(&rowwise_rows));
+
+  ASSERT_EQ(279, columnwise_rows.size());
+  ASSERT_EQ(rowwise_rows, columnwise_rows);
+  ASSERT_EQ(R"((string string_val=NULL, int32 added=12345, int32 int_val=0))",
+            columnwise_rows[0]);
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/memrowset.h"
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -25,7 +26,9 @@
 #include <glog/logging.h>
 
 #include "kudu/codegen/compilation_manager.h"
+#include "kudu/codegen/predicate_evaluator.h"
 #include "kudu/codegen/row_projector.h"
+#include "kudu/common/column_predicate.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/generic_iterators.h"
 #include "kudu/common/row.h"
@@ -41,6 +44,36 @@ DEFINE_bool(mrs_use_codegen, true, "whether the memrowset should use code "
             "generation for iteration");
 TAG_FLAG(mrs_use_codegen, hidden);
 
+DEFINE_bool(mrs_use_columnwise_projection, true, "whether the memrowset should "
+            "project the rows of a scan one column at a time rather than one row "
+            "at a time");
+TAG_FLAG(mrs_use_columnwise_projection, hidden);
+
+DEFINE_bool(mrs_codegen_predicates, true, "whether the memrowset should use code "
+            "generation to evaluate the predicates of scans");
+TAG_FLAG(mrs_codegen_predicates, hidden);
+
+DEFINE_string(memstore_arena_huge_pages, "none",
+              "Whether the arenas of MemRowSets and DeltaMemStores back their "
+              "large components with 2MB huge pages, reducing TLB misses on "
+              "inserts and lookups in large in-memory stores. One of 'none', "
+              "'transparent' (use madvise(MADV_HUGEPAGE) so that the kernel's "
+              "transparent huge page support backs them) or 'explicit' (map "
+              "them from the reserved hugetlbfs pool, falling back to "
+              "transparent huge pages when the pool is exhausted).");
+TAG_FLAG(memstore_arena_huge_pages, experimental);
+
+static bool ValidateMemStoreArenaHugePages(const char* flagname, const std::string& value) {
+  if (value == "none" || value == "transparent" || value == "explicit") {
+    return true;
+  }
+  LOG(ERROR) << "Invalid value for --" << flagname << ": " << value
+             << " (must be one of 'none', 'transparent' or 'explicit')";
+  return false;
+}
+static bool dummy_huge_pages = google::RegisterFlagValidator(
+    &FLAGS_memstore_arena_huge_pages, &ValidateMemStoreArenaHugePages);
+
 using std::pair;
 using std::shared_ptr;
 
@@ -53,6 +86,16 @@ using strings::Substitute;
 static const int kInitialArenaSize = 16;
 static const int kMaxArenaBufferSize = 8*1024*1024;
 
+BufferAllocator* MemStoreBufferAllocator() {
+  if (FLAGS_memstore_arena_huge_pages == "transparent") {
+    return HugePageBufferAllocator::Get(HugePageBufferAllocator::TRANSPARENT);
+  }
+  if (FLAGS_memstore_arena_huge_pages == "explicit") {
+    return HugePageBufferAllocator::Get(HugePageBufferAllocator::EXPLICIT);
+  }
+  return HeapBufferAllocator::Get();
+}
+
 bool MRSRow::IsGhost() const {
   bool is_ghost = false;
   for (const Mutation *mut = header_->redo_head;
@@ -103,7 +146,7 @@ MemRowSet::MemRowSet(int64_t id,
                      shared_ptr<MemTracker> parent_tracker)
   : id_(id),
     schema_(schema),
-    allocator_(new MemoryTrackingBufferAllocator(HeapBufferAllocator::Get(),
+    allocator_(new MemoryTrackingBufferAllocator(MemStoreBufferAllocator(),
                                                  CreateMemTrackerForMemRowSet(id, parent_tracker))),
     arena_(new ThreadSafeMemoryTrackingArena(kInitialArenaSize, kMaxArenaBufferSize,
                                              allocator_)),
@@ -306,6 +349,36 @@ Status MemRowSet::GetBounds(string *min_encoded_key,
   return Status::NotSupported("");
 }
 
+Status MemRowSet::SampleKeys(int num_samples, vector<string>* encoded_keys) const {
+  uint64_t num_rows = entry_count();
+  if (num_rows == 0 || num_samples <= 0) {
+    return Status::OK();
+  }
+
+  // The tree is keyed by the encoded row keys, so they can be copied out
+  // directly while walking it.
+  gscoped_ptr<MSBTIter> iter(tree_.NewIterator());
+  iter->SeekToStart();
+  uint64_t ord = 0;
+  uint64_t prev_sample_ord = num_rows;
+  for (int i = 1; i <= num_samples; i++) {
+    uint64_t sample_ord = num_rows * i / (num_samples + 1);
+    if (sample_ord == prev_sample_ord) continue;
+    prev_sample_ord = sample_ord;
+
+    // Rows may have been inserted since they were counted, which only makes
+    // the samples less evenly spaced.
+    for (; ord < sample_ord && iter->IsValid(); ord++) {
+      iter->Next();
+    }
+    if (!iter->IsValid()) break;
+    Slice key, val;
+    iter->GetCurrentEntry(&key, &val);
+    encoded_keys->push_back(key.ToString());
+  }
+  return Status::OK();
+}
+
 // Virtual interface allows two possible row projector implementations
 class MemRowSet::Iterator::MRSRowProjector {
  public:
@@ -399,6 +472,18 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
   RETURN_NOT_OK(projector_->Init());
   RETURN_NOT_OK(delta_projector_.Init());
 
+  // The projected columns which aren't in the MemRowSet, and are filled with
+  // their read default.
+  vector<bool> projected_from_base(projection_->num_columns(), false);
+  for (const auto& mapping : projector_->base_cols_mapping()) {
+    projected_from_base[mapping.first] = true;
+  }
+  for (size_t i = 0; i < projection_->num_columns(); i++) {
+    if (!projected_from_base[i]) {
+      projection_defaults_.push_back(i);
+    }
+  }
+
   if (spec && spec->lower_bound_key()) {
     bool exact;
     const Slice &lower_bound = spec->lower_bound_key()->encoded_key();
@@ -415,6 +500,21 @@ Status MemRowSet::Iterator::Init(ScanSpec *spec) {
     exclusive_upper_bound_.reset(upper_bound);
   }
 
+  // Evaluate the predicates with generated code if it is ready, in the same
+  // order as PredicateEvaluatingIterator would otherwise.
+  if (FLAGS_mrs_use_codegen && FLAGS_mrs_codegen_predicates &&
+      spec && !spec->predicates().empty()) {
+    vector<ColumnPredicate> predicates;
+    for (const auto& col_pred : spec->predicates()) {
+      predicates.push_back(col_pred.second);
+    }
+    std::sort(predicates.begin(), predicates.end(), SelectivityComparator);
+    if (codegen::CompilationManager::GetSingleton()->RequestPredicateEvaluator(
+          projection_, predicates, &predicate_evaluator_)) {
+      spec->RemovePredicates();
+    }
+  }
+
   state_ = kScanning;
   return Status::OK();
 }
@@ -472,10 +572,18 @@ Status MemRowSet::Iterator::NextBlock(RowBlock *dst) {
   // Clear unreached bits by resizing
   dst->Resize(fetched);
 
+  if (predicate_evaluator_) {
+    predicate_evaluator_->Evaluate(dst);
+  }
+
   return Status::OK();
 }
 
 Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
+  if (FLAGS_mrs_use_columnwise_projection) {
+    return FetchRowsColumnwise(dst, fetched);
+  }
+
   *fetched = 0;
   do {
     Slice k, v;
@@ -521,6 +629,89 @@ Status MemRowSet::Iterator::FetchRows(RowBlock* dst, size_t* fetched) {
   return Status::OK();
 }
 
+Status MemRowSet::Iterator::FetchRowsColumnwise(RowBlock* dst, size_t* fetched) {
+  // Find the rows of the block visible in the snapshot first, so that they can
+  // then be projected one column at a time: each column is copied in a tight
+  // loop, touching only its own cells of the rows.
+  *fetched = 0;
+  visible_rows_.clear();
+  visible_row_idxs_.clear();
+  do {
+    Slice k, v;
+    iter_->GetCurrentEntry(&k, &v);
+    MRSRow row(memrowset_.get(), v);
+
+    if (mvcc_snap_.IsCommitted(row.insertion_timestamp())) {
+      if (has_upper_bound() && out_of_bounds(k)) {
+        state_ = kFinished;
+        break;
+      }
+      visible_rows_.push_back(row);
+      visible_row_idxs_.push_back(*fetched);
+    } else {
+      // This row was not yet committed in the current MVCC snapshot
+      dst->selection_vector()->SetRowUnselected(*fetched);
+    }
+
+    ++*fetched;
+  } while (iter_->Next() && *fetched < dst->nrows());
+
+  RETURN_NOT_OK(ProjectVisibleRows(dst));
+
+  // Roll-forward MVCC for committed updates.
+  for (size_t i = 0; i < visible_rows_.size(); i++) {
+    RowBlockRow dst_row = dst->row(visible_row_idxs_[i]);
+    RETURN_NOT_OK(ApplyMutationsToProjectedRow(
+        visible_rows_[i].acquire_redo_head(), &dst_row, dst->arena()));
+  }
+  return Status::OK();
+}
+
+Status MemRowSet::Iterator::ProjectVisibleRows(RowBlock* dst) {
+  const Schema& base_schema = memrowset_->schema_nonvirtual();
+  Arena* arena = dst->arena();
+
+  for (const auto& mapping : projector_->base_cols_mapping()) {
+    const ColumnSchema& col = base_schema.column(mapping.second);
+    const size_t col_offset = base_schema.column_offset(mapping.second);
+    const size_t col_size = col.type_info()->size();
+    const bool is_binary = col.type_info()->physical_type() == BINARY;
+    ColumnBlock dst_col = dst->column_block(mapping.first);
+    for (size_t i = 0; i < visible_rows_.size(); i++) {
+      const uint8_t* row_data = visible_rows_[i].row_data();
+      size_t dst_idx = visible_row_idxs_[i];
+      if (col.is_nullable()) {
+        bool is_null = ContiguousRowHelper::is_null(base_schema, row_data, mapping.second);
+        dst_col.SetCellIsNull(dst_idx, is_null);
+        if (is_null) {
+          continue;
+        }
+      }
+      const uint8_t* src = row_data + col_offset;
+      if (is_binary && arena != nullptr) {
+        const Slice* src_slice = reinterpret_cast<const Slice*>(src);
+        Slice* dst_slice = reinterpret_cast<Slice*>(dst_col.data() + dst_idx * col_size);
+        if (PREDICT_FALSE(!arena->RelocateSlice(*src_slice, dst_slice))) {
+          return Status::IOError("out of memory copying slice", src_slice->ToString());
+        }
+      } else {
+        dst_col.SetCellValue(dst_idx, src);
+      }
+    }
+  }
+
+  for (size_t proj_idx : projection_defaults_) {
+    const ColumnSchema& col = projection_->column(proj_idx);
+    SimpleConstCell src_cell(&col, col.read_default_value());
+    ColumnBlock dst_col = dst->column_block(proj_idx);
+    for (size_t dst_idx : visible_row_idxs_) {
+      ColumnBlockCell dst_cell = dst_col.cell(dst_idx);
+      RETURN_NOT_OK(CopyCell(src_cell, &dst_cell, arena));
+    }
+  }
+  return Status::OK();
+}
+
 Status MemRowSet::Iterator::ApplyMutationsToProjectedRow(
   const Mutation *mutation_head, RowBlockRow *dst_row, Arena *dst_arena) {
   // Fast short-circuit the likely case of a row which was inserted and never
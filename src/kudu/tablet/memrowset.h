@@ -42,6 +42,10 @@ namespace kudu {
 
 class MemTracker;
 
+namespace codegen {
+class PredicateEvaluator;
+} // namespace codegen
+
 namespace tablet {
 
 //
@@ -174,6 +178,10 @@ struct MSBTreeTraits : public btree::BTreeTraits {
   MRSRow varname(memrowset, slice_name);
 
 
+// Returns the allocator which MemRowSet and DeltaMemStore arenas allocate
+// their components from, as selected by --memstore_arena_huge_pages.
+BufferAllocator* MemStoreBufferAllocator();
+
 // In-memory storage for data currently being written to the tablet.
 // This is a holding area for inserts, currently held in row form
 // (i.e not columnar)
@@ -230,9 +238,19 @@ class MemRowSet : public RowSet,
     return Status::OK();
   }
 
+  // The liveness of each row depends on its mutations, which are kept with
+  // the row, so counting live rows always requires iterating.
+  bool CountLiveRowsFromMetadata(const MvccSnapshot& snap, rowid_t* count) const OVERRIDE {
+    return false;
+  }
+
   virtual Status GetBounds(std::string *min_encoded_key,
                            std::string *max_encoded_key) const OVERRIDE;
 
+  // NOTE: like entry_count(), this requires iterating all data.
+  Status SampleKeys(int num_samples,
+                    std::vector<std::string>* encoded_keys) const OVERRIDE;
+
   uint64_t EstimateOnDiskSize() const OVERRIDE {
     return 0;
   }
@@ -503,6 +521,10 @@ class MemRowSet::Iterator : public RowwiseIterator {
 
   // Various helper functions called while getting the next RowBlock
   Status FetchRows(RowBlock* dst, size_t* fetched);
+  Status FetchRowsColumnwise(RowBlock* dst, size_t* fetched);
+  // Projects 'visible_rows_' into the rows 'visible_row_idxs_' of 'dst', one
+  // column at a time.
+  Status ProjectVisibleRows(RowBlock* dst);
   Status ApplyMutationsToProjectedRow(const Mutation *mutation_head,
                                       RowBlockRow *dst_row,
                                       Arena *dst_arena);
@@ -522,6 +544,20 @@ class MemRowSet::Iterator : public RowwiseIterator {
   gscoped_ptr<MRSRowProjector> projector_;
   DeltaProjector delta_projector_;
 
+  // The indexes of the projected columns which aren't in the MemRowSet's
+  // schema, and are filled with their read default.
+  std::vector<size_t> projection_defaults_;
+
+  // The rows of the block being fetched which are visible in 'mvcc_snap_', and
+  // their indexes in the destination block.
+  std::vector<MRSRow> visible_rows_;
+  std::vector<size_t> visible_row_idxs_;
+
+  // The code-generated evaluator of the predicates pushed down by the scan,
+  // if it was compiled by the time the iterator was initialized. Otherwise,
+  // the predicates are left in the scan spec and evaluated by the caller.
+  gscoped_ptr<codegen::PredicateEvaluator> predicate_evaluator_;
+
   // Temporary buffer used for RowChangeList projection.
   faststring delta_buf_;
 
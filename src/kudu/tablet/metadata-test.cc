@@ -127,5 +127,31 @@ TEST_F(MetadataTest, RSMD_TestReplaceDeltas_Bad_DoesntExist) {
   EXPECT_EQ(all_blocks_, meta_->redo_delta_blocks());
 }
 
+// Test that the max timestamps of UNDO delta blocks survive a round trip
+// through the protobuf and are dropped along with their blocks.
+TEST_F(MetadataTest, RSMD_TestUndoDeltaMaxTimestamps) {
+  ASSERT_OK(meta_->CommitUndoDeltaDataBlock(BlockId(10), Timestamp(100)));
+  ASSERT_OK(meta_->CommitUndoDeltaDataBlock(BlockId(11)));
+  ASSERT_OK(meta_->CommitUpdate(
+              RowSetMetadataUpdate().SetNewUndoBlock(BlockId(12), Timestamp(300))));
+  ASSERT_EQ(vector<BlockId>({ BlockId(12), BlockId(10), BlockId(11) }),
+            meta_->undo_delta_blocks());
+
+  RowSetDataPB pb;
+  meta_->ToProtobuf(&pb);
+  gscoped_ptr<RowSetMetadata> loaded;
+  ASSERT_OK(RowSetMetadata::Load(tablet_meta_.get(), pb, &loaded));
+
+  Timestamp max_timestamp;
+  ASSERT_TRUE(loaded->GetUndoDeltaMaxTimestamp(BlockId(10), &max_timestamp));
+  ASSERT_EQ(Timestamp(100), max_timestamp);
+  ASSERT_TRUE(loaded->GetUndoDeltaMaxTimestamp(BlockId(12), &max_timestamp));
+  ASSERT_EQ(Timestamp(300), max_timestamp);
+  ASSERT_FALSE(loaded->GetUndoDeltaMaxTimestamp(BlockId(11), &max_timestamp));
+
+  ASSERT_OK(loaded->CommitUpdate(RowSetMetadataUpdate().RemoveUndoDeltaBlocks({ BlockId(10) })));
+  ASSERT_FALSE(loaded->GetUndoDeltaMaxTimestamp(BlockId(10), &max_timestamp));
+}
+
 } // namespace tablet
 } // namespace kudu
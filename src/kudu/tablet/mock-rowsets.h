@@ -22,6 +22,9 @@
 #include <string>
 #include <vector>
 
+#include "kudu/gutil/strings/escaping.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/rowset.h"
 #include "kudu/tablet/rowset_metadata.h"
@@ -63,6 +66,16 @@ class MockRowSet : public RowSet {
     LOG(FATAL) << "Unimplemented";
     return Status::OK();
   }
+  virtual bool CountLiveRowsFromMetadata(const MvccSnapshot& snap,
+                                         rowid_t* count) const OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return false;
+  }
+  virtual Status SampleKeys(int num_samples,
+                            std::vector<std::string>* encoded_keys) const OVERRIDE {
+    LOG(FATAL) << "Unimplemented";
+    return Status::OK();
+  }
   virtual std::string ToString() const OVERRIDE {
     LOG(FATAL) << "Unimplemented";
     return "";
@@ -145,13 +158,18 @@ class MockRowSet : public RowSet {
 };
 
 // Mock which implements GetBounds() with constant provided bonuds.
+//
+// 'size' is the whole on-disk size, of which 'delta_size' are deltas.
 class MockDiskRowSet : public MockRowSet {
  public:
   MockDiskRowSet(std::string first_key, std::string last_key,
-                 int size = 1000000)
+                 uint64_t size = 1000000, uint64_t delta_size = 0)
       : first_key_(std::move(first_key)),
         last_key_(std::move(last_key)),
-        size_(size) {}
+        size_(size),
+        delta_size_(delta_size) {}
+
+  uint64_t delta_size() const { return delta_size_; }
 
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const OVERRIDE {
@@ -174,6 +192,7 @@ class MockDiskRowSet : public MockRowSet {
   const std::string first_key_;
   const std::string last_key_;
   const uint64_t size_;
+  const uint64_t delta_size_;
 };
 
 // Mock which acts like a MemRowSet and has no known bounds.
@@ -189,6 +208,43 @@ class MockMemRowSet : public MockRowSet {
   const std::string last_key_;
 };
 
+// Parses a layout of rowsets into MockDiskRowSets. Each line of 'data' which
+// is neither empty nor a '#' comment describes one rowset as tab-separated
+// fields:
+//
+//   <size in MB> <min key> <max key> [<size of the deltas in MB>]
+//
+// The keys are C-escaped encoded keys, and the size includes the deltas.
+// These layouts can be scraped from real tablets, e.g. with
+// 'kudu perf compaction_sim --local_replica --dump_layout'.
+inline Status ParseMockRowSetLayout(const std::string& data, RowSetVector* rowsets) {
+  std::vector<std::string> lines = strings::Split(data, "\n");
+  for (const auto& line : lines) {
+    if (line.empty() || line[0] == '#') continue;
+    std::vector<std::string> fields = strings::Split(line, "\t");
+    if (fields.size() != 3 && fields.size() != 4) {
+      return Status::Corruption("expected 3 or 4 fields on line", line);
+    }
+    int size_mb = ParseLeadingInt32Value(fields[0], -1);
+    if (size_mb < 1) {
+      return Status::Corruption("expected size at least 1MB on line", line);
+    }
+    std::string min_key, max_key, error;
+    if (!strings::CUnescape(fields[1], &min_key, &error) ||
+        !strings::CUnescape(fields[2], &max_key, &error)) {
+      return Status::Corruption(strings::Substitute("bad key on line $0", line), error);
+    }
+    int delta_mb = fields.size() == 4 ? ParseLeadingInt32Value(fields[3], -1) : 0;
+    if (delta_mb < 0 || delta_mb > size_mb) {
+      return Status::Corruption("expected delta size between 0 and the size on line", line);
+    }
+    rowsets->emplace_back(new MockDiskRowSet(std::move(min_key), std::move(max_key),
+                                             static_cast<uint64_t>(size_mb) * 1024 * 1024,
+                                             static_cast<uint64_t>(delta_mb) * 1024 * 1024));
+  }
+  return Status::OK();
+}
+
 } // namespace tablet
 } // namespace kudu
 #endif /* KUDU_TABLET_MOCK_ROWSETS_H */
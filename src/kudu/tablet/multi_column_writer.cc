@@ -17,11 +17,42 @@
 
 #include "kudu/tablet/multi_column_writer.h"
 
+#include <algorithm>
+#include <gflags/gflags.h>
+
 #include "kudu/cfile/cfile_writer.h"
 #include "kudu/common/rowblock.h"
 #include "kudu/common/schema.h"
 #include "kudu/fs/block_id.h"
+#include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stl_util.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/io_rate_limiter.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_bool(cfile_write_block_stats, true,
+            "Whether to store the min/max value of each data block of non-key "
+            "columns, allowing scans to skip blocks which cannot match their predicates.");
+TAG_FLAG(cfile_write_block_stats, advanced);
+
+DEFINE_bool(cfile_write_column_stats, true,
+            "Whether to store the null count, min/max value and a distinct value "
+            "sketch of each column of the DiskRowSets written, for query planning.");
+TAG_FLAG(cfile_write_column_stats, advanced);
+
+DEFINE_int32(flush_column_writer_threads, 4,
+             "Maximum number of threads, shared by all flushes and compactions, which "
+             "encode and compress the columns of the DiskRowSets being written in "
+             "parallel with the flushing thread. 0 writes every column on the "
+             "flushing thread.");
+TAG_FLAG(flush_column_writer_threads, experimental);
+
+DEFINE_int32(flush_column_writer_min_columns_per_thread, 8,
+             "Minimum number of columns each thread writes when the columns of a "
+             "DiskRowSet are written in parallel. Rowsets with fewer than twice this "
+             "many columns are written by the flushing thread alone.");
+TAG_FLAG(flush_column_writer_min_columns_per_thread, experimental);
 
 namespace kudu {
 namespace tablet {
@@ -29,11 +60,39 @@ namespace tablet {
 using cfile::CFileWriter;
 using fs::ScopedWritableBlockCloser;
 using fs::WritableBlock;
+using std::vector;
+
+// Process-wide pool of threads which append to the column writers of
+// MultiColumnWriters.
+class ColumnWriterPool {
+ public:
+  static ThreadPool* Get() {
+    return Singleton<ColumnWriterPool>::get()->pool_.get();
+  }
+
+ private:
+  friend class Singleton<ColumnWriterPool>;
+
+  ColumnWriterPool() {
+    CHECK_OK(ThreadPoolBuilder("column-writer")
+             .set_max_threads(std::max(FLAGS_flush_column_writer_threads, 1))
+             .Build(&pool_));
+  }
+
+  gscoped_ptr<ThreadPool> pool_;
+};
 
 MultiColumnWriter::MultiColumnWriter(FsManager* fs,
-                                     const Schema* schema)
+                                     const Schema* schema,
+                                     bool cache_written_blocks,
+                                     scoped_refptr<cfile::BlockCacheAttribution>
+                                         block_cache_attribution,
+                                     fs::CreateBlockOptions block_opts)
   : fs_(fs),
     schema_(schema),
+    cache_written_blocks_(cache_written_blocks),
+    block_cache_attribution_(std::move(block_cache_attribution)),
+    block_opts_(block_opts),
     finished_(false) {
 }
 
@@ -67,9 +126,21 @@ Status MultiColumnWriter::Open() {
       opts.write_validx = true;
     }
 
+    // Key columns are already pruned through the key range of the scan.
+    if (i >= schema_->num_key_columns()) {
+      opts.write_block_stats = FLAGS_cfile_write_block_stats;
+    }
+
+    opts.write_value_bloom = col.attributes().bloom_filter;
+    opts.write_secondary_index = col.attributes().secondary_index;
+    opts.write_column_stats = FLAGS_cfile_write_column_stats;
+
+    opts.cache_written_blocks = cache_written_blocks_;
+    opts.block_cache_attribution = block_cache_attribution_;
+
     // Open file for write.
     gscoped_ptr<WritableBlock> block;
-    RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(&block),
+    RETURN_NOT_OK_PREPEND(fs_->CreateNewBlock(block_opts_, &block),
                           "Unable to open output file for column " + col.ToString());
     BlockId block_id(block->id());
 
@@ -91,7 +162,50 @@ Status MultiColumnWriter::Open() {
 }
 
 Status MultiColumnWriter::AppendBlock(const RowBlock& block) {
-  for (int i = 0; i < schema_->num_columns(); i++) {
+  const int num_columns = schema_->num_columns();
+  int num_groups = 1;
+  if (FLAGS_flush_column_writer_threads > 0) {
+    num_groups = std::min(FLAGS_flush_column_writer_threads + 1,
+                          num_columns / std::max(FLAGS_flush_column_writer_min_columns_per_thread,
+                                                 1));
+  }
+  if (num_groups <= 1) {
+    return AppendColumns(block, 0, num_columns);
+  }
+
+  // Split the columns in contiguous groups. This thread writes the first
+  // group while the pool writes the others. Each column has its own
+  // CFileWriter and block, so the groups share no state; the blocks are
+  // only handed to the block manager, in column order, by Finish().
+  vector<Status> statuses(num_groups);
+  CountDownLatch latch(num_groups - 1);
+  ThreadPool* pool = ColumnWriterPool::Get();
+  bool background_io = IoRateLimiter::IsBackgroundIoThread();
+  for (int g = 1; g < num_groups; g++) {
+    int start = g * num_columns / num_groups;
+    int end = (g + 1) * num_columns / num_groups;
+    Status s = pool->SubmitFunc([this, &block, &statuses, &latch, g, start, end,
+                                 background_io]() {
+        ScopedBackgroundIo scope(background_io);
+        statuses[g] = AppendColumns(block, start, end);
+        latch.CountDown();
+      });
+    if (PREDICT_FALSE(!s.ok())) {
+      statuses[g] = AppendColumns(block, start, end);
+      latch.CountDown();
+    }
+  }
+  statuses[0] = AppendColumns(block, 0, num_columns / num_groups);
+  latch.Wait();
+
+  for (const Status& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+  return Status::OK();
+}
+
+Status MultiColumnWriter::AppendColumns(const RowBlock& block, int start, int end) {
+  for (int i = start; i < end; i++) {
     ColumnBlock column = block.column_block(i);
     if (column.is_nullable()) {
       RETURN_NOT_OK(cfile_writers_[i]->AppendNullableEntries(column.null_bitmap(),
@@ -22,8 +22,10 @@
 #include <vector>
 
 #include "kudu/common/schema.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
 
 namespace kudu {
 
@@ -31,6 +33,7 @@ class RowBlock;
 class Schema;
 
 namespace cfile {
+class BlockCacheAttribution;
 class CFileWriter;
 } // namespace cfile
 
@@ -44,8 +47,15 @@ namespace tablet {
 // Schema.
 class MultiColumnWriter {
  public:
+  // If 'cache_written_blocks' is true, the blocks of the columns are inserted
+  // into the block cache as they are written, accounted for in
+  // 'block_cache_attribution' if it is not null. The blocks are created with
+  // 'block_opts'.
   MultiColumnWriter(FsManager* fs,
-                    const Schema* schema);
+                    const Schema* schema,
+                    bool cache_written_blocks = false,
+                    scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution = nullptr,
+                    fs::CreateBlockOptions block_opts = fs::CreateBlockOptions());
 
   virtual ~MultiColumnWriter();
 
@@ -54,6 +64,10 @@ class MultiColumnWriter {
 
   // Append the given block to the output columns.
   //
+  // Wide schemas have their columns encoded and compressed in parallel by a
+  // process-wide pool of threads (see --flush_column_writer_threads). The
+  // call returns once every column has been appended.
+  //
   // Note that the selection vector here is ignored.
   Status AppendBlock(const RowBlock& block);
 
@@ -80,8 +94,14 @@ class MultiColumnWriter {
   void GetFlushedBlocksByColumnId(std::map<ColumnId, BlockId>* ret) const;
 
  private:
+  // Append the columns [start, end) of 'block' to their writers.
+  Status AppendColumns(const RowBlock& block, int start, int end);
+
   FsManager* const fs_;
   const Schema* const schema_;
+  const bool cache_written_blocks_;
+  const scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution_;
+  const fs::CreateBlockOptions block_opts_;
 
   bool finished_;
 
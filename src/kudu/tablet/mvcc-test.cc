@@ -15,18 +15,30 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <atomic>
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/server/logical_clock.h"
 #include "kudu/tablet/mvcc.h"
 #include "kudu/util/monotime.h"
+#include "kudu/util/stopwatch.h"
 #include "kudu/util/test_util.h"
 
+DEFINE_int32(mvcc_benchmark_num_writers, 8,
+             "Number of threads running transactions in the contention benchmark");
+DEFINE_int32(mvcc_benchmark_num_readers, 4,
+             "Number of threads taking snapshots in the contention benchmark");
+DEFINE_int32(mvcc_benchmark_txns_per_writer, 20000,
+             "Number of transactions run by each writer in the contention benchmark");
+
 using std::thread;
+using std::vector;
 
 namespace kudu {
 namespace tablet {
@@ -680,5 +692,74 @@ TEST_F(MvccTest, TestWaitUntilCleanDeadline) {
   ASSERT_TRUE(s.IsTimedOut()) << s.ToString();
 }
 
+// Benchmark for contention on the MvccManager: several threads run
+// transactions through their whole lifecycle while others repeatedly take
+// snapshots, as scans do.
+TEST_F(MvccTest, TestContentionBenchmark) {
+  MvccManager mgr;
+  const int kNumWriters = FLAGS_mvcc_benchmark_num_writers;
+  const int kNumReaders = FLAGS_mvcc_benchmark_num_readers;
+  const int kTxnsPerWriter = FLAGS_mvcc_benchmark_txns_per_writer;
+
+  // Like TimeManager, assign timestamps and start transactions in timestamp
+  // order so that the safe time can follow the latest started transaction.
+  simple_spinlock start_lock;
+  std::atomic<bool> writers_done(false);
+  std::atomic<int64_t> snapshots_taken(0);
+
+  vector<thread> writers;
+  vector<thread> readers;
+  Stopwatch sw;
+  sw.start();
+  for (int i = 0; i < kNumWriters; i++) {
+    writers.emplace_back([&]() {
+      for (int j = 0; j < kTxnsPerWriter; j++) {
+        Timestamp ts;
+        {
+          std::lock_guard<simple_spinlock> l(start_lock);
+          ts = clock_->Now();
+          mgr.StartTransaction(ts);
+          mgr.AdjustSafeTime(ts);
+        }
+        mgr.StartApplyingTransaction(ts);
+        mgr.CommitTransaction(ts);
+      }
+    });
+  }
+  for (int i = 0; i < kNumReaders; i++) {
+    readers.emplace_back([&]() {
+      int64_t count = 0;
+      MvccSnapshot snap;
+      while (!writers_done) {
+        // The clean time never moves back, so a snapshot taken after reading
+        // it must consider everything below it committed.
+        Timestamp clean = mgr.GetCleanTimestamp();
+        mgr.TakeSnapshot(&snap);
+        CHECK(snap.IsCommitted(Timestamp(clean.value() - 1)));
+        count++;
+      }
+      snapshots_taken += count;
+    });
+  }
+  for (thread& t : writers) {
+    t.join();
+  }
+  writers_done = true;
+  for (thread& t : readers) {
+    t.join();
+  }
+  sw.stop();
+
+  int64_t num_txns = static_cast<int64_t>(kNumWriters) * kTxnsPerWriter;
+  double secs = sw.elapsed().wall_seconds();
+  LOG(INFO) << "Ran " << num_txns << " transactions with " << kNumWriters << " writers and "
+            << kNumReaders << " readers in " << secs << "s: "
+            << (num_txns / secs) << " txns/sec, "
+            << (snapshots_taken / secs) << " snapshots/sec";
+
+  ASSERT_EQ(0, mgr.CountTransactionsInFlight());
+  ASSERT_TRUE(mgr.AreAllTransactionsCommitted(clock_->Now()));
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -41,6 +41,7 @@ MvccManager::MvccManager()
     earliest_in_flight_(Timestamp::kMax) {
   cur_snap_.all_committed_before_ = Timestamp::kInitialTimestamp;
   cur_snap_.none_committed_at_or_after_ = Timestamp::kInitialTimestamp;
+  PublishSnapshotUnlocked();
 }
 
 void MvccManager::StartTransaction(Timestamp timestamp) {
@@ -78,11 +79,18 @@ bool MvccManager::InitTransactionUnlocked(const Timestamp& timestamp) {
     return false;
   }
 
+  // Timestamps are usually handed out in increasing order, so hint that the
+  // new entry belongs at the end of the map.
+  size_t old_size = timestamps_in_flight_.size();
+  timestamps_in_flight_.emplace_hint(timestamps_in_flight_.end(), timestamp.value(), RESERVED);
+  if (PREDICT_FALSE(timestamps_in_flight_.size() == old_size)) {
+    return false;
+  }
+
   if (timestamp < earliest_in_flight_) {
     earliest_in_flight_ = timestamp;
   }
-
-  return InsertIfNotPresent(&timestamps_in_flight_, timestamp.value(), RESERVED);
+  return true;
 }
 
 void MvccManager::AbortTransaction(Timestamp timestamp) {
@@ -113,6 +121,7 @@ void MvccManager::CommitTransaction(Timestamp timestamp) {
     // the "clean" timestamp.
     AdjustCleanTime();
   }
+  PublishSnapshotUnlocked();
 }
 
 MvccManager::TxnState MvccManager::RemoveInFlightAndGetStateUnlocked(Timestamp ts) {
@@ -138,8 +147,9 @@ void MvccManager::CommitTransactionUnlocked(Timestamp timestamp,
     << "Trying to commit a transaction which never entered APPLYING state: "
     << timestamp.ToString() << " state=" << old_state;
 
-  // Add to snapshot's committed list
-  cur_snap_.AddCommittedTimestamp(timestamp);
+  // Add to snapshot's committed list. The transaction was in flight, so it
+  // can't already be committed in the snapshot.
+  cur_snap_.AddNewlyCommittedTimestamp(timestamp);
 
   // If we're committing the earliest transaction that was in flight,
   // update our cached value.
@@ -152,11 +162,17 @@ void MvccManager::AdvanceEarliestInFlightTimestamp() {
   if (timestamps_in_flight_.empty()) {
     earliest_in_flight_ = Timestamp::kMax;
   } else {
-    earliest_in_flight_ = Timestamp(std::min_element(timestamps_in_flight_.begin(),
-                                                     timestamps_in_flight_.end())->first);
+    earliest_in_flight_ = Timestamp(timestamps_in_flight_.begin()->first);
   }
 }
 
+void MvccManager::PublishSnapshotUnlocked() {
+  Timestamp::val_type clean = cur_snap_.all_committed_before_.value();
+  clean_time_.store(clean, std::memory_order_release);
+  clean_snapshot_time_.store(cur_snap_.is_clean() ? clean : Timestamp::kInvalidTimestamp.value(),
+                             std::memory_order_release);
+}
+
 void MvccManager::AdjustSafeTime(Timestamp safe_time) {
   std::lock_guard<LockType> l(lock_);
 
@@ -177,6 +193,7 @@ void MvccManager::AdjustSafeTime(Timestamp safe_time) {
   }
 
   AdjustCleanTime();
+  PublishSnapshotUnlocked();
 }
 
 // Remove any elements from 'v' which are < the given watermark.
@@ -288,15 +305,17 @@ bool MvccManager::AreAllTransactionsCommittedUnlocked(Timestamp ts) const {
 bool MvccManager::AnyApplyingAtOrBeforeUnlocked(Timestamp ts) const {
   // TODO(todd) this is not actually checking on the applying txns, it's checking on
   // _all in-flight_. Is this a bug?
-  for (const InFlightMap::value_type entry : timestamps_in_flight_) {
-    if (entry.first <= ts.value()) {
-      return true;
-    }
-  }
-  return false;
+  return !timestamps_in_flight_.empty() &&
+      timestamps_in_flight_.begin()->first <= ts.value();
 }
 
 void MvccManager::TakeSnapshot(MvccSnapshot *snap) const {
+  // Fast path: a clean snapshot is fully described by its watermark.
+  Timestamp::val_type clean = clean_snapshot_time_.load(std::memory_order_acquire);
+  if (PREDICT_TRUE(clean != Timestamp::kInvalidTimestamp.value())) {
+    *snap = MvccSnapshot(Timestamp(clean));
+    return;
+  }
   std::lock_guard<LockType> l(lock_);
   *snap = cur_snap_;
 }
@@ -318,9 +337,10 @@ void MvccManager::WaitForApplyingTransactionsToCommit() const {
   Timestamp wait_for = Timestamp::kMin;
   {
     std::lock_guard<LockType> l(lock_);
-    for (const InFlightMap::value_type entry : timestamps_in_flight_) {
-      if (entry.second == APPLYING) {
-        wait_for = Timestamp(std::max(entry.first, wait_for.value()));
+    for (auto it = timestamps_in_flight_.rbegin(); it != timestamps_in_flight_.rend(); ++it) {
+      if (it->second == APPLYING) {
+        wait_for = Timestamp(it->first);
+        break;
       }
     }
   }
@@ -337,6 +357,7 @@ void MvccManager::WaitForApplyingTransactionsToCommit() const {
 }
 
 bool MvccManager::AreAllTransactionsCommitted(Timestamp ts) const {
+  if (ts.value() < clean_time_.load(std::memory_order_acquire)) return true;
   std::lock_guard<LockType> l(lock_);
   return AreAllTransactionsCommittedUnlocked(ts);
 }
@@ -347,8 +368,7 @@ int MvccManager::CountTransactionsInFlight() const {
 }
 
 Timestamp MvccManager::GetCleanTimestamp() const {
-  std::lock_guard<LockType> l(lock_);
-  return cur_snap_.all_committed_before_;
+  return Timestamp(clean_time_.load(std::memory_order_acquire));
 }
 
 void MvccManager::GetApplyingTransactionsTimestamps(std::vector<Timestamp>* timestamps) const {
@@ -442,7 +462,11 @@ void MvccSnapshot::AddCommittedTimestamps(const std::vector<Timestamp>& timestam
 
 void MvccSnapshot::AddCommittedTimestamp(Timestamp timestamp) {
   if (IsCommitted(timestamp)) return;
+  AddNewlyCommittedTimestamp(timestamp);
+}
 
+void MvccSnapshot::AddNewlyCommittedTimestamp(Timestamp timestamp) {
+  DCHECK(!IsCommitted(timestamp));
   committed_timestamps_.push_back(timestamp.value());
 
   // If this is a new upper bound commit mark, update it.
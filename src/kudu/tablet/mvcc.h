@@ -17,10 +17,11 @@
 #ifndef KUDU_TABLET_MVCC_H
 #define KUDU_TABLET_MVCC_H
 
+#include <atomic>
 #include <gtest/gtest_prod.h>
+#include <map>
 #include <mutex>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "kudu/gutil/gscoped_ptr.h"
@@ -117,6 +118,11 @@ class MvccSnapshot {
 
   void AddCommittedTimestamp(Timestamp timestamp);
 
+  // Like AddCommittedTimestamp(), but for a timestamp which the caller knows
+  // is not yet committed in this snapshot. Skips the (possibly linear)
+  // IsCommitted() check.
+  void AddNewlyCommittedTimestamp(Timestamp timestamp);
+
   // Summary rule:
   //   A transaction T is committed if and only if:
   //      T < all_committed_before_ or
@@ -226,6 +232,9 @@ class MvccManager {
 
   // Take a snapshot of the current MVCC state, which indicates which
   // transactions have been committed at the time of this call.
+  //
+  // If the current state is clean (see MvccSnapshot::is_clean()) this does not
+  // take the manager's lock.
   void TakeSnapshot(MvccSnapshot *snapshot) const;
 
   // Take a snapshot of the MVCC state at 'timestamp' (i.e which includes
@@ -254,6 +263,8 @@ class MvccManager {
 
   // Returns the earliest possible timestamp for an uncommitted transaction.
   // All timestamps before this one are guaranteed to be committed.
+  //
+  // This does not take the manager's lock.
   Timestamp GetCleanTimestamp() const;
 
   // Return the timestamps of all transactions which are currently 'APPLYING'
@@ -333,6 +344,11 @@ class MvccManager {
   // commits or aborts.
   void AdvanceEarliestInFlightTimestamp();
 
+  // Publishes the watermarks of 'cur_snap_' to 'clean_time_' and
+  // 'clean_snapshot_time_'. Must be called with 'lock_' held after any change
+  // to 'cur_snap_'.
+  void PublishSnapshotUnlocked();
+
   int GetNumWaitersForTests() const {
     std::lock_guard<simple_spinlock> l(lock_);
     return waiters_.size();
@@ -344,9 +360,20 @@ class MvccManager {
   MvccSnapshot cur_snap_;
 
   // The set of timestamps corresponding to currently in-flight transactions.
-  typedef std::unordered_map<Timestamp::val_type, TxnState> InFlightMap;
+  // Kept sorted so that the earliest in-flight transaction can be found
+  // without scanning the whole set when it commits or aborts.
+  typedef std::map<Timestamp::val_type, TxnState> InFlightMap;
   InFlightMap timestamps_in_flight_;
 
+  // Copy of 'cur_snap_.all_committed_before_', which may be read without
+  // holding 'lock_'.
+  std::atomic<Timestamp::val_type> clean_time_;
+
+  // If 'cur_snap_' is clean, a copy of 'cur_snap_.all_committed_before_';
+  // otherwise Timestamp::kInvalidTimestamp. Lets readers construct a copy of
+  // a clean snapshot without taking 'lock_'.
+  std::atomic<Timestamp::val_type> clean_snapshot_time_;
+
   // A transaction timestamp below which all transactions are either committed or in-flight,
   // meaning no new transactions will be started with a timestamp that is equal
   // to or lower than this one.
@@ -0,0 +1,172 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/read_amplification.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <gflags/gflags.h>
+
+#include "kudu/common/schema.h"
+#include "kudu/gutil/stringprintf.h"
+#include "kudu/gutil/strings/human_readable.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/delta_tracker.h"
+#include "kudu/tablet/diskrowset.h"
+#include "kudu/tablet/rowset_info.h"
+
+DECLARE_int32(cfile_default_block_size);
+DECLARE_int32(deltafile_default_block_size);
+DECLARE_int32(tablet_bloom_block_size);
+DECLARE_double(tablet_bloom_target_fp_rate);
+
+using std::endl;
+using std::pair;
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tablet {
+
+void ComputeReadAmplification(const RowSetTree& tree,
+                              const Schema& schema,
+                              ReadAmplificationReport* report) {
+  *report = ReadAmplificationReport();
+  vector<RowSetInfo> min_key_ordered;
+  vector<RowSetInfo> max_key_ordered;
+  RowSetInfo::CollectOrdered(tree, &min_key_ordered, &max_key_ordered);
+
+  // The height of a key is the number of rowsets whose bounds include it:
+  // sweep the bounds in key order, a rowset starting at a key before another
+  // ends at it since the bounds are inclusive.
+  vector<pair<string, int>> bounds;
+  int64_t total_redo_depth = 0;
+  for (const RowSetInfo& info : min_key_ordered) {
+    DiskRowSet* drs = dynamic_cast<DiskRowSet*>(info.rowset());
+    if (drs == nullptr) {
+      // A DuplicatingRowSet, while its inputs are being compacted.
+      continue;
+    }
+    RowSetReadCost cost;
+    cost.name = drs->ToString();
+    cost.cdf_min_key = info.cdf_min_key();
+    cost.cdf_max_key = info.cdf_max_key();
+    cost.base_data_bytes = drs->EstimateBaseDataDiskSize();
+    DeltaTracker* deltas = drs->delta_tracker();
+    cost.num_redo_deltas = deltas->CountRedoDeltaStores();
+    cost.redo_delta_bytes = deltas->EstimateOnDiskSize();
+    cost.num_undo_deltas = deltas->CountUndoDeltaStores();
+    cost.undo_delta_bytes = deltas->EstimateUndoDeltasOnDiskSize();
+    cost.dms_bytes = drs->DeltaMemStoreEmpty() ? 0 : drs->DeltaMemStoreSize();
+    cost.redo_depth = cost.num_redo_deltas + (drs->DeltaMemStoreEmpty() ? 0 : 1);
+    total_redo_depth += cost.redo_depth;
+    report->max_redo_depth = std::max(report->max_redo_depth, cost.redo_depth);
+    report->average_height += info.width();
+    if (info.has_bounds()) {
+      bounds.emplace_back(info.min_key(), -1);
+      bounds.emplace_back(info.max_key(), 1);
+    }
+    report->rowsets.emplace_back(std::move(cost));
+  }
+  // At an equal key, the starts (-1) sort before the ends (1).
+  std::sort(bounds.begin(), bounds.end());
+  int height = 0;
+  for (const auto& b : bounds) {
+    height -= b.second;
+    report->max_height = std::max(report->max_height, height);
+  }
+  if (report->rowsets.empty()) {
+    return;
+  }
+  report->average_redo_depth =
+      static_cast<double>(total_redo_depth) / report->rowsets.size();
+
+  // A point lookup probes the bloom filter of every rowset the key falls in.
+  // The one holding the row and the false positives are then searched by key.
+  double other_rowsets = std::max(0.0, report->average_height - 1);
+  report->bloom_false_positives_per_lookup = other_rowsets * FLAGS_tablet_bloom_target_fp_rate;
+  double key_searches = 1 + report->bloom_false_positives_per_lookup;
+  int num_other_columns = schema.num_columns() - schema.num_key_columns();
+  report->point_lookup_bytes = static_cast<uint64_t>(
+      std::max(1.0, report->average_height) * FLAGS_tablet_bloom_block_size +
+      key_searches * FLAGS_cfile_default_block_size +
+      num_other_columns * FLAGS_cfile_default_block_size +
+      report->average_redo_depth * FLAGS_deltafile_default_block_size);
+}
+
+string ReadAmplificationReport::ToString() const {
+  string ret;
+  ret.append(Substitute("Rowsets: $0 (MemRowSet: $1)\n", rowsets.size(),
+                        HumanReadableNumBytes::ToString(mrs_bytes)));
+  ret.append(StringPrintf("Rowset height: %.2f average, %d max\n",
+                          average_height, max_height));
+  ret.append(StringPrintf("REDO depth: %.2f average, %d max\n",
+                          average_redo_depth, max_redo_depth));
+  ret.append(StringPrintf("Bloom false positives per lookup: %.6f\n",
+                          bloom_false_positives_per_lookup));
+  ret.append(Substitute("Estimated bytes read per point lookup: $0\n",
+                        HumanReadableNumBytes::ToString(point_lookup_bytes)));
+  for (const RowSetReadCost& rs : rowsets) {
+    ret.append(StringPrintf(
+        "  %s [%.4f, %.4f]: base %s, %zu REDO (%s, depth %d), %zu UNDO (%s), DMS %s\n",
+        rs.name.c_str(), rs.cdf_min_key, rs.cdf_max_key,
+        HumanReadableNumBytes::ToString(rs.base_data_bytes).c_str(),
+        rs.num_redo_deltas, HumanReadableNumBytes::ToString(rs.redo_delta_bytes).c_str(),
+        rs.redo_depth,
+        rs.num_undo_deltas, HumanReadableNumBytes::ToString(rs.undo_delta_bytes).c_str(),
+        HumanReadableNumBytes::ToString(rs.dms_bytes).c_str()));
+  }
+  return ret;
+}
+
+void ReadAmplificationReport::DumpHtml(std::ostream* out) const {
+  *out << "<table class=\"table table-striped\">" << endl;
+  *out << Substitute("<tr><th>Rowsets</th><td>$0</td></tr>", rowsets.size()) << endl;
+  *out << Substitute("<tr><th>MemRowSet</th><td>$0</td></tr>",
+                     HumanReadableNumBytes::ToString(mrs_bytes)) << endl;
+  *out << StringPrintf("<tr><th>Rowset height</th><td>%.2f average, %d max</td></tr>",
+                       average_height, max_height) << endl;
+  *out << StringPrintf("<tr><th>REDO depth</th><td>%.2f average, %d max</td></tr>",
+                       average_redo_depth, max_redo_depth) << endl;
+  *out << StringPrintf("<tr><th>Bloom false positives per lookup</th><td>%.6f</td></tr>",
+                       bloom_false_positives_per_lookup) << endl;
+  *out << Substitute("<tr><th>Estimated bytes read per point lookup</th><td>$0</td></tr>",
+                     HumanReadableNumBytes::ToString(point_lookup_bytes)) << endl;
+  *out << "</table>" << endl;
+
+  *out << "<table class=\"table table-striped\">" << endl;
+  *out << "<tr><th>Rowset</th><th>Key space</th><th>Base data</th>"
+       << "<th>REDO deltas</th><th>REDO depth</th><th>UNDO deltas</th>"
+       << "<th>DeltaMemStore</th></tr>" << endl;
+  for (const RowSetReadCost& rs : rowsets) {
+    *out << StringPrintf("<tr><td>%s</td><td>[%.4f, %.4f]</td><td>%s</td>"
+                         "<td>%zu (%s)</td><td>%d</td><td>%zu (%s)</td><td>%s</td></tr>",
+                         rs.name.c_str(), rs.cdf_min_key, rs.cdf_max_key,
+                         HumanReadableNumBytes::ToString(rs.base_data_bytes).c_str(),
+                         rs.num_redo_deltas,
+                         HumanReadableNumBytes::ToString(rs.redo_delta_bytes).c_str(),
+                         rs.redo_depth, rs.num_undo_deltas,
+                         HumanReadableNumBytes::ToString(rs.undo_delta_bytes).c_str(),
+                         HumanReadableNumBytes::ToString(rs.dms_bytes).c_str()) << endl;
+  }
+  *out << "</table>" << endl;
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,88 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_READ_AMPLIFICATION_H_
+#define KUDU_TABLET_READ_AMPLIFICATION_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace kudu {
+
+class Schema;
+
+namespace tablet {
+
+class RowSetTree;
+
+// The layout of a DiskRowSet, as far as reading it costs.
+struct RowSetReadCost {
+  std::string name;
+  // The data-weighted fraction of the key space of the tablet the rowset
+  // spans, see RowSetInfo.
+  double cdf_min_key = 0;
+  double cdf_max_key = 0;
+  uint64_t base_data_bytes = 0;
+  size_t num_redo_deltas = 0;
+  uint64_t redo_delta_bytes = 0;
+  size_t num_undo_deltas = 0;
+  uint64_t undo_delta_bytes = 0;
+  size_t dms_bytes = 0;
+  // The number of REDO delta stores, including a non-empty DeltaMemStore,
+  // merged to read the current version of a row of the rowset.
+  int redo_depth = 0;
+};
+
+// A summary of how expensive a tablet is to read, to relate slow reads to
+// the compaction debt of the tablet.
+struct ReadAmplificationReport {
+  std::vector<RowSetReadCost> rowsets;
+  size_t mrs_bytes = 0;
+
+  // The number of rowsets a key falls in, on average over the data-weighted
+  // key space, and at most.
+  double average_height = 0;
+  int max_height = 0;
+
+  double average_redo_depth = 0;
+  int max_redo_depth = 0;
+
+  // The expected number of rowsets whose bloom filter matches a key that
+  // they don't contain, in a point lookup.
+  double bloom_false_positives_per_lookup = 0;
+
+  // The estimated number of bytes read from uncached blocks by the point
+  // lookup of a full row: a bloom filter block per rowset the key falls in,
+  // a key block for the rowset holding the row and for each false positive,
+  // a block per other column and a block per REDO delta store to apply.
+  uint64_t point_lookup_bytes = 0;
+
+  std::string ToString() const;
+  void DumpHtml(std::ostream* out) const;
+};
+
+// Computes the report of the DiskRowSets in 'tree', of a tablet whose
+// schema is 'schema'.
+void ComputeReadAmplification(const RowSetTree& tree,
+                              const Schema& schema,
+                              ReadAmplificationReport* report);
+
+} // namespace tablet
+} // namespace kudu
+
+#endif
@@ -81,6 +81,12 @@ struct RowOp {
   // If this operation is being replayed from the log, set to the original
   // result. Otherwise nullptr.
   const OperationResultPB* orig_result_from_log_;
+
+  // Set if the rowsets with known bounds (i.e. the DiskRowSets) were already
+  // checked for this op's key along with the rest of its batch, in which case
+  // 'present_in_rowset' is the one found to hold the key, or nullptr.
+  bool checked_present;
+  RowSet* present_in_rowset;
 };
 
 
@@ -17,6 +17,8 @@
 
 #include "kudu/tablet/rowset.h"
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <memory>
 #include <string>
@@ -33,6 +35,97 @@ using strings::Substitute;
 
 namespace kudu { namespace tablet {
 
+RowSetAccessStats::RowSetAccessStats()
+    : count_(0),
+      last_count_(0),
+      last_time_(MonoTime::Now()),
+      rate_(0),
+      last_access_count_(0),
+      last_access_time_(last_time_) {
+}
+
+double RowSetAccessStats::RecentRate(MonoTime now, MonoDelta half_life) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  double elapsed_secs = (now - last_time_).ToSeconds();
+  if (elapsed_secs <= 0) {
+    return rate_;
+  }
+  int64_t cur_count = count();
+  double cur_rate = (cur_count - last_count_) / elapsed_secs;
+  // Weight the old rate by how much of it survives 'elapsed_secs' of decay.
+  double decay = std::exp2(-elapsed_secs / half_life.ToSeconds());
+  rate_ = rate_ * decay + cur_rate * (1 - decay);
+  last_count_ = cur_count;
+  last_time_ = now;
+  return rate_;
+}
+
+MonoTime RowSetAccessStats::LastAccessTime(MonoTime now) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  int64_t cur_count = count();
+  if (cur_count != last_access_count_) {
+    last_access_count_ = cur_count;
+    last_access_time_ = now;
+  }
+  return last_access_time_;
+}
+
+Status RowSet::CheckRowsPresent(const RowSetKeyProbe* const* probes, int num_probes,
+                                bool* present, ProbeStats* const* stats) const {
+  for (int i = 0; i < num_probes; i++) {
+    RETURN_NOT_OK(CheckRowPresent(*probes[i], &present[i], stats[i]));
+  }
+  return Status::OK();
+}
+
+Status PickSplitKeys(const RowSetVector& rowsets,
+                     int num_ranges,
+                     const string& lower_bound,
+                     const string& upper_bound,
+                     vector<string>* split_keys) {
+  if (num_ranges <= 1) {
+    return Status::OK();
+  }
+
+  // Number of keys sampled from each rowset for every range to pick.
+  const int kSamplesPerRange = 16;
+
+  // Each sampled key stands for the rows between it and the previous sample
+  // of its rowset, so that big rowsets weigh more than small ones. Samples
+  // outside of the bounds are dropped along with the rows they stand for.
+  vector<std::pair<string, double>> samples;
+  double total_rows = 0;
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    rowid_t num_rows;
+    RETURN_NOT_OK(rs->CountRows(&num_rows));
+    vector<string> keys;
+    RETURN_NOT_OK(rs->SampleKeys(num_ranges * kSamplesPerRange, &keys));
+    double rows_per_key = static_cast<double>(num_rows) / (keys.size() + 1);
+    for (string& key : keys) {
+      if (key <= lower_bound || (!upper_bound.empty() && key >= upper_bound)) {
+        continue;
+      }
+      samples.emplace_back(std::move(key), rows_per_key);
+      total_rows += rows_per_key;
+    }
+  }
+  std::sort(samples.begin(), samples.end());
+
+  // Pick the sample at which each successive 1/num_ranges of the rows ends.
+  double cumulative_rows = 0;
+  int next_range = 1;
+  for (const auto& sample : samples) {
+    if (next_range >= num_ranges) break;
+    cumulative_rows += sample.second;
+    if (cumulative_rows < total_rows * next_range / num_ranges) continue;
+    if (split_keys->empty() || split_keys->back() != sample.first) {
+      split_keys->push_back(sample.first);
+    }
+    next_range++;
+  }
+  return Status::OK();
+}
+
 DuplicatingRowSet::DuplicatingRowSet(RowSetVector old_rowsets,
                                      RowSetVector new_rowsets)
     : old_rowsets_(std::move(old_rowsets)),
@@ -180,6 +273,23 @@ Status DuplicatingRowSet::CheckRowPresent(const RowSetKeyProbe &probe,
   return Status::OK();
 }
 
+bool DuplicatingRowSet::CountLiveRowsFromMetadata(const MvccSnapshot& snap,
+                                                  rowid_t* count) const {
+  // Like iterators, read the inputs of the compaction, which receive every
+  // mutation.
+  int64_t accumulated_count = 0;
+  for (const shared_ptr<RowSet> &rs : old_rowsets_) {
+    rowid_t this_count;
+    if (!rs->CountLiveRowsFromMetadata(snap, &this_count)) {
+      return false;
+    }
+    accumulated_count += this_count;
+  }
+  CHECK_LT(accumulated_count, std::numeric_limits<rowid_t>::max());
+  *count = accumulated_count;
+  return true;
+}
+
 Status DuplicatingRowSet::CountRows(rowid_t *count) const {
   int64_t accumulated_count = 0;
   for (const shared_ptr<RowSet> &rs : new_rowsets_) {
@@ -207,6 +317,16 @@ Status DuplicatingRowSet::GetBounds(string* min_encoded_key,
   return Status::OK();
 }
 
+Status DuplicatingRowSet::SampleKeys(int num_samples,
+                                     vector<string>* encoded_keys) const {
+  // The output rowsets hold all of the rows of the input rowsets and are in
+  // ascending key order, so their samples are too.
+  for (const shared_ptr<RowSet> &rs : new_rowsets_) {
+    RETURN_NOT_OK(rs->SampleKeys(num_samples / new_rowsets_.size() + 1, encoded_keys));
+  }
+  return Status::OK();
+}
+
 uint64_t DuplicatingRowSet::EstimateOnDiskSize() const {
   // The actual value of this doesn't matter, since it won't be selected
   // for compaction.
@@ -28,8 +28,11 @@
 #include "kudu/common/schema.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/tablet/mvcc.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/bloom_filter.h"
 #include "kudu/util/faststring.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
@@ -50,6 +53,42 @@ class RowSetKeyProbe;
 class RowSetMetadata;
 struct ProbeStats;
 
+// Counts the accesses to a RowSet: the lookups of the RowSet by the
+// RowSetTree on behalf of writes and key-range scans. Thread-safe.
+class RowSetAccessStats {
+ public:
+  RowSetAccessStats();
+
+  void RecordAccesses(int64_t count) {
+    count_.IncrementBy(count, kMemOrderNoBarrier);
+  }
+
+  int64_t count() const { return count_.Load(kMemOrderNoBarrier); }
+
+  // Returns the rate of accesses per second, averaged with an exponential
+  // decay of the given half-life. Each call folds in the accesses recorded
+  // since the previous call (or since construction).
+  double RecentRate(MonoTime now, MonoDelta half_life);
+
+  // Returns the time of the last access, to the granularity of the calls:
+  // i.e. 'now' if accesses were recorded since the previous call, or the time
+  // returned by the previous call otherwise. Initially the construction time.
+  MonoTime LastAccessTime(MonoTime now);
+
+ private:
+  AtomicInt<int64_t> count_;
+
+  simple_spinlock lock_;
+  int64_t last_count_;
+  MonoTime last_time_;
+  double rate_;
+
+  int64_t last_access_count_;
+  MonoTime last_access_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(RowSetAccessStats);
+};
+
 class RowSet {
  public:
   enum DeltaCompactionType {
@@ -67,6 +106,15 @@ class RowSet {
   virtual Status CheckRowPresent(const RowSetKeyProbe &probe, bool *present,
                                  ProbeStats* stats) const = 0;
 
+  // Like CheckRowPresent(), for each of the 'num_probes' probes, which must
+  // be in ascending key order. Sets present[i] and updates *stats[i] for
+  // probes[i].
+  //
+  // The default implementation checks each key in turn; rowsets which can
+  // share work across the keys of a batch override it.
+  virtual Status CheckRowsPresent(const RowSetKeyProbe* const* probes, int num_probes,
+                                  bool* present, ProbeStats* const* stats) const;
+
   // Update/delete a row in this rowset.
   // The 'update_schema' is the client schema used to encode the 'update' RowChangeList.
   //
@@ -99,6 +147,12 @@ class RowSet {
   // Count the number of rows in this rowset.
   virtual Status CountRows(rowid_t *count) const = 0;
 
+  // If the number of rows of this rowset which are live in 'snap' can be
+  // computed from its metadata alone, without reading the rows or their
+  // deltas, sets '*count' to it and returns true. Otherwise returns false,
+  // in which case the rows must be counted by iterating over them.
+  virtual bool CountLiveRowsFromMetadata(const MvccSnapshot& snap, rowid_t* count) const = 0;
+
   // Return the bounds for this RowSet. 'min_encoded_key' and 'max_encoded_key'
   // are set to the first and last encoded keys for this RowSet.
   //
@@ -107,6 +161,11 @@ class RowSet {
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const = 0;
 
+  // Append to 'encoded_keys' the encoded keys of up to 'num_samples' rows,
+  // evenly spaced across the rowset and in ascending order.
+  virtual Status SampleKeys(int num_samples,
+                            std::vector<std::string>* encoded_keys) const = 0;
+
   // Return a displayable string for this rowset.
   virtual string ToString() const = 0;
 
@@ -195,6 +254,8 @@ class RowSet {
 
   virtual ~RowSet() {}
 
+  RowSetAccessStats* access_stats() const { return &access_stats_; }
+
   // Return true if this RowSet is available for compaction, based on
   // the current state of the compact_flush_lock. This should only be
   // used under the Tablet's compaction selection lock, or else the
@@ -212,10 +273,26 @@ class RowSet {
     return try_lock.owns_lock();
   }
 
+ private:
+  mutable RowSetAccessStats access_stats_;
 };
 
 // Used often enough, may as well typedef it.
 typedef vector<std::shared_ptr<RowSet> > RowSetVector;
+
+// Append to 'split_keys' up to 'num_ranges - 1' encoded keys, in ascending
+// order, which split the rows of 'rowsets' falling within the encoded key range
+// [lower_bound, upper_bound) into 'num_ranges' ranges holding roughly the same
+// number of rows. Empty bounds are unbounded.
+//
+// The split keys are picked from keys sampled with RowSet::SampleKeys(), so
+// they are only as precise as the samples.
+Status PickSplitKeys(const RowSetVector& rowsets,
+                     int num_ranges,
+                     const std::string& lower_bound,
+                     const std::string& upper_bound,
+                     std::vector<std::string>* split_keys);
+
 // Structure which caches an encoded and hashed key, suitable
 // for probing against rowsets.
 class RowSetKeyProbe {
@@ -323,9 +400,14 @@ class DuplicatingRowSet : public RowSet {
 
   Status CountRows(rowid_t *count) const OVERRIDE;
 
+  bool CountLiveRowsFromMetadata(const MvccSnapshot& snap, rowid_t* count) const OVERRIDE;
+
   virtual Status GetBounds(std::string* min_encoded_key,
                            std::string* max_encoded_key) const OVERRIDE;
 
+  Status SampleKeys(int num_samples,
+                    std::vector<std::string>* encoded_keys) const OVERRIDE;
+
   uint64_t EstimateOnDiskSize() const OVERRIDE;
 
   string ToString() const OVERRIDE;
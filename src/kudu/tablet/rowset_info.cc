@@ -129,8 +129,8 @@ double StringFractionInRange(const RowSetInfo* rsi,
 // Computes the "width" of an interval [prev, next] according to the amount
 // of data estimated to be inside the interval, where this is calculated by
 // multiplying the fraction that the interval takes up in the keyspace of
-// each rowset by the rowset's size (assumes distribution of rows is somewhat
-// uniform).
+// each rowset by the rowset's weighted size (assumes distribution of rows is
+// somewhat uniform).
 // Requires: [prev, next] contained in each rowset in "active"
 double WidthByDataSize(const Slice& prev, const Slice& next,
                        const unordered_map<RowSet*, RowSetInfo*>& active) {
@@ -138,7 +138,7 @@ double WidthByDataSize(const Slice& prev, const Slice& next,
 
   for (const auto& rs_rsi : active) {
     double fraction = StringFractionInRange(rs_rsi.second, prev, next);
-    weight += rs_rsi.second->size_bytes() * fraction;
+    weight += rs_rsi.second->size_bytes() * rs_rsi.second->weight() * fraction;
   }
 
   return weight;
@@ -171,7 +171,8 @@ void RowSetInfo::Collect(const RowSetTree& tree, vector<RowSetInfo>* rsvec) {
 
 void RowSetInfo::CollectOrdered(const RowSetTree& tree,
                                 vector<RowSetInfo>* min_key,
-                                vector<RowSetInfo>* max_key) {
+                                vector<RowSetInfo>* max_key,
+                                const unordered_map<RowSet*, double>* weights) {
   // Resize
   size_t len = tree.all_rowsets().size();
   min_key->reserve(min_key->size() + len);
@@ -227,6 +228,9 @@ void RowSetInfo::CollectOrdered(const RowSetTree& tree,
     // Add/remove current RowSetInfo
     if (rse.endpoint_ == RowSetTree::START) {
       min_key->push_back(RowSetInfo(rs, total_width));
+      if (weights) {
+        min_key->back().weight_ = FindWithDefault(*weights, rs, 1.0);
+      }
       // Store reference from vector. This is safe b/c of reserve() above.
       active.insert(std::make_pair(rs, &min_key->back()));
     } else if (rse.endpoint_ == RowSetTree::STOP) {
@@ -257,7 +261,9 @@ RowSetInfo::RowSetInfo(RowSet* rs, double init_cdf)
     size_bytes_(rs->EstimateOnDiskSize()),
     size_mb_(std::max(implicit_cast<int>(size_bytes_ / 1024 / 1024), kMinSizeMb)),
     cdf_min_key_(init_cdf),
-    cdf_max_key_(init_cdf) {
+    cdf_max_key_(init_cdf),
+    density_(0),
+    weight_(1) {
   has_bounds_ = rs->GetBounds(&min_key_, &max_key_).ok();
 }
 
@@ -281,6 +287,9 @@ string RowSetInfo::ToString() const {
   ret.append(rowset_->ToString());
   StringAppendF(&ret, "(% 3dM) [%.04f, %.04f]", size_mb_,
                 cdf_min_key_, cdf_max_key_);
+  if (weight_ != 1) {
+    StringAppendF(&ret, " weight=%.02f", weight_);
+  }
   if (has_bounds_) {
     ret.append(" [").append(KUDU_REDACT(Slice(min_key_).ToDebugString()));
     ret.append(",").append(KUDU_REDACT(Slice(max_key_).ToDebugString()));
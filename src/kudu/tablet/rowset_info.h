@@ -18,6 +18,7 @@
 #define KUDU_TABLET_ROWSET_INFO_H_
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace kudu {
@@ -37,9 +38,14 @@ class RowSetInfo {
   static void Collect(const RowSetTree& tree, std::vector<RowSetInfo>* rsvec);
   // Appends the rowsets in min-key and max-key sorted order, with
   // cdf values set.
+  //
+  // If 'weights' is not null, the data of each rowset it contains counts
+  // for its weight (1 otherwise) in the cdf. A rowset weighted 2 thus spans
+  // as much of the cdf as a rowset of twice its size.
   static void CollectOrdered(const RowSetTree& tree,
                              std::vector<RowSetInfo>* min_key,
-                             std::vector<RowSetInfo>* max_key);
+                             std::vector<RowSetInfo>* max_key,
+                             const std::unordered_map<RowSet*, double>* weights = nullptr);
 
   int size_bytes() const { return size_bytes_; }
   int size_mb() const { return size_mb_; }
@@ -64,6 +70,9 @@ class RowSetInfo {
 
   double density() const { return density_; }
 
+  // The weight of the rowset's data in the cdf.
+  double weight() const { return weight_; }
+
   RowSet* rowset() const { return rowset_; }
 
   std::string ToString() const;
@@ -99,6 +108,7 @@ class RowSetInfo {
 
   double cdf_min_key_, cdf_max_key_;
   double density_;
+  double weight_;
 };
 
 } // namespace tablet
@@ -73,6 +73,8 @@ Status RowSetMetadata::InitFromPB(const RowSetDataPB& pb) {
     adhoc_index_block_ = BlockId::FromPB(pb.adhoc_index_block());
   }
 
+  cold_ = pb.cold();
+
   // Load Column Files
   for (const ColumnDataPB& col_pb : pb.columns()) {
     ColumnId col_id = ColumnId(col_pb.column_id());
@@ -81,14 +83,23 @@ Status RowSetMetadata::InitFromPB(const RowSetDataPB& pb) {
 
   // Load redo delta files
   for (const DeltaDataPB& redo_delta_pb : pb.redo_deltas()) {
-    redo_delta_blocks_.push_back(BlockId::FromPB(redo_delta_pb.block()));
+    BlockId block_id = BlockId::FromPB(redo_delta_pb.block());
+    redo_delta_blocks_.push_back(block_id);
+    if (redo_delta_pb.has_max_timestamp() && redo_delta_pb.has_delete_count()) {
+      redo_delta_summaries_[block_id] = { Timestamp(redo_delta_pb.max_timestamp()),
+                                          redo_delta_pb.delete_count() };
+    }
   }
 
   last_durable_redo_dms_id_ = pb.last_durable_dms_id();
 
   // Load undo delta files
   for (const DeltaDataPB& undo_delta_pb : pb.undo_deltas()) {
-    undo_delta_blocks_.push_back(BlockId::FromPB(undo_delta_pb.block()));
+    BlockId block_id = BlockId::FromPB(undo_delta_pb.block());
+    undo_delta_blocks_.push_back(block_id);
+    if (undo_delta_pb.has_max_timestamp()) {
+      undo_delta_max_timestamps_[block_id] = Timestamp(undo_delta_pb.max_timestamp());
+    }
   }
 
   initted_ = true;
@@ -116,11 +127,20 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
   for (const BlockId& redo_delta_block : redo_delta_blocks_) {
     DeltaDataPB *redo_delta_pb = pb->add_redo_deltas();
     redo_delta_block.CopyToPB(redo_delta_pb->mutable_block());
+    const RedoDeltaSummary* summary = FindOrNull(redo_delta_summaries_, redo_delta_block);
+    if (summary) {
+      redo_delta_pb->set_max_timestamp(summary->max_timestamp.ToUint64());
+      redo_delta_pb->set_delete_count(summary->delete_count);
+    }
   }
 
   for (const BlockId& undo_delta_block : undo_delta_blocks_) {
     DeltaDataPB *undo_delta_pb = pb->add_undo_deltas();
     undo_delta_block.CopyToPB(undo_delta_pb->mutable_block());
+    const Timestamp* max_timestamp = FindOrNull(undo_delta_max_timestamps_, undo_delta_block);
+    if (max_timestamp) {
+      undo_delta_pb->set_max_timestamp(max_timestamp->ToUint64());
+    }
   }
 
   // Write Bloom File
@@ -132,6 +152,10 @@ void RowSetMetadata::ToProtobuf(RowSetDataPB *pb) {
   if (!adhoc_index_block_.IsNull()) {
     adhoc_index_block_.CopyToPB(pb->mutable_adhoc_index_block());
   }
+
+  if (cold_) {
+    pb->set_cold(true);
+  }
 }
 
 const string RowSetMetadata::ToString() const {
@@ -144,16 +168,24 @@ void RowSetMetadata::SetColumnDataBlocks(const ColumnIdToBlockIdMap& blocks) {
 }
 
 Status RowSetMetadata::CommitRedoDeltaDataBlock(int64_t dms_id,
-                                                const BlockId& block_id) {
+                                                const BlockId& block_id,
+                                                const RedoDeltaSummary* summary) {
   std::lock_guard<LockType> l(lock_);
   last_durable_redo_dms_id_ = dms_id;
   redo_delta_blocks_.push_back(block_id);
+  if (summary) {
+    redo_delta_summaries_[block_id] = *summary;
+  }
   return Status::OK();
 }
 
-Status RowSetMetadata::CommitUndoDeltaDataBlock(const BlockId& block_id) {
+Status RowSetMetadata::CommitUndoDeltaDataBlock(const BlockId& block_id,
+                                                Timestamp max_timestamp) {
   std::lock_guard<LockType> l(lock_);
   undo_delta_blocks_.push_back(block_id);
+  if (max_timestamp != Timestamp::kInvalidTimestamp) {
+    undo_delta_max_timestamps_[block_id] = max_timestamp;
+  }
   return Status::OK();
 }
 
@@ -180,9 +212,18 @@ Status RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update) {
         ++end_it;
       }
 
+      for (auto it = start_it; it != end_it; ++it) {
+        redo_delta_summaries_.erase(*it);
+      }
       removed.insert(removed.end(), start_it, end_it);
       redo_delta_blocks_.erase(start_it, end_it);
       redo_delta_blocks_.insert(start_it, rep.to_add.begin(), rep.to_add.end());
+      for (const BlockId& b : rep.to_add) {
+        const RedoDeltaSummary* summary = FindOrNull(update.redo_summaries_, b);
+        if (summary) {
+          redo_delta_summaries_[b] = *summary;
+        }
+      }
     }
 
     // Add new redo blocks
@@ -199,6 +240,7 @@ Status RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update) {
       if (ContainsKey(undos_to_remove, *iter)) {
         removed.push_back(*iter);
         undos_to_remove.erase(*iter);
+        undo_delta_max_timestamps_.erase(*iter);
         iter = undo_delta_blocks_.erase(iter);
         num_removed++;
       } else {
@@ -216,6 +258,10 @@ Status RowSetMetadata::CommitUpdate(const RowSetMetadataUpdate& update) {
     if (!update.new_undo_block_.IsNull()) {
       // Front-loading to keep the UNDO files in their natural order.
       undo_delta_blocks_.insert(undo_delta_blocks_.begin(), update.new_undo_block_);
+      if (update.new_undo_block_max_timestamp_ != Timestamp::kInvalidTimestamp) {
+        undo_delta_max_timestamps_[update.new_undo_block_] =
+            update.new_undo_block_max_timestamp_;
+      }
     }
 
     for (const ColumnIdToBlockIdMap::value_type& e : update.cols_to_replace_) {
@@ -286,14 +332,22 @@ RowSetMetadataUpdate& RowSetMetadataUpdate::ReplaceRedoDeltaBlocks(
   return *this;
 }
 
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetRedoBlockSummary(
+    const BlockId& redo_block, const RowSetMetadata::RedoDeltaSummary& summary) {
+  redo_summaries_[redo_block] = summary;
+  return *this;
+}
+
 RowSetMetadataUpdate& RowSetMetadataUpdate::RemoveUndoDeltaBlocks(
     const std::vector<BlockId>& to_remove) {
   remove_undo_blocks_.insert(remove_undo_blocks_.end(), to_remove.begin(), to_remove.end());
   return *this;
 }
 
-RowSetMetadataUpdate& RowSetMetadataUpdate::SetNewUndoBlock(const BlockId& undo_block) {
+RowSetMetadataUpdate& RowSetMetadataUpdate::SetNewUndoBlock(const BlockId& undo_block,
+                                                            Timestamp max_timestamp) {
   new_undo_block_ = undo_block;
+  new_undo_block_max_timestamp_ = max_timestamp;
   return *this;
 }
 
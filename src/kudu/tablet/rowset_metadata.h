@@ -20,10 +20,13 @@
 #include <map>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/common/schema.h"
+#include "kudu/common/timestamp.h"
 #include "kudu/fs/block_id.h"
+#include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/map-util.h"
@@ -99,9 +102,44 @@ class RowSetMetadata {
 
   void SetColumnDataBlocks(const ColumnIdToBlockIdMap& blocks_by_col_id);
 
-  Status CommitRedoDeltaDataBlock(int64_t dms_id, const BlockId& block_id);
+  // Whether the rowset is cold: cold rowsets' blocks are placed on the slow
+  // storage tier, those of hot rowsets on the fast tier. Must be set before
+  // the rowset's blocks are written.
+  bool cold() const {
+    std::lock_guard<LockType> l(lock_);
+    return cold_;
+  }
+
+  void set_cold(bool cold) {
+    std::lock_guard<LockType> l(lock_);
+    cold_ = cold;
+  }
+
+  // Returns the options with which to create the rowset's blocks, placing
+  // them on the storage tier of the rowset.
+  fs::CreateBlockOptions block_create_options() const {
+    fs::CreateBlockOptions opts;
+    opts.tier = cold() ? fs::StorageTier::SLOW : fs::StorageTier::FAST;
+    return opts;
+  }
+
+  // The statistics of a REDO delta block which are recorded when it is
+  // written, so that the rows deleted by the block can be counted without
+  // opening it.
+  struct RedoDeltaSummary {
+    Timestamp max_timestamp;
+    int64_t delete_count;
+  };
+
+  // Adds a new REDO delta block, flushed from DMS 'dms_id'. If 'summary' is
+  // non-NULL it is recorded as the block's summary (see GetRedoDeltaSummary()).
+  Status CommitRedoDeltaDataBlock(int64_t dms_id, const BlockId& block_id,
+                                  const RedoDeltaSummary* summary = nullptr);
 
-  Status CommitUndoDeltaDataBlock(const BlockId& block_id);
+  // Adds a new UNDO delta block. If 'max_timestamp' is valid, it is recorded
+  // as the block's maximum delta timestamp (see GetUndoDeltaMaxTimestamp()).
+  Status CommitUndoDeltaDataBlock(const BlockId& block_id,
+                                  Timestamp max_timestamp = Timestamp::kInvalidTimestamp);
 
   BlockId bloom_block() const {
     std::lock_guard<LockType> l(lock_);
@@ -138,6 +176,21 @@ class RowSetMetadata {
     return undo_delta_blocks_;
   }
 
+  // Returns true and sets 'max_timestamp' if the maximum delta timestamp of
+  // the UNDO delta block 'block_id' was recorded when it was written. Unlike
+  // DeltaStore::delta_stats(), this does not require opening the block.
+  bool GetUndoDeltaMaxTimestamp(const BlockId& block_id, Timestamp* max_timestamp) const {
+    std::lock_guard<LockType> l(lock_);
+    return FindCopy(undo_delta_max_timestamps_, block_id, max_timestamp);
+  }
+
+  // Returns true and sets 'summary' if the summary of the REDO delta block
+  // 'block_id' was recorded when it was written.
+  bool GetRedoDeltaSummary(const BlockId& block_id, RedoDeltaSummary* summary) const {
+    std::lock_guard<LockType> l(lock_);
+    return FindCopy(redo_delta_summaries_, block_id, summary);
+  }
+
   TabletMetadata *tablet_metadata() const { return tablet_metadata_; }
 
   int64_t last_durable_redo_dms_id() const {
@@ -181,6 +234,7 @@ class RowSetMetadata {
   explicit RowSetMetadata(TabletMetadata *tablet_metadata)
     : tablet_metadata_(tablet_metadata),
       initted_(false),
+      cold_(false),
       last_durable_redo_dms_id_(kNoDurableMemStore) {
   }
 
@@ -189,6 +243,7 @@ class RowSetMetadata {
     : tablet_metadata_(DCHECK_NOTNULL(tablet_metadata)),
       initted_(true),
       id_(id),
+      cold_(false),
       last_durable_redo_dms_id_(kNoDurableMemStore) {
   }
 
@@ -204,11 +259,19 @@ class RowSetMetadata {
   BlockId bloom_block_;
   BlockId adhoc_index_block_;
 
+  bool cold_;
+
   // Map of column ID to block ID.
   ColumnIdToBlockIdMap blocks_by_col_id_;
   std::vector<BlockId> redo_delta_blocks_;
   std::vector<BlockId> undo_delta_blocks_;
 
+  // Precomputed maximum timestamps of those UNDO delta blocks that have one.
+  std::unordered_map<BlockId, Timestamp, BlockIdHash> undo_delta_max_timestamps_;
+
+  // Precomputed summaries of those REDO delta blocks that have one.
+  std::unordered_map<BlockId, RedoDeltaSummary, BlockIdHash> redo_delta_summaries_;
+
   int64_t last_durable_redo_dms_id_;
 
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadata);
@@ -230,6 +293,11 @@ class RowSetMetadataUpdate {
   RowSetMetadataUpdate& ReplaceRedoDeltaBlocks(const std::vector<BlockId>& to_remove,
                                                const std::vector<BlockId>& to_add);
 
+  // Record the summary of 'redo_block', one of the blocks added by
+  // ReplaceRedoDeltaBlocks().
+  RowSetMetadataUpdate& SetRedoBlockSummary(const BlockId& redo_block,
+                                            const RowSetMetadata::RedoDeltaSummary& summary);
+
   // Remove the specified undo delta blocks.
   RowSetMetadataUpdate& RemoveUndoDeltaBlocks(const std::vector<BlockId>& to_remove);
 
@@ -239,9 +307,11 @@ class RowSetMetadataUpdate {
   // Remove the CFile for the given column ID.
   RowSetMetadataUpdate& RemoveColumnId(ColumnId col_id);
 
-  // Add a new UNDO delta block to the list of UNDO files.
+  // Add a new UNDO delta block to the list of UNDO files, along with its
+  // maximum delta timestamp if known.
   // We'll need to replace them instead when we start GCing.
-  RowSetMetadataUpdate& SetNewUndoBlock(const BlockId& undo_block);
+  RowSetMetadataUpdate& SetNewUndoBlock(const BlockId& undo_block,
+                                        Timestamp max_timestamp = Timestamp::kInvalidTimestamp);
 
  private:
   friend class RowSetMetadata;
@@ -254,9 +324,11 @@ class RowSetMetadataUpdate {
     std::vector<BlockId> to_add;
   };
   std::vector<ReplaceDeltaBlocks> replace_redo_blocks_;
+  std::unordered_map<BlockId, RowSetMetadata::RedoDeltaSummary, BlockIdHash> redo_summaries_;
 
   std::vector<BlockId> remove_undo_blocks_;
   BlockId new_undo_block_;
+  Timestamp new_undo_block_max_timestamp_;
 
   DISALLOW_COPY_AND_ASSIGN(RowSetMetadataUpdate);
 };
@@ -15,6 +15,7 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <memory>
@@ -104,6 +105,39 @@ TEST_F(TestRowSetTree, TestTree) {
   ASSERT_EQ(vec[2].get(), out[3]);
 }
 
+// Looking up a sorted batch of keys at once should find the same rowsets as
+// looking them up one at a time, less the unbounded ones.
+TEST_F(TestRowSetTree, TestForEachRowSetContainingKeys) {
+  SeedRandom();
+  RowSetVector vec = GenerateRandomRowSets(100);
+  vec.push_back(shared_ptr<RowSet>(new MockMemRowSet()));
+  RowSetTree tree;
+  ASSERT_OK(tree.Reset(vec));
+  ASSERT_EQ(1, tree.unbounded_rowsets().size());
+
+  vector<string> key_strs;
+  for (int i = 0; i < 1000; i++) {
+    key_strs.push_back(StringPrintf("%04d", rand() % 10000));
+  }
+  std::sort(key_strs.begin(), key_strs.end());
+  vector<Slice> keys(key_strs.begin(), key_strs.end());
+
+  vector<vector<RowSet*>> found(keys.size());
+  tree.ForEachRowSetContainingKeys(keys, [&](RowSet* rs, int i) {
+      found[i].push_back(rs);
+    });
+  for (int i = 0; i < keys.size(); i++) {
+    vector<RowSet*> expected;
+    tree.FindRowSetsWithKeyInRange(keys[i], &expected);
+    expected.erase(std::remove(expected.begin(), expected.end(),
+                               tree.unbounded_rowsets()[0].get()),
+                   expected.end());
+    std::sort(expected.begin(), expected.end());
+    std::sort(found[i].begin(), found[i].end());
+    ASSERT_EQ(expected, found[i]) << key_strs[i];
+  }
+}
+
 TEST_F(TestRowSetTree, TestPerformance) {
   const int kNumRowSets = 200;
   const int kNumQueries = AllowSlowTests() ? 1000000 : 10000;
@@ -167,6 +167,7 @@ void RowSetTree::FindRowSetsIntersectingInterval(const Slice &lower_bound,
   tree_->FindIntersectingInterval(&query, &from_tree);
   rowsets->reserve(rowsets->size() + from_tree.size());
   for (RowSetWithBounds *rs : from_tree) {
+    rs->rowset->access_stats()->RecordAccesses(1);
     rowsets->push_back(rs->rowset);
   }
 }
@@ -187,10 +188,25 @@ void RowSetTree::FindRowSetsWithKeyInRange(const Slice &encoded_key,
   tree_->FindContainingPoint(encoded_key, &from_tree);
   rowsets->reserve(rowsets->size() + from_tree.size());
   for (RowSetWithBounds *rs : from_tree) {
+    rs->rowset->access_stats()->RecordAccesses(1);
     rowsets->push_back(rs->rowset);
   }
 }
 
+void RowSetTree::ForEachRowSetContainingKeys(
+    const vector<Slice>& encoded_keys,
+    const std::function<void(RowSet*, int)>& cb) const {
+  DCHECK(initted_);
+  DCHECK(std::is_sorted(encoded_keys.begin(), encoded_keys.end(),
+                        [](const Slice& a, const Slice& b) { return a.compare(b) < 0; }));
+  tree_->ForEachIntervalContainingPoints(
+      encoded_keys,
+      [&](int i, RowSetWithBounds* rs) {
+        rs->rowset->access_stats()->RecordAccesses(1);
+        cb(rs->rowset, i);
+      });
+}
+
 RowSetTree::~RowSetTree() {
   STLDeleteElements(&entries_);
 }
@@ -17,6 +17,7 @@
 #ifndef KUDU_TABLET_ROWSET_MANAGER_H
 #define KUDU_TABLET_ROWSET_MANAGER_H
 
+#include <functional>
 #include <unordered_map>
 #include <vector>
 #include <utility>
@@ -68,17 +69,35 @@ class RowSetTree {
 
   // Return all RowSets whose range may contain the given encoded key.
   //
+  // This and the other lookups below record an access in the
+  // RowSetAccessStats of each RowSet with known bounds they return.
+  //
   // The returned pointers are guaranteed to be valid at least until this
   // RowSetTree object is Reset().
   void FindRowSetsWithKeyInRange(const Slice &encoded_key,
                                  std::vector<RowSet *> *rowsets) const;
 
+  // Call 'cb(rowset, i)' for each of the RowSets with known bounds whose
+  // range may contain 'encoded_keys[i]'. The keys must be sorted in
+  // ascending order. The RowSets with unknown bounds, which may contain any
+  // key, are not included: see unbounded_rowsets().
+  //
+  // This walks the interval tree once for the whole batch of keys, rather
+  // than once per key as FindRowSetsWithKeyInRange() does. The calls come in
+  // no particular order.
+  void ForEachRowSetContainingKeys(const std::vector<Slice>& encoded_keys,
+                                   const std::function<void(RowSet*, int)>& cb) const;
+
   void FindRowSetsIntersectingInterval(const Slice &lower_bound,
                                        const Slice &upper_bound,
                                        std::vector<RowSet *> *rowsets) const;
 
   const RowSetVector &all_rowsets() const { return all_rowsets_; }
 
+  // The RowSets whose bounds are unknown, e.g. because they're mutable
+  // (MemRowSets).
+  const RowSetVector &unbounded_rowsets() const { return unbounded_rowsets_; }
+
   RowSet* drs_by_id(int64_t drs_id) const {
     return FindPtrOrNull(drs_by_id_, drs_id);
   }
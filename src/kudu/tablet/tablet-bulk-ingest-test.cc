@@ -0,0 +1,178 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "kudu/common/row.h"
+#include "kudu/common/schema.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+class TabletBulkIngestTest : public KuduTabletTest {
+ public:
+  TabletBulkIngestTest()
+    : KuduTabletTest(Schema({ ColumnSchema("key", INT32),
+                              ColumnSchema("val", INT32) }, 1)) {
+  }
+
+  // Build the rows with keys [first, first + count) into 'rows', in the
+  // tablet's schema. The row data is kept in 'row_data_'.
+  void BuildRows(int32_t first, int32_t count, vector<ConstContiguousRow>* rows) {
+    RowBuilder rb(schema_);
+    rows->clear();
+    row_data_.clear();
+    row_data_.reserve(count);
+    for (int32_t i = first; i < first + count; i++) {
+      rb.Reset();
+      rb.AddInt32(i);
+      rb.AddInt32(i * 10);
+      row_data_.push_back(rb.data().ToString());
+    }
+    for (const string& data : row_data_) {
+      rows->emplace_back(&schema_, Slice(data));
+    }
+  }
+
+  Status IngestRows(int32_t first, int32_t count) {
+    vector<ConstContiguousRow> rows;
+    BuildRows(first, count, &rows);
+    return tablet()->BulkIngest(rows, clock()->Now());
+  }
+
+  uint64_t CountRows() {
+    uint64_t count = 0;
+    CHECK_OK(tablet()->CountRows(&count));
+    return count;
+  }
+
+  // Dump the rows visible in 'snap', in key order.
+  void DumpRowsAt(const MvccSnapshot& snap, vector<string>* rows) {
+    gscoped_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet()->NewRowIterator(client_schema_, snap, ORDERED, &iter));
+    ASSERT_OK(iter->Init(nullptr));
+    ASSERT_OK(IterateToStringList(iter.get(), rows));
+  }
+
+ protected:
+  vector<string> row_data_;
+};
+
+TEST_F(TabletBulkIngestTest, TestIngestIntoEmptyTablet) {
+  Timestamp before_ingest = clock()->Now();
+  ASSERT_OK(IngestRows(0, 1000));
+  ASSERT_EQ(1000, CountRows());
+  ASSERT_EQ(1, tablet()->num_rowsets());
+  ASSERT_TRUE(tablet()->MemRowSetEmpty());
+
+  vector<string> rows;
+  NO_FATALS(DumpRowsAt(MvccSnapshot(*tablet()->mvcc_manager()), &rows));
+  ASSERT_EQ(1000, rows.size());
+  ASSERT_EQ("(int32 key=0, int32 val=0)", rows[0]);
+  ASSERT_EQ("(int32 key=999, int32 val=9990)", rows[999]);
+
+  // A snapshot from before the ingest doesn't see any of the rows.
+  rows.clear();
+  NO_FATALS(DumpRowsAt(MvccSnapshot(before_ingest), &rows));
+  ASSERT_TRUE(rows.empty());
+}
+
+TEST_F(TabletBulkIngestTest, TestIngestedRowsAreWritable) {
+  ASSERT_OK(IngestRows(0, 100));
+
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  KuduPartialRow row(&client_schema_);
+  ASSERT_OK(row.SetInt32(0, 10));
+  ASSERT_OK(row.SetInt32(1, 12345));
+  ASSERT_TRUE(writer.Insert(row).IsAlreadyPresent());
+  ASSERT_OK(writer.Update(row));
+  KuduPartialRow key(&client_schema_);
+  ASSERT_OK(key.SetInt32(0, 20));
+  ASSERT_OK(writer.Delete(key));
+
+  vector<string> rows;
+  NO_FATALS(DumpRowsAt(MvccSnapshot(*tablet()->mvcc_manager()), &rows));
+  ASSERT_EQ(99, rows.size());
+  ASSERT_EQ("(int32 key=10, int32 val=12345)", rows[10]);
+
+  // The ingested rows, and the writes to them, survive a restart.
+  Timestamp t = clock()->Now();
+  ASSERT_OK(tablet()->FlushBiggestDMS());
+  TabletReOpen();
+  rows.clear();
+  NO_FATALS(DumpRowsAt(MvccSnapshot(t), &rows));
+  ASSERT_EQ(99, rows.size());
+  ASSERT_EQ("(int32 key=10, int32 val=12345)", rows[10]);
+  ASSERT_EQ("(int32 key=21, int32 val=210)", rows[20]);
+}
+
+TEST_F(TabletBulkIngestTest, TestAppendIngest) {
+  ASSERT_OK(IngestRows(0, 100));
+  ASSERT_OK(IngestRows(100, 100));
+  ASSERT_EQ(200, CountRows());
+  ASSERT_EQ(2, tablet()->num_rowsets());
+
+  // Ranges overlapping a DiskRowSet are rejected, even without any common key.
+  Status s = IngestRows(150, 100);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "overlap");
+  ASSERT_EQ(200, CountRows());
+}
+
+TEST_F(TabletBulkIngestTest, TestRejectsUnsortedRows) {
+  vector<ConstContiguousRow> rows;
+  BuildRows(0, 10, &rows);
+  std::swap(rows[3], rows[4]);
+  Status s = tablet()->BulkIngest(rows, clock()->Now());
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_STR_CONTAINS(s.ToString(), "sorted");
+
+  BuildRows(0, 10, &rows);
+  rows[4] = rows[3];
+  s = tablet()->BulkIngest(rows, clock()->Now());
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  ASSERT_EQ(0, CountRows());
+}
+
+TEST_F(TabletBulkIngestTest, TestRejectsKeysInMemRowSet) {
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  KuduPartialRow row(&client_schema_);
+  ASSERT_OK(row.SetInt32(0, 50));
+  ASSERT_OK(row.SetInt32(1, 0));
+  ASSERT_OK(writer.Insert(row));
+
+  Status s = IngestRows(0, 100);
+  ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+  ASSERT_EQ(1, CountRows());
+
+  // Keys which aren't in the MemRowSet may be ingested.
+  ASSERT_OK(IngestRows(100, 100));
+  ASSERT_EQ(101, CountRows());
+}
+
+} // namespace tablet
+} // namespace kudu
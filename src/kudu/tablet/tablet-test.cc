@@ -20,6 +20,7 @@
 #include <glog/logging.h>
 
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/common/column_statistics.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row.h"
 #include "kudu/common/scan_spec.h"
@@ -27,8 +28,11 @@
 #include "kudu/gutil/strings/join.h"
 #include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/read_amplification.h"
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet-test-base.h"
+#include "kudu/tablet/tablet_metrics.h"
+#include "kudu/util/maintenance_manager.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/test_macros.h"
 
@@ -39,7 +43,12 @@ DEFINE_int32(testiterator_num_inserts, 1000,
 DEFINE_int32(testcompaction_num_rows, 1000,
              "Number of rows per rowset in TestCompaction");
 
+DECLARE_int32(compaction_merge_threads);
+DECLARE_int64(compaction_parallel_merge_min_bytes);
+DECLARE_int32(tablet_cold_rowset_idle_secs);
+
 using std::shared_ptr;
+using std::unique_ptr;
 
 namespace kudu {
 namespace tablet {
@@ -92,6 +101,166 @@ TYPED_TEST(TestTablet, TestFlush) {
   ASSERT_EQ(dfr->delta_stats().delete_count(), max_rows);
 }
 
+// Test that Tablet::SplitKeyRange() picks ascending split keys within the
+// requested bounds from both the DiskRowSets and the MemRowSet.
+TYPED_TEST(TestTablet, TestSplitKeyRange) {
+  uint64_t max_rows = this->ClampRowCount(1000);
+  this->InsertTestRows(0, max_rows / 2, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(max_rows / 2, max_rows - max_rows / 2, 0);
+
+  vector<string> split_keys;
+  ASSERT_OK(this->tablet()->SplitKeyRange("", "", 4, &split_keys));
+  ASSERT_EQ(3, split_keys.size());
+  for (size_t i = 1; i < split_keys.size(); i++) {
+    ASSERT_LT(split_keys[i - 1], split_keys[i]);
+  }
+
+  // Split the range between the first and the last split key again.
+  const string& start = split_keys.front();
+  const string& stop = split_keys.back();
+  vector<string> bounded_split_keys;
+  ASSERT_OK(this->tablet()->SplitKeyRange(start, stop, 4, &bounded_split_keys));
+  ASSERT_FALSE(bounded_split_keys.empty());
+  for (const string& key : bounded_split_keys) {
+    ASSERT_GT(key, start);
+    ASSERT_LT(key, stop);
+  }
+
+  // A single range needs no split keys.
+  vector<string> no_split_keys;
+  ASSERT_OK(this->tablet()->SplitKeyRange("", "", 1, &no_split_keys));
+  ASSERT_TRUE(no_split_keys.empty());
+}
+
+// Test that Tablet::GetColumnStatistics() merges the statistics of the
+// DiskRowSets, leaving out the rows of the MemRowSet.
+TYPED_TEST(TestTablet, TestGetColumnStatistics) {
+  uint64_t max_rows = this->ClampRowCount(1000);
+  this->InsertTestRows(0, max_rows / 2, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(max_rows / 2, max_rows / 4, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  const int64_t flushed_rows = max_rows / 2 + max_rows / 4;
+  this->InsertTestRows(flushed_rows, 10, 0);
+
+  const Schema& schema = *this->tablet()->schema();
+  vector<ColumnStatistics> stats;
+  vector<bool> complete;
+  ASSERT_OK(this->tablet()->GetColumnStatistics(schema, &stats, &complete));
+  ASSERT_EQ(schema.num_columns(), stats.size());
+  ASSERT_EQ(schema.num_columns(), complete.size());
+  for (int i = 0; i < schema.num_columns(); i++) {
+    SCOPED_TRACE(schema.column(i).name());
+    ASSERT_TRUE(complete[i]);
+    ASSERT_EQ(flushed_rows, stats[i].null_count() + stats[i].non_null_count());
+  }
+  // The keys are distinct.
+  ASSERT_EQ(0, stats[0].null_count());
+  ASSERT_NEAR(flushed_rows, stats[0].EstimateDistinctCount(), flushed_rows * 0.05);
+}
+
+// Test that the read amplification report accounts for the rowsets a key
+// falls in and for the delta stores of each rowset.
+TYPED_TEST(TestTablet, TestReadAmplification) {
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  uint64_t max_rows = this->ClampRowCount(1000);
+  this->InsertTestRows(0, max_rows, 0);
+  ASSERT_OK(this->tablet()->Flush());
+
+  ReadAmplificationReport report;
+  this->tablet()->ComputeReadAmplification(&report);
+  ASSERT_EQ(1, report.rowsets.size());
+  ASSERT_EQ(1, report.max_height);
+  ASSERT_EQ(0, report.max_redo_depth);
+  ASSERT_GT(report.rowsets[0].base_data_bytes, 0);
+  ASSERT_EQ(1, report.rowsets[0].num_undo_deltas);
+
+  // Deleting the first and the last rows and inserting them again makes a
+  // second rowset spanning the whole key range of the first, which keeps the
+  // DELETEs in its DeltaMemStore.
+  ASSERT_OK(this->DeleteTestRow(&writer, 0));
+  ASSERT_OK(this->DeleteTestRow(&writer, max_rows - 1));
+  ASSERT_OK(this->InsertTestRow(&writer, 0, 0));
+  ASSERT_OK(this->InsertTestRow(&writer, max_rows - 1, 0));
+  this->tablet()->ComputeReadAmplification(&report);
+  ASSERT_GT(report.mrs_bytes, 0);
+  ASSERT_OK(this->tablet()->Flush());
+
+  this->tablet()->ComputeReadAmplification(&report);
+  ASSERT_EQ(2, report.rowsets.size());
+  ASSERT_EQ(2, report.max_height);
+  ASSERT_EQ(1, report.max_redo_depth);
+  ASSERT_GT(report.point_lookup_bytes, 0);
+
+  // Flushing the DeltaMemStore keeps the REDO depth.
+  ASSERT_OK(this->tablet()->FlushAllDMSForTests());
+  this->tablet()->ComputeReadAmplification(&report);
+  ASSERT_EQ(1, report.max_redo_depth);
+  ASSERT_GT(report.bloom_false_positives_per_lookup, 0);
+
+  // A full compaction leaves a single rowset without REDO deltas.
+  ASSERT_OK(this->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  this->tablet()->ComputeReadAmplification(&report);
+  ASSERT_EQ(1, report.rowsets.size());
+  ASSERT_EQ(1, report.max_height);
+  ASSERT_EQ(0, report.max_redo_depth);
+  LOG(INFO) << report.ToString();
+}
+
+TYPED_TEST(TestTablet, TestCountLiveRows) {
+  const int kNumRows = 100;
+  Tablet* tablet = this->tablet().get();
+  LocalTabletWriter writer(tablet, &this->client_schema_);
+  auto count_live_rows = [&](const MvccSnapshot& snap, int* num_rowsets_iterated) {
+    uint64_t count;
+    CHECK_OK(tablet->CountLiveRows(snap, &count, num_rowsets_iterated));
+    return count;
+  };
+  int num_rowsets_iterated;
+
+  // Rows of the MRS are always iterated over.
+  this->InsertTestRows(0, kNumRows, 0);
+  MvccSnapshot snap_before_deletes(*tablet->mvcc_manager());
+  ASSERT_EQ(kNumRows, count_live_rows(snap_before_deletes, &num_rowsets_iterated));
+  ASSERT_EQ(0, num_rowsets_iterated);
+
+  // Flushed rows are counted from the metadata, including the deletes in
+  // the DMS and, once it's flushed, in the REDO delta files.
+  ASSERT_OK(tablet->Flush());
+  ASSERT_EQ(kNumRows, count_live_rows(MvccSnapshot(*tablet->mvcc_manager()),
+                                      &num_rowsets_iterated));
+  ASSERT_EQ(0, num_rowsets_iterated);
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(this->DeleteTestRow(&writer, i));
+  }
+  ASSERT_EQ(kNumRows - 10, count_live_rows(MvccSnapshot(*tablet->mvcc_manager()),
+                                           &num_rowsets_iterated));
+  ASSERT_EQ(0, num_rowsets_iterated);
+  ASSERT_OK(tablet->FlushBiggestDMS());
+  for (int i = 10; i < 20; i++) {
+    ASSERT_OK(this->DeleteTestRow(&writer, i));
+  }
+  ASSERT_OK(tablet->FlushBiggestDMS());
+  ASSERT_OK(tablet->CompactWorstDeltas(RowSet::MINOR_DELTA_COMPACTION));
+  ASSERT_EQ(kNumRows - 20, count_live_rows(MvccSnapshot(*tablet->mvcc_manager()),
+                                           &num_rowsets_iterated));
+  ASSERT_EQ(0, num_rowsets_iterated);
+
+  // A snapshot which precedes the deletes requires iterating over the rowset.
+  ASSERT_EQ(kNumRows, count_live_rows(snap_before_deletes, &num_rowsets_iterated));
+  ASSERT_EQ(1, num_rowsets_iterated);
+
+  // The deleted rows of a compaction's output are still counted out, and
+  // reinserted rows are counted in again.
+  this->InsertTestRows(0, 5, 0);
+  ASSERT_OK(tablet->Flush());
+  ASSERT_OK(tablet->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(kNumRows - 15, count_live_rows(MvccSnapshot(*tablet->mvcc_manager()),
+                                           &num_rowsets_iterated));
+  ASSERT_EQ(0, num_rowsets_iterated);
+}
+
 // Test that historical data for a row is maintained even after the row
 // is flushed from the memrowset.
 TYPED_TEST(TestTablet, TestInsertsAndMutationsAreUndoneWithMVCCAfterFlush) {
@@ -697,6 +866,74 @@ TYPED_TEST(TestTablet, TestUpsert) {
 }
 
 
+// An UPSERT which sets every column should look its key up in the DiskRowSet
+// holding it only once, when it applies the update.
+TYPED_TEST(TestTablet, TestFullRowUpsertLooksUpKeyOnce) {
+  this->InsertTestRows(0, 1, 1000);
+  ASSERT_OK(this->tablet()->Flush());
+
+  const auto& lookups = this->tablet()->metrics()->key_file_lookups;
+  int64_t lookups_before = lookups->value();
+  this->UpsertTestRows(0, 1, 1001);
+  ASSERT_EQ(lookups_before + 1, lookups->value());
+
+  vector<string> rows;
+  ASSERT_OK(this->IterateToStringList(&rows));
+  EXPECT_EQ(vector<string>{ this->setup_.FormatDebugRow(0, 1001, false) }, rows);
+
+  // Once more, with the row's previous update already in the DeltaMemStore.
+  this->UpsertTestRows(0, 1, 1002);
+  ASSERT_OK(this->IterateToStringList(&rows));
+  EXPECT_EQ(vector<string>{ this->setup_.FormatDebugRow(0, 1002, false) }, rows);
+}
+
+// Test a batch of writes whose keys are checked against the DiskRowSets all
+// at once, including ops which share a key with an earlier op of the batch.
+TYPED_TEST(TestTablet, TestBatchedPresenceChecks) {
+  // Write two DiskRowSets, with keys [0, 10) and [10, 20).
+  this->InsertTestRows(0, 10, 0);
+  ASSERT_OK(this->tablet()->Flush());
+  this->InsertTestRows(10, 10, 0);
+  ASSERT_OK(this->tablet()->Flush());
+
+  struct BatchOp {
+    RowOperationsPB::Type type;
+    int64_t key;
+    bool expect_success;
+  };
+  const vector<BatchOp> batch = {
+    { RowOperationsPB::INSERT, 2, false },    // In the first DRS.
+    { RowOperationsPB::INSERT, 100, true },   // New.
+    { RowOperationsPB::UPSERT, 13, true },    // Updates the second DRS.
+    { RowOperationsPB::DELETE, 4, true },
+    { RowOperationsPB::INSERT, 4, true },     // Reinsert of the row just deleted.
+    { RowOperationsPB::INSERT, 100, false },  // Inserted earlier in the batch.
+    { RowOperationsPB::INSERT, 15, false },   // In the second DRS.
+  };
+  vector<unique_ptr<KuduPartialRow>> rows;
+  vector<LocalTabletWriter::Op> ops;
+  for (const BatchOp& op : batch) {
+    rows.emplace_back(new KuduPartialRow(&this->client_schema_));
+    if (op.type == RowOperationsPB::DELETE) {
+      this->setup_.BuildRowKey(rows.back().get(), op.key);
+    } else {
+      this->setup_.BuildRow(rows.back().get(), op.key, 1);
+    }
+    ops.emplace_back(op.type, rows.back().get());
+  }
+
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema_);
+  Status s = writer.WriteBatch(ops);
+  ASSERT_TRUE(s.IsAlreadyPresent()) << s.ToString();
+  const TxResultPB& result = writer.last_write_result();
+  ASSERT_EQ(batch.size(), result.ops_size());
+  for (int i = 0; i < batch.size(); i++) {
+    SCOPED_TRACE(i);
+    ASSERT_EQ(batch[i].expect_success, !result.ops(i).has_failed_status());
+  }
+  ASSERT_EQ(21, this->TabletCount());
+}
+
 // Test that when a row has been updated many times, it always yields
 // the most recent value.
 TYPED_TEST(TestTablet, TestMultipleUpdates) {
@@ -820,6 +1057,88 @@ TYPED_TEST(TestTablet, TestCompaction) {
   }
 }
 
+// Test a compaction which is split in key ranges merged in parallel.
+TYPED_TEST(TestTablet, TestCompactionWithParallelMerge) {
+  FLAGS_compaction_merge_threads = 4;
+  FLAGS_compaction_parallel_merge_min_bytes = 0;
+  uint64_t n_rows = this->ClampRowCount(FLAGS_testcompaction_num_rows) / 3;
+
+  // Create three rowsets, each with updates and deletes in its deltas.
+  LocalTabletWriter writer(this->tablet().get(), &this->client_schema());
+  for (int i = 0; i < 3; i++) {
+    this->InsertTestRows(i * n_rows, n_rows, 0);
+    ASSERT_OK(this->tablet()->Flush());
+    for (int64_t row = i * n_rows; row < (i + 1) * n_rows; row += 7) {
+      ASSERT_OK(this->UpdateTestRow(&writer, row, 1000 + row));
+    }
+    ASSERT_OK(this->DeleteTestRow(&writer, i * n_rows + 3));
+  }
+  ASSERT_OK(this->tablet()->FlushBiggestDMS());
+
+  vector<string> before;
+  ASSERT_OK(this->IterateToStringList(&before));
+
+  ASSERT_OK(this->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  // Every key range is written into rowsets of its own.
+  ASSERT_GT(this->tablet()->num_rowsets(), 1);
+
+  vector<string> after;
+  ASSERT_OK(this->IterateToStringList(&after));
+  ASSERT_EQ(before, after);
+  ASSERT_EQ(n_rows * 3 - 3, this->TabletCount());
+}
+
+// Test that idle rowsets are migrated to cold rowsets, and that compactions
+// of cold rowsets yield cold rowsets.
+TYPED_TEST(TestTablet, TestColdRowSetMigration) {
+  FLAGS_tablet_cold_rowset_idle_secs = 1;
+  uint64_t n_rows = this->ClampRowCount(FLAGS_testcompaction_num_rows) / 2;
+  for (int i = 0; i < 2; i++) {
+    this->InsertTestRows(i * n_rows, n_rows, 0);
+    ASSERT_OK(this->tablet()->Flush());
+  }
+  vector<string> before;
+  ASSERT_OK(this->IterateToStringList(&before));
+
+  // Flushes yield hot rowsets.
+  RowSetVector rowsets;
+  this->tablet()->GetRowSetsForTests(&rowsets);
+  ASSERT_EQ(2, rowsets.size());
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    ASSERT_FALSE(rs->metadata()->cold());
+  }
+
+  // Once idle, each rowset is migrated in turn.
+  SleepFor(MonoDelta::FromMilliseconds(1100));
+  for (int i = 0; i < 2; i++) {
+    ASSERT_OK(this->tablet()->MigrateColdRowSet());
+  }
+  rowsets.clear();
+  this->tablet()->GetRowSetsForTests(&rowsets);
+  ASSERT_EQ(2, rowsets.size());
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    ASSERT_TRUE(rs->metadata()->cold());
+    RowSetDataPB pb;
+    rs->metadata()->ToProtobuf(&pb);
+    ASSERT_TRUE(pb.cold());
+  }
+  MaintenanceOpStats stats;
+  this->tablet()->UpdateColdMigrationStats(&stats);
+  ASSERT_FALSE(stats.runnable());
+
+  // Compacting cold rowsets keeps them cold.
+  ASSERT_OK(this->tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  rowsets.clear();
+  this->tablet()->GetRowSetsForTests(&rowsets);
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    ASSERT_TRUE(rs->metadata()->cold());
+  }
+
+  vector<string> after;
+  ASSERT_OK(this->IterateToStringList(&after));
+  ASSERT_EQ(before, after);
+}
+
 enum MutationType {
   MRS_MUTATION,
   DELTA_MUTATION,
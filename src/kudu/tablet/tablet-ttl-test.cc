@@ -0,0 +1,151 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "kudu/common/partial_row.h"
+#include "kudu/common/schema.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/tablet/local_tablet_writer.h"
+#include "kudu/tablet/tablet-test-util.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+namespace {
+
+const int64_t kTtlSeconds = 3;
+
+ColumnStorageAttributes TtlAttributes() {
+  ColumnStorageAttributes attributes;
+  attributes.ttl_seconds = kTtlSeconds;
+  return attributes;
+}
+
+} // anonymous namespace
+
+class TabletTtlTest : public KuduTabletTest {
+ public:
+  TabletTtlTest()
+    : KuduTabletTest(Schema({ ColumnSchema("key", INT32),
+                              ColumnSchema("ts", UNIXTIME_MICROS, false,
+                                           nullptr, nullptr, TtlAttributes()),
+                              ColumnSchema("val", INT32) }, 1)) {
+  }
+
+  Status InsertRow(int32_t key, int64_t ts) {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    RETURN_NOT_OK(row.SetInt32(0, key));
+    RETURN_NOT_OK(row.SetUnixTimeMicros(1, ts));
+    RETURN_NOT_OK(row.SetInt32(2, key));
+    return writer.Insert(row);
+  }
+
+  Status UpdateTimestamp(int32_t key, int64_t ts) {
+    LocalTabletWriter writer(tablet().get(), &client_schema_);
+    KuduPartialRow row(&client_schema_);
+    RETURN_NOT_OK(row.SetInt32(0, key));
+    RETURN_NOT_OK(row.SetUnixTimeMicros(1, ts));
+    return writer.Update(row);
+  }
+
+  // Returns the number of rows physically stored in the tablet: the tablet
+  // iterators don't filter the expired rows, only the scans do.
+  int CountStoredRows() {
+    gscoped_ptr<RowwiseIterator> iter;
+    CHECK_OK(tablet()->NewRowIterator(client_schema_, &iter));
+    CHECK_OK(iter->Init(nullptr));
+    vector<string> rows;
+    CHECK_OK(IterateToStringList(iter.get(), &rows));
+    return rows.size();
+  }
+};
+
+TEST_F(TabletTtlTest, TestFlushAndCompactionDropExpiredRows) {
+  const int64_t now = GetCurrentTimeMicros();
+  const int64_t expired = now - 2 * kTtlSeconds * 1000000;
+  const int64_t live = now + 3600 * 1000000L;
+  for (int32_t i = 0; i < 10; i++) {
+    ASSERT_OK(InsertRow(i, i % 2 == 0 ? live : expired));
+  }
+  ASSERT_EQ(10, CountStoredRows());
+
+  // The flush of the MemRowSet doesn't write the expired rows.
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_EQ(5, CountStoredRows());
+
+  // A row updated to an expired time is dropped by the next compaction.
+  ASSERT_OK(UpdateTimestamp(0, expired));
+  ASSERT_OK(InsertRow(11, live));
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_EQ(2, tablet()->num_rowsets());
+  ASSERT_OK(tablet()->Compact(Tablet::FORCE_COMPACT_ALL));
+  ASSERT_EQ(5, CountStoredRows());
+  ASSERT_EQ(1, tablet()->num_rowsets());
+}
+
+TEST_F(TabletTtlTest, TestDeleteExpiredRowSets) {
+  // Rows which expire two seconds after being written, and rows which don't.
+  const int64_t expires_soon = GetCurrentTimeMicros() - (kTtlSeconds - 2) * 1000000;
+  const int64_t live = GetCurrentTimeMicros() + 3600 * 1000000L;
+  for (int32_t i = 0; i < 10; i++) {
+    ASSERT_OK(InsertRow(i, expires_soon));
+  }
+  ASSERT_OK(tablet()->Flush());
+  for (int32_t i = 10; i < 20; i++) {
+    ASSERT_OK(InsertRow(i, expires_soon));
+  }
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_OK(InsertRow(20, live));
+  ASSERT_OK(tablet()->Flush());
+  ASSERT_EQ(3, tablet()->num_rowsets());
+  ASSERT_EQ(21, CountStoredRows());
+
+  // A rowset whose TTL column was updated may hold live rows.
+  ASSERT_OK(UpdateTimestamp(15, live));
+
+  SleepFor(MonoDelta::FromSeconds(3));
+  int64_t expired_bytes;
+  ASSERT_OK(tablet()->EstimateBytesInExpiredRowSets(&expired_bytes));
+  ASSERT_GT(expired_bytes, 0);
+
+  int64_t rowsets_deleted;
+  int64_t bytes_deleted;
+  ASSERT_OK(tablet()->DeleteExpiredRowSets(&rowsets_deleted, &bytes_deleted));
+  ASSERT_EQ(1, rowsets_deleted);
+  ASSERT_EQ(expired_bytes, bytes_deleted);
+  ASSERT_EQ(2, tablet()->num_rowsets());
+  ASSERT_EQ(11, CountStoredRows());
+
+  // The deletion survives a restart.
+  TabletReOpen();
+  ASSERT_EQ(2, tablet()->num_rowsets());
+  ASSERT_EQ(11, CountStoredRows());
+}
+
+} // namespace tablet
+} // namespace kudu
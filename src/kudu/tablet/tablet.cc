@@ -28,9 +28,13 @@
 #include <vector>
 
 #include "kudu/cfile/cfile_writer.h"
+#include "kudu/codegen/compilation_manager.h"
+#include "kudu/common/column_statistics.h"
+#include "kudu/common/encoded_key.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
+#include "kudu/common/rowblock.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
 #include "kudu/consensus/consensus.pb.h"
@@ -38,15 +42,19 @@
 #include "kudu/consensus/opid_util.h"
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/human_readable.h"
 #include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/tablet/compaction.h"
 #include "kudu/tablet/compaction_policy.h"
 #include "kudu/tablet/delta_compaction.h"
 #include "kudu/tablet/diskrowset.h"
+#include "kudu/tablet/read_amplification.h"
 #include "kudu/tablet/row_op.h"
 #include "kudu/tablet/rowset_info.h"
 #include "kudu/tablet/rowset_tree.h"
@@ -56,10 +64,12 @@
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/util/bloom_filter.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/env.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/io_rate_limiter.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/maintenance_manager.h"
@@ -67,6 +77,7 @@
 #include "kudu/util/metrics.h"
 #include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 #include "kudu/util/url-coding.h"
 
@@ -74,6 +85,30 @@ DEFINE_int32(tablet_compaction_budget_mb, 128,
              "Budget for a single compaction");
 TAG_FLAG(tablet_compaction_budget_mb, experimental);
 
+DEFINE_string(tablet_compaction_policy, "budgeted",
+              "The policy used to select the rowsets of a tablet to compact. Either "
+              "'budgeted', which values reducing the overlap of all key ranges equally, "
+              "or 'access_weighted', which favors the key ranges that are written and "
+              "scanned the most, e.g. the newest range of a time-series table.");
+TAG_FLAG(tablet_compaction_policy, experimental);
+
+DEFINE_string(tablet_compaction_policy_by_table, "",
+              "Comma-separated list of <table name>:<policy> pairs which override "
+              "--tablet_compaction_policy for the tablets of specific tables. Read when "
+              "a tablet is opened.");
+TAG_FLAG(tablet_compaction_policy_by_table, experimental);
+
+static bool ValidateCompactionPolicy(const char* flagname, const std::string& value) {
+  if (value == "budgeted" || value == "access_weighted") {
+    return true;
+  }
+  LOG(ERROR) << "Invalid value for --" << flagname << ": " << value
+             << " (must be one of 'budgeted' or 'access_weighted')";
+  return false;
+}
+static bool dummy_compaction_policy = google::RegisterFlagValidator(
+    &FLAGS_tablet_compaction_policy, &ValidateCompactionPolicy);
+
 DEFINE_int32(tablet_bloom_block_size, 4096,
              "Block size of the bloom filters used for tablet keys.");
 TAG_FLAG(tablet_bloom_block_size, advanced);
@@ -85,6 +120,41 @@ DEFINE_double(tablet_bloom_target_fp_rate, 0.0001f,
               "required for bloom filters.");
 TAG_FLAG(tablet_bloom_target_fp_rate, advanced);
 
+DEFINE_bool(tablet_bloom_blocked_layout, false,
+            "Whether to write the key bloom filters of new DiskRowSets with all the bits "
+            "of a key in a single 32-byte bucket, so that checking a key touches one cache "
+            "line. The false positive rate is a little higher than with the default layout. "
+            "Files written this way can't be read by versions of Kudu which predate it.");
+TAG_FLAG(tablet_bloom_blocked_layout, experimental);
+
+DEFINE_int32(compaction_merge_threads, 1,
+             "Maximum number of key ranges which a large rowset compaction merges in "
+             "parallel, each into its own output rowsets. The threads are shared by all "
+             "the tablets of the server. 1 merges every compaction on the compacting "
+             "thread alone.");
+TAG_FLAG(compaction_merge_threads, experimental);
+
+DEFINE_int64(compaction_parallel_merge_min_bytes, 256 * 1024 * 1024,
+             "Minimum estimated on-disk size of the rowsets taking part in a compaction "
+             "for it to be split in key ranges which are merged in parallel. See "
+             "--compaction_merge_threads.");
+TAG_FLAG(compaction_parallel_merge_min_bytes, experimental);
+TAG_FLAG(compaction_parallel_merge_min_bytes, runtime);
+
+DEFINE_string(compaction_cache_output_tablets, "",
+              "Comma-separated list of table names and tablet IDs whose compactions "
+              "insert the blocks they write into the block cache, so that the first "
+              "scans of the compacted rowsets don't all miss the cache.");
+TAG_FLAG(compaction_cache_output_tablets, experimental);
+TAG_FLAG(compaction_cache_output_tablets, runtime);
+
+DEFINE_double(compaction_cache_output_min_hit_ratio, 0,
+              "If positive, compactions of tablets whose block cache hit ratio is at "
+              "least this insert the blocks they write into the block cache, as for "
+              "--compaction_cache_output_tablets. The ratio covers the lookups since "
+              "the tablet was opened, and is only trusted after 1000 of them.");
+TAG_FLAG(compaction_cache_output_min_hit_ratio, experimental);
+TAG_FLAG(compaction_cache_output_min_hit_ratio, runtime);
 
 DEFINE_double(fault_crash_before_flush_tablet_meta_after_compaction, 0.0,
               "Fraction of the time, during compaction, to crash before flushing metadata");
@@ -140,6 +210,30 @@ DEFINE_bool(enable_undo_delta_block_gc, true,
     "To change what is considered ancient history use --tablet_history_max_age_sec");
 TAG_FLAG(enable_undo_delta_block_gc, evolving);
 
+DEFINE_int32(tablet_num_hot_projections, 5,
+             "Number of the projections scanned most frequently to record in the tablet "
+             "metadata, whose code is compiled eagerly when the tablet is opened. "
+             "0 disables both.");
+TAG_FLAG(tablet_num_hot_projections, experimental);
+
+DEFINE_int32(tablet_scan_prefetch_rowsets, 0,
+             "Number of rowsets whose first blocks are read in the background "
+             "ahead of their turn in unordered scans, while the current rowset "
+             "is being read. 0 disables prefetching.");
+TAG_FLAG(tablet_scan_prefetch_rowsets, experimental);
+TAG_FLAG(tablet_scan_prefetch_rowsets, runtime);
+
+DEFINE_int32(tablet_cold_rowset_idle_secs, 0,
+             "Number of seconds after which a rowset whose key range hasn't "
+             "been written or scanned is rewritten as a cold rowset, placed on "
+             "the slow storage tier (see --fs_data_dirs_fast_tier). "
+             "Compactions of cold rowsets only yield cold rowsets. "
+             "0 disables the migration of rowsets to the slow tier.");
+TAG_FLAG(tablet_cold_rowset_idle_secs, experimental);
+TAG_FLAG(tablet_cold_rowset_idle_secs, runtime);
+
+DECLARE_bool(mrs_use_codegen);
+
 METRIC_DEFINE_entity(tablet);
 METRIC_DEFINE_gauge_size(tablet, memrowset_size, "MemRowSet Memory Usage",
                          kudu::MetricUnit::kBytes,
@@ -157,6 +251,7 @@ using kudu::server::HybridClock;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::pair;
 using std::unordered_set;
 using std::vector;
 using strings::Substitute;
@@ -164,7 +259,55 @@ using strings::Substitute;
 namespace kudu {
 namespace tablet {
 
-static CompactionPolicy *CreateCompactionPolicy() {
+// The maximum number of distinct projections whose uses are counted.
+static const size_t kMaxTrackedProjections = 100;
+
+// The performance improvement reported for the migration of a cold rowset:
+// low enough for any other useful maintenance to take precedence.
+static const double kColdMigrationPerfImprovement = 0.001;
+
+// Process-wide pool of threads which merge the key ranges of compactions
+// split by Tablet::FlushCompactionInputRanges().
+class CompactionMergePool {
+ public:
+  static ThreadPool* Get() {
+    return Singleton<CompactionMergePool>::get()->pool_.get();
+  }
+
+ private:
+  friend class Singleton<CompactionMergePool>;
+
+  CompactionMergePool() {
+    CHECK_OK(ThreadPoolBuilder("compaction-merge")
+             .set_max_threads(std::max(FLAGS_compaction_merge_threads - 1, 1))
+             .Build(&pool_));
+  }
+
+  gscoped_ptr<ThreadPool> pool_;
+};
+
+// Returns the policy named by --tablet_compaction_policy_by_table for
+// 'table_name', or else by --tablet_compaction_policy.
+static string CompactionPolicyName(const string& table_name) {
+  vector<string> entries = strings::Split(FLAGS_tablet_compaction_policy_by_table, ",",
+                                          strings::SkipEmpty());
+  for (const string& entry : entries) {
+    size_t sep = entry.rfind(':');
+    if (sep == string::npos || entry.compare(0, sep, table_name) != 0) {
+      continue;
+    }
+    string policy = entry.substr(sep + 1);
+    if (ValidateCompactionPolicy("tablet_compaction_policy_by_table", policy)) {
+      return policy;
+    }
+  }
+  return FLAGS_tablet_compaction_policy;
+}
+
+static CompactionPolicy *CreateCompactionPolicy(const string& table_name) {
+  if (CompactionPolicyName(table_name) == "access_weighted") {
+    return new AccessWeightedCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
+  }
   return new BudgetedCompactionPolicy(FLAGS_tablet_compaction_budget_mb);
 }
 
@@ -194,7 +337,7 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
     rowsets_flush_sem_(1),
     state_(kInitialized) {
       CHECK(schema()->has_column_ids());
-  compaction_policy_.reset(CreateCompactionPolicy());
+  compaction_policy_.reset(CreateCompactionPolicy(metadata_->table_name()));
 
   if (metric_registry) {
     MetricEntity::AttributeMap attrs;
@@ -211,6 +354,7 @@ Tablet::Tablet(const scoped_refptr<TabletMetadata>& metadata,
     METRIC_on_disk_size.InstantiateFunctionGauge(
       metric_entity_, Bind(&Tablet::EstimateOnDiskSize, Unretained(this)))
       ->AutoDetach(&metric_detacher_);
+    mem_trackers_.block_cache_attribution = new cfile::BlockCacheAttribution(metric_entity_);
   }
 
   if (FLAGS_tablet_throttler_rpc_per_sec > 0 || FLAGS_tablet_throttler_bytes_per_sec > 0) {
@@ -261,6 +405,8 @@ Status Tablet::Open() {
                                   &new_mrs));
   components_ = new TabletComponents(new_mrs, new_rowset_tree);
 
+  PrecompileHotProjections();
+
   state_ = kBootstrapping;
   return Status::OK();
 }
@@ -290,9 +436,99 @@ Status Tablet::GetMappedReadProjection(const Schema& projection,
   return cur_schema->GetMappedReadProjection(projection, mapped_projection);
 }
 
+void Tablet::RecordProjectionUse(const Schema& projection) const {
+  if (FLAGS_tablet_num_hot_projections <= 0 || projection.num_columns() == 0) {
+    return;
+  }
+  ProjectionPB pb;
+  for (size_t i = 0; i < projection.num_columns(); i++) {
+    pb.add_column_ids(projection.column_id(i));
+  }
+  pb.set_num_key_columns(projection.num_key_columns());
+  string key = pb.SerializeAsString();
+
+  std::lock_guard<simple_spinlock> l(projection_uses_lock_);
+  auto it = projection_uses_.find(key);
+  if (it != projection_uses_.end()) {
+    it->second++;
+  } else if (projection_uses_.size() < kMaxTrackedProjections) {
+    projection_uses_.emplace(std::move(key), 1);
+  }
+}
+
+void Tablet::UpdateHotProjections() {
+  if (FLAGS_tablet_num_hot_projections <= 0) {
+    return;
+  }
+  vector<pair<int64_t, string>> uses;
+  {
+    std::lock_guard<simple_spinlock> l(projection_uses_lock_);
+    for (auto it = projection_uses_.begin(); it != projection_uses_.end();) {
+      uses.emplace_back(it->second, it->first);
+      it->second /= 2;
+      if (it->second == 0) {
+        it = projection_uses_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  // Without any scan since the tablet was opened, keep the persisted ones.
+  if (uses.empty()) {
+    return;
+  }
+
+  size_t num_hot = std::min<size_t>(uses.size(), FLAGS_tablet_num_hot_projections);
+  std::partial_sort(uses.begin(), uses.begin() + num_hot, uses.end(),
+                    [](const pair<int64_t, string>& a, const pair<int64_t, string>& b) {
+                      return a.first > b.first;
+                    });
+  vector<ProjectionPB> hot(num_hot);
+  for (size_t i = 0; i < num_hot; i++) {
+    CHECK(hot[i].ParseFromString(uses[i].second));
+  }
+  metadata_->SetHotProjections(std::move(hot));
+}
+
+void Tablet::PrecompileHotProjections() {
+  if (FLAGS_tablet_num_hot_projections <= 0) {
+    return;
+  }
+  const Schema& base = *schema();
+  vector<ProjectionPB> hot = metadata_->hot_projections();
+  for (size_t i = 0; i < hot.size(); i++) {
+    vector<ColumnSchema> cols;
+    vector<ColumnId> ids;
+    for (int32_t id : hot[i].column_ids()) {
+      int idx = base.find_column_by_id(ColumnId(id));
+      // The column may have been dropped since.
+      if (idx == Schema::kColumnNotFound) {
+        break;
+      }
+      cols.push_back(base.column(idx));
+      ids.push_back(ColumnId(id));
+    }
+    Schema projection;
+    if (cols.size() != static_cast<size_t>(hot[i].column_ids_size()) ||
+        !projection.Reset(cols, ids, hot[i].num_key_columns()).ok()) {
+      continue;
+    }
+    if (FLAGS_mrs_use_codegen) {
+      codegen::CompilationManager::GetSingleton()->PrecompileRowProjector(base, projection);
+    }
+
+    // Carry the ranking over, so that it survives until the projections
+    // are scanned again.
+    std::lock_guard<simple_spinlock> l(projection_uses_lock_);
+    projection_uses_.emplace(hot[i].SerializeAsString(), hot.size() - i);
+  }
+}
+
 BloomFilterSizing Tablet::bloom_sizing() const {
   return BloomFilterSizing::BySizeAndFPRate(FLAGS_tablet_bloom_block_size,
-                                            FLAGS_tablet_bloom_target_fp_rate);
+                                            FLAGS_tablet_bloom_target_fp_rate)
+      .WithLayout(FLAGS_tablet_bloom_blocked_layout ? BloomFilterLayout::kBlocked
+                                                    : BloomFilterLayout::kSpread);
 }
 
 Status Tablet::NewRowIterator(const Schema &projection,
@@ -332,7 +568,8 @@ Status Tablet::DecodeWriteOperations(const Schema* client_schema,
   vector<DecodedRowOperation> ops;
 
   // Decode the ops
-  RowOperationsPBDecoder dec(&tx_state->request()->row_operations(),
+  RowOperationsPBDecoder dec(tx_state->rows_data(),
+                             tx_state->indirect_data(),
                              client_schema,
                              schema(),
                              tx_state->arena());
@@ -358,8 +595,19 @@ Status Tablet::AcquireRowLocks(WriteTransactionState* tx_state) {
   TRACE_EVENT1("tablet", "Tablet::AcquireRowLocks",
                "num_locks", tx_state->row_ops().size());
   TRACE("PREPARE: Acquiring locks for $0 operations", tx_state->row_ops().size());
-  for (RowOp* op : tx_state->row_ops()) {
-    RETURN_NOT_OK(AcquireLockForOp(tx_state, op));
+  const vector<RowOp*>& row_ops = tx_state->row_ops();
+  vector<Slice> keys;
+  keys.reserve(row_ops.size());
+  for (RowOp* op : row_ops) {
+    RETURN_NOT_OK(PrepareKeyForOp(op));
+    keys.push_back(op->key_probe->encoded_key_slice());
+  }
+
+  // Take all of the locks at once, so that the lock manager can order them.
+  vector<ScopedRowLock> locks;
+  lock_manager_.AcquireLocks(tx_state, keys, LockManager::LOCK_EXCLUSIVE, &locks);
+  for (int i = 0; i < row_ops.size(); i++) {
+    row_ops[i]->row_lock = std::move(locks[i]);
   }
   TRACE("PREPARE: locks acquired");
   return Status::OK();
@@ -381,16 +629,10 @@ Status Tablet::CheckRowInTablet(const ConstContiguousRow& row) const {
   return Status::OK();
 }
 
-Status Tablet::AcquireLockForOp(WriteTransactionState* tx_state, RowOp* op) {
+Status Tablet::PrepareKeyForOp(RowOp* op) {
   ConstContiguousRow row_key(&key_schema_, op->decoded_op.row_data);
   op->key_probe.reset(new tablet::RowSetKeyProbe(row_key));
-  RETURN_NOT_OK(CheckRowInTablet(row_key));
-
-  op->row_lock = ScopedRowLock(&lock_manager_,
-                               tx_state,
-                               op->key_probe->encoded_key_slice(),
-                               LockManager::LOCK_EXCLUSIVE);
-  return Status::OK();
+  return CheckRowInTablet(row_key);
 }
 
 void Tablet::AssignTimestampAndStartTransactionForTests(WriteTransactionState* tx_state) {
@@ -420,10 +662,17 @@ void Tablet::StartTransaction(WriteTransactionState* tx_state) {
 }
 
 Status Tablet::ValidateInsertOrUpsertUnlocked(const RowOp& op) const {
-  // Check that no individual cell is larger than the specified max.
   ConstContiguousRow row(schema(), op.decoded_op.row_data);
+  return ValidateInsertedRowUnlocked(row, op.decoded_op.isset_bitmap,
+                                     op.key_probe->encoded_key_slice());
+}
+
+Status Tablet::ValidateInsertedRowUnlocked(const ConstContiguousRow& row,
+                                           const uint8_t* isset_bitmap,
+                                           const Slice& encoded_key) const {
+  // Check that no individual cell is larger than the specified max.
   for (int i = 0; i < schema()->num_columns(); i++) {
-    if (!BitmapTest(op.decoded_op.isset_bitmap, i)) continue;
+    if (isset_bitmap && !BitmapTest(isset_bitmap, i)) continue;
     const auto& col = schema()->column(i);
     if (col.type_info()->physical_type() != BINARY) continue;
     const auto& cell = row.cell(i);
@@ -437,7 +686,7 @@ Status Tablet::ValidateInsertOrUpsertUnlocked(const RowOp& op) const {
     }
   }
   // Check that the encoded key is not longer than the maximum.
-  auto enc_key_size = op.key_probe->encoded_key_slice().size();
+  auto enc_key_size = encoded_key.size();
   if (PREDICT_FALSE(enc_key_size > FLAGS_max_encoded_key_size_bytes)) {
     return Status::InvalidArgument(Substitute(
         "encoded primary key too large ($0 bytes, maximum is $1 bytes)",
@@ -494,23 +743,43 @@ Status Tablet::InsertOrUpsertUnlocked(WriteTransactionState *tx_state,
   const bool is_upsert = op->decoded_op.type == RowOperationsPB::UPSERT;
   const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
 
+  if (is_upsert && IsFullRowUpsert(*op)) {
+    return ApplyFullRowUpsert(tx_state, op, stats);
+  }
+
   // First, ensure that it is a unique key by checking all the open RowSets.
-  vector<RowSet *> to_check = FindRowSetsToCheck(op, comps);
-  for (RowSet *rowset : to_check) {
-    bool present = false;
-    RETURN_NOT_OK(rowset->CheckRowPresent(*op->key_probe, &present, stats));
-    if (present) {
-      if (is_upsert) {
-        return ApplyUpsertAsUpdate(tx_state, op, rowset, stats);
+  RowSet* present_in = op->present_in_rowset;
+  if (present_in == nullptr) {
+    vector<RowSet *> to_check;
+    if (op->checked_present) {
+      // BulkCheckPresence() already checked the rowsets with known bounds,
+      // which leaves the ones whose bounds change as rows get inserted.
+      for (const shared_ptr<RowSet>& rs : comps->rowsets->unbounded_rowsets()) {
+        to_check.push_back(rs.get());
       }
-      Status s = Status::AlreadyPresent("key already present");
-      if (metrics_) {
-        metrics_->insertions_failed_dup_key->Increment();
+    } else {
+      to_check = FindRowSetsToCheck(op, comps);
+    }
+    for (RowSet *rowset : to_check) {
+      bool present = false;
+      RETURN_NOT_OK(rowset->CheckRowPresent(*op->key_probe, &present, stats));
+      if (present) {
+        present_in = rowset;
+        break;
       }
-      op->SetFailed(s);
-      return s;
     }
   }
+  if (present_in != nullptr) {
+    if (is_upsert) {
+      return ApplyUpsertAsUpdate(tx_state, op, present_in, stats);
+    }
+    Status s = Status::AlreadyPresent("key already present");
+    if (metrics_) {
+      metrics_->insertions_failed_dup_key->Increment();
+    }
+    op->SetFailed(s);
+    return s;
+  }
 
   Timestamp ts = tx_state->timestamp();
   ConstContiguousRow row(schema(), op->decoded_op.row_data);
@@ -584,6 +853,146 @@ Status Tablet::ApplyUpsertAsUpdate(WriteTransactionState* tx_state,
   return s;
 }
 
+bool Tablet::IsFullRowUpsert(const RowOp& upsert) const {
+  const Schema* schema = this->schema();
+  if (schema->num_key_columns() == schema->num_columns()) {
+    return false;
+  }
+  for (int i = schema->num_key_columns(); i < schema->num_columns(); i++) {
+    if (!BitmapTest(upsert.decoded_op.isset_bitmap, i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+Status Tablet::ApplyFullRowUpsert(WriteTransactionState* tx_state,
+                                  RowOp* upsert,
+                                  ProbeStats* stats) {
+  const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
+  const Timestamp ts = tx_state->timestamp();
+  ConstContiguousRow row(schema(), upsert->decoded_op.row_data);
+
+  // The update replaces every non-key column, so nothing needs to be read
+  // from the existing row. Apply it to each rowset which may hold the key
+  // instead of first checking which one does: MutateRow() looks the key up
+  // once and returns NotFound if it isn't there.
+  faststring buf;
+  RowChangeListEncoder enc(&buf);
+  enc.SetToFullRowUpdate(row);
+  RowChangeList rcl = enc.as_changelist();
+
+  // BulkCheckPresence() leaves full-row UPSERTs alone.
+  DCHECK(!upsert->checked_present);
+  gscoped_ptr<OperationResultPB> result(new OperationResultPB());
+  for (RowSet* rowset : FindRowSetsToCheck(upsert, comps)) {
+    Status s = rowset->MutateRow(ts, *upsert->key_probe, rcl, tx_state->op_id(), stats,
+                                 result.get());
+    if (s.IsNotFound()) {
+      continue;
+    }
+    if (s.ok()) {
+      upsert->SetMutateSucceeded(std::move(result));
+    } else {
+      upsert->SetFailed(s);
+    }
+    return s;
+  }
+
+  Status s = comps->memrowset->Insert(ts, row, tx_state->op_id());
+  if (s.ok()) {
+    upsert->SetInsertSucceeded(comps->memrowset->mrs_id());
+  } else {
+    upsert->SetFailed(s);
+  }
+  return s;
+}
+
+void Tablet::BulkCheckPresence(WriteTransactionState* tx_state, ProbeStats* stats_array) {
+  const TabletComponents* comps = DCHECK_NOTNULL(tx_state->tablet_components());
+  const vector<RowOp*>& row_ops = tx_state->row_ops();
+  auto op_key = [&](int op_idx) -> const Slice& {
+    return row_ops[op_idx]->key_probe->encoded_key_slice();
+  };
+
+  // Sort the ops which are still to be applied by key.
+  vector<int> sorted_ops;
+  sorted_ops.reserve(row_ops.size());
+  for (int i = 0; i < row_ops.size(); i++) {
+    if (row_ops[i]->key_probe && !row_ops[i]->has_result()) {
+      sorted_ops.push_back(i);
+    }
+  }
+  std::sort(sorted_ops.begin(), sorted_ops.end(), [&](int a, int b) {
+      return op_key(a).compare(op_key(b)) < 0;
+    });
+
+  // Keep the INSERTs and UPSERTs whose key is unique within the batch. Ops
+  // replayed from the log already know which rowset to apply to, and
+  // full-row UPSERTs look their key up as they apply (see
+  // ApplyFullRowUpsert()), so checking them here would only repeat the
+  // lookup.
+  vector<int> checked_ops;
+  vector<Slice> keys;
+  for (int i = 0; i < sorted_ops.size();) {
+    int run_end = i + 1;
+    while (run_end < sorted_ops.size() && op_key(sorted_ops[run_end]) == op_key(sorted_ops[i])) {
+      run_end++;
+    }
+    RowOp* op = row_ops[sorted_ops[i]];
+    if (run_end == i + 1 &&
+        (op->decoded_op.type == RowOperationsPB::INSERT ||
+         (op->decoded_op.type == RowOperationsPB::UPSERT && !IsFullRowUpsert(*op))) &&
+        !op->orig_result_from_log_) {
+      checked_ops.push_back(sorted_ops[i]);
+      keys.push_back(op_key(sorted_ops[i]));
+    }
+    i = run_end;
+  }
+  // A single op has nothing to share its lookups with.
+  if (checked_ops.size() < 2) {
+    return;
+  }
+
+  // Find the candidate keys of each rowset in a single pass over the rowset
+  // tree, and group them by rowset, each group in key order.
+  vector<std::pair<RowSet*, int>> candidates;
+  comps->rowsets->ForEachRowSetContainingKeys(keys, [&](RowSet* rs, int i) {
+      candidates.emplace_back(rs, i);
+    });
+  std::sort(candidates.begin(), candidates.end());
+
+  for (int op_idx : checked_ops) {
+    row_ops[op_idx]->checked_present = true;
+  }
+  vector<const RowSetKeyProbe*> probes;
+  vector<ProbeStats*> probe_stats;
+  gscoped_array<bool> present(new bool[keys.size()]);
+  for (int i = 0; i < candidates.size();) {
+    RowSet* rs = candidates[i].first;
+    int run_end = i;
+    probes.clear();
+    probe_stats.clear();
+    for (; run_end < candidates.size() && candidates[run_end].first == rs; run_end++) {
+      int op_idx = checked_ops[candidates[run_end].second];
+      probes.push_back(row_ops[op_idx]->key_probe.get());
+      probe_stats.push_back(&stats_array[op_idx]);
+    }
+    Status s = rs->CheckRowsPresent(probes.data(), probes.size(), present.get(),
+                                    probe_stats.data());
+    for (int j = i; j < run_end; j++) {
+      RowOp* op = row_ops[checked_ops[candidates[j].second]];
+      if (PREDICT_FALSE(!s.ok())) {
+        // Leave the op to be checked on its own, which will surface the error.
+        op->checked_present = false;
+      } else if (present[j - i]) {
+        op->present_in_rowset = rs;
+      }
+    }
+    i = run_end;
+  }
+}
+
 vector<RowSet*> Tablet::FindRowSetsToCheck(RowOp* op,
                                            const TabletComponents* comps) {
   vector<RowSet*> to_check;
@@ -693,14 +1102,17 @@ void Tablet::ApplyRowOperations(WriteTransactionState* tx_state) {
       tx_state->arena()->AllocateBytesAligned(sizeof(ProbeStats) * num_ops,
                                               alignof(ProbeStats)));
 
+  // Manually run the constructors to clear the stats to 0 before collecting
+  // them.
+  for (int i = 0; i < num_ops; i++) {
+    new (&stats_array[i]) ProbeStats();
+  }
+
   StartApplying(tx_state);
+  BulkCheckPresence(tx_state, stats_array);
   int i = 0;
   for (RowOp* row_op : tx_state->row_ops()) {
-    ProbeStats* stats = &stats_array[i++];
-    // Manually run the constructor to clear the stats to 0 before collecting
-    // them.
-    new (stats) ProbeStats();
-    ApplyRowOperation(tx_state, row_op, stats);
+    ApplyRowOperation(tx_state, row_op, &stats_array[i++]);
   }
 
   if (metrics_) {
@@ -817,10 +1229,132 @@ bool Tablet::GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const
 
 HistoryGcOpts Tablet::GetHistoryGcOpts() const {
   Timestamp ancient_history_mark;
-  if (GetTabletAncientHistoryMark(&ancient_history_mark)) {
-    return HistoryGcOpts::Enabled(ancient_history_mark);
+  HistoryGcOpts opts = GetTabletAncientHistoryMark(&ancient_history_mark) ?
+      HistoryGcOpts::Enabled(ancient_history_mark) : HistoryGcOpts::Disabled();
+  const Schema* s = schema();
+  int ttl_col_idx = s->find_ttl_column();
+  if (ttl_col_idx != Schema::kColumnNotFound) {
+    return opts.WithRowExpiration(s->column_id(ttl_col_idx),
+                                  GetExpirationCutoffMicros(s->column(ttl_col_idx)));
   }
-  return HistoryGcOpts::Disabled();
+  return opts;
+}
+
+int64_t Tablet::GetExpirationCutoffMicros(const ColumnSchema& ttl_col) {
+  DCHECK_GT(ttl_col.attributes().ttl_seconds, 0);
+  return GetCurrentTimeMicros() - ttl_col.attributes().ttl_seconds * 1000000;
+}
+
+Status Tablet::BulkIngest(const vector<ConstContiguousRow>& rows, Timestamp timestamp) {
+  TRACE_EVENT2("tablet", "Tablet::BulkIngest",
+               "tablet_id", tablet_id(),
+               "num_rows", rows.size());
+  CHECK_EQ(state_, kOpen);
+  if (rows.empty()) {
+    return Status::OK();
+  }
+
+  // Encode and validate the keys, checking that they're in order.
+  vector<unique_ptr<RowSetKeyProbe>> probes;
+  vector<Slice> keys;
+  probes.reserve(rows.size());
+  keys.reserve(rows.size());
+  for (const ConstContiguousRow& row : rows) {
+    DCHECK_SCHEMA_EQ(*row.schema(), *schema());
+    ConstContiguousRow row_key(&key_schema_, row.row_data());
+    probes.emplace_back(new RowSetKeyProbe(row_key));
+    const Slice& key = probes.back()->encoded_key_slice();
+    RETURN_NOT_OK(CheckRowInTablet(row_key));
+    RETURN_NOT_OK(ValidateInsertedRowUnlocked(row, nullptr, key));
+    if (PREDICT_FALSE(!keys.empty() && keys.back().compare(key) >= 0)) {
+      return Status::InvalidArgument(
+          "rows to bulk ingest must be sorted by primary key without duplicates",
+          KUDU_REDACT(schema()->DebugRowKey(row)));
+    }
+    keys.push_back(key);
+  }
+
+  // Lock the keys against concurrent writes while checking that they're not
+  // yet in the tablet and until the new rowsets are visible.
+  tserver::WriteRequestPB dummy_request;
+  WriteTransactionState tx_state(nullptr, &dummy_request, nullptr);
+  vector<ScopedRowLock> row_locks;
+  lock_manager_.AcquireLocks(&tx_state, keys, LockManager::LOCK_EXCLUSIVE, &row_locks);
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  vector<RowSet*> overlapping;
+  comps->rowsets->FindRowSetsIntersectingInterval(keys.front(), keys.back(), &overlapping);
+  // The rowsets with unknown bounds come first: those may hold any key, so
+  // each key must be checked against them individually.
+  int num_unbounded = comps->rowsets->unbounded_rowsets().size();
+  if (overlapping.size() > num_unbounded) {
+    return Status::InvalidArgument(Substitute(
+        "rows to bulk ingest overlap the key range of $0 existing rowset(s)",
+        overlapping.size() - num_unbounded));
+  }
+  ProbeStats stats;
+  for (int i = 0; i < num_unbounded; i++) {
+    for (int j = 0; j < probes.size(); j++) {
+      bool present = false;
+      RETURN_NOT_OK(overlapping[i]->CheckRowPresent(*probes[j], &present, &stats));
+      if (present) {
+        return Status::AlreadyPresent("key already present",
+                                      KUDU_REDACT(schema()->DebugRowKey(rows[j])));
+      }
+    }
+  }
+
+  // Reserve the timestamp: until the transaction commits, snapshots will
+  // undo the insertion of these rows even once the new rowsets are visible.
+  tx_state.set_timestamp(timestamp);
+  StartTransaction(&tx_state);
+
+  // Write the rows out, exactly as a flush of a MemRowSet holding them would.
+  MvccSnapshot snap(mvcc_);
+  gscoped_ptr<CompactionInput> input(
+      CompactionInput::CreateFromSortedRows(rows, schema(), timestamp));
+  RollingDiskRowSetWriter drsw(metadata_.get(), *schema(), bloom_sizing(),
+                               compaction_policy_->target_rowset_size());
+  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for bulk ingest");
+  RETURN_NOT_OK_PREPEND(FlushCompactionInput(input.get(), snap, GetHistoryGcOpts(), &drsw),
+                        "Bulk ingest to disk failed");
+  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+
+  RowSetMetadataVector new_drs_metas;
+  drsw.GetWrittenRowSetMetadata(&new_drs_metas);
+  RowSetVector new_disk_rowsets;
+  for (const shared_ptr<RowSetMetadata>& meta : new_drs_metas) {
+    shared_ptr<DiskRowSet> new_rowset;
+    RETURN_NOT_OK_PREPEND(DiskRowSet::Open(meta,
+                                           log_anchor_registry_.get(),
+                                           mem_trackers_,
+                                           &new_rowset),
+                          Substitute("Unable to open bulk ingest results $0",
+                                     meta->ToString()));
+    new_disk_rowsets.push_back(new_rowset);
+  }
+  RETURN_NOT_OK_PREPEND(FlushMetadata({}, new_drs_metas, TabletMetadata::kNoMrsFlushed),
+                        "Failed to flush new tablet metadata");
+
+  // Make the new rowsets visible and commit in one step with respect to
+  // compactions, so that no compaction can pick the new rowsets up while the
+  // transaction which inserted their rows is still in flight.
+  tx_state.StartApplying();
+  {
+    std::lock_guard<rw_spinlock> lock(component_lock_);
+    AtomicSwapRowSetsUnlocked({}, new_disk_rowsets);
+    tx_state.CommitOrAbort(Transaction::COMMITTED);
+  }
+
+  if (metrics_) {
+    metrics_->rows_bulk_ingested->IncrementBy(drsw.written_count());
+    metrics_->bytes_flushed->IncrementBy(drsw.written_size());
+  }
+  LOG_WITH_PREFIX(INFO) << "Bulk ingest of " << drsw.written_count() << " rows ("
+                        << drsw.written_size() << " bytes) into " << new_disk_rowsets.size()
+                        << " rowset(s) successful";
+  return Status::OK();
 }
 
 Status Tablet::Flush() {
@@ -1127,11 +1661,19 @@ void Tablet::RegisterMaintenanceOps(MaintenanceManager* maint_mgr) {
   maint_mgr->RegisterOp(major_delta_compact_op.get());
   maintenance_ops_.push_back(major_delta_compact_op.release());
 
+  gscoped_ptr<MaintenanceOp> cold_migration_op(new MigrateColdRowSetsOp(this));
+  maint_mgr->RegisterOp(cold_migration_op.get());
+  maintenance_ops_.push_back(cold_migration_op.release());
+
   if (FLAGS_enable_undo_delta_block_gc) {
     gscoped_ptr<MaintenanceOp> undo_delta_block_gc_op(new UndoDeltaBlockGCOp(this));
     maint_mgr->RegisterOp(undo_delta_block_gc_op.get());
     maintenance_ops_.push_back(undo_delta_block_gc_op.release());
   }
+
+  gscoped_ptr<MaintenanceOp> expired_rowset_gc_op(new ExpiredRowSetGCOp(this));
+  maint_mgr->RegisterOp(expired_rowset_gc_op.get());
+  maintenance_ops_.push_back(expired_rowset_gc_op.release());
 }
 
 void Tablet::UnregisterMaintenanceOps() {
@@ -1159,9 +1701,31 @@ Status Tablet::FlushMetadata(const RowSetVector& to_remove,
     to_remove_meta.insert(rowset->metadata()->id());
   }
 
+  UpdateHotProjections();
   return metadata_->UpdateAndFlush(to_remove_meta, to_add, mrs_being_flushed);
 }
 
+bool Tablet::ShouldCacheCompactionOutput() const {
+  vector<string> entries = strings::Split(FLAGS_compaction_cache_output_tablets, ",",
+                                          strings::SkipEmpty());
+  for (const string& entry : entries) {
+    if (entry == tablet_id() || entry == metadata_->table_name()) {
+      return true;
+    }
+  }
+
+  const double min_hit_ratio = FLAGS_compaction_cache_output_min_hit_ratio;
+  const scoped_refptr<cfile::BlockCacheAttribution>& attribution =
+      mem_trackers_.block_cache_attribution;
+  if (min_hit_ratio <= 0 || !attribution) {
+    return false;
+  }
+  const int64_t kMinLookups = 1000;
+  int64_t hits = attribution->hits();
+  int64_t lookups = hits + attribution->misses();
+  return lookups >= kMinLookups && hits >= min_hit_ratio * lookups;
+}
+
 Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                         int64_t mrs_being_flushed) {
   const char *op_name =
@@ -1179,17 +1743,49 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                           "PostTakeMvccSnapshot hook failed");
   }
 
-  shared_ptr<CompactionInput> merge;
-  RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &merge));
+  HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
 
-  RollingDiskRowSetWriter drsw(metadata_.get(), merge->schema(), bloom_sizing(),
-                               compaction_policy_->target_rowset_size());
-  RETURN_NOT_OK_PREPEND(drsw.Open(), "Failed to open DiskRowSet for flush");
+  // Large compactions are split in key ranges which are merged in parallel.
+  vector<string> split_keys;
+  if (mrs_being_flushed == TabletMetadata::kNoMrsFlushed &&
+      FLAGS_compaction_merge_threads > 1) {
+    uint64_t input_size = 0;
+    for (const shared_ptr<RowSet>& rs : input.rowsets()) {
+      input_size += rs->EstimateOnDiskSize();
+    }
+    if (input_size >= FLAGS_compaction_parallel_merge_min_bytes) {
+      RETURN_NOT_OK_PREPEND(input.PickSplitKeys(FLAGS_compaction_merge_threads, &split_keys),
+                            "Failed to split the compaction key range");
+    }
+  }
 
-  HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
-  RETURN_NOT_OK_PREPEND(FlushCompactionInput(merge.get(), flush_snap, history_gc_opts, &drsw),
-                        "Flush to disk failed");
-  RETURN_NOT_OK_PREPEND(drsw.Finish(), "Failed to finish DRS writer");
+  bool cache_output = mrs_being_flushed == TabletMetadata::kNoMrsFlushed &&
+      ShouldCacheCompactionOutput();
+  if (cache_output) {
+    LOG_WITH_PREFIX(INFO) << op_name << ": inserting the written blocks into the block cache";
+  }
+
+  // Flushes always yield hot rowsets, and so do compactions of which any
+  // input is hot and recently accessed.
+  bool cold_output = mrs_being_flushed == TabletMetadata::kNoMrsFlushed;
+  MonoTime now = MonoTime::Now();
+  for (const shared_ptr<RowSet>& rs : input.rowsets()) {
+    if (!cold_output) break;
+    cold_output = IsColdRowSet(rs.get(), now);
+  }
+  if (cold_output) {
+    LOG_WITH_PREFIX(INFO) << op_name << ": writing cold rowsets to the slow storage tier";
+  }
+
+  vector<unique_ptr<RollingDiskRowSetWriter>> drsws;
+  RETURN_NOT_OK(FlushCompactionInputRanges(input, flush_snap, history_gc_opts, split_keys,
+                                           cache_output, cold_output, &drsws));
+  int64_t written_count = 0;
+  size_t written_size = 0;
+  for (const auto& drsw : drsws) {
+    written_count += drsw->written_count();
+    written_size += drsw->written_size();
+  }
 
   if (common_hooks_) {
     RETURN_NOT_OK_PREPEND(common_hooks_->PostWriteSnapshot(),
@@ -1198,20 +1794,25 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
 
   // Though unlikely, it's possible that all of the input rows were actually
   // GCed in this compaction. In that case, we don't actually want to reopen.
-  bool gced_all_input = drsw.written_count() == 0;
+  bool gced_all_input = written_count == 0;
   if (gced_all_input) {
     LOG_WITH_PREFIX(INFO) << op_name << " resulted in no output rows (all input rows "
                           << "were GCed!)  Removing all input rowsets.";
     return HandleEmptyCompactionOrFlush(input.rowsets(), mrs_being_flushed);
   }
 
-  // The RollingDiskRowSet writer wrote out one or more RowSets as the
-  // output. Open these into 'new_rowsets'.
+  // The RollingDiskRowSet writers wrote out one or more RowSets as the
+  // output. Open these into 'new_rowsets'. They are kept in key order, which
+  // ReupdateMissedDeltas() relies on to find the output rows.
   vector<shared_ptr<RowSet> > new_disk_rowsets;
   RowSetMetadataVector new_drs_metas;
-  drsw.GetWrittenRowSetMetadata(&new_drs_metas);
+  for (const auto& drsw : drsws) {
+    RowSetMetadataVector metas;
+    drsw->GetWrittenRowSetMetadata(&metas);
+    new_drs_metas.insert(new_drs_metas.end(), metas.begin(), metas.end());
+  }
 
-  if (metrics_.get()) metrics_->bytes_flushed->IncrementBy(drsw.written_size());
+  if (metrics_.get()) metrics_->bytes_flushed->IncrementBy(written_size);
   CHECK(!new_drs_metas.empty());
   {
     TRACE_EVENT0("tablet", "Opening compaction results");
@@ -1314,6 +1915,7 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   LOG_WITH_PREFIX(INFO) << op_name
                         << " Phase 2: carrying over any updates which arrived during Phase 1";
   LOG_WITH_PREFIX(INFO) << "Phase 2 snapshot: " << non_duplicated_txns_snap.ToString();
+  shared_ptr<CompactionInput> merge;
   RETURN_NOT_OK_PREPEND(
       input.CreateCompactionInput(non_duplicated_txns_snap, schema(), &merge),
           Substitute("Failed to create $0 inputs", op_name).c_str());
@@ -1355,8 +1957,8 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   // their metadata was written to disk.
   AtomicSwapRowSets({ inprogress_rowset }, new_disk_rowsets);
 
-  LOG_WITH_PREFIX(INFO) << op_name << " successful on " << drsw.written_count()
-                        << " rows " << "(" << drsw.written_size() << " bytes)";
+  LOG_WITH_PREFIX(INFO) << op_name << " successful on " << written_count
+                        << " rows " << "(" << written_size << " bytes)";
 
   if (common_hooks_) {
     RETURN_NOT_OK_PREPEND(common_hooks_->PostSwapNewRowSet(),
@@ -1366,6 +1968,73 @@ Status Tablet::DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
   return Status::OK();
 }
 
+Status Tablet::FlushCompactionInputRanges(const RowSetsInCompaction& input,
+                                          const MvccSnapshot& flush_snap,
+                                          const HistoryGcOpts& history_gc_opts,
+                                          const vector<string>& split_keys,
+                                          bool cache_output,
+                                          bool cold_output,
+                                          vector<unique_ptr<RollingDiskRowSetWriter>>* drsws) {
+  const int num_ranges = split_keys.size() + 1;
+  Arena arena(1024, 1024 * 1024);
+  vector<unique_ptr<EncodedKey>> bounds;
+  for (const string& key : split_keys) {
+    gscoped_ptr<EncodedKey> bound;
+    RETURN_NOT_OK(EncodedKey::DecodeEncodedString(*schema(), &arena, key, &bound));
+    bounds.emplace_back(bound.release());
+  }
+
+  vector<shared_ptr<CompactionInput>> merges(num_ranges);
+  for (int i = 0; i < num_ranges; i++) {
+    RETURN_NOT_OK(input.CreateCompactionInput(flush_snap, schema(), &merges[i]));
+    if (num_ranges > 1) {
+      RETURN_NOT_OK(merges[i]->SetKeyRange(i == 0 ? nullptr : bounds[i - 1].get(),
+                                           i == num_ranges - 1 ? nullptr : bounds[i].get()));
+    }
+    drsws->emplace_back(new RollingDiskRowSetWriter(metadata_.get(), merges[i]->schema(),
+                                                    bloom_sizing(),
+                                                    compaction_policy_->target_rowset_size(),
+                                                    cache_output,
+                                                    mem_trackers_.block_cache_attribution,
+                                                    cold_output));
+    RETURN_NOT_OK_PREPEND((*drsws)[i]->Open(), "Failed to open DiskRowSet for flush");
+  }
+  if (num_ranges > 1) {
+    LOG_WITH_PREFIX(INFO) << "Compaction: merging " << num_ranges << " key ranges in parallel";
+  }
+
+  auto flush_range = [&](int i) -> Status {
+    RETURN_NOT_OK_PREPEND(FlushCompactionInput(merges[i].get(), flush_snap, history_gc_opts,
+                                               (*drsws)[i].get()),
+                          "Flush to disk failed");
+    RETURN_NOT_OK_PREPEND((*drsws)[i]->Finish(), "Failed to finish DRS writer");
+    return Status::OK();
+  };
+
+  vector<Status> statuses(num_ranges);
+  CountDownLatch latch(num_ranges - 1);
+  ThreadPool* pool = num_ranges > 1 ? CompactionMergePool::Get() : nullptr;
+  bool background_io = IoRateLimiter::IsBackgroundIoThread();
+  for (int i = 1; i < num_ranges; i++) {
+    Status s = pool->SubmitFunc([&flush_range, &statuses, &latch, i, background_io]() {
+        ScopedBackgroundIo scope(background_io);
+        statuses[i] = flush_range(i);
+        latch.CountDown();
+      });
+    if (PREDICT_FALSE(!s.ok())) {
+      statuses[i] = flush_range(i);
+      latch.CountDown();
+    }
+  }
+  statuses[0] = flush_range(0);
+  latch.Wait();
+
+  for (const Status& s : statuses) {
+    RETURN_NOT_OK(s);
+  }
+  return Status::OK();
+}
+
 Status Tablet::HandleEmptyCompactionOrFlush(const RowSetVector& rowsets,
                                             int mrs_being_flushed) {
   // Write out the new Tablet Metadata and remove old rowsets.
@@ -1424,6 +2093,84 @@ void Tablet::UpdateCompactionStats(MaintenanceOpStats* stats) {
   stats->set_perf_improvement(quality);
 }
 
+bool Tablet::IsColdRowSet(RowSet* rs, MonoTime now) {
+  shared_ptr<RowSetMetadata> meta = rs->metadata();
+  if (meta && meta->cold()) {
+    return true;
+  }
+  int32_t idle_secs = FLAGS_tablet_cold_rowset_idle_secs;
+  return idle_secs > 0 &&
+      now - rs->access_stats()->LastAccessTime(now) >= MonoDelta::FromSeconds(idle_secs);
+}
+
+shared_ptr<RowSet> Tablet::PickRowSetToMigrate(const RowSetTree& tree, MonoTime now) {
+  int32_t idle_secs = FLAGS_tablet_cold_rowset_idle_secs;
+  if (idle_secs <= 0) {
+    return nullptr;
+  }
+  shared_ptr<RowSet> best;
+  MonoTime best_access_time = now - MonoDelta::FromSeconds(idle_secs);
+  for (const shared_ptr<RowSet>& rs : tree.all_rowsets()) {
+    shared_ptr<RowSetMetadata> meta = rs->metadata();
+    // Skip DuplicatingRowSets, which don't have metadata, and cold rowsets.
+    if (!meta || meta->cold()) {
+      continue;
+    }
+    MonoTime access_time = rs->access_stats()->LastAccessTime(now);
+    if (access_time <= best_access_time && rs->IsAvailableForCompaction()) {
+      best = rs;
+      best_access_time = access_time;
+    }
+  }
+  return best;
+}
+
+Status Tablet::MigrateColdRowSet() {
+  CHECK_EQ(state_, kOpen);
+  shared_ptr<RowSetTree> rowsets_copy;
+  {
+    shared_lock<rw_spinlock> l(component_lock_);
+    rowsets_copy = components_->rowsets;
+  }
+
+  RowSetsInCompaction input;
+  {
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    shared_ptr<RowSet> rs = PickRowSetToMigrate(*rowsets_copy, MonoTime::Now());
+    if (!rs) {
+      return Status::OK();
+    }
+    std::unique_lock<std::mutex> lock(*rs->compact_flush_lock(), std::try_to_lock);
+    CHECK(lock.owns_lock()) << rs->ToString() << " appeared available for "
+      "migration but was unable to lock its compact_flush_lock";
+    input.AddRowSet(rs, std::move(lock));
+  }
+  LOG_WITH_PREFIX(INFO) << "Migrating idle rowset " << input.rowsets()[0]->ToString()
+                        << " to the slow storage tier";
+
+  // Unless it was accessed since its selection, the rowset is rewritten into
+  // cold rowsets.
+  return DoMergeCompactionOrFlush(input, TabletMetadata::kNoMrsFlushed);
+}
+
+void Tablet::UpdateColdMigrationStats(MaintenanceOpStats* stats) {
+  shared_ptr<RowSetTree> rowsets_copy;
+  {
+    shared_lock<rw_spinlock> l(component_lock_);
+    rowsets_copy = components_->rowsets;
+  }
+
+  shared_ptr<RowSet> rs;
+  {
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    rs = PickRowSetToMigrate(*rowsets_copy, MonoTime::Now());
+  }
+  // The migration frees space on the fast tier rather than speeding up
+  // anything, so it only runs when there's nothing more useful to do.
+  stats->set_runnable(rs != nullptr);
+  stats->set_perf_improvement(rs ? kColdMigrationPerfImprovement : 0);
+}
+
 
 Status Tablet::DebugDump(vector<string> *lines) {
   shared_lock<rw_spinlock> l(component_lock_);
@@ -1442,6 +2189,60 @@ Status Tablet::DebugDump(vector<string> *lines) {
   return Status::OK();
 }
 
+namespace {
+
+// Collects into 'rowsets', in the order of tree.all_rowsets(), the rowsets of
+// 'tree' which may hold keys in one of 'ranges', as returned by
+// ScanSpec::GetKeyInListRanges(). Returns false if they can't be told apart
+// from the others.
+bool FindRowSetsForKeyRanges(const RowSetTree& tree,
+                             const vector<EncodedKeyRange>& ranges,
+                             bool single_column_key,
+                             vector<RowSet*>* rowsets) {
+  unordered_set<RowSet*> matching;
+  if (single_column_key) {
+    // The ranges are sorted point keys: look them up in one pass.
+    vector<Slice> keys;
+    keys.reserve(ranges.size());
+    for (const EncodedKeyRange& range : ranges) {
+      keys.emplace_back(range.lower);
+    }
+    tree.ForEachRowSetContainingKeys(keys, [&](RowSet* rs, int /* key_idx */) {
+        matching.insert(rs);
+      });
+    for (const shared_ptr<RowSet>& rs : tree.unbounded_rowsets()) {
+      matching.insert(rs.get());
+    }
+  } else {
+    vector<RowSet*> found;
+    for (const EncodedKeyRange& range : ranges) {
+      if (range.upper.empty()) {
+        return false;
+      }
+      // As below, the interval is inclusive, so this may pick one more rowset
+      // than necessary.
+      tree.FindRowSetsIntersectingInterval(range.lower, range.upper, &found);
+    }
+    matching.insert(found.begin(), found.end());
+  }
+
+  for (const shared_ptr<RowSet>& rs : tree.all_rowsets()) {
+    if (ContainsKey(matching, rs.get())) {
+      rowsets->push_back(rs.get());
+    }
+  }
+  return true;
+}
+
+// Records in the current trace how many of the tablet's 'num_rowsets' rowsets
+// a scan iterates, for scan profiles.
+void TraceRowSetsScanned(size_t num_scanned, size_t num_rowsets) {
+  TRACE_COUNTER_INCREMENT("rowsets_scanned", num_scanned);
+  TRACE_COUNTER_INCREMENT("rowsets_pruned", num_rowsets - num_scanned);
+}
+
+} // anonymous namespace
+
 Status Tablet::CaptureConsistentIterators(
   const Schema *projection,
   const MvccSnapshot &snap,
@@ -1459,6 +2260,27 @@ Status Tablet::CaptureConsistentIterators(
   RETURN_NOT_OK(components_->memrowset->NewRowIterator(projection, snap, order, &ms_iter));
   ret.push_back(shared_ptr<RowwiseIterator>(ms_iter.release()));
 
+  // Cull row-sets in the case of an IN list predicate on the leading key
+  // column, keeping those which may hold the keys of one of its values. The
+  // rowset iterators then only read the rows of those keys.
+  vector<EncodedKeyRange> key_ranges;
+  vector<RowSet *> key_range_sets;
+  if (spec != nullptr &&
+      spec->GetKeyInListRanges(*schema(), &key_ranges) &&
+      FindRowSetsForKeyRanges(*components_->rowsets, key_ranges,
+                              schema()->num_key_columns() == 1, &key_range_sets)) {
+    for (const RowSet *rs : key_range_sets) {
+      gscoped_ptr<RowwiseIterator> row_it;
+      RETURN_NOT_OK_PREPEND(rs->NewRowIterator(projection, snap, order, &row_it),
+                            Substitute("Could not create iterator for rowset $0",
+                                       rs->ToString()));
+      ret.push_back(shared_ptr<RowwiseIterator>(row_it.release()));
+    }
+    TraceRowSetsScanned(key_range_sets.size(), components_->rowsets->all_rowsets().size());
+    ret.swap(*iters);
+    return Status::OK();
+  }
+
   // Cull row-sets in the case of key-range queries.
   if (spec != nullptr && spec->lower_bound_key() && spec->exclusive_upper_bound_key()) {
     // TODO : support open-ended intervals
@@ -1477,6 +2299,7 @@ Status Tablet::CaptureConsistentIterators(
                                        rs->ToString()));
       ret.push_back(shared_ptr<RowwiseIterator>(row_it.release()));
     }
+    TraceRowSetsScanned(interval_sets.size(), components_->rowsets->all_rowsets().size());
     ret.swap(*iters);
     return Status::OK();
   }
@@ -1490,6 +2313,8 @@ Status Tablet::CaptureConsistentIterators(
                                      rs->ToString()));
     ret.push_back(shared_ptr<RowwiseIterator>(row_it.release()));
   }
+  TraceRowSetsScanned(components_->rowsets->all_rowsets().size(),
+                      components_->rowsets->all_rowsets().size());
 
   // Swap results into the parameters.
   ret.swap(*iters);
@@ -1512,6 +2337,73 @@ Status Tablet::CountRows(uint64_t *count) const {
   return Status::OK();
 }
 
+namespace {
+
+// Adds to '*count' the number of rows of 'rowset' which are live in 'snap',
+// by iterating over them with the empty 'projection'.
+Status CountLiveRowsByIterating(const RowSet& rowset, const Schema* projection,
+                                const MvccSnapshot& snap, uint64_t* count) {
+  gscoped_ptr<RowwiseIterator> iter;
+  RETURN_NOT_OK(rowset.NewRowIterator(projection, snap, UNORDERED, &iter));
+  RETURN_NOT_OK(iter->Init(nullptr));
+  Arena arena(1024, 1024);
+  RowBlock block(*projection, 1024, &arena);
+  while (iter->HasNext()) {
+    RETURN_NOT_OK(iter->NextBlock(&block));
+    *count += block.selection_vector()->CountSelected();
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+Status Tablet::CountLiveRows(const MvccSnapshot& snap, uint64_t* count,
+                             int* num_rowsets_iterated) const {
+  Schema projection;
+  RETURN_NOT_OK(GetMappedReadProjection(Schema(), &projection));
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  uint64_t total = 0;
+  int iterated = 0;
+  RETURN_NOT_OK(CountLiveRowsByIterating(*comps->memrowset, &projection, snap, &total));
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    rowid_t live_rows;
+    if (rowset->CountLiveRowsFromMetadata(snap, &live_rows)) {
+      total += live_rows;
+    } else {
+      RETURN_NOT_OK_PREPEND(CountLiveRowsByIterating(*rowset, &projection, snap, &total),
+                            Substitute("Could not count the rows of rowset $0",
+                                       rowset->ToString()));
+      iterated++;
+    }
+  }
+
+  *count = total;
+  if (num_rowsets_iterated) {
+    *num_rowsets_iterated = iterated;
+  }
+  return Status::OK();
+}
+
+Status Tablet::SplitKeyRange(const string& start_key,
+                             const string& stop_key,
+                             int num_ranges,
+                             vector<string>* split_keys) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  RowSetVector rowsets;
+  if (!comps->memrowset->empty()) {
+    rowsets.push_back(comps->memrowset);
+  }
+  for (const shared_ptr<RowSet>& rowset : comps->rowsets->all_rowsets()) {
+    rowsets.push_back(rowset);
+  }
+  return PickSplitKeys(rowsets, num_ranges, start_key, stop_key, split_keys);
+}
+
 size_t Tablet::MemRowSetSize() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1880,6 +2772,120 @@ Status Tablet::DeleteAncientUndoDeltas(int64_t* blocks_deleted, int64_t* bytes_d
   return Status::OK();
 }
 
+namespace {
+
+// Sets 'expired' to whether all the rows of 'rowset' are expired per
+// 'history_gc_opts': the maximum value of the TTL column in its base data is
+// expired, and no REDO delta may have updated the column since.
+Status IsRowSetExpired(const HistoryGcOpts& history_gc_opts,
+                       const Schema& schema,
+                       RowSet* rowset,
+                       bool* expired) {
+  *expired = false;
+  DiskRowSet* drs = dynamic_cast<DiskRowSet*>(rowset);
+  if (drs == nullptr) {
+    return Status::OK();
+  }
+  ColumnId ttl_col_id = history_gc_opts.ttl_col_id();
+  ColumnStatistics stats(schema.column_by_id(ttl_col_id).type_info());
+  bool found;
+  RETURN_NOT_OK(drs->MergeColumnStatistics(ttl_col_id, &stats, &found));
+  if (!found || stats.non_null_count() == 0) {
+    // The rowset was written without statistics, or before the column existed.
+    return Status::OK();
+  }
+  int64_t max_micros = static_cast<int64_t>(UNALIGNED_LOAD64(stats.max_value().data()));
+  if (!history_gc_opts.IsExpired(max_micros)) {
+    return Status::OK();
+  }
+  bool updated;
+  RETURN_NOT_OK(drs->delta_tracker()->MayHaveUpdatesToColumn(ttl_col_id, &updated));
+  *expired = !updated;
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+Status Tablet::EstimateBytesInExpiredRowSets(int64_t* bytes) {
+  DCHECK(bytes);
+  *bytes = 0;
+  HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
+  if (!history_gc_opts.row_expiration_enabled()) {
+    return Status::OK();
+  }
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    bool expired;
+    RETURN_NOT_OK(IsRowSetExpired(history_gc_opts, *schema(), rowset.get(), &expired));
+    if (expired) {
+      *bytes += rowset->EstimateOnDiskSize();
+    }
+  }
+  return Status::OK();
+}
+
+Status Tablet::DeleteExpiredRowSets(int64_t* rowsets_deleted, int64_t* bytes_deleted) {
+  HistoryGcOpts history_gc_opts = GetHistoryGcOpts();
+  if (!history_gc_opts.row_expiration_enabled()) return Status::OK();
+
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+
+  RowSetVector candidates;
+  for (const auto& rowset : comps->rowsets->all_rowsets()) {
+    bool expired;
+    RETURN_NOT_OK(IsRowSetExpired(history_gc_opts, *schema(), rowset.get(), &expired));
+    if (expired) {
+      candidates.push_back(rowset);
+    }
+  }
+
+  // We need to hold the compact_flush_lock of each rowset we delete, so that
+  // no compaction picks it meanwhile.
+  RowSetVector rowsets_to_delete;
+  vector<std::unique_lock<std::mutex>> rowset_locks;
+  {
+    std::lock_guard<std::mutex> compact_lock(compact_select_lock_);
+    for (const auto& rowset : candidates) {
+      if (!rowset->IsAvailableForCompaction()) {
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(*rowset->compact_flush_lock(), std::try_to_lock);
+      CHECK(lock.owns_lock()) << rowset->ToString() << " unable to lock compact_flush_lock";
+      rowsets_to_delete.push_back(rowset);
+      rowset_locks.push_back(std::move(lock));
+    }
+  }
+
+  // The rowsets may have been updated while they were not locked.
+  int64_t tablet_bytes_deleted = 0;
+  RowSetVector expired_rowsets;
+  for (const auto& rowset : rowsets_to_delete) {
+    bool expired;
+    RETURN_NOT_OK(IsRowSetExpired(history_gc_opts, *schema(), rowset.get(), &expired));
+    if (expired) {
+      tablet_bytes_deleted += rowset->EstimateOnDiskSize();
+      expired_rowsets.push_back(rowset);
+    }
+  }
+  if (!expired_rowsets.empty()) {
+    LOG_WITH_PREFIX(INFO) << Substitute("Deleting $0 expired rowsets ($1)",
+                                        expired_rowsets.size(),
+                                        HumanReadableNumBytes::ToString(tablet_bytes_deleted));
+    RETURN_NOT_OK(HandleEmptyCompactionOrFlush(expired_rowsets,
+                                               TabletMetadata::kNoMrsFlushed));
+  }
+
+  metrics_->expired_rowset_gc_bytes_deleted->IncrementBy(tablet_bytes_deleted);
+
+  if (rowsets_deleted) *rowsets_deleted = expired_rowsets.size();
+  if (bytes_deleted) *bytes_deleted = tablet_bytes_deleted;
+  return Status::OK();
+}
+
 int64_t Tablet::CountUndoDeltasForTests() const {
   scoped_refptr<TabletComponents> comps;
   GetComponents(&comps);
@@ -1949,6 +2955,42 @@ void Tablet::PrintRSLayout(ostream* o) {
   *o << "</pre>" << std::endl;
 }
 
+void Tablet::ComputeReadAmplification(ReadAmplificationReport* report) const {
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  tablet::ComputeReadAmplification(*comps->rowsets, *schema(), report);
+  report->mrs_bytes = comps->memrowset->memory_footprint();
+}
+
+Status Tablet::GetColumnStatistics(const Schema& schema,
+                                   vector<ColumnStatistics>* stats,
+                                   vector<bool>* complete) const {
+  DCHECK(schema.has_column_ids());
+  scoped_refptr<TabletComponents> comps;
+  GetComponents(&comps);
+  stats->clear();
+  for (int i = 0; i < schema.num_columns(); i++) {
+    stats->emplace_back(schema.column(i).type_info());
+  }
+  complete->assign(schema.num_columns(), true);
+  for (const shared_ptr<RowSet>& rs : comps->rowsets->all_rowsets()) {
+    DiskRowSet* drs = dynamic_cast<DiskRowSet*>(rs.get());
+    if (drs == nullptr) {
+      // A DuplicatingRowSet, while its inputs are being compacted. They are
+      // still in the tree.
+      continue;
+    }
+    for (int i = 0; i < schema.num_columns(); i++) {
+      bool found;
+      RETURN_NOT_OK(drs->MergeColumnStatistics(schema.column_id(i), &(*stats)[i], &found));
+      if (!found) {
+        (*complete)[i] = false;
+      }
+    }
+  }
+  return Status::OK();
+}
+
 string Tablet::LogPrefix() const {
   return Substitute("T $0 P $1: ", tablet_id(), metadata_->fs_manager()->uuid());
 }
@@ -1970,6 +3012,7 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
   DCHECK(iter_.get() == nullptr);
 
   RETURN_NOT_OK(tablet_->GetMappedReadProjection(projection_, &projection_));
+  tablet_->RecordProjectionUse(projection_);
 
   vector<shared_ptr<RowwiseIterator>> iters;
 
@@ -1977,11 +3020,11 @@ Status Tablet::Iterator::Init(ScanSpec *spec) {
 
   switch (order_) {
     case ORDERED:
-      iter_.reset(new MergeIterator(projection_, iters));
+      iter_.reset(new MergeIterator(projection_, iters, MakeMergeKeyComparator(projection_)));
       break;
     case UNORDERED:
     default:
-      iter_.reset(new UnionIterator(iters));
+      iter_.reset(new UnionIterator(iters, FLAGS_tablet_scan_prefetch_rowsets));
       break;
   }
 
@@ -23,6 +23,7 @@
 #include <memory>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "kudu/common/iterator.h"
@@ -45,6 +46,7 @@
 
 namespace kudu {
 
+class ColumnStatistics;
 class MemTracker;
 class MetricEntity;
 class RowChangeList;
@@ -69,7 +71,9 @@ class CompactionPolicy;
 class HistoryGcOpts;
 class MemRowSet;
 class MvccSnapshot;
+struct ReadAmplificationReport;
 struct RowOp;
+class RollingDiskRowSetWriter;
 class RowSetsInCompaction;
 class RowSetTree;
 struct TabletComponents;
@@ -116,10 +120,9 @@ class Tablet {
 
   // Acquire locks for each of the operations in the given txn.
   //
-  // Note that, if this fails, it's still possible that the transaction
-  // state holds _some_ of the locks. In that case, we expect that
-  // the transaction will still clean them up when it is aborted (or
-  // otherwise destructed).
+  // The locks are acquired together, in key order, once every operation's key
+  // has been checked against the tablet's partition. If this fails, none of
+  // the locks have been taken.
   Status AcquireRowLocks(WriteTransactionState* tx_state);
 
   // Starts an MVCC transaction which must have a pre-assigned timestamp.
@@ -145,10 +148,9 @@ class Tablet {
   // present in the tablet.
   // Returns Status::OK unless allocation fails.
   //
-  // Acquires the row lock for the given operation, setting it in the
-  // RowOp struct. This also sets the row op's RowSetKeyProbe.
-  Status AcquireLockForOp(WriteTransactionState* tx_state,
-                          RowOp* op);
+  // Sets the row op's RowSetKeyProbe, and checks that its key falls within
+  // this tablet's partition.
+  Status PrepareKeyForOp(RowOp* op);
 
   // Signal that the given transaction is about to Apply.
   void StartApplying(WriteTransactionState* tx_state);
@@ -174,6 +176,24 @@ class Tablet {
                         const OrderMode order,
                         gscoped_ptr<RowwiseIterator> *iter) const;
 
+  // Write 'rows' directly into new DiskRowSets, bypassing the write-ahead log
+  // and the MemRowSet, and make them visible as inserted at 'timestamp'. The
+  // rows become visible atomically: a snapshot either sees all or none of them.
+  //
+  // 'rows' must be in this tablet's schema and sorted by primary key with no
+  // duplicates. They must not overlap any existing DiskRowSet's key range, as
+  // is the case when loading into an empty tablet or appending past its last
+  // key; otherwise this returns InvalidArgument. Returns AlreadyPresent if
+  // any of the keys is present in a MemRowSet.
+  //
+  // 'timestamp' must be one a transaction may be started at, as for
+  // StartTransaction().
+  //
+  // Since nothing is written to the log, the ingested rows are neither
+  // replayed at bootstrap (they are durable once this returns) nor
+  // replicated to other replicas of the tablet.
+  Status BulkIngest(const std::vector<ConstContiguousRow>& rows, Timestamp timestamp);
+
   // Flush the current MemRowSet for this tablet to disk. This swaps
   // in a new (initially empty) MemRowSet in its place.
   //
@@ -205,6 +225,20 @@ class Tablet {
   // on the current layout.
   void PrintRSLayout(std::ostream* o);
 
+  // Reports how expensive the current layout of the tablet is to read.
+  void ComputeReadAmplification(ReadAmplificationReport* report) const;
+
+  // Merges the column statistics of the DiskRowSets of the tablet into
+  // 'stats', one entry per column of 'schema', a copy of the current or a
+  // recent schema of the tablet, with column IDs. They describe the
+  // base data of the rowsets: rows in the MemRowSet, updates and deletes are
+  // not reflected. 'complete' is set, per column, to whether every rowset
+  // had statistics for it, which those written before the column was added
+  // or with --cfile_write_column_stats disabled don't.
+  Status GetColumnStatistics(const Schema& schema,
+                             std::vector<ColumnStatistics>* stats,
+                             std::vector<bool>* complete) const;
+
   // Flags to change the behavior of compaction.
   enum CompactFlag {
     COMPACT_NO_FLAGS = 0,
@@ -221,6 +255,14 @@ class Tablet {
   // Update the statistics for performing a compaction.
   void UpdateCompactionStats(MaintenanceOpStats* stats);
 
+  // Rewrites the hot rowset which has gone without access the longest, if it
+  // has been idle for at least --tablet_cold_rowset_idle_secs, into cold
+  // rowsets whose blocks are placed on the slow storage tier.
+  Status MigrateColdRowSet();
+
+  // Update the statistics for migrating a cold rowset.
+  void UpdateColdMigrationStats(MaintenanceOpStats* stats);
+
   // Returns the exact current size of the MRS, in bytes. A value greater than 0 doesn't imply
   // that the MRS has data, only that it has allocated that amount of memory.
   // This method takes a read lock on component_lock_ and is thread-safe.
@@ -294,6 +336,16 @@ class Tablet {
   Status DeleteAncientUndoDeltas(int64_t* blocks_deleted = nullptr,
                                  int64_t* bytes_deleted = nullptr);
 
+  // Estimate the number of bytes in the rowsets whose rows are all expired by
+  // the TTL column of the tablet, see ColumnStorageAttributes::ttl_seconds.
+  Status EstimateBytesInExpiredRowSets(int64_t* bytes);
+
+  // Find and delete, without rewriting them, the rowsets whose rows are all
+  // expired by the TTL column of the tablet. If this method returns OK, the
+  // number of rowsets and bytes deleted are returned in the out-parameters.
+  Status DeleteExpiredRowSets(int64_t* rowsets_deleted = nullptr,
+                              int64_t* bytes_deleted = nullptr);
+
   // Count the number of deltas in the tablet. Only used for tests.
   int64_t CountUndoDeltasForTests() const;
   int64_t CountRedoDeltasForTests() const;
@@ -306,6 +358,25 @@ class Tablet {
   // memrowset in the current implementation.
   Status CountRows(uint64_t *count) const;
 
+  // Count the rows of the tablet which are live in 'snap'. Unlike scanning
+  // them, this uses the row counts which disk rowsets can compute from their
+  // metadata (see RowSet::CountLiveRowsFromMetadata()), and only iterates
+  // over the rows of the MRS and of the rowsets whose deltas require it.
+  //
+  // If 'num_rowsets_iterated' is non-NULL, it is set to the number of disk
+  // rowsets which had to be iterated over.
+  Status CountLiveRows(const MvccSnapshot& snap, uint64_t* count,
+                       int* num_rowsets_iterated = nullptr) const;
+
+  // Append to 'split_keys' up to 'num_ranges - 1' encoded primary keys which
+  // split the encoded key range [start_key, stop_key) of the tablet into
+  // 'num_ranges' ranges of roughly the same number of rows. Empty keys are
+  // unbounded. The keys are sampled from the rowsets (see PickSplitKeys()), so
+  // they may be fewer than requested, e.g. for small tablets.
+  Status SplitKeyRange(const std::string& start_key,
+                       const std::string& stop_key,
+                       int num_ranges,
+                       std::vector<std::string>* split_keys) const;
 
   // Verbosely dump this entire tablet to the logs. This is only
   // really useful when debugging unit tests failures where the tablet
@@ -351,9 +422,15 @@ class Tablet {
   // Otherwise, returns false.
   bool GetTabletAncientHistoryMark(Timestamp* ancient_history_mark) const WARN_UNUSED_RESULT;
 
-  // Calculates history GC options based on properties of the Clock implementation.
+  // Calculates history GC options based on properties of the Clock implementation
+  // and on the TTL column of the tablet, if any.
   HistoryGcOpts GetHistoryGcOpts() const;
 
+  // Returns the time, in microseconds since the Unix epoch, before which the
+  // values of the TTL column 'ttl_col' are expired, see
+  // ColumnStorageAttributes::ttl_seconds.
+  static int64_t GetExpirationCutoffMicros(const ColumnSchema& ttl_col);
+
   // Method used by tests to retrieve all rowsets of this table. This
   // will be removed once code for selecting the appropriate RowSet is
   // finished and delta files is finished is part of Tablet class.
@@ -382,6 +459,12 @@ class Tablet {
     return mem_trackers_.tablet_tracker;
   }
 
+  // Returns the block cache statistics of this tablet's blocks, or null if
+  // the tablet has no metrics.
+  const scoped_refptr<cfile::BlockCacheAttribution>& block_cache_attribution() const {
+    return mem_trackers_.block_cache_attribution;
+  }
+
   // Throttle a RPC with 'bytes' request size.
   // Return true if this RPC is allowed.
   bool ShouldThrottleAllow(int64_t bytes);
@@ -402,6 +485,12 @@ class Tablet {
   // that the encoded key is not too large.
   Status ValidateInsertOrUpsertUnlocked(const RowOp& op) const;
 
+  // Like the above, for a row in the tablet's schema with the given encoded
+  // key. 'isset_bitmap' may be nullptr if all of the row's cells are set.
+  Status ValidateInsertedRowUnlocked(const ConstContiguousRow& row,
+                                     const uint8_t* isset_bitmap,
+                                     const Slice& encoded_key) const;
+
   // Validate the given update/delete operation. In particular, validates that no
   // cell is being updated to an invalid (too large) value.
   Status ValidateMutateUnlocked(const RowOp& op) const;
@@ -427,6 +516,27 @@ class Tablet {
                              RowSet* rowset,
                              ProbeStats* stats);
 
+  // Return true if 'upsert' sets every non-key column of the row.
+  bool IsFullRowUpsert(const RowOp& upsert) const;
+
+  // Perform an UPSERT which sets every non-key column, as part of
+  // InsertOrUpsertUnlocked(). The row is updated in the rowset holding its
+  // key, looking the key up in each candidate rowset only once, or inserted
+  // into the MemRowSet if no rowset holds it.
+  Status ApplyFullRowUpsert(WriteTransactionState* tx_state,
+                            RowOp* upsert,
+                            ProbeStats* stats);
+
+  // Check the rowsets with known bounds for the keys of the transaction's
+  // INSERT and UPSERT ops all at once, recording the results in the ops (see
+  // RowOp::checked_present). The keys are sorted, looked up in the rowset
+  // tree in a single pass, and checked against each rowset as a batch, which
+  // is cheaper than checking each op on its own.
+  //
+  // Ops sharing their key with another op of the transaction are left to be
+  // checked on their own, since the earlier op may change what they find.
+  void BulkCheckPresence(WriteTransactionState* tx_state, ProbeStats* stats_array);
+
   // Return the list of RowSets that need to be consulted when processing the
   // given insertion or mutation.
   static std::vector<RowSet*> FindRowSetsToCheck(RowOp* op,
@@ -450,10 +560,41 @@ class Tablet {
   Status PickRowSetsToCompact(RowSetsInCompaction *picked,
                               CompactFlags flags) const;
 
+  // Returns whether compactions should insert the blocks they write into the
+  // block cache: for the tablets named by --compaction_cache_output_tablets,
+  // or whose hit ratio reaches --compaction_cache_output_min_hit_ratio.
+  bool ShouldCacheCompactionOutput() const;
+
+  // Returns whether 'rs' is cold or, if cold migration is enabled, a hot
+  // rowset which hasn't been accessed for --tablet_cold_rowset_idle_secs as
+  // of 'now'. The compaction of cold rowsets only yields cold rowsets.
+  static bool IsColdRowSet(RowSet* rs, MonoTime now);
+
+  // Returns the hot rowset of 'tree', available for compaction, which has
+  // been idle the longest and at least for --tablet_cold_rowset_idle_secs as
+  // of 'now', or null if there is none. Must be called under
+  // compact_select_lock_.
+  static std::shared_ptr<RowSet> PickRowSetToMigrate(const RowSetTree& tree, MonoTime now);
+
   // Performs a merge compaction or a flush.
   Status DoMergeCompactionOrFlush(const RowSetsInCompaction &input,
                                   int64_t mrs_being_flushed);
 
+  // Writes the rows of 'input' as of 'flush_snap' into one
+  // RollingDiskRowSetWriter per key range delimited by 'split_keys', which are
+  // appended to 'drsws' in key order. The ranges are merged in parallel, the
+  // first one on this thread. Phase 1 of DoMergeCompactionOrFlush().
+  //
+  // If 'cache_output' is true, the written blocks are inserted into the block
+  // cache. If 'cold_output' is true, the written rowsets are cold.
+  Status FlushCompactionInputRanges(const RowSetsInCompaction& input,
+                                    const MvccSnapshot& flush_snap,
+                                    const HistoryGcOpts& history_gc_opts,
+                                    const std::vector<std::string>& split_keys,
+                                    bool cache_output,
+                                    bool cold_output,
+                                    std::vector<std::unique_ptr<RollingDiskRowSetWriter>>* drsws);
+
   // Handle the case in which a compaction or flush yielded no output rows.
   // In this case, we just need to remove the rowsets in 'rowsets' from the
   // metadata and flush it.
@@ -505,6 +646,20 @@ class Tablet {
 
   Status CheckRowInTablet(const ConstContiguousRow& row) const;
 
+  // Records a scan of 'projection', a projection mapped to the tablet's
+  // schema, to keep track of the projections scanned most frequently.
+  void RecordProjectionUse(const Schema& projection) const;
+
+  // Sets the projections scanned most frequently since the last call in the
+  // tablet metadata, to be persisted by its next flush (see
+  // TabletSuperBlockPB::hot_projections).
+  void UpdateHotProjections();
+
+  // Enqueues the eager compilation of the code used to scan the hot
+  // projections of the tablet metadata, so that the first scans after the
+  // tablet is opened don't have to fall back to the interpreted code.
+  void PrecompileHotProjections();
+
   // Helper method to find the rowset that has the DMS with the highest retention.
   std::shared_ptr<RowSet> FindBestDMSToFlush(const ReplaySizeMap& replay_size_map) const;
 
@@ -603,6 +758,12 @@ class Tablet {
 
   std::vector<MaintenanceOp*> maintenance_ops_;
 
+  // The number of scans of each projection, keyed by its serialized
+  // ProjectionPB. The counts are halved by every UpdateHotProjections() so
+  // that the projections which fell out of use are eventually forgotten.
+  mutable simple_spinlock projection_uses_lock_;
+  mutable std::unordered_map<std::string, int64_t> projection_uses_;
+
   DISALLOW_COPY_AND_ASSIGN(Tablet);
 };
 
@@ -651,6 +812,11 @@ class Tablet::Iterator : public RowwiseIterator {
 
   virtual void GetIteratorStats(std::vector<IteratorStats>* stats) const OVERRIDE;
 
+  // The snapshot the iterator reads at.
+  const MvccSnapshot& snapshot() const {
+    return snap_;
+  }
+
  private:
   friend class Tablet;
 
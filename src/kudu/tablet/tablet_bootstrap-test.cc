@@ -27,10 +27,17 @@
 #include "kudu/consensus/log_util.h"
 #include "kudu/consensus/metadata.pb.h"
 #include "kudu/consensus/opid_util.h"
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/server/logical_clock.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tablet/tablet_peer.h"
+#include "kudu/util/stopwatch.h"
+
+DECLARE_int32(tablet_bootstrap_log_readahead_segments);
+DEFINE_int32(bootstrap_benchmark_num_ops, 10000,
+             "Number of operations in the log replayed by BenchmarkBootstrap");
 
 using std::shared_ptr;
 using std::string;
@@ -93,7 +100,8 @@ class BootstrapTest : public LogTestBase {
 
   Status RunBootstrapOnTestTablet(const scoped_refptr<TabletMetadata>& meta,
                                   shared_ptr<Tablet>* tablet,
-                                  ConsensusBootstrapInfo* boot_info) {
+                                  ConsensusBootstrapInfo* boot_info,
+                                  TabletStatusListener* listener = nullptr) {
     scoped_refptr<LogAnchorRegistry> log_anchor_registry(new LogAnchorRegistry());
     // Now attempt to recover the log
     RETURN_NOT_OK(BootstrapTablet(
@@ -102,7 +110,7 @@ class BootstrapTest : public LogTestBase {
         shared_ptr<MemTracker>(),
         scoped_refptr<rpc::ResultTracker>(),
         NULL,
-        nullptr, // no status listener
+        listener,
         tablet,
         &log_,
         log_anchor_registry,
@@ -114,7 +122,8 @@ class BootstrapTest : public LogTestBase {
   Status BootstrapTestTablet(int mrs_id,
                              int delta_id,
                              shared_ptr<Tablet>* tablet,
-                             ConsensusBootstrapInfo* boot_info) {
+                             ConsensusBootstrapInfo* boot_info,
+                             TabletStatusListener* listener = nullptr) {
     scoped_refptr<TabletMetadata> meta;
     RETURN_NOT_OK_PREPEND(LoadTestTabletMetadata(mrs_id, delta_id, &meta),
                           "Unable to load test tablet metadata");
@@ -131,7 +140,7 @@ class BootstrapTest : public LogTestBase {
                                                     config, kMinimumTerm, &cmeta),
                           "Unable to create consensus metadata");
 
-    RETURN_NOT_OK_PREPEND(RunBootstrapOnTestTablet(meta, tablet, boot_info),
+    RETURN_NOT_OK_PREPEND(RunBootstrapOnTestTablet(meta, tablet, boot_info, listener),
                           "Unable to bootstrap test tablet");
     return Status::OK();
   }
@@ -171,6 +180,92 @@ TEST_F(BootstrapTest, TestBootstrap) {
   ASSERT_EQ(1, results.size());
 }
 
+// Tests that replaying many segments read ahead in parallel applies every
+// operation, in order.
+TEST_F(BootstrapTest, TestBootstrapWithSegmentReadahead) {
+  FLAGS_tablet_bootstrap_log_readahead_segments = 3;
+  ASSERT_OK(BuildLog());
+
+  const int kNumSegments = 10;
+  OpId last_opid;
+  for (int i = 0; i < kNumSegments; i++) {
+    last_opid = MakeOpId(1, 2 * i + 1);
+    AppendReplicateBatch(last_opid);
+    AppendCommit(last_opid);
+    ASSERT_OK(RollLog());
+  }
+
+  shared_ptr<Tablet> tablet;
+  ConsensusBootstrapInfo boot_info;
+  ASSERT_OK(BootstrapTestTablet(-1, -1, &tablet, &boot_info));
+  ASSERT_TRUE(consensus::OpIdEquals(last_opid, boot_info.last_id))
+      << boot_info.last_id.ShortDebugString();
+  ASSERT_TRUE(boot_info.orphaned_replicates.empty());
+
+  // Each batch inserted a row.
+  vector<string> results;
+  IterateTabletRows(tablet.get(), &results);
+  ASSERT_EQ(kNumSegments, results.size());
+}
+
+// Measures the time to replay a log of --bootstrap_benchmark_num_ops write
+// operations, each inserting and updating a row.
+TEST_F(BootstrapTest, BenchmarkBootstrap) {
+  ASSERT_OK(BuildLog());
+  AppendReplicateBatchAndCommitEntryPairsToLog(FLAGS_bootstrap_benchmark_num_ops,
+                                               APPEND_ASYNC);
+  ASSERT_OK(log_->WaitUntilAllFlushed());
+
+  shared_ptr<Tablet> tablet;
+  ConsensusBootstrapInfo boot_info;
+  LOG_TIMING(INFO, strings::Substitute("bootstrapping $0 ops",
+                                       FLAGS_bootstrap_benchmark_num_ops)) {
+    ASSERT_OK(BootstrapTestTablet(-1, -1, &tablet, &boot_info));
+  }
+  uint64_t num_rows;
+  ASSERT_OK(tablet->CountRows(&num_rows));
+  ASSERT_EQ(FLAGS_bootstrap_benchmark_num_ops, num_rows);
+}
+
+// Tests that the progress of the log replay is reported to the listener.
+TEST_F(BootstrapTest, TestBootstrapProgress) {
+  class ProgressListener : public TabletStatusListener {
+   public:
+    void StatusMessage(const string& /* status */) override {}
+    void BootstrapProgressUpdate(const TabletBootstrapProgress& progress) override {
+      num_updates++;
+      last = progress;
+    }
+    int num_updates = 0;
+    TabletBootstrapProgress last;
+  };
+
+  ASSERT_OK(BuildLog());
+  const int kNumSegments = 3;
+  for (int i = 0; i < kNumSegments; i++) {
+    OpId opid = MakeOpId(1, 2 * i + 1);
+    AppendReplicateBatch(opid);
+    AppendCommit(opid);
+    ASSERT_OK(RollLog());
+  }
+
+  ProgressListener listener;
+  shared_ptr<Tablet> tablet;
+  ConsensusBootstrapInfo boot_info;
+  ASSERT_OK(BootstrapTestTablet(-1, -1, &tablet, &boot_info, &listener));
+
+  // One update as the replay starts, one per segment and one at the end.
+  const TabletBootstrapProgress& p = listener.last;
+  ASSERT_GE(listener.num_updates, p.num_segments + 2);
+  ASSERT_TRUE(p.done);
+  ASSERT_EQ(p.num_segments, p.segments_replayed);
+  ASSERT_GE(p.num_segments, kNumSegments);
+  ASSERT_EQ(kNumSegments, p.ops_replayed);
+  ASSERT_GT(p.bytes_replayed, 0);
+  ASSERT_LE(p.bytes_replayed, p.bytes_to_replay);
+  ASSERT_EQ(0, p.EstimatedSecondsLeft());
+}
+
 // Tests attempting a local bootstrap of a tablet that was in the middle of a
 // tablet copy before "crashing".
 TEST_F(BootstrapTest, TestIncompleteTabletCopy) {
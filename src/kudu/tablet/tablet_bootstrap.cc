@@ -17,6 +17,7 @@
 
 #include "kudu/tablet/tablet_bootstrap.h"
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <map>
 #include <memory>
@@ -51,14 +52,17 @@
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/util/countdown_latch.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/logging.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/path_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/stopwatch.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_bool(skip_remove_old_recovery_dir, false,
             "Skip removing WAL recovery dir after startup. (useful for debugging)");
@@ -70,8 +74,38 @@ DEFINE_double(fault_crash_during_log_replay, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_during_log_replay, unsafe);
 
+DEFINE_int32(tablet_bootstrap_log_readahead_segments, 2,
+             "Number of log segments read, decompressed and decoded in the "
+             "background, in parallel, ahead of their replay during tablet "
+             "bootstrap. Each of them is held in memory until it's replayed. "
+             "If 0, each segment is read as it's replayed.");
+TAG_FLAG(tablet_bootstrap_log_readahead_segments, advanced);
+
 DECLARE_int32(max_clock_sync_error_usec);
 
+METRIC_DEFINE_gauge_int64(tablet, log_replay_bytes, "Log Bytes Replayed",
+                          kudu::MetricUnit::kBytes,
+                          "Number of bytes of log replayed by the bootstrap of the tablet.");
+METRIC_DEFINE_gauge_int64(tablet, log_replay_ops, "Log Operations Replayed",
+                          kudu::MetricUnit::kOperations,
+                          "Number of REPLICATE operations read from the log by the "
+                          "bootstrap of the tablet.");
+METRIC_DEFINE_gauge_int64(tablet, log_replay_duration, "Log Replay Duration",
+                          kudu::MetricUnit::kMicroseconds,
+                          "Wall time spent replaying the log by the bootstrap of the tablet.");
+METRIC_DEFINE_gauge_int64(tablet, log_replay_read_time, "Log Replay Read Time",
+                          kudu::MetricUnit::kMicroseconds,
+                          "Time spent reading, decompressing and decoding log entries "
+                          "by the bootstrap of the tablet. With log readahead, this "
+                          "overlaps the application of the entries.");
+METRIC_DEFINE_gauge_int64(tablet, log_replay_read_wait_time, "Log Replay Read Wait Time",
+                          kudu::MetricUnit::kMicroseconds,
+                          "Time the log replay of the bootstrap of the tablet spent "
+                          "waiting for log entries to be read.");
+METRIC_DEFINE_gauge_int64(tablet, log_replay_apply_time, "Log Replay Apply Time",
+                          kudu::MetricUnit::kMicroseconds,
+                          "Time spent applying log entries to the tablet by its bootstrap.");
+
 namespace kudu {
 namespace tablet {
 
@@ -107,6 +141,7 @@ using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
 using std::unordered_map;
+using std::vector;
 using strings::Substitute;
 using tserver::AlterSchemaRequestPB;
 using tserver::WriteRequestPB;
@@ -314,6 +349,9 @@ class TabletBootstrap {
   // status.
   void StatusMessage(const string& status);
 
+  // Reports 'progress_' to the listener and to the tablet's metrics.
+  void ReportProgress(MonoTime replay_start);
+
   scoped_refptr<TabletMetadata> meta_;
   scoped_refptr<Clock> clock_;
   shared_ptr<MemTracker> mem_tracker_;
@@ -372,6 +410,9 @@ class TabletBootstrap {
   };
   Stats stats_;
 
+  // Progress of the replay of the log.
+  TabletBootstrapProgress progress_;
+
   // Snapshot of which stores were flushed prior to restart.
   FlushedStoresSnapshot flushed_stores_;
 
@@ -384,6 +425,22 @@ void TabletBootstrap::StatusMessage(const string& status) {
   if (listener_) listener_->StatusMessage(status);
 }
 
+void TabletBootstrap::ReportProgress(MonoTime replay_start) {
+  progress_.ops_replayed = stats_.ops_read;
+  progress_.elapsed_us = (MonoTime::Now() - replay_start).ToMicroseconds();
+  if (listener_) listener_->BootstrapProgressUpdate(progress_);
+
+  const scoped_refptr<MetricEntity>& entity = tablet_->GetMetricEntity();
+  if (entity) {
+    METRIC_log_replay_bytes.Instantiate(entity, 0)->set_value(progress_.bytes_replayed);
+    METRIC_log_replay_ops.Instantiate(entity, 0)->set_value(progress_.ops_replayed);
+    METRIC_log_replay_duration.Instantiate(entity, 0)->set_value(progress_.elapsed_us);
+    METRIC_log_replay_read_time.Instantiate(entity, 0)->set_value(progress_.read_us);
+    METRIC_log_replay_read_wait_time.Instantiate(entity, 0)->set_value(progress_.read_wait_us);
+    METRIC_log_replay_apply_time.Instantiate(entity, 0)->set_value(progress_.apply_us);
+  }
+}
+
 Status BootstrapTablet(const scoped_refptr<TabletMetadata>& meta,
                        const scoped_refptr<Clock>& clock,
                        const shared_ptr<MemTracker>& mem_tracker,
@@ -1021,6 +1078,47 @@ void TabletBootstrap::DumpReplayStateToLog(const ReplayState& state) {
   }
 }
 
+namespace {
+
+// The entries of a log segment, read and decoded ahead of their replay.
+struct ReadSegment {
+  ReadSegment() : read_up_to_offset(0), read_us(0), done(1) {}
+
+  vector<unique_ptr<LogEntryPB>> entries;
+
+  // The error which stopped the reading of the segment after 'entries', or
+  // EndOfFile if the segment was read to its end.
+  Status status;
+
+  // The offset the segment was read up to.
+  int64_t read_up_to_offset;
+
+  // Time spent reading the entries.
+  int64_t read_us;
+
+  // Counted down once the entries have been read.
+  CountDownLatch done;
+};
+
+void ReadSegmentEntries(ReadableLogSegment* segment, ReadSegment* read) {
+  MonoTime start = MonoTime::Now();
+  log::LogEntryReader reader(segment);
+  while (true) {
+    unique_ptr<LogEntryPB> entry(new LogEntryPB);
+    Status s = reader.ReadNextEntry(entry.get());
+    if (PREDICT_FALSE(!s.ok())) {
+      read->status = s;
+      break;
+    }
+    read->entries.emplace_back(std::move(entry));
+  }
+  read->read_up_to_offset = reader.read_up_to_offset();
+  read->read_us = (MonoTime::Now() - start).ToMicroseconds();
+  read->done.CountDown();
+}
+
+} // anonymous namespace
+
 Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   ReplayState state;
   log::SegmentSequence segments;
@@ -1048,30 +1146,64 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
   auto last_status_update = MonoTime::Now();
   const auto kStatusUpdateInterval = MonoDelta::FromSeconds(5);
   int segment_count = 0;
-
+  const MonoTime replay_start = last_status_update;
+  progress_.num_segments = segments.size();
   for (const scoped_refptr<ReadableLogSegment>& segment : segments) {
-    log::LogEntryReader reader(segment.get());
+    progress_.bytes_to_replay += segment->file_size();
+  }
+  ReportProgress(replay_start);
+
+  // Segments are read and decoded by the threads of 'read_pool' while the
+  // earlier ones are replayed; the replay itself stays serial, in log order.
+  // 'read_pool' is declared after 'reads' so that its in-flight reads are
+  // done before 'reads' is destroyed.
+  vector<unique_ptr<ReadSegment>> reads(segments.size());
+  gscoped_ptr<ThreadPool> read_pool;
+  const size_t readahead = std::max(FLAGS_tablet_bootstrap_log_readahead_segments, 0);
+  if (readahead > 0) {
+    RETURN_NOT_OK(ThreadPoolBuilder("log-replay-read")
+                  .set_max_threads(readahead)
+                  .Build(&read_pool));
+  }
+  auto start_read = [&](size_t idx) {
+    reads[idx].reset(new ReadSegment);
+    ReadableLogSegment* segment = segments[idx].get();
+    ReadSegment* read = reads[idx].get();
+    Status s = read_pool->SubmitFunc([segment, read]() { ReadSegmentEntries(segment, read); });
+    if (PREDICT_FALSE(!s.ok())) {
+      // The segment is read when it's replayed instead.
+      reads[idx].reset();
+    }
+  };
+  for (size_t i = 0; i < segments.size() && i < readahead; i++) {
+    start_read(i);
+  }
 
-    int entry_count = 0;
-    while (true) {
-      unique_ptr<LogEntryPB> entry(new LogEntryPB);
+  for (size_t seg_idx = 0; seg_idx < segments.size(); seg_idx++) {
+    const scoped_refptr<ReadableLogSegment>& segment = segments[seg_idx];
+    unique_ptr<ReadSegment> read(std::move(reads[seg_idx]));
+    MonoTime wait_start = MonoTime::Now();
+    if (read) {
+      read->done.Wait();
+    } else {
+      read.reset(new ReadSegment);
+      ReadSegmentEntries(segment.get(), read.get());
+    }
+    progress_.read_wait_us += (MonoTime::Now() - wait_start).ToMicroseconds();
+    progress_.read_us += read->read_us;
+    const int64_t bytes_replayed_before = progress_.bytes_replayed;
+    if (readahead > 0 && seg_idx + readahead < segments.size()) {
+      start_read(seg_idx + readahead);
+    }
 
-      Status s = reader.ReadNextEntry(entry.get());
-      if (PREDICT_FALSE(!s.ok())) {
-        if (s.IsEndOfFile()) {
-          break;
-        }
-        return Status::Corruption(Substitute("Error reading Log Segment of tablet $0: $1 "
-                                             "(Read up to entry $2 of segment $3, in path $4)",
-                                             tablet_->tablet_id(),
-                                             s.ToString(),
-                                             entry_count,
-                                             segment->header().sequence_number(),
-                                             segment->path()));
-      }
+    int entry_count = 0;
+    for (unique_ptr<LogEntryPB>& entry : read->entries) {
       entry_count++;
 
-      s = HandleEntry(&state, entry.get());
+      MonoTime apply_start = MonoTime::Now();
+      Status s = HandleEntry(&state, entry.get());
+      auto now = MonoTime::Now();
+      progress_.apply_us += (now - apply_start).ToMicroseconds();
       if (!s.ok()) {
         DumpReplayStateToLog(state);
         RETURN_NOT_OK_PREPEND(s, DebugInfo(tablet_->tablet_id(),
@@ -1083,25 +1215,44 @@ Status TabletBootstrap::PlaySegments(ConsensusBootstrapInfo* consensus_info) {
       // If HandleEntry returns OK, then it has taken ownership of the entry.
       entry.release();
 
-      auto now = MonoTime::Now();
       if (now - last_status_update > kStatusUpdateInterval) {
+        // The entries don't record their offsets: the bytes replayed within
+        // the segment are estimated by the entries replayed.
+        progress_.bytes_replayed = bytes_replayed_before +
+            read->read_up_to_offset * entry_count / read->entries.size();
+        ReportProgress(replay_start);
         StatusMessage(Substitute("Bootstrap replaying log segment $0/$1 "
-                                 "($2/$3 this segment, stats: $4)",
+                                 "($2/$3 entries of $4 this segment, stats: $5)",
                                  segment_count + 1, log_reader_->num_segments(),
-                                 HumanReadableNumBytes::ToString(reader.offset()),
-                                 HumanReadableNumBytes::ToString(reader.read_up_to_offset()),
+                                 entry_count, read->entries.size(),
+                                 HumanReadableNumBytes::ToString(read->read_up_to_offset),
                                  stats_.ToString()));
         last_status_update = now;
       }
     }
+    if (PREDICT_FALSE(!read->status.IsEndOfFile())) {
+      return Status::Corruption(Substitute("Error reading Log Segment of tablet $0: $1 "
+                                           "(Read up to entry $2 of segment $3, in path $4)",
+                                           tablet_->tablet_id(),
+                                           read->status.ToString(),
+                                           entry_count,
+                                           segment->header().sequence_number(),
+                                           segment->path()));
+    }
 
+    progress_.bytes_replayed = bytes_replayed_before + read->read_up_to_offset;
+    progress_.segments_replayed = seg_idx + 1;
+    ReportProgress(replay_start);
     StatusMessage(Substitute("Bootstrap replayed $0/$1 log segments. "
-                             "Stats: $2. Pending: $3 replicates",
+                             "Stats: $2. Pending: $3 replicates. Progress: $4",
                              segment_count + 1, log_reader_->num_segments(),
                              stats_.ToString(),
-                             state.pending_replicates.size()));
+                             state.pending_replicates.size(),
+                             progress_.ToString()));
     segment_count++;
   }
+  progress_.done = true;
+  ReportProgress(replay_start);
 
   // If we have non-applied commits they all must belong to pending operations and
   // they should only pertain to stores which are still active.
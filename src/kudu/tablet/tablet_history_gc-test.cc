@@ -26,6 +26,7 @@
 #include "kudu/tablet/tablet-test-base.h"
 
 DECLARE_bool(enable_maintenance_manager);
+DECLARE_double(tablet_delta_store_major_compact_deltas_only_max_update_ratio);
 DECLARE_int32(tablet_history_max_age_sec);
 DECLARE_bool(use_mock_wall_clock);
 
@@ -201,6 +202,49 @@ TEST_F(TabletHistoryGcTest, TestMajorDeltaCompactionOnSubsetOfColumns) {
   ASSERT_EQ(TotalNumRows(), rows.size());
 }
 
+// Test that a major delta compaction of a rowset in which only a few rows were
+// updated, long enough ago, leaves the base data alone and merges the REDO
+// update chain of each of those rows into a single update.
+TEST_F(TabletHistoryGcTest, TestMajorDeltaCompactionOfDeltasOnly) {
+  FLAGS_tablet_history_max_age_sec = 100;
+  FLAGS_tablet_delta_store_major_compact_deltas_only_max_update_ratio = 0.5;
+
+  num_rowsets_ = 1;
+  const int kNumUpdatedRows = 10;
+
+  NO_FATALS(InsertOriginalRows(num_rowsets_, rows_per_rowset_));
+
+  LocalTabletWriter writer(tablet().get(), &client_schema_);
+  for (int val = 1; val <= 2; val++) {
+    for (int row_idx = 0; row_idx < kNumUpdatedRows; row_idx++) {
+      ASSERT_OK(UpdateTestRow(&writer, row_idx, val));
+    }
+    tablet()->FlushBiggestDMS();
+  }
+
+  NO_FATALS(AddTimeToHybridClock(MonoDelta::FromSeconds(200)));
+
+  vector<std::shared_ptr<RowSet>> rowsets;
+  tablet()->GetRowSetsForTests(&rowsets);
+  DiskRowSet* drs = down_cast<DiskRowSet*>(rowsets[0].get());
+  ColumnId val_col_id = schema_.column_id(2);
+  BlockId val_block = drs->metadata()->column_data_block_for_col_id(val_col_id);
+  ASSERT_EQ(2, drs->metadata()->redo_delta_blocks().size());
+
+  ASSERT_OK(drs->MajorCompactDeltaStores(tablet()->GetHistoryGcOpts()));
+
+  // The base data was not rewritten, but the two REDO delta files were merged
+  // into one holding a single update per updated row.
+  ASSERT_EQ(val_block, drs->metadata()->column_data_block_for_col_id(val_col_id));
+  ASSERT_EQ(1, drs->metadata()->redo_delta_blocks().size());
+  ASSERT_DEBUG_DUMP_ROWS_MATCH(R"(int32 val=0\); Undo Mutations: \[@[[:digit:]]+\(DELETE\)\]; )"
+                               R"(Redo Mutations: \[(@[[:digit:]]+\(SET val=2\))?\];$)");
+  TestRowVerifier verifier = [&](int32_t key, int32_t val) {
+    return val == (key < kNumUpdatedRows ? 2 : 0);
+  };
+  NO_FATALS(VerifyTestRowsWithVerifier(kStartRow, TotalNumRows(), verifier));
+}
+
 // Tests the following two MRS flush scenarios:
 // 1. Verify that no UNDO is generated after inserting a row into the MRS,
 //    waiting for the AHM to pass, then flushing the MRS.
@@ -551,13 +595,13 @@ TEST_F(TabletHistoryGcNoMaintMgrTest, TestUndoDeltaBlockGc) {
   const int expected_undo_blocks = (kNumMutationsPerRow + 1) * num_rowsets_;
   ASSERT_EQ(expected_undo_blocks, tablet()->CountUndoDeltasForTests());
 
-  // There will be uninitialized undos so we will estimate that there may be
-  // undos to GC.
+  // The undos are uninitialized, but their max timestamps were recorded in
+  // the rowset metadata when they were written, so the estimate is exact.
   int64_t bytes;
   ASSERT_OK(tablet()->EstimateBytesInPotentiallyAncientUndoDeltas(&bytes));
-  ASSERT_GT(bytes, 0);
+  ASSERT_EQ(0, bytes);
 
-  // Now initialize the undos. Our estimates should be back to 0.
+  // Initializing the undos therefore finds nothing to GC either.
   int64_t bytes_in_ancient_undos = 0;
   const MonoDelta kNoTimeLimit = MonoDelta();
   ASSERT_OK(tablet()->InitAncientUndoDeltas(kNoTimeLimit, &bytes_in_ancient_undos));
@@ -19,6 +19,8 @@
 #include <memory>
 #include <string>
 
+#include "kudu/cfile/block_cache.h"
+#include "kudu/gutil/ref_counted.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/mem_tracker.h"
 
@@ -46,6 +48,11 @@ struct TabletMemTrackers {
 
   // All of the below are children of tablet_tracker;
   std::shared_ptr<MemTracker> dms_tracker;
+
+  // Not a memory tracker, but threaded to the tablet's readers along with
+  // them: accounts for the tablet's blocks in the block cache. Null if the
+  // tablet has no metrics.
+  scoped_refptr<cfile::BlockCacheAttribution> block_cache_attribution;
 };
 
 } // namespace tablet
@@ -15,7 +15,10 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <thread>
+#include <vector>
 
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol-test-util.h"
@@ -25,6 +28,9 @@
 #include "kudu/tablet/tablet-test-util.h"
 #include "kudu/util/pb_util.h"
 
+DECLARE_bool(enable_tablet_orphaned_block_deletion);
+DECLARE_int32(tablet_num_hot_projections);
+
 namespace kudu {
 namespace tablet {
 
@@ -94,6 +100,68 @@ TEST_F(TestTabletMetadata, TestLoadFromSuperBlock) {
             << SecureDebugString(superblock_pb_1);
 }
 
+// Test that the projections scanned most frequently are recorded in the
+// superblock by flushes.
+TEST_F(TestTabletMetadata, TestHotProjections) {
+  FLAGS_tablet_num_hot_projections = 1;
+  Tablet* tablet = harness_->tablet().get();
+  gscoped_ptr<KuduPartialRow> row;
+  BuildPartialRow(0, 0, "foo", &row);
+  writer_->Insert(*row);
+
+  Schema key_projection = client_schema_.CreateKeyProjection();
+  for (int i = 0; i < 3; i++) {
+    const Schema& projection = i == 0 ? key_projection : client_schema_;
+    gscoped_ptr<RowwiseIterator> iter;
+    ASSERT_OK(tablet->NewRowIterator(projection, &iter));
+    ASSERT_OK(iter->Init(nullptr));
+  }
+  ASSERT_OK(tablet->Flush());
+
+  TabletSuperBlockPB superblock;
+  ASSERT_OK(tablet->metadata()->ReadSuperBlockFromDisk(&superblock));
+  ASSERT_EQ(1, superblock.hot_projections_size());
+  const ProjectionPB& hot = superblock.hot_projections(0);
+  ASSERT_EQ(1, hot.num_key_columns());
+  ASSERT_EQ(static_cast<int>(tablet->schema()->num_columns()), hot.column_ids_size());
+  for (int i = 0; i < hot.column_ids_size(); i++) {
+    ASSERT_EQ(static_cast<int32_t>(tablet->schema()->column_id(i)), hot.column_ids(i));
+  }
+
+  // Without further scans, the next flush keeps them.
+  BuildPartialRow(1, 1, "bar", &row);
+  writer_->Insert(*row);
+  ASSERT_OK(tablet->Flush());
+  ASSERT_OK(tablet->metadata()->ReadSuperBlockFromDisk(&superblock));
+  ASSERT_EQ(1, superblock.hot_projections_size());
+}
+
+// Test that concurrent flushes, which may be group-committed, all persist the
+// updates made before them.
+TEST_F(TestTabletMetadata, TestConcurrentFlushes) {
+  // Keep the orphaned blocks in the superblock so they record the updates.
+  FLAGS_enable_tablet_orphaned_block_deletion = false;
+  TabletMetadata* meta = harness_->tablet()->metadata();
+
+  const int kNumThreads = 8;
+  const int kNumFlushesPerThread = 20;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumFlushesPerThread; i++) {
+        meta->AddOrphanedBlocks({ BlockId(t * kNumFlushesPerThread + i + 1) });
+        CHECK_OK(meta->Flush());
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  TabletSuperBlockPB superblock;
+  ASSERT_OK(meta->ReadSuperBlockFromDisk(&superblock));
+  ASSERT_EQ(kNumThreads * kNumFlushesPerThread, superblock.orphaned_blocks_size());
+}
 
 } // namespace tablet
 } // namespace kudu
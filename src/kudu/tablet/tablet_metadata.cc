@@ -164,12 +164,23 @@ Status TabletMetadata::DeleteTabletData(TabletDataState delete_type,
   //
   // We also set the state in our persisted metadata to indicate that
   // we have been deleted.
+  //
+  // The blocks of the tablet copy checkpoint are kept unless the tablet is
+  // being deleted for good, since the next copy of the tablet may reuse them.
   {
     std::lock_guard<LockType> l(data_lock_);
     for (const shared_ptr<RowSetMetadata>& rsmd : rowsets_) {
       AddOrphanedBlocksUnlocked(rsmd->GetAllBlocks());
     }
     rowsets_.clear();
+    if (delete_type == TABLET_DATA_DELETED) {
+      vector<BlockId> checkpoint_blocks;
+      for (const CopiedBlockPB& block : copy_checkpoint_.blocks()) {
+        checkpoint_blocks.push_back(BlockId::FromPB(block.local_block_id()));
+      }
+      AddOrphanedBlocksUnlocked(checkpoint_blocks);
+      copy_checkpoint_.Clear();
+    }
     tablet_data_state_ = delete_type;
     if (last_logged_opid) {
       tombstone_last_logged_opid_ = *last_logged_opid;
@@ -237,6 +248,8 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id,
       tombstone_last_logged_opid_(MinimumOpId()),
       num_flush_pins_(0),
       needs_flush_(false),
+      last_flush_request_seqno_(0),
+      last_flushed_seqno_(0),
       pre_flush_callback_(Bind(DoNothingStatusClosure)) {
   CHECK(schema_->has_column_ids());
   CHECK_GT(schema_->num_key_columns(), 0);
@@ -256,6 +269,8 @@ TabletMetadata::TabletMetadata(FsManager* fs_manager, string tablet_id)
       tombstone_last_logged_opid_(MinimumOpId()),
       num_flush_pins_(0),
       needs_flush_(false),
+      last_flush_request_seqno_(0),
+      last_flushed_seqno_(0),
       pre_flush_callback_(Bind(DoNothingStatusClosure)) {}
 
 Status TabletMetadata::LoadFromDisk() {
@@ -349,6 +364,15 @@ Status TabletMetadata::LoadFromSuperBlock(const TabletSuperBlockPB& superblock)
     } else {
       tombstone_last_logged_opid_ = MinimumOpId();
     }
+
+    hot_projections_.assign(superblock.hot_projections().begin(),
+                            superblock.hot_projections().end());
+
+    if (superblock.has_copy_checkpoint()) {
+      copy_checkpoint_ = superblock.copy_checkpoint();
+    } else {
+      copy_checkpoint_.Clear();
+    }
   }
 
   // Now is a good time to clean up any orphaned blocks that may have been
@@ -433,11 +457,25 @@ Status TabletMetadata::Flush() {
   TRACE_EVENT1("tablet", "TabletMetadata::Flush",
                "tablet_id", tablet_id_);
 
+  // Flushes are group-committed: the callers which queue up on 'flush_lock_'
+  // while a superblock is written are all covered by the next one to get
+  // the lock, which snapshots the metadata after all their updates.
+  int64_t request_seqno;
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    request_seqno = ++last_flush_request_seqno_;
+  }
+
   MutexLock l_flush(flush_lock_);
   vector<BlockId> orphaned;
   TabletSuperBlockPB pb;
+  int64_t snapshot_seqno;
   {
     std::lock_guard<LockType> l(data_lock_);
+    if (last_flushed_seqno_ >= request_seqno) {
+      TRACE("Metadata flushed by a concurrent flush");
+      return Status::OK();
+    }
     CHECK_GE(num_flush_pins_, 0);
     if (num_flush_pins_ > 0) {
       needs_flush_ = true;
@@ -445,6 +483,7 @@ Status TabletMetadata::Flush() {
       return Status::OK();
     }
     needs_flush_ = false;
+    snapshot_seqno = last_flush_request_seqno_;
 
     RETURN_NOT_OK(ToSuperBlockUnlocked(&pb, rowsets_));
 
@@ -458,6 +497,10 @@ Status TabletMetadata::Flush() {
   }
   pre_flush_callback_.Run();
   RETURN_NOT_OK(ReplaceSuperBlockUnlocked(pb));
+  {
+    std::lock_guard<LockType> l(data_lock_);
+    last_flushed_seqno_ = snapshot_seqno;
+  }
   TRACE("Metadata flushed");
   l_flush.Unlock();
 
@@ -569,6 +612,14 @@ Status TabletMetadata::ToSuperBlockUnlocked(TabletSuperBlockPB* super_block,
     block_id.CopyToPB(pb.mutable_orphaned_blocks()->Add());
   }
 
+  for (const ProjectionPB& projection : hot_projections_) {
+    *pb.add_hot_projections() = projection;
+  }
+
+  if (copy_checkpoint_.has_source_uuid()) {
+    *pb.mutable_copy_checkpoint() = copy_checkpoint_;
+  }
+
   super_block->Swap(&pb);
   return Status::OK();
 }
@@ -626,6 +677,21 @@ void TabletMetadata::SetTableName(const string& table_name) {
   table_name_ = table_name;
 }
 
+void TabletMetadata::SetHotProjections(vector<ProjectionPB> projections) {
+  std::lock_guard<LockType> l(data_lock_);
+  hot_projections_ = std::move(projections);
+}
+
+vector<ProjectionPB> TabletMetadata::hot_projections() const {
+  std::lock_guard<LockType> l(data_lock_);
+  return hot_projections_;
+}
+
+TabletCopyCheckpointPB TabletMetadata::copy_checkpoint() const {
+  std::lock_guard<LockType> l(data_lock_);
+  return copy_checkpoint_;
+}
+
 string TabletMetadata::table_name() const {
   std::lock_guard<LockType> l(data_lock_);
   DCHECK_NE(state_, kNotLoadedYet);
@@ -118,6 +118,18 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
 
   void SetTableName(const std::string& table_name);
 
+  // Sets the projections most frequently scanned (see
+  // TabletSuperBlockPB::hot_projections). They're persisted by the next call
+  // to Flush().
+  void SetHotProjections(std::vector<ProjectionPB> projections);
+
+  std::vector<ProjectionPB> hot_projections() const;
+
+  // Returns the blocks kept from an interrupted tablet copy (see
+  // TabletSuperBlockPB::copy_checkpoint). The checkpoint is set by replacing
+  // the superblock, and survives tombstoning the tablet.
+  TabletCopyCheckpointPB copy_checkpoint() const;
+
   // Return a reference to the current schema.
   // This pointer will be valid until the TabletMetadata is destructed,
   // even if the schema is changed.
@@ -147,6 +159,9 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // this method.
   Status UnPinFlush();
 
+  // Writes the superblock to disk. Concurrent calls are group-committed:
+  // a call may return without writing anything once a superblock which
+  // holds all the updates made before it has been written.
   Status Flush();
 
   // Updates the metadata in the following ways:
@@ -337,6 +352,13 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // tombstoned. Has no meaning for non-tombstoned tablets.
   consensus::OpId tombstone_last_logged_opid_;
 
+  // Protected by 'data_lock_'.
+  std::vector<ProjectionPB> hot_projections_;
+
+  // Protected by 'data_lock_'. Unset (without a source uuid) if there is no
+  // checkpoint.
+  TabletCopyCheckpointPB copy_checkpoint_;
+
   // If this counter is > 0 then Flush() will not write any data to
   // disk.
   int32_t num_flush_pins_;
@@ -346,6 +368,13 @@ class TabletMetadata : public RefCountedThreadSafe<TabletMetadata> {
   // metadata is persisted.
   bool needs_flush_;
 
+  // The sequence number of the last call to Flush(), and that of the last
+  // call whose updates are known to be on disk. A call to Flush() returns
+  // without writing anything if a concurrent one already covered it.
+  // Protected by 'data_lock_'.
+  int64_t last_flush_request_seqno_;
+  int64_t last_flushed_seqno_;
+
   // A callback that, if set, is called before this metadata is flushed
   // to disk.
   StatusClosure pre_flush_callback_;
@@ -38,6 +38,10 @@ METRIC_DEFINE_counter(tablet, rows_updated, "Rows Updated",
 METRIC_DEFINE_counter(tablet, rows_deleted, "Rows Deleted",
     kudu::MetricUnit::kRows,
     "Number of row delete operations performed on this tablet since service start");
+METRIC_DEFINE_counter(tablet, rows_bulk_ingested, "Rows Bulk Ingested",
+    kudu::MetricUnit::kRows,
+    "Number of rows written directly to DiskRowSets by bulk ingest into this "
+    "tablet since service start");
 
 METRIC_DEFINE_counter(tablet, scanner_rows_returned, "Scanner Rows Returned",
                       kudu::MetricUnit::kRows,
@@ -118,6 +122,13 @@ METRIC_DEFINE_counter(tablet, undo_delta_block_gc_bytes_deleted,
                       "on this tablet since this server was restarted. "
                       "Does not include bytes garbage collected during compactions.");
 
+METRIC_DEFINE_counter(tablet, expired_rowset_gc_bytes_deleted,
+                      "Expired RowSet GC Bytes Deleted",
+                      kudu::MetricUnit::kBytes,
+                      "Number of bytes deleted by dropping the rowsets whose rows were all "
+                      "expired by the TTL column of this tablet since this server was restarted. "
+                      "Does not include expired rows dropped during compactions.");
+
 METRIC_DEFINE_histogram(tablet, bloom_lookups_per_op, "Bloom Lookups per Operation",
                         kudu::MetricUnit::kProbes,
                         "Tracks the number of bloom filter lookups performed by each "
@@ -194,6 +205,16 @@ METRIC_DEFINE_gauge_uint32(tablet, undo_delta_block_gc_running,
   kudu::MetricUnit::kMaintenanceOperations,
   "Number of UNDO delta block GC operations currently running.");
 
+METRIC_DEFINE_gauge_uint32(tablet, cold_rowset_migration_running,
+  "Cold RowSet Migrations Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of migrations of idle RowSets to the slow storage tier currently running.");
+
+METRIC_DEFINE_gauge_uint32(tablet, expired_rowset_gc_running,
+  "Expired RowSet GC Running",
+  kudu::MetricUnit::kMaintenanceOperations,
+  "Number of expired RowSet GC operations currently running.");
+
 METRIC_DEFINE_gauge_int64(tablet, undo_delta_block_estimated_retained_bytes,
   "Estimated Deletable Bytes Retained in Undo Delta Blocks",
   kudu::MetricUnit::kBytes,
@@ -240,6 +261,16 @@ METRIC_DEFINE_histogram(tablet, undo_delta_block_gc_perform_duration,
   kudu::MetricUnit::kMilliseconds,
   "Time spent running the maintenance operation to GC ancient UNDO delta blocks.", 60000LU, 1);
 
+METRIC_DEFINE_histogram(tablet, cold_rowset_migration_duration,
+  "Cold RowSet Migration Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent migrating idle RowSets to the slow storage tier.", 60000LU, 1);
+
+METRIC_DEFINE_histogram(tablet, expired_rowset_gc_duration,
+  "Expired RowSet GC Duration",
+  kudu::MetricUnit::kMilliseconds,
+  "Time spent dropping the RowSets whose rows are all expired.", 60000LU, 1);
+
 METRIC_DEFINE_counter(tablet, leader_memory_pressure_rejections,
   "Leader Memory Pressure Rejections",
   kudu::MetricUnit::kRequests,
@@ -259,6 +290,7 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(rows_upserted),
     MINIT(rows_updated),
     MINIT(rows_deleted),
+    MINIT(rows_bulk_ingested),
     MINIT(insertions_failed_dup_key),
     MINIT(scanner_rows_returned),
     MINIT(scanner_cells_returned),
@@ -273,6 +305,7 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(mrs_lookups),
     MINIT(bytes_flushed),
     MINIT(undo_delta_block_gc_bytes_deleted),
+    MINIT(expired_rowset_gc_bytes_deleted),
     MINIT(bloom_lookups_per_op),
     MINIT(key_file_lookups_per_op),
     MINIT(delta_file_lookups_per_op),
@@ -286,6 +319,8 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     GINIT(delta_minor_compact_rs_running),
     GINIT(delta_major_compact_rs_running),
     GINIT(undo_delta_block_gc_running),
+    GINIT(cold_rowset_migration_running),
+    GINIT(expired_rowset_gc_running),
     GINIT(undo_delta_block_estimated_retained_bytes),
     MINIT(flush_dms_duration),
     MINIT(flush_mrs_duration),
@@ -295,6 +330,8 @@ TabletMetrics::TabletMetrics(const scoped_refptr<MetricEntity>& entity)
     MINIT(undo_delta_block_gc_init_duration),
     MINIT(undo_delta_block_gc_delete_duration),
     MINIT(undo_delta_block_gc_perform_duration),
+    MINIT(cold_rowset_migration_duration),
+    MINIT(expired_rowset_gc_duration),
     MINIT(leader_memory_pressure_rejections) {
 }
 #undef MINIT
@@ -50,6 +50,7 @@ struct TabletMetrics {
   scoped_refptr<Counter> rows_upserted;
   scoped_refptr<Counter> rows_updated;
   scoped_refptr<Counter> rows_deleted;
+  scoped_refptr<Counter> rows_bulk_ingested;
   scoped_refptr<Counter> insertions_failed_dup_key;
   scoped_refptr<Counter> scanner_rows_returned;
   scoped_refptr<Counter> scanner_cells_returned;
@@ -68,6 +69,7 @@ struct TabletMetrics {
   // Operation stats.
   scoped_refptr<Counter> bytes_flushed;
   scoped_refptr<Counter> undo_delta_block_gc_bytes_deleted;
+  scoped_refptr<Counter> expired_rowset_gc_bytes_deleted;
 
   scoped_refptr<Histogram> bloom_lookups_per_op;
   scoped_refptr<Histogram> key_file_lookups_per_op;
@@ -84,6 +86,8 @@ struct TabletMetrics {
   scoped_refptr<AtomicGauge<uint32_t> > delta_minor_compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > delta_major_compact_rs_running;
   scoped_refptr<AtomicGauge<uint32_t> > undo_delta_block_gc_running;
+  scoped_refptr<AtomicGauge<uint32_t> > cold_rowset_migration_running;
+  scoped_refptr<AtomicGauge<uint32_t> > expired_rowset_gc_running;
   scoped_refptr<AtomicGauge<int64_t> > undo_delta_block_estimated_retained_bytes;
 
   scoped_refptr<Histogram> flush_dms_duration;
@@ -94,6 +98,8 @@ struct TabletMetrics {
   scoped_refptr<Histogram> undo_delta_block_gc_init_duration;
   scoped_refptr<Histogram> undo_delta_block_gc_delete_duration;
   scoped_refptr<Histogram> undo_delta_block_gc_perform_duration;
+  scoped_refptr<Histogram> cold_rowset_migration_duration;
+  scoped_refptr<Histogram> expired_rowset_gc_duration;
 
   scoped_refptr<Counter> leader_memory_pressure_rejections;
 };
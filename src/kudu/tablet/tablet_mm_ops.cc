@@ -24,6 +24,7 @@
 #include "kudu/tablet/tablet.h"
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/io_rate_limiter.h"
 #include "kudu/util/locks.h"
 
 DEFINE_int32(undo_delta_block_gc_init_budget_millis, 1000,
@@ -98,6 +99,7 @@ bool CompactRowSetsOp::Prepare() {
 }
 
 void CompactRowSetsOp::Perform() {
+  ScopedBackgroundIo background_io;
   WARN_NOT_OK(tablet_->Compact(Tablet::COMPACT_NO_FLAGS),
               Substitute("$0Compaction failed on $1",
                          LogPrefix(), tablet_->tablet_id()));
@@ -111,6 +113,38 @@ scoped_refptr<AtomicGauge<uint32_t> > CompactRowSetsOp::RunningGauge() const {
   return tablet_->metrics()->compact_rs_running;
 }
 
+////////////////////////////////////////////////////////////
+// MigrateColdRowSetsOp
+////////////////////////////////////////////////////////////
+
+MigrateColdRowSetsOp::MigrateColdRowSetsOp(Tablet* tablet)
+  : TabletOpBase(Substitute("MigrateColdRowSetsOp($0)", tablet->tablet_id()),
+                 MaintenanceOp::HIGH_IO_USAGE, tablet) {
+}
+
+void MigrateColdRowSetsOp::UpdateStats(MaintenanceOpStats* stats) {
+  tablet_->UpdateColdMigrationStats(stats);
+}
+
+bool MigrateColdRowSetsOp::Prepare() {
+  return true;
+}
+
+void MigrateColdRowSetsOp::Perform() {
+  ScopedBackgroundIo background_io;
+  WARN_NOT_OK(tablet_->MigrateColdRowSet(),
+              Substitute("$0Cold rowset migration failed on $1",
+                         LogPrefix(), tablet_->tablet_id()));
+}
+
+scoped_refptr<Histogram> MigrateColdRowSetsOp::DurationHistogram() const {
+  return tablet_->metrics()->cold_rowset_migration_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t> > MigrateColdRowSetsOp::RunningGauge() const {
+  return tablet_->metrics()->cold_rowset_migration_running;
+}
+
 ////////////////////////////////////////////////////////////
 // MinorDeltaCompactionOp
 ////////////////////////////////////////////////////////////
@@ -169,6 +203,7 @@ bool MinorDeltaCompactionOp::Prepare() {
 }
 
 void MinorDeltaCompactionOp::Perform() {
+  ScopedBackgroundIo background_io;
   WARN_NOT_OK(tablet_->CompactWorstDeltas(RowSet::MINOR_DELTA_COMPACTION),
               Substitute("$0Minor delta compaction failed on $1",
                          LogPrefix(), tablet_->tablet_id()));
@@ -245,6 +280,7 @@ bool MajorDeltaCompactionOp::Prepare() {
 }
 
 void MajorDeltaCompactionOp::Perform() {
+  ScopedBackgroundIo background_io;
   WARN_NOT_OK(tablet_->CompactWorstDeltas(RowSet::MAJOR_DELTA_COMPACTION),
               Substitute("$0Major delta compaction failed on $1",
                          LogPrefix(), tablet_->tablet_id()));
@@ -308,5 +344,40 @@ std::string UndoDeltaBlockGCOp::LogPrefix() const {
   return tablet_->LogPrefix();
 }
 
+////////////////////////////////////////////////////////////
+// ExpiredRowSetGCOp
+////////////////////////////////////////////////////////////
+
+ExpiredRowSetGCOp::ExpiredRowSetGCOp(Tablet* tablet)
+  : TabletOpBase(Substitute("ExpiredRowSetGCOp($0)", tablet->tablet_id()),
+                 MaintenanceOp::LOW_IO_USAGE, tablet) {
+}
+
+void ExpiredRowSetGCOp::UpdateStats(MaintenanceOpStats* stats) {
+  int64_t expired_bytes = 0;
+  WARN_NOT_OK(tablet_->EstimateBytesInExpiredRowSets(&expired_bytes),
+              "Unable to count bytes in expired rowsets");
+  stats->set_data_retained_bytes(expired_bytes);
+  stats->set_runnable(expired_bytes > 0);
+}
+
+bool ExpiredRowSetGCOp::Prepare() {
+  // Nothing for us to do.
+  return true;
+}
+
+void ExpiredRowSetGCOp::Perform() {
+  WARN_NOT_OK(tablet_->DeleteExpiredRowSets(),
+              Substitute("$0GC of expired rowsets failed", LogPrefix()));
+}
+
+scoped_refptr<Histogram> ExpiredRowSetGCOp::DurationHistogram() const {
+  return tablet_->metrics()->expired_rowset_gc_duration;
+}
+
+scoped_refptr<AtomicGauge<uint32_t>> ExpiredRowSetGCOp::RunningGauge() const {
+  return tablet_->metrics()->expired_rowset_gc_running;
+}
+
 } // namespace tablet
 } // namespace kudu
@@ -125,6 +125,30 @@ class MajorDeltaCompactionOp : public TabletOpBase {
   uint64_t last_num_rs_major_delta_compacted_;
 };
 
+// MaintenanceOp to move idle rowsets to the slow storage tier.
+//
+// Rewrites the hot rowset which has been idle the longest, once it has gone
+// without access for --tablet_cold_rowset_idle_secs, into cold rowsets. It
+// reports a minimal performance improvement, so that it only runs when there
+// is no more useful maintenance to do.
+class MigrateColdRowSetsOp : public TabletOpBase {
+ public:
+  explicit MigrateColdRowSetsOp(Tablet* tablet);
+
+  void UpdateStats(MaintenanceOpStats* stats) override;
+
+  bool Prepare() override;
+
+  void Perform() override;
+
+  scoped_refptr<Histogram> DurationHistogram() const override;
+
+  scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const override;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MigrateColdRowSetsOp);
+};
+
 // MaintenanceOp to garbage-collect undo delta blocks that are older than the
 // ancient history mark.
 class UndoDeltaBlockGCOp : public TabletOpBase {
@@ -154,6 +178,27 @@ class UndoDeltaBlockGCOp : public TabletOpBase {
   DISALLOW_COPY_AND_ASSIGN(UndoDeltaBlockGCOp);
 };
 
+// MaintenanceOp to delete the rowsets whose rows are all expired by the TTL
+// column of the tablet, without rewriting them.
+class ExpiredRowSetGCOp : public TabletOpBase {
+ public:
+  explicit ExpiredRowSetGCOp(Tablet* tablet);
+
+  // Estimates the number of bytes in the rowsets whose rows are all expired.
+  void UpdateStats(MaintenanceOpStats* stats) override;
+
+  bool Prepare() override;
+
+  void Perform() override;
+
+  scoped_refptr<Histogram> DurationHistogram() const override;
+
+  scoped_refptr<AtomicGauge<uint32_t> > RunningGauge() const override;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ExpiredRowSetGCOp);
+};
+
 
 } // namespace tablet
 } // namespace kudu
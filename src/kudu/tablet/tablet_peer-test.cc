@@ -17,6 +17,7 @@
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
+#include <vector>
 
 #include "kudu/common/partial_row.h"
 #include "kudu/common/timestamp.h"
@@ -48,7 +49,10 @@
 
 METRIC_DECLARE_entity(tablet);
 
+DECLARE_int32(flush_max_unflushed_age_secs);
 DECLARE_int32(flush_threshold_mb);
+DECLARE_int32(tablet_write_coalescing_max_ops);
+DECLARE_int32(tablet_write_coalescing_window_us);
 
 namespace kudu {
 namespace tablet {
@@ -72,6 +76,7 @@ using server::LogicalClock;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 using tserver::WriteRequestPB;
 using tserver::WriteResponsePB;
@@ -522,6 +527,73 @@ TEST_F(TabletPeerTest, TestActiveTransactionPreventsLogGC) {
   ASSERT_EQ(2, segments.size());
 }
 
+// Test that writes submitted within the coalescing window are replicated as a
+// single operation, and that per-row errors are returned to the write which
+// caused them.
+TEST_F(TabletPeerTest, TestCoalescedWrites) {
+  ConsensusBootstrapInfo info;
+  ASSERT_OK(StartPeer(info));
+  // Make sure the leader's NO_OP is in the log before noting its last entry.
+  ASSERT_OK(ExecuteInsertsAndRollLogs(1));
+  OpId before;
+  tablet_peer_->log_->GetLatestEntryOpId(&before);
+
+  const int kNumWrites = 10;
+  const int kDuplicatingWrite = 5;
+  // Keep the window long enough for the batch to only be submitted once it
+  // holds all of the writes' rows (one each, plus a duplicate).
+  FLAGS_tablet_write_coalescing_window_us = 60 * 1000 * 1000;
+  FLAGS_tablet_write_coalescing_max_ops = kNumWrites + 1;
+
+  Schema schema(GetTestSchema());
+  vector<unique_ptr<WriteRequestPB>> reqs;
+  vector<unique_ptr<WriteResponsePB>> resps;
+  CountDownLatch latch(kNumWrites);
+  for (int i = 0; i < kNumWrites; i++) {
+    reqs.emplace_back(new WriteRequestPB());
+    resps.emplace_back(new WriteResponsePB());
+    WriteRequestPB* req = reqs.back().get();
+    int32_t first_key = insert_counter_;
+    ASSERT_OK(GenerateSequentialInsertRequest(req));
+    if (i == kDuplicatingWrite) {
+      // Insert the first key of this batch a second time.
+      KuduPartialRow row(&schema);
+      CHECK_OK(row.SetInt32("key", first_key - kDuplicatingWrite));
+      RowOperationsPBEncoder enc(req->mutable_row_operations());
+      enc.Add(RowOperationsPB::INSERT, row);
+    }
+    unique_ptr<WriteTransactionState> tx_state(new WriteTransactionState(tablet_peer_.get(),
+                                                                         req,
+                                                                         nullptr, // No RequestIdPB
+                                                                         resps.back().get()));
+    tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+        new LatchTransactionCompletionCallback<WriteResponsePB>(&latch, resps.back().get())));
+    ASSERT_OK(tablet_peer_->SubmitWrite(std::move(tx_state)));
+  }
+  latch.Wait();
+
+  for (int i = 0; i < kNumWrites; i++) {
+    const WriteResponsePB& resp = *resps[i];
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp);
+    if (i == kDuplicatingWrite) {
+      ASSERT_EQ(1, resp.per_row_errors_size()) << SecureDebugString(resp);
+      EXPECT_EQ(1, resp.per_row_errors(0).row_index());
+      EXPECT_EQ(AppStatusPB::ALREADY_PRESENT, resp.per_row_errors(0).error().code());
+    } else {
+      ASSERT_EQ(0, resp.per_row_errors_size()) << SecureDebugString(resp);
+    }
+  }
+
+  // All of the writes went into a single replicated operation.
+  ASSERT_OK(tablet_peer_->log_->WaitUntilAllFlushed());
+  OpId after;
+  tablet_peer_->log_->GetLatestEntryOpId(&after);
+  ASSERT_EQ(before.index() + 1, after.index());
+  uint64_t rows;
+  ASSERT_OK(tablet()->CountRows(&rows));
+  ASSERT_EQ(kNumWrites + 1, rows);
+}
+
 TEST_F(TabletPeerTest, TestGCEmptyLog) {
   ConsensusBootstrapInfo info;
   tablet_peer_->Start(info);
@@ -558,6 +630,23 @@ TEST_F(TabletPeerTest, TestFlushOpsPerfImprovements) {
   ASSERT_LT(0.7, stats.perf_improvement());
   ASSERT_GT(1.0, stats.perf_improvement());
   stats.Clear();
+
+  // Below the threshold but older than the maximum unflushed age: the
+  // improvement outranks any time-based flush, and grows with the age.
+  FLAGS_flush_max_unflushed_age_secs = 10 * 60;
+  stats.set_ram_anchored(1024);
+  FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(&stats, 5 * 60 * 1000);
+  ASSERT_GT(1.0, stats.perf_improvement());
+  stats.Clear();
+  stats.set_ram_anchored(1024);
+  FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(&stats, 11 * 60 * 1000);
+  ASSERT_LE(1.0, stats.perf_improvement());
+  double improvement = stats.perf_improvement();
+  stats.Clear();
+  stats.set_ram_anchored(1024);
+  FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(&stats, 30 * 60 * 1000);
+  ASSERT_LT(improvement, stats.perf_improvement());
+  stats.Clear();
 }
 
 } // namespace tablet
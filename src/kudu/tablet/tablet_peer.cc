@@ -43,6 +43,7 @@
 #include "kudu/rpc/service_pool.h"
 #include "kudu/tablet/transactions/transaction_driver.h"
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
+#include "kudu/tablet/transactions/write_coalescer.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_metrics.h"
@@ -133,7 +134,8 @@ Status TabletPeer::Init(const shared_ptr<Tablet>& tablet,
                         const shared_ptr<Messenger>& messenger,
                         const scoped_refptr<ResultTracker>& result_tracker,
                         const scoped_refptr<Log>& log,
-                        const scoped_refptr<MetricEntity>& metric_entity) {
+                        const scoped_refptr<MetricEntity>& metric_entity,
+                        consensus::MultiRaftManager* multi_raft_manager) {
 
   DCHECK(tablet) << "A TabletPeer must be provided with a Tablet";
   DCHECK(log) << "A TabletPeer must be provided with a Log";
@@ -154,6 +156,9 @@ Status TabletPeer::Init(const shared_ptr<Tablet>& tablet,
     messenger_ = messenger;
     log_ = log;
     result_tracker_ = result_tracker;
+    if (messenger_) {
+      write_coalescer_ = new WriteCoalescer(this, messenger_);
+    }
 
     ConsensusOptions options;
     options.tablet_id = meta_->tablet_id();
@@ -176,7 +181,8 @@ Status TabletPeer::Init(const shared_ptr<Tablet>& tablet,
                                        messenger_,
                                        log_.get(),
                                        tablet_->mem_tracker(),
-                                       mark_dirty_clbk_);
+                                       mark_dirty_clbk_,
+                                       multi_raft_manager);
   }
 
   if (tablet_->metrics() != nullptr) {
@@ -230,6 +236,10 @@ void TabletPeer::Shutdown() {
     state_ = QUIESCING;
   }
 
+  // Hand any writes held back by the coalescer to the transaction machinery,
+  // which now rejects them, so that they are responded to.
+  if (write_coalescer_) write_coalescer_->Shutdown();
+
   std::lock_guard<simple_spinlock> l(state_change_lock_);
   // Even though Tablet::Shutdown() also unregisters its ops, we have to do it here
   // to ensure that any currently running operation finishes before we proceed with
@@ -333,6 +343,15 @@ Status TabletPeer::WaitUntilConsensusRunning(const MonoDelta& timeout) {
 Status TabletPeer::SubmitWrite(unique_ptr<WriteTransactionState> state) {
   RETURN_NOT_OK(CheckRunning());
 
+  if (write_coalescer_ && write_coalescer_->TryAdd(&state)) {
+    return Status::OK();
+  }
+  return SubmitWriteUnbatched(std::move(state));
+}
+
+Status TabletPeer::SubmitWriteUnbatched(unique_ptr<WriteTransactionState> state) {
+  RETURN_NOT_OK(CheckRunning());
+
   state->SetResultTracker(result_tracker_);
   gscoped_ptr<WriteTransaction> transaction(new WriteTransaction(std::move(state),
                                                                  consensus::LEADER));
@@ -390,6 +409,43 @@ string TabletPeer::last_status() const {
   return last_status_;
 }
 
+void TabletPeer::BootstrapProgressUpdate(const TabletBootstrapProgress& progress) {
+  std::lock_guard<simple_spinlock> lock(lock_);
+  bootstrap_progress_ = progress;
+}
+
+TabletBootstrapProgress TabletPeer::bootstrap_progress() const {
+  std::lock_guard<simple_spinlock> lock(lock_);
+  return bootstrap_progress_;
+}
+
+double TabletBootstrapProgress::bytes_per_sec() const {
+  return elapsed_us > 0 ? bytes_replayed * 1e6 / elapsed_us : 0;
+}
+
+double TabletBootstrapProgress::ops_per_sec() const {
+  return elapsed_us > 0 ? ops_replayed * 1e6 / elapsed_us : 0;
+}
+
+double TabletBootstrapProgress::EstimatedSecondsLeft() const {
+  if (done) {
+    return 0;
+  }
+  double rate = bytes_per_sec();
+  if (rate <= 0) {
+    return -1;
+  }
+  return std::max<int64_t>(bytes_to_replay - bytes_replayed, 0) / rate;
+}
+
+string TabletBootstrapProgress::ToString() const {
+  return Substitute("segments=$0/$1 bytes=$2/$3 ops=$4 elapsed=$5s read=$6s "
+                    "read_wait=$7s apply=$8s",
+                    segments_replayed, num_segments, bytes_replayed, bytes_to_replay,
+                    ops_replayed, elapsed_us / 1e6, read_us / 1e6,
+                    read_wait_us / 1e6, apply_us / 1e6);
+}
+
 void TabletPeer::SetFailed(const Status& error) {
   std::lock_guard<simple_spinlock> lock(lock_);
   CHECK(!error.ok());
@@ -37,6 +37,10 @@
 
 namespace kudu {
 
+namespace consensus {
+class MultiRaftManager;
+}
+
 namespace log {
 class LogAnchorRegistry;
 }
@@ -60,6 +64,52 @@ class TabletPeer;
 class TabletStatusPB;
 class TabletStatusListener;
 class TransactionDriver;
+class WriteCoalescer;
+
+// The progress of the replay of the log by the bootstrap of a tablet.
+struct TabletBootstrapProgress {
+  TabletBootstrapProgress()
+      : num_segments(0),
+        segments_replayed(0),
+        bytes_to_replay(0),
+        bytes_replayed(0),
+        ops_replayed(0),
+        elapsed_us(0),
+        read_us(0),
+        read_wait_us(0),
+        apply_us(0),
+        done(false) {
+  }
+
+  // Replay throughput so far, in bytes and REPLICATE ops per second.
+  double bytes_per_sec() const;
+  double ops_per_sec() const;
+
+  // Time left to replay the rest of the log at the throughput so far, in
+  // seconds, or -1 if there's no throughput to go by yet.
+  double EstimatedSecondsLeft() const;
+
+  std::string ToString() const;
+
+  int num_segments;
+  int segments_replayed;
+  int64_t bytes_to_replay;
+  int64_t bytes_replayed;
+  int64_t ops_replayed;
+
+  // Wall time since the replay started.
+  int64_t elapsed_us;
+  // Time spent reading, decompressing and decoding the log entries. With
+  // log readahead, this happens in the background and overlaps the replay.
+  int64_t read_us;
+  // Time the replay spent waiting for the entries to be read.
+  int64_t read_wait_us;
+  // Time spent applying the entries to the tablet.
+  int64_t apply_us;
+
+  // Whether the replay is over.
+  bool done;
+};
 
 // Interface by which various tablet-related processes can report back their status
 // to TabletPeer without having to have a circular class dependency, and so that
@@ -69,6 +119,9 @@ class TabletStatusListener {
   virtual ~TabletStatusListener() {}
 
   virtual void StatusMessage(const std::string& status) = 0;
+
+  // Called periodically while the log is replayed by the bootstrap.
+  virtual void BootstrapProgressUpdate(const TabletBootstrapProgress& /* progress */) {}
 };
 
 // A peer in a tablet consensus configuration, which coordinates writes to tablets.
@@ -85,13 +138,16 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
              Callback<void(const std::string& reason)> mark_dirty_clbk);
 
   // Initializes the TabletPeer, namely creating the Log and initializing
-  // Consensus.
+  // Consensus. If 'multi_raft_manager' isn't null, the heartbeats of the
+  // replica, as a leader, are batched with those of the other replicas of the
+  // server; it must outlive the TabletPeer.
   Status Init(const std::shared_ptr<tablet::Tablet>& tablet,
               const scoped_refptr<server::Clock>& clock,
               const std::shared_ptr<rpc::Messenger>& messenger,
               const scoped_refptr<rpc::ResultTracker>& result_tracker,
               const scoped_refptr<log::Log>& log,
-              const scoped_refptr<MetricEntity>& metric_entity);
+              const scoped_refptr<MetricEntity>& metric_entity,
+              consensus::MultiRaftManager* multi_raft_manager = nullptr);
 
   // Starts the TabletPeer, making it available for Write()s. If this
   // TabletPeer is part of a consensus configuration this will connect it to other peers
@@ -113,6 +169,9 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // The caller is expected to build and pass a TrasactionContext that points
   // to the RPC WriteRequest, WriteResponse, RpcContext and to the tablet's
   // MvccManager.
+  //
+  // Writes may be held back for up to --tablet_write_coalescing_window_us and
+  // applied together with other writes; see WriteCoalescer.
   Status SubmitWrite(std::unique_ptr<WriteTransactionState> tx_state);
 
   // Called by the tablet service to start an alter schema transaction.
@@ -184,6 +243,14 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // Retrieve the last human-readable status of this tablet peer.
   std::string last_status() const;
 
+  // Implementation of TabletStatusListener::BootstrapProgressUpdate().
+  void BootstrapProgressUpdate(const TabletBootstrapProgress& progress) override;
+
+  // Returns the last progress reported by the bootstrap of the tablet, which
+  // is kept after the bootstrap is over. Zero if the tablet wasn't
+  // bootstrapped from a log.
+  TabletBootstrapProgress bootstrap_progress() const;
+
   // Sets the tablet state to FAILED additionally setting the error to the provided
   // one.
   void SetFailed(const Status& error);
@@ -271,12 +338,17 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
  private:
   friend class RefCountedThreadSafe<TabletPeer>;
   friend class TabletPeerTest;
+  friend class WriteCoalescer;
   FRIEND_TEST(TabletPeerTest, TestMRSAnchorPreventsLogGC);
   FRIEND_TEST(TabletPeerTest, TestDMSAnchorPreventsLogGC);
   FRIEND_TEST(TabletPeerTest, TestActiveTransactionPreventsLogGC);
+  FRIEND_TEST(TabletPeerTest, TestCoalescedWrites);
 
   ~TabletPeer();
 
+  // Submits a write as a transaction of its own, bypassing the coalescer.
+  Status SubmitWriteUnbatched(std::unique_ptr<WriteTransactionState> tx_state);
+
   // Wait until the TabletPeer is fully in SHUTDOWN state.
   void WaitUntilShutdown();
 
@@ -310,6 +382,9 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // tools, etc.
   std::string last_status_;
 
+  // The last progress reported by the replay of the log.
+  TabletBootstrapProgress bootstrap_progress_;
+
   // Lock taken during Init/Shutdown which ensures that only a single thread
   // attempts to perform major lifecycle operations (Init/Shutdown) at once.
   // This must be acquired before acquiring lock_ if they are acquired together.
@@ -347,6 +422,10 @@ class TabletPeer : public RefCountedThreadSafe<TabletPeer>,
   // The result tracker for writes.
   scoped_refptr<rpc::ResultTracker> result_tracker_;
 
+  // Batches up concurrent writes. Not set if there is no messenger to
+  // schedule the end of the coalescing window on.
+  scoped_refptr<WriteCoalescer> write_coalescer_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletPeer);
 };
 
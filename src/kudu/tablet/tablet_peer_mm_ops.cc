@@ -23,9 +23,11 @@
 #include <mutex>
 #include <string>
 
+#include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tablet/tablet_metrics.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/io_rate_limiter.h"
 #include "kudu/util/maintenance_manager.h"
 #include "kudu/util/metrics.h"
 
@@ -40,6 +42,15 @@ DEFINE_int32(flush_threshold_secs, 2 * 60,
              "even if it is not large.");
 TAG_FLAG(flush_threshold_secs, experimental);
 
+DEFINE_int32(flush_max_unflushed_age_secs, 0,
+             "Number of seconds after which a non-empty MemRowSet or DeltaMemStore is "
+             "flushed ahead of compactions and of the other time-based flushes, however "
+             "small it is. This bounds the amount of WAL which the in-memory stores of a "
+             "slowly written tablet anchor, and therefore the time spent replaying it at "
+             "startup. 0 means no bound.");
+TAG_FLAG(flush_max_unflushed_age_secs, experimental);
+TAG_FLAG(flush_max_unflushed_age_secs, runtime);
+
 
 METRIC_DEFINE_gauge_uint32(tablet, log_gc_running,
                            "Log GCs Running",
@@ -75,6 +86,13 @@ void FlushOpPerfImprovementPolicy::SetPerfImprovementForFlush(MaintenanceOpStats
     double extra_mb =
         static_cast<double>(FLAGS_flush_threshold_mb - (stats->ram_anchored()) / (1024 * 1024));
     stats->set_perf_improvement(extra_mb);
+  } else if (FLAGS_flush_max_unflushed_age_secs > 0 &&
+             elapsed_ms > FLAGS_flush_max_unflushed_age_secs * 1000.0) {
+    // The store has been anchoring the WAL for too long: score it above any
+    // time-based flush, growing with its age so that the oldest store goes
+    // first.
+    stats->set_perf_improvement(
+        std::max(1.0, elapsed_ms / (FLAGS_flush_max_unflushed_age_secs * 1000.0)));
   } else if (elapsed_ms > FLAGS_flush_threshold_secs * 1000) {
     // Even if we aren't over the threshold, consider flushing if we haven't flushed
     // in a long time. But, don't give it a large perf_improvement score. We should
@@ -126,6 +144,7 @@ bool FlushMRSOp::Prepare() {
 }
 
 void FlushMRSOp::Perform() {
+  ScopedBackgroundIo background_io;
   CHECK(!tablet_peer_->tablet()->rowsets_flush_sem_.try_lock());
 
   KUDU_CHECK_OK_PREPEND(tablet_peer_->tablet()->FlushUnlocked(),
@@ -172,6 +191,7 @@ void FlushDeltaMemStoresOp::UpdateStats(MaintenanceOpStats* stats) {
 }
 
 void FlushDeltaMemStoresOp::Perform() {
+  ScopedBackgroundIo background_io;
   map<int64_t, int64_t> max_idx_to_replay_size;
   if (!tablet_peer_->GetReplaySizeMap(&max_idx_to_replay_size).ok()) {
     LOG(WARNING) << "Won't flush deltas since tablet shutting down: " << tablet_peer_->tablet_id();
@@ -201,7 +221,8 @@ scoped_refptr<AtomicGauge<uint32_t> > FlushDeltaMemStoresOp::RunningGauge() cons
 
 LogGCOp::LogGCOp(TabletPeer* tablet_peer)
     : MaintenanceOp(StringPrintf("LogGCOp(%s)", tablet_peer->tablet()->tablet_id().c_str()),
-                    MaintenanceOp::LOW_IO_USAGE),
+                    MaintenanceOp::LOW_IO_USAGE, MaintenanceOp::WAL_RETENTION,
+                    tablet_peer->tablet()->metadata()->fs_manager()->GetWalsRootDir()),
       tablet_peer_(tablet_peer),
       log_gc_duration_(METRIC_log_gc_duration.Instantiate(
                            tablet_peer->tablet()->GetMetricEntity())),
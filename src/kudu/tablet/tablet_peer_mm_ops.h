@@ -35,7 +35,8 @@ class FlushOpPerfImprovementPolicy {
   ~FlushOpPerfImprovementPolicy() {}
 
   // Sets the performance improvement based on the anchored ram if it's over the threshold,
-  // else it will set it based on how long it has been since the last flush.
+  // else it will set it based on how long it has been since the last flush. Past
+  // --flush_max_unflushed_age_secs, the improvement is at least 1.0.
   static void SetPerfImprovementForFlush(MaintenanceOpStats* stats, double elapsed_ms);
 
  private:
@@ -47,7 +48,7 @@ class FlushMRSOp : public MaintenanceOp {
  public:
   explicit FlushMRSOp(TabletPeer* tablet_peer)
     : MaintenanceOp(StringPrintf("FlushMRSOp(%s)", tablet_peer->tablet()->tablet_id().c_str()),
-                    MaintenanceOp::HIGH_IO_USAGE),
+                    MaintenanceOp::HIGH_IO_USAGE, MaintenanceOp::MEMORY_RELIEF),
       tablet_peer_(tablet_peer) {
     time_since_flush_.start();
   }
@@ -77,7 +78,7 @@ class FlushDeltaMemStoresOp : public MaintenanceOp {
   explicit FlushDeltaMemStoresOp(TabletPeer* tablet_peer)
     : MaintenanceOp(StringPrintf("FlushDeltaMemStoresOp(%s)",
                                  tablet_peer->tablet()->tablet_id().c_str()),
-                    MaintenanceOp::HIGH_IO_USAGE),
+                    MaintenanceOp::HIGH_IO_USAGE, MaintenanceOp::MEMORY_RELIEF),
       tablet_peer_(tablet_peer) {
     time_since_flush_.start();
   }
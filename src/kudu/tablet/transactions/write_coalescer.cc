@@ -0,0 +1,312 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tablet/transactions/write_coalescer.h"
+
+#include <algorithm>
+#include <gflags/gflags.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "kudu/common/row_operations.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/rpc/messenger.h"
+#include "kudu/tablet/tablet_peer.h"
+#include "kudu/tablet/transactions/write_transaction.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/monotime.h"
+
+DEFINE_int32(tablet_write_coalescing_window_us, 0,
+             "How long, in microseconds, a tablet leader holds back an incoming "
+             "write so that writes arriving after it can be applied in the same "
+             "transaction. Only writes which don't use exactly-once semantics and "
+             "use CLIENT_PROPAGATED consistency are coalesced. 0 disables "
+             "coalescing.");
+TAG_FLAG(tablet_write_coalescing_window_us, experimental);
+TAG_FLAG(tablet_write_coalescing_window_us, runtime);
+
+DEFINE_int32(tablet_write_coalescing_max_ops, 5000,
+             "Maximum number of row operations in a batch of coalesced writes. "
+             "A batch reaching this size is submitted without waiting for the "
+             "rest of its coalescing window.");
+TAG_FLAG(tablet_write_coalescing_max_ops, experimental);
+TAG_FLAG(tablet_write_coalescing_max_ops, runtime);
+
+DEFINE_int32(tablet_write_coalescing_max_bytes, 4 * 1024 * 1024,
+             "Maximum size, in bytes of encoded row data, of a batch of coalesced "
+             "writes. A batch reaching this size is submitted without waiting for "
+             "the rest of its coalescing window.");
+TAG_FLAG(tablet_write_coalescing_max_bytes, experimental);
+TAG_FLAG(tablet_write_coalescing_max_bytes, runtime);
+
+using std::shared_ptr;
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+namespace kudu {
+namespace tablet {
+
+using tserver::TabletServerErrorPB;
+using tserver::WriteRequestPB;
+using tserver::WriteResponsePB;
+
+// A set of writes combined into a single request.
+class WriteCoalescer::Batch {
+ public:
+  explicit Batch(int64_t seq) : seq(seq), num_ops(0) {}
+
+  const int64_t seq;
+
+  // The client schema shared by all of the writes, serialized and decoded.
+  string schema_pb_str;
+  Schema schema;
+
+  // The combined request, and the response of the combined transaction.
+  WriteRequestPB request;
+  WriteResponsePB response;
+
+  // The constituent writes and, for each, the index of its first operation
+  // within 'request'.
+  vector<unique_ptr<WriteTransactionState>> writes;
+  vector<int> first_op_index;
+  int num_ops;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(Batch);
+};
+
+// Completion callback of a combined transaction, which completes each of the
+// writes it was made of.
+class WriteCoalescer::BatchCompletionCallback : public TransactionCompletionCallback {
+ public:
+  BatchCompletionCallback(scoped_refptr<WriteCoalescer> coalescer, shared_ptr<Batch> batch)
+      : coalescer_(std::move(coalescer)),
+        batch_(std::move(batch)) {
+  }
+
+  virtual void TransactionCompleted() OVERRIDE {
+    if (!status_.ok()) {
+      // Errors raised while preparing the batch (as opposed to e.g. losing
+      // leadership) may have been caused by any one of its writes; nothing was
+      // replicated, so retry them one by one to find out which.
+      if (code_ == TabletServerErrorPB::MISMATCHED_SCHEMA ||
+          code_ == TabletServerErrorPB::INVALID_SCHEMA) {
+        for (int i = 0; i < batch_->writes.size(); i++) {
+          coalescer_->SubmitAlone(batch_, i);
+        }
+        return;
+      }
+      for (const auto& write : batch_->writes) {
+        write->completion_callback()->set_error(status_, code_);
+        write->completion_callback()->TransactionCompleted();
+      }
+      return;
+    }
+
+    const WriteResponsePB& resp = batch_->response;
+    const vector<int>& first = batch_->first_op_index;
+    for (const auto& per_row_error : resp.per_row_errors()) {
+      // 'first' is sorted; find the last write starting at or before this row.
+      int idx = std::upper_bound(first.begin(), first.end(), per_row_error.row_index()) -
+          first.begin() - 1;
+      DCHECK_GE(idx, 0);
+      WriteResponsePB::PerRowErrorPB* error = batch_->writes[idx]->response()->add_per_row_errors();
+      error->set_row_index(per_row_error.row_index() - first[idx]);
+      error->mutable_error()->CopyFrom(per_row_error.error());
+    }
+    for (const auto& write : batch_->writes) {
+      if (resp.has_timestamp()) {
+        write->response()->set_timestamp(resp.timestamp());
+      }
+      write->completion_callback()->TransactionCompleted();
+    }
+  }
+
+ private:
+  const scoped_refptr<WriteCoalescer> coalescer_;
+  const shared_ptr<Batch> batch_;
+};
+
+// Completion callback of a transaction made of a single write of a batch,
+// which completes that write. Since a write's state can't be recovered from a
+// transaction which failed to be submitted, the write is resubmitted as a new
+// WriteTransactionState, while the original one is kept alive by the batch.
+class WriteCoalescer::SingleWriteCompletionCallback : public TransactionCompletionCallback {
+ public:
+  SingleWriteCompletionCallback(shared_ptr<Batch> batch, WriteTransactionState* write)
+      : batch_(std::move(batch)),
+        write_(write) {
+  }
+
+  virtual void TransactionCompleted() OVERRIDE {
+    if (!status_.ok()) {
+      write_->completion_callback()->set_error(status_, code_);
+    }
+    write_->completion_callback()->TransactionCompleted();
+  }
+
+ private:
+  const shared_ptr<Batch> batch_;
+  WriteTransactionState* const write_;
+};
+
+WriteCoalescer::WriteCoalescer(TabletPeer* tablet_peer, shared_ptr<rpc::Messenger> messenger)
+    : tablet_peer_(tablet_peer),
+      messenger_(std::move(messenger)),
+      next_seq_(0),
+      shutdown_(false) {
+}
+
+WriteCoalescer::~WriteCoalescer() {
+  DCHECK(!pending_);
+}
+
+bool WriteCoalescer::TryAdd(unique_ptr<WriteTransactionState>* tx_state) {
+  const int32_t window_us = FLAGS_tablet_write_coalescing_window_us;
+  if (window_us <= 0) return false;
+
+  const WriteTransactionState& state = **tx_state;
+  if (state.has_request_id() ||
+      state.external_consistency_mode() != CLIENT_PROPAGATED) {
+    return false;
+  }
+  const WriteRequestPB* req = state.request();
+  if (!req->has_schema() || req->row_operations().rows().empty()) return false;
+  string schema_pb_str = req->schema().SerializeAsString();
+
+  shared_ptr<Batch> to_submit;
+  bool schedule = false;
+  int64_t seq;
+  {
+    MutexLock l(lock_);
+    if (shutdown_) return false;
+
+    if (pending_ && pending_->schema_pb_str != schema_pb_str) {
+      to_submit = std::move(pending_);
+    }
+    if (!pending_) {
+      shared_ptr<Batch> batch(new Batch(next_seq_++));
+      if (!SchemaFromPB(req->schema(), &batch->schema).ok() ||
+          batch->schema.has_column_ids()) {
+        // Let the write fail on its own in Prepare().
+        l.Unlock();
+        if (to_submit) SubmitBatch(std::move(to_submit));
+        return false;
+      }
+      batch->schema_pb_str = std::move(schema_pb_str);
+      batch->request.set_tablet_id(req->tablet_id());
+      batch->request.mutable_schema()->CopyFrom(req->schema());
+      batch->request.set_external_consistency_mode(CLIENT_PROPAGATED);
+      pending_ = std::move(batch);
+    }
+
+    Batch* batch = pending_.get();
+    int num_ops;
+    if (!AppendRowOperations(batch->schema, req->row_operations(),
+                             batch->request.mutable_row_operations(), &num_ops).ok()) {
+      if (batch->writes.empty()) pending_.reset();
+      l.Unlock();
+      if (to_submit) SubmitBatch(std::move(to_submit));
+      return false;
+    }
+    batch->first_op_index.push_back(batch->num_ops);
+    batch->num_ops += num_ops;
+    batch->writes.emplace_back(std::move(*tx_state));
+
+    const RowOperationsPB& ops = batch->request.row_operations();
+    if (batch->num_ops >= FLAGS_tablet_write_coalescing_max_ops ||
+        ops.rows().size() + ops.indirect_data().size() >= FLAGS_tablet_write_coalescing_max_bytes) {
+      DCHECK(!to_submit);
+      to_submit = std::move(pending_);
+    } else if (batch->writes.size() == 1) {
+      schedule = true;
+      seq = batch->seq;
+    }
+  }
+
+  if (to_submit) SubmitBatch(std::move(to_submit));
+  if (schedule) {
+    scoped_refptr<WriteCoalescer> self(this);
+    messenger_->ScheduleOnReactor([self, seq](const Status& s) { self->FlushTask(seq, s); },
+                                  MonoDelta::FromMicroseconds(window_us));
+  }
+  return true;
+}
+
+void WriteCoalescer::Shutdown() {
+  shared_ptr<Batch> to_submit;
+  {
+    MutexLock l(lock_);
+    shutdown_ = true;
+    to_submit = std::move(pending_);
+  }
+  if (to_submit) SubmitBatch(std::move(to_submit));
+}
+
+void WriteCoalescer::FlushTask(int64_t seq, const Status& /* s */) {
+  // Submit the batch even if the reactor is shutting down, so that its
+  // writes get a response.
+  shared_ptr<Batch> to_submit;
+  {
+    MutexLock l(lock_);
+    if (pending_ && pending_->seq == seq) {
+      to_submit = std::move(pending_);
+    }
+  }
+  if (to_submit) SubmitBatch(std::move(to_submit));
+}
+
+void WriteCoalescer::SubmitBatch(shared_ptr<Batch> batch) {
+  DCHECK(!batch->writes.empty());
+  if (batch->writes.size() == 1) {
+    SubmitAlone(batch, 0);
+    return;
+  }
+
+  unique_ptr<WriteTransactionState> state(new WriteTransactionState(
+      tablet_peer_, &batch->request, nullptr, &batch->response));
+  state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+      new BatchCompletionCallback(this, batch)));
+  Status s = tablet_peer_->SubmitWriteUnbatched(std::move(state));
+  if (PREDICT_FALSE(!s.ok())) {
+    // The callback is only run once the transaction was submitted.
+    for (const auto& write : batch->writes) {
+      write->completion_callback()->set_error(s, TabletServerErrorPB::UNKNOWN_ERROR);
+      write->completion_callback()->TransactionCompleted();
+    }
+  }
+}
+
+void WriteCoalescer::SubmitAlone(const shared_ptr<Batch>& batch, int idx) {
+  WriteTransactionState* write = batch->writes[idx].get();
+  unique_ptr<WriteTransactionState> state(new WriteTransactionState(
+      tablet_peer_, write->request(), nullptr, write->response()));
+  state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
+      new SingleWriteCompletionCallback(batch, write)));
+  Status s = tablet_peer_->SubmitWriteUnbatched(std::move(state));
+  if (PREDICT_FALSE(!s.ok())) {
+    write->completion_callback()->set_error(s, TabletServerErrorPB::UNKNOWN_ERROR);
+    write->completion_callback()->TransactionCompleted();
+  }
+}
+
+} // namespace tablet
+} // namespace kudu
@@ -0,0 +1,115 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TABLET_WRITE_COALESCER_H_
+#define KUDU_TABLET_WRITE_COALESCER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/mutex.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+namespace rpc {
+class Messenger;
+}
+
+namespace tablet {
+
+class TabletPeer;
+class WriteTransactionState;
+
+// Folds write RPCs which reach a tablet leader within a short window
+// (--tablet_write_coalescing_window_us) into a single WriteTransaction, so
+// that they share one Prepare, one ReplicateMsg, one WAL append and one MVCC
+// timestamp. Each constituent RPC is still responded to separately: on
+// completion, the per-row errors of the combined transaction are handed back
+// to the write they came from, with their row indexes rebased.
+//
+// Only writes whose results are not tracked (see ResultTracker) and which use
+// CLIENT_PROPAGATED consistency are coalesced: tracked writes are identified
+// by their own request id all the way through replication, which a combined
+// ReplicateMsg cannot carry, and COMMIT_WAIT writes would make every other
+// write in the batch wait out their commit-wait period as well.
+//
+// If the combined transaction fails while being prepared (for example since
+// one of the writes doesn't match the tablet's schema), each write is
+// resubmitted on its own so that the failure is attributed to the right RPC.
+// Any other error is reported to all of the writes in the batch.
+//
+// This class is thread-safe.
+class WriteCoalescer : public RefCountedThreadSafe<WriteCoalescer> {
+ public:
+  WriteCoalescer(TabletPeer* tablet_peer, std::shared_ptr<rpc::Messenger> messenger);
+
+  // Takes 'tx_state' into the pending batch, starting a new batch if there is
+  // none or if the pending one was written with a different schema, and
+  // returns true. Once this returns true the write will be submitted
+  // asynchronously, and any error will be reported through its completion
+  // callback.
+  //
+  // Returns false, leaving 'tx_state' untouched, if the write should be
+  // submitted on its own instead: if coalescing is disabled, if the write is
+  // not eligible (see above), if its operations can't be parsed, or after
+  // Shutdown().
+  bool TryAdd(std::unique_ptr<WriteTransactionState>* tx_state);
+
+  // Submits the pending batch, if any, and makes any later call to TryAdd()
+  // return false.
+  void Shutdown();
+
+ private:
+  friend class RefCountedThreadSafe<WriteCoalescer>;
+  class Batch;
+  class BatchCompletionCallback;
+  class SingleWriteCompletionCallback;
+
+  ~WriteCoalescer();
+
+  // Called on a reactor thread once the coalescing window of the batch with
+  // sequence number 'seq' has elapsed. Submits that batch if it's still
+  // pending.
+  void FlushTask(int64_t seq, const Status& s);
+
+  // Submits 'batch' as a single transaction; a batch holding a single write
+  // is submitted as that write.
+  void SubmitBatch(std::shared_ptr<Batch> batch);
+
+  // Submits the write at index 'idx' of 'batch' on its own, completing it
+  // with an error if it can't be submitted.
+  void SubmitAlone(const std::shared_ptr<Batch>& batch, int idx);
+
+  TabletPeer* const tablet_peer_;
+  const std::shared_ptr<rpc::Messenger> messenger_;
+
+  // Protects the members below. A Mutex rather than a spinlock since a new
+  // batch decodes the client schema while holding it.
+  Mutex lock_;
+  std::shared_ptr<Batch> pending_;
+  int64_t next_seq_;
+  bool shutdown_;
+
+  DISALLOW_COPY_AND_ASSIGN(WriteCoalescer);
+};
+
+} // namespace tablet
+} // namespace kudu
+
+#endif /* KUDU_TABLET_WRITE_COALESCER_H_ */
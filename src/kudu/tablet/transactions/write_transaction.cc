@@ -66,6 +66,14 @@ void WriteTransaction::NewReplicateMsg(gscoped_ptr<ReplicateMsg>* replicate_msg)
   replicate_msg->reset(new ReplicateMsg);
   (*replicate_msg)->set_op_type(WRITE_OP);
   (*replicate_msg)->mutable_write_request()->CopyFrom(*state()->request());
+  // Replicas decode the rows from the replicated request itself.
+  RowOperationsPB* ops = (*replicate_msg)->mutable_write_request()->mutable_row_operations();
+  if (ops->has_rows_sidecar()) {
+    ops->clear_rows_sidecar();
+    ops->clear_indirect_data_sidecar();
+    ops->set_rows(state()->rows_data().data(), state()->rows_data().size());
+    ops->set_indirect_data(state()->indirect_data().data(), state()->indirect_data().size());
+  }
   if (state()->are_results_tracked()) {
     (*replicate_msg)->mutable_request_id()->CopyFrom(state()->request_id());
   }
@@ -343,6 +351,8 @@ void WriteTransactionState::ResetRpcFields() {
   std::lock_guard<simple_spinlock> l(txn_state_lock_);
   request_ = nullptr;
   response_ = nullptr;
+  rows_sidecar_.clear();
+  indirect_data_sidecar_.clear();
   STLDeleteElements(&row_ops_);
 }
 
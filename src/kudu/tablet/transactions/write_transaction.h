@@ -29,6 +29,7 @@
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/transactions/transaction.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/slice.h"
 
 namespace kudu {
 struct DecodedRowOperation;
@@ -99,6 +100,27 @@ class WriteTransactionState : public TransactionState {
     return response_;
   }
 
+  // Sets the row data of the request, which the client sent in the RPC
+  // sidecars named by RowOperationsPB::rows_sidecar and indirect_data_sidecar
+  // rather than in the request itself. Like the request, the data belongs to
+  // the RPC.
+  void set_row_operations_sidecars(Slice rows, Slice indirect_data) {
+    DCHECK(request_->row_operations().has_rows_sidecar());
+    rows_sidecar_ = rows;
+    indirect_data_sidecar_ = indirect_data;
+  }
+
+  // Returns the encoded rows and indirect data of the request, whether they
+  // were sent in sidecars or in the request itself.
+  Slice rows_data() const {
+    return request_->row_operations().has_rows_sidecar() ?
+        rows_sidecar_ : Slice(request_->row_operations().rows());
+  }
+  Slice indirect_data() const {
+    return request_->row_operations().has_rows_sidecar() ?
+        indirect_data_sidecar_ : Slice(request_->row_operations().indirect_data());
+  }
+
   // Set the MVCC transaction associated with this Write operation.
   // This must be called exactly once, after the timestamp was acquired.
   // This also copies the timestamp from the MVCC transaction into the
@@ -210,6 +232,10 @@ class WriteTransactionState : public TransactionState {
   // Protected by superclass's txn_state_lock_.
   const Schema* schema_at_decode_time_;
 
+  // See set_row_operations_sidecars().
+  Slice rows_sidecar_;
+  Slice indirect_data_sidecar_;
+
   DISALLOW_COPY_AND_ASSIGN(WriteTransactionState);
 };
 
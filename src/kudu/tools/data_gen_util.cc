@@ -17,6 +17,7 @@
 #include "kudu/tools/data_gen_util.h"
 
 #include "kudu/client/schema.h"
+#include "kudu/common/decimal_util.h"
 #include "kudu/common/partial_row.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/util/random.h"
@@ -56,6 +57,11 @@ void WriteValueToColumn(const client::KuduSchema& schema,
     case client::KuduColumnSchema::BOOL:
       CHECK_OK(row->SetBool(col_idx, value));
       break;
+    case client::KuduColumnSchema::DECIMAL: {
+      int8_t precision = schema.Column(col_idx).type_attributes().precision();
+      CHECK_OK(row->SetUnscaledDecimal(col_idx, value % (MaxUnscaledDecimal(precision) + 1)));
+      break;
+    }
     default:
       LOG(FATAL) << "Unexpected data type: " << type;
   }
@@ -61,9 +61,21 @@ class MockKsckTabletServer : public KsckTabletServer {
     return fetch_info_status_;
   }
 
+  Status SplitTabletKeyRange(const std::string& /* tablet_id */,
+                             int num_ranges,
+                             std::vector<std::string>* split_keys) override {
+    split_keys->clear();
+    for (int i = 1; i < num_ranges; i++) {
+      split_keys->push_back(std::to_string(i));
+    }
+    return Status::OK();
+  }
+
   virtual void RunTabletChecksumScanAsync(
       const std::string& tablet_id,
       const Schema& schema,
+      const std::string& start_key,
+      const std::string& stop_key,
       const ChecksumOptions& options,
       ChecksumProgressCallbacks* callbacks) OVERRIDE {
     callbacks->Progress(10, 20);
@@ -329,6 +341,17 @@ TEST_F(KsckTest, TestOneTableCheck) {
                       "0/1 replicas remaining (20B from disk, 10 rows summed)");
 }
 
+TEST_F(KsckTest, TestOneTableChecksumByRanges) {
+  CreateOneTableOneTablet();
+  ASSERT_OK(RunKsck());
+  ChecksumOptions options;
+  options.ranges_per_tablet = 2;
+  ASSERT_OK(ksck_->ChecksumData(options));
+  // Each range of the single replica is scanned on its own.
+  ASSERT_STR_CONTAINS(err_stream_.str(),
+                      "0/1 replicas remaining (40B from disk, 20 rows summed)");
+}
+
 TEST_F(KsckTest, TestOneSmallReplicatedTable) {
   CreateOneSmallReplicatedTable();
   ASSERT_OK(RunKsck());
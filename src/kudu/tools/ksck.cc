@@ -43,6 +43,13 @@ DEFINE_int32(checksum_timeout_sec, 3600,
              "before timing out.");
 DEFINE_int32(checksum_scan_concurrency, 4,
              "Number of concurrent checksum scans to execute per tablet server.");
+DEFINE_int32(checksum_ranges_per_tablet, 1,
+             "Number of key ranges to split each tablet into. The ranges of "
+             "each replica are checksummed by concurrent scans, which speeds "
+             "up the checksum of large tablets.");
+DEFINE_int64(checksum_max_bytes_per_sec_per_tserver, 0,
+             "Maximum rate at which the checksum scans of each tablet server "
+             "read data, in bytes per second. 0 means unlimited.");
 DEFINE_bool(checksum_snapshot, true, "Should the checksum scanner use a snapshot scan");
 DEFINE_uint64(checksum_snapshot_timestamp,
               kudu::tools::ChecksumOptions::kCurrentTimestamp,
@@ -100,7 +107,9 @@ ChecksumOptions::ChecksumOptions()
     : timeout(MonoDelta::FromSeconds(FLAGS_checksum_timeout_sec)),
       scan_concurrency(FLAGS_checksum_scan_concurrency),
       use_snapshot(FLAGS_checksum_snapshot),
-      snapshot_timestamp(FLAGS_checksum_snapshot_timestamp) {
+      snapshot_timestamp(FLAGS_checksum_snapshot_timestamp),
+      ranges_per_tablet(FLAGS_checksum_ranges_per_tablet),
+      max_bytes_per_sec_per_tserver(FLAGS_checksum_max_bytes_per_sec_per_tserver) {
 }
 
 ChecksumOptions::ChecksumOptions(MonoDelta timeout, int scan_concurrency,
@@ -108,7 +117,9 @@ ChecksumOptions::ChecksumOptions(MonoDelta timeout, int scan_concurrency,
     : timeout(timeout),
       scan_concurrency(scan_concurrency),
       use_snapshot(use_snapshot),
-      snapshot_timestamp(snapshot_timestamp) {}
+      snapshot_timestamp(snapshot_timestamp),
+      ranges_per_tablet(1),
+      max_bytes_per_sec_per_tserver(0) {}
 
 const uint64_t ChecksumOptions::kCurrentTimestamp = 0;
 
@@ -255,12 +266,23 @@ class ChecksumResultReporter : public RefCountedThreadSafe<ChecksumResultReporte
         disk_bytes_summed_(0) {
   }
 
+  // Set the number of key ranges the replicas of the tablet are checksummed
+  // in. Defaults to 1. Must be called before any result of the tablet is
+  // reported.
+  void SetNumRanges(const std::string& tablet_id, int num_ranges) {
+    std::lock_guard<simple_spinlock> guard(lock_);
+    InsertOrUpdate(&num_ranges_, tablet_id, num_ranges);
+  }
+
   void ReportProgress(int64_t delta_rows, int64_t delta_bytes) {
     rows_summed_.IncrementBy(delta_rows);
     disk_bytes_summed_.IncrementBy(delta_bytes);
   }
 
-  // Write an entry to the result map indicating a response from the remote.
+  // Write an entry to the result map indicating a response from the remote
+  // for one of the key ranges of the replica. The checksums of the ranges
+  // add up to that of the replica, which is complete once all its ranges
+  // reported.
   void ReportResult(const std::string& tablet_id,
                     const std::string& replica_uuid,
                     const Status& status,
@@ -268,8 +290,19 @@ class ChecksumResultReporter : public RefCountedThreadSafe<ChecksumResultReporte
     std::lock_guard<simple_spinlock> guard(lock_);
     unordered_map<string, ResultPair>& replica_results =
         LookupOrInsert(&checksums_, tablet_id, unordered_map<string, ResultPair>());
-    InsertOrDie(&replica_results, replica_uuid, ResultPair(status, checksum));
-    responses_.CountDown();
+    ResultPair* result = FindOrNull(replica_results, replica_uuid);
+    if (result == nullptr) {
+      InsertOrDie(&replica_results, replica_uuid, ResultPair(status, checksum));
+    } else if (result->first.ok()) {
+      // Keep the first error of the ranges, if any.
+      result->first = status;
+      result->second += checksum;
+    }
+    int& ranges_reported = LookupOrInsert(&ranges_reported_,
+                                          std::make_pair(tablet_id, replica_uuid), 0);
+    if (++ranges_reported == FindWithDefault(num_ranges_, tablet_id, 1)) {
+      responses_.CountDown();
+    }
   }
 
   // Blocks until either the number of results plus errors reported equals
@@ -290,11 +323,16 @@ class ChecksumResultReporter : public RefCountedThreadSafe<ChecksumResultReporte
       done = responses_.WaitFor(MonoDelta::FromMilliseconds(std::min(rem_ms, 5000)));
       string status = done ? "finished in " : "running for ";
       int run_time_sec = (MonoTime::Now() - start).ToSeconds();
+      int64_t disk_bytes_summed = disk_bytes_summed_.Load();
       Out() << "Checksum " << status << run_time_sec << "s: "
              << responses_.count() << "/" << expected_count_ << " replicas remaining ("
-             << HumanReadableNumBytes::ToString(disk_bytes_summed_.Load()) << " from disk, "
-             << HumanReadableInt::ToString(rows_summed_.Load()) << " rows summed)"
-             << endl;
+             << HumanReadableNumBytes::ToString(disk_bytes_summed) << " from disk, "
+             << HumanReadableInt::ToString(rows_summed_.Load()) << " rows summed)";
+      if (run_time_sec > 0) {
+        Out() << " at " << HumanReadableNumBytes::ToString(disk_bytes_summed / run_time_sec)
+              << "/s";
+      }
+      Out() << endl;
     }
     return true;
   }
@@ -319,16 +357,28 @@ class ChecksumResultReporter : public RefCountedThreadSafe<ChecksumResultReporte
   const int expected_count_;
   CountDownLatch responses_;
 
-  mutable simple_spinlock lock_; // Protects 'checksums_'.
+  mutable simple_spinlock lock_; // Protects the maps below.
   // checksums_ is an unordered_map of { tablet_id : { replica_uuid : checksum } }.
   TabletResultMap checksums_;
+  // The number of key ranges of each tablet, if not 1.
+  std::unordered_map<std::string, int> num_ranges_;
+  // The number of key ranges which reported for each (tablet_id, replica_uuid).
+  std::map<std::pair<std::string, std::string>, int> ranges_reported_;
 
   AtomicInt<int64_t> rows_summed_;
   AtomicInt<int64_t> disk_bytes_summed_;
 };
 
-// Queue of tablet replicas for an individual tablet server.
-typedef shared_ptr<BlockingQueue<std::pair<Schema, std::string> > > SharedTabletQueue;
+// A key range of a tablet to checksum.
+struct TabletChecksumRange {
+  Schema schema;
+  std::string tablet_id;
+  std::string start_key;
+  std::string stop_key;
+};
+
+// Queue of key ranges of tablet replicas for an individual tablet server.
+typedef shared_ptr<BlockingQueue<TabletChecksumRange>> SharedTabletQueue;
 
 // A set of callbacks which records the result of a tablet replica's checksum,
 // and then checks if the tablet server has any more tablets to checksum. If so,
@@ -348,6 +398,14 @@ class TabletServerChecksumCallbacks : public ChecksumProgressCallbacks {
       tablet_id_(std::move(tablet_id)) {
   }
 
+  // Starts the checksum scan of 'range', reporting to this object.
+  void Start(const TabletChecksumRange& range) {
+    tablet_id_ = range.tablet_id;
+    tablet_server_->RunTabletChecksumScanAsync(range.tablet_id, range.schema,
+                                               range.start_key, range.stop_key,
+                                               options_, this);
+  }
+
   void Progress(int64_t rows_summed, int64_t disk_bytes_summed) override {
     reporter_->ReportProgress(rows_summed, disk_bytes_summed);
   }
@@ -355,11 +413,9 @@ class TabletServerChecksumCallbacks : public ChecksumProgressCallbacks {
   void Finished(const Status& status, uint64_t checksum) override {
     reporter_->ReportResult(tablet_id_, tablet_server_->uuid(), status, checksum);
 
-    std::pair<Schema, std::string> table_tablet;
-    if (queue_->BlockingGet(&table_tablet)) {
-      const Schema& table_schema = table_tablet.first;
-      tablet_id_ = table_tablet.second;
-      tablet_server_->RunTabletChecksumScanAsync(tablet_id_, table_schema, options_, this);
+    TabletChecksumRange range;
+    if (queue_->BlockingGet(&range)) {
+      Start(range);
     } else {
       delete this;
     }
@@ -374,6 +430,26 @@ class TabletServerChecksumCallbacks : public ChecksumProgressCallbacks {
   std::string tablet_id_;
 };
 
+Status Ksck::SplitTabletKeyRange(const KsckTablet& tablet, int num_ranges,
+                                 vector<string>* split_keys) {
+  // Prefer asking the leader, which is the most likely to be up to date.
+  shared_ptr<KsckTabletServer> split_ts;
+  for (const shared_ptr<KsckTabletReplica>& replica : tablet.replicas()) {
+    const shared_ptr<KsckTabletServer>* ts =
+        FindOrNull(cluster_->tablet_servers(), replica->ts_uuid());
+    if (ts == nullptr || !(*ts)->is_healthy()) {
+      continue;
+    }
+    if (!split_ts || replica->is_leader()) {
+      split_ts = *ts;
+    }
+  }
+  if (!split_ts) {
+    return Status::ServiceUnavailable("no healthy replica to split the tablet");
+  }
+  return split_ts->SplitTabletKeyRange(tablet.id(), num_ranges, split_keys);
+}
+
 Status Ksck::ChecksumData(const ChecksumOptions& opts) {
   // Copy options so that local modifications can be made and passed on.
   ChecksumOptions options = opts;
@@ -427,17 +503,37 @@ Status Ksck::ChecksumData(const ChecksumOptions& opts) {
   TabletServerQueueMap tablet_server_queues;
   scoped_refptr<ChecksumResultReporter> reporter(new ChecksumResultReporter(num_tablet_replicas));
 
-  // Create a queue of checksum callbacks grouped by the tablet server.
+  // Create a queue of the key ranges to checksum grouped by the tablet server.
+  // All the replicas of a tablet are split at the same keys.
   for (const TabletTableMap::value_type& entry : tablet_table_map) {
     const shared_ptr<KsckTablet>& tablet = entry.first;
     const shared_ptr<KsckTable>& table = entry.second;
+    vector<string> split_keys;
+    if (options.ranges_per_tablet > 1) {
+      Status s = SplitTabletKeyRange(*tablet, options.ranges_per_tablet, &split_keys);
+      if (!s.ok()) {
+        Warn() << "Checksumming tablet " << tablet->id() << " as a single key range: "
+               << s.ToString() << endl;
+        split_keys.clear();
+      }
+    }
+    reporter->SetNumRanges(tablet->id(), split_keys.size() + 1);
     for (const shared_ptr<KsckTabletReplica>& replica : tablet->replicas()) {
       const shared_ptr<KsckTabletServer>& ts =
           FindOrDie(cluster_->tablet_servers(), replica->ts_uuid());
 
       const SharedTabletQueue& queue =
-          LookupOrInsertNewSharedPtr(&tablet_server_queues, ts, num_tablet_replicas);
-      CHECK_EQ(QUEUE_SUCCESS, queue->Put(make_pair(table->schema(), tablet->id())));
+          LookupOrInsertNewSharedPtr(&tablet_server_queues, ts,
+                                     num_tablet_replicas *
+                                     std::max(1, options.ranges_per_tablet));
+      for (size_t i = 0; i <= split_keys.size(); i++) {
+        TabletChecksumRange range;
+        range.schema = table->schema();
+        range.tablet_id = tablet->id();
+        range.start_key = i == 0 ? "" : split_keys[i - 1];
+        range.stop_key = i == split_keys.size() ? "" : split_keys[i];
+        CHECK_EQ(QUEUE_SUCCESS, queue->Put(range));
+      }
     }
   }
 
@@ -465,14 +561,12 @@ Status Ksck::ChecksumData(const ChecksumOptions& opts) {
     const SharedTabletQueue& queue = entry.second;
     queue->Shutdown(); // Ensures that BlockingGet() will not block.
     for (int i = 0; i < options.scan_concurrency; i++) {
-      std::pair<Schema, std::string> table_tablet;
-      if (queue->BlockingGet(&table_tablet)) {
-        const Schema& table_schema = table_tablet.first;
-        const std::string& tablet_id = table_tablet.second;
+      TabletChecksumRange range;
+      if (queue->BlockingGet(&range)) {
         auto* cbs = new TabletServerChecksumCallbacks(
-            reporter, tablet_server, queue, tablet_id, options);
+            reporter, tablet_server, queue, range.tablet_id, options);
         // 'cbs' deletes itself when complete.
-        tablet_server->RunTabletChecksumScanAsync(tablet_id, table_schema, options, cbs);
+        cbs->Start(range);
       }
     }
   }
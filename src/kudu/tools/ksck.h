@@ -62,6 +62,15 @@ struct ChecksumOptions {
   // The snapshot timestamp to use for snapshot checksum scans.
   uint64_t snapshot_timestamp;
 
+  // The number of key ranges to split each tablet into. The ranges of a
+  // replica are checksummed by concurrent scans, whose checksums add up to
+  // that of the replica.
+  int ranges_per_tablet;
+
+  // The maximum rate at which the checksum scans of a tablet server read
+  // data, in bytes per second, or 0 for no limit.
+  int64_t max_bytes_per_sec_per_tserver;
+
   // A timestamp indicicating that the current time should be used for a checksum snapshot.
   static const uint64_t kCurrentTimestamp;
 };
@@ -186,11 +195,22 @@ class KsckTabletServer {
   // Connects to the configured tablet server and populates the fields of this class.
   virtual Status FetchInfo() = 0;
 
-  // Executes a checksum scan on the associated tablet, and runs the callback
-  // with the result. The callback must be threadsafe and non-blocking.
+  // Fetches the encoded primary keys which split the tablet into up to
+  // 'num_ranges' ranges holding roughly the same amount of data. There may be
+  // fewer split keys than 'num_ranges - 1', e.g. for small tablets.
+  virtual Status SplitTabletKeyRange(const std::string& tablet_id,
+                                     int num_ranges,
+                                     std::vector<std::string>* split_keys) = 0;
+
+  // Executes a checksum scan of the rows of the associated tablet whose
+  // encoded primary keys are within ['start_key', 'stop_key'), and runs
+  // the callback with the result. Empty bounds are unbounded. The callback
+  // must be threadsafe and non-blocking.
   virtual void RunTabletChecksumScanAsync(
                   const std::string& tablet_id,
                   const Schema& schema,
+                  const std::string& start_key,
+                  const std::string& stop_key,
                   const ChecksumOptions& options,
                   ChecksumProgressCallbacks* callbacks) = 0;
 
@@ -380,6 +400,11 @@ class Ksck {
   CheckResult VerifyTablet(const std::shared_ptr<KsckTablet>& tablet,
                            int table_num_replicas);
 
+  // Fetches the keys splitting 'tablet' into up to 'num_ranges' key ranges
+  // from a healthy tablet server hosting a replica, preferably the leader.
+  Status SplitTabletKeyRange(const KsckTablet& tablet, int num_ranges,
+                             std::vector<std::string>* split_keys);
+
   const std::shared_ptr<KsckCluster> cluster_;
 
   bool check_replica_count_ = true;
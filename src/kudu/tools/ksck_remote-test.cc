@@ -250,6 +250,34 @@ TEST_F(RemoteKsckTest, TestChecksum) {
   ASSERT_OK(s);
 }
 
+TEST_F(RemoteKsckTest, TestChecksumByRangesRateLimited) {
+  uint64_t num_writes = 100;
+  LOG(INFO) << "Generating row writes...";
+  ASSERT_OK(GenerateRowWrites(num_writes));
+
+  ChecksumOptions options(MonoDelta::FromSeconds(10), 16, false, 0);
+  options.ranges_per_tablet = 4;
+  options.max_bytes_per_sec_per_tserver = 1024 * 1024;
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromSeconds(30);
+  Status s;
+  while (MonoTime::Now() < deadline) {
+    ASSERT_OK(ksck_->FetchTableAndTabletInfo());
+
+    err_stream_.str("");
+    s = ksck_->ChecksumData(options);
+    if (s.ok()) {
+      // Whatever the tablets split into, every row is summed once per replica.
+      ASSERT_STR_CONTAINS(err_stream_.str(),
+                          AllowSlowTests() ?
+                          "0/30 replicas remaining (0B from disk, 300 rows summed)" :
+                          "0/9 replicas remaining (0B from disk, 300 rows summed)");
+      break;
+    }
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+  ASSERT_OK(s);
+}
+
 TEST_F(RemoteKsckTest, TestChecksumTimeout) {
   uint64_t num_writes = 10000;
   LOG(INFO) << "Generating row writes...";
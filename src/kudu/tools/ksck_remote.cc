@@ -17,6 +17,8 @@
 
 #include "kudu/tools/ksck_remote.h"
 
+#include <mutex>
+
 #include "kudu/client/client.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/wire_protocol.h"
@@ -24,6 +26,8 @@
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/net/sockaddr.h"
 
@@ -54,6 +58,29 @@ MonoDelta GetDefaultTimeout() {
   return MonoDelta::FromMilliseconds(FLAGS_timeout_ms);
 }
 
+// Paces the checksum scans of a tablet server, so that together they read
+// data at a bounded rate.
+class ChecksumRateLimiter {
+ public:
+  // Accounts for 'bytes' read by a checksum scan, and returns how long the
+  // scan should wait before reading more for the rate to stay at most
+  // 'max_bytes_per_sec'.
+  MonoDelta Consume(int64_t bytes, int64_t max_bytes_per_sec) {
+    std::lock_guard<simple_spinlock> l(lock_);
+    MonoTime now = MonoTime::Now();
+    if (!next_read_.Initialized() || next_read_ < now) {
+      next_read_ = now;
+    }
+    next_read_ += MonoDelta::FromNanoseconds(bytes * 1000000000 / max_bytes_per_sec);
+    return next_read_ - now;
+  }
+
+ private:
+  simple_spinlock lock_;
+  // The earliest time at which the next read fits in the rate.
+  MonoTime next_read_;
+};
+
 Status RemoteKsckTabletServer::Init() {
   vector<Sockaddr> addresses;
   RETURN_NOT_OK(ParseAddressList(
@@ -61,6 +88,7 @@ Status RemoteKsckTabletServer::Init() {
       tserver::TabletServer::kDefaultPort, &addresses));
   generic_proxy_.reset(new server::GenericServiceProxy(messenger_, addresses[0]));
   ts_proxy_.reset(new tserver::TabletServerServiceProxy(messenger_, addresses[0]));
+  checksum_rate_limiter_.reset(new ChecksumRateLimiter());
   return Status::OK();
 }
 
@@ -129,15 +157,22 @@ class ChecksumCallbackHandler {
 // After the ChecksumStepper reports its results to the reporter, it deletes itself.
 class ChecksumStepper {
  public:
-  ChecksumStepper(string tablet_id, const Schema& schema, string server_uuid,
-                  ChecksumOptions options, ChecksumProgressCallbacks* callbacks,
-                  shared_ptr<tserver::TabletServerServiceProxy> proxy)
+  ChecksumStepper(string tablet_id, const Schema& schema, string start_key,
+                  string stop_key, string server_uuid, ChecksumOptions options,
+                  ChecksumProgressCallbacks* callbacks,
+                  shared_ptr<tserver::TabletServerServiceProxy> proxy,
+                  shared_ptr<Messenger> messenger,
+                  shared_ptr<ChecksumRateLimiter> rate_limiter)
       : schema_(schema),
         tablet_id_(std::move(tablet_id)),
+        start_key_(std::move(start_key)),
+        stop_key_(std::move(stop_key)),
         server_uuid_(std::move(server_uuid)),
         options_(std::move(options)),
         callbacks_(callbacks),
         proxy_(std::move(proxy)),
+        messenger_(std::move(messenger)),
+        rate_limiter_(std::move(rate_limiter)),
         call_seq_id_(0),
         checksum_(0) {
     DCHECK(proxy_);
@@ -163,8 +198,9 @@ class ChecksumStepper {
       callbacks_->Finished(s, 0);
       return; // Deletes 'this'.
     }
+    int64_t bytes = 0;
     if (resp_.has_resource_metrics() || resp_.has_rows_checksummed()) {
-      int64_t bytes = resp_.resource_metrics().cfile_cache_miss_bytes() +
+      bytes = resp_.resource_metrics().cfile_cache_miss_bytes() +
           resp_.resource_metrics().cfile_cache_hit_bytes();
       callbacks_->Progress(resp_.rows_checksummed(), bytes);
     }
@@ -177,12 +213,22 @@ class ChecksumStepper {
       return; // Deletes 'this'.
     }
 
-    // We're not done scanning yet. Fetch the next chunk.
+    // We're not done scanning yet. Fetch the next chunk, once the data read
+    // so far fits in the rate limit of the tablet server.
     if (resp_.has_scanner_id()) {
       scanner_id_ = resp_.scanner_id();
     }
-    SendRequest(kContinueRequest);
     ignore_result(deleter.release()); // We have more work to do.
+    MonoDelta delay;
+    if (options_.max_bytes_per_sec_per_tserver > 0 && bytes > 0) {
+      delay = rate_limiter_->Consume(bytes, options_.max_bytes_per_sec_per_tserver);
+    }
+    if (delay.Initialized() && delay.ToNanoseconds() > 0) {
+      messenger_->ScheduleOnReactor(
+          boost::bind(&ChecksumStepper::SendDelayedRequest, this, _1), delay);
+    } else {
+      SendRequest(kContinueRequest);
+    }
   }
 
  private:
@@ -191,6 +237,15 @@ class ChecksumStepper {
     kContinueRequest
   };
 
+  void SendDelayedRequest(const Status& status) {
+    if (!status.ok()) {
+      gscoped_ptr<ChecksumStepper> deleter(this);
+      callbacks_->Finished(status, 0);
+      return; // Deletes 'this'.
+    }
+    SendRequest(kContinueRequest);
+  }
+
   void SendRequest(RequestType type) {
     switch (type) {
       case kNewRequest: {
@@ -198,6 +253,12 @@ class ChecksumStepper {
         req_.mutable_new_request()->mutable_projected_columns()->CopyFrom(cols_);
         req_.mutable_new_request()->set_tablet_id(tablet_id_);
         req_.mutable_new_request()->set_cache_blocks(FLAGS_checksum_cache_blocks);
+        if (!start_key_.empty()) {
+          req_.mutable_new_request()->set_start_primary_key(start_key_);
+        }
+        if (!stop_key_.empty()) {
+          req_.mutable_new_request()->set_stop_primary_key(stop_key_);
+        }
         if (options_.use_snapshot) {
           req_.mutable_new_request()->set_read_mode(READ_AT_SNAPSHOT);
           req_.mutable_new_request()->set_snap_timestamp(options_.snapshot_timestamp);
@@ -230,10 +291,14 @@ class ChecksumStepper {
   google::protobuf::RepeatedPtrField<ColumnSchemaPB> cols_;
 
   const string tablet_id_;
+  const string start_key_;
+  const string stop_key_;
   const string server_uuid_;
   const ChecksumOptions options_;
   ChecksumProgressCallbacks* const callbacks_;
   const shared_ptr<tserver::TabletServerServiceProxy> proxy_;
+  const shared_ptr<Messenger> messenger_;
+  const shared_ptr<ChecksumRateLimiter> rate_limiter_;
 
   uint32_t call_seq_id_;
   string scanner_id_;
@@ -248,13 +313,34 @@ void ChecksumCallbackHandler::Run() {
   delete this;
 }
 
+Status RemoteKsckTabletServer::SplitTabletKeyRange(const string& tablet_id,
+                                                   int num_ranges,
+                                                   vector<string>* split_keys) {
+  tserver::SplitKeyRangeRequestPB req;
+  tserver::SplitKeyRangeResponsePB resp;
+  RpcController rpc;
+  rpc.set_timeout(GetDefaultTimeout());
+  req.set_tablet_id(tablet_id);
+  req.set_num_ranges(num_ranges);
+  RETURN_NOT_OK_PREPEND(ts_proxy_->SplitKeyRange(req, &resp, &rpc),
+                        "could not split the key range of the tablet");
+  if (resp.has_error()) {
+    return StatusFromPB(resp.error().status());
+  }
+  split_keys->assign(resp.split_keys().begin(), resp.split_keys().end());
+  return Status::OK();
+}
+
 void RemoteKsckTabletServer::RunTabletChecksumScanAsync(
         const string& tablet_id,
         const Schema& schema,
+        const string& start_key,
+        const string& stop_key,
         const ChecksumOptions& options,
         ChecksumProgressCallbacks* callbacks) {
   gscoped_ptr<ChecksumStepper> stepper(
-      new ChecksumStepper(tablet_id, schema, uuid(), options, callbacks, ts_proxy_));
+      new ChecksumStepper(tablet_id, schema, start_key, stop_key, uuid(), options,
+                          callbacks, ts_proxy_, messenger_, checksum_rate_limiter_));
   stepper->Start();
   ignore_result(stepper.release()); // Deletes self on callback.
 }
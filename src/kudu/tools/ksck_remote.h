@@ -37,6 +37,8 @@ class Schema;
 
 namespace tools {
 
+class ChecksumRateLimiter;
+
 // This implementation connects to a Tablet Server via RPC.
 class RemoteKsckTabletServer : public KsckTabletServer {
  public:
@@ -54,9 +56,15 @@ class RemoteKsckTabletServer : public KsckTabletServer {
 
   Status FetchInfo() override;
 
+  Status SplitTabletKeyRange(const std::string& tablet_id,
+                             int num_ranges,
+                             std::vector<std::string>* split_keys) override;
+
   void RunTabletChecksumScanAsync(
       const std::string& tablet_id,
       const Schema& schema,
+      const std::string& start_key,
+      const std::string& stop_key,
       const ChecksumOptions& options,
       ChecksumProgressCallbacks* callbacks) override;
 
@@ -69,6 +77,9 @@ class RemoteKsckTabletServer : public KsckTabletServer {
   const std::shared_ptr<rpc::Messenger> messenger_;
   std::shared_ptr<server::GenericServiceProxy> generic_proxy_;
   std::shared_ptr<tserver::TabletServerServiceProxy> ts_proxy_;
+
+  // Paces the checksum scans of this tablet server.
+  std::shared_ptr<ChecksumRateLimiter> checksum_rate_limiter_;
 };
 
 // This implementation connects to a Master via RPC.
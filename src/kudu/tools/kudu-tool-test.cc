@@ -263,6 +263,7 @@ TEST_F(ToolTest, TestTopLevelHelp) {
       "local_replica.*tablet replicas",
       "master.*Kudu Master",
       "pbc.*protobuf container",
+      "perf.*performance",
       "remote_replica.*tablet replicas on a Kudu Tablet Server",
       "table.*Kudu tables",
       "tablet.*Kudu tablets",
@@ -298,10 +299,12 @@ TEST_F(ToolTest, TestModeHelp) {
   {
     const vector<string> kLocalReplicaModeRegexes = {
         "cmeta.*Operate on a local tablet replica's consensus",
+        "compact.*Compact tablet replicas in the local filesystem",
         "dump.*Dump a Kudu filesystem",
         "copy_from_remote.*Copy a tablet replica",
         "delete.*Delete a tablet replica from the local filesystem",
-        "list.*Show list of tablet replicas"
+        "list.*Show list of tablet replicas",
+        "read_amplification.*Print the read amplification of a local tablet replica"
     };
     NO_FATALS(RunTestHelp("local_replica", kLocalReplicaModeRegexes));
   }
@@ -353,6 +356,13 @@ TEST_F(ToolTest, TestModeHelp) {
     };
     NO_FATALS(RunTestHelp("pbc", kPbcModeRegexes));
   }
+  {
+    const vector<string> kPerfModeRegexes = {
+        "compaction_sim.*Simulate the compaction policy",
+        "table_scan.*Measure the throughput of a parallel scan",
+    };
+    NO_FATALS(RunTestHelp("perf", kPerfModeRegexes));
+  }
   {
     const vector<string> kRemoteReplicaModeRegexes = {
         "check.*Check if all tablet replicas",
@@ -494,6 +504,76 @@ TEST_F(ToolTest, TestPbcDump) {
   }
 }
 
+TEST_F(ToolTest, TestPerfCompactionSim) {
+  const string kLayoutPath = GetTestPath("layout.tsv");
+  const string kDumpPath = GetTestPath("layout_dump.tsv");
+  ASSERT_OK(WriteStringToFile(env_,
+                              "# size_mb\tmin_key\tmax_key\n"
+                              "32\ta\tm\n"
+                              "32\tb\tz\n"
+                              "32\tn\tz\t8\n",
+                              kLayoutPath));
+  vector<string> stdout;
+  NO_FATALS(RunActionStdoutLines(Substitute(
+      "perf compaction_sim $0 --dump_layout=$1 --sim_rounds=20 "
+      "--sim_report_interval=10", kLayoutPath, kDumpPath), &stdout));
+  SCOPED_TRACE(stdout);
+  // A header, then the reports for rounds 0, 10 and 20.
+  ASSERT_EQ(4, stdout.size());
+  ASSERT_STR_CONTAINS(stdout[0], "write_amp");
+  ASSERT_STR_MATCHES(stdout[1], "^0\t3\t");
+  ASSERT_STR_MATCHES(stdout[3], "^20\t");
+
+  // The dumped layout can be read back.
+  NO_FATALS(RunActionStdoutLines(Substitute(
+      "perf compaction_sim $0 --sim_rounds=0", kDumpPath), &stdout));
+  ASSERT_EQ(2, stdout.size());
+  ASSERT_STR_MATCHES(stdout[1], "^0\t3\t");
+}
+
+TEST_F(ToolTest, TestPerfTableScan) {
+  NO_FATALS(StartExternalMiniCluster());
+
+  // TestWorkLoad.Setup() internally generates a table.
+  TestWorkload workload(cluster_.get());
+  workload.set_num_tablets(3);
+  workload.set_num_replicas(1);
+  workload.Setup();
+  workload.Start();
+  while (workload.rows_inserted() < 1000) {
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+  workload.StopAndJoin();
+
+  string stdout;
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf table_scan $0 $1 --scan_num_threads=2 --scan_profile --list_tablets",
+      cluster_->master()->bound_rpc_addr().ToString(),
+      TestWorkload::kDefaultTableName), &stdout));
+  SCOPED_TRACE(stdout);
+  ASSERT_STR_MATCHES(stdout, "Scanned [0-9]+ rows \\([0-9]+ bytes\\) from 3 tablets");
+  ASSERT_STR_CONTAINS(stdout, "tablet scan time");
+  ASSERT_STR_CONTAINS(stdout, "queue_duration_nanos");
+
+  // With a projection, predicates and snapshot scans split in several ranges.
+  NO_FATALS(RunActionStdoutString(Substitute(
+      "perf table_scan $0 $1 --scan_columns=key,string_val "
+      "--scan_predicates=key>=0,int_val<1000000 --scan_read_mode=snapshot "
+      "--scan_fault_tolerant --scan_num_ranges_per_tablet=2",
+      cluster_->master()->bound_rpc_addr().ToString(),
+      TestWorkload::kDefaultTableName), &stdout));
+  ASSERT_STR_MATCHES(stdout, "Scanned [0-9]+ rows");
+
+  // Invalid predicates are rejected.
+  string stderr;
+  Status s = RunTool(Substitute(
+      "perf table_scan $0 $1 --scan_predicates=no_such_column=1",
+      cluster_->master()->bound_rpc_addr().ToString(),
+      TestWorkload::kDefaultTableName), nullptr, &stderr);
+  ASSERT_TRUE(s.IsRuntimeError());
+  ASSERT_STR_CONTAINS(stderr, "no such column");
+}
+
 TEST_F(ToolTest, TestFsDumpCFile) {
   const int kNumEntries = 8192;
   const string kTestDir = GetTestPath("test");
@@ -949,6 +1029,26 @@ TEST_F(ToolTest, TestLoadgenManualFlush) {
       "bench_manual_flush"));
 }
 
+// Run the loadgen benchmark with a mixed workload of lookups, range scans,
+// updates and deletes of skewed keys, at a limited rate of operations.
+TEST_F(ToolTest, TestLoadgenMixedWorkload) {
+  NO_FATALS(RunLoadgen(3,
+      {
+        "--delete_pct=0.05",
+        "--key_distribution=zipfian",
+        "--lookup_pct=0.4",
+        "--num_rows_per_thread=2048",
+        "--num_threads=2",
+        "--ops_per_sec=4000",
+        "--range_scan_pct=0.1",
+        "--range_scan_rows=16",
+        "--report_interval_sec=1",
+        "--run_scan",
+        "--update_pct=0.2",
+      },
+      "bench_mixed_workload"));
+}
+
 // Test 'kudu remote_replica copy' tool when the destination tablet server is online.
 // 1. Test the copy tool when the destination replica is healthy
 // 2. Test the copy tool when the destination replica is tombstoned
@@ -1139,6 +1239,80 @@ TEST_F(ToolTest, TestLocalReplicaDelete) {
   ASSERT_EQ(0, tablet_peers.size());
 }
 
+// Test 'kudu local_replica compact' on a replica with flushed and unflushed data.
+TEST_F(ToolTest, TestLocalReplicaCompact) {
+  NO_FATALS(StartMiniCluster());
+
+  TestWorkload workload(mini_cluster_.get());
+  workload.set_num_replicas(1);
+  workload.Setup();
+  workload.Start();
+
+  ASSERT_OK(mini_cluster_->WaitForTabletServerCount(1));
+  MiniTabletServer* ts = mini_cluster_->mini_tablet_server(0);
+  Tablet* tablet;
+  string tablet_id;
+  {
+    vector<scoped_refptr<TabletPeer>> tablet_peers;
+    ts->server()->tablet_manager()->GetTabletPeers(&tablet_peers);
+    ASSERT_EQ(1, tablet_peers.size());
+    tablet = tablet_peers[0]->tablet();
+    tablet_id = tablet_peers[0]->tablet_id();
+  }
+
+  // Flush a few times along the way to get several rowsets, leaving the last
+  // rows only in the WAL.
+  for (int i = 1; i <= 3; i++) {
+    while (workload.rows_inserted() < i * 3000) {
+      SleepFor(MonoDelta::FromMilliseconds(10));
+    }
+    ASSERT_OK(tablet->Flush());
+  }
+  while (workload.rows_inserted() < 10000) {
+    SleepFor(MonoDelta::FromMilliseconds(10));
+  }
+  workload.StopAndJoin();
+  ASSERT_GT(tablet->num_rowsets(), 1);
+  uint64_t rows_before;
+  ASSERT_OK(tablet->CountRows(&rows_before));
+
+  const string& tserver_dir = ts->options()->fs_opts.wal_path;
+  ts->Shutdown();
+
+  // An unknown codec is rejected before any tablet is touched.
+  string stderr;
+  Status s = RunTool(Substitute("local_replica compact $0 --fs_wal_dir=$1 --fs_data_dirs=$1 "
+                                "--compact_compression_codec=foo", tablet_id, tserver_dir),
+                     nullptr, &stderr, nullptr, nullptr);
+  ASSERT_TRUE(s.IsRuntimeError());
+  ASSERT_STR_CONTAINS(stderr, "unknown compression codec");
+
+  string stdout;
+  NO_FATALS(RunActionStdoutString(
+      Substitute("local_replica compact $0 --fs_wal_dir=$1 --fs_data_dirs=$1 "
+                 "--compact_compression_codec=LZ4", tablet_id, tserver_dir),
+      &stdout));
+  SCOPED_TRACE(stdout);
+  ASSERT_STR_CONTAINS(stdout, "-> 1 rowsets");
+  ASSERT_STR_CONTAINS(stdout, "Compacted 1 of 1 tablets");
+
+  // The replica comes back with the same rows, in a single LZ4-compressed rowset.
+  ASSERT_OK(ts->Start());
+  ASSERT_OK(ts->WaitStarted());
+  vector<scoped_refptr<TabletPeer>> tablet_peers;
+  ts->server()->tablet_manager()->GetTabletPeers(&tablet_peers);
+  ASSERT_EQ(1, tablet_peers.size());
+  ASSERT_OK(tablet_peers[0]->WaitUntilConsensusRunning(MonoDelta::FromSeconds(10)));
+  tablet = tablet_peers[0]->tablet();
+  ASSERT_EQ(1, tablet->num_rowsets());
+  uint64_t rows_after;
+  ASSERT_OK(tablet->CountRows(&rows_after));
+  ASSERT_EQ(rows_before, rows_after);
+  for (const ColumnSchema& col : tablet->schema()->columns()) {
+    ASSERT_EQ(LZ4, col.attributes().compression);
+  }
+}
+
 // Test 'kudu local_replica delete' tool for tombstoning the tablet.
 TEST_F(ToolTest, TestLocalReplicaTombstoneDelete) {
   NO_FATALS(StartMiniCluster());
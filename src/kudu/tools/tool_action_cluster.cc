@@ -131,6 +131,8 @@ unique_ptr<Mode> BuildClusterMode() {
       .ExtraDescription(extra_desc)
       .AddRequiredParameter({ kMasterAddressesArg, kMasterAddressesArgDesc })
       .AddOptionalParameter("checksum_cache_blocks")
+      .AddOptionalParameter("checksum_max_bytes_per_sec_per_tserver")
+      .AddOptionalParameter("checksum_ranges_per_tablet")
       .AddOptionalParameter("checksum_scan")
       .AddOptionalParameter("checksum_scan_concurrency")
       .AddOptionalParameter("checksum_snapshot")
@@ -25,6 +25,7 @@
 
 #include "kudu/cfile/cfile_reader.h"
 #include "kudu/cfile/cfile_util.h"
+#include "kudu/cfile/type_encodings.h"
 #include "kudu/common/common.pb.h"
 #include "kudu/common/row_changelist.h"
 #include "kudu/common/row_operations.h"
@@ -33,6 +34,8 @@
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus_meta.h"
 #include "kudu/consensus/consensus.pb.h"
+#include "kudu/consensus/log.h"
+#include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/log_index.h"
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/log_util.h"
@@ -46,13 +49,18 @@
 #include "kudu/gutil/strings/stringpiece.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/master/sys_catalog.h"
 #include "kudu/rpc/messenger.h"
+#include "kudu/server/hybrid_clock.h"
+#include "kudu/server/logical_clock.h"
 #include "kudu/tablet/cfile_set.h"
 #include "kudu/tablet/deltafile.h"
 #include "kudu/tablet/metadata.pb.h"
+#include "kudu/tablet/read_amplification.h"
 #include "kudu/tablet/rowset_metadata.h"
 #include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tools/tool_action_common.h"
 #include "kudu/tserver/tablet_copy_client.h"
 #include "kudu/tserver/ts_tablet_manager.h"
@@ -66,6 +74,8 @@
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/status.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_bool(dump_data, false,
             "Dump the data for each column in the rowset.");
@@ -82,6 +92,17 @@ DEFINE_bool(clean_unsafe, false,
             "This is not guaranteed to be safe because it also removes the "
             "consensus metadata (including Raft voting record) for the "
             "specified tablet, which violates the Raft vote durability requirements.");
+DEFINE_int32(compact_num_threads, 4,
+             "Number of tablets to compact in parallel.");
+DEFINE_string(compact_encoding, "",
+              "If set, the encoding to rewrite the columns with, e.g. "
+              "BIT_SHUFFLE or PLAIN_ENCODING. Columns whose type doesn't "
+              "support the encoding keep theirs.");
+DEFINE_string(compact_compression_codec, "",
+              "If set, the compression codec to rewrite the columns with, "
+              "e.g. LZ4, ZSTD or NO_COMPRESSION.");
+
+DECLARE_bool(use_hybrid_clock);
 
 namespace kudu {
 namespace tools {
@@ -90,11 +111,15 @@ using cfile::CFileIterator;
 using cfile::CFileReader;
 using cfile::DumpIterator;
 using cfile::ReaderOptions;
+using cfile::TypeEncodingInfo;
+using consensus::ConsensusBootstrapInfo;
 using consensus::ConsensusMetadata;
 using consensus::OpId;
 using consensus::RaftConfigPB;
 using consensus::RaftPeerPB;
 using fs::ReadableBlock;
+using log::Log;
+using log::LogAnchorRegistry;
 using log::LogEntryPB;
 using log::LogEntryReader;
 using log::LogIndex;
@@ -103,6 +128,9 @@ using log::ReadableLogSegment;
 using log::SegmentSequence;
 using rpc::Messenger;
 using rpc::MessengerBuilder;
+using server::Clock;
+using server::HybridClock;
+using server::LogicalClock;
 using std::cout;
 using std::endl;
 using std::list;
@@ -118,7 +146,9 @@ using tablet::DeltaIterator;
 using tablet::DeltaKeyAndUpdate;
 using tablet::DeltaType;
 using tablet::MvccSnapshot;
+using tablet::ReadAmplificationReport;
 using tablet::RowSetMetadata;
+using tablet::Tablet;
 using tablet::TabletMetadata;
 using tablet::TabletDataState;
 using tserver::TabletCopyClient;
@@ -329,6 +359,204 @@ Status DeleteLocalReplica(const RunnerContext& context) {
   return Status::OK();
 }
 
+// Parses --compact_encoding and --compact_compression_codec.
+Status ParseStorageAttributes(EncodingType* encoding, CompressionType* compression) {
+  *encoding = AUTO_ENCODING;
+  if (!FLAGS_compact_encoding.empty() &&
+      !EncodingType_Parse(FLAGS_compact_encoding, encoding)) {
+    return Status::InvalidArgument("unknown encoding", FLAGS_compact_encoding);
+  }
+  *compression = DEFAULT_COMPRESSION;
+  if (!FLAGS_compact_compression_codec.empty() &&
+      !CompressionType_Parse(FLAGS_compact_compression_codec, compression)) {
+    return Status::InvalidArgument("unknown compression codec",
+                                   FLAGS_compact_compression_codec);
+  }
+  return Status::OK();
+}
+
+// Rewrites 'schema' with the column encoding and compression requested by
+// --compact_encoding and --compact_compression_codec, if any.
+Status RewriteStorageAttributes(const Schema& schema, Schema* new_schema) {
+  EncodingType encoding;
+  CompressionType compression;
+  RETURN_NOT_OK(ParseStorageAttributes(&encoding, &compression));
+
+  SchemaPB schema_pb;
+  RETURN_NOT_OK(SchemaToPB(schema, &schema_pb));
+  for (int i = 0; i < schema.num_columns(); i++) {
+    ColumnSchemaPB* col = schema_pb.mutable_columns(i);
+    const TypeEncodingInfo* unused;
+    if (!FLAGS_compact_encoding.empty() &&
+        TypeEncodingInfo::Get(schema.column(i).type_info(), encoding, &unused).ok()) {
+      col->set_encoding(encoding);
+    }
+    if (!FLAGS_compact_compression_codec.empty()) {
+      col->set_compression(compression);
+    }
+  }
+  return SchemaFromPB(schema_pb, new_schema);
+}
+
+// The outcome of the compaction of a local replica.
+struct CompactResult {
+  Status status;
+  size_t rowsets_before = 0;
+  size_t rowsets_after = 0;
+  size_t size_before = 0;
+  size_t size_after = 0;
+  double elapsed_sec = 0;
+};
+
+// Bootstraps the local replica 'tablet_id', so that the operations not yet
+// flushed from its WAL are in memory, and then flushes and compacts all its
+// rowsets together with their deltas.
+Status CompactLocalReplica(FsManager* fs_manager,
+                           const scoped_refptr<Clock>& clock,
+                           const string& tablet_id,
+                           CompactResult* result) {
+  scoped_refptr<TabletMetadata> meta;
+  RETURN_NOT_OK(TabletMetadata::Load(fs_manager, tablet_id, &meta));
+  if (meta->tablet_data_state() != TabletDataState::TABLET_DATA_READY) {
+    return Status::IllegalState("the replica isn't ready",
+                                TabletDataState_Name(meta->tablet_data_state()));
+  }
+  if (!FLAGS_compact_encoding.empty() || !FLAGS_compact_compression_codec.empty()) {
+    // The tablet writes its rowsets with the attributes of the schema in its
+    // metadata. The schema version is kept: the master's schema is unchanged,
+    // and the next ALTER TABLE reverts the attributes for the later writes.
+    Schema new_schema;
+    RETURN_NOT_OK(RewriteStorageAttributes(meta->schema(), &new_schema));
+    meta->SetSchema(new_schema, meta->schema_version());
+    RETURN_NOT_OK(meta->Flush());
+  }
+
+  shared_ptr<Tablet> tablet;
+  scoped_refptr<Log> log;
+  ConsensusBootstrapInfo bootstrap_info;
+  RETURN_NOT_OK_PREPEND(tablet::BootstrapTablet(meta,
+                                                clock,
+                                                shared_ptr<MemTracker>(),
+                                                scoped_refptr<rpc::ResultTracker>(),
+                                                nullptr,
+                                                nullptr,
+                                                &tablet,
+                                                &log,
+                                                new LogAnchorRegistry(),
+                                                &bootstrap_info),
+                        "unable to bootstrap the replica");
+  result->rowsets_before = tablet->num_rowsets();
+  result->size_before = tablet->EstimateOnDiskSize();
+
+  // The merge compaction also compacts the deltas of the rowsets, including
+  // those still in memory, and drops the history older than
+  // --tablet_history_max_age_sec.
+  Status s = tablet->Flush();
+  if (s.ok()) {
+    s = tablet->Compact(Tablet::FORCE_COMPACT_ALL);
+  }
+  result->rowsets_after = tablet->num_rowsets();
+  result->size_after = tablet->EstimateOnDiskSize();
+  tablet->Shutdown();
+  WARN_NOT_OK(log->Close(), "unable to close the log of tablet " + tablet_id);
+  return s;
+}
+
+Status CompactLocalReplicas(const RunnerContext& context) {
+  const string& tablet_ids_str = FindOrDie(context.required_args, "tablet_ids");
+  vector<string> tablet_ids = Split(tablet_ids_str, ",", strings::SkipEmpty());
+  if (tablet_ids.empty()) {
+    return Status::InvalidArgument("no tablet identifier provided");
+  }
+  // Validate the attributes once rather than failing on every tablet.
+  EncodingType encoding;
+  CompressionType compression;
+  RETURN_NOT_OK(ParseStorageAttributes(&encoding, &compression));
+
+  FsManager fs_manager(Env::Default(), FsManagerOpts());
+  RETURN_NOT_OK(fs_manager.Open());
+
+  // Like the tablet server, timestamp the operations with a hybrid clock, so
+  // that the compactions can tell which history is ancient.
+  scoped_refptr<Clock> clock;
+  if (FLAGS_use_hybrid_clock) {
+    clock = new HybridClock();
+  } else {
+    clock = LogicalClock::CreateStartingAt(Timestamp::kInitialTimestamp);
+  }
+  RETURN_NOT_OK(clock->Init());
+
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("compact")
+                .set_max_threads(FLAGS_compact_num_threads)
+                .Build(&pool));
+  vector<CompactResult> results(tablet_ids.size());
+  for (size_t i = 0; i < tablet_ids.size(); i++) {
+    RETURN_NOT_OK(pool->SubmitFunc([&, i]() {
+          Stopwatch sw;
+          sw.start();
+          results[i].status = CompactLocalReplica(&fs_manager, clock, tablet_ids[i],
+                                                  &results[i]);
+          sw.stop();
+          results[i].elapsed_sec = sw.elapsed().wall_seconds();
+        }));
+  }
+  pool->Wait();
+
+  int num_failed = 0;
+  size_t total_before = 0;
+  size_t total_after = 0;
+  for (size_t i = 0; i < tablet_ids.size(); i++) {
+    const CompactResult& r = results[i];
+    cout << "Tablet " << tablet_ids[i] << ": ";
+    if (!r.status.ok()) {
+      num_failed++;
+      cout << "failed: " << r.status.ToString() << endl;
+      continue;
+    }
+    total_before += r.size_before;
+    total_after += r.size_after;
+    cout << Substitute("$0 rowsets ($1) -> $2 rowsets ($3) in $4s",
+                       r.rowsets_before, HumanReadableNumBytes::ToString(r.size_before),
+                       r.rowsets_after, HumanReadableNumBytes::ToString(r.size_after),
+                       StringPrintf("%.3f", r.elapsed_sec)) << endl;
+  }
+  cout << Substitute("Compacted $0 of $1 tablets: $2 -> $3",
+                     tablet_ids.size() - num_failed, tablet_ids.size(),
+                     HumanReadableNumBytes::ToString(total_before),
+                     HumanReadableNumBytes::ToString(total_after)) << endl;
+  if (num_failed > 0) {
+    return Status::RuntimeError(Substitute("$0 tablets failed to compact", num_failed));
+  }
+  return Status::OK();
+}
+
+Status PrintReadAmplification(const RunnerContext& context) {
+  unique_ptr<FsManager> fs_manager;
+  RETURN_NOT_OK(FsInit(&fs_manager));
+  const string& tablet_id = FindOrDie(context.required_args, kTabletIdArg);
+
+  scoped_refptr<TabletMetadata> meta;
+  RETURN_NOT_OK(TabletMetadata::Load(fs_manager.get(), tablet_id, &meta));
+  if (meta->tablet_data_state() != TabletDataState::TABLET_DATA_READY) {
+    return Status::IllegalState("the replica isn't ready",
+                                TabletDataState_Name(meta->tablet_data_state()));
+  }
+
+  // Only the rowsets are opened: the operations not yet flushed from the WAL
+  // aren't replayed, so the MemRowSet and the DeltaMemStores are empty.
+  Tablet tablet(meta,
+                LogicalClock::CreateStartingAt(Timestamp::kInitialTimestamp),
+                shared_ptr<MemTracker>(),
+                nullptr,
+                new LogAnchorRegistry());
+  RETURN_NOT_OK_PREPEND(tablet.Open(), "unable to open the replica");
+  ReadAmplificationReport report;
+  tablet.ComputeReadAmplification(&report);
+  cout << report.ToString();
+  return Status::OK();
+}
+
 Status DumpWals(const RunnerContext& context) {
   unique_ptr<FsManager> fs_manager;
   RETURN_NOT_OK(FsInit(&fs_manager));
@@ -524,7 +752,7 @@ Status DumpDeltaCFileBlockInternal(FsManager* fs_manager,
   // footer as to make it feasible iterate over all deltas using a
   // DeltaFileIterator alone.
   shared_ptr<CFileSet> cfileset;
-  RETURN_NOT_OK(CFileSet::Open(rs_meta, MemTracker::GetRootTracker(), &cfileset));
+  RETURN_NOT_OK(CFileSet::Open(rs_meta, MemTracker::GetRootTracker(), nullptr, &cfileset));
   gscoped_ptr<CFileSet::Iterator> cfileset_iter(cfileset->NewIterator(&schema));
 
   RETURN_NOT_OK(cfileset_iter->Init(NULL));
@@ -794,12 +1022,43 @@ unique_ptr<Mode> BuildLocalReplicaMode() {
       .AddOptionalParameter("clean_unsafe")
       .Build();
 
+  unique_ptr<Action> compact =
+      ActionBuilder("compact", &CompactLocalReplicas)
+      .Description("Compact tablet replicas in the local filesystem")
+      .ExtraDescription("Runs a full rowset and delta compaction of each "
+          "replica, which rewrites its data without the deleted rows, the "
+          "updates and the history older than --tablet_history_max_age_sec. "
+          "The tablet server must be stopped.")
+      .AddRequiredParameter({ "tablet_ids", "Comma-separated list of tablet "
+        "identifiers" })
+      .AddOptionalParameter("compact_compression_codec")
+      .AddOptionalParameter("compact_encoding")
+      .AddOptionalParameter("compact_num_threads")
+      .AddOptionalParameter("fs_wal_dir")
+      .AddOptionalParameter("fs_data_dirs")
+      .AddOptionalParameter("tablet_history_max_age_sec")
+      .Build();
+
+  unique_ptr<Action> read_amplification =
+      ActionBuilder("read_amplification", &PrintReadAmplification)
+      .Description("Print the read amplification of a local tablet replica")
+      .ExtraDescription("Reports the rowset height of the key space, the "
+          "delta stores a read merges per rowset and an estimate of the "
+          "bytes a point lookup reads from disk. The operations not yet "
+          "flushed from the WAL are not accounted for.")
+      .AddRequiredParameter({ kTabletIdArg, kTabletIdArgDesc })
+      .AddOptionalParameter("fs_wal_dir")
+      .AddOptionalParameter("fs_data_dirs")
+      .Build();
+
   return ModeBuilder("local_replica")
       .Description("Operate on local tablet replicas via the local filesystem")
       .AddMode(std::move(cmeta))
+      .AddAction(std::move(compact))
       .AddAction(std::move(copy_from_remote))
       .AddAction(std::move(delete_local_replica))
       .AddAction(std::move(list))
+      .AddAction(std::move(read_amplification))
       .AddMode(BuildDumpMode())
       .Build();
 }
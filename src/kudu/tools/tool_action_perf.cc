@@ -0,0 +1,758 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tools/tool_action.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <gflags/gflags.h>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "kudu/client/client.h"
+#include "kudu/client/resource_metrics.h"
+#include "kudu/client/scan_predicate.h"
+#include "kudu/client/value.h"
+#include "kudu/common/decimal_util.h"
+#include "kudu/common/types.h"
+#include "kudu/fs/block_manager.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/endian.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/gutil/stl_util.h"
+#include "kudu/gutil/strings/escaping.h"
+#include "kudu/gutil/strings/numbers.h"
+#include "kudu/gutil/strings/split.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tablet/cfile_set.h"
+#include "kudu/tablet/compaction_policy.h"
+#include "kudu/tablet/mock-rowsets.h"
+#include "kudu/tablet/rowset_info.h"
+#include "kudu/tablet/rowset_metadata.h"
+#include "kudu/tablet/rowset_tree.h"
+#include "kudu/tablet/tablet_metadata.h"
+#include "kudu/tools/tool_action_common.h"
+#include "kudu/util/env.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/mem_tracker.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+DECLARE_bool(list_tablets);
+DECLARE_int32(tablet_compaction_budget_mb);
+
+DEFINE_bool(local_replica, false,
+            "Whether <layout> is the ID of a tablet whose rowsets are read from "
+            "its local replica rather than the path to a rowset layout dump");
+DEFINE_string(dump_layout, "",
+              "If set, the path to which the rowset layout that was read is "
+              "written, in the format of a rowset layout dump");
+DEFINE_int32(sim_rounds, 100, "Number of simulated flushes");
+DEFINE_int32(sim_flush_mb, 64, "Size of each simulated flush, in MB");
+DEFINE_string(sim_write_pattern, "uniform",
+              "Key distribution of the simulated writes. 'uniform' flushes span "
+              "the whole key range of the tablet, 'sequential' flushes each "
+              "span a new range past all the existing keys, as in a "
+              "time-series table");
+DEFINE_int32(sim_compactions_per_flush, 1,
+             "Maximum number of compactions run after each simulated flush");
+DEFINE_int32(sim_report_interval, 10,
+             "Number of simulated flushes between two reports");
+DEFINE_string(scan_columns, "",
+              "Comma-separated list of the columns to scan. If empty, "
+              "all the columns are scanned");
+DEFINE_string(scan_predicates, "",
+              "Comma-separated list of predicates the scanned rows satisfy, "
+              "each of the form <column><op><value> with <op> one of "
+              "'=', '<', '<=', '>' and '>=', e.g. 'key>=100,name=foo'");
+DEFINE_int32(scan_num_threads, 4,
+             "Number of scan tokens scanned concurrently");
+DEFINE_int32(scan_num_ranges_per_tablet, 1,
+             "Number of scan tokens to split the key range of each tablet "
+             "into, so that a tablet can be scanned by several threads");
+DEFINE_string(scan_read_mode, "latest",
+              "Read mode of the scans: 'latest' or 'snapshot'");
+DEFINE_bool(scan_fault_tolerant, false,
+            "Whether the scans are fault-tolerant, i.e. return their rows in "
+            "key order and resume on another replica if the scanned one "
+            "fails. Implies --scan_read_mode=snapshot");
+DEFINE_int32(scan_batch_size_bytes, 0,
+             "Hint for the size of the batches returned by the tablet "
+             "servers. 0 uses the default of the client");
+DEFINE_bool(scan_profile, false,
+            "Whether the tablet servers return a profile of the scans, "
+            "which is added to the reported resource metrics");
+
+using std::cout;
+using std::endl;
+using std::map;
+using std::mutex;
+using std::shared_ptr;
+using std::string;
+using std::thread;
+using std::unique_ptr;
+using std::unordered_set;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+
+using client::KuduClient;
+using client::KuduClientBuilder;
+using client::KuduColumnSchema;
+using client::KuduPredicate;
+using client::KuduScanBatch;
+using client::KuduScanToken;
+using client::KuduScanTokenBuilder;
+using client::KuduScanner;
+using client::KuduTable;
+using client::KuduValue;
+using fs::ReadableBlock;
+using tablet::BudgetedCompactionPolicy;
+using tablet::CFileSet;
+using tablet::MockDiskRowSet;
+using tablet::RowSet;
+using tablet::RowSetInfo;
+using tablet::RowSetMetadata;
+using tablet::RowSetTree;
+using tablet::RowSetVector;
+using tablet::TabletMetadata;
+
+namespace tools {
+
+namespace {
+
+const char* const kLayoutArg = "layout";
+const char* const kTableNameArg = "table_name";
+
+const uint64_t kMB = 1024 * 1024;
+
+struct SimStats {
+  uint64_t bytes_flushed = 0;
+  uint64_t bytes_compacted_read = 0;
+  uint64_t bytes_compacted_written = 0;
+  int compactions = 0;
+};
+
+Status SumBlockSizes(FsManager* fs_manager, const vector<BlockId>& blocks,
+                     uint64_t* total) {
+  for (const BlockId& block_id : blocks) {
+    gscoped_ptr<ReadableBlock> block;
+    RETURN_NOT_OK(fs_manager->OpenBlock(block_id, &block));
+    uint64_t size;
+    RETURN_NOT_OK(block->Size(&size));
+    *total += size;
+  }
+  return Status::OK();
+}
+
+// Reads the bounds and sizes of the flushed rowsets of the local replica of
+// tablet 'tablet_id' into MockDiskRowSets.
+Status LoadLocalReplicaLayout(const string& tablet_id, RowSetVector* rowsets) {
+  FsManagerOpts fs_opts;
+  fs_opts.read_only = true;
+  FsManager fs_manager(Env::Default(), fs_opts);
+  RETURN_NOT_OK(fs_manager.Open());
+
+  scoped_refptr<TabletMetadata> meta;
+  RETURN_NOT_OK(TabletMetadata::Load(&fs_manager, tablet_id, &meta));
+  for (const shared_ptr<RowSetMetadata>& rs_meta : meta->rowsets()) {
+    shared_ptr<CFileSet> cfile_set;
+    RETURN_NOT_OK_PREPEND(CFileSet::Open(rs_meta, MemTracker::GetRootTracker(),
+                                         nullptr, &cfile_set),
+                          Substitute("could not open rowset $0", rs_meta->id()));
+    string min_key, max_key;
+    RETURN_NOT_OK(cfile_set->GetBounds(&min_key, &max_key));
+
+    uint64_t delta_size = 0;
+    RETURN_NOT_OK(SumBlockSizes(&fs_manager, rs_meta->redo_delta_blocks(), &delta_size));
+    RETURN_NOT_OK(SumBlockSizes(&fs_manager, rs_meta->undo_delta_blocks(), &delta_size));
+    rowsets->push_back(std::make_shared<MockDiskRowSet>(
+        min_key, max_key, cfile_set->EstimateOnDiskSize() + delta_size, delta_size));
+  }
+  return Status::OK();
+}
+
+// Writes 'rowsets' in the format read by tablet::ParseMockRowSetLayout().
+Status DumpLayout(const RowSetVector& rowsets, const string& path) {
+  faststring out;
+  out.append("# size_mb\tmin_key\tmax_key\tdelta_mb\n");
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    const auto* mock = down_cast<MockDiskRowSet*>(rs.get());
+    string min_key, max_key;
+    RETURN_NOT_OK(mock->GetBounds(&min_key, &max_key));
+    // The layout holds whole MBs, and rowsets of at least one.
+    uint64_t size_mb = std::max<uint64_t>(1, (mock->EstimateOnDiskSize() + kMB / 2) / kMB);
+    uint64_t delta_mb = std::min(size_mb, (mock->delta_size() + kMB / 2) / kMB);
+    out.append(Substitute("$0\t$1\t$2\t$3\n",
+                          size_mb,
+                          strings::CHexEscape(min_key),
+                          strings::CHexEscape(max_key),
+                          delta_mb));
+  }
+  return WriteStringToFile(Env::Default(), out, path);
+}
+
+// Returns a key between 'min' and 'max' at 'fraction' of the way between
+// them, interpolating the eight bytes which follow their common prefix the
+// same way RowSetInfo does to compute the cdf.
+string InterpolateKey(const string& min, const string& max, double fraction) {
+  size_t prefix = 0;
+  while (prefix < min.size() && prefix < max.size() && min[prefix] == max[prefix]) {
+    prefix++;
+  }
+  auto tail = [&](const string& key) {
+    uint64_t v = 0;
+    memcpy(&v, key.data() + prefix, std::min<size_t>(8, key.size() - prefix));
+    return BigEndian::ToHost64(v);
+  };
+  uint64_t lo = tail(min);
+  uint64_t hi = tail(max);
+  uint64_t v = lo + static_cast<uint64_t>((hi - lo) * fraction);
+  string ret = min.substr(0, prefix);
+  char buf[8];
+  BigEndian::Store64(buf, v);
+  ret.append(buf, sizeof(buf));
+  return std::max(min, std::min(ret, max));
+}
+
+// Returns the key which sorts immediately after 'key'.
+string SuccessorKey(const string& key) {
+  return key + string(1, '\0');
+}
+
+Status GetGlobalBounds(const RowSetVector& rowsets, string* min_key, string* max_key) {
+  bool first = true;
+  for (const shared_ptr<RowSet>& rs : rowsets) {
+    string rs_min, rs_max;
+    RETURN_NOT_OK(rs->GetBounds(&rs_min, &rs_max));
+    if (first || rs_min < *min_key) *min_key = rs_min;
+    if (first || rs_max > *max_key) *max_key = rs_max;
+    first = false;
+  }
+  return Status::OK();
+}
+
+// Replaces the rowsets in 'picked' by the output of their compaction: rowsets
+// of about 'target_size' bytes which evenly split the union of their key ranges,
+// and which no longer carry any deltas.
+Status SimulateCompaction(const unordered_set<RowSet*>& picked, uint64_t target_size,
+                          RowSetVector* rowsets, SimStats* stats) {
+  RowSetVector inputs;
+  RowSetVector remaining;
+  for (const shared_ptr<RowSet>& rs : *rowsets) {
+    if (ContainsKey(picked, rs.get())) {
+      inputs.push_back(rs);
+    } else {
+      remaining.push_back(rs);
+    }
+  }
+
+  string min_key, max_key;
+  RETURN_NOT_OK(GetGlobalBounds(inputs, &min_key, &max_key));
+  uint64_t bytes_read = 0;
+  uint64_t bytes_written = 0;
+  for (const shared_ptr<RowSet>& rs : inputs) {
+    const auto* mock = down_cast<MockDiskRowSet*>(rs.get());
+    bytes_read += mock->EstimateOnDiskSize();
+    bytes_written += mock->EstimateOnDiskSize() - mock->delta_size();
+  }
+
+  int num_outputs = std::max<int>(
+      1, static_cast<int>(std::ceil(static_cast<double>(bytes_written) / target_size)));
+  string lower = min_key;
+  for (int i = 0; i < num_outputs; i++) {
+    string upper = i == num_outputs - 1 ?
+        max_key : InterpolateKey(min_key, max_key, static_cast<double>(i + 1) / num_outputs);
+    remaining.push_back(std::make_shared<MockDiskRowSet>(
+        lower, std::max(lower, upper), bytes_written / num_outputs));
+    lower = SuccessorKey(upper);
+  }
+
+  stats->bytes_compacted_read += bytes_read;
+  stats->bytes_compacted_written += bytes_written;
+  stats->compactions++;
+  rowsets->swap(remaining);
+  return Status::OK();
+}
+
+// Returns the average number of rowsets a key lookup has to consult, i.e.
+// the sum of the widths of the rowsets in the cdf.
+double AverageHeight(const RowSetTree& tree) {
+  vector<RowSetInfo> min_key, max_key;
+  RowSetInfo::CollectOrdered(tree, &min_key, &max_key);
+  double height = 0;
+  for (const RowSetInfo& info : min_key) {
+    height += info.width();
+  }
+  return height;
+}
+
+void PrintReport(int round, const RowSetTree& tree, const SimStats& stats) {
+  double write_amp = stats.bytes_flushed == 0 ? 0 :
+      static_cast<double>(stats.bytes_flushed + stats.bytes_compacted_written) /
+      stats.bytes_flushed;
+  cout << Substitute("$0\t$1\t$2\t$3\t$4\t$5\t$6\t$7",
+                     round,
+                     tree.all_rowsets().size(),
+                     AverageHeight(tree),
+                     stats.compactions,
+                     stats.bytes_flushed / kMB,
+                     stats.bytes_compacted_read / kMB,
+                     stats.bytes_compacted_written / kMB,
+                     write_amp)
+       << endl;
+}
+
+Status SimulateCompactions(const RunnerContext& context) {
+  const string& layout = FindOrDie(context.required_args, kLayoutArg);
+  if (FLAGS_sim_write_pattern != "uniform" && FLAGS_sim_write_pattern != "sequential") {
+    return Status::InvalidArgument("unknown write pattern", FLAGS_sim_write_pattern);
+  }
+
+  RowSetVector rowsets;
+  if (FLAGS_local_replica) {
+    RETURN_NOT_OK(LoadLocalReplicaLayout(layout, &rowsets));
+  } else {
+    faststring data;
+    RETURN_NOT_OK(ReadFileToString(Env::Default(), layout, &data));
+    RETURN_NOT_OK(tablet::ParseMockRowSetLayout(data.ToString(), &rowsets));
+  }
+  if (!FLAGS_dump_layout.empty()) {
+    RETURN_NOT_OK(DumpLayout(rowsets, FLAGS_dump_layout));
+  }
+
+  string initial_min_key = "";
+  string initial_max_key = "";
+  RETURN_NOT_OK(GetGlobalBounds(rowsets, &initial_min_key, &initial_max_key));
+
+  BudgetedCompactionPolicy policy(FLAGS_tablet_compaction_budget_mb);
+  SimStats stats;
+  RowSetTree tree;
+  RETURN_NOT_OK(tree.Reset(rowsets));
+  cout << "round\trowsets\tavg_height\tcompactions\tflushed_mb\t"
+       << "compacted_read_mb\tcompacted_written_mb\twrite_amp" << endl;
+  PrintReport(0, tree, stats);
+
+  for (int round = 1; round <= FLAGS_sim_rounds; round++) {
+    // Flush.
+    string flush_min, flush_max;
+    if (FLAGS_sim_write_pattern == "sequential" || rowsets.empty()) {
+      char buf[8];
+      BigEndian::Store64(buf, 2 * round);
+      flush_min = initial_max_key + string(buf, sizeof(buf));
+      BigEndian::Store64(buf, 2 * round + 1);
+      flush_max = initial_max_key + string(buf, sizeof(buf));
+    } else {
+      RETURN_NOT_OK(GetGlobalBounds(rowsets, &flush_min, &flush_max));
+    }
+    uint64_t flush_size = FLAGS_sim_flush_mb * kMB;
+    rowsets.push_back(std::make_shared<MockDiskRowSet>(flush_min, flush_max, flush_size));
+    stats.bytes_flushed += flush_size;
+    RETURN_NOT_OK(tree.Reset(rowsets));
+
+    // Compact.
+    for (int i = 0; i < FLAGS_sim_compactions_per_flush; i++) {
+      unordered_set<RowSet*> picked;
+      double quality;
+      RETURN_NOT_OK(policy.PickRowSets(tree, &picked, &quality, nullptr));
+      if (picked.empty()) break;
+      RETURN_NOT_OK(SimulateCompaction(picked, policy.target_rowset_size(),
+                                       &rowsets, &stats));
+      RETURN_NOT_OK(tree.Reset(rowsets));
+    }
+
+    if (round % FLAGS_sim_report_interval == 0 || round == FLAGS_sim_rounds) {
+      PrintReport(round, tree, stats);
+    }
+  }
+  return Status::OK();
+}
+
+// Parses a predicate of the form <column><op><value>, as in --scan_predicates.
+Status ParsePredicate(KuduTable* table, const string& str, KuduPredicate** pred) {
+  // Two-character operators first, so that '<=' isn't parsed as '<'.
+  static const struct {
+    const char* op;
+    KuduPredicate::ComparisonOp cmp;
+  } kOps[] = {
+    { "<=", KuduPredicate::LESS_EQUAL },
+    { ">=", KuduPredicate::GREATER_EQUAL },
+    { "=", KuduPredicate::EQUAL },
+    { "<", KuduPredicate::LESS },
+    { ">", KuduPredicate::GREATER },
+  };
+  size_t pos = str.find_first_of("<=>");
+  if (pos == string::npos || pos == 0) {
+    return Status::InvalidArgument("invalid predicate", str);
+  }
+  const string column_name = str.substr(0, pos);
+  string value_str;
+  KuduPredicate::ComparisonOp cmp = KuduPredicate::EQUAL;
+  for (const auto& op : kOps) {
+    if (str.compare(pos, strlen(op.op), op.op) == 0) {
+      cmp = op.cmp;
+      value_str = str.substr(pos + strlen(op.op));
+      break;
+    }
+  }
+
+  size_t idx = table->schema().num_columns();
+  for (size_t i = 0; i < table->schema().num_columns(); i++) {
+    if (table->schema().Column(i).name() == column_name) {
+      idx = i;
+      break;
+    }
+  }
+  if (idx == table->schema().num_columns()) {
+    return Status::NotFound("no such column", column_name);
+  }
+
+  KuduValue* value = nullptr;
+  switch (table->schema().Column(idx).type()) {
+    case KuduColumnSchema::INT8:
+    case KuduColumnSchema::INT16:
+    case KuduColumnSchema::INT32:
+    case KuduColumnSchema::INT64:
+    case KuduColumnSchema::UNIXTIME_MICROS: {
+      int64_t v;
+      if (safe_strto64(value_str, &v)) {
+        value = KuduValue::FromInt(v);
+      }
+      break;
+    }
+    case KuduColumnSchema::FLOAT: {
+      float v;
+      if (safe_strtof(value_str.c_str(), &v)) {
+        value = KuduValue::FromFloat(v);
+      }
+      break;
+    }
+    case KuduColumnSchema::DOUBLE: {
+      double v;
+      if (safe_strtod(value_str.c_str(), &v)) {
+        value = KuduValue::FromDouble(v);
+      }
+      break;
+    }
+    case KuduColumnSchema::BOOL:
+      if (value_str == "true" || value_str == "false") {
+        value = KuduValue::FromBool(value_str == "true");
+      }
+      break;
+    case KuduColumnSchema::STRING:
+    case KuduColumnSchema::BINARY:
+      value = KuduValue::CopyString(value_str);
+      break;
+    case KuduColumnSchema::DECIMAL:
+      return Status::NotSupported("predicates on decimal columns", column_name);
+  }
+  if (value == nullptr) {
+    return Status::InvalidArgument(
+        Substitute("invalid value for column $0", column_name), value_str);
+  }
+  *pred = table->NewComparisonPredicate(column_name, cmp, value);
+  return Status::OK();
+}
+
+// Returns the size of the cells of 'col', or 0 for the variable-length types.
+int FixedCellSize(const KuduColumnSchema& col) {
+  switch (col.type()) {
+    case KuduColumnSchema::INT8:
+    case KuduColumnSchema::BOOL:
+      return 1;
+    case KuduColumnSchema::INT16:
+      return 2;
+    case KuduColumnSchema::INT32:
+    case KuduColumnSchema::FLOAT:
+      return 4;
+    case KuduColumnSchema::INT64:
+    case KuduColumnSchema::DOUBLE:
+    case KuduColumnSchema::UNIXTIME_MICROS:
+      return 8;
+    case KuduColumnSchema::DECIMAL:
+      return GetTypeInfo(MaxPrecisionToDecimalType(col.type_attributes().precision()))->size();
+    case KuduColumnSchema::STRING:
+    case KuduColumnSchema::BINARY:
+      return 0;
+  }
+  return 0;
+}
+
+// Returns the size of the data of the cells of 'batch': the size of the
+// fixed-length cells, and that of the values of the non-null variable-length
+// cells.
+Status ScanBatchBytes(const KuduScanBatch& batch, uint64_t* bytes) {
+  const client::KuduSchema* schema = batch.projection_schema();
+  uint64_t total = 0;
+  vector<int> var_len_columns;
+  for (int i = 0; i < schema->num_columns(); i++) {
+    int size = FixedCellSize(schema->Column(i));
+    if (size == 0) {
+      var_len_columns.push_back(i);
+    }
+    total += static_cast<uint64_t>(size) * batch.NumRows();
+  }
+  if (!var_len_columns.empty()) {
+    for (KuduScanBatch::RowPtr row : batch) {
+      for (int idx : var_len_columns) {
+        if (row.IsNull(idx)) {
+          continue;
+        }
+        Slice value;
+        if (schema->Column(idx).type() == KuduColumnSchema::STRING) {
+          RETURN_NOT_OK(row.GetString(idx, &value));
+        } else {
+          RETURN_NOT_OK(row.GetBinary(idx, &value));
+        }
+        total += value.size();
+      }
+    }
+  }
+  *bytes += total;
+  return Status::OK();
+}
+
+// The outcome of the scan of one token.
+struct TokenScanResult {
+  Status status;
+  uint64_t rows = 0;
+  uint64_t bytes = 0;
+  MonoDelta elapsed;
+};
+
+Status ScanToken(const KuduScanToken& token, TokenScanResult* result,
+                 map<string, int64_t>* resource_metrics) {
+  KuduScanner* scanner_ptr;
+  RETURN_NOT_OK(token.IntoKuduScanner(&scanner_ptr));
+  unique_ptr<KuduScanner> scanner(scanner_ptr);
+  if (FLAGS_scan_profile) {
+    RETURN_NOT_OK(scanner->SetProfiling(true));
+  }
+  MonoTime start = MonoTime::Now();
+  RETURN_NOT_OK(scanner->Open());
+  KuduScanBatch batch;
+  while (scanner->HasMoreRows()) {
+    RETURN_NOT_OK(scanner->NextBatch(&batch));
+    result->rows += batch.NumRows();
+    RETURN_NOT_OK(ScanBatchBytes(batch, &result->bytes));
+  }
+  result->elapsed = MonoTime::Now() - start;
+  for (const auto& e : scanner->GetResourceMetrics().Get()) {
+    (*resource_metrics)[e.first] += e.second;
+  }
+  return Status::OK();
+}
+
+Status TableScan(const RunnerContext& context) {
+  const string& master_addresses_str = FindOrDie(context.required_args,
+                                                 kMasterAddressesArg);
+  vector<string> master_addresses = strings::Split(master_addresses_str, ",");
+  const string& table_name = FindOrDie(context.required_args, kTableNameArg);
+  if (FLAGS_scan_num_threads <= 0) {
+    return Status::InvalidArgument("the number of threads must be positive");
+  }
+
+  client::sp::shared_ptr<KuduClient> client;
+  RETURN_NOT_OK(KuduClientBuilder()
+                .master_server_addrs(master_addresses)
+                .Build(&client));
+  client::sp::shared_ptr<KuduTable> table;
+  RETURN_NOT_OK(client->OpenTable(table_name, &table));
+
+  KuduScanTokenBuilder builder(table.get());
+  if (!FLAGS_scan_columns.empty()) {
+    RETURN_NOT_OK(builder.SetProjectedColumnNames(
+        strings::Split(FLAGS_scan_columns, ",", strings::SkipEmpty())));
+  }
+  for (const string& str : strings::Split(FLAGS_scan_predicates, ",",
+                                          strings::SkipEmpty())) {
+    KuduPredicate* pred;
+    RETURN_NOT_OK(ParsePredicate(table.get(), str, &pred));
+    RETURN_NOT_OK(builder.AddConjunctPredicate(pred));
+  }
+  if (FLAGS_scan_read_mode == "snapshot") {
+    RETURN_NOT_OK(builder.SetReadMode(KuduScanner::READ_AT_SNAPSHOT));
+  } else if (FLAGS_scan_read_mode != "latest") {
+    return Status::InvalidArgument("unknown read mode", FLAGS_scan_read_mode);
+  }
+  if (FLAGS_scan_fault_tolerant) {
+    RETURN_NOT_OK(builder.SetFaultTolerant());
+  }
+  if (FLAGS_scan_batch_size_bytes > 0) {
+    RETURN_NOT_OK(builder.SetBatchSizeBytes(FLAGS_scan_batch_size_bytes));
+  }
+  RETURN_NOT_OK(builder.SetNumRangesPerTablet(FLAGS_scan_num_ranges_per_tablet));
+  vector<KuduScanToken*> tokens;
+  ElementDeleter deleter(&tokens);
+  RETURN_NOT_OK(builder.Build(&tokens));
+
+  // The threads scan the next token which no thread scanned yet.
+  vector<TokenScanResult> results(tokens.size());
+  map<string, int64_t> resource_metrics;
+  mutex lock;
+  size_t next_token = 0;
+  auto scan_tokens = [&]() {
+    map<string, int64_t> thread_metrics;
+    while (true) {
+      size_t idx;
+      {
+        std::lock_guard<mutex> l(lock);
+        if (next_token == tokens.size()) {
+          break;
+        }
+        idx = next_token++;
+      }
+      results[idx].status = ScanToken(*tokens[idx], &results[idx], &thread_metrics);
+    }
+    std::lock_guard<mutex> l(lock);
+    for (const auto& e : thread_metrics) {
+      resource_metrics[e.first] += e.second;
+    }
+  };
+  MonoTime start = MonoTime::Now();
+  vector<thread> threads;
+  for (int i = 0; i < FLAGS_scan_num_threads; i++) {
+    threads.emplace_back(scan_tokens);
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  const double elapsed_sec = std::max((MonoTime::Now() - start).ToSeconds(), 1e-6);
+
+  // Sum up the token scans per tablet.
+  map<string, TokenScanResult> tablets;
+  uint64_t total_rows = 0;
+  uint64_t total_bytes = 0;
+  for (size_t i = 0; i < tokens.size(); i++) {
+    RETURN_NOT_OK_PREPEND(results[i].status, Substitute(
+        "failed to scan tablet $0", tokens[i]->tablet().id()));
+    TokenScanResult& tablet = tablets[tokens[i]->tablet().id()];
+    tablet.rows += results[i].rows;
+    tablet.bytes += results[i].bytes;
+    tablet.elapsed = MonoDelta::FromNanoseconds(
+        tablet.elapsed.ToNanoseconds() + results[i].elapsed.ToNanoseconds());
+    total_rows += results[i].rows;
+    total_bytes += results[i].bytes;
+  }
+
+  cout << Substitute("Scanned $0 rows ($1 bytes) from $2 tablets in $3 tokens "
+                     "in $4 s with $5 threads",
+                     total_rows, total_bytes, tablets.size(), tokens.size(),
+                     elapsed_sec, FLAGS_scan_num_threads) << endl;
+  cout << Substitute("  rows/s: $0", static_cast<int64_t>(total_rows / elapsed_sec)) << endl;
+  cout << Substitute("  MB/s  : $0", total_bytes / elapsed_sec / kMB) << endl;
+
+  // The skew is the ratio of the time spent scanning the slowest tablet to
+  // the average time spent scanning a tablet.
+  if (!tablets.empty()) {
+    double min_sec = std::numeric_limits<double>::max();
+    double max_sec = 0;
+    double sum_sec = 0;
+    for (const auto& e : tablets) {
+      double sec = e.second.elapsed.ToSeconds();
+      min_sec = std::min(min_sec, sec);
+      max_sec = std::max(max_sec, sec);
+      sum_sec += sec;
+    }
+    double mean_sec = sum_sec / tablets.size();
+    cout << Substitute("  tablet scan time (s): min $0, mean $1, max $2, skew $3",
+                       min_sec, mean_sec, max_sec,
+                       mean_sec > 0 ? max_sec / mean_sec : 1.0) << endl;
+  }
+  if (FLAGS_list_tablets) {
+    cout << endl << "tablet\trows\tbytes\tscan_time_s" << endl;
+    for (const auto& e : tablets) {
+      cout << Substitute("$0\t$1\t$2\t$3", e.first, e.second.rows, e.second.bytes,
+                         e.second.elapsed.ToSeconds()) << endl;
+    }
+  }
+  if (!resource_metrics.empty()) {
+    cout << endl << "Resource metrics:" << endl;
+    for (const auto& e : resource_metrics) {
+      cout << "  " << e.first << ": " << e.second << endl;
+    }
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+unique_ptr<Mode> BuildPerfMode() {
+  unique_ptr<Action> compaction_sim =
+      ActionBuilder("compaction_sim", &SimulateCompactions)
+      .Description("Simulate the compaction policy on a rowset layout")
+      .ExtraDescription("Replays flushes onto the rowset layout of a tablet "
+                        "and compacts the rowsets picked by the compaction "
+                        "policy, without doing any I/O. Reports the average "
+                        "rowset height, the number of rowsets and the write "
+                        "amplification as the simulation progresses. The "
+                        "policy's decisions can also be drawn as SVGs with "
+                        "--compaction_policy_dump_svgs_pattern.")
+      .AddRequiredParameter({ kLayoutArg, "Path to a rowset layout dump, or "
+                              "the tablet ID if --local_replica is set" })
+      .AddOptionalParameter("dump_layout")
+      .AddOptionalParameter("fs_wal_dir")
+      .AddOptionalParameter("fs_data_dirs")
+      .AddOptionalParameter("local_replica")
+      .AddOptionalParameter("sim_compactions_per_flush")
+      .AddOptionalParameter("sim_flush_mb")
+      .AddOptionalParameter("sim_report_interval")
+      .AddOptionalParameter("sim_rounds")
+      .AddOptionalParameter("sim_write_pattern")
+      .AddOptionalParameter("tablet_compaction_budget_mb")
+      .Build();
+
+  unique_ptr<Action> table_scan =
+      ActionBuilder("table_scan", &TableScan)
+      .Description("Measure the throughput of a parallel scan of a table")
+      .ExtraDescription("Splits the scan of the table into scan tokens, "
+                        "scanned concurrently by --scan_num_threads threads, "
+                        "and reports the rows and bytes scanned per second, "
+                        "the skew of the time spent scanning each tablet, and "
+                        "the resource metrics returned by the tablet servers.")
+      .AddRequiredParameter({ kMasterAddressesArg, kMasterAddressesArgDesc })
+      .AddRequiredParameter({ kTableNameArg, "Name of the table to scan" })
+      .AddOptionalParameter("list_tablets")
+      .AddOptionalParameter("scan_batch_size_bytes")
+      .AddOptionalParameter("scan_columns")
+      .AddOptionalParameter("scan_fault_tolerant")
+      .AddOptionalParameter("scan_num_ranges_per_tablet")
+      .AddOptionalParameter("scan_num_threads")
+      .AddOptionalParameter("scan_predicates")
+      .AddOptionalParameter("scan_profile")
+      .AddOptionalParameter("scan_read_mode")
+      .Build();
+
+  return ModeBuilder("perf")
+      .Description("Evaluate the performance of a Kudu cluster and of its "
+                   "internal policies")
+      .AddAction(std::move(compaction_sim))
+      .AddAction(std::move(table_scan))
+      .Build();
+}
+
+} // namespace tools
+} // namespace kudu
@@ -83,6 +83,38 @@
 //     --run_scan=true \
 //     127.0.0.1
 //
+//
+// Run a mixed workload for 5 minutes with 8 threads against an existing table
+// populated by a previous run with the same '--num_threads' and
+// '--num_rows_per_thread' parameters: 80% of point lookups and 10% of range
+// scans of 100 rows, with the keys drawn from a zipfian distribution,
+// and 10% of updates, at 10000 operations per second in total, reporting
+// the throughput and latencies of every type of operation every 10 seconds:
+//
+//   kudu test loadgen \
+//     --num_threads=8 \
+//     --num_rows_per_thread=1000000 \
+//     --lookup_pct=0.8 \
+//     --range_scan_pct=0.1 \
+//     --range_scan_rows=100 \
+//     --update_pct=0.1 \
+//     --key_distribution=zipfian \
+//     --ops_per_sec=10000 \
+//     --run_time_sec=300 \
+//     --report_interval_sec=10 \
+//     --table_name=bench_01 \
+//     127.0.0.1
+//
+// In a mixed workload, the operations other than inserts target the rows
+// which the thread inserted so far or, if the workload has no inserts,
+// the rows it would have inserted in an insert-only run. The latency of
+// a write is the time spent in KuduSession::Apply(), which only blocks once
+// the mutation buffers are full; the latency of a lookup or a range scan
+// spans opening the scanner to reading its last row. When the rate of
+// operations is limited, the latencies are measured from the time each
+// operation was scheduled to start, so that the time spent waiting behind
+// a slow operation is accounted for.
+//
 
 #include "kudu/tools/tool_action.h"
 
@@ -92,6 +124,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <limits>
@@ -102,13 +135,20 @@
 #include <vector>
 
 #include <gflags/gflags.h>
+#include <glog/logging.h>
 
 #include "kudu/client/client.h"
+#include "kudu/client/scan_predicate.h"
+#include "kudu/client/value.h"
 #include "kudu/common/schema.h"
 #include "kudu/common/types.h"
 #include "kudu/gutil/strings/split.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/tools/tool_action_common.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/hdr_histogram.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/random.h"
 #include "kudu/util/stopwatch.h"
@@ -120,8 +160,10 @@ using kudu::TypeInfo;
 using kudu::client::KuduClient;
 using kudu::client::KuduClientBuilder;
 using kudu::client::KuduColumnSchema;
+using kudu::client::KuduDelete;
 using kudu::client::KuduError;
 using kudu::client::KuduInsert;
+using kudu::client::KuduPredicate;
 using kudu::client::KuduRowResult;
 using kudu::client::KuduSchema;
 using kudu::client::KuduSchemaBuilder;
@@ -130,6 +172,8 @@ using kudu::client::KuduScanner;
 using kudu::client::KuduSession;
 using kudu::client::KuduTable;
 using kudu::client::KuduTableCreator;
+using kudu::client::KuduUpdate;
+using kudu::client::KuduValue;
 using kudu::client::sp::shared_ptr;
 using std::accumulate;
 using std::cerr;
@@ -152,6 +196,9 @@ DEFINE_int32(buffer_size_bytes, 4 * 1024 * 1024,
              "Size of the mutation buffer, per session (bytes).");
 DEFINE_int32(buffers_num, 2,
              "Number of mutation buffers per session.");
+DEFINE_double(delete_pct, 0.0,
+              "Fraction of the operations which delete a row, "
+              "between 0.0 and 1.0. See '--lookup_pct'.");
 DEFINE_int32(flush_per_n_rows, 0,
              "Perform async flush per given number of rows added. "
              "Setting to non-zero implicitly turns on manual flush mode.");
@@ -163,18 +210,49 @@ DEFINE_bool(keep_auto_table, false,
             "has no effect if using already existing table "
             "(see the '--table_name' flag): the existing tables nor their data "
             "are never dropped/deleted.");
+DEFINE_string(key_distribution, "uniform",
+              "Distribution of the keys of the rows targeted by the operations "
+              "other than inserts, among the rows inserted by the thread: "
+              "'uniform', 'zipfian' (the first inserted rows are the most "
+              "popular) or 'latest' (the last inserted rows are the most "
+              "popular). See also '--zipfian_theta'.");
+DEFINE_double(lookup_pct, 0.0,
+              "Fraction of the operations which look up a row by its key, "
+              "between 0.0 and 1.0. The fractions of lookups, range scans, "
+              "updates and deletes add up to at most 1.0, the rest of the "
+              "operations being inserts. Operations other than inserts "
+              "require a table with a single-column integer primary key "
+              "and sequential values (see '--use_random').");
 DEFINE_uint64(num_rows_per_thread, 1000,
-              "Number of rows each thread generates and inserts; "
-              "0 means unlimited. All rows generated by a thread are inserted "
-              "in the context of the same session.");
+              "Number of operations each thread performs, i.e. the number of "
+              "rows it generates and inserts if the workload only has inserts; "
+              "0 means unlimited. All rows generated by a thread are written "
+              "in the context of the same session. If the workload has no "
+              "inserts, the other operations target the rows an insert-only "
+              "run would have inserted.");
 DEFINE_int32(num_threads, 2,
              "Number of generator threads to run. Each thread runs its own "
              "KuduSession.");
+DEFINE_int32(ops_per_sec, 0,
+             "Total number of operations per second the threads start, "
+             "regardless of how long the operations take; "
+             "0 means unlimited, each thread starting an operation as soon as "
+             "the previous one completes.");
+DEFINE_double(range_scan_pct, 0.0,
+              "Fraction of the operations which scan a range of rows, "
+              "between 0.0 and 1.0. See '--lookup_pct'.");
+DEFINE_int32(range_scan_rows, 100,
+             "Number of consecutive rows read by each range scan.");
+DEFINE_int32(report_interval_sec, 10,
+             "Interval between the reports of the throughput and latencies "
+             "of the operations while the test runs; 0 disables them.");
 DEFINE_bool(run_scan, false,
             "Whether to run post-insertion scan to verify that the count of "
             "the inserted rows matches the expected number. If enabled, "
             "the scan is run only if no errors were encountered "
             "while inserting the generated rows.");
+DEFINE_int32(run_time_sec, 0,
+             "Maximum time to run the operations for; 0 means unlimited.");
 DEFINE_uint64(seq_start, 0,
               "Initial value for the generator in sequential mode. "
               "This is useful when running multiple times against already "
@@ -210,10 +288,16 @@ DEFINE_int32(table_num_buckets, 8,
 DEFINE_int32(table_num_replicas, 1,
              "The number of replicas for the auto-created table; "
              "0 means 'use server-side default'.");
+DEFINE_double(update_pct, 0.0,
+              "Fraction of the operations which update a row, "
+              "between 0.0 and 1.0. See '--lookup_pct'.");
 DEFINE_bool(use_random, false,
             "Whether to use random numbers instead of sequential ones. "
             "In case of using random numbers collisions are possible over "
             "the data for columns with unique constraint (e.g. primary key).");
+DEFINE_double(zipfian_theta, 0.99,
+              "Skew of the zipfian distribution of the keys, between 0.0 "
+              "(exclusive) and 1.0 (exclusive). See '--key_distribution'.");
 
 namespace kudu {
 namespace tools {
@@ -334,19 +418,281 @@ Status GenerateRowData(Generator* gen, KuduPartialRow* row,
   return Status::OK();
 }
 
+// The types of operations of the workload.
+enum OpType {
+  OP_INSERT,
+  OP_UPDATE,
+  OP_DELETE,
+  OP_LOOKUP,
+  OP_RANGE_SCAN,
+  OP_NUM_TYPES,
+};
+
+const char* const kOpTypeNames[] = {
+  "insert",
+  "update",
+  "delete",
+  "lookup",
+  "range scan",
+};
+
+// The highest latency of an operation tracked, in microseconds.
+const int64_t kMaxLatencyMicros = 60LL * 1000 * 1000;
+
+// The latencies of the operations of one type, since the start of the test
+// and since the last interval report.
+class OpStats {
+ public:
+  OpStats()
+      : total_(kMaxLatencyMicros, 2),
+        interval_(new HdrHistogram(kMaxLatencyMicros, 2)) {
+  }
+
+  void Record(int64_t latency_micros) {
+    latency_micros = std::min(latency_micros, kMaxLatencyMicros);
+    total_.Increment(latency_micros);
+    shared_lock<rw_spinlock> l(interval_lock_);
+    interval_->Increment(latency_micros);
+  }
+
+  // Returns the latencies recorded since the previous call, and starts
+  // recording a new interval.
+  unique_ptr<HdrHistogram> TakeInterval() {
+    unique_ptr<HdrHistogram> interval(new HdrHistogram(kMaxLatencyMicros, 2));
+    lock_guard<rw_spinlock> l(interval_lock_);
+    interval_.swap(interval);
+    return interval;
+  }
+
+  const HdrHistogram& total() const { return total_; }
+
+ private:
+  HdrHistogram total_;
+
+  // Protects swapping 'interval_': it's incremented concurrently under
+  // a shared lock.
+  rw_spinlock interval_lock_;
+  unique_ptr<HdrHistogram> interval_;
+};
+
+// Appends a line with the throughput and latency percentiles of the
+// operations in 'hist', which ran for 'elapsed_sec' seconds, to 'out'.
+void AppendOpStats(const char* name, const HdrHistogram& hist,
+                   double elapsed_sec, string* out) {
+  SubstituteAndAppend(
+      out, "  $0: $1 ops, $2 ops/s, latency us: mean $3, p50 $4, p95 $5, "
+      "p99 $6, p99.9 $7, max $8\n",
+      name, hist.TotalCount(),
+      static_cast<int64_t>(hist.TotalCount() / std::max(elapsed_sec, 1e-3)),
+      static_cast<int64_t>(hist.MeanValue()),
+      hist.ValueAtPercentile(50), hist.ValueAtPercentile(95),
+      hist.ValueAtPercentile(99), hist.ValueAtPercentile(99.9),
+      hist.MaxValue());
+}
+
+// Generates ranks in [0, n) following a zipfian distribution, rank 0 being
+// the most popular one, as described in "Quickly Generating Billion-Record
+// Synthetic Databases" by Gray et al. The number of items may grow between
+// calls: the zeta constant is updated incrementally.
+class ZipfianGenerator {
+ public:
+  ZipfianGenerator(double theta, uint32_t seed)
+      : theta_(theta),
+        alpha_(1.0 / (1.0 - theta)),
+        zeta2_(1.0 + std::pow(0.5, theta)),
+        random_(seed),
+        n_(0),
+        zetan_(0.0),
+        eta_(0.0) {
+  }
+
+  uint64_t Next(uint64_t n) {
+    DCHECK_GT(n, 0);
+    DCHECK_GE(n, n_);
+    if (n != n_) {
+      for (uint64_t i = n_ + 1; i <= n; i++) {
+        zetan_ += 1.0 / std::pow(static_cast<double>(i), theta_);
+      }
+      n_ = n;
+      eta_ = (1.0 - std::pow(2.0 / n_, 1.0 - theta_)) / (1.0 - zeta2_ / zetan_);
+    }
+    const double u = random_.NextDoubleFraction();
+    const double uz = u * zetan_;
+    if (uz < 1.0) {
+      return 0;
+    }
+    if (uz < zeta2_) {
+      return std::min<uint64_t>(1, n_ - 1);
+    }
+    return std::min<uint64_t>(
+        n_ - 1, n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+  }
+
+ private:
+  const double theta_;
+  const double alpha_;
+  const double zeta2_;
+  Random random_;
+  uint64_t n_;
+  double zetan_;
+  double eta_;
+};
+
+// Returns the key of the row generated from the sequence number 'seq' by
+// GenerateRowData() in sequential mode, for a key column of type 'type'.
+int64_t KeyForSeq(KuduColumnSchema::DataType type, uint64_t seq) {
+  switch (type) {
+    case KuduColumnSchema::INT8:
+      return seq & numeric_limits<int8_t>::max();
+    case KuduColumnSchema::INT16:
+      return seq & numeric_limits<int16_t>::max();
+    case KuduColumnSchema::INT32:
+      return seq & numeric_limits<int32_t>::max();
+    case KuduColumnSchema::INT64:
+      return seq & numeric_limits<int64_t>::max();
+    default:
+      LOG(FATAL) << "unexpected key type: " << type;
+  }
+  return 0;
+}
+
+Status SetKey(KuduColumnSchema::DataType type, uint64_t seq,
+              KuduPartialRow* row) {
+  const int64_t key = KeyForSeq(type, seq);
+  switch (type) {
+    case KuduColumnSchema::INT8:
+      return row->SetInt8(0, static_cast<int8_t>(key));
+    case KuduColumnSchema::INT16:
+      return row->SetInt16(0, static_cast<int16_t>(key));
+    case KuduColumnSchema::INT32:
+      return row->SetInt32(0, static_cast<int32_t>(key));
+    case KuduColumnSchema::INT64:
+      return row->SetInt64(0, key);
+    default:
+      return Status::InvalidArgument("unexpected key type");
+  }
+}
+
+// Read the 'num_rows' rows generated in sequential mode from the sequence
+// numbers 'first_seq', 'first_seq + stride', etc.
+Status ScanRows(KuduTable* table, uint64_t first_seq, uint64_t stride,
+                int num_rows) {
+  const KuduColumnSchema key_column = table->schema().Column(0);
+  const int64_t first_key = KeyForSeq(key_column.type(), first_seq);
+  KuduScanner scanner(table);
+  if (num_rows == 1) {
+    RETURN_NOT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+        key_column.name(), KuduPredicate::EQUAL, KuduValue::FromInt(first_key))));
+  } else {
+    const int64_t last_key =
+        KeyForSeq(key_column.type(), first_seq + (num_rows - 1) * stride);
+    RETURN_NOT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+        key_column.name(), KuduPredicate::GREATER_EQUAL,
+        KuduValue::FromInt(first_key))));
+    RETURN_NOT_OK(scanner.AddConjunctPredicate(table->NewComparisonPredicate(
+        key_column.name(), KuduPredicate::LESS_EQUAL,
+        KuduValue::FromInt(last_key))));
+  }
+  RETURN_NOT_OK(scanner.Open());
+  while (scanner.HasMoreRows()) {
+    KuduScanBatch batch;
+    RETURN_NOT_OK(scanner.NextBatch(&batch));
+  }
+  return Status::OK();
+}
+
+// Whether the workload has operations other than inserts.
+bool IsMixedWorkload() {
+  return FLAGS_lookup_pct > 0 || FLAGS_range_scan_pct > 0 ||
+      FLAGS_update_pct > 0 || FLAGS_delete_pct > 0;
+}
+
+Status CheckWorkloadFlags() {
+  for (double pct : { FLAGS_lookup_pct, FLAGS_range_scan_pct,
+                      FLAGS_update_pct, FLAGS_delete_pct }) {
+    if (pct < 0 || pct > 1) {
+      return Status::InvalidArgument(
+          "fractions of operations must be between 0.0 and 1.0");
+    }
+  }
+  if (FLAGS_lookup_pct + FLAGS_range_scan_pct + FLAGS_update_pct +
+      FLAGS_delete_pct > 1) {
+    return Status::InvalidArgument(
+        "fractions of operations must add up to at most 1.0");
+  }
+  if (FLAGS_ops_per_sec < 0 || FLAGS_run_time_sec < 0 ||
+      FLAGS_report_interval_sec < 0) {
+    return Status::InvalidArgument(
+        "rate of operations, run time and report interval must not be negative");
+  }
+  if (!IsMixedWorkload()) {
+    return Status::OK();
+  }
+  if (FLAGS_use_random) {
+    return Status::InvalidArgument(
+        "operations other than inserts require sequential values");
+  }
+  if (FLAGS_num_rows_per_thread == 0 && FLAGS_lookup_pct + FLAGS_range_scan_pct +
+      FLAGS_update_pct + FLAGS_delete_pct == 1) {
+    return Status::InvalidArgument(
+        "a workload without inserts requires a number of rows per thread");
+  }
+  if (FLAGS_range_scan_rows <= 0) {
+    return Status::InvalidArgument("range scans must read at least one row");
+  }
+  if (FLAGS_key_distribution != "uniform" &&
+      FLAGS_key_distribution != "zipfian" &&
+      FLAGS_key_distribution != "latest") {
+    return Status::InvalidArgument("unknown key distribution",
+                                   FLAGS_key_distribution);
+  }
+  if (FLAGS_zipfian_theta <= 0 || FLAGS_zipfian_theta >= 1) {
+    return Status::InvalidArgument(
+        "zipfian theta must be between 0.0 and 1.0, exclusive");
+  }
+  return Status::OK();
+}
+
+// Check that the table is suitable for operations other than inserts.
+Status CheckWorkloadTable(const shared_ptr<KuduClient>& client,
+                          const string& table_name) {
+  if (!IsMixedWorkload()) {
+    return Status::OK();
+  }
+  shared_ptr<KuduTable> table;
+  RETURN_NOT_OK(client->OpenTable(table_name, &table));
+  vector<int> key_indexes;
+  table->schema().GetPrimaryKeyColumnIndexes(&key_indexes);
+  if (key_indexes != vector<int>({ 0 })) {
+    return Status::InvalidArgument(
+        "operations other than inserts require a single-column primary key");
+  }
+  switch (table->schema().Column(0).type()) {
+    case KuduColumnSchema::INT8:
+    case KuduColumnSchema::INT16:
+    case KuduColumnSchema::INT32:
+    case KuduColumnSchema::INT64:
+      return Status::OK();
+    default:
+      return Status::InvalidArgument(
+          "operations other than inserts require an integer primary key");
+  }
+}
+
 mutex cerr_lock;
 
 void GeneratorThread(
     const shared_ptr<KuduClient>& client, const string& table_name,
-    size_t gen_idx, size_t gen_num,
-    Status* status, uint64_t* row_count, uint64_t* err_count) {
+    size_t gen_idx, size_t gen_num, OpStats* stats,
+    Status* status, uint64_t* row_count, uint64_t* err_count,
+    uint64_t* not_found_count) {
 
   const Generator::Mode gen_mode = FLAGS_use_random ? Generator::MODE_RAND
                                                     : Generator::MODE_SEQ;
   const size_t flush_per_n_rows = FLAGS_flush_per_n_rows;
   const uint64_t gen_seq_start = FLAGS_seq_start;
   shared_ptr<KuduSession> session(client->NewSession());
-  uint64_t idx = 0;
+  uint64_t num_inserted = 0;
 
   auto generator = [&]() -> Status {
     RETURN_NOT_OK(session->SetMutationBufferFlushWatermark(
@@ -370,11 +716,112 @@ void GeneratorThread(
                                 : num_rows_per_gen * num_columns;
     const int64_t gen_seed = gen_idx * gen_span + gen_seq_start;
     Generator gen(gen_mode, gen_seed, FLAGS_string_len);
-    for (; num_rows_per_gen == 0 || idx < num_rows_per_gen; ++idx) {
-      unique_ptr<KuduInsert> insert_op(table->NewInsert());
-      RETURN_NOT_OK(GenerateRowData(&gen, insert_op->mutable_row(),
-                                   FLAGS_string_fixed));
-      RETURN_NOT_OK(session->Apply(insert_op.release()));
+
+    // The cumulative fractions of the types of operations other than inserts.
+    const double op_pct_limits[] = {
+      FLAGS_update_pct,
+      FLAGS_update_pct + FLAGS_delete_pct,
+      FLAGS_update_pct + FLAGS_delete_pct + FLAGS_lookup_pct,
+      FLAGS_update_pct + FLAGS_delete_pct + FLAGS_lookup_pct +
+          FLAGS_range_scan_pct,
+    };
+    const bool has_inserts = op_pct_limits[3] < 1;
+    Random random(gen_seed + 1);
+    Generator update_gen(Generator::MODE_RAND, gen_seed + 2, FLAGS_string_len);
+    ZipfianGenerator zipfian(FLAGS_zipfian_theta, gen_seed + 3);
+    const KuduColumnSchema::DataType key_type = table->schema().Column(0).type();
+
+    // Returns the sequence number of the row targeted by an operation other
+    // than an insert, among the 'num_rows' rows inserted by this generator.
+    auto target_row_seq = [&](uint64_t num_rows) -> uint64_t {
+      uint64_t row_idx;
+      if (FLAGS_key_distribution == "zipfian") {
+        row_idx = zipfian.Next(num_rows);
+      } else if (FLAGS_key_distribution == "latest") {
+        row_idx = num_rows - 1 - zipfian.Next(num_rows);
+      } else {
+        row_idx = random.Uniform64(num_rows);
+      }
+      return gen_seed + row_idx * num_columns;
+    };
+
+    const MonoTime start = MonoTime::Now();
+    const MonoTime deadline = FLAGS_run_time_sec > 0
+        ? start + MonoDelta::FromSeconds(FLAGS_run_time_sec)
+        : MonoTime::Max();
+    const int64_t op_interval_nanos = FLAGS_ops_per_sec > 0
+        ? 1000000000LL * gen_num / FLAGS_ops_per_sec
+        : 0;
+    for (uint64_t idx = 0; num_rows_per_gen == 0 || idx < num_rows_per_gen; ++idx) {
+      // When the rate is limited, the operation is scheduled to start at a
+      // fixed time, regardless of how long the previous operations took.
+      MonoTime op_start;
+      if (op_interval_nanos > 0) {
+        op_start = start + MonoDelta::FromNanoseconds(op_interval_nanos * idx);
+        const MonoTime now = MonoTime::Now();
+        if (op_start > now) {
+          SleepFor(op_start - now);
+        }
+      } else {
+        op_start = MonoTime::Now();
+      }
+      if (op_start >= deadline) {
+        break;
+      }
+
+      OpType op_type = OP_INSERT;
+      const double r = random.NextDoubleFraction();
+      if (r < op_pct_limits[0]) {
+        op_type = OP_UPDATE;
+      } else if (r < op_pct_limits[1]) {
+        op_type = OP_DELETE;
+      } else if (r < op_pct_limits[2]) {
+        op_type = OP_LOOKUP;
+      } else if (r < op_pct_limits[3]) {
+        op_type = OP_RANGE_SCAN;
+      }
+      const uint64_t num_rows = has_inserts ? num_inserted : num_rows_per_gen;
+      if (num_rows == 0) {
+        op_type = OP_INSERT;
+      }
+
+      switch (op_type) {
+        case OP_INSERT: {
+          unique_ptr<KuduInsert> insert_op(table->NewInsert());
+          RETURN_NOT_OK(GenerateRowData(&gen, insert_op->mutable_row(),
+                                        FLAGS_string_fixed));
+          RETURN_NOT_OK(session->Apply(insert_op.release()));
+          ++num_inserted;
+          break;
+        }
+        case OP_UPDATE: {
+          unique_ptr<KuduUpdate> update_op(table->NewUpdate());
+          RETURN_NOT_OK(GenerateRowData(&update_gen, update_op->mutable_row(),
+                                        FLAGS_string_fixed));
+          RETURN_NOT_OK(SetKey(key_type, target_row_seq(num_rows),
+                               update_op->mutable_row()));
+          RETURN_NOT_OK(session->Apply(update_op.release()));
+          break;
+        }
+        case OP_DELETE: {
+          unique_ptr<KuduDelete> delete_op(table->NewDelete());
+          RETURN_NOT_OK(SetKey(key_type, target_row_seq(num_rows),
+                               delete_op->mutable_row()));
+          RETURN_NOT_OK(session->Apply(delete_op.release()));
+          break;
+        }
+        case OP_LOOKUP:
+          RETURN_NOT_OK(ScanRows(table.get(), target_row_seq(num_rows),
+                                 num_columns, 1));
+          break;
+        case OP_RANGE_SCAN:
+          RETURN_NOT_OK(ScanRows(table.get(), target_row_seq(num_rows),
+                                 num_columns, FLAGS_range_scan_rows));
+          break;
+        default:
+          LOG(FATAL) << "unexpected operation type: " << op_type;
+      }
+      stats[op_type].Record((MonoTime::Now() - op_start).ToMicroseconds());
       if (flush_per_n_rows != 0 && idx != 0 && idx % flush_per_n_rows == 0) {
         session->FlushAsync(nullptr);
       }
@@ -386,19 +833,37 @@ void GeneratorThread(
 
   *status = generator();
   if (row_count != nullptr) {
-    *row_count = idx;
+    *row_count = num_inserted;
   }
   vector<KuduError*> errors;
   ElementDeleter d(&errors);
   session->GetPendingErrors(&errors, nullptr);
+  // Updates and deletes may target rows which were deleted already, or
+  // whose insert hasn't been flushed yet: these aren't errors of the test.
+  uint64_t num_not_found = 0;
+  if (FLAGS_update_pct > 0 || FLAGS_delete_pct > 0) {
+    for (const auto* error : errors) {
+      if (error->status().IsNotFound()) {
+        ++num_not_found;
+      }
+    }
+  }
   if (err_count != nullptr) {
-    *err_count = errors.size();
+    *err_count = errors.size() - num_not_found;
   }
-  if (!errors.empty() && FLAGS_show_first_n_errors > 0) {
+  if (not_found_count != nullptr) {
+    *not_found_count = num_not_found;
+  }
+  if (errors.size() > num_not_found && FLAGS_show_first_n_errors > 0) {
     ostringstream str;
     str << "Error from generator " << std::setw(4) << gen_idx << ":" << endl;
-    for (size_t i = 0; i < errors.size() && i < FLAGS_show_first_n_errors; ++i) {
+    size_t num_shown = 0;
+    for (size_t i = 0; i < errors.size() && num_shown < FLAGS_show_first_n_errors; ++i) {
+      if (num_not_found != 0 && errors[i]->status().IsNotFound()) {
+        continue;
+      }
       str << "  " << errors[i]->status().ToString() << endl;
+      ++num_shown;
     }
     // Serialize access to the stderr to prevent garbled output.
     lock_guard<mutex> lock(cerr_lock);
@@ -406,29 +871,68 @@ void GeneratorThread(
   }
 }
 
+// Output the throughput and latencies of the operations over the last
+// interval every '--report_interval_sec' seconds, until 'done' is counted
+// down.
+void ReportThread(OpStats* stats, const CountDownLatch* done) {
+  const MonoTime start = MonoTime::Now();
+  MonoTime last = start;
+  while (!done->WaitFor(MonoDelta::FromSeconds(FLAGS_report_interval_sec))) {
+    const MonoTime now = MonoTime::Now();
+    string report = Substitute("Operations over the last $0 s ($1 s total)\n",
+                               FLAGS_report_interval_sec,
+                               static_cast<int64_t>((now - start).ToSeconds()));
+    for (int i = 0; i < OP_NUM_TYPES; ++i) {
+      unique_ptr<HdrHistogram> interval = stats[i].TakeInterval();
+      if (interval->TotalCount() != 0) {
+        AppendOpStats(kOpTypeNames[i], *interval, (now - last).ToSeconds(), &report);
+      }
+    }
+    last = now;
+    cout << report << std::flush;
+  }
+}
+
 Status GenerateInsertRows(const shared_ptr<KuduClient>& client,
                           const string& table_name,
+                          OpStats* stats,
                           uint64_t* total_row_count,
-                          uint64_t* total_err_count) {
+                          uint64_t* total_err_count,
+                          uint64_t* total_not_found_count) {
 
   const size_t gen_num = FLAGS_num_threads;
   vector<Status> status(gen_num);
   vector<uint64_t> row_count(gen_num, 0);
   vector<uint64_t> err_count(gen_num, 0);
+  vector<uint64_t> not_found_count(gen_num, 0);
+  CountDownLatch done(1);
+  thread reporter;
+  if (FLAGS_report_interval_sec > 0) {
+    reporter = thread(&ReportThread, stats, &done);
+  }
   vector<thread> threads;
   for (size_t i = 0; i < gen_num; ++i) {
     threads.emplace_back(&GeneratorThread, client, table_name, i, gen_num,
-                         &status[i], &row_count[i], &err_count[i]);
+                         stats, &status[i], &row_count[i], &err_count[i],
+                         &not_found_count[i]);
   }
   for (auto& t : threads) {
     t.join();
   }
+  done.CountDown();
+  if (reporter.joinable()) {
+    reporter.join();
+  }
   if (total_row_count != nullptr) {
     *total_row_count = accumulate(row_count.begin(), row_count.end(), 0UL);
   }
   if (total_err_count != nullptr) {
     *total_err_count = accumulate(err_count.begin(), err_count.end(), 0UL);
   }
+  if (total_not_found_count != nullptr) {
+    *total_not_found_count =
+        accumulate(not_found_count.begin(), not_found_count.end(), 0UL);
+  }
   // Return first non-OK error status, if any, as a result.
   const auto it = find_if(status.begin(), status.end(),
                           [&](const Status& s) { return !s.ok(); });
@@ -500,6 +1004,7 @@ Status CountTableRows(const shared_ptr<KuduClient>& client,
 Status TestLoadGenerator(const RunnerContext& context) {
   const string& master_addresses_str =
       FindOrDie(context.required_args, kMasterAddressesArg);
+  RETURN_NOT_OK(CheckWorkloadFlags());
 
   vector<string> master_addrs(strings::Split(master_addresses_str, ","));
   if (master_addrs.empty()) {
@@ -539,13 +1044,17 @@ Status TestLoadGenerator(const RunnerContext& context) {
   }
   cout << "Using " << (is_auto_table ? "auto-created " : "")
        << "table '" << table_name << "'" << endl;
+  RETURN_NOT_OK(CheckWorkloadTable(client, table_name));
 
+  OpStats stats[OP_NUM_TYPES];
   uint64_t total_row_count = 0;
   uint64_t total_err_count = 0;
+  uint64_t total_not_found_count = 0;
   Stopwatch sw(Stopwatch::ALL_THREADS);
   sw.start();
-  Status status = GenerateInsertRows(client, table_name,
-                                     &total_row_count, &total_err_count);
+  Status status = GenerateInsertRows(client, table_name, stats,
+                                     &total_row_count, &total_err_count,
+                                     &total_not_found_count);
   sw.stop();
   const double total = sw.elapsed().wall_millis();
   cout << endl << "Generator report" << endl
@@ -553,6 +1062,17 @@ Status TestLoadGenerator(const RunnerContext& context) {
   if (total_row_count != 0) {
     cout << "  time per row: " << total / total_row_count << " ms" << endl;
   }
+  if (total_not_found_count != 0) {
+    cout << "  rows not found by updates and deletes: "
+         << total_not_found_count << endl;
+  }
+  string op_report;
+  for (int i = 0; i < OP_NUM_TYPES; ++i) {
+    if (stats[i].total().TotalCount() != 0) {
+      AppendOpStats(kOpTypeNames[i], stats[i].total(), total / 1000, &op_report);
+    }
+  }
+  cout << op_report;
   if (!status.ok() || total_err_count != 0) {
     string err_str;
     if (!status.ok()) {
@@ -572,10 +1092,15 @@ Status TestLoadGenerator(const RunnerContext& context) {
     // Run a table scan to count inserted rows.
     uint64_t count;
     RETURN_NOT_OK(CountTableRows(client, table_name, &count));
-    cout << endl << "Scanner report" << endl
-         << "  expected rows: " << total_row_count << endl
-         << "  actual rows  : " << count << endl;
-    if (count != total_row_count) {
+    cout << endl << "Scanner report" << endl;
+    if (FLAGS_delete_pct > 0) {
+      // The number of rows actually deleted isn't known.
+      cout << "  actual rows  : " << count << endl;
+    } else {
+      cout << "  expected rows: " << total_row_count << endl
+           << "  actual rows  : " << count << endl;
+    }
+    if (FLAGS_delete_pct == 0 && count != total_row_count) {
       return Status::RuntimeError(
             Substitute("Row count mismatch: expected $0, actual $1",
                        total_row_count, count));
@@ -600,8 +1125,12 @@ unique_ptr<Mode> BuildTestMode() {
       .ExtraDescription(
           "Run load generation tool which inserts auto-generated data "
           "into already existing or auto-created table as fast as possible. "
-          "If requested, also run scan over the inserted rows to check whether "
-          "the actual count or inserted rows matches the expected one.")
+          "Optionally, mix point lookups, range scans, updates and deletes "
+          "of the inserted rows into the workload, limit the rate of "
+          "operations, and report their throughput and latencies at regular "
+          "intervals. If requested, also run scan over the inserted rows to "
+          "check whether the actual count or inserted rows matches the "
+          "expected one.")
       .AddRequiredParameter({ kMasterAddressesArg,
           "Comma-separated list of master addresses to run against. "
           "Addresses are in 'hostname:port' form where port may be omitted "
@@ -609,11 +1138,19 @@ unique_ptr<Mode> BuildTestMode() {
       .AddOptionalParameter("buffer_flush_watermark_pct")
       .AddOptionalParameter("buffer_size_bytes")
       .AddOptionalParameter("buffers_num")
+      .AddOptionalParameter("delete_pct")
       .AddOptionalParameter("flush_per_n_rows")
       .AddOptionalParameter("keep_auto_table")
+      .AddOptionalParameter("key_distribution")
+      .AddOptionalParameter("lookup_pct")
       .AddOptionalParameter("num_rows_per_thread")
       .AddOptionalParameter("num_threads")
+      .AddOptionalParameter("ops_per_sec")
+      .AddOptionalParameter("range_scan_pct")
+      .AddOptionalParameter("range_scan_rows")
+      .AddOptionalParameter("report_interval_sec")
       .AddOptionalParameter("run_scan")
+      .AddOptionalParameter("run_time_sec")
       .AddOptionalParameter("seq_start")
       .AddOptionalParameter("show_first_n_errors")
       .AddOptionalParameter("string_fixed")
@@ -621,7 +1158,9 @@ unique_ptr<Mode> BuildTestMode() {
       .AddOptionalParameter("table_name")
       .AddOptionalParameter("table_num_buckets")
       .AddOptionalParameter("table_num_replicas")
+      .AddOptionalParameter("update_pct")
       .AddOptionalParameter("use_random")
+      .AddOptionalParameter("zipfian_theta")
       .Build();
 
   return ModeBuilder("test")
@@ -123,6 +123,7 @@ int RunTool(int argc, char** argv, bool show_help) {
     .AddMode(BuildLocalReplicaMode())
     .AddMode(BuildMasterMode())
     .AddMode(BuildPbcMode())
+    .AddMode(BuildPerfMode())
     .AddMode(BuildRemoteReplicaMode())
     .AddMode(BuildTableMode())
     .AddMode(BuildTabletMode())
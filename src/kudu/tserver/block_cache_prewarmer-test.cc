@@ -0,0 +1,131 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/block_cache_prewarmer.h"
+
+#include <vector>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/cfile-test-base.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/index_btree.h"
+#include "kudu/util/test_macros.h"
+
+DECLARE_int32(block_cache_prewarm_max_mb_per_sec);
+
+namespace kudu {
+namespace tserver {
+
+using cfile::BlockCache;
+using cfile::BlockCacheHandle;
+using cfile::BlockHandle;
+using cfile::BlockPointer;
+using cfile::CFileReader;
+using cfile::IndexTreeIterator;
+using cfile::ReaderOptions;
+using cfile::UInt32DataGenerator;
+using fs::ReadableBlock;
+using std::vector;
+
+class BlockCachePrewarmerTest : public cfile::CFileTestBase {
+ protected:
+  void TearDown() OVERRIDE {
+    Singleton<BlockCache>::UnsafeReset();
+    cfile::CFileTestBase::TearDown();
+  }
+
+  // Returns the pointers to the data blocks of the given file, reading them
+  // into the block cache if 'read' is true.
+  void GetDataBlocks(const BlockId& block_id, bool read, vector<BlockPointer>* ptrs) {
+    gscoped_ptr<ReadableBlock> block;
+    ASSERT_OK(fs_manager_->OpenBlock(block_id, &block));
+    gscoped_ptr<CFileReader> reader;
+    ASSERT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+    gscoped_ptr<IndexTreeIterator> iter(IndexTreeIterator::Create(reader.get(),
+                                                                  reader->posidx_root()));
+    ASSERT_OK(iter->SeekToFirst());
+    do {
+      ptrs->push_back(iter->GetCurrentBlockPointer());
+      if (read) {
+        BlockHandle handle;
+        ASSERT_OK(reader->ReadBlock(ptrs->back(), CFileReader::CACHE_BLOCK, &handle));
+      }
+    } while (iter->Next().ok());
+  }
+};
+
+// Test that the blocks cached before a "restart" are cached again after
+// prewarming.
+TEST_F(BlockCachePrewarmerTest, TestSaveAndPrewarm) {
+  FLAGS_block_cache_prewarm_max_mb_per_sec = 0;
+  UInt32DataGenerator<false> generator;
+  BlockId block_id;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 10000,
+                                        SMALL_BLOCKSIZE, &block_id));
+  vector<BlockPointer> ptrs;
+  ASSERT_NO_FATAL_FAILURE(GetDataBlocks(block_id, true, &ptrs));
+  ASSERT_GT(ptrs.size(), 1);
+
+  BlockCachePrewarmer prewarmer(fs_manager_.get(), nullptr);
+  ASSERT_OK(prewarmer.SaveHotList());
+
+  // Start over with an empty cache.
+  Singleton<BlockCache>::UnsafeReset();
+  BlockCache* cache = BlockCache::GetSingleton();
+  for (const BlockPointer& ptr : ptrs) {
+    BlockCacheHandle handle;
+    ASSERT_FALSE(cache->Lookup(BlockCache::CacheKey(block_id, ptr.offset()),
+                               Cache::EXPECT_IN_CACHE, &handle));
+  }
+
+  ASSERT_OK(prewarmer.Prewarm());
+  for (const BlockPointer& ptr : ptrs) {
+    BlockCacheHandle handle;
+    ASSERT_TRUE(cache->Lookup(BlockCache::CacheKey(block_id, ptr.offset()),
+                              Cache::EXPECT_IN_CACHE, &handle));
+  }
+}
+
+// Test that prewarming skips files which were deleted since the hot list was
+// saved.
+TEST_F(BlockCachePrewarmerTest, TestPrewarmDeletedFile) {
+  UInt32DataGenerator<false> generator;
+  BlockId block_id;
+  ASSERT_NO_FATAL_FAILURE(WriteTestFile(&generator, PLAIN_ENCODING, NO_COMPRESSION, 1000,
+                                        NO_FLAGS, &block_id));
+  vector<BlockPointer> ptrs;
+  ASSERT_NO_FATAL_FAILURE(GetDataBlocks(block_id, true, &ptrs));
+
+  BlockCachePrewarmer prewarmer(fs_manager_.get(), nullptr);
+  ASSERT_OK(prewarmer.SaveHotList());
+  Singleton<BlockCache>::UnsafeReset();
+  ASSERT_OK(fs_manager_->DeleteBlock(block_id));
+  ASSERT_OK(prewarmer.Prewarm());
+}
+
+// Test that there is nothing to prewarm without a saved hot list.
+TEST_F(BlockCachePrewarmerTest, TestPrewarmWithoutHotList) {
+  BlockCachePrewarmer prewarmer(fs_manager_.get(), nullptr);
+  ASSERT_OK(prewarmer.Prewarm());
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,255 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/block_cache_prewarmer.h"
+
+#include <map>
+#include <unordered_set>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/cfile/block_cache.h"
+#include "kudu/cfile/block_handle.h"
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_reader.h"
+#include "kudu/cfile/index_btree.h"
+#include "kudu/fs/block_id.h"
+#include "kudu/fs/fs_manager.h"
+#include "kudu/gutil/map-util.h"
+#include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/env.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/path_util.h"
+#include "kudu/util/pb_util.h"
+#include "kudu/util/stopwatch.h"
+#include "kudu/util/thread.h"
+
+DEFINE_int32(block_cache_hot_list_save_interval_secs, 0,
+             "Interval in seconds at which the keys of the most recently used "
+             "blocks of the block cache are saved to the first data directory. "
+             "On startup, the blocks of the saved list are read back into the "
+             "block cache in the background, after the tablets have been "
+             "bootstrapped. If 0, the block cache is neither saved nor "
+             "prewarmed.");
+TAG_FLAG(block_cache_hot_list_save_interval_secs, experimental);
+
+DEFINE_int32(block_cache_hot_list_max_blocks, 100000,
+             "Maximum number of blocks saved in the block cache hot list.");
+TAG_FLAG(block_cache_hot_list_max_blocks, experimental);
+
+DEFINE_int32(block_cache_prewarm_max_mb_per_sec, 20,
+             "Maximum rate in MB per second at which blocks are read to "
+             "prewarm the block cache on startup. If 0, the rate is not limited.");
+TAG_FLAG(block_cache_prewarm_max_mb_per_sec, experimental);
+TAG_FLAG(block_cache_prewarm_max_mb_per_sec, runtime);
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+
+using cfile::BlockCache;
+using cfile::BlockCacheHotListPB;
+using cfile::BlockHandle;
+using cfile::BlockPointer;
+using cfile::CFileReader;
+using cfile::IndexTreeIterator;
+using cfile::ReaderOptions;
+using fs::ReadableBlock;
+
+namespace tserver {
+
+static const char* const kHotListFileName = "block_cache_hot_list";
+
+BlockCachePrewarmer::BlockCachePrewarmer(FsManager* fs_manager,
+                                         TSTabletManager* tablet_manager)
+    : fs_manager_(fs_manager),
+      tablet_manager_(tablet_manager),
+      shutdown_latch_(1),
+      prewarm_bytes_(0),
+      prewarm_done_(false) {
+}
+
+BlockCachePrewarmer::~BlockCachePrewarmer() {
+  Shutdown();
+}
+
+Status BlockCachePrewarmer::Start() {
+  if (FLAGS_block_cache_hot_list_save_interval_secs <= 0) {
+    return Status::OK();
+  }
+  return Thread::Create("block-cache", "prewarmer", &BlockCachePrewarmer::Run, this,
+                        &thread_);
+}
+
+void BlockCachePrewarmer::Shutdown() {
+  if (!thread_) {
+    return;
+  }
+  shutdown_latch_.CountDown();
+  CHECK_OK(ThreadJoiner(thread_.get()).Join());
+  thread_.reset();
+  if (prewarm_done_) {
+    WARN_NOT_OK(SaveHotList(), "Unable to save the block cache hot list");
+  }
+}
+
+string BlockCachePrewarmer::HotListPath() const {
+  return JoinPathSegments(fs_manager_->GetDataRootDirs()[0], kHotListFileName);
+}
+
+void BlockCachePrewarmer::Run() {
+  if (tablet_manager_) {
+    // Leave the IO to the tablets' bootstrap first.
+    WARN_NOT_OK(tablet_manager_->WaitForAllBootstrapsToFinish(),
+                "Not all tablets bootstrapped successfully");
+  }
+  if (shutdown_latch_.count() > 0) {
+    WARN_NOT_OK(Prewarm(), "Unable to prewarm the block cache");
+  }
+  prewarm_done_ = true;
+
+  const MonoDelta interval =
+      MonoDelta::FromSeconds(FLAGS_block_cache_hot_list_save_interval_secs);
+  while (!shutdown_latch_.WaitFor(interval)) {
+    WARN_NOT_OK(SaveHotList(), "Unable to save the block cache hot list");
+  }
+}
+
+Status BlockCachePrewarmer::SaveHotList() {
+  vector<BlockCache::HotBlock> blocks;
+  BlockCache::GetSingleton()->GetHotBlocks(FLAGS_block_cache_hot_list_max_blocks, &blocks);
+
+  // Group the blocks by file, which keeps the list compact and lets the
+  // prewarming open each file once.
+  BlockCacheHotListPB pb;
+  std::map<uint64_t, BlockCacheHotListPB::FileBlocksPB*> files;
+  for (const BlockCache::HotBlock& block : blocks) {
+    BlockCacheHotListPB::FileBlocksPB** file = &files[block.key.file_id_];
+    if (*file == nullptr) {
+      *file = pb.add_files();
+      (*file)->set_file_id(block.key.file_id_);
+    }
+    if (block.priority == BlockCache::HIGH_PRIORITY) {
+      (*file)->add_high_priority_offsets(block.key.offset_);
+    } else {
+      (*file)->add_offsets(block.key.offset_);
+    }
+  }
+  RETURN_NOT_OK_PREPEND(pb_util::WritePBContainerToPath(fs_manager_->env(), HotListPath(), pb,
+                                                        pb_util::OVERWRITE, pb_util::NO_SYNC),
+                        "Unable to write block cache hot list");
+  VLOG(1) << "Saved " << blocks.size() << " blocks of " << pb.files_size()
+          << " files to the block cache hot list";
+  return Status::OK();
+}
+
+Status BlockCachePrewarmer::Prewarm() {
+  string path = HotListPath();
+  if (!fs_manager_->env()->FileExists(path)) {
+    return Status::OK();
+  }
+  BlockCacheHotListPB pb;
+  RETURN_NOT_OK_PREPEND(pb_util::ReadPBContainerFromPath(fs_manager_->env(), path, &pb),
+                        "Unable to read block cache hot list");
+
+  LOG_TIMING(INFO, "prewarming the block cache") {
+    prewarm_start_ = MonoTime::Now();
+    prewarm_bytes_ = 0;
+    for (const BlockCacheHotListPB::FileBlocksPB& file : pb.files()) {
+      if (shutdown_latch_.count() == 0) {
+        break;
+      }
+      vector<uint64_t> offsets(file.offsets().begin(), file.offsets().end());
+      vector<uint64_t> high_priority_offsets(file.high_priority_offsets().begin(),
+                                             file.high_priority_offsets().end());
+      Status s = PrewarmFile(BlockId(file.file_id()), offsets, high_priority_offsets);
+      if (!s.ok()) {
+        LOG(WARNING) << "Unable to prewarm the block cache with blocks of "
+                     << BlockId(file.file_id()).ToString() << ": " << s.ToString();
+      }
+    }
+    LOG(INFO) << "Read " << prewarm_bytes_ << " bytes of " << pb.files_size()
+              << " files into the block cache";
+  }
+  return Status::OK();
+}
+
+Status BlockCachePrewarmer::PrewarmFile(const BlockId& block_id,
+                                        const vector<uint64_t>& offsets,
+                                        const vector<uint64_t>& high_priority_offsets) {
+  gscoped_ptr<ReadableBlock> block;
+  Status s = fs_manager_->OpenBlock(block_id, &block);
+  if (s.IsNotFound()) {
+    // The file was deleted since the hot list was saved.
+    return Status::OK();
+  }
+  RETURN_NOT_OK(s);
+  gscoped_ptr<CFileReader> reader;
+  RETURN_NOT_OK(CFileReader::Open(std::move(block), ReaderOptions(), &reader));
+
+  // Block pointers include the blocks' sizes, which the hot list doesn't
+  // have, so find them by walking the file's index. The index blocks
+  // themselves are cached along the way.
+  BlockPointer root;
+  if (reader->has_posidx()) {
+    root = reader->posidx_root();
+  } else if (reader->has_validx()) {
+    root = reader->validx_root();
+  } else {
+    return Status::OK();
+  }
+  std::unordered_set<uint64_t> normal(offsets.begin(), offsets.end());
+  std::unordered_set<uint64_t> high(high_priority_offsets.begin(),
+                                    high_priority_offsets.end());
+  gscoped_ptr<IndexTreeIterator> iter(IndexTreeIterator::Create(reader.get(), root));
+  RETURN_NOT_OK(iter->SeekToFirst());
+  do {
+    BlockPointer ptr = iter->GetCurrentBlockPointer();
+    BlockCache::Priority priority;
+    if (ContainsKey(high, ptr.offset())) {
+      priority = BlockCache::HIGH_PRIORITY;
+    } else if (ContainsKey(normal, ptr.offset())) {
+      priority = BlockCache::NORMAL_PRIORITY;
+    } else {
+      continue;
+    }
+    BlockHandle handle;
+    RETURN_NOT_OK(reader->ReadBlock(ptr, CFileReader::CACHE_BLOCK, &handle, priority));
+    if (!Throttle(ptr.size())) {
+      break;
+    }
+  } while (iter->Next().ok());
+  return Status::OK();
+}
+
+bool BlockCachePrewarmer::Throttle(int64_t bytes) {
+  prewarm_bytes_ += bytes;
+  int32_t max_mb_per_sec = FLAGS_block_cache_prewarm_max_mb_per_sec;
+  if (max_mb_per_sec > 0) {
+    MonoTime target = prewarm_start_ + MonoDelta::FromSeconds(
+        static_cast<double>(prewarm_bytes_) / (max_mb_per_sec * 1024 * 1024));
+    if (target > MonoTime::Now()) {
+      return !shutdown_latch_.WaitUntil(target);
+    }
+  }
+  return shutdown_latch_.count() > 0;
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,112 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_BLOCK_CACHE_PREWARMER_H
+#define KUDU_TSERVER_BLOCK_CACHE_PREWARMER_H
+
+#include <string>
+#include <vector>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/countdown_latch.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class BlockId;
+class FsManager;
+class Thread;
+
+namespace cfile {
+class BlockCacheHotListPB;
+} // namespace cfile
+
+namespace tserver {
+
+class TSTabletManager;
+
+// Keeps the block cache warm across restarts.
+//
+// While the server runs, the keys of the most recently used blocks of the
+// block cache are periodically saved to a "hot list" file in the first data
+// directory. On startup, once the tablets have been bootstrapped, the blocks
+// from the saved hot list are read back into the block cache in the
+// background, at a throttled rate so as not to compete with the workload.
+//
+// Everything happens on a background thread, so this never delays the
+// server becoming available.
+class BlockCachePrewarmer {
+ public:
+  // 'tablet_manager' may be null, in which case prewarming doesn't wait for
+  // tablets to be bootstrapped.
+  BlockCachePrewarmer(FsManager* fs_manager, TSTabletManager* tablet_manager);
+  ~BlockCachePrewarmer();
+
+  // Starts the background thread, unless
+  // --block_cache_hot_list_save_interval_secs is 0.
+  Status Start();
+
+  // Stops the background thread, saving the hot list one last time.
+  void Shutdown();
+
+  // Saves the current hot list of the block cache.
+  Status SaveHotList();
+
+  // Reads the blocks of the saved hot list, if any, into the block cache.
+  Status Prewarm();
+
+ private:
+  // Body of the background thread.
+  void Run();
+
+  std::string HotListPath() const;
+
+  // Reads the blocks of one file of the hot list. Blocks which no longer
+  // exist are skipped.
+  Status PrewarmFile(const BlockId& block_id,
+                     const std::vector<uint64_t>& offsets,
+                     const std::vector<uint64_t>& high_priority_offsets);
+
+  // Sleeps as needed to keep the prewarming below
+  // --block_cache_prewarm_max_mb_per_sec, having read 'bytes' more.
+  // Returns false if the prewarmer was shut down in the meantime.
+  bool Throttle(int64_t bytes);
+
+  FsManager* const fs_manager_;
+  TSTabletManager* const tablet_manager_;
+
+  // Counted down when shutting down.
+  CountDownLatch shutdown_latch_;
+
+  scoped_refptr<Thread> thread_;
+
+  // State for Throttle().
+  MonoTime prewarm_start_;
+  int64_t prewarm_bytes_;
+
+  // Set by the background thread once prewarming is over. Until then, the
+  // cache doesn't reflect the workload, so its hot list isn't saved.
+  bool prewarm_done_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockCachePrewarmer);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif // KUDU_TSERVER_BLOCK_CACHE_PREWARMER_H
@@ -17,6 +17,7 @@
 
 #include "kudu/tserver/heartbeater.h"
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <string>
@@ -34,10 +35,14 @@
 #include "kudu/security/tls_context.h"
 #include "kudu/security/token_verifier.h"
 #include "kudu/server/webserver.h"
+#include "kudu/tablet/tablet.h"
+#include "kudu/tablet/tablet_metrics.h"
+#include "kudu/tablet/tablet_peer.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/tablet_server_options.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
@@ -59,8 +64,13 @@ DEFINE_int32(heartbeat_max_failures_before_backoff, 3,
              "rather than retrying.");
 TAG_FLAG(heartbeat_max_failures_before_backoff, advanced);
 
+METRIC_DECLARE_counter(log_bytes_logged);
+
 using kudu::master::MasterServiceProxy;
 using kudu::master::TabletReportPB;
+using kudu::master::TSLoadStatsPB;
+using kudu::tablet::Tablet;
+using kudu::tablet::TabletPeer;
 using kudu::rpc::RpcController;
 using std::shared_ptr;
 using strings::Substitute;
@@ -102,6 +112,11 @@ class Heartbeater::Thread {
   void GenerateIncrementalTabletReport(TabletReportPB* report);
   void GenerateFullTabletReport(TabletReportPB* report);
 
+  // Fill in the load statistics of the tablet server. The rates are computed
+  // over the interval since the previous call, and are left unset on the
+  // first one.
+  void GenerateLoadStats(TSLoadStatsPB* stats);
+
   // Mark that the master successfully received and processed the given
   // tablet report. This uses the report sequence number to "un-dirty" any
   // tablets which have not changed since the acknowledged report.
@@ -175,6 +190,14 @@ class Heartbeater::Thread {
   // the thread detects that the master has been elected leader.
   bool send_full_tablet_report_;
 
+  // The number of bytes written to the WALs and the number of scans started,
+  // summed across the tablet replicas as of the last time the load statistics
+  // were generated, used to compute their rates. Only accessed by the
+  // heartbeat thread.
+  int64_t last_wal_bytes_logged_;
+  int64_t last_scans_started_;
+  MonoTime last_load_stats_time_;
+
   DISALLOW_COPY_AND_ASSIGN(Thread);
 };
 
@@ -274,7 +297,9 @@ Heartbeater::Thread::Thread(const HostPort& master_address, TabletServer* server
     cond_(&mutex_),
     should_run_(false),
     heartbeat_asap_(true),
-    send_full_tablet_report_(false) {
+    send_full_tablet_report_(false),
+    last_wal_bytes_logged_(0),
+    last_scans_started_(0) {
 }
 
 Status Heartbeater::Thread::ConnectToMaster() {
@@ -396,6 +421,7 @@ Status Heartbeater::Thread::DoHeartbeat() {
     GenerateIncrementalTabletReport(req.mutable_tablet_report());
   }
   req.set_num_live_tablets(server_->tablet_manager()->GetNumLiveTablets());
+  GenerateLoadStats(req.mutable_load_stats());
 
   RpcController rpc;
   rpc.set_timeout(MonoDelta::FromMilliseconds(FLAGS_heartbeat_rpc_timeout_ms));
@@ -611,5 +637,48 @@ void Heartbeater::Thread::GenerateFullTabletReport(TabletReportPB* report) {
   server_->tablet_manager()->PopulateFullTabletReport(report);
 }
 
+void Heartbeater::Thread::GenerateLoadStats(TSLoadStatsPB* stats) {
+  CHECK(IsCurrentThread());
+  int64_t on_disk_size = 0;
+  int64_t memrowset_size = 0;
+  int64_t wal_bytes_logged = 0;
+  int64_t scans_started = 0;
+
+  vector<scoped_refptr<TabletPeer>> peers;
+  server_->tablet_manager()->GetTabletPeers(&peers);
+  for (const auto& peer : peers) {
+    shared_ptr<Tablet> tablet = peer->shared_tablet();
+    if (!tablet) {
+      continue;
+    }
+    on_disk_size += tablet->EstimateOnDiskSize();
+    memrowset_size += tablet->MemRowSetSize();
+    if (tablet->metrics()) {
+      scans_started += tablet->metrics()->scans_started->value();
+    }
+    if (tablet->GetMetricEntity()) {
+      wal_bytes_logged += METRIC_log_bytes_logged.Instantiate(tablet->GetMetricEntity())->value();
+    }
+  }
+  stats->set_on_disk_size_bytes(on_disk_size);
+  stats->set_memrowset_size_bytes(memrowset_size);
+
+  MonoTime now = MonoTime::Now();
+  if (last_load_stats_time_.Initialized()) {
+    double elapsed_secs = (now - last_load_stats_time_).ToSeconds();
+    if (elapsed_secs > 0) {
+      // The counters of replicas which were deleted since the previous call
+      // no longer count towards the sums, so the rates may not go negative.
+      stats->set_wal_bytes_per_sec(
+          std::max<int64_t>(0, wal_bytes_logged - last_wal_bytes_logged_) / elapsed_secs);
+      stats->set_scans_per_sec(
+          std::max<int64_t>(0, scans_started - last_scans_started_) / elapsed_secs);
+    }
+  }
+  last_wal_bytes_logged_ = wal_bytes_logged;
+  last_scans_started_ = scans_started;
+  last_load_stats_time_ = now;
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -0,0 +1,210 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_aggregator.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/schema.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+using std::vector;
+
+namespace kudu {
+namespace tserver {
+
+class ScanAggregatorTest : public KuduTest {
+ public:
+  ScanAggregatorTest()
+      : schema_({ ColumnSchema("key", INT32),
+                  ColumnSchema("g", STRING, true /* nullable */),
+                  ColumnSchema("v", INT32, true /* nullable */) },
+                1),
+        arena_(1024, 1024 * 1024),
+        block_(schema_, 10, &arena_) {
+  }
+
+  // Fills the block with rows where:
+  // - 'g' is NULL for every third row, and 'odd' or 'even' otherwise.
+  // - 'v' is NULL for every fourth row, and the row's index otherwise.
+  // The strings are copied into the block's arena, so that they may be
+  // overwritten by resetting it.
+  void FillBlock() {
+    arena_.Reset();
+    block_.selection_vector()->SetAllTrue();
+    for (int i = 0; i < block_.nrows(); i++) {
+      RowBlockRow row = block_.row(i);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(0)) = i;
+      row.cell(1).set_null(i % 3 == 0);
+      Slice g;
+      CHECK(arena_.RelocateSlice(i % 2 ? "odd" : "even", &g));
+      *reinterpret_cast<Slice*>(row.mutable_cell_ptr(1)) = g;
+      row.cell(2).set_null(i % 4 == 0);
+      *reinterpret_cast<int32_t*>(row.mutable_cell_ptr(2)) = i;
+    }
+  }
+
+  // Returns the sorted result rows of 'aggregator' as strings.
+  vector<string> Results(ScanAggregator* aggregator) {
+    RowwiseRowBlockPB pb;
+    faststring direct, indirect;
+    aggregator->SerializeResults(&pb, &direct, &indirect);
+    Slice direct_slice = direct;
+    vector<const uint8_t*> row_ptrs;
+    CHECK_OK(ExtractRowsFromRowBlockPB(aggregator->result_schema(), pb, indirect,
+                                       &direct_slice, &row_ptrs));
+    vector<string> results;
+    for (const uint8_t* row_ptr : row_ptrs) {
+      ConstContiguousRow row(&aggregator->result_schema(), row_ptr);
+      results.push_back(aggregator->result_schema().DebugRow(row));
+    }
+    std::sort(results.begin(), results.end());
+    return results;
+  }
+
+  static void AddAggregate(AggregateSpecPB* spec, AggregatePB::Function function,
+                           const string& column) {
+    AggregatePB* agg = spec->add_aggregates();
+    agg->set_function(function);
+    if (!column.empty()) {
+      agg->set_column(column);
+    }
+  }
+
+ protected:
+  Schema schema_;
+  Arena arena_;
+  RowBlock block_;
+};
+
+TEST_F(ScanAggregatorTest, TestGroupBy) {
+  AggregateSpecPB spec;
+  spec.add_group_by_columns("g");
+  AddAggregate(&spec, AggregatePB::COUNT, "");
+  AddAggregate(&spec, AggregatePB::COUNT, "v");
+  AddAggregate(&spec, AggregatePB::SUM, "v");
+  AddAggregate(&spec, AggregatePB::MIN, "v");
+  AddAggregate(&spec, AggregatePB::MAX, "v");
+  gscoped_ptr<ScanAggregator> aggregator;
+  ASSERT_OK(ScanAggregator::Create(spec, &schema_, &aggregator));
+  vector<string> result_cols;
+  for (const ColumnSchema& col : aggregator->result_schema().columns()) {
+    result_cols.push_back(col.ToString());
+  }
+  ASSERT_EQ(vector<string>({ "g[string NULLABLE]",
+                             "count(*)[int64 NOT NULL]",
+                             "count(v)[int64 NOT NULL]",
+                             "sum(v)[int64 NULLABLE]",
+                             "min(v)[int32 NULLABLE]",
+                             "max(v)[int32 NULLABLE]" }),
+            result_cols);
+
+  // Aggregate the block twice: the counts and sums double, but the
+  // minimums and maximums don't change.
+  FillBlock();
+  aggregator->AddRowBlock(block_);
+  FillBlock();
+  aggregator->AddRowBlock(block_);
+  ASSERT_EQ(3, aggregator->num_groups());
+  vector<string> results = Results(aggregator.get());
+  ASSERT_EQ(3, results.size());
+  EXPECT_EQ("(string g=\"even\", int64 count(*)=6, int64 count(v)=2, int64 sum(v)=4, "
+            "int32 min(v)=2, int32 max(v)=2)", results[0]);
+  EXPECT_EQ("(string g=\"odd\", int64 count(*)=6, int64 count(v)=6, int64 sum(v)=26, "
+            "int32 min(v)=1, int32 max(v)=7)", results[1]);
+  EXPECT_EQ("(string g=NULL, int64 count(*)=8, int64 count(v)=6, int64 sum(v)=36, "
+            "int32 min(v)=3, int32 max(v)=9)", results[2]);
+}
+
+TEST_F(ScanAggregatorTest, TestNoGroupBy) {
+  AggregateSpecPB spec;
+  AddAggregate(&spec, AggregatePB::COUNT, "g");
+  AddAggregate(&spec, AggregatePB::MIN, "g");
+  AddAggregate(&spec, AggregatePB::MAX, "g");
+  gscoped_ptr<ScanAggregator> aggregator;
+  ASSERT_OK(ScanAggregator::Create(spec, &schema_, &aggregator));
+
+  // Without rows, there is a single group, with a COUNT of 0.
+  vector<string> results = Results(aggregator.get());
+  ASSERT_EQ(1, results.size());
+  EXPECT_EQ("(int64 count(g)=0, string min(g)=NULL, string max(g)=NULL)", results[0]);
+
+  // Only aggregate the first two rows, then reset the block's arena: the
+  // results must have copied the strings they kept.
+  FillBlock();
+  for (int i = 2; i < block_.nrows(); i++) {
+    block_.selection_vector()->SetRowUnselected(i);
+  }
+  aggregator->AddRowBlock(block_);
+  arena_.Reset();
+  for (int i = 0; i < 64; i++) {
+    Slice unused;
+    CHECK(arena_.RelocateSlice("xxxxxxxxxxxxxxxx", &unused));
+  }
+  results = Results(aggregator.get());
+  ASSERT_EQ(1, results.size());
+  EXPECT_EQ("(int64 count(g)=1, string min(g)=\"odd\", string max(g)=\"odd\")", results[0]);
+}
+
+TEST_F(ScanAggregatorTest, TestInvalidSpecs) {
+  gscoped_ptr<ScanAggregator> aggregator;
+  {
+    AggregateSpecPB spec;
+    Status s = ScanAggregator::Create(spec, &schema_, &aggregator);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  }
+  {
+    AggregateSpecPB spec;
+    spec.add_group_by_columns("not_a_column");
+    Status s = ScanAggregator::Create(spec, &schema_, &aggregator);
+    ASSERT_STR_CONTAINS(s.ToString(), "group-by column is not projected");
+  }
+  {
+    AggregateSpecPB spec;
+    AddAggregate(&spec, AggregatePB::SUM, "");
+    Status s = ScanAggregator::Create(spec, &schema_, &aggregator);
+    ASSERT_STR_CONTAINS(s.ToString(), "aggregate requires a column");
+  }
+  {
+    AggregateSpecPB spec;
+    AddAggregate(&spec, AggregatePB::SUM, "g");
+    Status s = ScanAggregator::Create(spec, &schema_, &aggregator);
+    ASSERT_STR_CONTAINS(s.ToString(), "SUM is not supported");
+  }
+  {
+    // The result columns would have the same name.
+    AggregateSpecPB spec;
+    AddAggregate(&spec, AggregatePB::COUNT, "");
+    AddAggregate(&spec, AggregatePB::COUNT, "");
+    Status s = ScanAggregator::Create(spec, &schema_, &aggregator);
+    ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+  }
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,417 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_aggregator.h"
+
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/common/row.h"
+#include "kudu/common/rowblock.h"
+#include "kudu/common/wire_protocol.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/pb_util.h"
+
+using std::string;
+using std::vector;
+using strings::Substitute;
+
+namespace kudu {
+namespace tserver {
+
+namespace {
+
+// Result cells aren't necessarily aligned.
+template<typename T>
+T LoadCell(const uint8_t* cell) {
+  T val;
+  memcpy(&val, cell, sizeof(val));
+  return val;
+}
+
+template<typename T>
+void StoreCell(uint8_t* cell, T val) {
+  memcpy(cell, &val, sizeof(val));
+}
+
+// Integer sums wrap on overflow rather than being undefined.
+int64_t AddToSum(int64_t sum, int64_t val) {
+  return static_cast<int64_t>(static_cast<uint64_t>(sum) + static_cast<uint64_t>(val));
+}
+
+double AddToSum(double sum, double val) {
+  return sum + val;
+}
+
+} // anonymous namespace
+
+Status ScanAggregator::Create(const AggregateSpecPB& spec, const Schema* projection,
+                              gscoped_ptr<ScanAggregator>* aggregator) {
+  gscoped_ptr<ScanAggregator> agg(new ScanAggregator(spec, projection));
+  RETURN_NOT_OK(agg->Init());
+  aggregator->swap(agg);
+  return Status::OK();
+}
+
+ScanAggregator::ScanAggregator(const AggregateSpecPB& spec, const Schema* projection)
+    : spec_(spec),
+      projection_(DCHECK_NOTNULL(projection)),
+      arena_(1024, 4 * 1024 * 1024) {
+}
+
+ScanAggregator::~ScanAggregator() {}
+
+Status ScanAggregator::Init() {
+  if (spec_.aggregates_size() == 0 && spec_.group_by_columns_size() == 0) {
+    return Status::InvalidArgument("aggregate spec has neither aggregates nor group-by columns");
+  }
+
+  vector<ColumnSchema> result_cols;
+  for (const string& name : spec_.group_by_columns()) {
+    int idx = projection_->find_column(name);
+    if (idx == Schema::kColumnNotFound) {
+      return Status::InvalidArgument("group-by column is not projected", name);
+    }
+    const ColumnSchema& col = projection_->column(idx);
+    result_cols.emplace_back(col.name(), col.type_info()->type(), col.is_nullable(),
+                             nullptr, nullptr, ColumnStorageAttributes(),
+                             col.type_attributes());
+    group_by_columns_.push_back(name);
+  }
+
+  for (const AggregatePB& agg : spec_.aggregates()) {
+    const ColumnSchema* col = nullptr;
+    if (agg.has_column()) {
+      int idx = projection_->find_column(agg.column());
+      if (idx == Schema::kColumnNotFound) {
+        return Status::InvalidArgument("aggregated column is not projected", agg.column());
+      }
+      col = &projection_->column(idx);
+    } else if (agg.function() != AggregatePB::COUNT) {
+      return Status::InvalidArgument("aggregate requires a column",
+                                     SecureShortDebugString(agg));
+    }
+    aggregate_columns_.push_back(col ? col->name() : "");
+    const string arg = col ? col->name() : "*";
+
+    switch (agg.function()) {
+      case AggregatePB::COUNT:
+        result_cols.emplace_back(Substitute("count($0)", arg), INT64);
+        break;
+      case AggregatePB::SUM: {
+        DataType sum_type;
+        switch (col->type_info()->type()) {
+          case INT8:
+          case INT16:
+          case INT32:
+          case INT64:
+            sum_type = INT64;
+            break;
+          case FLOAT:
+          case DOUBLE:
+            sum_type = DOUBLE;
+            break;
+          default:
+            return Status::InvalidArgument("SUM is not supported for column", col->ToString());
+        }
+        result_cols.emplace_back(Substitute("sum($0)", arg), sum_type, true);
+        break;
+      }
+      case AggregatePB::MIN:
+      case AggregatePB::MAX:
+        result_cols.emplace_back(
+            Substitute("$0($1)", agg.function() == AggregatePB::MIN ? "min" : "max", arg),
+            col->type_info()->type(), true, nullptr, nullptr, ColumnStorageAttributes(),
+            col->type_attributes());
+        break;
+      default:
+        return Status::InvalidArgument("unknown aggregate function",
+                                       SecureShortDebugString(agg));
+    }
+  }
+  RETURN_NOT_OK(result_schema_.Reset(result_cols, 0));
+
+  if (group_by_columns_.empty()) {
+    // Aggregate all the rows as one group, which exists even if there
+    // are no rows, so that e.g. COUNT(*) is 0 rather than absent.
+    AddGroup(nullptr, 0);
+  }
+  return Status::OK();
+}
+
+int ScanAggregator::AddGroup(const RowBlock* block, size_t row_idx) {
+  size_t row_size = ContiguousRowHelper::row_size(result_schema_);
+  uint8_t* row = static_cast<uint8_t*>(CHECK_NOTNULL(arena_.AllocateBytes(row_size)));
+  memset(row, 0, row_size);
+  ContiguousRow result_row(&result_schema_, row);
+
+  // The aggregates start out as 0 for COUNT, and NULL otherwise.
+  for (int i = group_by_columns_.size(); i < result_schema_.num_columns(); i++) {
+    if (result_schema_.column(i).is_nullable()) {
+      result_row.set_null(i, true);
+    }
+  }
+
+  for (int i = 0; i < group_by_columns_.size(); i++) {
+    DCHECK(block);
+    ColumnBlock cblock = block->column_block(group_by_block_idx_[i]);
+    bool is_null = cblock.is_nullable() && cblock.is_null(row_idx);
+    if (cblock.is_nullable()) {
+      result_row.set_null(i, is_null);
+    }
+    if (is_null) {
+      continue;
+    }
+    if (cblock.type_info()->physical_type() == BINARY) {
+      Slice cell = LoadCell<Slice>(cblock.cell_ptr(row_idx));
+      CHECK(arena_.RelocateSlice(cell, &cell));
+      StoreCell(result_row.mutable_cell_ptr(i), cell);
+    } else {
+      memcpy(result_row.mutable_cell_ptr(i), cblock.cell_ptr(row_idx), cblock.stride());
+    }
+  }
+
+  group_rows_.push_back(row);
+  is_dirty_.resize(group_rows_.size() * result_schema_.num_columns(), false);
+  return group_rows_.size() - 1;
+}
+
+int ScanAggregator::FindOrAddGroup(const RowBlock& block, size_t row_idx) {
+  // The encoding only needs to be unambiguous: a NULL flag for nullable
+  // cells, and a length ahead of variable-length ones.
+  group_key_.clear();
+  for (int block_idx : group_by_block_idx_) {
+    ColumnBlock cblock = block.column_block(block_idx);
+    if (cblock.is_nullable()) {
+      bool is_null = cblock.is_null(row_idx);
+      group_key_.push_back(is_null ? '\0' : '\1');
+      if (is_null) {
+        continue;
+      }
+    }
+    if (cblock.type_info()->physical_type() == BINARY) {
+      Slice cell = LoadCell<Slice>(cblock.cell_ptr(row_idx));
+      uint32_t size = cell.size();
+      group_key_.append(reinterpret_cast<const char*>(&size), sizeof(size));
+      group_key_.append(reinterpret_cast<const char*>(cell.data()), cell.size());
+    } else {
+      group_key_.append(reinterpret_cast<const char*>(cblock.cell_ptr(row_idx)),
+                        cblock.stride());
+    }
+  }
+
+  auto it = group_index_.find(group_key_);
+  if (it != group_index_.end()) {
+    return it->second;
+  }
+  int group_idx = AddGroup(&block, row_idx);
+  group_index_.emplace(group_key_, group_idx);
+  return group_idx;
+}
+
+bool ScanAggregator::CountsRowsOnly(const AggregateSpecPB& spec) {
+  if (spec.group_by_columns_size() > 0) {
+    return false;
+  }
+  for (const AggregatePB& aggregate : spec.aggregates()) {
+    if (aggregate.function() != AggregatePB::COUNT || aggregate.has_column()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ScanAggregator::AddRowCount(int64_t num_rows) {
+  DCHECK(CountsRowsOnly(spec_));
+  DCHECK_EQ(1, group_rows_.size());
+  for (int i = 0; i < spec_.aggregates_size(); i++) {
+    uint8_t* cell = group_rows_[0] + result_schema_.column_offset(i);
+    StoreCell<int64_t>(cell, LoadCell<int64_t>(cell) + num_rows);
+  }
+}
+
+void ScanAggregator::AddRowBlock(const RowBlock& block) {
+  const Schema& block_schema = block.schema();
+  group_by_block_idx_.clear();
+  for (const string& name : group_by_columns_) {
+    int idx = block_schema.find_column(name);
+    DCHECK_NE(idx, Schema::kColumnNotFound) << name;
+    group_by_block_idx_.push_back(idx);
+  }
+
+  const SelectionVector* sel = block.selection_vector();
+  row_groups_.assign(block.nrows(), -1);
+  for (size_t i = 0; i < block.nrows(); i++) {
+    if (sel->IsRowSelected(i)) {
+      row_groups_[i] = group_by_columns_.empty() ? 0 : FindOrAddGroup(block, i);
+    }
+  }
+
+  for (int i = 0; i < spec_.aggregates_size(); i++) {
+    int result_col_idx = group_by_columns_.size() + i;
+    if (aggregate_columns_[i].empty()) {
+      Count(nullptr, result_col_idx);
+      continue;
+    }
+    int block_idx = block_schema.find_column(aggregate_columns_[i]);
+    DCHECK_NE(block_idx, Schema::kColumnNotFound) << aggregate_columns_[i];
+    ColumnBlock cblock = block.column_block(block_idx);
+
+    switch (spec_.aggregates(i).function()) {
+      case AggregatePB::COUNT:
+        Count(&cblock, result_col_idx);
+        break;
+      case AggregatePB::SUM:
+        switch (cblock.type_info()->type()) {
+          case INT8: Sum<int8_t, int64_t>(cblock, result_col_idx); break;
+          case INT16: Sum<int16_t, int64_t>(cblock, result_col_idx); break;
+          case INT32: Sum<int32_t, int64_t>(cblock, result_col_idx); break;
+          case INT64: Sum<int64_t, int64_t>(cblock, result_col_idx); break;
+          case FLOAT: Sum<float, double>(cblock, result_col_idx); break;
+          case DOUBLE: Sum<double, double>(cblock, result_col_idx); break;
+          default: LOG(FATAL) << "unexpected type for SUM: " << cblock.type_info()->name();
+        }
+        break;
+      case AggregatePB::MIN:
+        MinOrMax<true>(cblock, result_col_idx);
+        break;
+      case AggregatePB::MAX:
+        MinOrMax<false>(cblock, result_col_idx);
+        break;
+      default:
+        LOG(FATAL) << "unexpected aggregate function: " << spec_.aggregates(i).function();
+    }
+  }
+
+  // The block's data may be destroyed once this returns.
+  RelocateDirtyCells();
+}
+
+void ScanAggregator::Count(const ColumnBlock* cblock, int result_col_idx) {
+  size_t offset = result_schema_.column_offset(result_col_idx);
+  bool check_nulls = cblock && cblock->is_nullable();
+  for (size_t i = 0; i < row_groups_.size(); i++) {
+    int group_idx = row_groups_[i];
+    if (group_idx < 0 || (check_nulls && cblock->is_null(i))) {
+      continue;
+    }
+    uint8_t* cell = group_rows_[group_idx] + offset;
+    StoreCell<int64_t>(cell, LoadCell<int64_t>(cell) + 1);
+  }
+}
+
+template<typename CppType, typename SumType>
+void ScanAggregator::Sum(const ColumnBlock& cblock, int result_col_idx) {
+  size_t offset = result_schema_.column_offset(result_col_idx);
+  bool is_nullable = cblock.is_nullable();
+  for (size_t i = 0; i < row_groups_.size(); i++) {
+    int group_idx = row_groups_[i];
+    if (group_idx < 0 || (is_nullable && cblock.is_null(i))) {
+      continue;
+    }
+    SumType val = LoadCell<CppType>(cblock.cell_ptr(i));
+    uint8_t* row = group_rows_[group_idx];
+    uint8_t* cell = row + offset;
+    if (ContiguousRowHelper::is_null(result_schema_, row, result_col_idx)) {
+      StoreCell<SumType>(cell, val);
+      ContiguousRowHelper::SetCellIsNull(result_schema_, row, result_col_idx, false);
+    } else {
+      StoreCell<SumType>(cell, AddToSum(LoadCell<SumType>(cell), val));
+    }
+  }
+}
+
+template<bool IS_MIN>
+void ScanAggregator::MinOrMax(const ColumnBlock& cblock, int result_col_idx) {
+  const TypeInfo* type_info = cblock.type_info();
+  bool is_varlen = type_info->physical_type() == BINARY;
+  bool is_nullable = cblock.is_nullable();
+  size_t offset = result_schema_.column_offset(result_col_idx);
+  size_t cell_size = type_info->size();
+  int num_result_cols = result_schema_.num_columns();
+  for (size_t i = 0; i < row_groups_.size(); i++) {
+    int group_idx = row_groups_[i];
+    if (group_idx < 0 || (is_nullable && cblock.is_null(i))) {
+      continue;
+    }
+    const uint8_t* src = cblock.cell_ptr(i);
+    uint8_t* row = group_rows_[group_idx];
+    uint8_t* cell = row + offset;
+    bool was_null = ContiguousRowHelper::is_null(result_schema_, row, result_col_idx);
+    if (!was_null) {
+      int cmp = type_info->Compare(src, cell);
+      if (IS_MIN ? cmp >= 0 : cmp <= 0) {
+        continue;
+      }
+    }
+    memcpy(cell, src, cell_size);
+    if (was_null) {
+      ContiguousRowHelper::SetCellIsNull(result_schema_, row, result_col_idx, false);
+    }
+    if (is_varlen) {
+      // The cell now refers to the block's data: copy that once the whole
+      // block has been aggregated, rather than for each new MIN or MAX.
+      int dirty_idx = group_idx * num_result_cols + result_col_idx;
+      if (!is_dirty_[dirty_idx]) {
+        is_dirty_[dirty_idx] = true;
+        dirty_cells_.push_back(dirty_idx);
+      }
+    }
+  }
+}
+
+void ScanAggregator::RelocateDirtyCells() {
+  int num_result_cols = result_schema_.num_columns();
+  for (int dirty_idx : dirty_cells_) {
+    uint8_t* cell = group_rows_[dirty_idx / num_result_cols] +
+                    result_schema_.column_offset(dirty_idx % num_result_cols);
+    Slice val = LoadCell<Slice>(cell);
+    CHECK(arena_.RelocateSlice(val, &val));
+    StoreCell(cell, val);
+    is_dirty_[dirty_idx] = false;
+  }
+  dirty_cells_.clear();
+}
+
+void ScanAggregator::SerializeResults(RowwiseRowBlockPB* rowblock_pb,
+                                      faststring* data_buf, faststring* indirect_data) {
+  if (group_rows_.empty()) {
+    return;
+  }
+  // The indirect data stays in 'arena_', so this arena only backs the block.
+  Arena arena(1024, 1024 * 1024);
+  RowBlock block(result_schema_, group_rows_.size(), &arena);
+  for (size_t i = 0; i < group_rows_.size(); i++) {
+    ConstContiguousRow src(&result_schema_, group_rows_[i]);
+    RowBlockRow dst = block.row(i);
+    CHECK_OK(CopyRow(src, &dst, reinterpret_cast<Arena*>(NULL)));
+  }
+  block.selection_vector()->SetAllTrue();
+  SerializeRowBlock(block, rowblock_pb, nullptr, data_buf, indirect_data);
+}
+
+int64_t ScanAggregator::ResultSize() const {
+  return arena_.memory_footprint();
+}
+
+} // namespace tserver
+} // namespace kudu
@@ -0,0 +1,151 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_SCAN_AGGREGATOR_H
+#define KUDU_TSERVER_SCAN_AGGREGATOR_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "kudu/common/schema.h"
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/memory/arena.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+class ColumnBlock;
+class RowBlock;
+class faststring;
+
+namespace tserver {
+
+// Evaluates the aggregates of an AggregateSpecPB over the selected rows of
+// RowBlocks, keeping a partial result per group of rows. The results are
+// rows of result_schema(): the group-by columns followed by a column per
+// aggregate.
+//
+// The memory used grows with the number of groups, which the caller should
+// bound (e.g. with ResultSize()).
+class ScanAggregator {
+ public:
+  // Creates an aggregator for 'spec' over rows with the columns of
+  // 'projection', which must outlive the aggregator.
+  //
+  // Returns Status::InvalidArgument if 'spec' is malformed, refers to
+  // columns which aren't in 'projection', or sums a column for which
+  // SUM isn't supported.
+  static Status Create(const AggregateSpecPB& spec, const Schema* projection,
+                       gscoped_ptr<ScanAggregator>* aggregator);
+
+  ~ScanAggregator();
+
+  // Returns true if 'spec' only counts rows, i.e. it has no group-by columns
+  // and only has COUNT aggregates without a column, so that its results only
+  // depend on the number of rows (see AddRowCount()).
+  static bool CountsRowsOnly(const AggregateSpecPB& spec);
+
+  // Aggregates the selected rows of 'block', whose schema must contain
+  // the columns of the projection.
+  void AddRowBlock(const RowBlock& block);
+
+  // Aggregates 'num_rows' rows without looking at them. The spec must
+  // satisfy CountsRowsOnly().
+  void AddRowCount(int64_t num_rows);
+
+  // Appends a row per group to 'rowblock_pb' and the data buffers, as
+  // SerializeRowBlock() would.
+  void SerializeResults(RowwiseRowBlockPB* rowblock_pb,
+                        faststring* data_buf, faststring* indirect_data);
+
+  const Schema& result_schema() const { return result_schema_; }
+
+  int num_groups() const { return group_rows_.size(); }
+
+  // Returns an estimate of the size of the serialized results.
+  int64_t ResultSize() const;
+
+ private:
+  ScanAggregator(const AggregateSpecPB& spec, const Schema* projection);
+
+  Status Init();
+
+  // Returns the index of the group of row 'row_idx' of 'block', adding
+  // the group if it's new.
+  int FindOrAddGroup(const RowBlock& block, size_t row_idx);
+
+  // Adds a group whose group-by cells are those of row 'row_idx' of 'block',
+  // or if 'block' is null (and there are no group-by columns), the only group.
+  int AddGroup(const RowBlock* block, size_t row_idx);
+
+  // Update the aggregate in result column 'result_col_idx' with the cells
+  // of 'cblock' in the rows mapped to a group by 'row_groups_'.
+  void Count(const ColumnBlock* cblock, int result_col_idx);
+  template<typename CppType, typename SumType>
+  void Sum(const ColumnBlock& cblock, int result_col_idx);
+  template<bool IS_MIN>
+  void MinOrMax(const ColumnBlock& cblock, int result_col_idx);
+
+  // Copies the BINARY cells which MinOrMax() pointed at the data of the
+  // current block into 'arena_'.
+  void RelocateDirtyCells();
+
+  const AggregateSpecPB spec_;
+  const Schema* const projection_;
+
+  Schema result_schema_;
+
+  // The names of the projected columns to group by, and for each
+  // aggregate, of the aggregated column (empty for COUNT(*)).
+  std::vector<std::string> group_by_columns_;
+  std::vector<std::string> aggregate_columns_;
+
+  // The result row of each group, in the ContiguousRow format of
+  // 'result_schema_', allocated from 'arena_'.
+  std::vector<uint8_t*> group_rows_;
+
+  // Maps the encoded group-by cells of each group to its index.
+  std::unordered_map<std::string, int> group_index_;
+
+  // For each row of the block being aggregated, the index of its group, or
+  // -1 if the row is not selected.
+  std::vector<int> row_groups_;
+
+  // The columns of the block being aggregated which hold the group-by cells.
+  std::vector<int> group_by_block_idx_;
+
+  // BINARY result cells which refer to data of the block being aggregated,
+  // each identified by its index in 'is_dirty_', which is the index of its
+  // group times the number of result columns plus its column index.
+  std::vector<int> dirty_cells_;
+  std::vector<bool> is_dirty_;
+
+  // Scratch space for the encoded group-by cells of a row.
+  std::string group_key_;
+
+  // Holds the result rows and their indirect data.
+  Arena arena_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanAggregator);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif
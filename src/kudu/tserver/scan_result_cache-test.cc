@@ -0,0 +1,138 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_result_cache.h"
+
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/slice.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+
+namespace kudu {
+namespace tserver {
+
+class ScanResultCacheTest : public KuduTest {
+ public:
+  ScanResultCacheTest()
+      : cache_(1024 * 1024, scoped_refptr<MetricEntity>()) {
+  }
+
+  static NewScanRequestPB SnapshotScan() {
+    NewScanRequestPB scan_pb;
+    scan_pb.set_tablet_id("tablet");
+    scan_pb.set_read_mode(READ_AT_SNAPSHOT);
+    scan_pb.set_snap_timestamp(12345);
+    scan_pb.set_limit(10);
+    return scan_pb;
+  }
+
+ protected:
+  ScanResultCache cache_;
+};
+
+TEST_F(ScanResultCacheTest, TestOnlySnapshotScansAreCacheable) {
+  string key;
+  NewScanRequestPB scan_pb = SnapshotScan();
+  ASSERT_TRUE(ScanResultCache::MakeKey(scan_pb, 0, &key));
+
+  scan_pb.clear_snap_timestamp();
+  ASSERT_FALSE(ScanResultCache::MakeKey(scan_pb, 0, &key));
+
+  scan_pb = SnapshotScan();
+  scan_pb.set_read_mode(READ_LATEST);
+  ASSERT_FALSE(ScanResultCache::MakeKey(scan_pb, 0, &key));
+
+  scan_pb = SnapshotScan();
+  scan_pb.set_columnar_layout(true);
+  ASSERT_FALSE(ScanResultCache::MakeKey(scan_pb, 0, &key));
+
+  scan_pb = SnapshotScan();
+  scan_pb.set_profile(true);
+  ASSERT_FALSE(ScanResultCache::MakeKey(scan_pb, 0, &key));
+}
+
+TEST_F(ScanResultCacheTest, TestKeys) {
+  string key;
+  ASSERT_TRUE(ScanResultCache::MakeKey(SnapshotScan(), 0, &key));
+
+  // The fields which don't change the result aren't part of the key.
+  NewScanRequestPB scan_pb = SnapshotScan();
+  scan_pb.set_propagated_timestamp(23456);
+  scan_pb.set_cache_blocks(false);
+  scan_pb.set_sidecar_compression(LZ4);
+  string other_key;
+  ASSERT_TRUE(ScanResultCache::MakeKey(scan_pb, 0, &other_key));
+  ASSERT_EQ(key, other_key);
+
+  // Those which do are.
+  ASSERT_TRUE(ScanResultCache::MakeKey(SnapshotScan(), 1, &other_key));
+  ASSERT_NE(key, other_key);
+  scan_pb = SnapshotScan();
+  scan_pb.set_snap_timestamp(12346);
+  ASSERT_TRUE(ScanResultCache::MakeKey(scan_pb, 0, &other_key));
+  ASSERT_NE(key, other_key);
+  scan_pb = SnapshotScan();
+  scan_pb.set_limit(11);
+  ASSERT_TRUE(ScanResultCache::MakeKey(scan_pb, 0, &other_key));
+  ASSERT_NE(key, other_key);
+}
+
+TEST_F(ScanResultCacheTest, TestInsertAndLookup) {
+  string key;
+  ASSERT_TRUE(ScanResultCache::MakeKey(SnapshotScan(), 0, &key));
+  int64_t num_rows;
+  faststring rows_data;
+  faststring indirect_data;
+  string last_primary_key;
+  ASSERT_FALSE(cache_.Lookup(key, 1024, &num_rows, &rows_data, &indirect_data,
+                             &last_primary_key));
+
+  cache_.Insert(key, 3, Slice("rows"), Slice("indirect"), Slice("last"));
+  ASSERT_TRUE(cache_.Lookup(key, 1024, &num_rows, &rows_data, &indirect_data,
+                            &last_primary_key));
+  ASSERT_EQ(3, num_rows);
+  ASSERT_EQ("rows", rows_data.ToString());
+  ASSERT_EQ("indirect", indirect_data.ToString());
+  ASSERT_EQ("last", last_primary_key);
+
+  // A scan asking for smaller batches can't be answered from the cache.
+  ASSERT_FALSE(cache_.Lookup(key, 3, &num_rows, &rows_data, &indirect_data,
+                             &last_primary_key));
+}
+
+TEST_F(ScanResultCacheTest, TestLargeResultsAreNotCached) {
+  string key;
+  ASSERT_TRUE(ScanResultCache::MakeKey(SnapshotScan(), 0, &key));
+  string rows(1024 * 1024 / 4, 'x');
+  cache_.Insert(key, 1, Slice(rows), Slice(), Slice());
+  int64_t num_rows;
+  faststring rows_data;
+  faststring indirect_data;
+  string last_primary_key;
+  ASSERT_FALSE(cache_.Lookup(key, rows.size(), &num_rows, &rows_data, &indirect_data,
+                             &last_primary_key));
+}
+
+} // namespace tserver
+} // namespace kudu
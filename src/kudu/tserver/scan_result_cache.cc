@@ -0,0 +1,144 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/tserver/scan_result_cache.h"
+
+#include <gflags/gflags.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/metrics.h"
+
+DEFINE_int64(scan_result_cache_capacity_mb, 0,
+             "Capacity of the cache of the results of snapshot scans, which "
+             "answers the scans identical to an earlier one from memory. Only "
+             "row-wise scans at a snapshot timestamp set by the client, which "
+             "return their whole result in one response, are cached. If 0, the "
+             "cache is disabled.");
+TAG_FLAG(scan_result_cache_capacity_mb, experimental);
+
+METRIC_DEFINE_counter(server, scan_result_cache_hits,
+                      "Scan Result Cache Hits",
+                      kudu::MetricUnit::kRequests,
+                      "Number of snapshot scans answered from the scan result cache");
+
+METRIC_DEFINE_counter(server, scan_result_cache_misses,
+                      "Scan Result Cache Misses",
+                      kudu::MetricUnit::kRequests,
+                      "Number of cacheable snapshot scans whose result wasn't in the "
+                      "scan result cache");
+
+namespace kudu {
+namespace tserver {
+
+gscoped_ptr<ScanResultCache> ScanResultCache::CreateIfEnabled(
+    const scoped_refptr<MetricEntity>& metric_entity) {
+  if (FLAGS_scan_result_cache_capacity_mb <= 0) {
+    return gscoped_ptr<ScanResultCache>();
+  }
+  return gscoped_ptr<ScanResultCache>(new ScanResultCache(
+      FLAGS_scan_result_cache_capacity_mb * 1024 * 1024, metric_entity));
+}
+
+ScanResultCache::ScanResultCache(size_t capacity_bytes,
+                                 const scoped_refptr<MetricEntity>& metric_entity)
+    : capacity_bytes_(capacity_bytes),
+      cache_(NewLRUCache(DRAM_CACHE, capacity_bytes, "scan_result_cache")) {
+  if (metric_entity) {
+    hits_ = METRIC_scan_result_cache_hits.Instantiate(metric_entity);
+    misses_ = METRIC_scan_result_cache_misses.Instantiate(metric_entity);
+  }
+}
+
+ScanResultCache::~ScanResultCache() {
+}
+
+bool ScanResultCache::MakeKey(const NewScanRequestPB& scan_pb, uint32_t schema_version,
+                              std::string* key) {
+  if (scan_pb.read_mode() != READ_AT_SNAPSHOT || !scan_pb.has_snap_timestamp() ||
+      scan_pb.columnar_layout() || scan_pb.profile()) {
+    return false;
+  }
+  // Leave out the fields which don't change the result.
+  NewScanRequestPB key_pb(scan_pb);
+  key_pb.clear_propagated_timestamp();
+  key_pb.clear_cache_blocks();
+  key_pb.clear_cache_blocks_low_priority();
+  key_pb.clear_readahead_blocks();
+  key_pb.clear_prefetch_next_batch();
+  key_pb.clear_sidecar_compression();
+  key_pb.clear_max_staleness_ms();
+  *key = strings::Substitute("$0:", schema_version);
+  return key_pb.AppendToString(key);
+}
+
+bool ScanResultCache::Lookup(const std::string& key, size_t max_rows_bytes, int64_t* num_rows,
+                             faststring* rows_data, faststring* indirect_data,
+                             std::string* last_primary_key) {
+  Cache::UniqueHandle handle(cache_->Lookup(key, Cache::EXPECT_IN_CACHE),
+                             Cache::HandleDeleter(cache_.get()));
+  if (!handle) {
+    if (misses_) misses_->Increment();
+    return false;
+  }
+  Slice value = cache_->Value(handle.get());
+  uint64_t rows;
+  Slice rows_slice;
+  Slice indirect_slice;
+  Slice last_key_slice;
+  CHECK(GetVarint64(&value, &rows) &&
+        GetLengthPrefixedSlice(&value, &rows_slice) &&
+        GetLengthPrefixedSlice(&value, &indirect_slice) &&
+        GetLengthPrefixedSlice(&value, &last_key_slice)) << "corrupt scan result cache entry";
+  if (rows_slice.size() > max_rows_bytes) {
+    if (misses_) misses_->Increment();
+    return false;
+  }
+  *num_rows = rows;
+  rows_data->assign_copy(rows_slice.data(), rows_slice.size());
+  indirect_data->assign_copy(indirect_slice.data(), indirect_slice.size());
+  *last_primary_key = last_key_slice.ToString();
+  if (hits_) hits_->Increment();
+  return true;
+}
+
+void ScanResultCache::Insert(const std::string& key, int64_t num_rows, const Slice& rows_data,
+                             const Slice& indirect_data, const Slice& last_primary_key) {
+  faststring value;
+  PutVarint64(&value, num_rows);
+  PutLengthPrefixedSlice(&value, rows_data);
+  PutLengthPrefixedSlice(&value, indirect_data);
+  PutLengthPrefixedSlice(&value, last_primary_key);
+
+  // Don't let a single large result flush most of the cache.
+  size_t charge = key.size() + value.size();
+  if (charge > capacity_bytes_ / 8) {
+    return;
+  }
+  Cache::PendingHandle* pending = cache_->Allocate(key, value.size(), charge);
+  if (pending == nullptr) {
+    return;
+  }
+  memcpy(cache_->MutableValue(pending), value.data(), value.size());
+  cache_->Release(cache_->Insert(pending, nullptr));
+}
+
+} // namespace tserver
+} // namespace kudu
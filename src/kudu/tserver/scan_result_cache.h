@@ -0,0 +1,90 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_TSERVER_SCAN_RESULT_CACHE_H
+#define KUDU_TSERVER_SCAN_RESULT_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/ref_counted.h"
+#include "kudu/util/faststring.h"
+#include "kudu/util/slice.h"
+
+namespace kudu {
+
+class Cache;
+class Counter;
+class MetricEntity;
+
+namespace tserver {
+
+class NewScanRequestPB;
+
+// Caches the results of the snapshot scans which are returned in a single
+// response, so that an identical scan repeated by many clients, such as those
+// of dashboards, is answered from memory rather than through the iterators.
+//
+// The result of a scan at a given snapshot timestamp never changes: the writes
+// past the snapshot aren't visible to it, and the scan waited for the writes
+// before it to be applied. So the entries aren't invalidated by writes. They're
+// keyed by the tablet's schema version and the scan request, and evicted in
+// LRU order when the cache is full. The cache's memory is tracked by the
+// "scan_result_cache" MemTracker.
+class ScanResultCache {
+ public:
+  // Returns a cache of --scan_result_cache_capacity_mb, or null if that is 0,
+  // which disables the cache.
+  static gscoped_ptr<ScanResultCache> CreateIfEnabled(
+      const scoped_refptr<MetricEntity>& metric_entity);
+
+  ScanResultCache(size_t capacity_bytes, const scoped_refptr<MetricEntity>& metric_entity);
+  ~ScanResultCache();
+
+  // Builds into 'key' the cache key of the scan requested by 'scan_pb' on a
+  // tablet at schema version 'schema_version'. Returns false if the scan's
+  // result isn't cacheable: only row-wise scans at a snapshot timestamp set
+  // by the client are.
+  static bool MakeKey(const NewScanRequestPB& scan_pb, uint32_t schema_version,
+                      std::string* key);
+
+  // Copies the result cached under 'key' into the out parameters. Returns
+  // false if there's none, or if its rows take more than 'max_rows_bytes',
+  // the batch size the scan asked for.
+  bool Lookup(const std::string& key, size_t max_rows_bytes, int64_t* num_rows,
+              faststring* rows_data, faststring* indirect_data,
+              std::string* last_primary_key);
+
+  // Caches a scan's result under 'key', unless it is too large.
+  void Insert(const std::string& key, int64_t num_rows, const Slice& rows_data,
+              const Slice& indirect_data, const Slice& last_primary_key);
+
+ private:
+  const size_t capacity_bytes_;
+  gscoped_ptr<Cache> cache_;
+
+  scoped_refptr<Counter> hits_;
+  scoped_refptr<Counter> misses_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanResultCache);
+};
+
+} // namespace tserver
+} // namespace kudu
+
+#endif // KUDU_TSERVER_SCAN_RESULT_CACHE_H
@@ -30,6 +30,19 @@ METRIC_DEFINE_histogram(server, scanner_duration,
                         "Histogram of the duration of active scanners on this tablet.",
                         60000000LU, 2);
 
+METRIC_DEFINE_counter(server, scan_batches_shrunk_memory_pressure,
+                      "Scan Batches Shrunk Due To Memory Pressure",
+                      kudu::MetricUnit::kRequests,
+                      "Number of scan RPCs whose batch size was reduced because the "
+                      "process was above its soft memory limit or the scanners' "
+                      "memory budget was exhausted");
+
+METRIC_DEFINE_counter(server, scans_deferred_memory_pressure,
+                      "Scans Deferred Due To Memory Pressure",
+                      kudu::MetricUnit::kRequests,
+                      "Number of scan RPCs rejected with a retriable 'server too busy' "
+                      "error because the scanners' memory budget was exhausted");
+
 namespace kudu {
 
 namespace tserver {
@@ -37,7 +50,11 @@ namespace tserver {
 ScannerMetrics::ScannerMetrics(const scoped_refptr<MetricEntity>& metric_entity)
     : scanners_expired(
           METRIC_scanners_expired.Instantiate(metric_entity)),
-      scanner_duration(METRIC_scanner_duration.Instantiate(metric_entity)) {
+      scanner_duration(METRIC_scanner_duration.Instantiate(metric_entity)),
+      scan_batches_shrunk_memory_pressure(
+          METRIC_scan_batches_shrunk_memory_pressure.Instantiate(metric_entity)),
+      scans_deferred_memory_pressure(
+          METRIC_scans_deferred_memory_pressure.Instantiate(metric_entity)) {
 }
 
 void ScannerMetrics::SubmitScannerDuration(const MonoTime& time_started) {
@@ -43,6 +43,13 @@ struct ScannerMetrics {
 
   // Keeps track of the duration of scanners.
   scoped_refptr<Histogram> scanner_duration;
+
+  // Number of scan RPCs whose batch size was reduced because of memory
+  // pressure.
+  scoped_refptr<Counter> scan_batches_shrunk_memory_pressure;
+
+  // Number of scan RPCs deferred because of memory pressure.
+  scoped_refptr<Counter> scans_deferred_memory_pressure;
 };
 
 } // namespace tserver
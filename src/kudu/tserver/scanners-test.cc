@@ -21,10 +21,14 @@
 #include <gtest/gtest.h>
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/tserver/scanner_metrics.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/test_util.h"
 
+DECLARE_int32(memory_limit_soft_percentage);
+DECLARE_int32(scanner_min_batch_size_bytes);
 DECLARE_int32(scanner_ttl_ms);
+DECLARE_int64(scanner_memory_limit_mb);
 
 namespace kudu {
 
@@ -81,5 +85,55 @@ TEST(ScannerTest, TestExpire) {
   ASSERT_EQ(s2->id(), active_scanners[0]->id());
 }
 
+// Test that scan batches are shrunk, and eventually deferred, as the
+// scanners' memory budget is used up.
+TEST(ScannerTest, TestReserveBatchMemory) {
+  google::FlagSaver saver;
+  // Make the soft limit equal to the hard limit so that batches are only
+  // shrunk deterministically, as the budget runs out.
+  FLAGS_memory_limit_soft_percentage = 100;
+  FLAGS_scanner_memory_limit_mb = 1;
+  FLAGS_scanner_min_batch_size_bytes = 64 * 1024;
+  MetricRegistry registry;
+  ScannerManager mgr(METRIC_ENTITY_server.Instantiate(&registry, "test"));
+
+  // A batch which fits in the budget is reserved in full. Each batch reserves
+  // room for two result buffers of 110% of the batch size.
+  size_t batch_size_bytes = 256 * 1024;
+  int64_t reserved1;
+  ASSERT_TRUE(mgr.ReserveBatchMemory(&batch_size_bytes, &reserved1));
+  ASSERT_EQ(256 * 1024, batch_size_bytes);
+  ASSERT_EQ(2 * (256 * 1024 * 11 / 10), reserved1);
+
+  // Larger batches are halved until they fit.
+  batch_size_bytes = 1024 * 1024;
+  int64_t reserved2;
+  ASSERT_TRUE(mgr.ReserveBatchMemory(&batch_size_bytes, &reserved2));
+  ASSERT_EQ(128 * 1024, batch_size_bytes);
+
+  // ...but never below the minimum batch size.
+  batch_size_bytes = 1024 * 1024;
+  int64_t reserved3;
+  ASSERT_TRUE(mgr.ReserveBatchMemory(&batch_size_bytes, &reserved3));
+  ASSERT_EQ(64 * 1024, batch_size_bytes);
+  ASSERT_EQ(2, mgr.metrics_->scan_batches_shrunk_memory_pressure->value());
+
+  // Once not even the minimum batch fits, the RPC is deferred.
+  batch_size_bytes = 1024 * 1024;
+  int64_t reserved4;
+  ASSERT_FALSE(mgr.ReserveBatchMemory(&batch_size_bytes, &reserved4));
+  ASSERT_EQ(1, mgr.metrics_->scans_deferred_memory_pressure->value());
+
+  // Requests which return no rows are always admitted.
+  batch_size_bytes = 0;
+  ASSERT_TRUE(mgr.ReserveBatchMemory(&batch_size_bytes, &reserved4));
+  ASSERT_EQ(0, reserved4);
+
+  mgr.ReleaseBatchMemory(reserved1);
+  mgr.ReleaseBatchMemory(reserved2);
+  mgr.ReleaseBatchMemory(reserved3);
+  ASSERT_EQ(0, mgr.mem_tracker()->consumption());
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -16,6 +16,7 @@
 // under the License.
 #include "kudu/tserver/scanners.h"
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <mutex>
 
@@ -24,8 +25,11 @@
 #include "kudu/gutil/hash/string_hash.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/tserver/scanner_metrics.h"
+#include "kudu/tserver/tserver.pb.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/mem_tracker.h"
 #include "kudu/util/thread.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/metrics.h"
 
 DEFINE_int32(scanner_ttl_ms, 60000,
@@ -36,6 +40,26 @@ DEFINE_int32(scanner_gc_check_interval_us, 5 * 1000L *1000L, // 5 seconds
              "Number of microseconds in the interval at which we remove expired scanners");
 TAG_FLAG(scanner_gc_check_interval_us, hidden);
 
+DEFINE_int64(scanner_memory_limit_mb, -1,
+             "Maximum amount of memory used by the result buffers of in-flight "
+             "scan RPCs. When exhausted, scan RPCs are given smaller batches "
+             "and, failing that, deferred with a 'server too busy' error which "
+             "causes clients to retry later. If -1, scans are limited only by "
+             "the process-wide memory limit.");
+TAG_FLAG(scanner_memory_limit_mb, advanced);
+
+DEFINE_int32(scanner_min_batch_size_bytes, 64 * 1024,
+             "Smallest batch size, in bytes, that scan RPCs are reduced to when "
+             "the process is above its soft memory limit or the scanners' "
+             "memory budget is exhausted.");
+TAG_FLAG(scanner_min_batch_size_bytes, advanced);
+TAG_FLAG(scanner_min_batch_size_bytes, runtime);
+
+DEFINE_int32(scanner_prefetch_threads, 8,
+             "Maximum number of threads building the next batches of scans "
+             "which request prefetching, ahead of the RPCs which return them.");
+TAG_FLAG(scanner_prefetch_threads, advanced);
+
 // TODO: would be better to scope this at a tablet level instead of
 // server level.
 METRIC_DEFINE_gauge_size(server, active_scanners,
@@ -45,12 +69,16 @@ METRIC_DEFINE_gauge_size(server, active_scanners,
 
 namespace kudu {
 
+using std::shared_ptr;
 using tablet::TabletPeer;
 
 namespace tserver {
 
 ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity)
-    : shutdown_(false),
+    : mem_tracker_(MemTracker::FindOrCreateGlobalTracker(
+          FLAGS_scanner_memory_limit_mb < 0 ? -1 : FLAGS_scanner_memory_limit_mb * 1024 * 1024,
+          "scanners")),
+      shutdown_(false),
       shutdown_cv_(&shutdown_lock_) {
   if (metric_entity) {
     metrics_.reset(new ScannerMetrics(metric_entity));
@@ -62,6 +90,10 @@ ScannerManager::ScannerManager(const scoped_refptr<MetricEntity>& metric_entity)
   for (size_t i = 0; i < kNumScannerMapStripes; i++) {
     scanner_maps_.push_back(new ScannerMapStripe());
   }
+  CHECK_OK(ThreadPoolBuilder("scan-prefetch")
+           .set_min_threads(0)
+           .set_max_threads(std::max(FLAGS_scanner_prefetch_threads, 1))
+           .Build(&prefetch_pool_));
 }
 
 ScannerManager::~ScannerManager() {
@@ -73,6 +105,7 @@ ScannerManager::~ScannerManager() {
   if (removal_thread_.get() != nullptr) {
     CHECK_OK(ThreadJoiner(removal_thread_.get()).Join());
   }
+  prefetch_pool_->Shutdown();
   STLDeleteElements(&scanner_maps_);
 }
 
@@ -177,6 +210,70 @@ void ScannerManager::RemoveExpiredScanners() {
   }
 }
 
+namespace {
+
+// Returns the number of bytes which the result buffers of a scan RPC with the
+// given batch size occupy. See TabletServiceImpl::Scan().
+int64_t BatchBufferBytes(size_t batch_size_bytes) {
+  return 2 * (batch_size_bytes * 11 / 10);
+}
+
+} // anonymous namespace
+
+bool ScannerManager::ReserveBatchMemory(size_t* batch_size_bytes, int64_t* reserved) {
+  size_t batch = *batch_size_bytes;
+  if (batch == 0) {
+    *reserved = 0;
+    return true;
+  }
+  size_t min_batch = std::min(batch,
+                              implicit_cast<size_t>(std::max(FLAGS_scanner_min_batch_size_bytes, 0)));
+  double capacity_pct;
+  if (PREDICT_FALSE(mem_tracker_->AnySoftLimitExceeded(&capacity_pct))) {
+    batch = min_batch;
+  }
+  while (true) {
+    int64_t bytes = BatchBufferBytes(batch);
+    if (PREDICT_TRUE(mem_tracker_->TryConsume(bytes))) {
+      if (PREDICT_FALSE(batch < *batch_size_bytes) && metrics_) {
+        metrics_->scan_batches_shrunk_memory_pressure->Increment();
+      }
+      *batch_size_bytes = batch;
+      *reserved = bytes;
+      return true;
+    }
+    if (batch <= min_batch) {
+      break;
+    }
+    batch = std::max(batch / 2, min_batch);
+  }
+  if (metrics_) {
+    metrics_->scans_deferred_memory_pressure->Increment();
+  }
+  return false;
+}
+
+void ScannerManager::ReleaseBatchMemory(int64_t reserved) {
+  mem_tracker_->Release(reserved);
+}
+
+Status ScannerManager::SubmitPrefetch(boost::function<void()> task) {
+  return prefetch_pool_->SubmitFunc(std::move(task));
+}
+
+PrefetchedScanBatch::PrefetchedScanBatch(ScannerManager* manager, int64_t reserved_bytes)
+    : blocks_processed(0),
+      num_rows_returned(0),
+      rows_scanned(0),
+      serialize_nanos(0),
+      manager_(manager),
+      reserved_bytes_(reserved_bytes) {
+}
+
+PrefetchedScanBatch::~PrefetchedScanBatch() {
+  manager_->ReleaseBatchMemory(reserved_bytes_);
+}
+
 Scanner::Scanner(string id, const scoped_refptr<TabletPeer>& tablet_peer,
                  string requestor_string, ScannerMetrics* metrics)
     : id_(std::move(id)),
@@ -185,6 +282,12 @@ Scanner::Scanner(string id, const scoped_refptr<TabletPeer>& tablet_peer,
       call_seq_id_(0),
       start_time_(MonoTime::Now()),
       metrics_(metrics),
+      columnar_layout_(false),
+      sidecar_compression_(NO_COMPRESSION),
+      prefetch_enabled_(false),
+      profile_enabled_(false),
+      prefetch_cond_(&prefetch_lock_),
+      prefetch_in_flight_(false),
       arena_(1024, 1024 * 1024) {
   UpdateAccessTime();
 }
@@ -212,6 +315,29 @@ const ScanSpec& Scanner::spec() const {
   return *spec_;
 }
 
+void Scanner::StartPrefetch() {
+  MutexLock l(prefetch_lock_);
+  DCHECK(!prefetch_in_flight_);
+  DCHECK(!prefetched_batch_);
+  prefetch_in_flight_ = true;
+}
+
+void Scanner::FinishPrefetch(shared_ptr<PrefetchedScanBatch> batch) {
+  MutexLock l(prefetch_lock_);
+  DCHECK(prefetch_in_flight_);
+  prefetch_in_flight_ = false;
+  prefetched_batch_ = std::move(batch);
+  prefetch_cond_.Broadcast();
+}
+
+shared_ptr<PrefetchedScanBatch> Scanner::TakePrefetchedBatch() {
+  MutexLock l(prefetch_lock_);
+  while (prefetch_in_flight_) {
+    prefetch_cond_.Wait();
+  }
+  return std::move(prefetched_batch_);
+}
+
 void Scanner::GetIteratorStats(vector<IteratorStats>* stats) const {
   iter_->GetIteratorStats(stats);
 }
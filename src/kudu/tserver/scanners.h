@@ -17,6 +17,7 @@
 #ifndef KUDU_TSERVER_SCANNERS_H
 #define KUDU_TSERVER_SCANNERS_H
 
+#include <boost/function.hpp>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -25,31 +26,38 @@
 #include <vector>
 
 #include "kudu/common/iterator_stats.h"
+#include "kudu/common/wire_protocol.pb.h"
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tablet/tablet_peer.h"
 #include "kudu/util/auto_release_pool.h"
+#include "kudu/util/compression/compression.pb.h"
+#include "kudu/util/condition_variable.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/memory/arena.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/oid_generator.h"
 #include "kudu/util/rw_mutex.h"
+#include "kudu/util/status.h"
 
 namespace kudu {
 
+class MemTracker;
 class MetricEntity;
 class RowwiseIterator;
 class ScanSpec;
 class Schema;
-class Status;
 class Thread;
+class ThreadPool;
 
 struct IteratorStats;
 
 namespace tserver {
 
+class AggregateSpecPB;
 class Scanner;
 struct ScannerMetrics;
 typedef std::shared_ptr<Scanner> SharedScanner;
@@ -96,8 +104,30 @@ class ScannerManager {
   // Iterate through scanners and remove any which are past their TTL.
   void RemoveExpiredScanners();
 
+  // Reserves memory from the scanners' memory budget for the result buffers
+  // of a scan RPC returning up to '*batch_size_bytes'. If a soft memory limit
+  // is exceeded or the budget can't cover the full batch, '*batch_size_bytes'
+  // is reduced, though never below --scanner_min_batch_size_bytes.
+  //
+  // On success, sets '*reserved' to the number of bytes reserved, which must
+  // later be returned with ReleaseBatchMemory(). Returns false if not even the
+  // smallest batch fits in the budget, in which case the RPC should be
+  // deferred.
+  bool ReserveBatchMemory(size_t* batch_size_bytes, int64_t* reserved);
+
+  // Releases memory reserved by ReserveBatchMemory().
+  void ReleaseBatchMemory(int64_t reserved);
+
+  // Returns the MemTracker which scan memory is charged to.
+  const std::shared_ptr<MemTracker>& mem_tracker() const { return mem_tracker_; }
+
+  // Submits 'task', which builds the next batch of a scanner ahead of the RPC
+  // which returns it, to the scan prefetch thread pool.
+  Status SubmitPrefetch(boost::function<void()> task) WARN_UNUSED_RESULT;
+
  private:
   FRIEND_TEST(ScannerTest, TestExpire);
+  FRIEND_TEST(ScannerTest, TestReserveBatchMemory);
 
   enum {
     kNumScannerMapStripes = 32
@@ -122,6 +152,10 @@ class ScannerManager {
   // (Optional) scanner metrics for this instance.
   gscoped_ptr<ScannerMetrics> metrics_;
 
+  // Tracks memory used by scan RPCs. Limited by --scanner_memory_limit_mb
+  // and by the process-wide limits of its ancestors.
+  std::shared_ptr<MemTracker> mem_tracker_;
+
   // If true, removal thread should shut itself down. Protected
   // by 'shutdown_lock_' and 'shutdown_cv_'.
   bool shutdown_;
@@ -136,6 +170,9 @@ class ScannerManager {
   // Thread to remove expired scanners.
   scoped_refptr<kudu::Thread> removal_thread_;
 
+  // Threads building the next batches of prefetching scanners.
+  gscoped_ptr<ThreadPool> prefetch_pool_;
+
   FunctionGaugeDetacher metric_detacher_;
 
   DISALLOW_COPY_AND_ASSIGN(ScannerManager);
@@ -164,6 +201,42 @@ class ScopedUnregisterScanner {
   bool cancelled_;
 };
 
+// A batch of row-wise results of a scanner, built in the background ahead of
+// the continuation RPC which returns it. See Scanner::StartPrefetch().
+struct PrefetchedScanBatch {
+  // 'reserved_bytes' of the scanners' memory budget, reserved with
+  // ScannerManager::ReserveBatchMemory(), are held by the batch until it is
+  // destroyed.
+  PrefetchedScanBatch(ScannerManager* manager, int64_t reserved_bytes);
+  ~PrefetchedScanBatch();
+
+  // The result of building the batch. The other fields are only meaningful
+  // if it is OK.
+  Status status;
+
+  RowwiseRowBlockPB data;
+  faststring rows_data;
+  faststring indirect_data;
+
+  // The encoded primary key of the last row returned, if any.
+  faststring last_primary_key;
+
+  int blocks_processed;
+  int64_t num_rows_returned;
+
+  // The number of rows read, regardless of predicates or deletions.
+  int64_t rows_scanned;
+
+  // The time spent serializing the rows into the batch.
+  int64_t serialize_nanos;
+
+ private:
+  ScannerManager* const manager_;
+  const int64_t reserved_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(PrefetchedScanBatch);
+};
+
 // An open scanner on the server side.
 class Scanner {
  public:
@@ -262,6 +335,46 @@ class Scanner {
   // See the note about 'set_client_projection_schema' above.
   const Schema* client_projection_schema() const { return client_projection_schema_.get(); }
 
+  // Whether the scan results are returned in a ColumnarRowBlockPB rather
+  // than a RowwiseRowBlockPB. Fixed when the scanner is created.
+  void set_columnar_layout(bool columnar_layout) { columnar_layout_ = columnar_layout; }
+  bool columnar_layout() const { return columnar_layout_; }
+
+  // The aggregates to return rather than the scanned rows, if any. Fixed
+  // when the scanner is created.
+  void set_aggregate_spec(gscoped_ptr<AggregateSpecPB> aggregate_spec) {
+    aggregate_spec_.swap(aggregate_spec);
+  }
+  const AggregateSpecPB* aggregate_spec() const { return aggregate_spec_.get(); }
+
+  // The codec which the sidecars of the scan responses are compressed with.
+  // Fixed when the scanner is created.
+  void set_sidecar_compression(CompressionType compression) { sidecar_compression_ = compression; }
+  CompressionType sidecar_compression() const { return sidecar_compression_; }
+
+  // Whether the scanner builds its next batch in the background after serving
+  // each continuation RPC. Fixed when the scanner is created.
+  void set_prefetch_enabled(bool prefetch_enabled) { prefetch_enabled_ = prefetch_enabled; }
+  bool prefetch_enabled() const { return prefetch_enabled_; }
+
+  // Whether the responses of the scanner include a profile of the scan.
+  // Fixed when the scanner is created.
+  void set_profile_enabled(bool profile_enabled) { profile_enabled_ = profile_enabled; }
+  bool profile_enabled() const { return profile_enabled_; }
+
+  // Marks a prefetch of the next batch as in flight. The iterator belongs to
+  // the prefetch until it completes with FinishPrefetch().
+  void StartPrefetch();
+
+  // Completes the in-flight prefetch with 'batch', which is null if building
+  // it was abandoned.
+  void FinishPrefetch(std::shared_ptr<PrefetchedScanBatch> batch);
+
+  // Waits for the in-flight prefetch, if any, to complete, and returns its
+  // batch, if any. Must be called before using the iterator of a prefetching
+  // scanner.
+  std::shared_ptr<PrefetchedScanBatch> TakePrefetchedBatch();
+
   // Get per-column stats for each iterator.
   void GetIteratorStats(std::vector<IteratorStats>* stats) const;
 
@@ -272,6 +385,15 @@ class Scanner {
     already_reported_stats_ = stats;
   }
 
+  // The per-column statistics already returned in the profiles of the scan,
+  // for scanners with profiling enabled.
+  const std::vector<IteratorStats>& already_profiled_stats() const {
+    return already_profiled_stats_;
+  }
+  void set_already_profiled_stats(std::vector<IteratorStats> stats) {
+    already_profiled_stats_ = std::move(stats);
+  }
+
  private:
   friend class ScannerManager;
 
@@ -305,6 +427,9 @@ class Scanner {
   // as the scanner proceeds.
   IteratorStats already_reported_stats_;
 
+  // Same, per column, for the profiles of the scan.
+  std::vector<IteratorStats> already_profiled_stats_;
+
   // The spec used by 'iter_'
   gscoped_ptr<ScanSpec> spec_;
 
@@ -312,6 +437,23 @@ class Scanner {
   // schema used by the iterator.
   gscoped_ptr<Schema> client_projection_schema_;
 
+  bool columnar_layout_;
+
+  gscoped_ptr<AggregateSpecPB> aggregate_spec_;
+
+  CompressionType sidecar_compression_;
+
+  bool prefetch_enabled_;
+
+  bool profile_enabled_;
+
+  // Protects 'prefetch_in_flight_' and 'prefetched_batch_'. Signalled by
+  // 'prefetch_cond_' when a prefetch completes.
+  Mutex prefetch_lock_;
+  ConditionVariable prefetch_cond_;
+  bool prefetch_in_flight_;
+  std::shared_ptr<PrefetchedScanBatch> prefetched_batch_;
+
   gscoped_ptr<RowwiseIterator> iter_;
 
   AutoReleasePool autorelease_pool_;
@@ -24,6 +24,11 @@
 
 using std::shared_ptr;
 
+DECLARE_bool(tablet_copy_resume_from_checkpoint);
+DECLARE_int32(tablet_copy_compress_below_mb_per_sec);
+DECLARE_int32(tablet_copy_download_threads_per_session);
+DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
+
 namespace kudu {
 namespace tserver {
 
@@ -136,6 +141,33 @@ TEST_F(TabletCopyClientTest, TestDownloadWalSegment) {
   ASSERT_OK(CompareFileContents(path, server_path));
 }
 
+// Test that chunks requested compressed are uncompressed and verified on
+// arrival.
+TEST_F(TabletCopyClientTest, TestDownloadCompressedChunks) {
+  // Any throughput is under the threshold, so every chunk after the first
+  // one is requested compressed.
+  FLAGS_tablet_copy_compress_below_mb_per_sec = 1000000;
+  FLAGS_tablet_copy_transfer_chunk_size_bytes = 256;
+  ASSERT_OK(fs_manager_->CreateDirIfMissing(fs_manager_->GetTabletWalDir(GetTabletId())));
+
+  uint64_t seqno = client_->wal_seqnos_[0];
+  string path = fs_manager_->GetWalSegmentFileName(GetTabletId(), seqno);
+  ASSERT_OK(client_->DownloadWAL(seqno));
+  ASSERT_TRUE(client_->compress_chunks_.Load());
+
+  log::SegmentSequence local_segments;
+  ASSERT_OK(tablet_peer_->log()->reader()->GetSegmentsSnapshot(&local_segments));
+  ASSERT_OK(CompareFileContents(path, local_segments[0]->path()));
+
+  // Blocks are compressed unless they already are.
+  BlockId new_block_id;
+  ASSERT_OK(client_->DownloadBlock(FirstColumnBlockId(client_->superblock_.get()),
+                                   &new_block_id));
+  Slice slice;
+  faststring scratch;
+  ASSERT_OK(ReadLocalBlockFile(fs_manager_.get(), new_block_id, &scratch, &slice));
+}
+
 // Ensure that we detect data corruption at the per-transfer level.
 TEST_F(TabletCopyClientTest, TestVerifyData) {
   string good = "This is a known good string";
@@ -152,13 +184,13 @@ TEST_F(TabletCopyClientTest, TestVerifyData) {
   valid_chunk.set_total_data_length(kDataTotalLen);
 
   // Make sure we work on the happy case.
-  ASSERT_OK(client_->VerifyData(kGoodOffset, valid_chunk));
+  ASSERT_OK(client_->VerifyData(kGoodOffset, valid_chunk.data(), valid_chunk));
 
   // Test unexpected offset.
   DataChunkPB bad_offset = valid_chunk;
   bad_offset.set_offset(kBadOffset);
   Status s;
-  s = client_->VerifyData(kGoodOffset, bad_offset);
+  s = client_->VerifyData(kGoodOffset, bad_offset.data(), bad_offset);
   ASSERT_TRUE(s.IsInvalidArgument()) << "Bad offset expected: " << s.ToString();
   ASSERT_STR_CONTAINS(s.ToString(), "Offset did not match");
   LOG(INFO) << "Expected error returned: " << s.ToString();
@@ -166,7 +198,7 @@ TEST_F(TabletCopyClientTest, TestVerifyData) {
   // Test bad checksum.
   DataChunkPB bad_checksum = valid_chunk;
   bad_checksum.set_data(bad);
-  s = client_->VerifyData(kGoodOffset, bad_checksum);
+  s = client_->VerifyData(kGoodOffset, bad_checksum.data(), bad_checksum);
   ASSERT_TRUE(s.IsCorruption()) << "Invalid checksum expected: " << s.ToString();
   ASSERT_STR_CONTAINS(s.ToString(), "CRC32 does not match");
   LOG(INFO) << "Expected error returned: " << s.ToString();
@@ -202,7 +234,8 @@ vector<BlockId> GetAllSortedBlocks(const tablet::TabletSuperBlockPB& sb) {
 } // anonymous namespace
 
 TEST_F(TabletCopyClientTest, TestDownloadAllBlocks) {
-  // Download all the blocks.
+  // Download all the blocks, several at a time.
+  FLAGS_tablet_copy_download_threads_per_session = 8;
   ASSERT_OK(client_->DownloadBlocks());
 
   // Verify that the new superblock reflects the changes in block IDs.
@@ -234,6 +267,49 @@ TEST_F(TabletCopyClientTest, TestDownloadAllBlocks) {
   }
 }
 
+// Test that the blocks downloaded by an aborted copy are kept, and reused by
+// the next copy of the tablet from the same source.
+TEST_F(TabletCopyClientTest, TestResumeFromCheckpoint) {
+  FLAGS_tablet_copy_resume_from_checkpoint = true;
+  HostPort host_port;
+  ASSERT_OK(HostPortFromPB(leader_.last_known_addr(), &host_port));
+
+  // Tombstone the tablet by aborting the copy started without checkpointing.
+  ASSERT_OK(client_->Abort());
+  ASSERT_EQ(tablet::TABLET_DATA_TOMBSTONED, meta_->tablet_data_state());
+
+  // Download a block, then abort the copy.
+  client_.reset(new TabletCopyClient(GetTabletId(), fs_manager_.get(), messenger_));
+  ASSERT_OK(client_->SetTabletToReplace(meta_, 0));
+  ASSERT_OK(client_->Start(host_port, nullptr));
+  BlockIdPB* block_id_pb = FirstColumnBlockIdPB(client_->superblock_.get());
+  BlockId remote_block_id = BlockId::FromPB(*block_id_pb);
+  int block_count = 0;
+  ASSERT_OK(client_->DownloadAndRewriteBlock(block_id_pb, &block_count,
+                                             client_->CountBlocks()));
+  BlockId local_block_id = BlockId::FromPB(*block_id_pb);
+  ASSERT_OK(client_->Abort());
+
+  // The block survives the tombstoning of the tablet.
+  ASSERT_EQ(tablet::TABLET_DATA_TOMBSTONED, meta_->tablet_data_state());
+  ASSERT_TRUE(fs_manager_->BlockExists(local_block_id));
+  tablet::TabletCopyCheckpointPB checkpoint = meta_->copy_checkpoint();
+  ASSERT_EQ(leader_.permanent_uuid(), checkpoint.source_uuid());
+  ASSERT_EQ(1, checkpoint.blocks_size());
+
+  // The next copy reuses the block rather than downloading it again.
+  client_.reset(new TabletCopyClient(GetTabletId(), fs_manager_.get(), messenger_));
+  ASSERT_OK(client_->SetTabletToReplace(meta_, 0));
+  ASSERT_OK(client_->Start(host_port, nullptr));
+  ASSERT_EQ(1, client_->reusable_blocks_.size());
+  ASSERT_OK(client_->FetchAll(nullptr /* no listener */));
+  ASSERT_OK(client_->Finish());
+  ASSERT_EQ(local_block_id, FirstColumnBlockId(client_->superblock_.get()));
+  ASSERT_NE(remote_block_id, local_block_id);
+  ASSERT_EQ(tablet::TABLET_DATA_READY, meta_->tablet_data_state());
+  ASSERT_FALSE(meta_->copy_checkpoint().has_source_uuid());
+}
+
 enum DeleteTrigger {
   kAbortMethod, // Delete blocks via Abort().
   kDestructor,  // Delete blocks via destructor.
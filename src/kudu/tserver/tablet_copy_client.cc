@@ -19,7 +19,10 @@
 
 #include <gflags/gflags.h>
 #include <glog/logging.h>
+#include <algorithm>
 #include <memory>
+#include <mutex>
+#include <unordered_set>
 
 #include "kudu/common/wire_protocol.h"
 #include "kudu/consensus/consensus_meta.h"
@@ -28,11 +31,13 @@
 #include "kudu/fs/block_manager.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
 #include "kudu/gutil/walltime.h"
 #include "kudu/rpc/messenger.h"
 #include "kudu/rpc/transfer.h"
+#include "kudu/tablet/metadata.pb.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_peer.h"
@@ -40,13 +45,16 @@
 #include "kudu/tserver/tablet_copy.proxy.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/env.h"
 #include "kudu/util/env_util.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/io_rate_limiter.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/net/net_util.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/threadpool.h"
 
 DEFINE_int32(tablet_copy_begin_session_timeout_ms, 3000,
              "Tablet server RPC client timeout for BeginTabletCopySession calls. "
@@ -65,6 +73,39 @@ DEFINE_int32(tablet_copy_dowload_file_inject_latency_ms, 0,
              "to take much longer. For use in tests only.");
 TAG_FLAG(tablet_copy_dowload_file_inject_latency_ms, hidden);
 
+DEFINE_int32(tablet_copy_download_threads_per_session, 4,
+             "Number of data blocks downloaded in parallel by each tablet copy session.");
+TAG_FLAG(tablet_copy_download_threads_per_session, advanced);
+
+DEFINE_int32(tablet_copy_max_download_mb_per_sec, 0,
+             "Maximum bandwidth, in MiB per second, used by all the tablet copy sessions "
+             "of this server together to download data. 0 means no limit. "
+             "Read when the first session starts downloading.");
+TAG_FLAG(tablet_copy_max_download_mb_per_sec, advanced);
+
+DEFINE_bool(tablet_copy_resume_from_checkpoint, false,
+            "Whether the data blocks downloaded by an interrupted tablet copy are kept, "
+            "so that the next copy of the tablet from the same source can reuse them "
+            "instead of downloading them again.");
+TAG_FLAG(tablet_copy_resume_from_checkpoint, experimental);
+TAG_FLAG(tablet_copy_resume_from_checkpoint, runtime);
+
+DEFINE_int32(tablet_copy_checkpoint_interval_blocks, 100,
+             "Number of data blocks downloaded by a tablet copy between two checkpoints "
+             "of the downloaded blocks, when --tablet_copy_resume_from_checkpoint is set. "
+             "0 means the blocks are only checkpointed when the copy is aborted.");
+TAG_FLAG(tablet_copy_checkpoint_interval_blocks, advanced);
+TAG_FLAG(tablet_copy_checkpoint_interval_blocks, experimental);
+
+DEFINE_int32(tablet_copy_compress_below_mb_per_sec, 0,
+             "Maximum throughput, in MiB/s, of the data received by a tablet copy "
+             "session below which the data chunks are requested LZ4-compressed, "
+             "i.e. when the copy is bound by the network rather than by the disks. "
+             "Data which the source already stores compressed is sent as is. "
+             "0 means the chunks are never compressed.");
+TAG_FLAG(tablet_copy_compress_below_mb_per_sec, experimental);
+TAG_FLAG(tablet_copy_compress_below_mb_per_sec, runtime);
+
 DECLARE_int32(tablet_copy_transfer_chunk_size_bytes);
 
 // RETURN_NOT_OK_PREPEND() with a remote-error unwinding step.
@@ -88,14 +129,30 @@ using std::unique_ptr;
 using std::vector;
 using strings::Substitute;
 using tablet::ColumnDataPB;
+using tablet::CopiedBlockPB;
 using tablet::DeltaDataPB;
 using tablet::RowSetDataPB;
+using tablet::TabletCopyCheckpointPB;
 using tablet::TabletDataState;
 using tablet::TabletDataState_Name;
 using tablet::TabletMetadata;
 using tablet::TabletStatusListener;
 using tablet::TabletSuperBlockPB;
 
+namespace {
+
+// Returns the limiter of the bandwidth used by all the tablet copy sessions
+// of the process, or null if it isn't limited.
+IoRateLimiter* DownloadRateLimiter() {
+  static IoRateLimiter* limiter = FLAGS_tablet_copy_max_download_mb_per_sec > 0 ?
+      new IoRateLimiter(static_cast<int64_t>(FLAGS_tablet_copy_max_download_mb_per_sec)
+                        * 1024 * 1024) :
+      nullptr;
+  return limiter;
+}
+
+} // anonymous namespace
+
 TabletCopyClient::TabletCopyClient(std::string tablet_id,
                                    FsManager* fs_manager,
                                    shared_ptr<Messenger> messenger)
@@ -106,7 +163,9 @@ TabletCopyClient::TabletCopyClient(std::string tablet_id,
       replace_tombstoned_tablet_(false),
       status_listener_(nullptr),
       session_idle_timeout_millis_(0),
-      start_time_micros_(0) {}
+      start_time_micros_(0),
+      blocks_since_checkpoint_(0),
+      compress_chunks_(false) {}
 
 TabletCopyClient::~TabletCopyClient() {
   // Note: Ending the tablet copy session releases anchors on the remote.
@@ -218,6 +277,13 @@ Status TabletCopyClient::Start(const HostPort& copy_source_addr,
   RETURN_NOT_OK_PREPEND(SchemaFromPB(superblock_->schema(), &schema),
                         "Cannot deserialize schema from remote superblock");
 
+  // The blocks are only checkpointed when the source is known, since they
+  // may only be reused by a later copy from the same source.
+  if (FLAGS_tablet_copy_resume_from_checkpoint && resp.has_responder_uuid()) {
+    checkpoint_.reset(new TabletCopyCheckpointPB());
+    checkpoint_->set_source_uuid(resp.responder_uuid());
+  }
+
   if (replace_tombstoned_tablet_) {
     // Also validate the term of the source peer, in case they are
     // different. This is a sanity check that protects us in case a bug or
@@ -237,10 +303,13 @@ Status TabletCopyClient::Start(const HostPort& copy_source_addr,
     }
 
     // Remove any existing orphaned blocks and WALs from the tablet, and
-    // set the data state to 'COPYING'.
+    // set the data state to 'COPYING'. The blocks left by an interrupted
+    // copy are kept, and sorted out once the data state is persisted.
     RETURN_NOT_OK_PREPEND(
         TSTabletManager::DeleteTabletData(meta_, tablet::TABLET_DATA_COPYING, boost::none),
         "Could not replace superblock with COPYING data state");
+    RETURN_NOT_OK_PREPEND(ReuseCheckpointedBlocks(meta_->copy_checkpoint()),
+                          "Could not reuse the blocks of an interrupted tablet copy");
   } else {
     Partition partition;
     Partition::FromPB(superblock_->partition(), &partition);
@@ -271,7 +340,7 @@ Status TabletCopyClient::FetchAll(TabletStatusListener* status_listener) {
 
   status_listener_ = status_listener;
 
-  // Download all the files (serially, for now, but in parallel in the future).
+  // Download all the files. The blocks are downloaded in parallel.
   RETURN_NOT_OK(DownloadBlocks());
   RETURN_NOT_OK(DownloadWALs());
 
@@ -312,9 +381,14 @@ Status TabletCopyClient::Abort() {
   CHECK(meta_);
 
   // Write the in-progress superblock to disk so that when we delete the tablet
-  // data all the partial blocks we have persisted will be deleted.
+  // data all the partial blocks we have persisted will be deleted. If the copy
+  // is checkpointed, the downloaded blocks are kept for the next copy instead.
   DCHECK_EQ(tablet::TABLET_DATA_COPYING, superblock_->tablet_data_state());
-  RETURN_NOT_OK(meta_->ReplaceSuperBlock(*superblock_));
+  if (checkpoint_) {
+    RETURN_NOT_OK(WriteCheckpoint());
+  } else {
+    RETURN_NOT_OK(meta_->ReplaceSuperBlock(*superblock_));
+  }
 
   // Delete all of the tablet data, including blocks and WALs.
   RETURN_NOT_OK_PREPEND(
@@ -415,42 +489,135 @@ int TabletCopyClient::CountBlocks() const {
   return num_blocks;
 }
 
-Status TabletCopyClient::DownloadBlocks() {
-  CHECK_EQ(kStarted, state_);
-
-  // Count up the total number of blocks to download.
-  int num_blocks = CountBlocks();
-
-  // Download each block, writing the new block IDs into the new superblock
-  // as each block downloads.
-  int block_count = 0;
-  LOG_WITH_PREFIX(INFO) << "Starting download of " << num_blocks << " data blocks...";
+void TabletCopyClient::ListBlocks(vector<BlockIdPB*>* block_ids) {
   for (RowSetDataPB& rowset : *superblock_->mutable_rowsets()) {
     for (ColumnDataPB& col : *rowset.mutable_columns()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(col.mutable_block(),
-                                            &block_count, num_blocks));
+      block_ids->push_back(col.mutable_block());
     }
     for (DeltaDataPB& redo : *rowset.mutable_redo_deltas()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(redo.mutable_block(),
-                                            &block_count, num_blocks));
+      block_ids->push_back(redo.mutable_block());
     }
     for (DeltaDataPB& undo : *rowset.mutable_undo_deltas()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(undo.mutable_block(),
-                                            &block_count, num_blocks));
+      block_ids->push_back(undo.mutable_block());
     }
     if (rowset.has_bloom_block()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(rowset.mutable_bloom_block(),
-                                            &block_count, num_blocks));
+      block_ids->push_back(rowset.mutable_bloom_block());
     }
     if (rowset.has_adhoc_index_block()) {
-      RETURN_NOT_OK(DownloadAndRewriteBlock(rowset.mutable_adhoc_index_block(),
-                                            &block_count, num_blocks));
+      block_ids->push_back(rowset.mutable_adhoc_index_block());
     }
   }
+}
+
+Status TabletCopyClient::ReuseCheckpointedBlocks(const TabletCopyCheckpointPB& checkpoint) {
+  if (!checkpoint.has_source_uuid()) {
+    return Status::OK();
+  }
 
+  // Block IDs are only meaningful on the server which allocated them, so
+  // only the blocks copied from the current source can be matched against
+  // the blocks of the new superblock.
+  bool same_source = checkpoint_ && checkpoint.source_uuid() == checkpoint_->source_uuid();
+  std::unordered_set<BlockId, BlockIdHash, BlockIdEqual> remote_blocks;
+  if (same_source) {
+    vector<BlockIdPB*> block_ids;
+    ListBlocks(&block_ids);
+    for (const BlockIdPB* block_id : block_ids) {
+      remote_blocks.insert(BlockId::FromPB(*block_id));
+    }
+  }
+
+  for (const CopiedBlockPB& block : checkpoint.blocks()) {
+    BlockId remote_block_id = BlockId::FromPB(block.remote_block_id());
+    BlockId local_block_id = BlockId::FromPB(block.local_block_id());
+    if (ContainsKey(remote_blocks, remote_block_id) &&
+        fs_manager_->BlockExists(local_block_id)) {
+      reusable_blocks_.emplace(remote_block_id, local_block_id);
+      *checkpoint_->add_blocks() = block;
+      continue;
+    }
+    // The block was already deleted if we crashed after deleting it but
+    // before persisting the new checkpoint.
+    Status s = fs_manager_->DeleteBlock(local_block_id);
+    if (!s.ok() && !s.IsNotFound()) {
+      LOG_WITH_PREFIX(WARNING) << "Unable to delete block " << local_block_id.ToString()
+                               << " of an interrupted tablet copy: " << s.ToString();
+    }
+  }
+  LOG_WITH_PREFIX(INFO) << "Reusing " << reusable_blocks_.size() << " of the "
+                        << checkpoint.blocks_size()
+                        << " blocks kept from an interrupted tablet copy";
+
+  // Persist the checkpoint without the deleted blocks.
+  if (checkpoint_) {
+    RETURN_NOT_OK(WriteCheckpoint());
+  }
   return Status::OK();
 }
 
+Status TabletCopyClient::WriteCheckpoint() {
+  MutexLock checkpoint_lock(checkpoint_lock_);
+  TabletSuperBlockPB superblock;
+  {
+    std::lock_guard<simple_spinlock> l(download_lock_);
+    superblock = *superblock_;
+    *superblock.mutable_copy_checkpoint() = *checkpoint_;
+    blocks_since_checkpoint_ = 0;
+  }
+  // Until the copy finishes, the rowsets reference blocks with both remote
+  // and local IDs. Leaving them out keeps the checkpointed blocks from being
+  // deleted along with the tablet data.
+  superblock.clear_rowsets();
+  return meta_->ReplaceSuperBlock(superblock);
+}
+
+Status TabletCopyClient::DownloadBlocks() {
+  CHECK_EQ(kStarted, state_);
+
+  // Count up the total number of blocks to download.
+  int num_blocks = CountBlocks();
+
+  // Collect the blocks to download, so that the new block IDs get written
+  // into the new superblock as each block downloads.
+  vector<BlockIdPB*> block_ids;
+  block_ids.reserve(num_blocks);
+  ListBlocks(&block_ids);
+  DCHECK_EQ(num_blocks, block_ids.size());
+
+  // Download the blocks in parallel. Once a download fails, the blocks which
+  // haven't started downloading yet are skipped.
+  gscoped_ptr<ThreadPool> pool;
+  RETURN_NOT_OK(ThreadPoolBuilder("tablet-copy-dl")
+                .set_min_threads(0)
+                .set_max_threads(std::max(FLAGS_tablet_copy_download_threads_per_session, 1))
+                .Build(&pool));
+  int block_count = 0;
+  Status first_error;
+  LOG_WITH_PREFIX(INFO) << "Starting download of " << num_blocks << " data blocks...";
+  for (BlockIdPB* block_id : block_ids) {
+    Status s = pool->SubmitFunc([this, block_id, &block_count, num_blocks, &first_error]() {
+        {
+          std::lock_guard<simple_spinlock> l(download_lock_);
+          if (!first_error.ok()) return;
+        }
+        Status download_status = DownloadAndRewriteBlock(block_id, &block_count, num_blocks);
+        if (!download_status.ok()) {
+          std::lock_guard<simple_spinlock> l(download_lock_);
+          if (first_error.ok()) first_error = download_status;
+        }
+      });
+    if (!s.ok()) {
+      std::lock_guard<simple_spinlock> l(download_lock_);
+      if (first_error.ok()) first_error = s;
+      break;
+    }
+  }
+  pool->Wait();
+  pool->Shutdown();
+
+  return first_error;
+}
+
 Status TabletCopyClient::DownloadWAL(uint64_t wal_segment_seqno) {
   VLOG_WITH_PREFIX(1) << "Downloading WAL segment with seqno " << wal_segment_seqno;
   DataIdPB data_id;
@@ -497,16 +664,44 @@ Status TabletCopyClient::WriteConsensusMetadata() {
 
 Status TabletCopyClient::DownloadAndRewriteBlock(BlockIdPB* block_id,
                                                  int* block_count, int num_blocks) {
-  BlockId old_block_id(BlockId::FromPB(*block_id));
-  UpdateStatusMessage(Substitute("Downloading block $0 ($1/$2)",
-                                 old_block_id.ToString(),
-                                 *block_count + 1, num_blocks));
+  BlockId old_block_id;
+  int blocks_done;
+  {
+    std::lock_guard<simple_spinlock> l(download_lock_);
+    old_block_id = BlockId::FromPB(*block_id);
+    blocks_done = *block_count;
+  }
   BlockId new_block_id;
-  RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
-      "Unable to download block with id " + old_block_id.ToString());
+  const BlockId* reusable_block_id = FindOrNull(reusable_blocks_, old_block_id);
+  if (reusable_block_id) {
+    VLOG_WITH_PREFIX(1) << "Reusing block " << reusable_block_id->ToString()
+                        << " as the copy of block " << old_block_id.ToString();
+    new_block_id = *reusable_block_id;
+  } else {
+    UpdateStatusMessage(Substitute("Downloading block $0 ($1/$2)",
+                                   old_block_id.ToString(),
+                                   blocks_done + 1, num_blocks));
+    RETURN_NOT_OK_PREPEND(DownloadBlock(old_block_id, &new_block_id),
+        "Unable to download block with id " + old_block_id.ToString());
+  }
 
-  new_block_id.CopyToPB(block_id);
-  (*block_count)++;
+  bool write_checkpoint = false;
+  {
+    std::lock_guard<simple_spinlock> l(download_lock_);
+    new_block_id.CopyToPB(block_id);
+    (*block_count)++;
+    // The reused blocks are already part of the checkpoint.
+    if (checkpoint_ && !reusable_block_id) {
+      CopiedBlockPB* copied_block = checkpoint_->add_blocks();
+      old_block_id.CopyToPB(copied_block->mutable_remote_block_id());
+      new_block_id.CopyToPB(copied_block->mutable_local_block_id());
+      write_checkpoint = FLAGS_tablet_copy_checkpoint_interval_blocks > 0 &&
+          ++blocks_since_checkpoint_ >= FLAGS_tablet_copy_checkpoint_interval_blocks;
+    }
+  }
+  if (write_checkpoint) {
+    RETURN_NOT_OK_PREPEND(WriteCheckpoint(), "Unable to checkpoint the downloaded blocks");
+  }
   return Status::OK();
 }
 
@@ -545,19 +740,70 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
     req.mutable_data_id()->CopyFrom(data_id);
     req.set_offset(offset);
     req.set_max_length(FLAGS_tablet_copy_transfer_chunk_size_bytes);
+    req.set_data_in_sidecar(true);
+    int compress_below_mb_per_sec = FLAGS_tablet_copy_compress_below_mb_per_sec;
+    req.set_compression_codec(compress_below_mb_per_sec > 0 && compress_chunks_.Load() ?
+                              LZ4 : NO_COMPRESSION);
 
+    MonoTime fetch_start = MonoTime::Now();
     FetchDataResponsePB resp;
     RETURN_NOT_OK_UNWIND_PREPEND(proxy_->FetchData(req, &resp, &controller),
                                 controller,
                                 "Unable to fetch data from remote");
 
+    // Servers which predate data sidecars send the data in the response.
+    Slice data;
+    if (resp.chunk().has_data_sidecar_idx()) {
+      RETURN_NOT_OK_PREPEND(controller.GetSidecar(resp.chunk().data_sidecar_idx(), &data),
+                            "Unable to get data sidecar");
+    } else {
+      data = resp.chunk().data();
+    }
+    size_t wire_bytes = data.size();
+
+    // Servers only compress the chunks when asked to, and only with LZ4.
+    faststring uncompressed;
+    if (resp.chunk().compression_codec() != NO_COMPRESSION) {
+      if (PREDICT_FALSE(resp.chunk().compression_codec() != LZ4 ||
+                        !resp.chunk().has_uncompressed_length() ||
+                        resp.chunk().uncompressed_length() > req.max_length())) {
+        return Status::Corruption(
+            Substitute("Unexpected compressed chunk of data item $0: $1",
+                       SecureShortDebugString(data_id),
+                       CompressionType_Name(resp.chunk().compression_codec())));
+      }
+      const CompressionCodec* codec;
+      RETURN_NOT_OK(GetCompressionCodec(LZ4, &codec));
+      uncompressed.resize(resp.chunk().uncompressed_length());
+      RETURN_NOT_OK_PREPEND(codec->Uncompress(data, uncompressed.data(), uncompressed.size()),
+                            Substitute("Unable to uncompress data item $0",
+                                       SecureShortDebugString(data_id)));
+      data = Slice(uncompressed);
+    }
+
     // Sanity-check for corruption.
-    RETURN_NOT_OK_PREPEND(VerifyData(offset, resp.chunk()),
+    RETURN_NOT_OK_PREPEND(VerifyData(offset, data, resp.chunk()),
                           Substitute("Error validating data item $0",
                                      SecureShortDebugString(data_id)));
 
     // Write the data.
-    RETURN_NOT_OK(appendable->Append(resp.chunk().data()));
+    RETURN_NOT_OK(appendable->Append(data));
+
+    IoRateLimiter* limiter = DownloadRateLimiter();
+    if (limiter) {
+      limiter->Request(wire_bytes);
+    }
+
+    // Compress the next chunks while the data comes in slower than the
+    // disks could presumably take it. The rate of the bytes on the wire is
+    // that of the network whether or not they are compressed. Small chunks,
+    // such as the tails of files, say little about it and are left out.
+    if (compress_below_mb_per_sec > 0 &&
+        data.size() >= FLAGS_tablet_copy_transfer_chunk_size_bytes / 2) {
+      double secs = (MonoTime::Now() - fetch_start).ToSeconds();
+      double mb_per_sec = secs > 0 ? wire_bytes / secs / (1024 * 1024) : 0;
+      compress_chunks_.Store(secs > 0 && mb_per_sec < compress_below_mb_per_sec);
+    }
 
     if (PREDICT_FALSE(FLAGS_tablet_copy_dowload_file_inject_latency_ms > 0)) {
       LOG_WITH_PREFIX(INFO) << "Injecting latency into file download: " <<
@@ -565,16 +811,17 @@ Status TabletCopyClient::DownloadFile(const DataIdPB& data_id,
       SleepFor(MonoDelta::FromMilliseconds(FLAGS_tablet_copy_dowload_file_inject_latency_ms));
     }
 
-    if (offset + resp.chunk().data().size() == resp.chunk().total_data_length()) {
+    if (offset + data.size() == resp.chunk().total_data_length()) {
       done = true;
     }
-    offset += resp.chunk().data().size();
+    offset += data.size();
   }
 
   return Status::OK();
 }
 
-Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
+Status TabletCopyClient::VerifyData(uint64_t offset, const Slice& data,
+                                    const DataChunkPB& chunk) {
   // Verify the offset is what we expected.
   if (offset != chunk.offset()) {
     return Status::InvalidArgument("Offset did not match what was asked for",
@@ -582,11 +829,11 @@ Status TabletCopyClient::VerifyData(uint64_t offset, const DataChunkPB& chunk) {
   }
 
   // Verify the checksum.
-  uint32_t crc32 = crc::Crc32c(chunk.data().data(), chunk.data().length());
+  uint32_t crc32 = crc::Crc32c(data.data(), data.size());
   if (PREDICT_FALSE(crc32 != chunk.crc32())) {
     return Status::Corruption(
         Substitute("CRC32 does not match at offset $0 size $1: $2 vs $3",
-          offset, chunk.data().size(), crc32, chunk.crc32()));
+          offset, data.size(), crc32, chunk.crc32()));
   }
   return Status::OK();
 }
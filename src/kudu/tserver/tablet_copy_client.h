@@ -19,6 +19,7 @@
 
 #include <string>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <gtest/gtest_prod.h>
@@ -26,6 +27,9 @@
 #include "kudu/fs/block_id.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
+#include "kudu/util/atomic.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
@@ -33,6 +37,7 @@ namespace kudu {
 class BlockIdPB;
 class FsManager;
 class HostPort;
+class Slice;
 
 namespace consensus {
 class ConsensusMetadata;
@@ -50,6 +55,7 @@ class RpcController;
 namespace tablet {
 class TabletMetadata;
 class TabletPeer;
+class TabletCopyCheckpointPB;
 class TabletStatusListener;
 class TabletSuperBlockPB;
 } // namespace tablet
@@ -107,6 +113,10 @@ class TabletCopyClient {
 
   // Abort an in-progress transfer and immediately delete the data blocks and
   // WALs downloaded so far. Does nothing if called after Finish().
+  //
+  // With --tablet_copy_resume_from_checkpoint, the blocks which were fully
+  // downloaded are kept in the tablet copy checkpoint instead, so that the
+  // next copy of the tablet from the same source can reuse them.
   Status Abort();
 
  private:
@@ -114,7 +124,9 @@ class TabletCopyClient {
   FRIEND_TEST(TabletCopyClientTest, TestDownloadBlock);
   FRIEND_TEST(TabletCopyClientTest, TestVerifyData);
   FRIEND_TEST(TabletCopyClientTest, TestDownloadWalSegment);
+  FRIEND_TEST(TabletCopyClientTest, TestDownloadCompressedChunks);
   FRIEND_TEST(TabletCopyClientTest, TestDownloadAllBlocks);
+  FRIEND_TEST(TabletCopyClientTest, TestResumeFromCheckpoint);
   FRIEND_TEST(TabletCopyClientAbortTest, TestAbort);
 
   enum State {
@@ -151,17 +163,37 @@ class TabletCopyClient {
   // Count the number of blocks contained in 'superblock_'.
   int CountBlocks() const;
 
-  // Download all blocks belonging to a tablet sequentially.
+  // Appends the IDs of all the blocks contained in 'superblock_' to
+  // 'block_ids', so that they may be rewritten in place.
+  void ListBlocks(std::vector<BlockIdPB*>* block_ids);
+
+  // Sorts out the blocks of 'checkpoint', left by an earlier copy of the
+  // tablet: the ones copied from the current source which are still part of
+  // 'superblock_' are reused, and the others are deleted.
+  Status ReuseCheckpointedBlocks(const tablet::TabletCopyCheckpointPB& checkpoint);
+
+  // Persists 'checkpoint_' in the tablet superblock. The rowsets are left out
+  // of the persisted superblock, so that tombstoning the tablet deletes none
+  // of the checkpointed blocks.
+  Status WriteCheckpoint();
+
+  // Download all blocks belonging to a tablet, using up to
+  // --tablet_copy_download_threads_per_session threads.
   //
-  // Blocks are given new IDs upon creation. On success, 'superblock_'
-  // is populated to reflect the new block IDs.
+  // Blocks are given new IDs upon creation. 'superblock_' is populated to
+  // reflect the new IDs of the blocks which were downloaded, even on failure,
+  // so that Abort() deletes them.
   Status DownloadBlocks();
 
-  // Download the block specified by 'block_id'.
+  // Download the block specified by 'block_id'. May be called concurrently
+  // for different blocks.
   //
   // On success:
   // - 'block_id' is set to the new ID of the downloaded block.
   // - 'block_count' is incremented.
+  // Both are accessed under 'download_lock_'.
+  //
+  // A block kept from an earlier copy is reused rather than downloaded.
   Status DownloadAndRewriteBlock(BlockIdPB* block_id, int* block_count, int num_blocks);
 
   // Download a single block.
@@ -180,7 +212,9 @@ class TabletCopyClient {
   template<class Appendable>
   Status DownloadFile(const DataIdPB& data_id, Appendable* appendable);
 
-  Status VerifyData(uint64_t offset, const DataChunkPB& resp);
+  // Verifies that 'data', received in 'chunk', is at 'offset' and matches
+  // the checksum of the chunk.
+  Status VerifyData(uint64_t offset, const Slice& data, const DataChunkPB& chunk);
 
   // Return standard log prefix.
   std::string LogPrefix();
@@ -213,6 +247,28 @@ class TabletCopyClient {
   std::vector<uint64_t> wal_seqnos_;
   int64_t start_time_micros_;
 
+  // Protects 'superblock_', 'checkpoint_' and the block counts while blocks
+  // are downloaded in parallel.
+  simple_spinlock download_lock_;
+
+  // The blocks kept from an interrupted copy which may be reused, keyed by
+  // their ID on the source. Set by Start().
+  std::unordered_map<BlockId, BlockId, BlockIdHash, BlockIdEqual> reusable_blocks_;
+
+  // The blocks copied or reused so far. Null if the copy isn't checkpointed.
+  std::unique_ptr<tablet::TabletCopyCheckpointPB> checkpoint_;
+
+  // The number of blocks downloaded since 'checkpoint_' was last persisted.
+  int blocks_since_checkpoint_;
+
+  // Serializes the calls to WriteCheckpoint().
+  Mutex checkpoint_lock_;
+
+  // Whether the data chunks of the session are to be requested compressed,
+  // as decided from the throughput of the last ones. See
+  // --tablet_copy_compress_below_mb_per_sec.
+  AtomicBool compress_chunks_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletCopyClient);
 };
 
@@ -393,6 +393,38 @@ TEST_F(TabletCopyServiceTest, TestFetchBlockAtOnce) {
   AssertDataEqual(local_data.data(), local_data.size(), resp.chunk());
 }
 
+// Test that blocks are sent in sidecars to clients which ask for it, and that
+// repeated fetches of a chunk are served the same data.
+TEST_F(TabletCopyServiceTest, TestFetchBlockInSidecar) {
+  string session_id;
+  tablet::TabletSuperBlockPB superblock;
+  ASSERT_OK(DoBeginValidTabletCopySession(&session_id, &superblock));
+
+  BlockId block_id = FirstColumnBlockId(&superblock);
+  Slice local_data;
+  faststring scratch;
+  ASSERT_OK(ReadLocalBlockFile(mini_server_->server()->fs_manager(), block_id,
+                               &scratch, &local_data));
+
+  FetchDataRequestPB req;
+  req.set_session_id(session_id);
+  req.mutable_data_id()->CopyFrom(AsDataTypeId(block_id));
+  req.set_data_in_sidecar(true);
+  for (int i = 0; i < 2; i++) {
+    FetchDataResponsePB resp;
+    RpcController controller;
+    controller.set_timeout(MonoDelta::FromSeconds(1.0));
+    ASSERT_OK(tablet_copy_proxy_->FetchData(req, &resp, &controller));
+    ASSERT_FALSE(resp.chunk().has_data());
+    ASSERT_TRUE(resp.chunk().has_data_sidecar_idx());
+    Slice data;
+    ASSERT_OK(controller.GetSidecar(resp.chunk().data_sidecar_idx(), &data));
+    ASSERT_EQ(local_data, data);
+    ASSERT_EQ(crc::Crc32c(local_data.data(), local_data.size()), resp.chunk().crc32());
+    ASSERT_EQ(local_data.size(), resp.chunk().total_data_length());
+  }
+}
+
 // Test that we are able to incrementally fetch blocks.
 TEST_F(TabletCopyServiceTest, TestFetchBlockIncrementally) {
   string session_id;
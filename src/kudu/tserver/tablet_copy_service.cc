@@ -28,9 +28,11 @@
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/map-util.h"
 #include "kudu/rpc/rpc_context.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/tserver/tablet_copy_source_session.h"
 #include "kudu/tserver/tablet_peer_lookup.h"
 #include "kudu/tablet/tablet_peer.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/fault_injection.h"
 #include "kudu/util/flag_tags.h"
@@ -61,6 +63,12 @@ DEFINE_double(fault_crash_on_handle_tc_fetch_data, 0.0,
               "(For testing only!)");
 TAG_FLAG(fault_crash_on_handle_tc_fetch_data, unsafe);
 
+DEFINE_int32(tablet_copy_chunk_cache_capacity_mb, 64,
+             "Capacity, in MiB, of the cache of the chunks of data blocks served by the "
+             "tablet copy sessions of this server, which lets concurrent copies of a "
+             "tablet share their reads. 0 disables the cache.");
+TAG_FLAG(tablet_copy_chunk_cache_capacity_mb, advanced);
+
 namespace kudu {
 namespace tserver {
 
@@ -76,7 +84,8 @@ TabletCopyServiceImpl::TabletCopyServiceImpl(
     : TabletCopyServiceIf(metric_entity, result_tracker),
       fs_manager_(CHECK_NOTNULL(fs_manager)),
       tablet_peer_lookup_(CHECK_NOTNULL(tablet_peer_lookup)),
-      shutdown_latch_(1) {
+      shutdown_latch_(1),
+      chunk_cache_(static_cast<int64_t>(FLAGS_tablet_copy_chunk_cache_capacity_mb) * 1024 * 1024) {
   CHECK_OK(Thread::Create("tablet-copy", "tc-session-exp",
                           &TabletCopyServiceImpl::EndExpiredSessions, this,
                           &session_expiration_thread_));
@@ -194,29 +203,78 @@ void TabletCopyServiceImpl::FetchData(const FetchDataRequestPB* req,
   RPC_RETURN_NOT_OK(ValidateFetchRequestDataId(data_id, &error_code, session),
                     error_code, "Invalid DataId", context);
 
-  DataChunkPB* data_chunk = resp->mutable_chunk();
-  string* data = data_chunk->mutable_data();
-  int64_t total_data_length = 0;
+  TabletCopyChunkCache::Chunk chunk;
+  bool cached = false;
   if (data_id.type() == DataIdPB::BLOCK) {
-    // Fetching a data block chunk.
+    // Fetching a data block chunk. The cache only serves requests for
+    // sidecars, since its chunks would otherwise be copied anyway.
     const BlockId& block_id = BlockId::FromPB(data_id.block_id());
-    RPC_RETURN_NOT_OK(session->GetBlockPiece(block_id, offset, client_maxlen,
-                                             data, &total_data_length, &error_code),
-                      error_code, "Unable to get piece of data block", context);
+    cached = req->data_in_sidecar() &&
+        chunk_cache_.Lookup(block_id, offset, client_maxlen, &chunk);
+    if (!cached) {
+      gscoped_ptr<faststring> data(new faststring());
+      RPC_RETURN_NOT_OK(session->GetBlockPiece(block_id, offset, client_maxlen,
+                                               data.get(), &chunk.total_data_length,
+                                               &error_code),
+                        error_code, "Unable to get piece of data block", context);
+      chunk.crc32 = Crc32c(data->data(), data->length());
+      chunk.data.reset(data.release());
+      if (req->data_in_sidecar()) {
+        chunk_cache_.Insert(block_id, offset, client_maxlen, chunk);
+      }
+    }
   } else {
     // Fetching a log segment chunk.
     uint64_t segment_seqno = data_id.wal_segment_seqno();
+    gscoped_ptr<faststring> data(new faststring());
     RPC_RETURN_NOT_OK(session->GetLogSegmentPiece(segment_seqno, offset, client_maxlen,
-                                                  data, &total_data_length, &error_code),
+                                                  data.get(), &chunk.total_data_length,
+                                                  &error_code),
                       error_code, "Unable to get piece of log segment", context);
+    chunk.crc32 = Crc32c(data->data(), data->length());
+    chunk.data.reset(data.release());
   }
 
-  data_chunk->set_total_data_length(total_data_length);
+  DataChunkPB* data_chunk = resp->mutable_chunk();
+  data_chunk->set_total_data_length(chunk.total_data_length);
   data_chunk->set_offset(offset);
+  data_chunk->set_crc32(chunk.crc32);
+
+  // Compress the data if the client asked for it, unless it is already
+  // compressed or doesn't shrink.
+  if (req->compression_codec() == LZ4 && chunk.data->size() > 0) {
+    bool already_compressed;
+    RPC_RETURN_NOT_OK(session->IsDataCompressed(data_id, &already_compressed, &error_code),
+                      error_code, "Unable to check whether data is compressed", context);
+    if (!already_compressed) {
+      const CompressionCodec* codec;
+      RPC_RETURN_NOT_OK(GetCompressionCodec(LZ4, &codec),
+                        TabletCopyErrorPB::UNKNOWN_ERROR, "Unable to get LZ4 codec", context);
+      gscoped_ptr<faststring> compressed(new faststring());
+      compressed->resize(codec->MaxCompressedLength(chunk.data->size()));
+      size_t compressed_len;
+      RPC_RETURN_NOT_OK(codec->Compress(Slice(*chunk.data), compressed->data(), &compressed_len),
+                        TabletCopyErrorPB::UNKNOWN_ERROR, "Unable to compress data", context);
+      if (compressed_len < chunk.data->size()) {
+        compressed->resize(compressed_len);
+        data_chunk->set_compression_codec(LZ4);
+        data_chunk->set_uncompressed_length(chunk.data->size());
+        chunk.data.reset(compressed.release());
+      }
+    }
+  }
 
-  // Calculate checksum.
-  uint32_t crc32 = Crc32c(data->data(), data->length());
-  data_chunk->set_crc32(crc32);
+  // Send the data in a sidecar if the client supports it, which spares
+  // copying it into the response protobuf and serializing it.
+  if (req->data_in_sidecar()) {
+    int idx;
+    RPC_RETURN_NOT_OK(context->AddRpcSidecar(
+                          make_gscoped_ptr(new rpc::RpcSidecar(std::move(chunk.data))), &idx),
+                      TabletCopyErrorPB::UNKNOWN_ERROR, "Unable to add data sidecar", context);
+    data_chunk->set_data_sidecar_idx(idx);
+  } else {
+    data_chunk->set_data(chunk.data->data(), chunk.data->size());
+  }
 
   context->RespondSuccess();
 }
@@ -23,6 +23,7 @@
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/tserver/tablet_copy.service.h"
+#include "kudu/tserver/tablet_copy_source_session.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
@@ -111,6 +112,10 @@ class TabletCopyServiceImpl : public TabletCopyServiceIf {
   // TODO: this is a hack, replace with some kind of timer impl. See KUDU-286.
   CountDownLatch shutdown_latch_;
   scoped_refptr<Thread> session_expiration_thread_;
+
+  // The chunks of data blocks recently served to clients which fetch them in
+  // sidecars, shared by all sessions.
+  TabletCopyChunkCache chunk_cache_;
 };
 
 } // namespace tserver
@@ -190,7 +190,7 @@ class TabletCopyTest : public KuduTabletTest {
   void FetchBlockToFile(const BlockId& block_id,
                         string* path,
                         unique_ptr<SequentialFile>* file) {
-    string data;
+    faststring data;
     int64_t block_file_size = 0;
     TabletCopyErrorPB::Code error_code;
     CHECK_OK(session_->GetBlockPiece(block_id, 0, 0, &data, &block_file_size, &error_code));
@@ -324,7 +324,7 @@ TEST_F(TabletCopyTest, TestBlocksAreFetchableAfterBeingDeleted) {
   // Read them back.
   for (const BlockId& block_id : data_blocks) {
     ASSERT_TRUE(session_->IsBlockOpenForTests(block_id));
-    string data;
+    faststring data;
     TabletCopyErrorPB::Code error_code;
     int64_t piece_size;
     ASSERT_OK(session_->GetBlockPiece(block_id, 0, 0,
@@ -19,6 +19,8 @@
 #include <algorithm>
 #include <mutex>
 
+#include "kudu/cfile/cfile.pb.h"
+#include "kudu/cfile/cfile_writer.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/log_reader.h"
 #include "kudu/consensus/metadata.pb.h"
@@ -28,6 +30,7 @@
 #include "kudu/gutil/type_traits.h"
 #include "kudu/rpc/transfer.h"
 #include "kudu/tablet/tablet_peer.h"
+#include "kudu/util/coding.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/mutex.h"
 #include "kudu/util/pb_util.h"
@@ -201,7 +204,7 @@ template <class Info>
 static Status ReadFileChunkToBuf(const Info* info,
                                  uint64_t offset, int64_t client_maxlen,
                                  const string& data_name,
-                                 string* data, int64_t* file_size,
+                                 faststring* data, int64_t* file_size,
                                  TabletCopyErrorPB::Code* error_code) {
   int64_t response_data_size = 0;
   RETURN_NOT_OK_PREPEND(GetResponseDataSize(info->size, offset, client_maxlen, error_code,
@@ -211,11 +214,8 @@ static Status ReadFileChunkToBuf(const Info* info,
   Stopwatch chunk_timer(Stopwatch::THIS_THREAD);
   chunk_timer.start();
 
-  // Writing into a std::string buffer is basically guaranteed to work on C++11,
-  // however any modern compiler should be compatible with it.
-  // Violates the API contract, but avoids excessive copies.
   data->resize(response_data_size);
-  uint8_t* buf = reinterpret_cast<uint8_t*>(const_cast<char*>(data->data()));
+  uint8_t* buf = data->data();
   Slice slice;
   Status s = info->ReadFully(offset, response_data_size, &slice, buf);
   if (PREDICT_FALSE(!s.ok())) {
@@ -240,7 +240,7 @@ static Status ReadFileChunkToBuf(const Info* info,
 
 Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
                                              uint64_t offset, int64_t client_maxlen,
-                                             string* data, int64_t* block_file_size,
+                                             faststring* data, int64_t* block_file_size,
                                              TabletCopyErrorPB::Code* error_code) {
   ImmutableReadableBlockInfo* block_info;
   RETURN_NOT_OK(FindBlock(block_id, &block_info, error_code));
@@ -259,7 +259,7 @@ Status TabletCopySourceSession::GetBlockPiece(const BlockId& block_id,
 
 Status TabletCopySourceSession::GetLogSegmentPiece(uint64_t segment_seqno,
                                                    uint64_t offset, int64_t client_maxlen,
-                                                   std::string* data, int64_t* log_file_size,
+                                                   faststring* data, int64_t* log_file_size,
                                                    TabletCopyErrorPB::Code* error_code) {
   ImmutableRandomAccessFileInfo* file_info;
   RETURN_NOT_OK(FindLogSegment(segment_seqno, &file_info, error_code));
@@ -272,6 +272,82 @@ Status TabletCopySourceSession::GetLogSegmentPiece(uint64_t segment_seqno,
   return Status::OK();
 }
 
+namespace {
+
+// Reads the footer of the CFile in 'block_info'. Returns Corruption if the
+// block isn't a CFile.
+Status ReadCFileFooter(const ImmutableReadableBlockInfo& block_info,
+                       cfile::CFileFooterPB* footer) {
+  const int64_t kMagicAndLengthSize = cfile::kMagicLength + sizeof(uint32_t);
+  if (block_info.size < kMagicAndLengthSize) {
+    return Status::Corruption("block too short to be a CFile");
+  }
+  uint8_t scratch[kMagicAndLengthSize];
+  Slice magic_and_length;
+  RETURN_NOT_OK(block_info.ReadFully(block_info.size - kMagicAndLengthSize,
+                                     kMagicAndLengthSize, &magic_and_length, scratch));
+  if (memcmp(magic_and_length.data(), cfile::kMagicStringV1, cfile::kMagicLength) != 0 &&
+      memcmp(magic_and_length.data(), cfile::kMagicStringV2, cfile::kMagicLength) != 0) {
+    return Status::Corruption("block isn't a CFile");
+  }
+  uint32_t footer_size = DecodeFixed32(magic_and_length.data() + cfile::kMagicLength);
+  if (footer_size > block_info.size - kMagicAndLengthSize) {
+    return Status::Corruption("invalid CFile footer size");
+  }
+  faststring buf;
+  buf.resize(footer_size);
+  Slice footer_data;
+  RETURN_NOT_OK(block_info.ReadFully(block_info.size - kMagicAndLengthSize - footer_size,
+                                     footer_size, &footer_data, buf.data()));
+  return pb_util::ParseFromArray(footer, footer_data.data(), footer_data.size());
+}
+
+} // anonymous namespace
+
+Status TabletCopySourceSession::IsDataCompressed(const DataIdPB& data_id, bool* compressed,
+                                                 TabletCopyErrorPB::Code* error_code) {
+  DCHECK(initted_);
+  if (data_id.type() == DataIdPB::LOG_SEGMENT) {
+    for (const scoped_refptr<ReadableLogSegment>& segment : log_segments_) {
+      if (segment->header().sequence_number() == data_id.wal_segment_seqno()) {
+        *compressed = segment->header().compression_codec() != NO_COMPRESSION;
+        return Status::OK();
+      }
+    }
+    *error_code = TabletCopyErrorPB::WAL_SEGMENT_NOT_FOUND;
+    return Status::NotFound(Substitute("Segment with sequence number $0 not found",
+                                       data_id.wal_segment_seqno()));
+  }
+
+  const BlockId block_id = BlockId::FromPB(data_id.block_id());
+  {
+    MutexLock l(session_lock_);
+    if (FindCopy(compressed_blocks_, block_id, compressed)) {
+      return Status::OK();
+    }
+  }
+
+  // Blocks which aren't CFiles are considered uncompressed. Concurrent
+  // requests for the same block may both read its footer, which is harmless.
+  ImmutableReadableBlockInfo* block_info;
+  RETURN_NOT_OK(FindBlock(block_id, &block_info, error_code));
+  cfile::CFileFooterPB footer;
+  Status s = ReadCFileFooter(*block_info, &footer);
+  if (!s.ok() && !s.IsCorruption()) {
+    *error_code = TabletCopyErrorPB::IO_ERROR;
+    return s.CloneAndPrepend(Substitute("Unable to read footer of block $0",
+                                        block_id.ToString()));
+  }
+  bool block_compressed = s.ok() &&
+      (footer.compression() != NO_COMPRESSION || footer.encoding() == BIT_SHUFFLE);
+  {
+    MutexLock l(session_lock_);
+    InsertOrUpdate(&compressed_blocks_, block_id, block_compressed);
+  }
+  *compressed = block_compressed;
+  return Status::OK();
+}
+
 bool TabletCopySourceSession::IsBlockOpenForTests(const BlockId& block_id) const {
   MutexLock l(session_lock_);
   return ContainsKey(blocks_, block_id);
@@ -379,5 +455,44 @@ Status TabletCopySourceSession::UnregisterAnchorIfNeededUnlocked() {
   return tablet_peer_->log_anchor_registry()->UnregisterIfAnchored(&log_anchor_);
 }
 
+TabletCopyChunkCache::TabletCopyChunkCache(int64_t capacity_bytes)
+    : capacity_bytes_(capacity_bytes),
+      size_bytes_(0) {
+}
+
+bool TabletCopyChunkCache::Lookup(const BlockId& block_id, uint64_t offset,
+                                  int64_t max_length, Chunk* chunk) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  ChunkList::iterator* it = FindOrNull(chunks_, Key(block_id.id(), offset, max_length));
+  if (!it) {
+    return false;
+  }
+  lru_.splice(lru_.begin(), lru_, *it);
+  *chunk = (*it)->second;
+  return true;
+}
+
+void TabletCopyChunkCache::Insert(const BlockId& block_id, uint64_t offset,
+                                  int64_t max_length, Chunk chunk) {
+  int64_t chunk_bytes = chunk.data->size();
+  if (chunk_bytes > capacity_bytes_) {
+    return;
+  }
+  Key key(block_id.id(), offset, max_length);
+  std::lock_guard<simple_spinlock> l(lock_);
+  if (ContainsKey(chunks_, key)) {
+    // Another session read the same chunk concurrently.
+    return;
+  }
+  while (size_bytes_ + chunk_bytes > capacity_bytes_) {
+    size_bytes_ -= lru_.back().second.data->size();
+    chunks_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+  lru_.emplace_front(key, std::move(chunk));
+  chunks_.emplace(key, lru_.begin());
+  size_bytes_ += chunk_bytes;
+}
+
 } // namespace tserver
 } // namespace kudu
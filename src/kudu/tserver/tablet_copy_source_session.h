@@ -17,9 +17,13 @@
 
 #pragma once
 
+#include <list>
+#include <map>
 #include <memory>
 #include <string>
+#include <tuple>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "kudu/consensus/log_anchor_registry.h"
@@ -33,6 +37,7 @@
 #include "kudu/gutil/stl_util.h"
 #include "kudu/tserver/tablet_copy.pb.h"
 #include "kudu/util/env_util.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/status.h"
 
@@ -112,7 +117,7 @@ class TabletCopySourceSession : public RefCountedThreadSafe<TabletCopySourceSess
   // This method is thread-safe.
   Status GetBlockPiece(const BlockId& block_id,
                        uint64_t offset, int64_t client_maxlen,
-                       std::string* data, int64_t* block_file_size,
+                       faststring* data, int64_t* block_file_size,
                        TabletCopyErrorPB::Code* error_code);
 
   // Get a piece of a log segment.
@@ -120,9 +125,19 @@ class TabletCopySourceSession : public RefCountedThreadSafe<TabletCopySourceSess
   // is only for sending WAL segment files.
   Status GetLogSegmentPiece(uint64_t segment_seqno,
                             uint64_t offset, int64_t client_maxlen,
-                            std::string* data, int64_t* log_file_size,
+                            faststring* data, int64_t* log_file_size,
                             TabletCopyErrorPB::Code* error_code);
 
+  // Sets 'compressed' to whether the data identified by 'data_id' is already
+  // compressed, in which case compressing its chunks for the wire would be a
+  // waste: a CFile written with a compression codec or the bitshuffle
+  // encoding (which compresses too), or a WAL segment written with a
+  // compression codec. This is detected once per block.
+  //
+  // This method is thread-safe.
+  Status IsDataCompressed(const DataIdPB& data_id, bool* compressed,
+                          TabletCopyErrorPB::Code* error_code);
+
   const tablet::TabletSuperBlockPB& tablet_superblock() const {
     DCHECK(initted_);
     return tablet_superblock_;
@@ -177,6 +192,7 @@ class TabletCopySourceSession : public RefCountedThreadSafe<TabletCopySourceSess
   bool initted_ = false;
   BlockMap blocks_; // Protected by session_lock_.
   LogMap logs_;     // Protected by session_lock_.
+  std::unordered_map<BlockId, bool, BlockIdHash> compressed_blocks_; // Protected by session_lock_.
   ValueDeleter blocks_deleter_;
   ValueDeleter logs_deleter_;
 
@@ -193,5 +209,45 @@ class TabletCopySourceSession : public RefCountedThreadSafe<TabletCopySourceSess
   DISALLOW_COPY_AND_ASSIGN(TabletCopySourceSession);
 };
 
+// A bounded LRU cache of the chunks of data blocks served by tablet copy
+// sessions, so that concurrent sessions copying the same tablet read and
+// checksum each chunk once. Chunks are shared with the RPC sidecars sending
+// them, so an evicted chunk stays in memory until its last sidecar is sent.
+//
+// This class is thread-safe.
+class TabletCopyChunkCache {
+ public:
+  struct Chunk {
+    std::shared_ptr<const faststring> data;
+    uint32_t crc32;
+    int64_t total_data_length;
+  };
+
+  // 'capacity_bytes' bounds the size of the chunks in the cache.
+  explicit TabletCopyChunkCache(int64_t capacity_bytes);
+
+  // Looks up the chunk of 'block_id' at 'offset' served to requests for at
+  // most 'max_length' bytes. Returns false if it isn't cached.
+  bool Lookup(const BlockId& block_id, uint64_t offset, int64_t max_length, Chunk* chunk);
+
+  // Inserts 'chunk', evicting the least recently used chunks as needed.
+  void Insert(const BlockId& block_id, uint64_t offset, int64_t max_length, Chunk chunk);
+
+ private:
+  typedef std::tuple<uint64_t, uint64_t, int64_t> Key;
+  typedef std::list<std::pair<Key, Chunk>> ChunkList;
+
+  const int64_t capacity_bytes_;
+
+  simple_spinlock lock_;
+
+  // Most recently used first.
+  ChunkList lru_;
+  std::map<Key, ChunkList::iterator> chunks_;
+  int64_t size_bytes_;
+
+  DISALLOW_COPY_AND_ASSIGN(TabletCopyChunkCache);
+};
+
 } // namespace tserver
 } // namespace kudu
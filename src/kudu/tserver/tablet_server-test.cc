@@ -22,14 +22,19 @@
 #include <zlib.h>
 
 #include "kudu/consensus/log-test-base.h"
+#include "kudu/consensus/opid_util.h"
 #include "kudu/gutil/strings/escaping.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/master/master.pb.h"
+#include "kudu/rpc/rpc_sidecar.h"
 #include "kudu/server/hybrid_clock.h"
 #include "kudu/server/server_base.pb.h"
 #include "kudu/server/server_base.proxy.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tserver/heartbeater.h"
+#include "kudu/tserver/scan_aggregator.h"
+#include "kudu/util/bitmap.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/curl_util.h"
 #include "kudu/util/pb_util.h"
@@ -41,6 +46,7 @@ using kudu::consensus::RaftPeerPB;
 using kudu::rpc::Messenger;
 using kudu::rpc::MessengerBuilder;
 using kudu::rpc::RpcController;
+using kudu::rpc::RpcSidecar;
 using kudu::server::Clock;
 using kudu::server::HybridClock;
 using kudu::tablet::Tablet;
@@ -59,6 +65,7 @@ DEFINE_int32(single_threaded_insert_latency_bench_insert_rows, 1000,
              " tablet server insert latency micro-benchmark");
 
 DECLARE_bool(fail_dns_resolution);
+DECLARE_bool(scanner_count_rows_from_metadata);
 DECLARE_int32(metrics_retirement_age_ms);
 DECLARE_int32(scanner_batch_size_rows);
 DECLARE_string(block_manager);
@@ -369,6 +376,35 @@ TEST_F(TabletServerTest, TestInsert) {
   ASSERT_GE(now_after.value(), now_before.value());
 }
 
+// Test that the writes batched in a MultiTabletWrite RPC succeed or fail
+// independently.
+TEST_F(TabletServerTest, TestMultiTabletWrite) {
+  MultiTabletWriteRequestPB req;
+  MultiTabletWriteResponsePB resp;
+  RpcController controller;
+
+  WriteRequestPB* bad_write = req.add_requests();
+  bad_write->set_tablet_id("bogus_tablet");
+  ASSERT_OK(SchemaToPB(schema_, bad_write->mutable_schema()));
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 1, "bogus",
+                 bad_write->mutable_row_operations());
+  WriteRequestPB* good_write = req.add_requests();
+  good_write->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, good_write->mutable_schema()));
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 2, 2, "original",
+                 good_write->mutable_row_operations());
+
+  SCOPED_TRACE(SecureDebugString(req));
+  ASSERT_OK(proxy_->MultiTabletWrite(req, &resp, &controller));
+  SCOPED_TRACE(SecureDebugString(resp));
+  ASSERT_EQ(2, resp.responses_size());
+  ASSERT_TRUE(resp.responses(0).has_error());
+  ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.responses(0).error().code());
+  ASSERT_FALSE(resp.responses(1).has_error());
+  ASSERT_EQ(0, resp.responses(1).per_row_errors_size());
+  VerifyRows(schema_, { KeyValue(2, 2) });
+}
+
 TEST_F(TabletServerTest, TestExternalConsistencyModes_ClientPropagated) {
   WriteRequestPB req;
   req.set_tablet_id(kTabletId);
@@ -1056,6 +1092,88 @@ TEST_F(TabletServerTest, TestScan) {
   }
 }
 
+// Test that a scan which prefetches its batches in the background returns
+// the same rows as a regular scan, across many continuation requests.
+TEST_F(TabletServerTest, TestScanWithPrefetching) {
+  int num_rows = AllowSlowTests() ? 10000 : 1000;
+  InsertTestRowsDirect(0, num_rows);
+
+  ScanRequestPB req;
+  ScanResponsePB resp;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  scan->set_prefetch_next_batch(true);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  req.set_call_seq_id(0);
+  req.set_batch_size_bytes(10000);
+
+  // The first request scans its batch itself, and prefetches the next one.
+  vector<string> results;
+  {
+    RpcController rpc;
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_TRUE(resp.has_more_results());
+    StringifyRowsFromResponse(schema_, rpc, resp, &results);
+  }
+  ASSERT_NO_FATAL_FAILURE(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+  ASSERT_EQ(num_rows, results.size());
+
+  KuduPartialRow row(&schema_);
+  for (int i = 0; i < num_rows; i++) {
+    BuildTestRow(i, &row);
+    string expected = "(" + row.ToString() + ")";
+    ASSERT_EQ(expected, results[i]);
+  }
+
+  SharedScanner junk;
+  ASSERT_FALSE(mini_server_->server()->scanner_manager()->LookupScanner(resp.scanner_id(),
+                                                                        &junk));
+}
+
+TEST_F(TabletServerTest, TestScanWithSidecarCompression) {
+  const int num_rows = 100;
+  InsertTestRowsDirect(0, num_rows);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  req.set_call_seq_id(0);
+
+  // Codecs other than LZ4 and ZSTD are rejected.
+  {
+    scan->set_sidecar_compression(SNAPPY);
+    ScanResponsePB resp;
+    RpcController rpc;
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+  }
+
+  scan->set_sidecar_compression(LZ4);
+  ScanResponsePB resp;
+  RpcController rpc;
+  rpc.RequireServerFeature(TabletServerFeatures::COMPRESSED_SIDECARS);
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  SCOPED_TRACE(SecureDebugString(resp));
+  ASSERT_FALSE(resp.has_error());
+  ASSERT_EQ(LZ4, resp.sidecar_compression());
+  ASSERT_EQ(num_rows, resp.data().num_rows());
+
+  // The rows sidecar uncompresses to the row-wise data of every row.
+  const CompressionCodec* codec;
+  ASSERT_OK(GetCompressionCodec(LZ4, &codec));
+  Slice compressed;
+  ASSERT_OK(rpc.GetSidecar(resp.data().rows_sidecar(), &compressed));
+  faststring rows_data;
+  ASSERT_OK(UncompressSidecar(*codec, compressed, &rows_data));
+  ASSERT_EQ(num_rows * (schema_.byte_size() + (schema_.has_nullables() ?
+                                               BitmapSize(schema_.num_columns()) : 0)),
+            rows_data.size());
+}
+
 TEST_F(TabletServerTest, TestScannerOpenWhenServerShutsDown) {
   InsertTestRowsDirect(0, 1);
 
@@ -1785,6 +1903,60 @@ void TabletServerTest::DoOrderedScanTest(const Schema& projection,
   }
 }
 
+// Test that scans with a limit return only that many rows: for ORDERED scans,
+// those with the smallest keys across all rowsets.
+TEST_F(TabletServerTest, TestScanWithLimit) {
+  InsertTestRowsDirect(20, 10);
+  ASSERT_OK(tablet_peer_->tablet()->Flush());
+  InsertTestRowsDirect(0, 10);
+  ASSERT_OK(tablet_peer_->tablet()->Flush());
+  InsertTestRowsDirect(10, 10);
+
+  for (OrderMode order_mode : { ORDERED, UNORDERED }) {
+    SCOPED_TRACE(OrderMode_Name(order_mode));
+    ScanRequestPB req;
+    NewScanRequestPB* scan = req.mutable_new_scan_request();
+    scan->set_tablet_id(kTabletId);
+    ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+    scan->set_read_mode(READ_AT_SNAPSHOT);
+    scan->set_order_mode(order_mode);
+    scan->set_limit(15);
+    req.set_call_seq_id(0);
+    req.set_batch_size_bytes(0);
+
+    ScanResponsePB resp;
+    {
+      RpcController rpc;
+      ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+      ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp.error());
+    }
+    vector<string> results;
+    ASSERT_NO_FATAL_FAILURE(DrainScannerToStrings(resp.scanner_id(), schema_, &results));
+    ASSERT_EQ(15, results.size());
+    if (order_mode == ORDERED) {
+      KuduPartialRow row(&schema_);
+      for (int i = 0; i < results.size(); i++) {
+        BuildTestRow(i, &row);
+        ASSERT_EQ("(" + row.ToString() + ")", results[i]);
+      }
+    }
+  }
+
+  // A limit of 0 returns nothing, without opening a scanner.
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  scan->set_limit(0);
+  req.set_call_seq_id(0);
+  ScanResponsePB resp;
+  RpcController rpc;
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp.error());
+  ASSERT_FALSE(resp.has_more_results());
+  ASSERT_FALSE(resp.has_scanner_id());
+}
+
 // Tests for KUDU-967. This test creates multiple row sets and then performs an ordered
 // scan including the key columns in the projection but without marking them as keys.
 // Without a fix for KUDU-967 the scan will often return out-of-order results.
@@ -1945,6 +2117,42 @@ TEST_F(TabletServerTest, TestCreateTablet_TabletExists) {
   }
 }
 
+TEST_F(TabletServerTest, TestCreateTablets) {
+  CreateTabletsRequestPB req;
+  CreateTabletsResponsePB resp;
+  RpcController rpc;
+
+  req.set_dest_uuid(mini_server_->server()->fs_manager()->uuid());
+  Schema schema = SchemaBuilder(schema_).Build();
+  const vector<string> tablet_ids = { "new-tablet-1", kTabletId, "new-tablet-2" };
+  for (const string& tablet_id : tablet_ids) {
+    CreateTabletRequestPB* tablet_req = req.add_tablets();
+    tablet_req->set_table_id("testtb");
+    tablet_req->set_tablet_id(tablet_id);
+    tablet_req->set_table_name("testtb");
+    tablet_req->mutable_config()->CopyFrom(mini_server_->CreateLocalConfig());
+    ASSERT_OK(SchemaToPB(schema, tablet_req->mutable_schema()));
+  }
+
+  // The new tablets are created, and the existing one is reported as such.
+  {
+    SCOPED_TRACE(SecureDebugString(req));
+    ASSERT_OK(admin_proxy_->CreateTablets(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(tablet_ids.size(), resp.tablets_size());
+    ASSERT_FALSE(resp.tablets(0).has_error());
+    ASSERT_TRUE(resp.tablets(1).has_error());
+    ASSERT_EQ(TabletServerErrorPB::TABLET_ALREADY_EXISTS, resp.tablets(1).error().code());
+    ASSERT_FALSE(resp.tablets(2).has_error());
+  }
+
+  for (const string& tablet_id : tablet_ids) {
+    scoped_refptr<TabletPeer> tablet;
+    ASSERT_TRUE(mini_server_->server()->tablet_manager()->LookupTablet(tablet_id, &tablet));
+  }
+}
+
 TEST_F(TabletServerTest, TestDeleteTablet) {
   scoped_refptr<TabletPeer> tablet;
 
@@ -2284,6 +2492,124 @@ TEST_F(TabletServerTest, TestChecksumScan) {
   ASSERT_FALSE(resp.has_more_results());
 }
 
+TEST_F(TabletServerTest, TestAggregateScan) {
+  InsertTestRowsDirect(0, 100);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  AggregateSpecPB* spec = scan->mutable_aggregate_spec();
+  spec->add_aggregates()->set_function(AggregatePB::COUNT);
+  AggregatePB* agg = spec->add_aggregates();
+  agg->set_function(AggregatePB::SUM);
+  agg->set_column("int_val");
+  agg = spec->add_aggregates();
+  agg->set_function(AggregatePB::MIN);
+  agg->set_column("string_val");
+  agg = spec->add_aggregates();
+  agg->set_function(AggregatePB::MAX);
+  agg->set_column("key");
+
+  gscoped_ptr<ScanAggregator> aggregator;
+  ASSERT_OK(ScanAggregator::Create(*spec, &schema_, &aggregator));
+  const Schema& result_schema = aggregator->result_schema();
+
+  // Scan in small batches so that the aggregates span several responses,
+  // each of which holds the partial aggregates of the rows it scanned.
+  FLAGS_scanner_batch_size_rows = 10;
+  req.set_batch_size_bytes(1);
+
+  int64_t count = 0;
+  int64_t sum = 0;
+  string min_str;
+  int32_t max_key = -1;
+  int num_partials = 0;
+  uint32_t call_seq_id = 0;
+  ScanResponsePB resp;
+  do {
+    RpcController rpc;
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp.error());
+    if (resp.has_data()) {
+      RowwiseRowBlockPB* rrpb = resp.mutable_data();
+      Slice direct, indirect;
+      ASSERT_OK(rpc.GetSidecar(rrpb->rows_sidecar(), &direct));
+      if (rrpb->has_indirect_data_sidecar()) {
+        ASSERT_OK(rpc.GetSidecar(rrpb->indirect_data_sidecar(), &indirect));
+      }
+      vector<const uint8_t*> rows;
+      ASSERT_OK(ExtractRowsFromRowBlockPB(result_schema, *rrpb, indirect, &direct, &rows));
+      ASSERT_EQ(1, rows.size());
+      ConstContiguousRow row(&result_schema, rows[0]);
+      count += *reinterpret_cast<const int64_t*>(row.cell_ptr(0));
+      sum += *reinterpret_cast<const int64_t*>(row.cell_ptr(1));
+      string s = reinterpret_cast<const Slice*>(row.cell_ptr(2))->ToString();
+      if (num_partials == 0 || s < min_str) {
+        min_str = s;
+      }
+      max_key = std::max(max_key, *reinterpret_cast<const int32_t*>(row.cell_ptr(3)));
+      num_partials++;
+    }
+    req.clear_new_scan_request();
+    req.set_scanner_id(resp.scanner_id());
+    req.set_call_seq_id(++call_seq_id);
+  } while (resp.has_more_results());
+
+  ASSERT_GT(num_partials, 1);
+  ASSERT_EQ(100, count);
+  ASSERT_EQ(9900, sum);
+  ASSERT_EQ("hello 0", min_str);
+  ASSERT_EQ(99, max_key);
+
+  // Aggregates may not be combined with the columnar layout.
+  req.Clear();
+  scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToColumnPBs(schema_, scan->mutable_projected_columns()));
+  scan->mutable_aggregate_spec()->add_aggregates()->set_function(AggregatePB::COUNT);
+  scan->set_columnar_layout(true);
+  RpcController rpc;
+  ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+  ASSERT_TRUE(resp.has_error());
+  ASSERT_EQ(TabletServerErrorPB::INVALID_SCAN_SPEC, resp.error().code());
+}
+
+TEST_F(TabletServerTest, TestCountScanFromMetadata) {
+  InsertTestRowsDirect(0, 100);
+  ASSERT_OK(tablet_peer_->tablet()->Flush());
+  DeleteTestRowsRemote(0, 10);
+  InsertTestRowsDirect(100, 20);
+
+  ScanRequestPB req;
+  NewScanRequestPB* scan = req.mutable_new_scan_request();
+  scan->set_tablet_id(kTabletId);
+  AggregateSpecPB* spec = scan->mutable_aggregate_spec();
+  spec->add_aggregates()->set_function(AggregatePB::COUNT);
+  gscoped_ptr<ScanAggregator> aggregator;
+  ASSERT_OK(ScanAggregator::Create(*spec, &schema_, &aggregator));
+  const Schema& result_schema = aggregator->result_schema();
+
+  // The count is answered in one response, with or without iterating over
+  // the flushed rows.
+  for (bool from_metadata : { true, false }) {
+    FLAGS_scanner_count_rows_from_metadata = from_metadata;
+    ScanResponsePB resp;
+    RpcController rpc;
+    ASSERT_OK(proxy_->Scan(req, &resp, &rpc));
+    ASSERT_FALSE(resp.has_error()) << SecureDebugString(resp.error());
+    ASSERT_FALSE(resp.has_more_results());
+    RowwiseRowBlockPB* rrpb = resp.mutable_data();
+    Slice direct, indirect;
+    ASSERT_OK(rpc.GetSidecar(rrpb->rows_sidecar(), &direct));
+    vector<const uint8_t*> rows;
+    ASSERT_OK(ExtractRowsFromRowBlockPB(result_schema, *rrpb, indirect, &direct, &rows));
+    ASSERT_EQ(1, rows.size());
+    ConstContiguousRow row(&result_schema, rows[0]);
+    ASSERT_EQ(110, *reinterpret_cast<const int64_t*>(row.cell_ptr(0)));
+  }
+}
+
 class DelayFsyncLogHook : public log::Log::LogFaultHooks {
  public:
   DelayFsyncLogHook() : log_latch1_(1), test_latch1_(1) {}
@@ -2394,5 +2720,156 @@ TEST_F(TabletServerTest, TestFailedDnsResolution) {
   usleep(100 * 1000);
 }
 
+// Test that each request of a batched UpdateConsensus is answered separately,
+// including those which can't be handled.
+TEST_F(TabletServerTest, TestMultiRaftUpdateConsensus) {
+  const string uuid = mini_server_->server()->fs_manager()->uuid();
+  consensus::MultiRaftConsensusRequestPB req;
+  consensus::MultiRaftConsensusResponsePB resp;
+  req.set_dest_uuid(uuid);
+  for (const string& tablet_id : { string(kTabletId), string("NotPresentTabletId") }) {
+    consensus::ConsensusRequestPB* request = req.add_requests();
+    request->set_dest_uuid(uuid);
+    request->set_tablet_id(tablet_id);
+    request->set_caller_uuid("fake-leader");
+    request->set_caller_term(0);
+    request->mutable_preceding_id()->CopyFrom(consensus::MinimumOpId());
+  }
+
+  {
+    RpcController rpc;
+    ASSERT_OK(consensus_proxy_->MultiRaftUpdateConsensus(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(2, resp.responses_size());
+    // The running tablet handles the request, and rejects its stale term.
+    ASSERT_FALSE(resp.responses(0).has_error());
+    ASSERT_EQ(uuid, resp.responses(0).responder_uuid());
+    ASSERT_TRUE(resp.responses(1).has_error());
+    ASSERT_EQ(TabletServerErrorPB::TABLET_NOT_FOUND, resp.responses(1).error().code());
+  }
+
+  // A batch for another server is rejected as a whole.
+  req.set_dest_uuid("wrong-uuid");
+  resp.Clear();
+  {
+    RpcController rpc;
+    ASSERT_OK(consensus_proxy_->MultiRaftUpdateConsensus(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_EQ(TabletServerErrorPB::WRONG_SERVER_UUID, resp.error().code());
+    ASSERT_EQ(0, resp.responses_size());
+  }
+}
+
+// Test that UpdateConsensus() decodes the operations sent in a sidecar.
+TEST_F(TabletServerTest, TestUpdateConsensusWithOpsInSidecar) {
+  const string uuid = mini_server_->server()->fs_manager()->uuid();
+  consensus::ConsensusRequestPB req;
+  req.set_dest_uuid(uuid);
+  req.set_tablet_id(kTabletId);
+  req.set_caller_uuid("fake-leader");
+  req.set_caller_term(0);
+  req.mutable_preceding_id()->CopyFrom(consensus::MinimumOpId());
+
+  consensus::ReplicateMsg* msg = new consensus::ReplicateMsg;
+  msg->mutable_id()->CopyFrom(consensus::MakeOpId(0, 1));
+  msg->set_timestamp(0);
+  msg->set_op_type(consensus::NO_OP);
+  msg->mutable_noop_request();
+  consensus::ReplicateRefPtr op = consensus::make_scoped_refptr_replicate(msg);
+
+  // The operations are decoded, and the request rejected for its stale term.
+  {
+    RpcController rpc;
+    gscoped_ptr<faststring> data(new faststring);
+    Slice serialized = op->serialized();
+    data->append(serialized.data(), serialized.size());
+    int idx;
+    ASSERT_OK(rpc.AddOutboundSidecar(make_gscoped_ptr(new RpcSidecar(std::move(data))), &idx));
+    req.set_ops_sidecar_idx(idx);
+    rpc.RequireServerFeature(consensus::OPS_IN_SIDECAR);
+    consensus::ConsensusResponsePB resp;
+    ASSERT_OK(consensus_proxy_->UpdateConsensus(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ASSERT_EQ(uuid, resp.responder_uuid());
+  }
+
+  // A truncated sidecar is rejected.
+  {
+    RpcController rpc;
+    gscoped_ptr<faststring> data(new faststring);
+    Slice serialized = op->serialized();
+    data->append(serialized.data(), serialized.size() - 1);
+    int idx;
+    ASSERT_OK(rpc.AddOutboundSidecar(make_gscoped_ptr(new RpcSidecar(std::move(data))), &idx));
+    req.set_ops_sidecar_idx(idx);
+    consensus::ConsensusResponsePB resp;
+    ASSERT_OK(consensus_proxy_->UpdateConsensus(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_STR_CONTAINS(StatusFromPB(resp.error().status()).ToString(),
+                        "Invalid operations sidecar");
+  }
+
+  // So is a request referencing a sidecar which wasn't sent.
+  {
+    RpcController rpc;
+    req.set_ops_sidecar_idx(3);
+    consensus::ConsensusResponsePB resp;
+    ASSERT_OK(consensus_proxy_->UpdateConsensus(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+  }
+}
+
+// Test that Write() decodes rows sent in sidecars, and that they're replicated
+// inline with the rest of the request.
+TEST_F(TabletServerTest, TestWriteWithRowsInSidecars) {
+  WriteRequestPB req;
+  req.set_tablet_id(kTabletId);
+  ASSERT_OK(SchemaToPB(schema_, req.mutable_schema()));
+  RowOperationsPB* ops = req.mutable_row_operations();
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 1, 10, "one", ops);
+  AddTestRowToPB(RowOperationsPB::INSERT, schema_, 2, 20, "two", ops);
+  auto to_sidecar = [](const string& s) {
+    gscoped_ptr<faststring> data(new faststring);
+    data->append(s.data(), s.size());
+    return make_gscoped_ptr(new RpcSidecar(std::move(data)));
+  };
+
+  {
+    RpcController rpc;
+    int idx;
+    ASSERT_OK(rpc.AddOutboundSidecar(to_sidecar(ops->rows()), &idx));
+    ops->set_rows_sidecar(idx);
+    ASSERT_OK(rpc.AddOutboundSidecar(to_sidecar(ops->indirect_data()), &idx));
+    ops->set_indirect_data_sidecar(idx);
+    RowOperationsPB inline_ops = *ops;
+    ops->clear_rows();
+    ops->clear_indirect_data();
+    rpc.RequireServerFeature(TabletServerFeatures::ROW_OPERATIONS_IN_SIDECARS);
+    WriteResponsePB resp;
+    ASSERT_OK(proxy_->Write(req, &resp, &rpc));
+    SCOPED_TRACE(SecureDebugString(resp));
+    ASSERT_FALSE(resp.has_error());
+    ops->Swap(&inline_ops);
+  }
+  VerifyRows(schema_, { KeyValue(1, 10), KeyValue(2, 20) });
+
+  // The rows are replayed from the log.
+  ASSERT_NO_FATAL_FAILURE(ShutdownAndRebuildTablet());
+  VerifyRows(schema_, { KeyValue(1, 10), KeyValue(2, 20) });
+
+  // A request referencing a sidecar which wasn't sent is rejected.
+  {
+    RpcController rpc;
+    ops->set_rows_sidecar(3);
+    WriteResponsePB resp;
+    ASSERT_OK(proxy_->Write(req, &resp, &rpc));
+    ASSERT_TRUE(resp.has_error());
+    ASSERT_STR_CONTAINS(StatusFromPB(resp.error().status()).ToString(),
+                        "Invalid row operations sidecar");
+  }
+}
+
 } // namespace tserver
 } // namespace kudu
@@ -27,7 +27,9 @@
 #include "kudu/rpc/service_if.h"
 #include "kudu/server/rpc_server.h"
 #include "kudu/server/webserver.h"
+#include "kudu/tserver/block_cache_prewarmer.h"
 #include "kudu/tserver/heartbeater.h"
+#include "kudu/tserver/scan_result_cache.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_service.h"
 #include "kudu/tserver/ts_tablet_manager.h"
@@ -46,6 +48,17 @@ using std::vector;
 namespace kudu {
 namespace tserver {
 
+namespace {
+
+MaintenanceManager::Options MaintenanceManagerOptions(
+    const scoped_refptr<MetricEntity>& metric_entity) {
+  MaintenanceManager::Options options = MaintenanceManager::DEFAULT_OPTIONS;
+  options.metric_entity = metric_entity;
+  return options;
+}
+
+} // anonymous namespace
+
 TabletServer::TabletServer(const TabletServerOptions& opts)
   : ServerBase("TabletServer", opts, "kudu.tabletserver"),
     initted_(false),
@@ -53,8 +66,10 @@ TabletServer::TabletServer(const TabletServerOptions& opts)
     opts_(opts),
     tablet_manager_(new TSTabletManager(fs_manager_.get(), this, metric_registry())),
     scanner_manager_(new ScannerManager(metric_entity())),
+    scan_result_cache_(ScanResultCache::CreateIfEnabled(metric_entity())),
     path_handlers_(new TabletServerPathHandlers(this)),
-    maintenance_manager_(new MaintenanceManager(MaintenanceManager::DEFAULT_OPTIONS)) {
+    maintenance_manager_(new MaintenanceManager(MaintenanceManagerOptions(metric_entity()))),
+    block_cache_prewarmer_(new BlockCachePrewarmer(fs_manager_.get(), tablet_manager_.get())) {
 }
 
 TabletServer::~TabletServer() {
@@ -126,6 +141,10 @@ Status TabletServer::Start() {
   RETURN_NOT_OK(heartbeater_->Start());
   RETURN_NOT_OK(maintenance_manager_->Init(fs_manager_->uuid()));
 
+  // Prewarms the block cache in the background, once the tablets are
+  // bootstrapped.
+  RETURN_NOT_OK(block_cache_prewarmer_->Start());
+
   google::FlushLogFiles(google::INFO); // Flush the startup messages.
 
   return Status::OK();
@@ -136,6 +155,7 @@ void TabletServer::Shutdown() {
 
   if (initted_) {
     maintenance_manager_->Shutdown();
+    block_cache_prewarmer_->Shutdown();
     WARN_NOT_OK(heartbeater_->Stop(), "Failed to stop TS Heartbeat thread");
     ServerBase::Shutdown();
     tablet_manager_->Shutdown();
@@ -39,7 +39,9 @@ class MaintenanceManager;
 
 namespace tserver {
 
+class BlockCachePrewarmer;
 class Heartbeater;
+class ScanResultCache;
 class ScannerManager;
 class TabletServerPathHandlers;
 class TSTabletManager;
@@ -73,6 +75,9 @@ class TabletServer : public server::ServerBase {
 
   ScannerManager* scanner_manager() { return scanner_manager_.get(); }
 
+  // Returns null if the scan result cache is disabled.
+  ScanResultCache* scan_result_cache() { return scan_result_cache_.get(); }
+
   Heartbeater* heartbeater() { return heartbeater_.get(); }
 
   void set_fail_heartbeats_for_tests(bool fail_heartbeats_for_tests) {
@@ -108,6 +113,9 @@ class TabletServer : public server::ServerBase {
   // dependencies.
   gscoped_ptr<ScannerManager> scanner_manager_;
 
+  // Cache of the results of snapshot scans, or null if disabled.
+  gscoped_ptr<ScanResultCache> scan_result_cache_;
+
   // Thread responsible for heartbeating to the master.
   gscoped_ptr<Heartbeater> heartbeater_;
 
@@ -117,6 +125,9 @@ class TabletServer : public server::ServerBase {
   // The maintenance manager for this tablet server
   std::shared_ptr<MaintenanceManager> maintenance_manager_;
 
+  // Saves the block cache's hot list and prewarms the block cache from it.
+  gscoped_ptr<BlockCachePrewarmer> block_cache_prewarmer_;
+
   DISALLOW_COPY_AND_ASSIGN(TabletServer);
 };
 
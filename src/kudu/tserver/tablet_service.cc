@@ -18,11 +18,14 @@
 #include "kudu/tserver/tablet_service.h"
 
 #include <algorithm>
+#include <atomic>
 #include <boost/optional.hpp>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "kudu/common/column_statistics.h"
 #include "kudu/common/iterator.h"
 #include "kudu/common/scan_spec.h"
 #include "kudu/common/schema.h"
@@ -45,10 +48,13 @@
 #include "kudu/tablet/transactions/alter_schema_transaction.h"
 #include "kudu/tablet/transactions/write_transaction.h"
 #include "kudu/tserver/tablet_copy_service.h"
+#include "kudu/tserver/scan_aggregator.h"
+#include "kudu/tserver/scan_result_cache.h"
 #include "kudu/tserver/scanners.h"
 #include "kudu/tserver/tablet_server.h"
 #include "kudu/tserver/ts_tablet_manager.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/compression/compression_codec.h"
 #include "kudu/util/crc.h"
 #include "kudu/util/debug/trace_event.h"
 #include "kudu/util/faststring.h"
@@ -57,8 +63,10 @@
 #include "kudu/util/mem_tracker.h"
 #include "kudu/util/monotime.h"
 #include "kudu/util/pb_util.h"
+#include "kudu/util/scoped_cleanup.h"
 #include "kudu/util/status.h"
 #include "kudu/util/status_callback.h"
+#include "kudu/util/threadpool.h"
 #include "kudu/util/trace.h"
 
 DEFINE_int32(scanner_default_batch_size_bytes, 1024 * 1024,
@@ -94,6 +102,18 @@ DEFINE_int32(scanner_inject_latency_on_each_batch_ms, 0,
              "Used for tests.");
 TAG_FLAG(scanner_inject_latency_on_each_batch_ms, unsafe);
 
+DEFINE_bool(scanner_count_rows_from_metadata, true,
+            "Whether scans which only count the rows of a whole tablet are answered "
+            "from the row counts of its rowsets' metadata where possible, rather than "
+            "by iterating over the rows.");
+TAG_FLAG(scanner_count_rows_from_metadata, advanced);
+TAG_FLAG(scanner_count_rows_from_metadata, runtime);
+
+DEFINE_int32(num_tablets_to_create_simultaneously, 8,
+             "The maximum number of tablets of a single CreateTablets request "
+             "which are created at the same time.");
+TAG_FLAG(num_tablets_to_create_simultaneously, advanced);
+
 DECLARE_int32(memory_limit_warn_threshold_percentage);
 DECLARE_int32(tablet_history_max_age_sec);
 
@@ -111,6 +131,8 @@ using kudu::consensus::GetNodeInstanceRequestPB;
 using kudu::consensus::GetNodeInstanceResponsePB;
 using kudu::consensus::LeaderStepDownRequestPB;
 using kudu::consensus::LeaderStepDownResponsePB;
+using kudu::consensus::MultiRaftConsensusRequestPB;
+using kudu::consensus::MultiRaftConsensusResponsePB;
 using kudu::consensus::RunLeaderElectionRequestPB;
 using kudu::consensus::RunLeaderElectionResponsePB;
 using kudu::consensus::StartTabletCopyRequestPB;
@@ -144,21 +166,14 @@ namespace tserver {
 namespace {
 
 // Lookup the given tablet, ensuring that it both exists and is RUNNING.
-// If it is not, responds to the RPC associated with 'context' after setting
-// resp->mutable_error() to indicate the failure reason.
-//
-// Returns true if successful.
-template<class RespClass>
-bool LookupTabletPeerOrRespond(TabletPeerLookupIf* tablet_manager,
+// If it is not, returns a bad status and sets 'error_code'.
+Status LookupRunningTabletPeer(TabletPeerLookupIf* tablet_manager,
                                const string& tablet_id,
-                               RespClass* resp,
-                               rpc::RpcContext* context,
-                               scoped_refptr<TabletPeer>* peer) {
+                               scoped_refptr<TabletPeer>* peer,
+                               TabletServerErrorPB::Code* error_code) {
   if (PREDICT_FALSE(!tablet_manager->GetTabletPeer(tablet_id, peer).ok())) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::NotFound("Tablet not found"),
-                         TabletServerErrorPB::TABLET_NOT_FOUND, context);
-    return false;
+    *error_code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    return Status::NotFound("Tablet not found");
   }
 
   // Check RUNNING state.
@@ -169,8 +184,27 @@ bool LookupTabletPeerOrRespond(TabletPeerLookupIf* tablet_manager,
     if (state == tablet::FAILED) {
       s = s.CloneAndAppend((*peer)->error().ToString());
     }
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::TABLET_NOT_RUNNING, context);
+    *error_code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    return s;
+  }
+  return Status::OK();
+}
+
+// Like LookupRunningTabletPeer(), but if the tablet isn't running, responds
+// to the RPC associated with 'context' after setting resp->mutable_error()
+// to indicate the failure reason.
+//
+// Returns true if successful.
+template<class RespClass>
+bool LookupTabletPeerOrRespond(TabletPeerLookupIf* tablet_manager,
+                               const string& tablet_id,
+                               RespClass* resp,
+                               rpc::RpcContext* context,
+                               scoped_refptr<TabletPeer>* peer) {
+  TabletServerErrorPB::Code error_code;
+  Status s = LookupRunningTabletPeer(tablet_manager, tablet_id, peer, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
     return false;
   }
   return true;
@@ -334,6 +368,21 @@ class ScanResultCollector {
 
   // Return the number of rows actually returned to the client.
   virtual int64_t NumRowsReturned() const = 0;
+
+  // Handles the results of 'batch', built in the background for a
+  // prefetching scanner, as if its row blocks had been passed to
+  // HandleRowBlock(). Only collectors of row-wise results support this, and
+  // only before handling any row blocks.
+  virtual void HandlePrefetchedBatch(const PrefetchedScanBatch& batch) {
+    LOG(FATAL) << "Prefetched batches are not supported by this collector";
+  }
+
+  // Handles 'num_rows' rows which were counted rather than scanned, as if
+  // row blocks holding them had been passed to HandleRowBlock(). Only
+  // collectors which don't look at the rows support this.
+  virtual void HandleRowCount(const Schema* client_projection_schema, int64_t num_rows) {
+    LOG(FATAL) << "Row counts are not supported by this collector";
+  }
 };
 
 namespace {
@@ -399,6 +448,18 @@ class ScanResultCopier : public ScanResultCollector {
     return num_rows_returned_;
   }
 
+  // Copies the serialized rows of 'batch' into the buffers. Since the buffers
+  // are still empty, the offsets of the indirect data stay valid.
+  virtual void HandlePrefetchedBatch(const PrefetchedScanBatch& batch) OVERRIDE {
+    DCHECK_EQ(0, blocks_processed_);
+    blocks_processed_ = batch.blocks_processed;
+    num_rows_returned_ = batch.num_rows_returned;
+    rowblock_pb_->set_num_rows(batch.data.num_rows());
+    rows_data_->append(batch.rows_data.data(), batch.rows_data.size());
+    indirect_data_->append(batch.indirect_data.data(), batch.indirect_data.size());
+    last_primary_key_.assign_copy(batch.last_primary_key.data(), batch.last_primary_key.size());
+  }
+
  private:
   RowwiseRowBlockPB* const rowblock_pb_;
   faststring* const rows_data_;
@@ -410,6 +471,98 @@ class ScanResultCopier : public ScanResultCollector {
   DISALLOW_COPY_AND_ASSIGN(ScanResultCopier);
 };
 
+namespace {
+
+// Adds 'buf' as a sidecar of the response to 'context', first compressing it
+// with 'codec' unless it is null, and sets '*idx' to the sidecar's index.
+Status AddScanSidecar(rpc::RpcContext* context, const CompressionCodec* codec,
+                      gscoped_ptr<faststring> buf, int* idx) {
+  if (codec) {
+    gscoped_ptr<faststring> compressed(new faststring());
+    RETURN_NOT_OK_PREPEND(CompressSidecar(*codec, Slice(*buf), compressed.get()),
+                          "Unable to compress scan response sidecar");
+    buf.swap(compressed);
+  }
+  return context->AddRpcSidecar(make_gscoped_ptr(new rpc::RpcSidecar(std::move(buf))), idx);
+}
+
+} // anonymous namespace
+
+// Copies the scan result into per-column buffers, for scanners which
+// return their results in a ColumnarRowBlockPB.
+class ColumnarScanResultCopier : public ScanResultCollector {
+ public:
+  ColumnarScanResultCopier()
+      : blocks_processed_(0),
+        num_rows_returned_(0) {
+  }
+
+  virtual void HandleRowBlock(const Schema* client_projection_schema,
+                              const RowBlock& row_block) OVERRIDE {
+    blocks_processed_++;
+    if (!batch_) {
+      // Both schemas are owned by the scanner, which outlives the response.
+      batch_.reset(new ColumnarSerializedBatch(
+          client_projection_schema ? client_projection_schema : &row_block.schema()));
+    }
+    batch_->AddRowBlock(row_block);
+    num_rows_returned_ += row_block.selection_vector()->CountSelected();
+    SetLastRow(row_block, &last_primary_key_);
+  }
+
+  virtual int BlocksProcessed() const OVERRIDE { return blocks_processed_; }
+
+  // Returns number of bytes buffered to return.
+  virtual int64_t ResponseSize() const OVERRIDE {
+    return batch_ ? batch_->TotalSize() : 0;
+  }
+
+  virtual const faststring& last_primary_key() const OVERRIDE {
+    return last_primary_key_;
+  }
+
+  virtual int64_t NumRowsReturned() const OVERRIDE {
+    return num_rows_returned_;
+  }
+
+  // Add the buffers as sidecars of the response, compressed with 'codec'
+  // unless it is null, recording their indexes in 'pb'. Must only be called
+  // if at least one block was processed.
+  Status AddSidecars(rpc::RpcContext* context, const CompressionCodec* codec,
+                     ColumnarRowBlockPB* pb) {
+    DCHECK(batch_);
+    pb->set_num_rows(batch_->num_rows());
+    for (ColumnarSerializedBatch::Column& col : *batch_->mutable_columns()) {
+      ColumnarRowBlockPB::Column* col_pb = pb->add_columns();
+      int idx;
+      RETURN_NOT_OK(AddSidecar(context, codec, &col.data, &idx));
+      col_pb->set_data_sidecar(idx);
+      if (col.varlen_data) {
+        RETURN_NOT_OK(AddSidecar(context, codec, &col.varlen_data, &idx));
+        col_pb->set_varlen_data_sidecar(idx);
+      }
+      if (col.non_null_bitmap) {
+        RETURN_NOT_OK(AddSidecar(context, codec, &col.non_null_bitmap, &idx));
+        col_pb->set_non_null_bitmap_sidecar(idx);
+      }
+    }
+    return Status::OK();
+  }
+
+ private:
+  static Status AddSidecar(rpc::RpcContext* context, const CompressionCodec* codec,
+                           std::unique_ptr<faststring>* buf, int* idx) {
+    return AddScanSidecar(context, codec, make_gscoped_ptr(buf->release()), idx);
+  }
+
+  gscoped_ptr<ColumnarSerializedBatch> batch_;
+  int blocks_processed_;
+  int64_t num_rows_returned_;
+  faststring last_primary_key_;
+
+  DISALLOW_COPY_AND_ASSIGN(ColumnarScanResultCopier);
+};
+
 // Checksums the scan result.
 class ScanResultChecksummer : public ScanResultCollector {
  public:
@@ -495,6 +648,73 @@ class ScanResultChecksummer : public ScanResultCollector {
   DISALLOW_COPY_AND_ASSIGN(ScanResultChecksummer);
 };
 
+// Aggregates the scan result (see NewScanRequestPB::aggregate_spec). The
+// partial aggregates of the rows scanned by this request are returned as
+// the rows of the response.
+class ScanResultAggregator : public ScanResultCollector {
+ public:
+  explicit ScanResultAggregator(const AggregateSpecPB& spec)
+      : spec_(spec),
+        blocks_processed_(0) {
+  }
+
+  virtual void HandleRowBlock(const Schema* client_projection_schema,
+                              const RowBlock& row_block) OVERRIDE {
+    blocks_processed_++;
+    if (!aggregator_) {
+      // The spec was checked against the projection when the scanner was
+      // created, and the scanner owns the projection.
+      CHECK_OK(ScanAggregator::Create(
+          spec_, client_projection_schema ? client_projection_schema : &row_block.schema(),
+          &aggregator_));
+    }
+    aggregator_->AddRowBlock(row_block);
+    SetLastRow(row_block, &last_primary_key_);
+  }
+
+  // Only valid if the spec counts rows only (see ScanAggregator::CountsRowsOnly()).
+  virtual void HandleRowCount(const Schema* client_projection_schema,
+                              int64_t num_rows) OVERRIDE {
+    blocks_processed_++;
+    if (!aggregator_) {
+      CHECK_OK(ScanAggregator::Create(spec_, client_projection_schema, &aggregator_));
+    }
+    aggregator_->AddRowCount(num_rows);
+  }
+
+  virtual int BlocksProcessed() const OVERRIDE { return blocks_processed_; }
+
+  // Returns an estimate of the size of the aggregates.
+  virtual int64_t ResponseSize() const OVERRIDE {
+    return aggregator_ ? aggregator_->ResultSize() : 0;
+  }
+
+  virtual const faststring& last_primary_key() const OVERRIDE {
+    return last_primary_key_;
+  }
+
+  // Returns the number of groups, each of which is returned as a row.
+  virtual int64_t NumRowsReturned() const OVERRIDE {
+    return aggregator_ ? aggregator_->num_groups() : 0;
+  }
+
+  // Serializes the partial aggregates as the rows of the response.
+  void SerializeResults(RowwiseRowBlockPB* rowblock_pb,
+                        faststring* rows_data, faststring* indirect_data) {
+    if (aggregator_) {
+      aggregator_->SerializeResults(rowblock_pb, rows_data, indirect_data);
+    }
+  }
+
+ private:
+  const AggregateSpecPB& spec_;
+  gscoped_ptr<ScanAggregator> aggregator_;
+  int blocks_processed_;
+  faststring last_primary_key_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScanResultAggregator);
+};
+
 // Return the batch size to use for a given request, after clamping
 // the user-requested request within the server-side allowable range.
 // This is only a hint, really more of a threshold since returned bytes
@@ -597,64 +817,121 @@ void TabletServiceAdminImpl::AlterSchema(const AlterSchemaRequestPB* req,
   }
 }
 
-void TabletServiceAdminImpl::CreateTablet(const CreateTabletRequestPB* req,
-                                          CreateTabletResponsePB* resp,
-                                          rpc::RpcContext* context) {
-  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "CreateTablet", req, resp, context)) {
-    return;
-  }
-  TRACE_EVENT1("tserver", "CreateTablet",
-               "tablet_id", req->tablet_id());
+namespace {
 
+// Creates the tablet described by 'req'. On failure, sets '*code' to the error
+// code to respond with.
+Status CreateTabletFromRequest(TSTabletManager* tablet_manager,
+                               const CreateTabletRequestPB& req,
+                               TabletServerErrorPB::Code* code) {
   Schema schema;
-  Status s = SchemaFromPB(req->schema(), &schema);
+  Status s = SchemaFromPB(req.schema(), &schema);
   DCHECK(schema.has_column_ids());
   if (!s.ok()) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::InvalidArgument("Invalid Schema."),
-                         TabletServerErrorPB::INVALID_SCHEMA, context);
-    return;
+    *code = TabletServerErrorPB::INVALID_SCHEMA;
+    return Status::InvalidArgument("Invalid Schema.");
   }
 
   PartitionSchema partition_schema;
-  s = PartitionSchema::FromPB(req->partition_schema(), schema, &partition_schema);
+  s = PartitionSchema::FromPB(req.partition_schema(), schema, &partition_schema);
   if (!s.ok()) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::InvalidArgument("Invalid PartitionSchema."),
-                         TabletServerErrorPB::INVALID_SCHEMA, context);
-    return;
+    *code = TabletServerErrorPB::INVALID_SCHEMA;
+    return Status::InvalidArgument("Invalid PartitionSchema.");
   }
 
   Partition partition;
-  Partition::FromPB(req->partition(), &partition);
+  Partition::FromPB(req.partition(), &partition);
 
-  LOG(INFO) << "Processing CreateTablet for tablet " << req->tablet_id()
-            << " (table=" << req->table_name()
-            << " [id=" << req->table_id() << "]), partition="
+  LOG(INFO) << "Processing CreateTablet for tablet " << req.tablet_id()
+            << " (table=" << req.table_name()
+            << " [id=" << req.table_id() << "]), partition="
             << partition_schema.PartitionDebugString(partition, schema);
-  VLOG(1) << "Full request: " << SecureDebugString(*req);
-
-  s = server_->tablet_manager()->CreateNewTablet(req->table_id(),
-                                                 req->tablet_id(),
-                                                 partition,
-                                                 req->table_name(),
-                                                 schema,
-                                                 partition_schema,
-                                                 req->config(),
-                                                 nullptr);
+  VLOG(1) << "Full request: " << SecureDebugString(req);
+
+  s = tablet_manager->CreateNewTablet(req.table_id(),
+                                      req.tablet_id(),
+                                      partition,
+                                      req.table_name(),
+                                      schema,
+                                      partition_schema,
+                                      req.config(),
+                                      nullptr);
   if (PREDICT_FALSE(!s.ok())) {
-    TabletServerErrorPB::Code code;
     if (s.IsAlreadyPresent()) {
-      code = TabletServerErrorPB::TABLET_ALREADY_EXISTS;
+      *code = TabletServerErrorPB::TABLET_ALREADY_EXISTS;
     } else {
-      code = TabletServerErrorPB::UNKNOWN_ERROR;
+      *code = TabletServerErrorPB::UNKNOWN_ERROR;
     }
+  }
+  return s;
+}
+
+} // anonymous namespace
+
+void TabletServiceAdminImpl::CreateTablet(const CreateTabletRequestPB* req,
+                                          CreateTabletResponsePB* resp,
+                                          rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "CreateTablet", req, resp, context)) {
+    return;
+  }
+  TRACE_EVENT1("tserver", "CreateTablet",
+               "tablet_id", req->tablet_id());
+
+  TabletServerErrorPB::Code code;
+  Status s = CreateTabletFromRequest(server_->tablet_manager(), *req, &code);
+  if (PREDICT_FALSE(!s.ok())) {
     SetupErrorAndRespond(resp->mutable_error(), s, code, context);
     return;
   }
   context->RespondSuccess();
 }
 
+void TabletServiceAdminImpl::CreateTablets(const CreateTabletsRequestPB* req,
+                                           CreateTabletsResponsePB* resp,
+                                           rpc::RpcContext* context) {
+  if (!CheckUuidMatchOrRespond(server_->tablet_manager(), "CreateTablets", req, resp, context)) {
+    return;
+  }
+  TRACE_EVENT1("tserver", "CreateTablets",
+               "num_tablets", req->tablets_size());
+  LOG(INFO) << "Processing CreateTablets for " << req->tablets_size() << " tablets";
+
+  // Most of the time spent creating a tablet goes to flushing its metadata
+  // and consensus metadata, so the tablets are created in parallel.
+  int num_tablets = req->tablets_size();
+  gscoped_ptr<ThreadPool> pool;
+  Status s = ThreadPoolBuilder("create-tablets")
+      .set_max_threads(std::max(1, std::min(FLAGS_num_tablets_to_create_simultaneously,
+                                            num_tablets)))
+      .Build(&pool);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+
+  vector<Status> statuses(num_tablets);
+  vector<TabletServerErrorPB::Code> codes(num_tablets, TabletServerErrorPB::UNKNOWN_ERROR);
+  TSTabletManager* tablet_manager = server_->tablet_manager();
+  for (int i = 0; i < num_tablets; i++) {
+    s = pool->SubmitFunc([&, i]() {
+        statuses[i] = CreateTabletFromRequest(tablet_manager, req->tablets(i), &codes[i]);
+      });
+    if (PREDICT_FALSE(!s.ok())) {
+      statuses[i] = s;
+    }
+  }
+  pool->Wait();
+
+  for (int i = 0; i < num_tablets; i++) {
+    CreateTabletResponsePB* tablet_resp = resp->add_tablets();
+    if (PREDICT_FALSE(!statuses[i].ok())) {
+      StatusToPB(statuses[i], tablet_resp->mutable_error()->mutable_status());
+      tablet_resp->mutable_error()->set_code(codes[i]);
+    }
+  }
+  context->RespondSuccess();
+}
+
 void TabletServiceAdminImpl::DeleteTablet(const DeleteTabletRequestPB* req,
                                           DeleteTabletResponsePB* resp,
                                           rpc::RpcContext* context) {
@@ -698,28 +975,134 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
                "tablet_id", req->tablet_id());
   DVLOG(3) << "Received Write RPC: " << SecureDebugString(*req);
 
-  scoped_refptr<TabletPeer> tablet_peer;
-  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
-                                 &tablet_peer)) {
-    return;
-  }
-
-  shared_ptr<Tablet> tablet;
   TabletServerErrorPB::Code error_code;
-  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  Status s = SubmitWriteRequest(
+      req, resp, context,
+      context->AreResultsTracked() ? context->request_id() : nullptr,
+      gscoped_ptr<TransactionCompletionCallback>(
+          new RpcTransactionCompletionCallback<WriteResponsePB>(context, resp)),
+      &error_code);
   if (PREDICT_FALSE(!s.ok())) {
     SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
-    return;
+  }
+  // Otherwise the RPC will be responded to asynchronously.
+}
+
+namespace {
+
+// Responds to a MultiTabletWrite() RPC once all the writes of its batch have
+// completed.
+class MultiTabletWriteTracker : public RefCountedThreadSafe<MultiTabletWriteTracker> {
+ public:
+  // The extra pending write is released by the submitter once it has
+  // submitted all of the batch's writes, so that the RPC isn't responded to
+  // while it's still doing so.
+  MultiTabletWriteTracker(rpc::RpcContext* context, int num_writes)
+      : context_(context),
+        num_pending_(num_writes + 1) {
+  }
+
+  void WriteCompleted() {
+    if (num_pending_.fetch_sub(1) == 1) {
+      context_->RespondSuccess();
+    }
+  }
+
+ private:
+  friend class RefCountedThreadSafe<MultiTabletWriteTracker>;
+  ~MultiTabletWriteTracker() {}
+
+  rpc::RpcContext* const context_;
+  std::atomic<int> num_pending_;
+};
+
+// Completes one of the writes of a MultiTabletWrite() batch, with any error
+// reported in the write's own response.
+class MultiTabletWriteCompletionCallback : public TransactionCompletionCallback {
+ public:
+  MultiTabletWriteCompletionCallback(scoped_refptr<MultiTabletWriteTracker> tracker,
+                                     WriteResponsePB* response)
+      : tracker_(std::move(tracker)),
+        response_(response) {
+  }
+
+  void TransactionCompleted() override {
+    if (!status_.ok()) {
+      StatusToPB(status_, response_->mutable_error()->mutable_status());
+      response_->mutable_error()->set_code(code_);
+    }
+    tracker_->WriteCompleted();
   }
 
-  uint64_t bytes = req->row_operations().rows().size() +
-      req->row_operations().indirect_data().size();
+ private:
+  const scoped_refptr<MultiTabletWriteTracker> tracker_;
+  WriteResponsePB* const response_;
+};
+
+} // anonymous namespace
+
+void TabletServiceImpl::MultiTabletWrite(const MultiTabletWriteRequestPB* req,
+                                         MultiTabletWriteResponsePB* resp,
+                                         rpc::RpcContext* context) {
+  TRACE_EVENT1("tserver", "TabletServiceImpl::MultiTabletWrite",
+               "num_writes", req->requests_size());
+  DVLOG(3) << "Received MultiTabletWrite RPC: " << SecureDebugString(*req);
+
+  // Lay out all the responses up front: the writes complete, and fill them
+  // in, concurrently.
+  for (int i = 0; i < req->requests_size(); i++) {
+    resp->add_responses();
+  }
+  scoped_refptr<MultiTabletWriteTracker> tracker(
+      new MultiTabletWriteTracker(context, req->requests_size()));
+  for (int i = 0; i < req->requests_size(); i++) {
+    WriteResponsePB* write_resp = resp->mutable_responses(i);
+    TabletServerErrorPB::Code error_code;
+    Status s = SubmitWriteRequest(
+        &req->requests(i), write_resp, context, nullptr,
+        gscoped_ptr<TransactionCompletionCallback>(
+            new MultiTabletWriteCompletionCallback(tracker, write_resp)),
+        &error_code);
+    if (PREDICT_FALSE(!s.ok())) {
+      StatusToPB(s, write_resp->mutable_error()->mutable_status());
+      write_resp->mutable_error()->set_code(error_code);
+      tracker->WriteCompleted();
+    }
+  }
+  tracker->WriteCompleted();
+}
+
+Status TabletServiceImpl::SubmitWriteRequest(const WriteRequestPB* req,
+                                             WriteResponsePB* resp,
+                                             rpc::RpcContext* context,
+                                             const rpc::RequestIdPB* request_id,
+                                             gscoped_ptr<TransactionCompletionCallback> callback,
+                                             TabletServerErrorPB::Code* error_code) {
+  *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+  scoped_refptr<TabletPeer> tablet_peer;
+  RETURN_NOT_OK(LookupRunningTabletPeer(server_->tablet_manager(), req->tablet_id(),
+                                        &tablet_peer, error_code));
+
+  shared_ptr<Tablet> tablet;
+  RETURN_NOT_OK(GetTabletRef(tablet_peer, &tablet, error_code));
+
+  // The client may have sent the rows in sidecars, which are then decoded in
+  // place rather than copied out of the request.
+  const RowOperationsPB& ops = req->row_operations();
+  Slice rows = ops.rows();
+  Slice indirect_data = ops.indirect_data();
+  if (ops.has_rows_sidecar()) {
+    Status s = context->GetInboundSidecar(ops.rows_sidecar(), &rows);
+    if (s.ok() && ops.has_indirect_data_sidecar()) {
+      s = context->GetInboundSidecar(ops.indirect_data_sidecar(), &indirect_data);
+    }
+    RETURN_NOT_OK_PREPEND(s, "Invalid row operations sidecar");
+  }
+
+  uint64_t bytes = rows.size() + indirect_data.size();
   if (!tablet->ShouldThrottleAllow(bytes)) {
-    SetupErrorAndRespond(resp->mutable_error(),
-                         Status::ServiceUnavailable("Rejecting Write request: throttled"),
-                         TabletServerErrorPB::THROTTLED,
-                         context);
-    return;
+    *error_code = TabletServerErrorPB::THROTTLED;
+    return Status::ServiceUnavailable("Rejecting Write request: throttled");
   }
 
   // Check for memory pressure; don't bother doing any additional work if we've
@@ -735,54 +1118,34 @@ void TabletServiceImpl::Write(const WriteRequestPB* req,
     } else {
       KLOG_EVERY_N_SECS(INFO, 1) << "Rejecting Write request: " << msg << THROTTLE_MSG;
     }
-    SetupErrorAndRespond(resp->mutable_error(), Status::ServiceUnavailable(msg),
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    return Status::ServiceUnavailable(msg);
   }
 
   if (!server_->clock()->SupportsExternalConsistencyMode(req->external_consistency_mode())) {
-    Status s = Status::NotSupported("The configured clock does not support the"
+    return Status::NotSupported("The configured clock does not support the"
         " required consistency mode.");
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
   }
 
   unique_ptr<WriteTransactionState> tx_state(new WriteTransactionState(
       tablet_peer.get(),
       req,
-      context->AreResultsTracked() ? context->request_id() : nullptr,
+      request_id,
       resp));
+  if (ops.has_rows_sidecar()) {
+    tx_state->set_row_operations_sidecars(rows, indirect_data);
+  }
 
   // If the client sent us a timestamp, decode it and update the clock so that all future
   // timestamps are greater than the passed timestamp.
   if (req->has_propagated_timestamp()) {
     Timestamp ts(req->propagated_timestamp());
-    s = server_->clock()->Update(ts);
-  }
-  if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-    return;
+    RETURN_NOT_OK(server_->clock()->Update(ts));
   }
 
-  tx_state->set_completion_callback(gscoped_ptr<TransactionCompletionCallback>(
-      new RpcTransactionCompletionCallback<WriteResponsePB>(context,
-                                                            resp)));
+  tx_state->set_completion_callback(std::move(callback));
 
-  // Submit the write. The RPC will be responded to asynchronously.
-  s = tablet_peer->SubmitWrite(std::move(tx_state));
-
-  // Check that we could submit the write
-  if (PREDICT_FALSE(!s.ok())) {
-    SetupErrorAndRespond(resp->mutable_error(), s,
-                         TabletServerErrorPB::UNKNOWN_ERROR,
-                         context);
-  }
-  return;
+  // Submit the write. The callback will be called asynchronously.
+  return tablet_peer->SubmitWrite(std::move(tx_state));
 }
 
 ConsensusServiceImpl::ConsensusServiceImpl(const scoped_refptr<MetricEntity>& metric_entity,
@@ -812,6 +1175,27 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   // Submit the update directly to the TabletPeer's Consensus instance.
   scoped_refptr<Consensus> consensus;
   if (!GetConsensusOrRespond(tablet_peer, resp, context, &consensus)) return;
+
+  // If the leader sent the operations in a sidecar, decode them into a copy of
+  // the request.
+  ConsensusRequestPB req_with_ops;
+  if (req->has_ops_sidecar_idx()) {
+    Slice sidecar;
+    Status s = context->GetInboundSidecar(req->ops_sidecar_idx(), &sidecar);
+    if (s.ok()) {
+      req_with_ops.CopyFrom(*req);
+      req_with_ops.clear_ops_sidecar_idx();
+      s = consensus::DecodeSerializedReplicates(sidecar, req_with_ops.mutable_ops());
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(), s.CloneAndPrepend("Invalid operations sidecar"),
+                           TabletServerErrorPB::UNKNOWN_ERROR,
+                           context);
+      return;
+    }
+    req = &req_with_ops;
+  }
+
   Status s = consensus->Update(req, resp);
   if (PREDICT_FALSE(!s.ok())) {
     // Clear the response first, since a partially-filled response could
@@ -827,6 +1211,57 @@ void ConsensusServiceImpl::UpdateConsensus(const ConsensusRequestPB* req,
   context->RespondSuccess();
 }
 
+namespace {
+
+// Handles 'req', one of the requests of a MultiRaftUpdateConsensus() batch, as
+// UpdateConsensus() would, except that errors are reported in 'resp' rather
+// than by responding to the RPC.
+void UpdateConsensusInBatch(TabletPeerLookupIf* tablet_manager,
+                            const ConsensusRequestPB& req,
+                            ConsensusResponsePB* resp) {
+  TabletServerErrorPB::Code code = TabletServerErrorPB::UNKNOWN_ERROR;
+  Status s;
+  scoped_refptr<TabletPeer> tablet_peer;
+  scoped_refptr<Consensus> consensus;
+  if (PREDICT_FALSE(!tablet_manager->GetTabletPeer(req.tablet_id(), &tablet_peer).ok())) {
+    code = TabletServerErrorPB::TABLET_NOT_FOUND;
+    s = Status::NotFound("Tablet not found");
+  } else if (PREDICT_FALSE(tablet_peer->state() != tablet::RUNNING)) {
+    code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    s = Status::IllegalState("Tablet not RUNNING",
+                             tablet::TabletStatePB_Name(tablet_peer->state()));
+  } else if (PREDICT_FALSE(!(consensus = tablet_peer->shared_consensus()))) {
+    code = TabletServerErrorPB::TABLET_NOT_RUNNING;
+    s = Status::ServiceUnavailable("Consensus unavailable. Tablet not running");
+  } else {
+    s = consensus->Update(&req, resp);
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    resp->Clear();
+    StatusToPB(s, resp->mutable_error()->mutable_status());
+    resp->mutable_error()->set_code(code);
+  }
+}
+
+} // anonymous namespace
+
+void ConsensusServiceImpl::MultiRaftUpdateConsensus(const MultiRaftConsensusRequestPB* req,
+                                                    MultiRaftConsensusResponsePB* resp,
+                                                    rpc::RpcContext* context) {
+  DVLOG(3) << "Received Multi-Raft Consensus Update RPC: " << SecureDebugString(*req);
+  if (!CheckUuidMatchOrRespond(tablet_manager_, "MultiRaftUpdateConsensus", req, resp, context)) {
+    return;
+  }
+  for (const ConsensusRequestPB& request : req->requests()) {
+    UpdateConsensusInBatch(tablet_manager_, request, resp->add_responses());
+  }
+  context->RespondSuccess();
+}
+
+bool ConsensusServiceImpl::SupportsFeature(uint32_t feature) const {
+  return feature == consensus::OPS_IN_SIDECAR;
+}
+
 void ConsensusServiceImpl::RequestConsensusVote(const VoteRequestPB* req,
                                                 VoteResponsePB* resp,
                                                 rpc::RpcContext* context) {
@@ -1027,11 +1462,23 @@ void TabletServiceImpl::ScannerKeepAlive(const ScannerKeepAliveRequestPB *req,
 }
 
 namespace {
-void SetResourceMetrics(ResourceMetricsPB* metrics, rpc::RpcContext* context) {
+// Sets the resource metrics gathered in the trace of the RPC, along with
+// those of the scan profile if 'profile' is true. The rest of the profile is
+// set by HandleContinueScanRequest().
+void SetResourceMetrics(ResourceMetricsPB* metrics, rpc::RpcContext* context,
+                        bool profile = false) {
+  TraceMetrics* trace_metrics = context->trace()->metrics();
   metrics->set_cfile_cache_miss_bytes(
-    context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME));
+    trace_metrics->GetMetric(cfile::CFILE_CACHE_MISS_BYTES_METRIC_NAME));
   metrics->set_cfile_cache_hit_bytes(
-    context->trace()->metrics()->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
+    trace_metrics->GetMetric(cfile::CFILE_CACHE_HIT_BYTES_METRIC_NAME));
+  if (profile) {
+    metrics->set_queue_duration_nanos(context->GetTimeInQueue().ToNanoseconds());
+    // Only counted when the scanner is opened.
+    metrics->set_rowsets_scanned(trace_metrics->GetMetric("rowsets_scanned"));
+    metrics->set_rowsets_pruned(trace_metrics->GetMetric("rowsets_pruned"));
+    metrics->set_delta_stores_consulted(trace_metrics->GetMetric("delta_iterators_relevant"));
+  }
 }
 } // anonymous namespace
 
@@ -1048,26 +1495,107 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
     return;
   }
 
-  size_t batch_size_bytes = GetMaxBatchSizeBytesHint(req);
-  gscoped_ptr<faststring> rows_data(new faststring(batch_size_bytes * 11 / 10));
-  gscoped_ptr<faststring> indirect_data(new faststring(batch_size_bytes * 11 / 10));
+  if (RespondFromScanResultCache(req, resp, context)) {
+    return;
+  }
+
+  // Charge the result buffers to the scanners' memory budget. Under memory
+  // pressure the batch is shrunk or, failing that, the RPC is deferred by
+  // asking the client to retry later.
+  const size_t requested_batch_size_bytes = GetMaxBatchSizeBytesHint(req);
+  size_t batch_size_bytes = requested_batch_size_bytes;
+  int64_t reserved_bytes;
+  ScannerManager* scanner_manager = server_->scanner_manager();
+  if (PREDICT_FALSE(!scanner_manager->ReserveBatchMemory(&batch_size_bytes, &reserved_bytes))) {
+    SetupErrorAndRespond(resp->mutable_error(),
+                         Status::ServiceUnavailable("Deferring Scan request: scanner memory "
+                                                    "budget exhausted"),
+                         TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+  auto release_reservation = MakeScopedCleanup([&]() {
+      scanner_manager->ReleaseBatchMemory(reserved_bytes);
+    });
+  ScanRequestPB shrunk_req;
+  if (PREDICT_FALSE(batch_size_bytes < requested_batch_size_bytes)) {
+    TRACE("Reduced scan batch size to $0 bytes due to memory pressure", batch_size_bytes);
+    shrunk_req.CopyFrom(*req);
+    shrunk_req.set_batch_size_bytes(batch_size_bytes);
+    req = &shrunk_req;
+  }
+
+  // The layout of the results, and whether they're aggregated, is chosen
+  // when the scanner is opened. 'scanner' keeps the spec alive if the scan
+  // ends in this request.
+  bool columnar_layout = false;
+  const AggregateSpecPB* aggregate_spec = nullptr;
+  CompressionType sidecar_compression = NO_COMPRESSION;
+  bool profile = false;
+  SharedScanner scanner;
+  if (req->has_new_scan_request()) {
+    const NewScanRequestPB& scan_pb = req->new_scan_request();
+    columnar_layout = scan_pb.columnar_layout();
+    profile = scan_pb.profile();
+    if (scan_pb.has_aggregate_spec()) {
+      aggregate_spec = &scan_pb.aggregate_spec();
+    }
+    // HandleNewScanRequest() validates the compression type.
+    sidecar_compression = scan_pb.sidecar_compression();
+  } else if (req->has_scanner_id()) {
+    // If the scanner doesn't exist, HandleContinueScanRequest() reports it.
+    if (scanner_manager->LookupScanner(req->scanner_id(), &scanner)) {
+      columnar_layout = scanner->columnar_layout();
+      aggregate_spec = scanner->aggregate_spec();
+      sidecar_compression = scanner->sidecar_compression();
+      profile = scanner->profile_enabled();
+    }
+  }
+
+  gscoped_ptr<faststring> rows_data;
+  gscoped_ptr<faststring> indirect_data;
   RowwiseRowBlockPB data;
-  ScanResultCopier collector(&data, rows_data.get(), indirect_data.get());
+  gscoped_ptr<ScanResultCollector> collector;
+  ColumnarScanResultCopier* columnar_copier = nullptr;
+  ScanResultAggregator* aggregator = nullptr;
+  if (columnar_layout) {
+    columnar_copier = new ColumnarScanResultCopier();
+    collector.reset(columnar_copier);
+  } else {
+    rows_data.reset(new faststring(batch_size_bytes * 11 / 10));
+    indirect_data.reset(new faststring(batch_size_bytes * 11 / 10));
+    if (aggregate_spec) {
+      aggregator = new ScanResultAggregator(*aggregate_spec);
+      collector.reset(aggregator);
+    } else {
+      collector.reset(new ScanResultCopier(&data, rows_data.get(), indirect_data.get()));
+    }
+  }
 
   bool has_more_results = false;
   TabletServerErrorPB::Code error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+  // Set if the result of the scan may be cached, along with the tablet's
+  // schema version when the scan started.
+  ScanResultCache* result_cache = server_->scan_result_cache();
+  string result_cache_key;
+  scoped_refptr<TabletPeer> tablet_peer;
+  uint32_t schema_version = 0;
   if (req->has_new_scan_request()) {
     const NewScanRequestPB& scan_pb = req->new_scan_request();
-    scoped_refptr<TabletPeer> tablet_peer;
     if (!LookupTabletPeerOrRespond(server_->tablet_manager(), scan_pb.tablet_id(), resp, context,
                                    &tablet_peer)) {
       return;
     }
+    if (result_cache) {
+      schema_version = tablet_peer->tablet_metadata()->schema_version();
+      if (!ScanResultCache::MakeKey(scan_pb, schema_version, &result_cache_key)) {
+        result_cache_key.clear();
+      }
+    }
     string scanner_id;
     Timestamp scan_timestamp;
     Status s = HandleNewScanRequest(tablet_peer.get(), req, context,
-                                    &collector, &scanner_id, &scan_timestamp, &has_more_results,
-                                    &error_code);
+                                    collector.get(), &scanner_id, &scan_timestamp,
+                                    &has_more_results, &error_code, resp);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1081,7 +1609,8 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
       resp->set_snap_timestamp(scan_timestamp.ToUint64());
     }
   } else if (req->has_scanner_id()) {
-    Status s = HandleContinueScanRequest(req, &collector, &has_more_results, &error_code);
+    Status s = HandleContinueScanRequest(req, collector.get(), &has_more_results, &error_code,
+                                         resp);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1093,34 +1622,56 @@ void TabletServiceImpl::Scan(const ScanRequestPB* req,
   }
   resp->set_has_more_results(has_more_results);
 
-  DVLOG(2) << "Blocks processed: " << collector.BlocksProcessed();
-  if (collector.BlocksProcessed() > 0) {
-    resp->mutable_data()->CopyFrom(data);
-
-    // Add sidecar data to context and record the returned indices.
-    int rows_idx;
-    CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
-        new rpc::RpcSidecar(std::move(rows_data))), &rows_idx));
-    resp->mutable_data()->set_rows_sidecar(rows_idx);
-
-    // Add indirect data as a sidecar, if applicable.
-    if (indirect_data->size() > 0) {
-      int indirect_idx;
-      CHECK_OK(context->AddRpcSidecar(make_gscoped_ptr(
-          new rpc::RpcSidecar(std::move(indirect_data))), &indirect_idx));
-      resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+  DVLOG(2) << "Blocks processed: " << collector->BlocksProcessed();
+  if (collector->BlocksProcessed() > 0) {
+    if (aggregator) {
+      aggregator->SerializeResults(&data, rows_data.get(), indirect_data.get());
+    }
+    // Only the results returned in a single response are cached, and not if
+    // the schema changed during the scan.
+    if (!result_cache_key.empty() && !has_more_results &&
+        tablet_peer->tablet_metadata()->schema_version() == schema_version) {
+      result_cache->Insert(result_cache_key, data.num_rows(), Slice(*rows_data),
+                           Slice(*indirect_data), Slice(collector->last_primary_key()));
+    }
+    const CompressionCodec* codec = nullptr;
+    if (sidecar_compression != NO_COMPRESSION) {
+      CHECK_OK(GetCompressionCodec(sidecar_compression, &codec));
+      resp->set_sidecar_compression(sidecar_compression);
+    }
+    Status s;
+    if (columnar_copier) {
+      s = columnar_copier->AddSidecars(context, codec, resp->mutable_columnar_data());
+    } else {
+      resp->mutable_data()->CopyFrom(data);
+
+      // Add sidecar data to context and record the returned indices.
+      int rows_idx;
+      s = AddScanSidecar(context, codec, std::move(rows_data), &rows_idx);
+      resp->mutable_data()->set_rows_sidecar(rows_idx);
+
+      // Add indirect data as a sidecar, if applicable.
+      if (s.ok() && indirect_data->size() > 0) {
+        int indirect_idx;
+        s = AddScanSidecar(context, codec, std::move(indirect_data), &indirect_idx);
+        resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+      }
+    }
+    if (PREDICT_FALSE(!s.ok())) {
+      SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
+      return;
     }
 
     // Set the last row found by the collector.
     // We could have an empty batch if all the remaining rows are filtered by the predicate,
     // in which case do not set the last row.
-    const faststring& last = collector.last_primary_key();
+    const faststring& last = collector->last_primary_key();
     if (last.length() > 0) {
       resp->set_last_primary_key(last.ToString());
     }
   }
   resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
-  SetResourceMetrics(resp->mutable_resource_metrics(), context);
+  SetResourceMetrics(resp->mutable_resource_metrics(), context, profile);
   context->RespondSuccess();
 }
 
@@ -1168,6 +1719,11 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
   TabletServerErrorPB::Code error_code;
   if (req->has_new_request()) {
     scan_req.mutable_new_scan_request()->CopyFrom(req->new_request());
+    // Prefetched batches hold row-wise results, which the checksummer can't
+    // consume.
+    scan_req.mutable_new_scan_request()->clear_prefetch_next_batch();
+    // Checksum responses have no room for a scan profile.
+    scan_req.mutable_new_scan_request()->clear_profile();
     const NewScanRequestPB& new_req = req->new_request();
     scoped_refptr<TabletPeer> tablet_peer;
     if (!LookupTabletPeerOrRespond(server_->tablet_manager(), new_req.tablet_id(), resp, context,
@@ -1179,7 +1735,7 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
     Timestamp snap_timestamp;
     Status s = HandleNewScanRequest(tablet_peer.get(), &scan_req, context,
                                     &collector, &scanner_id, &snap_timestamp, &has_more,
-                                    &error_code);
+                                    &error_code, nullptr);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1192,7 +1748,8 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
     const ContinueChecksumRequestPB& continue_req = req->continue_request();
     collector.set_agg_checksum(continue_req.previous_checksum());
     scan_req.set_scanner_id(continue_req.scanner_id());
-    Status s = HandleContinueScanRequest(&scan_req, &collector, &has_more, &error_code);
+    Status s = HandleContinueScanRequest(&scan_req, &collector, &has_more, &error_code,
+                                         nullptr);
     if (PREDICT_FALSE(!s.ok())) {
       SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
       return;
@@ -1210,8 +1767,86 @@ void TabletServiceImpl::Checksum(const ChecksumRequestPB* req,
   context->RespondSuccess();
 }
 
+void TabletServiceImpl::SplitKeyRange(const SplitKeyRangeRequestPB* req,
+                                      SplitKeyRangeResponsePB* resp,
+                                      rpc::RpcContext* context) {
+  VLOG(1) << "Full request: " << SecureDebugString(*req);
+
+  if (PREDICT_FALSE(req->num_ranges() <= 0)) {
+    context->RespondFailure(Status::InvalidArgument(
+        Substitute("Invalid number of ranges: $0", req->num_ranges())));
+    return;
+  }
+
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
+                                 &tablet_peer)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  vector<string> split_keys;
+  s = tablet->SplitKeyRange(req->start_primary_key(), req->stop_primary_key(),
+                            req->num_ranges(), &split_keys);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+  for (string& key : split_keys) {
+    resp->add_split_keys()->swap(key);
+  }
+  context->RespondSuccess();
+}
+
+void TabletServiceImpl::GetColumnStatistics(const GetColumnStatisticsRequestPB* req,
+                                            GetColumnStatisticsResponsePB* resp,
+                                            rpc::RpcContext* context) {
+  VLOG(1) << "Full request: " << SecureDebugString(*req);
+
+  scoped_refptr<TabletPeer> tablet_peer;
+  if (!LookupTabletPeerOrRespond(server_->tablet_manager(), req->tablet_id(), resp, context,
+                                 &tablet_peer)) {
+    return;
+  }
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  Status s = GetTabletRef(tablet_peer, &tablet, &error_code);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, error_code, context);
+    return;
+  }
+
+  const Schema schema = *tablet->schema();
+  vector<ColumnStatistics> stats;
+  vector<bool> complete;
+  s = tablet->GetColumnStatistics(schema, &stats, &complete);
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return;
+  }
+  for (int i = 0; i < stats.size(); i++) {
+    GetColumnStatisticsResponsePB::ColumnPB* col = resp->add_columns();
+    col->set_name(schema.column(i).name());
+    col->set_type(schema.column(i).type_info()->type());
+    stats[i].ToPB(col->mutable_stats());
+    col->set_complete(complete[i]);
+  }
+  context->RespondSuccess();
+}
+
 bool TabletServiceImpl::SupportsFeature(uint32_t feature) const {
-  return feature == TabletServerFeatures::COLUMN_PREDICATES;
+  return feature == TabletServerFeatures::COLUMN_PREDICATES ||
+         feature == TabletServerFeatures::COLUMNAR_LAYOUT ||
+         feature == TabletServerFeatures::AGGREGATE_PUSHDOWN ||
+         feature == TabletServerFeatures::BLOOM_FILTER_PREDICATES ||
+         feature == TabletServerFeatures::COMPRESSED_SIDECARS ||
+         feature == TabletServerFeatures::ROW_OPERATIONS_IN_SIDECARS;
 }
 
 void TabletServiceImpl::Shutdown() {
@@ -1301,6 +1936,13 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
                             const SharedScanner& scanner) {
   gscoped_ptr<ScanSpec> ret(new ScanSpec);
   ret->set_cache_blocks(scan_pb.cache_blocks());
+  ret->set_cache_blocks_low_priority(scan_pb.cache_blocks_low_priority());
+  if (scan_pb.has_readahead_blocks()) {
+    ret->set_readahead_blocks(scan_pb.readahead_blocks());
+  }
+  if (scan_pb.has_limit()) {
+    ret->set_limit(std::min<uint64_t>(scan_pb.limit(), std::numeric_limits<int64_t>::max()));
+  }
 
   unordered_set<string> missing_col_names;
 
@@ -1361,6 +2003,21 @@ static Status SetupScanSpec(const NewScanRequestPB& scan_pb,
     }
   }
 
+  // The rows expired by the TTL column of the tablet are never returned, even
+  // before compactions drop them.
+  int ttl_col_idx = tablet_schema.find_ttl_column();
+  if (ttl_col_idx != Schema::kColumnNotFound) {
+    const ColumnSchema& col = tablet_schema.column(ttl_col_idx);
+    int64_t* cutoff = scanner->arena()->NewObject<int64_t>(
+        tablet::Tablet::GetExpirationCutoffMicros(col));
+    if (projection.find_column(col.name()) == Schema::kColumnNotFound &&
+        !ContainsKey(missing_col_names, col.name())) {
+      missing_cols->push_back(col);
+      InsertOrDie(&missing_col_names, col.name());
+    }
+    ret->AddPredicate(ColumnPredicate::Range(col, cutoff, nullptr));
+  }
+
   // When doing an ordered scan, we need to include the key columns to be able to encode
   // the last row key for the scan response.
   if (scan_pb.order_mode() == kudu::ORDERED &&
@@ -1401,6 +2058,86 @@ Status VerifyNotAncientHistory(Tablet* tablet, ReadMode read_mode, Timestamp tim
 }
 } // anonymous namespace
 
+bool TabletServiceImpl::RespondFromScanResultCache(const ScanRequestPB* req,
+                                                   ScanResponsePB* resp,
+                                                   rpc::RpcContext* context) {
+  ScanResultCache* result_cache = server_->scan_result_cache();
+  if (result_cache == nullptr || !req->has_new_scan_request() ||
+      (req->has_batch_size_bytes() && req->batch_size_bytes() == 0)) {
+    return false;
+  }
+  const NewScanRequestPB& scan_pb = req->new_scan_request();
+
+  // Any error is left to HandleNewScanRequest() to report.
+  scoped_refptr<TabletPeer> tablet_peer;
+  shared_ptr<Tablet> tablet;
+  TabletServerErrorPB::Code error_code;
+  if (!LookupRunningTabletPeer(server_->tablet_manager(), scan_pb.tablet_id(),
+                               &tablet_peer, &error_code).ok() ||
+      !GetTabletRef(tablet_peer, &tablet, &error_code).ok()) {
+    return false;
+  }
+  string key;
+  if (!ScanResultCache::MakeKey(scan_pb, tablet->metadata()->schema_version(), &key)) {
+    return false;
+  }
+  const CompressionCodec* codec = nullptr;
+  if (scan_pb.sidecar_compression() != NO_COMPRESSION) {
+    if (scan_pb.sidecar_compression() != LZ4 && scan_pb.sidecar_compression() != ZSTD) {
+      return false;
+    }
+    if (!GetCompressionCodec(scan_pb.sidecar_compression(), &codec).ok()) {
+      return false;
+    }
+  }
+  if (scan_pb.has_propagated_timestamp() &&
+      !server_->clock()->Update(Timestamp(scan_pb.propagated_timestamp())).ok()) {
+    return false;
+  }
+  // The history the result was read from may have been garbage collected
+  // since, in which case the scan must fail as it would have.
+  Timestamp snap_timestamp(scan_pb.snap_timestamp());
+  if (!VerifyNotAncientHistory(tablet.get(), READ_AT_SNAPSHOT, snap_timestamp).ok()) {
+    return false;
+  }
+
+  int64_t num_rows;
+  gscoped_ptr<faststring> rows_data(new faststring());
+  gscoped_ptr<faststring> indirect_data(new faststring());
+  string last_primary_key;
+  if (!result_cache->Lookup(key, GetMaxBatchSizeBytesHint(req), &num_rows, rows_data.get(),
+                            indirect_data.get(), &last_primary_key)) {
+    return false;
+  }
+  TRACE("Found $0 rows in the scan result cache", num_rows);
+
+  if (codec) {
+    resp->set_sidecar_compression(scan_pb.sidecar_compression());
+  }
+  resp->mutable_data()->set_num_rows(num_rows);
+  int rows_idx;
+  Status s = AddScanSidecar(context, codec, std::move(rows_data), &rows_idx);
+  resp->mutable_data()->set_rows_sidecar(rows_idx);
+  if (s.ok() && indirect_data->size() > 0) {
+    int indirect_idx;
+    s = AddScanSidecar(context, codec, std::move(indirect_data), &indirect_idx);
+    resp->mutable_data()->set_indirect_data_sidecar(indirect_idx);
+  }
+  if (PREDICT_FALSE(!s.ok())) {
+    SetupErrorAndRespond(resp->mutable_error(), s, TabletServerErrorPB::UNKNOWN_ERROR, context);
+    return true;
+  }
+  if (!last_primary_key.empty()) {
+    resp->set_last_primary_key(last_primary_key);
+  }
+  resp->set_has_more_results(false);
+  resp->set_snap_timestamp(snap_timestamp.ToUint64());
+  resp->set_propagated_timestamp(server_->clock()->Now().ToUint64());
+  SetResourceMetrics(resp->mutable_resource_metrics(), context);
+  context->RespondSuccess();
+  return true;
+}
+
 // Start a new scan.
 Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
                                                const ScanRequestPB* req,
@@ -1409,7 +2146,8 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
                                                std::string* scanner_id,
                                                Timestamp* snap_timestamp,
                                                bool* has_more_results,
-                                               TabletServerErrorPB::Code* error_code) {
+                                               TabletServerErrorPB::Code* error_code,
+                                               ScanResponsePB* profile_resp) {
   DCHECK(result_collector != nullptr);
   DCHECK(error_code != nullptr);
   DCHECK(req->has_new_scan_request());
@@ -1442,6 +2180,32 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     return Status::InvalidArgument("User requests should not have Column IDs");
   }
 
+  if (PREDICT_FALSE(scan_pb.sidecar_compression() != NO_COMPRESSION &&
+                    scan_pb.sidecar_compression() != LZ4 &&
+                    scan_pb.sidecar_compression() != ZSTD)) {
+    *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+    return Status::InvalidArgument("Unsupported sidecar compression",
+                                   CompressionType_Name(scan_pb.sidecar_compression()));
+  }
+
+  if (scan_pb.has_aggregate_spec()) {
+    if (scan_pb.columnar_layout()) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument("Aggregates can't be returned in the columnar layout");
+    }
+    if (scan_pb.has_limit()) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return Status::InvalidArgument("A limit can't be combined with aggregates");
+    }
+    // Check the spec now: the scan result collector can't report errors.
+    gscoped_ptr<ScanAggregator> aggregator;
+    s = ScanAggregator::Create(scan_pb.aggregate_spec(), &projection, &aggregator);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::INVALID_SCAN_SPEC;
+      return s;
+    }
+  }
+
   if (scan_pb.order_mode() == ORDERED) {
     // Ordered scans must be at a snapshot so that we perform a serializable read (which can be
     // resumed). Otherwise, this would be read committed isolation, which is not resumable.
@@ -1476,6 +2240,16 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
   // Store the original projection.
   gscoped_ptr<Schema> orig_projection(new Schema(projection));
   scanner->set_client_projection_schema(std::move(orig_projection));
+  scanner->set_columnar_layout(scan_pb.columnar_layout());
+  if (scan_pb.has_aggregate_spec()) {
+    scanner->set_aggregate_spec(make_gscoped_ptr(new AggregateSpecPB(scan_pb.aggregate_spec())));
+  }
+  scanner->set_sidecar_compression(scan_pb.sidecar_compression());
+  // Only row-wise results of plain scans may be prefetched.
+  scanner->set_prefetch_enabled(scan_pb.prefetch_next_batch() &&
+                                !scan_pb.columnar_layout() &&
+                                !scan_pb.has_aggregate_spec());
+  scanner->set_profile_enabled(scan_pb.profile());
 
   // Build a new projection with the projection columns and the missing columns. Make
   // sure to set whether the column is a key column appropriately.
@@ -1528,6 +2302,35 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     }
   }
 
+  // Scans which count all the rows of the tablet are answered right away,
+  // without creating a server-side scanner.
+  if (PREDICT_TRUE(s.ok()) && FLAGS_scanner_count_rows_from_metadata &&
+      scan_pb.has_aggregate_spec() &&
+      ScanAggregator::CountsRowsOnly(scan_pb.aggregate_spec()) &&
+      spec->predicates().empty() && !spec->lower_bound_key() &&
+      !spec->exclusive_upper_bound_key()) {
+    TRACE("Counting rows");
+    uint64_t num_rows;
+    int num_rowsets_iterated;
+    s = tablet->CountLiveRows(down_cast<Tablet::Iterator*>(iter.get())->snapshot(),
+                              &num_rows, &num_rowsets_iterated);
+    if (PREDICT_FALSE(!s.ok())) {
+      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+      return s;
+    }
+    TRACE("Counted $0 rows, iterating over $1 rowsets", num_rows, num_rowsets_iterated);
+    s = VerifyNotAncientHistory(tablet.get(), scan_pb.read_mode(), *snap_timestamp);
+    if (!s.ok()) {
+      *error_code = TabletServerErrorPB::INVALID_SNAPSHOT;
+      return s;
+    }
+    if (num_rows > 0) {
+      result_collector->HandleRowCount(scanner->client_projection_schema(), num_rows);
+    }
+    *has_more_results = false;
+    return Status::OK();
+  }
+
   // Make a copy of the optimized spec before it's passed to the iterator.
   // This copy will be given to the Scanner so it can report its predicates to
   // /scans. The copy is necessary because the original spec will be modified
@@ -1603,7 +2406,7 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
     ScanRequestPB continue_req(*req);
     continue_req.set_scanner_id(scanner->id());
     RETURN_NOT_OK(HandleContinueScanRequest(&continue_req, result_collector, has_more_results,
-                                            error_code));
+                                            error_code, profile_resp));
   } else {
     // Increment the scanner call sequence ID. HandleContinueScanRequest handles
     // this in the non-empty scan case.
@@ -1612,11 +2415,147 @@ Status TabletServiceImpl::HandleNewScanRequest(TabletPeer* tablet_peer,
   return Status::OK();
 }
 
+namespace {
+
+// Reads the next rows of 'scanner' into 'result_collector', until the
+// collector buffers 'batch_size_bytes', the scan ends, or the time budget of
+// a batch runs out. Sets '*rows_scanned' to the number of rows read,
+// regardless of predicates or deletions, and '*serialize_nanos' to the time
+// spent passing them to the collector.
+Status ScanNextBatch(Scanner* scanner,
+                     size_t batch_size_bytes,
+                     ScanResultCollector* result_collector,
+                     int64_t* rows_scanned,
+                     int64_t* serialize_nanos) {
+  RowwiseIterator* iter = scanner->iter();
+
+  // TODO: could size the RowBlock based on the user's requested batch size?
+  // If people had really large indirect objects, we would currently overshoot
+  // their requested batch size by a lot.
+  Arena arena(32 * 1024, 1 * 1024 * 1024);
+  RowBlock block(iter->schema(), FLAGS_scanner_batch_size_rows, &arena);
+
+  // TODO: in the future, use the client timeout to set a budget. For now,
+  // just use a half second, which should be plenty to amortize call overhead.
+  int budget_ms = 500;
+  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(budget_ms);
+
+  *rows_scanned = 0;
+  *serialize_nanos = 0;
+  while (iter->HasNext()) {
+    if (PREDICT_FALSE(FLAGS_scanner_inject_latency_on_each_batch_ms > 0)) {
+      SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
+    }
+
+    RETURN_NOT_OK(iter->NextBlock(&block));
+
+    if (PREDICT_TRUE(block.nrows() > 0)) {
+      // Count the number of rows scanned, regardless of predicates or deletions.
+      // The collector will separately count the number of rows actually returned to
+      // the client.
+      *rows_scanned += block.nrows();
+      MonoTime start = MonoTime::Now();
+      result_collector->HandleRowBlock(scanner->client_projection_schema(), block);
+      *serialize_nanos += (MonoTime::Now() - start).ToNanoseconds();
+    }
+
+    int64_t response_size = result_collector->ResponseSize();
+
+    if (VLOG_IS_ON(2)) {
+      // This may be fairly expensive if row block size is small
+      TRACE("Copied block (nrows=$0), new size=$1", block.nrows(), response_size);
+    }
+
+    // TODO: should check if RPC got cancelled, once we implement RPC cancellation.
+    if (PREDICT_FALSE(MonoTime::Now() >= deadline)) {
+      TRACE("Deadline expired - responding early");
+      break;
+    }
+
+    if (response_size >= batch_size_bytes) {
+      break;
+    }
+  }
+  return Status::OK();
+}
+
+// Builds the next batch of 'scanner' on the scan prefetch thread pool, for its
+// next continuation RPC to return. The batch is charged to the scanners'
+// memory budget, and isn't built at all if the budget can't cover it.
+void PrefetchNextBatch(ScannerManager* scanner_manager,
+                       const SharedScanner& scanner,
+                       size_t batch_size_bytes) {
+  int64_t reserved_bytes;
+  if (!scanner_manager->ReserveBatchMemory(&batch_size_bytes, &reserved_bytes)) {
+    TRACE("Not prefetching the next batch: scanner memory budget exhausted");
+    return;
+  }
+  shared_ptr<PrefetchedScanBatch> batch(
+      new PrefetchedScanBatch(scanner_manager, reserved_bytes));
+  batch->rows_data.reserve(batch_size_bytes * 11 / 10);
+  batch->indirect_data.reserve(batch_size_bytes * 11 / 10);
+
+  scanner->StartPrefetch();
+  Status s = scanner_manager->SubmitPrefetch([scanner, batch, batch_size_bytes]() {
+      ScanResultCopier copier(&batch->data, &batch->rows_data, &batch->indirect_data);
+      batch->status = ScanNextBatch(scanner.get(), batch_size_bytes, &copier,
+                                    &batch->rows_scanned, &batch->serialize_nanos);
+      batch->blocks_processed = copier.BlocksProcessed();
+      batch->num_rows_returned = copier.NumRowsReturned();
+      batch->last_primary_key.assign_copy(copier.last_primary_key().data(),
+                                          copier.last_primary_key().size());
+      scanner->FinishPrefetch(batch);
+    });
+  if (PREDICT_FALSE(!s.ok())) {
+    LOG(WARNING) << "Unable to prefetch the next batch of scanner " << scanner->id()
+                 << ": " << s.ToString();
+    scanner->FinishPrefetch(nullptr);
+  }
+}
+
+// Sets in 'resp' the profile of the rows scanned by 'scanner' since its
+// previous response, given the per-column stats of its iterator 'stats' and
+// the time spent serializing the rows.
+void SetScanProfile(const Scanner& scanner,
+                    const vector<IteratorStats>& stats,
+                    int64_t serialize_nanos,
+                    ScanResponsePB* resp) {
+  const Schema& schema = scanner.iter()->schema();
+  DCHECK_EQ(stats.size(), schema.num_columns());
+  const vector<IteratorStats>& prev_stats = scanner.already_profiled_stats();
+  IteratorStats total_stats;
+  for (size_t i = 0; i < stats.size(); i++) {
+    IteratorStats col_stats = stats[i];
+    if (i < prev_stats.size()) {
+      col_stats.SubtractStats(prev_stats[i]);
+    }
+    total_stats.AddStats(col_stats);
+
+    ColumnScanProfilePB* col_profile = resp->add_column_profiles();
+    col_profile->set_column_name(schema.column(i).name());
+    col_profile->set_data_blocks_decoded(col_stats.data_blocks_read_from_disk);
+    col_profile->set_data_blocks_skipped(col_stats.data_blocks_skipped);
+    col_profile->set_cells_read(col_stats.cells_read_from_disk);
+    col_profile->set_predicate_rows_evaluated(col_stats.predicate_rows_evaluated);
+    col_profile->set_predicate_rows_passed(col_stats.predicate_rows_passed);
+  }
+
+  ResourceMetricsPB* metrics = resp->mutable_resource_metrics();
+  metrics->set_data_blocks_decoded(total_stats.data_blocks_read_from_disk);
+  metrics->set_data_blocks_skipped(total_stats.data_blocks_skipped);
+  metrics->set_predicate_eval_nanos(total_stats.predicate_eval_nanos);
+  metrics->set_materialize_nanos(total_stats.materialize_nanos);
+  metrics->set_serialize_nanos(serialize_nanos);
+}
+
+} // anonymous namespace
+
 // Continue an existing scan request.
 Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
                                                     ScanResultCollector* result_collector,
                                                     bool* has_more_results,
-                                                    TabletServerErrorPB::Code* error_code) {
+                                                    TabletServerErrorPB::Code* error_code,
+                                                    ScanResponsePB* profile_resp) {
   DCHECK(req->has_scanner_id());
   TRACE_EVENT1("tserver", "TabletServiceImpl::HandleContinueScanRequest",
                "scanner_id", req->scanner_id());
@@ -1656,59 +2595,35 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   scanner->IncrementCallSeqId();
   scanner->UpdateAccessTime();
 
-  RowwiseIterator* iter = scanner->iter();
-
-  // TODO: could size the RowBlock based on the user's requested batch size?
-  // If people had really large indirect objects, we would currently overshoot
-  // their requested batch size by a lot.
-  Arena arena(32 * 1024, 1 * 1024 * 1024);
-  RowBlock block(scanner->iter()->schema(),
-                 FLAGS_scanner_batch_size_rows, &arena);
-
-  // TODO: in the future, use the client timeout to set a budget. For now,
-  // just use a half second, which should be plenty to amortize call overhead.
-  int budget_ms = 500;
-  MonoTime deadline = MonoTime::Now() + MonoDelta::FromMilliseconds(budget_ms);
-
+  // Return the batch prefetched after the previous RPC, if any. Otherwise,
+  // scan the next batch now.
   int64_t rows_scanned = 0;
-  while (iter->HasNext()) {
-    if (PREDICT_FALSE(FLAGS_scanner_inject_latency_on_each_batch_ms > 0)) {
-      SleepFor(MonoDelta::FromMilliseconds(FLAGS_scanner_inject_latency_on_each_batch_ms));
-    }
-
-    Status s = iter->NextBlock(&block);
-    if (PREDICT_FALSE(!s.ok())) {
-      LOG(WARNING) << "Copying rows from internal iterator for request "
-                   << SecureShortDebugString(*req);
-      *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
-      return s;
-    }
-
-    if (PREDICT_TRUE(block.nrows() > 0)) {
-      // Count the number of rows scanned, regardless of predicates or deletions.
-      // The collector will separately count the number of rows actually returned to
-      // the client.
-      rows_scanned += block.nrows();
-      result_collector->HandleRowBlock(scanner->client_projection_schema(), block);
-    }
-
-    int64_t response_size = result_collector->ResponseSize();
-
-    if (VLOG_IS_ON(2)) {
-      // This may be fairly expensive if row block size is small
-      TRACE("Copied block (nrows=$0), new size=$1", block.nrows(), response_size);
-    }
-
-    // TODO: should check if RPC got cancelled, once we implement RPC cancellation.
-    if (PREDICT_FALSE(MonoTime::Now() >= deadline)) {
-      TRACE("Deadline expired - responding early");
-      break;
-    }
-
-    if (response_size >= batch_size_bytes) {
-      break;
+  int64_t serialize_nanos = 0;
+  Status scan_status;
+  shared_ptr<PrefetchedScanBatch> prefetched_batch;
+  if (scanner->prefetch_enabled()) {
+    prefetched_batch = scanner->TakePrefetchedBatch();
+  }
+  if (prefetched_batch) {
+    TRACE("Returning prefetched batch");
+    scan_status = prefetched_batch->status;
+    if (scan_status.ok()) {
+      rows_scanned = prefetched_batch->rows_scanned;
+      serialize_nanos = prefetched_batch->serialize_nanos;
+      result_collector->HandlePrefetchedBatch(*prefetched_batch);
     }
+    prefetched_batch.reset();
+  } else {
+    scan_status = ScanNextBatch(scanner.get(), batch_size_bytes, result_collector, &rows_scanned,
+                                &serialize_nanos);
+  }
+  if (PREDICT_FALSE(!scan_status.ok())) {
+    LOG(WARNING) << "Copying rows from internal iterator for request "
+                 << SecureShortDebugString(*req);
+    *error_code = TabletServerErrorPB::UNKNOWN_ERROR;
+    return scan_status;
   }
+  RowwiseIterator* iter = scanner->iter();
 
   scoped_refptr<TabletPeer> tablet_peer = scanner->tablet_peer();
   shared_ptr<Tablet> tablet;
@@ -1748,6 +2663,11 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   delta_stats.SubtractStats(scanner->already_reported_stats());
   scanner->set_already_reported_stats(total_stats);
 
+  if (profile_resp != nullptr && scanner->profile_enabled()) {
+    SetScanProfile(*scanner, stats_by_col, serialize_nanos, profile_resp);
+    scanner->set_already_profiled_stats(std::move(stats_by_col));
+  }
+
   if (tablet) {
     tablet->metrics()->scanner_rows_scanned->IncrementBy(
         rows_scanned);
@@ -1760,6 +2680,11 @@ Status TabletServiceImpl::HandleContinueScanRequest(const ScanRequestPB* req,
   scanner->UpdateAccessTime();
   *has_more_results = !req->close_scanner() && iter->HasNext();
   if (*has_more_results) {
+    // Overlap building the next batch with returning this one, and with
+    // whatever the client does with it.
+    if (scanner->prefetch_enabled()) {
+      PrefetchNextBatch(server_->scanner_manager(), scanner, batch_size_bytes);
+    }
     unreg_scanner.Cancel();
   } else {
     VLOG(2) << "Scanner " << scanner->id() << " complete: removing...";
@@ -1799,11 +2724,21 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
   }
 
   Timestamp tmp_snap_timestamp;
+  scoped_refptr<consensus::TimeManager> time_manager = tablet_peer->time_manager();
 
   // If the client provided no snapshot timestamp we take the current clock
-  // time as the snapshot timestamp.
+  // time as the snapshot timestamp, or our safe time if it's recent enough
+  // for the client.
   if (!scan_pb.has_snap_timestamp()) {
     tmp_snap_timestamp = server_->clock()->Now();
+    if (scan_pb.has_max_staleness_ms() && server_->clock()->HasPhysicalComponent()) {
+      Timestamp safe_time = time_manager->GetSafeTime();
+      MonoDelta staleness = server_->clock()->GetPhysicalComponentDifference(
+          tmp_snap_timestamp, safe_time);
+      if (staleness.ToMilliseconds() <= scan_pb.max_staleness_ms()) {
+        tmp_snap_timestamp = std::min(tmp_snap_timestamp, safe_time);
+      }
+    }
   // ... else we use the client provided one, but make sure it is not too far
   // in the future as to be invalid.
   } else {
@@ -1836,7 +2771,6 @@ Status TabletServiceImpl::HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
 
   tablet::MvccSnapshot snap;
   Tablet* tablet = tablet_peer->tablet();
-  scoped_refptr<consensus::TimeManager> time_manager = tablet_peer->time_manager();
   tablet::MvccManager* mvcc_manager = tablet->mvcc_manager();
 
   // Reduce the client's deadline by a few msecs to allow for overhead.
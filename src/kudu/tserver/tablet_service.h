@@ -35,6 +35,7 @@ class Timestamp;
 namespace tablet {
 class Tablet;
 class TabletPeer;
+class TransactionCompletionCallback;
 class TransactionState;
 } // namespace tablet
 
@@ -55,6 +56,10 @@ class TabletServiceImpl : public TabletServerServiceIf {
   virtual void Write(const WriteRequestPB* req, WriteResponsePB* resp,
                    rpc::RpcContext* context) OVERRIDE;
 
+  void MultiTabletWrite(const MultiTabletWriteRequestPB* req,
+                        MultiTabletWriteResponsePB* resp,
+                        rpc::RpcContext* context) override;
+
   virtual void Scan(const ScanRequestPB* req,
                     ScanResponsePB* resp,
                     rpc::RpcContext* context) OVERRIDE;
@@ -71,11 +76,39 @@ class TabletServiceImpl : public TabletServerServiceIf {
                         ChecksumResponsePB* resp,
                         rpc::RpcContext* context) OVERRIDE;
 
+  virtual void SplitKeyRange(const SplitKeyRangeRequestPB* req,
+                             SplitKeyRangeResponsePB* resp,
+                             rpc::RpcContext* context) OVERRIDE;
+
+  virtual void GetColumnStatistics(const GetColumnStatisticsRequestPB* req,
+                                   GetColumnStatisticsResponsePB* resp,
+                                   rpc::RpcContext* context) OVERRIDE;
+
   bool SupportsFeature(uint32_t feature) const override;
 
   virtual void Shutdown() OVERRIDE;
 
  private:
+  // Checks the write 'req' and submits it to its tablet, to be completed
+  // with 'callback'. The rows may be in the sidecars of 'context', and
+  // 'request_id', if not null, tracks the write for exactly-once semantics.
+  //
+  // Returns a bad status, with 'error_code' set, if the write couldn't be
+  // submitted, in which case 'callback' is never called.
+  Status SubmitWriteRequest(const WriteRequestPB* req,
+                            WriteResponsePB* resp,
+                            rpc::RpcContext* context,
+                            const rpc::RequestIdPB* request_id,
+                            gscoped_ptr<tablet::TransactionCompletionCallback> callback,
+                            TabletServerErrorPB::Code* error_code);
+
+  // Responds to the new scan 'req' with its result if it is in the scan
+  // result cache. Returns false, without responding, if it isn't, or if the
+  // request must go through HandleNewScanRequest() for any other reason.
+  bool RespondFromScanResultCache(const ScanRequestPB* req,
+                                  ScanResponsePB* resp,
+                                  rpc::RpcContext* context);
+
   Status HandleNewScanRequest(tablet::TabletPeer* tablet_peer,
                               const ScanRequestPB* req,
                               const rpc::RpcContext* rpc_context,
@@ -83,12 +116,16 @@ class TabletServiceImpl : public TabletServerServiceIf {
                               std::string* scanner_id,
                               Timestamp* snap_timestamp,
                               bool* has_more_results,
-                              TabletServerErrorPB::Code* error_code);
+                              TabletServerErrorPB::Code* error_code,
+                              ScanResponsePB* profile_resp);
 
+  // If 'profile_resp' isn't null and the scanner profiles its scan, the
+  // profile of the rows scanned for the request is set in it.
   Status HandleContinueScanRequest(const ScanRequestPB* req,
                                    ScanResultCollector* result_collector,
                                    bool* has_more_results,
-                                   TabletServerErrorPB::Code* error_code);
+                                   TabletServerErrorPB::Code* error_code,
+                                   ScanResponsePB* profile_resp);
 
   Status HandleScanAtSnapshot(const NewScanRequestPB& scan_pb,
                               const rpc::RpcContext* rpc_context,
@@ -107,6 +144,10 @@ class TabletServiceAdminImpl : public TabletServerAdminServiceIf {
                             CreateTabletResponsePB* resp,
                             rpc::RpcContext* context) OVERRIDE;
 
+  virtual void CreateTablets(const CreateTabletsRequestPB* req,
+                             CreateTabletsResponsePB* resp,
+                             rpc::RpcContext* context) OVERRIDE;
+
   virtual void DeleteTablet(const DeleteTabletRequestPB* req,
                             DeleteTabletResponsePB* resp,
                             rpc::RpcContext* context) OVERRIDE;
@@ -127,10 +168,16 @@ class ConsensusServiceImpl : public consensus::ConsensusServiceIf {
 
   virtual ~ConsensusServiceImpl();
 
+  bool SupportsFeature(uint32_t feature) const override;
+
   virtual void UpdateConsensus(const consensus::ConsensusRequestPB *req,
                                consensus::ConsensusResponsePB *resp,
                                rpc::RpcContext *context) OVERRIDE;
 
+  virtual void MultiRaftUpdateConsensus(const consensus::MultiRaftConsensusRequestPB* req,
+                                        consensus::MultiRaftConsensusResponsePB* resp,
+                                        rpc::RpcContext* context) OVERRIDE;
+
   virtual void RequestConsensusVote(const consensus::VoteRequestPB* req,
                                     consensus::VoteResponsePB* resp,
                                     rpc::RpcContext* context) OVERRIDE;
@@ -30,6 +30,7 @@
 #include "kudu/tserver/heartbeater.h"
 #include "kudu/tserver/mini_tablet_server.h"
 #include "kudu/tserver/tablet_server.h"
+#include "kudu/util/metrics.h"
 #include "kudu/util/pb_util.h"
 #include "kudu/util/test_util.h"
 
@@ -39,6 +40,9 @@
 #define ASSERT_MONOTONIC_REPORT_SEQNO(report_seqno, tablet_report) \
   ASSERT_NO_FATAL_FAILURE(AssertMonotonicReportSeqno(report_seqno, tablet_report))
 
+METRIC_DECLARE_gauge_int32(tablets_to_open_at_startup);
+METRIC_DECLARE_gauge_int32(tablets_opening_at_startup);
+
 namespace kudu {
 namespace tserver {
 
@@ -144,6 +148,12 @@ TEST_F(TsTabletManagerTest, TestCreateTablet) {
   // Ensure that the tablet got re-loaded and re-opened off disk.
   ASSERT_TRUE(tablet_manager_->LookupTablet(kTabletId, &peer));
   ASSERT_EQ(kTabletId, peer->tablet()->tablet_id());
+
+  // The progress of opening the tablets is exported.
+  ASSERT_OK(tablet_manager_->WaitForAllBootstrapsToFinish());
+  const scoped_refptr<MetricEntity>& entity = mini_server_->server()->metric_entity();
+  ASSERT_EQ(1, METRIC_tablets_to_open_at_startup.Instantiate(entity, 0)->value());
+  ASSERT_EQ(0, METRIC_tablets_opening_at_startup.Instantiate(entity, 0)->value());
 }
 
 static void AssertMonotonicReportSeqno(int64_t* report_seqno,
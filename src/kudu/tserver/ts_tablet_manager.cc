@@ -30,10 +30,12 @@
 #include "kudu/consensus/consensus_meta.h"
 #include "kudu/consensus/log.h"
 #include "kudu/consensus/metadata.pb.h"
+#include "kudu/consensus/multi_raft_batcher.h"
 #include "kudu/consensus/opid_util.h"
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/fs/fs_manager.h"
 #include "kudu/gutil/casts.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/strings/util.h"
 #include "kudu/master/master.pb.h"
@@ -66,9 +68,9 @@ TAG_FLAG(num_tablets_to_copy_simultaneously, advanced);
 DEFINE_int32(num_tablets_to_open_simultaneously, 0,
              "Number of threads available to open tablets during startup. If this "
              "is set to 0 (the default), then the number of bootstrap threads will "
-             "be set based on the number of data directories. If the data directories "
-             "are on some very fast storage device such as SSD or a RAID array, it "
-             "may make sense to manually tune this.");
+             "be set based on the number of data directories and of CPU cores. If "
+             "the data directories are on some very fast storage device such as SSD "
+             "or a RAID array, it may make sense to manually tune this.");
 TAG_FLAG(num_tablets_to_open_simultaneously, advanced);
 
 DEFINE_int32(tablet_start_warn_threshold_ms, 500,
@@ -116,14 +118,24 @@ METRIC_DEFINE_histogram(server, op_apply_queue_time, "Operation Apply Queue Time
                         "Time that operations spent waiting in the apply queue before being "
                         "processed. High queue times indicate that the server is unable to "
                         "process operations as fast as they are being written to the WAL.",
-                        10000000, 2);
+                        10000000, 2, STRIPED_HISTOGRAM);
 
 METRIC_DEFINE_histogram(server, op_apply_run_time, "Operation Apply Run Time",
                         MetricUnit::kMicroseconds,
                         "Time that operations spent being applied to the tablet. "
                         "High values may indicate that the server is under-provisioned or "
                         "that operations consist of very large batches.",
-                        10000000, 2);
+                        10000000, 2, STRIPED_HISTOGRAM);
+
+METRIC_DEFINE_gauge_int32(server, tablets_to_open_at_startup, "Tablets To Open At Startup",
+                          MetricUnit::kTablets,
+                          "Number of tablets found when the server started, which it "
+                          "opens before serving them.");
+
+METRIC_DEFINE_gauge_int32(server, tablets_opening_at_startup, "Tablets Opening At Startup",
+                          MetricUnit::kTablets,
+                          "Number of the tablets found when the server started which "
+                          "are yet to be opened.");
 
 using consensus::ConsensusMetadata;
 using consensus::ConsensusStatePB;
@@ -152,13 +164,59 @@ using tablet::TabletStatusListener;
 using tablet::TabletStatusPB;
 using tserver::TabletCopyClient;
 
+namespace {
+
+// The order in which the tablets found at startup are opened.
+struct TabletOpenOrder {
+  // Whether the replica voted for itself in its last term, i.e. probably was
+  // its leader, or recorded the projections scanned the most. Such replicas
+  // are the most likely to be waited on.
+  bool active;
+
+  // The size of the WAL to replay, which the bootstrap time grows with.
+  uint64_t wal_bytes;
+
+  bool operator<(const TabletOpenOrder& other) const {
+    if (active != other.active) {
+      return active;
+    }
+    return wal_bytes < other.wal_bytes;
+  }
+};
+
+// Returns the order in which the tablet of 'meta' is opened at startup.
+TabletOpenOrder GetTabletOpenOrder(FsManager* fs_manager,
+                                   const scoped_refptr<TabletMetadata>& meta) {
+  const string& tablet_id = meta->tablet_id();
+  TabletOpenOrder order;
+
+  // Only the term and vote of a replica are persisted, not its leader.
+  unique_ptr<ConsensusMetadata> cmeta;
+  bool voted_for_self =
+      ConsensusMetadata::Load(fs_manager, tablet_id, fs_manager->uuid(), &cmeta).ok() &&
+      cmeta->has_voted_for() && cmeta->voted_for() == fs_manager->uuid();
+  order.active = voted_for_self || !meta->hot_projections().empty();
+
+  // The WAL directory doesn't exist if the tablet never wrote to it.
+  order.wal_bytes = 0;
+  string wal_dir = fs_manager->GetTabletWalDir(tablet_id);
+  if (fs_manager->env()->FileExists(wal_dir)) {
+    WARN_NOT_OK(fs_manager->env()->GetFileSizeOnDiskRecursively(wal_dir, &order.wal_bytes),
+                Substitute("Unable to get the size of the WAL of tablet $0", tablet_id));
+  }
+  return order;
+}
+
+} // anonymous namespace
+
 TSTabletManager::TSTabletManager(FsManager* fs_manager,
                                  TabletServer* server,
                                  MetricRegistry* metric_registry)
   : fs_manager_(fs_manager),
     server_(server),
     metric_registry_(metric_registry),
-    state_(MANAGER_INITIALIZING) {
+    state_(MANAGER_INITIALIZING),
+    num_tablets_opened_at_startup_(0) {
 
   CHECK_OK(ThreadPoolBuilder("apply").Build(&apply_pool_));
   apply_pool_->SetQueueLengthHistogram(
@@ -188,13 +246,18 @@ Status TSTabletManager::Init() {
   // FsManager isn't initialized until this point.
   int max_open_threads = FLAGS_num_tablets_to_open_simultaneously;
   if (max_open_threads == 0) {
-    // Default to the number of disks.
-    max_open_threads = fs_manager_->GetDataRootDirs().size();
+    // Bootstrapping alternates between reading from disk and replaying on the
+    // CPU, so default to two threads per disk, within the number of cores but
+    // no fewer than one thread per disk.
+    int num_dirs = fs_manager_->GetDataRootDirs().size();
+    max_open_threads = std::max(num_dirs, std::min(2 * num_dirs, base::NumCPUs()));
   }
   RETURN_NOT_OK(ThreadPoolBuilder("tablet-open")
                 .set_max_threads(max_open_threads)
                 .Build(&open_tablet_pool_));
 
+  multi_raft_manager_.reset(new consensus::MultiRaftManager(server_->messenger()));
+
   // Search for tablets in the metadata dir.
   vector<string> tablet_ids;
   RETURN_NOT_OK(fs_manager_->ListTabletIds(&tablet_ids));
@@ -217,8 +280,28 @@ Status TSTabletManager::Init() {
     metas.push_back(meta);
   }
 
-  // Now submit the "Open" task for each.
+  // Open the tablets most likely to be waited on first, and among them the
+  // quickest to bootstrap.
+  vector<std::pair<TabletOpenOrder, scoped_refptr<TabletMetadata>>> ordered_metas;
+  ordered_metas.reserve(metas.size());
   for (const scoped_refptr<TabletMetadata>& meta : metas) {
+    ordered_metas.emplace_back(GetTabletOpenOrder(fs_manager_, meta), meta);
+  }
+  std::stable_sort(ordered_metas.begin(), ordered_metas.end(),
+                   [](const std::pair<TabletOpenOrder, scoped_refptr<TabletMetadata>>& a,
+                      const std::pair<TabletOpenOrder, scoped_refptr<TabletMetadata>>& b) {
+                     return a.first < b.first;
+                   });
+
+  int num_tablets = ordered_metas.size();
+  tablets_to_open_at_startup_ =
+      METRIC_tablets_to_open_at_startup.Instantiate(server_->metric_entity(), num_tablets);
+  tablets_opening_at_startup_ =
+      METRIC_tablets_opening_at_startup.Instantiate(server_->metric_entity(), num_tablets);
+
+  // Now submit the "Open" task for each.
+  for (const auto& entry : ordered_metas) {
+    const scoped_refptr<TabletMetadata>& meta = entry.second;
     scoped_refptr<TransitionInProgressDeleter> deleter;
     {
       std::lock_guard<rw_spinlock> lock(lock_);
@@ -226,8 +309,12 @@ Status TSTabletManager::Init() {
     }
 
     scoped_refptr<TabletPeer> tablet_peer = CreateAndRegisterTabletPeer(meta, NEW_PEER);
-    RETURN_NOT_OK(open_tablet_pool_->SubmitFunc(boost::bind(&TSTabletManager::OpenTablet,
-                                                this, meta, deleter)));
+    RETURN_NOT_OK(open_tablet_pool_->SubmitFunc([this, meta, deleter, num_tablets]() {
+          OpenTablet(meta, deleter);
+          tablets_opening_at_startup_->Decrement();
+          LOG(INFO) << Substitute("Opened $0 of the $1 tablets found at startup",
+                                  num_tablets_opened_at_startup_.Increment(), num_tablets);
+        }));
   }
 
   {
@@ -759,7 +846,8 @@ void TSTabletManager::OpenTablet(const scoped_refptr<TabletMetadata>& meta,
                            server_->messenger(),
                            server_->result_tracker(),
                            log,
-                           tablet->GetMetricEntity());
+                           tablet->GetMetricEntity(),
+                           multi_raft_manager_.get());
 
     if (!s.ok()) {
       LOG(ERROR) << LogPrefix(tablet_id) << "Tablet failed to init: "
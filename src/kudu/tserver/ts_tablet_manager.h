@@ -30,6 +30,7 @@
 #include "kudu/tserver/tablet_peer_lookup.h"
 #include "kudu/tserver/tserver_admin.pb.h"
 #include "kudu/tserver/tserver.pb.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/status.h"
@@ -44,6 +45,7 @@ class Partition;
 class Schema;
 
 namespace consensus {
+class MultiRaftManager;
 class RaftConfigPB;
 } // namespace consensus
 
@@ -315,9 +317,17 @@ class TSTabletManager : public tserver::TabletPeerLookupIf {
   // Thread pool used to open the tablets async, whether bootstrap is required or not.
   gscoped_ptr<ThreadPool> open_tablet_pool_;
 
+  // Progress of opening the tablets found at startup.
+  scoped_refptr<AtomicGauge<int32_t>> tablets_to_open_at_startup_;
+  scoped_refptr<AtomicGauge<int32_t>> tablets_opening_at_startup_;
+  AtomicInt<int32_t> num_tablets_opened_at_startup_;
+
   // Thread pool for apply transactions, shared between all tablets.
   gscoped_ptr<ThreadPool> apply_pool_;
 
+  // Batches the heartbeats of the tablets led by this server.
+  std::unique_ptr<consensus::MultiRaftManager> multi_raft_manager_;
+
   DISALLOW_COPY_AND_ASSIGN(TSTabletManager);
 };
 
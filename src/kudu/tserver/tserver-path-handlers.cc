@@ -18,12 +18,14 @@
 #include "kudu/tserver/tserver-path-handlers.h"
 
 #include <algorithm>
+#include <map>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <vector>
 
 #include "kudu/common/scan_spec.h"
+#include "kudu/consensus/consensus_queue.h"
 #include "kudu/consensus/log_anchor_registry.h"
 #include "kudu/consensus/quorum_util.h"
 #include "kudu/gutil/map-util.h"
@@ -31,7 +33,10 @@
 #include "kudu/gutil/strings/join.h"
 #include "kudu/gutil/strings/numbers.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/cfile/block_cache.h"
+#include "kudu/gutil/stringprintf.h"
 #include "kudu/server/webui_util.h"
+#include "kudu/tablet/read_amplification.h"
 #include "kudu/tablet/tablet.pb.h"
 #include "kudu/tablet/tablet_bootstrap.h"
 #include "kudu/tablet/tablet_peer.h"
@@ -45,12 +50,14 @@
 using kudu::consensus::GetConsensusRole;
 using kudu::consensus::CONSENSUS_CONFIG_COMMITTED;
 using kudu::consensus::ConsensusStatePB;
+using kudu::consensus::PeerReplicationStats;
 using kudu::consensus::RaftPeerPB;
 using kudu::consensus::TransactionStatusPB;
 using kudu::MaintenanceManagerStatusPB;
 using kudu::MaintenanceManagerStatusPB_CompletedOpPB;
 using kudu::MaintenanceManagerStatusPB_MaintenanceOpPB;
 using kudu::tablet::Tablet;
+using kudu::tablet::TabletBootstrapProgress;
 using kudu::tablet::TabletPeer;
 using kudu::tablet::TabletStatusPB;
 using kudu::tablet::Transaction;
@@ -70,7 +77,7 @@ Status TabletServerPathHandlers::Register(Webserver* server) {
     "/scans", "Scans",
     boost::bind(&TabletServerPathHandlers::HandleScansPage, this, _1, _2),
     true /* styled */, false /* is_on_nav_bar */);
-  server->RegisterPathHandler(
+  server->RegisterStreamingPathHandler(
     "/tablets", "Tablets",
     boost::bind(&TabletServerPathHandlers::HandleTabletsPage, this, _1, _2),
     true /* styled */, true /* is_on_nav_bar */);
@@ -86,6 +93,10 @@ Status TabletServerPathHandlers::Register(Webserver* server) {
     "/tablet-rowsetlayout-svg", "",
     boost::bind(&TabletServerPathHandlers::HandleTabletSVGPage, this, _1, _2),
     true /* styled */, false /* is_on_nav_bar */);
+  server->RegisterPathHandler(
+    "/tablet-read-amplification", "",
+    boost::bind(&TabletServerPathHandlers::HandleTabletReadAmplificationPage, this, _1, _2),
+    true /* styled */, false /* is_on_nav_bar */);
   server->RegisterPathHandler(
     "/tablet-consensus-status", "",
     boost::bind(&TabletServerPathHandlers::HandleConsensusStatusPage, this, _1, _2),
@@ -99,9 +110,21 @@ Status TabletServerPathHandlers::Register(Webserver* server) {
     boost::bind(&TabletServerPathHandlers::HandleDashboardsPage, this, _1, _2),
     true /* styled */, true /* is_on_nav_bar */);
   server->RegisterPathHandler(
+    "/block-cache", "",
+    boost::bind(&TabletServerPathHandlers::HandleBlockCachePage, this, _1, _2),
+    true /* styled */, false /* is_on_nav_bar */);
+  server->RegisterPathHandler(
+    "/consensus-peers", "",
+    boost::bind(&TabletServerPathHandlers::HandleConsensusPeersPage, this, _1, _2),
+    true /* styled */, false /* is_on_nav_bar */);
+  server->RegisterStreamingPathHandler(
     "/maintenance-manager", "",
     boost::bind(&TabletServerPathHandlers::HandleMaintenanceManagerPage, this, _1, _2),
     true /* styled */, false /* is_on_nav_bar */);
+  server->RegisterPathHandler(
+    "/bootstraps", "",
+    boost::bind(&TabletServerPathHandlers::HandleBootstrapsPage, this, _1, _2),
+    true /* styled */, false /* is_on_nav_bar */);
 
   return Status::OK();
 }
@@ -177,7 +200,9 @@ string TabletLink(const string& id) {
 } // anonymous namespace
 
 void TabletServerPathHandlers::HandleTabletsPage(const Webserver::WebRequest& req,
-                                                 std::ostringstream *output) {
+                                                 Webserver::WebResponseStream* stream) {
+  // The tablet manager's lock is only held to copy the list of peers, the page
+  // is rendered from that copy.
   vector<scoped_refptr<TabletPeer>> peers;
   tserver_->tablet_manager()->GetTabletPeers(&peers);
 
@@ -189,15 +214,17 @@ void TabletServerPathHandlers::HandleTabletsPage(const Webserver::WebRequest& re
                      std::make_pair(peer_b->tablet_metadata()->table_name(), peer_b->tablet_id());
             });
 
-  auto generate_table = [this](const string& header,
-                               const vector<scoped_refptr<TabletPeer>>& peers,
-                               ostream* output) {
+  std::ostringstream* output = stream->output();
+  auto generate_table = [this, stream, output](const string& header,
+                                               const vector<scoped_refptr<TabletPeer>>& peers,
+                                               int first, int last) {
     *output << "<h3>" << header << "</h3>\n";
     *output << "<table class='table table-striped'>\n";
     *output << "  <tr><th>Table name</th><th>Tablet ID</th>"
          "<th>Partition</th>"
          "<th>State</th><th>On-disk size</th><th>RaftConfig</th><th>Last status</th></tr>\n";
-    for (const scoped_refptr<TabletPeer>& peer : peers) {
+    for (int i = first; i < last; i++) {
+      const scoped_refptr<TabletPeer>& peer = peers[i];
       TabletStatusPB status;
       peer->GetTabletStatusPB(&status);
       string id = status.tablet_id();
@@ -232,6 +259,7 @@ void TabletServerPathHandlers::HandleTabletsPage(const Webserver::WebRequest& re
               ConsensusState(CONSENSUS_CONFIG_COMMITTED))
                     : "", // $5
           EscapeForHtmlToString(status.last_status())); // $6
+      stream->Flush();
     }
     *output << "</table>\n";
   };
@@ -246,14 +274,24 @@ void TabletServerPathHandlers::HandleTabletsPage(const Webserver::WebRequest& re
     }
   }
 
-  if (!live_peers.empty()) {
-    generate_table("Live Tablets", live_peers, output);
+  // The live tablets are paginated before the tombstoned ones, a page may
+  // show some of both.
+  HtmlPage page = ParseHtmlPage(req, peers.size());
+  HtmlOutputPageLinks("/tablets", page, output);
+  int num_live = live_peers.size();
+  int live_first = std::min(page.first, num_live);
+  int live_last = std::min(page.last, num_live);
+  if (live_first < live_last) {
+    generate_table("Live Tablets", live_peers, live_first, live_last);
   }
-  if (!tombstoned_peers.empty()) {
-    generate_table("Tombstoned Tablets", tombstoned_peers, output);
+  int tombstoned_first = std::max(0, page.first - num_live);
+  int tombstoned_last = std::max(0, page.last - num_live);
+  if (tombstoned_first < tombstoned_last) {
+    generate_table("Tombstoned Tablets", tombstoned_peers, tombstoned_first, tombstoned_last);
     *output << "<p><small>Tombstoned tablets are tablets that previously "
            "stored a replica on this server.</small></p>";
   }
+  HtmlOutputPageLinks("/tablets", page, output);
 }
 
 namespace {
@@ -371,6 +409,12 @@ void TabletServerPathHandlers::HandleTabletPage(const Webserver::WebRequest& req
                                   "Rowset Layout Diagram")
           << "</li>" << endl;
 
+  // Link to the read amplification report.
+  *output << "<li>" << Substitute("<a href=\"/tablet-read-amplification?id=$0\">$1</a>",
+                                  UrlEncodeToString(tablet_id),
+                                  "Read Amplification")
+          << "</li>" << endl;
+
   // Link to consensus status page.
   *output << "<li>" << Substitute("<a href=\"/tablet-consensus-status?id=$0\">$1</a>",
                                   UrlEncodeToString(tablet_id),
@@ -404,6 +448,23 @@ void TabletServerPathHandlers::HandleTabletSVGPage(const Webserver::WebRequest&
 
 }
 
+void TabletServerPathHandlers::HandleTabletReadAmplificationPage(
+    const Webserver::WebRequest& req, std::ostringstream* output) {
+  string id;
+  scoped_refptr<TabletPeer> peer;
+  if (!LoadTablet(tserver_, req, &id, &peer, output)) return;
+  shared_ptr<Tablet> tablet = peer->shared_tablet();
+  if (!tablet) {
+    *output << "Tablet " << EscapeForHtmlToString(id) << " not running";
+    return;
+  }
+
+  *output << "<h1>Read Amplification for Tablet " << TabletLink(id) << "</h1>\n";
+  tablet::ReadAmplificationReport report;
+  tablet->ComputeReadAmplification(&report);
+  report.DumpHtml(output);
+}
+
 void TabletServerPathHandlers::HandleLogAnchorsPage(const Webserver::WebRequest& req,
                                                     std::ostringstream* output) {
   string tablet_id;
@@ -507,6 +568,8 @@ string TabletServerPathHandlers::IteratorStatsToHtml(const Schema& projection,
        << "<th>Blocks read from disk</th>"
        << "<th>Bytes read from disk</th>"
        << "<th>Cells read from disk</th>"
+       << "<th>Rows evaluated by predicate</th>"
+       << "<th>Rows passed by predicate</th>"
        << "</tr>\n";
   for (size_t idx = 0; idx < stats.size(); idx++) {
     // We use 'title' attributes so that if the user hovers over the value, they get a
@@ -515,8 +578,7 @@ string TabletServerPathHandlers::IteratorStatsToHtml(const Schema& projection,
                        "<td>$0</td>"
                        "<td title=\"$1\">$2</td>"
                        "<td title=\"$3\">$4</td>"
-                       "<td title=\"$5\">$6</td>"
-                       "</tr>\n",
+                       "<td title=\"$5\">$6</td>",
                        EscapeForHtmlToString(projection.column(idx).name()), // $0
                        HumanReadableInt::ToString(stats[idx].data_blocks_read_from_disk), // $1
                        stats[idx].data_blocks_read_from_disk, // $2
@@ -524,6 +586,13 @@ string TabletServerPathHandlers::IteratorStatsToHtml(const Schema& projection,
                        stats[idx].bytes_read_from_disk, // $4
                        HumanReadableInt::ToString(stats[idx].cells_read_from_disk), // $5
                        stats[idx].cells_read_from_disk); // $6
+    html << Substitute("<td title=\"$0\">$1</td>"
+                       "<td title=\"$2\">$3</td>"
+                       "</tr>\n",
+                       HumanReadableInt::ToString(stats[idx].predicate_rows_evaluated), // $0
+                       stats[idx].predicate_rows_evaluated, // $1
+                       HumanReadableInt::ToString(stats[idx].predicate_rows_passed), // $2
+                       stats[idx].predicate_rows_passed); // $3
   }
   html << "</table>\n";
   return html.str();
@@ -541,6 +610,228 @@ void TabletServerPathHandlers::HandleDashboardsPage(const Webserver::WebRequest&
   *output << GetDashboardLine("maintenance-manager", "Maintenance Manager",
                               "List of operations that are currently running and those "
                               "that are registered.");
+  *output << GetDashboardLine("block-cache", "Block Cache",
+                              "Block cache usage and hit ratio of each table and tablet.");
+  *output << GetDashboardLine("consensus-peers", "Consensus Peers",
+                              "Replication lag and latency to the peers of the tablets "
+                              "led by this server.");
+  *output << GetDashboardLine("bootstraps", "Bootstraps",
+                              "Progress and throughput of the log replay of the tablets "
+                              "opening, and where the time of past replays went.");
+}
+
+namespace {
+
+struct BlockCacheStats {
+  BlockCacheStats() : hits(0), misses(0), inserted_bytes(0), resident_bytes(0) {}
+
+  void Add(const cfile::BlockCacheAttribution& attribution) {
+    hits += attribution.hits();
+    misses += attribution.misses();
+    inserted_bytes += attribution.inserted_bytes();
+    resident_bytes += attribution.resident_bytes();
+  }
+
+  void Add(const BlockCacheStats& other) {
+    hits += other.hits;
+    misses += other.misses;
+    inserted_bytes += other.inserted_bytes;
+    resident_bytes += other.resident_bytes;
+  }
+
+  // Returns the table cells for these stats.
+  string ToHtml() const {
+    int64_t lookups = hits + misses;
+    string hit_ratio = lookups == 0 ? "" : StringPrintf("%.1f%%", 100.0 * hits / lookups);
+    return Substitute("<td>$0</td><td>$1</td><td>$2</td><td>$3</td>",
+                      lookups, hit_ratio,
+                      HumanReadableNumBytes::ToString(inserted_bytes),
+                      HumanReadableNumBytes::ToString(resident_bytes));
+  }
+
+  int64_t hits;
+  int64_t misses;
+  int64_t inserted_bytes;
+  int64_t resident_bytes;
+};
+
+} // anonymous namespace
+
+void TabletServerPathHandlers::HandleBlockCachePage(const Webserver::WebRequest& req,
+                                                    std::ostringstream* output) {
+  vector<scoped_refptr<TabletPeer>> peers;
+  tserver_->tablet_manager()->GetTabletPeers(&peers);
+  std::sort(peers.begin(), peers.end(),
+            [](const scoped_refptr<TabletPeer>& peer_a,
+               const scoped_refptr<TabletPeer>& peer_b) {
+              return std::make_pair(peer_a->tablet_metadata()->table_name(), peer_a->tablet_id()) <
+                     std::make_pair(peer_b->tablet_metadata()->table_name(), peer_b->tablet_id());
+            });
+
+  const char* kHeader = "<th>Lookups</th><th>Hit ratio</th>"
+                        "<th>Inserted</th><th>Resident</th></tr>\n";
+  std::map<string, BlockCacheStats> table_stats;
+  std::ostringstream tablet_rows;
+  for (const scoped_refptr<TabletPeer>& peer : peers) {
+    shared_ptr<Tablet> tablet = peer->shared_tablet();
+    if (!tablet || !tablet->block_cache_attribution()) {
+      continue;
+    }
+    const string& table_name = peer->tablet_metadata()->table_name();
+    BlockCacheStats stats;
+    stats.Add(*tablet->block_cache_attribution().get());
+    table_stats[table_name].Add(stats);
+    tablet_rows << Substitute("  <tr><td>$0</td><td><a href=\"/tablet?id=$1\">$2</a></td>$3</tr>\n",
+                              EscapeForHtmlToString(table_name),
+                              UrlEncodeToString(peer->tablet_id()),
+                              EscapeForHtmlToString(peer->tablet_id()),
+                              stats.ToHtml());
+  }
+
+  *output << "<h1>Block Cache</h1>\n";
+  *output << "<p>Blocks of tablets which have been deleted are no longer listed, "
+          << "but may still be resident.</p>\n";
+  *output << "<h3>Tables</h3>\n";
+  *output << "<table class='table table-striped'>\n";
+  *output << "  <tr><th>Table name</th>" << kHeader;
+  for (const auto& e : table_stats) {
+    *output << Substitute("  <tr><td>$0</td>$1</tr>\n",
+                          EscapeForHtmlToString(e.first), e.second.ToHtml());
+  }
+  *output << "</table>\n";
+
+  *output << "<h3>Tablets</h3>\n";
+  *output << "<table class='table table-striped'>\n";
+  *output << "  <tr><th>Table name</th><th>Tablet ID</th>" << kHeader;
+  *output << tablet_rows.str();
+  *output << "</table>\n";
+}
+
+namespace {
+
+// The replication stats of one peer of one tablet led by this server.
+struct TabletPeerReplicationStats {
+  string table_name;
+  string tablet_id;
+  PeerReplicationStats stats;
+};
+
+// The rollup of the replication stats of all the tablets replicated to one
+// remote server.
+struct RemoteServerReplicationStats {
+  int num_tablets = 0;
+  int64_t max_lag_ops = 0;
+  int64_t bytes_in_flight = 0;
+  uint64_t max_rtt_p99_us = 0;
+  MonoDelta max_time_since_last_ack;
+  // Whether some tablet was never acked by the server in the current leadership.
+  bool never_acked = false;
+};
+
+// The number of tablet replicas listed on the consensus peers page.
+const int kMaxReplicasShown = 50;
+
+string TimeSinceLastAckToString(const MonoDelta& delta) {
+  if (!delta.Initialized()) return "never";
+  return HumanReadableElapsedTime::ToShortString(delta.ToSeconds());
+}
+
+} // anonymous namespace
+
+void TabletServerPathHandlers::HandleConsensusPeersPage(const Webserver::WebRequest& req,
+                                                        std::ostringstream* output) {
+  vector<scoped_refptr<TabletPeer>> peers;
+  tserver_->tablet_manager()->GetTabletPeers(&peers);
+
+  vector<TabletPeerReplicationStats> replicas;
+  std::map<string, RemoteServerReplicationStats> servers;
+  for (const scoped_refptr<TabletPeer>& peer : peers) {
+    scoped_refptr<consensus::Consensus> consensus = peer->shared_consensus();
+    if (!consensus) continue;
+    vector<PeerReplicationStats> peer_stats;
+    consensus->GetPeerReplicationStats(&peer_stats);
+    for (const PeerReplicationStats& stats : peer_stats) {
+      RemoteServerReplicationStats& server = servers[stats.uuid];
+      server.num_tablets++;
+      server.max_lag_ops = std::max(server.max_lag_ops, stats.lag_ops);
+      server.bytes_in_flight += stats.bytes_in_flight;
+      server.max_rtt_p99_us = std::max(server.max_rtt_p99_us, stats.rtt_p99_us);
+      if (!stats.time_since_last_ack.Initialized()) {
+        server.never_acked = true;
+      } else if (!server.max_time_since_last_ack.Initialized() ||
+                 stats.time_since_last_ack > server.max_time_since_last_ack) {
+        server.max_time_since_last_ack = stats.time_since_last_ack;
+      }
+      replicas.push_back({ peer->tablet_metadata()->table_name(), peer->tablet_id(), stats });
+    }
+  }
+
+  // List the slowest first.
+  vector<std::pair<string, RemoteServerReplicationStats>> sorted_servers(servers.begin(),
+                                                                         servers.end());
+  std::sort(sorted_servers.begin(), sorted_servers.end(),
+            [](const std::pair<string, RemoteServerReplicationStats>& a,
+               const std::pair<string, RemoteServerReplicationStats>& b) {
+              return std::make_pair(a.second.max_lag_ops, a.second.max_rtt_p99_us) >
+                     std::make_pair(b.second.max_lag_ops, b.second.max_rtt_p99_us);
+            });
+  std::sort(replicas.begin(), replicas.end(),
+            [](const TabletPeerReplicationStats& a, const TabletPeerReplicationStats& b) {
+              return std::make_pair(a.stats.lag_ops, a.stats.rtt_p99_us) >
+                     std::make_pair(b.stats.lag_ops, b.stats.rtt_p99_us);
+            });
+
+  *output << "<h1>Consensus Peers</h1>\n";
+  *output << "<p>Replication to the peers of the tablets led by this server. Lag is the "
+          << "number of operations a peer has yet to acknowledge, and latencies are the "
+          << "round-trip times of the requests to it.</p>\n";
+  *output << "<h3>Servers</h3>\n";
+  *output << "<table class='table table-striped'>\n";
+  *output << "  <tr><th>Server UUID</th><th>Tablets</th><th>Max lag (ops)</th>"
+          << "<th>Bytes in flight</th><th>Max p99 latency</th>"
+          << "<th>Max time since last ack</th></tr>\n";
+  for (const auto& e : sorted_servers) {
+    const RemoteServerReplicationStats& server = e.second;
+    *output << Substitute("  <tr><td>$0</td><td>$1</td><td>$2</td><td>$3</td>"
+                          "<td>$4 us</td><td>$5</td></tr>\n",
+                          EscapeForHtmlToString(e.first),
+                          server.num_tablets,
+                          server.max_lag_ops,
+                          HumanReadableNumBytes::ToString(server.bytes_in_flight),
+                          server.max_rtt_p99_us,
+                          server.never_acked ? "never" :
+                              TimeSinceLastAckToString(server.max_time_since_last_ack));
+  }
+  *output << "</table>\n";
+
+  *output << Substitute("<h3>Slowest tablet replicas (at most $0)</h3>\n", kMaxReplicasShown);
+  *output << "<table class='table table-striped'>\n";
+  *output << "  <tr><th>Table name</th><th>Tablet ID</th><th>Server UUID</th>"
+          << "<th>Lag (ops)</th><th>Ops in flight</th><th>Bytes in flight</th>"
+          << "<th>Requests</th><th>p50 latency</th><th>p99 latency</th><th>Max latency</th>"
+          << "<th>Time since last ack</th></tr>\n";
+  int num_shown = 0;
+  for (const TabletPeerReplicationStats& replica : replicas) {
+    if (num_shown++ == kMaxReplicasShown) break;
+    const PeerReplicationStats& stats = replica.stats;
+    *output << Substitute("  <tr><td>$0</td><td><a href=\"/tablet-consensus-status?id=$1\">"
+                          "$2</a></td><td>$3</td><td>$4</td><td>$5</td><td>$6</td>"
+                          "<td>$7</td><td>$8 us</td><td>$9 us</td>",
+                          EscapeForHtmlToString(replica.table_name),
+                          UrlEncodeToString(replica.tablet_id),
+                          EscapeForHtmlToString(replica.tablet_id),
+                          EscapeForHtmlToString(stats.uuid),
+                          stats.lag_ops,
+                          stats.ops_in_flight,
+                          HumanReadableNumBytes::ToString(stats.bytes_in_flight),
+                          stats.num_requests,
+                          stats.rtt_p50_us,
+                          stats.rtt_p99_us);
+    *output << Substitute("<td>$0 us</td><td>$1</td></tr>\n",
+                          stats.rtt_max_us,
+                          TimeSinceLastAckToString(stats.time_since_last_ack));
+  }
+  *output << "</table>\n";
 }
 
 string TabletServerPathHandlers::GetDashboardLine(const std::string& link,
@@ -552,28 +843,120 @@ string TabletServerPathHandlers::GetDashboardLine(const std::string& link,
                     EscapeForHtmlToString(desc));
 }
 
+void TabletServerPathHandlers::HandleBootstrapsPage(const Webserver::WebRequest& req,
+                                                    std::ostringstream* output) {
+  vector<scoped_refptr<TabletPeer>> peers;
+  tserver_->tablet_manager()->GetTabletPeers(&peers);
+
+  struct Bootstrap {
+    scoped_refptr<TabletPeer> peer;
+    TabletBootstrapProgress progress;
+  };
+  vector<Bootstrap> bootstraps;
+  int num_opening = 0;
+  int num_waiting = 0;
+  TabletBootstrapProgress total;
+  for (const scoped_refptr<TabletPeer>& peer : peers) {
+    if (peer->state() == tablet::NOT_STARTED) {
+      num_waiting++;
+    } else if (peer->state() == tablet::BOOTSTRAPPING) {
+      num_opening++;
+    }
+    TabletBootstrapProgress progress = peer->bootstrap_progress();
+    if (progress.num_segments == 0) continue;
+    total.num_segments += progress.num_segments;
+    total.segments_replayed += progress.segments_replayed;
+    total.bytes_to_replay += progress.bytes_to_replay;
+    total.bytes_replayed += progress.bytes_replayed;
+    total.ops_replayed += progress.ops_replayed;
+    total.read_us += progress.read_us;
+    total.read_wait_us += progress.read_wait_us;
+    total.apply_us += progress.apply_us;
+    bootstraps.push_back({ peer, progress });
+  }
+
+  // List the replays in progress first, the longest first.
+  std::sort(bootstraps.begin(), bootstraps.end(),
+            [](const Bootstrap& a, const Bootstrap& b) {
+              return std::make_pair(!a.progress.done, a.progress.elapsed_us) >
+                     std::make_pair(!b.progress.done, b.progress.elapsed_us);
+            });
+
+  *output << "<h1>Bootstraps</h1>\n";
+  *output << Substitute("<p>$0 tablet(s) bootstrapping, $1 waiting to be opened.</p>\n",
+                        num_opening, num_waiting);
+  *output << Substitute("<p>Log replayed by all tablets: $0 of $1 in $2 segment(s) of $3, "
+                        "$4 operation(s). Time spent reading: $5s, waiting for reads: $6s, "
+                        "applying: $7s.</p>\n",
+                        HumanReadableNumBytes::ToString(total.bytes_replayed),
+                        HumanReadableNumBytes::ToString(total.bytes_to_replay),
+                        total.segments_replayed, total.num_segments, total.ops_replayed,
+                        StringPrintf("%.1f", total.read_us / 1e6),
+                        StringPrintf("%.1f", total.read_wait_us / 1e6),
+                        StringPrintf("%.1f", total.apply_us / 1e6));
+
+  *output << "<table class='table table-striped'>\n";
+  *output << "  <tr><th>Table name</th><th>Tablet ID</th><th>State</th><th>Segments</th>"
+             "<th>Replayed</th><th>Throughput</th><th>Read</th><th>Read wait</th>"
+             "<th>Apply</th><th>Elapsed</th><th>Time left</th></tr>\n";
+  for (const Bootstrap& b : bootstraps) {
+    const TabletBootstrapProgress& p = b.progress;
+    double secs_left = p.EstimatedSecondsLeft();
+    string throughput = Substitute(
+        "$0/s, $1 ops/s",
+        HumanReadableNumBytes::ToString(static_cast<int64_t>(p.bytes_per_sec())),
+        StringPrintf("%.0f", p.ops_per_sec()));
+    *output << Substitute(
+        "  <tr><td>$0</td><td><a href=\"/tablet?id=$1\">$2</a></td><td>$3</td>"
+        "<td>$4/$5</td><td>$6/$7, $8 ops</td><td>$9</td>",
+        EscapeForHtmlToString(b.peer->tablet_metadata()->table_name()),
+        UrlEncodeToString(b.peer->tablet_id()),
+        EscapeForHtmlToString(b.peer->tablet_id()),
+        EscapeForHtmlToString(b.peer->HumanReadableState()),
+        p.segments_replayed, p.num_segments,
+        HumanReadableNumBytes::ToString(p.bytes_replayed),
+        HumanReadableNumBytes::ToString(p.bytes_to_replay),
+        p.ops_replayed, throughput);
+    *output << Substitute(
+        "<td>$0s</td><td>$1s</td><td>$2s</td><td>$3s</td><td>$4</td></tr>\n",
+        StringPrintf("%.1f", p.read_us / 1e6),
+        StringPrintf("%.1f", p.read_wait_us / 1e6),
+        StringPrintf("%.1f", p.apply_us / 1e6),
+        StringPrintf("%.1f", p.elapsed_us / 1e6),
+        secs_left < 0 ? "unknown" : StringPrintf("%.0fs", secs_left));
+  }
+  *output << "</table>\n";
+}
+
 void TabletServerPathHandlers::HandleMaintenanceManagerPage(const Webserver::WebRequest& req,
-                                                            std::ostringstream* output) {
+                                                            Webserver::WebResponseStream* stream) {
+  // The maintenance manager's lock is only held to dump its state, the page is
+  // rendered from the dump.
   MaintenanceManager* manager = tserver_->maintenance_manager();
   MaintenanceManagerStatusPB pb;
   manager->GetMaintenanceManagerStatusDump(&pb);
+  std::ostringstream* output = stream->output();
   if (ContainsKey(req.parsed_args, "raw")) {
     *output << SecureDebugString(pb);
     return;
   }
 
-  int ops_count = pb.registered_operations_size();
+  // There are registered operations for each tablet: they are paginated, the
+  // running and non-running ones alike.
+  HtmlPage page = ParseHtmlPage(req, pb.registered_operations_size());
 
   *output << "<h1>Maintenance Manager state</h1>\n";
+  HtmlOutputPageLinks("/maintenance-manager", page, output);
   *output << "<h3>Running operations</h3>\n";
   *output << "<table class='table table-striped'>\n";
   *output << "  <tr><th>Name</th><th>Instances running</th></tr>\n";
-  for (int i = 0; i < ops_count; i++) {
-    MaintenanceManagerStatusPB_MaintenanceOpPB op_pb = pb.registered_operations(i);
+  for (int i = page.first; i < page.last; i++) {
+    const MaintenanceManagerStatusPB_MaintenanceOpPB& op_pb = pb.registered_operations(i);
     if (op_pb.running() > 0) {
       *output <<  Substitute("<tr><td>$0</td><td>$1</td></tr>\n",
                              EscapeForHtmlToString(op_pb.name()),
                              op_pb.running());
+      stream->Flush();
     }
   }
   *output << "</table>\n";
@@ -582,13 +965,14 @@ void TabletServerPathHandlers::HandleMaintenanceManagerPage(const Webserver::Web
   *output << "<table class='table table-striped'>\n";
   *output << "  <tr><th>Name</th><th>Duration</th><th>Time since op started</th></tr>\n";
   for (int i = 0; i < pb.completed_operations_size(); i++) {
-    MaintenanceManagerStatusPB_CompletedOpPB op_pb = pb.completed_operations(i);
+    const MaintenanceManagerStatusPB_CompletedOpPB& op_pb = pb.completed_operations(i);
     *output <<  Substitute("<tr><td>$0</td><td>$1</td><td>$2</td></tr>\n",
                            EscapeForHtmlToString(op_pb.name()),
                            HumanReadableElapsedTime::ToShortString(
                                op_pb.duration_millis() / 1000.0),
                            HumanReadableElapsedTime::ToShortString(
                                op_pb.secs_since_start()));
+    stream->Flush();
   }
   *output << "</table>\n";
 
@@ -596,8 +980,8 @@ void TabletServerPathHandlers::HandleMaintenanceManagerPage(const Webserver::Web
   *output << "<table class='table table-striped'>\n";
   *output << "  <tr><th>Name</th><th>Runnable</th><th>RAM anchored</th>\n"
           << "       <th>Logs retained</th><th>Perf</th></tr>\n";
-  for (int i = 0; i < ops_count; i++) {
-    MaintenanceManagerStatusPB_MaintenanceOpPB op_pb = pb.registered_operations(i);
+  for (int i = page.first; i < page.last; i++) {
+    const MaintenanceManagerStatusPB_MaintenanceOpPB& op_pb = pb.registered_operations(i);
     if (op_pb.running() == 0) {
       *output << Substitute("<tr><td>$0</td><td>$1</td><td>$2</td><td>$3</td><td>$4</td></tr>\n",
                             EscapeForHtmlToString(op_pb.name()),
@@ -605,9 +989,11 @@ void TabletServerPathHandlers::HandleMaintenanceManagerPage(const Webserver::Web
                             HumanReadableNumBytes::ToString(op_pb.ram_anchored_bytes()),
                             HumanReadableNumBytes::ToString(op_pb.logs_retained_bytes()),
                             op_pb.perf_improvement());
+      stream->Flush();
     }
   }
   *output << "</table>\n";
+  HtmlOutputPageLinks("/maintenance-manager", page, output);
 }
 
 } // namespace tserver
@@ -52,21 +52,29 @@ class TabletServerPathHandlers {
   void HandleScansPage(const Webserver::WebRequest& req,
                        std::ostringstream* output);
   void HandleTabletsPage(const Webserver::WebRequest& req,
-                         std::ostringstream* output);
+                         Webserver::WebResponseStream* stream);
   void HandleTabletPage(const Webserver::WebRequest& req,
                         std::ostringstream* output);
   void HandleTransactionsPage(const Webserver::WebRequest& req,
                               std::ostringstream* output);
   void HandleTabletSVGPage(const Webserver::WebRequest& req,
                            std::ostringstream* output);
+  void HandleTabletReadAmplificationPage(const Webserver::WebRequest& req,
+                                         std::ostringstream* output);
   void HandleLogAnchorsPage(const Webserver::WebRequest& req,
                             std::ostringstream* output);
   void HandleConsensusStatusPage(const Webserver::WebRequest& req,
                                  std::ostringstream* output);
   void HandleDashboardsPage(const Webserver::WebRequest& req,
                             std::ostringstream* output);
+  void HandleBlockCachePage(const Webserver::WebRequest& req,
+                            std::ostringstream* output);
+  void HandleConsensusPeersPage(const Webserver::WebRequest& req,
+                                std::ostringstream* output);
   void HandleMaintenanceManagerPage(const Webserver::WebRequest& req,
-                                    std::ostringstream* output);
+                                    Webserver::WebResponseStream* stream);
+  void HandleBootstrapsPage(const Webserver::WebRequest& req,
+                            std::ostringstream* output);
   std::string ConsensusStatePBToHtml(const consensus::ConsensusStatePB& cstate) const;
   std::string ScannerToHtml(const Scanner& scanner) const;
   std::string IteratorStatsToHtml(const Schema& projection,
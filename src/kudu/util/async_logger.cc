@@ -17,20 +17,26 @@
 
 #include "kudu/util/async_logger.h"
 
+#include <time.h>
+
 #include <algorithm>
 #include <string>
 #include <thread>
 
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
 
 using std::string;
 
 namespace kudu {
 
 AsyncLogger::AsyncLogger(google::base::Logger* wrapped,
-                         int max_buffer_bytes) :
+                         int max_buffer_bytes,
+                         OverflowPolicy overflow_policy) :
     max_buffer_bytes_(max_buffer_bytes),
     wrapped_(DCHECK_NOTNULL(wrapped)),
+    overflow_policy_(overflow_policy),
     wake_flusher_cond_(&lock_),
     free_buffer_cond_(&lock_),
     flush_complete_cond_(&lock_),
@@ -63,12 +69,22 @@ void AsyncLogger::Write(bool force_flush,
                         time_t timestamp,
                         const char* message,
                         int message_len) {
+  bool fatal = message_len > 0 && message[0] == 'F';
   {
     MutexLock l(lock_);
     DCHECK_EQ(state_, RUNNING);
-    while (BufferFull(*active_buf_)) {
-      app_threads_blocked_count_for_tests_++;
-      free_buffer_cond_.Wait();
+    if (BufferFull(*active_buf_)) {
+      if (overflow_policy_ == DROP_UNFLUSHED_WHEN_FULL && !force_flush && !fatal) {
+        active_buf_->dropped++;
+        dropped_messages_++;
+        return;
+      }
+      MonoTime start = MonoTime::Now();
+      while (BufferFull(*active_buf_)) {
+        app_threads_blocked_count_for_tests_++;
+        free_buffer_cond_.Wait();
+      }
+      blocked_micros_ += (MonoTime::Now() - start).ToMicroseconds();
     }
     active_buf_->add(Msg(timestamp, string(message, message_len)),
                      force_flush);
@@ -87,7 +103,7 @@ void AsyncLogger::Write(bool force_flush,
   //
   // Unfortunately, the underlying log level isn't passed through to this interface, so we
   // have to use this hack: messages from FATAL errors start with the character 'F'.
-  if (message_len > 0 && message[0] == 'F') {
+  if (fatal) {
     Flush();
   }
 }
@@ -127,9 +143,7 @@ void AsyncLogger::RunThread() {
     }
     l.Unlock();
 
-    for (const auto& msg : flushing_buf_->messages) {
-      wrapped_->Write(false, msg.ts, msg.message.data(), msg.message.size());
-    }
+    WriteFlushingBuffer();
     if (flushing_buf_->flush) {
       wrapped_->Flush();
     }
@@ -141,6 +155,27 @@ void AsyncLogger::RunThread() {
   }
 }
 
+void AsyncLogger::WriteFlushingBuffer() {
+  const auto& messages = flushing_buf_->messages;
+  time_t ts = messages.empty() ? time(nullptr) : messages.back().ts;
+  batch_.clear();
+  for (const auto& msg : messages) {
+    batch_.append(msg.message);
+  }
+  if (flushing_buf_->dropped > 0) {
+    batch_.append(strings::Substitute(
+        "AsyncLogger dropped $0 log messages because its buffer was full\n",
+        flushing_buf_->dropped));
+  }
+  if (!batch_.empty()) {
+    wrapped_->Write(false, ts, batch_.data(), batch_.size());
+  }
+  // Don't keep the memory of an unusually large batch around.
+  if (batch_.capacity() > static_cast<size_t>(max_buffer_bytes_)) {
+    string().swap(batch_);
+  }
+}
+
 bool AsyncLogger::BufferFull(const Buffer& buf) const {
   // We evenly divide our total buffer space between the two buffers.
   return buf.size > (max_buffer_bytes_ / 2);
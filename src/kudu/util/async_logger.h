@@ -51,13 +51,29 @@ namespace kudu {
 // worth it. We do take care that a glog FATAL message flushes all buffered log
 // messages before exiting.
 //
+// The logger thread writes each buffer to the wrapped Logger with a single
+// write of all of its messages, rather than one write per message.
+//
 // NOTE: the logger limits the total amount of buffer space, so if the underlying
 // log blocks for too long, eventually the threads generating the log messages
-// will block as well. This prevents runaway memory usage.
+// will block as well, or their messages will be dropped, depending on the
+// overflow policy. This prevents runaway memory usage.
 class AsyncLogger : public google::base::Logger {
  public:
+  // What to do with a message logged while the buffers are full.
+  enum OverflowPolicy {
+    // Block the logging thread until the logger thread frees a buffer.
+    BLOCK_WHEN_FULL,
+
+    // Drop the messages which don't need to be flushed (see Write()), and
+    // block for the others. The logger thread writes the number of dropped
+    // messages to the log in their place.
+    DROP_UNFLUSHED_WHEN_FULL
+  };
+
   AsyncLogger(google::base::Logger* wrapped,
-              int max_buffer_bytes);
+              int max_buffer_bytes,
+              OverflowPolicy overflow_policy = BLOCK_WHEN_FULL);
   ~AsyncLogger();
 
   void Start();
@@ -100,6 +116,19 @@ class AsyncLogger : public google::base::Logger {
     return app_threads_blocked_count_for_tests_;
   }
 
+  // Return the total time application threads were blocked due to the
+  // buffers being full, in microseconds.
+  int64_t blocked_micros() const {
+    MutexLock l(lock_);
+    return blocked_micros_;
+  }
+
+  // Return the number of messages dropped due to the buffers being full.
+  int64_t dropped_messages() const {
+    MutexLock l(lock_);
+    return dropped_messages_;
+  }
+
  private:
   // A buffered message.
   //
@@ -128,12 +157,16 @@ class AsyncLogger : public google::base::Logger {
     // underlying logger.
     bool flush = false;
 
+    // The number of messages dropped while this buffer was full.
+    int64_t dropped = 0;
+
     Buffer() {}
 
     void clear() {
       messages.clear();
       size = 0;
       flush = false;
+      dropped = 0;
     }
 
     void add(Msg msg, bool flush) {
@@ -143,7 +176,7 @@ class AsyncLogger : public google::base::Logger {
     }
 
     bool needs_flush_or_write() const {
-      return flush || !messages.empty();
+      return flush || !messages.empty() || dropped > 0;
     }
 
    private:
@@ -153,15 +186,29 @@ class AsyncLogger : public google::base::Logger {
   bool BufferFull(const Buffer& buf) const;
   void RunThread();
 
+  // Write the messages of 'flushing_buf_' to the wrapped logger.
+  void WriteFlushingBuffer();
+
   // The maximum number of bytes used by the entire class.
   const int max_buffer_bytes_;
   google::base::Logger* const wrapped_;
+  const OverflowPolicy overflow_policy_;
   std::thread thread_;
 
   // Count of how many times an application thread was blocked due to
   // a full buffer.
   int app_threads_blocked_count_for_tests_ = 0;
 
+  // Total time application threads were blocked due to a full buffer.
+  int64_t blocked_micros_ = 0;
+
+  // Count of the messages dropped due to a full buffer.
+  int64_t dropped_messages_ = 0;
+
+  // The messages of 'flushing_buf_', concatenated to be written at once.
+  // Only used by the logger thread.
+  std::string batch_;
+
   // Count of how many times the writer thread has flushed the buffers.
   // 64 bits should be enough to never worry about overflow.
   uint64_t flush_count_ = 0;
@@ -0,0 +1,355 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/bit-packing.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+#include <algorithm>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/cpu.h"
+#include "kudu/gutil/port.h"
+
+using base::CPU;
+
+namespace kudu {
+namespace bitpacking {
+
+namespace {
+
+// The SIMD kernels load whole 16-byte words and may therefore read up to
+// this many bytes beyond the end of the 32-value group they decode.
+const int kMaxKernelOverread = 16;
+
+// All kernels decode 32 values at a time: 32 values of 'W' bits occupy
+// exactly 4 * W bytes, so every group starts on a byte boundary.
+const int kValuesPerGroup = 32;
+
+template<typename OutType>
+struct Kernels {
+  typedef void (*Unpack32Fn)(const uint8_t* in, OutType* out);
+
+  // Both tables are indexed by bit width. Only the entries up to
+  // min(32, 8 * sizeof(OutType)) are populated.
+  static Unpack32Fn scalar[33];
+  static Unpack32Fn selected[33];
+};
+
+template<typename OutType>
+typename Kernels<OutType>::Unpack32Fn Kernels<OutType>::scalar[33];
+template<typename OutType>
+typename Kernels<OutType>::Unpack32Fn Kernels<OutType>::selected[33];
+
+const char* g_selected_kernel_name = "scalar";
+
+// Expands each bit of a byte into a 0/1 byte (least significant bit first).
+uint64_t g_bit_expand_table[256];
+
+inline uint32_t LoadWord32(const uint8_t* in, int word_idx) {
+  uint32_t word;
+  memcpy(&word, in + word_idx * 4, sizeof(word));
+  return word;
+}
+
+// Portable kernel. With 'W' known at compile time, the loop below is fully
+// unrolled into constant shifts and masks.
+template<typename OutType, int W>
+struct ScalarKernel {
+  static void Unpack32(const uint8_t* in, OutType* out) {
+    if (W == 1 && sizeof(OutType) == 1) {
+      for (int i = 0; i < 4; i++) {
+        memcpy(out + i * 8, &g_bit_expand_table[in[i]], 8);
+      }
+      return;
+    }
+    if (W == 8 || W == 16 || W == 32) {
+      // Widths of whole machine words are a straight widening copy.
+      for (int i = 0; i < kValuesPerGroup; i++) {
+        uint32_t v = 0;
+        memcpy(&v, in + i * (W / 8), W / 8);
+        out[i] = v;
+      }
+      return;
+    }
+    const uint64_t mask = (1ULL << W) - 1;
+    for (int i = 0; i < kValuesPerGroup; i++) {
+      const int bit = i * W;
+      const int word_idx = bit / 32;
+      const int shift = bit % 32;
+      uint64_t v = LoadWord32(in, word_idx);
+      if (shift + W > 32) {
+        v |= static_cast<uint64_t>(LoadWord32(in, word_idx + 1)) << 32;
+      }
+      out[i] = (v >> shift) & mask;
+    }
+  }
+};
+
+// Position of the first byte of value 'lane' (of the 8-value group starting
+// at value 'first_lane'), relative to the first byte of value 'first_lane'.
+constexpr int LaneByte(int w, int first_lane, int lane) {
+  return (lane * w) / 8 - (first_lane * w) / 8;
+}
+
+// Bit offset of value 'lane' within its first byte.
+constexpr int LaneShift(int w, int lane) {
+  return (lane * w) % 8;
+}
+
+// Byte shuffle which moves the four bytes starting at each of the values
+// 'first_lane' ... 'first_lane + 3' into consecutive 32-bit lanes.
+#define KUDU_BP_LANE_BYTES(w, f, l)                             \
+  static_cast<char>(LaneByte(w, f, l)),                         \
+  static_cast<char>(LaneByte(w, f, l) + 1),                     \
+  static_cast<char>(LaneByte(w, f, l) + 2),                     \
+  static_cast<char>(LaneByte(w, f, l) + 3)
+
+template<int W, int FIRST>
+inline __m128i ShuffleMask() {
+  return _mm_setr_epi8(KUDU_BP_LANE_BYTES(W, FIRST, FIRST),
+                       KUDU_BP_LANE_BYTES(W, FIRST, FIRST + 1),
+                       KUDU_BP_LANE_BYTES(W, FIRST, FIRST + 2),
+                       KUDU_BP_LANE_BYTES(W, FIRST, FIRST + 3));
+}
+
+#undef KUDU_BP_LANE_BYTES
+
+// Narrowing stores of eight 32-bit values held in two 4-lane vectors.
+inline void Store8(__m128i lo, __m128i hi, uint8_t* out) {
+  __m128i packed = _mm_packus_epi16(_mm_packus_epi32(lo, hi), _mm_setzero_si128());
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(out), packed);
+}
+
+inline void Store8(__m128i lo, __m128i hi, uint16_t* out) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi32(lo, hi));
+}
+
+inline void Store8(__m128i lo, __m128i hi, uint32_t* out) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), lo);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4), hi);
+}
+
+inline void Store8(__m128i lo, __m128i hi, uint64_t* out) {
+  __m128i* dst = reinterpret_cast<__m128i*>(out);
+  _mm_storeu_si128(dst, _mm_cvtepu32_epi64(lo));
+  _mm_storeu_si128(dst + 1, _mm_cvtepu32_epi64(_mm_srli_si128(lo, 8)));
+  _mm_storeu_si128(dst + 2, _mm_cvtepu32_epi64(hi));
+  _mm_storeu_si128(dst + 3, _mm_cvtepu32_epi64(_mm_srli_si128(hi, 8)));
+}
+
+// Whether the SIMD kernels handle bit width 'w'. Values wider than 24 bits
+// plus their in-byte offset do not fit in a 32-bit lane, and single bits as
+// well as the 8- and 16-bit widths are already handled well by the scalar
+// kernel; the SIMD kernel families fall back to it for those widths.
+constexpr bool SimdSupportsWidth(int w) {
+  return w > 1 && w <= 24 && w != 8 && w != 16;
+}
+
+// SSE4.1 kernel: each value is shuffled into its own 32-bit lane, then the
+// per-lane variable right shift is emulated by a multiply (left shift by a
+// lane-specific amount, discarding the high bits) followed by a constant
+// right shift.
+template<typename OutType, int W, bool SIMD>
+struct Sse41KernelImpl : public ScalarKernel<OutType, W> {};
+
+template<typename OutType, int W>
+struct Sse41KernelImpl<OutType, W, true> {
+  static void Unpack32(const uint8_t* in, OutType* out) {
+    const __m128i shuf_lo = ShuffleMask<W, 0>();
+    const __m128i shuf_hi = ShuffleMask<W, 4>();
+    const __m128i mul_lo = _mm_setr_epi32(
+        static_cast<int>(1U << (32 - W - LaneShift(W, 0))),
+        static_cast<int>(1U << (32 - W - LaneShift(W, 1))),
+        static_cast<int>(1U << (32 - W - LaneShift(W, 2))),
+        static_cast<int>(1U << (32 - W - LaneShift(W, 3))));
+    const __m128i mul_hi = _mm_setr_epi32(
+        static_cast<int>(1U << (32 - W - LaneShift(W, 4))),
+        static_cast<int>(1U << (32 - W - LaneShift(W, 5))),
+        static_cast<int>(1U << (32 - W - LaneShift(W, 6))),
+        static_cast<int>(1U << (32 - W - LaneShift(W, 7))));
+    const int hi_offset = LaneByte(W, 0, 4);
+    for (int g = 0; g < 4; g++) {
+      const uint8_t* p = in + g * W;
+      __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + hi_offset));
+      lo = _mm_srli_epi32(_mm_mullo_epi32(_mm_shuffle_epi8(lo, shuf_lo), mul_lo), 32 - W);
+      hi = _mm_srli_epi32(_mm_mullo_epi32(_mm_shuffle_epi8(hi, shuf_hi), mul_hi), 32 - W);
+      Store8(lo, hi, out + g * 8);
+    }
+  }
+};
+
+template<typename OutType, int W>
+struct Sse41Kernel : public Sse41KernelImpl<OutType, W, SimdSupportsWidth(W)> {};
+
+// AVX2 kernel: like the SSE4.1 kernel, but decodes all eight values of a
+// group in one 256-bit register using a true variable shift.
+template<typename OutType, int W, bool SIMD>
+struct Avx2KernelImpl : public ScalarKernel<OutType, W> {};
+
+template<typename OutType, int W>
+struct Avx2KernelImpl<OutType, W, true> {
+  __attribute__((target("avx2")))
+  static void Unpack32(const uint8_t* in, OutType* out) {
+    const __m256i shuf = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(ShuffleMask<W, 0>()), ShuffleMask<W, 4>(), 1);
+    const __m256i shifts = _mm256_setr_epi32(
+        LaneShift(W, 0), LaneShift(W, 1), LaneShift(W, 2), LaneShift(W, 3),
+        LaneShift(W, 4), LaneShift(W, 5), LaneShift(W, 6), LaneShift(W, 7));
+    const __m256i mask = _mm256_set1_epi32((1U << W) - 1);
+    const int hi_offset = LaneByte(W, 0, 4);
+    for (int g = 0; g < 4; g++) {
+      const uint8_t* p = in + g * W;
+      __m256i v = _mm256_inserti128_si256(
+          _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + hi_offset)), 1);
+      v = _mm256_shuffle_epi8(v, shuf);
+      v = _mm256_and_si256(_mm256_srlv_epi32(v, shifts), mask);
+      Store8(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1), out + g * 8);
+    }
+  }
+};
+
+template<typename OutType, int W>
+struct Avx2Kernel : public Avx2KernelImpl<OutType, W, SimdSupportsWidth(W)> {};
+
+// Fills 'table[1..W]' with the kernels of the given family.
+template<typename OutType, template<typename, int> class Kernel, int W>
+struct FillTable {
+  static void Fill(typename Kernels<OutType>::Unpack32Fn* table) {
+    table[W] = &Kernel<OutType, W>::Unpack32;
+    FillTable<OutType, Kernel, W - 1>::Fill(table);
+  }
+};
+
+template<typename OutType, template<typename, int> class Kernel>
+struct FillTable<OutType, Kernel, 0> {
+  static void Fill(typename Kernels<OutType>::Unpack32Fn* /* table */) {}
+};
+
+template<typename OutType>
+struct MaxWidth {
+  enum { value = sizeof(OutType) * 8 < 32 ? sizeof(OutType) * 8 : 32 };
+};
+
+template<typename OutType, template<typename, int> class Kernel>
+void FillTables() {
+  FillTable<OutType, ScalarKernel, MaxWidth<OutType>::value>::Fill(Kernels<OutType>::scalar);
+  FillTable<OutType, Kernel, MaxWidth<OutType>::value>::Fill(Kernels<OutType>::selected);
+}
+
+template<template<typename, int> class Kernel>
+void FillAllTables(const char* name) {
+  FillTables<uint8_t, Kernel>();
+  FillTables<uint16_t, Kernel>();
+  FillTables<uint32_t, Kernel>();
+  FillTables<uint64_t, Kernel>();
+  g_selected_kernel_name = name;
+}
+
+__attribute__((constructor))
+void SelectBitPackingKernels() {
+  for (int i = 0; i < 256; i++) {
+    uint8_t expanded[8];
+    for (int b = 0; b < 8; b++) {
+      expanded[b] = (i >> b) & 1;
+    }
+    memcpy(&g_bit_expand_table[i], expanded, sizeof(expanded));
+  }
+
+  CPU cpu;
+  if (cpu.has_avx2()) {
+    FillAllTables<Avx2Kernel>("avx2");
+  } else if (cpu.has_sse41()) {
+    FillAllTables<Sse41Kernel>("sse4.1");
+  } else {
+    FillAllTables<ScalarKernel>("scalar");
+  }
+}
+
+// Decodes 'num_values' values one at a time. Never reads more than
+// ceil(num_values * bit_width / 8) bytes.
+template<typename OutType>
+void UnpackTail(int bit_width, const uint8_t* in, int64_t num_values, OutType* out) {
+  const uint64_t mask = (1ULL << bit_width) - 1;
+  uint64_t acc = 0;
+  int acc_bits = 0;
+  for (int64_t i = 0; i < num_values; i++) {
+    while (acc_bits < bit_width) {
+      acc |= static_cast<uint64_t>(*in++) << acc_bits;
+      acc_bits += 8;
+    }
+    out[i] = acc & mask;
+    acc >>= bit_width;
+    acc_bits -= bit_width;
+  }
+}
+
+} // anonymous namespace
+
+template<typename OutType>
+int64_t UnpackValues(int bit_width, const uint8_t* in, int64_t in_bytes,
+                     int64_t num_values, OutType* out) {
+  DCHECK_GE(bit_width, 1);
+  DCHECK_LE(bit_width, MaxWidth<OutType>::value);
+  DCHECK_GE(in_bytes, 0);
+
+  num_values = std::min(num_values, in_bytes * 8 / bit_width);
+  const int64_t group_bytes = kValuesPerGroup / 8 * bit_width;
+  int64_t remaining = num_values;
+
+  auto selected = Kernels<OutType>::selected[bit_width];
+  while (remaining >= kValuesPerGroup && in_bytes >= group_bytes + kMaxKernelOverread) {
+    selected(in, out);
+    in += group_bytes;
+    in_bytes -= group_bytes;
+    out += kValuesPerGroup;
+    remaining -= kValuesPerGroup;
+  }
+
+  // The last few groups are too close to the end of the buffer for the SIMD
+  // kernels, which may read past the group.
+  auto scalar = Kernels<OutType>::scalar[bit_width];
+  while (remaining >= kValuesPerGroup) {
+    scalar(in, out);
+    in += group_bytes;
+    out += kValuesPerGroup;
+    remaining -= kValuesPerGroup;
+  }
+
+  UnpackTail(bit_width, in, remaining, out);
+  return num_values;
+}
+
+template int64_t UnpackValues<uint8_t>(int bit_width, const uint8_t* in, int64_t in_bytes,
+                                       int64_t num_values, uint8_t* out);
+template int64_t UnpackValues<uint16_t>(int bit_width, const uint8_t* in, int64_t in_bytes,
+                                        int64_t num_values, uint16_t* out);
+template int64_t UnpackValues<uint32_t>(int bit_width, const uint8_t* in, int64_t in_bytes,
+                                        int64_t num_values, uint32_t* out);
+template int64_t UnpackValues<uint64_t>(int bit_width, const uint8_t* in, int64_t in_bytes,
+                                        int64_t num_values, uint64_t* out);
+
+const char* SelectedKernelName() {
+  return g_selected_kernel_name;
+}
+
+} // namespace bitpacking
+} // namespace kudu
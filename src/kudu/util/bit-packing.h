@@ -0,0 +1,54 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_BIT_PACKING_H
+#define KUDU_UTIL_BIT_PACKING_H
+
+#include <stdint.h>
+
+namespace kudu {
+namespace bitpacking {
+
+// Batch decoder for values bit-packed by BitWriter::PutValue(), i.e. packed
+// back to back starting at the least significant bit of each little-endian
+// byte.
+//
+// Decodes at most 'num_values' values of 'bit_width' bits each from 'in' into
+// 'out'. 'in' must point to the start of the first value (i.e. the packed
+// values must begin on a byte boundary) and 'in_bytes' is the number of bytes
+// which may be read from 'in'.
+//
+// Returns the number of values decoded. This is less than 'num_values' only
+// if 'in_bytes' does not hold enough bits.
+//
+// Whole groups of 32 values are decoded by kernels selected once at startup
+// according to the CPU features (AVX2, SSE4.1 or portable); any trailing
+// values are decoded one at a time.
+//
+// 'bit_width' must be between 1 and 32 and no wider than OutType, which may be
+// any of uint8_t, uint16_t, uint32_t or uint64_t.
+template<typename OutType>
+int64_t UnpackValues(int bit_width, const uint8_t* in, int64_t in_bytes,
+                     int64_t num_values, OutType* out);
+
+// Returns the name of the kernel set selected at startup ("avx2", "sse4.1"
+// or "scalar"). Exposed for benchmarks and tests.
+const char* SelectedKernelName();
+
+} // namespace bitpacking
+} // namespace kudu
+
+#endif
@@ -100,6 +100,13 @@ class BitReader {
   template<typename T>
   bool GetValue(int num_bits, T* v);
 
+  // Gets up to 'num_values' values of 'num_bits' each into 'v'. Returns the number
+  // of values read, which is less than 'num_values' only if there are not enough
+  // bytes left. Once the stream is byte-aligned, values are decoded in bulk by the
+  // kernels in bit-packing.h, so this is much faster than repeated GetValue() calls.
+  template<typename T>
+  int GetBatch(int num_bits, T* v, int num_values);
+
   // Reads a 'num_bytes'-sized value from the buffer and stores it in 'v'. T needs to be a
   // little-endian native type and big enough to store 'num_bytes'. The value is assumed
   // to be byte-aligned so the stream will be advanced to the start of the next byte
@@ -20,6 +20,7 @@
 #include <algorithm>
 
 #include "glog/logging.h"
+#include "kudu/util/bit-packing.h"
 #include "kudu/util/bit-stream-utils.h"
 #include "kudu/util/alignment.h"
 
@@ -131,6 +132,44 @@ inline bool BitReader::GetValue(int num_bits, T* v) {
   return true;
 }
 
+namespace internal {
+// The unsigned integer type of a given size, used to hand values of any of the
+// integer types (or bool) to bitpacking::UnpackValues().
+template<int SIZE> struct UnpackedType;
+template<> struct UnpackedType<1> { typedef uint8_t type; };
+template<> struct UnpackedType<2> { typedef uint16_t type; };
+template<> struct UnpackedType<4> { typedef uint32_t type; };
+template<> struct UnpackedType<8> { typedef uint64_t type; };
+} // namespace internal
+
+template<typename T>
+inline int BitReader::GetBatch(int num_bits, T* v, int num_values) {
+  DCHECK_LE(num_bits, 64);
+  DCHECK_LE(num_bits, sizeof(T) * 8);
+
+  int i = 0;
+  // The batch kernels only handle values of up to 32 bits which start on a
+  // byte boundary: read values one at a time until then.
+  while (i < num_values && (num_bits > 32 || bit_offset_ % 8 != 0)) {
+    if (PREDICT_FALSE(!GetValue(num_bits, &v[i]))) return i;
+    ++i;
+  }
+  if (i == num_values) return i;
+
+  typedef typename internal::UnpackedType<sizeof(T)>::type UnpackedType;
+  int byte_pos = byte_offset_ + bit_offset_ / 8;
+  int64_t num_read = bitpacking::UnpackValues(
+      num_bits, buffer_ + byte_pos, max_bytes_ - byte_pos, num_values - i,
+      reinterpret_cast<UnpackedType*>(v + i));
+
+  int64_t new_position = static_cast<int64_t>(byte_pos) * 8 + num_read * num_bits;
+  byte_offset_ = new_position / 8;
+  bit_offset_ = new_position % 8;
+  buffered_values_ = 0;
+  BufferValues();
+  return i + num_read;
+}
+
 inline void BitReader::Rewind(int num_bits) {
   bit_offset_ -= num_bits;
   if (bit_offset_ >= 0) {
@@ -121,6 +121,23 @@ class BlockingQueue {
     }
   }
 
+  // Get all elements currently in the queue, without waiting for any, and
+  // append them to a vector. Returns false if the queue was empty.
+  bool DrainTo(std::vector<T>* out) {
+    MutexLock l(lock_);
+    if (list_.empty()) {
+      return false;
+    }
+    out->reserve(out->size() + list_.size());
+    for (const T& elt : list_) {
+      out->push_back(elt);
+      decrement_size_unlocked(elt);
+    }
+    list_.clear();
+    not_full_.Signal();
+    return true;
+  }
+
   // Attempts to put the given value in the queue.
   // Returns:
   //   QUEUE_SUCCESS: if successfully inserted
@@ -84,4 +84,42 @@ TEST(TestBloomFilter, TestInsertAndProbe) {
   ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
 }
 
+TEST(TestBloomFilter, TestBlockedInsertAndProbe) {
+  int n_keys = 20000;
+  BloomFilterBuilder bfb(
+    BloomFilterSizing::ByCountAndFPRate(n_keys, 0.01)
+    .WithLayout(BloomFilterLayout::kBlocked));
+  ASSERT_EQ(BloomFilterLayout::kBlocked, bfb.layout());
+  ASSERT_EQ(0, bfb.n_bytes() % BloomFilter::kBucketBytes);
+  ASSERT_EQ(BloomFilter::kBucketWords, bfb.n_hashes());
+
+  // The blocked layout trades a slightly higher false positive rate for
+  // touching a single cache line per key.
+  double expected_fp_rate = bfb.false_positive_rate();
+  ASSERT_GT(expected_fp_rate, 0.01);
+  ASSERT_LT(expected_fp_rate, 0.02);
+
+  AddRandomKeys(kRandomSeed, n_keys, &bfb);
+
+  BloomFilter bf(bfb.slice(), bfb.n_hashes(), BloomFilterLayout::kBlocked);
+  CheckRandomKeys(kRandomSeed, n_keys, bf);
+
+  uint32_t num_queries = 100000;
+  uint32_t num_positives = 0;
+  for (int i = 0; i < num_queries; i++) {
+    uint64_t key = random();
+    Slice key_slice(reinterpret_cast<const uint8_t *>(&key), sizeof(key));
+    BloomKeyProbe probe(key_slice);
+    bf.Prefetch(probe);
+    if (bf.MayContainKey(probe)) {
+      num_positives++;
+    }
+  }
+
+  double fp_rate = static_cast<double>(num_positives) / static_cast<double>(num_queries);
+  LOG(INFO) << "FP rate: " << fp_rate << " (" << num_positives << "/" << num_queries << ")";
+  LOG(INFO) << "Expected FP rate: " << expected_fp_rate;
+  ASSERT_NEAR(fp_rate, expected_fp_rate, 0.20*expected_fp_rate);
+}
+
 } // namespace kudu
@@ -53,10 +53,23 @@ BloomFilterSizing BloomFilterSizing::BySizeAndFPRate(size_t n_bytes, double fp_r
 }
 
 
+static size_t BloomFilterBytes(const BloomFilterSizing &sizing) {
+  if (sizing.layout() != BloomFilterLayout::kBlocked) {
+    return sizing.n_bytes();
+  }
+  // A blocked filter holds a whole number of buckets.
+  size_t n_bytes = sizing.n_bytes() / BloomFilter::kBucketBytes * BloomFilter::kBucketBytes;
+  CHECK_GT(n_bytes, 0) << "bloom filter of " << sizing.n_bytes() << " bytes is too small";
+  return n_bytes;
+}
+
 BloomFilterBuilder::BloomFilterBuilder(const BloomFilterSizing &sizing)
-  : n_bits_(sizing.n_bytes() * 8),
-    bitmap_(new uint8_t[sizing.n_bytes()]),
-    n_hashes_(ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
+  : layout_(sizing.layout()),
+    n_bits_(BloomFilterBytes(sizing) * 8),
+    bitmap_(new uint8_t[n_bits_ / 8]),
+    n_hashes_(layout_ == BloomFilterLayout::kBlocked ?
+              BloomFilter::kBucketWords :
+              ComputeOptimalHashCount(n_bits_, sizing.expected_count())),
     expected_count_(sizing.expected_count()),
     n_inserted_(0) {
   Clear();
@@ -72,14 +85,35 @@ double BloomFilterBuilder::false_positive_rate() const {
     << "expected_count_ not initialized: can't call this function on "
     << "a BloomFilter initialized from external data";
 
+  if (layout_ == BloomFilterLayout::kBlocked) {
+    // The number of keys in a bucket is roughly Poisson distributed; a
+    // lookup is a false positive if each of the bits it tests in its
+    // bucket was set by one of the keys there.
+    const double mean_keys = static_cast<double>(expected_count_) * BloomFilter::kBucketBytes * 8 /
+        n_bits_;
+    const int bucket_bits = BloomFilter::kBucketBytes * 8 / BloomFilter::kBucketWords;
+    double rate = 0;
+    double p_keys = exp(-mean_keys);  // P(bucket holds 'keys' keys)
+    for (int keys = 0; keys < mean_keys * 4 + 20; keys++) {
+      rate += p_keys * pow(1 - pow(1 - 1.0 / bucket_bits, keys), BloomFilter::kBucketWords);
+      p_keys *= mean_keys / (keys + 1);
+    }
+    return rate;
+  }
   return pow(1 - exp(-static_cast<double>(n_hashes_) * expected_count_ / n_bits_), n_hashes_);
 }
 
-BloomFilter::BloomFilter(const Slice &data, size_t n_hashes)
-  : n_bits_(data.size() * 8),
+const size_t BloomFilter::kBucketBytes;
+const size_t BloomFilter::kBucketWords;
+
+BloomFilter::BloomFilter(const Slice &data, size_t n_hashes, BloomFilterLayout layout)
+  : layout_(layout),
+    n_bits_(data.size() * 8),
     bitmap_(reinterpret_cast<const uint8_t *>(data.data())),
-    n_hashes_(n_hashes)
-{}
+    n_hashes_(layout == BloomFilterLayout::kBlocked ? kBucketWords : n_hashes) {
+  DCHECK(layout != BloomFilterLayout::kBlocked ||
+         (data.size() > 0 && data.size() % kBucketBytes == 0)) << data.size();
+}
 
 
 
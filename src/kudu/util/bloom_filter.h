@@ -17,9 +17,14 @@
 #ifndef KUDU_UTIL_BLOOM_FILTER_H
 #define KUDU_UTIL_BLOOM_FILTER_H
 
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/hash/city.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/gutil/port.h"
 #include "kudu/util/bitmap.h"
 #include "kudu/util/slice.h"
 
@@ -73,6 +78,11 @@ class BloomKeyProbe {
     return h + h_2_;
   }
 
+  // The second calculated hash value, independent of initial_hash().
+  uint32_t secondary_hash() const {
+    return h_2_;
+  }
+
  private:
   Slice key_;
 
@@ -81,6 +91,23 @@ class BloomKeyProbe {
   uint32_t h_2_;
 };
 
+// How the bits set for a key are placed in a bloom filter.
+enum class BloomFilterLayout {
+  // Each of the key's hashes picks a bit anywhere in the filter, so a lookup
+  // touches up to one cache line per hash.
+  kSpread,
+
+  // The filter is split into 32-byte buckets of eight 32-bit words. The key's
+  // first hash picks a bucket and its second hash picks one bit in each word
+  // of it, so a lookup touches a single cache line and the bucket can be
+  // tested with a couple of SIMD instructions. For the same size, the false
+  // positive rate is somewhat higher than with kSpread.
+  //
+  // See "Cache-, Hash- and Space-Efficient Bloom Filters", Putze et al.,
+  // WEA 2007.
+  kBlocked
+};
+
 // Sizing parameters for the constructor to BloomFilterBuilder.
 // This is simply to provide a nicer API than a bunch of overloaded
 // constructors.
@@ -96,17 +123,28 @@ class BloomFilterSizing {
   // Picks the number of bytes to achieve the above.
   static BloomFilterSizing ByCountAndFPRate(size_t expected_count, double fp_rate);
 
+  // Return a copy of this sizing for filters with the given layout.
+  // The default is BloomFilterLayout::kSpread.
+  BloomFilterSizing WithLayout(BloomFilterLayout layout) const {
+    BloomFilterSizing ret(*this);
+    ret.layout_ = layout;
+    return ret;
+  }
+
   size_t n_bytes() const { return n_bytes_; }
   size_t expected_count() const { return expected_count_; }
+  BloomFilterLayout layout() const { return layout_; }
 
  private:
   BloomFilterSizing(size_t n_bytes, size_t expected_count) :
     n_bytes_(n_bytes),
-    expected_count_(expected_count)
+    expected_count_(expected_count),
+    layout_(BloomFilterLayout::kSpread)
   {}
 
   size_t n_bytes_;
   size_t expected_count_;
+  BloomFilterLayout layout_;
 };
 
 
@@ -144,6 +182,8 @@ class BloomFilterBuilder {
   // in the bloom filter.
   size_t n_hashes() const { return n_hashes_; }
 
+  BloomFilterLayout layout() const { return layout_; }
+
   size_t expected_count() const { return expected_count_; }
 
   // Return the number of keys inserted.
@@ -152,6 +192,8 @@ class BloomFilterBuilder {
  private:
   DISALLOW_COPY_AND_ASSIGN(BloomFilterBuilder);
 
+  const BloomFilterLayout layout_;
+
   size_t n_bits_;
   gscoped_array<uint8_t> bitmap_;
 
@@ -169,15 +211,39 @@ class BloomFilterBuilder {
 // Wrapper around a byte array for reading it as a bloom filter.
 class BloomFilter {
  public:
-  BloomFilter(const Slice &data, size_t n_hashes);
+  // The size of the buckets of a BloomFilterLayout::kBlocked filter, and the
+  // number of 32-bit words (and so of bits set per key) in each.
+  static const size_t kBucketBytes = 32;
+  static const size_t kBucketWords = kBucketBytes / sizeof(uint32_t);
+
+  // 'data' must be a whole number of buckets if 'layout' is kBlocked, in
+  // which case 'n_hashes' is ignored.
+  BloomFilter(const Slice &data, size_t n_hashes,
+              BloomFilterLayout layout = BloomFilterLayout::kSpread);
 
   // Return true if the filter may contain the given key.
   bool MayContainKey(const BloomKeyProbe &probe) const;
 
+  // Prefetch the parts of the bitmap which MayContainKey() reads for
+  // 'probe', so that a batch of probes can overlap their cache misses.
+  void Prefetch(const BloomKeyProbe &probe) const;
+
  private:
   friend class BloomFilterBuilder;
   static uint32_t PickBit(uint32_t hash, size_t n_bits);
 
+  // Return the offset of the kBlocked bucket picked by 'probe' in a filter
+  // of 'n_bytes' bytes.
+  static size_t PickBucket(const BloomKeyProbe &probe, size_t n_bytes);
+
+  // Set the kBucketWords 'masks' to the bit of each word of a kBlocked
+  // bucket which is set for 'probe'.
+  static void MakeBucketMasks(const BloomKeyProbe &probe, uint32_t *masks);
+
+  bool BlockedMayContainKey(const BloomKeyProbe &probe) const;
+
+  BloomFilterLayout layout_;
+
   size_t n_bits_;
   const uint8_t *bitmap_;
 
@@ -201,7 +267,39 @@ inline uint32_t BloomFilter::PickBit(uint32_t hash, size_t n_bits) {
   }
 }
 
+inline size_t BloomFilter::PickBucket(const BloomKeyProbe &probe, size_t n_bytes) {
+  // Multiply-shift maps the hash uniformly onto [0, n_buckets) without a
+  // division.
+  uint64_t n_buckets = n_bytes / kBucketBytes;
+  return ((probe.initial_hash() * n_buckets) >> 32) * kBucketBytes;
+}
+
+inline void BloomFilter::MakeBucketMasks(const BloomKeyProbe &probe, uint32_t *masks) {
+  // Odd multipliers which spread the hash into independent bit positions,
+  // as in Impala's split block bloom filter.
+  static const uint32_t kSalts[kBucketWords] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+  };
+  uint32_t h = probe.secondary_hash();
+  for (size_t i = 0; i < kBucketWords; i++) {
+    masks[i] = 1U << ((h * kSalts[i]) >> 27);
+  }
+}
+
 inline void BloomFilterBuilder::AddKey(const BloomKeyProbe &probe) {
+  if (layout_ == BloomFilterLayout::kBlocked) {
+    uint32_t masks[BloomFilter::kBucketWords];
+    BloomFilter::MakeBucketMasks(probe, masks);
+    uint8_t *bucket = &bitmap_[BloomFilter::PickBucket(probe, n_bytes())];
+    for (size_t i = 0; i < BloomFilter::kBucketWords; i++) {
+      uint8_t *word = bucket + i * sizeof(uint32_t);
+      UNALIGNED_STORE32(word, UNALIGNED_LOAD32(word) | masks[i]);
+    }
+    n_inserted_++;
+    return;
+  }
+
   uint32_t h = probe.initial_hash();
   for (size_t i = 0; i < n_hashes_; i++) {
     uint32_t bitpos = BloomFilter::PickBit(h, n_bits_);
@@ -211,7 +309,43 @@ inline void BloomFilterBuilder::AddKey(const BloomKeyProbe &probe) {
   n_inserted_++;
 }
 
+inline void BloomFilter::Prefetch(const BloomKeyProbe &probe) const {
+  if (layout_ == BloomFilterLayout::kBlocked) {
+    prefetch(reinterpret_cast<const char *>(&bitmap_[PickBucket(probe, n_bits_ / 8)]),
+             PREFETCH_HINT_T0);
+    return;
+  }
+  uint32_t h = probe.initial_hash();
+  for (size_t i = 0; i < n_hashes_; i++) {
+    uint32_t bitpos = PickBit(h, n_bits_);
+    prefetch(reinterpret_cast<const char *>(&bitmap_[bitpos / 8]), PREFETCH_HINT_T0);
+    h = probe.MixHash(h);
+  }
+}
+
+inline bool BloomFilter::BlockedMayContainKey(const BloomKeyProbe &probe) const {
+  uint32_t masks[kBucketWords];
+  MakeBucketMasks(probe, masks);
+  const uint8_t *bucket = &bitmap_[PickBucket(probe, n_bits_ / 8)];
+#ifdef __SSE4_1__
+  // _mm_testc_si128(a, b) is set if every bit of 'b' is set in 'a'.
+  const __m128i *b = reinterpret_cast<const __m128i *>(bucket);
+  const __m128i *m = reinterpret_cast<const __m128i *>(masks);
+  return _mm_testc_si128(_mm_loadu_si128(b), _mm_loadu_si128(m)) &
+         _mm_testc_si128(_mm_loadu_si128(b + 1), _mm_loadu_si128(m + 1));
+#else
+  uint32_t missing = 0;
+  for (size_t i = 0; i < kBucketWords; i++) {
+    missing |= masks[i] & ~UNALIGNED_LOAD32(bucket + i * sizeof(uint32_t));
+  }
+  return missing == 0;
+#endif
+}
+
 inline bool BloomFilter::MayContainKey(const BloomKeyProbe &probe) const {
+  if (layout_ == BloomFilterLayout::kBlocked) {
+    return BlockedMayContainKey(probe);
+  }
   uint32_t h = probe.initial_hash();
 
   // Basic unrolling by 2s gives a small benefit here since the two bit positions
@@ -6,8 +6,9 @@
 #include <gflags/gflags.h>
 #include <gtest/gtest.h>
 #include <memory>
-
+#include <thread>
 #include <vector>
+#include "kudu/gutil/casts.h"
 #include "kudu/util/cache.h"
 #include "kudu/util/coding.h"
 #include "kudu/util/mem_tracker.h"
@@ -18,6 +19,11 @@
 DECLARE_string(nvm_cache_path);
 #endif // defined(__linux__)
 
+DECLARE_bool(cache_force_single_shard);
+
+METRIC_DECLARE_counter(block_cache_probationary_segment_hits);
+METRIC_DECLARE_counter(block_cache_protected_segment_hits);
+
 namespace kudu {
 
 // Conversions between numeric keys/values and the types expected by Cache.
@@ -81,13 +87,24 @@ class CacheTest : public KuduTest,
     return r;
   }
 
-  void Insert(int key, int value, int charge = 1) {
+  // If 'track_evictions' is false, evicted entries aren't recorded in
+  // 'evicted_keys_' and 'evicted_values_', which aren't thread-safe.
+  void Insert(int key, int value, int charge = 1, bool track_evictions = true) {
     string key_str = EncodeInt(key);
     string val_str = EncodeInt(value);
     Cache::PendingHandle* handle = CHECK_NOTNULL(cache_->Allocate(key_str, val_str.size(), charge));
     memcpy(cache_->MutableValue(handle), val_str.data(), val_str.size());
 
-    cache_->Release(cache_->Insert(handle, this));
+    cache_->Release(cache_->Insert(handle, track_evictions ? this : nullptr));
+  }
+
+  void InsertCold(int key, int value, int charge = 1) {
+    string key_str = EncodeInt(key);
+    string val_str = EncodeInt(value);
+    Cache::PendingHandle* handle = CHECK_NOTNULL(cache_->Allocate(key_str, val_str.size(), charge));
+    memcpy(cache_->MutableValue(handle), val_str.data(), val_str.size());
+
+    cache_->Release(cache_->InsertCold(handle, this));
   }
 
   void Erase(int key) {
@@ -225,10 +242,147 @@ TEST_P(CacheTest, HeavyEntries) {
   ASSERT_LE(cached_weight, kCacheSize + kCacheSize/10);
 }
 
+// Lookups only take the shard lock in shared mode; make sure they can run
+// concurrently with inserts and evictions.
+TEST_P(CacheTest, ConcurrentLookupsAndInserts) {
+  const int kNumThreads = 8;
+  const int kNumOps = 10000;
+  const int kSizePerElem = kCacheSize / 100;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (int i = 0; i < kNumOps; i++) {
+        int key = (t * kNumOps + i) % 500;
+        int val = Lookup(key);
+        if (val == -1) {
+          Insert(key, key + 1000, kSizePerElem, false);
+        } else {
+          CHECK_EQ(key + 1000, val);
+        }
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
 TEST_P(CacheTest, NewId) {
   uint64_t a = cache_->NewId();
   uint64_t b = cache_->NewId();
   ASSERT_NE(a, b);
 }
 
+// Tests for the SLRU eviction policy, which only the DRAM cache supports.
+class SLRUCacheTest : public CacheTest {
+ public:
+  virtual void SetUp() OVERRIDE {
+    // Use a single shard so that the segment capacities are exact.
+    FLAGS_cache_force_single_shard = true;
+    cache_.reset(NewCache(DRAM_CACHE, CacheEvictionPolicy::SLRU, kCacheSize, "cache_test"));
+    entity_ = METRIC_ENTITY_server.Instantiate(&metric_registry_, "test");
+    cache_->SetMetrics(entity_);
+  }
+
+  int64_t CounterValue(const CounterPrototype& proto) {
+    return down_cast<Counter*>(entity_->FindOrNull(proto).get())->value();
+  }
+
+  scoped_refptr<MetricEntity> entity_;
+};
+
+TEST_F(SLRUCacheTest, ScanResistance) {
+  const int kNumElems = 1000;
+  const int kSizePerElem = kCacheSize / kNumElems;
+  const int kNumHot = 100;
+
+  // Hit each of the "hot" entries twice: first in the probationary segment,
+  // which promotes them, then in the protected segment.
+  for (int i = 0; i < kNumHot; i++) {
+    Insert(i, 1000+i, kSizePerElem);
+  }
+  for (int i = 0; i < kNumHot; i++) {
+    ASSERT_EQ(1000+i, Lookup(i));
+    ASSERT_EQ(1000+i, Lookup(i));
+  }
+  ASSERT_EQ(kNumHot, CounterValue(METRIC_block_cache_probationary_segment_hits));
+  ASSERT_EQ(kNumHot, CounterValue(METRIC_block_cache_protected_segment_hits));
+
+  // A scan inserting more entries than the cache can hold, without ever
+  // looking them up again, only churns the probationary segment.
+  for (int i = 0; i < 2 * kNumElems; i++) {
+    Insert(10000+i, 20000+i, kSizePerElem);
+  }
+  for (int i = 0; i < kNumHot; i++) {
+    ASSERT_EQ(1000+i, Lookup(i));
+  }
+  ASSERT_EQ(2 * kNumHot, CounterValue(METRIC_block_cache_protected_segment_hits));
+
+  // The start of the scan was evicted, the end wasn't.
+  ASSERT_EQ(-1, Lookup(10000));
+  ASSERT_EQ(20000 + 2 * kNumElems - 1, Lookup(10000 + 2 * kNumElems - 1));
+}
+
+TEST_F(SLRUCacheTest, ProtectedSegmentIsBounded) {
+  const int kNumElems = 1000;
+  const int kSizePerElem = kCacheSize / kNumElems;
+
+  // Promote every entry. Once the protected segment is full, the oldest
+  // protected entries are demoted rather than evicted, and the cache as a
+  // whole stays within its capacity.
+  for (int i = 0; i < 2 * kNumElems; i++) {
+    Insert(i, 1000+i, kSizePerElem);
+    ASSERT_EQ(1000+i, Lookup(i));
+  }
+  int cached = 0;
+  for (int i = 0; i < 2 * kNumElems; i++) {
+    if (Lookup(i) >= 0) {
+      cached++;
+    }
+  }
+  ASSERT_LE(cached, kNumElems);
+  ASSERT_GE(cached, kNumElems * 9 / 10);
+  // The most recently promoted entry survived.
+  ASSERT_EQ(1000 + 2 * kNumElems - 1, Lookup(2 * kNumElems - 1));
+}
+
+// Hot keys list the protected entries first, then the probationary ones,
+// each from the most recently inserted or promoted.
+TEST_F(SLRUCacheTest, HotKeys) {
+  for (int i = 0; i < 10; i++) {
+    Insert(i, 1000+i);
+  }
+  ASSERT_EQ(1003, Lookup(3));
+  ASSERT_EQ(1005, Lookup(5));
+
+  vector<string> keys;
+  cache_->GetHotKeys(4, &keys);
+  vector<int> hot;
+  for (const string& k : keys) {
+    hot.push_back(DecodeInt(k));
+  }
+  ASSERT_EQ((vector<int>{ 5, 3, 9, 8 }), hot);
+}
+
+// Cold entries are the first to go, so a run of them only displaces the
+// oldest warm entry, unless they're looked up before being evicted.
+TEST_F(SLRUCacheTest, ColdInsertions) {
+  const int kSizePerElem = kCacheSize / 10;
+  for (int i = 0; i < 10; i++) {
+    Insert(i, 1000+i, kSizePerElem);
+  }
+  InsertCold(100, 1100, kSizePerElem);
+  InsertCold(101, 1101, kSizePerElem);
+  ASSERT_EQ(-1, Lookup(100));
+  ASSERT_EQ(1101, Lookup(101));
+
+  // Having been used, '101' now survives the next eviction.
+  Insert(10, 1010, kSizePerElem);
+  ASSERT_EQ(1101, Lookup(101));
+  ASSERT_EQ((vector<int>{ 0, 100, 1 }), evicted_keys_);
+  for (int i = 2; i <= 10; i++) {
+    ASSERT_EQ(1000+i, Lookup(i));
+  }
+}
+
 }  // namespace kudu
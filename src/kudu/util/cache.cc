@@ -2,6 +2,7 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
 #include <cstdlib>
 #include <memory>
 #include <mutex>
@@ -35,6 +36,22 @@ DEFINE_bool(cache_force_single_shard, false,
             "Override all cache implementations to use just one shard");
 TAG_FLAG(cache_force_single_shard, hidden);
 
+DEFINE_double(cache_slru_protected_ratio, 0.8,
+              "Fraction of the capacity of caches using the SLRU eviction policy "
+              "which may be taken by the protected segment, i.e. by entries which "
+              "have been hit since they were inserted.");
+TAG_FLAG(cache_slru_protected_ratio, advanced);
+
+static bool ValidateProtectedRatio(const char* flagname, double value) {
+  if (value > 0 && value < 1) {
+    return true;
+  }
+  LOG(ERROR) << flagname << " must be strictly between 0 and 1, value " << value << " is invalid";
+  return false;
+}
+static bool dummy = google::RegisterFlagValidator(
+    &FLAGS_cache_slru_protected_ratio, &ValidateProtectedRatio);
+
 namespace kudu {
 
 class MetricEntity;
@@ -63,6 +80,10 @@ struct LRUHandle {
   uint32_t val_length;
   Atomic32 refs;
   uint32_t hash;      // Hash of key(); used for fast sharding and comparisons
+  bool in_protected;  // Whether the entry is in the protected SLRU segment
+  // Set by lookups, which don't reorder the LRU lists, and cleared when the
+  // entry is given a second chance instead of being evicted or demoted.
+  Atomic32 referenced;
 
   // The storage for the key/value pair itself. The data is stored as:
   //   [key bytes ...] [padding up to 8-byte boundary] [value bytes ...]
@@ -181,17 +202,39 @@ class LRUCache {
   // Separate from constructor so caller can easily make an array of LRUCache
   void SetCapacity(size_t capacity) { capacity_ = capacity; }
 
+  // Use the SLRU eviction policy, with at most 'capacity' of the entries'
+  // charge in the protected segment. Must be called before any inserts.
+  void SetProtectedCapacity(size_t capacity) { protected_capacity_ = capacity; }
+
   void SetMetrics(CacheMetrics* metrics) { metrics_ = metrics; }
 
-  Cache::Handle* Insert(LRUHandle* handle, Cache::EvictionCallback* eviction_callback);
+  // If 'cold' is true, the entry is inserted as the oldest entry of the
+  // probationary list instead of the newest one.
+  Cache::Handle* Insert(LRUHandle* handle, Cache::EvictionCallback* eviction_callback,
+                        bool cold);
   // Like Cache::Lookup, but with an extra "hash" parameter.
   Cache::Handle* Lookup(const Slice& key, uint32_t hash, bool caching);
   void Release(Cache::Handle* handle);
   void Erase(const Slice& key, uint32_t hash);
+  // Append the keys of up to 'max_keys' entries, protected entries first,
+  // each list from its newest entry.
+  void GetHotKeys(size_t max_keys, vector<string>* keys);
 
  private:
   void LRU_Remove(LRUHandle* e);
+  // Append 'e' as the newest entry of the probationary (or only) list.
   void LRU_Append(LRUHandle* e);
+  // Prepend 'e' as the oldest entry of the probationary (or only) list.
+  // Unlike LRU_Append(), doesn't account for the entry's charge.
+  void LRU_Prepend(LRUHandle* e);
+  // Append 'e' as the newest entry of the protected list, demoting the
+  // oldest unreferenced protected entries if it's over capacity.
+  void Protected_Append(LRUHandle* e);
+
+  // Return the next entry to evict, or nullptr if the shard is empty.
+  // Referenced entries found on the way are moved to the newest end of their
+  // list with their reference bit cleared (CLOCK-style second chance).
+  LRUHandle* NextToEvict();
   // Just reduce the reference count by 1.
   // Return true if last reference
   bool Unref(LRUHandle* e);
@@ -201,14 +244,23 @@ class LRUCache {
   // Initialized before use.
   size_t capacity_;
 
-  // mutex_ protects the following state.
-  MutexType mutex_;
+  // Zero unless using the SLRU eviction policy.
+  size_t protected_capacity_;
+
+  // mutex_ protects the following state. Lookups only take it in shared
+  // mode.
+  rw_spinlock mutex_;
   size_t usage_;
+  size_t protected_usage_;
 
   // Dummy head of LRU list.
   // lru.prev is newest entry, lru.next is oldest entry.
+  // With SLRU, this is the probationary segment.
   LRUHandle lru_;
 
+  // Dummy head of the protected SLRU segment's list, ordered like lru_.
+  LRUHandle protected_lru_;
+
   HandleTable table_;
 
   MemTracker* mem_tracker_;
@@ -217,22 +269,38 @@ class LRUCache {
 };
 
 LRUCache::LRUCache(MemTracker* tracker)
- : usage_(0),
+ : protected_capacity_(0),
+   usage_(0),
+   protected_usage_(0),
    mem_tracker_(tracker),
    metrics_(nullptr) {
-  // Make empty circular linked list
+  // Make empty circular linked lists
   lru_.next = &lru_;
   lru_.prev = &lru_;
+  protected_lru_.next = &protected_lru_;
+  protected_lru_.prev = &protected_lru_;
 }
 
 LRUCache::~LRUCache() {
-  for (LRUHandle* e = lru_.next; e != &lru_; ) {
-    LRUHandle* next = e->next;
-    DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
-    if (Unref(e)) {
-      FreeEntry(e);
+  for (LRUHandle* list : { &lru_, &protected_lru_ }) {
+    for (LRUHandle* e = list->next; e != list; ) {
+      LRUHandle* next = e->next;
+      DCHECK_EQ(e->refs, 1);  // Error if caller has an unreleased handle
+      if (Unref(e)) {
+        FreeEntry(e);
+      }
+      e = next;
+    }
+  }
+}
+
+void LRUCache::GetHotKeys(size_t max_keys, vector<string>* keys) {
+  shared_lock<rw_spinlock> l(mutex_);
+  size_t n = 0;
+  for (LRUHandle* list : { &protected_lru_, &lru_ }) {
+    for (LRUHandle* e = list->prev; e != list && n < max_keys; e = e->prev, n++) {
+      keys->push_back(e->key().ToString());
     }
-    e = next;
   }
 }
 
@@ -258,6 +326,9 @@ void LRUCache::LRU_Remove(LRUHandle* e) {
   e->next->prev = e->prev;
   e->prev->next = e->next;
   usage_ -= e->charge;
+  if (e->in_protected) {
+    protected_usage_ -= e->charge;
+  }
 }
 
 void LRUCache::LRU_Append(LRUHandle* e) {
@@ -266,18 +337,98 @@ void LRUCache::LRU_Append(LRUHandle* e) {
   e->prev = lru_.prev;
   e->prev->next = e;
   e->next->prev = e;
+  e->in_protected = false;
   usage_ += e->charge;
 }
 
+void LRUCache::LRU_Prepend(LRUHandle* e) {
+  e->next = lru_.next;
+  e->prev = &lru_;
+  e->prev->next = e;
+  e->next->prev = e;
+  e->in_protected = false;
+}
+
+void LRUCache::Protected_Append(LRUHandle* e) {
+  e->next = &protected_lru_;
+  e->prev = protected_lru_.prev;
+  e->prev->next = e;
+  e->next->prev = e;
+  e->in_protected = true;
+  // The hit which promoted the entry has been accounted for.
+  base::subtle::NoBarrier_Store(&e->referenced, 0);
+  usage_ += e->charge;
+  protected_usage_ += e->charge;
+
+  // Demoted entries get another chance in the probationary segment before
+  // being evicted. This terminates since each entry's reference bit is
+  // cleared at most once.
+  while (protected_usage_ > protected_capacity_) {
+    LRUHandle* old = protected_lru_.next;
+    LRU_Remove(old);
+    if (base::subtle::NoBarrier_Load(&old->referenced)) {
+      base::subtle::NoBarrier_Store(&old->referenced, 0);
+      old->next = &protected_lru_;
+      old->prev = protected_lru_.prev;
+      old->prev->next = old;
+      old->next->prev = old;
+      usage_ += old->charge;
+      protected_usage_ += old->charge;
+    } else {
+      LRU_Append(old);
+    }
+  }
+}
+
+LRUHandle* LRUCache::NextToEvict() {
+  // Evict from the probationary segment first. Without SLRU, everything
+  // is in it.
+  for (LRUHandle* list : { &lru_, &protected_lru_ }) {
+    while (list->next != list) {
+      LRUHandle* e = list->next;
+      if (!base::subtle::NoBarrier_Load(&e->referenced)) {
+        return e;
+      }
+      base::subtle::NoBarrier_Store(&e->referenced, 0);
+      // Move 'e' to the newest end of 'list'.
+      e->next->prev = list;
+      list->next = e->next;
+      e->next = list;
+      e->prev = list->prev;
+      e->prev->next = e;
+      list->prev = e;
+    }
+  }
+  return nullptr;
+}
+
 Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
   LRUHandle* e;
+  bool was_protected = false;
   {
-    std::lock_guard<MutexType> l(mutex_);
+    // Hits don't move the entry in its LRU list, so this doesn't need
+    // exclusive access: the reference bit stands in for the move.
+    shared_lock<rw_spinlock> l(mutex_);
     e = table_.Lookup(key, hash);
     if (e != nullptr) {
       base::RefCountInc(&e->refs);
+      was_protected = e->in_protected;
+      // Avoid dirtying the cache line of an entry that's already referenced.
+      if (!base::subtle::NoBarrier_Load(&e->referenced)) {
+        base::subtle::NoBarrier_Store(&e->referenced, 1);
+      }
+    }
+  }
+
+  // With SLRU, the first hit promotes the entry to the protected segment.
+  // That needs exclusive access, but only happens once per entry.
+  if (e != nullptr && protected_capacity_ > 0 && !was_protected) {
+    std::lock_guard<rw_spinlock> l(mutex_);
+    // The entry may have been erased, replaced, evicted or promoted by
+    // another thread since the shared lock was released.
+    if (!e->in_protected && table_.Lookup(e->key(), hash) == e) {
       LRU_Remove(e);
-      LRU_Append(e);
+      Protected_Append(e);
     }
   }
 
@@ -291,6 +442,13 @@ Cache::Handle* LRUCache::Lookup(const Slice& key, uint32_t hash, bool caching) {
       } else {
         metrics_->cache_hits->Increment();
       }
+      if (protected_capacity_ > 0) {
+        if (was_protected) {
+          metrics_->protected_segment_hits->Increment();
+        } else {
+          metrics_->probationary_segment_hits->Increment();
+        }
+      }
     } else {
       if (caching) {
         metrics_->cache_misses_caching->Increment();
@@ -311,7 +469,8 @@ void LRUCache::Release(Cache::Handle* handle) {
   }
 }
 
-Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_callback) {
+Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_callback,
+                                bool cold) {
 
   // Set the remaining LRUHandle members which were not already allocated during
   // Allocate().
@@ -325,9 +484,15 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
 
   LRUHandle* to_remove_head = nullptr;
   {
-    std::lock_guard<MutexType> l(mutex_);
+    std::lock_guard<rw_spinlock> l(mutex_);
 
-    LRU_Append(e);
+    if (cold) {
+      // The entry is linked in only after making room for it, so that it
+      // doesn't evict itself as the oldest entry.
+      usage_ += e->charge;
+    } else {
+      LRU_Append(e);
+    }
 
     LRUHandle* old = table_.Insert(e);
     if (old != nullptr) {
@@ -338,8 +503,11 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
       }
     }
 
-    while (usage_ > capacity_ && lru_.next != &lru_) {
-      LRUHandle* old = lru_.next;
+    while (usage_ > capacity_) {
+      LRUHandle* old = NextToEvict();
+      if (old == nullptr) {
+        break;
+      }
       LRU_Remove(old);
       table_.Remove(old->key(), old->hash);
       if (Unref(old)) {
@@ -347,6 +515,10 @@ Cache::Handle* LRUCache::Insert(LRUHandle* e, Cache::EvictionCallback *eviction_
         to_remove_head = old;
       }
     }
+
+    if (cold) {
+      LRU_Prepend(e);
+    }
   }
 
   // we free the entries here outside of mutex for
@@ -364,7 +536,7 @@ void LRUCache::Erase(const Slice& key, uint32_t hash) {
   LRUHandle* e;
   bool last_reference = false;
   {
-    std::lock_guard<MutexType> l(mutex_);
+    std::lock_guard<rw_spinlock> l(mutex_);
     e = table_.Remove(key, hash);
     if (e != nullptr) {
       LRU_Remove(e);
@@ -410,7 +582,7 @@ class ShardedLRUCache : public Cache {
   }
 
  public:
-  explicit ShardedLRUCache(size_t capacity, const string& id)
+  ShardedLRUCache(CacheEvictionPolicy policy, size_t capacity, const string& id)
       : last_id_(0),
         shard_bits_(DetermineShardBits()) {
     // A cache is often a singleton, so:
@@ -424,6 +596,10 @@ class ShardedLRUCache : public Cache {
     for (int s = 0; s < num_shards; s++) {
       gscoped_ptr<LRUCache> shard(new LRUCache(mem_tracker_.get()));
       shard->SetCapacity(per_shard);
+      if (policy == CacheEvictionPolicy::SLRU) {
+        shard->SetProtectedCapacity(
+            std::max<size_t>(1, per_shard * FLAGS_cache_slru_protected_ratio));
+      }
       shards_.push_back(shard.release());
     }
   }
@@ -435,7 +611,12 @@ class ShardedLRUCache : public Cache {
   virtual Handle* Insert(PendingHandle* handle,
                          Cache::EvictionCallback* eviction_callback) OVERRIDE {
     LRUHandle* h = reinterpret_cast<LRUHandle*>(DCHECK_NOTNULL(handle));
-    return shards_[Shard(h->hash)]->Insert(h, eviction_callback);
+    return shards_[Shard(h->hash)]->Insert(h, eviction_callback, false);
+  }
+  virtual Handle* InsertCold(PendingHandle* handle,
+                             Cache::EvictionCallback* eviction_callback) OVERRIDE {
+    LRUHandle* h = reinterpret_cast<LRUHandle*>(DCHECK_NOTNULL(handle));
+    return shards_[Shard(h->hash)]->Insert(h, eviction_callback, true);
   }
   virtual Handle* Lookup(const Slice& key, CacheBehavior caching) OVERRIDE {
     const uint32_t hash = HashSlice(key);
@@ -464,6 +645,15 @@ class ShardedLRUCache : public Cache {
     }
   }
 
+  virtual void GetHotKeys(size_t max_keys, vector<string>* keys) OVERRIDE {
+    // Take an equal share from each shard, since keys are spread uniformly.
+    const size_t per_shard = (max_keys + shards_.size() - 1) / shards_.size();
+    const size_t limit = keys->size() + max_keys;
+    for (LRUCache* cache : shards_) {
+      cache->GetHotKeys(std::min(per_shard, limit - keys->size()), keys);
+    }
+  }
+
   virtual PendingHandle* Allocate(Slice key, int val_len, int charge) OVERRIDE {
     int key_len = key.size();
     DCHECK_GE(key_len, 0);
@@ -478,6 +668,7 @@ class ShardedLRUCache : public Cache {
     handle->val_length = val_len;
     handle->charge = charge;
     handle->hash = HashSlice(key);
+    handle->referenced = 0;
     memcpy(handle->kv_data, key.data(), key_len);
 
     return reinterpret_cast<PendingHandle*>(handle);
@@ -497,11 +688,17 @@ class ShardedLRUCache : public Cache {
 }  // end anonymous namespace
 
 Cache* NewLRUCache(CacheType type, size_t capacity, const string& id) {
+  return NewCache(type, CacheEvictionPolicy::LRU, capacity, id);
+}
+
+Cache* NewCache(CacheType type, CacheEvictionPolicy policy, size_t capacity,
+                const string& id) {
   switch (type) {
     case DRAM_CACHE:
-      return new ShardedLRUCache(capacity, id);
+      return new ShardedLRUCache(policy, capacity, id);
 #if !defined(__APPLE__)
     case NVM_CACHE:
+      CHECK(policy == CacheEvictionPolicy::LRU) << "NVM cache only supports LRU eviction";
       return NewLRUNvmCache(capacity, id);
 #endif
     default:
@@ -21,6 +21,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
@@ -37,10 +38,26 @@ enum CacheType {
   NVM_CACHE
 };
 
+enum class CacheEvictionPolicy {
+  // Evict the least recently used entry.
+  LRU,
+
+  // Segmented LRU: entries are inserted into a probationary segment and
+  // moved to a protected segment when they are hit. Entries are evicted from
+  // the probationary segment first, so that a scan touching many entries once
+  // doesn't push out the entries which are used repeatedly.
+  SLRU
+};
+
 // Create a new cache with a fixed size capacity.  This implementation
 // of Cache uses a least-recently-used eviction policy.
 Cache* NewLRUCache(CacheType type, size_t capacity, const std::string& id);
 
+// Like NewLRUCache(), but with the given eviction policy. Only DRAM_CACHE
+// supports CacheEvictionPolicy::SLRU.
+Cache* NewCache(CacheType type, CacheEvictionPolicy policy, size_t capacity,
+                const std::string& id);
+
 class Cache {
  public:
   // Callback interface which is called when an entry is evicted from the
@@ -138,6 +155,11 @@ class Cache {
   // Pass a metric entity in order to start recoding metrics.
   virtual void SetMetrics(const scoped_refptr<MetricEntity>& metric_entity) = 0;
 
+  // Append to 'keys' the keys of up to 'max_keys' of the most recently used
+  // entries, as a best-effort snapshot. Caches which can't enumerate their
+  // entries append nothing.
+  virtual void GetHotKeys(size_t max_keys, std::vector<std::string>* keys) {}
+
   // ------------------------------------------------------------
   // Insertion path
   // ------------------------------------------------------------
@@ -195,6 +217,16 @@ class Cache {
   // entry is later evicted or when the cache shuts down.
   virtual Handle* Insert(PendingHandle* pending, EvictionCallback* eviction_callback) = 0;
 
+  // Like Insert(), but the entry goes in as the next candidate for eviction
+  // rather than as the most recently used one, so that it only displaces
+  // other cold entries unless it is looked up again before being evicted.
+  //
+  // Useful for data which is unlikely to be reused, such as the blocks of a
+  // large scan. Caches without an LRU order treat this like Insert().
+  virtual Handle* InsertCold(PendingHandle* pending, EvictionCallback* eviction_callback) {
+    return Insert(pending, eviction_callback);
+  }
+
   // Free 'ptr', which must have been previously allocated using 'Allocate'.
   virtual void Free(PendingHandle* ptr) = 0;
 
@@ -40,6 +40,10 @@ struct CacheMetrics {
   scoped_refptr<Counter> cache_misses;
   scoped_refptr<Counter> cache_misses_caching;
 
+  // Only incremented by caches using the SLRU eviction policy.
+  scoped_refptr<Counter> probationary_segment_hits;
+  scoped_refptr<Counter> protected_segment_hits;
+
   scoped_refptr<AtomicGauge<uint64_t> > cache_usage;
 };
 
@@ -17,19 +17,26 @@
 
 #include <stdlib.h>
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 
+#include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/compression/compression_codec.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/test_macros.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/status.h"
 
 namespace kudu {
 
+using std::string;
+using std::unique_ptr;
 using std::vector;
+using strings::Substitute;
 
 class TestCompression : public KuduTest {};
 
@@ -85,4 +92,42 @@ TEST_F(TestCompression, TestZlibCompressionCodec) {
   TestCompressionCodec(ZLIB);
 }
 
+TEST_F(TestCompression, TestZstdCompressionCodec) {
+  TestCompressionCodec(ZSTD);
+}
+
+// Train a dictionary on small, similar records and make sure they round-trip
+// through a codec using it.
+TEST_F(TestCompression, TestZstdDictionary) {
+  vector<string> records;
+  for (int i = 0; i < 2000; i++) {
+    records.push_back(Substitute(
+        "{\"id\": $0, \"user\": \"user_$1\", \"status\": \"$2\", \"score\": $3}",
+        i, i % 97, (i % 3 == 0) ? "active" : "inactive", i * 7 % 1000));
+  }
+  vector<Slice> samples(records.begin(), records.end());
+
+  faststring dictionary;
+  ASSERT_OK(TrainCompressionDictionary(ZSTD, samples, 4096, &dictionary));
+  ASSERT_GT(dictionary.size(), 0);
+  ASSERT_LE(dictionary.size(), 4096);
+
+  unique_ptr<CompressionCodec> codec;
+  ASSERT_OK(NewCompressionCodecWithDictionary(ZSTD, Slice(dictionary), &codec));
+  ASSERT_EQ(ZSTD, codec->type());
+
+  for (const Slice& record : samples) {
+    gscoped_array<uint8_t> cbuffer(new uint8_t[codec->MaxCompressedLength(record.size())]);
+    gscoped_array<uint8_t> ubuffer(new uint8_t[record.size()]);
+    size_t compressed;
+    ASSERT_OK(codec->Compress(record, cbuffer.get(), &compressed));
+    ASSERT_OK(codec->Uncompress(Slice(cbuffer.get(), compressed), ubuffer.get(), record.size()));
+    ASSERT_EQ(0, memcmp(record.data(), ubuffer.get(), record.size()));
+  }
+
+  // Dictionaries are only supported for ZSTD.
+  ASSERT_TRUE(NewCompressionCodecWithDictionary(LZ4, Slice(dictionary), &codec).IsNotSupported());
+  ASSERT_TRUE(TrainCompressionDictionary(SNAPPY, samples, 4096, &dictionary).IsNotSupported());
+}
+
 } // namespace kudu
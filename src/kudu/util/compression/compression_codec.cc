@@ -20,17 +20,40 @@
 #include <string>
 #include <vector>
 
+#include <gflags/gflags.h>
 #include <glog/logging.h>
 #include <lz4.h>
 #include <snappy-sinksource.h>
 #include <snappy.h>
+#include <zdict.h>
 #include <zlib.h>
+#include <zstd.h>
 
 
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stringprintf.h"
+#include "kudu/util/flag_tags.h"
 #include "kudu/util/logging.h"
 #include "kudu/util/string_case.h"
+#include "kudu/util/threadlocal.h"
+
+DEFINE_int32(zstd_compression_level, 3,
+             "The compression level used by the ZSTD codec, from 1 to 22. Higher "
+             "levels compress better but more slowly; decompression speed is "
+             "largely unaffected by the level.");
+TAG_FLAG(zstd_compression_level, advanced);
+TAG_FLAG(zstd_compression_level, runtime);
+
+static bool ValidateZstdCompressionLevel(const char* flagname, int32_t value) {
+  if (value >= 1 && value <= ZSTD_maxCLevel()) {
+    return true;
+  }
+  LOG(ERROR) << "Invalid value for " << flagname << ": " << value
+             << ", must be between 1 and " << ZSTD_maxCLevel();
+  return false;
+}
+static bool dummy = google::RegisterFlagValidator(&FLAGS_zstd_compression_level,
+                                                  &ValidateZstdCompressionLevel);
 
 namespace kudu {
 
@@ -241,6 +264,126 @@ class ZlibCodec : public CompressionCodec {
   }
 };
 
+namespace {
+
+// The ZSTD contexts of the current thread. Creating a context allocates its
+// working memory, so contexts are reused rather than created for every block.
+struct ZstdContexts {
+  ZstdContexts()
+      : cctx(ZSTD_createCCtx()),
+        dctx(ZSTD_createDCtx()) {
+    CHECK(cctx != nullptr && dctx != nullptr) << "unable to allocate ZSTD contexts";
+  }
+
+  ~ZstdContexts() {
+    ZSTD_freeCCtx(cctx);
+    ZSTD_freeDCtx(dctx);
+  }
+
+  ZSTD_CCtx* const cctx;
+  ZSTD_DCtx* const dctx;
+};
+
+ZstdContexts* GetZstdContexts() {
+  BLOCK_STATIC_THREAD_LOCAL(ZstdContexts, contexts);
+  return contexts;
+}
+
+} // anonymous namespace
+
+class ZstdCodec : public CompressionCodec {
+ public:
+  static ZstdCodec *GetSingleton() {
+    return Singleton<ZstdCodec>::get();
+  }
+
+  ZstdCodec() : ddict_(nullptr) {
+  }
+
+  ~ZstdCodec() {
+    ZSTD_freeDDict(ddict_);
+  }
+
+  // Makes this codec compress with, and expect data compressed with, the
+  // given dictionary.
+  Status InitDictionary(const Slice& dictionary) {
+    DCHECK(ddict_ == nullptr);
+    dictionary_.assign_copy(dictionary.data(), dictionary.size());
+    // Only the decompression side is digested up front: writers compress
+    // comparatively few blocks, and the digested form depends on the level.
+    ddict_ = ZSTD_createDDict(dictionary_.data(), dictionary_.size());
+    if (ddict_ == nullptr) {
+      return Status::Corruption("unable to load ZSTD dictionary");
+    }
+    return Status::OK();
+  }
+
+  Status Compress(const Slice& input,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    ZSTD_CCtx* cctx = GetZstdContexts()->cctx;
+    size_t n;
+    if (ddict_ != nullptr) {
+      n = ZSTD_compress_usingDict(cctx, compressed, MaxCompressedLength(input.size()),
+                                  input.data(), input.size(),
+                                  dictionary_.data(), dictionary_.size(),
+                                  FLAGS_zstd_compression_level);
+    } else {
+      n = ZSTD_compressCCtx(cctx, compressed, MaxCompressedLength(input.size()),
+                            input.data(), input.size(), FLAGS_zstd_compression_level);
+    }
+    if (ZSTD_isError(n)) {
+      return Status::IOError("unable to compress the buffer", ZSTD_getErrorName(n));
+    }
+    *compressed_length = n;
+    return Status::OK();
+  }
+
+  Status Compress(const vector<Slice>& input_slices,
+                  uint8_t *compressed, size_t *compressed_length) const OVERRIDE {
+    if (input_slices.size() == 1) {
+      return Compress(input_slices[0], compressed, compressed_length);
+    }
+
+    SlicesSource source(input_slices);
+    faststring buffer;
+    source.Dump(&buffer);
+    return Compress(Slice(buffer.data(), buffer.size()), compressed, compressed_length);
+  }
+
+  Status Uncompress(const Slice& compressed,
+                    uint8_t *uncompressed, size_t uncompressed_length) const OVERRIDE {
+    ZSTD_DCtx* dctx = GetZstdContexts()->dctx;
+    size_t n;
+    if (ddict_ != nullptr) {
+      n = ZSTD_decompress_usingDDict(dctx, uncompressed, uncompressed_length,
+                                     compressed.data(), compressed.size(), ddict_);
+    } else {
+      n = ZSTD_decompressDCtx(dctx, uncompressed, uncompressed_length,
+                              compressed.data(), compressed.size());
+    }
+    if (ZSTD_isError(n)) {
+      return Status::Corruption("unable to uncompress the buffer", ZSTD_getErrorName(n));
+    }
+    if (n != uncompressed_length) {
+      return Status::Corruption(
+          StringPrintf("uncompressed %zu bytes, expected %zu", n, uncompressed_length));
+    }
+    return Status::OK();
+  }
+
+  size_t MaxCompressedLength(size_t source_bytes) const OVERRIDE {
+    return ZSTD_compressBound(source_bytes);
+  }
+
+  CompressionType type() const override {
+    return ZSTD;
+  }
+
+ private:
+  faststring dictionary_;
+  ZSTD_DDict* ddict_;
+};
+
 Status GetCompressionCodec(CompressionType compression,
                            const CompressionCodec** codec) {
   switch (compression) {
@@ -256,12 +399,53 @@ Status GetCompressionCodec(CompressionType compression,
     case ZLIB:
       *codec = ZlibCodec::GetSingleton();
       break;
+    case ZSTD:
+      *codec = ZstdCodec::GetSingleton();
+      break;
     default:
       return Status::NotFound("bad compression type");
   }
   return Status::OK();
 }
 
+Status NewCompressionCodecWithDictionary(CompressionType compression,
+                                         const Slice& dictionary,
+                                         std::unique_ptr<CompressionCodec>* codec) {
+  if (compression != ZSTD) {
+    return Status::NotSupported("compression dictionaries are only supported by ZSTD");
+  }
+  std::unique_ptr<ZstdCodec> zstd(new ZstdCodec());
+  RETURN_NOT_OK(zstd->InitDictionary(dictionary));
+  codec->reset(zstd.release());
+  return Status::OK();
+}
+
+Status TrainCompressionDictionary(CompressionType compression,
+                                  const vector<Slice>& samples,
+                                  size_t max_size,
+                                  faststring* dictionary) {
+  if (compression != ZSTD) {
+    return Status::NotSupported("compression dictionaries are only supported by ZSTD");
+  }
+  faststring samples_buf;
+  vector<size_t> sample_sizes;
+  sample_sizes.reserve(samples.size());
+  for (const Slice& sample : samples) {
+    samples_buf.append(sample.data(), sample.size());
+    sample_sizes.push_back(sample.size());
+  }
+  dictionary->resize(max_size);
+  size_t n = ZDICT_trainFromBuffer(dictionary->data(), max_size,
+                                   samples_buf.data(), sample_sizes.data(),
+                                   sample_sizes.size());
+  if (ZDICT_isError(n)) {
+    dictionary->clear();
+    return Status::RuntimeError("unable to train ZSTD dictionary", ZDICT_getErrorName(n));
+  }
+  dictionary->resize(n);
+  return Status::OK();
+}
+
 CompressionType GetCompressionCodecType(const std::string& name) {
   string uname;
   ToUpperCase(name, &uname);
@@ -272,6 +456,8 @@ CompressionType GetCompressionCodecType(const std::string& name) {
     return LZ4;
   if (uname.compare("ZLIB") == 0)
     return ZLIB;
+  if (uname.compare("ZSTD") == 0)
+    return ZSTD;
   if (uname.compare("NONE") == 0)
     return NO_COMPRESSION;
 
@@ -17,11 +17,13 @@
 #ifndef KUDU_CFILE_COMPRESSION_CODEC_H
 #define KUDU_CFILE_COMPRESSION_CODEC_H
 
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "kudu/util/compression/compression.pb.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/faststring.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
@@ -68,6 +70,28 @@ class CompressionCodec {
 Status GetCompressionCodec(CompressionType compression,
                            const CompressionCodec** codec);
 
+// Returns a new codec of the specified type which compresses with, and
+// expects its input to have been compressed with, the given dictionary.
+// Unlike the codecs returned by GetCompressionCodec(), it is owned by the
+// caller.
+//
+// Only ZSTD supports dictionaries; other types return NotSupported.
+Status NewCompressionCodecWithDictionary(CompressionType compression,
+                                         const Slice& dictionary,
+                                         std::unique_ptr<CompressionCodec>* codec);
+
+// Trains a dictionary of at most 'max_size' bytes for the specified type of
+// codec from 'samples' of the data to be compressed, for use with
+// NewCompressionCodecWithDictionary().
+//
+// Returns RuntimeError if the samples are not suitable for training (e.g.
+// if there are too few of them), or NotSupported if the codec doesn't
+// support dictionaries.
+Status TrainCompressionDictionary(CompressionType compression,
+                                  const std::vector<Slice>& samples,
+                                  size_t max_size,
+                                  faststring* dictionary);
+
 // Returns the compression codec type given the name
 CompressionType GetCompressionCodecType(const std::string& name);
 
@@ -22,6 +22,7 @@
 
 #include "kudu/gutil/gscoped_ptr.h"
 #include "kudu/gutil/macros.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/rwc_lock.h"
 
 namespace kudu {
@@ -35,7 +36,7 @@ namespace kudu {
 template<class State>
 class CowObject {
  public:
-  CowObject() {}
+  CowObject() : version_(0) {}
   ~CowObject() {}
 
   void ReadLock() const {
@@ -69,9 +70,17 @@ class CowObject {
     CHECK(dirty_state_);
     std::swap(state_, *dirty_state_);
     dirty_state_.reset();
+    version_.Increment(kMemOrderBarrier);
     lock_.CommitUnlock();
   }
 
+  // Return the number of mutations committed so far. This may be called
+  // without holding the lock, in which case it's only a hint: for example,
+  // it tells whether something derived from an earlier state is stale.
+  int64_t version() const {
+    return version_.Load(kMemOrderAcquire);
+  }
+
   // Return the current state, not reflecting any in-progress mutations.
   State& state() {
     DCHECK(lock_.HasReaders() || lock_.HasWriteLock());
@@ -100,6 +109,8 @@ class CowObject {
   State state_;
   gscoped_ptr<State> dirty_state_;
 
+  AtomicInt<int64_t> version_;
+
   DISALLOW_COPY_AND_ASSIGN(CowObject);
 };
 
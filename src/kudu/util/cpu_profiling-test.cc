@@ -0,0 +1,73 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/port.h"
+#include "kudu/util/cpu_profiling.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/test_macros.h"
+#include "kudu/util/test_util.h"
+
+using std::string;
+
+namespace kudu {
+
+class CpuProfilingTest : public KuduTest {
+};
+
+// Spins for 'duration', so that the profiler samples this function.
+ATTRIBUTE_NOINLINE void CpuProfilingTestBurnCpu(const MonoDelta& duration) {
+  MonoTime deadline = MonoTime::Now() + duration;
+  volatile int64_t x = 0;
+  while (MonoTime::Now() < deadline) {
+    for (int i = 0; i < 10000; i++) {
+      x = x + i;
+    }
+  }
+}
+
+TEST_F(CpuProfilingTest, TestContinuousProfiling) {
+  ASSERT_FALSE(IsContinuousCpuProfilingRunning());
+  ASSERT_OK(StartContinuousCpuProfiling(1000, 10000));
+  ASSERT_TRUE(IsContinuousCpuProfilingRunning());
+  Status s = StartContinuousCpuProfiling(1000, 10000);
+  ASSERT_TRUE(s.IsIllegalState()) << s.ToString();
+
+  CpuProfilingTestBurnCpu(MonoDelta::FromMilliseconds(500));
+  StopContinuousCpuProfiling();
+  ASSERT_FALSE(IsContinuousCpuProfilingRunning());
+
+  // The burning function shows up in the folded stacks, which end with the
+  // number of samples.
+  std::ostringstream out;
+  DumpContinuousCpuProfile(MonoDelta::FromSeconds(60), &out);
+  string profile = out.str();
+  LOG(INFO) << "Profile:\n" << profile;
+  ASSERT_STR_CONTAINS(profile, "CpuProfilingTestBurnCpu");
+  ASSERT_STR_MATCHES(profile, "CpuProfilingTestBurnCpu[^\n]* [0-9]+\n");
+
+  // No sample is in an empty window.
+  std::ostringstream empty;
+  DumpContinuousCpuProfile(MonoDelta::FromSeconds(0), &empty);
+  ASSERT_EQ("", empty.str());
+}
+
+} // namespace kudu
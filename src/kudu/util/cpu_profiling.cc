@@ -0,0 +1,235 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/cpu_profiling.h"
+
+#include <signal.h>
+#include <sys/time.h>
+
+#include <algorithm>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/atomicops.h"
+#include "kudu/gutil/strings/join.h"
+#include "kudu/gutil/walltime.h"
+#include "kudu/util/debug-util.h"
+#include "kudu/util/debug/sanitizer_scopes.h"
+#include "kudu/util/errno.h"
+#include "kudu/util/locks.h"
+
+using base::subtle::Acquire_Load;
+using base::subtle::Acquire_Store;
+using base::subtle::Atomic64;
+using base::subtle::NoBarrier_AtomicIncrement;
+using base::subtle::NoBarrier_Load;
+using base::subtle::Release_Load;
+using base::subtle::Release_Store;
+using std::pair;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+namespace kudu {
+
+namespace {
+
+// A stack sampled by the SIGPROF handler.
+//
+// Each sample is guarded by a sequence number, which is odd while the
+// signal handler writes the sample. A reader copies the sample and only
+// keeps the copy if the sequence number was even and unchanged around it.
+struct Sample {
+  Atomic64 seq;
+  MicrosecondsInt64 time_micros;
+  StackTrace stack;
+};
+
+// The ring buffer of the most recent samples. It's allocated by the first
+// call to StartContinuousCpuProfiling() and never freed: a SIGPROF may still
+// be delivered after profiling is stopped.
+Sample* g_samples = nullptr;
+int g_max_samples = 0;
+
+// The number of samples taken so far. Sample 'n' (starting at 1) is stored
+// in slot (n - 1) % g_max_samples, with the sequence number 2 * n once
+// written.
+Atomic64 g_num_samples = 0;
+
+// Protects starting and stopping the profiler.
+simple_spinlock g_state_lock;
+bool g_running = false;  // protected by g_state_lock
+
+void HandleSigProf(int signum) {
+  // Only async-safe calls may be made here: see StackTrace::Collect().
+  Sample* samples = g_samples;
+  if (PREDICT_FALSE(samples == nullptr)) {
+    return;
+  }
+  int saved_errno = errno;
+  Atomic64 n = NoBarrier_AtomicIncrement(&g_num_samples, 1);
+  Sample* s = &samples[(n - 1) % g_max_samples];
+  Acquire_Store(&s->seq, 2 * n - 1);
+  s->time_micros = GetMonoTimeMicros();
+  // Skip the frames of Collect() and of this handler.
+  s->stack.Collect(2);
+  Release_Store(&s->seq, 2 * n);
+  errno = saved_errno;
+}
+
+// Set the SIGPROF timer to fire 'frequency_hz' times per second of CPU time,
+// or disable it if 'frequency_hz' is 0.
+Status SetProfilingTimer(int frequency_hz) {
+  struct itimerval timer;
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = frequency_hz > 0 ? 1000000 / frequency_hz : 0;
+  timer.it_value = timer.it_interval;
+  if (setitimer(ITIMER_PROF, &timer, nullptr) != 0) {
+    int err = errno;
+    return Status::RuntimeError("unable to set the profiling timer", ErrnoToString(err), err);
+  }
+  return Status::OK();
+}
+
+Status SetSigProfHandler(void (*handler)(int)) {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_handler = handler;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, nullptr) != 0) {
+    int err = errno;
+    return Status::RuntimeError("unable to install the SIGPROF handler",
+                                ErrnoToString(err), err);
+  }
+  return Status::OK();
+}
+
+} // anonymous namespace
+
+Status StartContinuousCpuProfiling(int frequency_hz, int max_samples) {
+  if (frequency_hz <= 0 || frequency_hz > 1000000) {
+    return Status::InvalidArgument("invalid profiling frequency", std::to_string(frequency_hz));
+  }
+  if (max_samples <= 0) {
+    return Status::InvalidArgument("invalid number of samples", std::to_string(max_samples));
+  }
+
+  std::lock_guard<simple_spinlock> l(g_state_lock);
+  if (g_running) {
+    return Status::IllegalState("continuous CPU profiling is already running");
+  }
+  if (g_samples == nullptr) {
+    g_max_samples = max_samples;
+    g_samples = new Sample[max_samples]();
+  }
+  RETURN_NOT_OK(SetSigProfHandler(&HandleSigProf));
+  Status s = SetProfilingTimer(frequency_hz);
+  if (!s.ok()) {
+    WARN_NOT_OK(SetSigProfHandler(SIG_IGN), "unable to reset the SIGPROF handler");
+    return s;
+  }
+  g_running = true;
+  return Status::OK();
+}
+
+void StopContinuousCpuProfiling() {
+  std::lock_guard<simple_spinlock> l(g_state_lock);
+  if (!g_running) {
+    return;
+  }
+  WARN_NOT_OK(SetProfilingTimer(0), "unable to disable the profiling timer");
+  // Ignore, rather than default, any SIGPROF still pending: its default
+  // action terminates the process.
+  WARN_NOT_OK(SetSigProfHandler(SIG_IGN), "unable to reset the SIGPROF handler");
+  g_running = false;
+}
+
+bool IsContinuousCpuProfilingRunning() {
+  std::lock_guard<simple_spinlock> l(g_state_lock);
+  return g_running;
+}
+
+void DumpContinuousCpuProfile(const MonoDelta& window, std::ostream* out) {
+  Sample* samples;
+  {
+    std::lock_guard<simple_spinlock> l(g_state_lock);
+    samples = g_samples;
+  }
+  if (samples == nullptr) {
+    return;
+  }
+  MicrosecondsInt64 start_micros = GetMonoTimeMicros() - window.ToMicroseconds();
+
+  // Aggregate the samples by stack. The stacks are bucketed by hash code,
+  // and only symbolized once aggregated.
+  unordered_map<uint64_t, vector<pair<StackTrace, int64_t>>> stacks;
+  Atomic64 num_samples = NoBarrier_Load(&g_num_samples);
+  Atomic64 first = std::max<Atomic64>(1, num_samples - g_max_samples + 1);
+  for (Atomic64 n = first; n <= num_samples; n++) {
+    const Sample& s = samples[(n - 1) % g_max_samples];
+    Atomic64 seq = Acquire_Load(&s.seq);
+    if (seq != 2 * n) {
+      // Being written, or already overwritten by a newer sample.
+      continue;
+    }
+    MicrosecondsInt64 time_micros;
+    StackTrace stack;
+    {
+      // The copy races with the signal handler, which the sequence number
+      // check below detects.
+      debug::ScopedTSANIgnoreReadsAndWrites ignore_tsan;
+      time_micros = s.time_micros;
+      stack.CopyFrom(s.stack);
+    }
+    if (Release_Load(&s.seq) != seq || time_micros < start_micros) {
+      continue;
+    }
+
+    auto& bucket = stacks[stack.HashCode()];
+    bool found = false;
+    for (auto& e : bucket) {
+      if (e.first.Equals(stack)) {
+        e.second++;
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      bucket.emplace_back();
+      bucket.back().first.CopyFrom(stack);
+      bucket.back().second = 1;
+    }
+  }
+
+  for (const auto& bucket : stacks) {
+    for (const auto& e : bucket.second) {
+      // Folded stacks start at the root frame.
+      vector<string> frames = e.first.SymbolizeFrames();
+      std::reverse(frames.begin(), frames.end());
+      *out << JoinStrings(frames, ";") << " " << e.second << "\n";
+    }
+  }
+}
+
+} // namespace kudu
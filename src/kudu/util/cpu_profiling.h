@@ -0,0 +1,62 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_CPU_PROFILING_H
+#define KUDU_UTIL_CPU_PROFILING_H
+
+#include <iosfwd>
+
+#include "kudu/util/monotime.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+// Continuous, low-frequency CPU profiling.
+//
+// While running, the process receives SIGPROF 'frequency_hz' times per second
+// of consumed CPU time. The signal handler collects the stack of the thread
+// it interrupted into a fixed-size ring buffer of the most recent samples,
+// which covers a window of roughly max_samples / frequency_hz seconds of CPU
+// time.
+//
+// This uses the same signal and timer as the gperftools CPU profiler, so the
+// two must not run at the same time.
+//
+// Returns an error if continuous profiling is already running, or if the
+// signal handler or the timer can't be set up.
+//
+// The sample buffer is allocated by the first call, with room for
+// 'max_samples' samples, and kept for the life of the process, since a
+// signal may still be delivered after profiling is stopped.
+Status StartContinuousCpuProfiling(int frequency_hz, int max_samples);
+
+// Stop continuous CPU profiling. The samples collected so far are kept, and
+// can still be dumped.
+void StopContinuousCpuProfiling();
+
+// Return true if continuous CPU profiling is running.
+bool IsContinuousCpuProfilingRunning();
+
+// Write the samples collected during the last 'window' to 'out' as folded
+// stacks, one line per distinct stack:
+//   <root frame>;<frame>;...;<leaf frame> <number of samples>
+// This is the input format of flame graph tools.
+//
+// The frames are symbolized, so this is not async-safe and may be slow.
+void DumpContinuousCpuProfile(const MonoDelta& window, std::ostream* out);
+
+} // namespace kudu
+#endif /* KUDU_UTIL_CPU_PROFILING_H */
@@ -58,6 +58,21 @@ TEST_F(CrcTest, TestCRC32C) {
   ASSERT_EQ(0xa9421b7, data_crc); // Known value from crcutil usage test program.
 }
 
+// Copying while checksumming yields the plain checksum of the data.
+TEST_F(CrcTest, TestCrc32cAndCopy) {
+  gscoped_ptr<const uint8_t[]> data;
+  const uint8_t* buf;
+  size_t buflen;
+  GenerateBenchmarkData(&buf, &buflen);
+  data.reset(buf);
+  gscoped_ptr<uint8_t[]> copy(new uint8_t[buflen]);
+  for (size_t len : { static_cast<size_t>(0), static_cast<size_t>(7),
+                      static_cast<size_t>(16 * 1024), buflen - 3 }) {
+    ASSERT_EQ(Crc32c(buf, len), Crc32cAndCopy(buf, copy.get(), len)) << len;
+    ASSERT_EQ(0, memcmp(buf, copy.get(), len)) << len;
+  }
+}
+
 // Simple benchmark of CRC32C throughput.
 // We should expect about 8 bytes per cycle in throughput on a single core.
 TEST_F(CrcTest, BenchmarkCRC32C) {
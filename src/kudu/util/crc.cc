@@ -16,6 +16,10 @@
 // under the License.
 #include "kudu/util/crc.h"
 
+#include <string.h>
+
+#include <algorithm>
+
 #include <crcutil/interface.h>
 
 #include "kudu/gutil/once.h"
@@ -46,5 +50,23 @@ uint32_t Crc32c(const void* data, size_t length) {
   return static_cast<uint32_t>(crc32); // Only uses lower 32 bits.
 }
 
+uint32_t Crc32cAndCopy(const void* src, void* dst, size_t length) {
+  // Small enough for a chunk to stay in L1 between the copy and the checksum.
+  const size_t kChunkSize = 16 * 1024;
+  Crc* crc = GetCrc32cInstance();
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  uint8_t* d = static_cast<uint8_t*>(dst);
+  uint64_t crc32 = 0;
+  while (length > 0) {
+    size_t n = std::min(length, kChunkSize);
+    memcpy(d, s, n);
+    crc->Compute(d, n, &crc32);
+    s += n;
+    d += n;
+    length -= n;
+  }
+  return static_cast<uint32_t>(crc32);
+}
+
 } // namespace crc
 } // namespace kudu
@@ -33,6 +33,11 @@ Crc* GetCrc32cInstance();
 // Helper function to simply calculate a CRC32C of the given data.
 uint32_t Crc32c(const void* data, size_t length);
 
+// Copies 'length' bytes from 'src' to 'dst' and returns their CRC32C, in a
+// single pass over the data: each chunk is checksummed while it's still in
+// the CPU cache from being copied.
+uint32_t Crc32cAndCopy(const void* src, void* dst, size_t length);
+
 } // namespace crc
 } // namespace kudu
 
@@ -369,48 +369,62 @@ string StackTrace::ToHexString(int flags) const {
 }
 
 // Symbolization function borrowed from glog.
+//
+// Returns the symbol of 'pc', written into 'buf' if found, or "(unknown)".
+static const char* SymbolizeFrame(void* pc, char* buf, int size) {
+  // The return address 'pc' on the stack is the address of the instruction
+  // following the 'call' instruction. In the case of calling a function annotated
+  // 'noreturn', this address may actually be the first instruction of the next
+  // function, because the function we care about ends with the 'call'.
+  // So, we subtract 1 from 'pc' so that we're pointing at the 'call' instead
+  // of the return address.
+  //
+  // For example, compiling a C program with -O2 that simply calls 'abort()' yields
+  // the following disassembly:
+  //     Disassembly of section .text:
+  //
+  //     0000000000400440 <main>:
+  //       400440:	48 83 ec 08          	sub    $0x8,%rsp
+  //       400444:	e8 c7 ff ff ff       	callq  400410 <abort@plt>
+  //
+  //     0000000000400449 <_start>:
+  //       400449:	31 ed                	xor    %ebp,%ebp
+  //       ...
+  //
+  // If we were to take a stack trace while inside 'abort', the return pointer
+  // on the stack would be 0x400449 (the first instruction of '_start'). By subtracting
+  // 1, we end up with 0x400448, which is still within 'main'.
+  //
+  // This also ensures that we point at the correct line number when using addr2line
+  // on logged stacks.
+  if (google::Symbolize(
+          reinterpret_cast<char *>(pc) - 1, buf, size)) {
+    return buf;
+  }
+  return "(unknown)";
+}
+
 string StackTrace::Symbolize() const {
   string ret;
   for (int i = 0; i < num_frames_; i++) {
     void* pc = frames_[i];
-
     char tmp[1024];
-    const char* symbol = "(unknown)";
-
-    // The return address 'pc' on the stack is the address of the instruction
-    // following the 'call' instruction. In the case of calling a function annotated
-    // 'noreturn', this address may actually be the first instruction of the next
-    // function, because the function we care about ends with the 'call'.
-    // So, we subtract 1 from 'pc' so that we're pointing at the 'call' instead
-    // of the return address.
-    //
-    // For example, compiling a C program with -O2 that simply calls 'abort()' yields
-    // the following disassembly:
-    //     Disassembly of section .text:
-    //
-    //     0000000000400440 <main>:
-    //       400440:	48 83 ec 08          	sub    $0x8,%rsp
-    //       400444:	e8 c7 ff ff ff       	callq  400410 <abort@plt>
-    //
-    //     0000000000400449 <_start>:
-    //       400449:	31 ed                	xor    %ebp,%ebp
-    //       ...
-    //
-    // If we were to take a stack trace while inside 'abort', the return pointer
-    // on the stack would be 0x400449 (the first instruction of '_start'). By subtracting
-    // 1, we end up with 0x400448, which is still within 'main'.
-    //
-    // This also ensures that we point at the correct line number when using addr2line
-    // on logged stacks.
-    if (google::Symbolize(
-            reinterpret_cast<char *>(pc) - 1, tmp, sizeof(tmp))) {
-      symbol = tmp;
-    }
+    const char* symbol = SymbolizeFrame(pc, tmp, sizeof(tmp));
     StringAppendF(&ret, "    @ %*p  %s\n", kPrintfPointerFieldWidth, pc, symbol);
   }
   return ret;
 }
 
+vector<string> StackTrace::SymbolizeFrames() const {
+  vector<string> ret;
+  ret.reserve(num_frames_);
+  for (int i = 0; i < num_frames_; i++) {
+    char tmp[1024];
+    ret.emplace_back(SymbolizeFrame(frames_[i], tmp, sizeof(tmp)));
+  }
+  return ret;
+}
+
 string StackTrace::ToLogFormatHexString() const {
   string ret;
   for (int i = 0; i < num_frames_; i++) {
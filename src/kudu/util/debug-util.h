@@ -146,6 +146,11 @@ class StackTrace {
   // This is not async-safe.
   std::string Symbolize() const;
 
+  // Return the symbol of each frame, innermost first, or "(unknown)" for
+  // the frames which can't be symbolized.
+  // This is not async-safe.
+  std::vector<std::string> SymbolizeFrames() const;
+
   // Return a string with a hex-only backtrace in the format typically used in
   // log files. Similar to the format given by Symbolize(), but symbols are not
   // resolved (only the hex addresses are given).
@@ -452,6 +452,75 @@ TEST_F(TestEnv, TestReadFully) {
   ASSERT_STR_CONTAINS(status.ToString(), "EOF");
 }
 
+TEST_F(TestEnv, TestDirectIoRead) {
+  const string kTestPath = GetTestPath("test");
+  const int kFileSize = 64 * 1024 + 123;
+  NO_FATALS(WriteTestFile(env_, kTestPath, kFileSize));
+
+  RandomAccessFileOptions opts;
+  opts.direct_io = true;
+  unique_ptr<RandomAccessFile> raf;
+  ASSERT_OK(env_->NewRandomAccessFile(opts, kTestPath, &raf));
+
+  // Aligned and unaligned reads both return the right data.
+  const struct {
+    uint64_t offset;
+    size_t length;
+  } kReads[] = { { 0, 4096 }, { 4096, 8192 }, { 1, 10 },
+                 { 4000, 5000 }, { 12345, 20000 } };
+  unique_ptr<uint8_t[]> scratch(new uint8_t[kFileSize + 1]);
+  for (const auto& r : kReads) {
+    Slice s;
+    ASSERT_OK(env_util::ReadFully(raf.get(), r.offset, r.length, &s, scratch.get()));
+    ASSERT_EQ(r.length, s.size());
+    VerifyTestData(s, r.offset);
+  }
+
+  // Reads are cut short by the end of the file as usual.
+  Slice s;
+  ASSERT_OK(raf->Read(kFileSize - 100, 200, &s, scratch.get()));
+  ASSERT_EQ(100, s.size());
+  VerifyTestData(s, kFileSize - 100);
+  ASSERT_TRUE(env_util::ReadFully(raf.get(), kFileSize - 100, 200,
+                                  &s, scratch.get()).IsIOError());
+}
+
+TEST_F(TestEnv, TestMap) {
+  const string kTestPath = GetTestPath("test");
+  const int kFileSize = 64 * 1024 + 123;
+  NO_FATALS(WriteTestFile(env_, kTestPath, kFileSize));
+
+  unique_ptr<RandomAccessFile> raf;
+  ASSERT_OK(env_->NewRandomAccessFile(kTestPath, &raf));
+
+  // Page-aligned and unaligned ranges are both mapped.
+  const struct {
+    uint64_t offset;
+    size_t length;
+  } kMaps[] = { { 0, kFileSize }, { 4096, 8192 }, { 1, 10 },
+                { 4000, 5000 }, { kFileSize - 100, 100 } };
+  vector<unique_ptr<MemoryMappedRegion>> regions;
+  for (const auto& m : kMaps) {
+    unique_ptr<MemoryMappedRegion> region;
+    ASSERT_OK(raf->Map(m.offset, m.length, &region));
+    ASSERT_EQ(m.length, region->data().size());
+    VerifyTestData(region->data(), m.offset);
+    region->Advise(0, m.length, MemoryMappedRegion::WILLNEED);
+    regions.emplace_back(std::move(region));
+  }
+
+  // The mappings remain valid once the file is closed.
+  raf.reset();
+  for (int i = 0; i < arraysize(kMaps); i++) {
+    VerifyTestData(regions[i]->data(), kMaps[i].offset);
+  }
+
+  // Ranges past the end of the file aren't mapped.
+  ASSERT_OK(env_->NewRandomAccessFile(kTestPath, &raf));
+  unique_ptr<MemoryMappedRegion> region;
+  ASSERT_TRUE(raf->Map(kFileSize - 100, 200, &region).IsInvalidArgument());
+}
+
 TEST_F(TestEnv, TestAppendVector) {
   WritableFileOptions opts;
   LOG(INFO) << "Testing AppendVector() only, NO pre-allocation";
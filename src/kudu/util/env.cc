@@ -21,6 +21,11 @@ SequentialFile::~SequentialFile() {
 RandomAccessFile::~RandomAccessFile() {
 }
 
+Status RandomAccessFile::Map(uint64_t /* offset */, size_t /* n */,
+                             std::unique_ptr<MemoryMappedRegion>* /* region */) const {
+  return Status::NotSupported("memory mapping not supported", filename());
+}
+
 WritableFile::~WritableFile() {
 }
 
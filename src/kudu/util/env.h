@@ -362,6 +362,37 @@ class SequentialFile {
   virtual const std::string& filename() const = 0;
 };
 
+// A read-only memory mapping of part of a file, created by
+// RandomAccessFile::Map(). The mapping is unmapped when this object is
+// destroyed and remains valid after the file itself is closed.
+class MemoryMappedRegion {
+ public:
+  // How the mapped data is about to be accessed. See madvise(2).
+  enum Advice {
+    // No particular pattern.
+    NORMAL,
+
+    // In order; the OS may read ahead aggressively.
+    SEQUENTIAL,
+
+    // In random order; the OS should not read ahead.
+    RANDOM,
+
+    // Soon; the OS may start reading the data in the background.
+    WILLNEED,
+  };
+
+  virtual ~MemoryMappedRegion() {}
+
+  // Returns the mapped contents of the file. Accessing them may block on
+  // disk I/O if they aren't resident in memory.
+  virtual const Slice& data() const = 0;
+
+  // Advises the OS how the 'length' bytes of data() starting at 'offset' are
+  // about to be accessed. Purely a hint: failures are ignored.
+  virtual void Advise(uint64_t offset, size_t length, Advice advice) const = 0;
+};
+
 // A file abstraction for randomly reading the contents of a file.
 class RandomAccessFile {
  public:
@@ -386,6 +417,16 @@ class RandomAccessFile {
   // Returns the filename provided when the RandomAccessFile was constructed.
   virtual const std::string& filename() const = 0;
 
+  // Maps the 'n' bytes of the file starting at 'offset' read-only into
+  // memory, which must all lie within the file. The file must not be
+  // truncated while the mapping exists.
+  //
+  // Returns NotSupported if the file cannot be memory mapped.
+  //
+  // Safe for concurrent use by multiple threads.
+  virtual Status Map(uint64_t offset, size_t n,
+                     std::unique_ptr<MemoryMappedRegion>* region) const;
+
   // Returns the approximate memory usage of this RandomAccessFile including
   // the object itself.
   virtual size_t memory_footprint() const = 0;
@@ -406,7 +447,14 @@ struct WritableFileOptions {
 
 // Options specified when a file is opened for random access.
 struct RandomAccessFileOptions {
-  RandomAccessFileOptions() {}
+  // Read the file with direct I/O, bypassing the OS page cache (O_DIRECT on
+  // Linux). Reads need not be aligned: unaligned ones go through an aligned
+  // bounce buffer, at the cost of a copy. Ignored where direct I/O isn't
+  // supported, either by the platform or by the file's filesystem.
+  bool direct_io;
+
+  RandomAccessFileOptions()
+    : direct_io(false) { }
 };
 
 // A file abstraction for sequential writing.  The implementation
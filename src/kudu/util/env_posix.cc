@@ -287,20 +287,109 @@ class PosixSequentialFile: public SequentialFile {
   virtual const string& filename() const OVERRIDE { return filename_; }
 };
 
+// An mmap()ed range of a file.
+class PosixMemoryMappedRegion : public MemoryMappedRegion {
+ public:
+  // 'addr' and 'mapped_len' are those of the page-aligned mapping, of which
+  // 'data' is the part requested by the caller.
+  PosixMemoryMappedRegion(void* addr, size_t mapped_len, Slice data)
+      : addr_(addr), mapped_len_(mapped_len), data_(data) {}
+
+  virtual ~PosixMemoryMappedRegion() {
+    if (munmap(addr_, mapped_len_) != 0) {
+      PLOG(WARNING) << "Failed to unmap " << mapped_len_ << " bytes";
+    }
+  }
+
+  virtual const Slice& data() const OVERRIDE { return data_; }
+
+  virtual void Advise(uint64_t offset, size_t length, Advice advice) const OVERRIDE {
+    DCHECK_LE(offset + length, data_.size());
+    int posix_advice;
+    switch (advice) {
+      case NORMAL: posix_advice = MADV_NORMAL; break;
+      case SEQUENTIAL: posix_advice = MADV_SEQUENTIAL; break;
+      case RANDOM: posix_advice = MADV_RANDOM; break;
+      case WILLNEED: posix_advice = MADV_WILLNEED; break;
+      default: LOG(FATAL) << "Unknown advice " << advice;
+    }
+    // madvise() requires a page-aligned address.
+    uintptr_t start = reinterpret_cast<uintptr_t>(data_.data()) + offset;
+    uintptr_t aligned_start = start & ~(static_cast<uintptr_t>(getpagesize()) - 1);
+    ignore_result(madvise(reinterpret_cast<void*>(aligned_start),
+                          length + (start - aligned_start), posix_advice));
+  }
+
+ private:
+  void* const addr_;
+  const size_t mapped_len_;
+  const Slice data_;
+
+  DISALLOW_COPY_AND_ASSIGN(PosixMemoryMappedRegion);
+};
+
 // pread() based random-access
 class PosixRandomAccessFile: public RandomAccessFile {
  private:
   std::string filename_;
   int fd_;
 
+  // Whether 'fd_' was opened with O_DIRECT.
+  bool direct_io_;
+
+  // The offset, length and memory of O_DIRECT reads must be aligned to the
+  // logical block size of the device, which this covers.
+  static const uint64_t kDirectIoAlignment = 4096;
+
+  Status DirectRead(uint64_t offset, size_t n, Slice* result,
+                    uint8_t *scratch) const {
+    uint64_t aligned_offset = offset & ~(kDirectIoAlignment - 1);
+    uint64_t aligned_end = (offset + n + kDirectIoAlignment - 1) &
+        ~(kDirectIoAlignment - 1);
+    if (aligned_offset == offset && aligned_end == offset + n &&
+        (reinterpret_cast<uintptr_t>(scratch) & (kDirectIoAlignment - 1)) == 0) {
+      ssize_t r;
+      RETRY_ON_EINTR(r, pread(fd_, scratch, n, offset));
+      if (r < 0) {
+        return IOError(filename_, errno);
+      }
+      *result = Slice(scratch, r);
+      return Status::OK();
+    }
+
+    // Read the enclosing aligned range into a bounce buffer.
+    size_t aligned_len = aligned_end - aligned_offset;
+    void* buf;
+    int err = posix_memalign(&buf, kDirectIoAlignment, aligned_len);
+    if (err != 0) {
+      return IOError(filename_, err);
+    }
+    auto cleanup = MakeScopedCleanup([&]() { free(buf); });
+    ssize_t r;
+    RETRY_ON_EINTR(r, pread(fd_, buf, aligned_len, aligned_offset));
+    if (r < 0) {
+      return IOError(filename_, errno);
+    }
+    // 'r' may fall short of 'aligned_len' at the end of the file.
+    size_t skip = offset - aligned_offset;
+    size_t bytes_read = static_cast<size_t>(r) > skip ?
+        std::min<size_t>(r - skip, n) : 0;
+    memcpy(scratch, static_cast<uint8_t*>(buf) + skip, bytes_read);
+    *result = Slice(scratch, bytes_read);
+    return Status::OK();
+  }
+
  public:
-  PosixRandomAccessFile(std::string fname, int fd)
-      : filename_(std::move(fname)), fd_(fd) {}
+  PosixRandomAccessFile(std::string fname, int fd, bool direct_io = false)
+      : filename_(std::move(fname)), fd_(fd), direct_io_(direct_io) {}
   virtual ~PosixRandomAccessFile() { close(fd_); }
 
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       uint8_t *scratch) const OVERRIDE {
     ThreadRestrictions::AssertIOAllowed();
+    if (direct_io_) {
+      return DirectRead(offset, n, result, scratch);
+    }
     Status s;
     ssize_t r;
     RETRY_ON_EINTR(r, pread(fd_, scratch, n, offset));
@@ -325,6 +414,34 @@ class PosixRandomAccessFile: public RandomAccessFile {
 
   virtual const string& filename() const OVERRIDE { return filename_; }
 
+  virtual Status Map(uint64_t offset, size_t n,
+                     unique_ptr<MemoryMappedRegion>* region) const OVERRIDE {
+    TRACE_EVENT1("io", "PosixRandomAccessFile::Map", "path", filename_);
+    ThreadRestrictions::AssertIOAllowed();
+    if (n == 0) {
+      return Status::InvalidArgument("cannot map an empty range", filename_);
+    }
+    // Touching a mapped page past the end of the file raises SIGBUS, so refuse
+    // to map any.
+    uint64_t size;
+    RETURN_NOT_OK(Size(&size));
+    if (offset + n > size) {
+      return Status::InvalidArgument(
+          Substitute("cannot map [$0-$1) beyond the end of the file (size $2)",
+                     offset, offset + n, size), filename_);
+    }
+    uint64_t page_size = getpagesize();
+    uint64_t aligned_offset = offset & ~(page_size - 1);
+    size_t mapped_len = n + (offset - aligned_offset);
+    void* addr = mmap(nullptr, mapped_len, PROT_READ, MAP_SHARED, fd_, aligned_offset);
+    if (addr == MAP_FAILED) {
+      return IOError(filename_, errno);
+    }
+    Slice data(static_cast<uint8_t*>(addr) + (offset - aligned_offset), n);
+    region->reset(new PosixMemoryMappedRegion(addr, mapped_len, data));
+    return Status::OK();
+  }
+
   virtual size_t memory_footprint() const OVERRIDE {
     return kudu_malloc_usable_size(this) + filename_.capacity();
   }
@@ -783,12 +900,26 @@ class PosixEnv : public Env {
                                      unique_ptr<RandomAccessFile>* result) OVERRIDE {
     TRACE_EVENT1("io", "PosixEnv::NewRandomAccessFile", "path", fname);
     ThreadRestrictions::AssertIOAllowed();
-    int fd = open(fname.c_str(), O_RDONLY);
+    int fd = -1;
+    bool direct_io = false;
+#if defined(__linux__)
+    if (opts.direct_io) {
+      fd = open(fname.c_str(), O_RDONLY | O_DIRECT);
+      // Some filesystems (e.g. tmpfs) don't support O_DIRECT.
+      if (fd < 0 && errno != EINVAL) {
+        return IOError(fname, errno);
+      }
+      direct_io = fd >= 0;
+    }
+#endif
+    if (fd < 0) {
+      fd = open(fname.c_str(), O_RDONLY);
+    }
     if (fd < 0) {
       return IOError(fname, errno);
     }
 
-    result->reset(new PosixRandomAccessFile(fname, fd));
+    result->reset(new PosixRandomAccessFile(fname, fd, direct_io));
     return Status::OK();
   }
 
@@ -121,21 +121,26 @@ static void OverrideBytesFreeWithTestingFlags(const string& path, int64_t* bytes
   }
 }
 
-Status VerifySufficientDiskSpace(Env *env, const std::string& path,
-                                 int64_t requested_bytes, int64_t reserved_bytes) {
-  DCHECK_GE(requested_bytes, 0);
-
-  int64_t bytes_free;
-  RETURN_NOT_OK(env->GetBytesFree(path, &bytes_free));
+Status GetBytesFree(Env* env, const std::string& path, int64_t* bytes_free) {
+  RETURN_NOT_OK(env->GetBytesFree(path, bytes_free));
 
   // Allow overriding these values by tests.
   if (PREDICT_FALSE(FLAGS_disk_reserved_bytes_free_for_testing > -1)) {
-    bytes_free = FLAGS_disk_reserved_bytes_free_for_testing;
+    *bytes_free = FLAGS_disk_reserved_bytes_free_for_testing;
   }
   if (PREDICT_FALSE(FLAGS_disk_reserved_override_prefix_1_bytes_free_for_testing != -1 ||
                     FLAGS_disk_reserved_override_prefix_2_bytes_free_for_testing != -1)) {
-    OverrideBytesFreeWithTestingFlags(path, &bytes_free);
+    OverrideBytesFreeWithTestingFlags(path, bytes_free);
   }
+  return Status::OK();
+}
+
+Status VerifySufficientDiskSpace(Env *env, const std::string& path,
+                                 int64_t requested_bytes, int64_t reserved_bytes) {
+  DCHECK_GE(requested_bytes, 0);
+
+  int64_t bytes_free;
+  RETURN_NOT_OK(GetBytesFree(env, path, &bytes_free));
 
   if (bytes_free - requested_bytes < reserved_bytes) {
     return Status::IOError(Substitute("Insufficient disk space to allocate $0 bytes under path $1 "
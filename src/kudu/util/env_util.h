@@ -39,6 +39,11 @@ Status OpenFileForRandom(Env *env, const std::string &path,
 Status OpenFileForSequential(Env *env, const std::string &path,
                              std::shared_ptr<SequentialFile> *file);
 
+// Returns the number of bytes free on the file system represented by 'path',
+// as seen by VerifySufficientDiskSpace() (i.e. subject to the overrides of
+// tests).
+Status GetBytesFree(Env* env, const std::string& path, int64_t* bytes_free);
+
 // Returns Status::IOError with POSIX code ENOSPC if there is not sufficient
 // disk space to write 'bytes' bytes to the file system represented by 'path'.
 // Otherwise returns OK.
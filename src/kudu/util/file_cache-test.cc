@@ -34,8 +34,13 @@
 #include "kudu/util/test_util.h"
 
 DECLARE_bool(cache_force_single_shard);
+DECLARE_bool(file_cache_close_in_background);
 DECLARE_int32(file_cache_expiry_period_ms);
 
+METRIC_DECLARE_counter(file_cache_open_hits);
+METRIC_DECLARE_counter(file_cache_open_misses);
+METRIC_DECLARE_entity(server);
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -55,6 +60,10 @@ class FileCacheTest : public KuduTest {
 
     // Speed up tests that check the number of descriptors.
     FLAGS_file_cache_expiry_period_ms = 1;
+
+    // Close evicted files inline so that the number of open fds is exact.
+    // TestBackgroundClose covers the background closer.
+    FLAGS_file_cache_close_in_background = false;
   }
 
   void SetUp() override {
@@ -63,11 +72,12 @@ class FileCacheTest : public KuduTest {
   }
 
  protected:
-  Status ReinitCache(int max_open_files) {
+  Status ReinitCache(int max_open_files,
+                     const scoped_refptr<MetricEntity>& entity = nullptr) {
     cache_.reset(new FileCache<FileType>("test",
                                          env_,
                                          max_open_files,
-                                         nullptr));
+                                         entity));
     return cache_->Init();
   }
 
@@ -261,6 +271,91 @@ TYPED_TEST(FileCacheTest, TestHeavyReads) {
   }
 }
 
+TYPED_TEST(FileCacheTest, TestBackgroundClose) {
+  FLAGS_file_cache_close_in_background = true;
+
+  const string kFile1 = this->GetTestPath("foo");
+  const string kFile2 = this->GetTestPath("bar");
+  const string kFile3 = this->GetTestPath("baz");
+  const string kData1 = "test data 1";
+  ASSERT_OK(this->WriteTestFile(kFile1, kData1));
+  ASSERT_OK(this->WriteTestFile(kFile2, "test data 2"));
+  ASSERT_OK(this->WriteTestFile(kFile3, "test data 3"));
+
+  {
+    // Opening the second file evicts the first, whose fd is closed by the
+    // background closer.
+    shared_ptr<TypeParam> f1;
+    ASSERT_OK(this->cache_->OpenExistingFile(kFile1, &f1));
+    shared_ptr<TypeParam> f2;
+    ASSERT_OK(this->cache_->OpenExistingFile(kFile2, &f2));
+    AssertEventually([&]() {
+      ASSERT_EQ(0, this->cache_->NumPendingClosesForTests());
+      ASSERT_EQ(this->initial_open_fds_ + 1, CountOpenFds(this->env_));
+    });
+
+    // The evicted file is reopened on demand.
+    uint64_t size;
+    ASSERT_OK(f1->Size(&size));
+    ASSERT_EQ(kData1.size(), size);
+    AssertEventually([&]() {
+      ASSERT_EQ(this->initial_open_fds_ + 1, CountOpenFds(this->env_));
+    });
+  }
+
+  // Deleting a file closes its fd right away, even if the eviction would
+  // otherwise have been handed off to the closer.
+  {
+    shared_ptr<TypeParam> f3;
+    ASSERT_OK(this->cache_->OpenExistingFile(kFile3, &f3));
+  }
+  ASSERT_OK(this->cache_->DeleteFile(kFile3));
+  ASSERT_EQ(0, this->cache_->NumPendingClosesForTests());
+  AssertEventually([&]() {
+    ASSERT_EQ(this->initial_open_fds_, CountOpenFds(this->env_));
+  });
+
+  // With the cache gone, so are the cached and pending fds.
+  this->cache_.reset();
+  ASSERT_EQ(this->initial_open_fds_, CountOpenFds(this->env_));
+}
+
+TYPED_TEST(FileCacheTest, TestOpenMetrics) {
+  MetricRegistry registry;
+  scoped_refptr<MetricEntity> entity =
+      METRIC_ENTITY_server.Instantiate(&registry, "test");
+  ASSERT_OK(this->ReinitCache(1, entity));
+  scoped_refptr<Counter> hits = METRIC_file_cache_open_hits.Instantiate(entity);
+  scoped_refptr<Counter> misses = METRIC_file_cache_open_misses.Instantiate(entity);
+
+  const string kFile1 = this->GetTestPath("foo");
+  const string kFile2 = this->GetTestPath("bar");
+  ASSERT_OK(this->WriteTestFile(kFile1, "test data 1"));
+  ASSERT_OK(this->WriteTestFile(kFile2, "test data 2"));
+
+  // The initial open misses, subsequent operations hit.
+  shared_ptr<TypeParam> f1;
+  ASSERT_OK(this->cache_->OpenExistingFile(kFile1, &f1));
+  ASSERT_EQ(0, hits->value());
+  ASSERT_EQ(1, misses->value());
+  uint64_t size;
+  ASSERT_OK(f1->Size(&size));
+  ASSERT_EQ(1, hits->value());
+  ASSERT_EQ(1, misses->value());
+
+  // Opening a second file evicts the first, which must then be reopened.
+  shared_ptr<TypeParam> f2;
+  ASSERT_OK(this->cache_->OpenExistingFile(kFile2, &f2));
+  ASSERT_OK(f1->Size(&size));
+  ASSERT_EQ(1, hits->value());
+  ASSERT_EQ(3, misses->value());
+
+  // Release the cache's references to the metrics before the registry goes.
+  f1.reset();
+  f2.reset();
+  this->cache_.reset();
+}
+
 TYPED_TEST(FileCacheTest, TestNoRecursiveDeadlock) {
   // This test triggered a deadlock in a previous implementation, when expired
   // weak_ptrs were removed from the descriptor map in the descriptor's
@@ -17,6 +17,8 @@
 
 #include "kudu/util/file_cache.h"
 
+#include <algorithm>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -42,9 +44,25 @@ DEFINE_int32(file_cache_expiry_period_ms, 60 * 1000,
              "Period of time (in ms) between removing expired file cache descriptors");
 TAG_FLAG(file_cache_expiry_period_ms, advanced);
 
+DEFINE_bool(file_cache_close_in_background, true,
+            "Whether files evicted from the file cache are closed by a background "
+            "thread rather than by the thread whose open caused the eviction");
+TAG_FLAG(file_cache_close_in_background, advanced);
+TAG_FLAG(file_cache_close_in_background, runtime);
+
+METRIC_DEFINE_counter(server, file_cache_open_hits,
+                      "File Cache Open Hits", kudu::MetricUnit::kOperations,
+                      "Number of file operations which found their file already "
+                      "open in a file cache");
+METRIC_DEFINE_counter(server, file_cache_open_misses,
+                      "File Cache Open Misses", kudu::MetricUnit::kOperations,
+                      "Number of file operations which had to reopen their file "
+                      "because it wasn't open in a file cache");
+
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 using strings::Substitute;
 
 namespace kudu {
@@ -57,24 +75,27 @@ FileType* CacheValueToFileType(Slice s) {
       s.mutable_data()));
 }
 
+} // anonymous namespace
+
+namespace internal {
+
 template <class FileType>
 class EvictionCallback : public Cache::EvictionCallback {
  public:
-  EvictionCallback() {}
+  explicit EvictionCallback(FileCache<FileType>* file_cache)
+      : file_cache_(file_cache) {}
 
   void EvictedEntry(Slice key, Slice value) override {
     VLOG(2) << "Evicted fd belonging to " << key.ToString();
-    delete CacheValueToFileType<FileType>(value);
+    file_cache_->ScheduleClose(CacheValueToFileType<FileType>(value));
   }
 
  private:
+  FileCache<FileType>* file_cache_;
+
   DISALLOW_COPY_AND_ASSIGN(EvictionCallback);
 };
 
-} // anonymous namespace
-
-namespace internal {
-
 template <class FileType>
 class ScopedOpenedDescriptor;
 
@@ -90,12 +111,13 @@ class BaseDescriptor {
   ~BaseDescriptor() {
     VLOG(2) << "Out of scope descriptor with file name: " << filename();
 
-    // The (now expired) weak_ptr remains in 'descriptors_', to be removed by
-    // the next call to RunDescriptorExpiry(). Removing it here would risk a
-    // deadlock on recursive acquisition of 'lock_'.
+    // The (now expired) weak_ptr remains in the descriptor map, to be removed
+    // by the next call to RunDescriptorExpiry(). Removing it here would risk a
+    // deadlock on recursive acquisition of the shard lock.
 
     if (deleted_) {
       cache()->Erase(filename());
+      file_cache_->ClosePendingFiles();
 
       VLOG(1) << "Deleting file: " << filename();
       WARN_NOT_OK(env()->DeleteFile(filename()), "");
@@ -142,6 +164,10 @@ class BaseDescriptor {
 
   Env* env() const { return file_cache_->env_; }
 
+  bool direct_io() const { return file_cache_->direct_io_; }
+
+  void RecordOpen(bool hit) const { file_cache_->RecordOpen(hit); }
+
   const string& filename() const { return file_name_; }
 
   bool deleted() const { return deleted_; }
@@ -277,6 +303,7 @@ class Descriptor<RWFile> : public RWFile {
 
   Status ReopenFileIfNecessary(ScopedOpenedDescriptor<RWFile>* out) const {
     ScopedOpenedDescriptor<RWFile> found(base_.LookupFromCache());
+    base_.RecordOpen(found.opened());
     if (found.opened()) {
       // The file is already open in the cache, return it.
       if (out) {
@@ -332,6 +359,15 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     return opened.file()->Size(size);
   }
 
+  // The mapping outlives the underlying file, so it is unaffected by the
+  // file's eviction from the cache.
+  Status Map(uint64_t offset, size_t n,
+             unique_ptr<MemoryMappedRegion>* region) const override {
+    ScopedOpenedDescriptor<RandomAccessFile> opened(&base_);
+    RETURN_NOT_OK(ReopenFileIfNecessary(&opened));
+    return opened.file()->Map(offset, n, region);
+  }
+
   const string& filename() const override {
     return base_.filename();
   }
@@ -356,6 +392,7 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
   Status ReopenFileIfNecessary(
       ScopedOpenedDescriptor<RandomAccessFile>* out) const {
     ScopedOpenedDescriptor<RandomAccessFile> found(base_.LookupFromCache());
+    base_.RecordOpen(found.opened());
     if (found.opened()) {
       // The file is already open in the cache, return it.
       if (out) {
@@ -365,8 +402,10 @@ class Descriptor<RandomAccessFile> : public RandomAccessFile {
     }
 
     // The file was evicted, reopen it.
+    RandomAccessFileOptions opts;
+    opts.direct_io = base_.direct_io();
     unique_ptr<RandomAccessFile> f;
-    RETURN_NOT_OK(base_.env()->NewRandomAccessFile(base_.filename(), &f));
+    RETURN_NOT_OK(base_.env()->NewRandomAccessFile(opts, base_.filename(), &f));
 
     // The cache will take ownership of the newly opened file.
     ScopedOpenedDescriptor<RandomAccessFile> opened(
@@ -391,12 +430,19 @@ FileCache<FileType>::FileCache(const string& cache_name,
                                int max_open_files,
                                const scoped_refptr<MetricEntity>& entity)
     : env_(env),
+      direct_io_(false),
       cache_name_(cache_name),
-      eviction_cb_(new EvictionCallback<FileType>()),
+      eviction_cb_(new internal::EvictionCallback<FileType>(this)),
       cache_(NewLRUCache(DRAM_CACHE, max_open_files, cache_name)),
-      running_(1) {
+      running_(1),
+      // Allow the closer to lag by a tenth of the capacity at most.
+      max_pending_closes_(std::max(1, max_open_files / 10)),
+      close_cond_(&close_lock_),
+      closer_running_(false) {
   if (entity) {
     cache_->SetMetrics(entity);
+    open_hits_ = METRIC_file_cache_open_hits.Instantiate(entity);
+    open_misses_ = METRIC_file_cache_open_misses.Instantiate(entity);
   }
   LOG(INFO) << Substitute("Constructed file cache $0 with capacity $1",
                           cache_name, max_open_files);
@@ -405,16 +451,40 @@ FileCache<FileType>::FileCache(const string& cache_name,
 template <class FileType>
 FileCache<FileType>::~FileCache() {
   running_.CountDown();
+  {
+    MutexLock l(close_lock_);
+    closer_running_ = false;
+    close_cond_.Signal();
+  }
   if (descriptor_expiry_thread_) {
     descriptor_expiry_thread_->Join();
   }
+  if (closer_thread_) {
+    closer_thread_->Join();
+  }
+
+  // Destroying the cache evicts the remaining files; with the closer stopped
+  // they're closed inline. Do it before the closer's state is destroyed.
+  cache_.reset();
+  ClosePendingFiles();
 }
 
 template <class FileType>
 Status FileCache<FileType>::Init() {
-  return Thread::Create("cache", Substitute("$0-evict", cache_name_),
-                        &FileCache::RunDescriptorExpiry, this,
-                        &descriptor_expiry_thread_);
+  RETURN_NOT_OK(Thread::Create("cache", Substitute("$0-evict", cache_name_),
+                               &FileCache::RunDescriptorExpiry, this,
+                               &descriptor_expiry_thread_));
+  {
+    MutexLock l(close_lock_);
+    closer_running_ = true;
+  }
+  Status s = Thread::Create("cache", Substitute("$0-close", cache_name_),
+                            &FileCache::RunCloser, this, &closer_thread_);
+  if (!s.ok()) {
+    MutexLock l(close_lock_);
+    closer_running_ = false;
+  }
+  return s;
 }
 
 template <class FileType>
@@ -423,13 +493,14 @@ Status FileCache<FileType>::OpenExistingFile(const string& file_name,
   shared_ptr<internal::Descriptor<FileType>> desc;
   {
     // Find an existing descriptor, or create one if none exists.
-    std::lock_guard<simple_spinlock> l(lock_);
-    RETURN_NOT_OK(FindDescriptorUnlocked(file_name, &desc));
+    DescriptorShard* shard = GetShard(file_name);
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    RETURN_NOT_OK(FindDescriptorUnlocked(shard, file_name, &desc));
     if (desc) {
       VLOG(2) << "Found existing descriptor: " << desc->filename();
     } else {
       desc = std::make_shared<internal::Descriptor<FileType>>(this, file_name);
-      InsertOrDie(&descriptors_, file_name, desc);
+      InsertOrDie(&shard->descriptors, file_name, desc);
       VLOG(2) << "Created new descriptor: " << desc->filename();
     }
   }
@@ -444,9 +515,10 @@ Status FileCache<FileType>::OpenExistingFile(const string& file_name,
 template <class FileType>
 Status FileCache<FileType>::DeleteFile(const string& file_name) {
   {
-    std::lock_guard<simple_spinlock> l(lock_);
+    DescriptorShard* shard = GetShard(file_name);
+    std::lock_guard<simple_spinlock> l(shard->lock);
     shared_ptr<internal::Descriptor<FileType>> desc;
-    RETURN_NOT_OK(FindDescriptorUnlocked(file_name, &desc));
+    RETURN_NOT_OK(FindDescriptorUnlocked(shard, file_name, &desc));
 
     if (desc) {
       VLOG(2) << "Marking file for deletion: " << file_name;
@@ -460,53 +532,86 @@ Status FileCache<FileType>::DeleteFile(const string& file_name) {
   // Make sure it's been fully evicted from the cache (perhaps it was opened
   // previously?) so that the filesystem can reclaim the file data instantly.
   cache_->Erase(file_name);
+  ClosePendingFiles();
   return env_->DeleteFile(file_name);
 }
 
+template <class FileType>
+void FileCache<FileType>::Invalidate(const string& file_name) {
+  {
+    DescriptorShard* shard = GetShard(file_name);
+    std::lock_guard<simple_spinlock> l(shard->lock);
+    auto it = shard->descriptors.find(file_name);
+    DCHECK(it == shard->descriptors.end() || it->second.expired())
+        << "Outstanding descriptor for " << file_name;
+  }
+  cache_->Erase(file_name);
+  ClosePendingFiles();
+}
+
 template <class FileType>
 int FileCache<FileType>::NumDescriptorsForTests() const {
-  std::lock_guard<simple_spinlock> l(lock_);
-  return descriptors_.size();
+  int count = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    count += shard.descriptors.size();
+  }
+  return count;
+}
+
+template <class FileType>
+int FileCache<FileType>::NumPendingClosesForTests() const {
+  MutexLock l(close_lock_);
+  return pending_closes_.size();
 }
 
 template <class FileType>
 string FileCache<FileType>::ToDebugString() const {
-  std::lock_guard<simple_spinlock> l(lock_);
   string ret;
-  for (const auto& e : descriptors_) {
-    bool strong = false;
-    bool deleted = false;
-    bool opened = false;
-    shared_ptr<internal::Descriptor<FileType>> desc = e.second.lock();
-    if (desc) {
-      strong = true;
-      if (desc->base_.deleted()) {
-        deleted = true;
+  for (const auto& shard : shards_) {
+    std::lock_guard<simple_spinlock> l(shard.lock);
+    for (const auto& e : shard.descriptors) {
+      bool strong = false;
+      bool deleted = false;
+      bool opened = false;
+      shared_ptr<internal::Descriptor<FileType>> desc = e.second.lock();
+      if (desc) {
+        strong = true;
+        if (desc->base_.deleted()) {
+          deleted = true;
+        }
+        internal::ScopedOpenedDescriptor<FileType> o(
+            desc->base_.LookupFromCache());
+        if (o.opened()) {
+          opened = true;
+        }
       }
-      internal::ScopedOpenedDescriptor<FileType> o(
-          desc->base_.LookupFromCache());
-      if (o.opened()) {
-        opened = true;
+      if (strong) {
+        ret += Substitute("$0 (S$1$2)\n", e.first,
+                          deleted ? "D" : "", opened ? "O" : "");
+      } else {
+        ret += Substitute("$0\n", e.first);
       }
     }
-    if (strong) {
-      ret += Substitute("$0 (S$1$2)\n", e.first,
-                        deleted ? "D" : "", opened ? "O" : "");
-    } else {
-      ret += Substitute("$0\n", e.first);
-    }
   }
   return ret;
 }
 
+template <class FileType>
+typename FileCache<FileType>::DescriptorShard* FileCache<FileType>::GetShard(
+    const string& file_name) {
+  return &shards_[std::hash<string>()(file_name) % kNumDescriptorShards];
+}
+
 template <class FileType>
 Status FileCache<FileType>::FindDescriptorUnlocked(
+    DescriptorShard* shard,
     const string& file_name,
     shared_ptr<internal::Descriptor<FileType>>* file) {
-  DCHECK(lock_.is_locked());
+  DCHECK(shard->lock.is_locked());
 
-  auto it = descriptors_.find(file_name);
-  if (it != descriptors_.end()) {
+  auto it = shard->descriptors.find(file_name);
+  if (it != shard->descriptors.end()) {
     // Found the descriptor. Has it expired?
     shared_ptr<internal::Descriptor<FileType>> desc = it->second.lock();
     if (desc) {
@@ -521,7 +626,7 @@ Status FileCache<FileType>::FindDescriptorUnlocked(
       return Status::OK();
     }
     // Descriptor has expired; erase it and pretend we found nothing.
-    descriptors_.erase(it);
+    shard->descriptors.erase(it);
   }
   return Status::OK();
 }
@@ -530,17 +635,77 @@ template <class FileType>
 void FileCache<FileType>::RunDescriptorExpiry() {
   while (!running_.WaitFor(MonoDelta::FromMilliseconds(
       FLAGS_file_cache_expiry_period_ms))) {
-    std::lock_guard<simple_spinlock> l(lock_);
-    for (auto it = descriptors_.begin(); it != descriptors_.end();) {
-      if (it->second.expired()) {
-        it = descriptors_.erase(it);
-      } else {
-        it++;
+    for (auto& shard : shards_) {
+      std::lock_guard<simple_spinlock> l(shard.lock);
+      for (auto it = shard.descriptors.begin(); it != shard.descriptors.end();) {
+        if (it->second.expired()) {
+          it = shard.descriptors.erase(it);
+        } else {
+          it++;
+        }
       }
     }
   }
 }
 
+template <class FileType>
+void FileCache<FileType>::ScheduleClose(FileType* file) {
+  if (PREDICT_TRUE(FLAGS_file_cache_close_in_background)) {
+    MutexLock l(close_lock_);
+    if (closer_running_ &&
+        pending_closes_.size() < static_cast<size_t>(max_pending_closes_)) {
+      pending_closes_.push_back(file);
+      close_cond_.Signal();
+      return;
+    }
+  }
+  delete file;
+}
+
+template <class FileType>
+void FileCache<FileType>::RunCloser() {
+  while (true) {
+    vector<FileType*> to_close;
+    {
+      MutexLock l(close_lock_);
+      while (closer_running_ && pending_closes_.empty()) {
+        close_cond_.Wait();
+      }
+      if (!closer_running_) {
+        break;
+      }
+      to_close.swap(pending_closes_);
+    }
+    for (FileType* f : to_close) {
+      delete f;
+    }
+  }
+  ClosePendingFiles();
+}
+
+template <class FileType>
+void FileCache<FileType>::ClosePendingFiles() {
+  vector<FileType*> to_close;
+  {
+    MutexLock l(close_lock_);
+    to_close.swap(pending_closes_);
+  }
+  for (FileType* f : to_close) {
+    delete f;
+  }
+}
+
+template <class FileType>
+void FileCache<FileType>::RecordOpen(bool hit) {
+  if (hit) {
+    if (open_hits_) {
+      open_hits_->Increment();
+    }
+  } else if (open_misses_) {
+    open_misses_->Increment();
+  }
+}
+
 // Explicit specialization for callers outside this compilation unit.
 template
 FileCache<RWFile>::FileCache(
@@ -559,8 +724,12 @@ Status FileCache<RWFile>::OpenExistingFile(
 template
 Status FileCache<RWFile>::DeleteFile(const string& file_name);
 template
+void FileCache<RWFile>::Invalidate(const string& file_name);
+template
 int FileCache<RWFile>::NumDescriptorsForTests() const;
 template
+int FileCache<RWFile>::NumPendingClosesForTests() const;
+template
 string FileCache<RWFile>::ToDebugString() const;
 
 template
@@ -580,8 +749,12 @@ Status FileCache<RandomAccessFile>::OpenExistingFile(
 template
 Status FileCache<RandomAccessFile>::DeleteFile(const string& file_name);
 template
+void FileCache<RandomAccessFile>::Invalidate(const string& file_name);
+template
 int FileCache<RandomAccessFile>::NumDescriptorsForTests() const;
 template
+int FileCache<RandomAccessFile>::NumPendingClosesForTests() const;
+template
 string FileCache<RandomAccessFile>::ToDebugString() const;
 
 } // namespace kudu
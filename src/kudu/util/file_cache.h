@@ -20,15 +20,18 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <gtest/gtest_prod.h>
 
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/ref_counted.h"
 #include "kudu/util/cache.h"
+#include "kudu/util/condition_variable.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/env.h"
 #include "kudu/util/locks.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/slice.h"
 #include "kudu/util/status.h"
 
@@ -42,8 +45,12 @@ class BaseDescriptor;
 template <class FileType>
 class Descriptor;
 
+template <class FileType>
+class EvictionCallback;
+
 } // namespace internal
 
+class Counter;
 class MetricEntity;
 class Thread;
 
@@ -100,6 +107,9 @@ class FileCache {
   // The 'cache_name' is used to disambiguate amongst other file cache
   // instances. The cache will use 'max_open_files' as a soft upper bound on
   // the number of files open at any given time.
+  //
+  // If 'entity' isn't null, the cache's metrics (including the hits and
+  // misses of file opens) are registered with it.
   FileCache(const std::string& cache_name,
             Env* env,
             int max_open_files,
@@ -111,6 +121,11 @@ class FileCache {
   // Initializes the file cache. Initialization done here may fail.
   Status Init();
 
+  // Makes the cache open files with direct I/O (see
+  // RandomAccessFileOptions::direct_io). Only meaningful for a cache of
+  // RandomAccessFiles, and must be called before any file is opened.
+  void set_direct_io(bool direct_io) { direct_io_ = direct_io; }
+
   // Opens an existing file by name through the cache.
   //
   // The returned 'file' is actually an object called a descriptor. It adheres
@@ -130,33 +145,88 @@ class FileCache {
   // deleted immediately.
   Status DeleteFile(const std::string& file_name);
 
+  // Closes the cached open file of 'file_name', if any, so that the next
+  // OpenExistingFile() opens the file anew. Used after the file was replaced,
+  // e.g. by renaming another file over it.
+  //
+  // There must be no outstanding descriptor for the file.
+  void Invalidate(const std::string& file_name);
+
   // Returns the number of entries in the descriptor map.
   //
   // Only intended for unit tests.
   int NumDescriptorsForTests() const;
 
+  // Returns the number of evicted files waiting to be closed.
+  //
+  // Only intended for unit tests.
+  int NumPendingClosesForTests() const;
+
   // Dumps the contents of the file cache. Intended for debugging.
   std::string ToDebugString() const;
 
  private:
   friend class internal::BaseDescriptor<FileType>;
+  friend class internal::EvictionCallback<FileType>;
 
   template<class FileType2>
   FRIEND_TEST(FileCacheTest, TestBasicOperations);
 
-  // Looks up a descriptor by file name.
+  // The descriptor map is split into shards, each with its own lock, so that
+  // concurrent opens of different files rarely contend.
+  static const int kNumDescriptorShards = 16;
+
+  struct DescriptorShard {
+    // Protects 'descriptors'.
+    mutable simple_spinlock lock;
+
+    // Maps filenames to descriptors.
+    std::unordered_map<std::string,
+                       std::weak_ptr<internal::Descriptor<FileType>>> descriptors;
+  };
+
+  // Returns the descriptor shard responsible for 'file_name'.
+  DescriptorShard* GetShard(const std::string& file_name);
+
+  // Looks up a descriptor by file name in 'shard'.
   //
-  // Must be called with 'lock_' held.
+  // Must be called with the shard's lock held.
   Status FindDescriptorUnlocked(
+      DescriptorShard* shard,
       const std::string& file_name,
       std::shared_ptr<internal::Descriptor<FileType>>* file);
 
-  // Periodically removes expired descriptors from 'descriptors_'.
+  // Periodically removes expired descriptors from the descriptor shards.
   void RunDescriptorExpiry();
 
+  // Takes ownership of 'file', which was just evicted from the cache, and
+  // closes it.
+  //
+  // The close (which may sync the file) is normally handed off to
+  // 'closer_thread_' as evictions happen on the threads opening files. Files
+  // are closed inline if the background closer isn't running or if too many
+  // closes are already pending, so that the number of open files stays
+  // bounded.
+  void ScheduleClose(FileType* file);
+
+  // Closes the evicted files in 'pending_closes_' until shutdown.
+  void RunCloser();
+
+  // Closes all evicted files in 'pending_closes_' on the calling thread.
+  //
+  // Used after explicitly erasing files from the cache, so that the
+  // filesystem can reclaim the space of deleted files right away.
+  void ClosePendingFiles();
+
+  // Records the outcome of looking up an open file in the cache.
+  void RecordOpen(bool hit);
+
   // Interface to the underlying filesystem.
   Env* env_;
 
+  // See set_direct_io().
+  bool direct_io_;
+
   // Name of the cache.
   const std::string cache_name_;
 
@@ -167,12 +237,7 @@ class FileCache {
   // Underlying cache instance. Caches opened files.
   std::unique_ptr<Cache> cache_;
 
-  // Protects the descriptor map.
-  mutable simple_spinlock lock_;
-
-  // Maps filenames to descriptors.
-  std::unordered_map<std::string,
-                     std::weak_ptr<internal::Descriptor<FileType>>> descriptors_;
+  DescriptorShard shards_[kNumDescriptorShards];
 
   // Calls RunDescriptorExpiry() in a loop until 'running_' isn't set.
   scoped_refptr<Thread> descriptor_expiry_thread_;
@@ -180,6 +245,30 @@ class FileCache {
   // Tracks whether or not 'descriptor_expiry_thread_' should be running.
   CountDownLatch running_;
 
+  // The maximum number of evicted files which may wait to be closed by
+  // 'closer_thread_'.
+  const int max_pending_closes_;
+
+  // Protects 'pending_closes_' and 'closer_running_'.
+  mutable Mutex close_lock_;
+
+  // Signaled when files are added to 'pending_closes_' or on shutdown.
+  ConditionVariable close_cond_;
+
+  // Evicted files waiting to be closed. Owned.
+  std::vector<FileType*> pending_closes_;
+
+  // Whether 'closer_thread_' accepts files to close.
+  bool closer_running_;
+
+  // Calls RunCloser() until shutdown.
+  scoped_refptr<Thread> closer_thread_;
+
+  // Counts, respectively, file operations which found their file open in the
+  // cache and those which had to reopen it. May be null.
+  scoped_refptr<Counter> open_hits_;
+  scoped_refptr<Counter> open_misses_;
+
   DISALLOW_COPY_AND_ASSIGN(FileCache);
 };
 
@@ -110,4 +110,26 @@ TEST_F(HdrHistogramTest, PercentileAndCopyTest) {
   ASSERT_EQ(hist.TotalSum(), copy.TotalSum());
 }
 
+TEST_F(HdrHistogramTest, MergeTest) {
+  uint64_t specified_max = 10000;
+  HdrHistogram low(specified_max, kSigDigits);
+  low.IncrementBy(10, 80);
+  low.IncrementBy(100, 10);
+  HdrHistogram high(specified_max, kSigDigits);
+  high.IncrementBy(1000, 5);
+  high.IncrementBy(10000, 3);
+  high.IncrementBy(100000, 1);
+  high.IncrementBy(1000000, 1);
+
+  // Merging into an empty histogram and into a non-empty one.
+  HdrHistogram merged(specified_max, kSigDigits);
+  merged.MergeFrom(high);
+  merged.MergeFrom(low);
+  NO_FATALS(validate_percentiles(&merged, specified_max));
+
+  // Merging an empty histogram changes nothing.
+  merged.MergeFrom(HdrHistogram(specified_max, kSigDigits));
+  NO_FATALS(validate_percentiles(&merged, specified_max));
+}
+
 } // namespace kudu
@@ -165,11 +165,15 @@ void HdrHistogram::IncrementBy(int64_t value, int64_t count) {
   NoBarrier_AtomicIncrement(&total_count_, count);
   NoBarrier_AtomicIncrement(&total_sum_, value * count);
 
+  UpdateMinMax(value, value);
+}
+
+void HdrHistogram::UpdateMinMax(int64_t min, int64_t max) {
   // Update min, if needed.
   {
     Atomic64 min_val;
-    while (PREDICT_FALSE(value < (min_val = MinValue()))) {
-      Atomic64 old_val = NoBarrier_CompareAndSwap(&min_value_, min_val, value);
+    while (PREDICT_FALSE(min < (min_val = NoBarrier_Load(&min_value_)))) {
+      Atomic64 old_val = NoBarrier_CompareAndSwap(&min_value_, min_val, min);
       if (PREDICT_TRUE(old_val == min_val)) break; // CAS success.
     }
   }
@@ -177,8 +181,8 @@ void HdrHistogram::IncrementBy(int64_t value, int64_t count) {
   // Update max, if needed.
   {
     Atomic64 max_val;
-    while (PREDICT_FALSE(value > (max_val = MaxValue()))) {
-      Atomic64 old_val = NoBarrier_CompareAndSwap(&max_value_, max_val, value);
+    while (PREDICT_FALSE(max > (max_val = NoBarrier_Load(&max_value_)))) {
+      Atomic64 old_val = NoBarrier_CompareAndSwap(&max_value_, max_val, max);
       if (PREDICT_TRUE(old_val == max_val)) break; // CAS success.
     }
   }
@@ -197,6 +201,31 @@ void HdrHistogram::IncrementWithExpectedInterval(int64_t value,
   }
 }
 
+void HdrHistogram::MergeFrom(const HdrHistogram& other) {
+  CHECK_EQ(highest_trackable_value_, other.highest_trackable_value_);
+  CHECK_EQ(num_significant_digits_, other.num_significant_digits_);
+
+  // As in the copy constructor, the sum and min are read before the counts
+  // and the max after them, and the total is made consistent with the
+  // merged counts.
+  Atomic64 other_sum = NoBarrier_Load(&other.total_sum_);
+  Atomic64 other_min = NoBarrier_Load(&other.min_value_);
+  uint64_t total_merged_count = 0;
+  for (int i = 0; i < counts_array_length_; i++) {
+    uint64_t count = NoBarrier_Load(&other.counts_[i]);
+    if (count == 0) continue;
+    NoBarrier_AtomicIncrement(&counts_[i], count);
+    total_merged_count += count;
+  }
+  Atomic64 other_max = NoBarrier_Load(&other.max_value_);
+  if (total_merged_count == 0) {
+    return;
+  }
+  NoBarrier_AtomicIncrement(&total_count_, total_merged_count);
+  NoBarrier_AtomicIncrement(&total_sum_, other_sum);
+  UpdateMinMax(other_min, other_max);
+}
+
 ////////////////////////////////////
 
 int HdrHistogram::BucketIndex(uint64_t value) const {
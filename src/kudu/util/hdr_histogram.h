@@ -95,6 +95,13 @@ class HdrHistogram {
   void IncrementWithExpectedInterval(int64_t value,
                                      int64_t expected_interval_between_samples);
 
+  // Add the values recorded in 'other' to this histogram. 'other' must have
+  // the same highest trackable value and number of significant digits.
+  //
+  // Like the copy constructor, this is not a consistent snapshot of 'other'
+  // if values are being recorded into it concurrently.
+  void MergeFrom(const HdrHistogram& other);
+
   // Fetch configuration params.
   uint64_t highest_trackable_value() const { return highest_trackable_value_; }
   int num_significant_digits() const { return num_significant_digits_; }
@@ -175,6 +182,7 @@ class HdrHistogram {
   static const int kMaxValidNumSignificantDigits = 5;
 
   void Init();
+  void UpdateMinMax(int64_t min, int64_t max);
   int CountsArrayIndex(int bucket_index, int sub_bucket_index) const;
 
   uint64_t highest_trackable_value_;
@@ -0,0 +1,95 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/hyperloglog.h"
+
+#include <cmath>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/test_macros.h"
+
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+
+static void AddValues(int start, int count, HyperLogLog* hll) {
+  for (int i = start; i < start + count; i++) {
+    string value = Substitute("value $0", i);
+    hll->Add(value);
+  }
+}
+
+// The estimates must fall within a few standard errors of the actual count.
+static void CheckEstimate(uint64_t expected, const HyperLogLog& hll) {
+  double error = 1.04 / std::sqrt(1 << hll.precision());
+  EXPECT_NEAR(expected, hll.Estimate(), 4 * error * expected + 1);
+}
+
+TEST(HyperLogLogTest, TestEstimate) {
+  HyperLogLog hll;
+  EXPECT_EQ(0, hll.Estimate());
+
+  // Small counts are estimated almost exactly.
+  AddValues(0, 10, &hll);
+  EXPECT_EQ(10, hll.Estimate());
+
+  // Repeated values don't count.
+  AddValues(0, 10, &hll);
+  EXPECT_EQ(10, hll.Estimate());
+
+  for (int count : { 1000, 100000, 1000000 }) {
+    HyperLogLog large;
+    AddValues(0, count, &large);
+    CheckEstimate(count, large);
+  }
+}
+
+TEST(HyperLogLogTest, TestMerge) {
+  HyperLogLog a;
+  HyperLogLog b;
+  AddValues(0, 60000, &a);
+  AddValues(40000, 60000, &b);
+  ASSERT_OK(a.Merge(b));
+  CheckEstimate(100000, a);
+
+  HyperLogLog other_precision(10);
+  Status s = a.Merge(other_precision);
+  ASSERT_TRUE(s.IsInvalidArgument()) << s.ToString();
+}
+
+TEST(HyperLogLogTest, TestFromRegisters) {
+  HyperLogLog hll(10);
+  AddValues(0, 5000, &hll);
+
+  HyperLogLog copy;
+  ASSERT_OK(copy.FromRegisters(hll.registers()));
+  EXPECT_EQ(10, copy.precision());
+  EXPECT_EQ(hll.Estimate(), copy.Estimate());
+
+  // Not a power of two.
+  Status s = copy.FromRegisters(string(1000, '\0'));
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+  // A register beyond the number of hash bits.
+  s = copy.FromRegisters(string(1024, '\x7f'));
+  ASSERT_TRUE(s.IsCorruption()) << s.ToString();
+}
+
+} // namespace kudu
@@ -0,0 +1,111 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/hyperloglog.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glog/logging.h>
+
+#include "kudu/gutil/bits.h"
+#include "kudu/gutil/hash/city.h"
+#include "kudu/gutil/strings/substitute.h"
+
+using strings::Substitute;
+
+namespace kudu {
+
+HyperLogLog::HyperLogLog(int precision)
+    : precision_(precision),
+      registers_(1 << precision, '\0') {
+  DCHECK_GE(precision, kMinPrecision);
+  DCHECK_LE(precision, kMaxPrecision);
+}
+
+void HyperLogLog::Add(const Slice& value) {
+  AddHash(util_hash::CityHash64(reinterpret_cast<const char*>(value.data()), value.size()));
+}
+
+void HyperLogLog::AddHash(uint64_t hash) {
+  // The top bits of the hash pick a register, which keeps the largest
+  // position of the first set bit in the rest of the hash. The guard bit
+  // bounds the position when the rest is all zeros.
+  uint64_t idx = hash >> (64 - precision_);
+  uint64_t rest = (hash << precision_) | (1ULL << (precision_ - 1));
+  uint8_t rank = 64 - Bits::Log2FloorNonZero64(rest);
+  uint8_t& reg = reinterpret_cast<uint8_t&>(registers_[idx]);
+  reg = std::max(reg, rank);
+}
+
+Status HyperLogLog::Merge(const HyperLogLog& other) {
+  if (other.precision_ != precision_) {
+    return Status::InvalidArgument(
+        Substitute("cannot merge HyperLogLog sketches of precisions $0 and $1",
+                   precision_, other.precision_));
+  }
+  for (size_t i = 0; i < registers_.size(); i++) {
+    registers_[i] = std::max<uint8_t>(registers_[i], other.registers_[i]);
+  }
+  return Status::OK();
+}
+
+uint64_t HyperLogLog::Estimate() const {
+  const double m = registers_.size();
+  double alpha;
+  switch (registers_.size()) {
+    case 16: alpha = 0.673; break;
+    case 32: alpha = 0.697; break;
+    case 64: alpha = 0.709; break;
+    default: alpha = 0.7213 / (1 + 1.079 / m); break;
+  }
+  double sum = 0;
+  int num_zeros = 0;
+  for (char c : registers_) {
+    uint8_t reg = c;
+    sum += std::ldexp(1.0, -reg);
+    num_zeros += reg == 0;
+  }
+  double estimate = alpha * m * m / sum;
+  // Small cardinalities are better estimated by linear counting of the
+  // registers still empty. The 64-bit hashes need no large range correction.
+  if (estimate <= 2.5 * m && num_zeros > 0) {
+    estimate = m * std::log(m / num_zeros);
+  }
+  return static_cast<uint64_t>(std::llround(estimate));
+}
+
+Status HyperLogLog::FromRegisters(const Slice& registers) {
+  size_t size = registers.size();
+  if (size < (1 << kMinPrecision) || size > (1 << kMaxPrecision) ||
+      (size & (size - 1)) != 0) {
+    return Status::Corruption(
+        Substitute("invalid number of HyperLogLog registers: $0", size));
+  }
+  int precision = Bits::Log2FloorNonZero(size);
+  for (size_t i = 0; i < size; i++) {
+    if (registers[i] > 64 - precision + 1) {
+      return Status::Corruption(
+          Substitute("invalid HyperLogLog register value: $0", registers[i]));
+    }
+  }
+  precision_ = precision;
+  registers_ = registers.ToString();
+  return Status::OK();
+}
+
+} // namespace kudu
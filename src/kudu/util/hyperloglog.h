@@ -0,0 +1,79 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_HYPERLOGLOG_H
+#define KUDU_UTIL_HYPERLOGLOG_H
+
+#include <cstdint>
+#include <string>
+
+#include "kudu/util/slice.h"
+#include "kudu/util/status.h"
+
+namespace kudu {
+
+// A HyperLogLog sketch, which estimates the number of distinct values added
+// to it in a fixed amount of memory: 2^precision one-byte registers. The
+// standard error of the estimate is about 1.04 / sqrt(2^precision), e.g.
+// 1.6% with the default precision of 12 (4KB).
+//
+// Sketches of the same precision can be merged, estimating the number of
+// distinct values of the union of their inputs.
+//
+// See "HyperLogLog: the analysis of a near-optimal cardinality estimation
+// algorithm", Flajolet et al., AofA 2007.
+//
+// This class is not thread-safe.
+class HyperLogLog {
+ public:
+  static const int kDefaultPrecision = 12;
+  static const int kMinPrecision = 4;
+  static const int kMaxPrecision = 18;
+
+  explicit HyperLogLog(int precision = kDefaultPrecision);
+
+  // Add a value, by its bytes.
+  void Add(const Slice& value);
+
+  // Add a value by a 64-bit hash of it, which must be well mixed.
+  void AddHash(uint64_t hash);
+
+  // Merge the values of 'other' into this sketch. Returns InvalidArgument if
+  // the precisions of the sketches differ.
+  Status Merge(const HyperLogLog& other);
+
+  // Return the estimated number of distinct values added.
+  uint64_t Estimate() const;
+
+  int precision() const { return precision_; }
+
+  // The registers of the sketch, one byte each, which are all there is to
+  // serialize.
+  const std::string& registers() const { return registers_; }
+
+  // Replace the contents of the sketch with 'registers', as returned by
+  // registers(). The precision is that of the number of registers. Returns
+  // Corruption if they aren't a valid sketch.
+  Status FromRegisters(const Slice& registers);
+
+ private:
+  int precision_;
+  std::string registers_;
+};
+
+} // namespace kudu
+
+#endif
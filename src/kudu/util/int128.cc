@@ -0,0 +1,42 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/int128.h"
+
+#include <algorithm>
+#include <ostream>
+#include <string>
+
+std::ostream& operator<<(std::ostream& os, const uint128_t& val) {
+  if (val == 0) {
+    return os << '0';
+  }
+  std::string digits;
+  for (uint128_t v = val; v != 0; v /= 10) {
+    digits.push_back(static_cast<char>('0' + static_cast<int>(v % 10)));
+  }
+  std::reverse(digits.begin(), digits.end());
+  return os << digits;
+}
+
+std::ostream& operator<<(std::ostream& os, const int128_t& val) {
+  if (val < 0) {
+    // Negate in the unsigned domain, where -INT128_MIN doesn't overflow.
+    return os << '-' << (~static_cast<uint128_t>(val) + 1);
+  }
+  return os << static_cast<uint128_t>(val);
+}
@@ -0,0 +1,45 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+// This file is the central location for defining the int128 type
+// used by Kudu. Though this file is small it ensures flexibility
+// as choices and standards around int128 change.
+#ifndef KUDU_UTIL_INT128_H_
+#define KUDU_UTIL_INT128_H_
+
+#include <iosfwd>
+
+// Both gcc and clang provide the 128-bit integers on 64-bit platforms.
+typedef unsigned __int128 uint128_t;
+typedef signed __int128 int128_t;
+
+namespace kudu {
+
+static const uint128_t UINT128_MIN = static_cast<uint128_t>(0);
+static const uint128_t UINT128_MAX = ~UINT128_MIN;
+static const int128_t INT128_MAX = static_cast<int128_t>(UINT128_MAX >> 1);
+static const int128_t INT128_MIN = -INT128_MAX - 1;
+
+} // namespace kudu
+
+// Prints the decimal representation of a 128-bit integer, which the
+// standard library has no overload for. These are not exported from the
+// client library.
+std::ostream& operator<<(std::ostream& os, const int128_t& val);
+std::ostream& operator<<(std::ostream& os, const uint128_t& val);
+
+#endif // KUDU_UTIL_INT128_H_
@@ -43,6 +43,15 @@ void IntervalTree<Traits>::FindContainingPoint(const point_type &query,
   }
 }
 
+template<class Traits>
+template<class Callback>
+void IntervalTree<Traits>::ForEachIntervalContainingPoints(
+    const std::vector<point_type> &points, const Callback &cb) const {
+  if (root_) {
+    root_->ForEachIntervalContainingPoints(points, 0, points.size(), cb);
+  }
+}
+
 template<class Traits>
 void IntervalTree<Traits>::FindIntersectingInterval(const interval_type &query,
                                                     IntervalVector *results) const {
@@ -154,6 +163,13 @@ class ITNode {
   void FindContainingPoint(const point_type &query,
                            IntervalVector *results) const;
 
+  // See IntervalTree::ForEachIntervalContainingPoints(...). Only considers
+  // the points in the index range [begin, end).
+  template<class Callback>
+  void ForEachIntervalContainingPoints(const std::vector<point_type> &points,
+                                       int begin, int end,
+                                       const Callback &cb) const;
+
   // See IntervalTree::FindIntersectingInterval(...)
   void FindIntersectingInterval(const interval_type &query,
                                 IntervalVector *results) const;
@@ -254,6 +270,65 @@ void ITNode<Traits>::FindContainingPoint(const point_type &query,
   }
 }
 
+template<class Traits>
+template<class Callback>
+void ITNode<Traits>::ForEachIntervalContainingPoints(const std::vector<point_type> &points,
+                                                     int begin, int end,
+                                                     const Callback &cb) const {
+  if (begin == end) {
+    return;
+  }
+  // Split the points into those left of, at, and right of the split point.
+  auto first = points.begin();
+  int mid_begin = std::lower_bound(first + begin, first + end, split_point_,
+                                   &LessThan<Traits>) - first;
+  int mid_end = std::upper_bound(first + mid_begin, first + end, split_point_,
+                                 &LessThan<Traits>) - first;
+
+  // The points left of the split point are contained by the overlapping
+  // intervals which start at or before them.
+  for (const interval_type &interval : overlapping_by_asc_left_) {
+    int i = std::lower_bound(first + begin, first + mid_begin, Traits::get_left(interval),
+                             &LessThan<Traits>) - first;
+    if (i == mid_begin) {
+      // Intervals further down the list start even later.
+      break;
+    }
+    for (; i < mid_begin; i++) {
+      cb(i, interval);
+    }
+  }
+
+  // The points at the split point are contained by all of the overlapping
+  // intervals.
+  for (int i = mid_begin; i < mid_end; i++) {
+    for (const interval_type &interval : overlapping_by_asc_left_) {
+      cb(i, interval);
+    }
+  }
+
+  // The points right of the split point are contained by the overlapping
+  // intervals which end at or after them.
+  for (const interval_type &interval : overlapping_by_desc_right_) {
+    int i_end = std::upper_bound(first + mid_end, first + end, Traits::get_right(interval),
+                                 &LessThan<Traits>) - first;
+    if (i_end == mid_end) {
+      // Intervals further down the list end even earlier.
+      break;
+    }
+    for (int i = mid_end; i < i_end; i++) {
+      cb(i, interval);
+    }
+  }
+
+  if (left_ != NULL) {
+    left_->ForEachIntervalContainingPoints(points, begin, mid_begin, cb);
+  }
+  if (right_ != NULL) {
+    right_->ForEachIntervalContainingPoints(points, mid_end, end, cb);
+  }
+}
+
 template<class Traits>
 void ITNode<Traits>::FindIntersectingInterval(const interval_type &query,
                                               IntervalVector *results) const {
@@ -149,6 +149,27 @@ static void VerifyFindIntersectingInterval(const vector<IntInterval> all_interva
 }
 
 
+// Verify that IntervalTree::ForEachIntervalContainingPoints yields the same
+// results as the naive brute-force O(n) algorithm for each of the points.
+static void VerifyForEachIntervalContainingPoints(const vector<IntInterval> all_intervals,
+                                                  const IntervalTree<IntTraits> &tree,
+                                                  const vector<int> &points) {
+  vector<vector<IntInterval>> results(points.size());
+  tree.ForEachIntervalContainingPoints(points, [&](int i, const IntInterval &interval) {
+      results[i].push_back(interval);
+    });
+  for (int i = 0; i < points.size(); i++) {
+    std::sort(results[i].begin(), results[i].end(), CompareIntervals);
+
+    vector<IntInterval> brute_force;
+    FindContainingBruteForce(all_intervals, points[i], &brute_force);
+    std::sort(brute_force.begin(), brute_force.end(), CompareIntervals);
+
+    SCOPED_TRACE(Stringify(all_intervals) + StringPrintf(" (q=%d)", points[i]));
+    EXPECT_EQ(Stringify(brute_force), Stringify(results[i]));
+  }
+}
+
 TEST_F(TestIntervalTree, TestBasic) {
   vector<IntInterval> intervals;
   intervals.push_back(IntInterval(1, 2));
@@ -163,6 +184,7 @@ TEST_F(TestIntervalTree, TestBasic) {
       VerifyFindIntersectingInterval(intervals, t, IntInterval(i, j));
     }
   }
+  VerifyForEachIntervalContainingPoints(intervals, t, { 0, 1, 1, 2, 3, 4, 5 });
 }
 
 TEST_F(TestIntervalTree, TestRandomized) {
@@ -188,6 +210,17 @@ TEST_F(TestIntervalTree, TestRandomized) {
     int r = l + rand() % 100; // NOLINT(runtime/threadsafe_fn)
     VerifyFindIntersectingInterval(intervals, t, IntInterval(l, r));
   }
+
+  // Test that we get the correct results for random sorted batches of points.
+  for (int i = 0; i < 100; i++) {
+    vector<int> points;
+    int num_points = rand() % 50; // NOLINT(runtime/threadsafe_fn)
+    for (int j = 0; j < num_points; j++) {
+      points.push_back(rand() % 202 - 1); // NOLINT(runtime/threadsafe_fn)
+    }
+    std::sort(points.begin(), points.end());
+    VerifyForEachIntervalContainingPoints(intervals, t, points);
+  }
 }
 
 TEST_F(TestIntervalTree, TestEmpty) {
@@ -196,6 +229,7 @@ TEST_F(TestIntervalTree, TestEmpty) {
 
   VerifyFindContainingPoint(empty, t, 1);
   VerifyFindIntersectingInterval(empty, t, IntInterval(1, 2));
+  VerifyForEachIntervalContainingPoints(empty, t, { 1, 2 });
 }
 
 } // namespace kudu
@@ -87,6 +87,17 @@ class IntervalTree {
   void FindContainingPoint(const point_type &query,
                            IntervalVector *results) const;
 
+  // For each query point 'points[i]' and each interval in the tree which
+  // contains it, call 'cb(i, interval)'. 'points' must be sorted in
+  // ascending order.
+  //
+  // This is equivalent to calling FindContainingPoint() for each point, but
+  // walks the tree only once for the whole set of points. The calls come in
+  // no particular order.
+  template<class Callback>
+  void ForEachIntervalContainingPoints(const std::vector<point_type> &points,
+                                       const Callback &cb) const;
+
   // Find all intervals in the tree which intersect the given interval.
   // The resulting intervals are added to the 'results' vector.
   // The vector is not cleared first.
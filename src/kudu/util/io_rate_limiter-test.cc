@@ -0,0 +1,115 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/io_rate_limiter.h"
+
+#include <algorithm>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "kudu/util/test_util.h"
+
+DECLARE_int32(background_io_foreground_latency_target_ms);
+DECLARE_int32(background_io_max_mb_per_sec);
+
+namespace kudu {
+
+class IoRateLimiterTest : public KuduTest {
+};
+
+TEST_F(IoRateLimiterTest, TestUnlimited) {
+  IoRateLimiter limiter;
+  MonoTime now = MonoTime::Now();
+  MonoDelta wait;
+  for (int i = 0; i < 100; i++) {
+    ASSERT_TRUE(limiter.TryTake(now, 1024 * 1024 * 1024, &wait));
+  }
+  ASSERT_EQ(0, limiter.bytes_per_sec(now));
+
+  // The flag applies to limiters without an override.
+  FLAGS_background_io_max_mb_per_sec = 10;
+  ASSERT_EQ(10 * 1024 * 1024, limiter.bytes_per_sec(now));
+  ASSERT_EQ(0, IoRateLimiter(0).bytes_per_sec(now));
+}
+
+TEST_F(IoRateLimiterTest, TestRate) {
+  IoRateLimiter limiter(1000 * 1000);
+  MonoTime now = MonoTime::Now();
+  MonoDelta wait;
+
+  // A request bigger than the bucket goes through, but the ones after it
+  // wait for the debt to be paid off.
+  ASSERT_TRUE(limiter.TryTake(now, 500 * 1000, &wait));
+  ASSERT_FALSE(limiter.TryTake(now, 1, &wait));
+  ASSERT_EQ(500, wait.ToMilliseconds());
+  now += MonoDelta::FromMilliseconds(250);
+  ASSERT_FALSE(limiter.TryTake(now, 1, &wait));
+  ASSERT_EQ(250, wait.ToMilliseconds());
+  now += wait;
+  ASSERT_TRUE(limiter.TryTake(now, 1, &wait));
+
+  // An idle limiter only accumulates a burst's worth of tokens.
+  now += MonoDelta::FromSeconds(10);
+  ASSERT_TRUE(limiter.TryTake(now, 300 * 1000, &wait));
+  ASSERT_FALSE(limiter.TryTake(now, 1, &wait));
+  ASSERT_EQ(200, wait.ToMilliseconds());
+}
+
+TEST_F(IoRateLimiterTest, TestBackoff) {
+  FLAGS_background_io_foreground_latency_target_ms = 10;
+  const int64_t kRate = 1000 * 1000;
+  IoRateLimiter limiter(kRate);
+  MonoTime now = MonoTime::Now();
+  ASSERT_EQ(kRate, limiter.bytes_per_sec(now));
+
+  // Slow foreground reads halve the rate in every period, down to a
+  // sixteenth of the limit.
+  for (int i = 1; i <= 10; i++) {
+    limiter.ReportForegroundLatency(now, MonoDelta::FromMilliseconds(50));
+    now += MonoDelta::FromMilliseconds(100);
+    ASSERT_EQ(std::max(kRate >> i, kRate / 16), limiter.bytes_per_sec(now));
+  }
+
+  // Fast foreground reads let it recover.
+  for (int i = 0; i < 9; i++) {
+    limiter.ReportForegroundLatency(now, MonoDelta::FromMilliseconds(1));
+    now += MonoDelta::FromMilliseconds(100);
+    ASSERT_LT(limiter.bytes_per_sec(now), kRate);
+    if (i == 0) {
+      ASSERT_GT(limiter.bytes_per_sec(now), kRate / 16);
+    }
+  }
+  now += MonoDelta::FromMilliseconds(100);
+  ASSERT_EQ(kRate, limiter.bytes_per_sec(now));
+}
+
+TEST_F(IoRateLimiterTest, TestScopedBackgroundIo) {
+  ASSERT_FALSE(IoRateLimiter::IsBackgroundIoThread());
+  {
+    ScopedBackgroundIo background;
+    ASSERT_TRUE(IoRateLimiter::IsBackgroundIoThread());
+    {
+      ScopedBackgroundIo foreground(false);
+      ASSERT_FALSE(IoRateLimiter::IsBackgroundIoThread());
+    }
+    ASSERT_TRUE(IoRateLimiter::IsBackgroundIoThread());
+  }
+  ASSERT_FALSE(IoRateLimiter::IsBackgroundIoThread());
+}
+
+} // namespace kudu
@@ -0,0 +1,150 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/io_rate_limiter.h"
+
+#include <algorithm>
+#include <mutex>
+
+#include <gflags/gflags.h>
+
+#include "kudu/util/flag_tags.h"
+
+DEFINE_int32(background_io_max_mb_per_sec, 0,
+             "Maximum number of megabytes per second which flushes and compactions "
+             "may read and write on each data directory, unless overridden by "
+             "--background_io_max_mb_per_sec_by_dir. 0 means no limit.");
+TAG_FLAG(background_io_max_mb_per_sec, experimental);
+TAG_FLAG(background_io_max_mb_per_sec, runtime);
+
+DEFINE_int32(background_io_foreground_latency_target_ms, 0,
+             "If foreground reads from a data directory take longer than this on "
+             "average, the rate allowed to flushes and compactions on that directory "
+             "is halved, down to a sixteenth of its limit, until they speed up again. "
+             "Only applies to directories with a background IO limit. 0 disables "
+             "this backoff.");
+TAG_FLAG(background_io_foreground_latency_target_ms, experimental);
+TAG_FLAG(background_io_foreground_latency_target_ms, runtime);
+
+namespace kudu {
+
+namespace {
+
+// The bucket holds at most this many seconds worth of tokens.
+const double kBurstSeconds = 0.1;
+
+// How often the backoff is adjusted.
+const int64_t kAdjustmentPeriodMs = 100;
+
+// The backoff never goes below this fraction of the limit, and recovers by
+// this much per adjustment period.
+const double kMinBackoff = 1.0 / 16;
+const double kBackoffRecoveryStep = 0.1;
+
+} // anonymous namespace
+
+__thread bool IoRateLimiter::background_io_thread_ = false;
+
+IoRateLimiter::IoRateLimiter(int64_t max_bytes_per_sec)
+    : max_bytes_per_sec_override_(max_bytes_per_sec),
+      tokens_(0),
+      backoff_(1),
+      foreground_latency_sum_us_(0),
+      foreground_latency_count_(0) {
+}
+
+bool IoRateLimiter::IsBackgroundIoThread() {
+  return background_io_thread_;
+}
+
+void IoRateLimiter::Request(int64_t bytes) {
+  MonoDelta wait;
+  while (!TryTake(MonoTime::Now(), bytes, &wait)) {
+    SleepFor(wait);
+  }
+}
+
+bool IoRateLimiter::TryTake(MonoTime now, int64_t bytes, MonoDelta* wait) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  int64_t rate = BytesPerSecUnlocked(now);
+  if (rate == 0) {
+    last_refill_ = MonoTime();
+    return true;
+  }
+
+  if (last_refill_.Initialized()) {
+    tokens_ += rate * (now - last_refill_).ToSeconds();
+    tokens_ = std::min(tokens_, rate * kBurstSeconds);
+  }
+  last_refill_ = now;
+
+  if (tokens_ < 0) {
+    *wait = MonoDelta::FromSeconds(-tokens_ / rate);
+    return false;
+  }
+  tokens_ -= bytes;
+  return true;
+}
+
+void IoRateLimiter::ReportForegroundLatency(MonoTime now, MonoDelta latency) {
+  if (FLAGS_background_io_foreground_latency_target_ms <= 0) {
+    return;
+  }
+  std::lock_guard<simple_spinlock> l(lock_);
+  foreground_latency_sum_us_ += latency.ToMicroseconds();
+  foreground_latency_count_++;
+  AdjustBackoffUnlocked(now);
+}
+
+int64_t IoRateLimiter::bytes_per_sec(MonoTime now) {
+  std::lock_guard<simple_spinlock> l(lock_);
+  return BytesPerSecUnlocked(now);
+}
+
+int64_t IoRateLimiter::BytesPerSecUnlocked(MonoTime now) {
+  int64_t max_rate = max_bytes_per_sec_override_ >= 0 ?
+      max_bytes_per_sec_override_ :
+      static_cast<int64_t>(FLAGS_background_io_max_mb_per_sec) * 1024 * 1024;
+  if (max_rate <= 0) {
+    return 0;
+  }
+  AdjustBackoffUnlocked(now);
+  return std::max<int64_t>(max_rate * backoff_, 1);
+}
+
+void IoRateLimiter::AdjustBackoffUnlocked(MonoTime now) {
+  if (!last_adjustment_.Initialized()) {
+    last_adjustment_ = now;
+    return;
+  }
+  if ((now - last_adjustment_).ToMilliseconds() < kAdjustmentPeriodMs) {
+    return;
+  }
+  last_adjustment_ = now;
+
+  int64_t target_us = FLAGS_background_io_foreground_latency_target_ms * 1000L;
+  if (target_us > 0 && foreground_latency_count_ > 0 &&
+      foreground_latency_sum_us_ / foreground_latency_count_ > target_us) {
+    backoff_ = std::max(backoff_ / 2, kMinBackoff);
+  } else {
+    backoff_ = std::min(backoff_ + kBackoffRecoveryStep, 1.0);
+  }
+  foreground_latency_sum_us_ = 0;
+  foreground_latency_count_ = 0;
+}
+
+} // namespace kudu
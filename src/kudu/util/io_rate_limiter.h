@@ -0,0 +1,118 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_IO_RATE_LIMITER_H
+#define KUDU_UTIL_IO_RATE_LIMITER_H
+
+#include <stdint.h>
+
+#include "kudu/gutil/macros.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+
+namespace kudu {
+
+// A token bucket which limits the bytes per second read and written by
+// background operations, such as flushes and compactions, on one disk so
+// that they leave bandwidth to foreground reads.
+//
+// The limit is --background_io_max_mb_per_sec unless overridden at
+// construction. It is further reduced, down to a sixteenth, while the
+// foreground reads reported through ReportForegroundLatency() are slower
+// than --background_io_foreground_latency_target_ms, and brought back up
+// once they are fast again.
+//
+// This class is thread-safe.
+class IoRateLimiter {
+ public:
+  // 'max_bytes_per_sec' overrides --background_io_max_mb_per_sec unless it
+  // is negative. 0 means no limit.
+  explicit IoRateLimiter(int64_t max_bytes_per_sec = -1);
+
+  // Blocks until 'bytes' of background IO may be done.
+  void Request(int64_t bytes);
+
+  // Takes tokens for 'bytes' of IO at time 'now', returning true. Fewer
+  // tokens than there are bytes may be left, else large requests couldn't
+  // ever be fulfilled: the debt then delays the next requests. Returns
+  // false and sets 'wait' to the time to wait for if the bucket is still in
+  // debt from previous requests.
+  bool TryTake(MonoTime now, int64_t bytes, MonoDelta* wait);
+
+  // Records the latency of a foreground IO on the disk.
+  void ReportForegroundLatency(MonoTime now, MonoDelta latency);
+
+  // Returns the current limit, in bytes per second, accounting for backoff.
+  // 0 means no limit.
+  int64_t bytes_per_sec(MonoTime now);
+
+  // Returns true if the IO done by this thread is background IO. See
+  // ScopedBackgroundIo.
+  static bool IsBackgroundIoThread();
+
+ private:
+  friend class ScopedBackgroundIo;
+
+  // Updates 'backoff_' from the foreground latencies reported since the
+  // last update, at most once per adjustment period.
+  void AdjustBackoffUnlocked(MonoTime now);
+
+  int64_t BytesPerSecUnlocked(MonoTime now);
+
+  static __thread bool background_io_thread_;
+
+  const int64_t max_bytes_per_sec_override_;
+
+  simple_spinlock lock_;
+
+  // Available bytes; negative while in debt.
+  double tokens_;
+  MonoTime last_refill_;
+
+  // The fraction of the configured rate currently allowed.
+  double backoff_;
+  MonoTime last_adjustment_;
+  int64_t foreground_latency_sum_us_;
+  int64_t foreground_latency_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(IoRateLimiter);
+};
+
+// Marks the IO done by the current thread, while in scope, as background IO
+// charged against the IoRateLimiter of the data directory it goes to.
+//
+// Scopes may be nested; 'background' may be false to mark IO as foreground
+// again, e.g. when a pool thread runs tasks on behalf of different callers.
+class ScopedBackgroundIo {
+ public:
+  explicit ScopedBackgroundIo(bool background = true)
+      : prev_(IoRateLimiter::background_io_thread_) {
+    IoRateLimiter::background_io_thread_ = background;
+  }
+
+  ~ScopedBackgroundIo() {
+    IoRateLimiter::background_io_thread_ = prev_;
+  }
+
+ private:
+  const bool prev_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedBackgroundIo);
+};
+
+} // namespace kudu
+
+#endif
@@ -15,6 +15,8 @@
 // specific language governing permissions and limitations
 // under the License.
 
+#include <algorithm>
+
 #include <glog/logging.h>
 #include <gmock/gmock.h>
 #include <string>
@@ -97,9 +99,18 @@ class CountingLogger : public google::base::Logger {
  public:
   void Write(bool force_flush,
              time_t /*timestamp*/,
-             const char* /*message*/,
-             int /*message_len*/) override {
-    message_count_++;
+             const char* message,
+             int message_len) override {
+    // The messages are written in batches, so count the 'x' messages
+    // written by the tests.
+    message_count_ += std::count(message, message + message_len, 'x');
+    if (string(message, message_len).find("log messages because its buffer was full") !=
+        string::npos) {
+      drop_summary_count_++;
+    }
+    if (write_delay_ms_ > 0) {
+      SleepFor(MonoDelta::FromMilliseconds(write_delay_ms_));
+    }
     if (force_flush) {
       Flush();
     }
@@ -117,6 +128,8 @@ class CountingLogger : public google::base::Logger {
 
   int flush_count_ = 0;
   int message_count_ = 0;
+  int write_delay_ms_ = 0;
+  int drop_summary_count_ = 0;
 };
 
 TEST(LoggingTest, TestAsyncLogger) {
@@ -158,6 +171,35 @@ TEST(LoggingTest, TestAsyncLogger) {
   // 'flush' set to true.
   ASSERT_LT(base.flush_count_, kNumMessages * kNumThreads);
   ASSERT_GT(async.app_threads_blocked_count_for_tests(), 0);
+  ASSERT_GT(async.blocked_micros(), 0);
+  ASSERT_EQ(0, async.dropped_messages());
+}
+
+TEST(LoggingTest, TestAsyncLoggerDropsWhenFull) {
+  const int kNumMessages = 10000;
+  const int kBuffer = 1000;
+  CountingLogger base;
+  base.write_delay_ms_ = 1;
+  AsyncLogger async(&base, kBuffer, AsyncLogger::DROP_UNFLUSHED_WHEN_FULL);
+  async.Start();
+
+  // The messages which don't need a flush are dropped rather than blocking
+  // the writer.
+  for (int m = 0; m < kNumMessages; m++) {
+    async.Write(false, m, "x", 1);
+  }
+  async.Flush();
+  ASSERT_EQ(0, async.app_threads_blocked_count_for_tests());
+  ASSERT_GT(async.dropped_messages(), 0);
+  ASSERT_EQ(kNumMessages, base.message_count_ + async.dropped_messages());
+  ASSERT_GT(base.drop_summary_count_, 0);
+
+  // Those which need a flush are never dropped.
+  for (int m = 0; m < kNumMessages; m++) {
+    async.Write(true, m, "x", 1);
+  }
+  async.Stop();
+  ASSERT_EQ(2 * kNumMessages, base.message_count_ + async.dropped_messages());
 }
 
 // Basic test that the redaction utilities work as expected.
@@ -58,6 +58,13 @@ DEFINE_int32(log_async_buffer_bytes_per_level, 2 * 1024 * 1024,
              "level. Only relevant when --log_async is enabled.");
 TAG_FLAG(log_async_buffer_bytes_per_level, hidden);
 
+DEFINE_bool(log_async_drop_when_full, true,
+            "Whether to drop, rather than block on, the log messages below "
+            "--logbuflevel when the async log buffers are full. The number of "
+            "dropped messages is logged in their place. Only relevant when "
+            "--log_async is enabled.");
+TAG_FLAG(log_async_drop_when_full, hidden);
+
 DEFINE_int32(max_log_files, 10,
     "Maximum number of log files to retain per severity level. The most recent "
     "log files are retained. If set to 0, all log files are retained.");
@@ -136,6 +143,12 @@ SimpleSink* registered_sink = nullptr;
 // Protected by 'logging_mutex'.
 int initial_stderr_severity;
 
+// The async loggers installed by EnableAsyncLogging(). They are never
+// destroyed.
+//
+// Protected by 'logging_mutex'.
+vector<AsyncLogger*> async_loggers;
+
 void EnableAsyncLogging() {
   debug::ScopedLeakCheckDisabler leaky;
 
@@ -143,9 +156,13 @@ void EnableAsyncLogging() {
   // to ensure that we get the fatal log message written before exiting.
   for (auto level : { google::INFO, google::WARNING, google::ERROR }) {
     auto* orig = google::base::GetLogger(level);
-    auto* async = new AsyncLogger(orig, FLAGS_log_async_buffer_bytes_per_level);
+    auto* async = new AsyncLogger(orig, FLAGS_log_async_buffer_bytes_per_level,
+                                  FLAGS_log_async_drop_when_full ?
+                                  AsyncLogger::DROP_UNFLUSHED_WHEN_FULL :
+                                  AsyncLogger::BLOCK_WHEN_FULL);
     async->Start();
     google::base::SetLogger(level, async);
+    async_loggers.push_back(async);
   }
 }
 
@@ -340,6 +357,24 @@ void GetFullLogFilename(google::LogSeverity severity, string* filename) {
   *filename = ss.str();
 }
 
+int64_t GetAsyncLoggingBlockedMicros() {
+  SpinLockHolder l(&logging_mutex);
+  int64_t total = 0;
+  for (const AsyncLogger* async : async_loggers) {
+    total += async->blocked_micros();
+  }
+  return total;
+}
+
+int64_t GetAsyncLoggingDroppedMessages() {
+  SpinLockHolder l(&logging_mutex);
+  int64_t total = 0;
+  for (const AsyncLogger* async : async_loggers) {
+    total += async->dropped_messages();
+  }
+  return total;
+}
+
 void ShutdownLoggingSafe() {
   SpinLockHolder l(&logging_mutex);
   if (!logging_initialized) return;
@@ -276,6 +276,14 @@ void UnregisterLoggingCallback();
 // file corresponding to this severity
 void GetFullLogFilename(google::LogSeverity severity, std::string* filename);
 
+// Returns the total time threads were blocked logging because the async log
+// buffers were full, in microseconds. Returns 0 if async logging isn't enabled.
+int64_t GetAsyncLoggingBlockedMicros();
+
+// Returns the number of log messages dropped because the async log buffers
+// were full. Returns 0 if async logging isn't enabled.
+int64_t GetAsyncLoggingDroppedMessages();
+
 // Shuts down the google logging library. Call before exit to ensure that log files are
 // flushed.
 void ShutdownLoggingSafe();
@@ -44,6 +44,8 @@ METRIC_DEFINE_histogram(test, maintenance_op_duration,
                         kudu::MetricUnit::kSeconds, "", 60000000LU, 2);
 
 DECLARE_int64(log_target_replay_size_mb);
+DECLARE_int32(maintenance_manager_max_ops_per_data_dir);
+DECLARE_double(maintenance_manager_memory_pressure_pct);
 
 namespace kudu {
 
@@ -81,8 +83,10 @@ class TestMaintenanceOp : public MaintenanceOp {
  public:
   TestMaintenanceOp(const std::string& name,
                     IOUsage io_usage,
-                    const shared_ptr<MemTracker>& tracker)
-    : MaintenanceOp(name, io_usage),
+                    const shared_ptr<MemTracker>& tracker,
+                    PriorityClass priority_class = MaintenanceOp::PERFORMANCE,
+                    const std::string& data_dir = "")
+    : MaintenanceOp(name, io_usage, priority_class, data_dir),
       consumption_(tracker, 500),
       logs_retained_bytes_(0),
       perf_improvement_(0),
@@ -294,6 +298,109 @@ TEST_F(MaintenanceManagerTest, TestLogRetentionPrioritization) {
   manager_->UnregisterOp(&op2);
 }
 
+// Test that the threads reserved for memory relief only run MEMORY_RELIEF ops.
+TEST_F(MaintenanceManagerTest, TestMemoryReliefThreads) {
+  manager_->Shutdown();
+
+  TestMaintenanceOp compact_op("compact", MaintenanceOp::HIGH_IO_USAGE, test_tracker_);
+  compact_op.set_perf_improvement(2);
+  TestMaintenanceOp flush_op("flush", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                             MaintenanceOp::MEMORY_RELIEF);
+  flush_op.set_perf_improvement(1);
+  manager_->RegisterOp(&compact_op);
+  manager_->RegisterOp(&flush_op);
+
+  ASSERT_EQ(&compact_op, manager_->FindBestOp());
+
+  // Once compactions occupy both regular threads, only the flush can run.
+  manager_->IncrementRunningOps(&compact_op);
+  manager_->IncrementRunningOps(&compact_op);
+  ASSERT_EQ(&flush_op, manager_->FindBestOp());
+
+  // ...until the reserved thread is busy too.
+  manager_->IncrementRunningOps(&flush_op);
+  ASSERT_EQ(nullptr, manager_->FindBestOp());
+
+  manager_->DecrementRunningOps(&flush_op);
+  manager_->DecrementRunningOps(&compact_op);
+  manager_->DecrementRunningOps(&compact_op);
+  manager_->UnregisterOp(&compact_op);
+  manager_->UnregisterOp(&flush_op);
+}
+
+// Test that ops tagged with a busy data directory are passed over in favor of
+// ops on other directories.
+TEST_F(MaintenanceManagerTest, TestMaxOpsPerDataDir) {
+  manager_->Shutdown();
+  FLAGS_maintenance_manager_max_ops_per_data_dir = 1;
+
+  TestMaintenanceOp op1("op1", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                        MaintenanceOp::PERFORMANCE, "/data/1");
+  op1.set_perf_improvement(3);
+  TestMaintenanceOp op2("op2", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                        MaintenanceOp::PERFORMANCE, "/data/1");
+  op2.set_perf_improvement(2);
+  TestMaintenanceOp op3("op3", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                        MaintenanceOp::PERFORMANCE, "/data/2");
+  op3.set_perf_improvement(1);
+  manager_->RegisterOp(&op1);
+  manager_->RegisterOp(&op2);
+  manager_->RegisterOp(&op3);
+
+  ASSERT_EQ(&op1, manager_->FindBestOp());
+  manager_->IncrementRunningOps(&op1);
+  ASSERT_EQ(&op3, manager_->FindBestOp());
+
+  // Without a limit, the directory of the op doesn't matter.
+  FLAGS_maintenance_manager_max_ops_per_data_dir = 0;
+  ASSERT_EQ(&op1, manager_->FindBestOp());
+
+  manager_->DecrementRunningOps(&op1);
+  manager_->UnregisterOp(&op1);
+  manager_->UnregisterOp(&op2);
+  manager_->UnregisterOp(&op3);
+}
+
+// Test that past the memory pressure threshold, the memory relief op anchoring
+// the most memory is picked, until the running ones relieve enough of it.
+TEST_F(MaintenanceManagerTest, TestMemoryPressureThreshold) {
+  manager_->Shutdown();
+
+  TestMaintenanceOp compact_op("compact", MaintenanceOp::HIGH_IO_USAGE, test_tracker_);
+  compact_op.set_ram_anchored(0);
+  compact_op.set_perf_improvement(10);
+  TestMaintenanceOp small_flush_op("small_flush", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                                   MaintenanceOp::MEMORY_RELIEF);
+  small_flush_op.set_ram_anchored(100);
+  TestMaintenanceOp large_flush_op("large_flush", MaintenanceOp::HIGH_IO_USAGE, test_tracker_,
+                                   MaintenanceOp::MEMORY_RELIEF);
+  large_flush_op.set_ram_anchored(300);
+  manager_->RegisterOp(&compact_op);
+  manager_->RegisterOp(&small_flush_op);
+  manager_->RegisterOp(&large_flush_op);
+
+  // 40% of the limit is consumed, below the soft limit.
+  int64_t memory_relief_bytes;
+  ASSERT_EQ(&compact_op, manager_->FindBestOp(&memory_relief_bytes));
+  ASSERT_EQ(0, memory_relief_bytes);
+
+  FLAGS_maintenance_manager_memory_pressure_pct = 30;
+  ASSERT_EQ(&large_flush_op, manager_->FindBestOp(&memory_relief_bytes));
+  ASSERT_EQ(300, memory_relief_bytes);
+
+  // Once the large flush runs, the rest of the consumption is under the
+  // threshold.
+  manager_->memory_relief_bytes_running_ = 300;
+  ASSERT_EQ(&compact_op, manager_->FindBestOp(&memory_relief_bytes));
+  ASSERT_EQ(0, memory_relief_bytes);
+
+  manager_->memory_relief_bytes_running_ = 0;
+  FLAGS_maintenance_manager_memory_pressure_pct = 0;
+  manager_->UnregisterOp(&compact_op);
+  manager_->UnregisterOp(&small_flush_op);
+  manager_->UnregisterOp(&large_flush_op);
+}
+
 // Test adding operations and make sure that the history of recently completed operations
 // is correct in that it wraps around and doesn't grow.
 TEST_F(MaintenanceManagerTest, TestCompletedOpsHistory) {
@@ -17,12 +17,14 @@
 
 #include "kudu/util/maintenance_manager.h"
 
+#include <algorithm>
 #include <gflags/gflags.h>
 #include <memory>
 #include <stdint.h>
 #include <string>
 #include <utility>
 
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stringprintf.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/util/debug/trace_event.h"
@@ -46,6 +48,20 @@ DEFINE_int32(maintenance_manager_num_threads, 1,
              "not be above the number of devices.");
 TAG_FLAG(maintenance_manager_num_threads, stable);
 
+DEFINE_int32(maintenance_manager_memory_relief_threads, 1,
+             "Number of maintenance manager threads, in addition to "
+             "--maintenance_manager_num_threads, which only run operations that "
+             "free memory, such as flushes. Other operations never use them, so "
+             "that long compactions can't delay flushes under memory pressure.");
+TAG_FLAG(maintenance_manager_memory_relief_threads, experimental);
+
+DEFINE_int32(maintenance_manager_max_ops_per_data_dir, 0,
+             "Maximum number of maintenance operations which mostly use the disk of "
+             "the same directory that run at once. Operations whose IO is spread "
+             "over all the disks aren't limited. 0 means no limit.");
+TAG_FLAG(maintenance_manager_max_ops_per_data_dir, experimental);
+TAG_FLAG(maintenance_manager_max_ops_per_data_dir, runtime);
+
 DEFINE_int32(maintenance_manager_polling_interval_ms, 250,
        "Polling interval for the maintenance manager scheduler, "
        "in milliseconds.");
@@ -78,6 +94,46 @@ DEFINE_double(data_gc_prioritization_prob, 0.5,
              "such as delta compaction.");
 TAG_FLAG(data_gc_prioritization_prob, experimental);
 
+DEFINE_double(maintenance_manager_memory_pressure_pct, 0,
+              "Percentage of the memory limit past which the scheduler runs the "
+              "memory relief ops (flushes) anchoring the most memory first, ahead of "
+              "ops which free log retention or improve performance. Memory anchored "
+              "by the flushes already running under pressure is not counted. "
+              "0 only relieves memory once the soft memory limit is exceeded.");
+TAG_FLAG(maintenance_manager_memory_pressure_pct, experimental);
+TAG_FLAG(maintenance_manager_memory_pressure_pct, runtime);
+
+DEFINE_double(maintenance_manager_memory_pressure_concurrent_pct, 0,
+              "Percentage of the memory limit past which the scheduler launches "
+              "several memory relief ops back to back, without waiting for the "
+              "polling interval, until the running ones are expected to bring the "
+              "consumption back below this threshold or no thread is free. 0 "
+              "disables it.");
+TAG_FLAG(maintenance_manager_memory_pressure_concurrent_pct, experimental);
+TAG_FLAG(maintenance_manager_memory_pressure_concurrent_pct, runtime);
+
+METRIC_DEFINE_counter(server, maintenance_memory_pressure_ops,
+                      "Maintenance Ops For Memory Pressure",
+                      kudu::MetricUnit::kMaintenanceOperations,
+                      "Number of maintenance operations launched to relieve memory "
+                      "pressure, rather than for their other benefits");
+METRIC_DEFINE_counter(server, maintenance_memory_pressure_bytes,
+                      "Memory Targeted By Maintenance Ops",
+                      kudu::MetricUnit::kBytes,
+                      "Memory anchored by the maintenance operations launched to relieve "
+                      "memory pressure, as of when they were launched");
+METRIC_DEFINE_counter(server, maintenance_memory_pressure_concurrent_launches,
+                      "Concurrent Maintenance Ops For Memory Pressure",
+                      kudu::MetricUnit::kMaintenanceOperations,
+                      "Number of maintenance operations launched to relieve memory "
+                      "pressure right after another one, without waiting for the "
+                      "polling interval");
+METRIC_DEFINE_gauge_int64(server, maintenance_memory_relief_bytes_running,
+                          "Memory Being Relieved By Maintenance Ops",
+                          kudu::MetricUnit::kBytes,
+                          "Memory anchored by the running maintenance operations which "
+                          "were launched to relieve memory pressure");
+
 namespace kudu {
 
 MaintenanceOpStats::MaintenanceOpStats() {
@@ -94,11 +150,14 @@ void MaintenanceOpStats::Clear() {
   last_modified_ = MonoTime();
 }
 
-MaintenanceOp::MaintenanceOp(std::string name, IOUsage io_usage)
+MaintenanceOp::MaintenanceOp(std::string name, IOUsage io_usage,
+                             PriorityClass priority_class, std::string data_dir)
     : name_(std::move(name)),
       running_(0),
       cancel_(false),
-      io_usage_(io_usage) {
+      io_usage_(io_usage),
+      priority_class_(priority_class),
+      data_dir_(std::move(data_dir)) {
 }
 
 MaintenanceOp::~MaintenanceOp() {
@@ -116,11 +175,13 @@ const MaintenanceManager::Options MaintenanceManager::DEFAULT_OPTIONS = {
   .polling_interval_ms = 0,
   .history_size = 0,
   .parent_mem_tracker = shared_ptr<MemTracker>(),
+  .metric_entity = scoped_refptr<MetricEntity>(),
 };
 
 MaintenanceManager::MaintenanceManager(const Options& options)
   : num_threads_(options.num_threads <= 0 ?
       FLAGS_maintenance_manager_num_threads : options.num_threads),
+    num_memory_relief_threads_(std::max(FLAGS_maintenance_manager_memory_relief_threads, 0)),
     cond_(&lock_),
     shutdown_(false),
     running_ops_(0),
@@ -130,9 +191,22 @@ MaintenanceManager::MaintenanceManager(const Options& options)
     completed_ops_count_(0),
     parent_mem_tracker_(!options.parent_mem_tracker ?
         MemTracker::GetRootTracker() : options.parent_mem_tracker),
+    memory_relief_bytes_running_(0),
     rand_(GetRandomSeed32()) {
-  CHECK_OK(ThreadPoolBuilder("MaintenanceMgr").set_min_threads(num_threads_)
-               .set_max_threads(num_threads_).Build(&thread_pool_));
+  if (options.metric_entity) {
+    memory_pressure_ops_ = METRIC_maintenance_memory_pressure_ops.Instantiate(
+        options.metric_entity);
+    memory_pressure_bytes_ = METRIC_maintenance_memory_pressure_bytes.Instantiate(
+        options.metric_entity);
+    memory_pressure_concurrent_launches_ =
+        METRIC_maintenance_memory_pressure_concurrent_launches.Instantiate(
+            options.metric_entity);
+    memory_relief_bytes_running_gauge_ =
+        METRIC_maintenance_memory_relief_bytes_running.Instantiate(options.metric_entity, 0);
+  }
+  const int total_threads = num_threads_ + num_memory_relief_threads_;
+  CHECK_OK(ThreadPoolBuilder("MaintenanceMgr").set_min_threads(total_threads)
+               .set_max_threads(total_threads).Build(&thread_pool_));
   uint32_t history_size = options.history_size == 0 ?
                           FLAGS_maintenance_manager_history_size :
                           options.history_size;
@@ -215,9 +289,14 @@ void MaintenanceManager::RunSchedulerThread() {
   MonoDelta polling_interval = MonoDelta::FromMilliseconds(polling_interval_ms_);
 
   std::unique_lock<Mutex> guard(lock_);
+  // Whether to launch another op right away, to relieve memory pressure.
+  bool launch_again = false;
   while (true) {
     // Loop until we are shutting down or it is time to run another op.
-    cond_.TimedWait(polling_interval);
+    if (!launch_again) {
+      cond_.TimedWait(polling_interval);
+    }
+    launch_again = false;
     if (shutdown_) {
       VLOG_AND_TRACE("maintenance", 1) << LogPrefix() << "Shutting down maintenance manager.";
       return;
@@ -229,7 +308,8 @@ void MaintenanceManager::RunSchedulerThread() {
     }
 
     // Find the best op.
-    MaintenanceOp* op = FindBestOp();
+    int64_t memory_relief_bytes;
+    MaintenanceOp* op = FindBestOp(&memory_relief_bytes);
     if (!op) {
       VLOG_AND_TRACE("maintenance", 2) << LogPrefix()
                                        << "No maintenance operations look worth doing.";
@@ -237,28 +317,57 @@ void MaintenanceManager::RunSchedulerThread() {
     }
 
     // Prepare the maintenance operation.
-    op->running_++;
-    running_ops_++;
+    IncrementRunningOps(op);
     guard.unlock();
     bool ready = op->Prepare();
     guard.lock();
     if (!ready) {
       LOG_WITH_PREFIX(INFO) << "Prepare failed for " << op->name()
                             << ".  Re-running scheduler.";
-      op->running_--;
+      DecrementRunningOps(op);
       op->cond_->Signal();
       continue;
     }
 
+    if (memory_relief_bytes > 0) {
+      memory_relief_bytes_running_ += memory_relief_bytes;
+      if (memory_pressure_ops_) {
+        memory_pressure_ops_->Increment();
+        memory_pressure_bytes_->IncrementBy(memory_relief_bytes);
+        memory_relief_bytes_running_gauge_->set_value(memory_relief_bytes_running_);
+      }
+      // If the memory is still short once this op is done, don't wait to
+      // launch the next one.
+      double concurrent_pct = FLAGS_maintenance_manager_memory_pressure_concurrent_pct;
+      launch_again = concurrent_pct > 0 && MemoryPressurePct() >= concurrent_pct;
+      if (launch_again && memory_pressure_concurrent_launches_) {
+        memory_pressure_concurrent_launches_->Increment();
+      }
+    }
+
     // Run the maintenance operation.
     Status s = thread_pool_->SubmitFunc(boost::bind(
-          &MaintenanceManager::LaunchOp, this, op));
+          &MaintenanceManager::LaunchOp, this, op, memory_relief_bytes));
     CHECK(s.ok());
   }
 }
 
+double MaintenanceManager::MemoryPressurePct() const {
+  double pct = 0;
+  for (shared_ptr<MemTracker> t = parent_mem_tracker_; t; t = t->parent()) {
+    if (t->has_limit() && t->limit() > 0) {
+      pct = std::max(pct, static_cast<double>(t->consumption() - memory_relief_bytes_running_) /
+                          t->limit() * 100);
+    }
+  }
+  return pct;
+}
+
 // Finding the best operation goes through four filters:
 // - If there's an Op that we can run quickly that frees log retention, we run it.
+// - If the memory consumption has reached --maintenance_manager_memory_pressure_pct of the limit,
+//   not counting what the memory relief Ops already running will free, we run the memory relief
+//   Op with the highest RAM usage, i.e. the largest MemRowSet or DeltaMemStore flush of any tablet.
 // - If we've hit the overall process memory limit (note: this includes memory that the Ops cannot
 //   free), we run the Op with the highest RAM usage.
 // - If there are Ops that are retaining logs past our target replay size, we run the one that has
@@ -273,15 +382,21 @@ void MaintenanceManager::RunSchedulerThread() {
 //
 // In the third priority we're at a point where nothing's urgent and there's nothing we can run
 // quickly.
+//
+// Only the Ops which can be launched right away are considered; see CanLaunchOp(). Hence, when
+// only the threads reserved for memory relief are free, or when a data directory already runs
+// as many Ops as it may, the best of the remaining Ops is picked instead.
 // TODO We currently optimize for freeing log retention but we could consider having some sort of
 // sliding priority between log retention and RAM usage. For example, is an Op that frees
 // 128MB of log retention and 12MB of RAM always better than an op that frees 12MB of log retention
 // and 128MB of RAM? Maybe a more holistic approach would be better.
-MaintenanceOp* MaintenanceManager::FindBestOp() {
+MaintenanceOp* MaintenanceManager::FindBestOp(int64_t* memory_relief_bytes) {
   TRACE_EVENT0("maintenance", "MaintenanceManager::FindBestOp");
+  if (memory_relief_bytes) {
+    *memory_relief_bytes = 0;
+  }
 
-  size_t free_threads = num_threads_ - running_ops_;
-  if (free_threads == 0) {
+  if (running_ops_ >= static_cast<uint64_t>(num_threads_ + num_memory_relief_threads_)) {
     VLOG_AND_TRACE("maintenance", 1) << LogPrefix()
                                      << "There are no free threads, so we can't run anything.";
     return nullptr;
@@ -293,6 +408,9 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
   uint64_t most_mem_anchored = 0;
   MaintenanceOp* most_mem_anchored_op = nullptr;
 
+  uint64_t most_relief_mem_anchored = 0;
+  MaintenanceOp* most_relief_mem_anchored_op = nullptr;
+
   int64_t most_logs_retained_bytes = 0;
   int64_t most_logs_retained_bytes_ram_anchored = 0;
   MaintenanceOp* most_logs_retained_bytes_op = nullptr;
@@ -309,7 +427,7 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
     // Update op stats.
     stats.Clear();
     op->UpdateStats(&stats);
-    if (op->cancelled() || !stats.valid() || !stats.runnable()) {
+    if (op->cancelled() || !stats.valid() || !stats.runnable() || !CanLaunchOp(op)) {
       continue;
     }
     if (stats.logs_retained_bytes() > low_io_most_logs_retained_bytes &&
@@ -324,6 +442,11 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
       most_mem_anchored_op = op;
       most_mem_anchored = stats.ram_anchored();
     }
+    if (op->priority_class() == MaintenanceOp::MEMORY_RELIEF &&
+        stats.ram_anchored() > most_relief_mem_anchored) {
+      most_relief_mem_anchored_op = op;
+      most_relief_mem_anchored = stats.ram_anchored();
+    }
     // We prioritize ops that can free more logs, but when it's the same we pick the one that
     // also frees up the most memory.
     if (stats.logs_retained_bytes() > 0 &&
@@ -361,6 +484,23 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
     }
   }
 
+  // As memory pressure nears the limit, flush the largest memory consumers
+  // first.
+  double pressure_pct = FLAGS_maintenance_manager_memory_pressure_pct;
+  if (pressure_pct > 0 && most_relief_mem_anchored_op) {
+    double current_pct = MemoryPressurePct();
+    if (current_pct >= pressure_pct) {
+      VLOG_AND_TRACE("maintenance", 1) << LogPrefix() << "Memory consumption is at "
+              << current_pct << "% of the limit, past the pressure threshold of "
+              << pressure_pct << "%.  Running the memory relief op which anchors the most "
+              << "memory: " << most_relief_mem_anchored_op->name();
+      if (memory_relief_bytes) {
+        *memory_relief_bytes = most_relief_mem_anchored;
+      }
+      return most_relief_mem_anchored_op;
+    }
+  }
+
   // Look at free memory. If it is dangerously low, we must select something
   // that frees memory-- the op with the most anchored memory.
   double capacity_pct;
@@ -375,6 +515,9 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
     VLOG_AND_TRACE("maintenance", 1) << LogPrefix() << "We have exceeded our soft memory limit "
             << "(current capacity is " << capacity_pct << "%).  Running the op "
             << "which anchors the most memory: " << most_mem_anchored_op->name();
+    if (memory_relief_bytes) {
+      *memory_relief_bytes = most_mem_anchored;
+    }
     return most_mem_anchored_op;
   }
 
@@ -411,7 +554,7 @@ MaintenanceOp* MaintenanceManager::FindBestOp() {
   return nullptr;
 }
 
-void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
+void MaintenanceManager::LaunchOp(MaintenanceOp* op, int64_t memory_relief_bytes) {
   MonoTime start_time = MonoTime::Now();
   op->RunningGauge()->Increment();
 
@@ -436,11 +579,57 @@ void MaintenanceManager::LaunchOp(MaintenanceOp* op) {
 
   op->DurationHistogram()->Increment(delta.ToMilliseconds());
 
-  running_ops_--;
-  op->running_--;
+  if (memory_relief_bytes > 0) {
+    memory_relief_bytes_running_ -= memory_relief_bytes;
+    if (memory_relief_bytes_running_gauge_) {
+      memory_relief_bytes_running_gauge_->set_value(memory_relief_bytes_running_);
+    }
+  }
+  DecrementRunningOps(op);
   op->cond_->Signal();
 }
 
+bool MaintenanceManager::CanLaunchOp(const MaintenanceOp* op) const {
+  // Only MEMORY_RELIEF ops may use the reserved threads.
+  uint64_t max_running = num_threads_;
+  if (op->priority_class() == MaintenanceOp::MEMORY_RELIEF) {
+    max_running += num_memory_relief_threads_;
+  }
+  if (running_ops_ >= max_running) {
+    return false;
+  }
+
+  int max_per_data_dir = FLAGS_maintenance_manager_max_ops_per_data_dir;
+  if (max_per_data_dir > 0 && !op->data_dir().empty() &&
+      FindWithDefault(running_ops_by_data_dir_, op->data_dir(), 0) >= max_per_data_dir) {
+    VLOG_AND_TRACE("maintenance", 2) << LogPrefix() << "Not running " << op->name()
+                                     << " since " << max_per_data_dir << " ops are already "
+                                     << "running in " << op->data_dir();
+    return false;
+  }
+  return true;
+}
+
+void MaintenanceManager::IncrementRunningOps(MaintenanceOp* op) {
+  op->running_++;
+  running_ops_++;
+  if (!op->data_dir().empty()) {
+    running_ops_by_data_dir_[op->data_dir()]++;
+  }
+}
+
+void MaintenanceManager::DecrementRunningOps(MaintenanceOp* op) {
+  op->running_--;
+  running_ops_--;
+  if (!op->data_dir().empty()) {
+    auto it = running_ops_by_data_dir_.find(op->data_dir());
+    DCHECK(it != running_ops_by_data_dir_.end());
+    if (--it->second == 0) {
+      running_ops_by_data_dir_.erase(it);
+    }
+  }
+}
+
 void MaintenanceManager::GetMaintenanceManagerStatusDump(MaintenanceManagerStatusPB* out_pb) {
   DCHECK(out_pb != nullptr);
   std::lock_guard<Mutex> guard(lock_);
@@ -40,9 +40,11 @@ namespace kudu {
 
 template<class T>
 class AtomicGauge;
+class Counter;
 class Histogram;
 class MaintenanceManager;
 class MemTracker;
+class MetricEntity;
 
 class MaintenanceOpStats {
  public:
@@ -160,7 +162,23 @@ class MaintenanceOp {
     HIGH_IO_USAGE // Everything else.
   };
 
-  explicit MaintenanceOp(std::string name, IOUsage io_usage);
+  // What running the Op mainly relieves. Threads reserved by
+  // --maintenance_manager_memory_relief_threads only run MEMORY_RELIEF Ops,
+  // so that they don't wait behind long-running compactions when memory is
+  // short.
+  enum PriorityClass {
+    MEMORY_RELIEF, // Flushes of in-memory stores.
+    WAL_RETENTION, // Operations that free log segments.
+    PERFORMANCE    // Everything else, e.g. compactions.
+  };
+
+  // 'data_dir' is the directory whose disk the Op mostly reads and writes, or
+  // empty if its IO is spread over all the disks. At most
+  // --maintenance_manager_max_ops_per_data_dir Ops with the same non-empty
+  // 'data_dir' run at once.
+  MaintenanceOp(std::string name, IOUsage io_usage,
+                PriorityClass priority_class = PERFORMANCE,
+                std::string data_dir = "");
   virtual ~MaintenanceOp();
 
   // Unregister this op, if it is currently registered.
@@ -195,6 +213,10 @@ class MaintenanceOp {
 
   IOUsage io_usage() const { return io_usage_; }
 
+  PriorityClass priority_class() const { return priority_class_; }
+
+  const std::string& data_dir() const { return data_dir_; }
+
   // Return true if the operation has been cancelled due to Unregister() pending.
   bool cancelled() const {
     return cancel_.Load();
@@ -233,6 +255,10 @@ class MaintenanceOp {
   std::shared_ptr<MaintenanceManager> manager_;
 
   IOUsage io_usage_;
+
+  const PriorityClass priority_class_;
+
+  const std::string data_dir_;
 };
 
 struct MaintenanceOpComparator {
@@ -260,6 +286,9 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
     int32_t polling_interval_ms;
     uint32_t history_size;
     std::shared_ptr<MemTracker> parent_mem_tracker;
+    // Where the scheduling decisions taken to relieve memory pressure are
+    // exported, if anywhere.
+    scoped_refptr<MetricEntity> metric_entity;
   };
 
   explicit MaintenanceManager(const Options& options);
@@ -282,19 +311,42 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
 
  private:
   FRIEND_TEST(MaintenanceManagerTest, TestLogRetentionPrioritization);
+  FRIEND_TEST(MaintenanceManagerTest, TestMemoryReliefThreads);
+  FRIEND_TEST(MaintenanceManagerTest, TestMaxOpsPerDataDir);
+  FRIEND_TEST(MaintenanceManagerTest, TestMemoryPressureThreshold);
   typedef std::map<MaintenanceOp*, MaintenanceOpStats,
           MaintenanceOpComparator> OpMapTy;
 
   void RunSchedulerThread();
 
   // find the best op, or null if there is nothing we want to run
-  MaintenanceOp* FindBestOp();
+  //
+  // If 'memory_relief_bytes' is not null, it is set to the memory anchored by
+  // the op if it was picked to relieve memory pressure, and to 0 otherwise.
+  MaintenanceOp* FindBestOp(int64_t* memory_relief_bytes = nullptr);
+
+  // Returns the highest percentage of its limit that the parent memory
+  // tracker or any of its ancestors would consume once the running memory
+  // relief ops have released what they anchored, or 0 if none of them has a
+  // limit.
+  double MemoryPressurePct() const;
+
+  // Returns true if running 'op' now would exceed neither the threads
+  // available to its priority class nor the limit of its data directory.
+  bool CanLaunchOp(const MaintenanceOp* op) const;
 
-  void LaunchOp(MaintenanceOp* op);
+  // Account for an instance of 'op' starting or finishing.
+  void IncrementRunningOps(MaintenanceOp* op);
+  void DecrementRunningOps(MaintenanceOp* op);
+
+  // 'memory_relief_bytes' is as returned by FindBestOp().
+  void LaunchOp(MaintenanceOp* op, int64_t memory_relief_bytes);
 
   std::string LogPrefix() const;
 
   const int32_t num_threads_;
+  // Threads, beyond 'num_threads_', which only run MEMORY_RELIEF ops.
+  const int32_t num_memory_relief_threads_;
   OpMapTy ops_; // registered operations
   Mutex lock_;
   scoped_refptr<kudu::Thread> monitor_thread_;
@@ -302,15 +354,26 @@ class MaintenanceManager : public std::enable_shared_from_this<MaintenanceManage
   ConditionVariable cond_;
   bool shutdown_;
   uint64_t running_ops_;
+  // Number of running ops by non-empty data directory.
+  std::map<std::string, int> running_ops_by_data_dir_;
   int32_t polling_interval_ms_;
   // Vector used as a circular buffer for recently completed ops. Elements need to be added at
   // the completed_ops_count_ % the vector's size and then the count needs to be incremented.
   std::vector<CompletedOp> completed_ops_;
   int64_t completed_ops_count_;
   std::shared_ptr<MemTracker> parent_mem_tracker_;
+  // Memory anchored by the running ops which were picked to relieve memory
+  // pressure, as of when they were picked.
+  int64_t memory_relief_bytes_running_;
   std::string server_uuid_;
   Random rand_;
 
+  // Null unless a metric entity was passed in the options.
+  scoped_refptr<Counter> memory_pressure_ops_;
+  scoped_refptr<Counter> memory_pressure_bytes_;
+  scoped_refptr<Counter> memory_pressure_concurrent_launches_;
+  scoped_refptr<AtomicGauge<int64_t>> memory_relief_bytes_running_gauge_;
+
   DISALLOW_COPY_AND_ASSIGN(MaintenanceManager);
 };
 
@@ -31,6 +31,7 @@
 #include "kudu/util/test_util.h"
 
 DECLARE_int32(memory_limit_soft_percentage);
+DECLARE_int64(memory_tracker_root_batch_bytes);
 
 namespace kudu {
 
@@ -309,6 +310,34 @@ TEST(MemTrackerTest, TcMallocRootTracker) {
   root->UpdateConsumption();
   ASSERT_GT(root->consumption(), value);
 }
+
+TEST(MemTrackerTest, TcMallocRootTrackerBatching) {
+  FLAGS_memory_tracker_root_batch_bytes = 1024 * 1024;
+  shared_ptr<MemTracker> root = MemTracker::GetRootTracker();
+  shared_ptr<MemTracker> child = MemTracker::CreateTracker(-1, "child");
+
+  // Small updates from a child are batched before reaching the root.
+  root->UpdateConsumption();
+  int64_t value = root->consumption();
+  child->Consume(1000);
+  ASSERT_EQ(1000, child->consumption());
+  ASSERT_EQ(value, root->consumption());
+
+  // Exceeding the batch size applies the whole batch.
+  child->Consume(1024 * 1024);
+  ASSERT_EQ(value + 1000 + 1024 * 1024, root->consumption());
+
+  // Checking a limit applies the batch too.
+  child->Release(1000);
+  ASSERT_EQ(value + 1000 + 1024 * 1024, root->consumption());
+  root->SpareCapacity();
+  ASSERT_EQ(value + 1024 * 1024, root->consumption());
+
+  // Without batching, every update is applied at once.
+  FLAGS_memory_tracker_root_batch_bytes = 0;
+  child->Release(1024 * 1024);
+  ASSERT_EQ(value, root->consumption());
+}
 #endif
 
 TEST(MemTrackerTest, CollisionDetection) {
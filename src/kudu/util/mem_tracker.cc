@@ -18,6 +18,7 @@
 #include "kudu/util/mem_tracker.h"
 
 #include <algorithm>
+#include <cstdlib>
 #include <deque>
 #include <limits>
 #include <list>
@@ -59,6 +60,14 @@ DEFINE_int32(memory_limit_warn_threshold_percentage, 98,
              "consume before WARNING level messages are periodically logged.");
 TAG_FLAG(memory_limit_warn_threshold_percentage, advanced);
 
+DEFINE_int64(memory_tracker_root_batch_bytes, 1024 * 1024,
+             "Maximum amount of memory, in bytes, that each thread may consume "
+             "or release before applying it to the root memory tracker, whose "
+             "consumption is periodically refreshed from the memory allocator. "
+             "Limits are always checked against up-to-date consumption from "
+             "the checking thread. A value of 0 applies every update at once.");
+TAG_FLAG(memory_tracker_root_batch_bytes, advanced);
+
 #ifdef TCMALLOC_ENABLED
 DEFINE_int32(tcmalloc_max_free_bytes_percentage, 10,
              "Maximum percentage of the RSS that tcmalloc is allowed to use for "
@@ -89,6 +98,10 @@ static GoogleOnceType root_tracker_once = GOOGLE_ONCE_INIT;
 // is greater than GC_RELEASE_SIZE, this will trigger a tcmalloc gc.
 static Atomic64 released_memory_since_gc;
 
+// Consumption by the calling thread that has not yet been applied to the root
+// tracker. See MemTracker::ConsumeBatched().
+static __thread int64_t tls_batched_root_consumption = 0;
+
 // Validate that various flags are percentages.
 static bool ValidatePercentage(const char* flagname, int value) {
   if (value >= 0 && value <= 100) {
@@ -288,6 +301,29 @@ void MemTracker::UpdateConsumption() {
   DCHECK(!consumption_func_.empty());
   DCHECK(parent_.get() == NULL);
   consumption_.set_value(consumption_func_());
+  // The new value already accounts for this thread's batched consumption.
+  tls_batched_root_consumption = 0;
+}
+
+void MemTracker::ConsumeBatched(int64_t bytes) {
+  DCHECK(!consumption_func_.empty());
+  DCHECK(parent_.get() == NULL);
+  int64_t batched = tls_batched_root_consumption + bytes;
+  if (PREDICT_TRUE(std::abs(batched) < FLAGS_memory_tracker_root_batch_bytes)) {
+    tls_batched_root_consumption = batched;
+    return;
+  }
+  tls_batched_root_consumption = 0;
+  consumption_.IncrementBy(batched);
+}
+
+void MemTracker::FlushBatchedConsumption() {
+  int64_t batched = tls_batched_root_consumption;
+  if (batched == 0) {
+    return;
+  }
+  tls_batched_root_consumption = 0;
+  root_tracker->consumption_.IncrementBy(batched);
 }
 
 void MemTracker::Consume(int64_t bytes) {
@@ -307,9 +343,10 @@ void MemTracker::Consume(int64_t bytes) {
     LogUpdate(true, bytes);
   }
   for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(bytes);
     if (!tracker->consumption_func_.empty()) {
-      DCHECK_GE(tracker->consumption_.current_value(), 0);
+      tracker->ConsumeBatched(bytes);
+    } else {
+      tracker->consumption_.IncrementBy(bytes);
     }
   }
 }
@@ -317,6 +354,8 @@ void MemTracker::Consume(int64_t bytes) {
 bool MemTracker::TryConsume(int64_t bytes) {
   if (!consumption_func_.empty()) {
     UpdateConsumption();
+  } else {
+    FlushBatchedConsumption();
   }
   if (bytes <= 0) {
     return true;
@@ -392,20 +431,16 @@ void MemTracker::Release(int64_t bytes) {
   }
 
   for (auto& tracker : all_trackers_) {
-    tracker->consumption_.IncrementBy(-bytes);
-    // If a UDF calls FunctionContext::TrackAllocation() but allocates less than the
-    // reported amount, the subsequent call to FunctionContext::Free() may cause the
-    // process mem tracker to go negative until it is synced back to the tcmalloc
-    // metric. Don't blow up in this case. (Note that this doesn't affect non-process
-    // trackers since we can enforce that the reported memory usage is internally
-    // consistent.)
     if (!tracker->consumption_func_.empty()) {
-      DCHECK_GE(tracker->consumption_.current_value(), 0);
+      tracker->ConsumeBatched(-bytes);
+    } else {
+      tracker->consumption_.IncrementBy(-bytes);
     }
   }
 }
 
 bool MemTracker::AnyLimitExceeded() {
+  FlushBatchedConsumption();
   for (const auto& tracker : limit_trackers_) {
     if (tracker->LimitExceeded()) {
       return true;
@@ -415,6 +450,7 @@ bool MemTracker::AnyLimitExceeded() {
 }
 
 bool MemTracker::LimitExceeded() {
+  FlushBatchedConsumption();
   if (PREDICT_FALSE(CheckLimitExceeded())) {
     return GcMemory(limit_);
   }
@@ -464,6 +500,7 @@ bool MemTracker::AnySoftLimitExceeded(double* current_capacity_pct) {
 }
 
 int64_t MemTracker::SpareCapacity() const {
+  FlushBatchedConsumption();
   int64_t result = std::numeric_limits<int64_t>::max();
   for (const auto& tracker : limit_trackers_) {
     int64_t mem_left = tracker->limit() - tracker->consumption();
@@ -239,6 +239,18 @@ class MemTracker : public std::enable_shared_from_this<MemTracker> {
     return limit_ >= 0 && limit_ < consumption();
   }
 
+  // Adds 'bytes' to the consumption of this tracker, which must be the root
+  // tracker with a consumption function. Since its consumption is refreshed
+  // from the consumption function anyway, the update is batched with others
+  // from the calling thread, and only applied once the batch exceeds
+  // --memory_tracker_root_batch_bytes in either direction. This avoids
+  // contending on the root tracker's consumption on every update.
+  void ConsumeBatched(int64_t bytes);
+
+  // Applies the calling thread's batched consumption to the root tracker.
+  // Called before checking limits.
+  static void FlushBatchedConsumption();
+
   // If consumption is higher than max_consumption, attempts to free memory by calling any
   // added GC functions.  Returns true if max_consumption is still exceeded. Takes
   // gc_lock. Updates metrics if initialized.
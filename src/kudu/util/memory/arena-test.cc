@@ -88,6 +88,34 @@ TEST(TestArena, TestMultiThreaded) {
   }
 }
 
+// Same as above, with an arena which allocates from per-CPU chunks.
+TEST(TestArena, TestMultiThreadedPerCpuChunks) {
+  CHECK(FLAGS_num_threads < 256);
+
+  shared_ptr<MemTracker> mem_tracker = MemTracker::CreateTracker(-1, "arena-test-tracker");
+  shared_ptr<MemoryTrackingBufferAllocator> allocator(
+      new MemoryTrackingBufferAllocator(HeapBufferAllocator::Get(), mem_tracker));
+  ThreadSafeMemoryTrackingArena arena(16, 128 * 1024, allocator);
+
+  vector<thread> threads;
+  for (uint8_t i = 0; i < FLAGS_num_threads; i++) {
+    threads.emplace_back(AllocateThread<ThreadSafeMemoryTrackingArena>, &arena, i);
+  }
+  for (thread& thr : threads) {
+    thr.join();
+  }
+
+  // The chunks are carved out of the tracked buffers.
+  ASSERT_EQ(static_cast<int64_t>(arena.memory_footprint()), mem_tracker->consumption());
+  ASSERT_GE(mem_tracker->consumption(),
+            static_cast<int64_t>(FLAGS_num_threads) * FLAGS_allocs_per_thread *
+            FLAGS_alloc_size);
+
+  // The arena can still be reused after a reset.
+  arena.Reset();
+  AllocateThread(&arena, 0);
+}
+
 TEST(TestArena, TestAlignment) {
 
   ThreadSafeArena arena(1024, 1024);
@@ -174,6 +202,37 @@ TEST(TestArena, TestMemoryTrackingEnforced) {
   ASSERT_EQ(256, mem_tracker->consumption());
 }
 
+// Test that large components are taken from huge-page aligned mappings, that
+// small ones still come from the heap, and that memory tracking accounts for
+// the rounded-up component sizes.
+TEST(TestArena, TestHugePageAllocator) {
+  for (HugePageBufferAllocator::Mode mode : { HugePageBufferAllocator::TRANSPARENT,
+                                              HugePageBufferAllocator::EXPLICIT }) {
+    shared_ptr<MemTracker> mem_tracker = MemTracker::CreateTracker(-1, "arena-test-tracker");
+    {
+      shared_ptr<MemoryTrackingBufferAllocator> allocator(
+          new MemoryTrackingBufferAllocator(HugePageBufferAllocator::Get(mode), mem_tracker));
+      MemoryTrackingArena arena(256, 8 * 1024 * 1024, allocator);
+      ASSERT_EQ(256, mem_tracker->consumption());
+
+      // Large enough to need a component of its own.
+      const size_t kLargeSize = 3 * 1024 * 1024;
+      void* allocated = arena.AllocateBytes(kLargeSize);
+      ASSERT_TRUE(allocated);
+      memset(allocated, 0xff, kLargeSize);
+      size_t rounded = HugePageBufferAllocator::RoundUp(kLargeSize);
+      ASSERT_GE(rounded, kLargeSize);
+#if defined(__linux__)
+      ASSERT_EQ(4 * 1024 * 1024, rounded);
+      ASSERT_EQ(0, reinterpret_cast<uintptr_t>(allocated) %
+                HugePageBufferAllocator::kHugePageSize);
+#endif
+      ASSERT_EQ(256 + rounded, mem_tracker->consumption());
+    }
+    ASSERT_EQ(0, mem_tracker->consumption());
+  }
+}
+
 TEST(TestArena, TestSTLAllocator) {
   Arena a(256, 256 * 1024);
   typedef vector<int, ArenaAllocator<int, false> > ArenaVector;
@@ -42,6 +42,12 @@ namespace kudu {
 template <bool THREADSAFE>
 const size_t ArenaBase<THREADSAFE>::kMinimumChunkSize = 16;
 
+template <bool THREADSAFE>
+const size_t ArenaBase<THREADSAFE>::kMinCpuChunkSize = 1024;
+
+template <bool THREADSAFE>
+const size_t ArenaBase<THREADSAFE>::kMaxCpuChunkSize = 16 * 1024;
+
 template <bool THREADSAFE>
 ArenaBase<THREADSAFE>::ArenaBase(
   BufferAllocator* const buffer_allocator,
@@ -50,7 +56,8 @@ ArenaBase<THREADSAFE>::ArenaBase(
     : buffer_allocator_(buffer_allocator),
       max_buffer_size_(max_buffer_size),
       arena_footprint_(0),
-      warned_(false) {
+      warned_(false),
+      num_cpu_chunks_(0) {
   AddComponent(CHECK_NOTNULL(NewComponent(initial_buffer_size, 0)));
 }
 
@@ -59,10 +66,57 @@ ArenaBase<THREADSAFE>::ArenaBase(size_t initial_buffer_size, size_t max_buffer_s
     : buffer_allocator_(HeapBufferAllocator::Get()),
       max_buffer_size_(max_buffer_size),
       arena_footprint_(0),
-      warned_(false) {
+      warned_(false),
+      num_cpu_chunks_(0) {
   AddComponent(CHECK_NOTNULL(NewComponent(initial_buffer_size, 0)));
 }
 
+template <bool THREADSAFE>
+void ArenaBase<THREADSAFE>::EnablePerCpuChunks() {
+  DCHECK(THREADSAFE);
+  DCHECK(!cpu_chunks_);
+#if defined(__APPLE__)
+  num_cpu_chunks_ = 1;
+#else
+  num_cpu_chunks_ = base::MaxCPUIndex() + 1;
+#endif  // defined(__APPLE__)
+  CHECK_GT(num_cpu_chunks_, 0);
+  cpu_chunks_.reset(new PaddedCpuChunk[num_cpu_chunks_]());
+}
+
+template <bool THREADSAFE>
+void* ArenaBase<THREADSAFE>::AllocateBytesFromNewCpuChunk(PaddedCpuChunk* slot,
+                                                          const size_t size,
+                                                          const size_t align) {
+  // Size the chunk relatively to the current component, so that the memory
+  // left unused at the end of the chunks stays small compared to the arena.
+  // The allocations which are large compared to the chunk, and all of them
+  // while the arena is still small, are made from the current component.
+  size_t chunk_size = min(kMaxCpuChunkSize, AcquireLoadCurrent()->size() / 4);
+  chunk_size &= ~static_cast<size_t>(15);
+  if (chunk_size < kMinCpuChunkSize || size > chunk_size / 4) {
+    return AllocateBytesFromCurrent(size, align);
+  }
+
+  uint8_t* data = static_cast<uint8_t*>(AllocateBytesFromCurrent(chunk_size, 16));
+  if (PREDICT_FALSE(data == nullptr)) {
+    // The allocator may still be able to provide the requested size.
+    return AllocateBytesFromCurrent(size, align);
+  }
+  Component* chunk = new Component(data, chunk_size);
+  void* result = chunk->AllocateBytesAligned(size, align);
+  CHECK(result != nullptr);
+  {
+    std::lock_guard<mutex_type> lock(component_lock_);
+    cpu_chunk_components_.emplace_back(chunk);
+  }
+  // If another thread on the same CPU raced with us, the rest of its chunk
+  // is simply left unused.
+  base::subtle::Release_Store(reinterpret_cast<AtomicWord*>(&slot->chunk),
+                              reinterpret_cast<AtomicWord>(chunk));
+  return result;
+}
+
 template <bool THREADSAFE>
 void *ArenaBase<THREADSAFE>::AllocateBytesFallback(const size_t size, const size_t align) {
   std::lock_guard<mutex_type> lock(component_lock_);
@@ -141,6 +195,12 @@ template <bool THREADSAFE>
 void ArenaBase<THREADSAFE>::Reset() {
   std::lock_guard<mutex_type> lock(component_lock_);
 
+  // The chunks point into the components, so drop them first.
+  for (int i = 0; i < num_cpu_chunks_; i++) {
+    cpu_chunks_[i].chunk = nullptr;
+  }
+  cpu_chunk_components_.clear();
+
   if (PREDICT_FALSE(arena_.size() > 1)) {
     unique_ptr<Component> last = std::move(arena_.back());
     arena_.clear();
@@ -159,14 +159,46 @@ class ArenaBase {
   // bytes allocated out of the arena.
   size_t memory_footprint() const;
 
+ protected:
+  // Makes the arena hand out small allocations from per-CPU chunks, which
+  // are carved out of its buffers. The threads allocating from the arena
+  // then contend on its current buffer only when they take a new chunk.
+  // Must be called before the arena is used from several threads.
+  //
+  // The chunks are sized relatively to the arena's current buffer, so an
+  // arena only starts using them once it has grown.
+  void EnablePerCpuChunks();
+
  private:
   typedef typename ArenaTraits<THREADSAFE>::mutex_type mutex_type;
   // Encapsulates a single buffer in the arena.
   class Component;
 
+  // A chunk of a buffer, used for the allocations made on a single CPU.
+  struct PaddedCpuChunk {
+    Component* chunk;
+    char padding[CACHELINE_SIZE - sizeof(Component*)];
+  };
+
+  // The bounds of the size of the per-CPU chunks.
+  static const size_t kMinCpuChunkSize;
+  static const size_t kMaxCpuChunkSize;
+
+  // Allocates from the current component, falling back to adding a new
+  // component if it's full.
+  void* AllocateBytesFromCurrent(const size_t size, const size_t align);
+
   // Fallback for AllocateBytes non-fast-path
   void* AllocateBytesFallback(const size_t size, const size_t align);
 
+  // Allocates from the current CPU's chunk.
+  void* AllocateBytesFromCpuChunk(const size_t size, const size_t align);
+
+  // Fallback for AllocateBytesFromCpuChunk() when the chunk in 'slot' is
+  // missing or full: takes a new chunk for it from the current component.
+  void* AllocateBytesFromNewCpuChunk(PaddedCpuChunk* slot, const size_t size,
+                                     const size_t align);
+
   Component* NewComponent(size_t requested_size, size_t minimum_size);
   void AddComponent(Component *component);
 
@@ -205,6 +237,15 @@ class ArenaBase {
   // the global warning size threshold.
   bool warned_;
 
+  // The chunk of each CPU, or NULL if per-CPU chunks aren't enabled.
+  // The chunks are loaded and stored with Acquire/Release semantics.
+  std::unique_ptr<PaddedCpuChunk[]> cpu_chunks_;
+  int num_cpu_chunks_;
+
+  // All the chunks handed out to the CPUs. Unlike the components in 'arena_',
+  // they don't own their memory. Protected by component_lock_.
+  vector<std::unique_ptr<Component> > cpu_chunk_components_;
+
   // Lock covering 'slow path' allocation, when new components are
   // allocated and added to the arena's list. Also covers any other
   // mutation of the component data structure (eg Reset).
@@ -310,6 +351,9 @@ class MemoryTrackingArena : public ArenaBase<false> {
   std::shared_ptr<MemoryTrackingBufferAllocator> tracking_allocator_;
 };
 
+// Since these arenas back the concurrently-written in-memory stores, they
+// allocate from per-CPU chunks. The chunks are carved out of the tracked
+// buffers, so the memory accounting is unaffected.
 class ThreadSafeMemoryTrackingArena : public ArenaBase<true> {
  public:
 
@@ -318,7 +362,9 @@ class ThreadSafeMemoryTrackingArena : public ArenaBase<true> {
       size_t max_buffer_size,
       const std::shared_ptr<MemoryTrackingBufferAllocator>& tracking_allocator)
       : ArenaBase<true>(tracking_allocator.get(), initial_buffer_size, max_buffer_size),
-        tracking_allocator_(tracking_allocator) {}
+        tracking_allocator_(tracking_allocator) {
+    EnablePerCpuChunks();
+  }
 
   ~ThreadSafeMemoryTrackingArena() {
   }
@@ -340,6 +386,14 @@ class ArenaBase<THREADSAFE>::Component {
         offset_(0),
         size_(buffer->size()) {}
 
+  // A component over memory owned by another component.
+  Component(uint8_t* data, size_t size)
+      : data_(data),
+        offset_(0),
+        size_(size) {
+    ASAN_POISON_MEMORY_REGION(data_, size_);
+  }
+
   // Tries to reserve space in this component. Returns the pointer to the
   // reserved space if successful; NULL on failure (if there's no more room).
   uint8_t* AllocateBytes(const size_t size) {
@@ -437,11 +491,43 @@ inline void ArenaBase<THREADSAFE>::Component::AsanUnpoison(const void* addr, siz
 // to non-inline function call for allocation failure
 template <bool THREADSAFE>
 inline void *ArenaBase<THREADSAFE>::AllocateBytesAligned(const size_t size, const size_t align) {
+  if (cpu_chunks_) {
+    return AllocateBytesFromCpuChunk(size, align);
+  }
+  return AllocateBytesFromCurrent(size, align);
+}
+
+template <bool THREADSAFE>
+inline void *ArenaBase<THREADSAFE>::AllocateBytesFromCurrent(const size_t size,
+                                                             const size_t align) {
   void* result = AcquireLoadCurrent()->AllocateBytesAligned(size, align);
   if (PREDICT_TRUE(result != NULL)) return result;
   return AllocateBytesFallback(size, align);
 }
 
+template <bool THREADSAFE>
+inline void *ArenaBase<THREADSAFE>::AllocateBytesFromCpuChunk(const size_t size,
+                                                              const size_t align) {
+#if defined(__APPLE__)
+  // OSX doesn't have a way to get the CPU, so we'll use a single chunk.
+  int cpu = 0;
+#else
+  int cpu = sched_getcpu();
+  DCHECK_LT(cpu, num_cpu_chunks_);
+#endif  // defined(__APPLE__)
+  PaddedCpuChunk* slot = &cpu_chunks_[cpu];
+  // A thread may be preempted or migrated while it allocates from the chunk,
+  // so the chunk still has to be allocated from atomically. It's rarely
+  // contended though.
+  Component* chunk = reinterpret_cast<Component*>(
+      base::subtle::Acquire_Load(reinterpret_cast<AtomicWord*>(&slot->chunk)));
+  if (PREDICT_TRUE(chunk != NULL)) {
+    void* result = chunk->AllocateBytesAligned(size, align);
+    if (PREDICT_TRUE(result != NULL)) return result;
+  }
+  return AllocateBytesFromNewCpuChunk(slot, size, align);
+}
+
 template <bool THREADSAFE>
 inline uint8_t* ArenaBase<THREADSAFE>::AddSlice(const Slice& value) {
   return reinterpret_cast<uint8_t *>(AddBytes(value.data(), value.size()));
@@ -21,14 +21,18 @@
 #include "kudu/util/memory/memory.h"
 
 #include <string.h>
+#include <sys/mman.h>
 
 #include <algorithm>
 #include <cstdlib>
 
 #include <gflags/gflags.h>
 
+#include "kudu/gutil/basictypes.h"
 #include "kudu/util/alignment.h"
+#include "kudu/util/errno.h"
 #include "kudu/util/flag_tags.h"
+#include "kudu/util/logging.h"
 #include "kudu/util/memory/overwrite.h"
 #include "kudu/util/mem_tracker.h"
 
@@ -280,6 +284,107 @@ void MemoryStatisticsCollectingBufferAllocator::FreeInternal(Buffer* buffer) {
   memory_stats_collector_->FreedMemoryBytes(buffer->size());
 }
 
+#if defined(MAP_HUGETLB) && defined(MADV_HUGEPAGE)
+#define KUDU_HAVE_HUGE_PAGES 1
+#endif
+
+HugePageBufferAllocator* HugePageBufferAllocator::Get(Mode mode) {
+  static HugePageBufferAllocator* transparent = new HugePageBufferAllocator(TRANSPARENT);
+  static HugePageBufferAllocator* explicit_pages = new HugePageBufferAllocator(EXPLICIT);
+  return mode == EXPLICIT ? explicit_pages : transparent;
+}
+
+size_t HugePageBufferAllocator::RoundUp(size_t size) {
+#ifdef KUDU_HAVE_HUGE_PAGES
+  if (size >= kMinHugePageAllocation) {
+    return KUDU_ALIGN_UP(size, kHugePageSize);
+  }
+#endif
+  return size;
+}
+
+void* HugePageBufferAllocator::MapHugePages(size_t size) {
+#ifdef KUDU_HAVE_HUGE_PAGES
+  DCHECK_EQ(0, size % kHugePageSize);
+  if (mode_ == EXPLICIT) {
+    void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      return data;
+    }
+    KLOG_EVERY_N_SECS(WARNING, 60) << "Unable to map " << size << " bytes of "
+                                   << "explicit huge pages, falling back to "
+                                   << "transparent huge pages: " << ErrnoToString(errno);
+  }
+
+  // Over-map by one huge page so that an aligned region can be carved out,
+  // then unmap the unaligned head and tail. The kernel can only back
+  // huge-page aligned ranges with transparent huge pages.
+  size_t mapped_size = size + kHugePageSize;
+  void* mapped = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapped == MAP_FAILED) {
+    return nullptr;
+  }
+  uint8_t* start = reinterpret_cast<uint8_t*>(mapped);
+  uint8_t* aligned = reinterpret_cast<uint8_t*>(
+      KUDU_ALIGN_UP(reinterpret_cast<uintptr_t>(start), kHugePageSize));
+  uint8_t* end = start + mapped_size;
+  if (aligned > start) {
+    PCHECK(munmap(start, aligned - start) == 0);
+  }
+  if (end > aligned + size) {
+    PCHECK(munmap(aligned + size, end - (aligned + size)) == 0);
+  }
+  // Failure here only means the kernel doesn't support (or has disabled)
+  // transparent huge pages; the mapping remains usable with regular pages.
+  ignore_result(madvise(aligned, size, MADV_HUGEPAGE));
+  return aligned;
+#else
+  return nullptr;
+#endif
+}
+
+Buffer* HugePageBufferAllocator::AllocateInternal(size_t requested,
+                                                  size_t minimal,
+                                                  BufferAllocator* originator) {
+  DCHECK_LE(minimal, requested);
+#ifdef KUDU_HAVE_HUGE_PAGES
+  if (requested >= kMinHugePageAllocation) {
+    size_t size = RoundUp(requested);
+    void* data = MapHugePages(size);
+    if (data != nullptr) {
+      return CreateBuffer(data, size, originator);
+    }
+    if (minimal >= kMinHugePageAllocation) {
+      return nullptr;
+    }
+    // Fall back to a heap allocation of at most the largest size which is
+    // still recognizable as a heap buffer on free.
+    requested = min(requested, kMinHugePageAllocation - 1);
+  }
+#endif
+  return DelegateAllocate(HeapBufferAllocator::Get(), requested, minimal, originator);
+}
+
+bool HugePageBufferAllocator::ReallocateInternal(size_t requested,
+                                                 size_t minimal,
+                                                 Buffer* buffer,
+                                                 BufferAllocator* originator) {
+  LOG(FATAL) << "Not implemented";
+  return false;
+}
+
+void HugePageBufferAllocator::FreeInternal(Buffer* buffer) {
+#ifdef KUDU_HAVE_HUGE_PAGES
+  if (buffer->size() >= kMinHugePageAllocation) {
+    PCHECK(munmap(buffer->data(), buffer->size()) == 0);
+    return;
+  }
+#endif
+  DelegateFree(HeapBufferAllocator::Get(), buffer);
+}
+
 size_t MemoryTrackingBufferAllocator::Available() const {
   return enforce_limit_ ? mem_tracker_->SpareCapacity() : std::numeric_limits<int64_t>::max();
 }
@@ -306,6 +411,7 @@ Buffer* MemoryTrackingBufferAllocator::AllocateInternal(size_t requested,
     if (buffer == nullptr) {
       mem_tracker_->Release(requested);
     } else {
+      ConsumeRoundedUp(requested, buffer);
       return buffer;
     }
   }
@@ -314,6 +420,8 @@ Buffer* MemoryTrackingBufferAllocator::AllocateInternal(size_t requested,
     Buffer* buffer = DelegateAllocate(delegate_, minimal, minimal, originator);
     if (buffer == nullptr) {
       mem_tracker_->Release(minimal);
+    } else {
+      ConsumeRoundedUp(minimal, buffer);
     }
     return buffer;
   }
@@ -330,6 +438,15 @@ bool MemoryTrackingBufferAllocator::ReallocateInternal(size_t requested,
   return false;
 }
 
+void MemoryTrackingBufferAllocator::ConsumeRoundedUp(size_t consumed, Buffer* buffer) {
+  // Some delegates (e.g. HugePageBufferAllocator) return buffers larger than
+  // requested. FreeInternal() releases the buffer's full size, so account for
+  // the difference here.
+  if (buffer->size() > consumed) {
+    mem_tracker_->Consume(buffer->size() - consumed);
+  }
+}
+
 void MemoryTrackingBufferAllocator::FreeInternal(Buffer* buffer) {
   DelegateFree(delegate_, buffer);
   mem_tracker_->Release(buffer->size());
@@ -291,6 +291,69 @@ class HeapBufferAllocator : public BufferAllocator {
   DISALLOW_COPY_AND_ASSIGN(HeapBufferAllocator);
 };
 
+// Allocator which backs large buffers with 2MB huge pages, so that arena-heavy
+// structures spanning many megabytes (e.g. MemRowSet and DeltaMemStore
+// arenas) take far fewer TLB misses than with 4KB pages.
+//
+// Requests of at least kMinHugePageAllocation bytes are rounded up to a
+// multiple of kHugePageSize and mapped at a kHugePageSize-aligned address.
+// In TRANSPARENT mode the mapping is advised with MADV_HUGEPAGE so that the
+// kernel's transparent huge page support can back it. In EXPLICIT mode the
+// mapping is first taken from the reserved hugetlbfs pool (MAP_HUGETLB), which
+// falls back to TRANSPARENT mode when the pool is exhausted or not configured.
+// Smaller requests are served by the HeapBufferAllocator.
+//
+// Note that the returned buffers may be larger than requested (see RoundUp());
+// arenas use the whole buffer, so the rounded-up tail is not wasted.
+//
+// On platforms without huge page support, all requests are served by the
+// HeapBufferAllocator.
+class HugePageBufferAllocator : public BufferAllocator {
+ public:
+  enum Mode {
+    TRANSPARENT,
+    EXPLICIT
+  };
+
+  static const size_t kHugePageSize = 2 * 1024 * 1024;
+  static const size_t kMinHugePageAllocation = kHugePageSize / 2;
+
+  virtual ~HugePageBufferAllocator() {}
+
+  // Returns the process-wide instance for the given mode.
+  static HugePageBufferAllocator* Get(Mode mode);
+
+  // Returns the size of the buffer that would be allocated for a request of
+  // 'size' bytes.
+  static size_t RoundUp(size_t size);
+
+  virtual size_t Available() const OVERRIDE {
+    return numeric_limits<size_t>::max();
+  }
+
+ private:
+  explicit HugePageBufferAllocator(Mode mode) : mode_(mode) {}
+
+  virtual Buffer* AllocateInternal(size_t requested,
+                                   size_t minimal,
+                                   BufferAllocator* originator) OVERRIDE;
+
+  virtual bool ReallocateInternal(size_t requested,
+                                  size_t minimal,
+                                  Buffer* buffer,
+                                  BufferAllocator* originator) OVERRIDE;
+
+  virtual void FreeInternal(Buffer* buffer) OVERRIDE;
+
+  // Maps 'size' bytes (a multiple of kHugePageSize) at a kHugePageSize-aligned
+  // address. Returns NULL on failure.
+  void* MapHugePages(size_t size);
+
+  const Mode mode_;
+
+  DISALLOW_COPY_AND_ASSIGN(HugePageBufferAllocator);
+};
+
 // Wrapper around the delegate allocator, that clears all newly allocated
 // (and reallocated) memory.
 class ClearingBufferAllocator : public BufferAllocator {
@@ -693,6 +756,10 @@ class MemoryTrackingBufferAllocator : public BufferAllocator {
   // mem_tracker_->Consume(bytes) and always return true.
   bool TryConsume(int64_t bytes);
 
+  // Consumes the part of 'buffer' which the delegate allocated beyond the
+  // 'consumed' bytes already accounted for.
+  void ConsumeRoundedUp(size_t consumed, Buffer* buffer);
+
   virtual Buffer* AllocateInternal(size_t requested,
                                    size_t minimal,
                                    BufferAllocator* originator) OVERRIDE;
@@ -18,11 +18,14 @@
 #include <gtest/gtest.h>
 #include <rapidjson/document.h>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <vector>
 
 #include "kudu/gutil/bind.h"
 #include "kudu/gutil/map-util.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/util/hdr_histogram.h"
 #include "kudu/util/jsonreader.h"
 #include "kudu/util/jsonwriter.h"
@@ -80,6 +83,32 @@ TEST_F(MetricsTest, SimpleAtomicGaugeTest) {
   ASSERT_EQ(5, mem_usage->value());
 }
 
+METRIC_DEFINE_gauge_int64(test_entity, test_striped_gauge, "Test Striped Gauge",
+                          MetricUnit::kRequests, "Test Striped Gauge");
+
+TEST_F(MetricsTest, StripedGaugeTest) {
+  scoped_refptr<StripedGauge<int64_t>> gauge =
+      METRIC_test_striped_gauge.InstantiateStriped(entity_);
+  ASSERT_EQ(0, gauge->value());
+
+  vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&]() {
+        for (int j = 0; j < 1000; j++) {
+          gauge->Increment();
+          gauge->Decrement();
+          gauge->Increment();
+        }
+      });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  ASSERT_EQ(4000, gauge->value());
+  gauge->DecrementBy(4000);
+  ASSERT_EQ(0, gauge->value());
+}
+
 METRIC_DEFINE_gauge_int64(test_entity, test_func_gauge, "Test Gauge", MetricUnit::kBytes,
                           "Test Gauge 2");
 
@@ -157,14 +186,45 @@ TEST_F(MetricsTest, SimpleHistogramTest) {
   scoped_refptr<Histogram> hist = METRIC_test_hist.Instantiate(entity_);
   hist->Increment(2);
   hist->IncrementBy(4, 1);
-  ASSERT_EQ(2, hist->histogram_->MinValue());
-  ASSERT_EQ(3, hist->histogram_->MeanValue());
-  ASSERT_EQ(4, hist->histogram_->MaxValue());
-  ASSERT_EQ(2, hist->histogram_->TotalCount());
-  ASSERT_EQ(6, hist->histogram_->TotalSum());
+  ASSERT_EQ(2, hist->Snapshot()->MinValue());
+  ASSERT_EQ(3, hist->Snapshot()->MeanValue());
+  ASSERT_EQ(4, hist->Snapshot()->MaxValue());
+  ASSERT_EQ(2, hist->Snapshot()->TotalCount());
+  ASSERT_EQ(6, hist->Snapshot()->TotalSum());
   // TODO: Test coverage needs to be improved a lot.
 }
 
+METRIC_DEFINE_histogram(test_entity, test_striped_hist, "Test Striped Histogram",
+                        MetricUnit::kMilliseconds, "foo", 1000000, 3, STRIPED_HISTOGRAM);
+
+TEST_F(MetricsTest, StripedHistogramTest) {
+  scoped_refptr<Histogram> hist = METRIC_test_striped_hist.Instantiate(entity_);
+  ASSERT_EQ(base::MaxCPUIndex() + 1, static_cast<int>(hist->histograms_.size()));
+
+  // Record from several threads, so that the values likely land in the
+  // histograms of different CPUs.
+  const int kNumThreads = 4;
+  const int kNumValuesPerThread = 1000;
+  vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&hist, i]() {
+      for (int j = 1; j <= kNumValuesPerThread; j++) {
+        hist->Increment(i * kNumValuesPerThread + j);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  const int kNumValues = kNumThreads * kNumValuesPerThread;
+  ASSERT_EQ(kNumValues, hist->TotalCount());
+  ASSERT_EQ(1, hist->MinValueForTests());
+  ASSERT_EQ(kNumValues, hist->MaxValueForTests());
+  ASSERT_EQ(static_cast<uint64_t>(kNumValues) * (kNumValues + 1) / 2,
+            hist->Snapshot()->TotalSum());
+}
+
 TEST_F(MetricsTest, JsonPrintTest) {
   scoped_refptr<Counter> bytes_seen = METRIC_reqs_pending.Instantiate(entity_);
   bytes_seen->Increment();
@@ -201,6 +261,67 @@ TEST_F(MetricsTest, JsonPrintTest) {
   ASSERT_EQ("", out.str());
 }
 
+// Test filtering the JSON dump by entity type and by modification epoch.
+TEST_F(MetricsTest, JsonFilterTest) {
+  scoped_refptr<Counter> reqs = METRIC_reqs_pending.Instantiate(entity_);
+  scoped_refptr<AtomicGauge<uint64_t>> gauge = METRIC_fake_memory_usage.Instantiate(entity_, 0);
+
+  std::ostringstream out;
+  JsonWriter writer(&out, JsonWriter::COMPACT);
+  MetricJsonOptions opts;
+  opts.entity_types = { "not_a_matching_type" };
+  ASSERT_OK(entity_->WriteAsJson(&writer, { "*" }, opts));
+  ASSERT_EQ("", out.str());
+  opts.entity_types = { "test_entity" };
+  ASSERT_OK(entity_->WriteAsJson(&writer, { "*" }, opts));
+  ASSERT_STR_CONTAINS(out.str(), "reqs_pending");
+
+  // Once the epoch has advanced, only the metrics modified since are dumped,
+  // and an entity without any is left out.
+  int64_t epoch = Metric::IncrementEpoch();
+  opts.only_modified_in_or_after_epoch = epoch;
+  out.str("");
+  ASSERT_OK(entity_->WriteAsJson(&writer, { "*" }, opts));
+  ASSERT_EQ("", out.str());
+
+  reqs->Increment();
+  ASSERT_OK(entity_->WriteAsJson(&writer, { "*" }, opts));
+  ASSERT_STR_CONTAINS(out.str(), "reqs_pending");
+  ASSERT_STR_NOT_CONTAINS(out.str(), "fake_memory_usage");
+
+  gauge->set_value(1);
+  out.str("");
+  ASSERT_OK(entity_->WriteAsJson(&writer, { "*" }, opts));
+  ASSERT_STR_CONTAINS(out.str(), "reqs_pending");
+  ASSERT_STR_CONTAINS(out.str(), "fake_memory_usage");
+}
+
+// Test rolling up the metrics of several entities into a merged entity.
+TEST_F(MetricsTest, MergedEntitiesTest) {
+  vector<scoped_refptr<MetricEntity>> entities;
+  for (int i = 1; i <= 2; i++) {
+    scoped_refptr<MetricEntity> entity = METRIC_ENTITY_test_entity.Instantiate(
+        &registry_, strings::Substitute("entity-$0", i));
+    METRIC_reqs_pending.Instantiate(entity)->IncrementBy(i);
+    METRIC_fake_memory_usage.Instantiate(entity, 0)->set_value(10 * i);
+    METRIC_test_hist.Instantiate(entity)->Increment(i);
+    entities.push_back(entity);
+  }
+
+  std::ostringstream out;
+  JsonWriter writer(&out, JsonWriter::COMPACT);
+  MetricJsonOptions opts;
+  opts.merged_entity_types = { "test_entity" };
+  ASSERT_OK(registry_.WriteAsJson(&writer, { "*" }, opts));
+  string json = out.str();
+  ASSERT_STR_CONTAINS(json, R"("id":"merged")");
+  ASSERT_STR_NOT_CONTAINS(json, "entity-1");
+  ASSERT_STR_CONTAINS(json, R"({"name":"reqs_pending","value":3})");
+  ASSERT_STR_CONTAINS(json, R"({"name":"fake_memory_usage","value":30})");
+  ASSERT_STR_CONTAINS(json, R"("name":"test_hist")");
+  ASSERT_STR_CONTAINS(json, R"("total_count":2)");
+}
+
 // Test that metrics are retired when they are no longer referenced.
 TEST_F(MetricsTest, RetirementTest) {
   FLAGS_metrics_retirement_age_ms = 100;
@@ -29,12 +29,14 @@
 #include "kudu/gutil/singleton.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
+#include "kudu/gutil/sysinfo.h"
 #include "kudu/util/flag_tags.h"
 #include "kudu/util/hdr_histogram.h"
 #include "kudu/util/histogram.pb.h"
 #include "kudu/util/jsonwriter.h"
 #include "kudu/util/locks.h"
 #include "kudu/util/status.h"
+#include "kudu/util/thread.h"
 
 DEFINE_int32(metrics_retirement_age_ms, 120 * 1000,
              "The minimum number of milliseconds a metric will be kept for after it is "
@@ -108,6 +110,8 @@ const char* MetricUnit::Name(Type unit) {
       return "context switches";
     case kDataDirectories:
       return "data directories";
+    case kTablets:
+      return "tablets";
     default:
       DCHECK(false) << "Unknown unit with type = " << unit;
       return "UNKNOWN UNIT";
@@ -196,32 +200,48 @@ bool MatchMetricInList(const string& metric_name,
 } // anonymous namespace
 
 
-Status MetricEntity::WriteAsJson(JsonWriter* writer,
-                                 const vector<string>& requested_metrics,
-                                 const MetricJsonOptions& opts) const {
+bool MetricEntity::SelectMetrics(const vector<string>& requested_metrics,
+                                 const MetricJsonOptions& opts,
+                                 OrderedMetricMap* metrics,
+                                 AttributeMap* attrs) const {
+  if (!opts.entity_types.empty() &&
+      std::find(opts.entity_types.begin(), opts.entity_types.end(),
+                prototype_->name()) == opts.entity_types.end()) {
+    return false;
+  }
   bool select_all = MatchMetricInList(id(), requested_metrics);
 
-  // We want the keys to be in alphabetical order when printing, so we use an ordered map here.
-  typedef std::map<const char*, scoped_refptr<Metric> > OrderedMetricMap;
-  OrderedMetricMap metrics;
-  AttributeMap attrs;
   {
     // Snapshot the metrics in this registry (not guaranteed to be a consistent snapshot)
     std::lock_guard<simple_spinlock> l(lock_);
-    attrs = attributes_;
+    *attrs = attributes_;
     for (const MetricMap::value_type& val : metric_map_) {
       const MetricPrototype* prototype = val.first;
       const scoped_refptr<Metric>& metric = val.second;
 
-      if (select_all || MatchMetricInList(prototype->name(), requested_metrics)) {
-        InsertOrDie(&metrics, prototype->name(), metric);
+      if ((select_all || MatchMetricInList(prototype->name(), requested_metrics)) &&
+          metric->ModifiedInOrAfterEpoch(opts.only_modified_in_or_after_epoch)) {
+        InsertOrDie(metrics, prototype->name(), metric);
       }
     }
   }
 
   // If we had a filter, and we didn't either match this entity or any metrics inside
-  // it, don't print the entity at all.
-  if (!requested_metrics.empty() && !select_all && metrics.empty()) {
+  // it, don't print the entity at all. Likewise if none of its metrics was modified
+  // since the requested epoch.
+  if ((!requested_metrics.empty() && !select_all && metrics->empty()) ||
+      (opts.only_modified_in_or_after_epoch > 0 && metrics->empty())) {
+    return false;
+  }
+  return true;
+}
+
+Status MetricEntity::WriteAsJson(JsonWriter* writer,
+                                 const vector<string>& requested_metrics,
+                                 const MetricJsonOptions& opts) const {
+  OrderedMetricMap metrics;
+  AttributeMap attrs;
+  if (!SelectMetrics(requested_metrics, opts, &metrics, &attrs)) {
     return Status::OK();
   }
 
@@ -325,6 +345,25 @@ MetricRegistry::MetricRegistry() {
 MetricRegistry::~MetricRegistry() {
 }
 
+namespace {
+
+// The merged value of the metrics of the same prototype across entities.
+struct MergedMetric {
+  const MetricPrototype* prototype = nullptr;
+  int64_t sum = 0;
+  std::unique_ptr<HdrHistogram> histogram;
+};
+
+// Merged metrics of each entity type, by metric name.
+typedef std::map<string, std::map<string, MergedMetric>> MergedEntityMap;
+
+Status HdrHistogramToPB(const MetricPrototype* prototype,
+                        const HdrHistogram& snapshot,
+                        const MetricJsonOptions& opts,
+                        HistogramSnapshotPB* snapshot_pb);
+
+} // anonymous namespace
+
 Status MetricRegistry::WriteAsJson(JsonWriter* writer,
                                    const vector<string>& requested_metrics,
                                    const MetricJsonOptions& opts) const {
@@ -334,10 +373,72 @@ Status MetricRegistry::WriteAsJson(JsonWriter* writer,
     entities = entities_;
   }
 
+  MergedEntityMap merged_entities;
   writer->StartArray();
   for (const EntityMap::value_type e : entities) {
-    WARN_NOT_OK(e.second->WriteAsJson(writer, requested_metrics, opts),
-                Substitute("Failed to write entity $0 as JSON", e.second->id()));
+    const char* type = e.second->prototype_->name();
+    if (std::find(opts.merged_entity_types.begin(), opts.merged_entity_types.end(), type) ==
+        opts.merged_entity_types.end()) {
+      WARN_NOT_OK(e.second->WriteAsJson(writer, requested_metrics, opts),
+                  Substitute("Failed to write entity $0 as JSON", e.second->id()));
+      continue;
+    }
+
+    MetricEntity::OrderedMetricMap metrics;
+    MetricEntity::AttributeMap attrs;
+    if (!e.second->SelectMetrics(requested_metrics, opts, &metrics, &attrs)) {
+      continue;
+    }
+    auto& merged_metrics = merged_entities[type];
+    for (const auto& m : metrics) {
+      const Metric* metric = m.second.get();
+      MergedMetric& merged = merged_metrics[m.first];
+      merged.prototype = metric->prototype();
+      if (metric->prototype()->type() == MetricType::kHistogram) {
+        std::unique_ptr<HdrHistogram> snapshot =
+            down_cast<const Histogram*>(metric)->Snapshot();
+        if (merged.histogram) {
+          merged.histogram->MergeFrom(*snapshot);
+        } else {
+          merged.histogram = std::move(snapshot);
+        }
+      } else if (!metric->AddToSum(&merged.sum)) {
+        merged_metrics.erase(m.first);
+      }
+    }
+  }
+
+  for (const auto& e : merged_entities) {
+    writer->StartObject();
+    writer->String("type");
+    writer->String(e.first);
+    writer->String("id");
+    writer->String("merged");
+    writer->String("attributes");
+    writer->StartObject();
+    writer->EndObject();
+    writer->String("metrics");
+    writer->StartArray();
+    for (const auto& m : e.second) {
+      const MergedMetric& merged = m.second;
+      if (merged.histogram) {
+        HistogramSnapshotPB snapshot_pb;
+        Status s = HdrHistogramToPB(merged.prototype, *merged.histogram, opts, &snapshot_pb);
+        if (!s.ok()) {
+          WARN_NOT_OK(s, Substitute("Failed to write merged $0 as JSON", m.first));
+          continue;
+        }
+        writer->Protobuf(snapshot_pb);
+      } else {
+        writer->StartObject();
+        merged.prototype->WriteFields(writer, opts);
+        writer->String("value");
+        writer->Int64(merged.sum);
+        writer->EndObject();
+      }
+    }
+    writer->EndArray();
+    writer->EndObject();
   }
   writer->EndArray();
 
@@ -483,8 +584,11 @@ scoped_refptr<MetricEntity> MetricRegistry::FindOrCreateEntity(
 //
 // Metric
 //
+AtomicInt<int64_t> Metric::current_epoch_(1);
+
 Metric::Metric(const MetricPrototype* prototype)
-  : prototype_(prototype) {
+  : prototype_(prototype),
+    m_epoch_(current_epoch_.Load()) {
 }
 
 Metric::~Metric() {
@@ -521,8 +625,11 @@ std::string StringGauge::value() const {
 }
 
 void StringGauge::set_value(const std::string& value) {
-  std::lock_guard<simple_spinlock> l(lock_);
-  value_ = value;
+  {
+    std::lock_guard<simple_spinlock> l(lock_);
+    value_ = value;
+  }
+  UpdateModificationEpoch();
 }
 
 void StringGauge::WriteValue(JsonWriter* writer) const {
@@ -551,6 +658,12 @@ void Counter::Increment() {
 
 void Counter::IncrementBy(int64_t amount) {
   value_.IncrementBy(amount);
+  UpdateModificationEpoch();
+}
+
+bool Counter::AddToSum(int64_t* sum) const {
+  *sum += value();
+  return true;
 }
 
 Status Counter::WriteAsJson(JsonWriter* writer,
@@ -593,17 +706,61 @@ scoped_refptr<Histogram> HistogramPrototype::Instantiate(
 // Histogram
 /////////////////////////////////////////////////
 
+// Pads a histogram so that the hot fields of the histograms of different
+// CPUs don't share a cache line.
+struct Histogram::PaddedHistogram {
+  PaddedHistogram(uint64_t highest_trackable_value, int num_significant_digits)
+      : histogram(highest_trackable_value, num_significant_digits) {
+  }
+
+  HdrHistogram histogram;
+  char padding[CACHELINE_SIZE];
+};
+
 Histogram::Histogram(const HistogramPrototype* proto)
-  : Metric(proto),
-    histogram_(new HdrHistogram(proto->max_trackable_value(), proto->num_sig_digits())) {
+  : Metric(proto) {
+  int num_histograms = proto->striped() ? base::MaxCPUIndex() + 1 : 1;
+  CHECK_GT(num_histograms, 0);
+  histograms_.reserve(num_histograms);
+  for (int i = 0; i < num_histograms; i++) {
+    histograms_.emplace_back(new PaddedHistogram(proto->max_trackable_value(),
+                                                 proto->num_sig_digits()));
+  }
+}
+
+Histogram::~Histogram() {
+}
+
+HdrHistogram* Histogram::RecordingHistogram() {
+  if (histograms_.size() == 1) {
+    return &histograms_[0]->histogram;
+  }
+#if defined(__APPLE__)
+  // OSX doesn't have a way to get the CPU, so we'll pick one by thread.
+  int cpu = Thread::UniqueThreadId() % histograms_.size();
+#else
+  int cpu = sched_getcpu();
+  DCHECK_LT(cpu, static_cast<int>(histograms_.size()));
+#endif  // defined(__APPLE__)
+  return &histograms_[cpu]->histogram;
+}
+
+std::unique_ptr<HdrHistogram> Histogram::Snapshot() const {
+  std::unique_ptr<HdrHistogram> snapshot(new HdrHistogram(histograms_[0]->histogram));
+  for (size_t i = 1; i < histograms_.size(); i++) {
+    snapshot->MergeFrom(histograms_[i]->histogram);
+  }
+  return snapshot;
 }
 
 void Histogram::Increment(int64_t value) {
-  histogram_->Increment(value);
+  RecordingHistogram()->Increment(value);
+  UpdateModificationEpoch();
 }
 
 void Histogram::IncrementBy(int64_t value, int64_t amount) {
-  histogram_->IncrementBy(value, amount);
+  RecordingHistogram()->IncrementBy(value, amount);
+  UpdateModificationEpoch();
 }
 
 Status Histogram::WriteAsJson(JsonWriter* writer,
@@ -615,15 +772,18 @@ Status Histogram::WriteAsJson(JsonWriter* writer,
   return Status::OK();
 }
 
-Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
-                                         const MetricJsonOptions& opts) const {
-  HdrHistogram snapshot(*histogram_);
-  snapshot_pb->set_name(prototype_->name());
+namespace {
+
+Status HdrHistogramToPB(const MetricPrototype* prototype,
+                        const HdrHistogram& snapshot,
+                        const MetricJsonOptions& opts,
+                        HistogramSnapshotPB* snapshot_pb) {
+  snapshot_pb->set_name(prototype->name());
   if (opts.include_schema_info) {
-    snapshot_pb->set_type(MetricType::Name(prototype_->type()));
-    snapshot_pb->set_label(prototype_->label());
-    snapshot_pb->set_unit(MetricUnit::Name(prototype_->unit()));
-    snapshot_pb->set_description(prototype_->description());
+    snapshot_pb->set_type(MetricType::Name(prototype->type()));
+    snapshot_pb->set_label(prototype->label());
+    snapshot_pb->set_unit(MetricUnit::Name(prototype->unit()));
+    snapshot_pb->set_description(prototype->description());
     snapshot_pb->set_max_trackable_value(snapshot.highest_trackable_value());
     snapshot_pb->set_num_significant_digits(snapshot.num_significant_digits());
   }
@@ -650,23 +810,34 @@ Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
   return Status::OK();
 }
 
+} // anonymous namespace
+
+Status Histogram::GetHistogramSnapshotPB(HistogramSnapshotPB* snapshot_pb,
+                                         const MetricJsonOptions& opts) const {
+  return HdrHistogramToPB(prototype_, *Snapshot(), opts, snapshot_pb);
+}
+
 uint64_t Histogram::CountInBucketForValueForTests(uint64_t value) const {
-  return histogram_->CountInBucketForValue(value);
+  return Snapshot()->CountInBucketForValue(value);
 }
 
 uint64_t Histogram::TotalCount() const {
-  return histogram_->TotalCount();
+  uint64_t total_count = 0;
+  for (const auto& h : histograms_) {
+    total_count += h->histogram.TotalCount();
+  }
+  return total_count;
 }
 
 uint64_t Histogram::MinValueForTests() const {
-  return histogram_->MinValue();
+  return Snapshot()->MinValue();
 }
 
 uint64_t Histogram::MaxValueForTests() const {
-  return histogram_->MaxValue();
+  return Snapshot()->MaxValue();
 }
 double Histogram::MeanValueForTests() const {
-  return histogram_->MeanValue();
+  return Snapshot()->MeanValue();
 }
 
 ScopedLatencyMetric::ScopedLatencyMetric(Histogram* latency_hist)
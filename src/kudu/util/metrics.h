@@ -224,8 +224,11 @@
 /////////////////////////////////////////////////////
 
 #include <algorithm>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <type_traits>
 #include <unordered_map>
 #include <vector>
 
@@ -279,9 +282,9 @@
   ::kudu::GaugePrototype<double> METRIC_##name(                      \
       ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc, ## __VA_ARGS__))
 
-#define METRIC_DEFINE_histogram(entity, name, label, unit, desc, max_val, num_sig_digits) \
+#define METRIC_DEFINE_histogram(entity, name, label, unit, desc, max_val, num_sig_digits, ...) \
   ::kudu::HistogramPrototype METRIC_##name(                                       \
-      ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc), \
+      ::kudu::MetricPrototype::CtorArgs(#entity, #name, label, unit, desc, ## __VA_ARGS__), \
     max_val, num_sig_digits)
 
 // The following macros act as forward declarations for entity types and metric prototypes.
@@ -329,6 +332,8 @@ class FunctionGauge;
 class Gauge;
 template<typename T>
 class GaugePrototype;
+template<typename T>
+class StripedGauge;
 
 class Metric;
 class MetricEntityPrototype;
@@ -380,6 +385,7 @@ struct MetricUnit {
     kMessages,
     kContextSwitches,
     kDataDirectories,
+    kTablets,
   };
   static const char* Name(Type unit);
 };
@@ -397,7 +403,8 @@ class MetricType {
 struct MetricJsonOptions {
   MetricJsonOptions() :
     include_raw_histograms(false),
-    include_schema_info(false) {
+    include_schema_info(false),
+    only_modified_in_or_after_epoch(0) {
   }
 
   // Include the raw histogram values and counts in the JSON output.
@@ -410,6 +417,26 @@ struct MetricJsonOptions {
   // unit, etc).
   // Default: false
   bool include_schema_info;
+
+  // Only include the entities whose type is in this list. Filtering on the
+  // type skips the other entities without locking them or their metrics.
+  // Default: empty, which includes entities of all types.
+  std::vector<std::string> entity_types;
+
+  // Only include the metrics which were modified in or after this epoch.
+  // See Metric::IncrementEpoch().
+  // Default: 0, which includes all metrics.
+  int64_t only_modified_in_or_after_epoch;
+
+  // Merge the entities of these types into a single entity per type, whose
+  // ID is "merged". Counters and integer gauges are summed, and histograms
+  // are merged; the other metrics are left out. This rolls up e.g. the
+  // metrics of all the tablets of a server without dumping each of them.
+  //
+  // NOTE: the merged values only cover the entities which still exist, so
+  // a merged counter may decrease when an entity is removed.
+  // Default: empty.
+  std::vector<std::string> merged_entity_types;
 };
 
 class MetricEntityPrototype {
@@ -455,6 +482,9 @@ class MetricEntity : public RefCountedThreadSafe<MetricEntity> {
   scoped_refptr<FunctionGauge<T> > FindOrCreateFunctionGauge(const GaugePrototype<T>* proto,
                                                              const Callback<T()>& function);
 
+  template<typename T>
+  scoped_refptr<StripedGauge<T> > FindOrCreateStripedGauge(const GaugePrototype<T>* proto);
+
   // Return the metric instantiated from the given prototype, or NULL if none has been
   // instantiated. Primarily used by tests trying to read metric values.
   scoped_refptr<Metric> FindOrNull(const MetricPrototype& prototype) const;
@@ -496,10 +526,22 @@ class MetricEntity : public RefCountedThreadSafe<MetricEntity> {
   friend class MetricRegistry;
   friend class RefCountedThreadSafe<MetricEntity>;
 
+  // We want the keys to be in alphabetical order when printing, so we use an ordered map here.
+  typedef std::map<const char*, scoped_refptr<Metric> > OrderedMetricMap;
+
   MetricEntity(const MetricEntityPrototype* prototype, std::string id,
                AttributeMap attributes);
   ~MetricEntity();
 
+  // Snapshot the metrics of this entity which match 'requested_metrics' and
+  // 'opts' (not guaranteed to be a consistent snapshot) into 'metrics', and
+  // its attributes into 'attrs'. Returns false if this entity shouldn't be
+  // printed at all.
+  bool SelectMetrics(const std::vector<std::string>& requested_metrics,
+                     const MetricJsonOptions& opts,
+                     OrderedMetricMap* metrics,
+                     AttributeMap* attrs) const;
+
   // Ensure that the given metric prototype is allowed to be instantiated
   // within this entity. This entity's type must match the expected entity
   // type defined within the metric prototype.
@@ -530,10 +572,46 @@ class Metric : public RefCountedThreadSafe<Metric> {
 
   const MetricPrototype* prototype() const { return prototype_; }
 
+  // Return true if this metric was modified in or after the given epoch.
+  virtual bool ModifiedInOrAfterEpoch(int64_t epoch) const {
+    return m_epoch_.Load() >= epoch;
+  }
+
+  // If the values of this metric can be summed across entities, add its
+  // value to 'sum' and return true. See
+  // MetricJsonOptions::merged_entity_types.
+  virtual bool AddToSum(int64_t* sum) const {
+    return false;
+  }
+
+  // Advance the current epoch, and return the new one.
+  //
+  // Metrics remember the epoch in which they were last modified, so that a
+  // consumer which dumps the metrics periodically can advance the epoch before
+  // each dump, and only dump the metrics modified in or after the epoch which
+  // the previous dump started (see
+  // MetricJsonOptions::only_modified_in_or_after_epoch).
+  static int64_t IncrementEpoch() {
+    return current_epoch_.Increment();
+  }
+
+  // Return the current epoch.
+  static int64_t current_epoch() {
+    return current_epoch_.Load();
+  }
+
  protected:
   explicit Metric(const MetricPrototype* prototype);
   virtual ~Metric();
 
+  // Record that this metric was modified in the current epoch. This is
+  // called after every update, so it only writes when the epoch has advanced.
+  void UpdateModificationEpoch() {
+    if (PREDICT_FALSE(m_epoch_.Load() < current_epoch_.Load())) {
+      m_epoch_.StoreMax(current_epoch_.Load());
+    }
+  }
+
   const MetricPrototype* const prototype_;
 
  private:
@@ -545,6 +623,12 @@ class Metric : public RefCountedThreadSafe<Metric> {
   // uninitialized.
   MonoTime retire_time_;
 
+  // The epoch in which this metric was last modified.
+  AtomicInt<int64_t> m_epoch_;
+
+  // The current epoch.
+  static AtomicInt<int64_t> current_epoch_;
+
   DISALLOW_COPY_AND_ASSIGN(Metric);
 };
 
@@ -638,7 +722,13 @@ class MetricPrototypeRegistry {
 enum PrototypeFlags {
   // Flag which causes a Gauge prototype to expose itself as if it
   // were a counter.
-  EXPOSE_AS_COUNTER = 1 << 0
+  EXPOSE_AS_COUNTER = 1 << 0,
+
+  // Flag which causes a Histogram to record into one sub-histogram per CPU,
+  // which are merged when the histogram is read. This avoids contention
+  // between the threads recording into a hot histogram, at the cost of a
+  // copy of its buckets per CPU and of slower reads.
+  STRIPED_HISTOGRAM = 1 << 1
 };
 
 class MetricPrototype {
@@ -712,6 +802,13 @@ class GaugePrototype : public MetricPrototype {
     return entity->FindOrCreateFunctionGauge(this, function);
   }
 
+  // Instantiate a gauge which is striped like a Counter, for gauges which
+  // are incremented and decremented concurrently by many threads.
+  scoped_refptr<StripedGauge<T> > InstantiateStriped(
+      const scoped_refptr<MetricEntity>& entity) const {
+    return entity->FindOrCreateStripedGauge(this);
+  }
+
   virtual MetricType::Type type() const OVERRIDE {
     if (args_.flags_ & EXPOSE_AS_COUNTER) {
       return MetricType::kCounter;
@@ -767,12 +864,15 @@ class AtomicGauge : public Gauge {
   }
   virtual void set_value(const T& value) {
     value_.Store(static_cast<int64_t>(value), kMemOrderNoBarrier);
+    UpdateModificationEpoch();
   }
   void Increment() {
     value_.IncrementBy(1, kMemOrderNoBarrier);
+    UpdateModificationEpoch();
   }
   virtual void IncrementBy(int64_t amount) {
     value_.IncrementBy(amount, kMemOrderNoBarrier);
+    UpdateModificationEpoch();
   }
   void Decrement() {
     IncrementBy(-1);
@@ -781,6 +881,14 @@ class AtomicGauge : public Gauge {
     IncrementBy(-amount);
   }
 
+  virtual bool AddToSum(int64_t* sum) const OVERRIDE {
+    if (!std::is_integral<T>::value || std::is_same<T, bool>::value) {
+      return false;
+    }
+    *sum += value_.Load(kMemOrderNoBarrier);
+    return true;
+  }
+
  protected:
   virtual void WriteValue(JsonWriter* writer) const OVERRIDE {
     writer->Value(value());
@@ -790,6 +898,52 @@ class AtomicGauge : public Gauge {
   DISALLOW_COPY_AND_ASSIGN(AtomicGauge);
 };
 
+// Gauge implementation for integer gauges which are incremented and
+// decremented concurrently by many threads. The value is striped like a
+// Counter's (see LongAdder), so the updates don't contend, at the expense of
+// more memory and of more expensive reads. The value can't be set directly.
+template <typename T>
+class StripedGauge : public Gauge {
+ public:
+  T value() const {
+    return static_cast<T>(value_.Value());
+  }
+  void Increment() {
+    IncrementBy(1);
+  }
+  void IncrementBy(int64_t amount) {
+    value_.IncrementBy(amount);
+    UpdateModificationEpoch();
+  }
+  void Decrement() {
+    IncrementBy(-1);
+  }
+  void DecrementBy(int64_t amount) {
+    IncrementBy(-amount);
+  }
+
+  virtual bool AddToSum(int64_t* sum) const OVERRIDE {
+    *sum += value_.Value();
+    return true;
+  }
+
+ protected:
+  virtual void WriteValue(JsonWriter* writer) const OVERRIDE {
+    writer->Value(value());
+  }
+
+ private:
+  friend class MetricEntity;
+  static_assert(std::is_integral<T>::value, "StripedGauge requires an integer type");
+
+  explicit StripedGauge(const GaugePrototype<T>* proto)
+    : Gauge(proto) {
+  }
+
+  LongAdder value_;
+  DISALLOW_COPY_AND_ASSIGN(StripedGauge);
+};
+
 // Utility class to automatically detach FunctionGauges when a class destructs.
 //
 // Because FunctionGauges typically access class instance state, it's important to ensure
@@ -860,6 +1014,19 @@ class FunctionGauge : public Gauge {
     writer->Value(value());
   }
 
+  // The value is computed on demand, so it may have changed at any time.
+  virtual bool ModifiedInOrAfterEpoch(int64_t epoch) const OVERRIDE {
+    return true;
+  }
+
+  virtual bool AddToSum(int64_t* sum) const OVERRIDE {
+    if (!std::is_integral<T>::value || std::is_same<T, bool>::value) {
+      return false;
+    }
+    *sum += static_cast<int64_t>(value());
+    return true;
+  }
+
   // Reset this FunctionGauge to return a specific value.
   // This should be used during destruction. If you want a settable
   // Gauge, use a normal Gauge instead of a FunctionGauge.
@@ -938,6 +1105,7 @@ class Counter : public Metric {
   void IncrementBy(int64_t amount);
   virtual Status WriteAsJson(JsonWriter* w,
                              const MetricJsonOptions& opts) const OVERRIDE;
+  virtual bool AddToSum(int64_t* sum) const OVERRIDE;
 
  private:
   FRIEND_TEST(MetricsTest, SimpleCounterTest);
@@ -958,6 +1126,7 @@ class HistogramPrototype : public MetricPrototype {
 
   uint64_t max_trackable_value() const { return max_trackable_value_; }
   int num_sig_digits() const { return num_sig_digits_; }
+  bool striped() const { return args_.flags_ & STRIPED_HISTOGRAM; }
   virtual MetricType::Type type() const OVERRIDE { return MetricType::kHistogram; }
 
  private:
@@ -994,10 +1163,23 @@ class Histogram : public Metric {
 
  private:
   FRIEND_TEST(MetricsTest, SimpleHistogramTest);
+  FRIEND_TEST(MetricsTest, StripedHistogramTest);
   friend class MetricEntity;
+  friend class MetricRegistry;
   explicit Histogram(const HistogramPrototype* proto);
+  virtual ~Histogram();
+
+  struct PaddedHistogram;
+
+  // Returns the histogram to record into.
+  HdrHistogram* RecordingHistogram();
 
-  const gscoped_ptr<HdrHistogram> histogram_;
+  // Returns a snapshot of the values recorded into all the histograms.
+  std::unique_ptr<HdrHistogram> Snapshot() const;
+
+  // The histograms the values are recorded into: a single one, or one per CPU
+  // for striped histograms.
+  std::vector<std::unique_ptr<PaddedHistogram>> histograms_;
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
 
@@ -1076,6 +1258,20 @@ inline scoped_refptr<FunctionGauge<T> > MetricEntity::FindOrCreateFunctionGauge(
   return m;
 }
 
+template<typename T>
+inline scoped_refptr<StripedGauge<T> > MetricEntity::FindOrCreateStripedGauge(
+    const GaugePrototype<T>* proto) {
+  CheckInstantiation(proto);
+  std::lock_guard<simple_spinlock> l(lock_);
+  scoped_refptr<StripedGauge<T> > m = down_cast<StripedGauge<T>*>(
+      FindPtrOrNull(metric_map_, proto).get());
+  if (!m) {
+    m = new StripedGauge<T>(proto);
+    InsertOrDie(&metric_map_, proto, m);
+  }
+  return m;
+}
+
 } // namespace kudu
 
 #endif // KUDU_UTIL_METRICS_H
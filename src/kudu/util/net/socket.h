@@ -83,6 +83,11 @@ class Socket {
   // Sets SO_REUSEADDR to 'flag'. Should be used prior to Bind().
   Status SetReuseAddr(bool flag);
 
+  // Sets SO_REUSEPORT to 'flag', allowing several sockets to be bound to the
+  // same address. Should be used prior to Bind(). Returns NotSupported on
+  // platforms without SO_REUSEPORT.
+  Status SetReusePort(bool flag);
+
   // Convenience method to invoke the common sequence:
   // 1) SetReuseAddr(true)
   // 2) Bind()
@@ -584,6 +584,34 @@ TEST_F(TestPBUtil, TestOverwriteExistingPB) {
   ASSERT_OK(CreateKnownGoodContainerFile(OVERWRITE));
 }
 
+TEST_F(TestPBUtil, TestWriteMultipleContainers) {
+  ProtoContainerTestPB pb_a;
+  pb_a.set_name("a");
+  pb_a.set_value(1);
+  ProtoContainerTestPB pb_b;
+  pb_b.set_name("b");
+  pb_b.set_value(2);
+  const string path_b = GetTestPath("b");
+  const string bad_path = GetTestPath("missing-dir/c");
+  ASSERT_OK(CreateKnownGoodContainerFile(NO_OVERWRITE));
+
+  // Existing files are overwritten, and a failed write doesn't fail the others.
+  vector<Status> statuses;
+  WritePBContainersToPaths(env_, { { path_, &pb_a }, { bad_path, &pb_b }, { path_b, &pb_b } },
+                           SYNC, &statuses);
+  ASSERT_EQ(3, statuses.size());
+  ASSERT_OK(statuses[0]);
+  ASSERT_FALSE(statuses[1].ok());
+  ASSERT_OK(statuses[2]);
+
+  ProtoContainerTestPB read_pb;
+  ASSERT_OK(ReadPBContainerFromPath(env_, path_, &read_pb));
+  ASSERT_EQ("a", read_pb.name());
+  ASSERT_OK(ReadPBContainerFromPath(env_, path_b, &read_pb));
+  ASSERT_EQ("b", read_pb.name());
+  ASSERT_EQ(2, read_pb.value());
+}
+
 TEST_F(TestPBUtil, TestRedaction) {
   FLAGS_log_redact_user_data = true;
   TestSecurePrintingPB pb;
@@ -25,12 +25,14 @@
 
 #include <deque>
 #include <initializer_list>
+#include <map>
 #include <memory>
 #include <mutex>
 #include <ostream>
 #include <sstream>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <glog/logging.h>
@@ -86,7 +88,9 @@ using kudu::pb_util::internal::WritableFileOutputStream;
 using std::deque;
 using std::endl;
 using std::initializer_list;
+using std::map;
 using std::ostream;
+using std::pair;
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
@@ -957,6 +961,73 @@ Status WritePBContainerToPath(Env* env, const std::string& path,
   return Status::OK();
 }
 
+void WritePBContainersToPaths(Env* env,
+                              const vector<pair<string, const Message*>>& msgs,
+                              SyncMode sync,
+                              vector<Status>* statuses) {
+  TRACE_EVENT1("io", "WritePBContainersToPaths",
+               "num_files", msgs.size());
+
+  statuses->assign(msgs.size(), Status::OK());
+  vector<string> tmp_paths(msgs.size());
+  vector<unique_ptr<WritablePBContainerFile>> files(msgs.size());
+
+  // Write all the files, starting their writeback as we go.
+  for (int i = 0; i < msgs.size(); i++) {
+    const string& path = msgs[i].first;
+    const Message& msg = *msgs[i].second;
+    unique_ptr<RWFile> file;
+    Status s = env->NewTempRWFile(RWFileOptions(), path + kTmpInfix + kTmpTemplateSuffix,
+                                  &tmp_paths[i], &file);
+    if (s.ok()) {
+      files[i].reset(new WritablePBContainerFile(std::move(file)));
+      s = files[i]->Init(msg);
+    }
+    if (s.ok()) {
+      s = files[i]->Append(msg);
+    }
+    if (s.ok() && sync == pb_util::SYNC) {
+      s = files[i]->Flush();
+    }
+    (*statuses)[i] = s;
+  }
+
+  // Wait for the writeback of each file and rename it into place.
+  map<string, vector<int>> dirs;
+  for (int i = 0; i < msgs.size(); i++) {
+    const string& path = msgs[i].first;
+    Status* s = &(*statuses)[i];
+    if (s->ok() && sync == pb_util::SYNC) {
+      *s = files[i]->Sync();
+    }
+    if (s->ok()) {
+      *s = files[i]->Close();
+    }
+    if (s->ok()) {
+      *s = env->RenameFile(tmp_paths[i], path).CloneAndPrepend(
+          "Failed to rename tmp file to " + path);
+    }
+    files[i].reset();
+    if (s->ok()) {
+      dirs[DirName(path)].push_back(i);
+    } else if (!tmp_paths[i].empty()) {
+      WARN_NOT_OK(env->DeleteFile(tmp_paths[i]),
+                  "Could not delete temporary file " + tmp_paths[i]);
+    }
+  }
+
+  if (sync == pb_util::SYNC) {
+    for (const auto& e : dirs) {
+      Status s = env->SyncDir(e.first);
+      if (!s.ok()) {
+        for (int i : e.second) {
+          (*statuses)[i] = s.CloneAndPrepend("Failed to SyncDir() parent of " + msgs[i].first);
+        }
+      }
+    }
+  }
+}
+
 
 scoped_refptr<debug::ConvertableToTraceFormat> PbTracer::TracePb(const Message& msg) {
   return make_scoped_refptr(new PbTracer(msg));
@@ -23,6 +23,8 @@
 
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <gtest/gtest_prod.h>
 
@@ -453,6 +455,19 @@ Status WritePBContainerToPath(Env* env, const std::string& path,
                               CreateMode create,
                               SyncMode sync);
 
+// Serialize each of 'msgs' to the path it is paired with, overwriting any
+// existing file, as WritePBContainerToPath() does with OVERWRITE.
+//
+// The files are written together: if sync == SYNC, the writeback of all of
+// them is started before any of them is fsynced, and each of their parent
+// directories is fsynced once after all the files are renamed into place.
+// The outcome of each write is returned in 'statuses', in the order of 'msgs'.
+void WritePBContainersToPaths(
+    Env* env,
+    const std::vector<std::pair<std::string, const google::protobuf::Message*>>& msgs,
+    SyncMode sync,
+    std::vector<Status>* statuses);
+
 // Wrapper for a protobuf message which lazily converts to JSON when
 // the trace buffer is dumped.
 //
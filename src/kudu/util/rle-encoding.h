@@ -17,6 +17,8 @@
 #ifndef IMPALA_RLE_ENCODING_H
 #define IMPALA_RLE_ENCODING_H
 
+#include <algorithm>
+
 #include <glog/logging.h>
 
 #include "kudu/gutil/port.h"
@@ -111,6 +113,11 @@ class RleDecoder {
   // GetNextRun will return more from the same run.
   size_t GetNextRun(T* val, size_t max_run);
 
+  // Gets the next 'num_values' values into 'vals'. Returns the number of values
+  // read, which is less than 'num_values' only if there is no more data. Literal
+  // runs are decoded in bulk, and repeated runs are filled in directly.
+  size_t GetValues(T* vals, size_t num_values);
+
  private:
   bool ReadHeader();
 
@@ -341,6 +348,34 @@ inline size_t RleDecoder<T>::GetNextRun(T* val, size_t max_run) {
   return ret;
  }
 
+template<typename T>
+inline size_t RleDecoder<T>::GetValues(T* vals, size_t num_values) {
+  DCHECK(bit_reader_.is_initialized());
+  size_t num_read = 0;
+  while (num_read < num_values && ReadHeader()) {
+    size_t rem = num_values - num_read;
+    if (PREDICT_TRUE(repeat_count_ > 0)) {
+      size_t n = std::min<size_t>(repeat_count_, rem);
+      std::fill(vals + num_read, vals + num_read + n, static_cast<T>(current_value_));
+      repeat_count_ -= n;
+      num_read += n;
+      rewind_state_ = REWIND_RUN;
+    } else {
+      DCHECK(literal_count_ > 0);
+      size_t n = std::min<size_t>(literal_count_, rem);
+      size_t batch_read = bit_reader_.GetBatch(bit_width_, vals + num_read, n);
+      literal_count_ -= batch_read;
+      num_read += batch_read;
+      rewind_state_ = REWIND_LITERAL;
+      if (PREDICT_FALSE(batch_read < n)) {
+        // The final literal group may be shorter than its indicator claims.
+        break;
+      }
+    }
+  }
+  return num_read;
+}
+
 template<typename T>
 inline size_t RleDecoder<T>::Skip(size_t to_skip) {
   DCHECK(bit_reader_.is_initialized());
@@ -28,6 +28,7 @@
 #include "kudu/util/rle-encoding.h"
 #include "kudu/util/bit-stream-utils.h"
 #include "kudu/util/hexdump.h"
+#include "kudu/util/random.h"
 #include "kudu/util/test_util.h"
 
 using std::string;
@@ -132,6 +133,45 @@ TEST(BitArray, TestValues) {
   }
 }
 
+// Writes 'num_vals' values with width 'bit_width', skips 'offset' values one
+// at a time, and reads the rest back with a single GetBatch() call.
+void TestBitArrayBatch(int bit_width, int num_vals, int offset) {
+  const int kTestLen = BitUtil::Ceil(bit_width * num_vals, 8);
+  const uint64_t mask = bit_width == 64 ? ~0ULL : (1ULL << bit_width) - 1;
+
+  vector<uint64_t> values;
+  faststring buffer(kTestLen);
+  BitWriter writer(&buffer);
+  for (int i = 0; i < num_vals; ++i) {
+    uint64_t v = (i * 0x9E3779B97F4A7C15ULL) & mask;
+    values.push_back(v);
+    writer.PutValue(v, bit_width);
+  }
+  writer.Flush();
+
+  BitReader reader(buffer.data(), kTestLen);
+  for (int i = 0; i < offset; ++i) {
+    uint64_t val = 0;
+    ASSERT_TRUE(reader.GetValue(bit_width, &val));
+    ASSERT_EQ(values[i], val);
+  }
+  vector<uint64_t> batch(num_vals - offset);
+  ASSERT_EQ(num_vals - offset, reader.GetBatch(bit_width, batch.data(), batch.size()));
+  for (int i = offset; i < num_vals; ++i) {
+    ASSERT_EQ(values[i], batch[i - offset]) << "width " << bit_width << " index " << i;
+  }
+  ASSERT_EQ(0, reader.bytes_left());
+}
+
+TEST(BitArray, TestBatchValues) {
+  for (int width = 1; width <= MAX_WIDTH; ++width) {
+    for (int offset : { 0, 1, 5, 33 }) {
+      NO_FATALS(TestBitArrayBatch(width, 40, offset));
+      NO_FATALS(TestBitArrayBatch(width, 1000, offset));
+    }
+  }
+}
+
 // Test some mixed values
 TEST(BitArray, TestMixed) {
   const int kTestLenBits = 1024;
@@ -478,6 +518,46 @@ TEST_F(TestRle, TestRoundTripRandomSequencesWithRuns) {
     ASSERT_EQ(string_rep, roundtrip_str);
   }
 }
+// Test that bulk decoding matches value-at-a-time decoding for every bit
+// width, over sequences which mix literal and repeated runs.
+TEST_F(TestRle, TestGetValues) {
+  Random rng(SeedRandom());
+  for (int width = 1; width <= 32; ++width) {
+    const uint32_t max_value = width == 32 ? MathLimits<uint32_t>::kMax : (1U << width) - 1;
+    vector<uint32_t> values;
+    for (int i = 0; i < 2000; ++i) {
+      uint32_t v = rng.Next32() & max_value;
+      int run_length = rng.OneIn(4) ? rng.Uniform(50) + 1 : 1;
+      values.insert(values.end(), run_length, v);
+    }
+
+    faststring buffer;
+    RleEncoder<uint32_t> encoder(&buffer, width);
+    for (uint32_t v : values) {
+      encoder.Put(v);
+    }
+    encoder.Flush();
+
+    RleDecoder<uint32_t> decoder(buffer.data(), encoder.len(), width);
+    vector<uint32_t> decoded(values.size());
+    size_t pos = 0;
+    while (pos < values.size()) {
+      // Alternate between single and bulk reads of varying size.
+      if (rng.OneIn(3)) {
+        ASSERT_TRUE(decoder.Get(&decoded[pos]));
+        pos++;
+      } else {
+        size_t n = std::min<size_t>(rng.Uniform(300) + 1, values.size() - pos);
+        ASSERT_EQ(n, decoder.GetValues(&decoded[pos], n));
+        pos += n;
+      }
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+      ASSERT_EQ(values[i], decoded[i]) << "width " << width << " index " << i;
+    }
+  }
+}
+
 TEST_F(TestRle, TestSkip) {
   faststring buffer(1);
   RleEncoder<bool> encoder(&buffer, 1);
@@ -23,7 +23,9 @@
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/macros.h"
 #include "kudu/gutil/port.h"
+#include "kudu/gutil/walltime.h"
 #include "kudu/util/debug-util.h"
+#include "kudu/util/spinlock_profiling.h"
 
 #include "kudu/util/thread.h"
 
@@ -65,6 +67,7 @@ class rw_semaphore {
 
   void lock_shared() {
     int loop_count = 0;
+    int64_t wait_start_cycles = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       Atomic32 expected = cur_state & kNumReadersMask;   // I expect no write lock
@@ -73,8 +76,14 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      if (wait_start_cycles == 0) {
+        wait_start_cycles = CycleClock::Now();
+      }
       boost::detail::yield(loop_count++);
     }
+    if (PREDICT_FALSE(wait_start_cycles != 0)) {
+      SubmitWaitCycles(wait_start_cycles);
+    }
   }
 
   void unlock_shared() {
@@ -119,6 +128,7 @@ class rw_semaphore {
 
   void lock() {
     int loop_count = 0;
+    int64_t wait_start_cycles = 0;
     Atomic32 cur_state = base::subtle::NoBarrier_Load(&state_);
     while (true) {
       Atomic32 expected = cur_state & kNumReadersMask;   // I expect some 0+ readers
@@ -129,10 +139,21 @@ class rw_semaphore {
       if (cur_state == expected)
         break;
       // Either was already locked by someone else, or CAS failed.
+      if (wait_start_cycles == 0) {
+        wait_start_cycles = CycleClock::Now();
+      }
       boost::detail::yield(loop_count++);
     }
 
-    WaitPendingReaders();
+    if (PREDICT_FALSE(base::subtle::Acquire_Load(&state_) & kNumReadersMask)) {
+      if (wait_start_cycles == 0) {
+        wait_start_cycles = CycleClock::Now();
+      }
+      WaitPendingReaders();
+    }
+    if (PREDICT_FALSE(wait_start_cycles != 0)) {
+      SubmitWaitCycles(wait_start_cycles);
+    }
 
 #ifndef NDEBUG
     writer_tid_ = Thread::CurrentThreadId();
@@ -185,6 +206,12 @@ class rw_semaphore {
   }
 #endif
 
+  // Reports the time spent waiting for the lock since 'wait_start_cycles' to
+  // the lock contention profile.
+  void SubmitWaitCycles(int64_t wait_start_cycles) {
+    SubmitLockContentionProfileData(this, CycleClock::Now() - wait_start_cycles);
+  }
+
   void WaitPendingReaders() {
     int loop_count = 0;
     while ((base::subtle::Acquire_Load(&state_) & kNumReadersMask) > 0) {
@@ -19,8 +19,10 @@
 
 #include <glog/logging.h>
 
-#ifndef NDEBUG
 #include "kudu/gutil/walltime.h"
+#include "kudu/util/spinlock_profiling.h"
+
+#ifndef NDEBUG
 #include "kudu/util/debug-util.h"
 #include "kudu/util/env.h"
 #include "kudu/util/thread.h"
@@ -77,8 +79,12 @@ bool RWCLock::HasWriteLock() const {
 void RWCLock::WriteLock() {
   MutexLock l(lock_);
   // Wait for any other mutations to finish.
-  while (write_locked_) {
-    no_mutators_.Wait();
+  if (PREDICT_FALSE(write_locked_)) {
+    int64_t start_cycles = CycleClock::Now();
+    while (write_locked_) {
+      no_mutators_.Wait();
+    }
+    SubmitLockContentionProfileData(this, CycleClock::Now() - start_cycles);
   }
 #ifndef NDEBUG
   last_writelock_acquire_time_ = GetCurrentTimeMicros();
@@ -101,8 +107,12 @@ void RWCLock::WriteUnlock() {
 void RWCLock::UpgradeToCommitLock() {
   lock_.lock();
   DCHECK(write_locked_);
-  while (reader_count_ > 0) {
-    no_readers_.Wait();
+  if (PREDICT_FALSE(reader_count_ > 0)) {
+    int64_t start_cycles = CycleClock::Now();
+    while (reader_count_ > 0) {
+      no_readers_.Wait();
+    }
+    SubmitLockContentionProfileData(this, CycleClock::Now() - start_cycles);
   }
   DCHECK(write_locked_);
 
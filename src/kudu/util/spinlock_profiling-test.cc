@@ -18,8 +18,12 @@
 #include <gtest/gtest.h>
 #include <glog/logging.h>
 #include <strstream>
+#include <thread>
 
 #include "kudu/gutil/spinlock.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/monotime.h"
+#include "kudu/util/mutex.h"
 #include "kudu/util/spinlock_profiling.h"
 #include "kudu/util/test_util.h"
 #include "kudu/util/trace.h"
@@ -82,4 +86,39 @@ TEST_F(SpinLockProfilingTest, TestTcmallocContention) {
   ASSERT_GE(GetTcmallocContentionMicros(), 0);
 }
 
+// Holds 'lock' while another thread waits for it, and returns the contention
+// profile collected meanwhile.
+template<class LockType>
+static string ProfileContendedLock(LockType* lock) {
+  StartSynchronizationProfiling();
+  lock->lock();
+  std::thread waiter([lock]() {
+      lock->lock();
+      lock->unlock();
+    });
+  SleepFor(MonoDelta::FromMilliseconds(50));
+  lock->unlock();
+  waiter.join();
+  StopSynchronizationProfiling();
+
+  std::ostringstream str;
+  int64_t dropped = 0;
+  FlushSynchronizationProfile(&str, &dropped);
+  return str.str();
+}
+
+TEST_F(SpinLockProfilingTest, TestOtherLockTypes) {
+  InitSpinLockContentionProfiling();
+  uint64_t contention_before = GetSpinLockContentionMicros();
+  {
+    Mutex lock;
+    ASSERT_STR_CONTAINS(ProfileContendedLock(&lock), "\t1 @ ");
+  }
+  {
+    rw_spinlock lock;
+    ASSERT_STR_CONTAINS(ProfileContendedLock(&lock), "\t1 @ ");
+  }
+  ASSERT_GT(GetSpinLockContentionMicros(), contention_before);
+}
+
 } // namespace kudu
@@ -36,14 +36,14 @@
 
 DEFINE_int32(lock_contention_trace_threshold_cycles,
              2000000, // 2M cycles should be about 1ms
-             "If acquiring a spinlock takes more than this number of "
+             "If acquiring a lock takes more than this number of "
              "cycles, and a Trace is currently active, then the current "
              "stack trace is logged to the trace buffer.");
 TAG_FLAG(lock_contention_trace_threshold_cycles, hidden);
 
 METRIC_DEFINE_gauge_uint64(server, spinlock_contention_time,
     "Spinlock Contention Time", kudu::MetricUnit::kMicroseconds,
-    "Amount of time consumed by contention on internal spinlocks since the server "
+    "Amount of time consumed by contention on internal locks since the server "
     "started. If this increases rapidly, it may indicate a performance issue in Kudu "
     "internals triggered by a particular workload and warrant investigation.",
     kudu::EXPOSE_AS_COUNTER);
@@ -224,8 +224,7 @@ bool ContentionStacks::CollectSample(uint64_t* iterator, StackTrace* s, int64_t*
 }
 
 
-void SubmitSpinLockProfileData(const void *contendedlock, int64 wait_cycles) {
-  TRACE_COUNTER_INCREMENT("spinlock_wait_cycles", wait_cycles);
+void SubmitProfileData(const void *contendedlock, int64 wait_cycles) {
   bool profiling_enabled = base::subtle::Acquire_Load(&g_profiling_enabled);
   bool long_wait_time = wait_cycles > FLAGS_lock_contention_trace_threshold_cycles;
   // Short circuit this function quickly in the common case.
@@ -265,6 +264,11 @@ void SubmitSpinLockProfileData(const void *contendedlock, int64 wait_cycles) {
   in_func = false;
 }
 
+void SubmitSpinLockProfileData(const void *contendedlock, int64 wait_cycles) {
+  TRACE_COUNTER_INCREMENT("spinlock_wait_cycles", wait_cycles);
+  SubmitProfileData(contendedlock, wait_cycles);
+}
+
 void DoInit() {
   base::subtle::Release_Store(reinterpret_cast<AtomicWord*>(&g_contention_stacks),
                               reinterpret_cast<uintptr_t>(new ContentionStacks()));
@@ -291,6 +295,10 @@ void RegisterSpinLockContentionMetrics(const scoped_refptr<MetricEntity>& entity
 
 }
 
+void SubmitLockContentionProfileData(const void* contended_lock, int64_t wait_cycles) {
+  SubmitProfileData(contended_lock, wait_cycles);
+}
+
 uint64_t GetSpinLockContentionMicros() {
   int64_t wait_cycles = DCHECK_NOTNULL(g_contended_cycles)->Value();
   double micros = static_cast<double>(wait_cycles) / base::CyclesPerSecond()
@@ -17,6 +17,8 @@
 #ifndef KUDU_UTIL_SPINLOCK_PROFILING_H
 #define KUDU_UTIL_SPINLOCK_PROFILING_H
 
+#include <stdint.h>
+
 #include <iosfwd>
 
 #include "kudu/gutil/macros.h"
@@ -34,7 +36,16 @@ class MetricEntity;
 // just so that gcc doesn't omit the underlying module from the binary.
 void InitSpinLockContentionProfiling();
 
-// Return the total number of microseconds spent in spinlock contention
+// Record that a thread waited 'wait_cycles' CPU cycles to acquire the lock at
+// 'contended_lock'.
+//
+// gutil SpinLocks, and so simple_spinlocks, report their contention through
+// the gutil hook. The other lock types (Mutex, rw_spinlock and percpu_rwlock,
+// RWCLock) call this when they had to wait, so that their contention shows
+// up in the same metrics, trace messages and contention profiles.
+void SubmitLockContentionProfileData(const void* contended_lock, int64_t wait_cycles);
+
+// Return the total number of microseconds spent in lock contention
 // since the server started.
 uint64_t GetSpinLockContentionMicros();
 
@@ -19,9 +19,12 @@
 #include <glog/logging.h>
 #include <gtest/gtest.h>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "kudu/gutil/atomicops.h"
 #include "kudu/gutil/bind.h"
+#include "kudu/util/atomic.h"
 #include "kudu/util/countdown_latch.h"
 #include "kudu/util/metrics.h"
 #include "kudu/util/promise.h"
@@ -31,6 +34,8 @@
 #include "kudu/util/trace.h"
 
 using std::shared_ptr;
+using std::unique_ptr;
+using std::vector;
 
 namespace kudu {
 
@@ -372,5 +377,95 @@ TEST(TestThreadPool, TestSlowDestructor) {
   ASSERT_LT((MonoTime::Now() - start).ToSeconds(), 5);
 }
 
+// Test that the tasks of a SERIAL token run one at a time, in order, even
+// though the pool has more threads.
+TEST(TestThreadPool, TestSerialToken) {
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(BuildMinMaxTestPool(0, 8, &thread_pool));
+  unique_ptr<ThreadPoolToken> token = thread_pool->NewToken(ThreadPool::ExecutionMode::SERIAL);
+
+  const int kNumTasks = 200;
+  Atomic32 running = 0;
+  vector<int> order;
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_OK(token->SubmitFunc([&, i]() {
+        CHECK_EQ(1, base::subtle::NoBarrier_AtomicIncrement(&running, 1));
+        order.push_back(i);
+        boost::detail::yield(i);
+        base::subtle::NoBarrier_AtomicIncrement(&running, -1);
+      }));
+  }
+  token->Wait();
+  ASSERT_EQ(kNumTasks, static_cast<int>(order.size()));
+  for (int i = 0; i < kNumTasks; i++) {
+    ASSERT_EQ(i, order[i]);
+  }
+}
+
+// Test that waiting for a token doesn't wait for the tasks of other tokens or
+// of the pool itself.
+TEST(TestThreadPool, TestTokenWait) {
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(BuildMinMaxTestPool(0, 4, &thread_pool));
+  unique_ptr<ThreadPoolToken> blocked =
+      thread_pool->NewToken(ThreadPool::ExecutionMode::CONCURRENT);
+  unique_ptr<ThreadPoolToken> token = thread_pool->NewToken(ThreadPool::ExecutionMode::SERIAL);
+
+  CountDownLatch latch(1);
+  ASSERT_OK(blocked->SubmitFunc([&]() { latch.Wait(); }));
+  ASSERT_OK(thread_pool->SubmitFunc([&]() { latch.Wait(); }));
+  Atomic32 counter = 0;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(token->SubmitFunc([&]() { base::subtle::NoBarrier_AtomicIncrement(&counter, 1); }));
+  }
+  token->Wait();
+  ASSERT_EQ(10, base::subtle::NoBarrier_Load(&counter));
+  ASSERT_FALSE(blocked->WaitFor(MonoDelta::FromMilliseconds(10)));
+  ASSERT_FALSE(thread_pool->WaitFor(MonoDelta::FromMilliseconds(10)));
+
+  latch.CountDown();
+  blocked->Wait();
+  thread_pool->Wait();
+}
+
+// Test that shutting a token down drops its queued tasks, waits for its running
+// one, and makes later submissions fail.
+TEST(TestThreadPool, TestTokenShutdown) {
+  gscoped_ptr<ThreadPool> thread_pool;
+  ASSERT_OK(BuildMinMaxTestPool(0, 4, &thread_pool));
+  unique_ptr<ThreadPoolToken> token = thread_pool->NewToken(ThreadPool::ExecutionMode::SERIAL);
+
+  CountDownLatch started(1);
+  CountDownLatch latch(1);
+  AtomicBool finished(false);
+  ASSERT_OK(token->SubmitFunc([&]() {
+      started.CountDown();
+      latch.Wait();
+      finished.Store(true);
+    }));
+  Atomic32 counter = 0;
+  for (int i = 0; i < 10; i++) {
+    ASSERT_OK(token->SubmitFunc([&]() { base::subtle::NoBarrier_AtomicIncrement(&counter, 1); }));
+  }
+  started.Wait();
+  ASSERT_EQ(10, thread_pool->queue_length());
+
+  std::thread releaser([&]() {
+      SleepFor(MonoDelta::FromMilliseconds(100));
+      latch.CountDown();
+    });
+  token->Shutdown();
+  releaser.join();
+  ASSERT_TRUE(finished.Load());
+  ASSERT_EQ(0, base::subtle::NoBarrier_Load(&counter));
+  ASSERT_EQ(0, thread_pool->queue_length());
+  ASSERT_TRUE(token->SubmitFunc([]() {}).IsServiceUnavailable());
+
+  // The pool itself is still usable.
+  ASSERT_OK(thread_pool->SubmitFunc([&]() { base::subtle::NoBarrier_AtomicIncrement(&counter, 1); }));
+  thread_pool->Wait();
+  ASSERT_EQ(1, base::subtle::NoBarrier_Load(&counter));
+}
+
 
 } // namespace kudu
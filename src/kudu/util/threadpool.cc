@@ -17,6 +17,8 @@
 
 #include "kudu/util/threadpool.h"
 
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/function.hpp>
 #include <gflags/gflags.h>
 #include <glog/logging.h>
@@ -24,6 +26,7 @@
 #include <string>
 
 #include "kudu/gutil/callback.h"
+#include "kudu/gutil/map-util.h"
 #include "kudu/gutil/stl_util.h"
 #include "kudu/gutil/strings/substitute.h"
 #include "kudu/gutil/sysinfo.h"
@@ -113,7 +116,8 @@ ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
     not_empty_(&lock_),
     num_threads_(0),
     active_threads_(0),
-    queue_size_(0) {
+    queue_size_(0),
+    tokenless_(NewToken(ExecutionMode::CONCURRENT)) {
 
   string prefix = !builder.trace_metric_prefix_.empty() ?
       builder.trace_metric_prefix_ : builder.name_;
@@ -128,6 +132,15 @@ ThreadPool::ThreadPool(const ThreadPoolBuilder& builder)
 
 ThreadPool::~ThreadPool() {
   Shutdown();
+  tokenless_.reset();
+  DCHECK(tokens_.empty()) << "Tokens of thread pool " << name_ << " outlived it";
+}
+
+std::unique_ptr<ThreadPoolToken> ThreadPool::NewToken(ExecutionMode mode) {
+  std::unique_ptr<ThreadPoolToken> token(new ThreadPoolToken(this, mode));
+  MutexLock unique_lock(lock_);
+  InsertOrDie(&tokens_, token.get());
+  return token;
 }
 
 Status ThreadPool::Init() {
@@ -152,13 +165,16 @@ void ThreadPool::Shutdown() {
 
   pool_status_ = Status::ServiceUnavailable("The pool has been shut down.");
 
-  // Clear the queue_ member under the lock, but defer the releasing
+  // Clear the queued tasks under the lock, but defer the releasing
   // of the entries outside the lock, in case there are concurrent threads
   // wanting to access the ThreadPool. The task's destructors may acquire
   // locks, etc, so this also prevents lock inversions.
-  auto to_release = std::move(queue_);
-  queue_.clear();
-  queue_size_ = 0;
+  std::deque<QueueEntry> to_release;
+  for (ThreadPoolToken* token : tokens_) {
+    RemoveTokenTasksUnlocked(token, &to_release);
+  }
+  DCHECK(queue_.empty());
+  DCHECK_EQ(0, queue_size_);
   not_empty_.Broadcast();
 
   // The Runnable doesn't have Abort() so we must wait
@@ -187,12 +203,19 @@ Status ThreadPool::SubmitFunc(boost::function<void()> func) {
 }
 
 Status ThreadPool::Submit(std::shared_ptr<Runnable> task) {
+  return DoSubmit(std::move(task), tokenless_.get());
+}
+
+Status ThreadPool::DoSubmit(std::shared_ptr<Runnable> task, ThreadPoolToken* token) {
   MonoTime submit_time = MonoTime::Now();
 
   MutexLock guard(lock_);
   if (PREDICT_FALSE(!pool_status_.ok())) {
     return pool_status_;
   }
+  if (PREDICT_FALSE(token->shutdown_)) {
+    return Status::ServiceUnavailable("The thread pool token has been shut down.");
+  }
 
   // Size limit check.
   int64_t capacity_remaining = static_cast<int64_t>(max_threads_) - active_threads_ +
@@ -238,7 +261,13 @@ Status ThreadPool::Submit(std::shared_ptr<Runnable> task) {
   }
   e.submit_time = submit_time;
 
-  queue_.emplace_back(std::move(e));
+  // A SERIAL token only becomes ready to run once the task it's running, if
+  // any, completes.
+  bool token_was_idle = token->IsIdleUnlocked();
+  token->entries_.emplace_back(std::move(e));
+  if (token->mode_ == ExecutionMode::CONCURRENT || token_was_idle) {
+    queue_.push_back(token);
+  }
   int length_at_submit = queue_size_++;
 
   guard.Unlock();
@@ -275,6 +304,19 @@ bool ThreadPool::WaitFor(const MonoDelta& delta) {
 }
 
 
+void ThreadPool::RemoveTokenTasksUnlocked(ThreadPoolToken* token,
+                                          std::deque<QueueEntry>* removed) {
+  queue_.erase(std::remove(queue_.begin(), queue_.end(), token), queue_.end());
+  queue_size_ -= token->entries_.size();
+  for (QueueEntry& e : token->entries_) {
+    removed->emplace_back(std::move(e));
+  }
+  token->entries_.clear();
+  if (token->IsIdleUnlocked()) {
+    token->idle_cond_.Broadcast();
+  }
+}
+
 void ThreadPool::SetQueueLengthHistogram(const scoped_refptr<Histogram>& hist) {
   queue_length_histogram_ = hist;
 }
@@ -318,10 +360,13 @@ void ThreadPool::DispatchThread(bool permanent) {
     }
 
     // Fetch a pending task
-    QueueEntry entry = std::move(queue_.front());
+    ThreadPoolToken* token = queue_.front();
     queue_.pop_front();
+    QueueEntry entry = std::move(token->entries_.front());
+    token->entries_.pop_front();
     queue_size_--;
     ++active_threads_;
+    ++token->active_threads_;
 
     unique_lock.Unlock();
 
@@ -364,6 +409,14 @@ void ThreadPool::DispatchThread(bool permanent) {
     entry.runnable.reset();
     unique_lock.Lock();
 
+    // The next task of a SERIAL token may run now that this one completed.
+    --token->active_threads_;
+    if (token->mode_ == ExecutionMode::SERIAL && !token->entries_.empty()) {
+      queue_.push_back(token);
+    }
+    if (token->IsIdleUnlocked()) {
+      token->idle_cond_.Broadcast();
+    }
     if (--active_threads_ == 0) {
       idle_cond_.Broadcast();
     }
@@ -407,4 +460,74 @@ void ThreadPool::CheckNotPoolThreadUnlocked() {
   }
 }
 
+////////////////////////////////////////////////////////
+// ThreadPoolToken
+////////////////////////////////////////////////////////
+
+ThreadPoolToken::ThreadPoolToken(ThreadPool* pool, ThreadPool::ExecutionMode mode)
+    : pool_(pool),
+      mode_(mode),
+      active_threads_(0),
+      shutdown_(false),
+      idle_cond_(&pool->lock_) {
+}
+
+ThreadPoolToken::~ThreadPoolToken() {
+  Shutdown();
+  MutexLock unique_lock(pool_->lock_);
+  CHECK_EQ(1, pool_->tokens_.erase(this));
+}
+
+Status ThreadPoolToken::SubmitClosure(const Closure& task) {
+  return SubmitFunc(boost::bind(&Closure::Run, task));
+}
+
+Status ThreadPoolToken::SubmitFunc(boost::function<void()> func) {
+  return Submit(std::shared_ptr<Runnable>(new FunctionRunnable(std::move(func))));
+}
+
+Status ThreadPoolToken::Submit(std::shared_ptr<Runnable> task) {
+  return pool_->DoSubmit(std::move(task), this);
+}
+
+void ThreadPoolToken::Wait() {
+  MutexLock unique_lock(pool_->lock_);
+  pool_->CheckNotPoolThreadUnlocked();
+  while (!IsIdleUnlocked()) {
+    idle_cond_.Wait();
+  }
+}
+
+bool ThreadPoolToken::WaitFor(const MonoDelta& delta) {
+  MonoTime deadline = MonoTime::Now() + delta;
+  MutexLock unique_lock(pool_->lock_);
+  pool_->CheckNotPoolThreadUnlocked();
+  while (!IsIdleUnlocked()) {
+    if (!idle_cond_.TimedWait(deadline - MonoTime::Now())) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ThreadPoolToken::Shutdown() {
+  MutexLock unique_lock(pool_->lock_);
+  pool_->CheckNotPoolThreadUnlocked();
+
+  shutdown_ = true;
+  std::deque<ThreadPool::QueueEntry> to_release;
+  pool_->RemoveTokenTasksUnlocked(this, &to_release);
+  while (active_threads_ > 0) {
+    idle_cond_.Wait();
+  }
+
+  // Release the removed tasks outside the lock, as ThreadPool::Shutdown() does.
+  unique_lock.Unlock();
+  for (ThreadPool::QueueEntry& e : to_release) {
+    if (e.trace) {
+      e.trace->Release();
+    }
+  }
+}
+
 } // namespace kudu
@@ -19,7 +19,7 @@
 
 #include <boost/function.hpp>
 #include <gtest/gtest_prod.h>
-#include <list>
+#include <deque>
 #include <memory>
 #include <unordered_set>
 #include <string>
@@ -40,6 +40,7 @@ namespace kudu {
 class Histogram;
 class Thread;
 class ThreadPool;
+class ThreadPoolToken;
 class Trace;
 
 class Runnable {
@@ -141,10 +142,29 @@ class ThreadPoolBuilder {
 //            .Build(&thread_pool));
 //    thread_pool->Submit(shared_ptr<Runnable>(new Task()));
 //    thread_pool->Submit(boost::bind(&Func, 10));
+//
+// Tasks may also be submitted through tokens (see ThreadPoolToken), which share
+// the threads of the pool. The tasks of a SERIAL token run one at a time, in
+// the order they were submitted, so that e.g. the work of every tablet can be
+// ordered without a dedicated pool (and threads) per tablet.
 class ThreadPool {
  public:
   ~ThreadPool();
 
+  // How the tasks submitted through a token are run.
+  enum class ExecutionMode {
+    // One at a time, in the order they were submitted.
+    SERIAL,
+
+    // Concurrently, in no particular order, like the tasks submitted
+    // directly to the pool.
+    CONCURRENT,
+  };
+
+  // Creates a new token to submit tasks through. The token must be destroyed
+  // before the pool.
+  std::unique_ptr<ThreadPoolToken> NewToken(ExecutionMode mode);
+
   // Wait for the running tasks to complete and then shutdown the threads.
   // All the other pending tasks in the queue will be removed.
   // NOTE: That the user may implement an external abort logic for the
@@ -192,10 +212,26 @@ class ThreadPool {
 
  private:
   friend class ThreadPoolBuilder;
+  friend class ThreadPoolToken;
+
+  struct QueueEntry {
+    std::shared_ptr<Runnable> runnable;
+    Trace* trace;
+
+    // Time at which the entry was submitted to the pool.
+    MonoTime submit_time;
+  };
 
   // Create a new thread pool using a builder.
   explicit ThreadPool(const ThreadPoolBuilder& builder);
 
+  // Submits 'task' through 'token'.
+  Status DoSubmit(std::shared_ptr<Runnable> task, ThreadPoolToken* token);
+
+  // Removes the queued tasks of 'token' from the queue, and moves them to
+  // 'removed'. Requires that lock_ is held.
+  void RemoveTokenTasksUnlocked(ThreadPoolToken* token, std::deque<QueueEntry>* removed);
+
   // Initialize the thread pool by starting the minimum number of threads.
   Status Init();
 
@@ -212,13 +248,6 @@ class ThreadPool {
   FRIEND_TEST(TestThreadPool, TestThreadPoolWithNoMinimum);
   FRIEND_TEST(TestThreadPool, TestVariableSizeThreadPool);
 
-  struct QueueEntry {
-    std::shared_ptr<Runnable> runnable;
-    Trace* trace;
-
-    // Time at which the entry was submitted to the pool.
-    MonoTime submit_time;
-  };
 
   const std::string name_;
   const int min_threads_;
@@ -233,8 +262,22 @@ class ThreadPool {
   ConditionVariable not_empty_;
   int num_threads_;
   int active_threads_;
+
+  // The number of queued tasks, of all tokens.
   int queue_size_;
-  std::list<QueueEntry> queue_;
+
+  // The tokens which have a task ready to run, in the order the tasks are to
+  // be run. A CONCURRENT token appears once per queued task. A SERIAL token
+  // appears at most once, and only while none of its tasks is running.
+  std::deque<ThreadPoolToken*> queue_;
+
+  // All the tokens of the pool, including 'tokenless_'.
+  //
+  // Protected by lock_.
+  std::unordered_set<ThreadPoolToken*> tokens_;
+
+  // The token of the tasks submitted directly to the pool.
+  std::unique_ptr<ThreadPoolToken> tokenless_;
 
   // Pointers to all running threads. Raw pointers are safe because a Thread
   // may only go out of scope after being removed from threads_.
@@ -253,5 +296,66 @@ class ThreadPool {
   DISALLOW_COPY_AND_ASSIGN(ThreadPool);
 };
 
+// A handle to submit tasks to a ThreadPool, created with ThreadPool::NewToken().
+// Its tasks run on the threads of the pool, as specified by its execution mode,
+// and they can be waited for or cancelled independently of the other tasks of
+// the pool.
+//
+// This class is thread-safe.
+class ThreadPoolToken {
+ public:
+  // Shuts the token down (see Shutdown()).
+  ~ThreadPoolToken();
+
+  // Submit a function using the kudu Closure system.
+  Status SubmitClosure(const Closure& task) WARN_UNUSED_RESULT;
+
+  // Submit a function binded using boost::bind(&FuncName, args...)
+  Status SubmitFunc(boost::function<void()> func) WARN_UNUSED_RESULT;
+
+  // Submit a Runnable class
+  Status Submit(std::shared_ptr<Runnable> task) WARN_UNUSED_RESULT;
+
+  // Wait until all the tasks of the token are completed.
+  void Wait();
+
+  // Waits for all the tasks of the token to complete, or until 'delta' time
+  // elapses. Returns true if they completed, false otherwise.
+  bool WaitFor(const MonoDelta& delta);
+
+  // Removes the queued tasks of the token, and waits for its running tasks to
+  // complete. Any later submission through the token fails.
+  //
+  // May not be called from a task of the pool.
+  void Shutdown();
+
+ private:
+  friend class ThreadPool;
+
+  ThreadPoolToken(ThreadPool* pool, ThreadPool::ExecutionMode mode);
+
+  // Whether none of the tasks of the token is queued or running.
+  // Requires that the pool's lock_ is held.
+  bool IsIdleUnlocked() const {
+    return entries_.empty() && active_threads_ == 0;
+  }
+
+  ThreadPool* const pool_;
+  const ThreadPool::ExecutionMode mode_;
+
+  // The queued tasks of the token, in submission order.
+  std::deque<ThreadPool::QueueEntry> entries_;  // protected by the pool's lock_
+
+  // The number of tasks of the token which are running.
+  int active_threads_;  // protected by the pool's lock_
+
+  bool shutdown_;  // protected by the pool's lock_
+
+  // Signalled when the token becomes idle.
+  ConditionVariable idle_cond_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThreadPoolToken);
+};
+
 } // namespace kudu
 #endif
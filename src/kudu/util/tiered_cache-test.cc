@@ -0,0 +1,135 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include <string>
+
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+
+#include "kudu/gutil/casts.h"
+#include "kudu/util/cache.h"
+#include "kudu/util/coding.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/test_util.h"
+#include "kudu/util/tiered_cache.h"
+
+DECLARE_bool(cache_force_single_shard);
+DECLARE_string(nvm_cache_path);
+
+METRIC_DECLARE_counter(block_cache_nvm_tier_hits);
+METRIC_DECLARE_counter(block_cache_nvm_tier_demotions);
+
+namespace kudu {
+
+class TieredCacheTest : public KuduTest {
+ public:
+  static const int kDramCapacity = 1024 * 1024;
+  static const int kNvmCapacity = 64 * 1024 * 1024;
+  static const int kEntrySize = 1024;
+
+  virtual void SetUp() OVERRIDE {
+    KuduTest::SetUp();
+    if (google::GetCommandLineFlagInfoOrDie("nvm_cache_path").is_default) {
+      FLAGS_nvm_cache_path = GetTestPath("nvm-cache");
+      ASSERT_OK(Env::Default()->CreateDir(FLAGS_nvm_cache_path));
+    }
+    // Use a single shard so that the DRAM tier's capacity is exact.
+    FLAGS_cache_force_single_shard = true;
+    cache_.reset(NewTieredCache(CacheEvictionPolicy::LRU, kDramCapacity, kNvmCapacity,
+                                "tiered_cache_test"));
+    entity_ = METRIC_ENTITY_server.Instantiate(&metric_registry_, "test");
+    cache_->SetMetrics(entity_);
+  }
+
+  int64_t CounterValue(const CounterPrototype& proto) {
+    return down_cast<Counter*>(entity_->FindOrNull(proto).get())->value();
+  }
+
+  void Insert(int key) {
+    faststring key_str;
+    PutFixed32(&key_str, key);
+    Cache::PendingHandle* ph = CHECK_NOTNULL(
+        cache_->Allocate(Slice(key_str), kEntrySize, kEntrySize));
+    uint8_t* val = cache_->MutableValue(ph);
+    memset(val, 0, kEntrySize);
+    EncodeFixed32(val, key);
+    cache_->Release(cache_->Insert(ph, nullptr));
+  }
+
+  // Returns the value stored for 'key', or -1 if it's not in the cache.
+  int Lookup(int key) {
+    faststring key_str;
+    PutFixed32(&key_str, key);
+    Cache::Handle* h = cache_->Lookup(Slice(key_str), Cache::EXPECT_IN_CACHE);
+    if (h == nullptr) {
+      return -1;
+    }
+    int ret = DecodeFixed32(cache_->Value(h).data());
+    cache_->Release(h);
+    return ret;
+  }
+
+ protected:
+  gscoped_ptr<Cache> cache_;
+  MetricRegistry metric_registry_;
+  scoped_refptr<MetricEntity> entity_;
+};
+
+// Entries evicted from the DRAM tier should be found in the NVM tier, and
+// moved back to the DRAM tier when they're looked up.
+TEST_F(TieredCacheTest, TestDemoteAndPromote) {
+  const int kNumEntries = 4 * kDramCapacity / kEntrySize;
+  for (int i = 0; i < kNumEntries; i++) {
+    Insert(i);
+  }
+
+  // The first entries have been evicted from the DRAM tier; wait for their
+  // demotion to the NVM tier.
+  const int kNumEvicted = kNumEntries - kDramCapacity / kEntrySize;
+  AssertEventually([&]() {
+      ASSERT_GE(CounterValue(METRIC_block_cache_nvm_tier_demotions), kNumEvicted);
+    });
+
+  for (int i = 0; i < kNumEvicted; i++) {
+    ASSERT_EQ(i, Lookup(i));
+  }
+  ASSERT_EQ(kNumEvicted, CounterValue(METRIC_block_cache_nvm_tier_hits));
+
+  // The last entry looked up was promoted and is now in the DRAM tier.
+  int64_t nvm_hits = CounterValue(METRIC_block_cache_nvm_tier_hits);
+  ASSERT_EQ(kNumEvicted - 1, Lookup(kNumEvicted - 1));
+  ASSERT_EQ(nvm_hits, CounterValue(METRIC_block_cache_nvm_tier_hits));
+}
+
+TEST_F(TieredCacheTest, TestErase) {
+  const int kNumEntries = 2 * kDramCapacity / kEntrySize;
+  for (int i = 0; i < kNumEntries; i++) {
+    Insert(i);
+  }
+  // One entry in each tier, eventually.
+  AssertEventually([&]() {
+      ASSERT_GE(CounterValue(METRIC_block_cache_nvm_tier_demotions), 1);
+    });
+  for (int key : { 0, kNumEntries - 1 }) {
+    faststring key_str;
+    PutFixed32(&key_str, key);
+    cache_->Erase(Slice(key_str));
+    ASSERT_EQ(-1, Lookup(key));
+  }
+}
+
+}  // namespace kudu
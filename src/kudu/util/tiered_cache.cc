@@ -0,0 +1,264 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+
+#include "kudu/util/tiered_cache.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+
+#include "kudu/gutil/gscoped_ptr.h"
+#include "kudu/gutil/macros.h"
+#include "kudu/gutil/strings/substitute.h"
+#include "kudu/util/flag_tags.h"
+#include "kudu/util/locks.h"
+#include "kudu/util/metrics.h"
+#include "kudu/util/threadpool.h"
+
+DEFINE_int32(tiered_cache_max_pending_demotions, 256,
+             "Maximum number of entries evicted from the DRAM tier of a tiered "
+             "cache which may be waiting to be copied to the NVM tier. Entries "
+             "evicted while this many are pending are dropped.");
+TAG_FLAG(tiered_cache_max_pending_demotions, advanced);
+
+METRIC_DEFINE_counter(server, block_cache_nvm_tier_hits,
+                      "Block Cache NVM Tier Hits", kudu::MetricUnit::kBlocks,
+                      "Number of lookups which missed the DRAM tier of the block "
+                      "cache but found the block in the NVM tier");
+METRIC_DEFINE_counter(server, block_cache_nvm_tier_demotions,
+                      "Block Cache NVM Tier Demotions", kudu::MetricUnit::kBlocks,
+                      "Number of blocks evicted from the DRAM tier of the block "
+                      "cache which were copied to the NVM tier");
+METRIC_DEFINE_counter(server, block_cache_nvm_tier_demotions_dropped,
+                      "Block Cache NVM Tier Dropped Demotions", kudu::MetricUnit::kBlocks,
+                      "Number of blocks evicted from the DRAM tier of the block "
+                      "cache which were dropped instead of being copied to the "
+                      "NVM tier, because too many copies were pending or the NVM "
+                      "tier had no room");
+
+using std::shared_ptr;
+using std::string;
+using strings::Substitute;
+
+namespace kudu {
+
+namespace {
+
+class TieredCache : public Cache {
+ public:
+  TieredCache(CacheEvictionPolicy dram_policy, size_t dram_capacity,
+              size_t nvm_capacity, const string& id)
+      : dram_(NewCache(DRAM_CACHE, dram_policy, dram_capacity, id)),
+        nvm_(NewCache(NVM_CACHE, CacheEvictionPolicy::LRU, nvm_capacity,
+                      Substitute("$0-nvm_tier", id))),
+        demoter_(this, nullptr) {
+    // A single thread keeps the demotions in eviction order, so that an
+    // entry that was replaced in the DRAM tier can't overwrite its
+    // replacement in the NVM tier.
+    CHECK_OK(ThreadPoolBuilder(Substitute("$0-demote", id))
+             .set_min_threads(0)
+             .set_max_threads(1)
+             .set_max_queue_size(FLAGS_tiered_cache_max_pending_demotions)
+             .Build(&demotion_pool_));
+  }
+
+  virtual ~TieredCache() {
+    // Entries still in the DRAM tier are freed (and their eviction callbacks
+    // called) with it, so stop accepting demotions first.
+    demotion_pool_->Shutdown();
+    dram_.reset();
+    nvm_.reset();
+  }
+
+  virtual Handle* Lookup(const Slice& key, CacheBehavior caching) OVERRIDE {
+    Handle* h = dram_->Lookup(key, caching);
+    if (h != nullptr) {
+      return h;
+    }
+    Handle* nh = nvm_->Lookup(key, caching);
+    if (nh == nullptr) {
+      return nullptr;
+    }
+
+    // Move the entry back to the DRAM tier.
+    Slice val = nvm_->Value(nh);
+    PendingHandle* ph = dram_->Allocate(key, val.size(), val.size());
+    if (ph != nullptr) {
+      memcpy(dram_->MutableValue(ph), val.data(), val.size());
+    }
+    nvm_->Release(nh);
+    if (ph == nullptr) {
+      return nullptr;
+    }
+    nvm_->Erase(key);
+    if (nvm_tier_hits_) {
+      nvm_tier_hits_->Increment();
+    }
+    return dram_->Insert(ph, &demoter_);
+  }
+
+  virtual void Release(Handle* handle) OVERRIDE {
+    dram_->Release(handle);
+  }
+
+  virtual Slice Value(Handle* handle) OVERRIDE {
+    return dram_->Value(handle);
+  }
+
+  virtual void Erase(const Slice& key) OVERRIDE {
+    // Erasing the DRAM entry demotes it, so wait for the demotion before
+    // erasing the NVM entry. Erase() is expected to be rare.
+    dram_->Erase(key);
+    demotion_pool_->Wait();
+    nvm_->Erase(key);
+  }
+
+  virtual uint64_t NewId() OVERRIDE {
+    return dram_->NewId();
+  }
+
+  virtual void SetMetrics(const scoped_refptr<MetricEntity>& metric_entity) OVERRIDE {
+    // Only the DRAM tier maintains the generic cache metrics: instrumenting
+    // both tiers would count an NVM hit as both a miss and a hit.
+    dram_->SetMetrics(metric_entity);
+    nvm_tier_hits_ = METRIC_block_cache_nvm_tier_hits.Instantiate(metric_entity);
+    demotions_ = METRIC_block_cache_nvm_tier_demotions.Instantiate(metric_entity);
+    demotions_dropped_ =
+        METRIC_block_cache_nvm_tier_demotions_dropped.Instantiate(metric_entity);
+  }
+
+  virtual void GetHotKeys(size_t max_keys, std::vector<string>* keys) OVERRIDE {
+    // Entries in the DRAM tier are hotter than the ones demoted from it.
+    size_t start = keys->size();
+    dram_->GetHotKeys(max_keys, keys);
+    nvm_->GetHotKeys(max_keys - (keys->size() - start), keys);
+  }
+
+  virtual PendingHandle* Allocate(Slice key, int val_len, int charge) OVERRIDE {
+    return dram_->Allocate(key, val_len, charge);
+  }
+
+  virtual uint8_t* MutableValue(PendingHandle* handle) OVERRIDE {
+    return dram_->MutableValue(handle);
+  }
+
+  virtual Handle* Insert(PendingHandle* pending,
+                         EvictionCallback* eviction_callback) OVERRIDE {
+    return dram_->Insert(pending, GetDemoter(eviction_callback));
+  }
+
+  virtual Handle* InsertCold(PendingHandle* pending,
+                             EvictionCallback* eviction_callback) OVERRIDE {
+    return dram_->InsertCold(pending, GetDemoter(eviction_callback));
+  }
+
+  virtual void Free(PendingHandle* ptr) OVERRIDE {
+    dram_->Free(ptr);
+  }
+
+ private:
+  // Queues the entries evicted from the DRAM tier for demotion, then calls
+  // the entries' own eviction callback, if any.
+  class Demoter : public EvictionCallback {
+   public:
+    Demoter(TieredCache* cache, EvictionCallback* user_callback)
+        : cache_(cache),
+          user_callback_(user_callback) {
+    }
+
+    virtual void EvictedEntry(Slice key, Slice value) OVERRIDE {
+      // The evicted entry is freed once this returns, so it must be copied.
+      shared_ptr<string> key_copy = std::make_shared<string>(key.ToString());
+      shared_ptr<string> value_copy = std::make_shared<string>(value.ToString());
+      TieredCache* cache = cache_;
+      Status s = cache->demotion_pool_->SubmitFunc([cache, key_copy, value_copy]() {
+          cache->Demote(*key_copy, *value_copy);
+        });
+      if (PREDICT_FALSE(!s.ok())) {
+        cache->DemotionDropped();
+      }
+      if (user_callback_) {
+        user_callback_->EvictedEntry(key, value);
+      }
+    }
+
+   private:
+    TieredCache* cache_;
+    EvictionCallback* const user_callback_;
+  };
+
+  Demoter* GetDemoter(EvictionCallback* user_callback) {
+    if (user_callback == nullptr) {
+      return &demoter_;
+    }
+    // Demoters are never freed: there is typically one per tablet, and
+    // entries referring to them may outlive their owners. A callback address
+    // that gets reused reuses the demoter, which only refers to the address.
+    std::lock_guard<simple_spinlock> l(demoters_lock_);
+    std::unique_ptr<Demoter>& demoter = demoters_[user_callback];
+    if (!demoter) {
+      demoter.reset(new Demoter(this, user_callback));
+    }
+    return demoter.get();
+  }
+
+  void Demote(const Slice& key, const Slice& value) {
+    PendingHandle* ph = nvm_->Allocate(key, value.size(), value.size());
+    if (PREDICT_FALSE(ph == nullptr)) {
+      DemotionDropped();
+      return;
+    }
+    memcpy(nvm_->MutableValue(ph), value.data(), value.size());
+    nvm_->Release(nvm_->Insert(ph, nullptr));
+    if (demotions_) {
+      demotions_->Increment();
+    }
+  }
+
+  void DemotionDropped() {
+    if (demotions_dropped_) {
+      demotions_dropped_->Increment();
+    }
+  }
+
+  gscoped_ptr<Cache> dram_;
+  gscoped_ptr<Cache> nvm_;
+  Demoter demoter_;
+  gscoped_ptr<ThreadPool> demotion_pool_;
+
+  simple_spinlock demoters_lock_;
+  std::unordered_map<EvictionCallback*, std::unique_ptr<Demoter>> demoters_;
+
+  scoped_refptr<Counter> nvm_tier_hits_;
+  scoped_refptr<Counter> demotions_;
+  scoped_refptr<Counter> demotions_dropped_;
+
+  DISALLOW_COPY_AND_ASSIGN(TieredCache);
+};
+
+} // anonymous namespace
+
+Cache* NewTieredCache(CacheEvictionPolicy dram_policy, size_t dram_capacity,
+                      size_t nvm_capacity, const string& id) {
+  return new TieredCache(dram_policy, dram_capacity, nvm_capacity, id);
+}
+
+}  // namespace kudu
@@ -0,0 +1,42 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing,
+// software distributed under the License is distributed on an
+// "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+// KIND, either express or implied.  See the License for the
+// specific language governing permissions and limitations
+// under the License.
+#ifndef KUDU_UTIL_TIERED_CACHE_H_
+#define KUDU_UTIL_TIERED_CACHE_H_
+
+#include <string>
+
+#include "kudu/util/cache.h"
+
+namespace kudu {
+
+// Create a cache made of a DRAM tier of 'dram_capacity' in front of an NVM
+// tier of 'nvm_capacity'. The DRAM tier uses the given eviction policy.
+//
+// Entries are inserted into the DRAM tier. Entries evicted from it are copied
+// to the NVM tier asynchronously instead of being dropped; if the copies fall
+// too far behind, further evicted entries are dropped. A lookup checks the
+// DRAM tier, then the NVM tier, moving the entry back to the DRAM tier on an
+// NVM hit. Handles returned by the cache always refer to DRAM entries.
+//
+// Eviction callbacks are called when entries leave the DRAM tier. Entries
+// moved back from the NVM tier have no eviction callback.
+Cache* NewTieredCache(CacheEvictionPolicy dram_policy, size_t dram_capacity,
+                      size_t nvm_capacity, const std::string& id);
+
+}  // namespace kudu
+
+#endif
@@ -47,6 +47,24 @@ class WebCallbackRegistry {
   typedef boost::function<void (const WebRequest& args, std::ostringstream* output)>
       PathHandlerCallback;
 
+  // The output of a streaming path handler. The page is rendered into
+  // output() and sent to the client piecemeal as Flush() is called, so that
+  // large pages needn't be buffered whole before being sent.
+  class WebResponseStream {
+   public:
+    virtual ~WebResponseStream() {}
+
+    // The buffer to render the next part of the page into.
+    virtual std::ostringstream* output() = 0;
+
+    // Hints that the page rendered so far may be sent to the client. The
+    // output may be held back until enough of it is buffered.
+    virtual void Flush() = 0;
+  };
+
+  typedef boost::function<void (const WebRequest& args, WebResponseStream* stream)>
+      StreamingPathHandlerCallback;
+
   virtual ~WebCallbackRegistry() {}
 
   // Register a callback for a URL path. Path should not include the
@@ -61,6 +79,13 @@ class WebCallbackRegistry {
   virtual void RegisterPathHandler(const std::string& path, const std::string& alias,
                                    const PathHandlerCallback& callback,
                                    bool is_styled = true, bool is_on_nav_bar = true) = 0;
+
+  // Like RegisterPathHandler(), but the page is sent with chunked transfer
+  // encoding as the callback renders it.
+  virtual void RegisterStreamingPathHandler(const std::string& path, const std::string& alias,
+                                            const StreamingPathHandlerCallback& callback,
+                                            bool is_styled = true,
+                                            bool is_on_nav_bar = true) = 0;
 };
 
 } // namespace kudu
@@ -265,6 +265,10 @@ if [ ! -d $LZ4_SOURCE ]; then
   echo
 fi
 
+if [ ! -d $ZSTD_SOURCE ]; then
+  fetch_and_expand zstd-${ZSTD_VERSION}.tar.gz
+fi
+
 if [ ! -d $BITSHUFFLE_SOURCE ]; then
   fetch_and_expand bitshuffle-${BITSHUFFLE_VERSION}.tar.gz
 fi